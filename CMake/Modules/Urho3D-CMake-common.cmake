@@ -109,6 +109,7 @@ else ()
 endif ()
 option (URHO3D_PACKAGING "Enable resources packaging support, on Emscripten default to 1, on other platforms default to 0" ${EMSCRIPTEN})
 option (URHO3D_PROFILING "Enable profiling support" TRUE)
+option (URHO3D_MEMORY_TRACKING "Enable tagged memory tracking through global operator new and delete" FALSE)
 option (URHO3D_LOGGING "Enable logging support" TRUE)
 option (URHO3D_TESTING "Enable testing support")
 if (URHO3D_TESTING)
@@ -219,6 +220,9 @@ if (EMSCRIPTEN)     # CMAKE_CROSSCOMPILING is always true for Emscripten
     math (EXPR EMSCRIPTEN_TOTAL_MEMORY "32 * 1024 * 1024")     # This option is ignored when EMSCRIPTEN_ALLOW_MEMORY_GROWTH option is set
     set (EMSCRIPTEN_TOTAL_MEMORY ${EMSCRIPTEN_TOTAL_MEMORY} CACHE STRING "Specify the total size of memory to be used (Emscripten cross-compiling build only); default to 33554432 (32MB), this option is ignored when EMSCRIPTEN_ALLOW_MEMORY_GROWTH=1")
     cmake_dependent_option (EMSCRIPTEN_SHARE_DATA "Enable sharing data file support (Emscripten cross-compiling build only)" FALSE "EMSCRIPTEN" FALSE)
+    option (EMSCRIPTEN_WEBGL2 "Enable WebGL 2 support for vertex array objects and hardware instancing, falling back to WebGL 1 when the browser does not support it (Emscripten cross-compiling build only)")
+    option (EMSCRIPTEN_PTHREADS "Enable worker threads using pthreads; the threads are only created when the page is served cross-origin isolated, otherwise the engine runs single-threaded (Emscripten cross-compiling build only)")
+    set (EMSCRIPTEN_PTHREAD_POOL_SIZE 4 CACHE STRING "Specify the number of web workers created at startup for the worker threads (Emscripten cross-compiling build with pthreads only); default to 4")
 endif ()
 # Constrain the build option values in cmake-gui, if applicable
 if (CMAKE_VERSION VERSION_GREATER 2.8 OR CMAKE_VERSION VERSION_EQUAL 2.8)
@@ -275,6 +279,11 @@ if (URHO3D_PROFILING)
     add_definitions (-DURHO3D_PROFILING)
 endif ()
 
+# Disable memory tracking by default. If enabled, global operator new and delete are replaced to account allocations per MEMORY_TAG scope.
+if (URHO3D_MEMORY_TRACKING)
+    add_definitions (-DURHO3D_MEMORY_TRACKING)
+endif ()
+
 # Enable logging by default. If disabled, LOGXXXX macros become no-ops and the Log subsystem is not instantiated.
 if (URHO3D_LOGGING)
     add_definitions (-DURHO3D_LOGGING)
@@ -296,6 +305,11 @@ if (URHO3D_OPENGL)
     add_definitions (-DURHO3D_OPENGL)
 endif ()
 
+# Add definition for WebGL 2
+if (EMSCRIPTEN_WEBGL2)
+    add_definitions (-DURHO3D_WEBGL2)
+endif ()
+
 # Add definitions for GLEW
 if (NOT IOS AND NOT ANDROID AND NOT RPI AND URHO3D_OPENGL)
     add_definitions (-DGLEW_STATIC -DGLEW_NO_GLU)
@@ -473,6 +487,11 @@ else ()
             endif ()
             set (CMAKE_C_FLAGS_RELEASE "-Oz -DNDEBUG")
             set (CMAKE_CXX_FLAGS_RELEASE "-Oz -DNDEBUG")
+            if (EMSCRIPTEN_PTHREADS)
+                # All the code, including the third-party libraries, must be compiled with atomics and shared memory support
+                set (CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -s USE_PTHREADS=1")
+                set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -s USE_PTHREADS=1")
+            endif ()
             if (DEFINED ENV{CI})
                 # Our CI server is slow, so do not optimize and discard all debug info when test building in Debug configuration
                 set (CMAKE_C_FLAGS_DEBUG "-g0")
@@ -869,6 +888,13 @@ macro (setup_emscripten_linker_flags LINKER_FLAGS)
         set (MEMORY_LINKER_FLAGS "-s TOTAL_MEMORY=${EMSCRIPTEN_TOTAL_MEMORY}")
     endif ()
     set (${LINKER_FLAGS} "${${LINKER_FLAGS}} ${MEMORY_LINKER_FLAGS} -s USE_SDL=2 -s NO_EXIT_RUNTIME=1 -s ERROR_ON_UNDEFINED_SYMBOLS=1")
+    if (EMSCRIPTEN_WEBGL2)
+        set (${LINKER_FLAGS} "${${LINKER_FLAGS}} -s USE_WEBGL2=1")
+    endif ()
+    if (EMSCRIPTEN_PTHREADS)
+        # Create the web workers at startup, as the browser can only start them after returning to its event loop
+        set (${LINKER_FLAGS} "${${LINKER_FLAGS}} -s USE_PTHREADS=1 -s PTHREAD_POOL_SIZE=${EMSCRIPTEN_PTHREAD_POOL_SIZE}")
+    endif ()
     set (${LINKER_FLAGS}_RELEASE "${${LINKER_FLAGS}_RELEASE} -O3 -s AGGRESSIVE_VARIABLE_ELIMINATION=1")     # Remove variables to make the -O3 regalloc easier
     if (NOT DEFINED ENV{CI})
         set (${LINKER_FLAGS}_DEBUG "${${LINKER_FLAGS}_DEBUG} -g4")     # Preserve LLVM debug information, show line number debug comments, and generate source maps
@@ -150,6 +150,7 @@ protected:
 	friend class b2ContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2Island;
 
 	// Flags stored in m_flags
 	enum
@@ -208,6 +209,10 @@ protected:
 	int32 m_indexA;
 	int32 m_indexB;
 
+	// Urho3D: island indices of the bodies, assigned when the island is built.
+	int32 m_islandIndexA;
+	int32 m_islandIndexB;
+
 	b2Manifold m_manifold;
 
 	int32 m_toiCount;
@@ -21,6 +21,7 @@
 
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
 
 class b2Contact;
@@ -69,6 +70,17 @@ public:
 		m_joints[m_jointCount++] = joint;
 	}
 
+	/// Urho3D: store the island indices of the bodies into the contacts, after all bodies have been added.
+	void AssignContactIndices()
+	{
+		for (int32 i = 0; i < m_contactCount; ++i)
+		{
+			b2Contact* contact = m_contacts[i];
+			contact->m_islandIndexA = contact->GetFixtureA()->GetBody()->m_islandIndex;
+			contact->m_islandIndexB = contact->GetFixtureB()->GetBody()->m_islandIndex;
+		}
+	}
+
 	void Report(const b2ContactVelocityConstraint* constraints);
 
 	b2StackAllocator* m_allocator;
@@ -39,6 +39,10 @@ b2World::b2World(const b2Vec2& gravity)
 	m_destructionListener = NULL;
 	m_debugDraw = NULL;
 
+	m_taskExecutor = NULL;
+	m_threadAllocators = NULL;
+	m_threadAllocatorCount = 0;
+
 	m_bodyList = NULL;
 	m_jointList = NULL;
 
@@ -82,6 +86,8 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	delete [] m_threadAllocators;
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -99,6 +105,57 @@ void b2World::SetContactListener(b2ContactListener* listener)
 	m_contactManager.m_contactListener = listener;
 }
 
+void b2World::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	m_taskExecutor = executor;
+}
+
+// Urho3D: island gathered for parallel solving, as ranges of the shared body, contact and joint arrays.
+struct b2IslandTask
+{
+	int32 bodyStart;
+	int32 bodyCount;
+	int32 contactStart;
+	int32 contactCount;
+	int32 jointStart;
+	int32 jointCount;
+	b2Profile profile;
+};
+
+// Urho3D: shared data of the parallel island solving tasks.
+struct b2IslandTaskData
+{
+	b2IslandTask* tasks;
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	const b2TimeStep* step;
+	b2Vec2 gravity;
+	bool allowSleep;
+	b2ContactListener* listener;
+	b2StackAllocator* allocator;
+	b2StackAllocator* threadAllocators;
+};
+
+// Urho3D: solve one gathered island. The body island indices and the contact island indices were
+// assigned when the island was gathered, so they are not written here.
+static void b2SolveIslandTask(void* data, int32 index, int32 threadIndex)
+{
+	b2IslandTaskData* taskData = (b2IslandTaskData*)data;
+	b2IslandTask* task = taskData->tasks + index;
+	b2StackAllocator* allocator = threadIndex ? taskData->threadAllocators + threadIndex - 1 : taskData->allocator;
+
+	b2Island island(task->bodyCount, task->contactCount, task->jointCount, allocator, taskData->listener);
+	memcpy(island.m_bodies, taskData->bodies + task->bodyStart, task->bodyCount * sizeof(b2Body*));
+	memcpy(island.m_contacts, taskData->contacts + task->contactStart, task->contactCount * sizeof(b2Contact*));
+	memcpy(island.m_joints, taskData->joints + task->jointStart, task->jointCount * sizeof(b2Joint*));
+	island.m_bodyCount = task->bodyCount;
+	island.m_contactCount = task->contactCount;
+	island.m_jointCount = task->jointCount;
+
+	island.Solve(&task->profile, *taskData->step, taskData->gravity, taskData->allowSleep);
+}
+
 void b2World::SetDebugDraw(b2Draw* debugDraw)
 {
 	m_debugDraw = debugDraw;
@@ -410,6 +467,31 @@ void b2World::Solve(const b2TimeStep& step)
 		j->m_islandFlag = false;
 	}
 
+	// Urho3D: with a task executor, gather the islands first and solve them in parallel afterward.
+	// A static body can belong to several islands, so the island indices are stored in the contacts.
+	// Joints read the island indices of their bodies directly, so islands with joints to static bodies
+	// (or gear joints, which refer to further bodies) are solved after the parallel ones instead.
+	int32 numThreads = m_taskExecutor ? m_taskExecutor->GetNumThreads() : 1;
+	bool parallel = numThreads > 1;
+	b2IslandTask* tasks = NULL;
+	b2Body** taskBodies = NULL;
+	b2Contact** taskContacts = NULL;
+	b2Joint** taskJoints = NULL;
+	int32 taskCount = 0;
+	int32 serialTaskCount = 0;
+	int32 taskBodyCount = 0;
+	int32 taskContactCount = 0;
+	int32 taskJointCount = 0;
+	if (parallel)
+	{
+		// Every static body entry of an island is reached through a contact or a joint of that island.
+		int32 contactCount = m_contactManager.m_contactCount;
+		tasks = (b2IslandTask*)b2Alloc(b2Max(m_bodyCount, 1) * sizeof(b2IslandTask));
+		taskBodies = (b2Body**)b2Alloc(b2Max(m_bodyCount + contactCount + m_jointCount, 1) * sizeof(b2Body*));
+		taskContacts = (b2Contact**)b2Alloc(b2Max(contactCount, 1) * sizeof(b2Contact*));
+		taskJoints = (b2Joint**)b2Alloc(b2Max(m_jointCount, 1) * sizeof(b2Joint*));
+	}
+
 	// Build and simulate all awake islands.
 	int32 stackSize = m_bodyCount;
 	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
@@ -527,11 +609,45 @@ void b2World::Solve(const b2TimeStep& step)
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+		island.AssignContactIndices();
+
+		if (parallel)
+		{
+			bool serial = false;
+			for (int32 i = 0; i < island.m_jointCount; ++i)
+			{
+				b2Joint* joint = island.m_joints[i];
+				if (joint->m_type == e_gearJoint || joint->m_bodyA->m_type == b2_staticBody ||
+					joint->m_bodyB->m_type == b2_staticBody)
+				{
+					serial = true;
+					break;
+				}
+			}
+
+			// Parallel islands are stored from the start of the task array, serial islands from the end.
+			b2IslandTask* task = serial ? tasks + m_bodyCount - 1 - serialTaskCount++ : tasks + taskCount++;
+			task->bodyStart = taskBodyCount;
+			task->bodyCount = island.m_bodyCount;
+			task->contactStart = taskContactCount;
+			task->contactCount = island.m_contactCount;
+			task->jointStart = taskJointCount;
+			task->jointCount = island.m_jointCount;
+			memcpy(taskBodies + taskBodyCount, island.m_bodies, island.m_bodyCount * sizeof(b2Body*));
+			memcpy(taskContacts + taskContactCount, island.m_contacts, island.m_contactCount * sizeof(b2Contact*));
+			memcpy(taskJoints + taskJointCount, island.m_joints, island.m_jointCount * sizeof(b2Joint*));
+			taskBodyCount += island.m_bodyCount;
+			taskContactCount += island.m_contactCount;
+			taskJointCount += island.m_jointCount;
+		}
+		else
+		{
+			b2Profile profile;
+			island.Solve(&profile, step, m_gravity, m_allowSleep);
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+		}
 
 		// Post solve cleanup.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
@@ -547,6 +663,78 @@ void b2World::Solve(const b2TimeStep& step)
 
 	m_stackAllocator.Free(stack);
 
+	if (parallel)
+	{
+		if (m_threadAllocatorCount < numThreads - 1)
+		{
+			delete [] m_threadAllocators;
+			m_threadAllocatorCount = numThreads - 1;
+			m_threadAllocators = new b2StackAllocator[m_threadAllocatorCount];
+		}
+
+		b2IslandTaskData taskData;
+		taskData.tasks = tasks;
+		taskData.bodies = taskBodies;
+		taskData.contacts = taskContacts;
+		taskData.joints = taskJoints;
+		taskData.step = &step;
+		taskData.gravity = m_gravity;
+		taskData.allowSleep = m_allowSleep;
+		taskData.listener = m_contactManager.m_contactListener;
+		taskData.allocator = &m_stackAllocator;
+		taskData.threadAllocators = m_threadAllocators;
+
+		if (taskCount > 1)
+		{
+			m_taskExecutor->Run(b2SolveIslandTask, &taskData, taskCount);
+		}
+		else
+		{
+			for (int32 i = 0; i < taskCount; ++i)
+			{
+				b2SolveIslandTask(&taskData, i, 0);
+			}
+		}
+
+		for (int32 i = 0; i < taskCount; ++i)
+		{
+			m_profile.solveInit += tasks[i].profile.solveInit;
+			m_profile.solveVelocity += tasks[i].profile.solveVelocity;
+			m_profile.solvePosition += tasks[i].profile.solvePosition;
+		}
+
+		// Solve the serial islands in the order they were gathered, reassigning the island indices.
+		for (int32 i = 0; i < serialTaskCount; ++i)
+		{
+			b2IslandTask* task = tasks + m_bodyCount - 1 - i;
+			island.Clear();
+			for (int32 j = 0; j < task->bodyCount; ++j)
+			{
+				island.Add(taskBodies[task->bodyStart + j]);
+			}
+			for (int32 j = 0; j < task->contactCount; ++j)
+			{
+				island.Add(taskContacts[task->contactStart + j]);
+			}
+			for (int32 j = 0; j < task->jointCount; ++j)
+			{
+				island.Add(taskJoints[task->jointStart + j]);
+			}
+			island.AssignContactIndices();
+
+			b2Profile profile;
+			island.Solve(&profile, step, m_gravity, m_allowSleep);
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+		}
+
+		b2Free(taskJoints);
+		b2Free(taskContacts);
+		b2Free(taskBodies);
+		b2Free(tasks);
+	}
+
 	{
 		b2Timer timer;
 		// Synchronize fixtures, check for out of range bodies.
@@ -860,6 +1048,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.warmStarting = false;
+		island.AssignContactIndices();
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
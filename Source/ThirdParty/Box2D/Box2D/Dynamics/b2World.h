@@ -61,6 +61,10 @@ public:
 	/// remain in scope.
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Urho3D: register a task executor to solve the islands in parallel. The executor is owned
+	/// by you and must remain in scope. Pass NULL to solve the islands in the calling thread.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside with b2World::DrawDebugData method. The debug draw object is owned
 	/// by you and must remain in scope.
@@ -249,6 +253,11 @@ private:
 	b2DestructionListener* m_destructionListener;
 	b2Draw* m_debugDraw;
 
+	// Urho3D: parallel island solving, with stack allocators for the threads other than the calling thread.
+	b2TaskExecutor* m_taskExecutor;
+	b2StackAllocator* m_threadAllocators;
+	int32 m_threadAllocatorCount;
+
 	// This is used to compute the time step ratio to
 	// support a variable time step.
 	float32 m_inv_dt0;
@@ -152,4 +152,23 @@ public:
 									const b2Vec2& normal, float32 fraction) = 0;
 };
 
+/// Urho3D: task function called by b2TaskExecutor::Run for each index.
+/// The thread index is below b2TaskExecutor::GetNumThreads, and zero for the calling thread.
+typedef void (*b2TaskFunction)(void* data, int32 index, int32 threadIndex);
+
+/// Urho3D: implement this class to let the world solve its islands in parallel.
+/// @warning b2ContactListener::PostSolve may then be called from several threads at once.
+class b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// Return the number of threads that may run tasks, including the calling thread.
+	virtual int32 GetNumThreads() = 0;
+
+	/// Call the task function for each index below count, possibly in parallel.
+	/// Return once all the calls have finished.
+	virtual void Run(b2TaskFunction task, void* data, int32 count) = 0;
+};
+
 #endif
@@ -198,6 +198,35 @@ struct dtCrowdAgentDebugInfo
 	dtObstacleAvoidanceDebugData* vod;
 };
 
+/// A function run by a #dtCrowdTaskExecutor on a range of items.
+///  @param[in]		data		The task data.
+///  @param[in]		begin		The index of the first item.
+///  @param[in]		end			The index after the last item.
+///  @param[in]		threadIndex	The index of the running thread. [Limits: 0 <= value < #dtCrowdTaskExecutor::getNumThreads()]
+typedef void (*dtCrowdTaskFunction)(void* data, int begin, int end, int threadIndex);
+
+/// Runs the passes of a crowd update on several threads.
+/// @ingroup crowd
+/// @see dtCrowd::setTaskExecutor()
+class dtCrowdTaskExecutor
+{
+public:
+	virtual ~dtCrowdTaskExecutor() {}
+	
+	/// Gets the number of threads that run tasks, including the calling thread, which must have index 0.
+	/// @return The number of threads.
+	virtual int getNumThreads() = 0;
+	
+	/// Runs the task on the items [0, count) split into ranges, and returns when all the ranges are done.
+	///  @param[in]		task	The task function.
+	///  @param[in]		data	The task data.
+	///  @param[in]		count	The number of items.
+	virtual void run(dtCrowdTaskFunction task, void* data, int count) = 0;
+};
+
+struct dtCrowdPassData;
+struct dtCrowdAgentSortItem;
+
 /// Provides local steering behaviors for a group of agents. 
 /// @ingroup crowd
 class dtCrowd
@@ -226,6 +255,13 @@ class dtCrowd
 	int m_velocitySampleCount;
 
 	dtNavMeshQuery* m_navquery;
+	
+	dtCrowdTaskExecutor* m_taskExecutor;
+	int m_numThreads;
+	dtNavMeshQuery** m_threadNavQueries;
+	dtObstacleAvoidanceQuery** m_threadObstacleQueries;
+	int* m_threadSampleCounts;
+	dtCrowdAgentSortItem* m_sortItems;
 
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
@@ -234,6 +270,13 @@ class dtCrowd
 	inline int getAgentIndex(const dtCrowdAgent* agent) const  { return (int)(agent - m_agents); }
 
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
+	
+	bool initThreadData();
+	void freeThreadData();
+	void sortAgents(dtCrowdAgent** agents, const int nagents);
+	void runPass(const int pass, dtCrowdAgent** agents, const int nagents, const float dt, dtCrowdAgentDebugInfo* debug);
+	void updatePass(const dtCrowdPassData& data, const int begin, const int end, const int threadIndex);
+	static void passTask(void* data, int begin, int end, int threadIndex);
 
 	void purge();
 	
@@ -317,6 +360,15 @@ public:
 	///  @param[out]	debug	A debug object to load with debug information. [Opt]
 	void update(const float dt, dtCrowdAgentDebugInfo* debug);
 	
+	/// Sets the executor for running the update on several threads, or null to update on the calling thread.
+	///  @param[in]		executor	The task executor. [Opt]
+	/// @return True if the per-thread queries could be allocated.
+	bool setTaskExecutor(dtCrowdTaskExecutor* executor);
+	
+	/// Gets the executor used for running the update on several threads.
+	/// @return The task executor, or null if not set.
+	dtCrowdTaskExecutor* getTaskExecutor() const { return m_taskExecutor; }
+	
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
 	inline const dtQueryFilter* getFilter(const int i) const { return (i >= 0 && i < DT_CROWD_MAX_QUERY_FILTER_TYPE) ? &m_filters[i] : 0; }
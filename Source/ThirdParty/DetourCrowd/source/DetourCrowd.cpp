@@ -51,6 +51,37 @@ static const int MAX_ITERS_PER_UPDATE = 100;
 static const int MAX_PATHQUEUE_NODES = 4096;
 static const int MAX_COMMON_NODES = 512;
 
+/// The passes of the crowd update that can be run on several threads.
+enum dtCrowdUpdatePass
+{
+	DT_CROWD_PASS_NEIGHBOURS,
+	DT_CROWD_PASS_CORNERS,
+	DT_CROWD_PASS_STEERING,
+	DT_CROWD_PASS_VELOCITY,
+	DT_CROWD_PASS_INTEGRATE,
+	DT_CROWD_PASS_COLLISION,
+	DT_CROWD_PASS_DISPLACE,
+	DT_CROWD_PASS_MOVE,
+};
+
+/// The data of an update pass, passed to the task executor.
+struct dtCrowdPassData
+{
+	dtCrowd* crowd;
+	int pass;
+	dtCrowdAgent** agents;
+	int nagents;
+	float dt;
+	dtCrowdAgentDebugInfo* debug;
+};
+
+/// An agent and its spatial sort key.
+struct dtCrowdAgentSortItem
+{
+	unsigned int key;
+	dtCrowdAgent* agent;
+};
+
 inline float tween(const float t, const float t0, const float t1)
 {
 	return dtClamp((t-t0) / (t1-t0), 0.0f, 1.0f);
@@ -340,7 +371,13 @@ dtCrowd::dtCrowd() :
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_taskExecutor(0),
+	m_numThreads(0),
+	m_threadNavQueries(0),
+	m_threadObstacleQueries(0),
+	m_threadSampleCounts(0),
+	m_sortItems(0)
 {
 }
 
@@ -351,6 +388,11 @@ dtCrowd::~dtCrowd()
 
 void dtCrowd::purge()
 {
+	freeThreadData();
+	
+	dtFree(m_sortItems);
+	m_sortItems = 0;
+	
 	for (int i = 0; i < m_maxAgents; ++i)
 		m_agents[i].~dtCrowdAgent();
 	dtFree(m_agents);
@@ -438,6 +480,10 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	if (!m_agentAnims)
 		return false;
 	
+	m_sortItems = (dtCrowdAgentSortItem*)dtAlloc(sizeof(dtCrowdAgentSortItem)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_sortItems)
+		return false;
+	
 	for (int i = 0; i < m_maxAgents; ++i)
 	{
 		new(&m_agents[i]) dtCrowdAgent();
@@ -458,9 +504,82 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	if (dtStatusFailed(m_navquery->init(nav, MAX_COMMON_NODES)))
 		return false;
 	
+	if (m_taskExecutor && !initThreadData())
+		return false;
+	
 	return true;
 }
 
+/// @par
+///
+/// The executor must stay valid until it is replaced or the crowd is destroyed. A query is allocated for
+/// each additional thread, so the executor should return the same number of threads until it is set again.
+bool dtCrowd::setTaskExecutor(dtCrowdTaskExecutor* executor)
+{
+	freeThreadData();
+	m_taskExecutor = executor;
+	
+	if (m_taskExecutor && m_navquery)
+		return initThreadData();
+	return true;
+}
+
+bool dtCrowd::initThreadData()
+{
+	const int numThreads = m_taskExecutor->getNumThreads();
+	if (numThreads <= 1)
+		return true;
+	
+	m_threadNavQueries = (dtNavMeshQuery**)dtAlloc(sizeof(dtNavMeshQuery*)*numThreads, DT_ALLOC_PERM);
+	m_threadObstacleQueries = (dtObstacleAvoidanceQuery**)dtAlloc(sizeof(dtObstacleAvoidanceQuery*)*numThreads, DT_ALLOC_PERM);
+	m_threadSampleCounts = (int*)dtAlloc(sizeof(int)*numThreads, DT_ALLOC_PERM);
+	if (!m_threadNavQueries || !m_threadObstacleQueries || !m_threadSampleCounts)
+	{
+		freeThreadData();
+		return false;
+	}
+	
+	// Thread 0 uses the crowd's own queries.
+	m_threadNavQueries[0] = m_navquery;
+	m_threadObstacleQueries[0] = m_obstacleQuery;
+	m_threadSampleCounts[0] = 0;
+	m_numThreads = 1;
+	
+	for (int i = 1; i < numThreads; ++i)
+	{
+		m_threadNavQueries[i] = dtAllocNavMeshQuery();
+		m_threadObstacleQueries[i] = dtAllocObstacleAvoidanceQuery();
+		m_threadSampleCounts[i] = 0;
+		m_numThreads = i + 1;
+		
+		if (!m_threadNavQueries[i] || dtStatusFailed(m_threadNavQueries[i]->init(m_navquery->getAttachedNavMesh(), MAX_COMMON_NODES)) ||
+			!m_threadObstacleQueries[i] || !m_threadObstacleQueries[i]->init(6, 8))
+		{
+			freeThreadData();
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+void dtCrowd::freeThreadData()
+{
+	for (int i = 1; i < m_numThreads; ++i)
+	{
+		dtFreeNavMeshQuery(m_threadNavQueries[i]);
+		dtFreeObstacleAvoidanceQuery(m_threadObstacleQueries[i]);
+	}
+	
+	dtFree(m_threadNavQueries);
+	m_threadNavQueries = 0;
+	dtFree(m_threadObstacleQueries);
+	m_threadObstacleQueries = 0;
+	dtFree(m_threadSampleCounts);
+	m_threadSampleCounts = 0;
+	m_numThreads = 0;
+}
+
 void dtCrowd::setObstacleAvoidanceParams(const int idx, const dtObstacleAvoidanceParams* params)
 {
 	if (idx >= 0 && idx < DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS)
@@ -1046,8 +1165,6 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 {
 	m_velocitySampleCount = 0;
 	
-	const int debugIdx = debug ? debug->idx : -1;
-	
 	dtCrowdAgent** agents = m_activeAgents;
 	int nagents = getActiveAgents(agents, m_maxAgents);
 
@@ -1060,6 +1177,10 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	// Optimize path topology.
 	updateTopologyOptimization(agents, nagents, dt);
 	
+	// When updating in parallel, order the agents spatially so that each thread works on nearby agents.
+	if (m_numThreads > 1)
+		sortAgents(agents, nagents);
+	
 	// Register agents to proximity grid.
 	m_grid->clear();
 	for (int i = 0; i < nagents; ++i)
@@ -1071,67 +1192,10 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	}
 	
 	// Get nearby navmesh segments and agents to collide with.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-
-		// Update the collision boundary after certain distance has been passed or
-		// if it has become invalid.
-		const float updateThr = ag->params.collisionQueryRange*0.25f;
-		if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
-			!ag->boundary.isValid(m_navquery, &m_filters[ag->params.queryFilterType]))
-		{
-			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
-								m_navquery, &m_filters[ag->params.queryFilterType]);
-		}
-		// Query neighbour agents
-		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
-								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
-								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
-	}
+	runPass(DT_CROWD_PASS_NEIGHBOURS, agents, nagents, dt, debug);
 	
 	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
-		
-		// Check to see if the corner after the next corner is directly visible,
-		// and short cut to there.
-		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
-		{
-			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
-			
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
-				dtVcopy(debug->optEnd, target);
-			}
-		}
-		else
-		{
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVset(debug->optStart, 0,0,0);
-				dtVset(debug->optEnd, 0,0,0);
-			}
-		}
-	}
+	runPass(DT_CROWD_PASS_CORNERS, agents, nagents, dt, debug);
 	
 	// Trigger off-mesh connections (depends on corners).
 	for (int i = 0; i < nagents; ++i)
@@ -1175,156 +1239,335 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	}
 		
 	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
+	runPass(DT_CROWD_PASS_STEERING, agents, nagents, dt, debug);
+	
+	// Velocity planning.	
+	runPass(DT_CROWD_PASS_VELOCITY, agents, nagents, dt, debug);
+	if (m_threadSampleCounts)
 	{
-		dtCrowdAgent* ag = agents[i];
+		for (int i = 0; i < m_numThreads; ++i)
+		{
+			m_velocitySampleCount += m_threadSampleCounts[i];
+			m_threadSampleCounts[i] = 0;
+		}
+	}
 
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+	// Integrate.
+	runPass(DT_CROWD_PASS_INTEGRATE, agents, nagents, dt, debug);
+	
+	// Handle collisions.
+	for (int iter = 0; iter < 4; ++iter)
+	{
+		runPass(DT_CROWD_PASS_COLLISION, agents, nagents, dt, debug);
+		runPass(DT_CROWD_PASS_DISPLACE, agents, nagents, dt, debug);
+	}
+	
+	// Move along navmesh.
+	runPass(DT_CROWD_PASS_MOVE, agents, nagents, dt, debug);
+	
+	// Update agents using off-mesh connection.
+	for (int i = 0; i < m_maxAgents; ++i)
+	{
+		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
+		if (!anim->active)
 			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+		dtCrowdAgent* ag = &m_agents[i];
+
+		anim->t += dt;
+		if (anim->t > anim->tmax)
+		{
+			// Reset animation
+			anim->active = false;
+			// Prepare agent for walking.
+			ag->state = DT_CROWDAGENT_STATE_WALKING;
 			continue;
+		}
 		
-		float dvel[3] = {0,0,0};
-
-		if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+		// Update position
+		const float ta = anim->tmax*0.15f;
+		const float tb = anim->tmax;
+		if (anim->t < ta)
 		{
-			dtVcopy(dvel, ag->targetPos);
-			ag->desiredSpeed = dtVlen(ag->targetPos);
+			const float u = tween(anim->t, 0.0, ta);
+			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
 		}
 		else
 		{
-			// Calculate steering direction.
-			if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
-				calcSmoothSteerDirection(ag, dvel);
-			else
-				calcStraightSteerDirection(ag, dvel);
+			const float u = tween(anim->t, ta, tb);
+			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
+		}
 			
-			// Calculate speed scale, which tells the agent to slowdown at the end of the path.
-			const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
-			const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
-				
-			ag->desiredSpeed = ag->params.maxSpeed;
-			dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+		// Update velocity.
+		dtVset(ag->vel, 0,0,0);
+		dtVset(ag->dvel, 0,0,0);
+	}
+	
+}
+
+void dtCrowd::runPass(const int pass, dtCrowdAgent** agents, const int nagents, const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	dtCrowdPassData data;
+	data.crowd = this;
+	data.pass = pass;
+	data.agents = agents;
+	data.nagents = nagents;
+	data.dt = dt;
+	data.debug = debug;
+	
+	if (m_numThreads > 1)
+		m_taskExecutor->run(passTask, &data, nagents);
+	else
+		updatePass(data, 0, nagents, 0);
+}
+
+void dtCrowd::passTask(void* data, int begin, int end, int threadIndex)
+{
+	const dtCrowdPassData& passData = *(const dtCrowdPassData*)data;
+	passData.crowd->updatePass(passData, begin, end, threadIndex);
+}
+
+/// @par
+///
+/// Each pass only writes to the agents in the range, and only reads the parts of the other agents that
+/// no pass running at the same time writes, so the ranges of a pass can be updated on different threads.
+void dtCrowd::updatePass(const dtCrowdPassData& data, const int begin, const int end, const int threadIndex)
+{
+	dtCrowdAgent** agents = data.agents;
+	const int nagents = data.nagents;
+	const float dt = data.dt;
+	dtCrowdAgentDebugInfo* debug = data.debug;
+	const int debugIdx = debug ? debug->idx : -1;
+	
+	// Thread 0 is the calling thread, which uses the crowd's own queries.
+	dtNavMeshQuery* navquery = threadIndex > 0 ? m_threadNavQueries[threadIndex] : m_navquery;
+	dtObstacleAvoidanceQuery* obstacleQuery = threadIndex > 0 ? m_threadObstacleQueries[threadIndex] : m_obstacleQuery;
+	
+	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
+	
+	switch (data.pass)
+	{
+	case DT_CROWD_PASS_NEIGHBOURS:
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+
+			// Update the collision boundary after certain distance has been passed or
+			// if it has become invalid.
+			const float updateThr = ag->params.collisionQueryRange*0.25f;
+			if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
+				!ag->boundary.isValid(navquery, &m_filters[ag->params.queryFilterType]))
+			{
+				ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
+									navquery, &m_filters[ag->params.queryFilterType]);
+			}
+			// Query neighbour agents
+			ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+									  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
+									  agents, nagents, m_grid);
+			for (int j = 0; j < ag->nneis; j++)
+				ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 		}
+		break;
 
-		// Separation
-		if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+	case DT_CROWD_PASS_CORNERS:
+		for (int i = begin; i < end; ++i)
 		{
-			const float separationDist = ag->params.collisionQueryRange; 
-			const float invSeparationDist = 1.0f / separationDist; 
-			const float separationWeight = ag->params.separationWeight;
+			dtCrowdAgent* ag = agents[i];
+		
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				continue;
+		
+			// Find corners for steering
+			ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+													DT_CROWDAGENT_MAX_CORNERS, navquery, &m_filters[ag->params.queryFilterType]);
+		
+			// Check to see if the corner after the next corner is directly visible,
+			// and short cut to there.
+			if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
+			{
+				const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
+				ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, navquery, &m_filters[ag->params.queryFilterType]);
 			
-			float w = 0;
-			float disp[3] = {0,0,0};
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVcopy(debug->optStart, ag->corridor.getPos());
+					dtVcopy(debug->optEnd, target);
+				}
+			}
+			else
+			{
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVset(debug->optStart, 0,0,0);
+					dtVset(debug->optEnd, 0,0,0);
+				}
+			}
+		}
+		break;
+
+	case DT_CROWD_PASS_STEERING:
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
+		
+			float dvel[3] = {0,0,0};
+
+			if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			{
+				dtVcopy(dvel, ag->targetPos);
+				ag->desiredSpeed = dtVlen(ag->targetPos);
+			}
+			else
+			{
+				// Calculate steering direction.
+				if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
+					calcSmoothSteerDirection(ag, dvel);
+				else
+					calcStraightSteerDirection(ag, dvel);
 			
-			for (int j = 0; j < ag->nneis; ++j)
+				// Calculate speed scale, which tells the agent to slowdown at the end of the path.
+				const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
+				const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+				
+				ag->desiredSpeed = ag->params.maxSpeed;
+				dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+			}
+
+			// Separation
+			if (ag->params.updateFlags & DT_CROWD_SEPARATION)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+				const float separationDist = ag->params.collisionQueryRange; 
+				const float invSeparationDist = 1.0f / separationDist; 
+				const float separationWeight = ag->params.separationWeight;
+			
+				float w = 0;
+				float disp[3] = {0,0,0};
+			
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
 				
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
 				
-				const float distSqr = dtVlenSqr(diff);
-				if (distSqr < 0.00001f)
-					continue;
-				if (distSqr > dtSqr(separationDist))
-					continue;
-				const float dist = dtMathSqrtf(distSqr);
-				const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+					const float distSqr = dtVlenSqr(diff);
+					if (distSqr < 0.00001f)
+						continue;
+					if (distSqr > dtSqr(separationDist))
+						continue;
+					const float dist = dtMathSqrtf(distSqr);
+					const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
 				
-				dtVmad(disp, disp, diff, weight/dist);
-				w += 1.0f;
-			}
+					dtVmad(disp, disp, diff, weight/dist);
+					w += 1.0f;
+				}
 			
-			if (w > 0.0001f)
-			{
-				// Adjust desired velocity.
-				dtVmad(dvel, dvel, disp, 1.0f/w);
-				// Clamp desired velocity to desired speed.
-				const float speedSqr = dtVlenSqr(dvel);
-				const float desiredSqr = dtSqr(ag->desiredSpeed);
-				if (speedSqr > desiredSqr)
-					dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				if (w > 0.0001f)
+				{
+					// Adjust desired velocity.
+					dtVmad(dvel, dvel, disp, 1.0f/w);
+					// Clamp desired velocity to desired speed.
+					const float speedSqr = dtVlenSqr(dvel);
+					const float desiredSqr = dtSqr(ag->desiredSpeed);
+					if (speedSqr > desiredSqr)
+						dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				}
 			}
-		}
 		
-		// Set the desired velocity.
-		dtVcopy(ag->dvel, dvel);
-	}
-	
-	// Velocity planning.	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
+			// Set the desired velocity.
+			dtVcopy(ag->dvel, dvel);
+		}
+		break;
+
+	case DT_CROWD_PASS_VELOCITY:
+		{
+			int numSamples = 0;
+			for (int i = begin; i < end; ++i)
+			{
+				dtCrowdAgent* ag = agents[i];
 		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
+				if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+					continue;
 		
-		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
-		{
-			m_obstacleQuery->reset();
+				if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
+				{
+					obstacleQuery->reset();
 			
-			// Add neighbours as obstacles.
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
-			}
+					// Add neighbours as obstacles.
+					for (int j = 0; j < ag->nneis; ++j)
+					{
+						const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+						obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+					}
 
-			// Append neighbour segments as obstacles.
-			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
-			{
-				const float* s = ag->boundary.getSegment(j);
-				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
-					continue;
-				m_obstacleQuery->addSegment(s, s+3);
-			}
+					// Append neighbour segments as obstacles.
+					for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+					{
+						const float* s = ag->boundary.getSegment(j);
+						if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+							continue;
+						obstacleQuery->addSegment(s, s+3);
+					}
 
-			dtObstacleAvoidanceDebugData* vod = 0;
-			if (debugIdx == i) 
-				vod = debug->vod;
+					dtObstacleAvoidanceDebugData* vod = 0;
+					if (debugIdx == i) 
+						vod = debug->vod;
 			
-			// Sample new safe velocity.
-			bool adaptive = true;
-			int ns = 0;
+					// Sample new safe velocity.
+					bool adaptive = true;
+					int ns = 0;
 
-			const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+					const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
 				
-			if (adaptive)
-			{
-				ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
-															 ag->vel, ag->dvel, ag->nvel, params, vod);
+					if (adaptive)
+					{
+						ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+																	 ag->vel, ag->dvel, ag->nvel, params, vod);
+					}
+					else
+					{
+						ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
+																 ag->vel, ag->dvel, ag->nvel, params, vod);
+					}
+					numSamples += ns;
+				}
+				else
+				{
+					// If not using velocity planning, new velocity is directly the desired velocity.
+					dtVcopy(ag->nvel, ag->dvel);
+				}
 			}
+			if (m_threadSampleCounts)
+				m_threadSampleCounts[threadIndex] += numSamples;
 			else
-			{
-				ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-														 ag->vel, ag->dvel, ag->nvel, params, vod);
-			}
-			m_velocitySampleCount += ns;
+				m_velocitySampleCount += numSamples;
 		}
-		else
+		break;
+
+	case DT_CROWD_PASS_INTEGRATE:
+		for (int i = begin; i < end; ++i)
 		{
-			// If not using velocity planning, new velocity is directly the desired velocity.
-			dtVcopy(ag->nvel, ag->dvel);
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			integrate(ag, dt);
 		}
-	}
+		break;
 
-	// Integrate.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		integrate(ag, dt);
-	}
-	
-	// Handle collisions.
-	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
-	
-	for (int iter = 0; iter < 4; ++iter)
-	{
-		for (int i = 0; i < nagents; ++i)
+	case DT_CROWD_PASS_COLLISION:
+		for (int i = begin; i < end; ++i)
 		{
 			dtCrowdAgent* ag = agents[i];
 			const int idx0 = getAgentIndex(ag);
@@ -1375,8 +1618,10 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 				dtVscale(ag->disp, ag->disp, iw);
 			}
 		}
-		
-		for (int i = 0; i < nagents; ++i)
+		break;
+
+	case DT_CROWD_PASS_DISPLACE:
+		for (int i = begin; i < end; ++i)
 		{
 			dtCrowdAgent* ag = agents[i];
 			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
@@ -1384,63 +1629,67 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 			
 			dtVadd(ag->npos, ag->npos, ag->disp);
 		}
-	}
-	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
-		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
-		// Get valid constrained position back.
-		dtVcopy(ag->npos, ag->corridor.getPos());
+		break;
 
-		// If not using path, truncate the corridor to just one poly.
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+	case DT_CROWD_PASS_MOVE:
+		for (int i = begin; i < end; ++i)
 		{
-			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
-			ag->partial = false;
-		}
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+		
+			// Move along navmesh.
+			ag->corridor.movePosition(ag->npos, navquery, &m_filters[ag->params.queryFilterType]);
+			// Get valid constrained position back.
+			dtVcopy(ag->npos, ag->corridor.getPos());
 
-	}
-	
-	// Update agents using off-mesh connection.
-	for (int i = 0; i < m_maxAgents; ++i)
-	{
-		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
-		if (!anim->active)
-			continue;
-		dtCrowdAgent* ag = agents[i];
+			// If not using path, truncate the corridor to just one poly.
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			{
+				ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+				ag->partial = false;
+			}
 
-		anim->t += dt;
-		if (anim->t > anim->tmax)
-		{
-			// Reset animation
-			anim->active = false;
-			// Prepare agent for walking.
-			ag->state = DT_CROWDAGENT_STATE_WALKING;
-			continue;
-		}
-		
-		// Update position
-		const float ta = anim->tmax*0.15f;
-		const float tb = anim->tmax;
-		if (anim->t < ta)
-		{
-			const float u = tween(anim->t, 0.0, ta);
-			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
-		}
-		else
-		{
-			const float u = tween(anim->t, ta, tb);
-			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
 		}
-			
-		// Update velocity.
-		dtVset(ag->vel, 0,0,0);
-		dtVset(ag->dvel, 0,0,0);
+		break;
+	}
+}
+
+static unsigned int spreadBits(unsigned int v)
+{
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+static int compareSortItems(const void* va, const void* vb)
+{
+	const dtCrowdAgentSortItem* a = (const dtCrowdAgentSortItem*)va;
+	const dtCrowdAgentSortItem* b = (const dtCrowdAgentSortItem*)vb;
+	if (a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+	if (a->agent != b->agent)
+		return a->agent < b->agent ? -1 : 1;
+	return 0;
+}
+
+void dtCrowd::sortAgents(dtCrowdAgent** agents, const int nagents)
+{
+	// Sort by the Z-order of the agent's cell, so that agents close to each other end up in the same range.
+	const float invCellSize = 1.0f / (m_maxAgentRadius * 8.0f);
+	for (int i = 0; i < nagents; ++i)
+	{
+		const float* p = agents[i]->npos;
+		const unsigned int x = (unsigned int)((int)dtMathFloorf(p[0] * invCellSize) + 0x8000) & 0xffff;
+		const unsigned int z = (unsigned int)((int)dtMathFloorf(p[2] * invCellSize) + 0x8000) & 0xffff;
+		m_sortItems[i].key = spreadBits(x) | (spreadBits(z) << 1);
+		m_sortItems[i].agent = agents[i];
 	}
 	
+	qsort(m_sortItems, nagents, sizeof(dtCrowdAgentSortItem), compareSortItems);
+	
+	for (int i = 0; i < nagents; ++i)
+		agents[i] = m_sortItems[i].agent;
 }
@@ -126,6 +126,17 @@ public:
     // Urho3D: added function to know when we have too many obstacle requests without update
     bool isObstacleQueueFull() const { return m_nreqs >= MAX_REQUESTS; }
 
+	// Urho3D: added functions for rebuilding the tiles touched by obstacles outside the main thread. beginUpdate()
+	// processes the queued obstacle requests and returns the tiles waiting for a rebuild. Their navmesh data can be
+	// built concurrently with buildNavMeshTileData(), each thread using its own allocator, as long as the tile cache is
+	// not modified meanwhile. Then add the data with replaceNavMeshTile() and mark the first tiles done with endUpdate().
+	void beginUpdate(const dtCompressedTileRef** tiles, int* ntiles);
+	dtStatus buildNavMeshTileData(const dtCompressedTileRef ref, struct dtTileCacheAlloc* talloc,
+								  unsigned char** navData, int* navDataSize) const;
+	dtStatus replaceNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh,
+								unsigned char* navData, const int navDataSize);
+	void endUpdate(const int ntiles);
+
 	/// Encodes a tile id.
 	inline dtCompressedTileRef encodeTileId(unsigned int salt, unsigned int it) const
 	{
@@ -441,6 +441,26 @@ dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 }
 
 dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh)
+{
+	const dtCompressedTileRef* tiles = 0;
+	int ntiles = 0;
+	beginUpdate(&tiles, &ntiles);
+	
+	// Process updates
+	if (ntiles)
+	{
+		// Build mesh
+		dtStatus status = buildNavMeshTile(tiles[0], navmesh);
+		endUpdate(1);
+		
+		if (dtStatusFailed(status))
+			return status;
+	}
+	
+	return DT_SUCCESS;
+}
+
+void dtTileCache::beginUpdate(const dtCompressedTileRef** tiles, int* ntiles)
 {
 	if (m_nupdate == 0)
 	{
@@ -499,16 +519,16 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh)
 		m_nreqs = 0;
 	}
 	
-	// Process updates
-	if (m_nupdate)
-	{
-		// Build mesh
-		const dtCompressedTileRef ref = m_update[0];
-		dtStatus status = buildNavMeshTile(ref, navmesh);
-		m_nupdate--;
-		if (m_nupdate > 0)
-			memmove(m_update, m_update+1, m_nupdate*sizeof(dtCompressedTileRef));
+	*tiles = m_update;
+	*ntiles = m_nupdate;
+}
 
+void dtTileCache::endUpdate(const int ntiles)
+{
+	for (int k = 0; k < ntiles && k < m_nupdate; ++k)
+	{
+		const dtCompressedTileRef ref = m_update[k];
+		
 		// Update obstacle states.
 		for (int i = 0; i < m_params.maxObstacles; ++i)
 		{
@@ -525,7 +545,7 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh)
 						break;
 					}
 				}
-				
+			
 				// If all pending tiles processed, change state.
 				if (ob->npending == 0)
 				{
@@ -547,12 +567,12 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh)
 				}
 			}
 		}
-			
-		if (dtStatusFailed(status))
-			return status;
 	}
 	
-	return DT_SUCCESS;
+	const int nremoved = ntiles < m_nupdate ? ntiles : m_nupdate;
+	m_nupdate -= nremoved;
+	if (m_nupdate > 0)
+		memmove(m_update, m_update+nremoved, m_nupdate*sizeof(dtCompressedTileRef));
 }
 
 
@@ -575,8 +595,25 @@ dtStatus dtTileCache::buildNavMeshTilesAt(const int tx, const int ty, dtNavMesh*
 dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh)
 {	
 	dtAssert(m_talloc);
+	
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	dtStatus status = buildNavMeshTileData(ref, m_talloc, &navData, &navDataSize);
+	if (dtStatusFailed(status))
+		return status;
+	
+	return replaceNavMeshTile(ref, navmesh, navData, navDataSize);
+}
+
+dtStatus dtTileCache::buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc,
+										   unsigned char** navData, int* navDataSize) const
+{
+	dtAssert(talloc);
 	dtAssert(m_tcomp);
 	
+	*navData = 0;
+	*navDataSize = 0;
+	
 	unsigned int idx = decodeTileIdTile(ref);
 	if (idx > (unsigned int)m_params.maxTiles)
 		return DT_FAILURE | DT_INVALID_PARAM;
@@ -585,14 +622,14 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (tile->salt != salt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	m_talloc->reset();
+	talloc->reset();
 	
-	BuildContext bc(m_talloc);
+	BuildContext bc(talloc);
 	const int walkableClimbVx = (int)(m_params.walkableClimb / m_params.ch);
 	dtStatus status;
 	
 	// Decompress tile layer data. 
-	status = dtDecompressTileCacheLayer(m_talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
+	status = dtDecompressTileCacheLayer(talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
 	if (dtStatusFailed(status))
 		return status;
 	
@@ -610,22 +647,22 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	}
 	
 	// Build navmesh
-	status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
+	status = dtBuildTileCacheRegions(talloc, *bc.layer, walkableClimbVx);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lcset = dtAllocTileCacheContourSet(m_talloc);
+	bc.lcset = dtAllocTileCacheContourSet(talloc);
 	if (!bc.lcset)
 		return status;
-	status = dtBuildTileCacheContours(m_talloc, *bc.layer, walkableClimbVx,
+	status = dtBuildTileCacheContours(talloc, *bc.layer, walkableClimbVx,
 									  m_params.maxSimplificationError, *bc.lcset);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lmesh = dtAllocTileCachePolyMesh(m_talloc);
+	bc.lmesh = dtAllocTileCachePolyMesh(talloc);
 	if (!bc.lmesh)
 		return status;
-	status = dtBuildTileCachePolyMesh(m_talloc, *bc.lcset, *bc.lmesh);
+	status = dtBuildTileCachePolyMesh(talloc, *bc.lcset, *bc.lmesh);
 	if (dtStatusFailed(status))
 		return status;
 	
@@ -659,11 +696,26 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 		m_tmproc->process(&params, bc.lmesh->areas, bc.lmesh->flags);
 	}
 	
-	unsigned char* navData = 0;
-	int navDataSize = 0;
-	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	if (!dtCreateNavMeshData(&params, navData, navDataSize))
 		return DT_FAILURE;
+	
+	return DT_SUCCESS;
+}
 
+dtStatus dtTileCache::replaceNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh,
+										 unsigned char* navData, const int navDataSize)
+{
+	// An empty mesh tile leaves the existing tile in place.
+	if (!navData)
+		return DT_SUCCESS;
+	
+	const dtCompressedTile* tile = getTileByRef(ref);
+	if (!tile)
+	{
+		dtFree(navData);
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
 	// Remove existing tile.
 	navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 
@@ -671,7 +723,7 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (navData)
 	{
 		// Let the navmesh own the data.
-		status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
+		dtStatus status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
 		if (dtStatusFailed(status))
 		{
 			dtFree(navData);
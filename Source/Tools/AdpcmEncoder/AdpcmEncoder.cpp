@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Audio/AdpcmSoundStream.h>
+#include <Urho3D/Container/ArrayPtr.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstring>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+/// Default IMA ADPCM block size per channel in bytes.
+static const unsigned DEFAULT_BLOCK_SIZE = 512;
+
+SharedPtr<Context> context_(new Context());
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 2)
+        ErrorExit("Usage: AdpcmEncoder <input wav file> <output wav file> [block size]\n\n"
+            "Converts 16-bit PCM WAV data to IMA ADPCM for in-memory playback. Block size is per channel in bytes\n"
+            "and defaults to 512.\n");
+    
+    unsigned blockSize = DEFAULT_BLOCK_SIZE;
+    if (arguments.Size() > 2)
+        blockSize = ToUInt(arguments[2]);
+    if (blockSize < 8 || blockSize > 8192 || (blockSize & 3))
+        ErrorExit("Block size must be a multiple of 4 between 8 and 8192");
+    
+    File source(context_);
+    if (!source.Open(arguments[0]))
+        ErrorExit("Could not open input file " + arguments[0]);
+    
+    char id[4];
+    source.Read(id, 4);
+    source.ReadUInt();
+    if (memcmp("RIFF", id, 4))
+        ErrorExit("Input file is not a RIFF file");
+    source.Read(id, 4);
+    if (memcmp("WAVE", id, 4))
+        ErrorExit("Input file is not a WAV file");
+    
+    // Search for the FORMAT and DATA chunks
+    unsigned short format = 0;
+    unsigned channels = 0;
+    unsigned frequency = 0;
+    unsigned bits = 0;
+    unsigned dataLength = 0;
+    for (;;)
+    {
+        if (source.IsEof())
+            ErrorExit("Could not find WAV data chunk");
+        
+        source.Read(id, 4);
+        unsigned length = source.ReadUInt();
+        if (!memcmp("fmt ", id, 4) && length >= 16)
+        {
+            format = source.ReadUShort();
+            channels = source.ReadUShort();
+            frequency = source.ReadUInt();
+            source.ReadUInt(); // Average bytes per second
+            source.ReadUShort(); // Block align
+            bits = source.ReadUShort();
+            length -= 16;
+        }
+        else if (!memcmp("data", id, 4))
+        {
+            dataLength = length;
+            break;
+        }
+        
+        // Chunks are word-aligned
+        source.Seek(source.GetPosition() + length + (length & 1));
+    }
+    
+    if (format != 1 || bits != 16)
+        ErrorExit("Input must be 16-bit PCM WAV data");
+    if (channels < 1 || channels > 2)
+        ErrorExit("Input must be mono or stereo");
+    
+    unsigned samples = dataLength / (channels * sizeof(short));
+    if (!samples)
+        ErrorExit("Input contains no sample data");
+    
+    SharedArrayPtr<short> pcm(new short[samples * channels]);
+    for (unsigned i = 0; i < samples * channels; ++i)
+        pcm[i] = source.ReadShort();
+    source.Close();
+    
+    unsigned blockAlign = blockSize * channels;
+    unsigned blockSamples = GetImaAdpcmBlockSamples(blockAlign, channels);
+    unsigned numBlocks = (samples + blockSamples - 1) / blockSamples;
+    unsigned compressedLength = numBlocks * blockAlign;
+    
+    SharedArrayPtr<unsigned char> compressed(new unsigned char[compressedLength]);
+    memset(compressed.Get(), 0, compressedLength);
+    // Step indices carry over block boundaries so the quantizer does not need to adapt again
+    int stepIndices[2] = { 0, 0 };
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        unsigned start = i * blockSamples;
+        EncodeImaAdpcmBlock(compressed.Get() + i * blockAlign, pcm.Get() + start * channels, Min((int)blockSamples,
+            (int)(samples - start)), blockAlign, channels, stepIndices);
+    }
+    
+    File dest(context_);
+    if (!dest.Open(arguments[1], FILE_WRITE))
+        ErrorExit("Could not open output file " + arguments[1]);
+    
+    // Format chunk with the samples per block extension, fact chunk with the exact sample count
+    unsigned formatLength = 20;
+    dest.Write("RIFF", 4);
+    dest.WriteUInt(4 + (8 + formatLength) + (8 + 4) + (8 + compressedLength + (compressedLength & 1)));
+    dest.Write("WAVE", 4);
+    dest.Write("fmt ", 4);
+    dest.WriteUInt(formatLength);
+    dest.WriteUShort(0x11);
+    dest.WriteUShort((unsigned short)channels);
+    dest.WriteUInt(frequency);
+    dest.WriteUInt((unsigned)((unsigned long long)frequency * blockAlign / blockSamples));
+    dest.WriteUShort((unsigned short)blockAlign);
+    dest.WriteUShort(4);
+    dest.WriteUShort(2);
+    dest.WriteUShort((unsigned short)blockSamples);
+    dest.Write("fact", 4);
+    dest.WriteUInt(4);
+    dest.WriteUInt(samples);
+    dest.Write("data", 4);
+    dest.WriteUInt(compressedLength);
+    dest.Write(compressed.Get(), compressedLength);
+    if (compressedLength & 1)
+        dest.WriteUByte(0);
+    
+    PrintLine("Encoded " + String(samples) + " samples into " + String(numBlocks) + " blocks, " + String(blockAlign) +
+        " bytes each");
+}
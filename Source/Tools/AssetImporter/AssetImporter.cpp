@@ -36,6 +36,7 @@
 #include <Urho3D/Graphics/Model.h>
 #include <Urho3D/Graphics/Octree.h>
 #ifdef URHO3D_PHYSICS
+#include <Urho3D/Physics/CollisionShape.h>
 #include <Urho3D/Physics/PhysicsWorld.h>
 #endif
 #include <Urho3D/Core/ProcessUtils.h>
@@ -51,6 +52,8 @@
 
 #include <Urho3D/Container/Sort.h>
 
+#include "MeshOptimizer.h"
+
 #ifdef WIN32
 #include <windows.h>
 #endif
@@ -122,6 +125,14 @@ bool noOverwriteMaterial_ = false;
 bool noOverwriteTexture_ = false;
 bool noOverwriteNewerTexture_ = false;
 bool checkUniqueModel_ = true;
+bool compressAnimations_ = false;
+float animationKeyFrameError_ = 0.0f;
+bool cookTriangleMesh_ = false;
+bool cookConvexHull_ = false;
+bool optimizeMeshes_ = true;
+bool packVertices_ = false;
+unsigned generatedLodLevels_ = 0;
+float generatedLodDistance_ = 0.0f;
 unsigned maxBones_ = 64;
 Vector<String> nonSkinningBoneIncludes_;
 Vector<String> nonSkinningBoneExcludes_;
@@ -155,6 +166,8 @@ void BuildAndSaveMaterial(aiMaterial* material, HashSet<String>& usedTextures);
 void CopyTextures(const HashSet<String>& usedTextures, const String& sourcePath);
 
 void CombineLods(const PODVector<float>& lodDistances, const Vector<String>& modelNames, const String& outName);
+void CookCollisionGeometry(Model* model, const String& outName);
+void OptimizeModel(Model* model);
 
 void GetMeshesUnderNode(Vector<Pair<aiNode*, aiMesh*> >& meshes, aiNode* node);
 unsigned GetMeshIndex(aiMesh* mesh);
@@ -175,6 +188,7 @@ void WriteVertex(float*& dest, aiMesh* mesh, unsigned index, unsigned elementMas
     const Matrix3x4& vertexTransform, const Matrix3& normalTransform, Vector<PODVector<unsigned char> >& blendIndices,
     Vector<PODVector<float> >& blendWeights);
 unsigned GetElementMask(aiMesh* mesh);
+void WritePackedNormal(float* dest, const Vector3& normal, float w);
 
 aiNode* GetNode(const String& name, aiNode* rootNode, bool caseSensitive = true);
 aiMatrix4x4 GetDerivedTransform(aiNode* node, aiNode* rootNode, bool rootInclusive = true);
@@ -248,6 +262,18 @@ void Run(const Vector<String>& arguments)
             "-ct         Check and do not overwrite if texture exists\n"
             "-ctn        Check and do not overwrite if texture has newer timestamp\n"
             "-am         Export all meshes even if identical (scene mode only)\n"
+            "-ac         Save animations in the compressed format with quantized keyframes\n"
+            "-ar <err>   Remove animation keyframes that interpolation reproduces within the\n"
+            "            error, in units for positions and scales and degrees for rotations\n"
+            "-pt         Save cooked physics triangle mesh collision geometry for models\n"
+            "-pc         Save cooked physics convex hull collision geometry for models\n"
+            "-no         Do not optimize triangle and vertex order for the GPU vertex cache\n"
+            "-lg <num>   Generate the number of simplified LOD levels for models, each with\n"
+            "            half of the triangles of the previous level\n"
+            "-ld <dist>  Distance of the first generated LOD level, doubled for each further\n"
+            "            level. Default is derived from the simplification error\n"
+            "-cv         Save packed vertex data: 16-bit normals, tangents and half float\n"
+            "            texcoords, and 8-bit blend weights\n"
         );
     }
     
@@ -338,6 +364,10 @@ void Run(const Vector<String>& arguments)
                 case 'f':
                     flags &= ~aiProcess_FixInfacingNormals;
                     break;
+                    
+                case 'o':
+                    optimizeMeshes_ = false;
+                    break;
                 }
             }
             else if (argument == "mb" && !value.Empty())
@@ -387,8 +417,31 @@ void Run(const Vector<String>& arguments)
                 noOverwriteTexture_ = true;
             else if (argument == "ctn")
                 noOverwriteNewerTexture_ = true;
+            else if (argument == "cv")
+                packVertices_ = true;
             else if (argument == "am")
                 checkUniqueModel_ = false;
+            else if (argument == "ac")
+                compressAnimations_ = true;
+            else if (argument == "ar" && !value.Empty())
+            {
+                animationKeyFrameError_ = ToFloat(value);
+                ++i;
+            }
+            else if (argument == "pt")
+                cookTriangleMesh_ = true;
+            else if (argument == "pc")
+                cookConvexHull_ = true;
+            else if (argument == "lg" && !value.Empty())
+            {
+                generatedLodLevels_ = ToUInt(value);
+                ++i;
+            }
+            else if (argument == "ld" && !value.Empty())
+            {
+                generatedLodDistance_ = ToFloat(value);
+                ++i;
+            }
         }
     }
     
@@ -927,6 +980,7 @@ void BuildAndSaveModel(OutModel& model)
     outModel->SetVertexBuffers(vbVector, emptyMorphRange, emptyMorphRange);
     outModel->SetIndexBuffers(ibVector);
     outModel->SetBoundingBox(box);
+    OptimizeModel(outModel);
     
     // Build skeleton if necessary
     if (model.bones_.Size() && model.rootBone_)
@@ -983,6 +1037,7 @@ void BuildAndSaveModel(OutModel& model)
     if (!outFile.Open(model.outName_, FILE_WRITE))
         ErrorExit("Could not open output file " + model.outName_);
     outModel->Save(outFile);
+    CookCollisionGeometry(outModel, model.outName_);
     
     // If exporting materials, also save material list for use by the editor
     if (!noMaterials_ && saveMaterialList_)
@@ -1197,6 +1252,9 @@ void BuildAndSaveAnimations(OutModel* model)
         }
         
         outAnim->SetTracks(tracks);
+        if (animationKeyFrameError_ > 0.0f)
+            outAnim->RemoveRedundantKeyFrames(animationKeyFrameError_, animationKeyFrameError_, animationKeyFrameError_);
+        outAnim->SetCompressed(compressAnimations_);
         
         File outFile(context_);
         if (!outFile.Open(animOutName, FILE_WRITE))
@@ -1844,6 +1902,235 @@ void CombineLods(const PODVector<float>& lodDistances, const Vector<String>& mod
     if (!outFile.Open(outName, FILE_WRITE))
         ErrorExit("Could not open output file " + outName);
     outModel->Save(outFile);
+    CookCollisionGeometry(outModel, outName);
+}
+
+void CookCollisionGeometry(Model* model, const String& outName)
+{
+    if (!cookTriangleMesh_ && !cookConvexHull_)
+        return;
+    
+#ifdef URHO3D_PHYSICS
+    unsigned numLodLevels = 0;
+    for (unsigned i = 0; i < model->GetNumGeometries(); ++i)
+        numLodLevels = Max((int)numLodLevels, (int)model->GetNumGeometryLodLevels(i));
+    
+    context_->GetSubsystem<FileSystem>()->CreateDir(GetPath(outName) + "Cache");
+    
+    for (unsigned i = 0; i < numLodLevels; ++i)
+    {
+        for (unsigned j = 0; j < 2; ++j)
+        {
+            ShapeType type = j ? SHAPE_CONVEXHULL : SHAPE_TRIANGLEMESH;
+            if ((type == SHAPE_TRIANGLEMESH && !cookTriangleMesh_) || (type == SHAPE_CONVEXHULL && !cookConvexHull_))
+                continue;
+            
+            String cookedName = GetCookedGeometryName(outName, i, type);
+            PrintLine("Writing cooked collision geometry " + GetFileNameAndExtension(cookedName));
+            File outFile(context_);
+            if (!outFile.Open(cookedName, FILE_WRITE))
+                ErrorExit("Could not open output file " + cookedName);
+            if (!CookGeometry(model, i, type, outFile))
+                ErrorExit("Could not cook collision geometry for " + outName);
+        }
+    }
+#else
+    PrintLine("Physics support is disabled, can not save cooked collision geometry");
+#endif
+}
+
+void OptimizeModel(Model* model)
+{
+    if (!optimizeMeshes_ && !generatedLodLevels_)
+        return;
+    
+    const Vector<SharedPtr<VertexBuffer> >& vbVector = model->GetVertexBuffers();
+    const Vector<SharedPtr<IndexBuffer> >& ibVector = model->GetIndexBuffers();
+    unsigned numGeometries = model->GetNumGeometries();
+    
+    // Read the vertex positions of each buffer
+    Vector<PODVector<Vector3> > positions(vbVector.Size());
+    for (unsigned i = 0; i < vbVector.Size(); ++i)
+    {
+        VertexBuffer* vb = vbVector[i];
+        const unsigned char* data = vb->GetShadowData() + vb->GetElementOffset(ELEMENT_POSITION);
+        positions[i].Resize(vb->GetVertexCount());
+        for (unsigned j = 0; j < vb->GetVertexCount(); ++j)
+            positions[i][j] = *((const Vector3*)(data + j * vb->GetVertexSize()));
+    }
+    
+    // Read the indices of each geometry LOD level
+    Vector<Vector<PODVector<unsigned> > > lodIndices(numGeometries);
+    Vector<PODVector<float> > lodDistances(numGeometries);
+    PODVector<unsigned> vbIndices;
+    PODVector<unsigned> ibIndices;
+    vbIndices.Resize(numGeometries);
+    ibIndices.Resize(numGeometries);
+    for (unsigned i = 0; i < numGeometries; ++i)
+    {
+        unsigned numLodLevels = model->GetNumGeometryLodLevels(i);
+        lodIndices[i].Resize(numLodLevels);
+        lodDistances[i].Resize(numLodLevels);
+        for (unsigned j = 0; j < numLodLevels; ++j)
+        {
+            Geometry* geom = model->GetGeometry(i, j);
+            IndexBuffer* ib = geom->GetIndexBuffer();
+            if (!j)
+            {
+                vbIndices[i] = vbVector.Find(SharedPtr<VertexBuffer>(geom->GetVertexBuffer(0))) - vbVector.Begin();
+                ibIndices[i] = ibVector.Find(SharedPtr<IndexBuffer>(ib)) - ibVector.Begin();
+            }
+            
+            PODVector<unsigned>& indices = lodIndices[i][j];
+            indices.Resize(geom->GetIndexCount());
+            const unsigned char* data = ib->GetShadowData() + geom->GetIndexStart() * ib->GetIndexSize();
+            for (unsigned k = 0; k < indices.Size(); ++k)
+                indices[k] = ib->GetIndexSize() == sizeof(unsigned) ? ((const unsigned*)data)[k] : ((const unsigned short*)data)[k];
+            lodDistances[i][j] = geom->GetLodDistance();
+        }
+    }
+    
+    // Generate simplified LOD levels for geometries that have only one
+    if (generatedLodLevels_)
+    {
+        // Without an explicit distance, switch LOD level when the simplification error is about one pixel on a 1080 pixel
+        // high view with a 45 degree field of view. LOD distances are scaled by the object size, so divide by it here
+        const float pixelsPerUnitAtDistance = 1080.0f / (2.0f * Tan(22.5f));
+        float scale = model->GetBoundingBox().Size().DotProduct(DOT_SCALE);
+        
+        for (unsigned i = 0; i < numGeometries; ++i)
+        {
+            if (lodIndices[i].Size() != 1)
+                continue;
+            
+            const PODVector<unsigned>& original = lodIndices[i][0];
+            const PODVector<Vector3>& vertexPositions = positions[vbIndices[i]];
+            unsigned lastTriangles = original.Size() / 3;
+            
+            for (unsigned j = 1; j <= generatedLodLevels_; ++j)
+            {
+                PODVector<unsigned> simplified;
+                float error = SimplifyMesh(simplified, original, vertexPositions, lastTriangles / 2);
+                unsigned triangles = simplified.Size() / 3;
+                // Stop when the mesh can no longer be reduced meaningfully
+                if (!triangles || triangles > lastTriangles * 9 / 10)
+                    break;
+                
+                float distance;
+                if (generatedLodDistance_ > 0.0f)
+                    distance = generatedLodDistance_ * (float)(1u << (j - 1));
+                else
+                    distance = scale > M_EPSILON ? error * pixelsPerUnitAtDistance / scale : 0.0f;
+                distance = Max(distance, lodDistances[i].Back() + M_EPSILON);
+                
+                PrintLine("Generated LOD level " + String(j) + " for geometry " + String(i) + " with " + String(triangles) +
+                    " triangles, distance " + String(distance));
+                lodIndices[i].Push(simplified);
+                lodDistances[i].Push(distance);
+                lastTriangles = triangles;
+            }
+        }
+    }
+    
+    // Reorder triangles for the vertex cache, then for overdraw without losing the cache efficiency
+    if (optimizeMeshes_)
+    {
+        for (unsigned i = 0; i < numGeometries; ++i)
+        {
+            for (unsigned j = 0; j < lodIndices[i].Size(); ++j)
+            {
+                OptimizeVertexCache(lodIndices[i][j], positions[vbIndices[i]].Size());
+                OptimizeOverdraw(lodIndices[i][j], positions[vbIndices[i]]);
+            }
+        }
+        
+        // Reorder vertices to the order of first use to improve vertex fetch locality
+        for (unsigned i = 0; i < vbVector.Size(); ++i)
+        {
+            VertexBuffer* vb = vbVector[i];
+            unsigned vertexSize = vb->GetVertexSize();
+            PODVector<unsigned> usedIndices;
+            for (unsigned j = 0; j < numGeometries; ++j)
+            {
+                if (vbIndices[j] != i)
+                    continue;
+                for (unsigned k = 0; k < lodIndices[j].Size(); ++k)
+                    usedIndices += lodIndices[j][k];
+            }
+            
+            PODVector<unsigned> remap;
+            GetVertexFetchRemap(remap, usedIndices, vb->GetVertexCount());
+            
+            PODVector<unsigned char> oldData(vb->GetShadowData(), vb->GetVertexCount() * vertexSize);
+            unsigned char* data = vb->GetShadowData();
+            for (unsigned j = 0; j < remap.Size(); ++j)
+                memcpy(data + remap[j] * vertexSize, &oldData[j * vertexSize], vertexSize);
+            
+            for (unsigned j = 0; j < numGeometries; ++j)
+            {
+                if (vbIndices[j] != i)
+                    continue;
+                for (unsigned k = 0; k < lodIndices[j].Size(); ++k)
+                {
+                    PODVector<unsigned>& indices = lodIndices[j][k];
+                    for (unsigned l = 0; l < indices.Size(); ++l)
+                        indices[l] = remap[indices[l]];
+                }
+            }
+        }
+    }
+    
+    // Rebuild the index buffers to hold all LOD levels and redefine the geometries
+    Vector<SharedPtr<IndexBuffer> > newIbVector;
+    for (unsigned i = 0; i < ibVector.Size(); ++i)
+    {
+        unsigned indexCount = 0;
+        for (unsigned j = 0; j < numGeometries; ++j)
+        {
+            if (ibIndices[j] != i)
+                continue;
+            for (unsigned k = 0; k < lodIndices[j].Size(); ++k)
+                indexCount += lodIndices[j][k].Size();
+        }
+        
+        bool largeIndices = ibVector[i]->GetIndexSize() == sizeof(unsigned);
+        SharedPtr<IndexBuffer> ib(new IndexBuffer(context_));
+        ib->SetSize(indexCount, largeIndices);
+        unsigned char* data = ib->GetShadowData();
+        unsigned startIndexOffset = 0;
+        
+        for (unsigned j = 0; j < numGeometries; ++j)
+        {
+            if (ibIndices[j] != i)
+                continue;
+            
+            VertexBuffer* vb = vbVector[vbIndices[j]];
+            model->SetNumGeometryLodLevels(j, lodIndices[j].Size());
+            for (unsigned k = 0; k < lodIndices[j].Size(); ++k)
+            {
+                const PODVector<unsigned>& indices = lodIndices[j][k];
+                for (unsigned l = 0; l < indices.Size(); ++l)
+                {
+                    if (largeIndices)
+                        ((unsigned*)data)[startIndexOffset + l] = indices[l];
+                    else
+                        ((unsigned short*)data)[startIndexOffset + l] = (unsigned short)indices[l];
+                }
+                
+                SharedPtr<Geometry> geom(new Geometry(context_));
+                geom->SetIndexBuffer(ib);
+                geom->SetVertexBuffer(0, vb);
+                geom->SetDrawRange(TRIANGLE_LIST, startIndexOffset, indices.Size(), true);
+                geom->SetLodDistance(lodDistances[j][k]);
+                model->SetGeometry(j, k, geom);
+                startIndexOffset += indices.Size();
+            }
+        }
+        
+        newIbVector.Push(ib);
+    }
+    
+    model->SetIndexBuffers(newIbVector);
 }
 
 void GetMeshesUnderNode(Vector<Pair<aiNode*, aiMesh*> >& dest, aiNode* node)
@@ -2060,9 +2347,17 @@ void WriteVertex(float*& dest, aiMesh* mesh, unsigned index, unsigned elementMas
     if (elementMask & MASK_NORMAL)
     {
         Vector3 normal = normalTransform * ToVector3(mesh->mNormals[index]);
-        *dest++ = normal.x_;
-        *dest++ = normal.y_;
-        *dest++ = normal.z_;
+        if (elementMask & MASK_PACKEDNORMALS)
+        {
+            WritePackedNormal(dest, normal.Normalized(), 0.0f);
+            dest += 2;
+        }
+        else
+        {
+            *dest++ = normal.x_;
+            *dest++ = normal.y_;
+            *dest++ = normal.z_;
+        }
     }
     if (elementMask & MASK_COLOR)
     {
@@ -2070,17 +2365,23 @@ void WriteVertex(float*& dest, aiMesh* mesh, unsigned index, unsigned elementMas
             mesh->mColors[0][index].a).ToUInt();
         ++dest;
     }
-    if (elementMask & MASK_TEXCOORD1)
-    {
-        Vector3 texCoord = ToVector3(mesh->mTextureCoords[0][index]);
-        *dest++ = texCoord.x_;
-        *dest++ = texCoord.y_;
-    }
-    if (elementMask & MASK_TEXCOORD2)
+    for (unsigned i = 0; i < 2; ++i)
     {
-        Vector3 texCoord = ToVector3(mesh->mTextureCoords[1][index]);
-        *dest++ = texCoord.x_;
-        *dest++ = texCoord.y_;
+        if (elementMask & (i ? MASK_TEXCOORD2 : MASK_TEXCOORD1))
+        {
+            Vector3 texCoord = ToVector3(mesh->mTextureCoords[i][index]);
+            if (elementMask & MASK_PACKEDTEXCOORDS)
+            {
+                unsigned short* destHalf = (unsigned short*)dest++;
+                destHalf[0] = FloatToHalf(texCoord.x_);
+                destHalf[1] = FloatToHalf(texCoord.y_);
+            }
+            else
+            {
+                *dest++ = texCoord.x_;
+                *dest++ = texCoord.y_;
+            }
+        }
     }
     if (elementMask & MASK_TANGENT)
     {
@@ -2092,19 +2393,45 @@ void WriteVertex(float*& dest, aiMesh* mesh, unsigned index, unsigned elementMas
         if ((tangent.CrossProduct(normal)).DotProduct(bitangent) < 0.5f)
             w = -1.0f;
         
-        *dest++ = tangent.x_;
-        *dest++ = tangent.y_;
-        *dest++ = tangent.z_;
-        *dest++ = w;
+        if (elementMask & MASK_PACKEDNORMALS)
+        {
+            WritePackedNormal(dest, tangent.Normalized(), w);
+            dest += 2;
+        }
+        else
+        {
+            *dest++ = tangent.x_;
+            *dest++ = tangent.y_;
+            *dest++ = tangent.z_;
+            *dest++ = w;
+        }
     }
     if (elementMask & MASK_BLENDWEIGHTS)
     {
+        float weights[4];
         for (unsigned i = 0; i < 4; ++i)
+            weights[i] = i < blendWeights[index].Size() ? blendWeights[index][i] : 0.0f;
+        
+        if (elementMask & MASK_PACKEDBLENDWEIGHTS)
         {
-            if (i < blendWeights[index].Size())
-                *dest++ = blendWeights[index][i];
-            else
-                *dest++ = 0.0f;
+            // Quantize so that the weights still sum to one, giving the rounding error to the largest weight
+            unsigned char* destBytes = (unsigned char*)dest++;
+            int sum = 0;
+            unsigned largest = 0;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                destBytes[i] = (unsigned char)Clamp((int)(weights[i] * 255.0f + 0.5f), 0, 255);
+                sum += destBytes[i];
+                if (weights[i] > weights[largest])
+                    largest = i;
+            }
+            if (sum)
+                destBytes[largest] = (unsigned char)Clamp(destBytes[largest] + 255 - sum, 0, 255);
+        }
+        else
+        {
+            for (unsigned i = 0; i < 4; ++i)
+                *dest++ = weights[i];
         }
     }
     if (elementMask & MASK_BLENDINDICES)
@@ -2136,9 +2463,27 @@ unsigned GetElementMask(aiMesh* mesh)
         elementMask |= MASK_TEXCOORD2;
     if (mesh->HasBones())
         elementMask |= (MASK_BLENDWEIGHTS | MASK_BLENDINDICES);
+    if (packVertices_)
+    {
+        if (elementMask & (MASK_NORMAL | MASK_TANGENT))
+            elementMask |= MASK_PACKEDNORMALS;
+        if (elementMask & (MASK_TEXCOORD1 | MASK_TEXCOORD2))
+            elementMask |= MASK_PACKEDTEXCOORDS;
+        if (elementMask & MASK_BLENDWEIGHTS)
+            elementMask |= MASK_PACKEDBLENDWEIGHTS;
+    }
     return elementMask;
 }
 
+void WritePackedNormal(float* dest, const Vector3& normal, float w)
+{
+    short* destShort = (short*)dest;
+    destShort[0] = (short)Clamp((int)floorf(normal.x_ * 32767.0f + 0.5f), -32767, 32767);
+    destShort[1] = (short)Clamp((int)floorf(normal.y_ * 32767.0f + 0.5f), -32767, 32767);
+    destShort[2] = (short)Clamp((int)floorf(normal.z_ * 32767.0f + 0.5f), -32767, 32767);
+    destShort[3] = (short)Clamp((int)floorf(w * 32767.0f + 0.5f), -32767, 32767);
+}
+
 aiNode* GetNode(const String& name, aiNode* rootNode, bool caseSensitive)
 {
     if (!rootNode)
@@ -0,0 +1,665 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include "MeshOptimizer.h"
+
+#include <cmath>
+
+static const unsigned VERTEX_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+static const unsigned OVERDRAW_CACHE_SIZE = 16;
+static const unsigned MAX_SIMPLIFY_PASSES = 100;
+
+/// Symmetric 4x4 error quadric for edge collapse cost evaluation.
+struct Quadric
+{
+    /// Construct as zero.
+    Quadric() :
+        weight_(0.0)
+    {
+        for (unsigned i = 0; i < 10; ++i)
+            a_[i] = 0.0;
+    }
+
+    /// Add the squared distance to a plane.
+    void AddPlane(double a, double b, double c, double d)
+    {
+        a_[0] += a * a; a_[1] += a * b; a_[2] += a * c; a_[3] += a * d;
+        a_[4] += b * b; a_[5] += b * c; a_[6] += b * d;
+        a_[7] += c * c; a_[8] += c * d;
+        a_[9] += d * d;
+        weight_ += 1.0;
+    }
+
+    /// Add another quadric.
+    void Add(const Quadric& rhs)
+    {
+        for (unsigned i = 0; i < 10; ++i)
+            a_[i] += rhs.a_[i];
+        weight_ += rhs.weight_;
+    }
+
+    /// Evaluate the error at a position.
+    double Evaluate(const Vector3& pos) const
+    {
+        double x = pos.x_, y = pos.y_, z = pos.z_;
+        return a_[0] * x * x + 2.0 * a_[1] * x * y + 2.0 * a_[2] * x * z + 2.0 * a_[3] * x +
+            a_[4] * y * y + 2.0 * a_[5] * y * z + 2.0 * a_[6] * y +
+            a_[7] * z * z + 2.0 * a_[8] * z + a_[9];
+    }
+
+    /// Coefficients: aa, ab, ac, ad, bb, bc, bd, cc, cd, dd.
+    double a_[10];
+    /// Number of accumulated planes.
+    double weight_;
+};
+
+/// Edge collapse candidate.
+struct Collapse
+{
+    /// Vertex to remove.
+    unsigned from_;
+    /// Vertex to collapse into.
+    unsigned to_;
+    /// Quadric error of the collapse.
+    double cost_;
+    /// Mean squared distance to the accumulated planes.
+    double error_;
+};
+
+/// Triangle cluster for overdraw sorting.
+struct ClusterSortKey
+{
+    /// Distance of the cluster from the mesh center along the cluster normal.
+    float key_;
+    /// Cluster index.
+    unsigned cluster_;
+};
+
+/// Vertex ordering by position for finding coincident vertices.
+struct VertexPositionCompare
+{
+    /// Construct with the position array.
+    VertexPositionCompare(const PODVector<Vector3>& positions) :
+        positions_(positions)
+    {
+    }
+
+    /// Compare two vertices lexicographically by position.
+    bool operator () (unsigned lhs, unsigned rhs) const
+    {
+        const Vector3& l = positions_[lhs];
+        const Vector3& r = positions_[rhs];
+        if (l.x_ != r.x_)
+            return l.x_ < r.x_;
+        if (l.y_ != r.y_)
+            return l.y_ < r.y_;
+        return l.z_ < r.z_;
+    }
+
+    /// Vertex positions.
+    const PODVector<Vector3>& positions_;
+};
+
+static bool CompareCollapses(const Collapse& lhs, const Collapse& rhs)
+{
+    return lhs.cost_ < rhs.cost_;
+}
+
+static bool CompareClusters(const ClusterSortKey& lhs, const ClusterSortKey& rhs)
+{
+    return lhs.key_ > rhs.key_;
+}
+
+static float GetVertexScore(int cachePosition, unsigned remainingTriangles)
+{
+    // Vertices with no triangles left never need to be selected again
+    if (!remainingTriangles)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the most recent triangle get a fixed score so that strips are not favored artificially
+        if (cachePosition < 3)
+            score = LAST_TRIANGLE_SCORE;
+        else
+        {
+            float scaler = 1.0f / (float)(VERTEX_CACHE_SIZE - 3);
+            score = powf(1.0f - (float)(cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Boost vertices with few triangles left so that lone triangles do not get stranded
+    score += VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+/// Build vertex to triangle adjacency as offsets into a flat triangle list.
+static void BuildTriangleAdjacency(PODVector<unsigned>& offsets, PODVector<unsigned>& counts, PODVector<unsigned>& triangles,
+    const PODVector<unsigned>& indices, unsigned numVertices)
+{
+    offsets.Resize(numVertices + 1);
+    counts.Resize(numVertices);
+    triangles.Resize(indices.Size());
+
+    for (unsigned i = 0; i < numVertices; ++i)
+        counts[i] = 0;
+    for (unsigned i = 0; i < indices.Size(); ++i)
+        ++counts[indices[i]];
+
+    offsets[0] = 0;
+    for (unsigned i = 0; i < numVertices; ++i)
+    {
+        offsets[i + 1] = offsets[i] + counts[i];
+        counts[i] = 0;
+    }
+
+    for (unsigned i = 0; i < indices.Size(); ++i)
+    {
+        unsigned vertex = indices[i];
+        triangles[offsets[vertex] + counts[vertex]++] = i / 3;
+    }
+}
+
+static Vector3 GetTriangleNormal(const Vector3& v0, const Vector3& v1, const Vector3& v2)
+{
+    return (v1 - v0).CrossProduct(v2 - v0);
+}
+
+void OptimizeVertexCache(PODVector<unsigned>& indices, unsigned numVertices)
+{
+    unsigned numTriangles = indices.Size() / 3;
+    if (numTriangles < 2 || !numVertices)
+        return;
+
+    PODVector<unsigned> offsets;
+    PODVector<unsigned> remaining;
+    PODVector<unsigned> adjacency;
+    BuildTriangleAdjacency(offsets, remaining, adjacency, indices, numVertices);
+
+    PODVector<int> cachePositions;
+    PODVector<float> vertexScores;
+    cachePositions.Resize(numVertices);
+    vertexScores.Resize(numVertices);
+    for (unsigned i = 0; i < numVertices; ++i)
+    {
+        cachePositions[i] = -1;
+        vertexScores[i] = GetVertexScore(-1, remaining[i]);
+    }
+
+    PODVector<float> triangleScores;
+    PODVector<unsigned char> triangleAdded;
+    triangleScores.Resize(numTriangles);
+    triangleAdded.Resize(numTriangles);
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+        triangleAdded[i] = 0;
+    }
+
+    PODVector<unsigned> newIndices;
+    newIndices.Reserve(indices.Size());
+
+    unsigned cache[VERTEX_CACHE_SIZE + 3];
+    unsigned newCache[VERTEX_CACHE_SIZE + 3];
+    unsigned cacheSize = 0;
+    unsigned cursor = 0;
+    int bestTriangle = -1;
+
+    while (newIndices.Size() < indices.Size())
+    {
+        // When no triangle in the cache is a candidate, continue from the next unprocessed triangle in the original order
+        if (bestTriangle < 0)
+        {
+            while (triangleAdded[cursor])
+                ++cursor;
+            bestTriangle = cursor;
+        }
+
+        triangleAdded[bestTriangle] = 1;
+        const unsigned* triangle = &indices[bestTriangle * 3];
+        unsigned newCacheSize = 0;
+
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            unsigned vertex = triangle[i];
+            newIndices.Push(vertex);
+            newCache[newCacheSize++] = vertex;
+
+            // Remove the triangle from the vertex's remaining triangles
+            unsigned* begin = &adjacency[offsets[vertex]];
+            unsigned count = remaining[vertex];
+            for (unsigned j = 0; j < count; ++j)
+            {
+                if (begin[j] == (unsigned)bestTriangle)
+                {
+                    begin[j] = begin[count - 1];
+                    break;
+                }
+            }
+            --remaining[vertex];
+        }
+
+        for (unsigned i = 0; i < cacheSize; ++i)
+        {
+            unsigned vertex = cache[i];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                newCache[newCacheSize++] = vertex;
+        }
+
+        // Update scores of the vertices in the cache and those that dropped out, and propagate to their triangles
+        for (unsigned i = 0; i < newCacheSize; ++i)
+        {
+            unsigned vertex = newCache[i];
+            cachePositions[vertex] = i < VERTEX_CACHE_SIZE ? (int)i : -1;
+            float score = GetVertexScore(cachePositions[vertex], remaining[vertex]);
+            float delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            const unsigned* begin = &adjacency[offsets[vertex]];
+            for (unsigned j = 0; j < remaining[vertex]; ++j)
+                triangleScores[begin[j]] += delta;
+        }
+
+        cacheSize = Min((int)newCacheSize, (int)VERTEX_CACHE_SIZE);
+        for (unsigned i = 0; i < cacheSize; ++i)
+            cache[i] = newCache[i];
+
+        // Pick the best scoring triangle among those referenced by the cache
+        bestTriangle = -1;
+        float bestScore = -M_INFINITY;
+        for (unsigned i = 0; i < cacheSize; ++i)
+        {
+            unsigned vertex = cache[i];
+            const unsigned* begin = &adjacency[offsets[vertex]];
+            for (unsigned j = 0; j < remaining[vertex]; ++j)
+            {
+                unsigned candidate = begin[j];
+                if (triangleScores[candidate] > bestScore)
+                {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = (int)candidate;
+                }
+            }
+        }
+    }
+
+    indices = newIndices;
+}
+
+void OptimizeOverdraw(PODVector<unsigned>& indices, const PODVector<Vector3>& positions)
+{
+    unsigned numTriangles = indices.Size() / 3;
+    if (numTriangles < 2 || positions.Empty())
+        return;
+
+    // Split the triangle order into clusters at hard cache misses, so that reordering the clusters keeps the cache efficiency
+    PODVector<unsigned> clusterStarts;
+    PODVector<unsigned> timestamps;
+    timestamps.Resize(positions.Size());
+    for (unsigned i = 0; i < timestamps.Size(); ++i)
+        timestamps[i] = 0;
+    unsigned timestamp = OVERDRAW_CACHE_SIZE + 1;
+
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        unsigned misses = 0;
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            unsigned vertex = indices[i * 3 + j];
+            if (timestamp - timestamps[vertex] > OVERDRAW_CACHE_SIZE)
+            {
+                timestamps[vertex] = timestamp++;
+                ++misses;
+            }
+        }
+        if (misses == 3)
+            clusterStarts.Push(i);
+    }
+    if (clusterStarts.Size() < 2)
+        return;
+    clusterStarts.Push(numTriangles);
+
+    Vector3 meshCenter = Vector3::ZERO;
+    float meshArea = 0.0f;
+    PODVector<ClusterSortKey> clusterKeys;
+    PODVector<Vector3> clusterCenters;
+    PODVector<Vector3> clusterNormals;
+    clusterCenters.Resize(clusterStarts.Size() - 1);
+    clusterNormals.Resize(clusterStarts.Size() - 1);
+
+    for (unsigned i = 0; i < clusterStarts.Size() - 1; ++i)
+    {
+        Vector3 center = Vector3::ZERO;
+        Vector3 normal = Vector3::ZERO;
+        float area = 0.0f;
+
+        for (unsigned j = clusterStarts[i]; j < clusterStarts[i + 1]; ++j)
+        {
+            const Vector3& v0 = positions[indices[j * 3]];
+            const Vector3& v1 = positions[indices[j * 3 + 1]];
+            const Vector3& v2 = positions[indices[j * 3 + 2]];
+            Vector3 triangleNormal = GetTriangleNormal(v0, v1, v2);
+            float triangleArea = triangleNormal.Length();
+            center += (v0 + v1 + v2) * triangleArea;
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        meshCenter += center;
+        meshArea += area;
+        clusterCenters[i] = area > M_EPSILON ? center / (area * 3.0f) : center;
+        clusterNormals[i] = normal.Normalized();
+    }
+
+    if (meshArea > M_EPSILON)
+        meshCenter /= meshArea * 3.0f;
+
+    // Draw the clusters facing outward from the furthest out first, as they are most likely to occlude the rest
+    clusterKeys.Resize(clusterCenters.Size());
+    for (unsigned i = 0; i < clusterKeys.Size(); ++i)
+    {
+        clusterKeys[i].key_ = (clusterCenters[i] - meshCenter).DotProduct(clusterNormals[i]);
+        clusterKeys[i].cluster_ = i;
+    }
+    Sort(clusterKeys.Begin(), clusterKeys.End(), CompareClusters);
+
+    PODVector<unsigned> newIndices;
+    newIndices.Reserve(indices.Size());
+    for (unsigned i = 0; i < clusterKeys.Size(); ++i)
+    {
+        unsigned cluster = clusterKeys[i].cluster_;
+        for (unsigned j = clusterStarts[cluster] * 3; j < clusterStarts[cluster + 1] * 3; ++j)
+            newIndices.Push(indices[j]);
+    }
+
+    indices = newIndices;
+}
+
+float SimplifyMesh(PODVector<unsigned>& dest, const PODVector<unsigned>& indices, const PODVector<Vector3>& positions,
+    unsigned targetTriangles)
+{
+    dest = indices;
+    unsigned numVertices = positions.Size();
+    if (dest.Size() / 3 <= targetTriangles || !numVertices)
+        return 0.0f;
+
+    // Accumulate the planes of the original triangles to their vertices
+    PODVector<Quadric> quadrics;
+    quadrics.Resize(numVertices);
+    for (unsigned i = 0; i < numVertices; ++i)
+        quadrics[i] = Quadric();
+
+    for (unsigned i = 0; i < dest.Size(); i += 3)
+    {
+        const Vector3& v0 = positions[dest[i]];
+        Vector3 normal = GetTriangleNormal(v0, positions[dest[i + 1]], positions[dest[i + 2]]);
+        float length = normal.Length();
+        if (length < M_EPSILON)
+            continue;
+        normal /= length;
+        double d = -normal.DotProduct(v0);
+        for (unsigned j = 0; j < 3; ++j)
+            quadrics[dest[i + j]].AddPlane(normal.x_, normal.y_, normal.z_, d);
+    }
+
+    // Lock vertices that share their position with another vertex (UV or normal seams)
+    PODVector<unsigned char> locked;
+    locked.Resize(numVertices);
+    for (unsigned i = 0; i < numVertices; ++i)
+        locked[i] = 0;
+
+    {
+        PODVector<unsigned> sorted;
+        sorted.Resize(numVertices);
+        for (unsigned i = 0; i < numVertices; ++i)
+            sorted[i] = i;
+        Sort(sorted.Begin(), sorted.End(), VertexPositionCompare(positions));
+        for (unsigned i = 1; i < numVertices; ++i)
+        {
+            if (positions[sorted[i]] == positions[sorted[i - 1]])
+                locked[sorted[i]] = locked[sorted[i - 1]] = 1;
+        }
+    }
+
+    PODVector<unsigned> offsets;
+    PODVector<unsigned> counts;
+    PODVector<unsigned> adjacency;
+    PODVector<unsigned> remap;
+    PODVector<unsigned char> touched;
+    PODVector<Collapse> collapses;
+    PODVector<unsigned> fromNeighbors;
+    remap.Resize(numVertices);
+    touched.Resize(numVertices);
+
+    // Lock vertices on open edges (edges used by only one triangle)
+    BuildTriangleAdjacency(offsets, counts, adjacency, dest, numVertices);
+    for (unsigned i = 0; i < dest.Size(); ++i)
+    {
+        unsigned a = dest[i];
+        unsigned b = dest[i - i % 3 + (i + 1) % 3];
+        unsigned edgeUse = 0;
+        for (unsigned j = offsets[a]; j < offsets[a + 1]; ++j)
+        {
+            const unsigned* triangle = &dest[adjacency[j] * 3];
+            if (triangle[0] == b || triangle[1] == b || triangle[2] == b)
+                ++edgeUse;
+        }
+        if (edgeUse < 2)
+            locked[a] = locked[b] = 1;
+    }
+
+    double maxError = 0.0;
+
+    for (unsigned pass = 0; pass < MAX_SIMPLIFY_PASSES && dest.Size() / 3 > targetTriangles; ++pass)
+    {
+        if (pass)
+            BuildTriangleAdjacency(offsets, counts, adjacency, dest, numVertices);
+
+        // Gather candidate collapses, considering each edge once from the triangle where it runs from a lower to a higher index
+        collapses.Clear();
+        for (unsigned i = 0; i < dest.Size(); ++i)
+        {
+            unsigned a = dest[i];
+            unsigned b = dest[i - i % 3 + (i + 1) % 3];
+            if (a >= b || (locked[a] && locked[b]))
+                continue;
+
+            Quadric sum = quadrics[a];
+            sum.Add(quadrics[b]);
+            Collapse collapse;
+            collapse.cost_ = M_INFINITY;
+
+            if (!locked[a])
+            {
+                collapse.from_ = a;
+                collapse.to_ = b;
+                collapse.cost_ = sum.Evaluate(positions[b]);
+            }
+            if (!locked[b])
+            {
+                double cost = sum.Evaluate(positions[a]);
+                if (cost < collapse.cost_)
+                {
+                    collapse.from_ = b;
+                    collapse.to_ = a;
+                    collapse.cost_ = cost;
+                }
+            }
+            collapse.error_ = sum.weight_ > 0.0 ? collapse.cost_ / sum.weight_ : 0.0;
+
+            collapses.Push(collapse);
+        }
+
+        if (collapses.Empty())
+            break;
+        Sort(collapses.Begin(), collapses.End(), CompareCollapses);
+
+        for (unsigned i = 0; i < numVertices; ++i)
+        {
+            remap[i] = i;
+            touched[i] = 0;
+        }
+
+        unsigned currentTriangles = dest.Size() / 3;
+        unsigned removedTriangles = 0;
+        unsigned numCollapses = 0;
+
+        for (unsigned i = 0; i < collapses.Size() && currentTriangles - removedTriangles > targetTriangles; ++i)
+        {
+            unsigned from = collapses[i].from_;
+            unsigned to = collapses[i].to_;
+            if (touched[from] || touched[to])
+                continue;
+
+            // Reject collapses that would flip a triangle, and count the triangles that will degenerate
+            const Vector3& toPos = positions[to];
+            unsigned shared = 0;
+            bool valid = true;
+            fromNeighbors.Clear();
+
+            for (unsigned j = offsets[from]; j < offsets[from + 1]; ++j)
+            {
+                const unsigned* triangle = &dest[adjacency[j] * 3];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                {
+                    ++shared;
+                    continue;
+                }
+
+                Vector3 v[3];
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                    v[k] = positions[triangle[k]];
+                    if (triangle[k] != from)
+                        fromNeighbors.Push(triangle[k]);
+                }
+                Vector3 oldNormal = GetTriangleNormal(v[0], v[1], v[2]);
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                    if (triangle[k] == from)
+                        v[k] = toPos;
+                }
+                Vector3 newNormal = GetTriangleNormal(v[0], v[1], v[2]);
+                if (oldNormal.DotProduct(newNormal) <= 0.0f || newNormal.Length() < M_EPSILON * oldNormal.Length())
+                {
+                    valid = false;
+                    break;
+                }
+            }
+
+            // Reject collapses that would merge the surface with itself, which happens when the two vertices have other
+            // common neighbors than those of the triangles around the edge
+            if (valid)
+            {
+                unsigned common = 0;
+                for (unsigned j = offsets[to]; j < offsets[to + 1] && valid; ++j)
+                {
+                    const unsigned* triangle = &dest[adjacency[j] * 3];
+                    if (triangle[0] == from || triangle[1] == from || triangle[2] == from)
+                        continue;
+                    for (unsigned k = 0; k < 3; ++k)
+                    {
+                        if (triangle[k] != to && fromNeighbors.Contains(triangle[k]))
+                            ++common;
+                    }
+                }
+                // The opposite vertex of each triangle around the edge is found once through the other triangle sharing it
+                if (common > shared)
+                    valid = false;
+            }
+
+            if (!valid || !shared)
+                continue;
+
+            remap[from] = to;
+            quadrics[to].Add(quadrics[from]);
+            if (collapses[i].error_ > maxError)
+                maxError = collapses[i].error_;
+            removedTriangles += shared;
+            ++numCollapses;
+
+            // Lock the neighborhood for the rest of the pass, as its adjacency is now stale
+            for (unsigned j = offsets[from]; j < offsets[from + 1]; ++j)
+            {
+                const unsigned* triangle = &dest[adjacency[j] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+            for (unsigned j = offsets[to]; j < offsets[to + 1]; ++j)
+            {
+                const unsigned* triangle = &dest[adjacency[j] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+        }
+
+        if (!numCollapses)
+            break;
+
+        // Apply the collapses and remove degenerate triangles
+        unsigned writeIndex = 0;
+        for (unsigned i = 0; i < dest.Size(); i += 3)
+        {
+            unsigned v0 = remap[dest[i]];
+            unsigned v1 = remap[dest[i + 1]];
+            unsigned v2 = remap[dest[i + 2]];
+            if (v0 == v1 || v1 == v2 || v2 == v0)
+                continue;
+            dest[writeIndex++] = v0;
+            dest[writeIndex++] = v1;
+            dest[writeIndex++] = v2;
+        }
+        dest.Resize(writeIndex);
+    }
+
+    return (float)sqrt(maxError);
+}
+
+void GetVertexFetchRemap(PODVector<unsigned>& remap, const PODVector<unsigned>& indices, unsigned numVertices)
+{
+    remap.Resize(numVertices);
+    for (unsigned i = 0; i < numVertices; ++i)
+        remap[i] = M_MAX_UNSIGNED;
+
+    unsigned nextVertex = 0;
+    for (unsigned i = 0; i < indices.Size(); ++i)
+    {
+        unsigned vertex = indices[i];
+        if (vertex < numVertices && remap[vertex] == M_MAX_UNSIGNED)
+            remap[vertex] = nextVertex++;
+    }
+
+    for (unsigned i = 0; i < numVertices; ++i)
+    {
+        if (remap[i] == M_MAX_UNSIGNED)
+            remap[i] = nextVertex++;
+    }
+}
@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/Vector3.h>
+
+using namespace Urho3D;
+
+/// Reorder triangles for post-transform vertex cache efficiency (Forsyth's linear-speed algorithm.)
+void OptimizeVertexCache(PODVector<unsigned>& indices, unsigned numVertices);
+/// Reorder vertex cache optimized triangle clusters front-to-back from the outside to reduce overdraw.
+void OptimizeOverdraw(PODVector<unsigned>& indices, const PODVector<Vector3>& positions);
+/// Simplify a triangle list by quadric edge collapse toward a target triangle count. Seam and border vertices are preserved. Return the geometric error of the result.
+float SimplifyMesh(PODVector<unsigned>& dest, const PODVector<unsigned>& indices, const PODVector<Vector3>& positions,
+    unsigned targetTriangles);
+/// Compute a vertex remap table that orders vertices by their first use in the index data. Unused vertices are moved to the end.
+void GetVertexFetchRemap(PODVector<unsigned>& remap, const PODVector<unsigned>& indices, unsigned numVertices);
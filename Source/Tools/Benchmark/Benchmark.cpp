@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/ObjectPool.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "Benchmark.h"
+#include "Scenario.h"
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+/// Default number of measured frames per scenario.
+static const unsigned DEFAULT_FRAMES = 300;
+/// Default number of frames to run before measuring.
+static const unsigned DEFAULT_WARMUP_FRAMES = 30;
+/// Random seed used for every scenario so that the scenes are the same on each run.
+static const unsigned RANDOM_SEED = 1;
+
+DEFINE_APPLICATION_MAIN(Benchmark);
+
+Benchmark::Benchmark(Context* context) :
+    Application(context),
+    currentScenario_(0),
+    frameNumber_(0),
+    numFrames_(DEFAULT_FRAMES),
+    numWarmupFrames_(DEFAULT_WARMUP_FRAMES),
+    timeStep_(1.0f / 60.0f),
+    setupTime_(0.0f),
+    failed_(false)
+{
+}
+
+void Benchmark::Setup()
+{
+    const Vector<String>& arguments = GetArguments();
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+        if (argument == "-scenarios" && !value.Empty())
+        {
+            scenarioNames_ = value.Split(',');
+            ++i;
+        }
+        else if (argument == "-frames" && !value.Empty())
+        {
+            numFrames_ = (unsigned)Max(ToInt(value), 1);
+            ++i;
+        }
+        else if (argument == "-warmup" && !value.Empty())
+        {
+            numWarmupFrames_ = ToUInt(value);
+            ++i;
+        }
+        else if (argument == "-fps" && !value.Empty())
+        {
+            timeStep_ = 1.0f / Max(ToFloat(value), 1.0f);
+            ++i;
+        }
+        else if (argument == "-output" && !value.Empty())
+        {
+            outputFileName_ = GetInternalPath(value);
+            ++i;
+        }
+        else if (argument == "-help")
+        {
+            ErrorExit("Usage: Benchmark [options]\n\n"
+                "Runs deterministic engine scenarios with a fixed timestep and reports their frame timings and memory use as "
+                "JSON. Rendering scenarios are skipped in headless mode. The engine command line options also apply.\n\n"
+                "Options:\n"
+                "-scenarios <list> Comma-separated scenarios to run, default all: Rendering,Culling,Physics,Navigation,"
+                "Skinning,SceneLoad,Replication\n"
+                "-frames <n>       Measured frames per scenario, default 300\n"
+                "-warmup <n>       Frames to run before measuring, default 30\n"
+                "-fps <n>          Fixed update rate, default 60\n"
+                "-output <file>    Write the results to a file instead of the standard output\n"
+            );
+            return;
+        }
+    }
+
+    // The frame time is measured over the whole frame, so never wait for the frame limiter or the vertical sync
+    if (!engineParameters_.Contains("WindowWidth"))
+        engineParameters_["WindowWidth"] = 1280;
+    if (!engineParameters_.Contains("WindowHeight"))
+        engineParameters_["WindowHeight"] = 720;
+    engineParameters_["FullScreen"] = false;
+    engineParameters_["FrameLimiter"] = false;
+    engineParameters_["VSync"] = false;
+    engineParameters_["Sound"] = false;
+    engineParameters_["LogName"] = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "logs") + "Benchmark.log";
+}
+
+void Benchmark::Start()
+{
+    engine_->SetPauseMinimized(false);
+
+    CreateScenarios();
+    if (scenarios_.Empty())
+    {
+        ErrorExit("No scenarios to run");
+        return;
+    }
+
+    SubscribeToEvent(E_BEGINFRAME, HANDLER(Benchmark, HandleBeginFrame));
+    SubscribeToEvent(E_UPDATE, HANDLER(Benchmark, HandleUpdate));
+    SubscribeToEvent(E_ENDFRAME, HANDLER(Benchmark, HandleEndFrame));
+
+    StartScenario(0);
+}
+
+void Benchmark::Stop()
+{
+    // If exited before all scenarios were run, stop the current one
+    if (currentScenario_ < scenarios_.Size())
+        scenarios_[currentScenario_]->Stop();
+    scenarios_.Clear();
+}
+
+void Benchmark::CreateScenarios()
+{
+    Vector<SharedPtr<Scenario> > scenarios;
+    scenarios.Push(SharedPtr<Scenario>(new RenderingScenario(context_)));
+    scenarios.Push(SharedPtr<Scenario>(new CullingScenario(context_)));
+#ifdef URHO3D_PHYSICS
+    scenarios.Push(SharedPtr<Scenario>(new PhysicsScenario(context_)));
+#endif
+#ifdef URHO3D_NAVIGATION
+    scenarios.Push(SharedPtr<Scenario>(new NavigationScenario(context_)));
+#endif
+    scenarios.Push(SharedPtr<Scenario>(new SkinningScenario(context_)));
+    scenarios.Push(SharedPtr<Scenario>(new SceneLoadScenario(context_)));
+#ifdef URHO3D_NETWORK
+    scenarios.Push(SharedPtr<Scenario>(new ReplicationScenario(context_)));
+#endif
+
+    if (scenarioNames_.Empty())
+    {
+        scenarios_ = scenarios;
+        return;
+    }
+
+    for (unsigned i = 0; i < scenarioNames_.Size(); ++i)
+    {
+        String name = scenarioNames_[i].Trimmed();
+        bool found = false;
+        for (unsigned j = 0; j < scenarios.Size(); ++j)
+        {
+            if (!scenarios[j]->GetName().Compare(name, false))
+            {
+                scenarios_.Push(scenarios[j]);
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            LOGWARNING("Unknown or unavailable benchmark scenario " + name);
+    }
+}
+
+void Benchmark::StartScenario(unsigned index)
+{
+    for (currentScenario_ = index; currentScenario_ < scenarios_.Size(); ++currentScenario_)
+    {
+        Scenario* scenario = scenarios_[currentScenario_];
+
+        ScenarioResult result;
+        result.name_ = scenario->GetName();
+
+        if (scenario->GetRequiresRendering() && engine_->IsHeadless())
+        {
+            LOGINFO("Skipping scenario " + scenario->GetName() + " in headless mode");
+            result.status_ = "skipped";
+            results_.Push(result);
+            continue;
+        }
+
+        LOGINFO("Starting scenario " + scenario->GetName());
+
+        SetRandomSeed(RANDOM_SEED);
+        HiresTimer setupTimer;
+        bool success = scenario->Start();
+        setupTime_ = setupTimer.GetUSec(false) / 1000.0f;
+
+        if (success)
+        {
+            frameNumber_ = 0;
+            frameTimes_.Clear();
+            engine_->SetNextTimeStep(timeStep_);
+            return;
+        }
+
+        LOGERROR("Failed to start scenario " + scenario->GetName());
+        scenario->Stop();
+        result.status_ = "failed";
+        results_.Push(result);
+        failed_ = true;
+    }
+
+    // All scenarios have been run
+    WriteResults();
+    if (failed_)
+        exitCode_ = EXIT_FAILURE;
+    engine_->Exit();
+}
+
+void Benchmark::FinishScenario()
+{
+    Scenario* scenario = scenarios_[currentScenario_];
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    ScenarioResult result;
+    result.name_ = scenario->GetName();
+    result.status_ = "ok";
+    result.setupTime_ = setupTime_;
+    result.numFrames_ = frameTimes_.Size();
+    result.numNodes_ = scenario->GetScene()->GetNumChildren(true);
+    result.resourceMemory_ = cache->GetTotalMemoryUse();
+    result.pooledObjects_ = ObjectPool::GetNumAllocated();
+
+    if (!frameTimes_.Empty())
+    {
+        for (unsigned i = 0; i < frameTimes_.Size(); ++i)
+            result.totalTime_ += frameTimes_[i];
+        result.averageTime_ = result.totalTime_ / frameTimes_.Size();
+
+        Sort(frameTimes_.Begin(), frameTimes_.End());
+        result.minTime_ = frameTimes_.Front();
+        result.maxTime_ = frameTimes_.Back();
+        result.medianTime_ = frameTimes_[frameTimes_.Size() / 2];
+    }
+
+    results_.Push(result);
+    LOGINFOF("Scenario %s: average %.3f ms, median %.3f ms, max %.3f ms", result.name_.CString(), result.averageTime_,
+        result.medianTime_, result.maxTime_);
+
+    scenario->Stop();
+    // Release the scenario's resources so that the next scenario's memory use is measured on its own
+    cache->ReleaseAllResources(false);
+}
+
+void Benchmark::WriteResults()
+{
+    char line[256];
+    String output;
+
+    Graphics* graphics = GetSubsystem<Graphics>();
+    sprintf(line, "{\"platform\":\"%s\",\"api\":\"%s\",\"cpus\":%u,\"timeStep\":%.6f,\"warmupFrames\":%u,\"scenarios\":[",
+        GetPlatform().CString(), engine_->IsHeadless() || !graphics ? "Headless" : graphics->GetApiName().CString(),
+        GetNumLogicalCPUs(), timeStep_, numWarmupFrames_);
+    output.Append(line);
+
+    for (unsigned i = 0; i < results_.Size(); ++i)
+    {
+        const ScenarioResult& result = results_[i];
+        sprintf(line, "%s\n{\"name\":\"%s\",\"status\":\"%s\",\"setupMs\":%.3f,\"frames\":%u,\"totalMs\":%.3f,\"averageMs\":%.3f,"
+            "\"minMs\":%.3f,\"maxMs\":%.3f,\"medianMs\":%.3f,", i ? "," : "", result.name_.CString(), result.status_.CString(),
+            result.setupTime_, result.numFrames_, result.totalTime_, result.averageTime_, result.minTime_, result.maxTime_,
+            result.medianTime_);
+        output.Append(line);
+        sprintf(line, "\"nodes\":%u,\"resourceMemory\":%u,\"pooledObjects\":%u}", result.numNodes_, result.resourceMemory_,
+            result.pooledObjects_);
+        output.Append(line);
+    }
+    output.Append("\n]}\n");
+
+    if (outputFileName_.Empty())
+    {
+        PrintUnicode(output);
+        return;
+    }
+
+    File file(context_);
+    if (!file.Open(outputFileName_, FILE_WRITE))
+    {
+        failed_ = true;
+        return;
+    }
+    file.Write(output.CString(), output.Length());
+    LOGINFO("Wrote benchmark results to " + outputFileName_);
+}
+
+void Benchmark::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    frameTimer_.Reset();
+}
+
+void Benchmark::HandleUpdate(StringHash eventType, VariantMap& eventData)
+{
+    using namespace Update;
+
+    if (currentScenario_ < scenarios_.Size())
+        scenarios_[currentScenario_]->Update(eventData[P_TIMESTEP].GetFloat());
+}
+
+void Benchmark::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    if (currentScenario_ >= scenarios_.Size())
+        return;
+
+    float frameTime = frameTimer_.GetUSec(false) / 1000.0f;
+    if (frameNumber_ >= numWarmupFrames_)
+        frameTimes_.Push(frameTime);
+    ++frameNumber_;
+
+    // The frame limiter is off, so the timestep set here is used as is
+    engine_->SetNextTimeStep(timeStep_);
+
+    if (frameTimes_.Size() >= numFrames_)
+    {
+        FinishScenario();
+        StartScenario(currentScenario_ + 1);
+    }
+}
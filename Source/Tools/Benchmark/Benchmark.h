@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Application.h>
+
+using namespace Urho3D;
+
+class Scenario;
+
+/// Timing and memory results of a benchmark scenario.
+struct ScenarioResult
+{
+    /// Construct.
+    ScenarioResult() :
+        setupTime_(0.0f),
+        totalTime_(0.0f),
+        averageTime_(0.0f),
+        minTime_(0.0f),
+        maxTime_(0.0f),
+        medianTime_(0.0f),
+        numFrames_(0),
+        numNodes_(0),
+        resourceMemory_(0),
+        pooledObjects_(0)
+    {
+    }
+
+    /// Scenario name.
+    String name_;
+    /// Status: "ok", "skipped" or "failed".
+    String status_;
+    /// Scene creation time in milliseconds.
+    float setupTime_;
+    /// Total time of the measured frames in milliseconds.
+    float totalTime_;
+    /// Average frame time in milliseconds.
+    float averageTime_;
+    /// Minimum frame time in milliseconds.
+    float minTime_;
+    /// Maximum frame time in milliseconds.
+    float maxTime_;
+    /// Median frame time in milliseconds.
+    float medianTime_;
+    /// Number of measured frames.
+    unsigned numFrames_;
+    /// Number of scene nodes at the end.
+    unsigned numNodes_;
+    /// Resource memory use in bytes at the end.
+    unsigned resourceMemory_;
+    /// Number of objects allocated from object pools at the end.
+    unsigned pooledObjects_;
+};
+
+/// Benchmark application. Runs deterministic scenarios with a fixed timestep and writes their frame timings as JSON.
+class Benchmark : public Application
+{
+    OBJECT(Benchmark);
+
+public:
+    /// Construct.
+    Benchmark(Context* context);
+
+    /// Setup before engine initialization. Parse the benchmark options.
+    virtual void Setup();
+    /// Setup after engine initialization. Create the scenarios and start the first one.
+    virtual void Start();
+    /// Cleanup after the main loop. Stop the running scenario.
+    virtual void Stop();
+
+private:
+    /// Create the scenarios selected on the command line.
+    void CreateScenarios();
+    /// Start a scenario, skipping those that can not run. When all have been run, write the results and exit.
+    void StartScenario(unsigned index);
+    /// Collect the results of the current scenario and stop it.
+    void FinishScenario();
+    /// Write the results as JSON to the output file or to the standard output.
+    void WriteResults();
+    /// Handle frame begin. Start the frame timer.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Handle the logic update. Run the scenario's own work.
+    void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle frame end. Record the frame time and set the fixed timestep of the next frame.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+
+    /// Scenarios to run.
+    Vector<SharedPtr<Scenario> > scenarios_;
+    /// Results of the finished scenarios.
+    Vector<ScenarioResult> results_;
+    /// Names of the scenarios to run, or empty to run all.
+    Vector<String> scenarioNames_;
+    /// Frame times of the current scenario in milliseconds.
+    PODVector<float> frameTimes_;
+    /// Result output file name, or empty to print to the standard output.
+    String outputFileName_;
+    /// Frame timer.
+    HiresTimer frameTimer_;
+    /// Current scenario index.
+    unsigned currentScenario_;
+    /// Frame number within the current scenario.
+    unsigned frameNumber_;
+    /// Number of measured frames per scenario.
+    unsigned numFrames_;
+    /// Number of frames to run before measuring.
+    unsigned numWarmupFrames_;
+    /// Fixed timestep in seconds.
+    float timeStep_;
+    /// Current scenario setup time in milliseconds.
+    float setupTime_;
+    /// Failure flag.
+    bool failed_;
+};
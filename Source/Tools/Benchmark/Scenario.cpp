@@ -0,0 +1,455 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#ifdef URHO3D_NAVIGATION
+#include <Urho3D/Navigation/CrowdAgent.h>
+#include <Urho3D/Navigation/DetourCrowdManager.h>
+#include <Urho3D/Navigation/Navigable.h>
+#include <Urho3D/Navigation/NavigationMesh.h>
+#endif
+
+#ifdef URHO3D_NETWORK
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#endif
+
+#ifdef URHO3D_PHYSICS
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#endif
+
+#include "Scenario.h"
+
+#include <Urho3D/DebugNew.h>
+
+#ifdef URHO3D_NETWORK
+/// UDP port used by the replication scenario.
+static const unsigned short REPLICATION_PORT = 2347;
+#endif
+
+Scenario::Scenario(Context* context, const String& name) :
+    Object(context),
+    name_(name)
+{
+}
+
+Scenario::~Scenario()
+{
+}
+
+void Scenario::Stop()
+{
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+        renderer->SetViewport(0, 0);
+
+    cameraNode_.Reset();
+    scene_.Reset();
+}
+
+void Scenario::CreateScene()
+{
+    scene_ = new Scene(context_);
+    scene_->CreateComponent<Octree>();
+
+    Node* zoneNode = scene_->CreateChild("Zone");
+    Zone* zone = zoneNode->CreateComponent<Zone>();
+    zone->SetBoundingBox(BoundingBox(-1000.0f, 1000.0f));
+    zone->SetAmbientColor(Color(0.2f, 0.2f, 0.2f));
+    zone->SetFogStart(200.0f);
+    zone->SetFogEnd(300.0f);
+}
+
+void Scenario::SetupViewport(const Vector3& position, const Quaternion& rotation)
+{
+    Node* lightNode = scene_->CreateChild("DirectionalLight");
+    lightNode->SetDirection(Vector3(0.6f, -1.0f, 0.8f));
+    Light* light = lightNode->CreateComponent<Light>();
+    light->SetLightType(LIGHT_DIRECTIONAL);
+    light->SetCastShadows(true);
+
+    // The camera is kept outside the scene so that reloading the scene does not destroy it
+    cameraNode_ = new Node(context_);
+    cameraNode_->SetPosition(position);
+    cameraNode_->SetRotation(rotation);
+    Camera* camera = cameraNode_->CreateComponent<Camera>();
+    camera->SetFarClip(300.0f);
+
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+        renderer->SetViewport(0, new Viewport(context_, scene_, camera));
+}
+
+void Scenario::CreateBoxes(Node* parent, int size, float spacing)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    Model* model = cache->GetResource<Model>("Models/Box.mdl");
+    Material* material = cache->GetResource<Material>("Materials/Stone.xml");
+
+    for (int y = -size / 2; y < size / 2; ++y)
+    {
+        for (int x = -size / 2; x < size / 2; ++x)
+        {
+            Node* boxNode = parent->CreateChild("Box");
+            boxNode->SetPosition(Vector3(x * spacing, 0.0f, y * spacing));
+            boxNode->SetScale(0.25f * spacing);
+            StaticModel* boxObject = boxNode->CreateComponent<StaticModel>();
+            boxObject->SetModel(model);
+            boxObject->SetMaterial(material);
+        }
+    }
+}
+
+RenderingScenario::RenderingScenario(Context* context) :
+    Scenario(context, "Rendering")
+{
+}
+
+bool RenderingScenario::Start()
+{
+    CreateScene();
+    CreateBoxes(scene_, 125, 0.6f);
+    SetupViewport(Vector3(0.0f, 20.0f, -40.0f), Quaternion(25.0f, 0.0f, 0.0f));
+    return true;
+}
+
+void RenderingScenario::Update(float timeStep)
+{
+    cameraNode_->RotateAround(Vector3::ZERO, Quaternion(10.0f * timeStep, Vector3::UP), TS_WORLD);
+}
+
+CullingScenario::CullingScenario(Context* context) :
+    Scenario(context, "Culling"),
+    yaw_(0.0f)
+{
+}
+
+bool CullingScenario::Start()
+{
+    CreateScene();
+    CreateBoxes(scene_, 200, 1.0f);
+    SetupViewport(Vector3(0.0f, 10.0f, 0.0f), Quaternion::IDENTITY);
+    return true;
+}
+
+void CullingScenario::Update(float timeStep)
+{
+    Octree* octree = scene_->GetComponent<Octree>();
+    Camera* camera = cameraNode_->GetComponent<Camera>();
+
+    // Sweep several frustums around the camera position, as if rendering multiple views
+    yaw_ += 10.0f * timeStep;
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        cameraNode_->SetRotation(Quaternion(15.0f, yaw_ + i * 22.5f, 0.0f));
+        drawables_.Clear();
+        FrustumOctreeQuery query(drawables_, camera->GetFrustum(), DRAWABLE_GEOMETRY);
+        octree->GetDrawables(query);
+    }
+}
+
+#ifdef URHO3D_PHYSICS
+PhysicsScenario::PhysicsScenario(Context* context) :
+    Scenario(context, "Physics")
+{
+}
+
+bool PhysicsScenario::Start()
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    CreateScene();
+    scene_->CreateComponent<PhysicsWorld>();
+
+    Node* floorNode = scene_->CreateChild("Floor");
+    floorNode->SetPosition(Vector3(0.0f, -0.5f, 0.0f));
+    floorNode->SetScale(Vector3(500.0f, 1.0f, 500.0f));
+    StaticModel* floorObject = floorNode->CreateComponent<StaticModel>();
+    floorObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+    floorObject->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
+    floorNode->CreateComponent<RigidBody>();
+    CollisionShape* floorShape = floorNode->CreateComponent<CollisionShape>();
+    floorShape->SetBox(Vector3::ONE);
+
+    // Create a pyramid of boxes, which collapses as the boxes settle
+    Model* model = cache->GetResource<Model>("Models/Box.mdl");
+    Material* material = cache->GetResource<Material>("Materials/StoneSmall.xml");
+    for (int y = 0; y < 10; ++y)
+    {
+        for (int x = -y; x <= y; ++x)
+        {
+            for (int z = -y; z <= y; ++z)
+            {
+                Node* boxNode = scene_->CreateChild("Box");
+                boxNode->SetPosition(Vector3(x * 1.05f, 10.0f - y + 0.5f, z * 1.05f));
+                StaticModel* boxObject = boxNode->CreateComponent<StaticModel>();
+                boxObject->SetModel(model);
+                boxObject->SetMaterial(material);
+                RigidBody* body = boxNode->CreateComponent<RigidBody>();
+                body->SetMass(1.0f);
+                body->SetFriction(0.75f);
+                CollisionShape* shape = boxNode->CreateComponent<CollisionShape>();
+                shape->SetBox(Vector3::ONE);
+            }
+        }
+    }
+
+    SetupViewport(Vector3(0.0f, 15.0f, -30.0f), Quaternion(25.0f, 0.0f, 0.0f));
+    return true;
+}
+#endif
+
+#ifdef URHO3D_NAVIGATION
+NavigationScenario::NavigationScenario(Context* context) :
+    Scenario(context, "Navigation"),
+    frames_(0),
+    targetIndex_(0)
+{
+}
+
+bool NavigationScenario::Start()
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    CreateScene();
+
+    Node* planeNode = scene_->CreateChild("Plane");
+    planeNode->SetScale(Vector3(100.0f, 1.0f, 100.0f));
+    StaticModel* planeObject = planeNode->CreateComponent<StaticModel>();
+    planeObject->SetModel(cache->GetResource<Model>("Models/Plane.mdl"));
+    planeObject->SetMaterial(cache->GetResource<Material>("Materials/StoneTiled.xml"));
+
+    Model* boxModel = cache->GetResource<Model>("Models/Box.mdl");
+    Material* boxMaterial = cache->GetResource<Material>("Materials/Stone.xml");
+    for (unsigned i = 0; i < 40; ++i)
+    {
+        Node* boxNode = scene_->CreateChild("Box");
+        float size = 1.0f + Random(5.0f);
+        boxNode->SetPosition(Vector3(Random(80.0f) - 40.0f, size * 0.5f, Random(80.0f) - 40.0f));
+        boxNode->SetScale(size);
+        StaticModel* boxObject = boxNode->CreateComponent<StaticModel>();
+        boxObject->SetModel(boxModel);
+        boxObject->SetMaterial(boxMaterial);
+    }
+
+    NavigationMesh* navMesh = scene_->CreateComponent<NavigationMesh>();
+    navMesh->SetAgentHeight(10.0f);
+    navMesh->SetCellHeight(0.05f);
+    scene_->CreateComponent<Navigable>();
+    if (!navMesh->Build())
+        return false;
+
+    scene_->CreateComponent<DetourCrowdManager>();
+
+    Model* agentModel = cache->GetResource<Model>("Models/Cylinder.mdl");
+    Material* agentMaterial = cache->GetResource<Material>("Materials/StoneSmall.xml");
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        Node* agentNode = scene_->CreateChild("Agent");
+        agentNode->SetPosition(navMesh->FindNearestPoint(Vector3(Random(80.0f) - 40.0f, 0.0f, Random(80.0f) - 40.0f)));
+        StaticModel* agentObject = agentNode->CreateComponent<StaticModel>();
+        agentObject->SetModel(agentModel);
+        agentObject->SetMaterial(agentMaterial);
+        CrowdAgent* agent = agentNode->CreateComponent<CrowdAgent>();
+        agent->SetHeight(2.0f);
+        agent->SetMaxSpeed(3.0f);
+        agent->SetMaxAccel(3.0f);
+    }
+
+    SetupViewport(Vector3(0.0f, 50.0f, 0.0f), Quaternion(80.0f, 0.0f, 0.0f));
+    return true;
+}
+
+void NavigationScenario::Update(float timeStep)
+{
+    // Send the whole crowd between the corners of the area so that paths have to be recalculated
+    static const Vector3 targets[] = {
+        Vector3(-40.0f, 0.0f, -40.0f),
+        Vector3(40.0f, 0.0f, 40.0f),
+        Vector3(40.0f, 0.0f, -40.0f),
+        Vector3(-40.0f, 0.0f, 40.0f)
+    };
+
+    if (frames_++ % 120)
+        return;
+
+    NavigationMesh* navMesh = scene_->GetComponent<NavigationMesh>();
+    scene_->GetComponent<DetourCrowdManager>()->SetCrowdTarget(navMesh->FindNearestPoint(targets[targetIndex_]));
+    targetIndex_ = (targetIndex_ + 1) % 4;
+}
+#endif
+
+SkinningScenario::SkinningScenario(Context* context) :
+    Scenario(context, "Skinning")
+{
+}
+
+bool SkinningScenario::Start()
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    Model* model = cache->GetResource<Model>("Models/Jack.mdl");
+    Material* material = cache->GetResource<Material>("Materials/Jack.xml");
+
+    CreateScene();
+
+    for (int y = -10; y < 10; ++y)
+    {
+        for (int x = -10; x < 10; ++x)
+        {
+            Node* modelNode = scene_->CreateChild("Jack");
+            modelNode->SetPosition(Vector3(x * 2.0f, 0.0f, y * 2.0f));
+            AnimatedModel* modelObject = modelNode->CreateComponent<AnimatedModel>();
+            modelObject->SetModel(model);
+            modelObject->SetMaterial(material);
+            // Animate also when there are no views, so that the animation cost is measured in headless mode
+            modelObject->SetUpdateInvisible(true);
+            AnimationController* controller = modelNode->CreateComponent<AnimationController>();
+            controller->PlayExclusive("Models/Jack_Walk.ani", 0, true);
+        }
+    }
+
+    SetupViewport(Vector3(0.0f, 15.0f, -30.0f), Quaternion(25.0f, 0.0f, 0.0f));
+    return true;
+}
+
+SceneLoadScenario::SceneLoadScenario(Context* context) :
+    Scenario(context, "SceneLoad")
+{
+}
+
+bool SceneLoadScenario::Start()
+{
+    CreateScene();
+
+    // Build a hierarchy with several components per node
+    for (unsigned i = 0; i < 50; ++i)
+    {
+        Node* groupNode = scene_->CreateChild("Group");
+        groupNode->SetPosition(Vector3(Random(200.0f) - 100.0f, 0.0f, Random(200.0f) - 100.0f));
+        CreateBoxes(groupNode, 6, 1.0f);
+
+        Node* lightNode = groupNode->CreateChild("PointLight");
+        lightNode->SetPosition(Vector3(0.0f, 3.0f, 0.0f));
+        Light* light = lightNode->CreateComponent<Light>();
+        light->SetLightType(LIGHT_POINT);
+        light->SetRange(10.0f);
+    }
+
+    SetupViewport(Vector3(0.0f, 50.0f, -100.0f), Quaternion(25.0f, 0.0f, 0.0f));
+
+    sceneData_.Clear();
+    return scene_->Save(sceneData_);
+}
+
+void SceneLoadScenario::Update(float timeStep)
+{
+    sceneData_.Seek(0);
+    scene_->Load(sceneData_);
+}
+
+void SceneLoadScenario::Stop()
+{
+    Scenario::Stop();
+    sceneData_.Clear();
+}
+
+#ifdef URHO3D_NETWORK
+ReplicationScenario::ReplicationScenario(Context* context) :
+    Scenario(context, "Replication"),
+    time_(0.0f)
+{
+}
+
+bool ReplicationScenario::Start()
+{
+    Network* network = GetSubsystem<Network>();
+
+    CreateScene();
+    CreateBoxes(scene_, 24, 2.0f);
+    SetupViewport(Vector3(0.0f, 30.0f, -40.0f), Quaternion(35.0f, 0.0f, 0.0f));
+
+    SubscribeToEvent(E_CLIENTCONNECTED, HANDLER(ReplicationScenario, HandleClientConnected));
+    if (!network->StartServer(REPLICATION_PORT))
+        return false;
+
+    // The client scene only receives the replicated content
+    clientScene_ = new Scene(context_);
+    network->SetUpdateFps(60);
+    return network->Connect("localhost", REPLICATION_PORT, clientScene_);
+}
+
+void ReplicationScenario::Update(float timeStep)
+{
+    time_ += timeStep;
+
+    // Move every box so that all of them need to be replicated each network update
+    const Vector<SharedPtr<Node> >& children = scene_->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        Node* node = children[i];
+        if (node->GetName() == "Box")
+        {
+            Vector3 position = node->GetPosition();
+            position.y_ = Sin(time_ * 90.0f + i * 10.0f);
+            node->SetPosition(position);
+        }
+    }
+}
+
+void ReplicationScenario::Stop()
+{
+    Network* network = GetSubsystem<Network>();
+    network->Disconnect();
+    network->StopServer();
+    UnsubscribeFromEvent(E_CLIENTCONNECTED);
+
+    clientScene_.Reset();
+    Scenario::Stop();
+}
+
+void ReplicationScenario::HandleClientConnected(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ClientConnected;
+
+    Connection* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    connection->SetScene(scene_);
+}
+#endif
@@ -0,0 +1,216 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+namespace Urho3D
+{
+
+class Drawable;
+class Node;
+class Scene;
+
+}
+
+using namespace Urho3D;
+
+/// Base class for a deterministic benchmark scenario. The scenario is driven with a fixed timestep by the Benchmark application.
+class Scenario : public Object
+{
+    OBJECT(Scenario);
+
+public:
+    /// Construct with name.
+    Scenario(Context* context, const String& name);
+    /// Destruct.
+    virtual ~Scenario();
+
+    /// Create the scene. Return false if the scenario can not be run.
+    virtual bool Start() = 0;
+    /// Perform the scenario's own work for a frame. Called before the scene update.
+    virtual void Update(float timeStep) {}
+    /// Release the scene and any other resources.
+    virtual void Stop();
+    /// Return whether the scenario is meaningful only when rendering.
+    virtual bool GetRequiresRendering() const { return false; }
+
+    /// Return name.
+    const String& GetName() const { return name_; }
+    /// Return the scene.
+    Scene* GetScene() const { return scene_; }
+
+protected:
+    /// Create the scene with an octree.
+    void CreateScene();
+    /// Create a camera and a light, and show the scene through the first viewport when rendering.
+    void SetupViewport(const Vector3& position, const Quaternion& rotation);
+    /// Create a grid of static box models.
+    void CreateBoxes(Node* parent, int size, float spacing);
+
+    /// Scenario name.
+    String name_;
+    /// Scene.
+    SharedPtr<Scene> scene_;
+    /// Camera scene node.
+    SharedPtr<Node> cameraNode_;
+};
+
+/// Render a large number of static objects with a rotating camera.
+class RenderingScenario : public Scenario
+{
+    OBJECT(RenderingScenario);
+
+public:
+    /// Construct.
+    RenderingScenario(Context* context);
+
+    /// Create the scene.
+    virtual bool Start();
+    /// Rotate the camera.
+    virtual void Update(float timeStep);
+    /// Return whether needs rendering.
+    virtual bool GetRequiresRendering() const { return true; }
+};
+
+/// Query the octree with several frustums each frame. Does not need rendering.
+class CullingScenario : public Scenario
+{
+    OBJECT(CullingScenario);
+
+public:
+    /// Construct.
+    CullingScenario(Context* context);
+
+    /// Create the scene.
+    virtual bool Start();
+    /// Perform the frustum queries.
+    virtual void Update(float timeStep);
+
+private:
+    /// Query result drawables.
+    PODVector<Drawable*> drawables_;
+    /// Camera rotation angle.
+    float yaw_;
+};
+
+#ifdef URHO3D_PHYSICS
+/// Simulate a large stack of rigid bodies falling on a floor.
+class PhysicsScenario : public Scenario
+{
+    OBJECT(PhysicsScenario);
+
+public:
+    /// Construct.
+    PhysicsScenario(Context* context);
+
+    /// Create the scene.
+    virtual bool Start();
+};
+#endif
+
+#ifdef URHO3D_NAVIGATION
+/// Move a crowd of agents on a navigation mesh between alternating targets.
+class NavigationScenario : public Scenario
+{
+    OBJECT(NavigationScenario);
+
+public:
+    /// Construct.
+    NavigationScenario(Context* context);
+
+    /// Create the scene and build the navigation mesh.
+    virtual bool Start();
+    /// Retarget the crowd periodically.
+    virtual void Update(float timeStep);
+
+private:
+    /// Frames since the last retarget.
+    unsigned frames_;
+    /// Current target index.
+    unsigned targetIndex_;
+};
+#endif
+
+/// Animate a grid of skinned characters.
+class SkinningScenario : public Scenario
+{
+    OBJECT(SkinningScenario);
+
+public:
+    /// Construct.
+    SkinningScenario(Context* context);
+
+    /// Create the scene.
+    virtual bool Start();
+};
+
+/// Reload a generated scene from binary data each frame.
+class SceneLoadScenario : public Scenario
+{
+    OBJECT(SceneLoadScenario);
+
+public:
+    /// Construct.
+    SceneLoadScenario(Context* context);
+
+    /// Create the scene and save it into memory.
+    virtual bool Start();
+    /// Load the scene again.
+    virtual void Update(float timeStep);
+    /// Release the scene and the saved data.
+    virtual void Stop();
+
+private:
+    /// Saved scene data.
+    VectorBuffer sceneData_;
+};
+
+#ifdef URHO3D_NETWORK
+/// Replicate moving objects from a server scene to a client scene over the loopback interface.
+class ReplicationScenario : public Scenario
+{
+    OBJECT(ReplicationScenario);
+
+public:
+    /// Construct.
+    ReplicationScenario(Context* context);
+
+    /// Create the scenes, start the server and connect to it.
+    virtual bool Start();
+    /// Move the replicated objects.
+    virtual void Update(float timeStep);
+    /// Disconnect, stop the server and release the scenes.
+    virtual void Stop();
+
+private:
+    /// Handle a client connecting to the server.
+    void HandleClientConnected(StringHash eventType, VariantMap& eventData);
+
+    /// Client scene.
+    SharedPtr<Scene> clientScene_;
+    /// Elapsed time.
+    float time_;
+};
+#endif
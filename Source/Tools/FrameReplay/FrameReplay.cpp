@@ -0,0 +1,326 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/FrameCapture.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "FrameReplay.h"
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+/// Default number of measured frames.
+static const unsigned DEFAULT_FRAMES = 600;
+/// Default number of frames to render before measuring.
+static const unsigned DEFAULT_WARMUP_FRAMES = 60;
+
+/// Timing statistics of a set of frames.
+struct FrameTimeStats
+{
+    /// Calculate from frame times. Sorts the frame times.
+    FrameTimeStats(PODVector<float>& times) :
+        average_(0.0f),
+        min_(0.0f),
+        max_(0.0f),
+        median_(0.0f)
+    {
+        if (times.Empty())
+            return;
+
+        for (unsigned i = 0; i < times.Size(); ++i)
+            average_ += times[i];
+        average_ /= times.Size();
+
+        Sort(times.Begin(), times.End());
+        min_ = times.Front();
+        max_ = times.Back();
+        median_ = times[times.Size() / 2];
+    }
+
+    /// Average time in milliseconds.
+    float average_;
+    /// Minimum time in milliseconds.
+    float min_;
+    /// Maximum time in milliseconds.
+    float max_;
+    /// Median time in milliseconds.
+    float median_;
+};
+
+DEFINE_APPLICATION_MAIN(FrameReplay);
+
+FrameReplay::FrameReplay(Context* context) :
+    Application(context),
+    frameNumber_(0),
+    numFrames_(DEFAULT_FRAMES),
+    numWarmupFrames_(DEFAULT_WARMUP_FRAMES),
+    numRenderedBatches_(0),
+    numRenderedPrimitives_(0),
+    gpuProfiling_(false),
+    windowSizeGiven_(false)
+{
+}
+
+void FrameReplay::Setup()
+{
+    const Vector<String>& arguments = GetArguments();
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+        if (argument == "-capture" && !value.Empty())
+        {
+            captureFileName_ = GetInternalPath(value);
+            ++i;
+        }
+        else if (argument == "-frames" && !value.Empty())
+        {
+            numFrames_ = (unsigned)Max(ToInt(value), 1);
+            ++i;
+        }
+        else if (argument == "-warmup" && !value.Empty())
+        {
+            numWarmupFrames_ = ToUInt(value);
+            ++i;
+        }
+        else if (argument == "-output" && !value.Empty())
+        {
+            outputFileName_ = GetInternalPath(value);
+            ++i;
+        }
+        else if (argument == "-gpu")
+            gpuProfiling_ = true;
+        else if (argument == "-help")
+        {
+            ErrorExit("Usage: FrameReplay -capture <file> [options]\n\n"
+                "Renders a frame captured with Renderer::CaptureFrame() repeatedly without the original scene logic and "
+                "reports its frame timings as JSON. The resources referenced by the capture have to be found from the "
+                "resource paths. The engine command line options also apply.\n\n"
+                "Options:\n"
+                "-capture <file> Frame capture file to replay\n"
+                "-frames <n>     Measured frames, default 600\n"
+                "-warmup <n>     Frames to render before measuring, default 60\n"
+                "-gpu            Measure GPU times of the render path commands with timer queries\n"
+                "-output <file>  Write the results to a file instead of the standard output\n"
+            );
+            return;
+        }
+    }
+
+    if (captureFileName_.Empty())
+    {
+        ErrorExit("Usage: FrameReplay -capture <file> [options]");
+        return;
+    }
+
+    // The capture is rendered at its own size unless the window size is given
+    windowSizeGiven_ = engineParameters_.Contains("WindowWidth") || engineParameters_.Contains("WindowHeight");
+    engineParameters_["FullScreen"] = false;
+    engineParameters_["FrameLimiter"] = false;
+    engineParameters_["VSync"] = false;
+    engineParameters_["Sound"] = false;
+    engineParameters_["LogName"] = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "logs") + "FrameReplay.log";
+}
+
+void FrameReplay::Start()
+{
+    if (engine_->IsHeadless())
+    {
+        ErrorExit("FrameReplay can not be run in headless mode");
+        return;
+    }
+
+    engine_->SetPauseMinimized(false);
+
+    File file(context_);
+    if (!file.Open(captureFileName_, FILE_READ))
+    {
+        ErrorExit("Could not open frame capture " + captureFileName_);
+        return;
+    }
+
+    capture_ = new FrameCapture(context_);
+    if (!capture_->Load(file))
+    {
+        ErrorExit("Could not load frame capture " + captureFileName_);
+        return;
+    }
+
+    Graphics* graphics = GetSubsystem<Graphics>();
+    const IntVector2& viewSize = capture_->GetViewSize();
+    if (!windowSizeGiven_ && viewSize.x_ > 0 && viewSize.y_ > 0)
+        graphics->SetMode(viewSize.x_, viewSize.y_);
+
+    if (gpuProfiling_)
+    {
+        graphics->SetGPUProfiling(true);
+        gpuProfiling_ = graphics->GetGPUProfiling();
+    }
+
+    SharedPtr<Viewport> viewport(new Viewport(context_, capture_->GetScene(), capture_->GetCamera()));
+    GetSubsystem<Renderer>()->SetViewport(0, viewport);
+
+    LOGINFOF("Replaying frame capture %s: %u drawables, %u batches", captureFileName_.CString(),
+        capture_->GetNumDrawables(), capture_->GetNumBatches());
+
+    SubscribeToEvent(E_BEGINFRAME, HANDLER(FrameReplay, HandleBeginFrame));
+    SubscribeToEvent(E_ENDFRAME, HANDLER(FrameReplay, HandleEndFrame));
+}
+
+void FrameReplay::Stop()
+{
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+        renderer->SetViewport(0, 0);
+    capture_.Reset();
+}
+
+void FrameReplay::RecordGPUTimes()
+{
+    // The results are read back a few frames late, and are absent when the queries were not yet complete
+    const Vector<GPUProfileBlock>& blocks = GetSubsystem<Graphics>()->GetGPUProfileResults();
+    if (blocks.Empty())
+        return;
+
+    float frameTime = 0.0f;
+    for (unsigned i = 0; i < blocks.Size(); ++i)
+    {
+        const GPUProfileBlock& block = blocks[i];
+        if (!block.depth_)
+            frameTime += block.time_;
+
+        unsigned index = (unsigned)(gpuBlockNames_.Find(block.name_) - gpuBlockNames_.Begin());
+        if (index >= gpuBlockNames_.Size())
+        {
+            gpuBlockNames_.Push(block.name_);
+            gpuBlockTimes_.Push(0.0f);
+            gpuBlockCounts_.Push(0);
+        }
+        gpuBlockTimes_[index] += block.time_;
+        ++gpuBlockCounts_[index];
+    }
+    gpuTimes_.Push(frameTime);
+}
+
+void FrameReplay::WriteResults()
+{
+    char line[256];
+    String output;
+
+    Graphics* graphics = GetSubsystem<Graphics>();
+    const IntVector2& viewSize = capture_->GetViewSize();
+    sprintf(line, "{\"capture\":\"%s\",\"api\":\"%s\",\"width\":%d,\"height\":%d,\"captureWidth\":%d,\"captureHeight\":%d,",
+        GetFileNameAndExtension(captureFileName_).CString(), graphics->GetApiName().CString(), graphics->GetWidth(),
+        graphics->GetHeight(), viewSize.x_, viewSize.y_);
+    output.Append(line);
+    sprintf(line, "\"drawables\":%u,\"batches\":%u,\"skippedBatches\":%u,\"renderedBatches\":%u,\"primitives\":%u,",
+        capture_->GetNumDrawables(), capture_->GetNumBatches(), capture_->GetNumSkippedBatches(), numRenderedBatches_,
+        numRenderedPrimitives_);
+    output.Append(line);
+
+    unsigned numFrames = frameTimes_.Size();
+    FrameTimeStats cpuStats(frameTimes_);
+    sprintf(line, "\"frames\":%u,\"warmupFrames\":%u,\"averageMs\":%.3f,\"minMs\":%.3f,\"maxMs\":%.3f,\"medianMs\":%.3f",
+        numFrames, numWarmupFrames_, cpuStats.average_, cpuStats.min_, cpuStats.max_, cpuStats.median_);
+    output.Append(line);
+
+    if (gpuProfiling_)
+    {
+        unsigned numGPUFrames = gpuTimes_.Size();
+        FrameTimeStats gpuStats(gpuTimes_);
+        sprintf(line, ",\"gpuFrames\":%u,\"gpuAverageMs\":%.3f,\"gpuMinMs\":%.3f,\"gpuMaxMs\":%.3f,\"gpuMedianMs\":%.3f,"
+            "\"gpuBlocks\":[", numGPUFrames, gpuStats.average_, gpuStats.min_, gpuStats.max_, gpuStats.median_);
+        output.Append(line);
+
+        for (unsigned i = 0; i < gpuBlockNames_.Size(); ++i)
+        {
+            sprintf(line, "%s\n{\"name\":\"%s\",\"averageMs\":%.3f}", i ? "," : "", gpuBlockNames_[i].CString(),
+                gpuBlockCounts_[i] ? gpuBlockTimes_[i] / gpuBlockCounts_[i] : 0.0f);
+            output.Append(line);
+        }
+        output.Append("\n]");
+    }
+    output.Append("}\n");
+
+    LOGINFOF("Frame capture %s: average %.3f ms, median %.3f ms, max %.3f ms", captureFileName_.CString(),
+        cpuStats.average_, cpuStats.median_, cpuStats.max_);
+
+    if (outputFileName_.Empty())
+    {
+        PrintUnicode(output);
+        return;
+    }
+
+    File file(context_);
+    if (!file.Open(outputFileName_, FILE_WRITE))
+    {
+        exitCode_ = EXIT_FAILURE;
+        return;
+    }
+    file.Write(output.CString(), output.Length());
+    LOGINFO("Wrote frame replay results to " + outputFileName_);
+}
+
+void FrameReplay::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    frameTimer_.Reset();
+}
+
+void FrameReplay::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    float frameTime = frameTimer_.GetUSec(false) / 1000.0f;
+    if (frameNumber_ >= numWarmupFrames_)
+    {
+        frameTimes_.Push(frameTime);
+        if (gpuProfiling_)
+            RecordGPUTimes();
+    }
+    ++frameNumber_;
+
+    Renderer* renderer = GetSubsystem<Renderer>();
+    numRenderedBatches_ = renderer->GetNumBatches();
+    numRenderedPrimitives_ = renderer->GetNumPrimitives();
+
+    if (frameTimes_.Size() >= numFrames_)
+    {
+        UnsubscribeFromAllEvents();
+        WriteResults();
+        engine_->Exit();
+    }
+}
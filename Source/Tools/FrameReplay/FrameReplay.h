@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Application.h>
+
+namespace Urho3D
+{
+
+class FrameCapture;
+
+}
+
+using namespace Urho3D;
+
+/// Frame replay application. Renders a captured frame repeatedly and reports its CPU and GPU frame timings as JSON.
+class FrameReplay : public Application
+{
+    OBJECT(FrameReplay);
+
+public:
+    /// Construct.
+    FrameReplay(Context* context);
+
+    /// Setup before engine initialization. Parse the replay options.
+    virtual void Setup();
+    /// Setup after engine initialization. Load the capture and create the viewport.
+    virtual void Start();
+    /// Cleanup after the main loop. Release the replay scene.
+    virtual void Stop();
+
+private:
+    /// Accumulate the GPU times of the profiling blocks read back on this frame.
+    void RecordGPUTimes();
+    /// Write the results as JSON to the output file or to the standard output.
+    void WriteResults();
+    /// Handle frame begin. Start the frame timer.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Handle frame end. Record the frame time and exit when all frames have been measured.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+
+    /// Loaded frame capture.
+    SharedPtr<FrameCapture> capture_;
+    /// Capture file name.
+    String captureFileName_;
+    /// Result output file name, or empty to print to the standard output.
+    String outputFileName_;
+    /// CPU frame times in milliseconds.
+    PODVector<float> frameTimes_;
+    /// Total GPU times of the frames in milliseconds.
+    PODVector<float> gpuTimes_;
+    /// GPU profiling block names.
+    Vector<String> gpuBlockNames_;
+    /// Accumulated GPU times of the profiling blocks in milliseconds.
+    PODVector<float> gpuBlockTimes_;
+    /// Number of measurements of the profiling blocks.
+    PODVector<unsigned> gpuBlockCounts_;
+    /// Frame timer.
+    HiresTimer frameTimer_;
+    /// Frame number.
+    unsigned frameNumber_;
+    /// Number of measured frames.
+    unsigned numFrames_;
+    /// Number of frames to render before measuring.
+    unsigned numWarmupFrames_;
+    /// Number of batches rendered on the last frame.
+    unsigned numRenderedBatches_;
+    /// Number of primitives rendered on the last frame.
+    unsigned numRenderedPrimitives_;
+    /// GPU profiling flag.
+    bool gpuProfiling_;
+    /// Whether the window size was given on the command line.
+    bool windowSizeGiven_;
+};
@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+static const char* levelPrefixes[] =
+{
+    "DEBUG",
+    "INFO",
+    "WARNING",
+    "ERROR"
+};
+
+SharedPtr<Context> context_(new Context());
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+        ErrorExit("Usage: LogDecoder <input binary log file> [output text file] [minimum level]\n\n"
+            "Decodes a binary log of structured messages to text. Minimum level is 0 (debug) to 3 (error) and\n"
+            "defaults to 0.\n");
+    
+    File source(context_);
+    if (!source.Open(arguments[0]))
+        ErrorExit("Could not open input file " + arguments[0]);
+    if (source.ReadFileID() != "ULOG")
+        ErrorExit(arguments[0] + " is not a binary log file");
+    
+    File dest(context_);
+    bool toFile = arguments.Size() > 1 && arguments[1] != "-";
+    if (toFile && !dest.Open(arguments[1], FILE_WRITE))
+        ErrorExit("Could not open output file " + arguments[1]);
+    
+    int minLevel = arguments.Size() > 2 ? ToInt(arguments[2]) : LOG_DEBUG;
+    
+    String header = "Binary log opened " + source.ReadString();
+    if (toFile)
+        dest.WriteLine(header);
+    else
+        PrintLine(header);
+    
+    HashMap<StringHash, String> formats;
+    VariantVector messageArguments;
+    unsigned numMessages = 0;
+    
+    while (!source.IsEof())
+    {
+        unsigned char type = source.ReadUByte();
+        if (type == BINARYLOG_FORMAT)
+        {
+            StringHash formatHash = source.ReadStringHash();
+            formats[formatHash] = source.ReadString();
+        }
+        else if (type == BINARYLOG_MESSAGE)
+        {
+            unsigned time = source.ReadUInt();
+            int level = source.ReadUByte();
+            StringHash formatHash = source.ReadStringHash();
+            messageArguments.Resize(source.ReadVLE());
+            for (unsigned i = 0; i < messageArguments.Size(); ++i)
+                messageArguments[i] = source.ReadVariant();
+            
+            if (level < minLevel)
+                continue;
+            
+            HashMap<StringHash, String>::ConstIterator i = formats.Find(formatHash);
+            String message = i != formats.End() ? Log::FormatStructured(i->second_, messageArguments) : "Unknown format " +
+                formatHash.ToString();
+            String line = ToString("[%u.%03u] ", time / 1000, time % 1000) + (level >= LOG_DEBUG && level < LOG_NONE ?
+                levelPrefixes[level] : "UNKNOWN") + ": " + message;
+            
+            if (toFile)
+                dest.WriteLine(line);
+            else
+                PrintLine(line);
+            ++numMessages;
+        }
+        else
+        {
+            // A truncated record at the end is expected if the application did not close the log
+            PrintLine("Stopped at corrupt or truncated record", true);
+            break;
+        }
+    }
+    
+    if (toFile)
+        PrintLine("Decoded " + String(numMessages) + " messages to " + arguments[1]);
+}
@@ -0,0 +1,375 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <Urho3D/Revision.h>
+
+#include "MicroBenchmark.h"
+
+#include <cmath>
+#include <cstdio>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+/// Default number of measured samples per benchmark.
+static const unsigned DEFAULT_SAMPLES = 15;
+/// Default number of samples to run before measuring.
+static const unsigned DEFAULT_WARMUP_SAMPLES = 2;
+/// Default duration of one sample in milliseconds.
+static const unsigned DEFAULT_SAMPLE_TIME = 20;
+/// Maximum number of iterations in one sample.
+static const unsigned MAX_ITERATIONS = 0x40000000;
+/// Random seed used for every benchmark so that the input data is the same on each run.
+static const unsigned RANDOM_SEED = 1;
+/// Smallest change in the median that is reported when comparing.
+static const float MIN_SIGNIFICANT_CHANGE = 0.02f;
+
+/// Result of one benchmark.
+struct MicroBenchmarkResult
+{
+    /// Benchmark name.
+    String name_;
+    /// Iterations per sample.
+    unsigned iterations_;
+    /// Time per operation of each sample in nanoseconds, sorted.
+    PODVector<double> samples_;
+    /// Fastest sample.
+    double min_;
+    /// Median sample.
+    double median_;
+    /// Mean of the samples.
+    double mean_;
+    /// Standard deviation of the samples.
+    double stdDev_;
+    /// Median absolute deviation of the samples.
+    double mad_;
+};
+
+SharedPtr<Context> context_(new Context());
+unsigned numSamples_ = DEFAULT_SAMPLES;
+unsigned numWarmupSamples_ = DEFAULT_WARMUP_SAMPLES;
+long long sampleTime_ = DEFAULT_SAMPLE_TIME * 1000;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+bool MatchesFilter(const String& name, const Vector<String>& filters);
+MicroBenchmarkResult RunBenchmark(MicroBenchmark* benchmark);
+long long MeasureSample(MicroBenchmark* benchmark, unsigned iterations);
+double GetMedian(const PODVector<double>& sortedValues);
+String FormatResults(const Vector<MicroBenchmarkResult>& results);
+void PrintResults(const Vector<MicroBenchmarkResult>& results, const String& baselineFileName);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    Vector<String> filters;
+    String outputFileName;
+    String baselineFileName;
+    bool listOnly = false;
+
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+        if (argument == "-filter" && !value.Empty())
+        {
+            filters = value.ToLower().Split(',');
+            ++i;
+        }
+        else if (argument == "-samples" && !value.Empty())
+        {
+            numSamples_ = (unsigned)Max(ToInt(value), 1);
+            ++i;
+        }
+        else if (argument == "-warmup" && !value.Empty())
+        {
+            numWarmupSamples_ = ToUInt(value);
+            ++i;
+        }
+        else if (argument == "-time" && !value.Empty())
+        {
+            sampleTime_ = Max(ToInt(value), 1) * 1000;
+            ++i;
+        }
+        else if (argument == "-output" && !value.Empty())
+        {
+            outputFileName = GetInternalPath(value);
+            ++i;
+        }
+        else if (argument == "-compare" && !value.Empty())
+        {
+            baselineFileName = GetInternalPath(value);
+            ++i;
+        }
+        else if (argument == "-list")
+            listOnly = true;
+        else
+        {
+            ErrorExit("Usage: MicroBenchmark [options]\n\n"
+                "Measures the time per operation of the container, math, variant, serialization and string hash primitives.\n"
+                "Each benchmark runs with the same input data on every run. The number of iterations in a sample is calibrated\n"
+                "to the sample time, and the median of the samples and its median absolute deviation are reported. The results\n"
+                "are written as JSON to the standard output, unless an output file or a baseline to compare with is given.\n\n"
+                "Options:\n"
+                "-filter <list>   Comma-separated parts of names of benchmarks to run, default all\n"
+                "-samples <n>     Measured samples per benchmark, default 15\n"
+                "-warmup <n>      Samples to run before measuring, default 2\n"
+                "-time <ms>       Duration of one sample, default 20\n"
+                "-output <file>   Write the results to a file and print a summary\n"
+                "-compare <file>  Compare with the results of an earlier run and print the changes\n"
+                "-list            List the benchmarks without running them\n"
+            );
+        }
+    }
+
+    Vector<SharedPtr<MicroBenchmark> > benchmarks;
+    CreateMicroBenchmarks(benchmarks);
+
+    Vector<MicroBenchmarkResult> results;
+    for (unsigned i = 0; i < benchmarks.Size(); ++i)
+    {
+        MicroBenchmark* benchmark = benchmarks[i];
+        if (!MatchesFilter(benchmark->GetName(), filters))
+            continue;
+
+        if (listOnly)
+        {
+            PrintLine(benchmark->GetName());
+            continue;
+        }
+
+        SetRandomSeed(RANDOM_SEED);
+        benchmark->Setup();
+        results.Push(RunBenchmark(benchmark));
+        benchmark->Teardown();
+    }
+
+    if (listOnly)
+        return;
+    if (results.Empty())
+        ErrorExit("No benchmarks to run");
+
+    String output = FormatResults(results);
+    if (outputFileName.Empty() && baselineFileName.Empty())
+    {
+        PrintUnicode(output);
+        return;
+    }
+
+    if (!outputFileName.Empty())
+    {
+        File file(context_);
+        if (!file.Open(outputFileName, FILE_WRITE))
+            ErrorExit("Could not open output file " + outputFileName);
+        file.Write(output.CString(), output.Length());
+    }
+
+    PrintResults(results, baselineFileName);
+}
+
+bool MatchesFilter(const String& name, const Vector<String>& filters)
+{
+    if (filters.Empty())
+        return true;
+
+    String lowerName = name.ToLower();
+    for (unsigned i = 0; i < filters.Size(); ++i)
+    {
+        if (lowerName.Contains(filters[i].Trimmed()))
+            return true;
+    }
+    return false;
+}
+
+MicroBenchmarkResult RunBenchmark(MicroBenchmark* benchmark)
+{
+    MicroBenchmarkResult result;
+    result.name_ = benchmark->GetName();
+
+    // Grow the iteration count until one sample lasts at least the sample time, so that the timer resolution does not matter
+    unsigned iterations = 1;
+    for (;;)
+    {
+        long long time = MeasureSample(benchmark, iterations);
+        if (time >= sampleTime_ || iterations >= MAX_ITERATIONS)
+            break;
+
+        double scale = time > 0 ? 1.2 * (double)sampleTime_ / (double)time : 10.0;
+        if (scale > 10.0)
+            scale = 10.0;
+        double newIterations = ceil(iterations * scale);
+        iterations = newIterations < (double)MAX_ITERATIONS ? (unsigned)newIterations : MAX_ITERATIONS;
+    }
+    result.iterations_ = iterations;
+
+    for (unsigned i = 0; i < numWarmupSamples_; ++i)
+        MeasureSample(benchmark, iterations);
+
+    double operations = (double)iterations * benchmark->GetOperationsPerIteration();
+    for (unsigned i = 0; i < numSamples_; ++i)
+        result.samples_.Push(MeasureSample(benchmark, iterations) * 1000.0 / operations);
+
+    Sort(result.samples_.Begin(), result.samples_.End());
+    result.min_ = result.samples_.Front();
+    result.median_ = GetMedian(result.samples_);
+
+    double sum = 0.0;
+    for (unsigned i = 0; i < result.samples_.Size(); ++i)
+        sum += result.samples_[i];
+    result.mean_ = sum / result.samples_.Size();
+
+    double squareSum = 0.0;
+    PODVector<double> deviations(result.samples_.Size());
+    for (unsigned i = 0; i < result.samples_.Size(); ++i)
+    {
+        squareSum += (result.samples_[i] - result.mean_) * (result.samples_[i] - result.mean_);
+        deviations[i] = fabs(result.samples_[i] - result.median_);
+    }
+    result.stdDev_ = result.samples_.Size() > 1 ? sqrt(squareSum / (result.samples_.Size() - 1)) : 0.0;
+    Sort(deviations.Begin(), deviations.End());
+    result.mad_ = GetMedian(deviations);
+
+    return result;
+}
+
+long long MeasureSample(MicroBenchmark* benchmark, unsigned iterations)
+{
+    HiresTimer timer;
+    benchmark->Run(iterations);
+    return timer.GetUSec(false);
+}
+
+double GetMedian(const PODVector<double>& sortedValues)
+{
+    unsigned size = sortedValues.Size();
+    if (!size)
+        return 0.0;
+    return size & 1 ? sortedValues[size / 2] : 0.5 * (sortedValues[size / 2 - 1] + sortedValues[size / 2]);
+}
+
+String FormatResults(const Vector<MicroBenchmarkResult>& results)
+{
+    char line[256];
+    String output;
+
+    #ifdef _DEBUG
+    const char* buildType = "Debug";
+    #else
+    const char* buildType = "Release";
+    #endif
+
+    sprintf(line, "{\"platform\":\"%s\",\"revision\":\"%s\",\"build\":\"%s\",\"bits\":%u,\"cpus\":%u,\"samples\":%u,"
+        "\"warmupSamples\":%u,\"sampleMs\":%u,\"benchmarks\":[", GetPlatform().CString(), GetRevision(), buildType,
+        (unsigned)sizeof(void*) * 8, GetNumLogicalCPUs(), numSamples_, numWarmupSamples_, (unsigned)(sampleTime_ / 1000));
+    output.Append(line);
+
+    for (unsigned i = 0; i < results.Size(); ++i)
+    {
+        const MicroBenchmarkResult& result = results[i];
+        sprintf(line, "%s\n{\"name\":\"%s\",\"iterations\":%u,\"minNs\":%.4f,\"medianNs\":%.4f,\"meanNs\":%.4f,"
+            "\"stdDevNs\":%.4f,\"madNs\":%.4f}", i ? "," : "", result.name_.CString(), result.iterations_, result.min_,
+            result.median_, result.mean_, result.stdDev_, result.mad_);
+        output.Append(line);
+    }
+    output.Append("\n]}\n");
+
+    return output;
+}
+
+void PrintResults(const Vector<MicroBenchmarkResult>& results, const String& baselineFileName)
+{
+    HashMap<String, Pair<float, float> > baseline;
+    if (!baselineFileName.Empty())
+    {
+        File file(context_);
+        if (!file.Open(baselineFileName))
+            ErrorExit("Could not open baseline file " + baselineFileName);
+        SharedPtr<JSONFile> json(new JSONFile(context_));
+        if (!json->Load(file))
+            ErrorExit("Could not parse baseline file " + baselineFileName);
+
+        JSONValue benchmarks = json->GetRoot().GetChild("benchmarks", JSON_ARRAY);
+        for (unsigned i = 0; i < benchmarks.GetSize(); ++i)
+        {
+            JSONValue benchmark = benchmarks.GetChild(i);
+            baseline[benchmark.GetString("name")] = MakePair(benchmark.GetFloat("medianNs"), benchmark.GetFloat("madNs"));
+        }
+    }
+
+    char line[256];
+    sprintf(line, "%-28s %12s %10s %12s", "Benchmark", "Median ns", "MAD %", baseline.Empty() ? "" : "Change %");
+    PrintLine(line);
+
+    for (unsigned i = 0; i < results.Size(); ++i)
+    {
+        const MicroBenchmarkResult& result = results[i];
+        float relativeMad = result.median_ > 0.0 ? (float)(100.0 * result.mad_ / result.median_) : 0.0f;
+        HashMap<String, Pair<float, float> >::ConstIterator j = baseline.Find(result.name_);
+
+        if (j == baseline.End() || j->second_.first_ <= 0.0f)
+        {
+            sprintf(line, "%-28s %12.3f %10.2f", result.name_.CString(), result.median_, relativeMad);
+            PrintLine(line);
+            continue;
+        }
+
+        // Report a change only when it exceeds the noise of both runs, estimated from their median absolute deviations
+        float oldMedian = j->second_.first_;
+        float change = ((float)result.median_ - oldMedian) / oldMedian;
+        float noise = Max(relativeMad * 0.01f, j->second_.second_ / oldMedian);
+        const char* verdict = "";
+        if (Abs(change) > Max(MIN_SIGNIFICANT_CHANGE, 3.0f * noise))
+            verdict = change < 0.0f ? "faster" : "slower";
+
+        sprintf(line, "%-28s %12.3f %10.2f %+12.2f %s", result.name_.CString(), result.median_, relativeMad, change * 100.0f,
+            verdict);
+        PrintLine(line);
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Container/Str.h>
+
+using namespace Urho3D;
+
+/// Base class for a microbenchmark. Run() repeats the measured operation and is timed by the MicroBenchmark tool.
+class MicroBenchmark : public RefCounted
+{
+public:
+    /// Construct with name and the number of operations performed by one iteration.
+    MicroBenchmark(const String& name, unsigned operationsPerIteration = 1) :
+        name_(name),
+        operationsPerIteration_(operationsPerIteration)
+    {
+    }
+    /// Destruct.
+    virtual ~MicroBenchmark() {}
+
+    /// Create the input data. Not timed.
+    virtual void Setup() {}
+    /// Perform the measured operation the given number of times.
+    virtual void Run(unsigned iterations) = 0;
+    /// Release the input data. Not timed.
+    virtual void Teardown() {}
+
+    /// Return name.
+    const String& GetName() const { return name_; }
+    /// Return the number of operations performed by one iteration.
+    unsigned GetOperationsPerIteration() const { return operationsPerIteration_; }
+
+private:
+    /// Name, in the form Group/Operation.
+    String name_;
+    /// Operations per iteration.
+    unsigned operationsPerIteration_;
+};
+
+/// Accumulator for benchmark results, so that the compiler can not remove the measured work.
+extern volatile unsigned benchmarkSink;
+
+/// Create all microbenchmarks.
+void CreateMicroBenchmarks(Vector<SharedPtr<MicroBenchmark> >& benchmarks);
@@ -0,0 +1,944 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Variant.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Math/Frustum.h>
+#include <Urho3D/Math/Matrix4.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Math/StringHash.h>
+
+#include "MicroBenchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+volatile unsigned benchmarkSink = 0;
+
+/// Number of elements in the container benchmarks.
+static const unsigned NUM_ELEMENTS = 1000;
+/// Number of bounding volumes tested against the frustum.
+static const unsigned NUM_VOLUMES = 1000;
+
+/// Return a random unsigned value that uses the full 32 bits.
+static unsigned RandomUInt()
+{
+    return ((unsigned)Rand() << 17) ^ ((unsigned)Rand() << 2) ^ (unsigned)Rand();
+}
+
+/// Return a random string of the given length.
+static String RandomString(unsigned length)
+{
+    String ret;
+    ret.Resize(length);
+    for (unsigned i = 0; i < length; ++i)
+        ret[i] = (char)('a' + Rand() % 26);
+    return ret;
+}
+
+/// Return a random transform.
+static Matrix3x4 RandomTransform()
+{
+    return Matrix3x4(Vector3(Random(-100.0f, 100.0f), Random(-100.0f, 100.0f), Random(-100.0f, 100.0f)),
+        Quaternion(Random(360.0f), Random(360.0f), Random(360.0f)), Vector3(Random(0.5f, 2.0f), Random(0.5f, 2.0f),
+        Random(0.5f, 2.0f)));
+}
+
+/// Push integers to a PODVector.
+class PODVectorPushBenchmark : public MicroBenchmark
+{
+public:
+    PODVectorPushBenchmark() : MicroBenchmark("PODVector/Push", NUM_ELEMENTS) {}
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            PODVector<unsigned> vector;
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                vector.Push(j);
+            benchmarkSink += vector.Back();
+        }
+    }
+};
+
+/// Push strings to a Vector.
+class VectorPushBenchmark : public MicroBenchmark
+{
+public:
+    VectorPushBenchmark() : MicroBenchmark("Vector/PushString", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        value_ = RandomString(24);
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            Vector<String> vector;
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                vector.Push(value_);
+            benchmarkSink += vector.Size();
+        }
+    }
+
+private:
+    String value_;
+};
+
+/// Iterate over a PODVector and sum the elements.
+class PODVectorIterateBenchmark : public MicroBenchmark
+{
+public:
+    PODVectorIterateBenchmark() : MicroBenchmark("PODVector/Iterate", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        vector_.Resize(NUM_ELEMENTS);
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            vector_[i] = RandomUInt();
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        unsigned sum = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (PODVector<unsigned>::ConstIterator j = vector_.Begin(); j != vector_.End(); ++j)
+                sum += *j;
+        }
+        benchmarkSink += sum;
+    }
+
+    virtual void Teardown()
+    {
+        vector_.Clear();
+    }
+
+private:
+    PODVector<unsigned> vector_;
+};
+
+/// Erase elements from the front of a Vector of strings.
+class VectorEraseBenchmark : public MicroBenchmark
+{
+public:
+    VectorEraseBenchmark() : MicroBenchmark("Vector/EraseFront", NUM_ELEMENTS / 10) {}
+
+    virtual void Setup()
+    {
+        source_.Resize(NUM_ELEMENTS);
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            source_[i] = RandomString(16);
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            Vector<String> vector = source_;
+            for (unsigned j = 0; j < NUM_ELEMENTS / 10; ++j)
+                vector.Erase(0);
+            benchmarkSink += vector.Size();
+        }
+    }
+
+    virtual void Teardown()
+    {
+        source_.Clear();
+    }
+
+private:
+    Vector<String> source_;
+};
+
+/// Insert integer keys to a HashMap.
+class HashMapInsertBenchmark : public MicroBenchmark
+{
+public:
+    HashMapInsertBenchmark() : MicroBenchmark("HashMap/Insert", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        keys_.Resize(NUM_ELEMENTS);
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            keys_[i] = RandomUInt();
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            HashMap<unsigned, unsigned> map;
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                map[keys_[j]] = j;
+            benchmarkSink += map.Size();
+        }
+    }
+
+    virtual void Teardown()
+    {
+        keys_.Clear();
+    }
+
+private:
+    PODVector<unsigned> keys_;
+};
+
+/// Find StringHash keys from a HashMap.
+class HashMapFindBenchmark : public MicroBenchmark
+{
+public:
+    HashMapFindBenchmark() : MicroBenchmark("HashMap/FindStringHash", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            StringHash key(RandomString(12));
+            map_[key] = i;
+            // Look up every other key that is not in the map
+            keys_.Push(i & 1 ? StringHash(RandomString(12)) : key);
+        }
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        unsigned found = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+            {
+                if (map_.Find(keys_[j]) != map_.End())
+                    ++found;
+            }
+        }
+        benchmarkSink += found;
+    }
+
+    virtual void Teardown()
+    {
+        map_.Clear();
+        keys_.Clear();
+    }
+
+private:
+    HashMap<StringHash, unsigned> map_;
+    PODVector<StringHash> keys_;
+};
+
+/// Find string keys from a HashMap.
+class HashMapFindStringBenchmark : public MicroBenchmark
+{
+public:
+    HashMapFindStringBenchmark() : MicroBenchmark("HashMap/FindString", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            String key = RandomString(12);
+            map_[key] = i;
+            keys_.Push(i & 1 ? RandomString(12) : key);
+        }
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        unsigned found = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+            {
+                if (map_.Find(keys_[j]) != map_.End())
+                    ++found;
+            }
+        }
+        benchmarkSink += found;
+    }
+
+    virtual void Teardown()
+    {
+        map_.Clear();
+        keys_.Clear();
+    }
+
+private:
+    HashMap<String, unsigned> map_;
+    Vector<String> keys_;
+};
+
+/// Assign C strings of varying length to a String, which reuses its allocation when possible.
+class StringAssignBenchmark : public MicroBenchmark
+{
+public:
+    StringAssignBenchmark() : MicroBenchmark("String/Assign", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            values_.Push(RandomString(8 + i % 24));
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        String str;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                str = values_[j].CString();
+        }
+        benchmarkSink += str.Length();
+    }
+
+    virtual void Teardown()
+    {
+        values_.Clear();
+    }
+
+private:
+    Vector<String> values_;
+};
+
+/// Build a string by appending.
+class StringAppendBenchmark : public MicroBenchmark
+{
+public:
+    StringAppendBenchmark() : MicroBenchmark("String/Append", NUM_ELEMENTS) {}
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            String str;
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+            {
+                str += "Node";
+                str += j;
+            }
+            benchmarkSink += str.Length();
+        }
+    }
+};
+
+/// Compare strings with a common prefix.
+class StringCompareBenchmark : public MicroBenchmark
+{
+public:
+    StringCompareBenchmark() : MicroBenchmark("String/Compare", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        String prefix = RandomString(16);
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            values_.Push(prefix + RandomString(4));
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        unsigned less = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 1; j < NUM_ELEMENTS; ++j)
+            {
+                if (values_[j - 1] < values_[j])
+                    ++less;
+            }
+            if (values_.Back() == values_.Front())
+                ++less;
+        }
+        benchmarkSink += less;
+    }
+
+    virtual void Teardown()
+    {
+        values_.Clear();
+    }
+
+private:
+    Vector<String> values_;
+};
+
+/// Sort random integers. Each iteration includes copying the unsorted input.
+class SortIntBenchmark : public MicroBenchmark
+{
+public:
+    SortIntBenchmark() : MicroBenchmark("Sort/Int", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        source_.Resize(NUM_ELEMENTS);
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            source_[i] = RandomUInt();
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            work_ = source_;
+            Sort(work_.Begin(), work_.End());
+            benchmarkSink += work_.Front();
+        }
+    }
+
+    virtual void Teardown()
+    {
+        source_.Clear();
+        work_.Clear();
+    }
+
+private:
+    PODVector<unsigned> source_;
+    PODVector<unsigned> work_;
+};
+
+/// Sort random strings. Each iteration includes copying the unsorted input.
+class SortStringBenchmark : public MicroBenchmark
+{
+public:
+    SortStringBenchmark() : MicroBenchmark("Sort/String", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        source_.Resize(NUM_ELEMENTS);
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            source_[i] = RandomString(12);
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            work_ = source_;
+            Sort(work_.Begin(), work_.End());
+            benchmarkSink += work_.Front().Length();
+        }
+    }
+
+    virtual void Teardown()
+    {
+        source_.Clear();
+        work_.Clear();
+    }
+
+private:
+    Vector<String> source_;
+    Vector<String> work_;
+};
+
+/// Multiply a chain of Matrix3x4 transforms, as when updating a scene hierarchy.
+class Matrix3x4MultiplyBenchmark : public MicroBenchmark
+{
+public:
+    Matrix3x4MultiplyBenchmark() : MicroBenchmark("Matrix3x4/Multiply", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            matrices_.Push(RandomTransform());
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        Matrix3x4 result;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            result = Matrix3x4::IDENTITY;
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                result = matrices_[j] * result;
+        }
+        benchmarkSink += (unsigned)result.m03_;
+    }
+
+    virtual void Teardown()
+    {
+        matrices_.Clear();
+    }
+
+private:
+    PODVector<Matrix3x4> matrices_;
+};
+
+/// Multiply Matrix4 view-projection by Matrix3x4 world transforms.
+class Matrix4MultiplyBenchmark : public MicroBenchmark
+{
+public:
+    Matrix4MultiplyBenchmark() : MicroBenchmark("Matrix4/Multiply", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        // Perspective projection with a 60 degree vertical field of view and near clip distance 0.1
+        Matrix4 projection(0.974f, 0.0f, 0.0f, 0.0f, 0.0f, 1.732f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -0.1f, 0.0f, 0.0f, 1.0f, 0.0f);
+        viewProj_ = projection * RandomTransform().Inverse().ToMatrix4();
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            matrices_.Push(RandomTransform());
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        float sum = 0.0f;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                sum += (viewProj_ * matrices_[j]).m33_;
+        }
+        benchmarkSink += (unsigned)sum;
+    }
+
+    virtual void Teardown()
+    {
+        matrices_.Clear();
+    }
+
+private:
+    Matrix4 viewProj_;
+    PODVector<Matrix3x4> matrices_;
+};
+
+/// Invert Matrix3x4 transforms.
+class Matrix3x4InverseBenchmark : public MicroBenchmark
+{
+public:
+    Matrix3x4InverseBenchmark() : MicroBenchmark("Matrix3x4/Inverse", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            matrices_.Push(RandomTransform());
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        float sum = 0.0f;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                sum += matrices_[j].Inverse().m03_;
+        }
+        benchmarkSink += (unsigned)sum;
+    }
+
+    virtual void Teardown()
+    {
+        matrices_.Clear();
+    }
+
+private:
+    PODVector<Matrix3x4> matrices_;
+};
+
+/// Invert general Matrix4 matrices.
+class Matrix4InverseBenchmark : public MicroBenchmark
+{
+public:
+    Matrix4InverseBenchmark() : MicroBenchmark("Matrix4/Inverse", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            matrices_.Push(RandomTransform().ToMatrix4());
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        float sum = 0.0f;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                sum += matrices_[j].Inverse().m03_;
+        }
+        benchmarkSink += (unsigned)sum;
+    }
+
+    virtual void Teardown()
+    {
+        matrices_.Clear();
+    }
+
+private:
+    PODVector<Matrix4> matrices_;
+};
+
+/// Transform points with a Matrix3x4.
+class Matrix3x4TransformBenchmark : public MicroBenchmark
+{
+public:
+    Matrix3x4TransformBenchmark() : MicroBenchmark("Matrix3x4/TransformPoint", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        transform_ = RandomTransform();
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            points_.Push(Vector3(Random(-100.0f, 100.0f), Random(-100.0f, 100.0f), Random(-100.0f, 100.0f)));
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        Vector3 sum(Vector3::ZERO);
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                sum += transform_ * points_[j];
+        }
+        benchmarkSink += (unsigned)sum.x_;
+    }
+
+    virtual void Teardown()
+    {
+        points_.Clear();
+    }
+
+private:
+    Matrix3x4 transform_;
+    PODVector<Vector3> points_;
+};
+
+/// Define frustums from a perspective projection.
+class FrustumDefineBenchmark : public MicroBenchmark
+{
+public:
+    FrustumDefineBenchmark() : MicroBenchmark("Frustum/Define", NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            transforms_.Push(RandomTransform());
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        Frustum frustum;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                frustum.Define(60.0f, 16.0f / 9.0f, 1.0f, 0.1f, 1000.0f, transforms_[j]);
+        }
+        benchmarkSink += (unsigned)frustum.vertices_[0].x_;
+    }
+
+    virtual void Teardown()
+    {
+        transforms_.Clear();
+    }
+
+private:
+    PODVector<Matrix3x4> transforms_;
+};
+
+/// Test bounding boxes or spheres against a frustum, as in view culling.
+class FrustumTestBenchmark : public MicroBenchmark
+{
+public:
+    FrustumTestBenchmark(const String& name, bool testSpheres, bool fast) :
+        MicroBenchmark(name, NUM_VOLUMES),
+        testSpheres_(testSpheres),
+        fast_(fast)
+    {
+    }
+
+    virtual void Setup()
+    {
+        frustum_.Define(60.0f, 16.0f / 9.0f, 1.0f, 0.1f, 500.0f, Matrix3x4(Vector3(0.0f, 0.0f, -250.0f), Quaternion::IDENTITY,
+            1.0f));
+        for (unsigned i = 0; i < NUM_VOLUMES; ++i)
+        {
+            // Place a part of the volumes outside the frustum and some on the planes
+            Vector3 center(Random(-400.0f, 400.0f), Random(-250.0f, 250.0f), Random(-300.0f, 300.0f));
+            float size = Random(1.0f, 20.0f);
+            boxes_.Push(BoundingBox(center - Vector3::ONE * size, center + Vector3::ONE * size));
+            spheres_.Push(Sphere(center, size));
+        }
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        unsigned inside = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_VOLUMES; ++j)
+            {
+                Intersection result;
+                if (testSpheres_)
+                    result = fast_ ? frustum_.IsInsideFast(spheres_[j]) : frustum_.IsInside(spheres_[j]);
+                else
+                    result = fast_ ? frustum_.IsInsideFast(boxes_[j]) : frustum_.IsInside(boxes_[j]);
+                if (result != OUTSIDE)
+                    ++inside;
+            }
+        }
+        benchmarkSink += inside;
+    }
+
+    virtual void Teardown()
+    {
+        boxes_.Clear();
+        spheres_.Clear();
+    }
+
+private:
+    Frustum frustum_;
+    PODVector<BoundingBox> boxes_;
+    PODVector<Sphere> spheres_;
+    bool testSpheres_;
+    bool fast_;
+};
+
+/// Assign values of different types to a Variant and compare them.
+class VariantAssignBenchmark : public MicroBenchmark
+{
+public:
+    VariantAssignBenchmark() : MicroBenchmark("Variant/AssignCompare", 4 * NUM_ELEMENTS) {}
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+        {
+            ints_.Push(RandomUInt());
+            vectors_.Push(Vector3(Random(), Random(), Random()));
+            strings_.Push(RandomString(8 + i % 16));
+        }
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        Variant value;
+        unsigned equal = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+            {
+                // Change the type on every assignment, which is the slow path
+                value = (int)ints_[j];
+                equal += value == (int)ints_[j] ? 1 : 0;
+                value = vectors_[j];
+                equal += value == vectors_[j] ? 1 : 0;
+                value = strings_[j];
+                equal += value == strings_[j] ? 1 : 0;
+                value = (float)j;
+                equal += value.GetFloat() > 0.0f ? 1 : 0;
+            }
+        }
+        benchmarkSink += equal;
+    }
+
+    virtual void Teardown()
+    {
+        ints_.Clear();
+        vectors_.Clear();
+        strings_.Clear();
+    }
+
+private:
+    PODVector<unsigned> ints_;
+    PODVector<Vector3> vectors_;
+    Vector<String> strings_;
+};
+
+/// Copy a VariantMap such as an event's parameters.
+class VariantMapCopyBenchmark : public MicroBenchmark
+{
+public:
+    VariantMapCopyBenchmark() : MicroBenchmark("VariantMap/Copy") {}
+
+    virtual void Setup()
+    {
+        CreateVariantMap(map_);
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            VariantMap copy = map_;
+            benchmarkSink += copy.Size();
+        }
+    }
+
+    virtual void Teardown()
+    {
+        map_.Clear();
+    }
+
+    /// Fill a VariantMap with a mix of value types.
+    static void CreateVariantMap(VariantMap& map)
+    {
+        map["Node"] = RandomUInt();
+        map["Position"] = Vector3(Random(), Random(), Random());
+        map["Rotation"] = Quaternion(Random(360.0f), Vector3::UP);
+        map["Scale"] = Vector3::ONE;
+        map["Name"] = RandomString(16);
+        map["Enabled"] = true;
+        map["TimeStep"] = Random();
+        map["Color"] = Color(Random(), Random(), Random());
+        map["Transform"] = RandomTransform();
+        map["Tags"] = RandomString(32);
+        map["Buttons"] = (int)RandomUInt();
+        map["Qualifiers"] = (int)RandomUInt();
+    }
+
+private:
+    VariantMap map_;
+};
+
+/// Write primitive values to a VectorBuffer and read them back.
+class VectorBufferPrimitiveBenchmark : public MicroBenchmark
+{
+public:
+    VectorBufferPrimitiveBenchmark() : MicroBenchmark("VectorBuffer/Primitives", 4 * NUM_ELEMENTS) {}
+
+    virtual void Run(unsigned iterations)
+    {
+        float sum = 0.0f;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            buffer_.Clear();
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+            {
+                buffer_.WriteUInt(j);
+                buffer_.WriteFloat((float)j);
+            }
+            buffer_.Seek(0);
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+            {
+                sum += (float)buffer_.ReadUInt();
+                sum += buffer_.ReadFloat();
+            }
+        }
+        benchmarkSink += (unsigned)sum;
+    }
+
+    virtual void Teardown()
+    {
+        buffer_.Clear();
+    }
+
+private:
+    VectorBuffer buffer_;
+};
+
+/// Serialize a VariantMap to a VectorBuffer and deserialize it.
+class VectorBufferVariantMapBenchmark : public MicroBenchmark
+{
+public:
+    VectorBufferVariantMapBenchmark() : MicroBenchmark("VectorBuffer/VariantMap") {}
+
+    virtual void Setup()
+    {
+        VariantMapCopyBenchmark::CreateVariantMap(map_);
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            buffer_.Clear();
+            buffer_.WriteVariantMap(map_);
+            buffer_.Seek(0);
+            VariantMap map = buffer_.ReadVariantMap();
+            benchmarkSink += map.Size();
+        }
+    }
+
+    virtual void Teardown()
+    {
+        map_.Clear();
+        buffer_.Clear();
+    }
+
+private:
+    VariantMap map_;
+    VectorBuffer buffer_;
+};
+
+/// Hash strings of the given length.
+class StringHashBenchmark : public MicroBenchmark
+{
+public:
+    StringHashBenchmark(const String& name, unsigned length) :
+        MicroBenchmark(name, NUM_ELEMENTS),
+        length_(length)
+    {
+    }
+
+    virtual void Setup()
+    {
+        for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+            strings_.Push(RandomString(length_));
+    }
+
+    virtual void Run(unsigned iterations)
+    {
+        unsigned sum = 0;
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            for (unsigned j = 0; j < NUM_ELEMENTS; ++j)
+                sum += StringHash(strings_[j].CString()).Value();
+        }
+        benchmarkSink += sum;
+    }
+
+    virtual void Teardown()
+    {
+        strings_.Clear();
+    }
+
+private:
+    unsigned length_;
+    Vector<String> strings_;
+};
+
+void CreateMicroBenchmarks(Vector<SharedPtr<MicroBenchmark> >& benchmarks)
+{
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new PODVectorPushBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new PODVectorIterateBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new VectorPushBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new VectorEraseBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new HashMapInsertBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new HashMapFindBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new HashMapFindStringBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new StringAssignBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new StringAppendBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new StringCompareBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new SortIntBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new SortStringBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new Matrix3x4MultiplyBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new Matrix4MultiplyBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new Matrix3x4InverseBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new Matrix4InverseBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new Matrix3x4TransformBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new FrustumDefineBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new FrustumTestBenchmark("Frustum/IsInsideBox", false, false)));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new FrustumTestBenchmark("Frustum/IsInsideFastBox", false, true)));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new FrustumTestBenchmark("Frustum/IsInsideSphere", true, false)));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new VariantAssignBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new VariantMapCopyBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new VectorBufferPrimitiveBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new VectorBufferVariantMapBenchmark()));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new StringHashBenchmark("StringHash/Short", 8)));
+    benchmarks.Push(SharedPtr<MicroBenchmark>(new StringHashBenchmark("StringHash/Long", 64)));
+}
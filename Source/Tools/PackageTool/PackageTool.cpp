@@ -24,9 +24,16 @@
 
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Container/ArrayPtr.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/IO/Compression.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/IO/PackageFile.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/VectorBuffer.h>
 
 #ifdef WIN32
 #include <windows.h>
@@ -34,14 +41,14 @@
 
 #include <cstdio>
 #include <cstring>
-#include <LZ4/lz4.h>
-#include <LZ4/lz4hc.h>
 
 #include <Urho3D/DebugNew.h>
 
 using namespace Urho3D;
 
 static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+/// Maximum number of files read and compressed ahead of writing them to the package.
+static const unsigned MAX_PENDING_FILES = 64;
 
 struct FileEntry
 {
@@ -51,12 +58,50 @@ struct FileEntry
     unsigned checksum_;
 };
 
+/// File data read and compressed by the worker threads, waiting to be written in file order.
+struct FileData
+{
+    /// Uncompressed file contents.
+    SharedArrayPtr<unsigned char> data_;
+    /// Block offset table and compressed blocks, when compressing.
+    VectorBuffer packed_;
+    /// Whether the compressed data was copied from the previous package.
+    bool reused_;
+    /// Whether the worker thread has finished with the file.
+    bool ready_;
+};
+
+/// Extent of a compressed file within the previous package.
+struct PackedExtent
+{
+    unsigned offset_;
+    unsigned size_;
+    unsigned fileSize_;
+    unsigned checksum_;
+};
+
+/// Worker thread which reads and compresses files.
+class PackThread : public Thread, public RefCounted
+{
+public:
+    /// Process files until all have been claimed.
+    virtual void ThreadFunction();
+};
+
 SharedPtr<Context> context_(new Context());
 SharedPtr<FileSystem> fileSystem_(new FileSystem(context_));
 String basePath_;
+String rootDir_;
 Vector<FileEntry> entries_;
+Vector<FileData> fileData_;
+HashMap<String, PackedExtent> previousExtents_;
+String previousPackageName_;
+Mutex mutex_;
+unsigned nextFile_ = 0;
+unsigned writtenFiles_ = 0;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool incremental_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
 
@@ -69,8 +114,13 @@ String ignoreExtensions_[] = {
 int main(int argc, char** argv);
 void Run(const Vector<String>& arguments);
 void ProcessFile(const String& fileName, const String& rootDir);
+void ReadPreviousPackage(const String& fileName);
 void WritePackageFile(const String& fileName, const String& rootDir);
 void WriteHeader(File& dest);
+unsigned ClaimFile();
+void PackFile(unsigned index);
+bool ReusePackedData(unsigned index);
+bool IsDuplicate(unsigned index, unsigned earlierIndex);
 
 int main(int argc, char** argv)
 {
@@ -94,6 +144,7 @@ void Run(const Vector<String>& arguments)
             "\n"
             "Options:\n"
             "-c      Enable package file LZ4 compression\n"
+            "-i      Incremental repack: reuse unchanged compressed files from the existing package\n"
             "-q      Enable quiet mode\n"
         );
 
@@ -114,6 +165,9 @@ void Run(const Vector<String>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                    case 'i':
+                        incremental_ = true;
+                        break;
                     case 'q':
                         quiet_ = true;
                         break;
@@ -149,6 +203,9 @@ void Run(const Vector<String>& arguments)
     for (unsigned i = 0; i < fileNames.Size(); ++i)
         ProcessFile(fileNames[i], dirName);
 
+    if (incremental_ && compress_ && fileSystem_->FileExists(packageName))
+        ReadPreviousPackage(packageName);
+
     WritePackageFile(packageName, dirName);
 }
 
@@ -169,14 +226,56 @@ void ProcessFile(const String& fileName, const String& rootDir)
     entries_.Push(newEntry);
 }
 
+void ReadPreviousPackage(const String& fileName)
+{
+    SharedPtr<PackageFile> package(new PackageFile(context_));
+    if (!package->Open(fileName) || !package->IsCompressed() || !package->HasBlockIndex())
+    {
+        if (!quiet_)
+            PrintLine("Existing package " + fileName + " can not be reused, packing all files");
+        return;
+    }
+
+    // Each file's compressed data extends to the start of the next file's data, or to the package size at the end
+    const HashMap<String, PackageEntry>& entries = package->GetEntries();
+    PODVector<unsigned> offsets;
+    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+        offsets.Push(i->second_.offset_);
+    offsets.Push(package->GetTotalSize() - sizeof(unsigned));
+    Sort(offsets.Begin(), offsets.End());
+
+    // Identical files share their data, so skip equal offsets
+    HashMap<unsigned, unsigned> extentEnds;
+    for (unsigned i = 1; i < offsets.Size(); ++i)
+    {
+        if (offsets[i] != offsets[i - 1])
+            extentEnds[offsets[i - 1]] = offsets[i];
+    }
+
+    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+    {
+        PackedExtent extent;
+        extent.offset_ = i->second_.offset_;
+        extent.size_ = extentEnds[i->second_.offset_] - i->second_.offset_;
+        extent.fileSize_ = i->second_.size_;
+        extent.checksum_ = i->second_.checksum_;
+        previousExtents_[i->first_] = extent;
+    }
+
+    previousPackageName_ = fileName;
+}
+
 void WritePackageFile(const String& fileName, const String& rootDir)
 {
     if (!quiet_)
         PrintLine("Writing package");
 
+    // When reusing data from the existing package, write to a temporary file first and replace the package at the end
+    String destName = previousPackageName_.Empty() ? fileName : fileName + ".tmp";
+
     File dest(context_);
-    if (!dest.Open(fileName, FILE_WRITE))
-        ErrorExit("Could not open output file " + fileName);
+    if (!dest.Open(destName, FILE_WRITE))
+        ErrorExit("Could not open output file " + destName);
 
     // Write ID, number of files & placeholder for checksum
     WriteHeader(dest);
@@ -190,68 +289,107 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         dest.WriteUInt(entries_[i].checksum_);
     }
 
+    // Read and compress the files in worker threads, then write them in order
+    rootDir_ = rootDir;
+    fileData_.Resize(entries_.Size());
+    for (unsigned i = 0; i < fileData_.Size(); ++i)
+    {
+        fileData_[i].reused_ = false;
+        fileData_[i].ready_ = false;
+    }
+
+    unsigned numThreads = Max((int)GetNumPhysicalCPUs(), 1);
+    Vector<SharedPtr<PackThread> > threads;
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        SharedPtr<PackThread> thread(new PackThread());
+        if (!thread->Run())
+            ErrorExit("Could not create worker thread");
+        threads.Push(thread);
+    }
+
     unsigned totalDataSize = 0;
+    unsigned numDuplicates = 0;
+    unsigned numReused = 0;
+    // Written files by size and checksum, for finding identical files
+    HashMap<Pair<unsigned, unsigned>, PODVector<unsigned> > writtenContents;
 
     // Write file data, calculate checksums & correct offsets
     for (unsigned i = 0; i < entries_.Size(); ++i)
     {
-        entries_[i].offset_ = dest.GetSize();
-        String fileFullPath = rootDir + "/" + entries_[i].name_;
-
-        File srcFile(context_, fileFullPath);
-        if (!srcFile.IsOpen())
-            ErrorExit("Could not open file " + fileFullPath);
+        for (;;)
+        {
+            {
+                MutexLock lock(mutex_);
+                if (fileData_[i].ready_)
+                    break;
+            }
+            Time::Sleep(1);
+        }
 
+        FileData& data = fileData_[i];
         unsigned dataSize = entries_[i].size_;
         totalDataSize += dataSize;
-        SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
-
-        if (srcFile.Read(&buffer[0], dataSize) != dataSize)
-            ErrorExit("Could not read file " + fileFullPath);
-        srcFile.Close();
 
         for (unsigned j = 0; j < dataSize; ++j)
+            checksum_ = SDBMHash(checksum_, data.data_[j]);
+
+        // Point identical files at the data already written
+        PODVector<unsigned>& candidates = writtenContents[MakePair(dataSize, entries_[i].checksum_)];
+        unsigned duplicateOf = M_MAX_UNSIGNED;
+        for (unsigned j = 0; j < candidates.Size(); ++j)
         {
-            checksum_ = SDBMHash(checksum_, buffer[j]);
-            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
+            if (IsDuplicate(i, candidates[j]))
+            {
+                duplicateOf = candidates[j];
+                break;
+            }
         }
 
-        if (!compress_)
+        if (duplicateOf != M_MAX_UNSIGNED)
         {
+            entries_[i].offset_ = entries_[duplicateOf].offset_;
+            ++numDuplicates;
             if (!quiet_)
-                PrintLine(entries_[i].name_ + " size " + String(dataSize));
-            dest.Write(&buffer[0], entries_[i].size_);
+                PrintLine(entries_[i].name_ + " size " + String(dataSize) + " duplicate of " + entries_[duplicateOf].name_);
         }
         else
         {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
-
-            unsigned pos = 0;
-            unsigned totalPackedBytes = 0;
+            entries_[i].offset_ = dest.GetSize();
+            candidates.Push(i);
 
-            while (pos < dataSize)
+            if (!compress_)
             {
-                unsigned unpackedSize = blockSize_;
-                if (pos + unpackedSize > dataSize)
-                    unpackedSize = dataSize - pos;
-
-                unsigned packedSize = LZ4_compressHC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize);
-                if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + pos);
-
-                dest.WriteUShort(unpackedSize);
-                dest.WriteUShort(packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
-                totalPackedBytes += 6 + packedSize;
+                if (!quiet_)
+                    PrintLine(entries_[i].name_ + " size " + String(dataSize));
+                dest.Write(&data.data_[0], dataSize);
+            }
+            else
+            {
+                dest.Write(data.packed_.GetData(), data.packed_.GetSize());
+                if (data.reused_)
+                    ++numReused;
 
-                pos += unpackedSize;
+                if (!quiet_)
+                {
+                    PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(data.packed_.GetSize()) +
+                        (data.reused_ ? " reused" : ""));
+                }
             }
+        }
 
-            if (!quiet_)
-                PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(totalPackedBytes));
+        // Release the data and let the worker threads proceed further
+        {
+            MutexLock lock(mutex_);
+            data.data_.Reset();
+            data.packed_.Clear();
+            ++writtenFiles_;
         }
     }
 
+    for (unsigned i = 0; i < threads.Size(); ++i)
+        threads[i]->Stop();
+
     // Write package size to the end of file to allow finding it linked to an executable file
     unsigned currentSize = dest.GetSize();
     dest.WriteUInt(currentSize + sizeof(unsigned));
@@ -268,11 +406,24 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         dest.WriteUInt(entries_[i].checksum_);
     }
 
+    unsigned packageSize = dest.GetSize();
+    dest.Close();
+
+    if (destName != fileName)
+    {
+        if (!fileSystem_->Delete(fileName) || !fileSystem_->Rename(destName, fileName))
+            ErrorExit("Could not replace package file " + fileName + " with " + destName);
+    }
+
     if (!quiet_)
     {
         PrintLine("Number of files " + String(entries_.Size()));
+        if (numDuplicates)
+            PrintLine("Duplicate files " + String(numDuplicates));
+        if (numReused)
+            PrintLine("Reused compressed files " + String(numReused));
         PrintLine("File data size " + String(totalDataSize));
-        PrintLine("Package size " + String(dest.GetSize()));
+        PrintLine("Package size " + String(packageSize));
     }
 }
 
@@ -281,7 +432,137 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZS");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
 }
+
+void PackThread::ThreadFunction()
+{
+    for (;;)
+    {
+        unsigned index = ClaimFile();
+        if (index >= entries_.Size())
+            break;
+
+        PackFile(index);
+    }
+}
+
+unsigned ClaimFile()
+{
+    // Do not run too far ahead of the writing, to bound the memory use
+    for (;;)
+    {
+        {
+            MutexLock lock(mutex_);
+            if (nextFile_ >= entries_.Size() || nextFile_ < writtenFiles_ + MAX_PENDING_FILES)
+                return nextFile_++;
+        }
+        Time::Sleep(1);
+    }
+}
+
+void PackFile(unsigned index)
+{
+    FileEntry& entry = entries_[index];
+    FileData& data = fileData_[index];
+    String fileFullPath = rootDir_ + "/" + entry.name_;
+
+    File srcFile(context_, fileFullPath);
+    if (!srcFile.IsOpen())
+        ErrorExit("Could not open file " + fileFullPath);
+
+    unsigned dataSize = entry.size_;
+    data.data_ = new unsigned char[dataSize];
+
+    if (srcFile.Read(&data.data_[0], dataSize) != dataSize)
+        ErrorExit("Could not read file " + fileFullPath);
+    srcFile.Close();
+
+    entry.checksum_ = 0;
+    for (unsigned j = 0; j < dataSize; ++j)
+        entry.checksum_ = SDBMHash(entry.checksum_, data.data_[j]);
+
+    if (compress_ && !ReusePackedData(index))
+    {
+        LZ4Codec codec;
+        SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[codec.GetCompressBound(blockSize_)]);
+        unsigned numBlocks = (dataSize + blockSize_ - 1) / blockSize_;
+        unsigned tableSize = (2 + numBlocks) * sizeof(unsigned);
+        PODVector<unsigned> blockOffsets;
+        VectorBuffer blocks;
+
+        // Compress all blocks first, as the block offset table precedes them
+        unsigned pos = 0;
+
+        while (pos < dataSize)
+        {
+            unsigned unpackedSize = blockSize_;
+            if (pos + unpackedSize > dataSize)
+                unpackedSize = dataSize - pos;
+
+            unsigned packedSize = codec.Compress(compressBuffer.Get(), &data.data_[pos], unpackedSize);
+            if (!packedSize)
+                ErrorExit("LZ4 compression failed for file " + entry.name_ + " at offset " + pos);
+
+            blockOffsets.Push(tableSize + blocks.GetSize());
+            blocks.WriteUShort(unpackedSize);
+            blocks.WriteUShort(packedSize);
+            blocks.Write(compressBuffer.Get(), packedSize);
+
+            pos += unpackedSize;
+        }
+
+        // Write the block offset table for random access, then the blocks
+        data.packed_.WriteUInt(numBlocks);
+        data.packed_.WriteUInt(blockSize_);
+        for (unsigned j = 0; j < numBlocks; ++j)
+            data.packed_.WriteUInt(blockOffsets[j]);
+        data.packed_.Write(blocks.GetData(), blocks.GetSize());
+    }
+
+    MutexLock lock(mutex_);
+    data.ready_ = true;
+}
+
+bool ReusePackedData(unsigned index)
+{
+    const FileEntry& entry = entries_[index];
+    HashMap<String, PackedExtent>::ConstIterator i = previousExtents_.Find(entry.name_);
+    if (i == previousExtents_.End() || i->second_.fileSize_ != entry.size_ || i->second_.checksum_ != entry.checksum_)
+        return false;
+
+    File package(context_, previousPackageName_);
+    if (!package.IsOpen() || package.Seek(i->second_.offset_) != i->second_.offset_)
+        return false;
+
+    // The block size must also match, as it is stored in the block offset table
+    FileData& data = fileData_[index];
+    data.packed_.Resize(i->second_.size_);
+    if (package.Read(data.packed_.GetModifiableData(), i->second_.size_) != i->second_.size_ ||
+        data.packed_.GetSize() < 2 * sizeof(unsigned) || ((const unsigned*)data.packed_.GetData())[1] != blockSize_)
+    {
+        data.packed_.Clear();
+        return false;
+    }
+
+    data.reused_ = true;
+    return true;
+}
+
+bool IsDuplicate(unsigned index, unsigned earlierIndex)
+{
+    // The earlier file's data has already been released, so compare against its source file
+    String earlierPath = rootDir_ + "/" + entries_[earlierIndex].name_;
+    File earlierFile(context_, earlierPath);
+    if (!earlierFile.IsOpen())
+        return false;
+
+    unsigned dataSize = entries_[index].size_;
+    SharedArrayPtr<unsigned char> earlierData(new unsigned char[dataSize]);
+    if (earlierFile.Read(&earlierData[0], dataSize) != dataSize)
+        return false;
+
+    return !memcmp(&earlierData[0], &fileData_[index].data_[0], dataSize);
+}
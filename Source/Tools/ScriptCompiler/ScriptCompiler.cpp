@@ -49,18 +49,29 @@ void CompileScript(Context* context, const String& fileName);
 int main(int argc, char** argv)
 {
     #ifdef WIN32
-    const Vector<String>& arguments = ParseArguments(GetCommandLineW());
+    const Vector<String>& allArguments = ParseArguments(GetCommandLineW());
     #else
-    const Vector<String>& arguments = ParseArguments(argc, argv);
+    const Vector<String>& allArguments = ParseArguments(argc, argv);
     #endif
 
     bool dumpApiMode = false;
+    bool jitInstructions = false;
     String sourceTree;
     String outputFile;
 
+    Vector<String> arguments;
+    for (unsigned i = 0; i < allArguments.Size(); ++i)
+    {
+        if (allArguments[i] == "-jit")
+            jitInstructions = true;
+        else
+            arguments.Push(allArguments[i]);
+    }
+
     if (arguments.Size() < 1)
-        ErrorExit("Usage: ScriptCompiler <input file> [resource path for includes]\n"
-                  "       ScriptCompiler -dumpapi <source tree> <Doxygen output file> [C header output file]");
+        ErrorExit("Usage: ScriptCompiler <input file> [resource path for includes] [-jit]\n"
+                  "       ScriptCompiler -dumpapi <source tree> <Doxygen output file> [C header output file]\n\n"
+                  "-jit  Include JIT entry instructions in the bytecode, so that it can be JIT compiled when loaded");
     else
     {
         if (arguments[0] != "-dumpapi")
@@ -81,6 +92,8 @@ int main(int argc, char** argv)
     SharedPtr<Context> context(new Context());
     SharedPtr<Engine> engine(new Engine(context));
     context->RegisterSubsystem(new Script(context));
+    if (jitInstructions)
+        context->GetSubsystem<Script>()->SetJITInstructions(true);
     
     // In API dumping mode initialize the engine and instantiate LuaScript system if available so that we
     // can dump attributes from as many classes as possible
@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/RenderPath.h>
+#include <Urho3D/Graphics/ShaderPrecache.h>
+#include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "ShaderPrecacher.h"
+
+#include <Urho3D/DebugNew.h>
+
+DEFINE_APPLICATION_MAIN(ShaderPrecacher);
+
+ShaderPrecacher::ShaderPrecacher(Context* context) :
+    Application(context),
+    numMaterials_(0)
+{
+}
+
+void ShaderPrecacher::Setup()
+{
+    const Vector<String>& arguments = GetArguments();
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+        if (argument == "-scenes" && !value.Empty())
+        {
+            sceneNames_ = value.Split(',');
+            ++i;
+        }
+        else if (argument == "-output" && !value.Empty())
+        {
+            outputFileName_ = GetInternalPath(value);
+            ++i;
+        }
+    }
+
+    if (sceneNames_.Empty() || outputFileName_.Empty())
+    {
+        ErrorExit("Usage: ShaderPrecacher -scenes <list> -output <file> [options]\n\n"
+            "Loads scenes and writes the shader combinations their materials can be rendered with, according to the render "
+            "path and the renderer settings, into a shader precache XML file. An existing file is added to. The engine command "
+            "line options, for example -p, -renderpath, -deferred, -lqshadows and -noshadows, also apply.\n\n"
+            "Options:\n"
+            "-scenes <list> Comma-separated scene file or resource names, XML or binary\n"
+            "-output <file> Shader precache file to write\n"
+        );
+        return;
+    }
+
+    // A window is needed to query the shader capabilities of the graphics device
+    engineParameters_["WindowWidth"] = 320;
+    engineParameters_["WindowHeight"] = 240;
+    engineParameters_["FullScreen"] = false;
+    engineParameters_["Sound"] = false;
+    engineParameters_["LogName"] = GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "logs") + "ShaderPrecacher.log";
+}
+
+void ShaderPrecacher::Start()
+{
+    if (engine_->IsHeadless())
+    {
+        ErrorExit("ShaderPrecacher can not be run in headless mode");
+        return;
+    }
+
+    CollectPasses();
+
+    SharedPtr<ShaderPrecache> precache(new ShaderPrecache(context_, outputFileName_));
+    bool failed = false;
+    for (unsigned i = 0; i < sceneNames_.Size(); ++i)
+    {
+        if (!ProcessScene(sceneNames_[i].Trimmed(), precache))
+            failed = true;
+    }
+
+    // The precache file is written when the precache is destroyed
+    precache.Reset();
+    LOGINFO("Stored the shaders of " + String(numMaterials_) + " materials to " + outputFileName_);
+
+    if (failed)
+        exitCode_ = EXIT_FAILURE;
+    engine_->Exit();
+}
+
+void ShaderPrecacher::CollectPasses()
+{
+    Renderer* renderer = GetSubsystem<Renderer>();
+    RenderPath* renderPath = renderer->GetDefaultRenderPath();
+
+    // The forward lighting passes are used by default. Custom base and alpha passes have their own lit passes
+    for (unsigned i = 0; i < renderPath->commands_.Size(); ++i)
+    {
+        const RenderPathCommand& command = renderPath->commands_[i];
+        if (!command.enabled_)
+            continue;
+
+        if (command.type_ == CMD_SCENEPASS)
+        {
+            passIndices_.Insert(Technique::GetPassIndex(command.pass_));
+            if ((command.metadata_ == "base" || command.metadata_ == "alpha") && command.pass_ != command.metadata_)
+                passIndices_.Insert(Technique::GetPassIndex("lit" + command.pass_));
+        }
+        else if (command.type_ == CMD_FORWARDLIGHTS)
+        {
+            passIndices_.Insert(Technique::GetPassIndex(command.pass_));
+            passIndices_.Insert(Technique::litBasePassIndex);
+            passIndices_.Insert(Technique::litAlphaPassIndex);
+        }
+    }
+
+    if (renderer->GetDrawShadows())
+        passIndices_.Insert(Technique::shadowPassIndex);
+}
+
+bool ShaderPrecacher::ProcessScene(const String& fileName, ShaderPrecache* precache)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    Renderer* renderer = GetSubsystem<Renderer>();
+
+    SharedPtr<File> file;
+    if (cache->Exists(fileName))
+        file = cache->GetFile(fileName);
+    else
+        file = new File(context_, GetInternalPath(fileName));
+    if (!file->IsOpen())
+    {
+        LOGERROR("Could not open scene file " + fileName);
+        return false;
+    }
+
+    SharedPtr<Scene> scene(new Scene(context_));
+    bool success = GetExtension(fileName) == ".xml" ? scene->LoadXML(*file) : scene->Load(*file);
+    if (!success)
+    {
+        LOGERROR("Could not load scene " + fileName);
+        return false;
+    }
+
+    PODVector<Node*> nodes;
+    scene->GetChildren(nodes, true);
+    nodes.Push(scene);
+
+    // Find out the light types with and without specular highlights, then the geometry types each material is drawn with
+    unsigned lightTypes = 0;
+    bool specular = false;
+    HashMap<Material*, unsigned> materials;
+    PODVector<Light*> lights;
+    PODVector<Drawable*> drawables;
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        nodes[i]->GetComponents(lights);
+        for (unsigned j = 0; j < lights.Size(); ++j)
+        {
+            if (!lights[j]->IsEnabledEffective() || lights[j]->GetPerVertex())
+                continue;
+            lightTypes |= 1 << lights[j]->GetLightType();
+            if (lights[j]->GetSpecularIntensity() > 0.0f)
+                specular = true;
+        }
+
+        nodes[i]->GetDerivedComponents(drawables);
+        for (unsigned j = 0; j < drawables.Size(); ++j)
+        {
+            const Vector<SourceBatch>& batches = drawables[j]->GetBatches();
+            for (unsigned k = 0; k < batches.Size(); ++k)
+            {
+                Material* material = batches[k].material_ ? batches[k].material_.Get() : renderer->GetDefaultMaterial();
+                materials[material] |= 1 << batches[k].geometryType_;
+            }
+        }
+    }
+
+    int materialQuality = renderer->GetMaterialQuality();
+    for (HashMap<Material*, unsigned>::ConstIterator i = materials.Begin(); i != materials.End(); ++i)
+    {
+        Material* material = i->first_;
+        bool materialSpecular = specular && material->GetSpecular();
+
+        // Any supported technique of the quality level can be chosen depending on the LOD distance
+        const Vector<TechniqueEntry>& techniques = material->GetTechniques();
+        for (unsigned j = 0; j < techniques.Size(); ++j)
+        {
+            Technique* tech = techniques[j].technique_;
+            if (!tech || !tech->IsSupported() || (techniques.Size() > 1 && materialQuality < techniques[j].qualityLevel_))
+                continue;
+
+            for (HashSet<unsigned>::ConstIterator k = passIndices_.Begin(); k != passIndices_.End(); ++k)
+                renderer->StorePassShaders(tech->GetSupportedPass(*k), precache, i->second_, lightTypes, materialSpecular);
+        }
+    }
+
+    numMaterials_ += materials.Size();
+    LOGINFO("Processed scene " + fileName + " with " + String(materials.Size()) + " materials");
+    return true;
+}
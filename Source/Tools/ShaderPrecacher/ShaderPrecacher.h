@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Container/HashSet.h>
+#include <Urho3D/Engine/Application.h>
+
+namespace Urho3D
+{
+
+class Scene;
+class ShaderPrecache;
+
+}
+
+using namespace Urho3D;
+
+/// Shader precacher application. Loads scenes and writes every shader combination their materials can be rendered with into a shader precache file.
+class ShaderPrecacher : public Application
+{
+    OBJECT(ShaderPrecacher);
+
+public:
+    /// Construct.
+    ShaderPrecacher(Context* context);
+
+    /// Setup before engine initialization. Parse the options.
+    virtual void Setup();
+    /// Setup after engine initialization. Process the scenes, write the precache file and exit.
+    virtual void Start();
+
+private:
+    /// Collect the pass indices used by the default render path and the renderer settings.
+    void CollectPasses();
+    /// Load a scene and store the shader combinations of its drawables. Return true if successful.
+    bool ProcessScene(const String& fileName, ShaderPrecache* precache);
+
+    /// Scene file or resource names.
+    Vector<String> sceneNames_;
+    /// Precache output file name.
+    String outputFileName_;
+    /// Indices of the technique passes that can be rendered.
+    HashSet<unsigned> passIndices_;
+    /// Number of processed materials.
+    unsigned numMaterials_;
+};
@@ -0,0 +1,203 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Urho3D.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/Image.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+// Offset of the source hash written by Image::SaveDDS() into the reserved DDS header field, including the file ID
+static const unsigned DDS_SOURCE_HASH_OFFSET = 36;
+
+SharedPtr<Context> context_(new Context());
+CompressedFormat format_ = CF_NONE;
+bool mipmaps_ = true;
+bool force_ = false;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void CompressTexture(const String& inputFileName, const String& outputFileName);
+unsigned GetSourceHash(const String& fileName);
+unsigned GetCachedHash(const String& fileName);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+    {
+        ErrorExit(
+            "Usage: TextureCompressor <input file or directory> [output file] [options]\n\n"
+            "Compresses images to DXT (BC1/BC3) DDS files with a full mip chain. When a\n"
+            "directory is given, all png, jpg, tga and bmp files in it are compressed\n"
+            "recursively into dds files next to the sources. Sources whose content hash\n"
+            "matches the one stored in an existing output file are skipped.\n\n"
+            "Options:\n"
+            "-f <format> Use dxt1 or dxt5. Default is dxt1 for opaque and dxt5 for\n"
+            "            translucent images\n"
+            "-nm         Do not generate mip levels\n"
+            "-r          Recompress even if the source has not changed\n"
+        );
+    }
+
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new Log(context_));
+
+    String inputName;
+    String outputName;
+
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = i + 1 < arguments.Size() ? arguments[i + 1].ToLower() : String::EMPTY;
+
+            if (argument == "f" && !value.Empty())
+            {
+                if (value == "dxt1")
+                    format_ = CF_DXT1;
+                else if (value == "dxt5")
+                    format_ = CF_DXT5;
+                else
+                    ErrorExit("Unsupported format " + value);
+                ++i;
+            }
+            else if (argument == "nm")
+                mipmaps_ = false;
+            else if (argument == "r")
+                force_ = true;
+        }
+        else if (inputName.Empty())
+            inputName = arguments[i];
+        else
+            outputName = arguments[i];
+    }
+
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    if (fileSystem->DirExists(inputName))
+    {
+        String path = AddTrailingSlash(inputName);
+        const char* filters[] = { "*.png", "*.jpg", "*.tga", "*.bmp" };
+        for (unsigned i = 0; i < sizeof filters / sizeof filters[0]; ++i)
+        {
+            Vector<String> fileNames;
+            fileSystem->ScanDir(fileNames, path, filters[i], SCAN_FILES, true);
+            for (unsigned j = 0; j < fileNames.Size(); ++j)
+                CompressTexture(path + fileNames[j], ReplaceExtension(path + fileNames[j], ".dds"));
+        }
+    }
+    else
+    {
+        if (outputName.Empty())
+            outputName = ReplaceExtension(inputName, ".dds");
+        CompressTexture(inputName, outputName);
+    }
+}
+
+void CompressTexture(const String& inputFileName, const String& outputFileName)
+{
+    unsigned sourceHash = GetSourceHash(inputFileName);
+    if (!force_ && GetCachedHash(outputFileName) == sourceHash)
+    {
+        PrintLine("Skipping unchanged " + inputFileName);
+        return;
+    }
+
+    File source(context_, inputFileName);
+    SharedPtr<Image> image(new Image(context_));
+    if (!image->Load(source))
+        ErrorExit("Could not load image " + inputFileName);
+    if (image->IsCompressed())
+        ErrorExit("Image " + inputFileName + " is already compressed");
+
+    SharedPtr<Image> compressedImage = image->ConvertToDXT(format_, mipmaps_);
+    if (!compressedImage)
+        ErrorExit("Could not compress image " + inputFileName);
+
+    PrintLine("Writing " + outputFileName + " (" + (compressedImage->GetCompressedFormat() == CF_DXT1 ? "DXT1" : "DXT5") +
+        ", " + String(compressedImage->GetNumCompressedLevels()) + " levels)");
+    if (!compressedImage->SaveDDS(outputFileName, sourceHash))
+        ErrorExit("Could not write " + outputFileName);
+}
+
+unsigned GetSourceHash(const String& fileName)
+{
+    File file(context_, fileName);
+    if (!file.IsOpen())
+        ErrorExit("Could not open input file " + fileName);
+
+    // Include the options so that changing them also invalidates the output
+    unsigned hash = SDBMHash(SDBMHash(0, (unsigned char)format_), (unsigned char)mipmaps_);
+    unsigned char buffer[4096];
+    unsigned bytesLeft = file.GetSize();
+    while (bytesLeft)
+    {
+        unsigned bytes = file.Read(buffer, bytesLeft < sizeof buffer ? bytesLeft : sizeof buffer);
+        if (!bytes)
+            break;
+        for (unsigned i = 0; i < bytes; ++i)
+            hash = SDBMHash(hash, buffer[i]);
+        bytesLeft -= bytes;
+    }
+
+    // Zero means no hash in the output file header, so avoid it
+    return hash ? hash : 1;
+}
+
+unsigned GetCachedHash(const String& fileName)
+{
+    if (!context_->GetSubsystem<FileSystem>()->FileExists(fileName))
+        return 0;
+
+    File file(context_, fileName);
+    if (file.ReadFileID() != "DDS ")
+        return 0;
+    file.Seek(DDS_SOURCE_HASH_OFFSET);
+    return file.ReadUInt();
+}
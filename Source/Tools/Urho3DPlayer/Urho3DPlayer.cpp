@@ -112,10 +112,15 @@ void Urho3DPlayer::Setup()
             "-lqshadows   Use low-quality (1-sample) shadow filtering\n"
             "-noshadows   Disable shadow rendering\n"
             "-nolimit     Disable frame limiter\n"
+            "-tickrate <n> Run fixed timestep frames at n per second, for example a headless server\n"
             "-nothreads   Disable worker threads\n"
+            "-workstealing Use work stealing between worker threads\n"
+            "-threadaffinity Pin worker threads to the performance or efficiency cores\n"
+            "-reservedcpus <n> Keep worker threads off n logical CPUs, left for other threads\n"
             "-nosound     Disable sound output\n"
             "-noip        Disable sound mixing interpolation\n"
             "-touch       Touch emulation on desktop platform\n"
+            "-scriptcache Cache compiled AngelScript bytecode in the user preferences directory\n"
             #endif
         );
     }
@@ -133,7 +138,10 @@ void Urho3DPlayer::Start()
     {
 #ifdef URHO3D_ANGELSCRIPT
         // Instantiate and register the AngelScript subsystem
-        context_->RegisterSubsystem(new Script(context_));
+        Script* script = new Script(context_);
+        context_->RegisterSubsystem(script);
+        if (GetArguments().Contains("-scriptcache"))
+            script->SetByteCodeCacheDir(GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "scriptcache"));
 
         // Hold a shared pointer to the script file to make sure it is not unloaded during runtime
         scriptFile_ = GetSubsystem<ResourceCache>()->GetResource<ScriptFile>(scriptFileName_);
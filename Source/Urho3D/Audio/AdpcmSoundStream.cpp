@@ -0,0 +1,352 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Audio/AdpcmSoundStream.h"
+#include "../Audio/Sound.h"
+
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const int IMA_INDEX_TABLE[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int IMA_STEP_TABLE[89] =
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+    1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int MS_ADAPTATION_TABLE[16] =
+{
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+static inline int ReadShort(const unsigned char* src)
+{
+    return (short)(src[0] | (src[1] << 8));
+}
+
+static inline void WriteShort(unsigned char* dest, int value)
+{
+    dest[0] = (unsigned char)(value & 0xff);
+    dest[1] = (unsigned char)((value >> 8) & 0xff);
+}
+
+static inline int ClampSample(int value)
+{
+    return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+/// Decode an IMA ADPCM nibble and update the predictor and step index.
+static inline int DecodeImaNibble(int nibble, int& predictor, int& stepIndex)
+{
+    int step = IMA_STEP_TABLE[stepIndex];
+    int diff = step >> 3;
+    if (nibble & 4)
+        diff += step;
+    if (nibble & 2)
+        diff += step >> 1;
+    if (nibble & 1)
+        diff += step >> 2;
+
+    predictor = ClampSample(nibble & 8 ? predictor - diff : predictor + diff);
+    stepIndex += IMA_INDEX_TABLE[nibble];
+    stepIndex = stepIndex < 0 ? 0 : (stepIndex > 88 ? 88 : stepIndex);
+    return predictor;
+}
+
+unsigned GetImaAdpcmBlockSamples(unsigned blockAlign, unsigned channels)
+{
+    if (!channels || blockAlign <= 4 * channels)
+        return 0;
+
+    // The header holds one sample, then each 4 bytes per channel hold 8 samples
+    return 1 + (blockAlign - 4 * channels) / (4 * channels) * 8;
+}
+
+unsigned GetMsAdpcmBlockSamples(unsigned blockAlign, unsigned channels)
+{
+    if (!channels || blockAlign < 7 * channels)
+        return 0;
+
+    // The header holds two samples, then each byte holds two
+    return 2 + (blockAlign - 7 * channels) * 2 / channels;
+}
+
+unsigned DecodeImaAdpcmBlock(short* dest, const unsigned char* src, unsigned blockAlign, unsigned channels)
+{
+    unsigned samples = GetImaAdpcmBlockSamples(blockAlign, channels);
+    if (!samples)
+        return 0;
+
+    int predictor[2];
+    int stepIndex[2];
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        predictor[c] = ReadShort(src);
+        stepIndex[c] = src[2] > 88 ? 88 : src[2];
+        dest[c] = (short)predictor[c];
+        src += 4;
+    }
+    dest += channels;
+
+    // Each channel has 4 bytes (8 samples) at a time, low nibble first
+    unsigned groups = (samples - 1) / 8;
+    for (unsigned g = 0; g < groups; ++g)
+    {
+        for (unsigned c = 0; c < channels; ++c)
+        {
+            short* out = dest + c;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                int byte = *src++;
+                *out = (short)DecodeImaNibble(byte & 0xf, predictor[c], stepIndex[c]);
+                out += channels;
+                *out = (short)DecodeImaNibble(byte >> 4, predictor[c], stepIndex[c]);
+                out += channels;
+            }
+        }
+        dest += 8 * channels;
+    }
+
+    return samples;
+}
+
+unsigned DecodeMsAdpcmBlock(short* dest, const unsigned char* src, unsigned blockAlign, unsigned channels,
+    const short* coefficients, unsigned numCoefficients)
+{
+    unsigned samples = GetMsAdpcmBlockSamples(blockAlign, channels);
+    if (!samples || !numCoefficients)
+        return 0;
+
+    int coef1[2];
+    int coef2[2];
+    int delta[2];
+    int sample1[2];
+    int sample2[2];
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        unsigned index = src[c] < numCoefficients ? src[c] : 0;
+        coef1[c] = coefficients[index * 2];
+        coef2[c] = coefficients[index * 2 + 1];
+    }
+    src += channels;
+    for (unsigned c = 0; c < channels; ++c, src += 2)
+        delta[c] = ReadShort(src);
+    for (unsigned c = 0; c < channels; ++c, src += 2)
+        sample1[c] = ReadShort(src);
+    for (unsigned c = 0; c < channels; ++c, src += 2)
+        sample2[c] = ReadShort(src);
+
+    // The older sample comes first
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        dest[c] = (short)sample2[c];
+        dest[channels + c] = (short)sample1[c];
+    }
+    dest += 2 * channels;
+
+    // Nibbles alternate between the channels, high nibble first
+    unsigned nibbles = (samples - 2) * channels;
+    for (unsigned i = 0; i < nibbles; ++i)
+    {
+        unsigned c = i % channels;
+        int nibble = i & 1 ? src[i >> 1] & 0xf : src[i >> 1] >> 4;
+        int signedNibble = nibble >= 8 ? nibble - 16 : nibble;
+
+        int predictor = ClampSample(((sample1[c] * coef1[c] + sample2[c] * coef2[c]) >> 8) + signedNibble * delta[c]);
+        sample2[c] = sample1[c];
+        sample1[c] = predictor;
+        delta[c] = (MS_ADAPTATION_TABLE[nibble] * delta[c]) >> 8;
+        if (delta[c] < 16)
+            delta[c] = 16;
+
+        *dest++ = (short)predictor;
+    }
+
+    return samples;
+}
+
+void EncodeImaAdpcmBlock(unsigned char* dest, const short* src, unsigned samples, unsigned blockAlign, unsigned channels,
+    int* stepIndices)
+{
+    unsigned blockSamples = GetImaAdpcmBlockSamples(blockAlign, channels);
+    if (!blockSamples || !samples)
+        return;
+    if (samples > blockSamples)
+        samples = blockSamples;
+
+    // The header stores the first sample exactly
+    int predictor[2];
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        predictor[c] = src[c];
+        WriteShort(dest, predictor[c]);
+        dest[2] = (unsigned char)stepIndices[c];
+        dest[3] = 0;
+        dest += 4;
+    }
+
+    unsigned groups = (blockSamples - 1) / 8;
+    for (unsigned g = 0; g < groups; ++g)
+    {
+        for (unsigned c = 0; c < channels; ++c)
+        {
+            for (unsigned i = 0; i < 8; ++i)
+            {
+                // Pad past the end with silence
+                unsigned index = 1 + g * 8 + i;
+                int sample = index < samples ? src[index * channels + c] : 0;
+
+                int diff = sample - predictor[c];
+                int nibble = 0;
+                if (diff < 0)
+                {
+                    nibble = 8;
+                    diff = -diff;
+                }
+                int step = IMA_STEP_TABLE[stepIndices[c]];
+                if (diff >= step)
+                {
+                    nibble |= 4;
+                    diff -= step;
+                }
+                step >>= 1;
+                if (diff >= step)
+                {
+                    nibble |= 2;
+                    diff -= step;
+                }
+                step >>= 1;
+                if (diff >= step)
+                    nibble |= 1;
+
+                // Track the predictor as the decoder sees it
+                DecodeImaNibble(nibble, predictor[c], stepIndices[c]);
+
+                if (i & 1)
+                    *dest++ |= (unsigned char)(nibble << 4);
+                else
+                    *dest = (unsigned char)nibble;
+            }
+        }
+    }
+}
+
+AdpcmSoundStream::AdpcmSoundStream(const Sound* sound) :
+    numCoefficients_(0),
+    nextBlock_(0),
+    decodedSamples_(0),
+    blockSize_(0),
+    blockPosition_(0)
+{
+    assert(sound && sound->IsCompressed());
+    
+    SetFormat(sound->GetIntFrequency(), true, sound->IsStereo());
+    // If the sound is looped, the stream will automatically rewind at end
+    SetStopAtEnd(!sound->IsLooped());
+    
+    data_ = sound->GetData();
+    dataSize_ = sound->GetDataSize();
+    channels_ = sound->IsStereo() ? 2 : 1;
+    blockAlign_ = sound->GetBlockAlign();
+    if (sound->GetCompression() == SC_MSADPCM)
+    {
+        coefficients_ = sound->GetAdpcmCoefficients();
+        numCoefficients_ = sound->GetNumAdpcmCoefficients();
+        blockSamples_ = GetMsAdpcmBlockSamples(blockAlign_, channels_);
+    }
+    else
+        blockSamples_ = GetImaAdpcmBlockSamples(blockAlign_, channels_);
+    totalSamples_ = sound->GetNumSamples();
+    
+    block_ = new short[blockSamples_ * channels_];
+}
+
+AdpcmSoundStream::~AdpcmSoundStream()
+{
+}
+
+unsigned AdpcmSoundStream::GetData(signed char* dest, unsigned numBytes)
+{
+    unsigned sampleSize = channels_ * sizeof(short);
+    unsigned outBytes = 0;
+    bool rewound = false;
+    
+    while (numBytes >= sampleSize)
+    {
+        if (blockPosition_ >= blockSize_)
+        {
+            if (!DecodeBlock())
+            {
+                // Rewind if is looping. Rewind only once per call, so that a sound without data does not loop forever
+                if (stopAtEnd_ || rewound)
+                    break;
+                nextBlock_ = 0;
+                decodedSamples_ = 0;
+                rewound = true;
+                continue;
+            }
+        }
+        
+        unsigned copySamples = Min((int)(blockSize_ - blockPosition_), (int)(numBytes / sampleSize));
+        unsigned copyBytes = copySamples * sampleSize;
+        memcpy(dest, block_.Get() + blockPosition_ * channels_, copyBytes);
+        blockPosition_ += copySamples;
+        dest += copyBytes;
+        outBytes += copyBytes;
+        numBytes -= copyBytes;
+        rewound = false;
+    }
+    
+    return outBytes;
+}
+
+bool AdpcmSoundStream::DecodeBlock()
+{
+    if (!blockSamples_ || nextBlock_ + blockAlign_ > dataSize_ || decodedSamples_ >= totalSamples_)
+        return false;
+    
+    const unsigned char* src = (const unsigned char*)data_.Get() + nextBlock_;
+    unsigned samples = numCoefficients_ ? DecodeMsAdpcmBlock(block_.Get(), src, blockAlign_, channels_, coefficients_.Get(),
+        numCoefficients_) : DecodeImaAdpcmBlock(block_.Get(), src, blockAlign_, channels_);
+    
+    // The last block may be only partially used
+    blockSize_ = Min((int)samples, (int)(totalSamples_ - decodedSamples_));
+    blockPosition_ = 0;
+    decodedSamples_ += blockSize_;
+    nextBlock_ += blockAlign_;
+    return blockSize_ > 0;
+}
+
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/ArrayPtr.h"
+#include "../Audio/SoundStream.h"
+
+namespace Urho3D
+{
+
+class Sound;
+
+/// Return number of samples per channel in an IMA ADPCM block.
+URHO3D_API unsigned GetImaAdpcmBlockSamples(unsigned blockAlign, unsigned channels);
+/// Return number of samples per channel in an MS ADPCM block.
+URHO3D_API unsigned GetMsAdpcmBlockSamples(unsigned blockAlign, unsigned channels);
+/// Decode an IMA ADPCM block to interleaved 16-bit samples. Return number of samples per channel decoded.
+URHO3D_API unsigned DecodeImaAdpcmBlock(short* dest, const unsigned char* src, unsigned blockAlign, unsigned channels);
+/// Decode an MS ADPCM block to interleaved 16-bit samples using coefficient pairs. Return number of samples per channel decoded.
+URHO3D_API unsigned DecodeMsAdpcmBlock(short* dest, const unsigned char* src, unsigned blockAlign, unsigned channels,
+    const short* coefficients, unsigned numCoefficients);
+/// Encode interleaved 16-bit samples to an IMA ADPCM block, padding with silence if fewer samples than fit the block. The step indices per channel carry over between blocks.
+URHO3D_API void EncodeImaAdpcmBlock(unsigned char* dest, const short* src, unsigned samples, unsigned blockAlign, unsigned channels,
+    int* stepIndices);
+
+/// ADPCM sound stream. Decodes one block at a time, which is cheap enough for the mixing thread.
+class URHO3D_API AdpcmSoundStream : public SoundStream
+{
+public:
+    /// Construct from an ADPCM compressed sound.
+    AdpcmSoundStream(const Sound* sound);
+    /// Destruct.
+    ~AdpcmSoundStream();
+    
+    /// Produce sound data into destination. Return number of bytes produced. Called by SoundSource from the mixing thread.
+    virtual unsigned GetData(signed char* dest, unsigned numBytes);
+    
+protected:
+    /// Decode the next block. Return false if at the end.
+    bool DecodeBlock();
+    
+    /// Compressed sound data.
+    SharedArrayPtr<signed char> data_;
+    /// Compressed sound data size in bytes.
+    unsigned dataSize_;
+    /// MS ADPCM coefficient pairs.
+    SharedArrayPtr<short> coefficients_;
+    /// Number of MS ADPCM coefficient pairs, zero for IMA ADPCM.
+    unsigned numCoefficients_;
+    /// Block size in bytes.
+    unsigned blockAlign_;
+    /// Number of samples per channel in a block.
+    unsigned blockSamples_;
+    /// Total number of samples per channel.
+    unsigned totalSamples_;
+    /// Number of channels.
+    unsigned channels_;
+    /// Decoded block.
+    SharedArrayPtr<short> block_;
+    /// Byte offset of the next block.
+    unsigned nextBlock_;
+    /// Number of samples per channel decoded so far, including the current block.
+    unsigned decodedSamples_;
+    /// Number of samples per channel available in the current block.
+    unsigned blockSize_;
+    /// Read position in samples per channel in the current block.
+    unsigned blockPosition_;
+};
+
+}
@@ -24,15 +24,21 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../IO/Log.h"
-#include "../Core/Mutex.h"
+#include "../Core/MemoryTracker.h"
 #include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
 #include "../Audio/Sound.h"
 #include "../Audio/SoundListener.h"
 #include "../Audio/SoundSource3D.h"
+#include "../Container/Sort.h"
 
 #include <SDL/SDL.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -44,18 +50,71 @@ static const int MIN_BUFFERLENGTH = 20;
 static const int MIN_MIXRATE = 11025;
 static const int MAX_MIXRATE = 48000;
 static const StringHash SOUND_MASTER_HASH("MASTER");
+static const float DEFAULT_VIRTUAL_THRESHOLD = 0.001f;
+static const float DEFAULT_STREAM_LOOKAHEAD = 0.5f;
+/// Capacity of the command ring buffer. Must be a power of two.
+static const unsigned AUDIO_COMMAND_BUFFER_SIZE = 8192;
 
 static void SDLAudioCallback(void *userdata, Uint8 *stream, int len);
 
+/// Sort sound sources by priority multiplied by effective gain, highest first.
+static bool CompareVoices(SoundSource* lhs, SoundSource* rhs)
+{
+    return lhs->GetPriority() * lhs->GetAudibility() > rhs->GetPriority() * rhs->GetAudibility();
+}
+
+#ifndef EMSCRIPTEN
+/// Clip float mix buffer samples to 16-bit output.
+static void ClipSamples(short* dest, const float* src, unsigned count)
+{
+    short* end = dest + count;
+
+#if defined(URHO3D_SIMD_SSE2)
+    // Clamp before converting, as out of range values convert to the integer minimum
+    __m128 minValue = _mm_set1_ps(-32768.0f);
+    __m128 maxValue = _mm_set1_ps(32767.0f);
+    while (end - dest >= 8)
+    {
+        __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), minValue), maxValue));
+        __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + 4), minValue), maxValue));
+        _mm_storeu_si128((__m128i*)dest, _mm_packs_epi32(a, b));
+        src += 8;
+        dest += 8;
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    while (end - dest >= 8)
+    {
+        // The conversion and narrowing both saturate
+        int16x4_t a = vqmovn_s32(vcvtq_s32_f32(vld1q_f32(src)));
+        int16x4_t b = vqmovn_s32(vcvtq_s32_f32(vld1q_f32(src + 4)));
+        vst1q_s16(dest, vcombine_s16(a, b));
+        src += 8;
+        dest += 8;
+    }
+#endif
+
+    while (dest < end)
+        *dest++ = (short)Clamp(*src++, -32768.0f, 32767.0f);
+}
+#endif
+
 Audio::Audio(Context* context) :
     Object(context),
+    commandWrite_(0),
+    commandRead_(0),
     deviceID_(0),
     sampleSize_(0),
-    playing_(false)
+    playing_(false),
+    maxVoices_(0),
+    virtualThreshold_(DEFAULT_VIRTUAL_THRESHOLD),
+    streamLookAhead_(DEFAULT_STREAM_LOOKAHEAD),
+    numVirtualSources_(0)
 {
     // Set the master to the default value
     masterGain_[SOUND_MASTER_HASH] = 1.0f;
 
+    commands_ = new AudioCommand[AUDIO_COMMAND_BUFFER_SIZE];
+
     // Register Audio library object factories
     RegisterAudioLibrary(context_);
 
@@ -65,6 +124,12 @@ Audio::Audio(Context* context) :
 Audio::~Audio()
 {
     Release();
+
+    // With the audio thread stopped, free the voices. Remaining sound sources no longer access them once the subsystem is gone
+    ProcessCommands();
+    for (PODVector<SoundVoice*>::Iterator i = voices_.Begin(); i != voices_.End(); ++i)
+        delete *i;
+    voices_.Clear();
 }
 
 bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpolation)
@@ -78,13 +143,13 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
     SDL_AudioSpec obtained;
 
     desired.freq = mixRate;
-
-// The concept behind the emspcripten audio port is to treat it as 16 bit until the final acumulation form the clip buffer
-#ifdef EMSCRIPTEN
+
+// The concept behind the emspcripten audio port is to treat it as 16 bit until the final acumulation form the clip buffer
+#ifdef EMSCRIPTEN
     desired.format = AUDIO_F32LSB;
-#else
+#else
     desired.format = AUDIO_S16;
-#endif
+#endif
     desired.channels = stereo ? 2 : 1;
     desired.callback = SDLAudioCallback;
     desired.userdata = this;
@@ -100,17 +165,17 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
     {
         LOGERROR("Could not initialize audio output");
         return false;
-    }
-
-#ifdef EMSCRIPTEN
+    }
+
+#ifdef EMSCRIPTEN
     if (obtained.format != AUDIO_F32LSB && obtained.format != AUDIO_F32MSB && obtained.format != AUDIO_F32SYS)
-    {
+    {
         LOGERROR("Could not initialize audio output, 32-bit float buffer format not supported");
         SDL_CloseAudioDevice(deviceID_);
         deviceID_ = 0;
         return false;
-    }
-#else
+    }
+#else
     if (obtained.format != AUDIO_S16SYS && obtained.format != AUDIO_S16LSB && obtained.format != AUDIO_S16MSB)
     {
         LOGERROR("Could not initialize audio output, 16-bit buffer format not supported");
@@ -118,7 +183,7 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
         deviceID_ = 0;
         return false;
     }
-#endif
+#endif
 
     stereo_ = obtained.channels == 2;
     sampleSize_ = stereo_ ? sizeof(int) : sizeof(short);
@@ -126,7 +191,7 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
     fragmentSize_ = Min((int)NextPowerOfTwo(mixRate >> 6), (int)obtained.samples);
     mixRate_ = obtained.freq;
     interpolation_ = interpolation;
-    clipBuffer_ = new int[stereo ? fragmentSize_ << 1 : fragmentSize_];
+    clipBuffer_ = new float[stereo ? fragmentSize_ << 1 : fragmentSize_];
 
     LOGINFO("Set audio mode " + String(mixRate_) + " Hz " + (stereo_ ? "stereo" : "mono") + " " +
         (interpolation_ ? "interpolated" : ""));
@@ -137,10 +202,22 @@ bool Audio::SetMode(int bufferLengthMSec, int mixRate, bool stereo, bool interpo
 void Audio::Update(float timeStep)
 {
     PROFILE(UpdateAudio);
+    MEMORY_TAG(MEMTAG_AUDIO);
+
+    // Without audio output there is no audio thread, so process the commands here
+    if (!deviceID_)
+        ProcessCommands();
 
     // Update in reverse order, because sound sources might remove themselves
     for (unsigned i = soundSources_.Size() - 1; i < soundSources_.Size(); --i)
         soundSources_[i]->Update(timeStep);
+
+    // Decide virtual sound sources after the updates, which calculate the 3D attenuation, then send the changed parameters
+    UpdateVoices();
+    for (PODVector<SoundSource*>::Iterator i = soundSources_.Begin(); i != soundSources_.End(); ++i)
+        (*i)->UpdateVoiceParameters();
+
+    FreeRetiredObjects();
 }
 
 bool Audio::Play()
@@ -187,6 +264,21 @@ void Audio::StopSound(Sound* soundClip)
     }
 }
 
+void Audio::SetMaxVoices(unsigned voices)
+{
+    maxVoices_ = voices;
+}
+
+void Audio::SetVirtualThreshold(float threshold)
+{
+    virtualThreshold_ = Max(threshold, 0.0f);
+}
+
+void Audio::SetStreamLookAhead(float seconds)
+{
+    streamLookAhead_ = Max(seconds, 0.0f);
+}
+
 float Audio::GetMasterGain(const String& type) const
 {
     // By definition previously unknown types return full volume
@@ -204,8 +296,8 @@ SoundListener* Audio::GetListener() const
 
 void Audio::AddSoundSource(SoundSource* channel)
 {
-    MutexLock lock(audioMutex_);
     soundSources_.Push(channel);
+    PushCommand(AudioCommand(AC_ADDVOICE, channel->GetVoice()));
 }
 
 void Audio::RemoveSoundSource(SoundSource* channel)
@@ -213,9 +305,35 @@ void Audio::RemoveSoundSource(SoundSource* channel)
     PODVector<SoundSource*>::Iterator i = soundSources_.Find(channel);
     if (i != soundSources_.End())
     {
-        MutexLock lock(audioMutex_);
         soundSources_.Erase(i);
+        PushCommand(AudioCommand(AC_REMOVEVOICE, channel->GetVoice()));
+    }
+}
+
+unsigned Audio::PushCommand(const AudioCommand& command)
+{
+    // The audio thread never waits for the main thread. If the ring buffer is full, the main thread waits instead
+    while (commandWrite_ - commandRead_ >= AUDIO_COMMAND_BUFFER_SIZE)
+    {
+        if (!deviceID_)
+            ProcessCommands();
+        else
+            Time::Sleep(1);
     }
+    AudioMemoryBarrier();
+
+    commands_[commandWrite_ & (AUDIO_COMMAND_BUFFER_SIZE - 1)] = command;
+    AudioMemoryBarrier();
+    commandWrite_ = commandWrite_ + 1;
+    return commandWrite_;
+}
+
+void Audio::RetireObject(RefCounted* object)
+{
+    RetiredAudioObject retired;
+    retired.sequence_ = commandWrite_;
+    retired.object_ = object;
+    retiredObjects_.Push(retired);
 }
 
 float Audio::GetSoundSourceMasterGain(StringHash typeHash) const
@@ -236,14 +354,16 @@ float Audio::GetSoundSourceMasterGain(StringHash typeHash) const
 void SDLAudioCallback(void *userdata, Uint8* stream, int len)
 {
     Audio* audio = static_cast<Audio*>(userdata);
-    {
-        MutexLock Lock(audio->GetMutex());
-        audio->MixOutput(stream, len / audio->GetSampleSize() / Audio::SAMPLE_SIZE_MUL);
-    }
+    audio->MixOutput(stream, len / audio->GetSampleSize() / Audio::SAMPLE_SIZE_MUL);
 }
 
 void Audio::MixOutput(void *dest, unsigned samples)
 {
+    PROFILE(MixOutput);
+    MEMORY_TAG(MEMTAG_AUDIO);
+
+    ProcessCommands();
+
     if (!playing_ || !clipBuffer_)
     {
         memset(dest, 0, samples * sampleSize_ * SAMPLE_SIZE_MUL);
@@ -259,22 +379,20 @@ void Audio::MixOutput(void *dest, unsigned samples)
             clipSamples <<= 1;
 
         // Clear clip buffer
-        int* clipPtr = clipBuffer_.Get();
-        memset(clipPtr, 0, clipSamples * sizeof(int));
+        float* clipPtr = clipBuffer_.Get();
+        memset(clipPtr, 0, clipSamples * sizeof(float));
 
         // Mix samples to clip buffer
-        for (PODVector<SoundSource*>::Iterator i = soundSources_.Begin(); i != soundSources_.End(); ++i)
+        for (PODVector<SoundVoice*>::Iterator i = voices_.Begin(); i != voices_.End(); ++i)
             (*i)->Mix(clipPtr, workSamples, mixRate_, stereo_, interpolation_);
 
-        // Copy output from clip buffer to destination
-#ifdef EMSCRIPTEN
+        // Copy output from clip buffer to destination
+#ifdef EMSCRIPTEN
         float* destPtr = (float*)dest;
         while (clipSamples--)
-            *destPtr++ = (float)Clamp(*clipPtr++, -32768, 32767) / 32768.0f;
-#else
-        short* destPtr = (short*)dest;
-        while (clipSamples--)
-            *destPtr++ = Clamp(*clipPtr++, -32768, 32767);
+            *destPtr++ = Clamp(*clipPtr++, -32768.0f, 32767.0f) / 32768.0f;
+#else
+        ClipSamples((short*)dest, clipPtr, clipSamples);
 #endif
         samples -= workSamples;
         ((unsigned char*&)dest) += sampleSize_ * SAMPLE_SIZE_MUL * workSamples;
@@ -288,6 +406,106 @@ void Audio::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
     Update(eventData[P_TIMESTEP].GetFloat());
 }
 
+void Audio::UpdateVoices()
+{
+    PROFILE(UpdateVoices);
+
+    audibleSources_.Clear();
+    numVirtualSources_ = 0;
+
+    for (PODVector<SoundSource*>::Iterator i = soundSources_.Begin(); i != soundSources_.End(); ++i)
+    {
+        SoundSource* source = *i;
+        if (!source->IsPlaying())
+            source->SetVirtual(false);
+        else if (source->GetAudibility() < virtualThreshold_)
+        {
+            source->SetVirtual(true);
+            ++numVirtualSources_;
+        }
+        else
+            audibleSources_.Push(source);
+    }
+
+    // Virtualize the least important playing sound sources over the voice limit
+    if (maxVoices_ && audibleSources_.Size() > maxVoices_)
+    {
+        Sort(audibleSources_.Begin(), audibleSources_.End(), CompareVoices);
+        for (unsigned i = maxVoices_; i < audibleSources_.Size(); ++i)
+        {
+            audibleSources_[i]->SetVirtual(true);
+            ++numVirtualSources_;
+        }
+        audibleSources_.Resize(maxVoices_);
+    }
+
+    for (PODVector<SoundSource*>::Iterator i = audibleSources_.Begin(); i != audibleSources_.End(); ++i)
+        (*i)->SetVirtual(false);
+}
+
+void Audio::ProcessCommands()
+{
+    unsigned write = commandWrite_;
+    AudioMemoryBarrier();
+
+    unsigned read = commandRead_;
+    while (read != write)
+    {
+        const AudioCommand& command = commands_[read & (AUDIO_COMMAND_BUFFER_SIZE - 1)];
+        SoundVoice* voice = command.voice_;
+
+        switch (command.type_)
+        {
+        case AC_ADDVOICE:
+            voices_.Push(voice);
+            break;
+
+        case AC_REMOVEVOICE:
+            voices_.Remove(voice);
+            delete voice;
+            break;
+
+        case AC_PLAY:
+            voice->Play(command.sound_);
+            break;
+
+        case AC_PLAYSTREAM:
+            voice->Play(command.sound_, command.stream_, command.streamBuffer_);
+            break;
+
+        case AC_STOP:
+            voice->Stop();
+            break;
+
+        case AC_SETPOSITION:
+            voice->SetPlayPosition(command.sound_, command.position_);
+            break;
+
+        case AC_SETPARAMETERS:
+            voice->SetParameters(command.parameters_);
+            break;
+        }
+
+        ++read;
+        // Publish the voice changes and free the command slot
+        AudioMemoryBarrier();
+        commandRead_ = read;
+    }
+}
+
+void Audio::FreeRetiredObjects()
+{
+    unsigned count = 0;
+    while (count < retiredObjects_.Size() && !IsCommandPending(retiredObjects_[count].sequence_))
+        ++count;
+
+    if (count)
+    {
+        AudioMemoryBarrier();
+        retiredObjects_.Erase(0, count);
+    }
+}
+
 void Audio::Release()
 {
     Stop();
@@ -300,6 +518,15 @@ void Audio::Release()
     }
 }
 
+void AudioMemoryBarrier()
+{
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
 void RegisterAudioLibrary(Context* context)
 {
     Sound::RegisterObject(context);
@@ -24,7 +24,7 @@
 
 #include "../Container/ArrayPtr.h"
 #include "../Audio/AudioDefs.h"
-#include "../Core/Mutex.h"
+#include "../Audio/SoundSource.h"
 #include "../Core/Object.h"
 
 namespace Urho3D
@@ -35,6 +35,68 @@ class Sound;
 class SoundListener;
 class SoundSource;
 
+/// Audio thread command type.
+enum AudioCommandType
+{
+    AC_ADDVOICE = 0,
+    AC_REMOVEVOICE,
+    AC_PLAY,
+    AC_PLAYSTREAM,
+    AC_STOP,
+    AC_SETPOSITION,
+    AC_SETPARAMETERS
+};
+
+/// Command from the main thread to the audio thread.
+struct AudioCommand
+{
+    /// Construct undefined.
+    AudioCommand() :
+        type_(AC_STOP),
+        voice_(0),
+        sound_(0),
+        stream_(0),
+        streamBuffer_(0),
+        position_(0)
+    {
+    }
+
+    /// Construct with type and voice.
+    AudioCommand(AudioCommandType type, SoundVoice* voice) :
+        type_(type),
+        voice_(voice),
+        sound_(0),
+        stream_(0),
+        streamBuffer_(0),
+        position_(0)
+    {
+    }
+
+    /// Command type.
+    AudioCommandType type_;
+    /// Target voice.
+    SoundVoice* voice_;
+    /// Sound to play.
+    Sound* sound_;
+    /// Sound stream to play.
+    SoundStream* stream_;
+    /// Stream buffer to play the stream through.
+    Sound* streamBuffer_;
+    /// Playback position.
+    signed char* position_;
+    /// Mixing parameters.
+    SoundVoiceParameters parameters_;
+};
+
+/// Object kept alive until the audio thread no longer uses it.
+struct RetiredAudioObject
+{
+    /// Command sequence number after which the object can be freed.
+    unsigned sequence_;
+    /// Object.
+    SharedPtr<RefCounted> object_;
+};
+
 /// %Audio subsystem.
 class URHO3D_API Audio : public Object
 {
@@ -60,6 +122,12 @@ public:
     void SetListener(SoundListener* listener);
     /// Stop any sound source playing a certain sound clip.
     void StopSound(Sound* sound);
+    /// Set maximum number of mixed sound sources. Sound sources over the limit with the lowest priority multiplied by gain become virtual. 0 (default) is unlimited.
+    void SetMaxVoices(unsigned voices);
+    /// Set effective gain below which sound sources become virtual and are not mixed.
+    void SetVirtualThreshold(float threshold);
+    /// Set length in seconds of compressed sound data decoded ahead on worker threads. 0 decodes in the audio thread while mixing. Applies to sounds started afterward.
+    void SetStreamLookAhead(float seconds);
 
     /// Return byte size of one sample.
     unsigned GetSampleSize() const { return sampleSize_; }
@@ -77,6 +145,14 @@ public:
     float GetMasterGain(const String& type) const;
     /// Return active sound listener.
     SoundListener* GetListener() const;
+    /// Return maximum number of mixed sound sources.
+    unsigned GetMaxVoices() const { return maxVoices_; }
+    /// Return effective gain below which sound sources become virtual.
+    float GetVirtualThreshold() const { return virtualThreshold_; }
+    /// Return length in seconds of compressed sound data decoded ahead on worker threads.
+    float GetStreamLookAhead() const { return streamLookAhead_; }
+    /// Return number of virtual sound sources after the last update.
+    unsigned GetNumVirtualSources() const { return numVirtualSources_; }
     /// Return all sound sources.
     const PODVector<SoundSource*>& GetSoundSources() const { return soundSources_; }
 
@@ -87,14 +163,18 @@ public:
     void AddSoundSource(SoundSource* soundSource);
     /// Remove a sound source. Called by SoundSource.
     void RemoveSoundSource(SoundSource* soundSource);
-    /// Return audio thread mutex.
-    Mutex& GetMutex() { return audioMutex_; }
+    /// Queue a command to the audio thread and return its sequence number. Called by SoundSource.
+    unsigned PushCommand(const AudioCommand& command);
+    /// Keep an object alive until the audio thread has processed all commands queued so far. Called by SoundSource.
+    void RetireObject(RefCounted* object);
+    /// Return whether the command with the sequence number has not been processed yet.
+    bool IsCommandPending(unsigned sequence) const { return (int)(sequence - commandRead_) > 0; }
     /// Return sound type specific gain multiplied by master gain.
     float GetSoundSourceMasterGain(StringHash typeHash) const;
 
     /// Mix sound sources into the buffer.
     void MixOutput(void *dest, unsigned samples);
-
+
     /// Final multiplier for for audio byte conversion
 #ifdef EMSCRIPTEN
     static const int SAMPLE_SIZE_MUL = 2;
@@ -106,10 +186,24 @@ private:
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
     /// Stop sound output and release the sound buffer.
     void Release();
-    /// Clipping buffer for mixing.
-    SharedArrayPtr<int> clipBuffer_;
-    /// Audio thread mutex.
-    Mutex audioMutex_;
+    /// Choose which playing sound sources are mixed and which are virtual.
+    void UpdateVoices();
+    /// Apply the queued commands to the voices. Called by the audio thread, or by the main thread when there is no audio output.
+    void ProcessCommands();
+    /// Free the retired objects that are no longer used by the audio thread.
+    void FreeRetiredObjects();
+    /// Float mix buffer, clipped on output.
+    SharedArrayPtr<float> clipBuffer_;
+    /// Command ring buffer from the main thread to the audio thread.
+    SharedArrayPtr<AudioCommand> commands_;
+    /// Command write count. Written only by the main thread.
+    volatile unsigned commandWrite_;
+    /// Command read count. Written only by the audio thread.
+    volatile unsigned commandRead_;
+    /// Voices mixed by the audio thread.
+    PODVector<SoundVoice*> voices_;
+    /// Objects waiting to be freed once the audio thread no longer uses them.
+    Vector<RetiredAudioObject> retiredObjects_;
     /// SDL audio device ID.
     unsigned deviceID_;
     /// Sample size.
@@ -128,10 +222,22 @@ private:
     HashMap<StringHash, Variant> masterGain_;
     /// Sound sources.
     PODVector<SoundSource*> soundSources_;
+    /// Audible sound sources sorted by priority during voice update.
+    PODVector<SoundSource*> audibleSources_;
+    /// Maximum number of mixed sound sources, 0 for unlimited.
+    unsigned maxVoices_;
+    /// Effective gain below which sound sources become virtual.
+    float virtualThreshold_;
+    /// Length of compressed sound data decoded ahead in seconds.
+    float streamLookAhead_;
+    /// Number of virtual sound sources after the last update.
+    unsigned numVirtualSources_;
     /// Sound listener.
     WeakPtr<SoundListener> listener_;
 };
 
+/// Order memory accesses around the counters shared by the main, worker and audio threads.
+void URHO3D_API AudioMemoryBarrier();
 /// Register Audio library objects.
 void URHO3D_API RegisterAudioLibrary(Context* context);
 
@@ -20,9 +20,13 @@
 // THE SOFTWARE.
 //
 
+#include "../Audio/Audio.h"
 #include "../Audio/OggVorbisSoundStream.h"
 #include "../Audio/Sound.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
 
+#include <cstring>
 #include <STB/stb_vorbis.h>
 
 #include "../DebugNew.h"
@@ -30,7 +34,19 @@
 namespace Urho3D
 {
 
-OggVorbisSoundStream::OggVorbisSoundStream(const Sound* sound)
+/// Queue more decoding when at least this fraction of the ring buffer is free.
+static const unsigned DECODE_FREE_DIVISOR = 4;
+
+static void DecodeAheadWork(const WorkItem* item, unsigned threadIndex)
+{
+    static_cast<OggVorbisSoundStream*>(item->aux_)->DecodeAhead();
+}
+
+OggVorbisSoundStream::OggVorbisSoundStream(const Sound* sound) :
+    ringSize_(0),
+    ringWrite_(0),
+    ringRead_(0),
+    decodeEnded_(false)
 {
     assert(sound && sound->IsCompressed());
     
@@ -47,6 +63,16 @@ OggVorbisSoundStream::OggVorbisSoundStream(const Sound* sound)
 
 OggVorbisSoundStream::~OggVorbisSoundStream()
 {
+    // If a decode is queued or in progress, it must not outlive the stream
+    if (decodeItem_ && decodeItem_->IsSubmitted() && !decodeItem_->completed_)
+    {
+        if (workQueue_ && !workQueue_->RemoveWorkItem(decodeItem_))
+        {
+            while (!decodeItem_->completed_)
+                Time::Sleep(0);
+        }
+    }
+
     // Close decoder
     if (decoder_)
     {
@@ -61,7 +87,99 @@ unsigned OggVorbisSoundStream::GetData(signed char* dest, unsigned numBytes)
 {
     if (!decoder_)
         return 0;
-    
+    if (!ringBuffer_)
+        return Decode(dest, numBytes);
+
+    // Check for the end first, so that all data decoded before it is seen
+    bool ended = decodeEnded_;
+    unsigned read = ringRead_;
+    unsigned available = ringWrite_ - read;
+    AudioMemoryBarrier();
+
+    unsigned outBytes = Min((int)available, (int)numBytes);
+    unsigned offset = read & (ringSize_ - 1);
+    unsigned firstBytes = Min((int)outBytes, (int)(ringSize_ - offset));
+    memcpy(dest, ringBuffer_.Get() + offset, firstBytes);
+    memcpy(dest + firstBytes, ringBuffer_.Get(), outBytes - firstBytes);
+
+    AudioMemoryBarrier();
+    ringRead_ = read + outBytes;
+
+    // If decoding has fallen behind, output silence instead, as producing no data would stop the playback
+    if (outBytes < numBytes && !ended)
+    {
+        memset(dest + outBytes, 0, numBytes - outBytes);
+        outBytes = numBytes;
+    }
+
+    return outBytes;
+}
+
+void OggVorbisSoundStream::Update()
+{
+    // The item can only be added again once the work queue has purged it after completion, which happens on the next frame
+    if (!ringBuffer_ || decodeEnded_ || !workQueue_ || (decodeItem_ && decodeItem_->IsSubmitted()))
+        return;
+
+    unsigned free = ringSize_ - (ringWrite_ - ringRead_);
+    if (free < ringSize_ / DECODE_FREE_DIVISOR)
+        return;
+
+    if (!decodeItem_)
+    {
+        decodeItem_ = new WorkItem();
+        decodeItem_->workFunction_ = DecodeAheadWork;
+        decodeItem_->aux_ = this;
+        decodeItem_->priority_ = 0;
+    }
+    workQueue_->AddWorkItem(decodeItem_);
+}
+
+void OggVorbisSoundStream::SetLookAhead(WorkQueue* queue, float seconds)
+{
+    if (!decoder_ || ringBuffer_ || !queue || seconds <= 0.0f)
+        return;
+
+    workQueue_ = queue;
+    ringSize_ = NextPowerOfTwo((unsigned)(seconds * (float)frequency_) * GetSampleSize());
+    ringBuffer_ = new signed char[ringSize_];
+
+    // Decode the first part right away, so that playback does not start with silence
+    unsigned prefillBytes = ringSize_ / DECODE_FREE_DIVISOR;
+    ringWrite_ = Decode(ringBuffer_.Get(), prefillBytes);
+    if (!ringWrite_ || (ringWrite_ < prefillBytes && stopAtEnd_))
+        decodeEnded_ = true;
+}
+
+void OggVorbisSoundStream::DecodeAhead()
+{
+    unsigned write = ringWrite_;
+    unsigned free = ringSize_ - (write - ringRead_);
+    AudioMemoryBarrier();
+
+    while (free && !decodeEnded_)
+    {
+        unsigned offset = write & (ringSize_ - 1);
+        unsigned bytes = Min((int)free, (int)(ringSize_ - offset));
+        unsigned outBytes = Decode(ringBuffer_.Get() + offset, bytes);
+
+        write += outBytes;
+        free -= outBytes;
+        AudioMemoryBarrier();
+        ringWrite_ = write;
+
+        // Publish the end after the data, so that the mixing thread does not miss the last data. A looped sound
+        // rewinds while decoding, so it only ends if it produces nothing
+        if (!outBytes || (outBytes < bytes && stopAtEnd_))
+        {
+            AudioMemoryBarrier();
+            decodeEnded_ = true;
+        }
+    }
+}
+
+unsigned OggVorbisSoundStream::Decode(signed char* dest, unsigned numBytes)
+{
     stb_vorbis* vorbis = static_cast<stb_vorbis*>(decoder_);
     
     unsigned channels = stereo_ ? 2 : 1;
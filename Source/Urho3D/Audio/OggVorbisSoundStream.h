@@ -23,12 +23,15 @@
 #pragma once
 
 #include "../Container/ArrayPtr.h"
+#include "../Container/Ptr.h"
 #include "../Audio/SoundStream.h"
 
 namespace Urho3D
 {
 
 class Sound;
+class WorkQueue;
+struct WorkItem;
 
 /// Ogg Vorbis sound stream.
 class URHO3D_API OggVorbisSoundStream : public SoundStream
@@ -41,14 +44,42 @@ public:
     
     /// Produce sound data into destination. Return number of bytes produced. Called by SoundSource from the mixing thread.
     virtual unsigned GetData(signed char* dest, unsigned numBytes);
+    /// Queue decoding ahead on a worker thread when the ring buffer has room. Called by SoundSource from the main thread.
+    virtual void Update();
+    
+    /// Decode ahead on worker threads into a ring buffer of the specified length in seconds, so that the mixing thread only copies the decoded data. Must be called before playback starts.
+    void SetLookAhead(WorkQueue* queue, float seconds);
+    /// Decode into the ring buffer until it is full. Called from a worker thread.
+    void DecodeAhead();
+    
+    /// Return whether decodes ahead on worker threads.
+    bool IsDecodingAhead() const { return ringBuffer_.NotNull(); }
     
 protected:
+    /// Decode directly into the destination. Return number of bytes produced.
+    unsigned Decode(signed char* dest, unsigned numBytes);
+    
+
     /// Decoder state.
     void* decoder_;
     /// Compressed sound data.
     SharedArrayPtr<signed char> data_;
     /// Compressed sound data size in bytes.
     unsigned dataSize_;
+    /// Work queue for decoding ahead.
+    WeakPtr<WorkQueue> workQueue_;
+    /// Work item for decoding ahead.
+    SharedPtr<WorkItem> decodeItem_;
+    /// Decoded data ring buffer.
+    SharedArrayPtr<signed char> ringBuffer_;
+    /// Ring buffer size in bytes. Always a power of two.
+    unsigned ringSize_;
+    /// Bytes written to the ring buffer. Written only by the decoding thread.
+    volatile unsigned ringWrite_;
+    /// Bytes read from the ring buffer. Written only by the mixing thread.
+    volatile unsigned ringRead_;
+    /// Whether decoding has reached the end of a non-looped sound.
+    volatile bool decodeEnded_;
 };
 
 }
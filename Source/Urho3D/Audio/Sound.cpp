@@ -23,6 +23,7 @@
 #include "../Core/Context.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Audio/AdpcmSoundStream.h"
 #include "../Audio/OggVorbisSoundStream.h"
 #include "../Core/Profiler.h"
 #include "../Resource/ResourceCache.h"
@@ -57,6 +58,12 @@ struct WavHeader
 
 static const unsigned IP_SAFETY = 4;
 
+static const unsigned short WAVE_FORMAT_PCM = 1;
+static const unsigned short WAVE_FORMAT_MSADPCM = 2;
+static const unsigned short WAVE_FORMAT_IMAADPCM = 0x11;
+/// Maximum number of MS ADPCM coefficient pairs accepted.
+static const unsigned MAX_ADPCM_COEFFICIENTS = 256;
+
 Sound::Sound(Context* context) :
     Resource(context),
     repeat_(0),
@@ -67,7 +74,11 @@ Sound::Sound(Context* context) :
     sixteenBit_(false),
     stereo_(false),
     compressed_(false),
-    compressedLength_(0.0f)
+    compression_(SC_NONE),
+    compressedLength_(0.0f),
+    blockAlign_(0),
+    numSamples_(0),
+    numAdpcmCoefficients_(0)
 {
 }
 
@@ -125,6 +136,7 @@ bool Sound::LoadOggVorbis(Deserializer& source)
     dataSize_ = dataSize;
     sixteenBit_ = true;
     compressed_ = true;
+    compression_ = SC_OGGVORBIS;
     
     SetMemoryUse(dataSize);
     return true;
@@ -169,24 +181,60 @@ bool Sound::LoadWav(Deserializer& source)
     header.avgBytes_ = source.ReadUInt();
     header.blockAlign_ = source.ReadUShort();
     header.bits_ = source.ReadUShort();
-    
-    // Skip data if the format chunk was bigger than what we use
-    source.Seek(source.GetPosition() + header.formatLength_ - 16);
+    unsigned formatRead = 16;
     
     // Check for correct format
-    if (header.format_ != 1)
+    bool adpcm = header.format_ == WAVE_FORMAT_IMAADPCM || header.format_ == WAVE_FORMAT_MSADPCM;
+    if ((header.format_ != WAVE_FORMAT_PCM && !adpcm) || (adpcm && (header.bits_ != 4 || !header.channels_ ||
+        header.channels_ > 2)))
+    {
+        LOGERROR("Could not read WAV data from " + source.GetName());
+        return false;
+    }
+    
+    // Read the MS ADPCM coefficients from the extended format
+    SharedArrayPtr<short> coefficients;
+    unsigned numCoefficients = 0;
+    if (header.format_ == WAVE_FORMAT_MSADPCM && header.formatLength_ >= 22)
+    {
+        source.ReadUShort(); // Extra format size
+        source.ReadUShort(); // Samples per block
+        numCoefficients = source.ReadUShort();
+        formatRead += 6;
+        if (!numCoefficients || numCoefficients > MAX_ADPCM_COEFFICIENTS || formatRead + numCoefficients * 4 >
+            header.formatLength_)
+        {
+            LOGERROR("Could not read WAV data from " + source.GetName());
+            return false;
+        }
+        
+        coefficients = new short[numCoefficients * 2];
+        for (unsigned i = 0; i < numCoefficients * 2; ++i)
+            coefficients[i] = source.ReadShort();
+        formatRead += numCoefficients * 4;
+    }
+    else if (header.format_ == WAVE_FORMAT_MSADPCM)
     {
         LOGERROR("Could not read WAV data from " + source.GetName());
         return false;
     }
     
-    // Search for the DATA chunk
+    // Skip data if the format chunk was bigger than what we use
+    source.Seek(source.GetPosition() + header.formatLength_ - formatRead);
+    
+    // Search for the DATA chunk. The FACT chunk gives the exact sample count of compressed data
+    unsigned factSamples = 0;
     for (;;)
     {
         source.Read(&header.dataText_, 4);
         header.dataLength_ = source.ReadUInt();
         if (!memcmp("data", &header.dataText_, 4))
             break;
+        if (!memcmp("fact", &header.dataText_, 4) && header.dataLength_ >= 4)
+        {
+            factSamples = source.ReadUInt();
+            header.dataLength_ -= 4;
+        }
         
         source.Seek(source.GetPosition() + header.dataLength_);
         if (!header.dataLength_ || source.GetPosition() >= source.GetSize())
@@ -196,6 +244,10 @@ bool Sound::LoadWav(Deserializer& source)
         }
     }
     
+    if (adpcm)
+        return LoadAdpcm(source, header.format_ == WAVE_FORMAT_MSADPCM ? SC_MSADPCM : SC_IMAADPCM, header.dataLength_,
+            header.frequency_, header.channels_ == 2, header.blockAlign_, factSamples, coefficients, numCoefficients);
+    
     // Allocate sound and load audio data
     unsigned length = header.dataLength_;
     SetSize(length);
@@ -212,6 +264,47 @@ bool Sound::LoadWav(Deserializer& source)
     return true;
 }
 
+bool Sound::LoadAdpcm(Deserializer& source, SoundCompression compression, unsigned dataSize, unsigned frequency, bool stereo,
+    unsigned blockAlign, unsigned numSamples, SharedArrayPtr<short> coefficients, unsigned numCoefficients)
+{
+    unsigned channels = stereo ? 2 : 1;
+    unsigned blockSamples = compression == SC_MSADPCM ? GetMsAdpcmBlockSamples(blockAlign, channels) :
+        GetImaAdpcmBlockSamples(blockAlign, channels);
+    unsigned numBlocks = blockAlign ? dataSize / blockAlign : 0;
+    if (!blockSamples || !numBlocks || !frequency)
+    {
+        LOGERROR("Could not read ADPCM data from " + source.GetName());
+        return false;
+    }
+    
+    // Without the FACT chunk, assume the last block is fully used
+    if (!numSamples || numSamples > numBlocks * blockSamples)
+        numSamples = numBlocks * blockSamples;
+    
+    SharedArrayPtr<signed char> data(new signed char[dataSize]);
+    if (source.Read(data.Get(), dataSize) != dataSize)
+    {
+        LOGERROR("Could not read ADPCM data from " + source.GetName());
+        return false;
+    }
+    
+    data_ = data;
+    dataSize_ = dataSize;
+    frequency_ = frequency;
+    sixteenBit_ = true;
+    stereo_ = stereo;
+    compressed_ = true;
+    compression_ = compression;
+    compressedLength_ = (float)numSamples / (float)frequency;
+    blockAlign_ = blockAlign;
+    numSamples_ = numSamples;
+    adpcmCoefficients_ = coefficients;
+    numAdpcmCoefficients_ = numCoefficients;
+    
+    SetMemoryUse(dataSize);
+    return true;
+}
+
 bool Sound::LoadRaw(Deserializer& source)
 {
     unsigned dataSize = source.GetSize();
@@ -311,7 +404,12 @@ void Sound::FixInterpolation()
 
 SharedPtr<SoundStream> Sound::GetDecoderStream() const
 {
-    return compressed_ ? SharedPtr<SoundStream>(new OggVorbisSoundStream(this)) : SharedPtr<SoundStream>();
+    if (!compressed_)
+        return SharedPtr<SoundStream>();
+    else if (compression_ == SC_IMAADPCM || compression_ == SC_MSADPCM)
+        return SharedPtr<SoundStream>(new AdpcmSoundStream(this));
+    else
+        return SharedPtr<SoundStream>(new OggVorbisSoundStream(this));
 }
 
 float Sound::GetLength() const
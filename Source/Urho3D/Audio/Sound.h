@@ -30,6 +30,15 @@ namespace Urho3D
 
 class SoundStream;
 
+/// Compressed sound data format.
+enum SoundCompression
+{
+    SC_NONE = 0,
+    SC_OGGVORBIS,
+    SC_IMAADPCM,
+    SC_MSADPCM
+};
+
 /// %Sound resource.
 class URHO3D_API Sound : public Resource
 {
@@ -48,7 +57,7 @@ public:
     
     /// Load raw sound data.
     bool LoadRaw(Deserializer& source);
-    /// Load WAV format sound data.
+    /// Load WAV format sound data. IMA and MS ADPCM data is not decoded at load, but will rather be decoded while playing.
     bool LoadWav(Deserializer& source);
     /// Load Ogg Vorbis format sound data. Does not decode at load, but will rather be decoded while playing.
     bool LoadOggVorbis(Deserializer& source);
@@ -91,6 +100,16 @@ public:
     bool IsStereo() const { return stereo_; }
     /// Return whether is compressed.
     bool IsCompressed() const { return compressed_; }
+    /// Return compressed data format.
+    SoundCompression GetCompression() const { return compressed_ ? compression_ : SC_NONE; }
+    /// Return ADPCM block size in bytes.
+    unsigned GetBlockAlign() const { return blockAlign_; }
+    /// Return number of samples per channel in ADPCM data.
+    unsigned GetNumSamples() const { return numSamples_; }
+    /// Return MS ADPCM coefficient pairs.
+    SharedArrayPtr<short> GetAdpcmCoefficients() const { return adpcmCoefficients_; }
+    /// Return number of MS ADPCM coefficient pairs.
+    unsigned GetNumAdpcmCoefficients() const { return numAdpcmCoefficients_; }
     
     /// Fix interpolation by copying data from loop start to loop end (looped), or adding silence (oneshot.) Called internally, does not normally need to be called, unless the sound data is modified manually on the fly.
     void FixInterpolation();
@@ -98,6 +117,9 @@ public:
 private:
     /// Load optional parameters from an XML file.
     void LoadParameters();
+    /// Store ADPCM sound data from a WAV file.
+    bool LoadAdpcm(Deserializer& source, SoundCompression compression, unsigned dataSize, unsigned frequency, bool stereo,
+        unsigned blockAlign, unsigned numSamples, SharedArrayPtr<short> coefficients, unsigned numCoefficients);
     
     /// Sound data.
     SharedArrayPtr<signed char> data_;
@@ -117,8 +139,18 @@ private:
     bool stereo_;
     /// Compressed flag.
     bool compressed_;
+    /// Compressed data format.
+    SoundCompression compression_;
     /// Compressed sound length.
     float compressedLength_;
+    /// ADPCM block size in bytes.
+    unsigned blockAlign_;
+    /// Number of samples per channel in ADPCM data.
+    unsigned numSamples_;
+    /// MS ADPCM coefficient pairs.
+    SharedArrayPtr<short> adpcmCoefficients_;
+    /// Number of MS ADPCM coefficient pairs.
+    unsigned numAdpcmCoefficients_;
 };
 
 }
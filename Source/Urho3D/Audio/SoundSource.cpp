@@ -21,7 +21,9 @@
 //
 
 #include "../Audio/Audio.h"
+#include "../Audio/OggVorbisSoundStream.h"
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
 #include "../Resource/ResourceCache.h"
 #include "../Audio/Sound.h"
 #include "../Audio/SoundSource.h"
@@ -34,302 +36,356 @@
 namespace Urho3D
 {
 
-#define INC_POS_LOOPED() \
-    pos += intAdd; \
-    fractPos += fractAdd; \
-    if (fractPos > 65535) \
-    { \
-        fractPos &= 65535; \
-        ++pos; \
-    } \
-    while (pos >= end) \
-        pos -= (end - repeat); \
-
-#define INC_POS_ONESHOT() \
-    pos += intAdd; \
-    fractPos += fractAdd; \
-    if (fractPos > 65535) \
-    { \
-        fractPos &= 65535; \
-        ++pos; \
-    } \
-    if (pos >= end) \
-    { \
-        pos = 0; \
-        break; \
-    } \
-
-#define INC_POS_STEREO_LOOPED() \
-    pos += (intAdd << 1); \
-    fractPos += fractAdd; \
-    if (fractPos > 65535) \
-    { \
-        fractPos &= 65535; \
-        pos += 2; \
-    } \
-    while (pos >= end) \
-        pos -= (end - repeat); \
-
-#define INC_POS_STEREO_ONESHOT() \
-    pos += (intAdd << 1); \
-    fractPos += fractAdd; \
-    if (fractPos > 65535) \
-    { \
-        fractPos &= 65535; \
-        pos += 2; \
-    } \
-    if (pos >= end) \
-    { \
-        pos = 0; \
-        break; \
-    } \
-
-#define GET_IP_SAMPLE() (((((int)pos[1] - (int)pos[0]) * fractPos) / 65536) + (int)pos[0])
-
-#define GET_IP_SAMPLE_LEFT() (((((int)pos[2] - (int)pos[0]) * fractPos) / 65536) + (int)pos[0])
-
-#define GET_IP_SAMPLE_RIGHT() (((((int)pos[3] - (int)pos[1]) * fractPos) / 65536) + (int)pos[1])
-
 static const float AUTOREMOVE_DELAY = 0.25f;
 
 static const int STREAM_SAFETY_SAMPLES = 4;
+/// Number of output samples resampled at a time before mixing.
+static const unsigned MIX_CHUNK_SAMPLES = 256;
 
-extern const char* AUDIO_CATEGORY;
-
-
-SoundSource::SoundSource(Context* context) :
-    Component(context),
-    soundType_(SOUND_EFFECT),
-    frequency_(0.0f),
-    gain_(1.0f),
-    attenuation_(1.0f),
-    panning_(0.0f),
-    autoRemoveTimer_(0.0f),
-    autoRemove_(false),
-    position_(0),
-    fractPosition_(0),
-    timePosition_(0.0f),
-    unusedStreamSize_(0)
+/// Convert 16-bit samples to float.
+static void ConvertSamples(float* dest, const short* src, unsigned count)
 {
-    audio_ = GetSubsystem<Audio>();
+    float* end = dest + count;
 
-    if (audio_)
-        audio_->AddSoundSource(this);
-    
-    UpdateMasterGain();
-}
+#if defined(URHO3D_SIMD_SSE2)
+    while (end - dest >= 8)
+    {
+        // Sign-extend by unpacking to the high halves of 32-bit values and shifting down
+        __m128i s = _mm_loadu_si128((const __m128i*)src);
+        _mm_storeu_ps(dest, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+        _mm_storeu_ps(dest + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+        src += 8;
+        dest += 8;
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    while (end - dest >= 8)
+    {
+        int16x8_t s = vld1q_s16(src);
+        vst1q_f32(dest, vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))));
+        vst1q_f32(dest + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))));
+        src += 8;
+        dest += 8;
+    }
+#endif
 
-SoundSource::~SoundSource()
-{
-    if (audio_)
-        audio_->RemoveSoundSource(this);
+    while (dest < end)
+        *dest++ = (float)*src++;
 }
 
-void SoundSource::RegisterObject(Context* context)
+/// Convert 8-bit samples to float in the 16-bit range.
+static void ConvertSamples(float* dest, const signed char* src, unsigned count)
 {
-    context->RegisterFactory<SoundSource>(AUDIO_CATEGORY);
+    float* end = dest + count;
 
-    ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
-    MIXED_ACCESSOR_ATTRIBUTE("Sound", GetSoundAttr, SetSoundAttr, ResourceRef, ResourceRef(Sound::GetTypeStatic()), AM_DEFAULT);
-    MIXED_ACCESSOR_ATTRIBUTE("Type", GetSoundType, SetSoundType, String, SOUND_EFFECT, AM_DEFAULT);
-    ATTRIBUTE("Frequency", float, frequency_, 0.0f, AM_DEFAULT);
-    ATTRIBUTE("Gain", float, gain_, 1.0f, AM_DEFAULT);
-    ATTRIBUTE("Attenuation", float, attenuation_, 1.0f, AM_DEFAULT);
-    ATTRIBUTE("Panning", float, panning_, 0.0f, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Is Playing", IsPlaying, SetPlayingAttr, bool, false, AM_DEFAULT);
-    ATTRIBUTE("Autoremove on Stop", bool, autoRemove_, false, AM_FILE);
-    ACCESSOR_ATTRIBUTE("Play Position", GetPositionAttr, SetPositionAttr, int, 0, AM_FILE);
+#if defined(URHO3D_SIMD_SSE2)
+    while (end - dest >= 8)
+    {
+        // Unpack each byte to the high byte of a 16-bit value, which multiplies it by 256
+        __m128i s = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_loadl_epi64((const __m128i*)src));
+        _mm_storeu_ps(dest, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+        _mm_storeu_ps(dest + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+        src += 8;
+        dest += 8;
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    while (end - dest >= 8)
+    {
+        int16x8_t s = vshlq_n_s16(vmovl_s8(vld1_s8(src)), 8);
+        vst1q_f32(dest, vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))));
+        vst1q_f32(dest + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))));
+        src += 8;
+        dest += 8;
+    }
+#endif
+
+    while (dest < end)
+        *dest++ = (float)(*src++ * 256);
 }
 
-void SoundSource::Play(Sound* sound)
+/// Copy samples at the mixing rate, converted to float. Return the number of samples read, which is less than requested if a one-shot sound ended, in which case the position is set to null.
+template <class T> static unsigned CopySamples(float* dest, unsigned samples, unsigned channels, const T*& pos, const T* end,
+    const T* repeat, bool looped)
 {
-    if (!audio_)
-        return;
-
-    // If no frequency set yet, set from the sound's default
-    if (frequency_ == 0.0f && sound)
-        SetFrequency(sound->GetFrequency());
+    unsigned readSamples = 0;
 
-    // If sound source is currently playing, have to lock the audio mutex
-    if (position_)
+    while (readSamples < samples)
     {
-        MutexLock lock(audio_->GetMutex());
-        PlayLockless(sound);
+        unsigned count = (unsigned)(end - pos) / channels;
+        if (count > samples - readSamples)
+            count = samples - readSamples;
+
+        ConvertSamples(dest, pos, count * channels);
+        dest += count * channels;
+        pos += count * channels;
+        readSamples += count;
+
+        if (pos >= end)
+        {
+            if (!looped)
+            {
+                pos = 0;
+                break;
+            }
+            while (pos >= end)
+                pos -= (end - repeat);
+        }
     }
-    else
-        PlayLockless(sound);
 
-    MarkNetworkUpdate();
+    return readSamples;
 }
 
-void SoundSource::Play(Sound* sound, float frequency)
+/// Resample with a 16.16 fixed-point step, converted to float. When interpolating, also store the next samples and the interpolation fractions. Return the number of samples read, which is less than requested if a one-shot sound ended, in which case the position is set to null.
+template <class T> static unsigned ResampleSamples(float* dest, float* next, float* fract, unsigned samples, unsigned channels,
+    const T*& pos, int& fractPos, int intAdd, int fractAdd, const T* end, const T* repeat, bool looped, float scale)
 {
-    SetFrequency(frequency);
-    Play(sound);
-}
+    unsigned readSamples = 0;
 
-void SoundSource::Play(Sound* sound, float frequency, float gain)
-{
-    SetFrequency(frequency);
-    SetGain(gain);
-    Play(sound);
-}
+    while (readSamples < samples)
+    {
+        for (unsigned i = 0; i < channels; ++i)
+            *dest++ = (float)pos[i] * scale;
+        if (next)
+        {
+            for (unsigned i = 0; i < channels; ++i)
+            {
+                *next++ = (float)pos[i + channels] * scale;
+                *fract++ = (float)fractPos * (1.0f / 65536.0f);
+            }
+        }
+        ++readSamples;
 
-void SoundSource::Play(Sound* sound, float frequency, float gain, float panning)
-{
-    SetFrequency(frequency);
-    SetGain(gain);
-    SetPanning(panning);
-    Play(sound);
-}
+        pos += intAdd * channels;
+        fractPos += fractAdd;
+        if (fractPos > 65535)
+        {
+            fractPos &= 65535;
+            pos += channels;
+        }
 
-void SoundSource::Play(SoundStream* stream)
-{
-    if (!audio_)
-        return;
+        if (pos >= end)
+        {
+            if (!looped)
+            {
+                pos = 0;
+                break;
+            }
+            while (pos >= end)
+                pos -= (end - repeat);
+        }
+    }
 
-    // If no frequency set yet, set from the stream's default
-    if (frequency_ == 0.0f && stream)
-        SetFrequency(stream->GetFrequency());
+    return readSamples;
+}
 
-    SharedPtr<SoundStream> streamPtr(stream);
+/// Interpolate samples towards the next samples by the fractions.
+static void InterpolateSamples(float* dest, const float* next, const float* fract, unsigned count)
+{
+    float* end = dest + count;
 
-    // If sound source is currently playing, have to lock the audio mutex. When stream playback is explicitly
-    // requested, clear the existing sound if any
-    if (position_)
+#if defined(URHO3D_SIMD_SSE)
+    while (end - dest >= 4)
     {
-        MutexLock lock(audio_->GetMutex());
-        sound_.Reset();
-        PlayLockless(streamPtr);
+        __m128 s = _mm_loadu_ps(dest);
+        _mm_storeu_ps(dest, _mm_add_ps(s, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(next), s), _mm_loadu_ps(fract))));
+        dest += 4;
+        next += 4;
+        fract += 4;
     }
-    else
+#elif defined(URHO3D_SIMD_NEON)
+    while (end - dest >= 4)
     {
-        sound_.Reset();
-        PlayLockless(streamPtr);
+        float32x4_t s = vld1q_f32(dest);
+        vst1q_f32(dest, vmlaq_f32(s, vsubq_f32(vld1q_f32(next), s), vld1q_f32(fract)));
+        dest += 4;
+        next += 4;
+        fract += 4;
     }
+#endif
 
-    // Stream playback is not supported for network replication, no need to mark network dirty
+    while (dest < end)
+    {
+        *dest += (*next++ - *dest) * *fract++;
+        ++dest;
+    }
 }
 
-void SoundSource::Stop()
+/// Mix samples to the mix buffer with a gain.
+static void MixSamples(float* dest, const float* src, unsigned count, float gain)
 {
-    if (!audio_)
-        return;
+    float* end = dest + count;
 
-    // If sound source is currently playing, have to lock the audio mutex
-    if (position_)
+#if defined(URHO3D_SIMD_SSE)
+    __m128 g = _mm_set1_ps(gain);
+    while (end - dest >= 4)
     {
-        MutexLock lock(audio_->GetMutex());
-        StopLockless();
+        _mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), _mm_mul_ps(_mm_loadu_ps(src), g)));
+        src += 4;
+        dest += 4;
     }
-    else
-        StopLockless();
+#elif defined(URHO3D_SIMD_NEON)
+    float32x4_t g = vdupq_n_f32(gain);
+    while (end - dest >= 4)
+    {
+        vst1q_f32(dest, vmlaq_f32(vld1q_f32(dest), vld1q_f32(src), g));
+        src += 4;
+        dest += 4;
+    }
+#endif
 
-    MarkNetworkUpdate();
+    while (dest < end)
+        *dest++ += *src++ * gain;
 }
 
-void SoundSource::SetSoundType(const String& type)
+/// Mix mono samples to the stereo mix buffer with left and right gains.
+static void MixSamplesToStereo(float* dest, const float* src, unsigned count, float leftGain, float rightGain)
 {
-    if (type == SOUND_MASTER)
-        return;
+    const float* end = src + count;
 
-    soundType_ = type;
-    soundTypeHash_ = StringHash(type);
-    UpdateMasterGain();
-    
-    MarkNetworkUpdate();
-}
+#if defined(URHO3D_SIMD_SSE)
+    __m128 g = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+    while (end - src >= 4)
+    {
+        __m128 s = _mm_loadu_ps(src);
+        _mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), _mm_mul_ps(_mm_unpacklo_ps(s, s), g)));
+        _mm_storeu_ps(dest + 4, _mm_add_ps(_mm_loadu_ps(dest + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), g)));
+        src += 4;
+        dest += 8;
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    float32x4_t g = vcombine_f32(vset_lane_f32(rightGain, vdup_n_f32(leftGain), 1), vset_lane_f32(rightGain,
+        vdup_n_f32(leftGain), 1));
+    while (end - src >= 4)
+    {
+        float32x4_t s = vld1q_f32(src);
+        float32x4x2_t pairs = vzipq_f32(s, s);
+        vst1q_f32(dest, vmlaq_f32(vld1q_f32(dest), pairs.val[0], g));
+        vst1q_f32(dest + 4, vmlaq_f32(vld1q_f32(dest + 4), pairs.val[1], g));
+        src += 4;
+        dest += 8;
+    }
+#endif
 
-void SoundSource::SetFrequency(float frequency)
-{
-    frequency_ = Clamp(frequency, 0.0f, 535232.0f);
-    MarkNetworkUpdate();
+    while (src < end)
+    {
+        *dest++ += *src * leftGain;
+        *dest++ += *src++ * rightGain;
+    }
 }
 
-void SoundSource::SetGain(float gain)
+/// Mix stereo samples to the mono mix buffer with a gain, averaging the channels.
+static void MixStereoSamplesToMono(float* dest, const float* src, unsigned count, float gain)
 {
-    gain_ = Max(gain, 0.0f);
-    MarkNetworkUpdate();
-}
+    float* end = dest + count;
+    gain *= 0.5f;
 
-void SoundSource::SetAttenuation(float attenuation)
-{
-    attenuation_ = Clamp(attenuation, 0.0f, 1.0f);
-    MarkNetworkUpdate();
+#if defined(URHO3D_SIMD_SSE)
+    __m128 g = _mm_set1_ps(gain);
+    while (end - dest >= 4)
+    {
+        __m128 a = _mm_loadu_ps(src);
+        __m128 b = _mm_loadu_ps(src + 4);
+        __m128 sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), _mm_mul_ps(sum, g)));
+        src += 8;
+        dest += 4;
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    float32x4_t g = vdupq_n_f32(gain);
+    while (end - dest >= 4)
+    {
+        float32x4x2_t channels = vuzpq_f32(vld1q_f32(src), vld1q_f32(src + 4));
+        vst1q_f32(dest, vmlaq_f32(vld1q_f32(dest), vaddq_f32(channels.val[0], channels.val[1]), g));
+        src += 8;
+        dest += 4;
+    }
+#endif
+
+    while (dest < end)
+    {
+        *dest++ += (src[0] + src[1]) * gain;
+        src += 2;
+    }
 }
 
-void SoundSource::SetPanning(float panning)
+extern const char* AUDIO_CATEGORY;
+
+SoundVoice::SoundVoice() :
+    sound_(0),
+    stream_(0),
+    streamBuffer_(0),
+    position_(0),
+    fractPosition_(0),
+    timePosition_(0.0f),
+    unusedStreamSize_(0)
 {
-    panning_ = Clamp(panning, -1.0f, 1.0f);
-    MarkNetworkUpdate();
 }
 
-void SoundSource::SetAutoRemove(bool enable)
+void SoundVoice::Play(Sound* sound)
 {
-    autoRemove_ = enable;
+    sound_ = sound;
+    stream_ = 0;
+    streamBuffer_ = 0;
+    position_ = sound ? sound->GetStart() : 0;
+    fractPosition_ = 0;
+    timePosition_ = 0.0f;
 }
 
-bool SoundSource::IsPlaying() const
+void SoundVoice::Play(Sound* sound, SoundStream* stream, Sound* streamBuffer)
 {
-    return (sound_ || soundStream_) && position_ != 0;
+    sound_ = sound;
+    stream_ = stream;
+    streamBuffer_ = streamBuffer;
+    unusedStreamSize_ = 0;
+    position_ = streamBuffer ? streamBuffer->GetStart() : 0;
+    fractPosition_ = 0;
+    timePosition_ = 0.0f;
 }
 
-void SoundSource::SetPlayPosition(signed char* pos)
+void SoundVoice::Stop()
 {
-    // Setting play position on a stream is not supported
-    if (!audio_ || !sound_ || soundStream_)
-        return;
-
-    MutexLock lock(audio_->GetMutex());
-    SetPlayPositionLockless(pos);
+    position_ = 0;
+    timePosition_ = 0.0f;
+    stream_ = 0;
+    streamBuffer_ = 0;
 }
 
-void SoundSource::Update(float timeStep)
+void SoundVoice::SetPlayPosition(Sound* sound, signed char* pos)
 {
-    if (!audio_ || !IsEnabledEffective())
+    if (!sound)
         return;
 
-    // If there is no actual audio output, perform fake mixing into a nonexistent buffer to check stopping/looping
-    if (!audio_->IsInitialized())
-        MixNull(timeStep);
-
-    // Free the stream if playback has stopped
-    if (soundStream_ && !position_)
-        StopLockless();
+    signed char* start = sound->GetStart();
+    signed char* end = sound->GetEnd();
+    if (pos < start)
+        pos = start;
+    if (sound->IsSixteenBit() && (pos - start) & 1)
+        ++pos;
+    if (pos > end)
+        pos = end;
 
-    // Check for autoremove
-    if (autoRemove_)
-    {
-        if (!IsPlaying())
-        {
-            autoRemoveTimer_ += timeStep;
-            if (autoRemoveTimer_ > AUTOREMOVE_DELAY)
-            {
-                Remove();
-                // Note: this object is now deleted, so only returning immediately is safe
-                return;
-            }
-        }
-        else
-            autoRemoveTimer_ = 0.0f;
-    }
+    sound_ = sound;
+    stream_ = 0;
+    streamBuffer_ = 0;
+    position_ = pos;
+    timePosition_ = ((float)(int)(size_t)(pos - sound->GetStart())) / (sound->GetSampleSize() * sound->GetFrequency());
 }
 
-void SoundSource::Mix(int* dest, unsigned samples, int mixRate, bool stereo, bool interpolation)
+void SoundVoice::Mix(float* dest, unsigned samples, int mixRate, bool stereo, bool interpolation)
 {
-    if (!position_ || (!sound_ && !soundStream_) || !IsEnabledEffective())
+    if (!position_ || (!sound_ && !stream_) || !parameters_.enabled_)
         return;
 
+    float frequency = parameters_.frequency_;
     int streamFilledSize, outBytes;
 
-    if (soundStream_ && streamBuffer_)
+    if (stream_ && streamBuffer_)
     {
         int streamBufferSize = streamBuffer_->GetDataSize();
         // Calculate how many bytes of stream sound data is needed
-        int neededSize = (int)((float)samples * frequency_ / (float)mixRate);
+        int neededSize = (int)((float)samples * frequency / (float)mixRate);
         // Add a little safety buffer. Subtract previous unused data
         neededSize += STREAM_SAFETY_SAMPLES;
-        neededSize *= soundStream_->GetSampleSize();
+        neededSize *= stream_->GetSampleSize();
         neededSize -= unusedStreamSize_;
         neededSize = Clamp(neededSize, 0, streamBufferSize - unusedStreamSize_);
 
@@ -338,7 +394,7 @@ void SoundSource::Mix(int* dest, unsigned samples, int mixRate, bool stereo, boo
 
         // Request new data from the stream
         signed char* dest = streamBuffer_->GetStart() + unusedStreamSize_;
-        outBytes = neededSize ? soundStream_->GetData(dest, neededSize) : 0;
+        outBytes = neededSize ? stream_->GetData(dest, neededSize) : 0;
         dest += outBytes;
         // Zero-fill rest if stream did not produce enough data
         if (outBytes < neededSize)
@@ -349,57 +405,58 @@ void SoundSource::Mix(int* dest, unsigned samples, int mixRate, bool stereo, boo
     }
 
     // If streaming, play the stream buffer. Otherwise play the original sound
-    Sound* sound = soundStream_ ? streamBuffer_ : sound_;
+    Sound* sound = stream_ ? streamBuffer_ : sound_;
     if (!sound)
         return;
 
-    // Choose the correct mixing routine
-    if (!sound->IsStereo())
-    {
-        if (interpolation)
-        {
-            if (stereo)
-                MixMonoToStereoIP(sound, dest, samples, mixRate);
-            else
-                MixMonoToMonoIP(sound, dest, samples, mixRate);
-        }
-        else
-        {
-            if (stereo)
-                MixMonoToStereo(sound, dest, samples, mixRate);
-            else
-                MixMonoToMono(sound, dest, samples, mixRate);
-        }
-    }
+    // Resample the sound into a float buffer one chunk at a time, then apply the gain and panning to the float mix buffer.
+    // Virtual sound sources only advance the playback position, so that they continue in sync when mixed again
+    float totalGain = parameters_.gain_;
+    if (parameters_.virtual_ || totalGain * 256.0f < 0.5f)
+        MixZeroVolume(sound, samples, mixRate);
     else
     {
-        if (interpolation)
-        {
-            if (stereo)
-                MixStereoToStereoIP(sound, dest, samples, mixRate);
-            else
-                MixStereoToMonoIP(sound, dest, samples, mixRate);
-        }
-        else
+        float leftGain = (1.0f - parameters_.panning_) * totalGain;
+        float rightGain = (1.0f + parameters_.panning_) * totalGain;
+        float buffer[MIX_CHUNK_SAMPLES * 2];
+        unsigned remaining = samples;
+
+        while (remaining && position_)
         {
-            if (stereo)
-                MixStereoToStereo(sound, dest, samples, mixRate);
+            unsigned chunkSamples = remaining < MIX_CHUNK_SAMPLES ? remaining : MIX_CHUNK_SAMPLES;
+            unsigned readSamples = ReadSamples(sound, buffer, chunkSamples, mixRate, interpolation);
+
+            if (!sound->IsStereo())
+            {
+                if (stereo)
+                    MixSamplesToStereo(dest, buffer, readSamples, leftGain, rightGain);
+                else
+                    MixSamples(dest, buffer, readSamples, totalGain);
+            }
             else
-                MixStereoToMono(sound, dest, samples, mixRate);
+            {
+                if (stereo)
+                    MixSamples(dest, buffer, readSamples << 1, totalGain);
+                else
+                    MixStereoSamplesToMono(dest, buffer, readSamples, totalGain);
+            }
+
+            dest += stereo ? readSamples << 1 : readSamples;
+            remaining -= chunkSamples;
         }
     }
 
     // Update the time position. In stream mode, copy unused data back to the beginning of the stream buffer
-    if (soundStream_)
+    if (stream_)
     {
-        timePosition_ += ((float)samples / (float)mixRate) * frequency_ / soundStream_->GetFrequency();
+        timePosition_ += ((float)samples / (float)mixRate) * frequency / stream_->GetFrequency();
 
         unusedStreamSize_ = Max(streamFilledSize - (int)(size_t)(position_ - streamBuffer_->GetStart()), 0);
         if (unusedStreamSize_)
             memcpy(streamBuffer_->GetStart(), (const void*)position_, unusedStreamSize_);
 
         // If stream did not produce any data, stop if applicable
-        if (!outBytes && soundStream_->GetStopAtEnd())
+        if (!outBytes && stream_->GetStopAtEnd())
         {
             position_ = 0;
             return;
@@ -409,829 +466,527 @@ void SoundSource::Mix(int* dest, unsigned samples, int mixRate, bool stereo, boo
         timePosition_ = ((float)(int)(size_t)(position_ - sound_->GetStart())) / (sound_->GetSampleSize() * sound_->GetFrequency());
 }
 
-void SoundSource::UpdateMasterGain()
-{
-    if (audio_)
-        masterGain_ = audio_->GetSoundSourceMasterGain(soundType_);
-}
-
-void SoundSource::SetSoundAttr(const ResourceRef& value)
+unsigned SoundVoice::ReadSamples(Sound* sound, float* dest, unsigned samples, int mixRate, bool interpolation)
 {
-    ResourceCache* cache = GetSubsystem<ResourceCache>();
-    Sound* newSound = cache->GetResource<Sound>(value.name_);
-    if (IsPlaying())
-        Play(newSound);
-    else
-    {
-        // When changing the sound and not playing, free previous sound stream and stream buffer (if any)
-        soundStream_.Reset();
-        streamBuffer_.Reset();
-        sound_ = newSound;
-    }
-}
+    float add = parameters_.frequency_ / (float)mixRate;
+    int intAdd = (int)add;
+    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
+    int fractPos = fractPosition_;
+    unsigned channels = sound->IsStereo() ? 2 : 1;
+    bool looped = sound->IsLooped();
+    unsigned readSamples;
 
-void SoundSource::SetPlayingAttr(bool value)
-{
-    if (value)
+    // At the mixing rate, and without a fractional position to interpolate from, the samples can be converted as they are
+    if (intAdd == 1 && !fractAdd && (!interpolation || !fractPos))
     {
-        if (!IsPlaying())
-            Play(sound_);
+        if (sound->IsSixteenBit())
+        {
+            const short* pos = (const short*)position_;
+            readSamples = CopySamples(dest, samples, channels, pos, (const short*)sound->GetEnd(),
+                (const short*)sound->GetRepeat(), looped);
+            position_ = (signed char*)pos;
+        }
+        else
+        {
+            const signed char* pos = (const signed char*)position_;
+            readSamples = CopySamples(dest, samples, channels, pos, sound->GetEnd(), sound->GetRepeat(), looped);
+            position_ = (signed char*)pos;
+        }
     }
     else
-        Stop();
-}
+    {
+        float next[MIX_CHUNK_SAMPLES * 2];
+        float fract[MIX_CHUNK_SAMPLES * 2];
+        float* nextDest = interpolation ? next : 0;
 
-void SoundSource::SetPositionAttr(int value)
-{
-    if (sound_)
-        SetPlayPosition(sound_->GetStart() + value);
-}
+        if (sound->IsSixteenBit())
+        {
+            const short* pos = (const short*)position_;
+            readSamples = ResampleSamples(dest, nextDest, fract, samples, channels, pos, fractPos, intAdd, fractAdd,
+                (const short*)sound->GetEnd(), (const short*)sound->GetRepeat(), looped, 1.0f);
+            position_ = (signed char*)pos;
+        }
+        else
+        {
+            const signed char* pos = (const signed char*)position_;
+            readSamples = ResampleSamples(dest, nextDest, fract, samples, channels, pos, fractPos, intAdd, fractAdd,
+                sound->GetEnd(), sound->GetRepeat(), looped, 256.0f);
+            position_ = (signed char*)pos;
+        }
 
-ResourceRef SoundSource::GetSoundAttr() const
-{
-    return GetResourceRef(sound_, Sound::GetTypeStatic());
-}
+        if (interpolation)
+            InterpolateSamples(dest, next, fract, readSamples * channels);
+    }
 
-int SoundSource::GetPositionAttr() const
-{
-    if (sound_ && position_)
-        return (int)(GetPlayPosition() - sound_->GetStart());
-    else
-        return 0;
+    fractPosition_ = fractPos;
+    return readSamples;
 }
 
-void SoundSource::PlayLockless(Sound* sound)
+void SoundVoice::MixZeroVolume(Sound* sound, unsigned samples, int mixRate)
 {
-    // Reset the time position in any case
-    timePosition_ = 0.0f;
+    float add = parameters_.frequency_ * (float)samples / (float)mixRate;
+    int intAdd = (int)add;
+    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
+    unsigned sampleSize = sound->GetSampleSize();
 
-    if (sound)
+    fractPosition_ += fractAdd;
+    if (fractPosition_ > 65535)
     {
-        if (!sound->IsCompressed())
+        fractPosition_ &= 65535;
+        position_ += sampleSize;
+    }
+    position_ += intAdd * sampleSize;
+
+    if (position_ > sound->GetEnd())
+    {
+        if (sound->IsLooped())
         {
-            // Uncompressed sound start
-            signed char* start = sound->GetStart();
-            if (start)
+            while (position_ >= sound->GetEnd())
             {
-                // Free existing stream & stream buffer if any
-                soundStream_.Reset();
-                streamBuffer_.Reset();
-                sound_ = sound;
-                position_ = start;
-                fractPosition_ = 0;
-                return;
+                position_ -= (sound->GetEnd() - sound->GetRepeat());
             }
         }
         else
+            position_ = 0;
+    }
+}
+
+void SoundVoice::MixNull(float timeStep)
+{
+    if (!position_ || !sound_)
+        return;
+
+    // Advance only the time position
+    timePosition_ += timeStep * parameters_.frequency_ / sound_->GetFrequency();
+
+    if (sound_->IsLooped())
+    {
+        // For simulated playback, simply reset the time position to zero when the sound loops
+        if (timePosition_ >= sound_->GetLength())
+            timePosition_ -= sound_->GetLength();
+    }
+    else
+    {
+        if (timePosition_ >= sound_->GetLength())
         {
-            // Compressed sound start
-            PlayLockless(sound->GetDecoderStream());
-            sound_ = sound;
-            return;
+            position_ = 0;
+            timePosition_ = 0.0f;
         }
     }
-
-    // If sound pointer is null or if sound has no data, stop playback
-    StopLockless();
-    sound_.Reset();
 }
 
-void SoundSource::PlayLockless(SharedPtr<SoundStream> stream)
+SoundSource::SoundSource(Context* context) :
+    Component(context),
+    soundType_(SOUND_EFFECT),
+    frequency_(0.0f),
+    gain_(1.0f),
+    attenuation_(1.0f),
+    panning_(0.0f),
+    autoRemoveTimer_(0.0f),
+    priority_(1.0f),
+    autoRemove_(false),
+    voice_(0),
+    playSequence_(0),
+    playRequested_(false),
+    virtual_(false)
 {
-    // Reset the time position in any case
-    timePosition_ = 0.0f;
+    audio_ = GetSubsystem<Audio>();
 
-    if (stream)
+    if (audio_)
     {
-        // Setup the stream buffer
-        unsigned sampleSize = stream->GetSampleSize();
-        unsigned streamBufferSize = sampleSize * stream->GetIntFrequency() * STREAM_BUFFER_LENGTH / 1000;
+        // The voice is deleted by the audio subsystem once it has been removed from mixing
+        voice_ = new SoundVoice();
+        audio_->AddSoundSource(this);
+    }
 
-        streamBuffer_ = new Sound(context_);
-        streamBuffer_->SetSize(streamBufferSize);
-        streamBuffer_->SetFormat(stream->GetIntFrequency(), stream->IsSixteenBit(), stream->IsStereo());
-        streamBuffer_->SetLooped(true);
+    UpdateMasterGain();
+}
 
-        soundStream_ = stream;
-        unusedStreamSize_ = 0;
-        position_ = streamBuffer_->GetStart();
-        fractPosition_ = 0;
-        return;
+SoundSource::~SoundSource()
+{
+    if (audio_)
+    {
+        audio_->RemoveSoundSource(this);
+        RetireResources();
     }
-
-    // If stream pointer is null, stop playback
-    StopLockless();
 }
 
-void SoundSource::StopLockless()
+void SoundSource::RegisterObject(Context* context)
 {
-    position_ = 0;
-    timePosition_ = 0.0f;
+    context->RegisterFactory<SoundSource>(AUDIO_CATEGORY);
 
-    // Free the sound stream and decode buffer if a stream was playing
-    soundStream_.Reset();
-    streamBuffer_.Reset();
+    ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Sound", GetSoundAttr, SetSoundAttr, ResourceRef, ResourceRef(Sound::GetTypeStatic()), AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Type", GetSoundType, SetSoundType, String, SOUND_EFFECT, AM_DEFAULT);
+    ATTRIBUTE("Frequency", float, frequency_, 0.0f, AM_DEFAULT);
+    ATTRIBUTE("Gain", float, gain_, 1.0f, AM_DEFAULT);
+    ATTRIBUTE("Attenuation", float, attenuation_, 1.0f, AM_DEFAULT);
+    ATTRIBUTE("Panning", float, panning_, 0.0f, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Priority", GetPriority, SetPriority, float, 1.0f, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Is Playing", IsPlaying, SetPlayingAttr, bool, false, AM_DEFAULT);
+    ATTRIBUTE("Autoremove on Stop", bool, autoRemove_, false, AM_FILE);
+    ACCESSOR_ATTRIBUTE("Play Position", GetPositionAttr, SetPositionAttr, int, 0, AM_FILE);
 }
 
-void SoundSource::SetPlayPositionLockless(signed char* pos)
+void SoundSource::Play(Sound* sound)
 {
-    // Setting position on a stream is not supported
-    if (!sound_ || soundStream_)
+    if (!audio_)
         return;
 
-    signed char* start = sound_->GetStart();
-    signed char* end = sound_->GetEnd();
-    if (pos < start)
-        pos = start;
-    if (sound_->IsSixteenBit() && (pos - start) & 1)
-        ++pos;
-    if (pos > end)
-        pos = end;
+    // If no frequency set yet, set from the sound's default
+    if (frequency_ == 0.0f && sound)
+        SetFrequency(sound->GetFrequency());
 
-    position_ = pos;
-    timePosition_ = ((float)(int)(size_t)(pos - sound_->GetStart())) / (sound_->GetSampleSize() * sound_->GetFrequency());
+    PlayInternal(sound);
+
+    MarkNetworkUpdate();
 }
 
-void SoundSource::MixMonoToMono(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::Play(Sound* sound, float frequency)
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int vol = (int)(256.0f * totalGain + 0.5f);
-    if (!vol)
-    {
-        MixZeroVolume(sound, samples, mixRate);
-        return;
-    }
+    SetFrequency(frequency);
+    Play(sound);
+}
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+void SoundSource::Play(Sound* sound, float frequency, float gain)
+{
+    SetFrequency(frequency);
+    SetGain(gain);
+    Play(sound);
+}
 
-    if (sound->IsSixteenBit())
-    {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
+void SoundSource::Play(Sound* sound, float frequency, float gain, float panning)
+{
+    SetFrequency(frequency);
+    SetGain(gain);
+    SetPanning(panning);
+    Play(sound);
+}
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + (*pos * vol) / 256;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + (*pos * vol) / 256;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
-    }
-    else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
+void SoundSource::Play(SoundStream* stream)
+{
+    if (!audio_)
+        return;
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + *pos * vol;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + *pos * vol;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = pos;
-        }
-    }
-    fractPosition_ = fractPos;
+    // If no frequency set yet, set from the stream's default
+    if (frequency_ == 0.0f && stream)
+        SetFrequency(stream->GetFrequency());
+
+    // When stream playback is explicitly requested, clear the existing sound if any
+    SharedPtr<SoundStream> streamPtr(stream);
+    PlayInternal(streamPtr, 0);
+
+    // Stream playback is not supported for network replication, no need to mark network dirty
 }
 
-void SoundSource::MixMonoToStereo(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::Stop()
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int leftVol = (int)((-panning_ + 1.0f) * (256.0f * totalGain + 0.5f));
-    int rightVol = (int)((panning_ + 1.0f) * (256.0f * totalGain + 0.5f));
-    if (!leftVol && !rightVol)
-    {
-        MixZeroVolume(sound, samples, mixRate);
+    if (!audio_)
         return;
-    }
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+    StopInternal();
 
-    if (sound->IsSixteenBit())
-    {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
+    MarkNetworkUpdate();
+}
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + (*pos * leftVol) / 256;
-                ++dest;
-                *dest = *dest + (*pos * rightVol) / 256;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + (*pos * leftVol) / 256;
-                ++dest;
-                *dest = *dest + (*pos * rightVol) / 256;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
-    }
-    else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
+void SoundSource::SetSoundType(const String& type)
+{
+    if (type == SOUND_MASTER)
+        return;
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + *pos * leftVol;
-                ++dest;
-                *dest = *dest + *pos * rightVol;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + *pos * leftVol;
-                ++dest;
-                *dest = *dest + *pos * rightVol;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = pos;
-        }
-    }
+    soundType_ = type;
+    soundTypeHash_ = StringHash(type);
+    UpdateMasterGain();
+    
+    MarkNetworkUpdate();
+}
 
-    fractPosition_ = fractPos;
+void SoundSource::SetFrequency(float frequency)
+{
+    frequency_ = Clamp(frequency, 0.0f, 535232.0f);
+    MarkNetworkUpdate();
 }
 
-void SoundSource::MixMonoToMonoIP(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::SetGain(float gain)
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int vol = (int)(256.0f * totalGain + 0.5f);
-    if (!vol)
-    {
-        MixZeroVolume(sound, samples, mixRate);
-        return;
-    }
+    gain_ = Max(gain, 0.0f);
+    MarkNetworkUpdate();
+}
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+void SoundSource::SetAttenuation(float attenuation)
+{
+    attenuation_ = Clamp(attenuation, 0.0f, 1.0f);
+    MarkNetworkUpdate();
+}
 
-    if (sound->IsSixteenBit())
-    {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
+void SoundSource::SetPanning(float panning)
+{
+    panning_ = Clamp(panning, -1.0f, 1.0f);
+    MarkNetworkUpdate();
+}
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + (GET_IP_SAMPLE() * vol) / 256;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + (GET_IP_SAMPLE() * vol) / 256;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
-    }
-    else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
+void SoundSource::SetAutoRemove(bool enable)
+{
+    autoRemove_ = enable;
+}
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + GET_IP_SAMPLE() * vol;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + GET_IP_SAMPLE() * vol;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = pos;
-        }
-    }
+void SoundSource::SetPriority(float priority)
+{
+    priority_ = Max(priority, 0.0f);
+    MarkNetworkUpdate();
+}
 
-    fractPosition_ = fractPos;
+volatile signed char* SoundSource::GetPlayPosition() const
+{
+    return audio_ ? voice_->GetPlayPosition() : 0;
 }
 
-void SoundSource::MixMonoToStereoIP(Sound* sound, int* dest, unsigned samples, int mixRate)
+float SoundSource::GetTimePosition() const
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int leftVol = (int)((-panning_ + 1.0f) * (256.0f * totalGain + 0.5f));
-    int rightVol = (int)((panning_ + 1.0f) * (256.0f * totalGain + 0.5f));
-    if (!leftVol && !rightVol)
-    {
-        MixZeroVolume(sound, samples, mixRate);
-        return;
-    }
+    if (!audio_ || IsCommandPending())
+        return 0.0f;
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+    return voice_->GetTimePosition();
+}
 
-    if (sound->IsSixteenBit())
-    {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
+bool SoundSource::IsPlaying() const
+{
+    if (!audio_ || (!sound_ && !soundStream_))
+        return false;
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                int s = GET_IP_SAMPLE();
-                *dest = *dest + (s * leftVol) / 256;
-                ++dest;
-                *dest = *dest + (s * rightVol) / 256;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                int s = GET_IP_SAMPLE();
-                *dest = *dest + (s * leftVol) / 256;
-                ++dest;
-                *dest = *dest + (s * rightVol) / 256;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
-    }
-    else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
+    // Until the audio thread has started or stopped the playback, return the requested state
+    if (IsCommandPending())
+        return playRequested_;
+
+    return voice_->GetPlayPosition() != 0;
+}
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                int s = GET_IP_SAMPLE();
-                *dest = *dest + s * leftVol;
-                ++dest;
-                *dest = *dest + s * rightVol;
-                ++dest;
-                INC_POS_LOOPED();
-            }
-            position_ = pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                int s = GET_IP_SAMPLE();
-                *dest = *dest + s * leftVol;
-                ++dest;
-                *dest = *dest + s * rightVol;
-                ++dest;
-                INC_POS_ONESHOT();
-            }
-            position_ = pos;
-        }
-    }
+void SoundSource::SetPlayPosition(signed char* pos)
+{
+    // Setting play position on a stream is not supported
+    if (!audio_ || !sound_ || soundStream_)
+        return;
 
-    fractPosition_ = fractPos;
+    AudioCommand command(AC_SETPOSITION, voice_);
+    command.sound_ = sound_;
+    command.position_ = pos;
+    SendPlaybackCommand(command, true);
 }
 
-void SoundSource::MixStereoToMono(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::Update(float timeStep)
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int vol = (int)(256.0f * totalGain + 0.5f);
-    if (!vol)
-    {
-        MixZeroVolume(sound, samples, mixRate);
+    if (!audio_ || !IsEnabledEffective())
         return;
-    }
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+    // If there is no actual audio output, perform fake mixing into a nonexistent buffer to check stopping/looping.
+    // In that case the main thread processes the audio commands, so the voice can be accessed directly
+    if (!audio_->IsInitialized())
+        voice_->MixNull(timeStep);
 
-    if (sound->IsSixteenBit())
+    // Free the stream if playback has stopped. Otherwise let it queue background decoding
+    if (soundStream_)
     {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
-
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                int s = ((int)pos[0] + (int)pos[1]) / 2;
-                *dest = *dest + (s * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
+        if (!IsCommandPending() && !voice_->GetPlayPosition())
+            StopInternal();
         else
-        {
-            while (samples--)
-            {
-                int s = ((int)pos[0] + (int)pos[1]) / 2;
-                *dest = *dest + (s * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
+            soundStream_->Update();
     }
-    else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
 
-        if (sound->IsLooped())
+    // Check for autoremove
+    if (autoRemove_)
+    {
+        if (!IsPlaying())
         {
-            while (samples--)
+            autoRemoveTimer_ += timeStep;
+            if (autoRemoveTimer_ > AUTOREMOVE_DELAY)
             {
-                int s = ((int)pos[0] + (int)pos[1]) / 2;
-                *dest = *dest + s * vol;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
+                Remove();
+                // Note: this object is now deleted, so only returning immediately is safe
+                return;
             }
-            position_ = pos;
         }
         else
-        {
-            while (samples--)
-            {
-                int s = ((int)pos[0] + (int)pos[1]) / 2;
-                *dest = *dest + s * vol;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = pos;
-        }
+            autoRemoveTimer_ = 0.0f;
     }
+}
 
-    fractPosition_ = fractPos;
+void SoundSource::UpdateMasterGain()
+{
+    if (audio_)
+        masterGain_ = audio_->GetSoundSourceMasterGain(soundType_);
 }
 
-void SoundSource::MixStereoToStereo(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::UpdateVoiceParameters()
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int vol = (int)(256.0f * totalGain + 0.5f);
-    if (!vol)
-    {
-        MixZeroVolume(sound, samples, mixRate);
+    if (!audio_)
         return;
-    }
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+    SoundVoiceParameters parameters;
+    parameters.frequency_ = frequency_;
+    parameters.gain_ = masterGain_ * attenuation_ * gain_;
+    parameters.panning_ = panning_;
+    parameters.enabled_ = IsEnabledEffective();
+    parameters.virtual_ = virtual_;
 
-    if (sound->IsSixteenBit())
+    if (parameters != voiceParameters_)
     {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
-
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + (pos[0] * vol) / 256;
-                ++dest;
-                *dest = *dest + (pos[1] * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + (pos[0] * vol) / 256;
-                ++dest;
-                *dest = *dest + (pos[1] * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
+        voiceParameters_ = parameters;
+        AudioCommand command(AC_SETPARAMETERS, voice_);
+        command.parameters_ = parameters;
+        audio_->PushCommand(command);
     }
+}
+
+void SoundSource::SetSoundAttr(const ResourceRef& value)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    Sound* newSound = cache->GetResource<Sound>(value.name_);
+    if (IsPlaying())
+        Play(newSound);
     else
     {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
-
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + pos[0] * vol;
-                ++dest;
-                *dest = *dest + pos[1] * vol;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
-            }
-            position_ = pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + pos[0] * vol;
-                ++dest;
-                *dest = *dest + pos[1] * vol;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = pos;
-        }
+        // When changing the sound and not playing, free previous sound stream and stream buffer (if any)
+        if (audio_)
+            RetireResources();
+        soundStream_.Reset();
+        streamBuffer_.Reset();
+        sound_ = newSound;
     }
-
-    fractPosition_ = fractPos;
 }
 
-void SoundSource::MixStereoToMonoIP(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::SetPlayingAttr(bool value)
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int vol = (int)(256.0f * totalGain + 0.5f);
-    if (!vol)
+    if (value)
     {
-        MixZeroVolume(sound, samples, mixRate);
-        return;
+        if (!IsPlaying())
+            Play(sound_);
     }
+    else
+        Stop();
+}
 
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+void SoundSource::SetPositionAttr(int value)
+{
+    if (sound_)
+        SetPlayPosition(sound_->GetStart() + value);
+}
 
-    if (sound->IsSixteenBit())
-    {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
+ResourceRef SoundSource::GetSoundAttr() const
+{
+    return GetResourceRef(sound_, Sound::GetTypeStatic());
+}
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                int s = (GET_IP_SAMPLE_LEFT() + GET_IP_SAMPLE_RIGHT()) / 2;
-                *dest = *dest + (s * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                int s = (GET_IP_SAMPLE_LEFT() + GET_IP_SAMPLE_RIGHT()) / 2;
-                *dest = *dest + (s * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
-    }
+int SoundSource::GetPositionAttr() const
+{
+    if (sound_ && GetPlayPosition())
+        return (int)(GetPlayPosition() - sound_->GetStart());
     else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
+        return 0;
+}
 
-        if (sound->IsLooped())
+void SoundSource::PlayInternal(Sound* sound)
+{
+    if (sound)
+    {
+        if (!sound->IsCompressed())
         {
-            while (samples--)
+            // Uncompressed sound start
+            if (sound->GetStart())
             {
-                int s = (GET_IP_SAMPLE_LEFT() + GET_IP_SAMPLE_RIGHT()) / 2;
-                *dest = *dest + s * vol;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
+                AudioCommand command(AC_PLAY, voice_);
+                command.sound_ = sound;
+                SendPlaybackCommand(command, true);
+
+                // Free existing stream & stream buffer if any
+                RetireResources();
+                soundStream_.Reset();
+                streamBuffer_.Reset();
+                sound_ = sound;
+                return;
             }
-            position_ = pos;
         }
         else
         {
-            while (samples--)
-            {
-                int s = (GET_IP_SAMPLE_LEFT() + GET_IP_SAMPLE_RIGHT()) / 2;
-                *dest = *dest + s * vol;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = pos;
+            // Compressed sound start. Decode ahead on worker threads if enabled
+            SharedPtr<SoundStream> stream = sound->GetDecoderStream();
+            float lookAhead = audio_->GetStreamLookAhead();
+            if (stream && lookAhead > 0.0f && audio_->IsInitialized() && sound->GetCompression() == SC_OGGVORBIS)
+                static_cast<OggVorbisSoundStream*>(stream.Get())->SetLookAhead(GetSubsystem<WorkQueue>(), lookAhead);
+            PlayInternal(stream, sound);
+            return;
         }
     }
 
-    fractPosition_ = fractPos;
+    // If sound pointer is null or if sound has no data, stop playback
+    StopInternal();
+    sound_.Reset();
 }
 
-void SoundSource::MixStereoToStereoIP(Sound* sound, int* dest, unsigned samples, int mixRate)
+void SoundSource::PlayInternal(SharedPtr<SoundStream> stream, Sound* sound)
 {
-    float totalGain = masterGain_ * attenuation_ * gain_;
-    int vol = (int)(256.0f * totalGain + 0.5f);
-    if (!vol)
+    if (stream)
     {
-        MixZeroVolume(sound, samples, mixRate);
-        return;
-    }
-
-    float add = frequency_ / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    int fractPos = fractPosition_;
+        // Setup the stream buffer
+        unsigned sampleSize = stream->GetSampleSize();
+        unsigned streamBufferSize = sampleSize * stream->GetIntFrequency() * STREAM_BUFFER_LENGTH / 1000;
 
-    if (sound->IsSixteenBit())
-    {
-        short* pos = (short*)position_;
-        short* end = (short*)sound->GetEnd();
-        short* repeat = (short*)sound->GetRepeat();
+        SharedPtr<Sound> streamBuffer(new Sound(context_));
+        streamBuffer->SetSize(streamBufferSize);
+        streamBuffer->SetFormat(stream->GetIntFrequency(), stream->IsSixteenBit(), stream->IsStereo());
+        streamBuffer->SetLooped(true);
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + (GET_IP_SAMPLE_LEFT() * vol) / 256;
-                ++dest;
-                *dest = *dest + (GET_IP_SAMPLE_RIGHT() * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
-            }
-            position_ = (signed char*)pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + (GET_IP_SAMPLE_LEFT() * vol) / 256;
-                ++dest;
-                *dest = *dest + (GET_IP_SAMPLE_RIGHT() * vol) / 256;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = (signed char*)pos;
-        }
-    }
-    else
-    {
-        signed char* pos = (signed char*)position_;
-        signed char* end = sound->GetEnd();
-        signed char* repeat = sound->GetRepeat();
+        AudioCommand command(AC_PLAYSTREAM, voice_);
+        command.sound_ = sound;
+        command.stream_ = stream;
+        command.streamBuffer_ = streamBuffer;
+        SendPlaybackCommand(command, true);
 
-        if (sound->IsLooped())
-        {
-            while (samples--)
-            {
-                *dest = *dest + GET_IP_SAMPLE_LEFT() * vol;
-                ++dest;
-                *dest = *dest + GET_IP_SAMPLE_RIGHT() * vol;
-                ++dest;
-                INC_POS_STEREO_LOOPED();
-            }
-            position_ = pos;
-        }
-        else
-        {
-            while (samples--)
-            {
-                *dest = *dest + GET_IP_SAMPLE_LEFT() * vol;
-                ++dest;
-                *dest = *dest + GET_IP_SAMPLE_RIGHT() * vol;
-                ++dest;
-                INC_POS_STEREO_ONESHOT();
-            }
-            position_ = pos;
-        }
+        RetireResources();
+        sound_ = sound;
+        soundStream_ = stream;
+        streamBuffer_ = streamBuffer;
+        return;
     }
 
-    fractPosition_ = fractPos;
+    // If stream pointer is null, stop playback
+    StopInternal();
+    sound_ = sound;
 }
 
-void SoundSource::MixZeroVolume(Sound* sound, unsigned samples, int mixRate)
+void SoundSource::StopInternal()
 {
-    float add = frequency_ * (float)samples / (float)mixRate;
-    int intAdd = (int)add;
-    int fractAdd = (int)((add - floorf(add)) * 65536.0f);
-    unsigned sampleSize = sound->GetSampleSize();
-
-    fractPosition_ += fractAdd;
-    if (fractPosition_ > 65535)
-    {
-        fractPosition_ &= 65535;
-        position_ += sampleSize;
-    }
-    position_ += intAdd * sampleSize;
+    SendPlaybackCommand(AudioCommand(AC_STOP, voice_), false);
 
-    if (position_ > sound->GetEnd())
-    {
-        if (sound->IsLooped())
-        {
-            while (position_ >= sound->GetEnd())
-            {
-                position_ -= (sound->GetEnd() - sound->GetRepeat());
-            }
-        }
-        else
-            position_ = 0;
-    }
+    // Free the sound stream and decode buffer if a stream was playing
+    RetireResources();
+    soundStream_.Reset();
+    streamBuffer_.Reset();
 }
 
-void SoundSource::MixNull(float timeStep)
+void SoundSource::SendPlaybackCommand(const AudioCommand& command, bool play)
 {
-    if (!position_ || !sound_ || !IsEnabledEffective())
-        return;
+    // Send the current parameters first, so that playback does not start with old ones
+    if (play)
+        UpdateVoiceParameters();
 
-    // Advance only the time position
-    timePosition_ += timeStep * frequency_ / sound_->GetFrequency();
+    playSequence_ = audio_->PushCommand(command);
+    playRequested_ = play;
+}
 
-    if (sound_->IsLooped())
-    {
-        // For simulated playback, simply reset the time position to zero when the sound loops
-        if (timePosition_ >= sound_->GetLength())
-            timePosition_ -= sound_->GetLength();
-    }
-    else
-    {
-        if (timePosition_ >= sound_->GetLength())
-        {
-            position_ = 0;
-            timePosition_ = 0.0f;
-        }
-    }
+void SoundSource::RetireResources()
+{
+    // The voice may use the current sound, stream and stream buffer until the audio thread processes the commands sent so far
+    if (sound_)
+        audio_->RetireObject(sound_);
+    if (soundStream_)
+        audio_->RetireObject(soundStream_);
+    if (streamBuffer_)
+        audio_->RetireObject(streamBuffer_);
+}
+
+bool SoundSource::IsCommandPending() const
+{
+    return audio_->IsCommandPending(playSequence_);
 }
 
 }
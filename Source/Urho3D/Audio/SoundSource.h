@@ -31,10 +31,97 @@ namespace Urho3D
 class Audio;
 class Sound;
 class SoundStream;
+struct AudioCommand;
 
 // Compressed audio decode buffer length in milliseconds
 static const int STREAM_BUFFER_LENGTH = 100;
 
+/// Mixing parameters of a sound source, copied to its voice by audio commands.
+struct SoundVoiceParameters
+{
+    /// Construct.
+    SoundVoiceParameters() :
+        frequency_(0.0f),
+        gain_(0.0f),
+        panning_(0.0f),
+        enabled_(false),
+        virtual_(false)
+    {
+    }
+
+    /// Test for equality with another parameter set.
+    bool operator == (const SoundVoiceParameters& rhs) const
+    {
+        return frequency_ == rhs.frequency_ && gain_ == rhs.gain_ && panning_ == rhs.panning_ && enabled_ == rhs.enabled_ &&
+            virtual_ == rhs.virtual_;
+    }
+
+    /// Test for inequality with another parameter set.
+    bool operator != (const SoundVoiceParameters& rhs) const { return !(*this == rhs); }
+
+    /// Frequency.
+    float frequency_;
+    /// Effective gain, including master gain and attenuation.
+    float gain_;
+    /// Stereo panning.
+    float panning_;
+    /// Enabled flag.
+    bool enabled_;
+    /// Virtual flag.
+    bool virtual_;
+};
+
+/// Playback state of a sound source on the audio thread. Changed only by audio commands, so that mixing does not need to wait for the main thread.
+class URHO3D_API SoundVoice
+{
+public:
+    /// Construct.
+    SoundVoice();
+
+    /// Start playing an uncompressed sound.
+    void Play(Sound* sound);
+    /// Start playing a sound stream through a stream buffer. The sound is the compressed sound being decoded, if any.
+    void Play(Sound* sound, SoundStream* stream, Sound* streamBuffer);
+    /// Stop playback.
+    void Stop();
+    /// Start playing an uncompressed sound from a position.
+    void SetPlayPosition(Sound* sound, signed char* pos);
+    /// Set mixing parameters.
+    void SetParameters(const SoundVoiceParameters& parameters) { parameters_ = parameters; }
+    /// Mix output to a float mix buffer.
+    void Mix(float* dest, unsigned samples, int mixRate, bool stereo, bool interpolation);
+    /// Advance playback pointer to simulate audio playback in headless mode.
+    void MixNull(float timeStep);
+
+    /// Return playback position.
+    volatile signed char* GetPlayPosition() const { return position_; }
+    /// Return playback time position.
+    float GetTimePosition() const { return timePosition_; }
+
+private:
+    /// Read and resample sound data into a float buffer, interleaved if the sound is stereo. Return the number of samples read, which is less than requested if a one-shot sound ended.
+    unsigned ReadSamples(Sound* sound, float* dest, unsigned samples, int mixRate, bool interpolation);
+    /// Advance playback pointer without producing audible output.
+    void MixZeroVolume(Sound* sound, unsigned samples, int mixRate);
+
+    /// Sound that is being played. Kept alive by the sound source.
+    Sound* sound_;
+    /// Sound stream that is being played.
+    SoundStream* stream_;
+    /// Decode buffer.
+    Sound* streamBuffer_;
+    /// Playback position.
+    volatile signed char* position_;
+    /// Playback fractional position.
+    int fractPosition_;
+    /// Playback time position.
+    volatile float timePosition_;
+    /// Unused stream bytes from previous mix.
+    int unusedStreamSize_;
+    /// Mixing parameters.
+    SoundVoiceParameters parameters_;
+};
+
 /// %Sound source component with stereo position.
 class URHO3D_API SoundSource : public Component
 {
@@ -72,17 +159,19 @@ public:
     void SetPanning(float panning);
    /// Set whether sound source will be automatically removed from the scene node when playback stops.
     void SetAutoRemove(bool enable);
+    /// Set priority for keeping the sound source mixed when the audio subsystem's voice limit is exceeded. Multiplied by the effective gain. Default 1.
+    void SetPriority(float priority);
     /// Set new playback position.
     void SetPlayPosition(signed char* pos);
     
     /// Return sound.
     Sound* GetSound() const { return sound_; }
     /// Return playback position.
-    volatile signed char* GetPlayPosition() const { return position_; }
+    volatile signed char* GetPlayPosition() const;
     /// Return sound type, determines the master gain group.
     String GetSoundType() const { return soundType_; }
     /// Return playback time position.
-    float GetTimePosition() const { return timePosition_; }
+    float GetTimePosition() const;
     /// Return frequency.
     float GetFrequency() const { return frequency_; }
     /// Return gain.
@@ -93,15 +182,25 @@ public:
     float GetPanning() const { return panning_; }
     /// Return autoremove mode.
     bool GetAutoRemove() const { return autoRemove_; }
+    /// Return priority.
+    float GetPriority() const { return priority_; }
+    /// Return effective gain, including master gain and attenuation.
+    float GetAudibility() const { return masterGain_ * attenuation_ * gain_; }
     /// Return whether is playing.
     bool IsPlaying() const;
+    /// Return whether is virtual, advancing the playback position without being mixed.
+    bool IsVirtual() const { return virtual_; }
     
     /// Update the sound source. Perform subclass specific operations. Called by Audio.
     virtual void Update(float timeStep);
-    /// Mix sound source output to a 32-bit clipping buffer. Called by Audio.
-    void Mix(int* dest, unsigned samples, int mixRate, bool stereo, bool interpolation);
     /// Update the effective master gain. Called internally and by Audio when the master gain changes.
     void UpdateMasterGain();
+    /// Send changed mixing parameters to the audio thread. Called internally and by Audio.
+    void UpdateVoiceParameters();
+    /// Return the playback state on the audio thread. Called by Audio.
+    SoundVoice* GetVoice() const { return voice_; }
+    /// Set whether is virtual. Called by Audio.
+    void SetVirtual(bool enable) { virtual_ = enable; }
     
     /// Set sound attribute.
     void SetSoundAttr(const ResourceRef& value);
@@ -133,53 +232,41 @@ protected:
     float autoRemoveTimer_;
     /// Effective master gain.
     float masterGain_;
+    /// Priority.
+    float priority_;
     /// Autoremove flag.
     bool autoRemove_;
     
 private:
-    /// Play a sound without locking the audio mutex. Called internally.
-    void PlayLockless(Sound* sound);
-    /// Play a sound stream without locking the audio mutex. Called internally.
-    void PlayLockless(SharedPtr<SoundStream> stream);
-    /// Stop sound without locking the audio mutex. Called internally.
-    void StopLockless();
-    /// Set new playback position without locking the audio mutex. Called internally.
-    void SetPlayPositionLockless(signed char* position);
-    /// Mix mono sample to mono buffer.
-    void MixMonoToMono(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix mono sample to stereo buffer.
-    void MixMonoToStereo(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix mono sample to mono buffer interpolated.
-    void MixMonoToMonoIP(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix mono sample to stereo buffer interpolated.
-    void MixMonoToStereoIP(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix stereo sample to mono buffer.
-    void MixStereoToMono(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix stereo sample to stereo buffer.
-    void MixStereoToStereo(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix stereo sample to mono buffer interpolated.
-    void MixStereoToMonoIP(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Mix stereo sample to stereo buffer interpolated.
-    void MixStereoToStereoIP(Sound* sound, int* dest, unsigned samples, int mixRate);
-    /// Advance playback pointer without producing audible output.
-    void MixZeroVolume(Sound* sound, unsigned samples, int mixRate);
-    /// Advance playback pointer to simulate audio playback in headless mode.
-    void MixNull(float timeStep);
+    /// Start playing a sound. Called internally.
+    void PlayInternal(Sound* sound);
+    /// Start playing a sound stream. The sound is the compressed sound being decoded, if any. Called internally.
+    void PlayInternal(SharedPtr<SoundStream> stream, Sound* sound);
+    /// Stop playback. Called internally.
+    void StopInternal();
+    /// Send a command that starts or stops playback. Called internally.
+    void SendPlaybackCommand(const AudioCommand& command, bool play);
+    /// Keep the current sound, stream and stream buffer alive until the audio thread has processed the commands sent so far.
+    void RetireResources();
+    /// Return whether the last playback command has not been processed by the audio thread yet.
+    bool IsCommandPending() const;
     
     /// Sound that is being played.
     SharedPtr<Sound> sound_;
     /// Sound stream that is being played.
     SharedPtr<SoundStream> soundStream_;
-    /// Playback position.
-    volatile signed char *position_;
-    /// Playback fractional position.
-    volatile int fractPosition_;
-    /// Playback time position.
-    volatile float timePosition_;
     /// Decode buffer.
     SharedPtr<Sound> streamBuffer_;
-    /// Unused stream bytes from previous frame.
-    int unusedStreamSize_;
+    /// Playback state on the audio thread.
+    SoundVoice* voice_;
+    /// Mixing parameters last sent to the audio thread.
+    SoundVoiceParameters voiceParameters_;
+    /// Command sequence number of the last playback command.
+    unsigned playSequence_;
+    /// Whether the last playback command started playback.
+    bool playRequested_;
+    /// Virtual flag.
+    bool virtual_;
 };
 
 }
@@ -38,6 +38,8 @@ public:
     
     /// Produce sound data into destination. Return number of bytes produced. Called by SoundSource from the mixing thread.
     virtual unsigned GetData(signed char* dest, unsigned numBytes) = 0;
+    /// Perform main thread processing, such as queuing background decoding. Called by SoundSource.
+    virtual void Update() {}
     
     /// Set sound data format.
     void SetFormat(unsigned frequency, bool sixteenBit, bool stereo);
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Swap.h"
+
+namespace Urho3D
+{
+
+/// Flat hash table base class. The elements are stored in a single array using open addressing with robin hood probing.
+class FlatHashBase
+{
+public:
+    /// Initial capacity.
+    static const unsigned MIN_CAPACITY = 8;
+    /// Maximum probe distance of an element. The table grows if exceeded.
+    static const unsigned MAX_DISTANCE = 255;
+
+    /// Construct.
+    FlatHashBase() :
+        slots_(0),
+        distances_(0),
+        size_(0),
+        capacity_(0),
+        shift_(0)
+    {
+    }
+
+    /// Swap with another table.
+    void Swap(FlatHashBase& rhs)
+    {
+        Urho3D::Swap(slots_, rhs.slots_);
+        Urho3D::Swap(distances_, rhs.distances_);
+        Urho3D::Swap(size_, rhs.size_);
+        Urho3D::Swap(capacity_, rhs.capacity_);
+        Urho3D::Swap(shift_, rhs.shift_);
+    }
+
+    /// Return number of elements.
+    unsigned Size() const { return size_; }
+    /// Return number of slots.
+    unsigned Capacity() const { return capacity_; }
+    /// Return whether has no elements.
+    bool Empty() const { return size_ == 0; }
+
+protected:
+    /// Return the slot an element with the hash value would ideally occupy. Fibonacci hashing spreads sequential keys such as IDs.
+    unsigned HomeIndex(unsigned hash) const { return (hash * 2654435769u) >> shift_; }
+    /// Return the next slot index, wrapping around.
+    unsigned NextIndex(unsigned index) const { return (index + 1) & (capacity_ - 1); }
+    /// Return the previous slot index, wrapping around.
+    unsigned PrevIndex(unsigned index) const { return (index - 1) & (capacity_ - 1); }
+    /// Return whether one more element would exceed the maximum load factor of 7/8.
+    bool IsFull() const { return (size_ + 1) * 8 > capacity_ * 7; }
+    /// Return the capacity needed for a number of elements.
+    static unsigned GetCapacityFor(unsigned numElements)
+    {
+        unsigned capacity = MIN_CAPACITY;
+        while (numElements * 8 > capacity * 7)
+            capacity <<= 1;
+        return capacity;
+    }
+    /// Set the capacity, which must be a power of two, and calculate the home index shift for it.
+    void SetCapacity(unsigned capacity)
+    {
+        capacity_ = capacity;
+        shift_ = 32;
+        while (capacity > 1)
+        {
+            capacity >>= 1;
+            --shift_;
+        }
+    }
+    /// Return the slot index of the first element at or after an index, or capacity if none.
+    unsigned GetOccupiedIndex(unsigned index) const
+    {
+        while (index < capacity_ && !distances_[index])
+            ++index;
+        return index;
+    }
+
+    /// Element storage.
+    unsigned char* slots_;
+    /// Probe distance of the element in each slot plus one, or zero if the slot is empty.
+    unsigned char* distances_;
+    /// Number of elements.
+    unsigned size_;
+    /// Number of slots, a power of two.
+    unsigned capacity_;
+    /// Home index shift.
+    unsigned shift_;
+};
+
+}
@@ -0,0 +1,470 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Hash.h"
+#include "../Container/Pair.h"
+#include "../Container/Vector.h"
+
+#include <cstring>
+#include <new>
+
+namespace Urho3D
+{
+
+/// Flat hash map template class. Stores the key-value pairs in a single array for cache-friendly lookup, but does not preserve
+/// insertion order. Inserting or erasing invalidates iterators and pointers to the pairs.
+template <class T, class U> class FlatHashMap : public FlatHashBase
+{
+public:
+    typedef T KeyType;
+    typedef U ValueType;
+
+    /// Flat hash map key-value pair with const key.
+    class KeyValue
+    {
+    public:
+        /// Construct with default key.
+        KeyValue() :
+            first_(T())
+        {
+        }
+
+        /// Construct with key and value.
+        KeyValue(const T& first, const U& second) :
+            first_(first),
+            second_(second)
+        {
+        }
+
+        /// Copy-construct.
+        KeyValue(const KeyValue& value) :
+            first_(value.first_),
+            second_(value.second_)
+        {
+        }
+
+        /// Test for equality with another pair.
+        bool operator == (const KeyValue& rhs) const { return first_ == rhs.first_ && second_ == rhs.second_; }
+        /// Test for inequality with another pair.
+        bool operator != (const KeyValue& rhs) const { return first_ != rhs.first_ || second_ != rhs.second_; }
+
+        /// Key.
+        const T first_;
+        /// Value.
+        U second_;
+
+    private:
+        /// Prevent assignment.
+        KeyValue& operator = (const KeyValue& rhs);
+    };
+
+    /// Flat hash map iterator.
+    struct Iterator
+    {
+        /// Construct.
+        Iterator() :
+            map_(0),
+            index_(0)
+        {
+        }
+
+        /// Construct with a map and slot index.
+        Iterator(FlatHashMap* map, unsigned index) :
+            map_(map),
+            index_(index)
+        {
+        }
+
+        /// Test for equality with another iterator.
+        bool operator == (const Iterator& rhs) const { return index_ == rhs.index_ && map_ == rhs.map_; }
+        /// Test for inequality with another iterator.
+        bool operator != (const Iterator& rhs) const { return index_ != rhs.index_ || map_ != rhs.map_; }
+        /// Preincrement the index.
+        Iterator& operator ++ () { index_ = map_->GetOccupiedIndex(index_ + 1); return *this; }
+        /// Postincrement the index.
+        Iterator operator ++ (int) { Iterator it = *this; ++*this; return it; }
+        /// Point to the pair.
+        KeyValue* operator -> () const { return map_->Slots() + index_; }
+        /// Dereference the pair.
+        KeyValue& operator * () const { return map_->Slots()[index_]; }
+
+        /// Map.
+        FlatHashMap* map_;
+        /// Slot index.
+        unsigned index_;
+    };
+
+    /// Flat hash map const iterator.
+    struct ConstIterator
+    {
+        /// Construct.
+        ConstIterator() :
+            map_(0),
+            index_(0)
+        {
+        }
+
+        /// Construct with a map and slot index.
+        ConstIterator(const FlatHashMap* map, unsigned index) :
+            map_(map),
+            index_(index)
+        {
+        }
+
+        /// Construct from a non-const iterator.
+        ConstIterator(const Iterator& rhs) :
+            map_(rhs.map_),
+            index_(rhs.index_)
+        {
+        }
+
+        /// Assign from a non-const iterator.
+        ConstIterator& operator = (const Iterator& rhs) { map_ = rhs.map_; index_ = rhs.index_; return *this; }
+        /// Test for equality with another iterator.
+        bool operator == (const ConstIterator& rhs) const { return index_ == rhs.index_ && map_ == rhs.map_; }
+        /// Test for inequality with another iterator.
+        bool operator != (const ConstIterator& rhs) const { return index_ != rhs.index_ || map_ != rhs.map_; }
+        /// Preincrement the index.
+        ConstIterator& operator ++ () { index_ = map_->GetOccupiedIndex(index_ + 1); return *this; }
+        /// Postincrement the index.
+        ConstIterator operator ++ (int) { ConstIterator it = *this; ++*this; return it; }
+        /// Point to the pair.
+        const KeyValue* operator -> () const { return map_->Slots() + index_; }
+        /// Dereference the pair.
+        const KeyValue& operator * () const { return map_->Slots()[index_]; }
+
+        /// Map.
+        const FlatHashMap* map_;
+        /// Slot index.
+        unsigned index_;
+    };
+
+    /// Construct empty.
+    FlatHashMap()
+    {
+    }
+
+    /// Construct from another map.
+    FlatHashMap(const FlatHashMap<T, U>& map)
+    {
+        Reserve(map.Size());
+        Insert(map);
+    }
+
+    /// Destruct.
+    ~FlatHashMap()
+    {
+        Clear();
+        delete[] slots_;
+        delete[] distances_;
+    }
+
+    /// Assign a map.
+    FlatHashMap& operator = (const FlatHashMap<T, U>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Clear();
+            Insert(rhs);
+        }
+        return *this;
+    }
+
+    /// Add-assign a pair.
+    FlatHashMap& operator += (const Pair<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a map.
+    FlatHashMap& operator += (const FlatHashMap<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another map.
+    bool operator == (const FlatHashMap<T, U>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            ConstIterator j = rhs.Find(i->first_);
+            if (j == rhs.End() || j->second_ != i->second_)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another map.
+    bool operator != (const FlatHashMap<T, U>& rhs) const { return !(*this == rhs); }
+
+    /// Index the map. Create a new pair if key not found.
+    U& operator [] (const T& key)
+    {
+        unsigned index = FindIndex(key);
+        if (index == capacity_)
+            index = InsertNew(key, U());
+        return Slots()[index].second_;
+    }
+
+    /// Insert a pair. Return an iterator to it.
+    Iterator Insert(const Pair<T, U>& pair) { return Iterator(this, InsertPair(pair.first_, pair.second_)); }
+
+    /// Insert a map.
+    void Insert(const FlatHashMap<T, U>& map)
+    {
+        for (ConstIterator i = map.Begin(); i != map.End(); ++i)
+            InsertPair(i->first_, i->second_);
+    }
+
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        if (index == capacity_)
+            return false;
+
+        EraseIndex(index);
+        return true;
+    }
+
+    /// Erase a pair by iterator. Return iterator to the next pair. Note that a pair that wrapped around from the start of the
+    /// array may be moved into the erased slot and visited again.
+    Iterator Erase(const Iterator& it)
+    {
+        if (it.map_ != this || it.index_ >= capacity_)
+            return End();
+
+        EraseIndex(it.index_);
+        return Iterator(this, GetOccupiedIndex(it.index_));
+    }
+
+    /// Clear the map. Keeps the allocated storage.
+    void Clear()
+    {
+        for (unsigned i = 0; i < capacity_ && size_; ++i)
+        {
+            if (distances_[i])
+            {
+                (Slots() + i)->~KeyValue();
+                distances_[i] = 0;
+                --size_;
+            }
+        }
+    }
+
+    /// Reserve storage for a number of pairs.
+    void Reserve(unsigned numElements)
+    {
+        unsigned capacity = GetCapacityFor(numElements);
+        if (capacity > capacity_)
+            Rehash(capacity);
+    }
+
+    /// Swap with another map.
+    void Swap(FlatHashMap<T, U>& map) { FlatHashBase::Swap(map); }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key) { return Iterator(this, FindIndex(key)); }
+    /// Return const iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const { return ConstIterator(this, FindIndex(key)); }
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const { return FindIndex(key) != capacity_; }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->first_);
+        return result;
+    }
+
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->second_);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(this, GetOccupiedIndex(0)); }
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(this, GetOccupiedIndex(0)); }
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(this, capacity_); }
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(this, capacity_); }
+
+private:
+    friend struct Iterator;
+    friend struct ConstIterator;
+
+    /// Return the pair array.
+    KeyValue* Slots() const { return reinterpret_cast<KeyValue*>(slots_); }
+
+    /// Return the slot index of a key, or capacity if not found.
+    unsigned FindIndex(const T& key) const
+    {
+        if (!size_)
+            return capacity_;
+
+        unsigned index = HomeIndex(MakeHash(key));
+        for (unsigned distance = 1; distances_[index] >= distance; ++distance)
+        {
+            if (distances_[index] == distance && Slots()[index].first_ == key)
+                return index;
+            index = NextIndex(index);
+        }
+
+        return capacity_;
+    }
+
+    /// Insert a pair, or change the value if the key exists. Return the slot index.
+    unsigned InsertPair(const T& key, const U& value)
+    {
+        unsigned index = FindIndex(key);
+        if (index != capacity_)
+        {
+            Slots()[index].second_ = value;
+            return index;
+        }
+        else
+            return InsertNew(key, value);
+    }
+
+    /// Insert a pair whose key does not exist yet. Return the slot index.
+    unsigned InsertNew(const T& key, const U& value)
+    {
+        if (!capacity_ || IsFull())
+            Rehash(capacity_ ? capacity_ << 1 : MIN_CAPACITY);
+
+        unsigned hash = MakeHash(key);
+        for (;;)
+        {
+            unsigned index = HomeIndex(hash);
+            unsigned distance = 1;
+
+            // Find the first slot whose element is closer to its own home slot. Elements in the same cluster stay ordered by
+            // home slot, so the following elements can simply be shifted forward by one slot
+            while (distances_[index] >= distance && distance < MAX_DISTANCE)
+            {
+                index = NextIndex(index);
+                ++distance;
+            }
+
+            unsigned empty = index;
+            while (distances_[empty] && distances_[empty] < MAX_DISTANCE)
+                empty = NextIndex(empty);
+
+            // If a probe distance would overflow, grow the table and retry
+            if (distance >= MAX_DISTANCE || distances_[empty])
+            {
+                Rehash(capacity_ << 1);
+                continue;
+            }
+
+            while (empty != index)
+            {
+                unsigned prev = PrevIndex(empty);
+                new(Slots() + empty) KeyValue(Slots()[prev]);
+                (Slots() + prev)->~KeyValue();
+                distances_[empty] = distances_[prev] + 1;
+                empty = prev;
+            }
+
+            new(Slots() + index) KeyValue(key, value);
+            distances_[index] = (unsigned char)distance;
+            ++size_;
+            return index;
+        }
+    }
+
+    /// Erase the pair at a slot index. Shift the following elements of the cluster back by one slot.
+    void EraseIndex(unsigned index)
+    {
+        (Slots() + index)->~KeyValue();
+
+        unsigned next = NextIndex(index);
+        while (distances_[next] > 1)
+        {
+            new(Slots() + index) KeyValue(Slots()[next]);
+            (Slots() + next)->~KeyValue();
+            distances_[index] = distances_[next] - 1;
+            index = next;
+            next = NextIndex(next);
+        }
+
+        distances_[index] = 0;
+        --size_;
+    }
+
+    /// Reallocate to a new capacity, which must be a power of two, and reinsert the pairs.
+    void Rehash(unsigned capacity)
+    {
+        KeyValue* oldSlots = Slots();
+        unsigned char* oldDistances = distances_;
+        unsigned oldCapacity = capacity_;
+
+        slots_ = new unsigned char[capacity * sizeof(KeyValue)];
+        distances_ = new unsigned char[capacity];
+        memset(distances_, 0, capacity);
+        size_ = 0;
+        SetCapacity(capacity);
+
+        for (unsigned i = 0; i < oldCapacity; ++i)
+        {
+            if (oldDistances[i])
+            {
+                InsertNew(oldSlots[i].first_, oldSlots[i].second_);
+                (oldSlots + i)->~KeyValue();
+            }
+        }
+
+        delete[] reinterpret_cast<unsigned char*>(oldSlots);
+        delete[] oldDistances;
+    }
+};
+
+}
+
+namespace std
+{
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator begin(const Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator end(const Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator begin(Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator end(Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+}
@@ -0,0 +1,402 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Hash.h"
+#include "../Container/Vector.h"
+
+#include <cstring>
+#include <new>
+
+namespace Urho3D
+{
+
+/// Flat hash set template class. Stores the keys in a single array for cache-friendly lookup, but does not preserve insertion
+/// order. Inserting or erasing invalidates iterators and pointers to the keys.
+template <class T> class FlatHashSet : public FlatHashBase
+{
+public:
+    typedef T KeyType;
+
+    /// Flat hash set iterator.
+    struct Iterator
+    {
+        /// Construct.
+        Iterator() :
+            set_(0),
+            index_(0)
+        {
+        }
+
+        /// Construct with a set and slot index.
+        Iterator(FlatHashSet* set, unsigned index) :
+            set_(set),
+            index_(index)
+        {
+        }
+
+        /// Test for equality with another iterator.
+        bool operator == (const Iterator& rhs) const { return index_ == rhs.index_ && set_ == rhs.set_; }
+        /// Test for inequality with another iterator.
+        bool operator != (const Iterator& rhs) const { return index_ != rhs.index_ || set_ != rhs.set_; }
+        /// Preincrement the index.
+        Iterator& operator ++ () { index_ = set_->GetOccupiedIndex(index_ + 1); return *this; }
+        /// Postincrement the index.
+        Iterator operator ++ (int) { Iterator it = *this; ++*this; return it; }
+        /// Point to the key.
+        const T* operator -> () const { return set_->Slots() + index_; }
+        /// Dereference the key.
+        const T& operator * () const { return set_->Slots()[index_]; }
+
+        /// Set.
+        FlatHashSet* set_;
+        /// Slot index.
+        unsigned index_;
+    };
+
+    /// Flat hash set const iterator.
+    struct ConstIterator
+    {
+        /// Construct.
+        ConstIterator() :
+            set_(0),
+            index_(0)
+        {
+        }
+
+        /// Construct with a set and slot index.
+        ConstIterator(const FlatHashSet* set, unsigned index) :
+            set_(set),
+            index_(index)
+        {
+        }
+
+        /// Construct from a non-const iterator.
+        ConstIterator(const Iterator& rhs) :
+            set_(rhs.set_),
+            index_(rhs.index_)
+        {
+        }
+
+        /// Assign from a non-const iterator.
+        ConstIterator& operator = (const Iterator& rhs) { set_ = rhs.set_; index_ = rhs.index_; return *this; }
+        /// Test for equality with another iterator.
+        bool operator == (const ConstIterator& rhs) const { return index_ == rhs.index_ && set_ == rhs.set_; }
+        /// Test for inequality with another iterator.
+        bool operator != (const ConstIterator& rhs) const { return index_ != rhs.index_ || set_ != rhs.set_; }
+        /// Preincrement the index.
+        ConstIterator& operator ++ () { index_ = set_->GetOccupiedIndex(index_ + 1); return *this; }
+        /// Postincrement the index.
+        ConstIterator operator ++ (int) { ConstIterator it = *this; ++*this; return it; }
+        /// Point to the key.
+        const T* operator -> () const { return set_->Slots() + index_; }
+        /// Dereference the key.
+        const T& operator * () const { return set_->Slots()[index_]; }
+
+        /// Set.
+        const FlatHashSet* set_;
+        /// Slot index.
+        unsigned index_;
+    };
+
+    /// Construct empty.
+    FlatHashSet()
+    {
+    }
+
+    /// Construct from another set.
+    FlatHashSet(const FlatHashSet<T>& set)
+    {
+        Reserve(set.Size());
+        Insert(set);
+    }
+
+    /// Destruct.
+    ~FlatHashSet()
+    {
+        Clear();
+        delete[] slots_;
+        delete[] distances_;
+    }
+
+    /// Assign a set.
+    FlatHashSet& operator = (const FlatHashSet<T>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Clear();
+            Insert(rhs);
+        }
+        return *this;
+    }
+
+    /// Add-assign a key.
+    FlatHashSet& operator += (const T& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a set.
+    FlatHashSet& operator += (const FlatHashSet<T>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another set.
+    bool operator == (const FlatHashSet<T>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            if (!rhs.Contains(*i))
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another set.
+    bool operator != (const FlatHashSet<T>& rhs) const { return !(*this == rhs); }
+
+    /// Insert a key. Return an iterator to it.
+    Iterator Insert(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        if (index == capacity_)
+            index = InsertNew(key);
+        return Iterator(this, index);
+    }
+
+    /// Insert a key. Return an iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const T& key, bool& exists)
+    {
+        unsigned index = FindIndex(key);
+        exists = index != capacity_;
+        if (!exists)
+            index = InsertNew(key);
+        return Iterator(this, index);
+    }
+
+    /// Insert a set.
+    void Insert(const FlatHashSet<T>& set)
+    {
+        for (ConstIterator i = set.Begin(); i != set.End(); ++i)
+            Insert(*i);
+    }
+
+    /// Erase a key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        if (index == capacity_)
+            return false;
+
+        EraseIndex(index);
+        return true;
+    }
+
+    /// Erase a key by iterator. Return iterator to the next key. Note that a key that wrapped around from the start of the array
+    /// may be moved into the erased slot and visited again.
+    Iterator Erase(const Iterator& it)
+    {
+        if (it.set_ != this || it.index_ >= capacity_)
+            return End();
+
+        EraseIndex(it.index_);
+        return Iterator(this, GetOccupiedIndex(it.index_));
+    }
+
+    /// Clear the set. Keeps the allocated storage.
+    void Clear()
+    {
+        for (unsigned i = 0; i < capacity_ && size_; ++i)
+        {
+            if (distances_[i])
+            {
+                (Slots() + i)->~T();
+                distances_[i] = 0;
+                --size_;
+            }
+        }
+    }
+
+    /// Reserve storage for a number of keys.
+    void Reserve(unsigned numElements)
+    {
+        unsigned capacity = GetCapacityFor(numElements);
+        if (capacity > capacity_)
+            Rehash(capacity);
+    }
+
+    /// Swap with another set.
+    void Swap(FlatHashSet<T>& set) { FlatHashBase::Swap(set); }
+
+    /// Return iterator to the key, or end iterator if not found.
+    Iterator Find(const T& key) { return Iterator(this, FindIndex(key)); }
+    /// Return const iterator to the key, or end iterator if not found.
+    ConstIterator Find(const T& key) const { return ConstIterator(this, FindIndex(key)); }
+    /// Return whether contains a key.
+    bool Contains(const T& key) const { return FindIndex(key) != capacity_; }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(this, GetOccupiedIndex(0)); }
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(this, GetOccupiedIndex(0)); }
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(this, capacity_); }
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(this, capacity_); }
+
+private:
+    friend struct Iterator;
+    friend struct ConstIterator;
+
+    /// Return the key array.
+    T* Slots() const { return reinterpret_cast<T*>(slots_); }
+
+    /// Return the slot index of a key, or capacity if not found.
+    unsigned FindIndex(const T& key) const
+    {
+        if (!size_)
+            return capacity_;
+
+        unsigned index = HomeIndex(MakeHash(key));
+        for (unsigned distance = 1; distances_[index] >= distance; ++distance)
+        {
+            if (distances_[index] == distance && Slots()[index] == key)
+                return index;
+            index = NextIndex(index);
+        }
+
+        return capacity_;
+    }
+
+    /// Insert a key that does not exist yet. Return the slot index.
+    unsigned InsertNew(const T& key)
+    {
+        if (!capacity_ || IsFull())
+            Rehash(capacity_ ? capacity_ << 1 : MIN_CAPACITY);
+
+        unsigned hash = MakeHash(key);
+        for (;;)
+        {
+            unsigned index = HomeIndex(hash);
+            unsigned distance = 1;
+
+            // Find the first slot whose element is closer to its own home slot. Elements in the same cluster stay ordered by
+            // home slot, so the following elements can simply be shifted forward by one slot
+            while (distances_[index] >= distance && distance < MAX_DISTANCE)
+            {
+                index = NextIndex(index);
+                ++distance;
+            }
+
+            unsigned empty = index;
+            while (distances_[empty] && distances_[empty] < MAX_DISTANCE)
+                empty = NextIndex(empty);
+
+            // If a probe distance would overflow, grow the table and retry
+            if (distance >= MAX_DISTANCE || distances_[empty])
+            {
+                Rehash(capacity_ << 1);
+                continue;
+            }
+
+            while (empty != index)
+            {
+                unsigned prev = PrevIndex(empty);
+                new(Slots() + empty) T(Slots()[prev]);
+                (Slots() + prev)->~T();
+                distances_[empty] = distances_[prev] + 1;
+                empty = prev;
+            }
+
+            new(Slots() + index) T(key);
+            distances_[index] = (unsigned char)distance;
+            ++size_;
+            return index;
+        }
+    }
+
+    /// Erase the key at a slot index. Shift the following elements of the cluster back by one slot.
+    void EraseIndex(unsigned index)
+    {
+        (Slots() + index)->~T();
+
+        unsigned next = NextIndex(index);
+        while (distances_[next] > 1)
+        {
+            new(Slots() + index) T(Slots()[next]);
+            (Slots() + next)->~T();
+            distances_[index] = distances_[next] - 1;
+            index = next;
+            next = NextIndex(next);
+        }
+
+        distances_[index] = 0;
+        --size_;
+    }
+
+    /// Reallocate to a new capacity, which must be a power of two, and reinsert the keys.
+    void Rehash(unsigned capacity)
+    {
+        T* oldSlots = Slots();
+        unsigned char* oldDistances = distances_;
+        unsigned oldCapacity = capacity_;
+
+        slots_ = new unsigned char[capacity * sizeof(T)];
+        distances_ = new unsigned char[capacity];
+        memset(distances_, 0, capacity);
+        size_ = 0;
+        SetCapacity(capacity);
+
+        for (unsigned i = 0; i < oldCapacity; ++i)
+        {
+            if (oldDistances[i])
+            {
+                InsertNew(oldSlots[i]);
+                (oldSlots + i)->~T();
+            }
+        }
+
+        delete[] reinterpret_cast<unsigned char*>(oldSlots);
+        delete[] oldDistances;
+    }
+};
+
+}
+
+namespace std
+{
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator begin(const Urho3D::FlatHashSet<T>& v) { return v.Begin(); }
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator end(const Urho3D::FlatHashSet<T>& v) { return v.End(); }
+template <class T> typename Urho3D::FlatHashSet<T>::Iterator begin(Urho3D::FlatHashSet<T>& v) { return v.Begin(); }
+template <class T> typename Urho3D::FlatHashSet<T>::Iterator end(Urho3D::FlatHashSet<T>& v) { return v.End(); }
+
+}
@@ -186,6 +186,17 @@ public:
         *this = map;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another hash map.
+    HashMap(HashMap<T, U>&& map)
+    {
+        // Reserve the tail node so that the other hash map stays valid after the swap
+        allocator_ = AllocatorInitialize(sizeof(Node));
+        head_ = tail_ = ReserveNode();
+        Swap(map);
+    }
+#endif
+    
     /// Destruct.
     ~HashMap()
     {
@@ -203,6 +214,15 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign a hash map.
+    HashMap& operator = (HashMap<T, U>&& rhs)
+    {
+        Swap(rhs);
+        return *this;
+    }
+#endif
+    
     /// Add-assign a pair.
     HashMap& operator += (const Pair<T, U>& rhs)
     {
@@ -446,6 +466,23 @@ public:
             return End();
     }
     
+    /// Return const iterator to the pair with a key equal to a key of another type, or end iterator if not found. The other type must hash and compare equal to the key type, for example StringView for String keys.
+    template <class K> ConstIterator FindAs(const K& key) const
+    {
+        if (!ptrs_)
+            return End();
+        
+        Node* node = static_cast<Node*>(Ptrs()[MakeHash(key) & (NumBuckets() - 1)]);
+        while (node)
+        {
+            if (key == node->pair_.first_)
+                return ConstIterator(node);
+            node = node->Down();
+        }
+        
+        return End();
+    }
+    
     /// Return whether contains a pair with key.
     bool Contains(const T& key) const
     {
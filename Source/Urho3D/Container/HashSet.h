@@ -142,6 +142,17 @@ public:
         *this = set;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another hash set.
+    HashSet(HashSet<T>&& set)
+    {
+        // Reserve the tail node so that the other hash set stays valid after the swap
+        allocator_ = AllocatorInitialize(sizeof(Node));
+        head_ = tail_ = ReserveNode();
+        Swap(set);
+    }
+#endif
+    
     /// Destruct.
     ~HashSet()
     {
@@ -159,6 +170,15 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign a hash set.
+    HashSet& operator = (HashSet<T>&& rhs)
+    {
+        Swap(rhs);
+        return *this;
+    }
+#endif
+    
     /// Add-assign a value.
     HashSet& operator += (const T& rhs)
     {
@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Container/LinearAllocator.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Alignment of allocations.
+static const unsigned LINEAR_ALIGNMENT = 16;
+/// Minimum size of a chunk in bytes.
+static const unsigned MIN_CHUNK_SIZE = 16384;
+
+/// %Linear allocator memory chunk.
+struct LinearAllocatorChunk
+{
+    /// Previous chunk.
+    LinearAllocatorChunk* prev_;
+    /// Start of the usable memory, aligned.
+    unsigned char* start_;
+    /// Current allocation position.
+    unsigned char* pos_;
+    /// End of the usable memory.
+    unsigned char* end_;
+    /// Memory follows.
+};
+
+static unsigned AlignSize(unsigned size)
+{
+    return (size + LINEAR_ALIGNMENT - 1) & ~(LINEAR_ALIGNMENT - 1);
+}
+
+LinearAllocator::LinearAllocator(unsigned initialCapacity) :
+    chunk_(0),
+    last_(0),
+    usedMemory_(0),
+    capacity_(0)
+{
+    if (initialCapacity)
+        AddChunk(initialCapacity);
+}
+
+LinearAllocator::LinearAllocator(const LinearAllocator& rhs) :
+    chunk_(0),
+    last_(0),
+    usedMemory_(0),
+    capacity_(0)
+{
+}
+
+LinearAllocator::~LinearAllocator()
+{
+    FreeChunks();
+}
+
+void* LinearAllocator::Allocate(unsigned size)
+{
+    size = AlignSize(size ? size : 1);
+    if (!chunk_ || (unsigned)(chunk_->end_ - chunk_->pos_) < size)
+        AddChunk(size);
+
+    last_ = chunk_->pos_;
+    chunk_->pos_ += size;
+    usedMemory_ += size;
+    return last_;
+}
+
+void* LinearAllocator::Reallocate(void* ptr, unsigned oldSize, unsigned newSize)
+{
+    if (!ptr)
+        return Allocate(newSize);
+
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(ptr);
+    unsigned alignedOld = AlignSize(oldSize);
+    unsigned alignedNew = AlignSize(newSize);
+
+    // Extend the latest allocation in place if possible
+    if (bytes == last_ && bytes + alignedOld == chunk_->pos_ && (unsigned)(chunk_->end_ - bytes) >= alignedNew)
+    {
+        if (alignedNew > alignedOld)
+        {
+            chunk_->pos_ = bytes + alignedNew;
+            usedMemory_ += alignedNew - alignedOld;
+        }
+        return ptr;
+    }
+
+    void* newPtr = Allocate(newSize);
+    memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+    return newPtr;
+}
+
+void LinearAllocator::Reset()
+{
+    if (!chunk_)
+        return;
+
+    if (chunk_->prev_)
+    {
+        // Consolidate to one chunk so that the next round of allocations fits without adding chunks
+        unsigned capacity = capacity_;
+        FreeChunks();
+        AddChunk(capacity);
+    }
+    else
+        chunk_->pos_ = chunk_->start_;
+
+    last_ = 0;
+    usedMemory_ = 0;
+}
+
+void LinearAllocator::AddChunk(unsigned size)
+{
+    // Grow geometrically to keep the number of chunks low before the first reset
+    if (size < capacity_)
+        size = capacity_;
+    if (size < MIN_CHUNK_SIZE)
+        size = MIN_CHUNK_SIZE;
+    size = AlignSize(size);
+
+    unsigned char* memory = new unsigned char[sizeof(LinearAllocatorChunk) + size + LINEAR_ALIGNMENT];
+    LinearAllocatorChunk* chunk = reinterpret_cast<LinearAllocatorChunk*>(memory);
+    size_t start = (size_t)(memory + sizeof(LinearAllocatorChunk) + LINEAR_ALIGNMENT - 1) & ~(size_t)(LINEAR_ALIGNMENT - 1);
+    chunk->prev_ = chunk_;
+    chunk->start_ = reinterpret_cast<unsigned char*>(start);
+    chunk->pos_ = chunk->start_;
+    chunk->end_ = chunk->start_ + size;
+    chunk_ = chunk;
+    capacity_ += size;
+}
+
+void LinearAllocator::FreeChunks()
+{
+    while (chunk_)
+    {
+        LinearAllocatorChunk* prev = chunk_->prev_;
+        delete[] reinterpret_cast<unsigned char*>(chunk_);
+        chunk_ = prev;
+    }
+
+    last_ = 0;
+    capacity_ = 0;
+}
+
+}
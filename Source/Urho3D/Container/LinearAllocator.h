@@ -0,0 +1,223 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/VectorBase.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace Urho3D
+{
+
+struct LinearAllocatorChunk;
+
+/// Linear allocator for transient data. Allocations are pointer bumps inside large chunks and are never freed individually;
+/// instead all memory is released at once by Reset(), for example when the per-frame data owning it is cleared.
+class URHO3D_API LinearAllocator
+{
+public:
+    /// Construct with initial capacity in bytes.
+    LinearAllocator(unsigned initialCapacity = 0);
+    /// Construct empty. Memory of the other allocator is neither shared nor copied.
+    LinearAllocator(const LinearAllocator& rhs);
+    /// Destruct. Free all chunks.
+    ~LinearAllocator();
+
+    /// Assign. Keeps the own memory, as allocations can not be transferred between allocators.
+    LinearAllocator& operator = (const LinearAllocator& rhs) { return *this; }
+
+    /// Allocate memory aligned to 16 bytes.
+    void* Allocate(unsigned size);
+    /// Grow an allocation. Extends in place if it is the latest allocation and fits, otherwise allocates and copies.
+    void* Reallocate(void* ptr, unsigned oldSize, unsigned newSize);
+    /// Release all allocations. If they did not fit in one chunk, replace the chunks with one big enough for all of them.
+    void Reset();
+
+    /// Return bytes allocated since the last reset.
+    unsigned GetUsedMemory() const { return usedMemory_; }
+    /// Return total capacity of the chunks in bytes.
+    unsigned GetCapacity() const { return capacity_; }
+
+private:
+    /// Allocate a new chunk that holds at least the given amount of bytes and make it current.
+    void AddChunk(unsigned size);
+    /// Free all chunks.
+    void FreeChunks();
+
+    /// Current chunk.
+    LinearAllocatorChunk* chunk_;
+    /// Latest allocation.
+    unsigned char* last_;
+    /// Bytes allocated since the last reset.
+    unsigned usedMemory_;
+    /// Total capacity of the chunks.
+    unsigned capacity_;
+};
+
+/// %Vector template class for POD types that allocates its buffer from a linear allocator. Does not free memory; it is
+/// released when the allocator is reset. The vector must not be used after that without calling Clear() first.
+template <class T> class LinearVector
+{
+public:
+    typedef T ValueType;
+    typedef RandomAccessIterator<T> Iterator;
+    typedef RandomAccessConstIterator<T> ConstIterator;
+
+    /// Construct empty without an allocator.
+    LinearVector() :
+        allocator_(0),
+        buffer_(0),
+        size_(0),
+        capacity_(0)
+    {
+    }
+
+    /// Construct empty with an allocator.
+    explicit LinearVector(LinearAllocator* allocator) :
+        allocator_(allocator),
+        buffer_(0),
+        size_(0),
+        capacity_(0)
+    {
+    }
+
+    /// Construct from another vector. Allocates from the same allocator.
+    LinearVector(const LinearVector<T>& vector) :
+        allocator_(vector.allocator_),
+        buffer_(0),
+        size_(0),
+        capacity_(0)
+    {
+        *this = vector;
+    }
+
+    /// Assign from another vector. Keeps the own allocator if it has one.
+    LinearVector<T>& operator = (const LinearVector<T>& rhs)
+    {
+        if (&rhs == this)
+            return *this;
+
+        if (!allocator_)
+            allocator_ = rhs.allocator_;
+        size_ = 0;
+        Resize(rhs.size_);
+        if (size_)
+            memcpy(buffer_, rhs.buffer_, size_ * sizeof(T));
+        return *this;
+    }
+
+    /// Return element at index.
+    T& operator [] (unsigned index) { assert(index < size_); return buffer_[index]; }
+    /// Return const element at index.
+    const T& operator [] (unsigned index) const { assert(index < size_); return buffer_[index]; }
+
+    /// Set the allocator. Clears the vector.
+    void SetAllocator(LinearAllocator* allocator)
+    {
+        allocator_ = allocator;
+        buffer_ = 0;
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    /// Add an element at the end.
+    void Push(const T& value)
+    {
+        if (size_ < capacity_)
+            buffer_[size_++] = value;
+        else
+        {
+            // The value may be in the old buffer, which stays allocated, so it can be copied after growing
+            Reserve(capacity_ ? capacity_ + ((capacity_ + 1) >> 1) : 4);
+            buffer_[size_++] = value;
+        }
+    }
+
+    /// Remove the last element.
+    void Pop()
+    {
+        if (size_)
+            --size_;
+    }
+
+    /// Resize the vector. New elements are uninitialized.
+    void Resize(unsigned newSize)
+    {
+        if (newSize > capacity_)
+            Reserve(newSize);
+        size_ = newSize;
+    }
+
+    /// Set new capacity. Does not shrink.
+    void Reserve(unsigned newCapacity)
+    {
+        if (newCapacity <= capacity_)
+            return;
+
+        assert(allocator_);
+        buffer_ = reinterpret_cast<T*>(allocator_->Reallocate(buffer_, capacity_ * sizeof(T), newCapacity * sizeof(T)));
+        capacity_ = newCapacity;
+    }
+
+    /// Clear the vector. Forgets the buffer, as the allocator may have been reset.
+    void Clear()
+    {
+        buffer_ = 0;
+        size_ = 0;
+        capacity_ = 0;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(buffer_); }
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(buffer_); }
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(buffer_ + size_); }
+    /// Return const iterator to the end.
+    ConstIterator End() const { return ConstIterator(buffer_ + size_); }
+    /// Return first element.
+    T& Front() { assert(size_); return buffer_[0]; }
+    /// Return last element.
+    T& Back() { assert(size_); return buffer_[size_ - 1]; }
+    /// Return size of vector.
+    unsigned Size() const { return size_; }
+    /// Return capacity of vector.
+    unsigned Capacity() const { return capacity_; }
+    /// Return whether vector is empty.
+    bool Empty() const { return size_ == 0; }
+    /// Return the allocator.
+    LinearAllocator* GetAllocator() const { return allocator_; }
+
+private:
+    /// Allocator.
+    LinearAllocator* allocator_;
+    /// Buffer.
+    T* buffer_;
+    /// Number of elements.
+    unsigned size_;
+    /// Number of elements the buffer can hold.
+    unsigned capacity_;
+};
+
+}
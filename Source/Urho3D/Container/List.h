@@ -136,6 +136,17 @@ public:
         *this = list;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another list.
+    List(List<T>&& list)
+    {
+        // Reserve the tail node so that the other list stays valid after the swap
+        allocator_ = AllocatorInitialize(sizeof(Node));
+        head_ = tail_ = ReserveNode();
+        Swap(list);
+    }
+#endif
+    
     /// Destruct.
     ~List()
     {
@@ -153,6 +164,15 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign a list.
+    List& operator = (List<T>&& rhs)
+    {
+        Swap(rhs);
+        return *this;
+    }
+#endif
+    
     /// Add-assign an element.
     List& operator += (const T& rhs)
     {
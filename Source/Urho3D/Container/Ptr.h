@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/RefCounted.h"
+#include "../Container/Swap.h"
 
 #include <cassert>
 #include <cstddef>
@@ -47,6 +48,15 @@ public:
         AddRef();
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another shared pointer, taking over its reference.
+    SharedPtr(SharedPtr<T>&& rhs) :
+        ptr_(rhs.ptr_)
+    {
+        rhs.ptr_ = 0;
+    }
+#endif
+    
     /// Construct from a raw pointer.
     explicit SharedPtr(T* ptr) :
         ptr_(ptr)
@@ -73,6 +83,21 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign from another shared pointer, taking over its reference.
+    SharedPtr<T>& operator = (SharedPtr<T>&& rhs)
+    {
+        if (&rhs == this)
+            return *this;
+        
+        ReleaseRef();
+        ptr_ = rhs.ptr_;
+        rhs.ptr_ = 0;
+        
+        return *this;
+    }
+#endif
+    
     /// Assign from a raw pointer.
     SharedPtr<T>& operator = (T* ptr)
     {
@@ -207,6 +232,17 @@ public:
         AddRef();
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another weak pointer, taking over its reference.
+    WeakPtr(WeakPtr<T>&& rhs) :
+        ptr_(rhs.ptr_),
+        refCount_(rhs.refCount_)
+    {
+        rhs.ptr_ = 0;
+        rhs.refCount_ = 0;
+    }
+#endif
+    
     /// Construct from a shared pointer.
     WeakPtr(const SharedPtr<T>& rhs) :
         ptr_(rhs.Get()),
@@ -257,6 +293,23 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign from another weak pointer, taking over its reference.
+    WeakPtr<T>& operator = (WeakPtr<T>&& rhs)
+    {
+        if (&rhs == this)
+            return *this;
+        
+        ReleaseRef();
+        ptr_ = rhs.ptr_;
+        refCount_ = rhs.refCount_;
+        rhs.ptr_ = 0;
+        rhs.refCount_ = 0;
+        
+        return *this;
+    }
+#endif
+    
     /// Assign from a raw pointer.
     WeakPtr<T>& operator = (T* ptr)
     {
@@ -21,6 +21,7 @@
 //
 
 #include "../Container/RefCounted.h"
+#include "../Core/ObjectPool.h"
 
 #include <cassert>
 
@@ -29,6 +30,23 @@
 namespace Urho3D
 {
 
+void* RefCount::operator new(size_t size)
+{
+    return ObjectPool::Allocate(size);
+}
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+void* RefCount::operator new(size_t size, int, const char*, int)
+{
+    return ObjectPool::Allocate(size);
+}
+#endif
+
+void RefCount::operator delete(void* ptr, size_t size)
+{
+    ObjectPool::Free(ptr, size);
+}
+
 RefCounted::RefCounted() :
     refCount_(new RefCount())
 {
@@ -22,11 +22,13 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace Urho3D
 {
 
-/// Reference count structure.
-struct RefCount
+/// Reference count structure. Allocated from the object pool.
+struct URHO3D_API RefCount
 {
     /// Construct.
     RefCount() :
@@ -43,6 +45,15 @@ struct RefCount
         weakRefs_ = -1;
     }
     
+    /// Allocate memory from the object pool.
+    static void* operator new(size_t size);
+#if defined(_MSC_VER) && defined(_DEBUG)
+    /// Allocate memory from the object pool. Overload for the debug new of DebugNew.h.
+    static void* operator new(size_t size, int, const char*, int);
+#endif
+    /// Free memory to the object pool.
+    static void operator delete(void* ptr, size_t size);
+    
     /// Reference count. If below zero, the object has been destroyed.
     int refs_;
     /// Weak reference count.
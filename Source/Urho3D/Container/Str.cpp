@@ -159,7 +159,7 @@ String::String(char value) :
     buffer_(&endZero)
 {
     Resize(1);
-    buffer_[0] = value;
+    Buffer()[0] = value;
 }
 
 String::String(char value, unsigned length) :
@@ -169,7 +169,7 @@ String::String(char value, unsigned length) :
 {
     Resize(length);
     for (unsigned i = 0; i < length; ++i)
-        buffer_[i] = value;
+        Buffer()[i] = value;
 }
 
 String& String::operator += (int rhs)
@@ -224,12 +224,13 @@ String& String::operator += (bool rhs)
 
 void String::Replace(char replaceThis, char replaceWith, bool caseSensitive)
 {
+    char* buffer = Buffer();
     if (caseSensitive)
     {
         for (unsigned i = 0; i < length_; ++i)
         {
-            if (buffer_[i] == replaceThis)
-                buffer_[i] = replaceWith;
+            if (buffer[i] == replaceThis)
+                buffer[i] = replaceWith;
         }
     }
     else
@@ -237,8 +238,8 @@ void String::Replace(char replaceThis, char replaceWith, bool caseSensitive)
         replaceThis = tolower(replaceThis);
         for (unsigned i = 0; i < length_; ++i)
         {
-            if (tolower(buffer_[i]) == replaceThis)
-                buffer_[i] = replaceWith;
+            if (tolower(buffer[i]) == replaceThis)
+                buffer[i] = replaceWith;
         }
     }
 }
@@ -263,7 +264,7 @@ void String::Replace(unsigned pos, unsigned length, const String& replaceWith)
     if (pos + length > length_)
         return;
     
-    Replace(pos, length, replaceWith.buffer_, replaceWith.length_);
+    Replace(pos, length, replaceWith.Buffer(), replaceWith.length_);
 }
 
 void String::Replace(unsigned pos, unsigned length, const char* replaceWith)
@@ -321,7 +322,7 @@ String& String::Append(const char* str, unsigned length)
     {
         unsigned oldLength = length_;
         Resize(oldLength + length);
-        CopyChars(&buffer_[oldLength], str, length);
+        CopyChars(&Buffer()[oldLength], str, length);
     }
     return *this;
 }
@@ -349,7 +350,7 @@ void String::Insert(unsigned pos, char c)
         unsigned oldLength = length_;
         Resize(length_ + 1);
         MoveRange(pos + 1, pos, oldLength - pos);
-        buffer_[pos] = c;
+        Buffer()[pos] = c;
     }
 }
 
@@ -418,32 +419,46 @@ void String::Resize(unsigned newLength)
         if (!newLength)
             return;
         
-        // Calculate initial capacity
-        capacity_ = newLength + 1;
-        if (capacity_ < MIN_CAPACITY)
-            capacity_ = MIN_CAPACITY;
-        
-        buffer_ = new char[capacity_];
+        // Use the inline buffer for short strings
+        if (newLength + 1 <= INLINE_CAPACITY)
+            capacity_ = INLINE_CAPACITY;
+        else
+        {
+            // Calculate initial capacity
+            capacity_ = newLength + 1;
+            if (capacity_ < MIN_CAPACITY)
+                capacity_ = MIN_CAPACITY;
+            
+            buffer_ = new char[capacity_];
+        }
     }
     else
     {
         if (newLength && capacity_ < newLength + 1)
         {
+            bool allocated = capacity_ > INLINE_CAPACITY;
+            
             // Increase the capacity with half each time it is exceeded
             while (capacity_ < newLength + 1)
                 capacity_ += (capacity_ + 1) >> 1;
             
             char* newBuffer = new char[capacity_];
-            // Move the existing data to the new buffer, then delete the old buffer
-            if (length_)
-                CopyChars(newBuffer, buffer_, length_);
-            delete[] buffer_;
+            // Move the existing data to the new buffer, then delete the old buffer. Note that the capacity has already
+            // changed, so the old buffer has to be accessed directly
+            if (allocated)
+            {
+                if (length_)
+                    CopyChars(newBuffer, buffer_, length_);
+                delete[] buffer_;
+            }
+            else if (length_)
+                CopyChars(newBuffer, inline_, length_);
             
             buffer_ = newBuffer;
         }
     }
     
-    buffer_[newLength] = 0;
+    Buffer()[newLength] = 0;
     length_ = newLength;
 }
 
@@ -451,17 +466,34 @@ void String::Reserve(unsigned newCapacity)
 {
     if (newCapacity < length_ + 1)
         newCapacity = length_ + 1;
+    // Use the inline buffer whenever the string fits
+    if (newCapacity <= INLINE_CAPACITY)
+        newCapacity = INLINE_CAPACITY;
     if (newCapacity == capacity_)
         return;
     
-    char* newBuffer = new char[newCapacity];
-    // Move the existing data to the new buffer, then delete the old buffer
-    CopyChars(newBuffer, buffer_, length_ + 1);
-    if (capacity_)
-        delete[] buffer_;
+    bool allocated = capacity_ > INLINE_CAPACITY;
+    
+    if (newCapacity == INLINE_CAPACITY)
+    {
+        // Move the existing data from the allocated buffer or the end zero to the inline buffer, which overlaps the pointer
+        char* oldBuffer = buffer_;
+        CopyChars(inline_, oldBuffer, length_ + 1);
+        if (allocated)
+            delete[] oldBuffer;
+    }
+    else
+    {
+        char* newBuffer = new char[newCapacity];
+        // Move the existing data to the new buffer, then delete the old buffer
+        CopyChars(newBuffer, Buffer(), length_ + 1);
+        if (allocated)
+            delete[] buffer_;
+        
+        buffer_ = newBuffer;
+    }
     
     capacity_ = newCapacity;
-    buffer_ = newBuffer;
 }
 
 void String::Compact()
@@ -477,9 +509,13 @@ void String::Clear()
 
 void String::Swap(String& str)
 {
+    // The inline buffer does not point to the string itself, so the buffers can be swapped bytewise
+    char temp[INLINE_CAPACITY];
+    memcpy(temp, inline_, INLINE_CAPACITY);
+    memcpy(inline_, str.inline_, INLINE_CAPACITY);
+    memcpy(str.inline_, temp, INLINE_CAPACITY);
     Urho3D::Swap(length_, str.length_);
     Urho3D::Swap(capacity_, str.capacity_);
-    Urho3D::Swap(buffer_, str.buffer_);
 }
 
 String String::Substring(unsigned pos) const
@@ -488,7 +524,7 @@ String String::Substring(unsigned pos) const
     {
         String ret;
         ret.Resize(length_ - pos);
-        CopyChars(ret.buffer_, buffer_ + pos, ret.length_);
+        CopyChars(ret.Buffer(), Buffer() + pos, ret.length_);
         
         return ret;
     }
@@ -504,7 +540,7 @@ String String::Substring(unsigned pos, unsigned length) const
         if (pos + length > length_)
             length = length_ - pos;
         ret.Resize(length);
-        CopyChars(ret.buffer_, buffer_ + pos, ret.length_);
+        CopyChars(ret.Buffer(), Buffer() + pos, ret.length_);
         
         return ret;
     }
@@ -519,14 +555,14 @@ String String::Trimmed() const
     
     while (trimStart < trimEnd)
     {
-        char c = buffer_[trimStart];
+        char c = Buffer()[trimStart];
         if (c != ' ' && c != 9)
             break;
         ++trimStart;
     }
     while (trimEnd > trimStart)
     {
-        char c = buffer_[trimEnd - 1];
+        char c = Buffer()[trimEnd - 1];
         if (c != ' ' && c != 9)
             break;
         --trimEnd;
@@ -537,18 +573,20 @@ String String::Trimmed() const
 
 String String::ToLower() const
 {
+    const char* buffer = Buffer();
     String ret(*this);
     for (unsigned i = 0; i < ret.length_; ++i)
-        ret[i] = tolower(buffer_[i]);
+        ret[i] = tolower(buffer[i]);
     
     return ret;
 }
 
 String String::ToUpper() const
 {
+    const char* buffer = Buffer();
     String ret(*this);
     for (unsigned i = 0; i < ret.length_; ++i)
-        ret[i] = toupper(buffer_[i]);
+        ret[i] = toupper(buffer[i]);
     
     return ret;
 }
@@ -565,11 +603,12 @@ void String::Join(const Vector<String>& subStrings, String glue)
 
 unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
 {
+    const char* buffer = Buffer();
     if (caseSensitive)
     {
         for (unsigned i = startPos; i < length_; ++i)
         {
-            if (buffer_[i] == c)
+            if (buffer[i] == c)
                 return i;
         }
     }
@@ -578,7 +617,7 @@ unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
         c = tolower(c);
         for (unsigned i = startPos; i < length_; ++i)
         {
-            if (tolower(buffer_[i]) == c)
+            if (tolower(buffer[i]) == c)
                 return i;
         }
     }
@@ -588,16 +627,18 @@ unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
 
 unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive) const
 {
+    const char* buffer = Buffer();
+    const char* strBuffer = str.Buffer();
     if (!str.length_ || str.length_ > length_)
         return NPOS;
     
-    char first = str.buffer_[0];
+    char first = strBuffer[0];
     if (!caseSensitive)
         first = tolower(first);
 
     for (unsigned i = startPos; i <= length_ - str.length_; ++i)
     {
-        char c = buffer_[i];
+        char c = buffer[i];
         if (!caseSensitive)
             c = tolower(c);
 
@@ -607,8 +648,8 @@ unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive)
             bool found = true;
             for (unsigned j = 1; j < str.length_; ++j)
             {
-                c = buffer_[i + j];
-                char d = str.buffer_[j];
+                c = buffer[i + j];
+                char d = strBuffer[j];
                 if (!caseSensitive)
                 {
                     c = tolower(c);
@@ -636,6 +677,7 @@ unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive)
 
 unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
 {
+    const char* buffer = Buffer();
     if (startPos >= length_)
         startPos = length_ - 1;
     
@@ -643,7 +685,7 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
     {
         for (unsigned i = startPos; i < length_; --i)
         {
-            if (buffer_[i] == c)
+            if (buffer[i] == c)
                 return i;
         }
     }
@@ -652,7 +694,7 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
         c = tolower(c);
         for (unsigned i = startPos; i < length_; --i)
         {
-            if (tolower(buffer_[i]) == c)
+            if (tolower(buffer[i]) == c)
                 return i;
         }
     }
@@ -662,18 +704,20 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
 
 unsigned String::FindLast(const String& str, unsigned startPos, bool caseSensitive) const
 {
+    const char* buffer = Buffer();
+    const char* strBuffer = str.Buffer();
     if (!str.length_ || str.length_ > length_)
         return NPOS;
     if (startPos > length_ - str.length_)
         startPos = length_ - str.length_;
     
-    char first = str.buffer_[0];
+    char first = strBuffer[0];
     if (!caseSensitive)
         first = tolower(first);
 
     for (unsigned i = startPos; i < length_; --i)
     {
-        char c = buffer_[i];
+        char c = buffer[i];
         if (!caseSensitive)
             c = tolower(c);
 
@@ -682,8 +726,8 @@ unsigned String::FindLast(const String& str, unsigned startPos, bool caseSensiti
             bool found = true;
             for (unsigned j = 1; j < str.length_; ++j)
             {
-                c = buffer_[i + j];
-                char d = str.buffer_[j];
+                c = buffer[i + j];
+                char d = strBuffer[j];
                 if (!caseSensitive)
                 {
                     c = tolower(c);
@@ -776,10 +820,10 @@ unsigned String::LengthUTF8() const
 {
     unsigned ret = 0;
     
-    const char* src = buffer_;
+    const char* src = Buffer();
     if (!src)
         return ret;
-    const char* end = buffer_ + length_;
+    const char* end = Buffer() + length_;
     
     while (src < end)
     {
@@ -806,12 +850,12 @@ unsigned String::ByteOffsetUTF8(unsigned index) const
 
 unsigned String::NextUTF8Char(unsigned& byteOffset) const
 {
-    if (!buffer_)
+    if (!Buffer())
         return 0;
     
-    const char* src = buffer_ + byteOffset;
+    const char* src = Buffer() + byteOffset;
     unsigned ret = DecodeUTF8(src);
-    byteOffset = src - buffer_;
+    byteOffset = src - Buffer();
     
     return ret;
 }
@@ -1241,7 +1285,7 @@ void String::Replace(unsigned pos, unsigned length, const char* srcStart, unsign
     else
         Resize(length_ + delta);
     
-    CopyChars(buffer_ + pos, srcStart, srcLength);
+    CopyChars(Buffer() + pos, srcStart, srcLength);
 }
 
 WString::WString() :
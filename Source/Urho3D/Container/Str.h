@@ -60,6 +60,17 @@ public:
         *this = str;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another string.
+    String(String&& str) :
+        length_(0),
+        capacity_(0),
+        buffer_(&endZero)
+    {
+        Swap(str);
+    }
+#endif
+    
     /// Construct from a C string.
     String(const char* str) :
         length_(0),
@@ -85,7 +96,7 @@ public:
         buffer_(&endZero)
     {
         Resize(length);
-        CopyChars(buffer_, str, length);
+        CopyChars(Buffer(), str, length);
     }
     
     /// Construct from a null-terminated wide character array.
@@ -148,7 +159,7 @@ public:
     /// Destruct.
     ~String()
     {
-        if (capacity_)
+        if (capacity_ > INLINE_CAPACITY)
             delete[] buffer_;
     }
     
@@ -156,17 +167,26 @@ public:
     String& operator = (const String& rhs)
     {
         Resize(rhs.length_);
-        CopyChars(buffer_, rhs.buffer_, rhs.length_);
+        CopyChars(Buffer(), rhs.Buffer(), rhs.length_);
         
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign another string.
+    String& operator = (String&& rhs)
+    {
+        Swap(rhs);
+        return *this;
+    }
+#endif
+    
     /// Assign a C string.
     String& operator = (const char* rhs)
     {
         unsigned rhsLength = CStringLength(rhs);
         Resize(rhsLength);
-        CopyChars(buffer_, rhs, rhsLength);
+        CopyChars(Buffer(), rhs, rhsLength);
         
         return *this;
     }
@@ -176,7 +196,7 @@ public:
     {
         unsigned oldLength = length_;
         Resize(length_ + rhs.length_);
-        CopyChars(buffer_ + oldLength, rhs.buffer_, rhs.length_);
+        CopyChars(Buffer() + oldLength, rhs.Buffer(), rhs.length_);
         
         return *this;
     }
@@ -187,7 +207,7 @@ public:
         unsigned rhsLength = CStringLength(rhs);
         unsigned oldLength = length_;
         Resize(length_ + rhsLength);
-        CopyChars(buffer_ + oldLength, rhs, rhsLength);
+        CopyChars(Buffer() + oldLength, rhs, rhsLength);
         
         return *this;
     }
@@ -197,7 +217,7 @@ public:
     {
         unsigned oldLength = length_;
         Resize(length_ + 1);
-        buffer_[oldLength]  = rhs;
+        Buffer()[oldLength]  = rhs;
         
         return *this;
     }
@@ -230,8 +250,8 @@ public:
     {
         String ret;
         ret.Resize(length_ + rhs.length_);
-        CopyChars(ret.buffer_, buffer_, length_);
-        CopyChars(ret.buffer_ + length_, rhs.buffer_, rhs.length_);
+        CopyChars(ret.Buffer(), Buffer(), length_);
+        CopyChars(ret.Buffer() + length_, rhs.Buffer(), rhs.length_);
         
         return ret;
     }
@@ -242,8 +262,8 @@ public:
         unsigned rhsLength = CStringLength(rhs);
         String ret;
         ret.Resize(length_ + rhsLength);
-        CopyChars(ret.buffer_, buffer_, length_);
-        CopyChars(ret.buffer_ + length_, rhs, rhsLength);
+        CopyChars(ret.Buffer(), Buffer(), length_);
+        CopyChars(ret.Buffer() + length_, rhs, rhsLength);
         
         return ret;
     }
@@ -274,13 +294,13 @@ public:
     /// Test if string is greater than a C string.
     bool operator > (const char* rhs) const { return strcmp(CString(), rhs) > 0; }
     /// Return char at index.
-    char& operator [] (unsigned index) { assert(index < length_); return buffer_[index]; }
+    char& operator [] (unsigned index) { assert(index < length_); return Buffer()[index]; }
     /// Return const char at index.
-    const char& operator [] (unsigned index) const { assert(index < length_); return buffer_[index]; }
+    const char& operator [] (unsigned index) const { assert(index < length_); return Buffer()[index]; }
     /// Return char at index.
-    char& At(unsigned index) { assert(index < length_); return buffer_[index]; }
+    char& At(unsigned index) { assert(index < length_); return Buffer()[index]; }
     /// Return const char at index.
-    const char& At(unsigned index) const { assert(index < length_); return buffer_[index]; }
+    const char& At(unsigned index) const { assert(index < length_); return Buffer()[index]; }
     
     /// Replace all occurrences of a character.
     void Replace(char replaceThis, char replaceWith, bool caseSensitive = true);
@@ -332,17 +352,17 @@ public:
     void Swap(String& str);
     
     /// Return iterator to the beginning.
-    Iterator Begin() { return Iterator(buffer_); }
+    Iterator Begin() { return Iterator(Buffer()); }
     /// Return const iterator to the beginning.
-    ConstIterator Begin() const { return ConstIterator(buffer_); }
+    ConstIterator Begin() const { return ConstIterator(Buffer()); }
     /// Return iterator to the end.
-    Iterator End() { return Iterator(buffer_ + length_); }
+    Iterator End() { return Iterator(Buffer() + length_); }
     /// Return const iterator to the end.
-    ConstIterator End() const { return ConstIterator(buffer_ + length_); }
+    ConstIterator End() const { return ConstIterator(Buffer() + length_); }
     /// Return first char, or 0 if empty.
-    char Front() const { return buffer_[0]; }
+    char Front() const { return Buffer()[0]; }
     /// Return last char, or 0 if empty.
-    char Back() const { return length_ ? buffer_[length_ - 1] : buffer_[0]; }
+    char Back() const { return length_ ? Buffer()[length_ - 1] : Buffer()[0]; }
     /// Return a substring from position to end.
     String Substring(unsigned pos) const;
     /// Return a substring with length from position.
@@ -370,7 +390,7 @@ public:
     /// Return whether ends with a string.
     bool EndsWith(const String& str, bool caseSensitive = true) const;
     /// Return the C string.
-    const char* CString() const { return buffer_; }
+    const char* CString() const { return Buffer(); }
     /// Return length.
     unsigned Length() const { return length_; }
     /// Return buffer capacity.
@@ -411,7 +431,7 @@ public:
     unsigned ToHash() const
     {
         unsigned hash = 0;
-        const char* ptr = buffer_;
+        const char* ptr = Buffer();
         while (*ptr)
         {
             hash = *ptr + (hash << 6) + (hash << 16) - hash;
@@ -463,6 +483,8 @@ public:
     static const unsigned NPOS = 0xffffffff;
     /// Initial dynamic allocation size.
     static const unsigned MIN_CAPACITY = 8;
+    /// Capacity of the inline buffer used for short strings, including the terminating zero. Sized so that the string fits in a Variant.
+    static const unsigned INLINE_CAPACITY = 4 * sizeof(void*) - 2 * sizeof(unsigned);
     /// Empty string.
     static const String EMPTY;
     
@@ -471,7 +493,7 @@ private:
     void MoveRange(unsigned dest, unsigned src, unsigned count)
     {
         if (count)
-            memmove(buffer_ + dest, buffer_ + src, count);
+            memmove(Buffer() + dest, Buffer() + src, count);
     }
     
     /// Copy chars from one buffer to another.
@@ -494,12 +516,20 @@ private:
     /// Replace a substring with another substring.
     void Replace(unsigned pos, unsigned length, const char* srcStart, unsigned srcLength);
     
+    /// Return the character buffer, either inline or allocated.
+    char* Buffer() const { return capacity_ == INLINE_CAPACITY ? const_cast<char*>(inline_) : buffer_; }
+
     /// String length.
     unsigned length_;
-    /// Capacity, zero if buffer not allocated.
+    /// Capacity, zero if no buffer, INLINE_CAPACITY if using the inline buffer, or larger if allocated.
     unsigned capacity_;
-    /// String buffer, null if not allocated.
-    char* buffer_;
+    union
+    {
+        /// Allocated string buffer, or the end zero if no buffer.
+        char* buffer_;
+        /// Inline buffer for short strings. Does not point to itself, so that the string can be moved in memory.
+        char inline_[INLINE_CAPACITY];
+    };
     
     /// End zero for empty strings.
     static char endZero;
@@ -521,6 +551,71 @@ inline String operator + (const wchar_t* lhs, const String& rhs)
     return ret;
 }
 
+/// Non-owning view of a character range, for looking up strings without constructing a String. The characters must outlive the view and do not need to be null-terminated.
+class URHO3D_API StringView
+{
+public:
+    /// Construct empty.
+    StringView() :
+        data_(""),
+        length_(0)
+    {
+    }
+    
+    /// Construct from a C string.
+    StringView(const char* str) :
+        data_(str),
+        length_(String::CStringLength(str))
+    {
+    }
+    
+    /// Construct from a character range.
+    StringView(const char* str, unsigned length) :
+        data_(str),
+        length_(length)
+    {
+    }
+    
+    /// Construct from a string.
+    StringView(const String& str) :
+        data_(str.CString()),
+        length_(str.Length())
+    {
+    }
+    
+    /// Test for equality with another view.
+    bool operator == (const StringView& rhs) const { return length_ == rhs.length_ && !memcmp(data_, rhs.data_, length_); }
+    /// Test for inequality with another view.
+    bool operator != (const StringView& rhs) const { return !(*this == rhs); }
+    /// Return char at index.
+    char operator [] (unsigned index) const { assert(index < length_); return data_[index]; }
+    
+    /// Return the characters. Not necessarily null-terminated.
+    const char* Data() const { return data_; }
+    /// Return length.
+    unsigned Length() const { return length_; }
+    /// Return whether the view is empty.
+    bool Empty() const { return length_ == 0; }
+    /// Return as a string.
+    String ToString() const { return String(data_, length_); }
+    
+    /// Return hash value for HashSet & HashMap. Same as the hash of an equal String.
+    unsigned ToHash() const
+    {
+        unsigned hash = 0;
+        for (unsigned i = 0; i < length_; ++i)
+            hash = data_[i] + (hash << 6) + (hash << 16) - hash;
+        
+        return hash;
+    }
+    
+private:
+    /// Characters.
+    const char* data_;
+    /// Length.
+    unsigned length_;
+};
+
 /// Wide character string. Only meant for converting from String and passing to the operating system where necessary.
 class URHO3D_API WString
 {
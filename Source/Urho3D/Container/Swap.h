@@ -22,6 +22,11 @@
 
 #pragma once
 
+// Enable move semantics in the containers when the compiler supports rvalue references and variadic templates
+#if !defined(URHO3D_CXX11) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800))
+#define URHO3D_CXX11
+#endif
+
 namespace Urho3D
 {
 
@@ -30,6 +35,21 @@ class ListBase;
 class String;
 class VectorBase;
 
+#ifdef URHO3D_CXX11
+/// Cast a value to an rvalue reference so that it can be moved from.
+template<class T> inline T&& Move(T& value) { return static_cast<T&&>(value); }
+
+/// Swap two values.
+template<class T> inline void Swap(T& first, T& second)
+{
+    T temp = Move(first);
+    first = Move(second);
+    second = Move(temp);
+}
+#else
+/// Return the value itself, as moving is not supported.
+template<class T> inline T& Move(T& value) { return value; }
+
 /// Swap two values.
 template<class T> inline void Swap(T& first, T& second)
 {
@@ -37,6 +57,7 @@ template<class T> inline void Swap(T& first, T& second)
     first = second;
     second = temp;
 }
+#endif
 
 template<> void Swap<String>(String& first, String& second);
 template<> void Swap<VectorBase>(VectorBase& first, VectorBase& second);
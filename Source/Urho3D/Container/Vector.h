@@ -62,6 +62,14 @@ public:
         *this = vector;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another vector.
+    Vector(Vector<T>&& vector)
+    {
+        Swap(vector);
+    }
+#endif
+    
     /// Destruct.
     ~Vector()
     {
@@ -77,6 +85,15 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign from another vector.
+    Vector<T>& operator = (Vector<T>&& rhs)
+    {
+        Swap(rhs);
+        return *this;
+    }
+#endif
+    
     /// Add-assign an element.
     Vector<T>& operator += (const T& rhs)
     {
@@ -154,6 +171,35 @@ public:
     void Push(const T& value) { Resize(size_ + 1, &value); }
     /// Add another vector at the end.
     void Push(const Vector<T>& vector) { Resize(size_ + vector.size_, vector.Buffer()); }
+#ifdef URHO3D_CXX11
+    /// Add an element at the end by moving it.
+    void Push(T&& value) { EmplaceBack(Move(value)); }
+    
+    /// Construct an element at the end from the arguments. Return the new element.
+    template <class... Args> T& EmplaceBack(Args&&... args)
+    {
+        if (size_ < capacity_)
+            new(Buffer() + size_) T(static_cast<Args&&>(args)...);
+        else
+        {
+            // Construct the new element before moving the old ones, as the arguments may refer to them
+            unsigned newCapacity = GetGrownCapacity(size_ + 1);
+            T* newBuffer = reinterpret_cast<T*>(AllocateBuffer(newCapacity * sizeof(T)));
+            new(newBuffer + size_) T(static_cast<Args&&>(args)...);
+            if (buffer_)
+            {
+                MoveElements(newBuffer, Buffer(), size_);
+                DestructElements(Buffer(), size_);
+                delete[] buffer_;
+            }
+            buffer_ = reinterpret_cast<unsigned char*>(newBuffer);
+            capacity_ = newCapacity;
+        }
+        
+        ++size_;
+        return Back();
+    }
+#endif
     
     /// Remove the last element.
     void Pop()
@@ -174,6 +220,20 @@ public:
         Buffer()[pos] = value;
     }
     
+#ifdef URHO3D_CXX11
+    /// Insert an element at position by moving it.
+    void Insert(unsigned pos, T&& value)
+    {
+        if (pos > size_)
+            pos = size_;
+        
+        unsigned oldSize = size_;
+        Resize(size_ + 1, 0);
+        MoveRange(pos + 1, pos, oldSize - pos);
+        Buffer()[pos] = Move(value);
+    }
+#endif
+    
     /// Insert another vector at position.
     void Insert(unsigned pos, const Vector<T>& vector)
     {
@@ -309,7 +369,7 @@ public:
             {
                 newBuffer = reinterpret_cast<T*>(AllocateBuffer(capacity_ * sizeof(T)));
                 // Move the data into the new buffer
-                ConstructElements(newBuffer, Buffer(), size_);
+                MoveElements(newBuffer, Buffer(), size_);
             }
             
             // Delete the old buffer
@@ -378,34 +438,44 @@ private:
             DestructElements(Buffer() + newSize, size_ - newSize);
         else
         {
-            // Allocate new buffer if necessary and copy the current elements
+            // Allocate new buffer if necessary and move the current elements
             if (newSize > capacity_)
             {
-                if (!capacity_)
-                    capacity_ = newSize;
-                else
-                {
-                    while (capacity_ < newSize)
-                        capacity_ += (capacity_ + 1) >> 1;
-                }
+                capacity_ = GetGrownCapacity(newSize);
                 
-                unsigned char* newBuffer = AllocateBuffer(capacity_ * sizeof(T));
+                // Initialize the new elements first, as the source data may be in the old buffer
+                T* newBuffer = reinterpret_cast<T*>(AllocateBuffer(capacity_ * sizeof(T)));
+                ConstructElements(newBuffer + size_, src, newSize - size_);
                 if (buffer_)
                 {
-                    ConstructElements(reinterpret_cast<T*>(newBuffer), Buffer(), size_);
+                    MoveElements(newBuffer, Buffer(), size_);
                     DestructElements(Buffer(), size_);
                     delete[] buffer_;
                 }
-                buffer_ = newBuffer;
+                buffer_ = reinterpret_cast<unsigned char*>(newBuffer);
+            }
+            else
+            {
+                // Initialize the new elements
+                ConstructElements(Buffer() + size_, src, newSize - size_);
             }
-            
-            // Initialize the new elements
-            ConstructElements(Buffer() + size_, src, newSize - size_);
         }
         
         size_ = newSize;
     }
     
+    /// Return the capacity to grow to for holding a number of elements.
+    unsigned GetGrownCapacity(unsigned newSize) const
+    {
+        if (!capacity_)
+            return newSize;
+        
+        unsigned newCapacity = capacity_;
+        while (newCapacity < newSize)
+            newCapacity += (newCapacity + 1) >> 1;
+        return newCapacity;
+    }
+    
     /// Move a range of elements within the vector.
     void MoveRange(unsigned dest, unsigned src, unsigned count)
     {
@@ -413,12 +483,12 @@ private:
         if (src < dest)
         {
             for (unsigned i = count - 1; i < count; --i)
-                buffer[dest + i] = buffer[src + i];
+                buffer[dest + i] = Move(buffer[src + i]);
         }
         if (src > dest)
         {
             for (unsigned i = 0; i < count; ++i)
-                buffer[dest + i] = buffer[src + i];
+                buffer[dest + i] = Move(buffer[src + i]);
         }
     }
     
@@ -444,6 +514,13 @@ private:
             *dest++ = *src++;
     }
     
+    /// Move-construct elements into uninitialized memory. Copies if move semantics are not supported.
+    static void MoveElements(T* dest, T* src, unsigned count)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            new(dest + i) T(Move(src[i]));
+    }
+    
     // Call the elements' destructors.
     static void DestructElements(T* dest, unsigned count)
     {
@@ -487,6 +564,14 @@ public:
         *this = vector;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-construct from another vector.
+    PODVector(PODVector<T>&& vector)
+    {
+        Swap(vector);
+    }
+#endif
+    
     /// Destruct.
     ~PODVector()
     {
@@ -501,6 +586,15 @@ public:
         return *this;
     }
     
+#ifdef URHO3D_CXX11
+    /// Move-assign from another vector.
+    PODVector<T>& operator = (PODVector<T>&& rhs)
+    {
+        Swap(rhs);
+        return *this;
+    }
+#endif
+    
     /// Add-assign an element.
     PODVector<T>& operator += (const T& rhs)
     {
@@ -48,6 +48,52 @@ static const unsigned AM_COMPONENTID = 0x20;
 static const unsigned AM_NODEIDVECTOR = 0x40;
 
 class Serializable;
+class Serializer;
+
+/// Network encoding mode of an attribute.
+enum AttributeEncodingMode
+{
+    /// Full precision, in the same format as Serializer::WriteVariantData().
+    AEM_DEFAULT = 0,
+    /// Float or vector components quantized to a range, bit-packed.
+    AEM_QUANTIZED,
+    /// Quaternion as the index of the largest component and the other three quantized, bit-packed.
+    AEM_SMALLEST_THREE
+};
+
+/// Network encoding of an attribute.
+struct AttributeEncoding
+{
+    /// Construct as full precision.
+    AttributeEncoding() :
+        mode_(AEM_DEFAULT),
+        min_(0.0f),
+        max_(0.0f),
+        bits_(0)
+    {
+    }
+    
+    /// Construct as quantized to a range with the specified precision. Applies to float and vector attributes.
+    AttributeEncoding(float min, float max, float precision);
+    
+    /// Construct as smallest three with the specified number of bits per component. Applies to quaternion attributes.
+    explicit AttributeEncoding(unsigned bitsPerComponent) :
+        mode_(AEM_SMALLEST_THREE),
+        min_(0.0f),
+        max_(0.0f),
+        bits_(bitsPerComponent < 1 ? 1 : (bitsPerComponent > 16 ? 16 : bitsPerComponent))
+    {
+    }
+    
+    /// Encoding mode.
+    AttributeEncodingMode mode_;
+    /// Minimum value of the quantized range.
+    float min_;
+    /// Maximum value of the quantized range.
+    float max_;
+    /// Bits per quantized component.
+    unsigned bits_;
+};
 
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
@@ -57,6 +103,10 @@ public:
     virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
     /// Set the attribute.
     virtual void Set(Serializable* ptr, const Variant& src) = 0;
+    /// Write the attribute to a stream in the same format as Serializer::WriteVariantData(). Default implementation goes through a Variant. Return true if successful.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const;
+    /// Return whether the attribute equals a value. Default implementation goes through a Variant.
+    virtual bool Equals(const Serializable* ptr, const Variant& value) const;
 };
 
 /// Description of an automatically serializable variable.
@@ -138,6 +188,8 @@ struct AttributeInfo
     unsigned mode_;
     /// Attribute data pointer if elsewhere than in the Serializable.
     void* ptr_;
+    /// Network replication encoding.
+    AttributeEncoding encoding_;
 };
 
 }
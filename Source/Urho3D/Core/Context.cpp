@@ -22,6 +22,9 @@
 
 #include "../Core/Context.h"
 #include "../Core/Thread.h"
+#include "../IO/Log.h"
+
+#include <cassert>
 
 #include "../DebugNew.h"
 
@@ -73,6 +76,7 @@ Context::~Context()
     RemoveSubsystem("Graphics");
     
     subsystems_.Clear();
+    lazySubsystems_.Clear();
     factories_.Clear();
     
     // Delete allocated event data maps
@@ -114,6 +118,7 @@ void Context::RegisterSubsystem(Object* object)
         return;
 
     subsystems_[object->GetType()] = object;
+    lazySubsystems_.Erase(object->GetType());
 }
 
 void Context::RemoveSubsystem(StringHash objectType)
@@ -121,6 +126,15 @@ void Context::RemoveSubsystem(StringHash objectType)
     HashMap<StringHash, SharedPtr<Object> >::Iterator i = subsystems_.Find(objectType);
     if (i != subsystems_.End())
         subsystems_.Erase(i);
+    lazySubsystems_.Erase(objectType);
+}
+
+void Context::RegisterLazySubsystem(ObjectFactory* factory)
+{
+    if (!factory)
+        return;
+
+    lazySubsystems_[factory->GetType()].factory_ = factory;
 }
 
 void Context::RegisterAttribute(StringHash objectType, const AttributeInfo& attr)
@@ -148,6 +162,27 @@ void Context::UpdateAttributeDefaultValue(StringHash objectType, const char* nam
         info->defaultValue_ = defaultValue;
 }
 
+void Context::SetAttributeNetworkEncoding(StringHash objectType, const char* name, const AttributeEncoding& encoding)
+{
+    AttributeInfo* info = GetAttribute(objectType, name);
+    if (info)
+        info->encoding_ = encoding;
+
+    // The network attributes are stored as a separate copy
+    HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = networkAttributes_.Find(objectType);
+    if (i == networkAttributes_.End())
+        return;
+
+    for (Vector<AttributeInfo>::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+    {
+        if (!j->name_.Compare(name, true))
+        {
+            j->encoding_ = encoding;
+            break;
+        }
+    }
+}
+
 VariantMap& Context::GetEventDataMap()
 {
     unsigned nestingLevel = eventSenders_.Size();
@@ -180,6 +215,8 @@ Object* Context::GetSubsystem(StringHash type) const
     HashMap<StringHash, SharedPtr<Object> >::ConstIterator i = subsystems_.Find(type);
     if (i != subsystems_.End())
         return i->second_;
+    else if (!lazySubsystems_.Empty())
+        return GetLazySubsystem(type);
     else
         return 0;
 }
@@ -216,25 +253,117 @@ AttributeInfo* Context::GetAttribute(StringHash objectType, const char* name)
     return 0;
 }
 
+void Context::PostEvent(StringHash eventType, const VariantMap& eventData)
+{
+    // Copy the data outside the lock, so that posting threads only contend on the push
+    PostedEvent event;
+    event.eventType_ = eventType;
+    event.eventData_ = eventData;
+
+    MutexLock lock(postedEventsMutex_);
+    postedEvents_.Push(Move(event));
+}
+
+void Context::SendPostedEvents(Object* sender)
+{
+    if (!Thread::IsMainThread())
+    {
+        LOGERROR("Sending posted events is only supported from the main thread");
+        return;
+    }
+
+    // Take the whole batch at once. Events posted while sending are left for the next call
+    Vector<PostedEvent> events;
+    {
+        MutexLock lock(postedEventsMutex_);
+        if (postedEvents_.Empty())
+            return;
+        events.Swap(postedEvents_);
+    }
+
+    for (Vector<PostedEvent>::Iterator i = events.Begin(); i != events.End(); ++i)
+        sender->SendEvent(i->eventType_, i->eventData_);
+}
+
+void EventReceiverGroup::EndSendEvent()
+{
+    assert(inSend_ > 0);
+    --inSend_;
+
+    if (!inSend_ && numHoles_)
+        Compact();
+}
+
+void EventReceiverGroup::Add(Object* object)
+{
+    indices_[object] = receivers_.Size();
+    receivers_.Push(object);
+}
+
+void EventReceiverGroup::Remove(Object* object)
+{
+    HashMap<Object*, unsigned>::Iterator i = indices_.Find(object);
+    if (i == indices_.End())
+        return;
+
+    receivers_[i->second_] = 0;
+    indices_.Erase(i);
+    ++numHoles_;
+
+    // Outside a send, compact once half of the array is holes, so that each removal costs amortized constant time
+    if (!inSend_ && numHoles_ * 2 >= receivers_.Size())
+        Compact();
+}
+
+void EventReceiverGroup::Compact()
+{
+    unsigned dest = 0;
+    for (unsigned i = 0; i < receivers_.Size(); ++i)
+    {
+        Object* receiver = receivers_[i];
+        if (receiver)
+        {
+            if (dest != i)
+            {
+                receivers_[dest] = receiver;
+                indices_[receiver] = dest;
+            }
+            ++dest;
+        }
+    }
+    receivers_.Resize(dest);
+    numHoles_ = 0;
+}
+
 void Context::AddEventReceiver(Object* receiver, StringHash eventType)
 {
-    eventReceivers_[eventType].Insert(receiver);
+    SharedPtr<EventReceiverGroup>& group = eventReceivers_[eventType];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(receiver);
 }
 
 void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash eventType)
 {
-    specificEventReceivers_[sender][eventType].Insert(receiver);
+    SharedPtr<EventReceiverGroup>& group = specificEventReceivers_[sender][eventType];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(receiver);
 }
 
 void Context::RemoveEventSender(Object* sender)
 {
-    HashMap<Object*, HashMap<StringHash, HashSet<Object*> > >::Iterator i = specificEventReceivers_.Find(sender);
+    HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
     if (i != specificEventReceivers_.End())
     {
-        for (HashMap<StringHash, HashSet<Object*> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+        for (HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
         {
-            for (HashSet<Object*>::Iterator k = j->second_.Begin(); k != j->second_.End(); ++k)
-                (*k)->RemoveEventSender(sender);
+            PODVector<Object*>& receivers = j->second_->receivers_;
+            for (PODVector<Object*>::Iterator k = receivers.Begin(); k != receivers.End(); ++k)
+            {
+                if (*k)
+                    (*k)->RemoveEventSender(sender);
+            }
         }
         specificEventReceivers_.Erase(i);
     }
@@ -242,16 +371,37 @@ void Context::RemoveEventSender(Object* sender)
 
 void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
 {
-    HashSet<Object*>* group = GetEventReceivers(eventType);
+    EventReceiverGroup* group = GetEventReceivers(eventType);
     if (group)
-        group->Erase(receiver);
+        group->Remove(receiver);
 }
 
 void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType)
 {
-    HashSet<Object*>* group = GetEventReceivers(sender, eventType);
+    EventReceiverGroup* group = GetEventReceivers(sender, eventType);
     if (group)
-        group->Erase(receiver);
+        group->Remove(receiver);
+}
+
+Object* Context::GetLazySubsystem(StringHash type) const
+{
+    // The map itself is only modified during registration. The entries are accessed under the mutex, as the main thread
+    // may create the subsystem while worker threads are reading it
+    HashMap<StringHash, LazySubsystem>::ConstIterator i = lazySubsystems_.Find(type);
+    if (i == lazySubsystems_.End())
+        return 0;
+
+    MutexLock lock(lazySubsystemsMutex_);
+    LazySubsystem& lazy = const_cast<LazySubsystem&>(i->second_);
+    // Subsystems are not expected to be constructed thread-safely, so worker threads only see already created ones
+    if (!lazy.subsystem_ && lazy.factory_ && Thread::IsMainThread())
+    {
+        // Clear the factory first so that the subsystem's constructor can not recurse into creating itself
+        SharedPtr<ObjectFactory> factory = lazy.factory_;
+        lazy.factory_.Reset();
+        lazy.subsystem_ = factory->CreateObject();
+    }
+    return lazy.subsystem_;
 }
 
 }
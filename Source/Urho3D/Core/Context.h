@@ -25,10 +25,66 @@
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
 #include "../Container/HashSet.h"
+#include "../Core/Mutex.h"
 
 namespace Urho3D
 {
 
+/// Dense array of the receivers of an event. Removed receivers leave holes, found in constant time through an index map, so
+/// that sending can iterate by index without checking for changes after each receiver. The holes are compacted when the
+/// outermost send ends, or outside a send once they make up half of the array, which keeps removal amortized constant time.
+class URHO3D_API EventReceiverGroup : public RefCounted
+{
+public:
+    /// Construct.
+    EventReceiverGroup() :
+        inSend_(0),
+        numHoles_(0)
+    {
+    }
+
+    /// Begin event send.
+    void BeginSendEvent() { ++inSend_; }
+    /// End event send. Compact away the holes left by removed receivers if no send is in progress anymore.
+    void EndSendEvent();
+    /// Add a receiver. The same receiver must not be added twice.
+    void Add(Object* object);
+    /// Remove a receiver. Leaves a hole that is compacted later.
+    void Remove(Object* object);
+
+    /// Receivers. May contain null holes.
+    PODVector<Object*> receivers_;
+
+private:
+    /// Compact the holes, preserving the order of the remaining receivers.
+    void Compact();
+
+    /// Indices of the receivers in the array.
+    HashMap<Object*, unsigned> indices_;
+    /// Nesting depth of event sends in progress.
+    unsigned inSend_;
+    /// Number of holes in the array.
+    unsigned numHoles_;
+};
+
+/// Subsystem registered to be created on first access.
+struct LazySubsystem
+{
+    /// Factory, cleared once the subsystem creation has started.
+    SharedPtr<ObjectFactory> factory_;
+    /// Subsystem, null until created.
+    SharedPtr<Object> subsystem_;
+};
+
+/// Event posted from any thread, waiting to be sent on the main thread.
+struct PostedEvent
+{
+    /// Event type.
+    StringHash eventType_;
+    /// Event data.
+    VariantMap eventData_;
+};
+
 /// Urho3D execution context. Provides access to subsystems, object factories and attributes, and event receivers.
 class URHO3D_API Context : public RefCounted
 {
@@ -50,14 +106,22 @@ public:
     void RegisterSubsystem(Object* subsystem);
     /// Remove a subsystem.
     void RemoveSubsystem(StringHash objectType);
+    /// Register a subsystem to be created on first access through GetSubsystem(). The subsystem is only created when accessed from the main thread.
+    void RegisterLazySubsystem(ObjectFactory* factory);
     /// Register object attribute.
     void RegisterAttribute(StringHash objectType, const AttributeInfo& attr);
     /// Remove object attribute.
     void RemoveAttribute(StringHash objectType, const char* name);
     /// Update object attribute's default value.
     void UpdateAttributeDefaultValue(StringHash objectType, const char* name, const Variant& defaultValue);
+    /// Set object attribute's network replication encoding. The server and the clients must use the same encodings.
+    void SetAttributeNetworkEncoding(StringHash objectType, const char* name, const AttributeEncoding& encoding);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap();
+    /// Post an event to be sent on the main thread at the beginning of the next frame, with the Time subsystem as the sender. Is thread-safe. The event data is copied, so it should not contain pointers to refcounted objects, as their reference counts are not thread-safe.
+    void PostEvent(StringHash eventType, const VariantMap& eventData);
+    /// Send the events posted since the last call, in the order they were posted. Called by Time at the beginning of each frame.
+    void SendPostedEvents(Object* sender);
 
     /// Copy base class attributes to derived class.
     void CopyBaseAttributes(StringHash baseType, StringHash derivedType);
@@ -67,6 +131,8 @@ public:
     template <class T> void RegisterFactory(const char* category);
     /// Template version of removing a subsystem.
     template <class T> void RemoveSubsystem();
+    /// Template version of registering a subsystem to be created on first access.
+    template <class T> void RegisterLazySubsystem();
     /// Template version of registering an object attribute.
     template <class T> void RegisterAttribute(const AttributeInfo& attr);
     /// Template version of removing an object attribute.
@@ -75,10 +141,12 @@ public:
     template <class T, class U> void CopyBaseAttributes();
     /// Template version of updating an object attribute's default value.
     template <class T> void UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue);
+    /// Template version of setting an object attribute's network replication encoding.
+    template <class T> void SetAttributeNetworkEncoding(const char* name, const AttributeEncoding& encoding);
 
     /// Return subsystem by type.
     Object* GetSubsystem(StringHash type) const;
-    /// Return all subsystems.
+    /// Return all subsystems, excluding the lazily created ones.
     const HashMap<StringHash, SharedPtr<Object> >& GetSubsystems() const { return subsystems_; }
     /// Return all object factories.
     const HashMap<StringHash, SharedPtr<ObjectFactory> >& GetObjectFactories() const { return factories_; }
@@ -115,23 +183,23 @@ public:
     const HashMap<StringHash, Vector<AttributeInfo> >& GetAllAttributes() const { return attributes_; }
 
     /// Return event receivers for a sender and event type, or null if they do not exist.
-    HashSet<Object*>* GetEventReceivers(Object* sender, StringHash eventType)
+    EventReceiverGroup* GetEventReceivers(Object* sender, StringHash eventType)
     {
-        HashMap<Object*, HashMap<StringHash, HashSet<Object*> > >::Iterator i = specificEventReceivers_.Find(sender);
+        HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
         if (i != specificEventReceivers_.End())
         {
-            HashMap<StringHash, HashSet<Object*> >::Iterator j = i->second_.Find(eventType);
-            return j != i->second_.End() ? &j->second_ : 0;
+            HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Find(eventType);
+            return j != i->second_.End() ? j->second_.Get() : 0;
         }
         else
             return 0;
     }
 
     /// Return event receivers for an event type, or null if they do not exist.
-    HashSet<Object*>* GetEventReceivers(StringHash eventType)
+    EventReceiverGroup* GetEventReceivers(StringHash eventType)
     {
-        HashMap<StringHash, HashSet<Object*> >::Iterator i = eventReceivers_.Find(eventType);
-        return i != eventReceivers_.End() ? &i->second_ : 0;
+        HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator i = eventReceivers_.Find(eventType);
+        return i != eventReceivers_.End() ? i->second_.Get() : 0;
     }
 
 private:
@@ -151,19 +219,23 @@ private:
     void BeginSendEvent(Object* sender) { eventSenders_.Push(sender); }
     /// End event send. Clean up event receivers removed in the meanwhile.
     void EndSendEvent() { eventSenders_.Pop(); }
+    /// Return a lazily created subsystem, creating it first if on the main thread. Return null if not registered as lazy or not created yet.
+    Object* GetLazySubsystem(StringHash type) const;
 
     /// Object factories.
     HashMap<StringHash, SharedPtr<ObjectFactory> > factories_;
     /// Subsystems.
     HashMap<StringHash, SharedPtr<Object> > subsystems_;
+    /// Lazily created subsystems. Kept apart from the other subsystems so that creating one does not modify a map that worker threads are reading.
+    HashMap<StringHash, LazySubsystem> lazySubsystems_;
     /// Attribute descriptions per object type.
     HashMap<StringHash, Vector<AttributeInfo> > attributes_;
     /// Network replication attribute descriptions per object type.
     HashMap<StringHash, Vector<AttributeInfo> > networkAttributes_;
     /// Event receivers for non-specific events.
-    HashMap<StringHash, HashSet<Object*> > eventReceivers_;
+    HashMap<StringHash, SharedPtr<EventReceiverGroup> > eventReceivers_;
     /// Event receivers for specific senders' events.
-    HashMap<Object*, HashMap<StringHash, HashSet<Object*> > > specificEventReceivers_;
+    HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > > specificEventReceivers_;
     /// Event sender stack.
     PODVector<Object*> eventSenders_;
     /// Event data stack.
@@ -172,16 +244,24 @@ private:
     EventHandler* eventHandler_;
     /// Object categories.
     HashMap<String, Vector<StringHash> > objectCategories_;
+    /// Events posted from any thread for sending on the main thread.
+    Vector<PostedEvent> postedEvents_;
+    /// Mutex for the posted events.
+    Mutex postedEventsMutex_;
+    /// Mutex for creating and accessing the lazily created subsystems.
+    mutable Mutex lazySubsystemsMutex_;
 };
 
 template <class T> void Context::RegisterFactory() { RegisterFactory(new ObjectFactoryImpl<T>(this)); }
 template <class T> void Context::RegisterFactory(const char* category) { RegisterFactory(new ObjectFactoryImpl<T>(this), category); }
 template <class T> void Context::RemoveSubsystem() { RemoveSubsystem(T::GetTypeStatic()); }
+template <class T> void Context::RegisterLazySubsystem() { RegisterLazySubsystem(new ObjectFactoryImpl<T>(this)); }
 template <class T> void Context::RegisterAttribute(const AttributeInfo& attr) { RegisterAttribute(T::GetTypeStatic(), attr); }
 template <class T> void Context::RemoveAttribute(const char* name) { RemoveAttribute(T::GetTypeStatic(), name); }
 template <class T, class U> void Context::CopyBaseAttributes() { CopyBaseAttributes(T::GetTypeStatic(), U::GetTypeStatic()); }
 template <class T> T* Context::GetSubsystem() const { return static_cast<T*>(GetSubsystem(T::GetTypeStatic())); }
 template <class T> AttributeInfo* Context::GetAttribute(const char* name) { return GetAttribute(T::GetTypeStatic(), name); }
 template <class T> void Context::UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue) { UpdateAttributeDefaultValue(T::GetTypeStatic(), name, defaultValue); }
+template <class T> void Context::SetAttributeNetworkEncoding(const char* name, const AttributeEncoding& encoding) { SetAttributeNetworkEncoding(T::GetTypeStatic(), name, encoding); }
 
 }
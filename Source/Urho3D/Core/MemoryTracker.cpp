@@ -0,0 +1,262 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/MemoryTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef URHO3D_MEMORY_TRACKING
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef URHO3D_THREADING
+#if defined(_MSC_VER)
+#define MEMORY_THREAD_LOCAL __declspec(thread)
+#else
+#define MEMORY_THREAD_LOCAL __thread
+#endif
+#else
+#define MEMORY_THREAD_LOCAL
+#endif
+
+// Dynamic exception specifications were deprecated in C++11, and MSVC ignores them
+#if __cplusplus >= 201103L
+#define MEMORY_THROW_BAD_ALLOC
+#define MEMORY_NO_THROW noexcept
+#elif defined(_MSC_VER)
+#define MEMORY_THROW_BAD_ALLOC
+#define MEMORY_NO_THROW throw()
+#else
+#define MEMORY_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define MEMORY_NO_THROW throw()
+#endif
+#endif
+
+// Note: DebugNew.h is not included, as its new macro would break the operator definitions below
+
+namespace Urho3D
+{
+
+static const char* memoryTagNames[] =
+{
+    "General",
+    "Render",
+    "Scene",
+    "Physics",
+    "Audio",
+    "Script",
+    "Navigation",
+    "UI",
+    "Network",
+    0
+};
+
+#ifdef URHO3D_MEMORY_TRACKING
+/// Size of the header stored before each allocation. A multiple of 16 to keep the returned memory aligned for any type.
+static const size_t ALLOCATION_HEADER_SIZE = 16;
+
+/// Header stored before each tracked allocation.
+struct AllocationHeader
+{
+    /// Requested size.
+    size_t size_;
+    /// Tag the allocation was accounted to.
+    unsigned tag_;
+};
+
+/// Live bytes per tag. Plain zero-initialized arrays, as allocations happen already during static initialization.
+static volatile long long liveBytes[MAX_MEMORY_TAGS];
+/// Peak bytes per tag.
+static volatile long long peakBytes[MAX_MEMORY_TAGS];
+/// Live allocations per tag.
+static volatile long long liveAllocations[MAX_MEMORY_TAGS];
+/// Total allocations per tag.
+static volatile long long totalAllocations[MAX_MEMORY_TAGS];
+/// Current tag of the thread.
+static MEMORY_THREAD_LOCAL unsigned currentTag = MEMTAG_GENERAL;
+
+/// Add to a counter atomically and return the new value.
+static inline long long AtomicAdd(volatile long long* value, long long delta)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd64(value, delta) + delta;
+#else
+    return __sync_add_and_fetch(value, delta);
+#endif
+}
+
+/// Raise a counter atomically to a value if it is higher.
+static inline void AtomicMax(volatile long long* value, long long candidate)
+{
+    long long old = AtomicAdd(value, 0);
+    while (candidate > old)
+    {
+#ifdef _WIN32
+        long long previous = InterlockedCompareExchange64(value, candidate, old);
+#else
+        long long previous = __sync_val_compare_and_swap(value, old, candidate);
+#endif
+        if (previous == old)
+            break;
+        old = previous;
+    }
+}
+#endif
+
+void* MemoryTracker::Allocate(size_t size)
+{
+#ifdef URHO3D_MEMORY_TRACKING
+    unsigned char* block = (unsigned char*)malloc(size + ALLOCATION_HEADER_SIZE);
+    if (!block)
+        return 0;
+
+    unsigned tag = currentTag;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    header->size_ = size;
+    header->tag_ = tag;
+
+    AtomicMax(&peakBytes[tag], AtomicAdd(&liveBytes[tag], (long long)size));
+    AtomicAdd(&liveAllocations[tag], 1);
+    AtomicAdd(&totalAllocations[tag], 1);
+
+    return block + ALLOCATION_HEADER_SIZE;
+#else
+    return malloc(size);
+#endif
+}
+
+void MemoryTracker::Free(void* ptr)
+{
+#ifdef URHO3D_MEMORY_TRACKING
+    if (!ptr)
+        return;
+
+    // The allocation is removed from the tag it was made with, regardless of the current tag
+    unsigned char* block = (unsigned char*)ptr - ALLOCATION_HEADER_SIZE;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(block);
+    AtomicAdd(&liveBytes[header->tag_], -(long long)header->size_);
+    AtomicAdd(&liveAllocations[header->tag_], -1);
+
+    free(block);
+#else
+    free(ptr);
+#endif
+}
+
+void MemoryTracker::SetCurrentTag(MemoryTag tag)
+{
+#ifdef URHO3D_MEMORY_TRACKING
+    if (tag < MAX_MEMORY_TAGS)
+        currentTag = tag;
+#endif
+}
+
+MemoryTag MemoryTracker::GetCurrentTag()
+{
+#ifdef URHO3D_MEMORY_TRACKING
+    return (MemoryTag)currentTag;
+#else
+    return MEMTAG_GENERAL;
+#endif
+}
+
+MemoryTagStats MemoryTracker::GetStats(MemoryTag tag)
+{
+    MemoryTagStats stats;
+#ifdef URHO3D_MEMORY_TRACKING
+    if (tag < MAX_MEMORY_TAGS)
+    {
+        // Read through atomic operations so that the 64-bit values are not torn on 32-bit platforms
+        stats.liveBytes_ = AtomicAdd(&liveBytes[tag], 0);
+        stats.peakBytes_ = AtomicAdd(&peakBytes[tag], 0);
+        stats.liveAllocations_ = AtomicAdd(&liveAllocations[tag], 0);
+        stats.totalAllocations_ = AtomicAdd(&totalAllocations[tag], 0);
+    }
+#endif
+    return stats;
+}
+
+const char* MemoryTracker::GetTagName(MemoryTag tag)
+{
+    return tag < MAX_MEMORY_TAGS ? memoryTagNames[tag] : "";
+}
+
+bool MemoryTracker::IsEnabled()
+{
+#ifdef URHO3D_MEMORY_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
+
+#ifdef URHO3D_MEMORY_TRACKING
+void* operator new(size_t size) MEMORY_THROW_BAD_ALLOC
+{
+    void* ptr = Urho3D::MemoryTracker::Allocate(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) MEMORY_THROW_BAD_ALLOC
+{
+    void* ptr = Urho3D::MemoryTracker::Allocate(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) MEMORY_NO_THROW
+{
+    return Urho3D::MemoryTracker::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) MEMORY_NO_THROW
+{
+    return Urho3D::MemoryTracker::Allocate(size);
+}
+
+void operator delete(void* ptr) MEMORY_NO_THROW
+{
+    Urho3D::MemoryTracker::Free(ptr);
+}
+
+void operator delete[](void* ptr) MEMORY_NO_THROW
+{
+    Urho3D::MemoryTracker::Free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) MEMORY_NO_THROW
+{
+    Urho3D::MemoryTracker::Free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) MEMORY_NO_THROW
+{
+    Urho3D::MemoryTracker::Free(ptr);
+}
+#endif
@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace Urho3D
+{
+
+/// %Memory accounting tag. Allocations are attributed to the tag that is current in the allocating thread.
+enum MemoryTag
+{
+    MEMTAG_GENERAL = 0,
+    MEMTAG_RENDER,
+    MEMTAG_SCENE,
+    MEMTAG_PHYSICS,
+    MEMTAG_AUDIO,
+    MEMTAG_SCRIPT,
+    MEMTAG_NAVIGATION,
+    MEMTAG_UI,
+    MEMTAG_NETWORK,
+    MAX_MEMORY_TAGS
+};
+
+/// %Memory use statistics of a tag.
+struct MemoryTagStats
+{
+    /// Construct with zero values.
+    MemoryTagStats() :
+        liveBytes_(0),
+        peakBytes_(0),
+        liveAllocations_(0),
+        totalAllocations_(0)
+    {
+    }
+
+    /// Bytes currently allocated.
+    long long liveBytes_;
+    /// Highest number of bytes allocated at once.
+    long long peakBytes_;
+    /// Number of allocations not yet freed.
+    long long liveAllocations_;
+    /// Number of allocations made in total.
+    long long totalAllocations_;
+};
+
+/// Tagged memory accounting. When compiled in with URHO3D_MEMORY_TRACKING, the global operator new and delete are replaced to count the allocations of each tag.
+class URHO3D_API MemoryTracker
+{
+public:
+    /// Allocate memory and account it to the current tag. Uses the system allocator directly if tracking has not been compiled in.
+    static void* Allocate(size_t size);
+    /// Free memory allocated with Allocate().
+    static void Free(void* ptr);
+    /// Set the current tag of the calling thread.
+    static void SetCurrentTag(MemoryTag tag);
+    /// Return the current tag of the calling thread.
+    static MemoryTag GetCurrentTag();
+    /// Return statistics of a tag. All zero if tracking has not been compiled in.
+    static MemoryTagStats GetStats(MemoryTag tag);
+    /// Return name of a tag.
+    static const char* GetTagName(MemoryTag tag);
+    /// Return whether tracking has been compiled in.
+    static bool IsEnabled();
+};
+
+/// Sets the current memory tag of the thread for the duration of a scope.
+class URHO3D_API MemoryTagScope
+{
+public:
+    /// Construct and set the tag.
+    MemoryTagScope(MemoryTag tag) :
+        previousTag_(MemoryTracker::GetCurrentTag())
+    {
+        MemoryTracker::SetCurrentTag(tag);
+    }
+
+    /// Destruct and restore the previous tag.
+    ~MemoryTagScope()
+    {
+        MemoryTracker::SetCurrentTag(previousTag_);
+    }
+
+private:
+    /// Tag before the scope.
+    MemoryTag previousTag_;
+};
+
+}
+
+#ifdef URHO3D_MEMORY_TRACKING
+#define MEMORY_TAG(tag) Urho3D::MemoryTagScope memoryTagScope_(tag)
+#else
+#define MEMORY_TAG(tag)
+#endif
@@ -87,15 +87,19 @@ void Object::SubscribeToEvent(StringHash eventType, EventHandler* handler)
         return;
     
     handler->SetSenderAndEventType(0, eventType);
-    // Remove old event handler first
+    // Replace an old event handler. The receiver is registered to the context only once
     EventHandler* previous;
     EventHandler* oldHandler = FindSpecificEventHandler(0, eventType, &previous);
     if (oldHandler)
+    {
         eventHandlers_.Erase(oldHandler, previous);
-    
-    eventHandlers_.InsertFront(handler);
-    
-    context_->AddEventReceiver(this, eventType);
+        eventHandlers_.InsertFront(handler);
+    }
+    else
+    {
+        eventHandlers_.InsertFront(handler);
+        context_->AddEventReceiver(this, eventType);
+    }
 }
 
 void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler* handler)
@@ -108,15 +112,19 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler
     }
     
     handler->SetSenderAndEventType(sender, eventType);
-    // Remove old event handler first
+    // Replace an old event handler. The receiver is registered to the context only once
     EventHandler* previous;
     EventHandler* oldHandler = FindSpecificEventHandler(sender, eventType, &previous);
     if (oldHandler)
+    {
         eventHandlers_.Erase(oldHandler, previous);
-    
-    eventHandlers_.InsertFront(handler);
-    
-    context_->AddEventReceiver(this, sender, eventType);
+        eventHandlers_.InsertFront(handler);
+    }
+    else
+    {
+        eventHandlers_.InsertFront(handler);
+        context_->AddEventReceiver(this, sender, eventType);
+    }
 }
 
 void Object::UnsubscribeFromEvent(StringHash eventType)
@@ -232,95 +240,66 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
     Context* context = context_;
-    HashSet<Object*> processed;
+    PODVector<Object*> processed;
     
     context->BeginSendEvent(this);
     
-    // Check first the specific event receivers
-    const HashSet<Object*>* group = context->GetEventReceivers(this, eventType);
+    // Check first the specific event receivers. The group is held alive, as it is destroyed if the sender is
+    SharedPtr<EventReceiverGroup> group(context->GetEventReceivers(this, eventType));
     if (group)
     {
-        for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+        group->BeginSendEvent();
+        
+        // Receivers subscribed during the send do not get this event
+        unsigned numReceivers = group->receivers_.Size();
+        for (unsigned i = 0; i < numReceivers; ++i)
         {
-            HashSet<Object*>::ConstIterator current = i++;
-            Object* receiver = *current;
-            Object* next = 0;
-            if (i != group->End())
-                next = *i;
+            Object* receiver = group->receivers_[i];
+            // Skip holes left by receivers removed during the send
+            if (!receiver)
+                continue;
             
-            unsigned oldSize = group->Size();
             receiver->OnEvent(this, eventType, eventData);
             
             // If self has been destroyed as a result of event handling, exit
             if (self.Expired())
             {
+                group->EndSendEvent();
                 context->EndSendEvent();
                 return;
             }
             
-            // If group has changed size during iteration (removed/added subscribers) try to recover
-            /// \todo This is not entirely foolproof, as a subscriber could have been added to make up for the removed one
-            if (group->Size() != oldSize)
-                i = group->Find(next);
-            
-            processed.Insert(receiver);
+            processed.Push(receiver);
         }
+        
+        group->EndSendEvent();
     }
     
     // Then the non-specific receivers
     group = context->GetEventReceivers(eventType);
     if (group)
     {
-        if (processed.Empty())
-        {
-            for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
-            {
-                HashSet<Object*>::ConstIterator current = i++;
-                Object* receiver = *current;
-                Object* next = 0;
-                if (i != group->End())
-                    next = *i;
-                
-                unsigned oldSize = group->Size();
-                receiver->OnEvent(this, eventType, eventData);
-                
-                if (self.Expired())
-                {
-                    context->EndSendEvent();
-                    return;
-                }
-                
-                if (group->Size() != oldSize)
-                    i = group->Find(next);
-            }
-        }
-        else
+        group->BeginSendEvent();
+        
+        unsigned numReceivers = group->receivers_.Size();
+        for (unsigned i = 0; i < numReceivers; ++i)
         {
+            Object* receiver = group->receivers_[i];
             // If there were specific receivers, check that the event is not sent doubly to them
-            for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+            if (!receiver || (processed.Size() && processed.Contains(receiver)))
+                continue;
+            
+            receiver->OnEvent(this, eventType, eventData);
+            
+            if (self.Expired())
             {
-                HashSet<Object*>::ConstIterator current = i++;
-                Object* receiver = *current;
-                Object* next = 0;
-                if (i != group->End())
-                    next = *i;
-                
-                if (!processed.Contains(receiver))
-                {
-                    unsigned oldSize = group->Size();
-                    receiver->OnEvent(this, eventType, eventData);
-                    
-                    if (self.Expired())
-                    {
-                        context->EndSendEvent();
-                        return;
-                    }
-                    
-                    if (group->Size() != oldSize)
-                        i = group->Find(next);
-                }
+                group->EndSendEvent();
+                context->EndSendEvent();
+                return;
             }
         }
+        
+        group->EndSendEvent();
     }
     
     context->EndSendEvent();
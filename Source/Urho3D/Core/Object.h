@@ -37,12 +37,12 @@ class EventHandler;
         virtual Urho3D::StringHash GetType() const { return GetTypeStatic(); } \
         virtual Urho3D::StringHash GetBaseType() const { return GetBaseTypeStatic(); } \
         virtual const Urho3D::String& GetTypeName() const { return GetTypeNameStatic(); } \
-        static Urho3D::StringHash GetTypeStatic() { static const Urho3D::StringHash typeStatic(#typeName); return typeStatic; } \
+        static Urho3D::StringHash GetTypeStatic() { return Urho3D::StringHash(Urho3D::StringHash::CalculateLiteral(#typeName)); } \
         static const Urho3D::String& GetTypeNameStatic() { static const Urho3D::String typeNameStatic(#typeName); return typeNameStatic; } \
 
 #define BASEOBJECT(typeName) \
     public: \
-        static Urho3D::StringHash GetBaseTypeStatic() { static const Urho3D::StringHash baseTypeStatic(#typeName); return baseTypeStatic; } \
+        static Urho3D::StringHash GetBaseTypeStatic() { return Urho3D::StringHash(Urho3D::StringHash::CalculateLiteral(#typeName)); } \
 
 /// Base class for objects with type identification, subsystem access and event sending/receiving capability.
 class URHO3D_API Object : public RefCounted
@@ -275,9 +275,9 @@ private:
 };
 
 /// Describe an event's hash ID and begin a namespace in which to define its parameters.
-#define EVENT(eventID, eventName) static const Urho3D::StringHash eventID(#eventName); namespace eventName
+#define EVENT(eventID, eventName) static const Urho3D::StringHash eventID(Urho3D::StringHash::CalculateLiteral(#eventName)); namespace eventName
 /// Describe an event's parameter hash ID. Should be used inside an event namespace.
-#define PARAM(paramID, paramName) static const Urho3D::StringHash paramID(#paramName)
+#define PARAM(paramID, paramName) static const Urho3D::StringHash paramID(Urho3D::StringHash::CalculateLiteral(#paramName))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function.
 #define HANDLER(className, function) (new Urho3D::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+#include "../Container/Allocator.h"
+#include "../Core/Mutex.h"
+#include "../Core/ObjectPool.h"
+
+#include "../DebugNew.h"
+
+#ifdef URHO3D_THREADING
+#if defined(_MSC_VER)
+#define POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define POOL_THREAD_LOCAL __thread
+#endif
+#else
+#define POOL_THREAD_LOCAL
+#endif
+
+namespace Urho3D
+{
+
+/// Size class granularity in bytes.
+static const unsigned POOL_GRANULARITY = 16;
+/// Largest pooled object size in bytes.
+static const unsigned MAX_POOLED_SIZE = 2048;
+/// Number of size classes.
+static const unsigned NUM_POOLS = MAX_POOLED_SIZE / POOL_GRANULARITY;
+/// Initial number of objects in a size class.
+static const unsigned INITIAL_POOL_CAPACITY = 16;
+/// Number of objects moved between the shared pools and a thread cache at a time.
+static const unsigned THREAD_CACHE_BATCH = 32;
+/// Maximum number of free objects per size class in a thread cache before returning some of them.
+static const unsigned THREAD_CACHE_MAX = 2 * THREAD_CACHE_BATCH;
+
+/// Per-thread cache of free objects, so that most allocations and frees do not need to lock the shared pools.
+struct ThreadPoolCache
+{
+    /// Free objects per size class, linked through their first bytes.
+    void* free_[NUM_POOLS];
+    /// Number of free objects per size class.
+    unsigned count_[NUM_POOLS];
+};
+
+/// Size class allocators. Never uninitialized, as pooled objects may still be destroyed during static destruction.
+static AllocatorBlock* pools[NUM_POOLS];
+/// Number of objects taken from the shared pools.
+static unsigned numAllocated = 0;
+/// Mutex for the shared pools. Created on first use, as objects may be allocated during static initialization.
+static Mutex* poolMutex = 0;
+/// Free object cache of the current thread. Zero-initialized for each thread.
+static POOL_THREAD_LOCAL ThreadPoolCache threadCache;
+
+static Mutex& GetPoolMutex()
+{
+    // The first allocation happens in the main thread before worker threads exist, so the creation does not need to be guarded
+    if (!poolMutex)
+        poolMutex = new Mutex();
+    return *poolMutex;
+}
+
+static void RefillThreadCache(ThreadPoolCache& cache, unsigned index)
+{
+    MutexLock lock(GetPoolMutex());
+    if (!pools[index])
+        pools[index] = AllocatorInitialize((index + 1) * POOL_GRANULARITY, INITIAL_POOL_CAPACITY);
+
+    for (unsigned i = 0; i < THREAD_CACHE_BATCH; ++i)
+    {
+        void* ptr = AllocatorReserve(pools[index]);
+        *reinterpret_cast<void**>(ptr) = cache.free_[index];
+        cache.free_[index] = ptr;
+    }
+
+    cache.count_[index] += THREAD_CACHE_BATCH;
+    numAllocated += THREAD_CACHE_BATCH;
+}
+
+static void ReleaseThreadCache(ThreadPoolCache& cache, unsigned index, unsigned keep)
+{
+    MutexLock lock(GetPoolMutex());
+    while (cache.count_[index] > keep)
+    {
+        void* ptr = cache.free_[index];
+        cache.free_[index] = *reinterpret_cast<void**>(ptr);
+        AllocatorFree(pools[index], ptr);
+        --cache.count_[index];
+        --numAllocated;
+    }
+}
+
+void* ObjectPool::Allocate(size_t size)
+{
+    if (size > MAX_POOLED_SIZE)
+        return ::operator new(size);
+
+    unsigned index = size ? (unsigned)(size - 1) / POOL_GRANULARITY : 0;
+
+    ThreadPoolCache& cache = threadCache;
+    if (!cache.free_[index])
+        RefillThreadCache(cache, index);
+
+    void* ptr = cache.free_[index];
+    cache.free_[index] = *reinterpret_cast<void**>(ptr);
+    --cache.count_[index];
+    return ptr;
+}
+
+void ObjectPool::Free(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    if (size > MAX_POOLED_SIZE)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    unsigned index = size ? (unsigned)(size - 1) / POOL_GRANULARITY : 0;
+
+    // Objects freed in another thread than where they were allocated simply move to this thread's cache
+    ThreadPoolCache& cache = threadCache;
+    *reinterpret_cast<void**>(ptr) = cache.free_[index];
+    cache.free_[index] = ptr;
+    if (++cache.count_[index] > THREAD_CACHE_MAX)
+        ReleaseThreadCache(cache, index, THREAD_CACHE_BATCH);
+}
+
+void ObjectPool::FlushThreadCache()
+{
+    ThreadPoolCache& cache = threadCache;
+    for (unsigned i = 0; i < NUM_POOLS; ++i)
+    {
+        if (cache.count_[i])
+            ReleaseThreadCache(cache, i, 0);
+    }
+}
+
+unsigned ObjectPool::GetNumAllocated()
+{
+    MutexLock lock(GetPoolMutex());
+    return numAllocated;
+}
+
+unsigned ObjectPool::GetReservedMemory()
+{
+    MutexLock lock(GetPoolMutex());
+
+    // The first block of each chain holds the total capacity
+    unsigned total = 0;
+    for (unsigned i = 0; i < NUM_POOLS; ++i)
+    {
+        if (pools[i])
+            total += pools[i]->capacity_ * (pools[i]->nodeSize_ + sizeof(AllocatorNode));
+    }
+
+    return total;
+}
+
+}
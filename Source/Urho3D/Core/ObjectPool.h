@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace Urho3D
+{
+
+/// Slab allocator pools for frequently created and destroyed objects, such as scene nodes and components. Objects are bucketed by size, and freed memory is recycled for later objects of the same size class instead of being returned to the system allocator. Each thread caches free objects, so that the shared pools are locked only when moving a batch of objects to or from the cache.
+class URHO3D_API ObjectPool
+{
+public:
+    /// Allocate memory for an object. Sizes above the largest size class use the system allocator.
+    static void* Allocate(size_t size);
+    /// Free memory of an object. The size must be the same as used for allocation.
+    static void Free(void* ptr, size_t size);
+    /// Return the calling thread's cached free objects to the shared pools. Called automatically when a Thread exits.
+    static void FlushThreadCache();
+    /// Return number of objects taken from the shared pools, including free objects held in thread caches.
+    static unsigned GetNumAllocated();
+    /// Return total capacity in bytes of the pool blocks reserved from the system allocator.
+    static unsigned GetReservedMemory();
+};
+
+}
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+// Overload for the debug new of DebugNew.h, as class-specific operator new hides the global overloads
+#define POOLED_OBJECT_DEBUG_NEW() \
+    static void* operator new(size_t size, int, const char*, int) { return Urho3D::ObjectPool::Allocate(size); }
+#else
+#define POOLED_OBJECT_DEBUG_NEW()
+#endif
+
+/// Allocate instances of the class and its subclasses from the object pool.
+#define POOLED_OBJECT() \
+    public: \
+        static void* operator new(size_t size) { return Urho3D::ObjectPool::Allocate(size); } \
+        static void operator delete(void* ptr, size_t size) { Urho3D::ObjectPool::Free(ptr, size); } \
+        POOLED_OBJECT_DEBUG_NEW() \
+
@@ -33,6 +33,8 @@
 
 #if defined(IOS)
 #include <mach/mach_host.h>
+#elif defined(__EMSCRIPTEN_PTHREADS__)
+#include <emscripten/threading.h>
 #elif !defined(ANDROID) && !defined(RPI) && !defined(EMSCRIPTEN)
 #include <LibCpuId/libcpuid.h>
 #endif
@@ -389,6 +391,37 @@ static unsigned GetArmCPUCount()
 }
 #endif
 
+#if (defined(__linux__) || defined(ANDROID)) && !defined(EMSCRIPTEN)
+static unsigned ReadCPUValue(unsigned cpu, const char* name)
+{
+    char path[128];
+    sprintf(path, "/sys/devices/system/cpu/cpu%u/%s", cpu, name);
+    
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+        return 0;
+    
+    unsigned value = 0;
+    if (fscanf(fp, "%u", &value) != 1)
+        value = 0;
+    fclose(fp);
+    return value;
+}
+
+static bool GetCPUValues(const char* name, PODVector<unsigned>& values)
+{
+    unsigned numCPUs = GetNumLogicalCPUs();
+    values.Resize(numCPUs);
+    for (unsigned i = 0; i < numCPUs; ++i)
+    {
+        values[i] = ReadCPUValue(i, name);
+        if (!values[i])
+            return false;
+    }
+    return numCPUs > 1;
+}
+#endif
+
 unsigned GetNumPhysicalCPUs()
 {
     #if defined(IOS)
@@ -402,6 +435,9 @@ unsigned GetNumPhysicalCPUs()
     #endif
     #elif defined(ANDROID) || defined(RPI)
     return GetArmCPUCount();
+    #elif defined(__EMSCRIPTEN_PTHREADS__)
+    // Browsers only report the logical cores
+    return GetNumLogicalCPUs();
     #elif !defined(EMSCRIPTEN)
     struct cpu_id_t data;
     GetCPUData(&data);
@@ -424,6 +460,9 @@ unsigned GetNumLogicalCPUs()
     #endif
     #elif defined(ANDROID) || defined (RPI)
     return GetArmCPUCount();
+    #elif defined(__EMSCRIPTEN_PTHREADS__)
+    // Threads need SharedArrayBuffer, which browsers only allow on cross-origin isolated pages
+    return emscripten_has_threading_support() ? (unsigned)Max(emscripten_num_logical_cores(), 1) : 1;
     #elif !defined(EMSCRIPTEN)
     struct cpu_id_t data;
     GetCPUData(&data);
@@ -434,4 +473,43 @@ unsigned GetNumLogicalCPUs()
     #endif
 }
 
+void GetEfficiencyCPUs(PODVector<unsigned>& dest)
+{
+    dest.Clear();
+    
+    #if (defined(__linux__) || defined(ANDROID)) && !defined(EMSCRIPTEN)
+    // Prefer the scheduler's core capacities of ARM systems, and fall back to the maximum frequencies. A core is counted as
+    // an efficiency core if it is much slower than the fastest one, so that the mid cores of three-cluster CPUs remain
+    // performance cores
+    PODVector<unsigned> values;
+    unsigned numerator;
+    unsigned denominator;
+    if (GetCPUValues("cpu_capacity", values))
+    {
+        numerator = 1;
+        denominator = 2;
+    }
+    else if (GetCPUValues("cpufreq/cpuinfo_max_freq", values))
+    {
+        numerator = 3;
+        denominator = 4;
+    }
+    else
+        return;
+    
+    unsigned maxValue = 0;
+    for (unsigned i = 0; i < values.Size(); ++i)
+    {
+        if (values[i] > maxValue)
+            maxValue = values[i];
+    }
+    
+    for (unsigned i = 0; i < values.Size(); ++i)
+    {
+        if ((unsigned long long)values[i] * denominator < (unsigned long long)maxValue * numerator)
+            dest.Push(i);
+    }
+    #endif
+}
+
 }
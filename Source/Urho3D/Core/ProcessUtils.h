@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/Str.h"
+#include "../Container/Vector.h"
 
 #include <cstdlib>
 
@@ -65,5 +66,7 @@ URHO3D_API String GetPlatform();
 URHO3D_API unsigned GetNumPhysicalCPUs();
 /// Return the number of logical CPUs (different from physical if hyperthreading is used.)
 URHO3D_API unsigned GetNumLogicalCPUs();
+/// Return the indices of the logical CPUs that are efficiency cores of a hybrid CPU, such as the LITTLE cores of ARM big.LITTLE. Detected on Linux and Android from the relative core capacities or maximum frequencies; empty on other platforms or if all cores are alike.
+URHO3D_API void GetEfficiencyCPUs(PODVector<unsigned>& dest);
 
 }
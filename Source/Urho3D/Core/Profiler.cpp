@@ -22,24 +22,48 @@
 
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/StringUtils.h"
+#include "../IO/Serializer.h"
 
 #include <cstdio>
 #include <cstring>
 
 #include "../DebugNew.h"
 
+#ifdef URHO3D_THREADING
+#if defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+#else
+#define PROFILER_THREAD_LOCAL
+#endif
+
 namespace Urho3D
 {
 
 static const int LINE_MAX_LENGTH = 256;
 static const int NAME_MAX_LENGTH = 30;
 
+/// Calling thread's timeline.
+static PROFILER_THREAD_LOCAL ProfilerTimelineBuffer* threadTimeline = 0;
+/// ID of the profiler owning the calling thread's timeline.
+static PROFILER_THREAD_LOCAL unsigned threadTimelineID = 0;
+/// Last assigned profiler instance ID.
+static unsigned lastTimelineID = 0;
+
 Profiler::Profiler(Context* context) :
     Object(context),
     current_(0),
     root_(0),
     intervalFrames_(0),
-    totalFrames_(0)
+    totalFrames_(0),
+    frameHistoryIndex_(0),
+    numHistoryFrames_(0),
+    timelineCapacity_(DEFAULT_TIMELINE_EVENTS),
+    timelineID_(++lastTimelineID),
+    timelineEnabled_(false)
 {
     root_ = new ProfilerBlock(0, "Root");
     current_ = root_;
@@ -49,6 +73,9 @@ Profiler::~Profiler()
 {
     delete root_;
     root_ = 0;
+    
+    for (PODVector<ProfilerTimelineBuffer*>::Iterator i = timelineBuffers_.Begin(); i != timelineBuffers_.End(); ++i)
+        delete *i;
 }
 
 void Profiler::BeginFrame()
@@ -70,6 +97,18 @@ void Profiler::EndFrame()
             ++totalFrames_;
         root_->EndFrame();
         current_ = root_;
+
+        if (!frameHistory_.Empty())
+        {
+            ProfilerFrameRecord& record = frameHistory_[frameHistoryIndex_];
+            record.frameNumber_ = totalFrames_;
+            record.blocks_.Clear();
+            RecordFrameHistory(root_, record.blocks_, 0);
+
+            frameHistoryIndex_ = (frameHistoryIndex_ + 1) % frameHistory_.Size();
+            if (numHistoryFrames_ < frameHistory_.Size())
+                ++numHistoryFrames_;
+        }
     }
 }
 
@@ -79,6 +118,161 @@ void Profiler::BeginInterval()
     intervalFrames_ = 0;
 }
 
+void Profiler::SetFrameHistorySize(unsigned frames)
+{
+    frameHistory_.Clear();
+    frameHistory_.Resize(frames);
+    frameHistoryIndex_ = 0;
+    numHistoryFrames_ = 0;
+}
+
+String Profiler::GetFrameHistoryData() const
+{
+    char line[LINE_MAX_LENGTH];
+    char indentedName[LINE_MAX_LENGTH];
+    String output;
+
+    unsigned historySize = frameHistory_.Size();
+    for (unsigned i = 0; i < numHistoryFrames_; ++i)
+    {
+        const ProfilerFrameRecord& record = frameHistory_[(frameHistoryIndex_ + historySize - numHistoryFrames_ + i) % historySize];
+        output.AppendWithFormat("Frame %u\n\nBlock                            Cnt     Max    Total\n\n", record.frameNumber_);
+
+        for (PODVector<ProfilerFrameBlock>::ConstIterator j = record.blocks_.Begin(); j != record.blocks_.End(); ++j)
+        {
+            memset(indentedName, ' ', NAME_MAX_LENGTH);
+            indentedName[j->depth_] = 0;
+            strcat(indentedName, j->name_);
+            indentedName[strlen(indentedName)] = ' ';
+            indentedName[NAME_MAX_LENGTH] = 0;
+
+            sprintf(line, "%s %5u %8.3f %8.3f\n", indentedName, Min(j->count_, 99999), j->maxTime_ / 1000.0f,
+                j->time_ / 1000.0f);
+            output += String(line);
+        }
+
+        output += "\n";
+    }
+
+    return output;
+}
+
+void Profiler::RecordFrameHistory(ProfilerBlock* block, PODVector<ProfilerFrameBlock>& dest, unsigned depth)
+{
+    // Do not record the root block or blocks that were not called, like the text output
+    if (block != root_)
+    {
+        if (!block->frameCount_)
+            return;
+
+        ProfilerFrameBlock frameBlock;
+        frameBlock.name_ = block->name_;
+        frameBlock.depth_ = depth;
+        frameBlock.time_ = block->frameTime_;
+        frameBlock.maxTime_ = block->frameMaxTime_;
+        frameBlock.count_ = block->frameCount_;
+        dest.Push(frameBlock);
+        ++depth;
+    }
+
+    for (PODVector<ProfilerBlock*>::ConstIterator i = block->children_.Begin(); i != block->children_.End(); ++i)
+        RecordFrameHistory(*i, dest, depth);
+}
+
+void Profiler::StartTimeline(unsigned maxEventsPerThread)
+{
+    MutexLock lock(timelineMutex_);
+    
+    timelineCapacity_ = Max((int)maxEventsPerThread, 1);
+    for (PODVector<ProfilerTimelineBuffer*>::Iterator i = timelineBuffers_.Begin(); i != timelineBuffers_.End(); ++i)
+    {
+        (*i)->size_ = 0;
+        (*i)->events_.Resize(timelineCapacity_);
+    }
+    
+    timelineTimer_.Reset();
+    timelineEnabled_ = true;
+}
+
+void Profiler::StopTimeline()
+{
+    timelineEnabled_ = false;
+}
+
+bool Profiler::SaveTimeline(Serializer& dest) const
+{
+    MutexLock lock(const_cast<Mutex&>(timelineMutex_));
+    
+    char line[LINE_MAX_LENGTH];
+    String output("{\"traceEvents\":[\n");
+    bool first = true;
+    
+    for (PODVector<ProfilerTimelineBuffer*>::ConstIterator i = timelineBuffers_.Begin(); i != timelineBuffers_.End(); ++i)
+    {
+        const ProfilerTimelineBuffer* buffer = *i;
+        
+        // Name the thread with a metadata event
+        if (buffer->mainThread_)
+            snprintf(line, LINE_MAX_LENGTH, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Main thread\"}}",
+                first ? "" : ",\n", buffer->index_);
+        else
+            snprintf(line, LINE_MAX_LENGTH, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+                first ? "" : ",\n", buffer->index_, buffer->index_);
+        output.Append(line);
+        first = false;
+        
+        for (unsigned j = 0; j < buffer->size_; ++j)
+        {
+            const ProfilerTimelineEvent& event = buffer->events_[j];
+            if (event.begin_)
+            {
+                // The name is escaped separately, so the formatted parts have a bounded length
+                output.Append(",\n{\"name\":");
+                AppendJSONString(output, event.name_);
+                snprintf(line, LINE_MAX_LENGTH, ",\"ph\":\"B\",\"pid\":1,\"tid\":%u,\"ts\":%lld}", buffer->index_, event.time_);
+            }
+            else
+                snprintf(line, LINE_MAX_LENGTH, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%u,\"ts\":%lld}", buffer->index_, event.time_);
+            output.Append(line);
+        }
+    }
+    
+    output += "\n]}\n";
+    return dest.Write(output.CString(), output.Length()) == output.Length();
+}
+
+void Profiler::RecordTimelineEvent(const char* name)
+{
+    // Register a timeline for the calling thread on its first event
+    if (threadTimelineID != timelineID_)
+    {
+        MutexLock lock(timelineMutex_);
+        threadTimeline = new ProfilerTimelineBuffer(timelineBuffers_.Size(), timelineCapacity_, Thread::IsMainThread());
+        threadTimelineID = timelineID_;
+        timelineBuffers_.Push(threadTimeline);
+    }
+    
+    ProfilerTimelineBuffer* buffer = threadTimeline;
+    // Drop the events when the timeline is full
+    if (buffer->size_ >= buffer->events_.Size())
+        return;
+    
+    ProfilerTimelineEvent& event = buffer->events_[buffer->size_];
+    event.time_ = timelineTimer_.GetUSec(false);
+    event.begin_ = name != 0;
+    
+    // Copy the name, as it may be a temporary. It is escaped when saving
+    unsigned length = 0;
+    if (name)
+    {
+        for (; name[length] && length < TIMELINE_NAME_LENGTH - 1; ++length)
+            event.name_[length] = name[length];
+    }
+    event.name_[length] = 0;
+    
+    ++buffer->size_;
+}
+
 String Profiler::GetData(bool showUnused, bool showTotal, unsigned maxDepth) const
 {
     String output;
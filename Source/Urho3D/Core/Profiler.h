@@ -23,12 +23,77 @@
 #pragma once
 
 #include "../Container/Str.h"
+#include "../Core/Mutex.h"
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 
 namespace Urho3D
 {
 
+class Serializer;
+
+/// Maximum length of a block name in the profiler timeline, including the terminating null.
+static const unsigned TIMELINE_NAME_LENGTH = 32;
+/// Default maximum number of profiler timeline events recorded per thread.
+static const unsigned DEFAULT_TIMELINE_EVENTS = 65536;
+
+/// Beginning or end of a profiling block in the profiler timeline.
+struct ProfilerTimelineEvent
+{
+    /// Time in microseconds since the timeline was started.
+    long long time_;
+    /// Block name. Empty for the end of a block.
+    char name_[TIMELINE_NAME_LENGTH];
+    /// Block beginning flag.
+    bool begin_;
+};
+
+/// Profiler timeline events of one thread. Written only by the owning thread, without locking.
+struct ProfilerTimelineBuffer
+{
+    /// Construct with thread index and event capacity.
+    ProfilerTimelineBuffer(unsigned index, unsigned capacity, bool mainThread) :
+        index_(index),
+        size_(0),
+        mainThread_(mainThread)
+    {
+        events_.Resize(capacity);
+    }
+    
+    /// Preallocated events.
+    PODVector<ProfilerTimelineEvent> events_;
+    /// Thread index in the timeline.
+    unsigned index_;
+    /// Number of events recorded.
+    unsigned size_;
+    /// Main thread flag.
+    bool mainThread_;
+};
+
+/// Timing of one block on one frame in the profiler frame history.
+struct ProfilerFrameBlock
+{
+    /// Block name. Points to the name owned by the profiling tree block.
+    const char* name_;
+    /// Depth in the profiling tree.
+    unsigned depth_;
+    /// Time on the frame.
+    long long time_;
+    /// Maximum time on the frame.
+    long long maxTime_;
+    /// Calls on the frame.
+    unsigned count_;
+};
+
+/// Block timings of one frame in the profiler frame history.
+struct ProfilerFrameRecord
+{
+    /// Frame number in the profiler.
+    unsigned frameNumber_;
+    /// Blocks that were called on the frame, in depth-first order.
+    PODVector<ProfilerFrameBlock> blocks_;
+};
+
 /// Profiling data for one block in the profiling tree.
 class URHO3D_API ProfilerBlock
 {
@@ -182,7 +247,10 @@ public:
     /// Begin timing a profiling block.
     void BeginBlock(const char* name)
     {
-        // Profiler supports only the main thread currently
+        if (timelineEnabled_)
+            RecordTimelineEvent(name);
+        
+        // The hierarchical block statistics only support the main thread
         if (!Thread::IsMainThread())
             return;
         
@@ -193,6 +261,9 @@ public:
     /// End timing the current profiling block.
     void EndBlock()
     {
+        if (timelineEnabled_)
+            RecordTimelineEvent(0);
+        
         if (!Thread::IsMainThread())
             return;
         
@@ -209,6 +280,20 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Start recording the beginning and end of profiling blocks from all threads into per-thread timelines, up to the specified number of events per thread. Clears the previous timeline.
+    void StartTimeline(unsigned maxEventsPerThread = DEFAULT_TIMELINE_EVENTS);
+    /// Stop recording the timeline.
+    void StopTimeline();
+    /// Save the recorded timeline in the Chrome trace event JSON format. Should be called after stopping the timeline, when other threads do not profile anymore. Return true if successful.
+    bool SaveTimeline(Serializer& dest) const;
+    /// Return whether the timeline is being recorded.
+    bool IsTimelineEnabled() const { return timelineEnabled_; }
+    /// Set number of most recent frames to keep the block timings of. Zero (default) disables the frame history.
+    void SetFrameHistorySize(unsigned frames);
+    /// Return number of most recent frames to keep the block timings of.
+    unsigned GetFrameHistorySize() const { return frameHistory_.Size(); }
+    /// Return the block timings of the recorded frames as text output, oldest first.
+    String GetFrameHistoryData() const;
     
     /// Return profiling data as text output.
     String GetData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
@@ -220,6 +305,10 @@ public:
 private:
     /// Return profiling data as text output for a specified profiling block.
     void GetData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
+    /// Record a block beginning, or end if name is null, to the calling thread's timeline.
+    void RecordTimelineEvent(const char* name);
+    /// Record the block timings of the frame that ended into the frame history.
+    void RecordFrameHistory(ProfilerBlock* block, PODVector<ProfilerFrameBlock>& dest, unsigned depth);
     
     /// Current profiling block.
     ProfilerBlock* current_;
@@ -229,6 +318,24 @@ private:
     unsigned intervalFrames_;
     /// Total frames.
     unsigned totalFrames_;
+    /// Frame history ring buffer.
+    Vector<ProfilerFrameRecord> frameHistory_;
+    /// Next frame history record to write.
+    unsigned frameHistoryIndex_;
+    /// Number of recorded frames in the history.
+    unsigned numHistoryFrames_;
+    /// Per-thread timelines.
+    PODVector<ProfilerTimelineBuffer*> timelineBuffers_;
+    /// Mutex for registering the per-thread timelines.
+    Mutex timelineMutex_;
+    /// Timer for the timeline timestamps.
+    HiresTimer timelineTimer_;
+    /// Maximum timeline events per thread.
+    unsigned timelineCapacity_;
+    /// Unique profiler instance ID for detecting stale thread-local timelines.
+    unsigned timelineID_;
+    /// Timeline recording flag.
+    volatile bool timelineEnabled_;
 };
 
 /// Helper class for automatically beginning and ending a profiling block
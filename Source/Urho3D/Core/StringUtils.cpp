@@ -537,6 +537,25 @@ void BufferToString(String& dest, const void* data, unsigned size)
     }
 }
 
+void AppendJSONString(String& dest, const char* source)
+{
+    dest += '"';
+    for (; *source; ++source)
+    {
+        char c = *source;
+        if (c == '"' || c == '\\')
+        {
+            dest += '\\';
+            dest += c;
+        }
+        else if ((unsigned char)c < ' ')
+            dest.AppendWithFormat("\\u%04x", (unsigned char)c);
+        else
+            dest += c;
+    }
+    dest += '"';
+}
+
 void StringToBuffer(PODVector<unsigned char>& dest, const String& source)
 {
     StringToBuffer(dest, source.CString());
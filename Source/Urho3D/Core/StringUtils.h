@@ -97,6 +97,8 @@ URHO3D_API String ToString(void* value);
 URHO3D_API String ToStringHex(unsigned value);
 /// Convert a byte buffer to a string.
 URHO3D_API void BufferToString(String& dest, const void* data, unsigned size);
+/// Append a C string to a string as a quoted JSON string, escaping the quotes, backslashes and control characters.
+URHO3D_API void AppendJSONString(String& dest, const char* source);
 /// Convert a string to a byte buffer.
 URHO3D_API void StringToBuffer(PODVector<unsigned char>& dest, const String& source);
 /// Convert a C string to a byte buffer.
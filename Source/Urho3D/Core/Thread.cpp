@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../Core/ObjectPool.h"
 #include "../Core/Thread.h"
 
 #ifdef WIN32
@@ -28,6 +29,13 @@
 #include <pthread.h>
 #endif
 
+#if (defined(__linux__) || defined(ANDROID)) && !defined(EMSCRIPTEN)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -38,6 +46,7 @@ DWORD WINAPI ThreadFunctionStatic(void* data)
 {
     Thread* thread = static_cast<Thread*>(data);
     thread->ThreadFunction();
+    ObjectPool::FlushThreadCache();
     return 0;
 }
 #else
@@ -45,6 +54,7 @@ void* ThreadFunctionStatic(void* data)
 {
     Thread* thread = static_cast<Thread*>(data);
     thread->ThreadFunction();
+    ObjectPool::FlushThreadCache();
 #ifdef EMSCRIPTEN
 // note: emscripten doesn't have this function but doesn't use threading anyway
 // so #ifdef it out to prevent linker warnings
@@ -77,14 +87,19 @@ bool Thread::Run()
     #ifdef WIN32
     handle_ = CreateThread(0, 0, ThreadFunctionStatic, this, 0, 0);
 //    #else
-    #elif !defined(EMSCRIPTEN)
-// note: emscripten doesn't have this function but doesn't use
-// threading anyway so #ifdef it out to prevent linker warnings
-    handle_ = new pthread_t;
+    #elif !defined(EMSCRIPTEN) || defined(__EMSCRIPTEN_PTHREADS__)
+// note: emscripten only has this function when built with pthreads,
+// so #ifdef it out otherwise to prevent linker warnings
+    pthread_t* thread = new pthread_t;
     pthread_attr_t type;
     pthread_attr_init(&type);
     pthread_attr_setdetachstate(&type, PTHREAD_CREATE_JOINABLE);
-    pthread_create((pthread_t*)handle_, &type, ThreadFunctionStatic, this);
+    // In browsers creating the thread fails if the page is not allowed to use SharedArrayBuffer
+    if (pthread_create(thread, &type, ThreadFunctionStatic, this) == 0)
+        handle_ = thread;
+    else
+        delete thread;
+    pthread_attr_destroy(&type);
     #endif
     return handle_ != 0;
 }
@@ -100,9 +115,9 @@ void Thread::Stop()
     WaitForSingleObject((HANDLE)handle_, INFINITE);
     CloseHandle((HANDLE)handle_);
 //    #else
-    #elif !defined(EMSCRIPTEN)
- // note: emscripten doesn't have this function but doesn't use
- // threading anyway so #ifdef it out to prevent linker warnings
+    #elif !defined(EMSCRIPTEN) || defined(__EMSCRIPTEN_PTHREADS__)
+ // note: emscripten only has this function when built with pthreads,
+ // so #ifdef it out otherwise to prevent linker warnings
     pthread_t* thread = (pthread_t*)handle_;
     if (thread)
         pthread_join(*thread, 0);
@@ -143,4 +158,60 @@ bool Thread::IsMainThread()
     return GetCurrentThreadID() == mainThreadID;
 }
 
+bool Thread::SetCurrentThreadAffinity(const PODVector<unsigned>& cpus)
+{
+    if (cpus.Empty())
+        return false;
+    
+    #ifdef WIN32
+    DWORD_PTR mask = 0;
+    for (unsigned i = 0; i < cpus.Size(); ++i)
+    {
+        if (cpus[i] < sizeof(DWORD_PTR) * 8)
+            mask |= (DWORD_PTR)1 << cpus[i];
+    }
+    return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+    #elif (defined(__linux__) || defined(ANDROID)) && !defined(EMSCRIPTEN)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned i = 0; i < cpus.Size(); ++i)
+    {
+        if (cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &set);
+    }
+    // Pid zero means the calling thread
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+    #else
+    return false;
+    #endif
+}
+
+bool Thread::SetCurrentThreadPriority(ThreadPriority priority)
+{
+    #ifdef WIN32
+    static const int priorities[] = { THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL };
+    return SetThreadPriority(GetCurrentThread(), priorities[priority]) != 0;
+    #elif (defined(__linux__) || defined(ANDROID)) && !defined(EMSCRIPTEN)
+    // Threads of the normal scheduling policy have no priority levels, but each thread has its own nice value
+    static const int niceValues[] = { 10, 0, -5 };
+    return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), niceValues[priority]) == 0;
+    #elif !defined(EMSCRIPTEN)
+    int policy;
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param))
+        return false;
+    int minPriority = sched_get_priority_min(policy);
+    int maxPriority = sched_get_priority_max(policy);
+    if (priority == THREADPRIORITY_LOW)
+        param.sched_priority = minPriority;
+    else if (priority == THREADPRIORITY_HIGH)
+        param.sched_priority = maxPriority;
+    else
+        param.sched_priority = (minPriority + maxPriority) / 2;
+    return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+    #else
+    return false;
+    #endif
+}
+
 }
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include "../Container/Vector.h"
+
 #ifndef WIN32
 #include <pthread.h>
 typedef pthread_t ThreadID;
@@ -32,6 +34,14 @@ typedef unsigned ThreadID;
 namespace Urho3D
 {
 
+/// Thread priority class.
+enum ThreadPriority
+{
+    THREADPRIORITY_LOW = 0,
+    THREADPRIORITY_NORMAL,
+    THREADPRIORITY_HIGH
+};
+
 /// Operating system thread.
 class URHO3D_API Thread
 {
@@ -60,6 +70,10 @@ public:
     static ThreadID GetCurrentThreadID();
     /// Return whether is executing in the main thread.
     static bool IsMainThread();
+    /// Restrict the current thread to run only on the specified logical CPUs. Return true if successful. Not supported on Apple platforms.
+    static bool SetCurrentThreadAffinity(const PODVector<unsigned>& cpus);
+    /// Set the current thread's priority class. Return true if successful. Raising the priority above normal may require privileges.
+    static bool SetCurrentThreadPriority(ThreadPriority priority);
     
 protected:
     /// Thread handle.
@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
 #include "../Core/Timer.h"
@@ -46,7 +47,11 @@ Time::Time(Context* context) :
     Object(context),
     frameNumber_(0),
     timeStep_(0.0f),
-    timerPeriod_(0)
+    timerPeriod_(0),
+    frameLatency_(0.0f),
+    averageFrameLatency_(0.0f),
+    frameWaitTime_(0.0f),
+    framePacingError_(0.0f)
 {
     #ifdef WIN32
     LARGE_INTEGER frequency;
@@ -88,6 +93,9 @@ void Time::BeginFrame(float timeStep)
         eventData[P_FRAMENUMBER] = frameNumber_;
         eventData[P_TIMESTEP] = timeStep_;
         SendEvent(E_BEGINFRAME, eventData);
+
+        // Then the events posted from other threads since the last frame
+        context_->SendPostedEvents(this);
     }
 }
 
@@ -118,6 +126,14 @@ void Time::SetTimerPeriod(unsigned mSec)
     #endif
 }
 
+void Time::SetFrameStats(long long latency, long long waitTime, long long pacingError)
+{
+    frameLatency_ = latency / 1000000.0f;
+    frameWaitTime_ = waitTime / 1000000.0f;
+    framePacingError_ = pacingError / 1000000.0f;
+    averageFrameLatency_ = averageFrameLatency_ ? Lerp(averageFrameLatency_, frameLatency_, 0.1f) : frameLatency_;
+}
+
 float Time::GetElapsedTime()
 {
     return elapsedTime_.GetMSec(false) / 1000.0f;
@@ -90,6 +90,8 @@ public:
     void EndFrame();
     /// Set the low-resolution timer period in milliseconds. 0 resets to the default period.
     void SetTimerPeriod(unsigned mSec);
+    /// Set the latency statistics of the last frame in microseconds. Called by Engine.
+    void SetFrameStats(long long latency, long long waitTime, long long pacingError);
     
     /// Return frame number, starting from 1 once BeginFrame() is called for the first time.
     unsigned GetFrameNumber() const { return frameNumber_; }
@@ -99,6 +101,14 @@ public:
     unsigned GetTimerPeriod() const { return timerPeriod_; }
     /// Return elapsed time from program start as seconds.
     float GetElapsedTime();
+    /// Return time in seconds from the start of the last frame, when input was read, until the frame was presented. Does not include the time the GPU takes to display the frame.
+    float GetFrameLatency() const { return frameLatency_; }
+    /// Return frame latency averaged over recent frames in seconds.
+    float GetAverageFrameLatency() const { return averageFrameLatency_; }
+    /// Return time in seconds the frame limiter waited at the end of the last frame.
+    float GetFrameWaitTime() const { return frameWaitTime_; }
+    /// Return how many seconds after the frame limiter's target time the last frame ended. Positive when the frame took longer than the target frame time, 0 when the frame limiter is not in use.
+    float GetFramePacingError() const { return framePacingError_; }
     
     /// Get system time as milliseconds.
     static unsigned GetSystemTime();
@@ -118,6 +128,14 @@ private:
     float timeStep_;
     /// Low-resolution timer period.
     unsigned timerPeriod_;
+    /// Last frame latency in seconds.
+    float frameLatency_;
+    /// Averaged frame latency in seconds.
+    float averageFrameLatency_;
+    /// Last frame limiter wait time in seconds.
+    float frameWaitTime_;
+    /// Last frame pacing error in seconds.
+    float framePacingError_;
 };
 
 }
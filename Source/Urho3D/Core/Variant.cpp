@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../Core/ObjectPool.h"
 #include "../Core/StringUtils.h"
 
 #include <cstring>
@@ -27,6 +28,23 @@
 namespace Urho3D
 {
 
+/// Compile-time check that a type constructed in place into the variant value fits in it. Larger types are allocated from the object pool.
+#define CHECK_VARIANT_VALUE_SIZE(type, name) typedef char name##DoesNotFitVariantValue[sizeof(type) <= sizeof(VariantValue) ? 1 : -1]
+
+CHECK_VARIANT_VALUE_SIZE(Vector2, Vector2);
+CHECK_VARIANT_VALUE_SIZE(Vector3, Vector3);
+CHECK_VARIANT_VALUE_SIZE(Vector4, Vector4);
+CHECK_VARIANT_VALUE_SIZE(Quaternion, Quaternion);
+CHECK_VARIANT_VALUE_SIZE(Color, Color);
+CHECK_VARIANT_VALUE_SIZE(String, String);
+CHECK_VARIANT_VALUE_SIZE(PODVector<unsigned char>, Buffer);
+CHECK_VARIANT_VALUE_SIZE(ResourceRefList, ResourceRefList);
+CHECK_VARIANT_VALUE_SIZE(VariantVector, VariantVector);
+CHECK_VARIANT_VALUE_SIZE(VariantMap, VariantMap);
+CHECK_VARIANT_VALUE_SIZE(IntRect, IntRect);
+CHECK_VARIANT_VALUE_SIZE(IntVector2, IntVector2);
+CHECK_VARIANT_VALUE_SIZE(WeakPtr<RefCounted>, WeakPtr);
+
 const Variant Variant::EMPTY;
 const PODVector<unsigned char> Variant::emptyBuffer;
 const ResourceRef Variant::emptyResourceRef;
@@ -76,7 +94,7 @@ Variant& Variant::operator = (const Variant& rhs)
         break;
 
     case VAR_RESOURCEREF:
-        *(reinterpret_cast<ResourceRef*>(&value_)) = *(reinterpret_cast<const ResourceRef*>(&rhs.value_));
+        *(reinterpret_cast<ResourceRef*>(value_.ptr_)) = *(reinterpret_cast<const ResourceRef*>(rhs.value_.ptr_));
         break;
 
     case VAR_RESOURCEREFLIST:
@@ -152,7 +170,7 @@ bool Variant::operator == (const Variant& rhs) const
         return *(reinterpret_cast<const PODVector<unsigned char>*>(&value_)) == *(reinterpret_cast<const PODVector<unsigned char>*>(&rhs.value_));
 
     case VAR_RESOURCEREF:
-        return *(reinterpret_cast<const ResourceRef*>(&value_)) == *(reinterpret_cast<const ResourceRef*>(&rhs.value_));
+        return *(reinterpret_cast<const ResourceRef*>(value_.ptr_)) == *(reinterpret_cast<const ResourceRef*>(rhs.value_.ptr_));
 
     case VAR_RESOURCEREFLIST:
         return *(reinterpret_cast<const ResourceRefList*>(&value_)) == *(reinterpret_cast<const ResourceRefList*>(&rhs.value_));
@@ -257,7 +275,7 @@ void Variant::FromString(VariantType type, const char* value)
             if (values.Size() == 2)
             {
                 SetType(VAR_RESOURCEREF);
-                ResourceRef& ref = *(reinterpret_cast<ResourceRef*>(&value_));
+                ResourceRef& ref = *(reinterpret_cast<ResourceRef*>(value_.ptr_));
                 ref.type_ = values[0];
                 ref.name_ = values[1];
             }
@@ -432,7 +450,7 @@ bool Variant::IsZero() const
         return value_.ptr_ == 0;
 
     case VAR_RESOURCEREF:
-        return reinterpret_cast<const ResourceRef*>(&value_)->name_.Empty();
+        return reinterpret_cast<const ResourceRef*>(value_.ptr_)->name_.Empty();
 
     case VAR_RESOURCEREFLIST:
     {
@@ -490,7 +508,8 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_RESOURCEREF:
-        (reinterpret_cast<ResourceRef*>(&value_))->~ResourceRef();
+        reinterpret_cast<ResourceRef*>(value_.ptr_)->~ResourceRef();
+        ObjectPool::Free(value_.ptr_, sizeof(ResourceRef));
         break;
 
     case VAR_RESOURCEREFLIST:
@@ -510,15 +529,18 @@ void Variant::SetType(VariantType newType)
         break;
         
     case VAR_MATRIX3:
-        delete reinterpret_cast<Matrix3*>(value_.ptr_);
+        reinterpret_cast<Matrix3*>(value_.ptr_)->~Matrix3();
+        ObjectPool::Free(value_.ptr_, sizeof(Matrix3));
         break;
         
     case VAR_MATRIX3X4:
-        delete reinterpret_cast<Matrix3x4*>(value_.ptr_);
+        reinterpret_cast<Matrix3x4*>(value_.ptr_)->~Matrix3x4();
+        ObjectPool::Free(value_.ptr_, sizeof(Matrix3x4));
         break;
         
     case VAR_MATRIX4:
-        delete reinterpret_cast<Matrix4*>(value_.ptr_);
+        reinterpret_cast<Matrix4*>(value_.ptr_)->~Matrix4();
+        ObjectPool::Free(value_.ptr_, sizeof(Matrix4));
         break;
         
     default:
@@ -538,7 +560,7 @@ void Variant::SetType(VariantType newType)
         break;
 
     case VAR_RESOURCEREF:
-        new(reinterpret_cast<ResourceRef*>(&value_)) ResourceRef();
+        value_.ptr_ = new(ObjectPool::Allocate(sizeof(ResourceRef))) ResourceRef();
         break;
 
     case VAR_RESOURCEREFLIST:
@@ -558,15 +580,15 @@ void Variant::SetType(VariantType newType)
         break;
         
     case VAR_MATRIX3:
-        value_.ptr_ = new Matrix3();
+        value_.ptr_ = new(ObjectPool::Allocate(sizeof(Matrix3))) Matrix3();
         break;
         
     case VAR_MATRIX3X4:
-        value_.ptr_ = new Matrix3x4();
+        value_.ptr_ = new(ObjectPool::Allocate(sizeof(Matrix3x4))) Matrix3x4();
         break;
         
     case VAR_MATRIX4:
-        value_.ptr_ = new Matrix4();
+        value_.ptr_ = new(ObjectPool::Allocate(sizeof(Matrix4))) Matrix4();
         break;
         
     default:
@@ -61,7 +61,7 @@ enum VariantType
     MAX_VAR_TYPES
 };
 
-/// Union for the possible variant values. Also stores non-POD objects such as String which must not exceed 16 bytes in size.
+/// Union for the possible variant values. Also stores non-POD objects such as String in place, which must not exceed the size of four pointers. ResourceRef and the matrices are allocated from the object pool instead.
 struct VariantValue
 {
     union
@@ -516,7 +516,7 @@ public:
     Variant& operator = (const ResourceRef& rhs)
     {
         SetType(VAR_RESOURCEREF);
-        *(reinterpret_cast<ResourceRef*>(&value_)) = rhs;
+        *(reinterpret_cast<ResourceRef*>(value_.ptr_)) = rhs;
         return *this;
     }
 
@@ -629,7 +629,7 @@ public:
     }
     
     /// Test for equality with a resource reference. To return true, both the type and value must match.
-    bool operator == (const ResourceRef& rhs) const { return type_ == VAR_RESOURCEREF ? *(reinterpret_cast<const ResourceRef*>(&value_)) == rhs : false; }
+    bool operator == (const ResourceRef& rhs) const { return type_ == VAR_RESOURCEREF ? *(reinterpret_cast<const ResourceRef*>(value_.ptr_)) == rhs : false; }
     /// Test for equality with a resource reference list. To return true, both the type and value must match.
     bool operator == (const ResourceRefList& rhs) const { return type_ == VAR_RESOURCEREFLIST ? *(reinterpret_cast<const ResourceRefList*>(&value_)) == rhs : false; }
     /// Test for equality with a variant vector. To return true, both the type and value must match.
@@ -756,7 +756,7 @@ public:
     }
     
     /// Return a resource reference or empty on type mismatch.
-    const ResourceRef& GetResourceRef() const { return type_ == VAR_RESOURCEREF ? *reinterpret_cast<const ResourceRef*>(&value_) : emptyResourceRef; }
+    const ResourceRef& GetResourceRef() const { return type_ == VAR_RESOURCEREF ? *reinterpret_cast<const ResourceRef*>(value_.ptr_) : emptyResourceRef; }
     /// Return a resource reference list or empty on type mismatch.
     const ResourceRefList& GetResourceRefList() const { return type_ == VAR_RESOURCEREFLIST ? *reinterpret_cast<const ResourceRefList*>(&value_) : emptyResourceRefList; }
     /// Return a variant vector or empty on type mismatch.
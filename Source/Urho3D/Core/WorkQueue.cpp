@@ -36,9 +36,11 @@ class WorkerThread : public Thread, public RefCounted
 {
 public:
     /// Construct.
-    WorkerThread(WorkQueue* owner, unsigned index) :
+    WorkerThread(WorkQueue* owner, unsigned index, const PODVector<unsigned>& cpus, bool skipCritical) :
         owner_(owner),
-        index_(index)
+        index_(index),
+        cpus_(cpus),
+        skipCritical_(skipCritical)
     {
     }
     
@@ -47,17 +49,34 @@ public:
     {
         // Init FPU state first
         InitFPU();
-        owner_->ProcessItems(index_);
+        if (!cpus_.Empty() && !SetCurrentThreadAffinity(cpus_))
+            LOGWARNINGF("Could not set the CPU affinity of worker thread %u", index_);
+        if (owner_->threadPriority_ != THREADPRIORITY_NORMAL && !SetCurrentThreadPriority(owner_->threadPriority_))
+            LOGWARNINGF("Could not set the priority of worker thread %u", index_);
+        
+        if (owner_->workStealing_)
+            owner_->ProcessItemsStealing(index_, skipCritical_);
+        else
+            owner_->ProcessItems(index_, skipCritical_);
     }
     
     /// Return thread index.
     unsigned GetIndex() const { return index_; }
     
+    /// Own prioritized work item queue, used in work stealing mode.
+    List<WorkItem*> queue_;
+    /// Own queue mutex.
+    Mutex queueMutex_;
+    
 private:
     /// Work queue.
     WorkQueue* owner_;
     /// Thread index.
     unsigned index_;
+    /// Logical CPUs to run on, or empty to not restrict.
+    PODVector<unsigned> cpus_;
+    /// Whether to leave latency-critical items to other threads.
+    bool skipCritical_;
 };
 
 WorkQueue::WorkQueue(Context* context) :
@@ -67,7 +86,14 @@ WorkQueue::WorkQueue(Context* context) :
     paused_(false),
     tolerance_(10),
     lastSize_(0),
-    maxNonThreadedWorkMs_(5)
+    maxNonThreadedWorkMs_(5),
+    nextQueueIndex_(0),
+    workStealing_(false),
+    threadAffinity_(false),
+    threadPriority_(THREADPRIORITY_NORMAL),
+    numReservedCPUs_(0),
+    criticalPriority_(M_MAX_UNSIGNED),
+    numEfficiencyThreads_(0)
 {
     SubscribeToEvent(E_BEGINFRAME, HANDLER(WorkQueue, HandleBeginFrame));
 }
@@ -89,15 +115,115 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     if (!threads_.Empty())
         return;
     
-    // Start threads in paused mode
+    // Sort the logical CPUs into performance and efficiency cores, and reserve CPUs for other threads starting from the
+    // efficiency cores. At least one CPU is always left for the main thread and the workers
+    PODVector<unsigned> performanceCPUs;
+    PODVector<unsigned> efficiencyCPUs;
+    reservedCPUs_.Clear();
+    if (threadAffinity_ || numReservedCPUs_)
+    {
+        GetEfficiencyCPUs(efficiencyCPUs);
+        unsigned numCPUs = GetNumLogicalCPUs();
+        for (unsigned i = 0; i < numCPUs; ++i)
+        {
+            if (!efficiencyCPUs.Contains(i))
+                performanceCPUs.Push(i);
+        }
+        
+        while (reservedCPUs_.Size() < numReservedCPUs_ && performanceCPUs.Size() + efficiencyCPUs.Size() > 1)
+        {
+            PODVector<unsigned>& cpus = efficiencyCPUs.Empty() ? performanceCPUs : efficiencyCPUs;
+            reservedCPUs_.Push(cpus.Back());
+            cpus.Pop();
+        }
+        
+        // Without affinity the workers may run on any of the remaining CPUs
+        if (!threadAffinity_)
+        {
+            performanceCPUs.Push(efficiencyCPUs);
+            efficiencyCPUs.Clear();
+        }
+    }
+    
+    // Fill the performance cores first, leaving one of them for the main thread. Efficiency core threads leave the
+    // latency-critical work items to the performance core threads if there are any
+    unsigned numPerformanceThreads = numThreads;
+    if (!efficiencyCPUs.Empty())
+        numPerformanceThreads = Min((int)numThreads, (int)performanceCPUs.Size() - 1);
+    numEfficiencyThreads_ = numThreads - numPerformanceThreads;
+    
+    // Start threads in paused mode. In work stealing mode there are no queue mutexes to hold yet, so each new thread's
+    // mutex is acquired before it starts
     Pause();
     
     for (unsigned i = 0; i < numThreads; ++i)
     {
-        SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
-        thread->Run();
+        bool efficiency = i >= numPerformanceThreads;
+        SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1, efficiency ? efficiencyCPUs : performanceCPUs,
+            efficiency && numPerformanceThreads > 0));
+        if (workStealing_)
+            thread->queueMutex_.Acquire();
+        // Thread creation can fail for example in browsers when the page is not cross-origin isolated
+        if (!thread->Run())
+        {
+            if (workStealing_)
+                thread->queueMutex_.Release();
+            LOGWARNINGF("Failed to create worker thread, using %u worker threads", threads_.Size());
+            break;
+        }
         threads_.Push(thread);
     }
+    numEfficiencyThreads_ = threads_.Size() > numPerformanceThreads ? threads_.Size() - numPerformanceThreads : 0;
+    
+    if (numEfficiencyThreads_ || !reservedCPUs_.Empty())
+    {
+        LOGINFOF("Pinned %u worker threads to performance cores and %u to efficiency cores, reserved %u CPUs",
+            numPerformanceThreads, numEfficiencyThreads_, reservedCPUs_.Size());
+    }
+}
+
+void WorkQueue::SetWorkStealing(bool enable)
+{
+    if (!threads_.Empty())
+    {
+        LOGERROR("Can not change work stealing mode after creating worker threads");
+        return;
+    }
+    
+    workStealing_ = enable;
+}
+
+void WorkQueue::SetThreadAffinity(bool enable)
+{
+    if (!threads_.Empty())
+    {
+        LOGERROR("Can not change thread affinity after creating worker threads");
+        return;
+    }
+    
+    threadAffinity_ = enable;
+}
+
+void WorkQueue::SetThreadPriority(ThreadPriority priority)
+{
+    if (!threads_.Empty())
+    {
+        LOGERROR("Can not change thread priority after creating worker threads");
+        return;
+    }
+    
+    threadPriority_ = priority;
+}
+
+void WorkQueue::SetNumReservedCPUs(unsigned num)
+{
+    if (!threads_.Empty())
+    {
+        LOGERROR("Can not change reserved CPUs after creating worker threads");
+        return;
+    }
+    
+    numReservedCPUs_ = num;
 }
 
 SharedPtr<WorkItem> WorkQueue::GetFreeItem()
@@ -132,26 +258,43 @@ void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
-
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
     
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
+    // If the item still waits for dependencies, it will be queued by the thread completing the last of them
+    if (item->numDependencies_)
+    {
+        MutexLock lock(dependencyMutex_);
+        item->submitted_ = true;
+        if (item->pendingDependencies_)
+            return;
+    }
     else
+        item->submitted_ = true;
+
+    if (workStealing_ && threads_.Size())
     {
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
+        // Distribute items to the per-thread queues in round-robin order. If paused, all the queue mutexes are already held
+        WorkerThread* thread = threads_[nextQueueIndex_];
+        nextQueueIndex_ = (nextQueueIndex_ + 1) % threads_.Size();
+        
+        if (!paused_)
         {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                break;
-            }
+            MutexLock lock(thread->queueMutex_);
+            InsertItem(thread->queue_, item);
+        }
+        else
+        {
+            InsertItem(thread->queue_, item);
+            Resume();
         }
+        return;
     }
     
+    // Make sure worker threads' list is safe to modify
+    if (threads_.Size() && !paused_)
+        queueMutex_.Acquire();
+    
+    InsertItem(queue_, item);
+    
     if (threads_.Size())
     {
         queueMutex_.Release();
@@ -159,11 +302,54 @@ void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
     }
 }
 
+void WorkQueue::AddDependency(SharedPtr<WorkItem> item, SharedPtr<WorkItem> dependency)
+{
+    if (!item || !dependency || item == dependency)
+    {
+        LOGERROR("Null or self work item dependency");
+        return;
+    }
+    
+    if (item->submitted_ || dependency->submitted_ || workItems_.Contains(item) || workItems_.Contains(dependency))
+    {
+        LOGERROR("Can not add dependency to a work item already in the work queue");
+        return;
+    }
+    
+    dependency->dependents_.Push(item.Get());
+    ++item->numDependencies_;
+    ++item->pendingDependencies_;
+}
+
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 {
-    if (!item)
+    if (!item || !item->dependents_.Empty())
         return false;
 
+    if (workStealing_ && threads_.Size())
+    {
+        for (unsigned t = 0; t < threads_.Size(); ++t)
+        {
+            WorkerThread* thread = threads_[t];
+            MutexLock lock(thread->queueMutex_);
+            
+            List<WorkItem*>::Iterator i = thread->queue_.Find(item.Get());
+            if (i != thread->queue_.End())
+            {
+                List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
+                if (j != workItems_.End())
+                {
+                    thread->queue_.Erase(i);
+                    ReturnToPool(item);
+                    workItems_.Erase(j);
+                    return true;
+                }
+            }
+        }
+        
+        return false;
+    }
+    
     MutexLock lock(queueMutex_);
     
     // Can only remove successfully if the item was not yet taken by threads for execution
@@ -185,6 +371,19 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 
 unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 {
+    if (workStealing_ && threads_.Size())
+    {
+        unsigned removed = 0;
+        
+        for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
+        {
+            if (RemoveWorkItem(*i))
+                ++removed;
+        }
+        
+        return removed;
+    }
+    
     MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
@@ -213,7 +412,14 @@ void WorkQueue::Pause()
     {
         pausing_ = true;
         
-        queueMutex_.Acquire();
+        if (workStealing_)
+        {
+            // Worker threads take only one queue mutex at a time, so acquiring all in order can not deadlock
+            for (unsigned i = 0; i < threads_.Size(); ++i)
+                threads_[i]->queueMutex_.Acquire();
+        }
+        else
+            queueMutex_.Acquire();
         paused_ = true;
         
         pausing_ = false;
@@ -224,7 +430,13 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
+        if (workStealing_)
+        {
+            for (unsigned i = 0; i < threads_.Size(); ++i)
+                threads_[i]->queueMutex_.Release();
+        }
+        else
+            queueMutex_.Release();
         paused_ = false;
     }
 }
@@ -236,6 +448,17 @@ void WorkQueue::Complete(unsigned priority)
     {
         Resume();
         
+        if (workStealing_)
+        {
+            // Take work items also in the main thread, stealing from each worker's queue in turn
+            unsigned startIndex = 0;
+            while (WorkItem* item = TakeItem(startIndex, priority))
+            {
+                ExecuteItem(item, 0);
+                startIndex = (startIndex + 1) % threads_.Size();
+            }
+        }
+        
         // Take work items also in the main thread until queue empty or no high-priority items anymore
         while (!queue_.Empty())
         {
@@ -245,8 +468,7 @@ void WorkQueue::Complete(unsigned priority)
                 WorkItem* item = queue_.Front();
                 queue_.PopFront();
                 queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
+                ExecuteItem(item, 0);
             }
             else
             {
@@ -261,7 +483,7 @@ void WorkQueue::Complete(unsigned priority)
         }
         
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (!HasQueuedItems())
             Pause();
     }
     else
@@ -271,14 +493,26 @@ void WorkQueue::Complete(unsigned priority)
         {
             WorkItem* item = queue_.Front();
             queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            ExecuteItem(item, 0);
         }
     }
     
     PurgeCompleted(priority);
 }
 
+unsigned WorkQueue::GetChunkSize(unsigned count, unsigned grainSize) const
+{
+    // Without worker threads everything will be executed in the main thread, so do not split at all
+    if (threads_.Empty())
+        return count ? count : 1;
+    
+    unsigned numItems = (threads_.Size() + 1) * PARALLEL_ITEMS_PER_THREAD;
+    unsigned chunkSize = (count + numItems - 1) / numItems;
+    if (chunkSize < grainSize)
+        chunkSize = grainSize;
+    return chunkSize ? chunkSize : 1;
+}
+
 bool WorkQueue::IsCompleted(unsigned priority) const
 {
     for (List<SharedPtr<WorkItem> >::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
@@ -290,7 +524,7 @@ bool WorkQueue::IsCompleted(unsigned priority) const
     return true;
 }
 
-void WorkQueue::ProcessItems(unsigned threadIndex)
+void WorkQueue::ProcessItems(unsigned threadIndex, bool skipCritical)
 {
     bool wasActive = false;
     
@@ -304,15 +538,13 @@ void WorkQueue::ProcessItems(unsigned threadIndex)
         else
         {
             queueMutex_.Acquire();
-            if (!queue_.Empty())
+            WorkItem* item = PopItem(queue_, 0, skipCritical);
+            if (item)
             {
                 wasActive = true;
                 
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
                 queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
+                ExecuteItem(item, threadIndex);
             }
             else
             {
@@ -325,6 +557,154 @@ void WorkQueue::ProcessItems(unsigned threadIndex)
     }
 }
 
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    {
+        PROFILE(ExecuteWorkItem);
+        item->workFunction_(item, threadIndex);
+    }
+    
+    for (PODVector<WorkItem*>::Iterator i = item->dependents_.Begin(); i != item->dependents_.End(); ++i)
+    {
+        WorkItem* dependent = *i;
+        bool ready;
+        {
+            MutexLock lock(dependencyMutex_);
+            ready = --dependent->pendingDependencies_ == 0 && dependent->submitted_;
+        }
+        
+        if (ready)
+            QueueDependentItem(dependent, threadIndex);
+    }
+    
+    // Mark completed only after dependents have been queued, so that Complete() can not finish in between
+    item->completed_ = true;
+}
+
+void WorkQueue::QueueDependentItem(WorkItem* item, unsigned threadIndex)
+{
+    if (workStealing_ && threads_.Size())
+    {
+        // Prefer the completing thread's own queue, as the dependent likely uses the same data
+        WorkerThread* thread = threads_[threadIndex ? threadIndex - 1 : 0];
+        MutexLock lock(thread->queueMutex_);
+        InsertItem(thread->queue_, item);
+    }
+    else
+    {
+        MutexLock lock(queueMutex_);
+        InsertItem(queue_, item);
+    }
+}
+
+void WorkQueue::ProcessItemsStealing(unsigned threadIndex, bool skipCritical)
+{
+    bool wasActive = false;
+    
+    for (;;)
+    {
+        if (shutDown_)
+            return;
+        
+        if (pausing_ && !wasActive)
+            Time::Sleep(0);
+        else
+        {
+            // Take from own queue first, then steal from the other threads
+            WorkItem* item = TakeItem(threadIndex - 1, 0, skipCritical);
+            if (item)
+            {
+                wasActive = true;
+                
+                ExecuteItem(item, threadIndex);
+            }
+            else
+            {
+                wasActive = false;
+                
+                Time::Sleep(0);
+            }
+        }
+    }
+}
+
+void WorkQueue::InsertItem(List<WorkItem*>& queue, WorkItem* item)
+{
+    // Find position for new item, searching from the back as items are typically added in the same or decreasing priority.
+    // Items of equal priority are executed in the order they were added
+    List<WorkItem*>::Iterator i = queue.End();
+    while (i != queue.Begin())
+    {
+        List<WorkItem*>::Iterator prev = i;
+        --prev;
+        if ((*prev)->priority_ >= item->priority_)
+            break;
+        i = prev;
+    }
+    
+    queue.Insert(i, item);
+}
+
+WorkItem* WorkQueue::TakeItem(unsigned startIndex, unsigned priority, bool skipCritical)
+{
+    unsigned numThreads = threads_.Size();
+    
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        WorkerThread* thread = threads_[(startIndex + i) % numThreads];
+        
+        // Always lock before looking at the queue. While paused, all queue mutexes are held, so a worker thread blocks here
+        // on its own queue instead of spinning
+        MutexLock lock(thread->queueMutex_);
+        WorkItem* item = PopItem(thread->queue_, priority, skipCritical);
+        if (item)
+            return item;
+    }
+    
+    return 0;
+}
+
+WorkItem* WorkQueue::PopItem(List<WorkItem*>& queue, unsigned priority, bool skipCritical)
+{
+    // The queue is sorted by decreasing priority, so the latency-critical items are at the front
+    for (List<WorkItem*>::Iterator i = queue.Begin(); i != queue.End(); ++i)
+    {
+        WorkItem* item = *i;
+        if (item->priority_ < priority)
+            break;
+        if (skipCritical && item->priority_ >= criticalPriority_)
+            continue;
+        
+        queue.Erase(i);
+        return item;
+    }
+    
+    return 0;
+}
+
+bool WorkQueue::HasQueuedItems()
+{
+    // Worker threads may be queueing dependent items, so lock the queues
+    {
+        MutexLock lock(queueMutex_);
+        if (!queue_.Empty())
+            return true;
+    }
+    
+    if (workStealing_)
+    {
+        for (unsigned i = 0; i < threads_.Size(); ++i)
+        {
+            WorkerThread* thread = threads_[i];
+            MutexLock lock(thread->queueMutex_);
+            if (!thread->queue_.Empty())
+                return true;
+        }
+    }
+    
+    return false;
+}
+
 void WorkQueue::PurgeCompleted(unsigned priority)
 {
     // Purge completed work items and send completion events. Do not signal items lower than priority threshold,
@@ -365,6 +745,12 @@ void WorkQueue::PurgePool()
 
 void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 {
+    // Dependencies are consumed when the item completes, so that it can be reused
+    item->dependents_.Clear();
+    item->numDependencies_ = 0;
+    item->pendingDependencies_ = 0;
+    item->submitted_ = false;
+    
     // Check if this was a pooled item and set it to usable
     if (item->pooled_)
     {
@@ -397,8 +783,7 @@ void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
         {
             WorkItem* item = queue_.Front();
             queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            ExecuteItem(item, 0);
         }
     }
     
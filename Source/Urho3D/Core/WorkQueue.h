@@ -25,6 +25,8 @@
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
+#include "../Core/ObjectPool.h"
+#include "../Core/Thread.h"
 
 namespace Urho3D
 {
@@ -37,10 +39,14 @@ EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 
 class WorkerThread;
 
+/// Number of work items to split a range into per thread (including the main thread) when no grain size is specified. Using more than one helps to balance uneven work.
+static const unsigned PARALLEL_ITEMS_PER_THREAD = 4;
+
 /// Work queue item.
 struct WorkItem : public RefCounted
 {
     friend class WorkQueue;
+    POOLED_OBJECT();
 
 public:
     // Construct
@@ -48,6 +54,9 @@ public:
         priority_(0),
         sendEvent_(false),
         completed_(false),
+        numDependencies_(0),
+        pendingDependencies_(0),
+        submitted_(false),
         pooled_(false)
     {
     }
@@ -66,11 +75,52 @@ public:
     bool sendEvent_;
     /// Completed flag.
     volatile bool completed_;
+    
+    /// Return whether has been added to the work queue and not purged or removed yet. The item can be added again only after this returns false. Main thread only.
+    bool IsSubmitted() const { return submitted_; }
 
 private:
+    /// Work items waiting for this item to complete.
+    PODVector<WorkItem*> dependents_;
+    /// Number of work items this item depends on.
+    unsigned numDependencies_;
+    /// Number of unfinished work items this item depends on.
+    unsigned pendingDependencies_;
+    /// Whether has been added to the work queue and not purged or removed yet.
+    bool submitted_;
+    /// Whether belongs to the work item pool.
     bool pooled_;
 };
 
+/// Work function for WorkQueue::ParallelFor(). Calls the functor in the auxiliary pointer with the item's range.
+template <class T, class F> void ParallelForWork(const WorkItem* item, unsigned threadIndex)
+{
+    F& functor = *reinterpret_cast<F*>(item->aux_);
+    functor(reinterpret_cast<T*>(item->start_), reinterpret_cast<T*>(item->end_), threadIndex);
+}
+
+/// Shared state of a WorkQueue::ParallelReduce() operation.
+template <class T, class R, class F> struct ParallelReduceData
+{
+    /// Functor to call for each chunk.
+    F* functor_;
+    /// Start of the whole range.
+    T* begin_;
+    /// Number of elements per chunk.
+    unsigned chunkSize_;
+    /// Result of each chunk.
+    Vector<R> results_;
+};
+
+/// Work function for WorkQueue::ParallelReduce(). Stores the functor result of the item's range to its chunk slot.
+template <class T, class R, class F> void ParallelReduceWork(const WorkItem* item, unsigned threadIndex)
+{
+    ParallelReduceData<T, R, F>& data = *reinterpret_cast<ParallelReduceData<T, R, F>*>(item->aux_);
+    T* start = reinterpret_cast<T*>(item->start_);
+    data.results_[(unsigned)(start - data.begin_) / data.chunkSize_] = (*data.functor_)(start, reinterpret_cast<T*>(item->end_),
+        threadIndex);
+}
+
 /// Work queue subsystem for multithreading.
 class URHO3D_API WorkQueue : public Object
 {
@@ -90,10 +140,89 @@ public:
     SharedPtr<WorkItem> GetFreeItem();
     /// Add a work item and resume worker threads.
     void AddWorkItem(SharedPtr<WorkItem> item);
-    /// Remove a work item before it has started executing. Return true if successfully removed.
+    /// Make a work item wait until another work item has completed. Both must be added to the queue only after all their dependencies are defined. The dependency should have at least the same priority as the item to not stall Complete().
+    void AddDependency(SharedPtr<WorkItem> item, SharedPtr<WorkItem> dependency);
+    /// Remove a work item before it has started executing. Return true if successfully removed. Items waiting for dependencies, or which have dependents, can not be removed.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items);
+    /// Split an array range into work items calling the work function with the start and end pointers of each chunk, and add them to the queue. Zero grain size chooses the chunk size according to the number of threads. Return the number of work items added.
+    template <class T> unsigned AddRangeWorkItems(T* begin, T* end, unsigned grainSize, void (*workFunction)(const WorkItem*, unsigned),
+        void* aux, unsigned priority = M_MAX_UNSIGNED)
+    {
+        unsigned count = (unsigned)(end - begin);
+        if (!count)
+            return 0;
+        
+        unsigned chunkSize = GetChunkSize(count, grainSize);
+        unsigned numItems = 0;
+        
+        for (T* start = begin; start < end; start += chunkSize)
+        {
+            SharedPtr<WorkItem> item = GetFreeItem();
+            item->priority_ = priority;
+            item->workFunction_ = workFunction;
+            item->aux_ = aux;
+            item->start_ = start;
+            item->end_ = (unsigned)(end - start) > chunkSize ? start + chunkSize : end;
+            AddWorkItem(item);
+            ++numItems;
+        }
+        
+        return numItems;
+    }
+    /// Split a vector into work items and add them to the queue. Return the number of work items added.
+    template <class T> unsigned AddRangeWorkItems(PODVector<T>& vector, unsigned grainSize, void (*workFunction)(const WorkItem*, unsigned),
+        void* aux, unsigned priority = M_MAX_UNSIGNED)
+    {
+        return AddRangeWorkItems(vector.Begin().ptr_, vector.End().ptr_, grainSize, workFunction, aux, priority);
+    }
+    /// Process an array range in parallel and wait for completion. The functor is called as functor(start, end, threadIndex) for each chunk. Zero grain size chooses the chunk size according to the number of threads. Must be called from the main thread.
+    template <class T, class F> void ParallelFor(T* begin, T* end, unsigned grainSize, F& functor)
+    {
+        unsigned count = (unsigned)(end - begin);
+        if (!count)
+            return;
+        
+        // If the range fits in one chunk, skip the work items altogether
+        if (GetChunkSize(count, grainSize) >= count)
+            functor(begin, end, 0);
+        else
+        {
+            AddRangeWorkItems(begin, end, grainSize, &ParallelForWork<T, F>, &functor);
+            Complete(M_MAX_UNSIGNED);
+        }
+    }
+    /// Process a vector in parallel and wait for completion.
+    template <class T, class F> void ParallelFor(PODVector<T>& vector, unsigned grainSize, F& functor)
+    {
+        ParallelFor(vector.Begin().ptr_, vector.End().ptr_, grainSize, functor);
+    }
+    /// Process an array range in parallel and return the combined result. The functor is called as functor(start, end, threadIndex) for each chunk and returns the chunk result. The chunk results are combined in range order as join(lhs, rhs), starting from the identity value. Must be called from the main thread.
+    template <class T, class R, class F, class J> R ParallelReduce(T* begin, T* end, unsigned grainSize, const R& identity, F& functor, J join)
+    {
+        unsigned count = (unsigned)(end - begin);
+        if (!count)
+            return identity;
+        
+        unsigned chunkSize = GetChunkSize(count, grainSize);
+        if (chunkSize >= count)
+            return join(identity, functor(begin, end, 0));
+        
+        ParallelReduceData<T, R, F> data;
+        data.functor_ = &functor;
+        data.begin_ = begin;
+        data.chunkSize_ = chunkSize;
+        data.results_.Resize((count + chunkSize - 1) / chunkSize);
+        
+        AddRangeWorkItems(begin, end, grainSize, &ParallelReduceWork<T, R, F>, &data);
+        Complete(M_MAX_UNSIGNED);
+        
+        R result = identity;
+        for (unsigned i = 0; i < data.results_.Size(); ++i)
+            result = join(result, data.results_[i]);
+        return result;
+    }
     /// Pause worker threads.
     void Pause();
     /// Resume worker threads.
@@ -104,19 +233,59 @@ public:
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
     /// Set how many milliseconds maximum per frame to spend on low-priority work, when there are no worker threads.
     void SetNonThreadedWorkMs(int ms) { maxNonThreadedWorkMs_ = Max(ms, 1); }
+    /// Enable or disable work stealing mode, where each worker thread has its own queue and idle threads steal work from the others. Can only be changed before creating the worker threads.
+    void SetWorkStealing(bool enable);
+    /// Enable or disable pinning the worker threads to the performance or efficiency cores of the CPU. The performance cores are filled first. Can only be changed before creating the worker threads.
+    void SetThreadAffinity(bool enable);
+    /// Set the priority class of the worker threads. Can only be changed before creating the worker threads.
+    void SetThreadPriority(ThreadPriority priority);
+    /// Set number of logical CPUs that the worker threads are kept away from, to leave them for the audio, network or other application threads. Efficiency cores are reserved first. Can only be changed before creating the worker threads.
+    void SetNumReservedCPUs(unsigned num);
+    /// Set the priority from which work items are latency-critical. Worker threads pinned to efficiency cores leave such items to the performance core threads and the main thread. Default M_MAX_UNSIGNED, the priority of the work the main thread waits for.
+    void SetCriticalPriority(unsigned priority) { criticalPriority_ = priority; }
     
     /// Return number of worker threads.
     unsigned GetNumThreads() const { return threads_.Size(); }
+    /// Return the number of elements per work item for splitting a range of the specified size, but at least the grain size. Zero grain size chooses according to the number of threads only.
+    unsigned GetChunkSize(unsigned count, unsigned grainSize) const;
     /// Return whether all work with at least the specified priority is finished.
     bool IsCompleted(unsigned priority) const;
     /// Return the pool tolerance.
     int GetTolerance() const { return tolerance_; }
     /// Return how many milliseconds maximum to spend on non-threaded low-priority work.
     int GetNonThreadedWorkMs() const { return maxNonThreadedWorkMs_; }
+    /// Return whether work stealing mode is enabled.
+    bool GetWorkStealing() const { return workStealing_; }
+    /// Return whether worker threads are pinned to the performance or efficiency cores.
+    bool GetThreadAffinity() const { return threadAffinity_; }
+    /// Return the priority class of the worker threads.
+    ThreadPriority GetThreadPriority() const { return threadPriority_; }
+    /// Return number of logical CPUs to reserve for other threads.
+    unsigned GetNumReservedCPUs() const { return numReservedCPUs_; }
+    /// Return the logical CPUs reserved for other threads. Valid after creating the worker threads. Other threads can be pinned to them with Thread::SetCurrentThreadAffinity().
+    const PODVector<unsigned>& GetReservedCPUs() const { return reservedCPUs_; }
+    /// Return the priority from which work items are latency-critical.
+    unsigned GetCriticalPriority() const { return criticalPriority_; }
+    /// Return number of worker threads pinned to efficiency cores.
+    unsigned GetNumEfficiencyThreads() const { return numEfficiencyThreads_; }
     
 private:
-    /// Process work items until shut down. Called by the worker threads.
-    void ProcessItems(unsigned threadIndex);
+    /// Process work items until shut down, optionally leaving the latency-critical items to other threads. Called by the worker threads.
+    void ProcessItems(unsigned threadIndex, bool skipCritical);
+    /// Execute a work item and queue those of its dependents that have no more unfinished dependencies.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Queue a work item whose dependencies have completed.
+    void QueueDependentItem(WorkItem* item, unsigned threadIndex);
+    /// Process work items from the per-thread queues until shut down, optionally leaving the latency-critical items to other threads. Called by the worker threads in work stealing mode.
+    void ProcessItemsStealing(unsigned threadIndex, bool skipCritical);
+    /// Insert a work item to a queue according to its priority.
+    void InsertItem(List<WorkItem*>& queue, WorkItem* item);
+    /// Take the highest priority item from the per-thread queues, starting from the specified queue index. Return null if no item with at least the specified priority.
+    WorkItem* TakeItem(unsigned startIndex, unsigned priority, bool skipCritical = false);
+    /// Remove and return the highest priority item with at least the specified priority from a locked queue, optionally skipping latency-critical items. Return null if none.
+    WorkItem* PopItem(List<WorkItem*>& queue, unsigned priority, bool skipCritical);
+    /// Return whether any work items are waiting in the queues. Must not be called while paused.
+    bool HasQueuedItems();
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -136,6 +305,8 @@ private:
     List<WorkItem*> queue_;
     /// Worker queue mutex.
     Mutex queueMutex_;
+    /// Work item dependency counter mutex.
+    Mutex dependencyMutex_;
     /// Shutting down flag.
     volatile bool shutDown_;
     /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
@@ -148,6 +319,22 @@ private:
     unsigned lastSize_;
     /// Maximum milliseconds per frame to spend on low-priority work, when there are no worker threads.
     int maxNonThreadedWorkMs_;
+    /// Index of the per-thread queue to receive the next work item in work stealing mode.
+    unsigned nextQueueIndex_;
+    /// Work stealing mode flag.
+    bool workStealing_;
+    /// Thread affinity flag.
+    bool threadAffinity_;
+    /// Worker thread priority class.
+    ThreadPriority threadPriority_;
+    /// Number of logical CPUs to reserve for other threads.
+    unsigned numReservedCPUs_;
+    /// Logical CPUs reserved for other threads.
+    PODVector<unsigned> reservedCPUs_;
+    /// Priority from which work items are latency-critical.
+    unsigned criticalPriority_;
+    /// Number of worker threads pinned to efficiency cores.
+    unsigned numEfficiencyThreads_;
 };
 
 }
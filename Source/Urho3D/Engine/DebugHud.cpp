@@ -20,16 +20,28 @@
 // THE SOFTWARE.
 //
 
+#include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Engine/DebugHud.h"
 #include "../Engine/Engine.h"
 #include "../UI/Font.h"
 #include "../Graphics/Graphics.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Core/MemoryTracker.h"
+#include "../Core/ObjectPool.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/Renderer.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Scene.h"
+#include "../Container/Sort.h"
 #include "../UI/Text.h"
 #include "../UI/UI.h"
+#ifdef URHO3D_NETWORK
+#include "../Network/Network.h"
+#include "../Network/Protocol.h"
+#endif
 
 #include "../DebugNew.h"
 
@@ -51,13 +63,115 @@ static const char* shadowQualityTexts[] =
     "24bit High"
 };
 
+/// Number of most recent frame times shown in the histogram.
+static const unsigned FRAMETIME_HISTORY_FRAMES = 300;
+/// Default number of most recent frames included in a hitch report.
+static const unsigned DEFAULT_HITCH_FRAMES = 30;
+/// Number of frame time histogram bins.
+static const unsigned NUM_FRAMETIME_BINS = 6;
+/// Upper limits of the frame time histogram bins in milliseconds. The last bin is unlimited.
+static const float frameTimeBinLimits[NUM_FRAMETIME_BINS - 1] =
+{
+    8.333f,
+    16.667f,
+    33.333f,
+    50.0f,
+    100.0f
+};
+/// Frame time histogram bin labels.
+static const char* frameTimeBinNames[NUM_FRAMETIME_BINS] =
+{
+    "< 8.3 ms",
+    "< 16.7 ms",
+    "< 33.3 ms",
+    "< 50 ms",
+    "< 100 ms",
+    ">= 100 ms"
+};
+/// Maximum length of a frame time histogram bar.
+static const unsigned MAX_FRAMETIME_BAR_LENGTH = 40;
+
+/// Return total tracked memory allocations of all tags.
+static long long GetTotalAllocations()
+{
+    long long allocations = 0;
+    for (unsigned i = 0; i < MAX_MEMORY_TAGS; ++i)
+        allocations += MemoryTracker::GetStats((MemoryTag)i).totalAllocations_;
+    return allocations;
+}
+
+#ifdef URHO3D_NETWORK
+static const char* networkMessageNames[] =
+{
+    "Identity",
+    "Controls",
+    "SceneLoaded",
+    "RequestPackage",
+    "PackageData",
+    "LoadScene",
+    "SceneChecksumError",
+    "CreateNode",
+    "NodeDeltaUpdate",
+    "NodeLatestData",
+    "RemoveNode",
+    "CreateComponent",
+    "ComponentDeltaUpdate",
+    "ComponentLatestData",
+    "RemoveComponent",
+    "RemoteEvent",
+    "RemoteNodeEvent",
+    "PackageInfo",
+    "CreateNodes"
+};
+
+/// Maximum number of nodes and component types to list in the network traffic text.
+static const unsigned MAX_NETWORK_TRAFFIC_ENTRIES = 8;
+
+/// Named traffic counters for sorting.
+struct TrafficEntry
+{
+    /// Name to display.
+    String name_;
+    /// Counters.
+    TrafficStats stats_;
+};
+
+static bool CompareTrafficEntries(const TrafficEntry& lhs, const TrafficEntry& rhs)
+{
+    return lhs.stats_.bytesSent_ + lhs.stats_.bytesReceived_ > rhs.stats_.bytesSent_ + rhs.stats_.bytesReceived_;
+}
+
+static void AppendTrafficEntries(String& dest, Vector<TrafficEntry>& entries, unsigned maxEntries)
+{
+    Sort(entries.Begin(), entries.End(), CompareTrafficEntries);
+    for (unsigned i = 0; i < entries.Size() && i < maxEntries; ++i)
+    {
+        const TrafficStats& stats = entries[i].stats_;
+        dest.AppendWithFormat("%-24s %7u %9.1f %7u %9.1f\n", entries[i].name_.Substring(0, 24).CString(), stats.messagesSent_,
+            stats.bytesSent_ / 1024.0f, stats.messagesReceived_, stats.bytesReceived_ / 1024.0f);
+    }
+}
+#endif
+
 DebugHud::DebugHud(Context* context) :
     Object(context),
     profilerMaxDepth_(M_MAX_UNSIGNED),
     profilerInterval_(1000),
     useRendererStats_(false),
-    mode_(DEBUGHUD_SHOW_NONE)
+    mode_(DEBUGHUD_SHOW_NONE),
+    frameTimeIndex_(0),
+    numFrameTimes_(0),
+    hitchStatsIndex_(0),
+    numHitchStats_(0),
+    hitchFileName_("Hitches.txt"),
+    hitchThreshold_(0.0f),
+    hitchCooldown_(0),
+    numHitches_(0),
+    lastAllocations_(0)
 {
+    frameTimes_.Resize(FRAMETIME_HISTORY_FRAMES);
+    hitchStats_.Resize(DEFAULT_HITCH_FRAMES);
+
     UI* ui = GetSubsystem<UI>();
     UIElement* uiRoot = ui->GetRoot();
 
@@ -79,6 +193,24 @@ DebugHud::DebugHud(Context* context) :
     profilerText_->SetVisible(false);
     uiRoot->AddChild(profilerText_);
 
+    memoryText_ = new Text(context_);
+    memoryText_->SetAlignment(HA_RIGHT, VA_BOTTOM);
+    memoryText_->SetPriority(100);
+    memoryText_->SetVisible(false);
+    uiRoot->AddChild(memoryText_);
+
+    networkText_ = new Text(context_);
+    networkText_->SetAlignment(HA_CENTER, VA_TOP);
+    networkText_->SetPriority(100);
+    networkText_->SetVisible(false);
+    uiRoot->AddChild(networkText_);
+
+    frameTimeText_ = new Text(context_);
+    frameTimeText_->SetAlignment(HA_LEFT, VA_CENTER);
+    frameTimeText_->SetPriority(100);
+    frameTimeText_->SetVisible(false);
+    uiRoot->AddChild(frameTimeText_);
+
     SubscribeToEvent(E_POSTUPDATE, HANDLER(DebugHud, HandlePostUpdate));
 }
 
@@ -87,6 +219,16 @@ DebugHud::~DebugHud()
     statsText_->Remove();
     modeText_->Remove();
     profilerText_->Remove();
+    memoryText_->Remove();
+    networkText_->Remove();
+    frameTimeText_->Remove();
+
+    if (hitchThreshold_ > 0.0f)
+    {
+        Profiler* profiler = GetSubsystem<Profiler>();
+        if (profiler)
+            profiler->SetFrameHistorySize(0);
+    }
 }
 
 void DebugHud::Update()
@@ -104,26 +246,39 @@ void DebugHud::Update()
         uiRoot->AddChild(statsText_);
         uiRoot->AddChild(modeText_);
         uiRoot->AddChild(profilerText_);
+        uiRoot->AddChild(memoryText_);
+        uiRoot->AddChild(networkText_);
+        uiRoot->AddChild(frameTimeText_);
     }
 
     if (statsText_->IsVisible())
     {
-        unsigned primitives, batches;
+        unsigned primitives, batches, stateChanges, avoidedStateChanges, parameterBytes;
         if (!useRendererStats_)
         {
             primitives = graphics->GetNumPrimitives();
             batches = graphics->GetNumBatches();
+            stateChanges = graphics->GetNumStateChanges();
+            avoidedStateChanges = graphics->GetNumAvoidedStateChanges();
+            parameterBytes = graphics->GetNumParameterBytes();
         }
         else
         {
             primitives = renderer->GetNumPrimitives();
             batches = renderer->GetNumBatches();
+            stateChanges = renderer->GetNumStateChanges();
+            avoidedStateChanges = renderer->GetNumAvoidedStateChanges();
+            parameterBytes = renderer->GetNumParameterBytes();
         }
 
         String stats;
-        stats.AppendWithFormat("Triangles %u\nBatches %u\nViews %u\nLights %u\nShadowmaps %u\nOccluders %u",
+        stats.AppendWithFormat("Triangles %u\nBatches %u\nState changes %u\nAvoided changes %u\nParameter bytes %u\n"
+            "Views %u\nLights %u\nShadowmaps %u\nOccluders %u",
             primitives,
             batches,
+            stateChanges,
+            avoidedStateChanges,
+            parameterBytes,
             renderer->GetNumViews(),
             renderer->GetNumLights(true),
             renderer->GetNumShadowMaps(true),
@@ -166,12 +321,59 @@ void DebugHud::Update()
             if (profilerText_->IsVisible())
             {
                 String profilerOutput = profiler->GetData(false, false, profilerMaxDepth_);
+                
+                // Append the GPU timings of the most recent frame that has finished on the GPU
+                if (graphics->GetGPUProfiling())
+                {
+                    const Vector<GPUProfileBlock>& gpuBlocks = graphics->GetGPUProfileResults();
+                    
+                    profilerOutput.Append("\nGPU block                            Time (ms)\n\n");
+                    for (Vector<GPUProfileBlock>::ConstIterator i = gpuBlocks.Begin(); i != gpuBlocks.End(); ++i)
+                    {
+                        if (i->depth_ >= profilerMaxDepth_)
+                            continue;
+                        
+                        String indentedName = String(' ', i->depth_ * 2) + i->name_;
+                        if (indentedName.Length() > 36)
+                            indentedName = indentedName.Substring(0, 36);
+                        profilerOutput.AppendWithFormat("%-36s %9.3f\n", indentedName.CString(), i->time_);
+                    }
+                }
+                
                 profilerText_->SetText(profilerOutput);
             }
 
             profiler->BeginInterval();
         }
     }
+
+    if (memoryText_->IsVisible())
+    {
+        String memory;
+        if (MemoryTracker::IsEnabled())
+        {
+            memory.AppendWithFormat("%-12s %10s %10s %10s\n\n", "Memory tag", "Live KB", "Peak KB", "Allocs");
+            for (unsigned i = 0; i < MAX_MEMORY_TAGS; ++i)
+            {
+                MemoryTagStats stats = MemoryTracker::GetStats((MemoryTag)i);
+                memory.AppendWithFormat("%-12s %10u %10u %10u\n", MemoryTracker::GetTagName((MemoryTag)i),
+                    (unsigned)(stats.liveBytes_ / 1024), (unsigned)(stats.peakBytes_ / 1024), (unsigned)stats.liveAllocations_);
+            }
+            memory.Append("\n");
+        }
+
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+        memory.AppendWithFormat("Resources KB %u\nPooled objects %u\nPool reserved KB %u", cache->GetTotalMemoryUse() / 1024,
+            ObjectPool::GetNumAllocated(), ObjectPool::GetReservedMemory() / 1024);
+
+        memoryText_->SetText(memory);
+    }
+
+    if (networkText_->IsVisible())
+        UpdateNetworkText();
+
+    if (frameTimeText_->IsVisible())
+        UpdateFrameTimeText();
 }
 
 void DebugHud::SetDefaultStyle(XMLFile* style)
@@ -185,6 +387,12 @@ void DebugHud::SetDefaultStyle(XMLFile* style)
     modeText_->SetStyle("DebugHudText");
     profilerText_->SetDefaultStyle(style);
     profilerText_->SetStyle("DebugHudText");
+    memoryText_->SetDefaultStyle(style);
+    memoryText_->SetStyle("DebugHudText");
+    networkText_->SetDefaultStyle(style);
+    networkText_->SetStyle("DebugHudText");
+    frameTimeText_->SetDefaultStyle(style);
+    frameTimeText_->SetStyle("DebugHudText");
 }
 
 void DebugHud::SetMode(unsigned mode)
@@ -192,6 +400,9 @@ void DebugHud::SetMode(unsigned mode)
     statsText_->SetVisible((mode & DEBUGHUD_SHOW_STATS) != 0);
     modeText_->SetVisible((mode & DEBUGHUD_SHOW_MODE) != 0);
     profilerText_->SetVisible((mode & DEBUGHUD_SHOW_PROFILER) != 0);
+    memoryText_->SetVisible((mode & DEBUGHUD_SHOW_MEMORY) != 0);
+    networkText_->SetVisible((mode & DEBUGHUD_SHOW_NETWORK) != 0);
+    frameTimeText_->SetVisible((mode & DEBUGHUD_SHOW_FRAMETIME) != 0);
 
     mode_ = mode;
 }
@@ -211,6 +422,27 @@ void DebugHud::SetUseRendererStats(bool enable)
     useRendererStats_ = enable;
 }
 
+void DebugHud::SetHitchThreshold(float ms)
+{
+    hitchThreshold_ = Max(ms, 0.0f);
+    numHitchStats_ = 0;
+    lastAllocations_ = GetTotalAllocations();
+    UpdateProfilerFrameHistory();
+}
+
+void DebugHud::SetHitchFrames(unsigned frames)
+{
+    hitchStats_.Resize(Max((int)frames, 1));
+    hitchStatsIndex_ = 0;
+    numHitchStats_ = 0;
+    UpdateProfilerFrameHistory();
+}
+
+void DebugHud::SetHitchFileName(const String& fileName)
+{
+    hitchFileName_ = fileName;
+}
+
 void DebugHud::Toggle(unsigned mode)
 {
     SetMode(GetMode() ^ mode);
@@ -254,10 +486,224 @@ void DebugHud::ClearAppStats()
     appStats_.Clear();
 }
 
+void DebugHud::UpdateNetworkText()
+{
+#ifdef URHO3D_NETWORK
+    Network* network = GetSubsystem<Network>();
+    if (!network)
+    {
+        networkText_->SetText("No network subsystem");
+        return;
+    }
+
+    // On the client show the server connection, on the server the sum of all client connections
+    Vector<SharedPtr<Connection> > connections;
+    if (network->GetServerConnection())
+        connections.Push(SharedPtr<Connection>(network->GetServerConnection()));
+    else
+        connections = network->GetClientConnections();
+
+    HashMap<int, TrafficStats> messages;
+    HashMap<unsigned, TrafficStats> nodes;
+    HashMap<StringHash, TrafficStats> components;
+    Scene* scene = 0;
+
+    for (unsigned i = 0; i < connections.Size(); ++i)
+    {
+        Connection* connection = connections[i];
+        // Start counting once the traffic is shown
+        connection->SetTrafficProfiling(true);
+        if (!scene)
+            scene = connection->GetScene();
+
+        const HashMap<int, TrafficStats>& connMessages = connection->GetMessageTraffic();
+        for (HashMap<int, TrafficStats>::ConstIterator j = connMessages.Begin(); j != connMessages.End(); ++j)
+            messages[j->first_].Add(j->second_);
+        const HashMap<unsigned, TrafficStats>& connNodes = connection->GetNodeTraffic();
+        for (HashMap<unsigned, TrafficStats>::ConstIterator j = connNodes.Begin(); j != connNodes.End(); ++j)
+            nodes[j->first_].Add(j->second_);
+        const HashMap<StringHash, TrafficStats>& connComponents = connection->GetComponentTraffic();
+        for (HashMap<StringHash, TrafficStats>::ConstIterator j = connComponents.Begin(); j != connComponents.End(); ++j)
+            components[j->first_].Add(j->second_);
+    }
+
+    String traffic;
+    traffic.AppendWithFormat("%-24s %7s %9s %7s %9s\n\n", "Network message", "Sent", "Sent KB", "Recv", "Recv KB");
+
+    messages.Sort();
+    TrafficStats total;
+    for (HashMap<int, TrafficStats>::ConstIterator i = messages.Begin(); i != messages.End(); ++i)
+    {
+        const TrafficStats& stats = i->second_;
+        String name = i->first_ >= MSG_IDENTITY && i->first_ <= MSG_CREATENODES ? String(networkMessageNames[i->first_ -
+            MSG_IDENTITY]) : ToString("Message 0x%x", i->first_);
+        traffic.AppendWithFormat("%-24s %7u %9.1f %7u %9.1f\n", name.CString(), stats.messagesSent_, stats.bytesSent_ / 1024.0f,
+            stats.messagesReceived_, stats.bytesReceived_ / 1024.0f);
+        total.Add(stats);
+    }
+    traffic.AppendWithFormat("%-24s %7u %9.1f %7u %9.1f\n", "Total", total.messagesSent_, total.bytesSent_ / 1024.0f,
+        total.messagesReceived_, total.bytesReceived_ / 1024.0f);
+
+    Vector<TrafficEntry> entries;
+    for (HashMap<StringHash, TrafficStats>::ConstIterator i = components.Begin(); i != components.End(); ++i)
+    {
+        TrafficEntry entry;
+        entry.name_ = context_->GetTypeName(i->first_);
+        if (entry.name_.Empty())
+            entry.name_ = i->first_.ToString();
+        entry.stats_ = i->second_;
+        entries.Push(entry);
+    }
+    traffic.AppendWithFormat("\n%-24s %7s %9s %7s %9s\n\n", "Component type", "Sent", "Sent KB", "Recv", "Recv KB");
+    AppendTrafficEntries(traffic, entries, MAX_NETWORK_TRAFFIC_ENTRIES);
+
+    entries.Clear();
+    for (HashMap<unsigned, TrafficStats>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        TrafficEntry entry;
+        Node* node = scene ? scene->GetNode(i->first_) : 0;
+        entry.name_ = node && !node->GetName().Empty() ? node->GetName() + " " + String(i->first_) : "Node " + String(i->first_);
+        entry.stats_ = i->second_;
+        entries.Push(entry);
+    }
+    traffic.AppendWithFormat("\n%-24s %7s %9s %7s %9s\n\n", "Node", "Sent", "Sent KB", "Recv", "Recv KB");
+    AppendTrafficEntries(traffic, entries, MAX_NETWORK_TRAFFIC_ENTRIES);
+
+    networkText_->SetText(traffic);
+#else
+    networkText_->SetText("Network support not enabled");
+#endif
+}
+
+void DebugHud::UpdateFrameTimeText()
+{
+    unsigned bins[NUM_FRAMETIME_BINS];
+    for (unsigned i = 0; i < NUM_FRAMETIME_BINS; ++i)
+        bins[i] = 0;
+
+    float totalTime = 0.0f;
+    float maxTime = 0.0f;
+    for (unsigned i = 0; i < numFrameTimes_; ++i)
+    {
+        float time = frameTimes_[i];
+        unsigned bin = 0;
+        while (bin < NUM_FRAMETIME_BINS - 1 && time >= frameTimeBinLimits[bin])
+            ++bin;
+        ++bins[bin];
+        totalTime += time;
+        maxTime = Max(maxTime, time);
+    }
+
+    unsigned maxCount = 1;
+    for (unsigned i = 0; i < NUM_FRAMETIME_BINS; ++i)
+        maxCount = Max((int)maxCount, (int)bins[i]);
+
+    String histogram;
+    histogram.AppendWithFormat("Frame time %u frames\nAvg %.3f ms Max %.3f ms\n\n", numFrameTimes_, numFrameTimes_ ?
+        totalTime / numFrameTimes_ : 0.0f, maxTime);
+    for (unsigned i = 0; i < NUM_FRAMETIME_BINS; ++i)
+    {
+        unsigned length = bins[i] * MAX_FRAMETIME_BAR_LENGTH / maxCount;
+        if (bins[i] && !length)
+            length = 1;
+        histogram.AppendWithFormat("%-10s %5u %s\n", frameTimeBinNames[i], bins[i], String('#', length).CString());
+    }
+    if (hitchThreshold_ > 0.0f)
+        histogram.AppendWithFormat("\nHitches %u", numHitches_);
+
+    frameTimeText_->SetText(histogram);
+}
+
+void DebugHud::RecordFrame()
+{
+    // Measure the frame time directly, as the engine's time step is smoothed and clamped to the minimum FPS
+    float frameTime = frameTimer_.GetUSec(true) / 1000.0f;
+
+    frameTimes_[frameTimeIndex_] = frameTime;
+    frameTimeIndex_ = (frameTimeIndex_ + 1) % frameTimes_.Size();
+    if (numFrameTimes_ < frameTimes_.Size())
+        ++numFrameTimes_;
+
+    if (hitchThreshold_ <= 0.0f)
+        return;
+
+    long long allocations = GetTotalAllocations();
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    HitchFrameStats& stats = hitchStats_[hitchStatsIndex_];
+    stats.frameTime_ = frameTime;
+    stats.allocations_ = (unsigned)(allocations - lastAllocations_);
+    stats.resourceMemory_ = cache ? cache->GetTotalMemoryUse() : 0;
+    stats.backgroundLoads_ = cache ? cache->GetNumBackgroundLoadResources() : 0;
+    stats.pooledObjects_ = ObjectPool::GetNumAllocated();
+    lastAllocations_ = allocations;
+
+    hitchStatsIndex_ = (hitchStatsIndex_ + 1) % hitchStats_.Size();
+    if (numHitchStats_ < hitchStats_.Size())
+        ++numHitchStats_;
+
+    // Skip the frames already included in the previous report, which also skips the stall caused by writing it
+    if (hitchCooldown_)
+        --hitchCooldown_;
+    else if (frameTime >= hitchThreshold_)
+    {
+        ++numHitches_;
+        SaveHitchReport(frameTime);
+        hitchCooldown_ = hitchStats_.Size();
+    }
+}
+
+void DebugHud::SaveHitchReport(float frameTime)
+{
+    String report;
+    report.AppendWithFormat("Hitch %u: frame time %.3f ms, threshold %.3f ms\n\n", numHitches_, frameTime, hitchThreshold_);
+    report.AppendWithFormat("%-8s %10s %10s %12s %10s %10s\n\n", "Frame", "Time ms", "Allocs", "Resources KB", "Bg loads",
+        "Pooled");
+
+    unsigned historySize = hitchStats_.Size();
+    for (unsigned i = 0; i < numHitchStats_; ++i)
+    {
+        const HitchFrameStats& stats = hitchStats_[(hitchStatsIndex_ + historySize - numHitchStats_ + i) % historySize];
+        report.AppendWithFormat("%-8d %10.3f %10u %12u %10u %10u\n", (int)i - (int)numHitchStats_ + 1, stats.frameTime_,
+            stats.allocations_, stats.resourceMemory_ / 1024, stats.backgroundLoads_, stats.pooledObjects_);
+    }
+    if (!MemoryTracker::IsEnabled())
+        report.Append("\nAllocation counts require URHO3D_MEMORY_TRACKING\n");
+    report.Append("\n");
+
+    Profiler* profiler = GetSubsystem<Profiler>();
+    if (profiler)
+        report.Append(profiler->GetFrameHistoryData());
+    else
+        report.Append("Block timings require URHO3D_PROFILING\n\n");
+
+    // Append to the existing reports
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    File file(context_);
+    bool opened = fileSystem && fileSystem->FileExists(hitchFileName_) ? file.Open(hitchFileName_, FILE_READWRITE) :
+        file.Open(hitchFileName_, FILE_WRITE);
+    if (!opened)
+    {
+        LOGERROR("Could not open hitch file " + hitchFileName_);
+        return;
+    }
+
+    file.Seek(file.GetSize());
+    file.Write(report.CString(), report.Length());
+    LOGWARNING("Frame time " + String(frameTime) + " ms exceeded the hitch threshold, appended report to " + hitchFileName_);
+}
+
+void DebugHud::UpdateProfilerFrameHistory()
+{
+    Profiler* profiler = GetSubsystem<Profiler>();
+    if (profiler)
+        profiler->SetFrameHistorySize(hitchThreshold_ > 0.0f ? hitchStats_.Size() : 0);
+}
+
 void DebugHud::HandlePostUpdate(StringHash eventType, VariantMap& eventData)
 {
     using namespace PostUpdate;
 
+    RecordFrame();
     Update();
 }
 
@@ -37,7 +37,25 @@ static const unsigned DEBUGHUD_SHOW_NONE = 0x0;
 static const unsigned DEBUGHUD_SHOW_STATS = 0x1;
 static const unsigned DEBUGHUD_SHOW_MODE = 0x2;
 static const unsigned DEBUGHUD_SHOW_PROFILER = 0x4;
-static const unsigned DEBUGHUD_SHOW_ALL = 0x7;
+static const unsigned DEBUGHUD_SHOW_MEMORY = 0x8;
+static const unsigned DEBUGHUD_SHOW_NETWORK = 0x10;
+static const unsigned DEBUGHUD_SHOW_FRAMETIME = 0x20;
+static const unsigned DEBUGHUD_SHOW_ALL = 0x3f;
+
+/// Per-frame counters recorded for hitch reports.
+struct HitchFrameStats
+{
+    /// Frame time in milliseconds.
+    float frameTime_;
+    /// Tracked memory allocations made during the frame.
+    unsigned allocations_;
+    /// Resource memory use in bytes.
+    unsigned resourceMemory_;
+    /// Resources queued for background loading.
+    unsigned backgroundLoads_;
+    /// Allocated pooled objects.
+    unsigned pooledObjects_;
+};
 
 /// Displays rendering stats and profiling information.
 class URHO3D_API DebugHud : public Object
@@ -62,6 +80,12 @@ public:
     void SetProfilerInterval(float interval);
     /// Set whether to show 3D geometry primitive/batch count only. Default false.
     void SetUseRendererStats(bool enable);
+    /// Set frame time in milliseconds above which a hitch report is appended to the hitch file. Zero (default) disables hitch detection.
+    void SetHitchThreshold(float ms);
+    /// Set number of most recent frames included in a hitch report. Default 30.
+    void SetHitchFrames(unsigned frames);
+    /// Set file name hitch reports are appended to.
+    void SetHitchFileName(const String& fileName);
     /// Toggle elements.
     void Toggle(unsigned mode);
     /// Toggle all elements.
@@ -75,6 +99,12 @@ public:
     Text* GetModeText() const { return modeText_; }
     /// Return profiler text.
     Text* GetProfilerText() const { return profilerText_; }
+    /// Return memory use text.
+    Text* GetMemoryText() const { return memoryText_; }
+    /// Return network traffic text.
+    Text* GetNetworkText() const { return networkText_; }
+    /// Return frame time histogram text.
+    Text* GetFrameTimeText() const { return frameTimeText_; }
     /// Return currently shown elements.
     unsigned GetMode() const { return mode_; }
     /// Return maximum profiler block depth.
@@ -84,6 +114,14 @@ public:
 
     /// Return whether showing 3D geometry primitive/batch count only.
     bool GetUseRendererStats() const { return useRendererStats_; }
+    /// Return hitch detection frame time threshold in milliseconds.
+    float GetHitchThreshold() const { return hitchThreshold_; }
+    /// Return number of most recent frames included in a hitch report.
+    unsigned GetHitchFrames() const { return hitchStats_.Size(); }
+    /// Return file name hitch reports are appended to.
+    const String& GetHitchFileName() const { return hitchFileName_; }
+    /// Return number of hitches detected.
+    unsigned GetNumHitches() const { return numHitches_; }
     /// Set application-specific stats.
     void SetAppStats(const String& label, const Variant& stats);
     /// Set application-specific stats.
@@ -96,6 +134,16 @@ public:
 private:
     /// Handle logic post-update event. The HUD texts are updated here.
     void HandlePostUpdate(StringHash eventType, VariantMap& eventData);
+    /// Update the network traffic text.
+    void UpdateNetworkText();
+    /// Update the frame time histogram text.
+    void UpdateFrameTimeText();
+    /// Record the time and counters of the frame that ended, and detect hitches.
+    void RecordFrame();
+    /// Append a hitch report of the recorded frames to the hitch file.
+    void SaveHitchReport(float frameTime);
+    /// Size the profiler frame history for the hitch reports.
+    void UpdateProfilerFrameHistory();
 
     /// Rendering stats text.
     SharedPtr<Text> statsText_;
@@ -103,6 +151,12 @@ private:
     SharedPtr<Text> modeText_;
     /// Profiling information text.
     SharedPtr<Text> profilerText_;
+    /// Memory use text.
+    SharedPtr<Text> memoryText_;
+    /// Network traffic text.
+    SharedPtr<Text> networkText_;
+    /// Frame time histogram text.
+    SharedPtr<Text> frameTimeText_;
     /// Hashmap containing application specific stats.
     HashMap<String, String> appStats_;
     /// Profiler timer.
@@ -115,6 +169,30 @@ private:
     bool useRendererStats_;
     /// Current shown-element mode.
     unsigned mode_;
+    /// Timer for measuring the unsmoothed frame time.
+    HiresTimer frameTimer_;
+    /// Frame time ring buffer for the histogram, in milliseconds.
+    PODVector<float> frameTimes_;
+    /// Next frame time to write.
+    unsigned frameTimeIndex_;
+    /// Number of recorded frame times.
+    unsigned numFrameTimes_;
+    /// Hitch report frame counters ring buffer.
+    PODVector<HitchFrameStats> hitchStats_;
+    /// Next hitch report frame counters to write.
+    unsigned hitchStatsIndex_;
+    /// Number of recorded hitch report frames.
+    unsigned numHitchStats_;
+    /// Hitch file name.
+    String hitchFileName_;
+    /// Hitch detection threshold in milliseconds.
+    float hitchThreshold_;
+    /// Frames left before detecting the next hitch.
+    unsigned hitchCooldown_;
+    /// Number of hitches detected.
+    unsigned numHitches_;
+    /// Total tracked memory allocations on the previous frame.
+    long long lastAllocations_;
 };
 
 }
@@ -31,11 +31,13 @@
 #include "../Input/Input.h"
 #include "../Input/InputEvents.h"
 #include "../IO/Log.h"
+#include "../Core/MemoryTracker.h"
 #ifdef URHO3D_NAVIGATION
 #include "../Navigation/NavigationMesh.h"
 #endif
 #ifdef URHO3D_NETWORK
 #include "../Network/Network.h"
+#include "../Network/ProfilerServer.h"
 #endif
 #include "../IO/PackageFile.h"
 #ifdef URHO3D_PHYSICS
@@ -82,18 +84,63 @@ namespace Urho3D
 
 extern const char* logLevelPrefixes[];
 
+/// Lag behind the fixed tick schedule after which the missed ticks are skipped.
+static const long long MAX_TICK_LAG_USEC = 250000;
+/// Longest oversleep that the frame limiter compensates by spinning.
+static const long long MAX_SLEEP_OVERSHOOT_USEC = 2000;
+
+/// Functor for reading the directories of the resource packages in the worker threads.
+struct PackageFileOpener
+{
+    /// Construct.
+    PackageFileOpener(const Vector<String>& fileNames, PackageFile** begin) :
+        fileNames_(fileNames),
+        begin_(begin)
+    {
+    }
+
+    /// Open the packages of a range.
+    void operator () (PackageFile** start, PackageFile** end, unsigned threadIndex)
+    {
+        for (PackageFile** i = start; i < end; ++i)
+            (*i)->Open(fileNames_[(unsigned)(i - begin_)]);
+    }
+
+    /// Package file names.
+    const Vector<String>& fileNames_;
+    /// Start of the package range.
+    PackageFile** begin_;
+};
+
+/// Add a resource package to the resource cache, using the already opened package if available.
+static bool AddPackageFile(ResourceCache* cache, const HashMap<String, SharedPtr<PackageFile> >& packages, const String& fileName)
+{
+    HashMap<String, SharedPtr<PackageFile> >::ConstIterator i = packages.Find(fileName);
+    if (i != packages.End())
+        return cache->AddPackageFile(i->second_);
+    else
+        return cache->AddPackageFile(fileName);
+}
+
 Engine::Engine(Context* context) :
     Object(context),
+    nextTickTime_(0),
+    sleepOvershoot_(0),
     timeStep_(0.0f),
     timeStepSmoothing_(2),
     minFps_(10),
     #if defined(ANDROID) || defined(IOS) || defined(RPI)
     maxFps_(60),
     maxInactiveFps_(10),
-    pauseMinimized_(true),
     #else
     maxFps_(200),
     maxInactiveFps_(60),
+    #endif
+    tickRate_(0),
+    skippedTicks_(0),
+    #if defined(ANDROID) || defined(IOS) || defined(RPI)
+    pauseMinimized_(true),
+    #else
     pauseMinimized_(false),
     #endif
 #ifdef URHO3D_TESTING
@@ -120,7 +167,8 @@ Engine::Engine(Context* context) :
     #endif
     context_->RegisterSubsystem(new ResourceCache(context_));
     #ifdef URHO3D_NETWORK
-    context_->RegisterSubsystem(new Network(context_));
+    // The network subsystem is created on first access, as many applications never use it
+    context_->RegisterLazySubsystem<Network>();
     #endif
     context_->RegisterSubsystem(new Input(context_));
     context_->RegisterSubsystem(new Audio(context_));
@@ -137,6 +185,10 @@ Engine::Engine(Context* context) :
     RegisterNavigationLibrary(context_);
 #endif
 
+#ifdef URHO3D_NETWORK
+    RegisterNetworkLibrary(context_);
+#endif
+
     SubscribeToEvent(E_EXITREQUESTED, HANDLER(Engine, HandleExitRequested));
 }
 
@@ -178,7 +230,9 @@ bool Engine::Initialize(const VariantMap& parameters)
         if (HasParameter(parameters, "LogLevel"))
             log->SetLevel(GetParameter(parameters, "LogLevel").GetInt());
         log->SetQuiet(GetParameter(parameters, "LogQuiet", false).GetBool());
+        log->SetAsync(GetParameter(parameters, "LogAsync", false).GetBool());
         log->Open(GetParameter(parameters, "LogName", "Urho3D.log").GetString());
+        log->OpenBinary(GetParameter(parameters, "BinaryLogName", String::EMPTY).GetString());
     }
 
     // Set maximally accurate low res timer
@@ -187,15 +241,28 @@ bool Engine::Initialize(const VariantMap& parameters)
     // Configure max FPS
     if (GetParameter(parameters, "FrameLimiter", true) == false)
         SetMaxFps(0);
+    
+    // Configure fixed tick rate, typically for a headless server
+    if (HasParameter(parameters, "TickRate"))
+        SetTickRate(GetParameter(parameters, "TickRate").GetInt());
 
     // Set amount of worker threads according to the available physical CPU cores. Using also hyperthreaded cores results in
     // unpredictable extra synchronization overhead. Also reserve one core for the main thread
     unsigned numThreads = GetParameter(parameters, "WorkerThreads", true).GetBool() ? GetNumPhysicalCPUs() - 1 : 0;
+    // CPUs reserved for other threads, such as audio or networking, do not get worker threads either
+    unsigned numReservedCPUs = (unsigned)Max(GetParameter(parameters, "ReservedCPUs", 0).GetInt(), 0);
+    numThreads = numThreads > numReservedCPUs ? numThreads - numReservedCPUs : 0;
     if (numThreads)
     {
-        GetSubsystem<WorkQueue>()->CreateThreads(numThreads);
-
-        LOGINFOF("Created %u worker thread%s", numThreads, numThreads > 1 ? "s" : "");
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        queue->SetWorkStealing(GetParameter(parameters, "WorkStealing", false).GetBool());
+        queue->SetThreadAffinity(GetParameter(parameters, "ThreadAffinity", false).GetBool());
+        queue->SetNumReservedCPUs(numReservedCPUs);
+        queue->CreateThreads(numThreads);
+
+        numThreads = queue->GetNumThreads();
+        if (numThreads)
+            LOGINFOF("Created %u worker thread%s", numThreads, numThreads > 1 ? "s" : "");
     }
 
     // Add resource paths
@@ -211,6 +278,54 @@ bool Engine::Initialize(const VariantMap& parameters)
     Vector<String> resourcePackages = GetParameter(parameters, "ResourcePackages").GetString().Split(';');
     Vector<String> autoLoadPaths = GetParameter(parameters, "AutoloadPaths", "Autoload").GetString().Split(';');
 
+    // Collect the package files first and read their directories in the worker threads, as opening them is mostly waiting
+    // for file I/O. They are still added to the resource cache in the configured order below
+    Vector<String> packageNames;
+    for (unsigned i = 0; i < resourcePaths.Size(); ++i)
+    {
+        if (!IsAbsolutePath(resourcePaths[i]))
+            packageNames.Push(resourcePrefixPath + resourcePaths[i] + ".pak");
+    }
+    for (unsigned i = 0; i < resourcePackages.Size(); ++i)
+        packageNames.Push(resourcePrefixPath + resourcePackages[i]);
+
+    Vector<Vector<String> > autoLoadPaks(autoLoadPaths.Size());
+    for (unsigned i = 0; i < autoLoadPaths.Size(); ++i)
+    {
+        String autoLoadPath(autoLoadPaths[i]);
+        if (!IsAbsolutePath(autoLoadPath))
+            autoLoadPath = resourcePrefixPath + autoLoadPath;
+
+        if (fileSystem->DirExists(autoLoadPath))
+        {
+            fileSystem->ScanDir(autoLoadPaks[i], autoLoadPath, "*.pak", SCAN_FILES, false);
+            for (unsigned y = 0; y < autoLoadPaks[i].Size(); ++y)
+            {
+                if (!autoLoadPaks[i][y].StartsWith("."))
+                    packageNames.Push(autoLoadPath + "/" + autoLoadPaks[i][y]);
+            }
+        }
+    }
+
+    HashMap<String, SharedPtr<PackageFile> > packages;
+    {
+        Vector<String> openNames;
+        PODVector<PackageFile*> openPackages;
+        for (unsigned i = 0; i < packageNames.Size(); ++i)
+        {
+            if (!packages.Contains(packageNames[i]) && fileSystem->FileExists(packageNames[i]))
+            {
+                PackageFile* package = new PackageFile(context_);
+                packages[packageNames[i]] = package;
+                openNames.Push(packageNames[i]);
+                openPackages.Push(package);
+            }
+        }
+
+        PackageFileOpener opener(openNames, openPackages.Begin().ptr_);
+        GetSubsystem<WorkQueue>()->ParallelFor(openPackages, 1, opener);
+    }
+
     for (unsigned i = 0; i < resourcePaths.Size(); ++i)
     {
         bool success = false;
@@ -220,7 +335,7 @@ bool Engine::Initialize(const VariantMap& parameters)
         {
             String packageName = resourcePrefixPath + resourcePaths[i] + ".pak";
             if (fileSystem->FileExists(packageName))
-                success = cache->AddPackageFile(packageName);
+                success = AddPackageFile(cache, packages, packageName);
 
             if (!success)
             {
@@ -249,7 +364,7 @@ bool Engine::Initialize(const VariantMap& parameters)
         String packageName = resourcePrefixPath + resourcePackages[i];
         if (fileSystem->FileExists(packageName))
         {
-            if (!cache->AddPackageFile(packageName))
+            if (!AddPackageFile(cache, packages, packageName))
             {
                 LOGERRORF("Failed to add resource package '%s', check the documentation on how to set the 'resource prefix path'", resourcePackages[i].CString());
                 return false;
@@ -286,8 +401,7 @@ bool Engine::Initialize(const VariantMap& parameters)
             }
 
             // Add all the found package files (non-recursive)
-            Vector<String> paks;
-            fileSystem->ScanDir(paks, autoLoadPath, "*.pak", SCAN_FILES, false);
+            const Vector<String>& paks = autoLoadPaks[i];
             for (unsigned y = 0; y < paks.Size(); ++y)
             {
                 String pak = paks[y];
@@ -295,7 +409,7 @@ bool Engine::Initialize(const VariantMap& parameters)
                     continue;
 
                 String autoPackageName = autoLoadPath + "/" + pak;
-                if (!cache->AddPackageFile(autoPackageName, 0))
+                if (!AddPackageFile(cache, packages, autoPackageName))
                 {
                     LOGERRORF("Failed to add package file '%s' in autoload path %s, check the documentation on how to set the 'resource prefix path'", pak.CString(), autoLoadPaths[i].CString());
                     return false;
@@ -317,6 +431,10 @@ bool Engine::Initialize(const VariantMap& parameters)
         graphics->SetWindowTitle(GetParameter(parameters, "WindowTitle", "Urho3D").GetString());
         graphics->SetWindowIcon(cache->GetResource<Image>(GetParameter(parameters, "WindowIcon", String::EMPTY).GetString()));
         graphics->SetFlushGPU(GetParameter(parameters, "FlushGPU", false).GetBool());
+        graphics->SetRenderThread(GetParameter(parameters, "RenderThread", false).GetBool());
+        graphics->SetAsyncShaders(GetParameter(parameters, "AsyncShaders", false).GetBool());
+        graphics->SetShaderFallbackDefines(GetParameter(parameters, "ShaderFallbackDefines", String::EMPTY).GetString());
+        graphics->SetShaderCacheDir(GetParameter(parameters, "ShaderCacheDir", String::EMPTY).GetString());
         graphics->SetOrientations(GetParameter(parameters, "Orientations", "LandscapeLeft LandscapeRight").GetString());
 
         if (HasParameter(parameters, "WindowPositionX") && HasParameter(parameters, "WindowPositionY"))
@@ -370,6 +488,16 @@ bool Engine::Initialize(const VariantMap& parameters)
     if (HasParameter(parameters, "TouchEmulation"))
         GetSubsystem<Input>()->SetTouchEmulation(GetParameter(parameters, "TouchEmulation").GetBool());
 
+    #ifdef URHO3D_NETWORK
+    // Serve profiling data to remote viewers if requested
+    if (HasParameter(parameters, "ProfilerServerPort"))
+    {
+        ProfilerServer* profilerServer = new ProfilerServer(context_);
+        context_->RegisterSubsystem(profilerServer);
+        profilerServer->Start((unsigned short)GetParameter(parameters, "ProfilerServerPort").GetInt());
+    }
+    #endif
+
     #ifdef URHO3D_TESTING
     if (HasParameter(parameters, "TimeOut"))
         timeOut_ = GetParameter(parameters, "TimeOut", 0).GetInt() * 1000000LL;
@@ -475,6 +603,14 @@ void Engine::SetTimeStepSmoothing(int frames)
     timeStepSmoothing_ = Clamp(frames, 1, 20);
 }
 
+void Engine::SetTickRate(int ticksPerSecond)
+{
+    tickRate_ = (unsigned)Max(ticksPerSecond, 0);
+    skippedTicks_ = 0;
+    nextTickTime_ = 0;
+    tickTimer_.Reset();
+}
+
 void Engine::SetMinFps(int fps)
 {
     minFps_ = Max(fps, 0);
@@ -604,8 +740,23 @@ void Engine::DumpMemory()
     }
 
     LOGRAW("Total allocated memory " + String(total) + " bytes in " + String(blocks) + " blocks\n\n");
+    #elif defined(URHO3D_MEMORY_TRACKING)
+    long long total = 0;
+    long long allocations = 0;
+
+    for (unsigned i = 0; i < MAX_MEMORY_TAGS; ++i)
+    {
+        MemoryTagStats stats = MemoryTracker::GetStats((MemoryTag)i);
+        LOGRAW("Tag " + String(MemoryTracker::GetTagName((MemoryTag)i)) + ": " + String((unsigned)stats.liveBytes_) + " bytes in " +
+            String((unsigned)stats.liveAllocations_) + " blocks, peak " + String((unsigned)stats.peakBytes_) + " bytes, " +
+            String((unsigned)stats.totalAllocations_) + " allocations total\n");
+        total += stats.liveBytes_;
+        allocations += stats.liveAllocations_;
+    }
+
+    LOGRAW("Total allocated memory " + String((unsigned)total) + " bytes in " + String((unsigned)allocations) + " blocks\n\n");
     #else
-    LOGRAW("DumpMemory() supported on MSVC debug mode only\n\n");
+    LOGRAW("DumpMemory() supported on MSVC debug mode or with URHO3D_MEMORY_TRACKING only\n\n");
     #endif
     #endif
 }
@@ -652,37 +803,33 @@ void Engine::ApplyFrameLimit()
 {
     if (!initialized_)
         return;
+    
+    if (tickRate_)
+    {
+        ApplyTickLimit();
+        return;
+    }
 
     int maxFps = maxFps_;
     Input* input = GetSubsystem<Input>();
     if (input && !input->HasFocus())
         maxFps = Min(maxInactiveFps_, maxFps);
 
-    long long elapsed = 0;
+    // The frame timer was reset at the start of the frame, just before input was read, and rendering has finished now
+    long long latency = frameTimer_.GetUSec(false);
+    long long targetMax = 0;
 
     // Perform waiting loop if maximum FPS set
     if (maxFps)
     {
         PROFILE(ApplyFrameLimit);
 
-        long long targetMax = 1000000LL / maxFps;
-
-        for (;;)
-        {
-            elapsed = frameTimer_.GetUSec(false);
-            if (elapsed >= targetMax)
-                break;
-
-            // Sleep if 1 ms or more off the frame limiting goal
-            if (targetMax - elapsed >= 1000LL)
-            {
-                unsigned sleepTime = (unsigned)((targetMax - elapsed) / 1000LL);
-                Time::Sleep(sleepTime);
-            }
-        }
+        targetMax = 1000000LL / maxFps;
+        WaitUntil(frameTimer_, targetMax);
     }
 
-    elapsed = frameTimer_.GetUSec(true);
+    long long elapsed = frameTimer_.GetUSec(true);
+    GetSubsystem<Time>()->SetFrameStats(latency, elapsed - latency, targetMax ? elapsed - targetMax : 0);
     #ifdef URHO3D_TESTING
     if (timeOut_ > 0)
     {
@@ -757,8 +904,22 @@ VariantMap Engine::ParseParameters(const Vector<String>& arguments)
                 ret["Shadows"] = false;
             else if (argument == "lqshadows")
                 ret["LowQualityShadows"] = true;
+            else if (argument == "tickrate" && !value.Empty())
+            {
+                ret["TickRate"] = ToInt(value);
+                ++i;
+            }
             else if (argument == "nothreads")
                 ret["WorkerThreads"] = false;
+            else if (argument == "workstealing")
+                ret["WorkStealing"] = true;
+            else if (argument == "threadaffinity")
+                ret["ThreadAffinity"] = true;
+            else if (argument == "reservedcpus" && !value.Empty())
+            {
+                ret["ReservedCPUs"] = ToInt(value);
+                ++i;
+            }
             else if (argument == "v")
                 ret["VSync"] = true;
             else if (argument == "t")
@@ -879,6 +1040,73 @@ const Variant& Engine::GetParameter(const VariantMap& parameters, const String&
     return i != parameters.End() ? i->second_ : defaultValue;
 }
 
+void Engine::ApplyTickLimit()
+{
+    long long tickLength = 1000000LL / tickRate_;
+    nextTickTime_ += tickLength;
+    
+    long long latency = frameTimer_.GetUSec(false);
+    long long now = tickTimer_.GetUSec(false);
+    long long waitStart = now;
+    if (now - nextTickTime_ > MAX_TICK_LAG_USEC)
+    {
+        // Too far behind, for example after a long load: skip the missed ticks instead of running them back to back
+        skippedTicks_ += (unsigned)((now - nextTickTime_) / tickLength);
+        nextTickTime_ = now;
+    }
+    else
+    {
+        PROFILE(ApplyTickLimit);
+        
+        // Wait until the scheduled time. As the schedule is absolute, frames that start late are followed by shorter waits
+        WaitUntil(tickTimer_, nextTickTime_);
+    }
+    
+    now = tickTimer_.GetUSec(false);
+    GetSubsystem<Time>()->SetFrameStats(latency, now - waitStart, now - nextTickTime_);
+    
+    #ifdef URHO3D_TESTING
+    long long elapsed = frameTimer_.GetUSec(true);
+    if (timeOut_ > 0)
+    {
+        timeOut_ -= elapsed;
+        if (timeOut_ <= 0)
+            Exit();
+    }
+    #else
+    frameTimer_.Reset();
+    #endif
+    
+    timeStep_ = (float)tickLength / 1000000.0f;
+}
+
+void Engine::WaitUntil(HiresTimer& timer, long long uSec)
+{
+    for (;;)
+    {
+        long long remaining = uSec - timer.GetUSec(false);
+        if (remaining <= 0)
+            break;
+        
+        // Sleep in whole milliseconds while more time remains than sleeping has recently overslept, then spin the rest
+        long long sleepTime = (remaining - sleepOvershoot_) / 1000LL;
+        if (sleepTime > 0)
+        {
+            long long sleepStart = timer.GetUSec(false);
+            Time::Sleep((unsigned)sleepTime);
+            long long overshoot = timer.GetUSec(false) - sleepStart - sleepTime * 1000LL;
+            if (overshoot < 0)
+                overshoot = 0;
+            
+            // Follow an increase immediately, but let the estimate decay slowly
+            if (overshoot > sleepOvershoot_)
+                sleepOvershoot_ = overshoot < MAX_SLEEP_OVERSHOOT_USEC ? overshoot : MAX_SLEEP_OVERSHOOT_USEC;
+            else
+                sleepOvershoot_ = (sleepOvershoot_ * 15 + overshoot) / 16;
+        }
+    }
+}
+
 void Engine::HandleExitRequested(StringHash eventType, VariantMap& eventData)
 {
     if (autoExit_)
@@ -58,6 +58,8 @@ public:
     void SetMaxInactiveFps(int fps);
     /// Set how many frames to average for timestep smoothing. Default is 2. 1 disables smoothing.
     void SetTimeStepSmoothing(int frames);
+    /// Set fixed tick rate. When nonzero, each frame uses a fixed timestep and starts on an absolute schedule, overriding the frame limiter and timestep smoothing. 0 (default) disables.
+    void SetTickRate(int ticksPerSecond);
     /// Set whether to pause update events and audio when minimized.
     void SetPauseMinimized(bool enable);
     /// Set whether to exit automatically on exit request (window close button.)
@@ -83,6 +85,10 @@ public:
     int GetMaxInactiveFps() const { return maxInactiveFps_; }
     /// Return how many frames to average for timestep smoothing.
     int GetTimeStepSmoothing() const { return timeStepSmoothing_; }
+    /// Return fixed tick rate, or 0 if disabled.
+    int GetTickRate() const { return tickRate_; }
+    /// Return number of ticks skipped since the tick rate was set, because the frames took too long to catch up.
+    unsigned GetSkippedTicks() const { return skippedTicks_; }
     /// Return whether to pause update events and audio when minimized.
     bool GetPauseMinimized() const { return pauseMinimized_; }
     /// Return whether to exit automatically on exit request.
@@ -113,9 +119,19 @@ private:
     void HandleExitRequested(StringHash eventType, VariantMap& eventData);
     /// Actually perform the exit actions.
     void DoExit();
+    /// Sleep until the scheduled time of the next fixed tick.
+    void ApplyTickLimit();
+    /// Wait until a timer reaches a time in microseconds. Sleeps for most of the wait and spins for the rest, so that the inaccuracy of sleeping does not delay the frame.
+    void WaitUntil(HiresTimer& timer, long long uSec);
     
     /// Frame update timer.
     HiresTimer frameTimer_;
+    /// Fixed tick schedule timer.
+    HiresTimer tickTimer_;
+    /// Scheduled time of the next fixed tick in microseconds from the tick timer start.
+    long long nextTickTime_;
+    /// Recently observed oversleep of Time::Sleep() in microseconds, which is left for spinning instead.
+    long long sleepOvershoot_;
     /// Previous timesteps for smoothing.
     PODVector<float> lastTimeSteps_;
     /// Next frame timestep in seconds.
@@ -128,6 +144,10 @@ private:
     unsigned maxFps_;
     /// Maximum frames per second when the application does not have input focus.
     unsigned maxInactiveFps_;
+    /// Fixed ticks per second, or 0 if disabled.
+    unsigned tickRate_;
+    /// Skipped fixed ticks.
+    unsigned skippedTicks_;
     /// Pause when minimized flag.
     bool pauseMinimized_;
 #ifdef URHO3D_TESTING
@@ -62,6 +62,8 @@ AnimatedModel::AnimatedModel(Context* context) :
     animationLodBias_(1.0f),
     animationLodTimer_(-1.0f),
     animationLodDistance_(0.0f),
+    animationLodInterpolation_(false),
+    animationLodInterpolating_(false),
     updateInvisible_(false),
     animationDirty_(false),
     animationOrderDirty_(false),
@@ -72,6 +74,8 @@ AnimatedModel::AnimatedModel(Context* context) :
     loading_(false),
     assignBonesPending_(false)
 {
+    // Skinned models are expensive to update and render, so test them with occlusion queries by default
+    occlusionQuery_ = true;
 }
 
 AnimatedModel::~AnimatedModel()
@@ -95,14 +99,17 @@ void AnimatedModel::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Material", GetMaterialsAttr, SetMaterialsAttr, ResourceRefList, ResourceRefList(Material::GetTypeStatic()), AM_DEFAULT);
     ATTRIBUTE("Is Occluder", bool, occluder_, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
+    ATTRIBUTE("Occlusion Query", bool, occlusionQuery_, true, AM_DEFAULT);
     ATTRIBUTE("Cast Shadows", bool, castShadows_, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Update When Invisible", GetUpdateInvisible, SetUpdateInvisible, bool, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Animation LOD Bias", GetAnimationLodBias, SetAnimationLodBias, float, 1.0f, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Animation LOD Interpolation", GetAnimationLodInterpolation, SetAnimationLodInterpolation, bool, false, AM_DEFAULT);
     COPY_BASE_ATTRIBUTES(Drawable);
     MIXED_ACCESSOR_ATTRIBUTE("Bone Animation Enabled", GetBonesEnabledAttr, SetBonesEnabledAttr, VariantVector, Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
+    MIXED_ACCESSOR_ATTRIBUTE("Bone Animation LOD Distances", GetBoneLodDistancesAttr, SetBoneLodDistancesAttr, VariantVector, Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
     MIXED_ACCESSOR_ATTRIBUTE("Animation States", GetAnimationStatesAttr, SetAnimationStatesAttr, VariantVector, Variant::emptyVariantVector, AM_FILE);
     ACCESSOR_ATTRIBUTE("Morphs", GetMorphsAttr, SetMorphsAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_DEFAULT | AM_NOEDIT);
 }
@@ -215,12 +222,24 @@ void AnimatedModel::Update(const FrameInfo& frame)
         animationLodDistance_ = frame.camera_->GetLodDistance(distance, scale, lodBias_);
     }
 
-    if (animationDirty_ || animationOrderDirty_)
+    if (animationDirty_ || animationOrderDirty_ || animationLodInterpolating_)
         UpdateAnimation(frame);
     else if (boneBoundingBoxDirty_)
         UpdateBoneBoundingBox();
 }
 
+unsigned AnimatedModel::GetUpdateCost() const
+{
+    // Applying the animations dominates, otherwise only the bone bounding box may need to be updated
+    unsigned numBones = skeleton_.GetNumBones();
+    if ((animationDirty_ || animationOrderDirty_) && isMaster_)
+        return 1 + numBones * Max((int)animationStates_.Size(), 1);
+    else if (animationLodInterpolating_)
+        return 1 + numBones;
+    else
+        return 1 + numBones / 4;
+}
+
 void AnimatedModel::UpdateBatches(const FrameInfo& frame)
 {
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
@@ -489,6 +508,12 @@ void AnimatedModel::SetAnimationLodBias(float bias)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetAnimationLodInterpolation(bool enable)
+{
+    animationLodInterpolation_ = enable;
+    MarkNetworkUpdate();
+}
+
 void AnimatedModel::SetUpdateInvisible(bool enable)
 {
     updateInvisible_ = enable;
@@ -662,12 +687,14 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
                 if (destBones[i].node_ && destBones[i].name_ == srcBones[i].name_ && destBones[i].parentIndex_ ==
                     srcBones[i].parentIndex_)
                 {
-                    // If compatible, just copy the values and retain the old node and animated status
+                    // If compatible, just copy the values and retain the old node, animated status and LOD distance
                     Node* boneNode = destBones[i].node_;
                     bool animated = destBones[i].animated_;
+                    float animationLodDistance = destBones[i].animationLodDistance_;
                     destBones[i] = srcBones[i];
                     destBones[i].node_ = boneNode;
                     destBones[i].animated_ = animated;
+                    destBones[i].animationLodDistance_ = animationLodDistance;
                 }
                 else
                 {
@@ -763,6 +790,13 @@ void AnimatedModel::SetBonesEnabledAttr(const VariantVector& value)
         bones[i].animated_ = value[i].GetBool();
 }
 
+void AnimatedModel::SetBoneLodDistancesAttr(const VariantVector& value)
+{
+    Vector<Bone>& bones = skeleton_.GetModifiableBones();
+    for (unsigned i = 0; i < bones.Size() && i < value.Size(); ++i)
+        bones[i].animationLodDistance_ = value[i].GetFloat();
+}
+
 void AnimatedModel::SetAnimationStatesAttr(const VariantVector& value)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
@@ -827,6 +861,16 @@ VariantVector AnimatedModel::GetBonesEnabledAttr() const
     return ret;
 }
 
+VariantVector AnimatedModel::GetBoneLodDistancesAttr() const
+{
+    VariantVector ret;
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    ret.Reserve(bones.Size());
+    for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
+        ret.Push(i->animationLodDistance_);
+    return ret;
+}
+
 VariantVector AnimatedModel::GetAnimationStatesAttr() const
 {
     VariantVector ret;
@@ -1042,6 +1086,8 @@ void AnimatedModel::CloneGeometries()
 void AnimatedModel::CopyMorphVertices(void* destVertexData, void* srcVertexData, unsigned vertexCount, VertexBuffer* destBuffer, VertexBuffer* srcBuffer)
 {
     unsigned mask = destBuffer->GetElementMask() & srcBuffer->GetElementMask();
+    // The morph buffer is always unpacked, so packed source normals and tangents need to be converted
+    bool packedNormals = (srcBuffer->GetElementMask() & MASK_PACKEDNORMALS) != 0;
     unsigned normalOffset = srcBuffer->GetElementOffset(ELEMENT_NORMAL);
     unsigned tangentOffset = srcBuffer->GetElementOffset(ELEMENT_TANGENT);
     unsigned vertexSize = srcBuffer->GetVertexSize();
@@ -1060,19 +1106,37 @@ void AnimatedModel::CopyMorphVertices(void* destVertexData, void* srcVertexData,
         }
         if (mask & MASK_NORMAL)
         {
-            float* normalSrc = (float*)(src + normalOffset);
-            dest[0] = normalSrc[0];
-            dest[1] = normalSrc[1];
-            dest[2] = normalSrc[2];
+            if (packedNormals)
+            {
+                short* normalSrc = (short*)(src + normalOffset);
+                for (unsigned i = 0; i < 3; ++i)
+                    dest[i] = Max((float)normalSrc[i] / 32767.0f, -1.0f);
+            }
+            else
+            {
+                float* normalSrc = (float*)(src + normalOffset);
+                dest[0] = normalSrc[0];
+                dest[1] = normalSrc[1];
+                dest[2] = normalSrc[2];
+            }
             dest += 3;
         }
         if (mask & MASK_TANGENT)
         {
-            float* tangentSrc = (float*)(src + tangentOffset);
-            dest[0] = tangentSrc[0];
-            dest[1] = tangentSrc[1];
-            dest[2] = tangentSrc[2];
-            dest[3] = tangentSrc[3];
+            if (packedNormals)
+            {
+                short* tangentSrc = (short*)(src + tangentOffset);
+                for (unsigned i = 0; i < 4; ++i)
+                    dest[i] = Max((float)tangentSrc[i] / 32767.0f, -1.0f);
+            }
+            else
+            {
+                float* tangentSrc = (float*)(src + tangentOffset);
+                dest[0] = tangentSrc[0];
+                dest[1] = tangentSrc[1];
+                dest[2] = tangentSrc[2];
+                dest[3] = tangentSrc[3];
+            }
             dest += 4;
         }
 
@@ -1115,7 +1179,8 @@ void AnimatedModel::SetGeometryBoneMappings()
 void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
 {
     // If using animation LOD, accumulate time and see if it is time to update
-    if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
+    bool useLod = animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f;
+    if (useLod)
     {
         // Check for first time update
         if (animationLodTimer_ >= 0.0f)
@@ -1124,12 +1189,25 @@ void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
             if (animationLodTimer_ >= animationLodDistance_)
                 animationLodTimer_ = fmodf(animationLodTimer_, animationLodDistance_);
             else
+            {
+                // Move the bones towards the last applied pose in between the updates
+                if (animationLodInterpolating_)
+                    InterpolateAnimationLod(animationLodTimer_ / animationLodDistance_);
                 return;
+            }
         }
         else
             animationLodTimer_ = 0.0f;
     }
 
+    // If the animation stopped changing, finish interpolating to the last applied pose
+    if (animationLodInterpolating_ && !animationDirty_ && !animationOrderDirty_)
+    {
+        InterpolateAnimationLod(1.0f);
+        animationLodInterpolating_ = false;
+        return;
+    }
+
     // Make sure animations are in ascending priority order
     if (animationOrderDirty_)
     {
@@ -1141,41 +1219,108 @@ void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
     // (first AnimatedModel in a node)
     if (isMaster_)
     {
+        bool interpolate = useLod && animationLodInterpolation_;
+        if (interpolate)
+            StoreAnimationLodTransforms(false);
+
         skeleton_.ResetSilent();
         for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
             (*i)->Apply();
 
-        // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
-        node_->MarkDirty();
+        // Interpolate from the pose shown so far to the new pose during the following LOD interval
+        if (interpolate)
+        {
+            StoreAnimationLodTransforms(true);
+            InterpolateAnimationLod(animationLodTimer_ / animationLodDistance_);
+            animationLodInterpolating_ = true;
+        }
+        else
+        {
+            animationLodInterpolating_ = false;
+
+            // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
+            node_->MarkDirty();
 
-        // Calculate new bone bounding box
-        UpdateBoneBoundingBox();
+            // Calculate new bone bounding box
+            UpdateBoneBoundingBox();
+        }
     }
 
     animationDirty_ = false;
 }
 
+void AnimatedModel::StoreAnimationLodTransforms(bool target)
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    animationLodTransforms_.Resize(bones.Size());
+
+    for (unsigned i = 0; i < bones.Size(); ++i)
+    {
+        Node* boneNode = bones[i].node_;
+        if (!boneNode)
+            continue;
+
+        AnimationLodTransform& transform = animationLodTransforms_[i];
+        if (target)
+        {
+            transform.targetPosition_ = boneNode->GetPosition();
+            transform.targetRotation_ = boneNode->GetRotation();
+            transform.targetScale_ = boneNode->GetScale();
+        }
+        else
+        {
+            transform.startPosition_ = boneNode->GetPosition();
+            transform.startRotation_ = boneNode->GetRotation();
+            transform.startScale_ = boneNode->GetScale();
+        }
+    }
+}
+
+void AnimatedModel::InterpolateAnimationLod(float t)
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    if (animationLodTransforms_.Size() != bones.Size())
+        return;
+
+    for (unsigned i = 0; i < bones.Size(); ++i)
+    {
+        const Bone& bone = bones[i];
+        Node* boneNode = bone.node_;
+        // Leave manually controlled bones alone
+        if (!boneNode || !bone.animated_)
+            continue;
+
+        const AnimationLodTransform& transform = animationLodTransforms_[i];
+        boneNode->SetPositionSilent(transform.startPosition_.Lerp(transform.targetPosition_, t));
+        boneNode->SetRotationSilent(transform.startRotation_.Slerp(transform.targetRotation_, t));
+        boneNode->SetScaleSilent(transform.startScale_.Lerp(transform.targetScale_, t));
+    }
+
+    node_->MarkDirty();
+    UpdateBoneBoundingBox();
+}
+
 void AnimatedModel::UpdateBoneBoundingBox()
 {
     if (skeleton_.GetNumBones())
     {
-        // The bone bounding box is in local space, so need the node's inverse transform
+        // The bone bounding box is in local space, which the model space bone transforms already are
         boneBoundingBox_.defined_ = false;
-        Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
+        UpdateBoneTransforms();
 
         const Vector<Bone>& bones = skeleton_.GetBones();
-        for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
+        for (unsigned i = 0; i < bones.Size(); ++i)
         {
-            Node* boneNode = i->node_;
-            if (!boneNode)
+            const Bone& bone = bones[i];
+            if (!bone.node_)
                 continue;
 
             // Use hitbox if available. If not, use only half of the sphere radius
             /// \todo The sphere radius should be multiplied with bone scale
-            if (i->collisionMask_ & BONECOLLISION_BOX)
-                boneBoundingBox_.Merge(i->boundingBox_.Transformed(inverseNodeTransform * boneNode->GetWorldTransform()));
-            else if (i->collisionMask_ & BONECOLLISION_SPHERE)
-                boneBoundingBox_.Merge(Sphere(inverseNodeTransform * boneNode->GetWorldPosition(), i->radius_ * 0.5f));
+            if (bone.collisionMask_ & BONECOLLISION_BOX)
+                boneBoundingBox_.Merge(bone.boundingBox_.Transformed(boneTransforms_[i]));
+            else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
+                boneBoundingBox_.Merge(Sphere(boneTransforms_[i].Translation(), bone.radius_ * 0.5f));
         }
     }
 
@@ -1183,6 +1328,45 @@ void AnimatedModel::UpdateBoneBoundingBox()
     worldBoundingBoxDirty_ = true;
 }
 
+void AnimatedModel::UpdateBoneTransforms()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    boneTransforms_.Resize(bones.Size());
+
+    Matrix3x4 inverseNodeTransform;
+    bool inverseCalculated = false;
+
+    for (unsigned i = 0; i < bones.Size(); ++i)
+    {
+        const Bone& bone = bones[i];
+        Node* boneNode = bone.node_;
+        if (!boneNode)
+        {
+            boneTransforms_[i] = Matrix3x4::IDENTITY;
+            continue;
+        }
+
+        // While the bone node hierarchy matches the skeleton, accumulate the local transforms into the flat array instead
+        // of updating the world transforms of each bone node, which may be happening in a worker thread
+        Node* parentNode = boneNode->GetParent();
+        unsigned parentIndex = bone.parentIndex_;
+        if ((parentIndex == i || parentIndex >= bones.Size()) && parentNode == node_)
+            boneTransforms_[i] = boneNode->GetTransform();
+        else if (parentIndex < i && parentNode && parentNode == bones[parentIndex].node_)
+            boneTransforms_[i] = boneTransforms_[parentIndex] * boneNode->GetTransform();
+        else
+        {
+            // Bone has been reparented, or its parent comes later in the skeleton
+            if (!inverseCalculated)
+            {
+                inverseNodeTransform = node_->GetWorldTransform().Inverse();
+                inverseCalculated = true;
+            }
+            boneTransforms_[i] = inverseNodeTransform * boneNode->GetWorldTransform();
+        }
+    }
+}
+
 void AnimatedModel::UpdateSkinning()
 {
     // Note: the model's world transform will be baked in the skin matrices
@@ -1190,6 +1374,8 @@ void AnimatedModel::UpdateSkinning()
     // Use model's world transform in case a bone is missing
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
 
+    UpdateBoneTransforms();
+
     // Skinning with global matrices only
     if (!geometrySkinMatrices_.Size())
     {
@@ -1197,7 +1383,7 @@ void AnimatedModel::UpdateSkinning()
         {
             const Bone& bone = bones[i];
             if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+                skinMatrices_[i] = worldTransform * boneTransforms_[i] * bone.offsetMatrix_;
             else
                 skinMatrices_[i] = worldTransform;
         }
@@ -1209,7 +1395,7 @@ void AnimatedModel::UpdateSkinning()
         {
             const Bone& bone = bones[i];
             if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+                skinMatrices_[i] = worldTransform * boneTransforms_[i] * bone.offsetMatrix_;
             else
                 skinMatrices_[i] = worldTransform;
 
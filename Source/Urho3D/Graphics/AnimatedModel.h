@@ -32,6 +32,23 @@ namespace Urho3D
 class Animation;
 class AnimationState;
 
+/// Bone transform interpolated between animation LOD updates.
+struct AnimationLodTransform
+{
+    /// Position to interpolate from.
+    Vector3 startPosition_;
+    /// Rotation to interpolate from.
+    Quaternion startRotation_;
+    /// Scale to interpolate from.
+    Vector3 startScale_;
+    /// Position to interpolate to.
+    Vector3 targetPosition_;
+    /// Rotation to interpolate to.
+    Quaternion targetRotation_;
+    /// Scale to interpolate to.
+    Vector3 targetScale_;
+};
+
 /// Animated model component.
 class URHO3D_API AnimatedModel : public StaticModel
 {
@@ -57,6 +74,8 @@ public:
     virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results);
     /// Update before octree reinsertion. Is called from a worker thread.
     virtual void Update(const FrameInfo& frame);
+    /// Return the relative cost of Update(), which grows with the number of bones and animations.
+    virtual unsigned GetUpdateCost() const;
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     virtual void UpdateBatches(const FrameInfo& frame);
     /// Prepare geometry for rendering. Called from a worker thread if possible (no GPU update.)
@@ -84,6 +103,8 @@ public:
     void RemoveAllAnimationStates();
     /// Set animation LOD bias.
     void SetAnimationLodBias(float bias);
+    /// Set whether to interpolate the bone transforms between animation LOD updates. Smooths the motion at the cost of delaying it by one update interval.
+    void SetAnimationLodInterpolation(bool enable);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
     /// Set vertex morph weight by index.
@@ -111,6 +132,10 @@ public:
     AnimationState* GetAnimationState(unsigned index) const;
     /// Return animation LOD bias.
     float GetAnimationLodBias() const { return animationLodBias_; }
+    /// Return whether interpolates the bone transforms between animation LOD updates.
+    bool GetAnimationLodInterpolation() const { return animationLodInterpolation_; }
+    /// Return animation LOD distance, the minimum of all LOD view distances last frame.
+    float GetAnimationLodDistance() const { return animationLodDistance_; }
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
     /// Return all vertex morphs.
@@ -132,6 +157,8 @@ public:
     void SetModelAttr(const ResourceRef& value);
     /// Set bones' animation enabled attribute.
     void SetBonesEnabledAttr(const VariantVector& value);
+    /// Set bones' animation LOD distance attribute.
+    void SetBoneLodDistancesAttr(const VariantVector& value);
     /// Set animation states attribute.
     void SetAnimationStatesAttr(const VariantVector& value);
     /// Set morphs attribute.
@@ -140,6 +167,8 @@ public:
     ResourceRef GetModelAttr() const;
     /// Return bones' animation enabled attribute.
     VariantVector GetBonesEnabledAttr() const;
+    /// Return bones' animation LOD distance attribute.
+    VariantVector GetBoneLodDistancesAttr() const;
     /// Return animation states attribute.
     VariantVector GetAnimationStatesAttr() const;
     /// Return morphs attribute.
@@ -178,8 +207,14 @@ private:
     void CopyMorphVertices(void* dest, void* src, unsigned vertexCount, VertexBuffer* clone, VertexBuffer* original);
     /// Recalculate animations. Called from Update().
     void UpdateAnimation(const FrameInfo& frame);
+    /// Store the current bone transforms as the start or the target of animation LOD interpolation.
+    void StoreAnimationLodTransforms(bool target);
+    /// Interpolate the bone transforms between animation LOD updates.
+    void InterpolateAnimationLod(float t);
     /// Recalculate the bone bounding box.
     void UpdateBoneBoundingBox();
+    /// Recalculate the model space bone transforms from the bone node transforms.
+    void UpdateBoneTransforms();
     /// Recalculate skinning.
     void UpdateSkinning();
     /// Reapply all vertex morphs.
@@ -199,6 +234,10 @@ private:
     Vector<SharedPtr<AnimationState> > animationStates_;
     /// Skinning matrices.
     PODVector<Matrix3x4> skinMatrices_;
+    /// Model space bone transforms.
+    PODVector<Matrix3x4> boneTransforms_;
+    /// Bone transforms to interpolate between animation LOD updates.
+    PODVector<AnimationLodTransform> animationLodTransforms_;
     /// Mapping of subgeometry bone indices, used if more bones than skinning shader can manage.
     Vector<PODVector<unsigned> > geometryBoneMappings_;
     /// Subgeometry skinning matrices, used if more bones than skinning shader can manage.
@@ -219,6 +258,10 @@ private:
     float animationLodTimer_;
     /// Animation LOD distance, the minimum of all LOD view distances last frame.
     float animationLodDistance_;
+    /// Animation LOD interpolation flag.
+    bool animationLodInterpolation_;
+    /// Animation LOD interpolation in progress flag.
+    bool animationLodInterpolating_;
     /// Update animation when invisible flag.
     bool updateInvisible_;
     /// Animation dirty flag.
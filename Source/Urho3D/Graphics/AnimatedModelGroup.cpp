@@ -0,0 +1,475 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Graphics/AnimatedModelGroup.h"
+#include "../Graphics/Animation.h"
+#include "../Graphics/Batch.h"
+#include "../Graphics/Camera.h"
+#include "../Core/Context.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/Model.h"
+#include "../Core/Profiler.h"
+#include "../Graphics/Renderer.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* GEOMETRY_CATEGORY;
+
+static const float DEFAULT_SAMPLE_RATE = 30.0f;
+
+/// Sample the local transform of a bone from an animation track, or return its initial transform if it has no track.
+static Matrix3x4 SampleBoneTransform(const Bone& bone, const AnimationTrack* track, float time, float length, unsigned& keyFrame)
+{
+    Vector3 position = bone.initialPosition_;
+    Quaternion rotation = bone.initialRotation_;
+    Vector3 scale = bone.initialScale_;
+
+    if (track && !track->keyFrames_.Empty())
+    {
+        track->GetKeyFrameIndex(time, keyFrame);
+
+        // The animations are looped, so interpolate from the last keyframe to the first
+        unsigned nextKeyFrame = keyFrame + 1 < track->keyFrames_.Size() ? keyFrame + 1 : 0;
+        const AnimationKeyFrame& current = track->keyFrames_[keyFrame];
+        const AnimationKeyFrame& next = track->keyFrames_[nextKeyFrame];
+        float timeInterval = next.time_ - current.time_;
+        if (timeInterval < 0.0f)
+            timeInterval += length;
+        float t = timeInterval > 0.0f ? (time - current.time_) / timeInterval : 1.0f;
+
+        if (track->channelMask_ & CHANNEL_POSITION)
+            position = current.position_.Lerp(next.position_, t);
+        if (track->channelMask_ & CHANNEL_ROTATION)
+            rotation = current.rotation_.Slerp(next.rotation_, t);
+        if (track->channelMask_ & CHANNEL_SCALE)
+            scale = current.scale_.Lerp(next.scale_, t);
+    }
+
+    return Matrix3x4(position, rotation, scale);
+}
+
+/// Calculate the model space transform of a bone after its parents.
+static void CalculateBoneModelTransform(const Vector<Bone>& bones, const PODVector<Matrix3x4>& localTransforms,
+    PODVector<Matrix3x4>& modelTransforms, PODVector<unsigned char>& calculated, unsigned index)
+{
+    if (calculated[index])
+        return;
+    calculated[index] = 1;
+
+    // The root bone is its own parent
+    unsigned parentIndex = bones[index].parentIndex_;
+    if (parentIndex != index && parentIndex < bones.Size())
+    {
+        CalculateBoneModelTransform(bones, localTransforms, modelTransforms, calculated, parentIndex);
+        modelTransforms[index] = modelTransforms[parentIndex] * localTransforms[index];
+    }
+    else
+        modelTransforms[index] = localTransforms[index];
+}
+
+AnimatedModelGroup::AnimatedModelGroup(Context* context) :
+    StaticModelGroup(context),
+    animationsAttr_(Animation::GetTypeStatic()),
+    sampleRate_(DEFAULT_SAMPLE_RATE),
+    lastUpdateFrameNumber_(M_MAX_UNSIGNED),
+    bakeDirty_(true)
+{
+}
+
+AnimatedModelGroup::~AnimatedModelGroup()
+{
+}
+
+void AnimatedModelGroup::RegisterObject(Context* context)
+{
+    context->RegisterFactory<AnimatedModelGroup>(GEOMETRY_CATEGORY);
+
+    COPY_BASE_ATTRIBUTES(StaticModelGroup);
+    ACCESSOR_ATTRIBUTE("Animations", GetAnimationsAttr, SetAnimationsAttr, ResourceRefList, ResourceRefList(Animation::GetTypeStatic()), AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Sample Rate", GetSampleRate, SetSampleRate, float, DEFAULT_SAMPLE_RATE, AM_DEFAULT);
+}
+
+void AnimatedModelGroup::OnSetEnabled()
+{
+    StaticModelGroup::OnSetEnabled();
+
+    Scene* scene = GetScene();
+    if (scene)
+    {
+        if (IsEnabledEffective())
+            SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(AnimatedModelGroup, HandleScenePostUpdate));
+        else
+            UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
+    }
+}
+
+void AnimatedModelGroup::UpdateBatches(const FrameInfo& frame)
+{
+    // Getting the world bounding box ensures the transforms are updated
+    const BoundingBox& worldBoundingBox = GetWorldBoundingBox();
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    distance_ = frame.camera_->GetDistance(worldBoundingBox.Center());
+
+    float scale = worldBoundingBox.Size().DotProduct(DOT_SCALE);
+    float newLodDistance = frame.camera_->GetLodDistance(distance_, scale, lodBias_);
+
+    if (newLodDistance != lodDistance_)
+    {
+        lodDistance_ = newLodDistance;
+        CalculateLodLevels();
+    }
+
+    // The instance records are resized only during the scene update. Skip drawing until they match the instances
+    bool available = numWorldTransforms_ && !bakedAnimations_.Empty() && instanceRecords_.Size() == batches_.Size() &&
+        IsInstancingAvailable();
+
+    for (unsigned i = 0; i < batches_.Size(); ++i)
+    {
+        SourceBatch& batch = batches_[i];
+        bool valid = available && batch.geometry_ && batch.geometry_->GetIndexBuffer() && instanceRecords_[i].Size() ==
+            worldTransforms_.Size() * 2;
+
+        batch.distance_ = batches_.Size() > 1 ? frame.camera_->GetDistance(worldTransform * geometryData_[i].center_) :
+            distance_;
+        batch.geometryType_ = GEOM_SKINNED_INSTANCED;
+        batch.worldTransform_ = valid ? &instanceRecords_[i][0] : &Matrix3x4::IDENTITY;
+        batch.numWorldTransforms_ = valid ? numWorldTransforms_ * 2 : 0;
+    }
+}
+
+void AnimatedModelGroup::UpdateGeometry(const FrameInfo& frame)
+{
+    // The instance records are shared by all views, so write them only once per frame
+    if (frame.frameNumber_ == lastUpdateFrameNumber_)
+        return;
+    lastUpdateFrameNumber_ = frame.frameNumber_;
+
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (!renderer || bakedAnimations_.Empty() || instanceRecords_.Size() != batches_.Size())
+        return;
+
+    PROFILE(UpdateAnimatedModelGroup);
+
+    // Choose the frames to blend for each valid instance, in the same order as the world transforms
+    instancePoses_.Clear();
+    for (unsigned i = 0; i < instanceNodes_.Size() && instancePoses_.Size() < numWorldTransforms_; ++i)
+    {
+        Node* node = instanceNodes_[i];
+        if (!node || !node->IsEnabled())
+            continue;
+
+        HashMap<unsigned, AnimatedModelGroupInstance>::ConstIterator j = instanceStates_.Find(node->GetID());
+        AnimatedModelGroupInstance state = j != instanceStates_.End() ? j->second_ : AnimatedModelGroupInstance();
+        if (state.animation_ >= bakedAnimations_.Size())
+            state.animation_ = 0;
+
+        const AnimatedModelGroupAnimation& baked = bakedAnimations_[state.animation_];
+        float position = baked.length_ > 0.0f ? state.time_ / baked.length_ * baked.numFrames_ : 0.0f;
+        unsigned frameIndex = (unsigned)position;
+
+        AnimatedModelGroupPose pose;
+        pose.animation_ = state.animation_;
+        pose.frameA_ = frameIndex % baked.numFrames_;
+        pose.frameB_ = (frameIndex + 1) % baked.numFrames_;
+        pose.weight_ = position - (float)frameIndex;
+        instancePoses_.Push(pose);
+    }
+
+    // Instances at the same frame of an animation share the pose in the bone matrix texture
+    for (unsigned i = 0; i < instanceRecords_.Size(); ++i)
+    {
+        PODVector<Matrix3x4>& records = instanceRecords_[i];
+        unsigned numInstances = Min((int)instancePoses_.Size(), (int)records.Size() / 2);
+
+        for (unsigned j = 0; j < numInstances; ++j)
+        {
+            const AnimatedModelGroupPose& pose = instancePoses_[j];
+            const AnimatedModelGroupAnimation& baked = bakedAnimations_[pose.animation_];
+            const PODVector<Matrix3x4>& poses = baked.poses_[baked.poses_.Size() > 1 ? i : 0];
+            unsigned numBones = poses.Size() / baked.numFrames_;
+
+            Matrix3x4& poseRecord = records[j * 2 + 1];
+            poseRecord = Matrix3x4::ZERO;
+            if (numBones)
+            {
+                poseRecord.m00_ = (float)renderer->GetSkinMatrixOffset(&poses[pose.frameA_ * numBones], numBones);
+                poseRecord.m01_ = (float)renderer->GetSkinMatrixOffset(&poses[pose.frameB_ * numBones], numBones);
+                poseRecord.m02_ = pose.weight_;
+            }
+            records[j * 2] = worldTransforms_[j];
+        }
+    }
+}
+
+UpdateGeometryType AnimatedModelGroup::GetUpdateGeometryType()
+{
+    // The bone matrix texture offsets of the poses are assigned in the main thread
+    return bakedAnimations_.Empty() ? UPDATE_NONE : UPDATE_MAIN_THREAD;
+}
+
+unsigned AnimatedModelGroup::AddAnimation(Animation* animation)
+{
+    animations_.Push(SharedPtr<Animation>(animation));
+    bakeDirty_ = true;
+    MarkNetworkUpdate();
+    return animations_.Size() - 1;
+}
+
+void AnimatedModelGroup::RemoveAllAnimations()
+{
+    animations_.Clear();
+    bakeDirty_ = true;
+    MarkNetworkUpdate();
+}
+
+void AnimatedModelGroup::SetSampleRate(float rate)
+{
+    sampleRate_ = Max(rate, M_EPSILON);
+    bakeDirty_ = true;
+    MarkNetworkUpdate();
+}
+
+void AnimatedModelGroup::SetInstanceAnimation(Node* node, unsigned index, float time, float speed)
+{
+    if (!node)
+        return;
+
+    AnimatedModelGroupInstance& state = instanceStates_[node->GetID()];
+    state.animation_ = index;
+    state.time_ = time;
+    state.speed_ = speed;
+}
+
+void AnimatedModelGroup::SetInstanceTime(Node* node, float time)
+{
+    if (!node)
+        return;
+
+    instanceStates_[node->GetID()].time_ = time;
+}
+
+Animation* AnimatedModelGroup::GetAnimation(unsigned index) const
+{
+    return index < animations_.Size() ? animations_[index] : (Animation*)0;
+}
+
+unsigned AnimatedModelGroup::GetInstanceAnimation(Node* node) const
+{
+    if (!node)
+        return 0;
+
+    HashMap<unsigned, AnimatedModelGroupInstance>::ConstIterator i = instanceStates_.Find(node->GetID());
+    return i != instanceStates_.End() ? i->second_.animation_ : 0;
+}
+
+float AnimatedModelGroup::GetInstanceTime(Node* node) const
+{
+    if (!node)
+        return 0.0f;
+
+    HashMap<unsigned, AnimatedModelGroupInstance>::ConstIterator i = instanceStates_.Find(node->GetID());
+    return i != instanceStates_.End() ? i->second_.time_ : 0.0f;
+}
+
+void AnimatedModelGroup::SetAnimationsAttr(const ResourceRefList& value)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    animations_.Clear();
+    for (unsigned i = 0; i < value.names_.Size(); ++i)
+        animations_.Push(SharedPtr<Animation>(cache->GetResource<Animation>(value.names_[i])));
+    bakeDirty_ = true;
+}
+
+const ResourceRefList& AnimatedModelGroup::GetAnimationsAttr() const
+{
+    animationsAttr_.names_.Resize(animations_.Size());
+    for (unsigned i = 0; i < animations_.Size(); ++i)
+        animationsAttr_.names_[i] = GetResourceName(animations_[i]);
+
+    return animationsAttr_;
+}
+
+void AnimatedModelGroup::OnNodeSet(Node* node)
+{
+    StaticModelGroup::OnNodeSet(node);
+
+    if (node)
+    {
+        Scene* scene = GetScene();
+        if (scene && IsEnabledEffective())
+            SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(AnimatedModelGroup, HandleScenePostUpdate));
+    }
+}
+
+void AnimatedModelGroup::BakeAnimations()
+{
+    PROFILE(BakeAnimations);
+
+    bakedAnimations_.Clear();
+    bakedModel_ = model_;
+    bakeDirty_ = false;
+
+    if (!model_ || animations_.Empty())
+        return;
+
+    const Vector<Bone>& bones = model_->GetSkeleton().GetBones();
+    const Vector<PODVector<unsigned> >& boneMappings = model_->GetGeometryBoneMappings();
+    unsigned numBones = bones.Size();
+    if (!numBones)
+        return;
+
+    bool hasBoneMappings = false;
+    for (unsigned i = 0; i < boneMappings.Size(); ++i)
+    {
+        if (!boneMappings[i].Empty())
+            hasBoneMappings = true;
+    }
+
+    PODVector<const AnimationTrack*> tracks(numBones);
+    PODVector<unsigned> keyFrames(numBones);
+    PODVector<Matrix3x4> localTransforms(numBones);
+    PODVector<Matrix3x4> modelTransforms(numBones);
+    PODVector<unsigned char> calculated(numBones);
+
+    bakedAnimations_.Resize(animations_.Size());
+    for (unsigned i = 0; i < animations_.Size(); ++i)
+    {
+        Animation* animation = animations_[i];
+        AnimatedModelGroupAnimation& baked = bakedAnimations_[i];
+        baked.length_ = animation ? animation->GetLength() : 0.0f;
+        baked.numFrames_ = Max((int)ceilf(baked.length_ * sampleRate_), 1);
+        baked.poses_.Resize(hasBoneMappings ? boneMappings.Size() : 1);
+
+        // Bones without a track, or with animation disabled, stay in their initial transform
+        for (unsigned j = 0; j < numBones; ++j)
+        {
+            tracks[j] = animation && bones[j].animated_ ? animation->GetTrack(bones[j].nameHash_) : 0;
+            keyFrames[j] = 0;
+        }
+
+        for (unsigned j = 0; j < baked.numFrames_; ++j)
+        {
+            float time = baked.length_ * j / baked.numFrames_;
+
+            for (unsigned k = 0; k < numBones; ++k)
+            {
+                localTransforms[k] = SampleBoneTransform(bones[k], tracks[k], time, baked.length_, keyFrames[k]);
+                calculated[k] = 0;
+            }
+            for (unsigned k = 0; k < numBones; ++k)
+                CalculateBoneModelTransform(bones, localTransforms, modelTransforms, calculated, k);
+
+            // Store the skin matrices in model space. The instance world transform is applied in the vertex shader
+            for (unsigned k = 0; k < numBones; ++k)
+                modelTransforms[k] = modelTransforms[k] * bones[k].offsetMatrix_;
+
+            for (unsigned k = 0; k < baked.poses_.Size(); ++k)
+            {
+                PODVector<Matrix3x4>& poses = baked.poses_[k];
+                if (!hasBoneMappings || boneMappings[k].Empty())
+                {
+                    for (unsigned l = 0; l < numBones; ++l)
+                        poses.Push(modelTransforms[l]);
+                }
+                else
+                {
+                    const PODVector<unsigned>& boneMapping = boneMappings[k];
+                    for (unsigned l = 0; l < boneMapping.Size(); ++l)
+                        poses.Push(boneMapping[l] < numBones ? modelTransforms[boneMapping[l]] : Matrix3x4::IDENTITY);
+                }
+            }
+        }
+    }
+}
+
+bool AnimatedModelGroup::IsInstancingAvailable() const
+{
+    Renderer* renderer = GetSubsystem<Renderer>();
+    Graphics* graphics = GetSubsystem<Graphics>();
+    return renderer && graphics && renderer->GetTextureSkinning() && graphics->GetInstancingSupport();
+}
+
+void AnimatedModelGroup::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ScenePostUpdate;
+
+    float timeStep = eventData[P_TIMESTEP].GetFloat();
+
+    if (bakeDirty_ || bakedModel_.Get() != model_.Get())
+        BakeAnimations();
+
+    // Forget the playback state of removed instance nodes
+    if (instanceStates_.Size() > instanceNodes_.Size())
+    {
+        HashMap<unsigned, AnimatedModelGroupInstance> instanceStates;
+        for (unsigned i = 0; i < instanceNodes_.Size(); ++i)
+        {
+            Node* node = instanceNodes_[i];
+            if (!node)
+                continue;
+            HashMap<unsigned, AnimatedModelGroupInstance>::ConstIterator j = instanceStates_.Find(node->GetID());
+            if (j != instanceStates_.End())
+                instanceStates[j->first_] = j->second_;
+        }
+        instanceStates_ = instanceStates;
+    }
+
+    // Advance playback of the instances
+    if (!bakedAnimations_.Empty())
+    {
+        for (unsigned i = 0; i < instanceNodes_.Size(); ++i)
+        {
+            Node* node = instanceNodes_[i];
+            if (!node)
+                continue;
+
+            AnimatedModelGroupInstance& state = instanceStates_[node->GetID()];
+            float length = bakedAnimations_[state.animation_ < bakedAnimations_.Size() ? state.animation_ : 0].length_;
+            if (length > 0.0f)
+            {
+                state.time_ = fmodf(state.time_ + timeStep * state.speed_, length);
+                if (state.time_ < 0.0f)
+                    state.time_ += length;
+            }
+            else
+                state.time_ = 0.0f;
+        }
+    }
+
+    // Resize the instance records now, as the batches point to them from the view update until rendering
+    if (instanceRecords_.Size() != batches_.Size())
+        instanceRecords_.Resize(batches_.Size());
+    for (unsigned i = 0; i < instanceRecords_.Size(); ++i)
+    {
+        if (instanceRecords_[i].Size() != worldTransforms_.Size() * 2)
+            instanceRecords_[i].Resize(worldTransforms_.Size() * 2);
+    }
+}
+
+}
@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Graphics/StaticModelGroup.h"
+
+namespace Urho3D
+{
+
+class Animation;
+
+/// Animation playback state of an animated model group instance.
+struct AnimatedModelGroupInstance
+{
+    /// Construct with defaults.
+    AnimatedModelGroupInstance() :
+        animation_(0),
+        time_(0.0f),
+        speed_(1.0f)
+    {
+    }
+
+    /// Animation index.
+    unsigned animation_;
+    /// Playback time.
+    float time_;
+    /// Playback speed.
+    float speed_;
+};
+
+/// Animation baked into poses for an animated model group.
+struct AnimatedModelGroupAnimation
+{
+    /// Construct with defaults.
+    AnimatedModelGroupAnimation() :
+        length_(0.0f),
+        numFrames_(1)
+    {
+    }
+
+    /// Animation length.
+    float length_;
+    /// Number of baked frames.
+    unsigned numFrames_;
+    /// Skin matrices of all frames. One vector per geometry if the model has geometry bone mappings, otherwise one shared vector.
+    Vector<PODVector<Matrix3x4> > poses_;
+};
+
+/// Pose blend of an animated model group instance during a frame.
+struct AnimatedModelGroupPose
+{
+    /// Animation index.
+    unsigned animation_;
+    /// Frame to blend from.
+    unsigned frameA_;
+    /// Frame to blend to.
+    unsigned frameB_;
+    /// Blend weight.
+    float weight_;
+};
+
+/// Renders instances of a skinned model playing looped animations without bone scene nodes. The animations are baked into poses in model space, and all instances of a geometry are drawn with one hardware instanced draw call that reads the instance transforms and the poses from the bone matrix texture. Requires texture skinning to be enabled in the Renderer.
+class URHO3D_API AnimatedModelGroup : public StaticModelGroup
+{
+    OBJECT(AnimatedModelGroup);
+
+public:
+    /// Construct.
+    AnimatedModelGroup(Context* context);
+    /// Destruct.
+    virtual ~AnimatedModelGroup();
+    /// Register object factory. StaticModelGroup must be registered first.
+    static void RegisterObject(Context* context);
+
+    /// Handle enabled/disabled state change.
+    virtual void OnSetEnabled();
+    /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
+    virtual void UpdateBatches(const FrameInfo& frame);
+    /// Write the instance transforms and poses for rendering.
+    virtual void UpdateGeometry(const FrameInfo& frame);
+    /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
+    virtual UpdateGeometryType GetUpdateGeometryType();
+
+    /// Add an animation for the instances to play. Return its index.
+    unsigned AddAnimation(Animation* animation);
+    /// Remove all animations.
+    void RemoveAllAnimations();
+    /// Set the number of frames per second to bake the animations at.
+    void SetSampleRate(float rate);
+    /// Set the animation an instance node plays, the time to start from and the playback speed.
+    void SetInstanceAnimation(Node* node, unsigned index, float time = 0.0f, float speed = 1.0f);
+    /// Set the playback time of an instance node.
+    void SetInstanceTime(Node* node, float time);
+
+    /// Return number of animations.
+    unsigned GetNumAnimations() const { return animations_.Size(); }
+    /// Return animation by index.
+    Animation* GetAnimation(unsigned index) const;
+    /// Return the number of frames per second the animations are baked at.
+    float GetSampleRate() const { return sampleRate_; }
+    /// Return the animation index an instance node plays.
+    unsigned GetInstanceAnimation(Node* node) const;
+    /// Return the playback time of an instance node.
+    float GetInstanceTime(Node* node) const;
+
+    /// Set animations attribute.
+    void SetAnimationsAttr(const ResourceRefList& value);
+    /// Return animations attribute.
+    const ResourceRefList& GetAnimationsAttr() const;
+
+protected:
+    /// Handle node being assigned.
+    virtual void OnNodeSet(Node* node);
+
+private:
+    /// Bake the animations into poses of the current model.
+    void BakeAnimations();
+    /// Return whether instances can be drawn with the bone matrix texture.
+    bool IsInstancingAvailable() const;
+    /// Handle scene post-update event.
+    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+
+    /// Animations.
+    Vector<SharedPtr<Animation> > animations_;
+    /// Baked animations.
+    Vector<AnimatedModelGroupAnimation> bakedAnimations_;
+    /// Playback state of instance nodes by node ID.
+    HashMap<unsigned, AnimatedModelGroupInstance> instanceStates_;
+    /// Pose blends of the valid instances during the current frame.
+    PODVector<AnimatedModelGroupPose> instancePoses_;
+    /// Instance records for each geometry, consisting of the world transform and the pose blend of each instance.
+    Vector<PODVector<Matrix3x4> > instanceRecords_;
+    /// Model the animations were baked for.
+    WeakPtr<Model> bakedModel_;
+    /// Animations attribute.
+    mutable ResourceRefList animationsAttr_;
+    /// Baking sample rate.
+    float sampleRate_;
+    /// Frame number the instance records were last written on.
+    unsigned lastUpdateFrameNumber_;
+    /// Animations need to be baked flag.
+    bool bakeDirty_;
+};
+
+}
@@ -26,6 +26,7 @@
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../Core/Profiler.h"
+#include "../Math/BoundingBox.h"
 #include "../Resource/ResourceCache.h"
 #include "../IO/Serializer.h"
 #include "../Resource/XMLFile.h"
@@ -35,11 +36,125 @@
 namespace Urho3D
 {
 
+static const float QUANTIZE_RANGE = 65535.0f;
+static const float ROTATION_QUANTIZE_RANGE = 32767.0f;
+static const float ROTATION_COMPONENT_MAX = 0.70710678f;
+
 inline bool CompareTriggers(AnimationTriggerPoint& lhs, AnimationTriggerPoint& rhs)
 {
     return lhs.time_ < rhs.time_;
 }
 
+static unsigned short QuantizeFloat(float value, float min, float range)
+{
+    return range > 0.0f ? (unsigned short)(Clamp((value - min) / range, 0.0f, 1.0f) * QUANTIZE_RANGE + 0.5f) : 0;
+}
+
+static float DequantizeFloat(unsigned short value, float min, float range)
+{
+    return min + (float)value / QUANTIZE_RANGE * range;
+}
+
+static void WriteQuantizedVector3(Serializer& dest, const Vector3& value, const Vector3& min, const Vector3& range)
+{
+    dest.WriteUShort(QuantizeFloat(value.x_, min.x_, range.x_));
+    dest.WriteUShort(QuantizeFloat(value.y_, min.y_, range.y_));
+    dest.WriteUShort(QuantizeFloat(value.z_, min.z_, range.z_));
+}
+
+static Vector3 ReadQuantizedVector3(Deserializer& source, const Vector3& min, const Vector3& range)
+{
+    float x = DequantizeFloat(source.ReadUShort(), min.x_, range.x_);
+    float y = DequantizeFloat(source.ReadUShort(), min.y_, range.y_);
+    float z = DequantizeFloat(source.ReadUShort(), min.z_, range.z_);
+    return Vector3(x, y, z);
+}
+
+static void WriteQuantizedQuaternion(Serializer& dest, const Quaternion& value)
+{
+    // Smallest three: drop the largest component and store the other three, which are within +-1/sqrt(2), in 15 bits each.
+    // The index of the dropped component goes to the top bits of the first two values
+    Quaternion q = value.Normalized();
+    float components[4] = { q.w_, q.x_, q.y_, q.z_ };
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, so make the dropped component positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    unsigned short values[3];
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float normalized = Clamp(sign * components[i] / ROTATION_COMPONENT_MAX * 0.5f + 0.5f, 0.0f, 1.0f);
+        values[j++] = (unsigned short)(normalized * ROTATION_QUANTIZE_RANGE + 0.5f);
+    }
+    values[0] |= (largest & 1) << 15;
+    values[1] |= (largest & 2) << 14;
+
+    dest.WriteUShort(values[0]);
+    dest.WriteUShort(values[1]);
+    dest.WriteUShort(values[2]);
+}
+
+static Quaternion ReadQuantizedQuaternion(Deserializer& source)
+{
+    unsigned short values[3];
+    values[0] = source.ReadUShort();
+    values[1] = source.ReadUShort();
+    values[2] = source.ReadUShort();
+    unsigned largest = (values[0] >> 15) | ((values[1] >> 14) & 2);
+
+    float components[4];
+    float sumSquared = 0.0f;
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float normalized = (float)(values[j++] & 0x7fff) / ROTATION_QUANTIZE_RANGE;
+        components[i] = (normalized - 0.5f) * 2.0f * ROTATION_COMPONENT_MAX;
+        sumSquared += components[i] * components[i];
+    }
+    components[largest] = sqrtf(Max(1.0f - sumSquared, 0.0f));
+
+    return Quaternion(components[0], components[1], components[2], components[3]).Normalized();
+}
+
+static void GetChannelRange(const AnimationTrack& track, unsigned char channel, Vector3& min, Vector3& range)
+{
+    BoundingBox box;
+    for (unsigned i = 0; i < track.keyFrames_.Size(); ++i)
+        box.Merge(channel == CHANNEL_POSITION ? track.keyFrames_[i].position_ : track.keyFrames_[i].scale_);
+    min = box.min_;
+    range = box.max_ - box.min_;
+}
+
+static bool IsKeyFrameRedundant(const AnimationKeyFrame& keyFrame, const AnimationKeyFrame& prev, const AnimationKeyFrame& next,
+    unsigned char channelMask, float positionError, float rotationError, float scaleError)
+{
+    float timeInterval = next.time_ - prev.time_;
+    float t = timeInterval > 0.0f ? (keyFrame.time_ - prev.time_) / timeInterval : 1.0f;
+
+    if ((channelMask & CHANNEL_POSITION) && (prev.position_.Lerp(next.position_, t) - keyFrame.position_).Length() > positionError)
+        return false;
+    if (channelMask & CHANNEL_ROTATION)
+    {
+        float dot = Abs(prev.rotation_.Slerp(next.rotation_, t).DotProduct(keyFrame.rotation_));
+        if (2.0f * Acos(dot) > rotationError)
+            return false;
+    }
+    if ((channelMask & CHANNEL_SCALE) && (prev.scale_.Lerp(next.scale_, t) - keyFrame.scale_).Length() > scaleError)
+        return false;
+
+    return true;
+}
+
 void AnimationTrack::GetKeyFrameIndex(float time, unsigned& index) const
 {
     if (time < 0.0f)
@@ -59,7 +174,8 @@ void AnimationTrack::GetKeyFrameIndex(float time, unsigned& index) const
 
 Animation::Animation(Context* context) :
     Resource(context),
-    length_(0.f)
+    length_(0.f),
+    compressed_(false)
 {
 }
 
@@ -77,11 +193,13 @@ bool Animation::BeginLoad(Deserializer& source)
     unsigned memoryUse = sizeof(Animation);
     
     // Check ID
-    if (source.ReadFileID() != "UANI")
+    String fileID = source.ReadFileID();
+    if (fileID != "UANI" && fileID != "UANC")
     {
         LOGERROR(source.GetName() + " is not a valid animation file");
         return false;
     }
+    compressed_ = fileID == "UANC";
     
     // Read name and length
     animationName_ = source.ReadString();
@@ -105,17 +223,47 @@ bool Animation::BeginLoad(Deserializer& source)
         newTrack.keyFrames_.Resize(keyFrames);
         memoryUse += keyFrames * sizeof(AnimationKeyFrame);
         
-        // Read keyframes of the track
-        for (unsigned j = 0; j < keyFrames; ++j)
+        if (!compressed_)
+        {
+            // Read keyframes of the track
+            for (unsigned j = 0; j < keyFrames; ++j)
+            {
+                AnimationKeyFrame& newKeyFrame = newTrack.keyFrames_[j];
+                newKeyFrame.time_ = source.ReadFloat();
+                if (newTrack.channelMask_ & CHANNEL_POSITION)
+                    newKeyFrame.position_ = source.ReadVector3();
+                if (newTrack.channelMask_ & CHANNEL_ROTATION)
+                    newKeyFrame.rotation_ = source.ReadQuaternion();
+                if (newTrack.channelMask_ & CHANNEL_SCALE)
+                    newKeyFrame.scale_ = source.ReadVector3();
+            }
+        }
+        else if (keyFrames)
         {
-            AnimationKeyFrame& newKeyFrame = newTrack.keyFrames_[j];
-            newKeyFrame.time_ = source.ReadFloat();
+            // Read quantized keyframe data one channel at a time
+            float minTime = source.ReadFloat();
+            float timeRange = source.ReadFloat();
+            for (unsigned j = 0; j < keyFrames; ++j)
+                newTrack.keyFrames_[j].time_ = DequantizeFloat(source.ReadUShort(), minTime, timeRange);
             if (newTrack.channelMask_ & CHANNEL_POSITION)
-                newKeyFrame.position_ = source.ReadVector3();
+            {
+                Vector3 min = source.ReadVector3();
+                Vector3 range = source.ReadVector3();
+                for (unsigned j = 0; j < keyFrames; ++j)
+                    newTrack.keyFrames_[j].position_ = ReadQuantizedVector3(source, min, range);
+            }
             if (newTrack.channelMask_ & CHANNEL_ROTATION)
-                newKeyFrame.rotation_ = source.ReadQuaternion();
+            {
+                for (unsigned j = 0; j < keyFrames; ++j)
+                    newTrack.keyFrames_[j].rotation_ = ReadQuantizedQuaternion(source);
+            }
             if (newTrack.channelMask_ & CHANNEL_SCALE)
-                newKeyFrame.scale_ = source.ReadVector3();
+            {
+                Vector3 min = source.ReadVector3();
+                Vector3 range = source.ReadVector3();
+                for (unsigned j = 0; j < keyFrames; ++j)
+                    newTrack.keyFrames_[j].scale_ = ReadQuantizedVector3(source, min, range);
+            }
         }
     }
     
@@ -148,7 +296,7 @@ bool Animation::BeginLoad(Deserializer& source)
 bool Animation::Save(Serializer& dest) const
 {
     // Write ID, name and length
-    dest.WriteFileID("UANI");
+    dest.WriteFileID(compressed_ ? "UANC" : "UANI");
     dest.WriteString(animationName_);
     dest.WriteFloat(length_);
     
@@ -161,17 +309,54 @@ bool Animation::Save(Serializer& dest) const
         dest.WriteUByte(track.channelMask_);
         dest.WriteUInt(track.keyFrames_.Size());
         
-        // Write keyframes of the track
-        for (unsigned j = 0; j < track.keyFrames_.Size(); ++j)
+        if (!compressed_)
+        {
+            // Write keyframes of the track
+            for (unsigned j = 0; j < track.keyFrames_.Size(); ++j)
+            {
+                const AnimationKeyFrame& keyFrame = track.keyFrames_[j];
+                dest.WriteFloat(keyFrame.time_);
+                if (track.channelMask_ & CHANNEL_POSITION)
+                    dest.WriteVector3(keyFrame.position_);
+                if (track.channelMask_ & CHANNEL_ROTATION)
+                    dest.WriteQuaternion(keyFrame.rotation_);
+                if (track.channelMask_ & CHANNEL_SCALE)
+                    dest.WriteVector3(keyFrame.scale_);
+            }
+        }
+        else if (track.keyFrames_.Size())
         {
-            const AnimationKeyFrame& keyFrame = track.keyFrames_[j];
-            dest.WriteFloat(keyFrame.time_);
+            // Write quantized keyframe data one channel at a time. Positions, scales and times are relative to their range in the track
+            unsigned keyFrames = track.keyFrames_.Size();
+            float minTime = track.keyFrames_[0].time_;
+            float timeRange = track.keyFrames_[keyFrames - 1].time_ - minTime;
+            dest.WriteFloat(minTime);
+            dest.WriteFloat(timeRange);
+            for (unsigned j = 0; j < keyFrames; ++j)
+                dest.WriteUShort(QuantizeFloat(track.keyFrames_[j].time_, minTime, timeRange));
             if (track.channelMask_ & CHANNEL_POSITION)
-                dest.WriteVector3(keyFrame.position_);
+            {
+                Vector3 min, range;
+                GetChannelRange(track, CHANNEL_POSITION, min, range);
+                dest.WriteVector3(min);
+                dest.WriteVector3(range);
+                for (unsigned j = 0; j < keyFrames; ++j)
+                    WriteQuantizedVector3(dest, track.keyFrames_[j].position_, min, range);
+            }
             if (track.channelMask_ & CHANNEL_ROTATION)
-                dest.WriteQuaternion(keyFrame.rotation_);
+            {
+                for (unsigned j = 0; j < keyFrames; ++j)
+                    WriteQuantizedQuaternion(dest, track.keyFrames_[j].rotation_);
+            }
             if (track.channelMask_ & CHANNEL_SCALE)
-                dest.WriteVector3(keyFrame.scale_);
+            {
+                Vector3 min, range;
+                GetChannelRange(track, CHANNEL_SCALE, min, range);
+                dest.WriteVector3(min);
+                dest.WriteVector3(range);
+                for (unsigned j = 0; j < keyFrames; ++j)
+                    WriteQuantizedVector3(dest, track.keyFrames_[j].scale_, min, range);
+            }
         }
     }
     
@@ -203,6 +388,48 @@ bool Animation::Save(Serializer& dest) const
     return true;
 }
 
+void Animation::RemoveRedundantKeyFrames(float positionError, float rotationError, float scaleError)
+{
+    unsigned memoryUse = GetMemoryUse();
+
+    for (unsigned i = 0; i < tracks_.Size(); ++i)
+    {
+        AnimationTrack& track = tracks_[i];
+        if (track.keyFrames_.Size() < 3)
+            continue;
+
+        // Extend the span from the last kept keyframe as long as interpolating over it reproduces all the skipped keyframes
+        Vector<AnimationKeyFrame> keptKeyFrames;
+        keptKeyFrames.Push(track.keyFrames_[0]);
+        unsigned last = 0;
+        for (unsigned j = 1; j < track.keyFrames_.Size() - 1; ++j)
+        {
+            const AnimationKeyFrame& next = track.keyFrames_[j + 1];
+            for (unsigned k = last + 1; k <= j; ++k)
+            {
+                if (!IsKeyFrameRedundant(track.keyFrames_[k], track.keyFrames_[last], next, track.channelMask_, positionError,
+                    rotationError, scaleError))
+                {
+                    keptKeyFrames.Push(track.keyFrames_[j]);
+                    last = j;
+                    break;
+                }
+            }
+        }
+        keptKeyFrames.Push(track.keyFrames_.Back());
+
+        memoryUse -= (track.keyFrames_.Size() - keptKeyFrames.Size()) * sizeof(AnimationKeyFrame);
+        track.keyFrames_ = keptKeyFrames;
+    }
+
+    SetMemoryUse(memoryUse);
+}
+
+void Animation::SetCompressed(bool enable)
+{
+    compressed_ = enable;
+}
+
 void Animation::SetAnimationName(const String& name)
 {
     animationName_ = name;
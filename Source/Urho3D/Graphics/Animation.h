@@ -96,6 +96,11 @@ public:
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
     
+    /// Remove keyframes that interpolating their neighbours reproduces within the given position, rotation (degrees) and scale error.
+    void RemoveRedundantKeyFrames(float positionError, float rotationError, float scaleError);
+    /// Set whether to save in the compressed format with quantized keyframes.
+    void SetCompressed(bool enable);
+    
     /// Set animation name.
     void SetAnimationName(const String& name);
     /// Set animation length.
@@ -117,6 +122,8 @@ public:
     StringHash GetAnimationNameHash() const { return animationNameHash_; }
     /// Return animation length.
     float GetLength() const { return length_; }
+    /// Return whether saves in the compressed format.
+    bool IsCompressed() const { return compressed_; }
     /// Return all animation tracks.
     const Vector<AnimationTrack>& GetTracks() const { return tracks_; }
     /// Return number of animation tracks.
@@ -143,6 +150,8 @@ private:
     Vector<AnimationTrack> tracks_;
     /// Animation trigger points.
     Vector<AnimationTriggerPoint> triggers_;
+    /// Compressed format flag.
+    bool compressed_;
 };
 
 }
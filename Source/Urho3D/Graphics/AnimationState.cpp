@@ -402,13 +402,16 @@ void AnimationState::Apply()
 
 void AnimationState::ApplyToModel()
 {
+    float lodDistance = model_->GetAnimationLodDistance();
+    
     for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
     {
         AnimationStateTrack& stateTrack = *i;
         float finalWeight = weight_ * stateTrack.weight_;
         
-        // Do not apply if zero effective weight or the bone has animation disabled
-        if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_)
+        // Do not apply if zero effective weight, the bone has animation disabled or is outside the reduced bone set at this distance
+        if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_ || (stateTrack.bone_->animationLodDistance_ > 0.0f &&
+            lodDistance > stateTrack.bone_->animationLodDistance_))
             continue;
         
         if (Equals(finalWeight, 1.0f))
@@ -42,21 +42,8 @@
 namespace Urho3D
 {
 
-inline bool CompareBatchesState(Batch* lhs, Batch* rhs)
-{
-    if (lhs->sortKey_ != rhs->sortKey_)
-        return lhs->sortKey_ < rhs->sortKey_;
-    else
-        return lhs->distance_ < rhs->distance_;
-}
-
-inline bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
-{
-    if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
-}
+static const unsigned MAX_SHADER_SORT_ID = 0x3fff;
+static const unsigned MAX_STATE_SORT_ID = 0xfff;
 
 inline bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
 {
@@ -71,6 +58,128 @@ inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceD
     return lhs.distance_ < rhs.distance_;
 }
 
+/// Return a radix sort key that orders distances the same as comparing them as floats.
+static inline unsigned long long GetDistanceSortKey(float distance)
+{
+    union
+    {
+        float f_;
+        unsigned u_;
+    } value;
+    
+    value.f_ = distance;
+    return (value.u_ & 0x80000000) ? ~value.u_ : (value.u_ | 0x80000000);
+}
+
+/// Return the sort ID of a render state object, assigning the next free ID on first use. IDs saturate at the maximum.
+template <class T> static unsigned GetStateSortID(HashMap<T, unsigned>& remapping, const T& key, unsigned& freeID, unsigned maxID)
+{
+    typename HashMap<T, unsigned>::ConstIterator i = remapping.Find(key);
+    if (i != remapping.End())
+        return i->second_;
+    
+    unsigned id = freeID < maxID ? freeID++ : maxID;
+    remapping[key] = id;
+    return id;
+}
+
+/// Sort batches by their keys with a stable least significant byte first radix sort. Bytes that are equal in all keys are skipped.
+static void RadixSortBatches(PODVector<Batch*>& batches, PODVector<unsigned long long>& keys, PODVector<Batch*>& tempBatches,
+    PODVector<unsigned long long>& tempKeys)
+{
+    unsigned count = batches.Size();
+    if (count < 2)
+        return;
+    
+    unsigned histograms[8][256];
+    memset(histograms, 0, sizeof histograms);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned long long key = keys[i];
+        for (unsigned j = 0; j < 8; ++j)
+            ++histograms[j][(key >> (j * 8)) & 0xff];
+    }
+    
+    tempBatches.Resize(count);
+    tempKeys.Resize(count);
+    Batch** src = &batches[0];
+    Batch** dest = &tempBatches[0];
+    unsigned long long* srcKeys = &keys[0];
+    unsigned long long* destKeys = &tempKeys[0];
+    
+    for (unsigned j = 0; j < 8; ++j)
+    {
+        unsigned shift = j * 8;
+        unsigned* histogram = histograms[j];
+        if (histogram[(srcKeys[0] >> shift) & 0xff] == count)
+            continue;
+        
+        unsigned offset = 0;
+        for (unsigned k = 0; k < 256; ++k)
+        {
+            unsigned bucketCount = histogram[k];
+            histogram[k] = offset;
+            offset += bucketCount;
+        }
+        
+        for (unsigned i = 0; i < count; ++i)
+        {
+            unsigned index = histogram[(srcKeys[i] >> shift) & 0xff]++;
+            dest[index] = src[i];
+            destKeys[index] = srcKeys[i];
+        }
+        
+        Swap(src, dest);
+        Swap(srcKeys, destKeys);
+    }
+    
+    // If the result ended up in the temporary buffers, copy it back
+    if (src != &batches[0])
+    {
+        memcpy(&batches[0], src, count * sizeof(Batch*));
+        memcpy(&keys[0], srcKeys, count * sizeof(unsigned long long));
+    }
+}
+
+/// Return whether an instanced group can be drawn as part of an indirect draw.
+static bool CanDrawIndirect(const BatchGroup* group)
+{
+    Geometry* geometry = group->geometry_;
+    // Texture array groups select the layer by instance ID, which does not include the indirect draw's base instance
+    return group->geometryType_ == GEOM_INSTANCED && group->startIndex_ != M_MAX_UNSIGNED && group->instances_.Size() &&
+        geometry && !geometry->IsEmpty() && geometry->GetIndexBuffer() && !(group->material_ &&
+        group->material_->HasTextureArrays());
+}
+
+/// Return whether two instanced groups set the same render state and buffers, and can be drawn with the same indirect draw.
+static bool IsIndirectCompatible(const BatchGroup* lhs, const BatchGroup* rhs, bool markToStencil)
+{
+    if (lhs->vertexShader_ != rhs->vertexShader_ || lhs->pixelShader_ != rhs->pixelShader_ || lhs->pass_ != rhs->pass_ ||
+        lhs->material_ != rhs->material_ || lhs->camera_ != rhs->camera_ || lhs->zone_ != rhs->zone_ ||
+        lhs->lightQueue_ != rhs->lightQueue_ || (markToStencil && lhs->lightMask_ != rhs->lightMask_))
+        return false;
+    
+    Geometry* lhsGeometry = lhs->geometry_;
+    Geometry* rhsGeometry = rhs->geometry_;
+    if (lhsGeometry->GetPrimitiveType() != rhsGeometry->GetPrimitiveType() || lhsGeometry->GetIndexBuffer() !=
+        rhsGeometry->GetIndexBuffer())
+        return false;
+    
+    const Vector<SharedPtr<VertexBuffer> >& lhsBuffers = lhsGeometry->GetVertexBuffers();
+    const Vector<SharedPtr<VertexBuffer> >& rhsBuffers = rhsGeometry->GetVertexBuffers();
+    const PODVector<unsigned>& lhsMasks = lhsGeometry->GetVertexElementMasks();
+    const PODVector<unsigned>& rhsMasks = rhsGeometry->GetVertexElementMasks();
+    if (lhsBuffers.Size() != rhsBuffers.Size())
+        return false;
+    for (unsigned i = 0; i < lhsBuffers.Size(); ++i)
+    {
+        if (lhsBuffers[i] != rhsBuffers[i] || lhsMasks[i] != rhsMasks[i])
+            return false;
+    }
+    
+    return true;
+}
+
 void CalculateShadowMatrix(Matrix4& dest, LightBatchQueue* queue, unsigned split, Renderer* renderer, const Vector3& translation)
 {
     Camera* shadowCamera = queue->shadowSplits_[split].shadowCamera_;
@@ -229,16 +338,24 @@ void Batch::Prepare(View* view, bool setModelTransform, bool allowDepthWrite) co
     // Set model or skinning transforms
     if (setModelTransform && graphics->NeedParameterUpdate(SP_OBJECT, worldTransform_))
     {
-        if (geometryType_ == GEOM_SKINNED)
+        if (geometryType_ == GEOM_SKINNED || geometryType_ == GEOM_SKINNED_INSTANCED)
         {
-            graphics->SetShaderParameter(VSP_SKINMATRICES, reinterpret_cast<const float*>(worldTransform_), 
-                12 * numWorldTransforms_);
+            if (renderer->GetTextureSkinning())
+            {
+                unsigned offset = renderer->GetSkinMatrixOffset(worldTransform_, numWorldTransforms_);
+                graphics->SetShaderParameter(VSP_SKINMATRIXOFFSET, (float)offset);
+            }
+            else
+            {
+                graphics->SetShaderParameter(VSP_SKINMATRICES, reinterpret_cast<const float*>(worldTransform_), 
+                    12 * numWorldTransforms_);
+            }
         }
         else
             graphics->SetShaderParameter(VSP_MODEL, *worldTransform_);
         
-        // Set the orientation for billboards, either from the object itself or from the camera
-        if (geometryType_ == GEOM_BILLBOARD)
+        // Set the orientation for billboards and GPU particles, either from the object itself or from the camera
+        if (geometryType_ == GEOM_BILLBOARD || geometryType_ == GEOM_PARTICLE || geometryType_ == GEOM_BILLBOARD_INSTANCED)
         {
             if (numWorldTransforms_ > 1)
                 graphics->SetShaderParameter(VSP_BILLBOARDROT, worldTransform_[1].RotationMatrix());
@@ -247,6 +364,10 @@ void Batch::Prepare(View* view, bool setModelTransform, bool allowDepthWrite) co
         }
     }
     
+    // Set the texture array layer of a single draw. Instanced groups set the layers of all instances in BatchGroup::Draw()
+    if (setModelTransform && graphics->HasShaderParameter(VSP_ARRAYLAYERS))
+        graphics->SetShaderParameter(VSP_ARRAYLAYERS, Vector4((float)arrayLayer_, 0.0f, 0.0f, 0.0f));
+    
     // Set zone-related shader parameters
     BlendMode blend = graphics->GetBlendMode();
     // If the pass is additive, override fog color to black so that shaders do not need a separate additive path
@@ -420,21 +541,24 @@ void Batch::Prepare(View* view, bool setModelTransform, bool allowDepthWrite) co
             if (shadowMap)
             {
                 {
-                    // Calculate point light shadow sampling offsets (unrolled cube map)
-                    unsigned faceWidth = shadowMap->GetWidth() / 2;
-                    unsigned faceHeight = shadowMap->GetHeight() / 3;
+                    // Calculate point light shadow sampling offsets (unrolled cube map.) The faces occupy the shadow map area
+                    // of the light, which is smaller than the whole texture when using a shadow atlas
+                    const IntRect& area = lightQueue_->shadowMapArea_;
+                    unsigned faceWidth = area.Width() / 2;
+                    unsigned faceHeight = area.Height() / 3;
                     float width = (float)shadowMap->GetWidth();
                     float height = (float)shadowMap->GetHeight();
                     #ifdef URHO3D_OPENGL
                     float mulX = (float)(faceWidth - 3) / width;
                     float mulY = (float)(faceHeight - 3) / height;
-                    float addX = 1.5f / width;
-                    float addY = 1.5f / height;
+                    float addX = ((float)area.left_ + 1.5f) / width;
+                    // OpenGL texture coordinates are vertically flipped in relation to the viewport
+                    float addY = ((float)(shadowMap->GetHeight() - area.bottom_) + 1.5f) / height;
                     #else
                     float mulX = (float)(faceWidth - 4) / width;
                     float mulY = (float)(faceHeight - 4) / height;
-                    float addX = 2.5f / width;
-                    float addY = 2.5f / height;
+                    float addX = ((float)area.left_ + 2.5f) / width;
+                    float addY = ((float)area.top_ + 2.5f) / height;
                     #endif
                     // If using 4 shadow samples, offset the position diagonally by half pixel
                     if (renderer->GetShadowQuality() & SHADOWQUALITY_HIGH_16BIT)
@@ -443,6 +567,8 @@ void Batch::Prepare(View* view, bool setModelTransform, bool allowDepthWrite) co
                         addY -= 0.5f / height;
                     }
                     graphics->SetShaderParameter(PSP_SHADOWCUBEADJUST, Vector4(mulX, mulY, addX, addY));
+                    graphics->SetShaderParameter(PSP_SHADOWCUBESCALE, Vector2(0.5f * (float)area.Width() / width,
+                        (float)area.Height() / height));
                 }
 
                 {
@@ -546,7 +672,10 @@ void Batch::Prepare(View* view, bool setModelTransform, bool allowDepthWrite) co
     // Set material-specific shader parameters and textures
     if (material_)
     {
-        if (graphics->NeedParameterUpdate(SP_MATERIAL, reinterpret_cast<const void*>(material_->GetShaderParameterHash())))
+        // Bind persistent constant buffers holding the material parameters if possible, else set the parameters individually
+        unsigned parameterHash = material_->GetShaderParameterHash();
+        if (!graphics->SetMaterialConstantBuffers(parameterHash, material_->GetShaderParameters()) &&
+            graphics->NeedParameterUpdate(SP_MATERIAL, reinterpret_cast<const void*>(parameterHash)))
         {
             const HashMap<StringHash, MaterialShaderParameter>& parameters = material_->GetShaderParameters();
             for (HashMap<StringHash, MaterialShaderParameter>::ConstIterator i = parameters.Begin(); i != parameters.End(); ++i)
@@ -586,6 +715,14 @@ void Batch::Prepare(View* view, bool setModelTransform, bool allowDepthWrite) co
     #ifdef DESKTOP_GRAPHICS
     if (zone_ && graphics->HasTextureUnit(TU_ZONE))
         graphics->SetTexture(TU_ZONE, zone_->GetZoneTexture());
+    
+    // Set the bone matrix texture last, as it shares the unit with the volume map. Matrices not gathered by the view yet
+    // are uploaded now
+    if ((geometryType_ == GEOM_SKINNED || geometryType_ == GEOM_SKINNED_INSTANCED) && renderer->GetTextureSkinning())
+    {
+        renderer->UpdateSkinMatrixTexture();
+        graphics->SetTexture(TU_SKINMATRICES, renderer->GetSkinMatrixTexture());
+    }
     #endif
 }
 
@@ -594,7 +731,27 @@ void Batch::Draw(View* view, bool allowDepthWrite) const
     if (!geometry_->IsEmpty())
     {
         Prepare(view, true, allowDepthWrite);
-        geometry_->Draw(view->GetGraphics());
+        
+        if (geometryType_ == GEOM_SKINNED_INSTANCED)
+        {
+            // The instance transforms and poses are read from the bone matrix texture, so no instancing buffer is needed
+            Graphics* graphics = view->GetGraphics();
+            graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
+            graphics->SetVertexBuffers(geometry_->GetVertexBuffers(), geometry_->GetVertexElementMasks());
+            graphics->DrawInstanced(geometry_->GetPrimitiveType(), geometry_->GetIndexStart(), geometry_->GetIndexCount(),
+                geometry_->GetVertexStart(), geometry_->GetVertexCount(), numWorldTransforms_ / 2);
+        }
+        else if (geometryType_ == GEOM_BILLBOARD_INSTANCED)
+        {
+            // The geometry holds a shared quad and the per-billboard instance buffer
+            Graphics* graphics = view->GetGraphics();
+            graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
+            graphics->SetVertexBuffers(geometry_->GetVertexBuffers(), geometry_->GetVertexElementMasks());
+            graphics->DrawInstanced(geometry_->GetPrimitiveType(), geometry_->GetIndexStart(), geometry_->GetIndexCount(),
+                geometry_->GetVertexStart(), geometry_->GetVertexCount(), numInstances_);
+        }
+        else
+            geometry_->Draw(view->GetGraphics());
     }
 }
 
@@ -630,10 +787,13 @@ void BatchGroup::Draw(View* view, bool allowDepthWrite) const
             graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
             graphics->SetVertexBuffers(geometry_->GetVertexBuffers(), geometry_->GetVertexElementMasks());
             
+            bool arrayLayers = graphics->HasShaderParameter(VSP_ARRAYLAYERS);
             for (unsigned i = 0; i < instances_.Size(); ++i)
             {
                 if (graphics->NeedParameterUpdate(SP_OBJECT, instances_[i].worldTransform_))
                     graphics->SetShaderParameter(VSP_MODEL, *instances_[i].worldTransform_);
+                if (arrayLayers)
+                    graphics->SetShaderParameter(VSP_ARRAYLAYERS, Vector4((float)instances_[i].arrayLayer_, 0.0f, 0.0f, 0.0f));
                 
                 graphics->Draw(geometry_->GetPrimitiveType(), geometry_->GetIndexStart(), geometry_->GetIndexCount(),
                     geometry_->GetVertexStart(), geometry_->GetVertexCount());
@@ -652,9 +812,30 @@ void BatchGroup::Draw(View* view, bool allowDepthWrite) const
             elementMasks.Push(instanceBuffer->GetElementMask());
             
             graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
-            graphics->SetVertexBuffers(vertexBuffers, elementMasks, startIndex_);
-            graphics->DrawInstanced(geometry_->GetPrimitiveType(), geometry_->GetIndexStart(), geometry_->GetIndexCount(),
-                geometry_->GetVertexStart(), geometry_->GetVertexCount(), instances_.Size());
+            if (!graphics->HasShaderParameter(VSP_ARRAYLAYERS))
+            {
+                graphics->SetVertexBuffers(vertexBuffers, elementMasks, startIndex_);
+                graphics->DrawInstanced(geometry_->GetPrimitiveType(), geometry_->GetIndexStart(), geometry_->GetIndexCount(),
+                    geometry_->GetVertexStart(), geometry_->GetVertexCount(), instances_.Size());
+            }
+            else
+            {
+                // The shader reads the texture array layer by instance ID, which restarts from zero on each draw call.
+                // Draw in chunks that fit in the layer array
+                float layers[MAX_ARRAY_LAYER_INSTANCES];
+                for (unsigned start = 0; start < instances_.Size(); start += MAX_ARRAY_LAYER_INSTANCES)
+                {
+                    unsigned count = (unsigned)Min((int)(instances_.Size() - start), (int)MAX_ARRAY_LAYER_INSTANCES);
+                    unsigned paddedCount = (count + 3) & ~3;
+                    for (unsigned j = 0; j < paddedCount; ++j)
+                        layers[j] = j < count ? (float)instances_[start + j].arrayLayer_ : 0.0f;
+                    
+                    graphics->SetShaderParameter(VSP_ARRAYLAYERS, layers, paddedCount);
+                    graphics->SetVertexBuffers(vertexBuffers, elementMasks, startIndex_ + start);
+                    graphics->DrawInstanced(geometry_->GetPrimitiveType(), geometry_->GetIndexStart(), geometry_->GetIndexCount(),
+                        geometry_->GetVertexStart(), geometry_->GetVertexCount(), count);
+                }
+            }
             
             // Remove the instancing buffer & element mask now
             vertexBuffers.Pop();
@@ -677,6 +858,7 @@ void BatchQueue::Clear(int maxSortedInstances)
     batches_.Clear();
     sortedBatches_.Clear();
     batchGroups_.Clear();
+    instanceAllocator_.Reset();
     maxSortedInstances_ = maxSortedInstances;
 }
 
@@ -718,7 +900,7 @@ void BatchQueue::SortFrontToBack()
         else
         {
             float minDistance = M_INFINITY;
-            for (PODVector<InstanceData>::ConstIterator j = i->second_.instances_.Begin(); j != i->second_.instances_.End(); ++j)
+            for (LinearVector<InstanceData>::ConstIterator j = i->second_.instances_.Begin(); j != i->second_.instances_.End(); ++j)
                 minDistance = Min(minDistance, j->distance_);
             i->second_.distance_ = minDistance;
         }
@@ -735,62 +917,54 @@ void BatchQueue::SortFrontToBack()
 
 void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
 {
-    // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant. The 2-pass
-    // method is also time consuming, so just sort with state having priority
-    #ifdef GL_ES_VERSION_2_0
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
-    #else
-    // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    Sort(batches.Begin(), batches.End(), CompareBatchesFrontToBack);
+    unsigned count = batches.Size();
+    if (count < 2)
+        return;
+    
+    sortKeys_.Resize(count);
+    
+    // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant, so just sort by
+    // state with the IDs assigned in submission order. For desktop, first sort by distance so that the state IDs are assigned
+    // front to back, and the stable state sort keeps the batches of each state front to back
+    #ifndef GL_ES_VERSION_2_0
+    for (unsigned i = 0; i < count; ++i)
+        sortKeys_[i] = GetDistanceSortKey(batches[i]->distance_);
+    RadixSortBatches(batches, sortKeys_, tempSortedBatches_, tempSortKeys_);
+    #endif
     
     unsigned freeShaderID = 0;
-    unsigned short freeMaterialID = 0;
-    unsigned short freeGeometryID = 0;
+    unsigned freeLightQueueID = 0;
+    unsigned freeMaterialID = 0;
+    unsigned freeVertexBufferID = 0;
+    unsigned freeGeometryID = 0;
     
-    for (PODVector<Batch*>::Iterator i = batches.Begin(); i != batches.End(); ++i)
+    for (unsigned i = 0; i < count; ++i)
     {
-        Batch* batch = *i;
+        Batch* batch = batches[i];
         
-        unsigned shaderID = (batch->sortKey_ >> 32);
-        HashMap<unsigned, unsigned>::ConstIterator j = shaderRemapping_.Find(shaderID);
-        if (j != shaderRemapping_.End())
-            shaderID = j->second_;
-        else
-        {
-            shaderID = shaderRemapping_[shaderID] = freeShaderID | (shaderID & 0xc0000000);
-            ++freeShaderID;
-        }
+        unsigned long long flags = (batch->isBase_ ? 0 : 2) | ((batch->pass_ && batch->pass_->GetAlphaMask()) ? 1 : 0);
+        unsigned long long shaderID = GetStateSortID(shaderRemapping_, MakePair(batch->vertexShader_, batch->pixelShader_),
+            freeShaderID, MAX_SHADER_SORT_ID);
+        unsigned long long lightQueueID = GetStateSortID(lightQueueRemapping_, batch->lightQueue_, freeLightQueueID,
+            MAX_STATE_SORT_ID);
+        unsigned long long materialID = GetStateSortID(materialRemapping_, batch->material_, freeMaterialID, MAX_STATE_SORT_ID);
+        VertexBuffer* vertexBuffer = batch->geometry_ ? batch->geometry_->GetVertexBuffer(0) : 0;
+        unsigned long long vertexBufferID = GetStateSortID(vertexBufferRemapping_, vertexBuffer, freeVertexBufferID,
+            MAX_STATE_SORT_ID);
+        unsigned long long geometryID = GetStateSortID(geometryRemapping_, batch->geometry_, freeGeometryID, MAX_STATE_SORT_ID);
         
-        unsigned short materialID = (unsigned short)(batch->sortKey_ & 0xffff0000);
-        HashMap<unsigned short, unsigned short>::ConstIterator k = materialRemapping_.Find(materialID);
-        if (k != materialRemapping_.End())
-            materialID = k->second_;
-        else
-        {
-            materialID = materialRemapping_[materialID] = freeMaterialID;
-            ++freeMaterialID;
-        }
-        
-        unsigned short geometryID = (unsigned short)(batch->sortKey_ & 0xffff);
-        HashMap<unsigned short, unsigned short>::ConstIterator l = geometryRemapping_.Find(geometryID);
-        if (l != geometryRemapping_.End())
-            geometryID = l->second_;
-        else
-        {
-            geometryID = geometryRemapping_[geometryID] = freeGeometryID;
-            ++freeGeometryID;
-        }
-        
-        batch->sortKey_ = (((unsigned long long)shaderID) << 32) || (((unsigned long long)materialID) << 16) | geometryID;
+        batch->sortKey_ = (flags << 62) | (shaderID << 48) | (lightQueueID << 36) | (materialID << 24) | (vertexBufferID << 12) |
+            geometryID;
+        sortKeys_[i] = batch->sortKey_;
     }
     
     shaderRemapping_.Clear();
+    lightQueueRemapping_.Clear();
     materialRemapping_.Clear();
+    vertexBufferRemapping_.Clear();
     geometryRemapping_.Clear();
     
-    // Finally sort again with the rewritten ID's
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
-    #endif
+    RadixSortBatches(batches, sortKeys_, tempSortedBatches_, tempSortKeys_);
 }
 
 void BatchQueue::SetTransforms(void* lockedData, unsigned& freeIndex)
@@ -814,14 +988,29 @@ void BatchQueue::Draw(View* view, bool markToStencil, bool usingLightOptimizatio
             graphics->SetStencilTest(false);
     }
     
-    // Instanced
-    for (PODVector<BatchGroup*>::ConstIterator i = sortedBatchGroups_.Begin(); i != sortedBatchGroups_.End(); ++i)
+    // Instanced. If supported, consecutive groups that differ only by the geometry's index range, such as the submeshes
+    // of a model, are drawn with one indirect draw call
+    bool indirectDraw = renderer->GetIndirectDraw() && graphics->GetIndirectDrawSupport() && renderer->GetInstancingBuffer();
+    for (unsigned i = 0; i < sortedBatchGroups_.Size();)
     {
-        BatchGroup* group = *i;
+        BatchGroup* group = sortedBatchGroups_[i];
         if (markToStencil)
             graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, group->lightMask_);
         
-        group->Draw(view, allowDepthWrite);
+        unsigned end = i + 1;
+        if (indirectDraw && CanDrawIndirect(group))
+        {
+            while (end < sortedBatchGroups_.Size() && CanDrawIndirect(sortedBatchGroups_[end]) &&
+                IsIndirectCompatible(group, sortedBatchGroups_[end], markToStencil))
+                ++end;
+        }
+        
+        if (end - i > 1)
+            DrawIndirect(view, i, end, allowDepthWrite);
+        else
+            group->Draw(view, allowDepthWrite);
+        
+        i = end;
     }
     // Non-instanced
     for (PODVector<Batch*>::ConstIterator i = sortedBatches_.Begin(); i != sortedBatches_.End(); ++i)
@@ -842,6 +1031,54 @@ void BatchQueue::Draw(View* view, bool markToStencil, bool usingLightOptimizatio
     }
 }
 
+void BatchQueue::DrawIndirect(View* view, unsigned start, unsigned end, bool allowDepthWrite) const
+{
+    Graphics* graphics = view->GetGraphics();
+    VertexBuffer* instanceBuffer = view->GetRenderer()->GetInstancingBuffer();
+    unsigned count = end - start;
+    
+    IndirectDrawCommand* commands = (IndirectDrawCommand*)graphics->ReserveScratchBuffer(count * sizeof(IndirectDrawCommand));
+    if (!commands)
+    {
+        for (unsigned i = start; i < end; ++i)
+            sortedBatchGroups_[i]->Draw(view, allowDepthWrite);
+        return;
+    }
+    
+    // The instance transforms of each group are already in the instancing buffer, so address them by the instance start
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const BatchGroup* group = sortedBatchGroups_[start + i];
+        IndirectDrawCommand& command = commands[i];
+        command.indexCount_ = group->geometry_->GetIndexCount();
+        command.instanceCount_ = group->instances_.Size();
+        command.indexStart_ = group->geometry_->GetIndexStart();
+        command.baseVertex_ = 0;
+        command.instanceStart_ = group->startIndex_;
+    }
+    
+    const BatchGroup* first = sortedBatchGroups_[start];
+    Geometry* geometry = first->geometry_;
+    first->Prepare(view, false, allowDepthWrite);
+    
+    // Get the geometry vertex buffers, then add the instancing stream buffer
+    // Hack: use a const_cast to avoid dynamic allocation of new temp vectors
+    Vector<SharedPtr<VertexBuffer> >& vertexBuffers = const_cast<Vector<SharedPtr<VertexBuffer> >&>(geometry->GetVertexBuffers());
+    PODVector<unsigned>& elementMasks = const_cast<PODVector<unsigned>&>(geometry->GetVertexElementMasks());
+    vertexBuffers.Push(SharedPtr<VertexBuffer>(instanceBuffer));
+    elementMasks.Push(instanceBuffer->GetElementMask());
+    
+    graphics->SetIndexBuffer(geometry->GetIndexBuffer());
+    graphics->SetVertexBuffers(vertexBuffers, elementMasks);
+    graphics->DrawIndirect(geometry->GetPrimitiveType(), commands, count);
+    
+    // Remove the instancing buffer & element mask now
+    vertexBuffers.Pop();
+    elementMasks.Pop();
+    
+    graphics->FreeScratchBuffer(commands);
+}
+
 unsigned BatchQueue::GetNumInstances() const
 {
     unsigned total = 0;
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/LinearAllocator.h"
 #include "../Graphics/Drawable.h"
 #include "../Math/MathDefs.h"
 #include "../Math/Matrix3x4.h"
@@ -39,6 +40,7 @@ class Material;
 class Matrix3x4;
 class Pass;
 class ShaderVariation;
+struct ShadowMapCache;
 class Texture2D;
 class VertexBuffer;
 class View;
@@ -51,7 +53,9 @@ struct Batch
     /// Construct with defaults.
     Batch() :
         lightQueue_(0),
-        isBase_(false)
+        arrayLayer_(0),
+        isBase_(false),
+        clusteredLights_(false)
     {
     }
     
@@ -62,9 +66,12 @@ struct Batch
         material_(rhs.material_),
         worldTransform_(rhs.worldTransform_),
         numWorldTransforms_(rhs.numWorldTransforms_),
+        numInstances_(rhs.numInstances_),
         lightQueue_(0),
+        arrayLayer_(0),
         geometryType_(rhs.geometryType_),
-        isBase_(false)
+        isBase_(false),
+        clusteredLights_(false)
     {
     }
     
@@ -87,6 +94,8 @@ struct Batch
     const Matrix3x4* worldTransform_;
     /// Number of world transforms.
     unsigned numWorldTransforms_;
+    /// Number of hardware instances to draw for an instanced billboard geometry.
+    unsigned numInstances_;
     /// Camera.
     Camera* camera_;
     /// Zone.
@@ -99,10 +108,14 @@ struct Batch
     ShaderVariation* vertexShader_;
     /// Pixel shader.
     ShaderVariation* pixelShader_;
+    /// Texture array layer to sample when the material's textures are texture arrays.
+    unsigned arrayLayer_;
     /// %Geometry type.
     GeometryType geometryType_;
     /// Base batch flag. This tells to draw the object fully without light optimizations.
     bool isBase_;
+    /// Clustered forward lighting flag. Selects the shader variation that shades the view's clustered lights.
+    bool clusteredLights_;
     /// 8-bit light mask for stencil marking in deferred rendering.
     unsigned char lightMask_;
 };
@@ -118,7 +131,8 @@ struct InstanceData
     /// Construct with transform and distance.
     InstanceData(const Matrix3x4* worldTransform, float distance) :
         worldTransform_(worldTransform),
-        distance_(distance)
+        distance_(distance),
+        arrayLayer_(0)
     {
     }
     
@@ -126,6 +140,8 @@ struct InstanceData
     const Matrix3x4* worldTransform_;
     /// Distance from camera.
     float distance_;
+    /// Texture array layer.
+    unsigned arrayLayer_;
 };
 
 /// Instanced 3D geometry draw call.
@@ -154,6 +170,7 @@ struct BatchGroup : public Batch
     {
         InstanceData newInstance;
         newInstance.distance_ = batch.distance_;
+        newInstance.arrayLayer_ = batch.arrayLayer_;
         
         for (unsigned i = 0; i < batch.numWorldTransforms_; ++i)
         {
@@ -167,8 +184,8 @@ struct BatchGroup : public Batch
     /// Prepare and draw.
     void Draw(View* view, bool allowDepthWrite) const;
     
-    /// Instance data.
-    PODVector<InstanceData> instances_;
+    /// Instance data. Allocated from the batch queue's instance allocator.
+    LinearVector<InstanceData> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
 };
@@ -221,12 +238,14 @@ public:
     void SortBackToFront();
     /// Sort instanced and non-instanced draw calls front to back.
     void SortFrontToBack();
-    /// Sort batches front to back while also maintaining state sorting.
+    /// Sort batches by render state with IDs assigned front to back, and front to back within each state. Recalculates the sort keys.
     void SortFrontToBack2Pass(PODVector<Batch*>& batches);
     /// Pre-set instance transforms of all groups. The vertex buffer must be big enough to hold all transforms.
     void SetTransforms(void* lockedData, unsigned& freeIndex);
     /// Draw.
     void Draw(View* view, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const;
+    /// Draw a range of sorted instanced groups that share render state and buffers with one indirect draw call.
+    void DrawIndirect(View* view, unsigned start, unsigned end, bool allowDepthWrite) const;
     /// Return the combined amount of instances.
     unsigned GetNumInstances() const;
     /// Return whether the batch group is empty.
@@ -234,12 +253,22 @@ public:
     
     /// Instanced draw calls.
     HashMap<BatchGroupKey, BatchGroup> batchGroups_;
-    /// Shader remapping table for 2-pass state and distance sort.
-    HashMap<unsigned, unsigned> shaderRemapping_;
-    /// Material remapping table for 2-pass state and distance sort.
-    HashMap<unsigned short, unsigned short> materialRemapping_;
-    /// Geometry remapping table for 2-pass state and distance sort.
-    HashMap<unsigned short, unsigned short> geometryRemapping_;
+    /// Shader pair sort ID table for state and distance sort.
+    HashMap<Pair<ShaderVariation*, ShaderVariation*>, unsigned> shaderRemapping_;
+    /// Light queue sort ID table for state and distance sort.
+    HashMap<LightBatchQueue*, unsigned> lightQueueRemapping_;
+    /// Material sort ID table for state and distance sort.
+    HashMap<Material*, unsigned> materialRemapping_;
+    /// Vertex buffer sort ID table for state and distance sort.
+    HashMap<VertexBuffer*, unsigned> vertexBufferRemapping_;
+    /// Geometry sort ID table for state and distance sort.
+    HashMap<Geometry*, unsigned> geometryRemapping_;
+    /// Radix sort keys.
+    PODVector<unsigned long long> sortKeys_;
+    /// Radix sort temporary keys.
+    PODVector<unsigned long long> tempSortKeys_;
+    /// Radix sort temporary batches.
+    PODVector<Batch*> tempSortedBatches_;
     
     /// Unsorted non-instanced draw calls.
     PODVector<Batch> batches_;
@@ -249,6 +278,8 @@ public:
     PODVector<BatchGroup*> sortedBatchGroups_;
     /// Maximum sorted instances.
     unsigned maxSortedInstances_;
+    /// Allocator for the instance data of the batch groups. Reset when the queue is cleared.
+    LinearAllocator instanceAllocator_;
 };
 
 /// Queue for shadow map draw calls
@@ -260,6 +291,8 @@ struct ShadowBatchQueue
     IntRect shadowViewport_;
     /// Shadow caster draw calls.
     BatchQueue shadowBatches_;
+    /// Static shadow caster draw calls. Only rendered when the shadow map cache needs updating.
+    BatchQueue staticBatches_;
     /// Directional light cascade near split distance.
     float nearSplit_;
     /// Directional light cascade far split distance.
@@ -275,6 +308,10 @@ struct LightBatchQueue
     bool negative_;
     /// Shadow map depth texture.
     Texture2D* shadowMap_;
+    /// Static shadow caster cache. If the shadow map is not the cache's own, the cache is copied to it before rendering the other shadow casters.
+    ShadowMapCache* shadowMapCache_;
+    /// Area of the shadow map texture used by the light. Smaller than the whole texture when using a shadow atlas.
+    IntRect shadowMapArea_;
     /// Lit geometry draw calls, base (replace blend mode)
     BatchQueue litBaseBatches_;
     /// Lit geometry draw calls, non-base (additive)
@@ -285,6 +322,8 @@ struct LightBatchQueue
     PODVector<Light*> vertexLights_;
     /// Light volume draw calls.
     PODVector<Batch> volumeBatches_;
+    /// Index of the instanced light volume group the light belongs to, or M_MAX_UNSIGNED if not instanceable.
+    unsigned volumeGroupIndex_;
 };
 
 }
@@ -44,6 +44,9 @@ namespace Urho3D
 extern const char* GEOMETRY_CATEGORY;
 
 static const float INV_SQRT_TWO = 1.0f / sqrtf(2.0f);
+static const unsigned BILLBOARD_VERTEX_MASK = MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1 | MASK_TEXCOORD2;
+static const unsigned CORNER_VERTEX_MASK = MASK_POSITION | MASK_TEXCOORD1;
+static const unsigned INSTANCE_VERTEX_MASK = MASK_INSTANCEMATRIX1 | MASK_INSTANCEMATRIX2 | MASK_INSTANCEMATRIX3;
 
 const char* faceCameraModeNames[] =
 {
@@ -71,6 +74,8 @@ BillboardSet::BillboardSet(Context* context) :
     geometry_(new Geometry(context)),
     vertexBuffer_(new VertexBuffer(context_)),
     indexBuffer_(new IndexBuffer(context_)),
+    numInstances_(0),
+    instancing_(false),
     bufferSizeDirty_(true),
     bufferDirty_(true),
     forceUpdate_(false),
@@ -78,7 +83,7 @@ BillboardSet::BillboardSet(Context* context) :
     sortFrameNumber_(0),
     previousOffset_(Vector3::ZERO)
 {
-    geometry_->SetVertexBuffer(0, vertexBuffer_, MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1 | MASK_TEXCOORD2);
+    geometry_->SetVertexBuffer(0, vertexBuffer_, BILLBOARD_VERTEX_MASK);
     geometry_->SetIndexBuffer(indexBuffer_);
 
     batches_.Resize(1);
@@ -186,11 +191,33 @@ void BillboardSet::UpdateBatches(const FrameInfo& frame)
     // Billboard rotation
     transforms_[1] = Matrix3x4(Vector3::ZERO, faceCameraMode_ != FC_NONE ? frame.camera_->GetFaceCameraRotation(
         node_->GetWorldPosition(), node_->GetWorldRotation(), faceCameraMode_) : node_->GetWorldRotation(), Vector3::ONE);
+
+    // Choose between hardware instancing and expanded quads. The view copies the geometry type and instance count before
+    // the geometry update, so they are decided here
+    Graphics* graphics = GetSubsystem<Graphics>();
+    bool instancing = graphics && graphics->GetInstancingSupport();
+    if (instancing != instancing_)
+    {
+        instancing_ = instancing;
+        bufferSizeDirty_ = true;
+    }
+    batches_[0].geometryType_ = instancing_ ? GEOM_BILLBOARD_INSTANCED : GEOM_BILLBOARD;
+
+    if (instancing_)
+    {
+        unsigned enabledBillboards = 0;
+        for (unsigned i = 0; i < billboards_.Size(); ++i)
+        {
+            if (billboards_[i].enabled_)
+                ++enabledBillboards;
+        }
+        batches_[0].numInstances_ = enabledBillboards;
+    }
 }
 
 void BillboardSet::UpdateGeometry(const FrameInfo& frame)
 {
-    if (bufferSizeDirty_ || indexBuffer_->IsDataLost())
+    if (bufferSizeDirty_ || indexBuffer_->IsDataLost() || (cornerBuffer_ && cornerBuffer_->IsDataLost()))
         UpdateBufferSize();
 
     if (bufferDirty_ || sortThisFrame_ || vertexBuffer_->IsDataLost())
@@ -207,7 +234,8 @@ void BillboardSet::UpdateGeometry(const FrameInfo& frame)
 UpdateGeometryType BillboardSet::GetUpdateGeometryType()
 {
     // If using camera facing, always need some kind of geometry update, in case the billboard set is rendered from several views
-    if (bufferDirty_ || bufferSizeDirty_ || vertexBuffer_->IsDataLost() || indexBuffer_->IsDataLost() || sortThisFrame_)
+    if (bufferDirty_ || bufferSizeDirty_ || vertexBuffer_->IsDataLost() || indexBuffer_->IsDataLost() ||
+        (cornerBuffer_ && cornerBuffer_->IsDataLost()) || sortThisFrame_)
         return UPDATE_MAIN_THREAD;
     else if (faceCameraMode_ != FC_NONE)
         return UPDATE_WORKER_THREAD;
@@ -412,15 +440,51 @@ void BillboardSet::UpdateBufferSize()
 {
     unsigned numBillboards = billboards_.Size();
 
-    if (vertexBuffer_->GetVertexCount() != numBillboards * 4)
-        vertexBuffer_->SetSize(numBillboards * 4, MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1 | MASK_TEXCOORD2, true);
-    if (indexBuffer_->GetIndexCount() != numBillboards * 6)
-        indexBuffer_->SetSize(numBillboards * 6, false);
-
     bufferSizeDirty_ = false;
     bufferDirty_ = true;
     forceUpdate_ = true;
 
+    // With hardware instancing, each billboard is one instance of a shared quad
+    if (instancing_)
+    {
+        if (!cornerBuffer_)
+            cornerBuffer_ = new VertexBuffer(context_);
+        if (cornerBuffer_->GetVertexCount() != 4)
+            cornerBuffer_->SetSize(4, CORNER_VERTEX_MASK);
+        if (vertexBuffer_->GetVertexCount() != numBillboards || vertexBuffer_->GetElementMask() != INSTANCE_VERTEX_MASK)
+            vertexBuffer_->SetSize(numBillboards, INSTANCE_VERTEX_MASK, true);
+        if (indexBuffer_->GetIndexCount() != 6)
+            indexBuffer_->SetSize(6, false);
+
+        geometry_->SetNumVertexBuffers(2);
+        geometry_->SetVertexBuffer(0, cornerBuffer_, CORNER_VERTEX_MASK);
+        geometry_->SetVertexBuffer(1, vertexBuffer_, INSTANCE_VERTEX_MASK);
+
+        // Corners in the same order and with the same UVs as the non-instanced quads
+        static const float cornerData[] =
+        {
+            -1.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+            1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+            1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+            -1.0f, -1.0f, 0.0f, 0.0f, 1.0f
+        };
+        static const unsigned short cornerIndices[] = { 0, 1, 2, 2, 3, 0 };
+
+        cornerBuffer_->SetData(cornerData);
+        cornerBuffer_->ClearDataLost();
+        indexBuffer_->SetData(cornerIndices);
+        indexBuffer_->ClearDataLost();
+        return;
+    }
+
+    if (vertexBuffer_->GetVertexCount() != numBillboards * 4 || vertexBuffer_->GetElementMask() != BILLBOARD_VERTEX_MASK)
+        vertexBuffer_->SetSize(numBillboards * 4, BILLBOARD_VERTEX_MASK, true);
+    if (indexBuffer_->GetIndexCount() != numBillboards * 6)
+        indexBuffer_->SetSize(numBillboards * 6, false);
+
+    geometry_->SetNumVertexBuffers(1);
+    geometry_->SetVertexBuffer(0, vertexBuffer_, BILLBOARD_VERTEX_MASK);
+
     if (!numBillboards)
         return;
 
@@ -453,8 +517,8 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
             animationLodTimer_ = fmodf(animationLodTimer_, lodDistance_);
         else
         {
-            // No LOD if immediate update forced
-            if (!forceUpdate_)
+            // No LOD if immediate update forced, or if the instance count has changed since the last update
+            if (!forceUpdate_ && (!instancing_ || numInstances_ == batches_[0].numInstances_))
                 return;
         }
     }
@@ -487,7 +551,13 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
         }
     }
 
-    batches_[0].geometry_->SetDrawRange(TRIANGLE_LIST, 0, enabledBillboards * 6, false);
+    if (instancing_)
+    {
+        batches_[0].geometry_->SetDrawRange(TRIANGLE_LIST, 0, enabledBillboards ? 6 : 0, false);
+        numInstances_ = enabledBillboards;
+    }
+    else
+        batches_[0].geometry_->SetDrawRange(TRIANGLE_LIST, 0, enabledBillboards * 6, false);
 
     bufferDirty_ = false;
     forceUpdate_ = false;
@@ -502,6 +572,34 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
         previousOffset_ = (worldPos - frame.camera_->GetNode()->GetWorldPosition());
     }
     
+    if (instancing_)
+    {
+        float* dest = (float*)vertexBuffer_->Lock(0, enabledBillboards, true);
+        if (!dest)
+            return;
+
+        // Position & rotation, size & color packed as two 16-bit channel pairs, and the UV rectangle
+        for (unsigned i = 0; i < enabledBillboards; ++i)
+        {
+            Billboard& billboard = *sortedBillboards_[i];
+            unsigned color = billboard.color_.ToUInt();
+
+            dest[0] = billboard.position_.x_; dest[1] = billboard.position_.y_; dest[2] = billboard.position_.z_;
+            dest[3] = billboard.rotation_;
+            dest[4] = billboard.size_.x_ * billboardScale.x_; dest[5] = billboard.size_.y_ * billboardScale.y_;
+            dest[6] = (float)((color & 0xff) * 256 + ((color >> 8) & 0xff));
+            dest[7] = (float)(((color >> 16) & 0xff) * 256 + (color >> 24));
+            dest[8] = billboard.uv_.min_.x_; dest[9] = billboard.uv_.min_.y_;
+            dest[10] = billboard.uv_.max_.x_; dest[11] = billboard.uv_.max_.y_;
+
+            dest += 12;
+        }
+
+        vertexBuffer_->Unlock();
+        vertexBuffer_->ClearDataLost();
+        return;
+    }
+
     float* dest = (float*)vertexBuffer_->Lock(0, enabledBillboards * 4, true);
     if (!dest)
         return;
@@ -556,4 +654,11 @@ void BillboardSet::MarkPositionsDirty()
     bufferDirty_ = true;
 }
 
+void BillboardSet::MarkBuffersDirty(bool resized)
+{
+    bufferDirty_ = true;
+    if (resized)
+        bufferSizeDirty_ = true;
+}
+
 }
@@ -131,6 +131,8 @@ protected:
     virtual void OnWorldBoundingBoxUpdate();
     /// Mark billboard vertex buffer to need an update.
     void MarkPositionsDirty();
+    /// Mark billboard vertex buffer to need an update without dirtying the bounding box, and also the buffer size if the number of billboards changed. For subclasses that rebuild the billboards in UpdateBatches().
+    void MarkBuffersDirty(bool resized);
 
     /// Billboards.
     PODVector<Billboard> billboards_;
@@ -157,12 +159,18 @@ private:
 
     /// Geometry.
     SharedPtr<Geometry> geometry_;
-    /// Vertex buffer.
+    /// Vertex buffer. When instancing, holds one instance per billboard instead of four vertices.
     SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Shared quad corner vertex buffer for hardware instancing.
+    SharedPtr<VertexBuffer> cornerBuffer_;
     /// Index buffer.
     SharedPtr<IndexBuffer> indexBuffer_;
     /// Transform matrices for position and billboard orientation.
     Matrix3x4 transforms_[2];
+    /// Number of instances in the instance buffer.
+    unsigned numInstances_;
+    /// Hardware instancing in use flag.
+    bool instancing_;
     /// Buffers need resize flag.
     bool bufferSizeDirty_;
     /// Vertex buffer needs rewrite flag.
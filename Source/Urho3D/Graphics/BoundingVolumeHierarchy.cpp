@@ -0,0 +1,311 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Graphics/BoundingVolumeHierarchy.h"
+#include "../Graphics/DebugRenderer.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/OctreeQuery.h"
+#include "../Container/Swap.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned BVH_LEAF_SIZE = 4;
+static const float BVH_DEGRADED_AREA_RATIO = 2.0f;
+
+static inline float GetSurfaceArea(const BoundingBox& box)
+{
+    Vector3 size = box.Size();
+    return size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_;
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy() :
+    numDegradedNodes_(0)
+{
+}
+
+void BoundingVolumeHierarchy::Build(const PODVector<Drawable*>& drawables)
+{
+    Clear();
+
+    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if (drawable->IsOccludee())
+        {
+            drawables_.Push(drawable);
+            centers_.Push(drawable->GetWorldBoundingBox().Center());
+        }
+        else
+            unculledDrawables_.Push(drawable);
+    }
+
+    if (!drawables_.Empty())
+    {
+        nodes_.Resize(1);
+        BuildNode(0, M_MAX_UNSIGNED, 0, drawables_.Size());
+        dirtyNodes_.Resize(nodes_.Size());
+        for (unsigned i = 0; i < dirtyNodes_.Size(); ++i)
+            dirtyNodes_[i] = 0;
+    }
+
+    centers_.Clear();
+}
+
+bool BoundingVolumeHierarchy::Refit(const PODVector<Drawable*>& drawables)
+{
+    if (nodes_.Empty())
+        return true;
+
+    bool rebuild = false;
+
+    // Mark the leaves of moved drawables and their parents dirty
+    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+    {
+        HashMap<Drawable*, unsigned>::ConstIterator j = leafIndices_.Find(*i);
+        if (j == leafIndices_.End())
+            continue;
+        // A drawable that stopped being an occludee must move outside the hierarchy
+        if (!(*i)->IsOccludee())
+            rebuild = true;
+
+        unsigned index = j->second_;
+        while (index != M_MAX_UNSIGNED && !dirtyNodes_[index])
+        {
+            dirtyNodes_[index] = 1;
+            index = nodes_[index].parent_;
+        }
+    }
+
+    // Children are stored after their parent, so refit in reverse order
+    for (unsigned i = nodes_.Size() - 1; i < nodes_.Size(); --i)
+    {
+        if (dirtyNodes_[i])
+        {
+            UpdateNodeBox(nodes_[i]);
+            dirtyNodes_[i] = 0;
+        }
+    }
+
+    // Rebuild when a quarter of the nodes have grown much larger than when built
+    return !rebuild && numDegradedNodes_ * 4 <= nodes_.Size();
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    nodes_.Clear();
+    drawables_.Clear();
+    unculledDrawables_.Clear();
+    centers_.Clear();
+    dirtyNodes_.Clear();
+    leafIndices_.Clear();
+    numDegradedNodes_ = 0;
+}
+
+void BoundingVolumeHierarchy::GetDrawables(OctreeQuery& query) const
+{
+    if (unculledDrawables_.Size())
+    {
+        Drawable** start = const_cast<Drawable**>(&unculledDrawables_[0]);
+        query.TestDrawables(start, start + unculledDrawables_.Size(), false);
+    }
+
+    if (nodes_.Size())
+        GetDrawablesInternal(query, 0, false);
+}
+
+void BoundingVolumeHierarchy::GetDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    for (PODVector<Drawable*>::ConstIterator i = unculledDrawables_.Begin(); i != unculledDrawables_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawables.Push(drawable);
+    }
+
+    if (nodes_.Size())
+        GetDrawablesInternal(query, 0, drawables);
+}
+
+void BoundingVolumeHierarchy::DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const
+{
+    if (!debug)
+        return;
+
+    for (PODVector<BVHNode>::ConstIterator i = nodes_.Begin(); i != nodes_.End(); ++i)
+    {
+        if (i->count_ && debug->IsInside(i->box_))
+            debug->AddBoundingBox(i->box_, Color(0.25f, 0.25f, 0.25f), depthTest);
+    }
+}
+
+void BoundingVolumeHierarchy::BuildNode(unsigned index, unsigned parent, unsigned start, unsigned end)
+{
+    BoundingBox centerBox;
+    for (unsigned i = start; i < end; ++i)
+        centerBox.Merge(centers_[i]);
+
+    unsigned count = end - start;
+    nodes_[index].parent_ = parent;
+    nodes_[index].box_.Clear();
+    nodes_[index].buildArea_ = M_INFINITY;
+
+    if (count <= BVH_LEAF_SIZE)
+    {
+        nodes_[index].first_ = start;
+        nodes_[index].count_ = count;
+        for (unsigned i = start; i < end; ++i)
+            leafIndices_[drawables_[i]] = index;
+        UpdateNodeBox(nodes_[index]);
+        nodes_[index].buildArea_ = GetSurfaceArea(nodes_[index].box_);
+        return;
+    }
+
+    // Split at the median along the longest axis of the centers to keep the hierarchy balanced
+    Vector3 size = centerBox.Size();
+    unsigned axis = 0;
+    if (size.y_ > size.x_)
+        axis = 1;
+    if (size.z_ > size.Data()[axis])
+        axis = 2;
+
+    unsigned mid = start + count / 2;
+    SelectNth(start, end, mid, axis);
+
+    // Allocate both children at once. Note that this may reallocate the node vector
+    unsigned child = nodes_.Size();
+    nodes_.Resize(child + 2);
+    nodes_[index].first_ = child;
+    nodes_[index].count_ = 0;
+    BuildNode(child, index, start, mid);
+    BuildNode(child + 1, index, mid, end);
+
+    UpdateNodeBox(nodes_[index]);
+    nodes_[index].buildArea_ = GetSurfaceArea(nodes_[index].box_);
+}
+
+void BoundingVolumeHierarchy::SelectNth(unsigned start, unsigned end, unsigned nth, unsigned axis)
+{
+    int low = start;
+    int high = end - 1;
+
+    while (low < high)
+    {
+        float pivot = centers_[(low + high) / 2].Data()[axis];
+        int i = low - 1;
+        int j = high + 1;
+
+        // Hoare partition: afterward [low, j] are not greater and [j + 1, high] are not less than the pivot
+        for (;;)
+        {
+            do
+                ++i;
+            while (centers_[i].Data()[axis] < pivot);
+            do
+                --j;
+            while (centers_[j].Data()[axis] > pivot);
+
+            if (i >= j)
+                break;
+
+            Swap(centers_[i], centers_[j]);
+            Swap(drawables_[i], drawables_[j]);
+        }
+
+        if ((int)nth <= j)
+            high = j;
+        else
+            low = j + 1;
+    }
+}
+
+void BoundingVolumeHierarchy::UpdateNodeBox(BVHNode& node)
+{
+    bool wasDegraded = node.box_.defined_ && GetSurfaceArea(node.box_) > node.buildArea_ * BVH_DEGRADED_AREA_RATIO;
+
+    if (node.count_)
+    {
+        node.box_.Clear();
+        for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+            node.box_.Merge(drawables_[i]->GetWorldBoundingBox());
+    }
+    else
+    {
+        node.box_ = nodes_[node.first_].box_;
+        node.box_.Merge(nodes_[node.first_ + 1].box_);
+    }
+
+    bool degraded = GetSurfaceArea(node.box_) > node.buildArea_ * BVH_DEGRADED_AREA_RATIO;
+    if (degraded && !wasDegraded)
+        ++numDegradedNodes_;
+    else if (!degraded && wasDegraded)
+        --numDegradedNodes_;
+}
+
+void BoundingVolumeHierarchy::GetDrawablesInternal(OctreeQuery& query, unsigned index, bool inside) const
+{
+    const BVHNode& node = nodes_[index];
+
+    Intersection res = query.TestOctant(node.box_, inside);
+    if (res == INSIDE)
+        inside = true;
+    else if (res == OUTSIDE)
+        return;
+
+    if (node.count_)
+    {
+        Drawable** start = const_cast<Drawable**>(&drawables_[node.first_]);
+        query.TestDrawables(start, start + node.count_, inside);
+    }
+    else
+    {
+        GetDrawablesInternal(query, node.first_, inside);
+        GetDrawablesInternal(query, node.first_ + 1, inside);
+    }
+}
+
+void BoundingVolumeHierarchy::GetDrawablesInternal(RayOctreeQuery& query, unsigned index, PODVector<Drawable*>& drawables) const
+{
+    const BVHNode& node = nodes_[index];
+
+    if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+        return;
+
+    if (node.count_)
+    {
+        for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+        {
+            Drawable* drawable = drawables_[i];
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                drawables.Push(drawable);
+        }
+    }
+    else
+    {
+        GetDrawablesInternal(query, node.first_, drawables);
+        GetDrawablesInternal(query, node.first_ + 1, drawables);
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+class DebugRenderer;
+class Drawable;
+class OctreeQuery;
+class RayOctreeQuery;
+
+/// Bounding volume hierarchy node.
+struct BVHNode
+{
+    /// World bounding box of the node and its drawables.
+    BoundingBox box_;
+    /// Index of the first child node, or of the first drawable for a leaf node.
+    unsigned first_;
+    /// Number of drawables for a leaf node, zero for an internal node.
+    unsigned count_;
+    /// Parent node index, M_MAX_UNSIGNED for the root node.
+    unsigned parent_;
+    /// Surface area of the bounding box when built.
+    float buildArea_;
+};
+
+/// Bounding volume hierarchy of drawables, used by Octree as an alternative spatial index. Refitted incrementally as drawables move.
+class URHO3D_API BoundingVolumeHierarchy
+{
+public:
+    /// Construct empty.
+    BoundingVolumeHierarchy();
+
+    /// Build from drawables. Drawables that are not occludees are kept outside the hierarchy and are always tested, so that occlusion of a node can not hide them.
+    void Build(const PODVector<Drawable*>& drawables);
+    /// Refit the node bounding boxes of moved drawables. Return false if the hierarchy has degraded and should be rebuilt.
+    bool Refit(const PODVector<Drawable*>& drawables);
+    /// Remove all drawables and nodes.
+    void Clear();
+
+    /// Return drawable objects by a query.
+    void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects whose nodes a ray query hits.
+    void GetDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Draw leaf node bounds to the debug graphics.
+    void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const;
+    /// Return number of nodes.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+
+private:
+    /// Build a node from a range of drawables recursively.
+    void BuildNode(unsigned index, unsigned parent, unsigned start, unsigned end);
+    /// Partially sort a range of drawables so that the nth one is at its sorted position along an axis.
+    void SelectNth(unsigned start, unsigned end, unsigned nth, unsigned axis);
+    /// Recalculate the bounding box of a node from its drawables or child nodes and track whether it has degraded.
+    void UpdateNodeBox(BVHNode& node);
+    /// Return drawable objects by a query recursively.
+    void GetDrawablesInternal(OctreeQuery& query, unsigned index, bool inside) const;
+    /// Return drawable objects by a ray query recursively.
+    void GetDrawablesInternal(RayOctreeQuery& query, unsigned index, PODVector<Drawable*>& drawables) const;
+
+    /// Nodes. Children are always stored after their parent.
+    PODVector<BVHNode> nodes_;
+    /// Drawables in leaf node order.
+    PODVector<Drawable*> drawables_;
+    /// Drawables outside the hierarchy.
+    PODVector<Drawable*> unculledDrawables_;
+    /// Drawable bounding box centers during build.
+    PODVector<Vector3> centers_;
+    /// Node dirty flags during refit.
+    PODVector<unsigned char> dirtyNodes_;
+    /// Leaf node index for each drawable in the hierarchy.
+    HashMap<Drawable*, unsigned> leafIndices_;
+    /// Number of nodes whose surface area has grown too much since build.
+    unsigned numDegradedNodes_;
+};
+
+}
@@ -0,0 +1,778 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Graphics/Camera.h"
+#include "../Graphics/CDLODTerrain.h"
+#include "../Core/Context.h"
+#include "../IO/File.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../IO/Log.h"
+#include "../Graphics/Material.h"
+#include "../Scene/Node.h"
+#include "../Core/Profiler.h"
+#include "../Resource/ResourceCache.h"
+#include "../Container/Sort.h"
+#include "../Graphics/Texture2D.h"
+#include "../Graphics/VertexBuffer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* GEOMETRY_CATEGORY;
+
+static const Vector3 DEFAULT_SPACING(1.0f, 0.25f, 1.0f);
+static const int DEFAULT_GRID_SIZE = 64;
+static const int MIN_GRID_SIZE = 2;
+static const int MAX_GRID_SIZE = 128;
+static const float DEFAULT_LOD_RANGE_FACTOR = 3.0f;
+static const float DEFAULT_MORPH_START = 0.7f;
+static const unsigned DEFAULT_MAX_TILES = 128;
+static const unsigned DEFAULT_MAX_TILE_LOADS = 2;
+/// Nodes per height tile side. Must be even so that the children of a node share a tile.
+static const int TILE_NODES = 4;
+/// Grid vertex layout: position in the 0-1 range over the node, upward normal and texture coordinate.
+static const unsigned GRID_VERTEX_MASK = MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1;
+
+static inline bool CompareTileKeys(unsigned lhs, unsigned rhs)
+{
+    // The level is in the highest bits, so the coarsest tiles are requested first
+    return lhs > rhs;
+}
+
+CDLODTerrain::CDLODTerrain(Context* context) :
+    Drawable(context, DRAWABLE_GEOMETRY),
+    vertexBuffer_(new VertexBuffer(context)),
+    indexBuffer_(new IndexBuffer(context)),
+    numVertices_(IntVector2::ZERO),
+    numNodes_(IntVector2::ZERO),
+    origin_(Vector3::ZERO),
+    spacing_(DEFAULT_SPACING),
+    gridSize_(DEFAULT_GRID_SIZE),
+    numLevels_(0),
+    lodRangeFactor_(DEFAULT_LOD_RANGE_FACTOR),
+    morphStart_(DEFAULT_MORPH_START),
+    maxTiles_(DEFAULT_MAX_TILES),
+    maxTileLoads_(DEFAULT_MAX_TILE_LOADS),
+    recreateTerrain_(false),
+    tileParametersDirty_(false)
+{
+    vertexBuffer_->SetShadowed(true);
+    for (unsigned i = 0; i < 5; ++i)
+    {
+        geometries_[i] = new Geometry(context);
+        geometries_[i]->SetVertexBuffer(0, vertexBuffer_, GRID_VERTEX_MASK);
+        geometries_[i]->SetIndexBuffer(indexBuffer_);
+    }
+}
+
+CDLODTerrain::~CDLODTerrain()
+{
+}
+
+void CDLODTerrain::RegisterObject(Context* context)
+{
+    context->RegisterFactory<CDLODTerrain>(GEOMETRY_CATEGORY);
+
+    ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    ATTRIBUTE("Height File", String, heightFileName_, String::EMPTY, AM_DEFAULT);
+    ATTRIBUTE("Height File Size", IntVector2, numVertices_, IntVector2::ZERO, AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Material", GetMaterialAttr, SetMaterialAttr, ResourceRef, ResourceRef(Material::GetTypeStatic()), AM_DEFAULT);
+    ATTRIBUTE("Vertex Spacing", Vector3, spacing_, DEFAULT_SPACING, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Grid Size", GetGridSize, SetGridSizeAttr, int, DEFAULT_GRID_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("LOD Range Factor", GetLodRangeFactor, SetLodRangeFactor, float, DEFAULT_LOD_RANGE_FACTOR, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Morph Start", GetMorphStart, SetMorphStart, float, DEFAULT_MORPH_START, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Max Tiles", GetMaxTiles, SetMaxTiles, unsigned, DEFAULT_MAX_TILES, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Max Tile Loads", GetMaxTileLoads, SetMaxTileLoads, unsigned, DEFAULT_MAX_TILE_LOADS, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cast Shadows", GetCastShadows, SetCastShadows, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
+    COPY_BASE_ATTRIBUTES(Drawable);
+}
+
+void CDLODTerrain::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
+{
+    Serializable::OnSetAttribute(attr, src);
+
+    // Change of the heightmap file, its size or the spacing requires recreation of the terrain
+    if (!attr.accessor_)
+        recreateTerrain_ = true;
+}
+
+void CDLODTerrain::ApplyAttributes()
+{
+    if (recreateTerrain_)
+        CreateTerrain();
+}
+
+void CDLODTerrain::UpdateBatches(const FrameInfo& frame)
+{
+    distance_ = frame.camera_->GetDistance(GetWorldBoundingBox().Center());
+    batches_.Clear();
+    if (!numLevels_)
+        return;
+
+    // Select in terrain space. The LOD ranges assume uniform scaling, like the geomorph in the vertex shader
+    Matrix3x4 inverse = node_->GetWorldTransform().Inverse();
+    selectionCameraPos_ = inverse * frame.camera_->GetNode()->GetWorldPosition();
+    selectionFrustum_ = frame.camera_->GetFrustum().Transformed(inverse);
+
+    unsigned topLevel = numLevels_ - 1;
+    IntVector2 numRoots = GetNumNodes(topLevel);
+    for (int z = 0; z < numRoots.y_; ++z)
+    {
+        for (int x = 0; x < numRoots.x_; ++x)
+        {
+            // Roots beyond their LOD range are still drawn, as there is no coarser level
+            if (!SelectNode(topLevel, x, z, frame))
+                AddNodeBatch(topLevel, x, z, 0, frame);
+        }
+    }
+}
+
+void CDLODTerrain::UpdateGeometry(const FrameInfo& frame)
+{
+    PROFILE(UpdateCDLODTerrain);
+
+    if (tileParametersDirty_)
+    {
+        for (HashMap<unsigned, CDLODTile>::Iterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+            UpdateTileParameters(i->first_, i->second_);
+        tileParametersDirty_ = false;
+    }
+
+    if (tileRequests_.Size())
+    {
+        Sort(tileRequests_.Begin(), tileRequests_.End(), CompareTileKeys);
+        unsigned numLoads = Min((int)maxTileLoads_, (int)tileRequests_.Size());
+        for (unsigned i = 0; i < numLoads; ++i)
+            LoadTile(tileRequests_[i]);
+        // Requests that did not fit in the budget are repeated by the next selection
+        tileRequests_.Clear();
+
+        EvictTiles(frame.frameNumber_);
+    }
+}
+
+UpdateGeometryType CDLODTerrain::GetUpdateGeometryType()
+{
+    return (tileRequests_.Size() || tileParametersDirty_) ? UPDATE_MAIN_THREAD : UPDATE_NONE;
+}
+
+bool CDLODTerrain::SetHeightFile(const String& fileName, const IntVector2& size)
+{
+    heightFileName_ = fileName;
+    numVertices_ = size;
+    CreateTerrain();
+    MarkNetworkUpdate();
+
+    return numLevels_ > 0;
+}
+
+void CDLODTerrain::SetSpacing(const Vector3& spacing)
+{
+    if (spacing != spacing_)
+    {
+        spacing_ = spacing;
+
+        CreateTerrain();
+        MarkNetworkUpdate();
+    }
+}
+
+void CDLODTerrain::SetGridSize(int size)
+{
+    if (size < MIN_GRID_SIZE || size > MAX_GRID_SIZE || !IsPowerOfTwo(size))
+        return;
+
+    if (size != gridSize_)
+    {
+        gridSize_ = size;
+
+        CreateTerrain();
+        MarkNetworkUpdate();
+    }
+}
+
+void CDLODTerrain::SetLodRangeFactor(float factor)
+{
+    // Below two a node could border nodes two levels coarser, which the geomorph can not stitch
+    lodRangeFactor_ = Max(factor, 2.0f);
+    tileParametersDirty_ = true;
+    MarkNetworkUpdate();
+}
+
+void CDLODTerrain::SetMorphStart(float start)
+{
+    morphStart_ = Clamp(start, 0.0f, 0.99f);
+    tileParametersDirty_ = true;
+    MarkNetworkUpdate();
+}
+
+void CDLODTerrain::SetMaxTiles(unsigned num)
+{
+    maxTiles_ = num;
+    MarkNetworkUpdate();
+}
+
+void CDLODTerrain::SetMaxTileLoads(unsigned num)
+{
+    maxTileLoads_ = Max((int)num, 1);
+    MarkNetworkUpdate();
+}
+
+void CDLODTerrain::SetMaterial(Material* material)
+{
+    material_ = material;
+
+    // Each tile has its own copy of the material to hold the height texture
+    for (HashMap<unsigned, CDLODTile>::Iterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+    {
+        CDLODTile& tile = i->second_;
+        tile.material_ = material_ ? material_->Clone() : SharedPtr<Material>(new Material(context_));
+        #ifdef DESKTOP_GRAPHICS
+        tile.material_->SetTexture(TU_HEIGHTMAP, tile.texture_);
+        #endif
+        UpdateTileParameters(i->first_, tile);
+    }
+
+    MarkNetworkUpdate();
+}
+
+float CDLODTerrain::GetHeight(const Vector3& worldPosition) const
+{
+    if (!numLevels_ || !node_)
+        return 0.0f;
+
+    Vector3 position = node_->GetWorldTransform().Inverse() * worldPosition;
+    float fx = (position.x_ - origin_.x_) / spacing_.x_;
+    float fz = (position.z_ - origin_.z_) / spacing_.z_;
+    fx = Clamp(fx, 0.0f, (float)(numVertices_.x_ - 1));
+    fz = Clamp(fz, 0.0f, (float)(numVertices_.y_ - 1));
+
+    // Find the finest resident tile. The coarsest level is always resident
+    int tileVertices = TILE_NODES * gridSize_;
+    int samples = tileVertices + 3;
+    for (unsigned level = 0; level < numLevels_; ++level)
+    {
+        float step = (float)(1 << level);
+        // Position within the tile in texels, excluding the border
+        float lx = fx / step;
+        float lz = fz / step;
+        int tx = Min((int)lx / tileVertices, (GetNumNodes(level).x_ - 1) / TILE_NODES);
+        int tz = Min((int)lz / tileVertices, (GetNumNodes(level).y_ - 1) / TILE_NODES);
+        HashMap<unsigned, CDLODTile>::ConstIterator i = tiles_.Find(GetTileKey(level, tx * TILE_NODES, tz * TILE_NODES));
+        if (i == tiles_.End())
+            continue;
+
+        lx -= tx * tileVertices - 1;
+        lz -= tz * tileVertices - 1;
+        int x = Min((int)lx, samples - 2);
+        int z = Min((int)lz, samples - 2);
+        float xFrac = lx - x;
+        float zFrac = lz - z;
+        const float* heights = i->second_.heights_.Get() + z * samples + x;
+        float h0 = Lerp(heights[0], heights[1], xFrac);
+        float h1 = Lerp(heights[samples], heights[samples + 1], xFrac);
+        // Return world-space height
+        Vector3 local(position.x_, Lerp(h0, h1, zFrac), position.z_);
+        return (node_->GetWorldTransform() * local).y_;
+    }
+
+    return 0.0f;
+}
+
+void CDLODTerrain::SetGridSizeAttr(int size)
+{
+    if (size < MIN_GRID_SIZE || size > MAX_GRID_SIZE || !IsPowerOfTwo(size))
+        return;
+
+    if (size != gridSize_)
+    {
+        gridSize_ = size;
+        recreateTerrain_ = true;
+    }
+}
+
+void CDLODTerrain::SetMaterialAttr(const ResourceRef& value)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    SetMaterial(cache->GetResource<Material>(value.name_));
+}
+
+ResourceRef CDLODTerrain::GetMaterialAttr() const
+{
+    return GetResourceRef(material_, Material::GetTypeStatic());
+}
+
+void CDLODTerrain::OnMarkedDirty(Node* node)
+{
+    Drawable::OnMarkedDirty(node);
+
+    // The tile shader parameters map world positions to the height textures
+    if (node == node_ && numLevels_)
+        tileParametersDirty_ = true;
+}
+
+void CDLODTerrain::OnWorldBoundingBoxUpdate()
+{
+    worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+}
+
+void CDLODTerrain::CreateTerrain()
+{
+    PROFILE(CreateCDLODTerrain);
+
+    ReleaseTerrain();
+    recreateTerrain_ = false;
+
+    if (heightFileName_.Empty())
+        return;
+
+    Graphics* graphics = GetSubsystem<Graphics>();
+    if (!graphics)
+        return;
+    if (!graphics->GetVertexTextureSupport())
+    {
+        LOGERROR("CDLOD terrain requires vertex texture fetch support");
+        return;
+    }
+
+    int width = numVertices_.x_;
+    int height = numVertices_.y_;
+    if (width <= gridSize_ || height <= gridSize_ || (width - 1) % gridSize_ || (height - 1) % gridSize_)
+    {
+        LOGERROR("CDLOD terrain heightmap size minus one must be a multiple of the grid size");
+        return;
+    }
+    if ((width - 1) / gridSize_ > (TILE_NODES << 14) || (height - 1) / gridSize_ > (TILE_NODES << 14))
+    {
+        LOGERROR("CDLOD terrain heightmap is too large for the grid size");
+        return;
+    }
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    heightFile_ = cache->GetFile(heightFileName_);
+    if (!heightFile_)
+        return;
+    if (heightFile_->GetSize() < (unsigned)width * (unsigned)height * sizeof(unsigned short))
+    {
+        LOGERROR("CDLOD terrain heightmap file " + heightFileName_ + " is smaller than the heightmap size");
+        heightFile_.Reset();
+        return;
+    }
+
+    // Add levels as long as the nodes divide evenly into the coarser level
+    numNodes_ = IntVector2((width - 1) / gridSize_, (height - 1) / gridSize_);
+    numLevels_ = 1;
+    while (numLevels_ < MAX_CDLOD_LEVELS && !(numNodes_.x_ % (1 << numLevels_)) && !(numNodes_.y_ % (1 << numLevels_)))
+        ++numLevels_;
+
+    for (unsigned i = 0; i < numLevels_; ++i)
+    {
+        IntVector2 numNodes = GetNumNodes(i);
+        heightRanges_[i].Resize(numNodes.x_ * numNodes.y_);
+        nodeTransforms_[i].Resize(numNodes.x_ * numNodes.y_);
+    }
+
+    origin_ = Vector3(-0.5f * (width - 1) * spacing_.x_, 0.0f, -0.5f * (height - 1) * spacing_.z_);
+    if (!ReadHeightRanges())
+    {
+        ReleaseTerrain();
+        return;
+    }
+
+    CreateGrid();
+
+    // Load the coarsest level tiles, which are always resident
+    unsigned topLevel = numLevels_ - 1;
+    IntVector2 numRoots = GetNumNodes(topLevel);
+    for (int z = 0; z < numRoots.y_; z += TILE_NODES)
+    {
+        for (int x = 0; x < numRoots.x_; x += TILE_NODES)
+            LoadTile(GetTileKey(topLevel, x, z));
+    }
+
+    if (node_)
+        OnMarkedDirty(node_);
+}
+
+void CDLODTerrain::ReleaseTerrain()
+{
+    heightFile_.Reset();
+    tiles_.Clear();
+    tileRequests_.Clear();
+    batches_.Clear();
+    for (unsigned i = 0; i < MAX_CDLOD_LEVELS; ++i)
+    {
+        heightRanges_[i].Clear();
+        nodeTransforms_[i].Clear();
+    }
+    numNodes_ = IntVector2::ZERO;
+    numLevels_ = 0;
+    boundingBox_ = BoundingBox();
+    tileParametersDirty_ = false;
+
+    if (node_)
+        OnMarkedDirty(node_);
+}
+
+void CDLODTerrain::CreateGrid()
+{
+    unsigned row = (unsigned)gridSize_ + 1;
+    float invSize = 1.0f / gridSize_;
+
+    PODVector<float> vertices;
+    vertices.Reserve(row * row * 8);
+    for (unsigned z = 0; z < row; ++z)
+    {
+        for (unsigned x = 0; x < row; ++x)
+        {
+            float u = x * invSize;
+            float v = z * invSize;
+            vertices.Push(u);
+            vertices.Push(0.0f);
+            vertices.Push(v);
+            vertices.Push(0.0f);
+            vertices.Push(1.0f);
+            vertices.Push(0.0f);
+            vertices.Push(u);
+            vertices.Push(v);
+        }
+    }
+
+    // Indices are ordered by quadrant so that a node can also be drawn partially
+    PODVector<unsigned short> indices;
+    unsigned half = (unsigned)gridSize_ / 2;
+    for (unsigned q = 0; q < 4; ++q)
+    {
+        unsigned xStart = (q & 1) * half;
+        unsigned zStart = (q >> 1) * half;
+        for (unsigned z = zStart; z < zStart + half; ++z)
+        {
+            for (unsigned x = xStart; x < xStart + half; ++x)
+            {
+                indices.Push((z + 1) * row + x);
+                indices.Push(z * row + x + 1);
+                indices.Push(z * row + x);
+                indices.Push((z + 1) * row + x);
+                indices.Push((z + 1) * row + x + 1);
+                indices.Push(z * row + x + 1);
+            }
+        }
+    }
+
+    vertexBuffer_->SetSize(row * row, GRID_VERTEX_MASK);
+    vertexBuffer_->SetData(&vertices[0]);
+    indexBuffer_->SetSize(indices.Size(), false);
+    indexBuffer_->SetData(&indices[0]);
+
+    unsigned quadrantIndices = indices.Size() / 4;
+    geometries_[0]->SetDrawRange(TRIANGLE_LIST, 0, indices.Size(), 0, row * row);
+    for (unsigned q = 0; q < 4; ++q)
+        geometries_[q + 1]->SetDrawRange(TRIANGLE_LIST, q * quadrantIndices, quadrantIndices, 0, row * row);
+}
+
+bool CDLODTerrain::ReadHeightRanges()
+{
+    int width = numVertices_.x_;
+    int height = numVertices_.y_;
+    float heightScale = spacing_.y_ / 256.0f;
+
+    PODVector<Vector2>& leafRanges = heightRanges_[0];
+    for (unsigned i = 0; i < leafRanges.Size(); ++i)
+        leafRanges[i] = Vector2(M_INFINITY, -M_INFINITY);
+
+    // Stream the heightmap one row at a time instead of holding all of it in memory
+    PODVector<unsigned short> row(width);
+    PODVector<Vector2> rowRanges(numNodes_.x_);
+    heightFile_->Seek(0);
+    for (int i = 0; i < height; ++i)
+    {
+        if (heightFile_->Read(&row[0], width * sizeof(unsigned short)) != (unsigned)width * sizeof(unsigned short))
+        {
+            LOGERROR("Failed to read CDLOD terrain heightmap file " + heightFileName_);
+            return false;
+        }
+
+        for (int x = 0; x < numNodes_.x_; ++x)
+        {
+            int minHeight = 65535;
+            int maxHeight = 0;
+            for (int j = x * gridSize_; j <= (x + 1) * gridSize_; ++j)
+            {
+                minHeight = Min(minHeight, row[j]);
+                maxHeight = Max(maxHeight, row[j]);
+            }
+            rowRanges[x] = Vector2(minHeight * heightScale, maxHeight * heightScale);
+        }
+
+        // North is at the top of the heightmap, but at the end of the terrain-space Z axis. Edge rows belong to two nodes
+        int z = height - 1 - i;
+        for (int nodeZ = Max(z - 1, 0) / gridSize_; nodeZ <= Min(z / gridSize_, numNodes_.y_ - 1); ++nodeZ)
+        {
+            Vector2* ranges = &leafRanges[nodeZ * numNodes_.x_];
+            for (int x = 0; x < numNodes_.x_; ++x)
+                ranges[x] = Vector2(Min(ranges[x].x_, rowRanges[x].x_), Max(ranges[x].y_, rowRanges[x].y_));
+        }
+    }
+
+    for (unsigned level = 1; level < numLevels_; ++level)
+    {
+        IntVector2 numNodes = GetNumNodes(level);
+        IntVector2 numChildren = GetNumNodes(level - 1);
+        for (int z = 0; z < numNodes.y_; ++z)
+        {
+            for (int x = 0; x < numNodes.x_; ++x)
+            {
+                const Vector2* children = &heightRanges_[level - 1][z * 2 * numChildren.x_ + x * 2];
+                Vector2 range = children[0];
+                for (unsigned j = 1; j < 4; ++j)
+                {
+                    const Vector2& child = children[(j >> 1) * numChildren.x_ + (j & 1)];
+                    range = Vector2(Min(range.x_, child.x_), Max(range.y_, child.y_));
+                }
+                heightRanges_[level][z * numNodes.x_ + x] = range;
+            }
+        }
+    }
+
+    const PODVector<Vector2>& rootRanges = heightRanges_[numLevels_ - 1];
+    Vector2 range = rootRanges[0];
+    for (unsigned i = 1; i < rootRanges.Size(); ++i)
+        range = Vector2(Min(range.x_, rootRanges[i].x_), Max(range.y_, rootRanges[i].y_));
+    boundingBox_ = BoundingBox(Vector3(origin_.x_, range.x_, origin_.z_), Vector3(-origin_.x_, range.y_, -origin_.z_));
+
+    return true;
+}
+
+bool CDLODTerrain::SelectNode(unsigned level, int x, int z, const FrameInfo& frame)
+{
+    BoundingBox box = GetNodeBox(level, x, z);
+    Vector3 closest(Clamp(selectionCameraPos_.x_, box.min_.x_, box.max_.x_), Clamp(selectionCameraPos_.y_, box.min_.y_,
+        box.max_.y_), Clamp(selectionCameraPos_.z_, box.min_.z_, box.max_.z_));
+    float distanceSquared = (closest - selectionCameraPos_).LengthSquared();
+
+    float range = GetLodRange(level);
+    if (distanceSquared > range * range)
+        return false;
+    // Shadowcasting terrain is not culled per node, as it may cast shadows into the view from outside it
+    if (!castShadows_ && selectionFrustum_.IsInsideFast(box) == OUTSIDE)
+        return true;
+
+    if (level > 0)
+    {
+        // Refine only when the children's height tile is resident, otherwise keep drawing this level until it loads
+        float childRange = GetLodRange(level - 1);
+        if (distanceSquared <= childRange * childRange && CheckTile(GetTileKey(level - 1, x * 2, z * 2), true))
+        {
+            for (unsigned q = 0; q < 4; ++q)
+            {
+                if (!SelectNode(level - 1, x * 2 + (q & 1), z * 2 + (q >> 1), frame))
+                    AddNodeBatch(level, x, z, q + 1, frame);
+            }
+            return true;
+        }
+    }
+
+    AddNodeBatch(level, x, z, 0, frame);
+    return true;
+}
+
+void CDLODTerrain::AddNodeBatch(unsigned level, int x, int z, unsigned geometryIndex, const FrameInfo& frame)
+{
+    HashMap<unsigned, CDLODTile>::Iterator i = tiles_.Find(GetTileKey(level, x, z));
+    if (i == tiles_.End())
+        return;
+    CDLODTile& tile = i->second_;
+    tile.lastUsedFrame_ = frame.frameNumber_;
+
+    // The grid spans the node in the 0-1 range, so scale it to the node size
+    float sizeX = (float)(gridSize_ << level) * spacing_.x_;
+    float sizeZ = (float)(gridSize_ << level) * spacing_.z_;
+    Matrix3x4& transform = nodeTransforms_[level][z * GetNumNodes(level).x_ + x];
+    transform = node_->GetWorldTransform() * Matrix3x4(Vector3(origin_.x_ + x * sizeX, 0.0f, origin_.z_ + z * sizeZ),
+        Quaternion::IDENTITY, Vector3(sizeX, 1.0f, sizeZ));
+
+    SourceBatch batch;
+    batch.distance_ = frame.camera_->GetDistance(transform * Vector3(0.5f, 0.0f, 0.5f));
+    batch.geometry_ = geometries_[geometryIndex];
+    batch.material_ = tile.material_;
+    batch.worldTransform_ = &transform;
+    batches_.Push(batch);
+}
+
+bool CDLODTerrain::CheckTile(unsigned key, bool request)
+{
+    if (tiles_.Contains(key))
+        return true;
+
+    if (request && !tileRequests_.Contains(key))
+        tileRequests_.Push(key);
+    return false;
+}
+
+bool CDLODTerrain::LoadTile(unsigned key)
+{
+    if (!heightFile_ || tiles_.Contains(key))
+        return false;
+
+    PROFILE(LoadCDLODTerrainTile);
+
+    unsigned level = key >> 28;
+    int tileVertices = TILE_NODES * gridSize_;
+    int samples = tileVertices + 3;
+    int step = 1 << level;
+    // First sample of the tile including the border, in the level's vertex units
+    int startX = (int)(key & 0x3fff) * tileVertices - 1;
+    int startZ = (int)((key >> 14) & 0x3fff) * tileVertices - 1;
+    int width = numVertices_.x_;
+    int height = numVertices_.y_;
+    float heightScale = spacing_.y_ / 256.0f;
+
+    // Read the column span of each sampled row, clamping the border to the heightmap edges
+    int firstColumn = Clamp(startX * step, 0, width - 1);
+    int lastColumn = Clamp((startX + samples - 1) * step, 0, width - 1);
+    PODVector<unsigned short> row(lastColumn - firstColumn + 1);
+    SharedArrayPtr<float> heights(new float[samples * samples]);
+    for (int z = 0; z < samples; ++z)
+    {
+        int fileRow = height - 1 - Clamp((startZ + z) * step, 0, height - 1);
+        heightFile_->Seek((fileRow * width + firstColumn) * sizeof(unsigned short));
+        if (heightFile_->Read(&row[0], row.Size() * sizeof(unsigned short)) != row.Size() * sizeof(unsigned short))
+        {
+            LOGERROR("Failed to read CDLOD terrain heightmap file " + heightFileName_);
+            return false;
+        }
+
+        float* dest = heights.Get() + z * samples;
+        for (int x = 0; x < samples; ++x)
+            dest[x] = row[Clamp((startX + x) * step, 0, width - 1) - firstColumn] * heightScale;
+    }
+
+    SharedPtr<Texture2D> texture(new Texture2D(context_));
+    texture->SetNumLevels(1);
+    texture->SetFilterMode(FILTER_NEAREST);
+    texture->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+    texture->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+    if (!texture->SetSize(samples, samples, Graphics::GetFloat32Format()) ||
+        !texture->SetData(0, 0, 0, samples, samples, heights.Get()))
+    {
+        LOGERROR("Failed to create CDLOD terrain height texture");
+        return false;
+    }
+
+    CDLODTile& tile = tiles_[key];
+    tile.texture_ = texture;
+    tile.heights_ = heights;
+    tile.material_ = material_ ? material_->Clone() : SharedPtr<Material>(new Material(context_));
+    #ifdef DESKTOP_GRAPHICS
+    tile.material_->SetTexture(TU_HEIGHTMAP, texture);
+    #endif
+    tile.lastUsedFrame_ = 0;
+    UpdateTileParameters(key, tile);
+
+    return true;
+}
+
+void CDLODTerrain::EvictTiles(unsigned frameNumber)
+{
+    unsigned topLevel = numLevels_ - 1;
+    unsigned numEvictable = 0;
+    for (HashMap<unsigned, CDLODTile>::ConstIterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+    {
+        if ((i->first_ >> 28) < topLevel)
+            ++numEvictable;
+    }
+
+    while (numEvictable > maxTiles_)
+    {
+        // Tiles drawn on this frame are still referenced by the render queues
+        HashMap<unsigned, CDLODTile>::Iterator oldest = tiles_.End();
+        for (HashMap<unsigned, CDLODTile>::Iterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+        {
+            if ((i->first_ >> 28) < topLevel && i->second_.lastUsedFrame_ != frameNumber && (oldest == tiles_.End() ||
+                i->second_.lastUsedFrame_ < oldest->second_.lastUsedFrame_))
+                oldest = i;
+        }
+        if (oldest == tiles_.End())
+            break;
+
+        tiles_.Erase(oldest);
+        --numEvictable;
+    }
+}
+
+void CDLODTerrain::UpdateTileParameters(unsigned key, CDLODTile& tile)
+{
+    Matrix3x4 inverse = node_ ? node_->GetWorldTransform().Inverse() : Matrix3x4::IDENTITY;
+    Vector4 row0(inverse.m00_, inverse.m01_, inverse.m02_, inverse.m03_);
+    Vector4 row2(inverse.m20_, inverse.m21_, inverse.m22_, inverse.m23_);
+
+    // World position to height texel, offset by the tile start and the border
+    unsigned level = key >> 28;
+    int tileVertices = TILE_NODES * gridSize_;
+    float stepX = (float)(1 << level) * spacing_.x_;
+    float stepZ = (float)(1 << level) * spacing_.z_;
+    float tileX = origin_.x_ + (key & 0x3fff) * tileVertices * stepX;
+    float tileZ = origin_.z_ + ((key >> 14) & 0x3fff) * tileVertices * stepZ;
+    Vector4 texelX = (row0 - Vector4(0.0f, 0.0f, 0.0f, tileX)) / stepX + Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+    Vector4 texelZ = (row2 - Vector4(0.0f, 0.0f, 0.0f, tileZ)) / stepZ + Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // World position to terrain texture coordinates, with north at the top like in Terrain
+    float sizeX = (numVertices_.x_ - 1) * spacing_.x_;
+    float sizeZ = (numVertices_.y_ - 1) * spacing_.z_;
+    Vector4 uvX = (row0 - Vector4(0.0f, 0.0f, 0.0f, origin_.x_)) / sizeX;
+    Vector4 uvZ = (row2 - Vector4(0.0f, 0.0f, 0.0f, origin_.z_)) / -sizeZ + Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    Material* material = tile.material_;
+    material->SetShaderParameter("TerrainTexelX", texelX);
+    material->SetShaderParameter("TerrainTexelZ", texelZ);
+    material->SetShaderParameter("TerrainUVX", uvX);
+    material->SetShaderParameter("TerrainUVZ", uvZ);
+    material->SetShaderParameter("TerrainMorph", Vector3(lodRangeFactor_ * morphStart_, lodRangeFactor_, (float)gridSize_));
+}
+
+BoundingBox CDLODTerrain::GetNodeBox(unsigned level, int x, int z) const
+{
+    float sizeX = (float)(gridSize_ << level) * spacing_.x_;
+    float sizeZ = (float)(gridSize_ << level) * spacing_.z_;
+    const Vector2& range = heightRanges_[level][z * GetNumNodes(level).x_ + x];
+    Vector3 min(origin_.x_ + x * sizeX, range.x_, origin_.z_ + z * sizeZ);
+    return BoundingBox(min, min + Vector3(sizeX, range.y_ - range.x_, sizeZ));
+}
+
+float CDLODTerrain::GetLodRange(unsigned level) const
+{
+    return lodRangeFactor_ * (float)(gridSize_ << level) * Max(spacing_.x_, spacing_.z_);
+}
+
+unsigned CDLODTerrain::GetTileKey(unsigned level, int x, int z) const
+{
+    return (level << 28) | ((unsigned)(z / TILE_NODES) << 14) | (unsigned)(x / TILE_NODES);
+}
+
+}
@@ -0,0 +1,218 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/ArrayPtr.h"
+#include "../Graphics/Drawable.h"
+#include "../Math/Frustum.h"
+#include "../Math/Matrix3x4.h"
+
+namespace Urho3D
+{
+
+class File;
+class Geometry;
+class IndexBuffer;
+class Material;
+class Texture2D;
+class VertexBuffer;
+
+/// Maximum number of quadtree levels in a CDLOD terrain.
+static const unsigned MAX_CDLOD_LEVELS = 16;
+
+/// Resident height tile of a CDLOD terrain. Covers a square of nodes on one quadtree level.
+struct CDLODTile
+{
+    /// Height texture with a one texel border.
+    SharedPtr<Texture2D> texture_;
+    /// Copy of the terrain material which references the height texture.
+    SharedPtr<Material> material_;
+    /// CPU copy of the heights.
+    SharedArrayPtr<float> heights_;
+    /// Rendering framenumber on which was last drawn.
+    unsigned lastUsedFrame_;
+};
+
+/// Quadtree terrain for very large heightmaps using continuous distance-dependent LOD (CDLOD). All nodes are drawn with one shared grid mesh which is displaced in the vertex shader from streamed height tile textures, and geomorphed towards the next coarser level so that LOD transitions have no cracks or popping. Requires vertex texture fetch (OpenGL 3 or Direct3D 11.)
+class URHO3D_API CDLODTerrain : public Drawable
+{
+    OBJECT(CDLODTerrain);
+
+public:
+    /// Construct.
+    CDLODTerrain(Context* context);
+    /// Destruct.
+    virtual ~CDLODTerrain();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Handle attribute write access.
+    virtual void OnSetAttribute(const AttributeInfo& attr, const Variant& src);
+    /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
+    virtual void ApplyAttributes();
+    /// Calculate distance, select the quadtree nodes to draw and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
+    virtual void UpdateBatches(const FrameInfo& frame);
+    /// Load requested height tiles and update the tile shader parameters. Called from the main thread.
+    virtual void UpdateGeometry(const FrameInfo& frame);
+    /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
+    virtual UpdateGeometryType GetUpdateGeometryType();
+
+    /// Set heightmap file. This is a raw file of 16-bit little-endian unsigned heights, north row first. Return true if successful.
+    bool SetHeightFile(const String& fileName, const IntVector2& size);
+    /// Set vertex (XZ) and height (Y) spacing.
+    void SetSpacing(const Vector3& spacing);
+    /// Set grid quads per node side. Must be a power of two between 2 and 128.
+    void SetGridSize(int size);
+    /// Set LOD range factor. A node is drawn until the camera distance is this many times its size.
+    void SetLodRangeFactor(float factor);
+    /// Set the fraction of the LOD range at which the geomorph to the coarser level starts.
+    void SetMorphStart(float start);
+    /// Set maximum number of resident height tiles. Tiles of the coarsest level are always resident and do not count towards the limit.
+    void SetMaxTiles(unsigned num);
+    /// Set maximum number of height tiles to load per frame.
+    void SetMaxTileLoads(unsigned num);
+    /// Set material. Should use a technique with the CDLOD vertex shader define, for example Techniques/TerrainBlendCDLOD.xml.
+    void SetMaterial(Material* material);
+
+    /// Return heightmap file name.
+    const String& GetHeightFile() const { return heightFileName_; }
+    /// Return heightmap size in vertices.
+    const IntVector2& GetNumVertices() const { return numVertices_; }
+    /// Return vertex and height spacing.
+    const Vector3& GetSpacing() const { return spacing_; }
+    /// Return grid quads per node side.
+    int GetGridSize() const { return gridSize_; }
+    /// Return LOD range factor.
+    float GetLodRangeFactor() const { return lodRangeFactor_; }
+    /// Return geomorph start fraction.
+    float GetMorphStart() const { return morphStart_; }
+    /// Return maximum number of resident height tiles.
+    unsigned GetMaxTiles() const { return maxTiles_; }
+    /// Return maximum number of height tiles to load per frame.
+    unsigned GetMaxTileLoads() const { return maxTileLoads_; }
+    /// Return material.
+    Material* GetMaterial() const { return material_; }
+    /// Return number of quadtree levels.
+    unsigned GetNumLevels() const { return numLevels_; }
+    /// Return number of resident height tiles.
+    unsigned GetNumTiles() const { return tiles_.Size(); }
+    /// Return height at world coordinates, sampled from the finest resident height tile.
+    float GetHeight(const Vector3& worldPosition) const;
+
+    /// Set grid size attribute.
+    void SetGridSizeAttr(int size);
+    /// Set material attribute.
+    void SetMaterialAttr(const ResourceRef& value);
+    /// Return material attribute.
+    ResourceRef GetMaterialAttr() const;
+
+protected:
+    /// Handle node transform being dirtied.
+    virtual void OnMarkedDirty(Node* node);
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate();
+
+private:
+    /// Open the heightmap file and build the quadtree.
+    void CreateTerrain();
+    /// Release the quadtree and the height tiles.
+    void ReleaseTerrain();
+    /// Build the shared grid mesh.
+    void CreateGrid();
+    /// Read the node height ranges from the heightmap file.
+    bool ReadHeightRanges();
+    /// Select the nodes to draw from one node and its children. Return false if the node is beyond its LOD range and should be drawn by the parent.
+    bool SelectNode(unsigned level, int x, int z, const FrameInfo& frame);
+    /// Add a batch for a node or one of its quadrants.
+    void AddNodeBatch(unsigned level, int x, int z, unsigned geometryIndex, const FrameInfo& frame);
+    /// Return whether a height tile is resident, and optionally request it if not.
+    bool CheckTile(unsigned key, bool request);
+    /// Load a height tile from the heightmap file. Return true if successful.
+    bool LoadTile(unsigned key);
+    /// Evict the least recently used tiles until below the resident limit.
+    void EvictTiles(unsigned frameNumber);
+    /// Set the world-dependent shader parameters of a tile material.
+    void UpdateTileParameters(unsigned key, CDLODTile& tile);
+    /// Return terrain-space bounding box of a node.
+    BoundingBox GetNodeBox(unsigned level, int x, int z) const;
+    /// Return LOD range of a level in terrain space.
+    float GetLodRange(unsigned level) const;
+    /// Return number of nodes per side on a level.
+    IntVector2 GetNumNodes(unsigned level) const { return IntVector2(numNodes_.x_ >> level, numNodes_.y_ >> level); }
+    /// Return height tile key of a node.
+    unsigned GetTileKey(unsigned level, int x, int z) const;
+
+    /// Heightmap file.
+    SharedPtr<File> heightFile_;
+    /// Heightmap file name.
+    String heightFileName_;
+    /// Material.
+    SharedPtr<Material> material_;
+    /// Grid vertex buffer.
+    SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Grid index buffer.
+    SharedPtr<IndexBuffer> indexBuffer_;
+    /// Grid geometries: the whole node followed by its four quadrants.
+    SharedPtr<Geometry> geometries_[5];
+    /// Height range (min, max) of each node per level.
+    PODVector<Vector2> heightRanges_[MAX_CDLOD_LEVELS];
+    /// World transform of each node per level. Written when the node is selected.
+    PODVector<Matrix3x4> nodeTransforms_[MAX_CDLOD_LEVELS];
+    /// Resident height tiles.
+    HashMap<unsigned, CDLODTile> tiles_;
+    /// Height tiles requested during the frame.
+    PODVector<unsigned> tileRequests_;
+    /// Terrain-space camera position during node selection.
+    Vector3 selectionCameraPos_;
+    /// Terrain-space camera frustum during node selection.
+    Frustum selectionFrustum_;
+    /// Heightmap size in vertices.
+    IntVector2 numVertices_;
+    /// Number of finest level nodes per side.
+    IntVector2 numNodes_;
+    /// Terrain-space position of the heightmap's first vertex.
+    Vector3 origin_;
+    /// Vertex and height spacing.
+    Vector3 spacing_;
+    /// Terrain-space bounding box.
+    BoundingBox boundingBox_;
+    /// Grid quads per node side.
+    int gridSize_;
+    /// Number of quadtree levels.
+    unsigned numLevels_;
+    /// LOD range factor.
+    float lodRangeFactor_;
+    /// Geomorph start fraction.
+    float morphStart_;
+    /// Maximum number of resident height tiles.
+    unsigned maxTiles_;
+    /// Maximum number of height tiles to load per frame.
+    unsigned maxTileLoads_;
+    /// Terrain needs to be rebuilt flag.
+    bool recreateTerrain_;
+    /// Tile shader parameters need update flag.
+    bool tileParametersDirty_;
+};
+
+}
@@ -27,12 +27,16 @@
 #include "../Core/CoreEvents.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Light.h"
+#include "../IO/Log.h"
 #include "../Math/Polyhedron.h"
 #include "../Core/Profiler.h"
 #include "../Resource/ResourceCache.h"
 #include "../Graphics/ShaderVariation.h"
+#include "../Container/Sort.h"
 #include "../Graphics/VertexBuffer.h"
+#include "../Core/WorkQueue.h"
 
 #include "../DebugNew.h"
 
@@ -45,12 +49,188 @@ extern const char* SUBSYSTEM_CATEGORY;
 static const unsigned MAX_LINES = 1000000;
 // Cap the amount of triangles to prevent crash.
 static const unsigned MAX_TRIANGLES = 100000;
+// Cap the amount of instances of each debug shape.
+static const unsigned MAX_INSTANCES = 100000;
+// Number of lines written to the vertex buffer per work item.
+static const unsigned LINE_WRITE_GRAIN = 16384;
+static const unsigned INSTANCE_MASK = MASK_INSTANCEMATRIX1 | MASK_INSTANCEMATRIX2 | MASK_INSTANCEMATRIX3;
+
+static Vector3 PointOnSphere(const Sphere& sphere, unsigned theta, unsigned phi)
+{
+    return Vector3(
+        sphere.center_.x_ + sphere.radius_ * Sin((float)theta) * Sin((float)phi),
+        sphere.center_.y_ + sphere.radius_ * Cos((float)phi),
+        sphere.center_.z_ + sphere.radius_ * Cos((float)theta) * Sin((float)phi)
+    );
+}
+
+static float* WriteLines(float* dest, const DebugLine* start, const DebugLine* end)
+{
+    for (const DebugLine* line = start; line != end; ++line)
+    {
+        dest[0] = line->start_.x_; dest[1] = line->start_.y_; dest[2] = line->start_.z_;
+        ((unsigned&)dest[3]) = line->color_;
+        dest[4] = line->end_.x_; dest[5] = line->end_.y_; dest[6] = line->end_.z_;
+        ((unsigned&)dest[7]) = line->color_;
+
+        dest += 8;
+    }
+
+    return dest;
+}
+
+static float* WriteTriangles(float* dest, const DebugTriangle* start, const DebugTriangle* end)
+{
+    for (const DebugTriangle* triangle = start; triangle != end; ++triangle)
+    {
+        dest[0] = triangle->v1_.x_; dest[1] = triangle->v1_.y_; dest[2] = triangle->v1_.z_;
+        ((unsigned&)dest[3]) = triangle->color_;
+
+        dest[4] = triangle->v2_.x_; dest[5] = triangle->v2_.y_; dest[6] = triangle->v2_.z_;
+        ((unsigned&)dest[7]) = triangle->color_;
+
+        dest[8] = triangle->v3_.x_; dest[9] = triangle->v3_.y_; dest[10] = triangle->v3_.z_;
+        ((unsigned&)dest[11]) = triangle->color_;
+
+        dest += 12;
+    }
+
+    return dest;
+}
+
+/// %Functor for writing a range of debug lines to vertex data in a work item.
+struct DebugLineWriter
+{
+    /// Construct with destination of the first line.
+    DebugLineWriter(float* dest, const DebugLine* begin) :
+        dest_(dest),
+        begin_(begin)
+    {
+    }
+
+    /// Write a range of lines.
+    void operator () (DebugLine* start, DebugLine* end, unsigned threadIndex)
+    {
+        WriteLines(dest_ + (start - begin_) * 8, start, end);
+    }
+
+    /// Destination of the first line.
+    float* dest_;
+    /// First line.
+    const DebugLine* begin_;
+};
+
+static float* WriteLines(WorkQueue* queue, float* dest, PODVector<DebugLine>& lines)
+{
+    if (lines.Empty())
+        return dest;
+
+    // Large line counts, for example from navigation meshes or heightfields, are written from the worker threads
+    if (queue)
+    {
+        DebugLineWriter writer(dest, lines.Begin().ptr_);
+        queue->ParallelFor(lines.Begin().ptr_, lines.End().ptr_, LINE_WRITE_GRAIN, writer);
+        return dest + lines.Size() * 8;
+    }
+    else
+        return WriteLines(dest, lines.Begin().ptr_, lines.End().ptr_);
+}
+
+static bool CompareInstances(const DebugInstance& lhs, const DebugInstance& rhs)
+{
+    if (lhs.depthTest_ != rhs.depthTest_)
+        return lhs.depthTest_;
+    return lhs.color_ < rhs.color_;
+}
+
+static Color ColorFromUInt(unsigned color)
+{
+    return Color((color & 0xff) / 255.0f, ((color >> 8) & 0xff) / 255.0f, ((color >> 16) & 0xff) / 255.0f,
+        ((color >> 24) & 0xff) / 255.0f);
+}
+
+DebugPersistentGeometry::DebugPersistentGeometry() :
+    numLines_(0),
+    numNoDepthLines_(0),
+    numTriangles_(0),
+    numNoDepthTriangles_(0)
+{
+}
+
+DebugPersistentGeometry::~DebugPersistentGeometry()
+{
+}
 
 DebugRenderer::DebugRenderer(Context* context) :
-    Component(context)
+    Component(context),
+    recording_(false)
 {
     vertexBuffer_ = new VertexBuffer(context_);
 
+    // Unit box from -0.5 to 0.5
+    const Vector3 min(-0.5f, -0.5f, -0.5f);
+    const Vector3 max(0.5f, 0.5f, 0.5f);
+    Vector3 corners[8];
+    for (unsigned i = 0; i < 8; ++i)
+        corners[i] = Vector3((i & 1) ? max.x_ : min.x_, (i & 2) ? max.y_ : min.y_, (i & 4) ? max.z_ : min.z_);
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        // Connect each corner to the corners that differ by one axis
+        for (unsigned axis = 1; axis < 8; axis <<= 1)
+        {
+            if (!(i & axis))
+            {
+                shapeLines_[DEBUG_BOX].Push(corners[i]);
+                shapeLines_[DEBUG_BOX].Push(corners[i | axis]);
+            }
+        }
+    }
+
+    // Unit sphere
+    Sphere sphere(Vector3::ZERO, 1.0f);
+    for (unsigned j = 0; j < 180; j += 45)
+    {
+        for (unsigned i = 0; i < 360; i += 45)
+        {
+            Vector3 p1 = PointOnSphere(sphere, i, j);
+            Vector3 p2 = PointOnSphere(sphere, i + 45, j);
+            Vector3 p3 = PointOnSphere(sphere, i, j + 45);
+            Vector3 p4 = PointOnSphere(sphere, i + 45, j + 45);
+
+            shapeLines_[DEBUG_SPHERE].Push(p1);
+            shapeLines_[DEBUG_SPHERE].Push(p2);
+            shapeLines_[DEBUG_SPHERE].Push(p3);
+            shapeLines_[DEBUG_SPHERE].Push(p4);
+            shapeLines_[DEBUG_SPHERE].Push(p1);
+            shapeLines_[DEBUG_SPHERE].Push(p3);
+            shapeLines_[DEBUG_SPHERE].Push(p2);
+            shapeLines_[DEBUG_SPHERE].Push(p4);
+        }
+    }
+
+    // Unit cylinder from 0 to 1 on the Y axis
+    for (unsigned i = 0; i < 360; i += 45)
+    {
+        Vector3 p1 = PointOnSphere(sphere, i, 90);
+        Vector3 p2 = PointOnSphere(sphere, i + 45, 90);
+        shapeLines_[DEBUG_CYLINDER].Push(p1);
+        shapeLines_[DEBUG_CYLINDER].Push(p2);
+        shapeLines_[DEBUG_CYLINDER].Push(p1 + Vector3::UP);
+        shapeLines_[DEBUG_CYLINDER].Push(p2 + Vector3::UP);
+    }
+    for (unsigned i = 0; i < 360; i += 90)
+    {
+        Vector3 p = PointOnSphere(sphere, i, 90);
+        shapeLines_[DEBUG_CYLINDER].Push(p);
+        shapeLines_[DEBUG_CYLINDER].Push(p + Vector3::UP);
+    }
+
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+    {
+        shapeIndexStart_[i] = 0;
+        shapeIndexCount_[i] = 0;
+    }
+
     SubscribeToEvent(E_ENDFRAME, HANDLER(DebugRenderer, HandleEndFrame));
 }
 
@@ -105,6 +285,26 @@ void DebugRenderer::AddTriangle(const Vector3& v1, const Vector3& v2, const Vect
         noDepthTriangles_.Push(DebugTriangle(v1, v2, v3, color));
 }
 
+void DebugRenderer::AddLines(const PODVector<DebugLine>& lines, bool depthTest)
+{
+    MutexLock lock(addMutex_);
+
+    PODVector<DebugLine>& dest = depthTest ? lines_ : noDepthLines_;
+    int count = Min((int)lines.Size(), (int)MAX_LINES - (int)(lines_.Size() + noDepthLines_.Size()));
+    if (count > 0)
+        dest.Insert(dest.End(), lines.Begin(), lines.Begin() + count);
+}
+
+void DebugRenderer::AddTriangles(const PODVector<DebugTriangle>& triangles, bool depthTest)
+{
+    MutexLock lock(addMutex_);
+
+    PODVector<DebugTriangle>& dest = depthTest ? triangles_ : noDepthTriangles_;
+    int count = Min((int)triangles.Size(), (int)MAX_TRIANGLES - (int)(triangles_.Size() + noDepthTriangles_.Size()));
+    if (count > 0)
+        dest.Insert(dest.End(), triangles.Begin(), triangles.Begin() + count);
+}
+
 void DebugRenderer::AddNode(Node* node, float scale, bool depthTest)
 {
     if (!node)
@@ -120,63 +320,14 @@ void DebugRenderer::AddNode(Node* node, float scale, bool depthTest)
 
 void DebugRenderer::AddBoundingBox(const BoundingBox& box, const Color& color, bool depthTest)
 {
-    const Vector3& min = box.min_;
-    const Vector3& max = box.max_;
-
-    Vector3 v1(max.x_, min.y_, min.z_);
-    Vector3 v2(max.x_, max.y_, min.z_);
-    Vector3 v3(min.x_, max.y_, min.z_);
-    Vector3 v4(min.x_, min.y_, max.z_);
-    Vector3 v5(max.x_, min.y_, max.z_);
-    Vector3 v6(min.x_, max.y_, max.z_);
-
-    unsigned uintColor = color.ToUInt();
-
-    AddLine(min, v1, uintColor, depthTest);
-    AddLine(v1, v2, uintColor, depthTest);
-    AddLine(v2, v3, uintColor, depthTest);
-    AddLine(v3, min, uintColor, depthTest);
-    AddLine(v4, v5, uintColor, depthTest);
-    AddLine(v5, max, uintColor, depthTest);
-    AddLine(max, v6, uintColor, depthTest);
-    AddLine(v6, v4, uintColor, depthTest);
-    AddLine(min, v4, uintColor, depthTest);
-    AddLine(v1, v5, uintColor, depthTest);
-    AddLine(v2, max, uintColor, depthTest);
-    AddLine(v3, v6, uintColor, depthTest);
+    AddShape(DEBUG_BOX, Matrix3x4(box.Center(), Quaternion::IDENTITY, box.Size()), color, depthTest);
 }
 
 void DebugRenderer::AddBoundingBox(const BoundingBox& box, const Matrix3x4& transform, const Color& color, bool depthTest)
 {
-    const Vector3& min = box.min_;
-    const Vector3& max = box.max_;
-
-    Vector3 v0(transform * min);
-    Vector3 v1(transform * Vector3(max.x_, min.y_, min.z_));
-    Vector3 v2(transform * Vector3(max.x_, max.y_, min.z_));
-    Vector3 v3(transform * Vector3(min.x_, max.y_, min.z_));
-    Vector3 v4(transform * Vector3(min.x_, min.y_, max.z_));
-    Vector3 v5(transform * Vector3(max.x_, min.y_, max.z_));
-    Vector3 v6(transform * Vector3(min.x_, max.y_, max.z_));
-    Vector3 v7(transform * max);
-
-    unsigned uintColor = color.ToUInt();
-
-    AddLine(v0, v1, uintColor, depthTest);
-    AddLine(v1, v2, uintColor, depthTest);
-    AddLine(v2, v3, uintColor, depthTest);
-    AddLine(v3, v0, uintColor, depthTest);
-    AddLine(v4, v5, uintColor, depthTest);
-    AddLine(v5, v7, uintColor, depthTest);
-    AddLine(v7, v6, uintColor, depthTest);
-    AddLine(v6, v4, uintColor, depthTest);
-    AddLine(v0, v4, uintColor, depthTest);
-    AddLine(v1, v5, uintColor, depthTest);
-    AddLine(v2, v7, uintColor, depthTest);
-    AddLine(v3, v6, uintColor, depthTest);
+    AddShape(DEBUG_BOX, transform * Matrix3x4(box.Center(), Quaternion::IDENTITY, box.Size()), color, depthTest);
 }
 
-
 void DebugRenderer::AddFrustum(const Frustum& frustum, const Color& color, bool depthTest)
 {
     const Vector3* vertices = frustum.vertices_;
@@ -211,53 +362,14 @@ void DebugRenderer::AddPolyhedron(const Polyhedron& poly, const Color& color, bo
     }
 }
 
-static Vector3 PointOnSphere(const Sphere& sphere, unsigned theta, unsigned phi)
-{
-    return Vector3(
-        sphere.center_.x_ + sphere.radius_ * Sin((float)theta) * Sin((float)phi),
-        sphere.center_.y_ + sphere.radius_ * Cos((float)phi),
-        sphere.center_.z_ + sphere.radius_ * Cos((float)theta) * Sin((float)phi)
-    );
-}
-
 void DebugRenderer::AddSphere(const Sphere& sphere, const Color& color, bool depthTest)
 {
-    unsigned uintColor = color.ToUInt();
-    
-    for (unsigned j = 0; j < 180; j += 45)
-    {
-        for (unsigned i = 0; i < 360; i += 45)
-        {
-            Vector3 p1 = PointOnSphere(sphere, i, j);
-            Vector3 p2 = PointOnSphere(sphere, i + 45, j);
-            Vector3 p3 = PointOnSphere(sphere, i, j + 45);
-            Vector3 p4 = PointOnSphere(sphere, i + 45, j + 45);
-            
-            AddLine(p1, p2, uintColor, depthTest);
-            AddLine(p3, p4, uintColor, depthTest);
-            AddLine(p1, p3, uintColor, depthTest);
-            AddLine(p2, p4, uintColor, depthTest);
-        }
-    }
+    AddShape(DEBUG_SPHERE, Matrix3x4(sphere.center_, Quaternion::IDENTITY, sphere.radius_), color, depthTest);
 }
 
 void DebugRenderer::AddCylinder(const Vector3& position, float radius, float height, const Color& color, bool depthTest)
 {
-    Sphere sphere(position, radius);
-    Vector3 heightVec(0, height, 0);
-    Vector3 offsetXVec(radius, 0, 0);
-    Vector3 offsetZVec(0, 0, radius);
-    for (unsigned i = 0; i < 360; i += 45)
-    {
-        Vector3 p1 = PointOnSphere(sphere, i, 90);
-        Vector3 p2 = PointOnSphere(sphere, i + 45, 90);
-        AddLine(p1, p2, color, depthTest);
-        AddLine(p1 + heightVec, p2 + heightVec, color, depthTest);
-    }
-    AddLine(position + offsetXVec, position + heightVec + offsetXVec, color, depthTest);
-    AddLine(position - offsetXVec, position + heightVec - offsetXVec, color, depthTest);
-    AddLine(position + offsetZVec, position + heightVec + offsetZVec, color, depthTest);
-    AddLine(position - offsetZVec, position + heightVec - offsetZVec, color, depthTest);
+    AddShape(DEBUG_CYLINDER, Matrix3x4(position, Quaternion::IDENTITY, Vector3(radius, height, radius)), color, depthTest);
 }
 
 void DebugRenderer::AddSkeleton(const Skeleton& skeleton, const Color& color, bool depthTest)
@@ -339,101 +451,153 @@ void DebugRenderer::AddTriangleMesh(const void* vertexData, unsigned vertexSize,
     }
 }
 
-void DebugRenderer::Render()
+void DebugRenderer::AddShape(DebugShape shape, const Matrix3x4& transform, const Color& color, bool depthTest)
 {
-    if (!HasContent())
+    if (shape >= MAX_DEBUG_SHAPES)
         return;
 
+    // Persistent geometry holds only lines and triangles, so the shape is expanded while recording
     Graphics* graphics = GetSubsystem<Graphics>();
-    // Engine does not render when window is closed or device is lost
-    assert(graphics && graphics->IsInitialized() && !graphics->IsDeviceLost());
+    if (recording_ || !graphics || !graphics->GetInstancingSupport())
+    {
+        AddShapeLines(shape, transform, color.ToUInt(), depthTest);
+        return;
+    }
 
-    PROFILE(RenderDebugGeometry);
+    PODVector<DebugInstance>& instances = instances_[shape];
+    if (instances.Size() >= MAX_INSTANCES)
+        return;
 
-    ShaderVariation* vs = graphics->GetShader(VS, "Basic", "VERTEXCOLOR");
-    ShaderVariation* ps = graphics->GetShader(PS, "Basic", "VERTEXCOLOR");
-    
-    unsigned numVertices = (lines_.Size() + noDepthLines_.Size()) * 2 + (triangles_.Size() + noDepthTriangles_.Size()) * 3;
-    // Resize the vertex buffer if too small or much too large
-    if (vertexBuffer_->GetVertexCount() < numVertices || vertexBuffer_->GetVertexCount() > numVertices * 2)
-        vertexBuffer_->SetSize(numVertices, MASK_POSITION | MASK_COLOR, true);
+    instances.Push(DebugInstance(transform, color.ToUInt(), depthTest));
+}
 
-    float* dest = (float*)vertexBuffer_->Lock(0, numVertices, true);
-    if (!dest)
+void DebugRenderer::BeginPersistentGeometry(StringHash key)
+{
+    if (recording_)
+    {
+        LOGERROR("Already recording persistent debug geometry");
         return;
+    }
+
+    // Set the lines and triangles of the frame aside, so that the ones added from now on can be recorded
+    recording_ = true;
+    recordingKey_ = key;
+    frameLines_[0].Swap(lines_);
+    frameLines_[1].Swap(noDepthLines_);
+    frameTriangles_[0].Swap(triangles_);
+    frameTriangles_[1].Swap(noDepthTriangles_);
+}
 
-    for (unsigned i = 0; i < lines_.Size(); ++i)
+void DebugRenderer::EndPersistentGeometry(const Matrix3x4& transform)
+{
+    if (!recording_)
     {
-        const DebugLine& line = lines_[i];
+        LOGERROR("Not recording persistent debug geometry");
+        return;
+    }
 
-        dest[0] = line.start_.x_; dest[1] = line.start_.y_; dest[2] = line.start_.z_;
-        ((unsigned&)dest[3]) = line.color_;
-        dest[4] = line.end_.x_; dest[5] = line.end_.y_; dest[6] = line.end_.z_;
-        ((unsigned&)dest[7]) = line.color_;
+    DebugPersistentGeometry& geometry = persistentGeometry_[recordingKey_];
+    geometry.numLines_ = lines_.Size();
+    geometry.numNoDepthLines_ = noDepthLines_.Size();
+    geometry.numTriangles_ = triangles_.Size();
+    geometry.numNoDepthTriangles_ = noDepthTriangles_.Size();
 
-        dest += 8;
+    unsigned numVertices = (lines_.Size() + noDepthLines_.Size()) * 2 + (triangles_.Size() + noDepthTriangles_.Size()) * 3;
+    if (numVertices)
+    {
+        PODVector<float> vertexData(numVertices * 4);
+        float* dest = &vertexData[0];
+        dest = WriteLines(dest, lines_.Begin().ptr_, lines_.End().ptr_);
+        dest = WriteLines(dest, noDepthLines_.Begin().ptr_, noDepthLines_.End().ptr_);
+        dest = WriteTriangles(dest, triangles_.Begin().ptr_, triangles_.End().ptr_);
+        WriteTriangles(dest, noDepthTriangles_.Begin().ptr_, noDepthTriangles_.End().ptr_);
+
+        if (!geometry.vertexBuffer_)
+        {
+            geometry.vertexBuffer_ = new VertexBuffer(context_);
+            // Restore the contents if the graphics context is lost, as the geometry is not added again
+            geometry.vertexBuffer_->SetShadowed(true);
+        }
+        geometry.vertexBuffer_->SetSize(numVertices, MASK_POSITION | MASK_COLOR);
+        geometry.vertexBuffer_->SetData(&vertexData[0]);
     }
+    else
+        geometry.vertexBuffer_.Reset();
 
-    for (unsigned i = 0; i < noDepthLines_.Size(); ++i)
-    {
-        const DebugLine& line = noDepthLines_[i];
+    lines_.Clear();
+    noDepthLines_.Clear();
+    triangles_.Clear();
+    noDepthTriangles_.Clear();
+    lines_.Swap(frameLines_[0]);
+    noDepthLines_.Swap(frameLines_[1]);
+    triangles_.Swap(frameTriangles_[0]);
+    noDepthTriangles_.Swap(frameTriangles_[1]);
+    recording_ = false;
 
-        dest[0] = line.start_.x_; dest[1] = line.start_.y_; dest[2] = line.start_.z_;
-        ((unsigned&)dest[3]) = line.color_;
-        dest[4] = line.end_.x_; dest[5] = line.end_.y_; dest[6] = line.end_.z_;
-        ((unsigned&)dest[7]) = line.color_;
+    persistentDraws_.Push(MakePair(recordingKey_, transform));
+}
 
-        dest += 8;
-    }
+bool DebugRenderer::DrawPersistentGeometry(StringHash key, const Matrix3x4& transform)
+{
+    if (!persistentGeometry_.Contains(key))
+        return false;
 
-    for (unsigned i = 0; i < triangles_.Size(); ++i)
-    {
-        const DebugTriangle& triangle = triangles_[i];
+    persistentDraws_.Push(MakePair(key, transform));
+    return true;
+}
 
-        dest[0] = triangle.v1_.x_; dest[1] = triangle.v1_.y_; dest[2] = triangle.v1_.z_;
-        ((unsigned&)dest[3]) = triangle.color_;
+void DebugRenderer::RemovePersistentGeometry(StringHash key)
+{
+    persistentGeometry_.Erase(key);
+}
 
-        dest[4] = triangle.v2_.x_; dest[5] = triangle.v2_.y_; dest[6] = triangle.v2_.z_;
-        ((unsigned&)dest[7]) = triangle.color_;
-        
-        dest[8] = triangle.v3_.x_; dest[9] = triangle.v3_.y_; dest[10] = triangle.v3_.z_;
-        ((unsigned&)dest[11]) = triangle.color_;
+void DebugRenderer::RemoveAllPersistentGeometry()
+{
+    persistentGeometry_.Clear();
+}
 
-        dest += 12;
-    }
+void DebugRenderer::Render()
+{
+    if (!HasContent())
+        return;
 
-    for (unsigned i = 0; i < noDepthTriangles_.Size(); ++i)
-    {
-        const DebugTriangle& triangle = noDepthTriangles_[i];
+    Graphics* graphics = GetSubsystem<Graphics>();
+    // Engine does not render when window is closed or device is lost
+    assert(graphics && graphics->IsInitialized() && !graphics->IsDeviceLost());
+
+    PROFILE(RenderDebugGeometry);
 
-        dest[0] = triangle.v1_.x_; dest[1] = triangle.v1_.y_; dest[2] = triangle.v1_.z_;
-        ((unsigned&)dest[3]) = triangle.color_;
+    unsigned numVertices = (lines_.Size() + noDepthLines_.Size()) * 2 + (triangles_.Size() + noDepthTriangles_.Size()) * 3;
+    if (numVertices)
+    {
+        // Resize the vertex buffer if too small or much too large
+        if (vertexBuffer_->GetVertexCount() < numVertices || vertexBuffer_->GetVertexCount() > numVertices * 2)
+            vertexBuffer_->SetSize(numVertices, MASK_POSITION | MASK_COLOR, true);
 
-        dest[4] = triangle.v2_.x_; dest[5] = triangle.v2_.y_; dest[6] = triangle.v2_.z_;
-        ((unsigned&)dest[7]) = triangle.color_;
+        float* dest = (float*)vertexBuffer_->Lock(0, numVertices, true);
+        if (!dest)
+            return;
 
-        dest[8] = triangle.v3_.x_; dest[9] = triangle.v3_.y_; dest[10] = triangle.v3_.z_;
-        ((unsigned&)dest[11]) = triangle.color_;
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        dest = WriteLines(queue, dest, lines_);
+        dest = WriteLines(queue, dest, noDepthLines_);
+        dest = WriteTriangles(dest, triangles_.Begin().ptr_, triangles_.End().ptr_);
+        WriteTriangles(dest, noDepthTriangles_.Begin().ptr_, noDepthTriangles_.End().ptr_);
 
-        dest += 12;
+        vertexBuffer_->Unlock();
     }
 
-    vertexBuffer_->Unlock();
-
     graphics->SetBlendMode(BLEND_REPLACE);
     graphics->SetColorWrite(true);
     graphics->SetCullMode(CULL_NONE);
     graphics->SetDepthWrite(true);
     graphics->SetScissorTest(false);
     graphics->SetStencilTest(false);
-    graphics->SetShaders(vs, ps);
-    graphics->SetShaderParameter(VSP_MODEL, Matrix3x4::IDENTITY);
-    graphics->SetShaderParameter(VSP_VIEWPROJ, projection_ * view_);
-    graphics->SetShaderParameter(PSP_MATDIFFCOLOR, Color(1.0f, 1.0f, 1.0f, 1.0f));
-    graphics->SetVertexBuffer(vertexBuffer_);
 
     unsigned start = 0;
     unsigned count = 0;
+    if (lines_.Size() || noDepthLines_.Size())
+        PrepareVertexColorDraw(vertexBuffer_, Matrix3x4::IDENTITY);
     if (lines_.Size())
     {
         count = lines_.Size() * 2;
@@ -448,9 +612,15 @@ void DebugRenderer::Render()
         graphics->Draw(LINE_LIST, start, count);
         start += count;
     }
-    
+
+    RenderShapes();
+    RenderPersistentGeometry();
+
+    // Draw the transparent triangles last
     graphics->SetBlendMode(BLEND_ALPHA);
-    
+
+    if (triangles_.Size() || noDepthTriangles_.Size())
+        PrepareVertexColorDraw(vertexBuffer_, Matrix3x4::IDENTITY);
     if (triangles_.Size())
     {
         count = triangles_.Size() * 3;
@@ -473,7 +643,174 @@ bool DebugRenderer::IsInside(const BoundingBox& box) const
 
 bool DebugRenderer::HasContent() const
 {
-    return (lines_.Empty() && noDepthLines_.Empty() && triangles_.Empty() && noDepthTriangles_.Empty()) ? false : true;
+    if (!lines_.Empty() || !noDepthLines_.Empty() || !triangles_.Empty() || !noDepthTriangles_.Empty() ||
+        !persistentDraws_.Empty())
+        return true;
+
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+    {
+        if (!instances_[i].Empty())
+            return true;
+    }
+
+    return false;
+}
+
+void DebugRenderer::AddShapeLines(DebugShape shape, const Matrix3x4& transform, unsigned color, bool depthTest)
+{
+    const PODVector<Vector3>& points = shapeLines_[shape];
+    for (unsigned i = 0; i < points.Size(); i += 2)
+        AddLine(transform * points[i], transform * points[i + 1], color, depthTest);
+}
+
+bool DebugRenderer::CreateShapeGeometry()
+{
+    // The unit meshes are small, so store each line with its own vertices
+    PODVector<Vector3> vertices;
+    PODVector<unsigned short> indices;
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+    {
+        shapeIndexStart_[i] = vertices.Size();
+        shapeIndexCount_[i] = shapeLines_[i].Size();
+        for (unsigned j = 0; j < shapeLines_[i].Size(); ++j)
+        {
+            indices.Push((unsigned short)vertices.Size());
+            vertices.Push(shapeLines_[i][j]);
+        }
+    }
+
+    shapeVertexBuffer_ = new VertexBuffer(context_);
+    shapeVertexBuffer_->SetShadowed(true);
+    shapeIndexBuffer_ = new IndexBuffer(context_);
+    shapeIndexBuffer_->SetShadowed(true);
+    if (!shapeVertexBuffer_->SetSize(vertices.Size(), MASK_POSITION) || !shapeVertexBuffer_->SetData(&vertices[0]) ||
+        !shapeIndexBuffer_->SetSize(indices.Size(), false) || !shapeIndexBuffer_->SetData(&indices[0]))
+    {
+        LOGERROR("Failed to create debug shape geometry");
+        shapeVertexBuffer_.Reset();
+        shapeIndexBuffer_.Reset();
+        return false;
+    }
+
+    return true;
+}
+
+void DebugRenderer::RenderShapes()
+{
+    unsigned numInstances = 0;
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+        numInstances += instances_[i].Size();
+    if (!numInstances)
+        return;
+
+    if (!shapeVertexBuffer_ && !CreateShapeGeometry())
+        return;
+
+    if (!instanceBuffer_)
+        instanceBuffer_ = new VertexBuffer(context_);
+    // Resize the instance buffer if too small or much too large
+    if (instanceBuffer_->GetVertexCount() < numInstances || instanceBuffer_->GetVertexCount() > numInstances * 2)
+        instanceBuffer_->SetSize(numInstances, INSTANCE_MASK, true);
+
+    Matrix3x4* dest = (Matrix3x4*)instanceBuffer_->Lock(0, numInstances, true);
+    if (!dest)
+        return;
+
+    // Sort so that the instances with the same depth test and color are drawn with one call
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+    {
+        PODVector<DebugInstance>& instances = instances_[i];
+        Sort(instances.Begin(), instances.End(), CompareInstances);
+        for (unsigned j = 0; j < instances.Size(); ++j)
+            *dest++ = instances[j].transform_;
+    }
+
+    instanceBuffer_->Unlock();
+
+    Graphics* graphics = GetSubsystem<Graphics>();
+    graphics->SetShaders(graphics->GetShader(VS, "Basic", "INSTANCED"), graphics->GetShader(PS, "Basic"));
+    graphics->SetShaderParameter(VSP_VIEWPROJ, projection_ * view_);
+    graphics->SetIndexBuffer(shapeIndexBuffer_);
+
+    PODVector<VertexBuffer*> vertexBuffers;
+    PODVector<unsigned> elementMasks;
+    vertexBuffers.Push(shapeVertexBuffer_);
+    vertexBuffers.Push(instanceBuffer_);
+    elementMasks.Push(MASK_POSITION);
+    elementMasks.Push(INSTANCE_MASK);
+
+    unsigned start = 0;
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+    {
+        const PODVector<DebugInstance>& instances = instances_[i];
+        for (unsigned j = 0; j < instances.Size();)
+        {
+            unsigned end = j + 1;
+            while (end < instances.Size() && instances[end].depthTest_ == instances[j].depthTest_ &&
+                instances[end].color_ == instances[j].color_)
+                ++end;
+
+            graphics->SetDepthTest(instances[j].depthTest_ ? CMP_LESSEQUAL : CMP_ALWAYS);
+            graphics->SetShaderParameter(PSP_MATDIFFCOLOR, ColorFromUInt(instances[j].color_));
+            graphics->SetVertexBuffers(vertexBuffers, elementMasks, start + j);
+            graphics->DrawInstanced(LINE_LIST, shapeIndexStart_[i], shapeIndexCount_[i], shapeIndexStart_[i], shapeIndexCount_[i],
+                end - j);
+            j = end;
+        }
+        start += instances.Size();
+    }
+}
+
+void DebugRenderer::RenderPersistentGeometry()
+{
+    Graphics* graphics = GetSubsystem<Graphics>();
+
+    for (unsigned i = 0; i < persistentDraws_.Size(); ++i)
+    {
+        HashMap<StringHash, DebugPersistentGeometry>::ConstIterator j = persistentGeometry_.Find(persistentDraws_[i].first_);
+        if (j == persistentGeometry_.End() || !j->second_.vertexBuffer_)
+            continue;
+
+        const DebugPersistentGeometry& geometry = j->second_;
+        PrepareVertexColorDraw(geometry.vertexBuffer_, persistentDraws_[i].second_);
+
+        unsigned start = 0;
+        graphics->SetBlendMode(BLEND_REPLACE);
+        if (geometry.numLines_)
+        {
+            graphics->SetDepthTest(CMP_LESSEQUAL);
+            graphics->Draw(LINE_LIST, start, geometry.numLines_ * 2);
+            start += geometry.numLines_ * 2;
+        }
+        if (geometry.numNoDepthLines_)
+        {
+            graphics->SetDepthTest(CMP_ALWAYS);
+            graphics->Draw(LINE_LIST, start, geometry.numNoDepthLines_ * 2);
+            start += geometry.numNoDepthLines_ * 2;
+        }
+        graphics->SetBlendMode(BLEND_ALPHA);
+        if (geometry.numTriangles_)
+        {
+            graphics->SetDepthTest(CMP_LESSEQUAL);
+            graphics->Draw(TRIANGLE_LIST, start, geometry.numTriangles_ * 3);
+            start += geometry.numTriangles_ * 3;
+        }
+        if (geometry.numNoDepthTriangles_)
+        {
+            graphics->SetDepthTest(CMP_ALWAYS);
+            graphics->Draw(TRIANGLE_LIST, start, geometry.numNoDepthTriangles_ * 3);
+        }
+    }
+}
+
+void DebugRenderer::PrepareVertexColorDraw(VertexBuffer* buffer, const Matrix3x4& transform)
+{
+    Graphics* graphics = GetSubsystem<Graphics>();
+    graphics->SetShaders(graphics->GetShader(VS, "Basic", "VERTEXCOLOR"), graphics->GetShader(PS, "Basic", "VERTEXCOLOR"));
+    graphics->SetShaderParameter(VSP_MODEL, transform);
+    graphics->SetShaderParameter(VSP_VIEWPROJ, projection_ * view_);
+    graphics->SetShaderParameter(PSP_MATDIFFCOLOR, Color(1.0f, 1.0f, 1.0f, 1.0f));
+    graphics->SetVertexBuffer(buffer);
 }
 
 void DebugRenderer::HandleEndFrame(StringHash eventType, VariantMap& eventData)
@@ -497,6 +834,16 @@ void DebugRenderer::HandleEndFrame(StringHash eventType, VariantMap& eventData)
         triangles_.Reserve(trianglesSize);
     if (noDepthTriangles_.Capacity() > noDepthTrianglesSize * 2)
         noDepthTriangles_.Reserve(noDepthTrianglesSize);
+
+    for (unsigned i = 0; i < MAX_DEBUG_SHAPES; ++i)
+    {
+        unsigned instancesSize = instances_[i].Size();
+        instances_[i].Clear();
+        if (instances_[i].Capacity() > instancesSize * 2)
+            instances_[i].Reserve(instancesSize);
+    }
+
+    persistentDraws_.Clear();
 }
 
 }
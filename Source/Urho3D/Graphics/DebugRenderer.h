@@ -25,12 +25,14 @@
 #include "../Math/Color.h"
 #include "../Scene/Component.h"
 #include "../Math/Frustum.h"
+#include "../Core/Mutex.h"
 
 namespace Urho3D
 {
 
 class BoundingBox;
 class Camera;
+class IndexBuffer;
 class Polyhedron;
 class Drawable;
 class Light;
@@ -91,6 +93,59 @@ struct DebugTriangle
     unsigned color_;
 };
 
+/// Debug shapes drawn as instances of a unit mesh.
+enum DebugShape
+{
+    DEBUG_BOX = 0,
+    DEBUG_SPHERE,
+    DEBUG_CYLINDER,
+    MAX_DEBUG_SHAPES
+};
+
+/// Instance of a debug shape.
+struct DebugInstance
+{
+    /// Construct undefined.
+    DebugInstance()
+    {
+    }
+    
+    /// Construct with transform of the unit mesh, color and depth test flag.
+    DebugInstance(const Matrix3x4& transform, unsigned color, bool depthTest) :
+        transform_(transform),
+        color_(color),
+        depthTest_(depthTest)
+    {
+    }
+    
+    /// Transform of the unit mesh.
+    Matrix3x4 transform_;
+    /// Color.
+    unsigned color_;
+    /// Depth test flag.
+    bool depthTest_;
+};
+
+/// Debug geometry kept in a vertex buffer between frames.
+struct DebugPersistentGeometry
+{
+    /// Construct.
+    DebugPersistentGeometry();
+    /// Destruct.
+    ~DebugPersistentGeometry();
+    
+    /// Vertex buffer.
+    SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Number of lines rendered with depth test.
+    unsigned numLines_;
+    /// Number of lines rendered without depth test.
+    unsigned numNoDepthLines_;
+    /// Number of triangles rendered with depth test.
+    unsigned numTriangles_;
+    /// Number of triangles rendered without depth test.
+    unsigned numNoDepthTriangles_;
+};
+
 /// Debug geometry rendering component. Should be added only to the root scene node.
 class URHO3D_API DebugRenderer : public Component
 {
@@ -114,6 +169,10 @@ public:
     void AddTriangle(const Vector3& v1, const Vector3& v2, const Vector3& v3, const Color& color, bool depthTest = true);
     /// Add a triangle with color already converted to unsigned.
     void AddTriangle(const Vector3& v1, const Vector3& v2, const Vector3& v3, unsigned color, bool depthTest = true);
+    /// Add lines. Can be called from worker threads, concurrently with other AddLines() and AddTriangles() calls but not with the other functions.
+    void AddLines(const PODVector<DebugLine>& lines, bool depthTest = true);
+    /// Add triangles. Can be called from worker threads, concurrently with other AddLines() and AddTriangles() calls but not with the other functions.
+    void AddTriangles(const PODVector<DebugTriangle>& triangles, bool depthTest = true);
     /// Add a scene node represented as its coordinate axes.
     void AddNode(Node* node, float scale = 1.0f, bool depthTest = true);
     /// Add a bounding box.
@@ -132,6 +191,18 @@ public:
     void AddSkeleton(const Skeleton& skeleton, const Color& color, bool depthTest = true);
     /// Add a triangle mesh.
     void AddTriangleMesh(const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, const Matrix3x4& transform, const Color& color, bool depthTest = true);
+    /// Add an instance of a unit debug shape: a box from -0.5 to 0.5, a sphere of radius 1 or a cylinder of radius 1 from 0 to 1 on the Y axis. Drawn with hardware instancing if supported, otherwise expanded to lines.
+    void AddShape(DebugShape shape, const Matrix3x4& transform, const Color& color, bool depthTest = true);
+    /// Begin recording persistent geometry under a key. Until EndPersistentGeometry(), added lines and triangles are recorded instead of being drawn once, in the local space of the transform given when drawing.
+    void BeginPersistentGeometry(StringHash key);
+    /// End recording persistent geometry, replacing any previous geometry under the key. The geometry is drawn this frame with the given transform.
+    void EndPersistentGeometry(const Matrix3x4& transform = Matrix3x4::IDENTITY);
+    /// Draw persistent geometry this frame with a transform. Return false if no geometry is recorded under the key.
+    bool DrawPersistentGeometry(StringHash key, const Matrix3x4& transform = Matrix3x4::IDENTITY);
+    /// Remove persistent geometry.
+    void RemovePersistentGeometry(StringHash key);
+    /// Remove all persistent geometry.
+    void RemoveAllPersistentGeometry();
     /// Update vertex buffer and render all debug lines. The viewport and rendertarget should be set before.
     void Render();
     
@@ -145,8 +216,22 @@ public:
     bool IsInside(const BoundingBox& box) const;
     /// Return whether has something to render.
     bool HasContent() const;
+    /// Return whether persistent geometry is recorded under a key.
+    bool HasPersistentGeometry(StringHash key) const { return persistentGeometry_.Contains(key); }
+    /// Return whether is recording persistent geometry.
+    bool IsRecordingPersistentGeometry() const { return recording_; }
     
 private:
+    /// Add a debug shape as lines.
+    void AddShapeLines(DebugShape shape, const Matrix3x4& transform, unsigned color, bool depthTest);
+    /// Create the unit meshes of the debug shapes.
+    bool CreateShapeGeometry();
+    /// Render the debug shape instances.
+    void RenderShapes();
+    /// Render the persistent geometry queued for this frame.
+    void RenderPersistentGeometry();
+    /// Set the vertex color shaders, the transforms and a vertex buffer of lines and triangles for drawing.
+    void PrepareVertexColorDraw(VertexBuffer* buffer, const Matrix3x4& transform);
     /// Handle end of frame. Clear debug geometry.
     void HandleEndFrame(StringHash eventType, VariantMap& eventData);
     
@@ -166,6 +251,34 @@ private:
     Frustum frustum_;
     /// Vertex buffer.
     SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Debug shape instances.
+    PODVector<DebugInstance> instances_[MAX_DEBUG_SHAPES];
+    /// Persistent geometry by key.
+    HashMap<StringHash, DebugPersistentGeometry> persistentGeometry_;
+    /// Persistent geometry to draw this frame with its transform.
+    Vector<Pair<StringHash, Matrix3x4> > persistentDraws_;
+    /// Lines of the frame, set aside while recording persistent geometry.
+    PODVector<DebugLine> frameLines_[2];
+    /// Triangles of the frame, set aside while recording persistent geometry.
+    PODVector<DebugTriangle> frameTriangles_[2];
+    /// Key of the persistent geometry being recorded.
+    StringHash recordingKey_;
+    /// Recording persistent geometry flag.
+    bool recording_;
+    /// Unit mesh line end points of each debug shape.
+    PODVector<Vector3> shapeLines_[MAX_DEBUG_SHAPES];
+    /// Unit mesh vertex buffer of the debug shapes.
+    SharedPtr<VertexBuffer> shapeVertexBuffer_;
+    /// Unit mesh index buffer of the debug shapes.
+    SharedPtr<IndexBuffer> shapeIndexBuffer_;
+    /// Index start of each debug shape's unit mesh.
+    unsigned shapeIndexStart_[MAX_DEBUG_SHAPES];
+    /// Index count of each debug shape's unit mesh.
+    unsigned shapeIndexCount_[MAX_DEBUG_SHAPES];
+    /// Instance transform buffer of the debug shapes.
+    SharedPtr<VertexBuffer> instanceBuffer_;
+    /// Mutex for adding lines and triangles from worker threads.
+    Mutex addMutex_;
 };
 
 }
@@ -37,8 +37,10 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Graphics/Tangent.h"
+#include "../Core/Timer.h"
 #include "../IO/VectorBuffer.h"
 #include "../Graphics/VertexBuffer.h"
+#include "../Core/WorkQueue.h"
 
 #include "../DebugNew.h"
 
@@ -52,6 +54,9 @@ static const unsigned MIN_INDICES = 6;
 static const unsigned MAX_VERTICES = 65536;
 static const unsigned DEFAULT_MAX_VERTICES = 512;
 static const unsigned DEFAULT_MAX_INDICES = 1024;
+static const unsigned DEFAULT_FACE_CACHE_SIZE = 16;
+/// Size of a face cache region relative to the bounding box of the decal that created it.
+static const float FACE_CACHE_REGION_SCALE = 4.0f;
 static const unsigned STATIC_ELEMENT_MASK = MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT;
 static const unsigned SKINNED_ELEMENT_MASK = MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT | MASK_BLENDWEIGHTS |
     MASK_BLENDINDICES;
@@ -124,6 +129,555 @@ static void ClipPolygon(PODVector<DecalVertex>& dest, const PODVector<DecalVerte
         dest.Push(ClipEdge(src[last], src[0], lastDistance, distance, skinned));
 }
 
+/// Target geometry data of one batch for clipping a decal.
+struct DecalSource
+{
+    /// Construct with defaults.
+    DecalSource() :
+        positionData_(0),
+        normalData_(0),
+        skinningData_(0),
+        indexData_(0),
+        positionStride_(0),
+        normalStride_(0),
+        skinningStride_(0),
+        indexStride_(0),
+        indexStart_(0),
+        indexCount_(0),
+        vertexStart_(0),
+        vertexCount_(0),
+        batchIndex_(0),
+        packedNormals_(false),
+        packedBlendWeights_(false)
+    {
+    }
+
+    /// References that keep the vertex and index data alive while a worker thread reads it.
+    Vector<SharedArrayPtr<unsigned char> > dataRefs_;
+    /// Position data.
+    const unsigned char* positionData_;
+    /// Normal data.
+    const unsigned char* normalData_;
+    /// Blend weight and index data.
+    const unsigned char* skinningData_;
+    /// Index data, or null for non-indexed geometry.
+    const unsigned char* indexData_;
+    /// Position stride.
+    unsigned positionStride_;
+    /// Normal stride.
+    unsigned normalStride_;
+    /// Skinning stride.
+    unsigned skinningStride_;
+    /// Index size.
+    unsigned indexStride_;
+    /// Index start.
+    unsigned indexStart_;
+    /// Index count.
+    unsigned indexCount_;
+    /// Vertex start.
+    unsigned vertexStart_;
+    /// Vertex count.
+    unsigned vertexCount_;
+    /// Batch index in the target drawable.
+    unsigned batchIndex_;
+    /// Whether normals are stored as 16-bit normalized integers.
+    bool packedNormals_;
+    /// Whether blend weights are stored as 8-bit normalized integers.
+    bool packedBlendWeights_;
+    /// Skeleton bone indices of the geometry's blend indices when the target uses per-geometry skinning.
+    PODVector<unsigned> boneMapping_;
+    /// Cached region to read the faces from instead of the geometry.
+    SharedPtr<DecalFaceCache> cache_;
+    /// New cached region to fill from the geometry and read the faces from.
+    SharedPtr<DecalFaceCache> newCache_;
+};
+
+/// Triangles of a static target geometry overlapping a region of its local space.
+struct DecalFaceCache : public RefCounted
+{
+    /// Source geometry.
+    WeakPtr<Geometry> geometry_;
+    /// Source position data, to detect reallocated vertex data.
+    const unsigned char* positionData_;
+    /// Region in geometry local space.
+    BoundingBox region_;
+    /// Vertices of the overlapping triangles, three per triangle.
+    PODVector<DecalVertex> vertices_;
+};
+
+/// Decal clipping request, executed either immediately or in a worker thread.
+struct DecalProjection : public RefCounted
+{
+    /// Construct with defaults.
+    DecalProjection() :
+        normalCutoff_(0.0f),
+        maxVertices_(0),
+        maxIndices_(0),
+        skinned_(false)
+    {
+    }
+
+    /// Work item for a queued decal.
+    SharedPtr<WorkItem> item_;
+    /// Target drawable.
+    WeakPtr<Drawable> target_;
+    /// Target geometry data.
+    Vector<DecalSource> sources_;
+    /// Decal frustum in target geometry space.
+    Frustum frustum_;
+    /// Decal frustum transform in target geometry space.
+    Matrix3x4 frustumTransform_;
+    /// Decal projection for calculating UVs.
+    Matrix4 projection_;
+    /// Transform from target geometry space to the decal set's local space.
+    Matrix3x4 decalTransform_;
+    /// Decal normal in target geometry space.
+    Vector3 decalNormal_;
+    /// Top-left UV coordinate.
+    Vector2 topLeftUV_;
+    /// Bottom-right UV coordinate.
+    Vector2 bottomRightUV_;
+    /// Face normal cutoff.
+    float normalCutoff_;
+    /// Maximum decal vertices when the request was made.
+    unsigned maxVertices_;
+    /// Maximum decal vertex indices when the request was made.
+    unsigned maxIndices_;
+    /// Skinned mode flag.
+    bool skinned_;
+    /// Skeleton bone indices referenced by the resulting decal's blend indices.
+    PODVector<unsigned> bones_;
+    /// Resulting decal.
+    Decal decal_;
+};
+
+/// Return whether a target triangle faces the decal and is not culled completely by the decal frustum.
+static bool IsDecalFace(const DecalProjection& projection, const Vector3& v0, const Vector3& v1, const Vector3& v2,
+    const Vector3& n0, const Vector3& n1, const Vector3& n2)
+{
+    // Check if face is too much away from the decal normal
+    if (projection.decalNormal_.DotProduct((n0 + n1 + n2) / 3.0f) < projection.normalCutoff_)
+        return false;
+
+    // Check if face is culled completely by any of the planes
+    for (unsigned i = PLANE_FAR; i < NUM_FRUSTUM_PLANES; --i)
+    {
+        const Plane& plane = projection.frustum_.planes_[i];
+        if (plane.Distance(v0) < 0.0f && plane.Distance(v1) < 0.0f && plane.Distance(v2) < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+/// Read a target vertex normal.
+static Vector3 ReadNormal(const unsigned char* data, bool packed)
+{
+    if (!packed)
+        return *((const Vector3*)data);
+
+    const short* src = (const short*)data;
+    return Vector3(Max(src[0] / 32767.0f, -1.0f), Max(src[1] / 32767.0f, -1.0f), Max(src[2] / 32767.0f, -1.0f));
+}
+
+/// Read target vertex blend weights. Return pointer to the blend indices that follow them.
+static const unsigned char* ReadBlendWeights(const unsigned char* data, bool packed, float* blendWeights)
+{
+    if (!packed)
+    {
+        for (unsigned i = 0; i < 4; ++i)
+            blendWeights[i] = ((const float*)data)[i];
+        return data + 4 * sizeof(float);
+    }
+
+    for (unsigned i = 0; i < 4; ++i)
+        blendWeights[i] = data[i] / 255.0f;
+    return data + 4;
+}
+
+/// Remap blend indices of a target vertex to the bones of a decal projection. Return true if successful.
+static bool GetProjectionBones(DecalProjection& projection, const DecalSource& source, const float* blendWeights,
+    const unsigned char* blendIndices, unsigned char* newBlendIndices)
+{
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (blendWeights[i] > 0.0f)
+        {
+            unsigned skeletonIndex = blendIndices[i];
+            if (!source.boneMapping_.Empty())
+            {
+                if (skeletonIndex >= source.boneMapping_.Size())
+                {
+                    LOGWARNING("Out of range bone index for skinned decal");
+                    return false;
+                }
+                skeletonIndex = source.boneMapping_[skeletonIndex];
+            }
+
+            unsigned index;
+            for (index = 0; index < projection.bones_.Size(); ++index)
+            {
+                if (projection.bones_[index] == skeletonIndex)
+                    break;
+            }
+
+            if (index == projection.bones_.Size())
+            {
+                if (index >= Graphics::GetMaxBones())
+                {
+                    LOGWARNING("Maximum skinned decal bone count reached");
+                    return false;
+                }
+                projection.bones_.Push(skeletonIndex);
+            }
+
+            newBlendIndices[i] = index;
+        }
+        else
+            newBlendIndices[i] = 0;
+    }
+
+    return true;
+}
+
+/// Call a functor with the vertex indices of each triangle in a target geometry.
+template <class F> static void ForEachTriangle(const DecalSource& source, F& functor)
+{
+    if (source.indexData_)
+    {
+        // 16-bit indices
+        if (source.indexStride_ == sizeof(unsigned short))
+        {
+            const unsigned short* indices = ((const unsigned short*)source.indexData_) + source.indexStart_;
+            const unsigned short* indicesEnd = indices + source.indexCount_;
+
+            while (indices < indicesEnd)
+            {
+                functor(indices[0], indices[1], indices[2]);
+                indices += 3;
+            }
+        }
+        else
+        // 32-bit indices
+        {
+            const unsigned* indices = ((const unsigned*)source.indexData_) + source.indexStart_;
+            const unsigned* indicesEnd = indices + source.indexCount_;
+
+            while (indices < indicesEnd)
+            {
+                functor(indices[0], indices[1], indices[2]);
+                indices += 3;
+            }
+        }
+    }
+    else
+    {
+        // Non-indexed geometry
+        unsigned indices = source.vertexStart_;
+        unsigned indicesEnd = indices + source.vertexCount_;
+
+        while (indices + 2 < indicesEnd)
+        {
+            functor(indices, indices + 1, indices + 2);
+            indices += 3;
+        }
+    }
+}
+
+/// Triangle functor that reads target geometry triangles, either as decal faces or into a face cache region.
+struct DecalFaceReader
+{
+    /// Construct.
+    DecalFaceReader(DecalProjection& projection, const DecalSource& source, Vector<PODVector<DecalVertex> >* faces,
+        DecalFaceCache* cache) :
+        projection_(projection),
+        source_(source),
+        faces_(faces),
+        cache_(cache)
+    {
+    }
+
+    /// Read a triangle.
+    void operator () (unsigned i0, unsigned i1, unsigned i2)
+    {
+        bool hasNormals = source_.normalData_ != 0;
+        bool hasSkinning = projection_.skinned_ && source_.skinningData_ != 0;
+
+        const Vector3& v0 = *((const Vector3*)(&source_.positionData_[i0 * source_.positionStride_]));
+        const Vector3& v1 = *((const Vector3*)(&source_.positionData_[i1 * source_.positionStride_]));
+        const Vector3& v2 = *((const Vector3*)(&source_.positionData_[i2 * source_.positionStride_]));
+
+        // Calculate unsmoothed face normals if no normal data
+        Vector3 faceNormal = Vector3::ZERO;
+        if (!hasNormals)
+        {
+            Vector3 dist1 = v1 - v0;
+            Vector3 dist2 = v2 - v0;
+            faceNormal = (dist1.CrossProduct(dist2)).Normalized();
+        }
+
+        bool packed = source_.packedNormals_;
+        Vector3 n0 = hasNormals ? ReadNormal(&source_.normalData_[i0 * source_.normalStride_], packed) : faceNormal;
+        Vector3 n1 = hasNormals ? ReadNormal(&source_.normalData_[i1 * source_.normalStride_], packed) : faceNormal;
+        Vector3 n2 = hasNormals ? ReadNormal(&source_.normalData_[i2 * source_.normalStride_], packed) : faceNormal;
+
+        if (cache_)
+        {
+            // Cache all triangles that overlap the region regardless of the decal direction
+            BoundingBox box(v0, v0);
+            box.Merge(v1);
+            box.Merge(v2);
+            if (cache_->region_.IsInside(box) != OUTSIDE)
+            {
+                cache_->vertices_.Push(DecalVertex(v0, n0));
+                cache_->vertices_.Push(DecalVertex(v1, n1));
+                cache_->vertices_.Push(DecalVertex(v2, n2));
+            }
+            return;
+        }
+
+        if (!IsDecalFace(projection_, v0, v1, v2, n0, n1, n2))
+            return;
+
+        if (!hasSkinning)
+        {
+            faces_->Resize(faces_->Size() + 1);
+            PODVector<DecalVertex>& face = faces_->Back();
+            face.Reserve(3);
+            face.Push(DecalVertex(v0, n0));
+            face.Push(DecalVertex(v1, n1));
+            face.Push(DecalVertex(v2, n2));
+        }
+        else
+        {
+            bool packedWeights = source_.packedBlendWeights_;
+            float bw0[4];
+            float bw1[4];
+            float bw2[4];
+            const unsigned char* bi0 = ReadBlendWeights(&source_.skinningData_[i0 * source_.skinningStride_], packedWeights, bw0);
+            const unsigned char* bi1 = ReadBlendWeights(&source_.skinningData_[i1 * source_.skinningStride_], packedWeights, bw1);
+            const unsigned char* bi2 = ReadBlendWeights(&source_.skinningData_[i2 * source_.skinningStride_], packedWeights, bw2);
+            unsigned char nbi0[4];
+            unsigned char nbi1[4];
+            unsigned char nbi2[4];
+
+            // Make sure all bones are found and that there is room in the skinning matrices
+            if (!GetProjectionBones(projection_, source_, bw0, bi0, nbi0) || !GetProjectionBones(projection_, source_, bw1, bi1,
+                nbi1) || !GetProjectionBones(projection_, source_, bw2, bi2, nbi2))
+                return;
+
+            faces_->Resize(faces_->Size() + 1);
+            PODVector<DecalVertex>& face = faces_->Back();
+            face.Reserve(3);
+            face.Push(DecalVertex(v0, n0, bw0, nbi0));
+            face.Push(DecalVertex(v1, n1, bw1, nbi1));
+            face.Push(DecalVertex(v2, n2, bw2, nbi2));
+        }
+    }
+
+    /// Decal projection.
+    DecalProjection& projection_;
+    /// Target geometry data.
+    const DecalSource& source_;
+    /// Destination decal faces.
+    Vector<PODVector<DecalVertex> >* faces_;
+    /// Destination face cache region, or null to read decal faces.
+    DecalFaceCache* cache_;
+};
+
+/// Get decal faces from a cached target geometry region.
+static void GetCachedFaces(Vector<PODVector<DecalVertex> >& faces, const DecalProjection& projection, const DecalFaceCache& cache)
+{
+    for (unsigned i = 0; i + 2 < cache.vertices_.Size(); i += 3)
+    {
+        const DecalVertex& v0 = cache.vertices_[i];
+        const DecalVertex& v1 = cache.vertices_[i + 1];
+        const DecalVertex& v2 = cache.vertices_[i + 2];
+        if (!IsDecalFace(projection, v0.position_, v1.position_, v2.position_, v0.normal_, v1.normal_, v2.normal_))
+            continue;
+
+        faces.Resize(faces.Size() + 1);
+        PODVector<DecalVertex>& face = faces.Back();
+        face.Reserve(3);
+        face.Push(v0);
+        face.Push(v1);
+        face.Push(v2);
+    }
+}
+
+/// Calculate UV coordinates for the decal.
+static void CalculateUVs(Decal& decal, const Matrix3x4& view, const Matrix4& projection, const Vector2& topLeftUV,
+    const Vector2& bottomRightUV)
+{
+    Matrix4 viewProj = projection * view;
+
+    for (PODVector<DecalVertex>::Iterator i = decal.vertices_.Begin(); i != decal.vertices_.End(); ++i)
+    {
+        Vector3 projected = viewProj * i->position_;
+        i->texCoord_ = Vector2(
+            Lerp(topLeftUV.x_, bottomRightUV.x_, projected.x_ * 0.5f + 0.5f),
+            Lerp(bottomRightUV.y_, topLeftUV.y_, projected.y_ * 0.5f + 0.5f)
+        );
+    }
+}
+
+/// Transform decal's vertices from the target geometry to the decal set local space.
+static void TransformVertices(Decal& decal, const Matrix3x4& transform)
+{
+    for (PODVector<DecalVertex>::Iterator i = decal.vertices_.Begin(); i != decal.vertices_.End(); ++i)
+    {
+        i->position_ = transform * i->position_;
+        i->normal_ = (transform * i->normal_).Normalized();
+    }
+}
+
+/// Clip the target geometry against the decal frustum and build the decal. Does not access the scene, so may be called from a worker thread.
+static void ProjectDecal(DecalProjection& projection)
+{
+    Vector<PODVector<DecalVertex> > faces;
+    PODVector<DecalVertex> tempFace;
+
+    for (unsigned i = 0; i < projection.sources_.Size(); ++i)
+    {
+        const DecalSource& source = projection.sources_[i];
+
+        // Fill a new cached region first, then read the faces from it like from an existing one
+        if (source.newCache_)
+        {
+            DecalFaceReader reader(projection, source, 0, source.newCache_);
+            ForEachTriangle(source, reader);
+        }
+
+        DecalFaceCache* cache = source.cache_ ? source.cache_.Get() : source.newCache_.Get();
+        if (cache)
+            GetCachedFaces(faces, projection, *cache);
+        else
+        {
+            DecalFaceReader reader(projection, source, &faces, 0);
+            ForEachTriangle(source, reader);
+        }
+    }
+
+    // Clip the acquired faces against all frustum planes
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        for (unsigned j = 0; j < faces.Size(); ++j)
+        {
+            PODVector<DecalVertex>& face = faces[j];
+            if (face.Empty())
+                continue;
+
+            ClipPolygon(tempFace, face, projection.frustum_.planes_[i], projection.skinned_);
+            face = tempFace;
+        }
+    }
+
+    // Now triangulate the resulting faces into decal vertices
+    Decal& newDecal = projection.decal_;
+    for (unsigned i = 0; i < faces.Size(); ++i)
+    {
+        PODVector<DecalVertex>& face = faces[i];
+        if (face.Size() < 3)
+            continue;
+
+        for (unsigned j = 2; j < face.Size(); ++j)
+        {
+            newDecal.AddVertex(face[0]);
+            newDecal.AddVertex(face[j - 1]);
+            newDecal.AddVertex(face[j]);
+        }
+    }
+
+    // Leave empty and oversized decals to be checked when adding
+    if (newDecal.vertices_.Empty() || newDecal.vertices_.Size() > projection.maxVertices_ || newDecal.indices_.Size() >
+        projection.maxIndices_)
+        return;
+
+    CalculateUVs(newDecal, projection.frustumTransform_.Inverse(), projection.projection_, projection.topLeftUV_,
+        projection.bottomRightUV_);
+
+    // Transform vertices to the decal set's local space and generate tangents
+    TransformVertices(newDecal, projection.decalTransform_);
+    GenerateTangents(&newDecal.vertices_[0], sizeof(DecalVertex), &newDecal.indices_[0], sizeof(unsigned short), 0,
+        newDecal.indices_.Size(), offsetof(DecalVertex, normal_), offsetof(DecalVertex, texCoord_), offsetof(DecalVertex,
+        tangent_));
+
+    newDecal.CalculateBoundingBox();
+}
+
+/// Work function for clipping a queued decal.
+static void ProjectDecalWork(const WorkItem* item, unsigned threadIndex)
+{
+    ProjectDecal(*reinterpret_cast<DecalProjection*>(item->aux_));
+}
+
+/// Get the CPU-side vertex and index data of a target geometry. Return true if positions are available.
+static bool GetSourceData(DecalSource& source, Geometry* geometry)
+{
+    IndexBuffer* ib = geometry->GetIndexBuffer();
+    if (ib && ib->GetShadowData())
+    {
+        source.dataRefs_.Push(ib->GetShadowDataShared());
+        source.indexData_ = ib->GetShadowData();
+        source.indexStride_ = ib->GetIndexSize();
+    }
+
+    // For morphed models positions, normals and skinning may be in different buffers
+    for (unsigned i = 0; i < geometry->GetNumVertexBuffers(); ++i)
+    {
+        VertexBuffer* vb = geometry->GetVertexBuffer(i);
+        if (!vb)
+            continue;
+
+        unsigned elementMask = geometry->GetVertexElementMask(i);
+        unsigned char* data = vb->GetShadowData();
+        if (!data)
+            continue;
+
+        source.dataRefs_.Push(vb->GetShadowDataShared());
+        if (elementMask & MASK_POSITION)
+        {
+            source.positionData_ = data;
+            source.positionStride_ = vb->GetVertexSize();
+        }
+        if (elementMask & MASK_NORMAL)
+        {
+            source.normalData_ = data + vb->GetElementOffset(ELEMENT_NORMAL);
+            source.normalStride_ = vb->GetVertexSize();
+            source.packedNormals_ = (vb->GetElementMask() & MASK_PACKEDNORMALS) != 0;
+        }
+        if (elementMask & MASK_BLENDWEIGHTS)
+        {
+            source.skinningData_ = data + vb->GetElementOffset(ELEMENT_BLENDWEIGHTS);
+            source.skinningStride_ = vb->GetVertexSize();
+            source.packedBlendWeights_ = (vb->GetElementMask() & MASK_PACKEDBLENDWEIGHTS) != 0;
+        }
+    }
+
+    // Positions and indices are needed
+    if (!source.positionData_)
+    {
+        // As a fallback, try to get the geometry's raw vertex/index data
+        SharedArrayPtr<unsigned char> vertexData;
+        SharedArrayPtr<unsigned char> indexData;
+        unsigned elementMask;
+        geometry->GetRawDataShared(vertexData, source.positionStride_, indexData, source.indexStride_, elementMask);
+        if (!vertexData)
+            return false;
+
+        source.dataRefs_.Push(vertexData);
+        source.dataRefs_.Push(indexData);
+        source.positionData_ = vertexData.Get();
+        source.indexData_ = indexData.Get();
+    }
+
+    source.indexStart_ = geometry->GetIndexStart();
+    source.indexCount_ = geometry->GetIndexCount();
+    source.vertexStart_ = geometry->GetVertexStart();
+    source.vertexCount_ = geometry->GetVertexCount();
+    return true;
+}
+
 void Decal::AddVertex(const DecalVertex& vertex)
 {
     for (unsigned i = 0; i < vertices_.Size(); ++i)
@@ -156,6 +710,7 @@ DecalSet::DecalSet(Context* context) :
     numIndices_(0),
     maxVertices_(DEFAULT_MAX_VERTICES),
     maxIndices_(DEFAULT_MAX_INDICES),
+    faceCacheSize_(DEFAULT_FACE_CACHE_SIZE),
     skinned_(false),
     bufferSizeDirty_(true),
     bufferDirty_(true),
@@ -173,6 +728,7 @@ DecalSet::DecalSet(Context* context) :
 
 DecalSet::~DecalSet()
 {
+    CancelProjections();
 }
 
 void DecalSet::RegisterObject(Context* context)
@@ -283,187 +839,59 @@ void DecalSet::SetMaxIndices(unsigned num)
     }
 }
 
-bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size,
-    float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive, float normalCutoff,
-    unsigned subGeometry)
+void DecalSet::SetFaceCacheSize(unsigned num)
 {
-    PROFILE(AddDecal);
-
-    // Do not add decals in headless mode
-    if (!node_ || !GetSubsystem<Graphics>())
-        return false;
-
-    if (!target || !target->GetNode())
-    {
-        LOGERROR("Null target drawable for decal");
-        return false;
-    }
-
-    // Check for animated target and switch into skinned/static mode if necessary
-    AnimatedModel* animatedModel = dynamic_cast<AnimatedModel*>(target);
-    if ((animatedModel && !skinned_) || (!animatedModel && skinned_))
-    {
-        RemoveAllDecals();
-        skinned_ = animatedModel != 0;
-        bufferSizeDirty_ = true;
-    }
-
-    // Center the decal frustum on the world position
-    Vector3 adjustedWorldPosition = worldPosition - 0.5f * depth * (worldRotation * Vector3::FORWARD);
-    /// \todo target transform is not right if adding a decal to StaticModelGroup
-    Matrix3x4 targetTransform = target->GetNode()->GetWorldTransform().Inverse();
-
-    // For an animated model, adjust the decal position back to the bind pose
-    // To do this, need to find the bone the decal is colliding with
-    if (animatedModel)
-    {
-        Skeleton& skeleton = animatedModel->GetSkeleton();
-        unsigned numBones = skeleton.GetNumBones();
-        Bone* bestBone = 0;
-        float bestSize = 0.0f;
-
-        for (unsigned i = 0; i < numBones; ++i)
-        {
-            Bone* bone = skeleton.GetBone(i);
-            if (!bone->node_ || !bone->collisionMask_)
-                continue;
-
-            // Represent the decal as a sphere, try to find the biggest colliding bone
-            Sphere decalSphere(bone->node_->GetWorldTransform().Inverse() * worldPosition, 0.5f * size /
-                bone->node_->GetWorldScale().Length());
-
-            if (bone->collisionMask_ & BONECOLLISION_BOX)
-            {
-                float size = bone->boundingBox_.HalfSize().Length();
-                if (bone->boundingBox_.IsInside(decalSphere) && size > bestSize)
-                {
-                    bestBone = bone;
-                    bestSize = size;
-                }
-            }
-            else if (bone->collisionMask_ & BONECOLLISION_SPHERE)
-            {
-                Sphere boneSphere(Vector3::ZERO, bone->radius_);
-                float size = bone->radius_;
-                if (boneSphere.IsInside(decalSphere) && size > bestSize)
-                {
-                    bestBone = bone;
-                    bestSize = size;
-                }
-            }
-        }
-
-        if (bestBone)
-            targetTransform = (bestBone->node_->GetWorldTransform() * bestBone->offsetMatrix_).Inverse();
-    }
-
-    // Build the decal frustum
-    Frustum decalFrustum;
-    Matrix3x4 frustumTransform = targetTransform * Matrix3x4(adjustedWorldPosition, worldRotation, 1.0f);
-    decalFrustum.DefineOrtho(size, aspectRatio, 1.0, 0.0f, depth, frustumTransform);
-
-    Vector3 decalNormal = (targetTransform * Vector4(worldRotation * Vector3::BACK, 0.0f)).Normalized();
-
-    decals_.Resize(decals_.Size() + 1);
-    Decal& newDecal = decals_.Back();
-    newDecal.timeToLive_ = timeToLive;
-
-    Vector<PODVector<DecalVertex> > faces;
-    PODVector<DecalVertex> tempFace;
-
-    unsigned numBatches = target->GetBatches().Size();
-
-    // Use either a specified subgeometry in the target, or all
-    if (subGeometry < numBatches)
-        GetFaces(faces, target, subGeometry, decalFrustum, decalNormal, normalCutoff);
-    else
-    {
-        for (unsigned i = 0; i < numBatches; ++i)
-            GetFaces(faces, target, i, decalFrustum, decalNormal, normalCutoff);
-    }
-
-    // Clip the acquired faces against all frustum planes
-    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
-    {
-        for (unsigned j = 0; j < faces.Size(); ++j)
-        {
-            PODVector<DecalVertex>& face = faces[j];
-            if (face.Empty())
-                continue;
-
-            ClipPolygon(tempFace, face, decalFrustum.planes_[i], skinned_);
-            face = tempFace;
-        }
-    }
-
-    // Now triangulate the resulting faces into decal vertices
-    for (unsigned i = 0; i < faces.Size(); ++i)
-    {
-        PODVector<DecalVertex>& face = faces[i];
-        if (face.Size() < 3)
-            continue;
-
-        for (unsigned j = 2; j < face.Size(); ++j)
-        {
-            newDecal.AddVertex(face[0]);
-            newDecal.AddVertex(face[j - 1]);
-            newDecal.AddVertex(face[j]);
-        }
-    }
-
-    // Check if resulted in no triangles
-    if (newDecal.vertices_.Empty())
-    {
-        decals_.Pop();
-        return true;
-    }
+    faceCacheSize_ = num;
+    if (faceCache_.Size() > faceCacheSize_)
+        faceCache_.Erase(0, faceCache_.Size() - faceCacheSize_);
+}
 
-    if (newDecal.vertices_.Size() > maxVertices_)
-    {
-        LOGWARNING("Can not add decal, vertex count " + String(newDecal.vertices_.Size()) + " exceeds maximum " +
-            String(maxVertices_));
-        decals_.Pop();
-        return false;
-    }
-    if (newDecal.indices_.Size() > maxIndices_)
-    {
-        LOGWARNING("Can not add decal, index count " + String(newDecal.indices_.Size()) + " exceeds maximum " +
-            String(maxIndices_));
-        decals_.Pop();
+bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size,
+    float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive, float normalCutoff,
+    unsigned subGeometry)
+{
+    PROFILE(AddDecal);
+
+    SharedPtr<DecalProjection> projection = BeginProjection(target, worldPosition, worldRotation, size, aspectRatio, depth,
+        topLeftUV, bottomRightUV, timeToLive, normalCutoff, subGeometry);
+    if (!projection)
         return false;
-    }
 
-    // Calculate UVs
-    Matrix4 projection(Matrix4::ZERO);
-    projection.m11_ = (1.0f / (size * 0.5f));
-    projection.m00_ = projection.m11_ / aspectRatio;
-    projection.m22_ = 1.0f / depth;
-    projection.m33_ = 1.0f;
+    ProjectDecal(*projection);
+    return FinishProjection(*projection);
+}
 
-    CalculateUVs(newDecal, frustumTransform.Inverse(), projection, topLeftUV, bottomRightUV);
+bool DecalSet::AddDecalAsync(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size,
+    float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive, float normalCutoff,
+    unsigned subGeometry)
+{
+    // Queued decals are added on scene post-update, so without a scene clip immediately instead
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue || !GetScene())
+    {
+        return AddDecal(target, worldPosition, worldRotation, size, aspectRatio, depth, topLeftUV, bottomRightUV, timeToLive,
+            normalCutoff, subGeometry);
+    }
 
-    // Transform vertices to this node's local space and generate tangents
-    Matrix3x4 decalTransform = node_->GetWorldTransform().Inverse() * target->GetNode()->GetWorldTransform();
-    TransformVertices(newDecal, skinned_ ? Matrix3x4::IDENTITY : decalTransform);
-    GenerateTangents(&newDecal.vertices_[0], sizeof(DecalVertex), &newDecal.indices_[0], sizeof(unsigned short), 0,
-        newDecal.indices_.Size(), offsetof(DecalVertex, normal_), offsetof(DecalVertex, texCoord_), offsetof(DecalVertex,
-        tangent_));
+    PROFILE(AddDecalAsync);
 
-    newDecal.CalculateBoundingBox();
-    numVertices_ += newDecal.vertices_.Size();
-    numIndices_ += newDecal.indices_.Size();
+    SharedPtr<DecalProjection> projection = BeginProjection(target, worldPosition, worldRotation, size, aspectRatio, depth,
+        topLeftUV, bottomRightUV, timeToLive, normalCutoff, subGeometry);
+    if (!projection)
+        return false;
 
-    // Remove oldest decals if total vertices exceeded
-    while (decals_.Size() && (numVertices_ > maxVertices_ || numIndices_ > maxIndices_))
-        RemoveDecals(1);
+    // Use an own work item instead of the pool, so that it stays valid for polling after completion
+    projection->item_ = new WorkItem();
+    projection->item_->workFunction_ = ProjectDecalWork;
+    projection->item_->aux_ = projection.Get();
+    projection->item_->priority_ = 0;
 
-    LOGDEBUG("Added decal with " + String(newDecal.vertices_.Size()) + " vertices");
+    projections_.Push(projection);
+    queue->AddWorkItem(projection->item_);
 
-    // If new decal is time limited, subscribe to scene post-update
-    if (newDecal.timeToLive_ > 0.0f && !subscribed_)
+    if (!subscribed_)
         UpdateEventSubscription(false);
 
-    MarkDecalsDirty();
     return true;
 }
 
@@ -475,6 +903,8 @@ void DecalSet::RemoveDecals(unsigned num)
 
 void DecalSet::RemoveAllDecals()
 {
+    CancelProjections();
+
     if (!decals_.Empty())
     {
         decals_.Clear();
@@ -495,6 +925,11 @@ void DecalSet::RemoveAllDecals()
     UpdateBatch();
 }
 
+void DecalSet::ClearFaceCache()
+{
+    faceCache_.Clear();
+}
+
 Material* DecalSet::GetMaterial() const
 {
     return batches_[0].material_;
@@ -680,291 +1115,327 @@ void DecalSet::OnWorldBoundingBoxUpdate()
     }
 }
 
-void DecalSet::GetFaces(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, const Frustum& frustum,
-    const Vector3& decalNormal, float normalCutoff)
+SharedPtr<DecalProjection> DecalSet::BeginProjection(Drawable* target, const Vector3& worldPosition,
+    const Quaternion& worldRotation, float size, float aspectRatio, float depth, const Vector2& topLeftUV,
+    const Vector2& bottomRightUV, float timeToLive, float normalCutoff, unsigned subGeometry)
 {
-    // Try to use the most accurate LOD level if possible
-    Geometry* geometry = target->GetLodGeometry(batchIndex, 0);
-    if (!geometry || geometry->GetPrimitiveType() != TRIANGLE_LIST)
-        return;
-
-    const unsigned char* positionData = 0;
-    const unsigned char* normalData = 0;
-    const unsigned char* skinningData = 0;
-    const unsigned char* indexData = 0;
-    unsigned positionStride = 0;
-    unsigned normalStride = 0;
-    unsigned skinningStride = 0;
-    unsigned indexStride = 0;
+    // Do not add decals in headless mode
+    if (!node_ || !GetSubsystem<Graphics>())
+        return SharedPtr<DecalProjection>();
 
-    IndexBuffer* ib = geometry->GetIndexBuffer();
-    if (ib)
+    if (!target || !target->GetNode())
     {
-        indexData = ib->GetShadowData();
-        indexStride = ib->GetIndexSize();
+        LOGERROR("Null target drawable for decal");
+        return SharedPtr<DecalProjection>();
     }
 
-    // For morphed models positions, normals and skinning may be in different buffers
-    for (unsigned i = 0; i < geometry->GetNumVertexBuffers(); ++i)
+    // Check for animated target and switch into skinned/static mode if necessary
+    AnimatedModel* animatedModel = dynamic_cast<AnimatedModel*>(target);
+    if ((animatedModel && !skinned_) || (!animatedModel && skinned_))
     {
-        VertexBuffer* vb = geometry->GetVertexBuffer(i);
-        if (!vb)
-            continue;
+        RemoveAllDecals();
+        skinned_ = animatedModel != 0;
+        bufferSizeDirty_ = true;
+    }
 
-        unsigned elementMask = geometry->GetVertexElementMask(i);
-        unsigned char* data = vb->GetShadowData();
-        if (!data)
-            continue;
+    // Re-read the target model's CPU-side geometry data if it was released after upload. The decal sources keep references to it
+    StaticModel* staticModel = dynamic_cast<StaticModel*>(target);
+    if (staticModel && staticModel->GetModel())
+        staticModel->GetModel()->RequestCPUData();
 
-        if (elementMask & MASK_POSITION)
-        {
-            positionData = data;
-            positionStride = vb->GetVertexSize();
-        }
-        if (elementMask & MASK_NORMAL)
-        {
-            normalData = data + vb->GetElementOffset(ELEMENT_NORMAL);
-            normalStride = vb->GetVertexSize();
-        }
-        if (elementMask & MASK_BLENDWEIGHTS)
-        {
-            skinningData = data + vb->GetElementOffset(ELEMENT_BLENDWEIGHTS);
-            skinningStride = vb->GetVertexSize();
-        }
-    }
+    // Center the decal frustum on the world position
+    Vector3 adjustedWorldPosition = worldPosition - 0.5f * depth * (worldRotation * Vector3::FORWARD);
+    /// \todo target transform is not right if adding a decal to StaticModelGroup
+    Matrix3x4 targetTransform = target->GetNode()->GetWorldTransform().Inverse();
 
-    // Positions and indices are needed
-    if (!positionData)
+    // For an animated model, adjust the decal position back to the bind pose
+    // To do this, need to find the bone the decal is colliding with
+    if (animatedModel)
     {
-        // As a fallback, try to get the geometry's raw vertex/index data
-        unsigned elementMask;
-        geometry->GetRawData(positionData, positionStride, indexData, indexStride, elementMask);
-        if (!positionData)
+        Skeleton& skeleton = animatedModel->GetSkeleton();
+        unsigned numBones = skeleton.GetNumBones();
+        Bone* bestBone = 0;
+        float bestSize = 0.0f;
+
+        for (unsigned i = 0; i < numBones; ++i)
         {
-            LOGWARNING("Can not add decal, target drawable has no CPU-side geometry data");
-            return;
+            Bone* bone = skeleton.GetBone(i);
+            if (!bone->node_ || !bone->collisionMask_)
+                continue;
+
+            // Represent the decal as a sphere, try to find the biggest colliding bone
+            Sphere decalSphere(bone->node_->GetWorldTransform().Inverse() * worldPosition, 0.5f * size /
+                bone->node_->GetWorldScale().Length());
+
+            if (bone->collisionMask_ & BONECOLLISION_BOX)
+            {
+                float size = bone->boundingBox_.HalfSize().Length();
+                if (bone->boundingBox_.IsInside(decalSphere) && size > bestSize)
+                {
+                    bestBone = bone;
+                    bestSize = size;
+                }
+            }
+            else if (bone->collisionMask_ & BONECOLLISION_SPHERE)
+            {
+                Sphere boneSphere(Vector3::ZERO, bone->radius_);
+                float size = bone->radius_;
+                if (boneSphere.IsInside(decalSphere) && size > bestSize)
+                {
+                    bestBone = bone;
+                    bestSize = size;
+                }
+            }
         }
+
+        if (bestBone)
+            targetTransform = (bestBone->node_->GetWorldTransform() * bestBone->offsetMatrix_).Inverse();
     }
 
-    if (indexData)
+    SharedPtr<DecalProjection> projection(new DecalProjection());
+    projection->target_ = target;
+    projection->skinned_ = skinned_;
+    projection->normalCutoff_ = normalCutoff;
+    projection->topLeftUV_ = topLeftUV;
+    projection->bottomRightUV_ = bottomRightUV;
+    projection->maxVertices_ = maxVertices_;
+    projection->maxIndices_ = maxIndices_;
+    projection->decal_.timeToLive_ = timeToLive;
+
+    // Build the decal frustum
+    projection->frustumTransform_ = targetTransform * Matrix3x4(adjustedWorldPosition, worldRotation, 1.0f);
+    projection->frustum_.DefineOrtho(size, aspectRatio, 1.0, 0.0f, depth, projection->frustumTransform_);
+    projection->decalNormal_ = (targetTransform * Vector4(worldRotation * Vector3::BACK, 0.0f)).Normalized();
+
+    projection->projection_ = Matrix4::ZERO;
+    projection->projection_.m11_ = (1.0f / (size * 0.5f));
+    projection->projection_.m00_ = projection->projection_.m11_ / aspectRatio;
+    projection->projection_.m22_ = 1.0f / depth;
+    projection->projection_.m33_ = 1.0f;
+
+    projection->decalTransform_ = skinned_ ? Matrix3x4::IDENTITY : node_->GetWorldTransform().Inverse() *
+        target->GetNode()->GetWorldTransform();
+
+    // Use either a specified subgeometry in the target, or all
+    unsigned numBatches = target->GetBatches().Size();
+    unsigned firstBatch = subGeometry < numBatches ? subGeometry : 0;
+    unsigned lastBatch = subGeometry < numBatches ? subGeometry + 1 : numBatches;
+    BoundingBox decalBox(projection->frustum_);
+
+    for (unsigned i = firstBatch; i < lastBatch; ++i)
     {
-        unsigned indexStart = geometry->GetIndexStart();
-        unsigned indexCount = geometry->GetIndexCount();
+        // Try to use the most accurate LOD level if possible
+        Geometry* geometry = target->GetLodGeometry(i, 0);
+        if (!geometry || geometry->GetPrimitiveType() != TRIANGLE_LIST)
+            continue;
 
-        // 16-bit indices
-        if (indexStride == sizeof(unsigned short))
+        DecalSource source;
+        source.batchIndex_ = i;
+        if (!GetSourceData(source, geometry))
         {
-            const unsigned short* indices = ((const unsigned short*)indexData) + indexStart;
-            const unsigned short* indicesEnd = indices + indexCount;
+            LOGWARNING("Can not add decal, target drawable has no CPU-side geometry data");
+            continue;
+        }
 
-            while (indices < indicesEnd)
-            {
-                GetFace(faces, target, batchIndex, indices[0], indices[1], indices[2], positionData, normalData, skinningData,
-                    positionStride, normalStride, skinningStride, frustum, decalNormal, normalCutoff);
-                indices += 3;
-            }
+        if (animatedModel)
+        {
+            // Check whether target is using global or per-geometry skinning
+            const Vector<PODVector<unsigned> >& geometryBoneMappings = animatedModel->GetGeometryBoneMappings();
+            if (!animatedModel->GetGeometrySkinMatrices().Empty() && i < geometryBoneMappings.Size())
+                source.boneMapping_ = geometryBoneMappings[i];
         }
-        else
-        // 32-bit indices
+        else if (faceCacheSize_)
         {
-            const unsigned* indices = ((const unsigned*)indexData) + indexStart;
-            const unsigned* indicesEnd = indices + indexCount;
+            // For static geometry, read the faces from a cached region containing the decal, or cache a larger region
+            // around it for the next decals that hit nearby
+            for (unsigned j = faceCache_.Size() - 1; j < faceCache_.Size(); --j)
+            {
+                DecalFaceCache* entry = faceCache_[j];
+                if (entry->geometry_.Get() == geometry && entry->positionData_ == source.positionData_ &&
+                    entry->region_.IsInside(decalBox) == INSIDE)
+                {
+                    // Move to the back as the most recently used
+                    source.cache_ = entry;
+                    faceCache_.Erase(j);
+                    faceCache_.Push(source.cache_);
+                    break;
+                }
+            }
 
-            while (indices < indicesEnd)
+            if (!source.cache_)
             {
-                GetFace(faces, target, batchIndex, indices[0], indices[1], indices[2], positionData, normalData, skinningData,
-                    positionStride, normalStride, skinningStride, frustum, decalNormal, normalCutoff);
-                indices += 3;
+                Vector3 halfSize = FACE_CACHE_REGION_SCALE * decalBox.HalfSize();
+                source.newCache_ = new DecalFaceCache();
+                source.newCache_->geometry_ = geometry;
+                source.newCache_->positionData_ = source.positionData_;
+                source.newCache_->region_.Define(decalBox.Center() - halfSize, decalBox.Center() + halfSize);
             }
         }
-    }
-    else
-    {
-        // Non-indexed geometry
-        unsigned indices = geometry->GetVertexStart();
-        unsigned indicesEnd = indices + geometry->GetVertexCount();
 
-        while (indices + 2 < indicesEnd)
-        {
-            GetFace(faces, target, batchIndex, indices, indices + 1, indices + 2, positionData, normalData, skinningData,
-                positionStride, normalStride, skinningStride, frustum, decalNormal, normalCutoff);
-            indices += 3;
-        }
+        projection->sources_.Push(source);
     }
+
+    return projection;
 }
 
-void DecalSet::GetFace(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, unsigned i0, unsigned i1,
-    unsigned i2, const unsigned char* positionData, const unsigned char* normalData, const unsigned char* skinningData,
-    unsigned positionStride, unsigned normalStride, unsigned skinningStride, const Frustum& frustum, const Vector3& decalNormal,
-    float normalCutoff)
+bool DecalSet::FinishProjection(DecalProjection& projection)
 {
-    bool hasNormals = normalData != 0;
-    bool hasSkinning = skinned_ && skinningData != 0;
-
-    const Vector3& v0 = *((const Vector3*)(&positionData[i0 * positionStride]));
-    const Vector3& v1 = *((const Vector3*)(&positionData[i1 * positionStride]));
-    const Vector3& v2 = *((const Vector3*)(&positionData[i2 * positionStride]));
-
-    // Calculate unsmoothed face normals if no normal data
-    Vector3 faceNormal = Vector3::ZERO;
-    if (!hasNormals)
+    // Store the newly cached regions, dropping the least recently used and those of destroyed geometries
+    for (unsigned i = 0; i < projection.sources_.Size() && faceCacheSize_; ++i)
     {
-        Vector3 dist1 = v1 - v0;
-        Vector3 dist2 = v2 - v0;
-        faceNormal = (dist1.CrossProduct(dist2)).Normalized();
-    }
+        SharedPtr<DecalFaceCache>& newCache = projection.sources_[i].newCache_;
+        if (!newCache || newCache->geometry_.Expired())
+            continue;
 
-    const Vector3& n0 = hasNormals ? *((const Vector3*)(&normalData[i0 * normalStride])) : faceNormal;
-    const Vector3& n1 = hasNormals ? *((const Vector3*)(&normalData[i1 * normalStride])) : faceNormal;
-    const Vector3& n2 = hasNormals ? *((const Vector3*)(&normalData[i2 * normalStride])) : faceNormal;
+        for (unsigned j = faceCache_.Size() - 1; j < faceCache_.Size(); --j)
+        {
+            if (faceCache_[j]->geometry_.Expired())
+                faceCache_.Erase(j);
+        }
+        if (faceCache_.Size() >= faceCacheSize_)
+            faceCache_.Erase(0, faceCache_.Size() - faceCacheSize_ + 1);
+        faceCache_.Push(newCache);
+    }
 
-    const unsigned char* s0 = hasSkinning ? &skinningData[i0 * skinningStride] : (const unsigned char*)0;
-    const unsigned char* s1 = hasSkinning ? &skinningData[i1 * skinningStride] : (const unsigned char*)0;
-    const unsigned char* s2 = hasSkinning ? &skinningData[i2 * skinningStride] : (const unsigned char*)0;
+    Decal& newDecal = projection.decal_;
 
-    // Check if face is too much away from the decal normal
-    if (decalNormal.DotProduct((n0 + n1 + n2) / 3.0f) < normalCutoff)
-        return;
+    // Check if resulted in no triangles
+    if (newDecal.vertices_.Empty())
+        return true;
 
-    // Check if face is culled completely by any of the planes
-    for (unsigned i = PLANE_FAR; i < NUM_FRUSTUM_PLANES; --i)
+    if (newDecal.vertices_.Size() > maxVertices_ || newDecal.vertices_.Size() > projection.maxVertices_)
     {
-        const Plane& plane = frustum.planes_[i];
-        if (plane.Distance(v0) < 0.0f && plane.Distance(v1) < 0.0f && plane.Distance(v2) < 0.0f)
-            return;
+        LOGWARNING("Can not add decal, vertex count " + String(newDecal.vertices_.Size()) + " exceeds maximum " +
+            String(Min((int)maxVertices_, (int)projection.maxVertices_)));
+        return false;
     }
-
-    faces.Resize(faces.Size() + 1);
-    PODVector<DecalVertex>& face = faces.Back();
-    if (!hasSkinning)
+    if (newDecal.indices_.Size() > maxIndices_ || newDecal.indices_.Size() > projection.maxIndices_)
     {
-        face.Reserve(3);
-        face.Push(DecalVertex(v0, n0));
-        face.Push(DecalVertex(v1, n1));
-        face.Push(DecalVertex(v2, n2));
+        LOGWARNING("Can not add decal, index count " + String(newDecal.indices_.Size()) + " exceeds maximum " +
+            String(Min((int)maxIndices_, (int)projection.maxIndices_)));
+        return false;
     }
-    else
-    {
-        const float* bw0 = (const float*)s0;
-        const float* bw1 = (const float*)s1;
-        const float* bw2 = (const float*)s2;
-        const unsigned char* bi0 = s0 + sizeof(float) * 4;
-        const unsigned char* bi1 = s1 + sizeof(float) * 4;
-        const unsigned char* bi2 = s2 + sizeof(float) * 4;
-        unsigned char nbi0[4];
-        unsigned char nbi1[4];
-        unsigned char nbi2[4];
-
-        // Make sure all bones are found and that there is room in the skinning matrices
-        if (!GetBones(target, batchIndex, bw0, bi0, nbi0) || !GetBones(target, batchIndex, bw1, bi1, nbi1) ||
-            !GetBones(target, batchIndex, bw2, bi2, nbi2))
-            return;
 
-        face.Reserve(3);
-        face.Push(DecalVertex(v0, n0, bw0, nbi0));
-        face.Push(DecalVertex(v1, n1, bw1, nbi1));
-        face.Push(DecalVertex(v2, n2, bw2, nbi2));
-    }
-}
+    if (projection.skinned_)
+    {
+        AnimatedModel* animatedModel = dynamic_cast<AnimatedModel*>(projection.target_.Get());
+        if (!animatedModel)
+        {
+            LOGWARNING("Can not add skinned decal, target drawable has been destroyed");
+            return false;
+        }
 
-bool DecalSet::GetBones(Drawable* target, unsigned batchIndex, const float* blendWeights, const unsigned char* blendIndices,
-    unsigned char* newBlendIndices)
-{
-    AnimatedModel* animatedModel = dynamic_cast<AnimatedModel*>(target);
-    if (!animatedModel)
-        return false;
+        // Copy the skeleton bones referenced by the decal and remap its blend indices to them
+        PODVector<unsigned char> newIndices(projection.bones_.Size());
+        bool success = true;
+        for (unsigned i = 0; i < projection.bones_.Size() && success; ++i)
+            success = GetBone(animatedModel, projection.bones_[i], newIndices[i]);
 
-    // Check whether target is using global or per-geometry skinning
-    const Vector<PODVector<Matrix3x4> >& geometrySkinMatrices = animatedModel->GetGeometrySkinMatrices();
-    const Vector<PODVector<unsigned> >& geometryBoneMappings = animatedModel->GetGeometryBoneMappings();
+        // Update amount of shader data in the decal batch
+        UpdateBatch();
+        if (!success)
+            return false;
 
-    for (unsigned i = 0; i < 4; ++i)
-    {
-        if (blendWeights[i] > 0.0f)
+        for (PODVector<DecalVertex>::Iterator i = newDecal.vertices_.Begin(); i != newDecal.vertices_.End(); ++i)
         {
-            Bone* bone = 0;
-            if (geometrySkinMatrices.Empty())
-                bone = animatedModel->GetSkeleton().GetBone(blendIndices[i]);
-            else if (blendIndices[i] < geometryBoneMappings[batchIndex].Size())
-                bone = animatedModel->GetSkeleton().GetBone(geometryBoneMappings[batchIndex][blendIndices[i]]);
-
-            if (!bone)
+            for (unsigned j = 0; j < 4; ++j)
             {
-                LOGWARNING("Out of range bone index for skinned decal");
-                return false;
+                if (i->blendWeights_[j] > 0.0f)
+                    i->blendIndices_[j] = newIndices[i->blendIndices_[j]];
             }
+        }
+    }
 
-            bool found = false;
-            unsigned index;
+    decals_.Push(newDecal);
+    numVertices_ += newDecal.vertices_.Size();
+    numIndices_ += newDecal.indices_.Size();
 
-            for (index = 0; index < bones_.Size(); ++index)
-            {
-                if (bones_[index].node_ == bone->node_)
-                {
-                    // Check also that the offset matrix matches, in case we for example have a separate attachment AnimatedModel
-                    // with a different bind pose
-                    if (bones_[index].offsetMatrix_.Equals(bone->offsetMatrix_))
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-            }
+    // Remove oldest decals if total vertices exceeded
+    while (decals_.Size() && (numVertices_ > maxVertices_ || numIndices_ > maxIndices_))
+        RemoveDecals(1);
 
-            if (!found)
-            {
-                if (bones_.Size() >= Graphics::GetMaxBones())
-                {
-                    LOGWARNING("Maximum skinned decal bone count reached");
-                    return false;
-                }
-                else
-                {
-                    // Copy the bone from the model to the decal
-                    index = bones_.Size();
-                    bones_.Resize(bones_.Size() + 1);
-                    bones_[index] = *bone;
-                    skinMatrices_.Resize(skinMatrices_.Size() + 1);
-                    skinningDirty_ = true;
-
-                    // Start listening to bone transform changes to update skinning
-                    bone->node_->AddListener(this);
-                }
-            }
+    LOGDEBUG("Added decal with " + String(newDecal.vertices_.Size()) + " vertices");
 
-            newBlendIndices[i] = index;
-        }
-        else
-            newBlendIndices[i] = 0;
-    }
+    // If new decal is time limited, subscribe to scene post-update
+    if (newDecal.timeToLive_ > 0.0f && !subscribed_)
+        UpdateEventSubscription(false);
 
-    // Update amount of shader data in the decal batch
-    UpdateBatch();
+    MarkDecalsDirty();
     return true;
 }
 
-void DecalSet::CalculateUVs(Decal& decal, const Matrix3x4& view, const Matrix4& projection, const Vector2& topLeftUV,
-    const Vector2& bottomRightUV)
+void DecalSet::FinishCompletedProjections()
 {
-    Matrix4 viewProj = projection * view;
+    // Add in request order, so that the oldest decals are also the first to be removed when the buffers fill up
+    while (projections_.Size() && projections_[0]->item_->completed_)
+    {
+        SharedPtr<DecalProjection> projection = projections_[0];
+        projections_.Erase(0);
+        FinishProjection(*projection);
+    }
+}
 
-    for (PODVector<DecalVertex>::Iterator i = decal.vertices_.Begin(); i != decal.vertices_.End(); ++i)
+void DecalSet::CancelProjections()
+{
+    if (projections_.Empty())
+        return;
+
+    // The worker threads may still refer to the requests, so wait for those that already started
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    for (unsigned i = 0; i < projections_.Size(); ++i)
     {
-        Vector3 projected = viewProj * i->position_;
-        i->texCoord_ = Vector2(
-            Lerp(topLeftUV.x_, bottomRightUV.x_, projected.x_ * 0.5f + 0.5f),
-            Lerp(bottomRightUV.y_, topLeftUV.y_, projected.y_ * 0.5f + 0.5f)
-        );
+        SharedPtr<WorkItem> item = projections_[i]->item_;
+        if (!queue || !queue->RemoveWorkItem(item))
+        {
+            while (!item->completed_)
+                Time::Sleep(1);
+        }
     }
+
+    projections_.Clear();
 }
 
-void DecalSet::TransformVertices(Decal& decal, const Matrix3x4& transform)
+bool DecalSet::GetBone(AnimatedModel* animatedModel, unsigned skeletonIndex, unsigned char& newIndex)
 {
-    for (PODVector<DecalVertex>::Iterator i = decal.vertices_.Begin(); i != decal.vertices_.End(); ++i)
+    Bone* bone = animatedModel->GetSkeleton().GetBone(skeletonIndex);
+    if (!bone)
     {
-        i->position_ = transform * i->position_;
-        i->normal_ = (transform * i->normal_).Normalized();
+        LOGWARNING("Out of range bone index for skinned decal");
+        return false;
+    }
+
+    unsigned index;
+    for (index = 0; index < bones_.Size(); ++index)
+    {
+        if (bones_[index].node_ == bone->node_)
+        {
+            // Check also that the offset matrix matches, in case we for example have a separate attachment AnimatedModel
+            // with a different bind pose
+            if (bones_[index].offsetMatrix_.Equals(bone->offsetMatrix_))
+                break;
+        }
+    }
+
+    if (index == bones_.Size())
+    {
+        if (bones_.Size() >= Graphics::GetMaxBones())
+        {
+            LOGWARNING("Maximum skinned decal bone count reached");
+            return false;
+        }
+
+        // Copy the bone from the model to the decal
+        bones_.Resize(bones_.Size() + 1);
+        bones_[index] = *bone;
+        skinMatrices_.Resize(skinMatrices_.Size() + 1);
+        skinningDirty_ = true;
+
+        // Start listening to bone transform changes to update skinning
+        bone->node_->AddListener(this);
     }
+
+    newIndex = index;
+    return true;
 }
 
 List<Decal>::Iterator DecalSet::RemoveDecal(List<Decal>::Iterator i)
@@ -1127,8 +1598,8 @@ void DecalSet::UpdateEventSubscription(bool checkAllDecals)
             }
         }
 
-        // If no time limited decals, no need to subscribe to scene update
-        enabled = hasTimeLimitedDecals;
+        // If no time limited or queued decals, no need to subscribe to scene update
+        enabled = hasTimeLimitedDecals || !projections_.Empty();
     }
 
     if (enabled && !subscribed_)
@@ -1149,6 +1620,13 @@ void DecalSet::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData
 
     float timeStep = eventData[P_TIMESTEP].GetFloat();
 
+    if (!projections_.Empty())
+    {
+        FinishCompletedProjections();
+        if (projections_.Empty())
+            UpdateEventSubscription(true);
+    }
+
     for (List<Decal>::Iterator i = decals_.Begin(); i != decals_.End();)
     {
         i->timer_ += timeStep;
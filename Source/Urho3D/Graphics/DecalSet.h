@@ -30,8 +30,11 @@
 namespace Urho3D
 {
 
+class AnimatedModel;
 class IndexBuffer;
 class VertexBuffer;
+struct DecalFaceCache;
+struct DecalProjection;
 
 /// %Decal vertex.
 struct DecalVertex
@@ -133,17 +136,25 @@ public:
     void SetMaxVertices(unsigned num);
     /// Set maximum number of decal vertex indices.
     void SetMaxIndices(unsigned num);
+    /// Set maximum number of cached target geometry regions used to speed up repeated decals on the same static geometry. 0 disables the cache. Default 16.
+    void SetFaceCacheSize(unsigned num);
     /// Add a decal at world coordinates, using a target drawable's geometry for reference. If the decal needs to move with the target, the decal component should be created to the target's node. Return true if successful.
     bool AddDecal(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size, float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive = 0.0f, float normalCutoff = 0.1f, unsigned subGeometry = M_MAX_UNSIGNED);
+    /// Add a decal like AddDecal(), but clip the target geometry in a worker thread. The decal is added on the first scene post-update after the clipping finishes. Return true if the decal was queued.
+    bool AddDecalAsync(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size, float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive = 0.0f, float normalCutoff = 0.1f, unsigned subGeometry = M_MAX_UNSIGNED);
     /// Remove n oldest decals.
     void RemoveDecals(unsigned num);
-    /// Remove all decals.
+    /// Remove all decals, including queued ones.
     void RemoveAllDecals();
+    /// Clear the target geometry face cache. Call after modifying the vertex data of a decal target in place.
+    void ClearFaceCache();
 
     /// Return material.
     Material* GetMaterial() const;
     /// Return number of decals.
     unsigned GetNumDecals() const { return decals_.Size(); }
+    /// Return number of queued decals still being clipped.
+    unsigned GetNumPendingDecals() const { return projections_.Size(); }
     /// Retur number of vertices in the decals.
     unsigned GetNumVertices() const { return numVertices_; }
     /// Retur number of vertex indices in the decals.
@@ -152,6 +163,8 @@ public:
     unsigned GetMaxVertices() const { return maxVertices_; }
     /// Return maximum number of decal vertex indices.
     unsigned GetMaxIndices() const { return maxIndices_; }
+    /// Return maximum number of cached target geometry regions.
+    unsigned GetFaceCacheSize() const { return faceCacheSize_; }
 
     /// Set material attribute.
     void SetMaterialAttr(const ResourceRef& value);
@@ -169,16 +182,16 @@ protected:
     virtual void OnMarkedDirty(Node* node);
 
 private:
-    /// Get triangle faces from the target geometry.
-    void GetFaces(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, const Frustum& frustum, const Vector3& decalNormal, float normalCutoff);
-    /// Get triangle face from the target geometry.
-    void GetFace(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, unsigned i0, unsigned i1, unsigned i2, const unsigned char* positionData, const unsigned char* normalData, const unsigned char* skinningData, unsigned positionStride, unsigned normalStride, unsigned skinningStride, const Frustum& frustum, const Vector3& decalNormal, float normalCutoff);
-    /// Get bones referenced by skinning data and remap the skinning indices. Return true if successful.
-    bool GetBones(Drawable* target, unsigned batchIndex, const float* blendWeights, const unsigned char* blendIndices, unsigned char* newBlendIndices);
-    /// Calculate UV coordinates for the decal.
-    void CalculateUVs(Decal& decal, const Matrix3x4& view, const Matrix4& projection, const Vector2& topLeftUV, const Vector2& bottomRightUV);
-    /// Transform decal's vertices from the target geometry to the decal set local space.
-    void TransformVertices(Decal& decal, const Matrix3x4& transform);
+    /// Set up clipping a decal from the target geometry. Return null if not possible.
+    SharedPtr<DecalProjection> BeginProjection(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size, float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive, float normalCutoff, unsigned subGeometry);
+    /// Add a clipped decal and store its new face cache regions. Return true if successful.
+    bool FinishProjection(DecalProjection& projection);
+    /// Add the queued decals whose clipping has finished.
+    void FinishCompletedProjections();
+    /// Cancel or wait for the queued decals.
+    void CancelProjections();
+    /// Find a bone in the decal's bones or copy it from the skeleton, and return its decal bone index. Return true if successful.
+    bool GetBone(AnimatedModel* animatedModel, unsigned skeletonIndex, unsigned char& newIndex);
     /// Remove a decal by iterator and return iterator to the next decal.
     List<Decal>::Iterator RemoveDecal(List<Decal>::Iterator i);
     /// Mark decals and the bounding box dirty.
@@ -212,6 +225,10 @@ private:
     Vector<Bone> bones_;
     /// Skinning matrices.
     PODVector<Matrix3x4> skinMatrices_;
+    /// Queued decals being clipped in worker threads.
+    Vector<SharedPtr<DecalProjection> > projections_;
+    /// Cached target geometry regions, least recently used first.
+    Vector<SharedPtr<DecalFaceCache> > faceCache_;
     /// Vertices in the current decals.
     unsigned numVertices_;
     /// Indices in the current decals.
@@ -220,6 +237,8 @@ private:
     unsigned maxVertices_;
     /// Maximum indices.
     unsigned maxIndices_;
+    /// Maximum cached target geometry regions.
+    unsigned faceCacheSize_;
     /// Skinned mode flag.
     bool skinned_;
     /// Vertex buffer needs resize flag.
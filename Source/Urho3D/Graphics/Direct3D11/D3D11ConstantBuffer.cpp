@@ -98,32 +98,45 @@ bool ConstantBuffer::SetSize(unsigned size)
     return true;
 }
 
-void ConstantBuffer::SetParameter(unsigned offset, unsigned size, const void* data)
+bool ConstantBuffer::SetParameter(unsigned offset, unsigned size, const void* data)
 {
     if (offset + size > size_)
-        return; // Would overflow the buffer
+        return false; // Would overflow the buffer
+
+    // Skip if the value is unchanged
+    if (!memcmp(&shadowData_[offset], data, size))
+        return false;
 
     memcpy(&shadowData_[offset], data, size);
     dirty_ = true;
+    return true;
 }
 
-void ConstantBuffer::SetVector3ArrayParameter(unsigned offset, unsigned rows, const void* data)
+bool ConstantBuffer::SetVector3ArrayParameter(unsigned offset, unsigned rows, const void* data)
 {
     if (offset + rows * 4 * sizeof(float) > size_)
-        return; // Would overflow the buffer
+        return false; // Would overflow the buffer
 
     float* dest = (float*)&shadowData_[offset];
     const float* src = (const float*)data;
+    bool changed = false;
 
     while (rows--)
     {
-        *dest++ = *src++;
-        *dest++ = *src++;
-        *dest++ = *src++;
-        ++dest; // Skip over the w coordinate
+        if (dest[0] != src[0] || dest[1] != src[1] || dest[2] != src[2])
+        {
+            dest[0] = src[0];
+            dest[1] = src[1];
+            dest[2] = src[2];
+            changed = true;
+        }
+        dest += 4; // Skip over the w coordinate
+        src += 3;
     }
 
-    dirty_ = true;
+    if (changed)
+        dirty_ = true;
+    return changed;
 }
 
 void ConstantBuffer::Apply()
@@ -21,9 +21,11 @@
 //
 
 #include "../../Graphics/AnimatedModel.h"
+#include "../../Graphics/AnimatedModelGroup.h"
 #include "../../Graphics/Animation.h"
 #include "../../Graphics/AnimationController.h"
 #include "../../Graphics/Camera.h"
+#include "../../Graphics/CDLODTerrain.h"
 #include "../../Graphics/ConstantBuffer.h"
 #include "../../Core/Context.h"
 #include "../../Graphics/CustomGeometry.h"
@@ -31,9 +33,11 @@
 #include "../../Graphics/DecalSet.h"
 #include "../../IO/File.h"
 #include "../../Graphics/Geometry.h"
+#include "../../Graphics/GPUParticleEmitter.h"
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsEvents.h"
 #include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/ImpostorSet.h"
 #include "../../Graphics/IndexBuffer.h"
 #include "../../IO/Log.h"
 #include "../../Graphics/Material.h"
@@ -54,6 +58,7 @@
 #include "../../Graphics/Terrain.h"
 #include "../../Graphics/TerrainPatch.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../Graphics/Texture2DArray.h"
 #include "../../Graphics/Texture3D.h"
 #include "../../Graphics/TextureCube.h"
 #include "../../Core/Timer.h"
@@ -237,14 +242,22 @@ Graphics::Graphics(Context* context) :
     vsync_(false),
     tripleBuffer_(false),
     flushGPU_(false),
+    renderThread_(false),
+    asyncShaders_(false),
     sRGB_(false),
     lightPrepassSupport_(false),
     deferredSupport_(false),
     instancingSupport_(false),
+    indirectDrawSupport_(false),
+    occlusionQuerySupport_(false),
+    timerQuerySupport_(false),
     sRGBSupport_(false),
     sRGBWriteSupport_(false),
     numPrimitives_(0),
     numBatches_(0),
+    numStateChanges_(0),
+    numAvoidedStateChanges_(0),
+    numParameterBytes_(0),
     maxScratchBufferRequest_(0),
     defaultTextureFilterMode_(FILTER_TRILINEAR),
     shaderProgram_(0),
@@ -256,6 +269,15 @@ Graphics::Graphics(Context* context) :
     SetTextureUnitMappings();
     ResetCachedState();
     
+    gpuProfileFrame_ = 0;
+    gpuProfiling_ = false;
+    gpuProfileFrameActive_ = false;
+    for (unsigned i = 0; i < NUM_GPU_PROFILE_FRAMES; ++i)
+    {
+        numGPUProfileBlocks_[i] = 0;
+        gpuDisjointQueries_[i] = 0;
+    }
+    
     // Initialize SDL now. Graphics should be the first SDL-using subsystem to be created
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER | SDL_INIT_NOPARACHUTE);
     
@@ -265,6 +287,8 @@ Graphics::Graphics(Context* context) :
 
 Graphics::~Graphics()
 {
+    StopRenderThread();
+    
     {
         MutexLock lock(gpuObjectMutex_);
 
@@ -277,6 +301,15 @@ Graphics::~Graphics()
     vertexDeclarations_.Clear();
     constantBuffers_.Clear();
     
+    for (PODVector<void*>::Iterator i = occlusionQueries_.Begin(); i != occlusionQueries_.End(); ++i)
+    {
+        if (*i)
+            ((ID3D11Query*)*i)->Release();
+    }
+    occlusionQueries_.Clear();
+    freeOcclusionQueries_.Clear();
+    ReleaseGPUProfileQueries();
+    
     for (HashMap<unsigned, ID3D11BlendState*>::Iterator i = impl_->blendStates_.Begin(); i != impl_->blendStates_.End(); ++i)
     {
         if (i->second_)
@@ -298,6 +331,12 @@ Graphics::~Graphics()
     }
     impl_->rasterizerStates_.Clear();
 
+    if (impl_->indirectBuffer_)
+    {
+        impl_->indirectBuffer_->Release();
+        impl_->indirectBuffer_ = 0;
+    }
+
     if (impl_->defaultRenderTargetView_)
     {
         impl_->defaultRenderTargetView_->Release();
@@ -318,11 +357,17 @@ Graphics::~Graphics()
         impl_->swapChain_->Release();
         impl_->swapChain_ = 0;
     }
-    if (impl_->deviceContext_)
+    if (impl_->deferredContext_)
     {
-        impl_->deviceContext_->Release();
-        impl_->deviceContext_ = 0;
+        impl_->deferredContext_->Release();
+        impl_->deferredContext_ = 0;
     }
+    if (impl_->immediateContext_)
+    {
+        impl_->immediateContext_->Release();
+        impl_->immediateContext_ = 0;
+    }
+    impl_->deviceContext_ = 0;
     if (impl_->device_)
     {
         impl_->device_->Release();
@@ -417,6 +462,9 @@ bool Graphics::SetMode(int width, int height, bool fullscreen, bool borderless,
         vsync == vsync_ && tripleBuffer == tripleBuffer_ && multiSample == multiSample_)
         return true;
     
+    // The swap chain can not be modified while the render thread may be presenting
+    StopRenderThread();
+    
     SDL_SetHint(SDL_HINT_ORIENTATIONS, orientations_.CString());
 
     if (!impl_->window_)
@@ -473,6 +521,8 @@ bool Graphics::SetMode(int width, int height, bool fullscreen, bool borderless,
     Clear(CLEAR_COLOR);
     impl_->swapChain_->Present(0, 0);
     
+    StartRenderThread();
+    
     #ifdef URHO3D_LOGGING
     String msg;
     msg.AppendWithFormat("Set screen mode %dx%d %s", width_, height_, (fullscreen_ ? "fullscreen" : "windowed"));
@@ -512,8 +562,10 @@ void Graphics::SetSRGB(bool enable)
         if (impl_->swapChain_)
         {
             // Recreate swap chain for the new backbuffer format
+            StopRenderThread();
             CreateDevice(width_, height_, multiSample_);
             UpdateSwapChain(width_, height_);
+            StartRenderThread();
         }
     }
 }
@@ -534,6 +586,30 @@ void Graphics::SetFlushGPU(bool enable)
     }
 }
 
+void Graphics::SetRenderThread(bool enable)
+{
+    renderThread_ = enable;
+    
+    if (enable)
+        StartRenderThread();
+    else
+        StopRenderThread();
+}
+
+void Graphics::SetAsyncShaders(bool enable)
+{
+    asyncShaders_ = enable;
+}
+
+void Graphics::SetShaderFallbackDefines(const String& defines)
+{
+    shaderFallbackDefines_ = defines.Trimmed();
+}
+
+void Graphics::SetShaderCacheDir(const String& path)
+{
+}
+
 void Graphics::SetOrientations(const String& orientations)
 {
     orientations_ = orientations.Trimmed();
@@ -561,6 +637,8 @@ bool Graphics::TakeScreenShot(Image& destImage)
 
     if (!impl_->device_)
         return false;
+    
+    MutexLock lock(impl_->immediateContextMutex_);
 
     D3D11_TEXTURE2D_DESC textureDesc;
     memset(&textureDesc, 0, sizeof textureDesc);
@@ -600,18 +678,18 @@ bool Graphics::TakeScreenShot(Image& destImage)
             return false;
         }
 
-        impl_->deviceContext_->ResolveSubresource(resolveTexture, 0, source, 0, DXGI_FORMAT_R8G8B8A8_UNORM);
-        impl_->deviceContext_->CopyResource(stagingTexture, resolveTexture);
+        impl_->immediateContext_->ResolveSubresource(resolveTexture, 0, source, 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+        impl_->immediateContext_->CopyResource(stagingTexture, resolveTexture);
         resolveTexture->Release();
     }
     else
-        impl_->deviceContext_->CopyResource(stagingTexture, source);
+        impl_->immediateContext_->CopyResource(stagingTexture, source);
 
     source->Release();
 
     D3D11_MAPPED_SUBRESOURCE mappedData;
     mappedData.pData = 0;
-    impl_->deviceContext_->Map(stagingTexture, 0, D3D11_MAP_READ, 0, &mappedData);
+    impl_->immediateContext_->Map(stagingTexture, 0, D3D11_MAP_READ, 0, &mappedData);
 
     destImage.SetSize(width_, height_, 3);
     unsigned char* destData = destImage.GetData();
@@ -628,7 +706,7 @@ bool Graphics::TakeScreenShot(Image& destImage)
                 ++src;
             }
         }
-        impl_->deviceContext_->Unmap(stagingTexture, 0);
+        impl_->immediateContext_->Unmap(stagingTexture, 0);
         stagingTexture->Release();
         return true;
     }
@@ -671,6 +749,11 @@ bool Graphics::BeginFrame()
     
     numPrimitives_ = 0;
     numBatches_ = 0;
+    numStateChanges_ = 0;
+    numAvoidedStateChanges_ = 0;
+    numParameterBytes_ = 0;
+    
+    BeginGPUProfileFrame();
     
     SendEvent(E_BEGINRENDERING);
     
@@ -687,7 +770,16 @@ void Graphics::EndFrame()
         
         SendEvent(E_ENDRENDERING);
         
-        impl_->swapChain_->Present(vsync_ ? 1 : 0, 0);
+        EndGPUProfileFrame();
+        
+        if (impl_->renderThread_)
+        {
+            // Hand the frame to the render thread, and keep recording the next frame's resource updates and draws
+            impl_->renderThread_->Submit((ID3D11CommandList*)EndCommandList(), vsync_);
+            BeginCommandList();
+        }
+        else
+            impl_->swapChain_->Present(vsync_ ? 1 : 0, 0);
     }
     
     // Clean up too large scratch buffers
@@ -802,6 +894,20 @@ bool Graphics::ResolveToTexture(Texture2D* destination, const IntRect& viewport)
     return true;
 }
 
+bool Graphics::CopyDepthTexture(Texture2D* destination, Texture2D* source)
+{
+    if (!destination || !source || !destination->GetGPUObject() || !source->GetGPUObject())
+        return false;
+    if (destination->GetWidth() != source->GetWidth() || destination->GetHeight() != source->GetHeight() ||
+        destination->GetFormat() != source->GetFormat())
+        return false;
+    
+    PROFILE(CopyDepthTexture);
+    
+    impl_->deviceContext_->CopyResource((ID3D11Resource*)destination->GetGPUObject(), (ID3D11Resource*)source->GetGPUObject());
+    return true;
+}
+
 void Graphics::Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount)
 {
     if (!vertexCount || !shaderProgram_)
@@ -869,6 +975,401 @@ void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned i
     ++numBatches_;
 }
 
+void Graphics::DrawIndirect(PrimitiveType type, const IndirectDrawCommand* commands, unsigned count)
+{
+    if (!count || !commands || !shaderProgram_ || !indirectDrawSupport_)
+        return;
+    
+    unsigned dataSize = count * sizeof(IndirectDrawCommand);
+    if (dataSize > impl_->indirectBufferSize_)
+    {
+        if (impl_->indirectBuffer_)
+        {
+            impl_->indirectBuffer_->Release();
+            impl_->indirectBuffer_ = 0;
+            impl_->indirectBufferSize_ = 0;
+        }
+        
+        D3D11_BUFFER_DESC bufferDesc;
+        memset(&bufferDesc, 0, sizeof bufferDesc);
+        
+        bufferDesc.ByteWidth = NextPowerOfTwo(dataSize);
+        bufferDesc.BindFlags = 0;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+        
+        impl_->device_->CreateBuffer(&bufferDesc, 0, &impl_->indirectBuffer_);
+        if (!impl_->indirectBuffer_)
+        {
+            LOGERROR("Failed to create indirect draw buffer");
+            return;
+        }
+        
+        impl_->indirectBufferSize_ = bufferDesc.ByteWidth;
+    }
+    
+    PrepareDraw();
+    
+    D3D11_BOX destBox;
+    destBox.left = 0;
+    destBox.right = dataSize;
+    destBox.top = 0;
+    destBox.bottom = 1;
+    destBox.front = 0;
+    destBox.back = 1;
+    impl_->deviceContext_->UpdateSubresource(impl_->indirectBuffer_, 0, &destBox, commands, 0, 0);
+    
+    unsigned primitiveCount;
+    D3D_PRIMITIVE_TOPOLOGY d3dPrimitiveType;
+    
+    GetD3DPrimitiveType(commands[0].indexCount_, type, primitiveCount, d3dPrimitiveType);
+    if (d3dPrimitiveType != primitiveType_)
+    {
+        impl_->deviceContext_->IASetPrimitiveTopology(d3dPrimitiveType);
+        primitiveType_ = d3dPrimitiveType;
+    }
+    
+    // Direct3D11 has no multi-draw, but the arguments of all draws are uploaded at once
+    for (unsigned i = 0; i < count; ++i)
+    {
+        impl_->deviceContext_->DrawIndexedInstancedIndirect(impl_->indirectBuffer_, i * sizeof(IndirectDrawCommand));
+        GetD3DPrimitiveType(commands[i].indexCount_, type, primitiveCount, d3dPrimitiveType);
+        numPrimitives_ += commands[i].instanceCount_ * primitiveCount;
+    }
+    
+    ++numBatches_;
+}
+
+unsigned Graphics::CreateOcclusionQuery()
+{
+    if (!occlusionQuerySupport_)
+        return 0;
+    
+    // The query object itself is created on first use
+    unsigned index;
+    if (freeOcclusionQueries_.Size())
+    {
+        index = freeOcclusionQueries_.Back();
+        freeOcclusionQueries_.Pop();
+    }
+    else
+    {
+        index = occlusionQueries_.Size();
+        occlusionQueries_.Push(0);
+    }
+    
+    return index + 1;
+}
+
+void Graphics::DestroyOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size())
+        return;
+    
+    void*& object = occlusionQueries_[query - 1];
+    if (object)
+    {
+        ((ID3D11Query*)object)->Release();
+        object = 0;
+    }
+    
+    freeOcclusionQueries_.Push(query - 1);
+}
+
+void Graphics::BeginOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size())
+        return;
+    
+    void*& object = occlusionQueries_[query - 1];
+    if (!object)
+    {
+        D3D11_QUERY_DESC queryDesc;
+        memset(&queryDesc, 0, sizeof queryDesc);
+        queryDesc.Query = D3D11_QUERY_OCCLUSION_PREDICATE;
+        
+        if (FAILED(impl_->device_->CreateQuery(&queryDesc, (ID3D11Query**)&object)))
+        {
+            object = 0;
+            return;
+        }
+    }
+    
+    impl_->deviceContext_->Begin((ID3D11Query*)object);
+}
+
+void Graphics::EndOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size() || !occlusionQueries_[query - 1])
+        return;
+    
+    impl_->deviceContext_->End((ID3D11Query*)occlusionQueries_[query - 1]);
+}
+
+bool Graphics::GetOcclusionQueryResult(unsigned query, bool& visible)
+{
+    visible = true;
+    if (!query || query > occlusionQueries_.Size() || !occlusionQueries_[query - 1])
+        return true;
+    
+    BOOL anySamples = TRUE;
+    // Query results can only be read from the immediate context
+    MutexLock lock(impl_->immediateContextMutex_);
+    HRESULT hr = impl_->immediateContext_->GetData((ID3D11Query*)occlusionQueries_[query - 1], &anySamples, sizeof anySamples,
+        D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    if (hr == S_FALSE)
+        return false;
+    
+    if (hr == S_OK)
+        visible = anySamples != FALSE;
+    return true;
+}
+
+void Graphics::SetGPUProfiling(bool enable)
+{
+    if (enable && !timerQuerySupport_)
+    {
+        LOGERROR("Timer queries not supported, can not enable GPU profiling");
+        return;
+    }
+    
+    if (enable == gpuProfiling_)
+        return;
+    
+    gpuProfiling_ = enable;
+    if (!enable)
+    {
+        ReleaseGPUProfileQueries();
+        gpuProfileResults_.Clear();
+    }
+}
+
+void Graphics::BeginGPUProfileBlock(const char* name)
+{
+    if (!gpuProfileFrameActive_)
+        return;
+    
+    unsigned frame = gpuProfileFrame_;
+    unsigned index = numGPUProfileBlocks_[frame];
+    PODVector<void*>& queries = gpuTimestampQueries_[frame];
+    
+    if (index < MAX_GPU_PROFILE_BLOCKS && queries.Size() <= index * 2)
+    {
+        D3D11_QUERY_DESC queryDesc;
+        memset(&queryDesc, 0, sizeof queryDesc);
+        queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+        
+        ID3D11Query* beginQuery = 0;
+        ID3D11Query* endQuery = 0;
+        impl_->device_->CreateQuery(&queryDesc, &beginQuery);
+        impl_->device_->CreateQuery(&queryDesc, &endQuery);
+        if (beginQuery && endQuery)
+        {
+            queries.Push(beginQuery);
+            queries.Push(endQuery);
+        }
+        else
+        {
+            if (beginQuery)
+                beginQuery->Release();
+            if (endQuery)
+                endQuery->Release();
+        }
+    }
+    
+    // If out of blocks, push an invalid index so that the matching end is ignored
+    if (index >= MAX_GPU_PROFILE_BLOCKS || queries.Size() <= index * 2)
+    {
+        gpuProfileStack_.Push(M_MAX_UNSIGNED);
+        return;
+    }
+    
+    Vector<GPUProfileBlock>& blocks = gpuProfileBlocks_[frame];
+    if (blocks.Size() <= index)
+        blocks.Resize(index + 1);
+    blocks[index].name_ = name;
+    blocks[index].depth_ = gpuProfileStack_.Size();
+    
+    impl_->deviceContext_->End((ID3D11Query*)queries[index * 2]);
+    ++numGPUProfileBlocks_[frame];
+    gpuProfileStack_.Push(index);
+}
+
+void Graphics::EndGPUProfileBlock()
+{
+    if (!gpuProfileFrameActive_ || gpuProfileStack_.Empty())
+        return;
+    
+    unsigned index = gpuProfileStack_.Back();
+    gpuProfileStack_.Pop();
+    if (index != M_MAX_UNSIGNED)
+        impl_->deviceContext_->End((ID3D11Query*)gpuTimestampQueries_[gpuProfileFrame_][index * 2 + 1]);
+}
+
+void Graphics::BeginGPUProfileFrame()
+{
+    if (!gpuProfiling_)
+        return;
+    
+    gpuProfileFrame_ = (gpuProfileFrame_ + 1) % NUM_GPU_PROFILE_FRAMES;
+    unsigned frame = gpuProfileFrame_;
+    ID3D11Query*& disjointQuery = (ID3D11Query*&)gpuDisjointQueries_[frame];
+    
+    // Read back the frame issued NUM_GPU_PROFILE_FRAMES ago. If its queries are still pending, its results are dropped
+    unsigned numBlocks = numGPUProfileBlocks_[frame];
+    if (numBlocks && disjointQuery)
+    {
+        // Query results can only be read from the immediate context
+        MutexLock lock(impl_->immediateContextMutex_);
+        
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+        if (impl_->immediateContext_->GetData(disjointQuery, &disjointData, sizeof disjointData, D3D11_ASYNC_GETDATA_DONOTFLUSH) ==
+            S_OK && !disjointData.Disjoint && disjointData.Frequency)
+        {
+            const Vector<GPUProfileBlock>& blocks = gpuProfileBlocks_[frame];
+            const PODVector<void*>& queries = gpuTimestampQueries_[frame];
+            
+            gpuProfileResults_.Resize(numBlocks);
+            for (unsigned i = 0; i < numBlocks; ++i)
+            {
+                UINT64 beginTime = 0;
+                UINT64 endTime = 0;
+                GPUProfileBlock& result = gpuProfileResults_[i];
+                result = blocks[i];
+                if (impl_->immediateContext_->GetData((ID3D11Query*)queries[i * 2], &beginTime, sizeof beginTime,
+                    D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK && impl_->immediateContext_->GetData((ID3D11Query*)queries[i * 2 + 1],
+                    &endTime, sizeof endTime, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK && endTime > beginTime)
+                    result.time_ = (float)((double)(endTime - beginTime) * 1000.0 / (double)disjointData.Frequency);
+            }
+        }
+    }
+    
+    numGPUProfileBlocks_[frame] = 0;
+    gpuProfileStack_.Clear();
+    
+    if (!disjointQuery)
+    {
+        D3D11_QUERY_DESC queryDesc;
+        memset(&queryDesc, 0, sizeof queryDesc);
+        queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+        
+        if (FAILED(impl_->device_->CreateQuery(&queryDesc, &disjointQuery)))
+        {
+            disjointQuery = 0;
+            return;
+        }
+    }
+    
+    impl_->deviceContext_->Begin(disjointQuery);
+    gpuProfileFrameActive_ = true;
+}
+
+void Graphics::EndGPUProfileFrame()
+{
+    if (!gpuProfileFrameActive_)
+        return;
+    
+    // Close the blocks left open
+    while (!gpuProfileStack_.Empty())
+        EndGPUProfileBlock();
+    
+    impl_->deviceContext_->End((ID3D11Query*)gpuDisjointQueries_[gpuProfileFrame_]);
+    gpuProfileFrameActive_ = false;
+}
+
+void Graphics::ReleaseGPUProfileQueries()
+{
+    for (unsigned i = 0; i < NUM_GPU_PROFILE_FRAMES; ++i)
+    {
+        for (PODVector<void*>::Iterator j = gpuTimestampQueries_[i].Begin(); j != gpuTimestampQueries_[i].End(); ++j)
+            ((ID3D11Query*)*j)->Release();
+        gpuTimestampQueries_[i].Clear();
+        
+        if (gpuDisjointQueries_[i])
+        {
+            ((ID3D11Query*)gpuDisjointQueries_[i])->Release();
+            gpuDisjointQueries_[i] = 0;
+        }
+        
+        numGPUProfileBlocks_[i] = 0;
+    }
+    
+    gpuProfileStack_.Clear();
+    gpuProfileFrameActive_ = false;
+}
+
+bool Graphics::BeginCommandList()
+{
+    if (!impl_->device_)
+        return false;
+    
+    if (IsRecordingCommandList())
+    {
+        LOGERROR("Already recording a command list");
+        return false;
+    }
+    
+    if (!impl_->deferredContext_)
+    {
+        if (FAILED(impl_->device_->CreateDeferredContext(0, &impl_->deferredContext_)))
+        {
+            impl_->deferredContext_ = 0;
+            LOGERROR("Failed to create deferred device context");
+            return false;
+        }
+    }
+    
+    // A deferred context starts from the default state, and the constant buffers may change before the list is executed
+    impl_->deviceContext_ = impl_->deferredContext_;
+    ResetCachedState();
+    ClearParameterSources();
+    return true;
+}
+
+void* Graphics::EndCommandList()
+{
+    if (!IsRecordingCommandList())
+    {
+        LOGERROR("Not recording a command list");
+        return 0;
+    }
+    
+    ID3D11CommandList* commandList = 0;
+    HRESULT hr = impl_->deferredContext_->FinishCommandList(FALSE, &commandList);
+    
+    // Recording was done against a separate state, so the immediate context state needs to be reapplied
+    impl_->deviceContext_ = impl_->immediateContext_;
+    ResetCachedState();
+    ClearParameterSources();
+    
+    if (FAILED(hr))
+    {
+        LOGERROR("Failed to finish command list");
+        return 0;
+    }
+    
+    return commandList;
+}
+
+void Graphics::ExecuteCommandList(void* commandList)
+{
+    if (!commandList)
+        return;
+    
+    if (IsRecordingCommandList())
+    {
+        LOGERROR("Can not execute a command list while recording");
+        return;
+    }
+    
+    // Executing without restoring the state leaves the immediate context in the default state
+    impl_->immediateContext_->ExecuteCommandList((ID3D11CommandList*)commandList, FALSE);
+    ((ID3D11CommandList*)commandList)->Release();
+    ResetCachedState();
+    ClearParameterSources();
+}
+
 void Graphics::SetVertexBuffer(VertexBuffer* buffer)
 {
     // Note: this is not multi-instance safe
@@ -901,7 +1402,8 @@ bool Graphics::SetVertexBuffers(const PODVector<VertexBuffer*>& buffers, const P
         buffer = i < buffers.Size() ? buffers[i] : 0;
         if (buffer)
         {
-            unsigned elementMask = buffer->GetElementMask() & elementMasks[i];
+            // Keep the packed format bits, as they affect the input layout
+            unsigned elementMask = buffer->GetElementMask() & (elementMasks[i] | MASK_PACKEDFORMATS);
             unsigned offset = (elementMask & MASK_INSTANCEMATRIX1) ? instanceOffset * buffer->GetVertexSize() : 0;
 
             if (buffer != vertexBuffers_[i] || elementMask != elementMasks_[i] || offset != impl_->vertexOffsets_[i])
@@ -962,7 +1464,10 @@ void Graphics::SetIndexBuffer(IndexBuffer* buffer)
             impl_->deviceContext_->IASetIndexBuffer(0, DXGI_FORMAT_UNKNOWN, 0);
 
         indexBuffer_ = buffer;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
@@ -977,8 +1482,35 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
             ps = ps->GetOwner()->GetVariation(PS, ps->GetDefines() + " CLIPPLANE");
     }
 
+    // With asynchronous compiling, draw with the fallback permutations until both shaders are ready, or skip drawing
+    if (asyncShaders_ && vs && ps)
+    {
+        bool vsReady = IsShaderReady(vs);
+        bool psReady = IsShaderReady(ps);
+        if (!vsReady || !psReady)
+        {
+            ShaderVariation* fallbackVS = GetFallbackShader(vs);
+            ShaderVariation* fallbackPS = GetFallbackShader(ps);
+            if (fallbackVS && fallbackPS && IsShaderReady(fallbackVS) && IsShaderReady(fallbackPS))
+            {
+                vs = fallbackVS;
+                ps = fallbackPS;
+            }
+            else
+            {
+                vs = 0;
+                ps = 0;
+            }
+        }
+    }
+
     if (vs == vertexShader_ && ps == pixelShader_)
+    {
+        ++numAvoidedStateChanges_;
         return;
+    }
+    
+    ++numStateChanges_;
     
     if (vs != vertexShader_)
     {
@@ -1088,10 +1620,7 @@ void Graphics::SetShaderParameter(StringHash param, const float* data, unsigned
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, count * sizeof(float), data);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, count * sizeof(float), data);
 }
 
 void Graphics::SetShaderParameter(StringHash param, float value)
@@ -1100,10 +1629,7 @@ void Graphics::SetShaderParameter(StringHash param, float value)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(float), &value);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(float), &value);
 }
 
 void Graphics::SetShaderParameter(StringHash param, bool value)
@@ -1112,10 +1638,7 @@ void Graphics::SetShaderParameter(StringHash param, bool value)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(bool), &value);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(bool), &value);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Color& color)
@@ -1124,10 +1647,7 @@ void Graphics::SetShaderParameter(StringHash param, const Color& color)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(Color), &color);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(Color), &color);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
@@ -1136,10 +1656,7 @@ void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(Vector2), &vector);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(Vector2), &vector);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
@@ -1149,9 +1666,14 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
         return;
 
     ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetVector3ArrayParameter(i->second_.offset_, 3, &matrix);
+    bool wasDirty = buffer->IsDirty();
+    if (buffer->SetVector3ArrayParameter(i->second_.offset_, 3, &matrix))
+    {
+        if (!wasDirty)
+            dirtyConstantBuffers_.Push(buffer);
+    }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
@@ -1160,10 +1682,7 @@ void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(Vector3), &vector);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(Vector3), &vector);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
@@ -1172,10 +1691,7 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(Matrix4), &matrix);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(Matrix4), &matrix);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
@@ -1184,10 +1700,7 @@ void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(Vector4), &vector);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(Vector4), &vector);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
@@ -1196,10 +1709,7 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
 
-    ConstantBuffer* buffer = i->second_.bufferPtr_;
-    if (!buffer->IsDirty())
-        dirtyConstantBuffers_.Push(buffer);
-    buffer->SetParameter(i->second_.offset_, sizeof(Matrix3x4), &matrix);
+    SetBufferParameter(i->second_.bufferPtr_, i->second_.offset_, sizeof(Matrix3x4), &matrix);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Variant& value)
@@ -1320,7 +1830,10 @@ void Graphics::SetTexture(unsigned index, Texture* texture)
         impl_->shaderResourceViews_[index] = texture ? (ID3D11ShaderResourceView*)texture->GetShaderResourceView() : 0;
         impl_->samplers_[index] = texture ? (ID3D11SamplerState*)texture->GetSampler() : 0;
         texturesDirty_ = true;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetDefaultTextureFilterMode(TextureFilterMode mode)
@@ -1675,6 +2188,41 @@ void Graphics::PrecacheShaders(Deserializer& source)
     ShaderPrecache::LoadShaders(this, source);
 }
 
+void Graphics::StartRenderThread()
+{
+    if (!renderThread_ || impl_->renderThread_ || !impl_->swapChain_)
+        return;
+    
+    if (!BeginCommandList())
+        return;
+    
+    impl_->renderThread_ = new RenderThread(impl_);
+    if (!impl_->renderThread_->Run())
+    {
+        LOGERROR("Failed to start render thread");
+        delete impl_->renderThread_;
+        impl_->renderThread_ = 0;
+        ExecuteCommandList(EndCommandList());
+    }
+}
+
+void Graphics::StopRenderThread()
+{
+    if (!impl_->renderThread_)
+        return;
+    
+    impl_->renderThread_->Quit();
+    delete impl_->renderThread_;
+    impl_->renderThread_ = 0;
+    
+    ExecuteCommandList(EndCommandList());
+}
+
+bool Graphics::IsRecordingCommandList() const
+{
+    return impl_->deviceContext_ && impl_->deviceContext_ != impl_->immediateContext_;
+}
+
 bool Graphics::IsInitialized() const
 {
     return impl_->window_ != 0 && impl_->GetDevice() != 0;
@@ -2243,6 +2791,8 @@ bool Graphics::CreateDevice(int width, int height, int multiSample)
             LOGERROR("Failed to create D3D11 device");
             return false;
         }
+        
+        impl_->immediateContext_ = impl_->deviceContext_;
 
         CheckFeatureSupport();
         // Set the flush mode now as the device has been created
@@ -2381,6 +2931,10 @@ void Graphics::CheckFeatureSupport()
     deferredSupport_ = true;
     hardwareShadowSupport_ = true;
     instancingSupport_ = true;
+    // Indirect draw arguments require feature level 11 hardware
+    indirectDrawSupport_ = impl_->device_->GetFeatureLevel() >= D3D_FEATURE_LEVEL_11_0;
+    occlusionQuerySupport_ = true;
+    timerQuerySupport_ = true;
     shadowMapFormat_ = DXGI_FORMAT_R16_TYPELESS;
     hiresShadowMapFormat_ = DXGI_FORMAT_R32_TYPELESS;
     dummyColorFormat_ = DXGI_FORMAT_UNKNOWN;
@@ -2506,11 +3060,12 @@ void Graphics::PrepareDraw()
                 [firstDirtyVB_], &impl_->vertexSizes_[firstDirtyVB_], &impl_->vertexOffsets_[firstDirtyVB_]);
 
             firstDirtyVB_ = lastDirtyVB_ = M_MAX_UNSIGNED;
+            ++numStateChanges_;
         }
 
         unsigned long long newVertexDeclarationHash = 0;
         for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
-            newVertexDeclarationHash |= (unsigned long long)elementMasks_[i] << (i * 13);
+            newVertexDeclarationHash |= (unsigned long long)elementMasks_[i] << (i * 16);
 
         // Do not create input layout if no vertex buffers / elements
         if (newVertexDeclarationHash)
@@ -2528,7 +3083,10 @@ void Graphics::PrepareDraw()
     
                 impl_->deviceContext_->IASetInputLayout((ID3D11InputLayout*)i->second_->GetInputLayout());
                 vertexDeclarationHash_ = newVertexDeclarationHash;
+                ++numStateChanges_;
             }
+            else
+                ++numAvoidedStateChanges_;
         }
 
         vertexDeclarationDirty_ = false;
@@ -2567,7 +3125,10 @@ void Graphics::PrepareDraw()
 
             impl_->deviceContext_->OMSetBlendState(i->second_, 0, M_MAX_UNSIGNED);
             blendStateHash_ = newBlendStateHash;
+            ++numStateChanges_;
         }
+        else
+            ++numAvoidedStateChanges_;
 
         blendStateDirty_ = false;
     }
@@ -2611,7 +3172,10 @@ void Graphics::PrepareDraw()
 
             impl_->deviceContext_->OMSetDepthStencilState(i->second_, stencilRef_);
             depthStateHash_ = newDepthStateHash;
+            ++numStateChanges_;
         }
+        else
+            ++numAvoidedStateChanges_;
         
         depthStateDirty_ = false;
         stencilRefDirty_ = false;
@@ -2656,7 +3220,10 @@ void Graphics::PrepareDraw()
 
             impl_->deviceContext_->RSSetState(i->second_);
             rasterizerStateHash_ = newRasterizerStateHash;
+            ++numStateChanges_;
         }
+        else
+            ++numAvoidedStateChanges_;
 
         rasterizerStateDirty_ = false;
     }
@@ -2673,10 +3240,74 @@ void Graphics::PrepareDraw()
     }
 
     for (unsigned i = 0; i < dirtyConstantBuffers_.Size(); ++i)
+    {
+        if (dirtyConstantBuffers_[i]->IsDirty())
+        {
+            numParameterBytes_ += dirtyConstantBuffers_[i]->GetSize();
+            ++numStateChanges_;
+        }
         dirtyConstantBuffers_[i]->Apply();
+    }
     dirtyConstantBuffers_.Clear();
 }
 
+void Graphics::SetBufferParameter(ConstantBuffer* buffer, unsigned offset, unsigned size, const void* data)
+{
+    bool wasDirty = buffer->IsDirty();
+    if (buffer->SetParameter(offset, size, data))
+    {
+        if (!wasDirty)
+            dirtyConstantBuffers_.Push(buffer);
+    }
+    else
+        ++numAvoidedStateChanges_;
+}
+
+bool Graphics::IsShaderReady(ShaderVariation* shader)
+{
+    if (shader->GetGPUObject())
+        return true;
+    // If already attempted and failed, do not retry
+    if (!shader->GetCompilerOutput().Empty())
+        return false;
+    
+    if (shader->CreateAsync())
+        return true;
+    
+    if (!shader->IsCompiling())
+    {
+        LOGERROR("Failed to compile " + String(shader->GetShaderType() == VS ? "vertex" : "pixel") + " shader " +
+            shader->GetFullName() + ":\n" + shader->GetCompilerOutput());
+    }
+    return false;
+}
+
+ShaderVariation* Graphics::GetFallbackShader(ShaderVariation* shader) const
+{
+    if (shaderFallbackDefines_.Empty() || !shader->GetOwner())
+        return 0;
+    
+    // Keep only the defines that are listed for the fallback, comparing without a possible value
+    Vector<String> keepDefines = shaderFallbackDefines_.Split(' ');
+    Vector<String> defines = shader->GetDefines().Split(' ');
+    String fallbackDefines;
+    bool removed = false;
+    for (unsigned i = 0; i < defines.Size(); ++i)
+    {
+        String name = defines[i].Substring(0, defines[i].Find('='));
+        if (keepDefines.Contains(name))
+        {
+            if (!fallbackDefines.Empty())
+                fallbackDefines += ' ';
+            fallbackDefines += defines[i];
+        }
+        else
+            removed = true;
+    }
+    
+    return removed ? shader->GetOwner()->GetVariation(shader->GetShaderType(), fallbackDefines) : 0;
+}
+
 void Graphics::SetTextureUnitMappings()
 {
     textureUnits_["DiffMap"] = TU_DIFFUSE;
@@ -2693,6 +3324,8 @@ void Graphics::SetTextureUnitMappings()
     textureUnits_["FaceSelectCubeMap"] = TU_FACESELECT;
     textureUnits_["IndirectionCubeMap"] = TU_INDIRECTION;
     textureUnits_["VolumeMap"] = TU_VOLUMEMAP;
+    textureUnits_["SkinMatrixMap"] = TU_SKINMATRICES;
+    textureUnits_["HeightMap"] = TU_HEIGHTMAP;
     textureUnits_["ZoneCubeMap"] = TU_ZONE;
     textureUnits_["ZoneVolumeMap"] = TU_ZONE;
 }
@@ -2706,6 +3339,7 @@ void RegisterGraphicsLibrary(Context* context)
     Technique::RegisterObject(context);
     Texture2D::RegisterObject(context);
     Texture3D::RegisterObject(context);
+    Texture2DArray::RegisterObject(context);
     TextureCube::RegisterObject(context);
     Camera::RegisterObject(context);
     Drawable::RegisterObject(context);
@@ -2714,14 +3348,18 @@ void RegisterGraphicsLibrary(Context* context)
     StaticModelGroup::RegisterObject(context);
     Skybox::RegisterObject(context);
     AnimatedModel::RegisterObject(context);
+    AnimatedModelGroup::RegisterObject(context);
     AnimationController::RegisterObject(context);
     BillboardSet::RegisterObject(context);
+    ImpostorSet::RegisterObject(context);
     ParticleEffect::RegisterObject(context);
     ParticleEmitter::RegisterObject(context);
+    GPUParticleEmitter::RegisterObject(context);
     CustomGeometry::RegisterObject(context);
     DecalSet::RegisterObject(context);
     Terrain::RegisterObject(context);
     TerrainPatch::RegisterObject(context);
+    CDLODTerrain::RegisterObject(context);
     DebugRenderer::RegisterObject(context);
     Octree::RegisterObject(context);
     Zone::RegisterObject(context);
@@ -55,6 +55,7 @@ class Vector4;
 class VertexBuffer;
 class VertexDeclaration;
 
+struct MaterialShaderParameter;
 struct ShaderParameter;
 
 /// CPU-side scratch buffer for vertex data updates.
@@ -105,6 +106,14 @@ public:
     void SetSRGB(bool enable);
     /// Set whether to flush the GPU command buffer to prevent multiple frames being queued and uneven frame timesteps. Default off, may decrease performance if enabled.
     void SetFlushGPU(bool enable);
+    /// Set whether to record each frame to a command list and execute and present it in a render thread, so that the next frame can be updated and recorded meanwhile. Default off.
+    void SetRenderThread(bool enable);
+    /// Set whether to compile shaders without up-to-date bytecode in worker threads. Until ready, draws use the fallback shader permutation or are skipped. Default off.
+    void SetAsyncShaders(bool enable);
+    /// Set the space-separated shader defines to keep in the fallback permutation used while an asynchronously compiled shader is not ready. Empty (default) skips drawing instead.
+    void SetShaderFallbackDefines(const String& defines);
+    /// Set the directory to store linked shader program binaries in. Used only on OpenGL, as Direct3D stores compiled shader bytecode next to the shader sources.
+    void SetShaderCacheDir(const String& path);
     /// Set allowed screen orientations as a space-separated list of "LandscapeLeft", "LandscapeRight", "Portrait" and "PortraitUpsideDown". Affects currently only iOS platform.
     void SetOrientations(const String& orientations);
     /// Toggle between full screen and windowed mode. Return true if successful.
@@ -119,14 +128,42 @@ public:
     void EndFrame();
     /// Clear any or all of rendertarget, depth buffer and stencil buffer.
     void Clear(unsigned flags, const Color& color = Color(0.0f, 0.0f, 0.0f, 0.0f), float depth = 1.0f, unsigned stencil = 0);
+    /// Discard rendertarget, depth buffer and stencil buffer contents. Not supported, exists for API compatibility.
+    void DiscardFramebuffer(unsigned flags) {}
     /// Resolve multisampled backbuffer to a texture rendertarget. The texture's size should match the viewport size.
     bool ResolveToTexture(Texture2D* destination, const IntRect& viewport);
+    /// Copy the contents of a depth-stencil texture to another of the same size and format. Return true on success.
+    bool CopyDepthTexture(Texture2D* destination, Texture2D* source);
     /// Draw non-indexed geometry.
     void Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount);
     /// Draw indexed geometry.
     void Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount);
     /// Draw indexed, instanced geometry. An instancing vertex buffer must be set.
     void DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount, unsigned instanceCount);
+    /// Draw several indexed, instanced geometries from the current index buffer and vertex buffers in one call, using the instance start of each command to offset the instanced vertex streams. Requires indirect draw support.
+    void DrawIndirect(PrimitiveType type, const IndirectDrawCommand* commands, unsigned count);
+    /// Create an occlusion query and return its handle, or 0 if not supported.
+    unsigned CreateOcclusionQuery();
+    /// Destroy an occlusion query.
+    void DestroyOcclusionQuery(unsigned query);
+    /// Begin an occlusion query. Draw calls until EndOcclusionQuery() are tested against the depth buffer.
+    void BeginOcclusionQuery(unsigned query);
+    /// End an occlusion query.
+    void EndOcclusionQuery(unsigned query);
+    /// Return the result of an occlusion query without waiting for the GPU. Return false if not available yet.
+    bool GetOcclusionQueryResult(unsigned query, bool& visible);
+    /// Set GPU profiling enabled. Measures the GPU time of the blocks between BeginGPUProfileBlock() and EndGPUProfileBlock() with timer queries, which are read back a few frames later.
+    void SetGPUProfiling(bool enable);
+    /// Begin a GPU profiling block. Blocks can be nested. No-op if GPU profiling is disabled or outside BeginFrame() and EndFrame().
+    void BeginGPUProfileBlock(const char* name);
+    /// End the current GPU profiling block.
+    void EndGPUProfileBlock();
+    /// Begin recording rendering commands to a command list on a deferred context instead of executing them. Resets the cached rendering state. Return true if successful.
+    bool BeginCommandList();
+    /// End recording rendering commands and return the command list, or null if failed. Resets the cached rendering state.
+    void* EndCommandList();
+    /// Execute and release a recorded command list. Resets the cached rendering state.
+    void ExecuteCommandList(void* commandList);
     /// Set vertex buffer.
     void SetVertexBuffer(VertexBuffer* buffer);
     /// Set multiple vertex buffers.
@@ -161,6 +198,8 @@ public:
     void SetShaderParameter(StringHash param, const Variant& value);
     /// Check whether a shader parameter group needs update. Does not actually check whether parameters exist in the shaders.
     bool NeedParameterUpdate(ShaderParameterGroup group, const void* source);
+    /// Bind persistent constant buffers holding material shader parameters. Not supported on Direct3D, always returns false so that the parameters are set individually.
+    bool SetMaterialConstantBuffers(unsigned parameterHash, const HashMap<StringHash, MaterialShaderParameter>& parameters) { return false; }
     /// Check whether a shader parameter exists on the currently set shaders.
     bool HasShaderParameter(StringHash param);
     /// Check whether the current pixel shader uses a texture unit.
@@ -256,14 +295,28 @@ public:
     bool GetSRGB() const { return sRGB_; }
     /// Return whether the GPU command buffer is flushed each frame.
     bool GetFlushGPU() const { return flushGPU_; }
+    /// Return whether frames are executed and presented in a render thread.
+    bool GetRenderThread() const { return renderThread_; }
     /// Return allowed screen orientations.
     const String& GetOrientations() const { return orientations_; }
+    /// Return whether compiles shaders in worker threads.
+    bool GetAsyncShaders() const { return asyncShaders_; }
+    /// Return the shader defines kept in the fallback permutation.
+    const String& GetShaderFallbackDefines() const { return shaderFallbackDefines_; }
+    /// Return the shader program binary cache directory. Always empty on Direct3D.
+    const String& GetShaderCacheDir() const { return String::EMPTY; }
     /// Return whether Direct3D device is lost, and can not yet render. Always false on D3D11.
     bool IsDeviceLost() const { return false; }
     /// Return number of primitives drawn this frame.
     unsigned GetNumPrimitives() const { return numPrimitives_; }
     /// Return number of batches drawn this frame.
     unsigned GetNumBatches() const { return numBatches_; }
+    /// Return number of render state changes, texture and buffer binds and shader parameter updates sent to the GPU this frame.
+    unsigned GetNumStateChanges() const { return numStateChanges_; }
+    /// Return number of redundant render state changes, binds and shader parameter updates filtered out this frame.
+    unsigned GetNumAvoidedStateChanges() const { return numAvoidedStateChanges_; }
+    /// Return number of shader parameter bytes uploaded this frame.
+    unsigned GetNumParameterBytes() const { return numParameterBytes_; }
     /// Return dummy color texture format for shadow maps. Is "NULL" (consume no video memory) if supported.
     unsigned GetDummyColorFormat() const { return dummyColorFormat_; }
     /// Return shadow map depth texture format, or 0 if not supported.
@@ -272,6 +325,28 @@ public:
     unsigned GetHiresShadowMapFormat() const { return hiresShadowMapFormat_; }
     /// Return whether hardware instancing is supported..
     bool GetInstancingSupport() const { return instancingSupport_; }
+    /// Return whether discarding framebuffer contents is supported. Always false on Direct3D11.
+    bool GetFramebufferDiscardSupport() const { return false; }
+    /// Return whether 2D texture arrays are supported. Always true on Direct3D11.
+    bool GetTextureArraySupport() const { return true; }
+    /// Return whether indirect drawing of several instanced geometries in one call is supported.
+    bool GetIndirectDrawSupport() const { return indirectDrawSupport_; }
+    /// Return whether hardware occlusion queries are supported.
+    bool GetOcclusionQuerySupport() const { return occlusionQuerySupport_; }
+    /// Return whether GPU timer queries for GPU profiling are supported.
+    bool GetTimerQuerySupport() const { return timerQuerySupport_; }
+    /// Return whether GPU profiling is enabled.
+    bool GetGPUProfiling() const { return gpuProfiling_; }
+    /// Return the GPU profiling blocks of the latest frame whose timer queries have completed.
+    const Vector<GPUProfileBlock>& GetGPUProfileResults() const { return gpuProfileResults_; }
+    /// Return whether recording rendering commands to command lists is supported.
+    bool GetCommandListSupport() const { return true; }
+    /// Return whether is recording rendering commands to a command list.
+    bool IsRecordingCommandList() const;
+    /// Return whether skinning from a bone matrix texture is supported.
+    bool GetTextureSkinningSupport() const { return true; }
+    /// Return whether vertex shaders can fetch from textures, as needed by CDLOD terrain.
+    bool GetVertexTextureSupport() const { return true; }
     /// Return whether light pre-pass rendering is supported.
     bool GetLightPrepassSupport() const { return lightPrepassSupport_; }
     /// Return whether deferred rendering is supported.
@@ -280,6 +355,8 @@ public:
     bool GetHardwareShadowSupport() const { return hardwareShadowSupport_; }
     /// Return whether a readable hardware depth format is available.
     bool GetReadableDepthSupport() const { return GetReadableDepthFormat() != 0; }
+    /// Return whether depth-stencil textures can be copied.
+    bool GetDepthCopySupport() const { return true; }
     /// Return whether sRGB conversion on texture sampling is supported.
     bool GetSRGBSupport() const { return sRGBSupport_; }
     /// Return whether sRGB conversion on rendertarget writing is supported.
@@ -296,6 +373,10 @@ public:
     ShaderVariation* GetShader(ShaderType type, const String& name, const String& defines = String::EMPTY) const;
     /// Return a shader variation by name and defines.
     ShaderVariation* GetShader(ShaderType type, const char* name, const char* defines) const;
+    /// Return the resource directory shaders are loaded from.
+    const String& GetShaderPath() const { return shaderPath_; }
+    /// Return the shader source file extension.
+    const String& GetShaderExtension() const { return shaderExtension_; }
     /// Return current vertex buffer by index.
     VertexBuffer* GetVertexBuffer(unsigned index) const;
     /// Return current index buffer.
@@ -436,12 +517,28 @@ private:
     bool UpdateSwapChain(int width, int height);
     /// Check supported rendering features.
     void CheckFeatureSupport();
+    /// Begin GPU profiling of a frame. Read back the results of the oldest frame in flight.
+    void BeginGPUProfileFrame();
+    /// End GPU profiling of a frame.
+    void EndGPUProfileFrame();
+    /// Release the GPU profiling timer queries.
+    void ReleaseGPUProfileQueries();
     /// Reset cached rendering state.
     void ResetCachedState();
+    /// Create a shader asynchronously if not created yet. Return true if ready for use.
+    bool IsShaderReady(ShaderVariation* shader);
+    /// Return the fallback permutation of a shader, or null if none.
+    ShaderVariation* GetFallbackShader(ShaderVariation* shader) const;
     /// Initialize texture unit mappings.
     void SetTextureUnitMappings();
     /// Process dirtied state before draw.
     void PrepareDraw();
+    /// Write a shader parameter to a constant buffer and queue the buffer for update if the value changed.
+    void SetBufferParameter(ConstantBuffer* buffer, unsigned offset, unsigned size, const void* data);
+    /// Start recording frames for the render thread if enabled and the device exists.
+    void StartRenderThread();
+    /// Wait for the render thread to finish, stop it and execute the partially recorded frame on the immediate context.
+    void StopRenderThread();
     
     /// Mutex for accessing the GPU objects vector from several threads.
     Mutex gpuObjectMutex_;
@@ -473,6 +570,10 @@ private:
     bool tripleBuffer_;
     /// Flush GPU command buffer flag.
     bool flushGPU_;
+    /// Render thread flag.
+    bool renderThread_;
+    /// Asynchronous shader compile flag.
+    bool asyncShaders_;
     /// sRGB conversion on write flag for the main window.
     bool sRGB_;
     /// Light pre-pass rendering support flag.
@@ -483,6 +584,12 @@ private:
     bool hardwareShadowSupport_;
     /// Instancing support flag.
     bool instancingSupport_;
+    /// Indirect draw support flag.
+    bool indirectDrawSupport_;
+    /// Occlusion query support flag.
+    bool occlusionQuerySupport_;
+    /// Timer query support flag.
+    bool timerQuerySupport_;
     /// sRGB conversion on read support flag.
     bool sRGBSupport_;
     /// sRGB conversion on write support flag.
@@ -491,10 +598,38 @@ private:
     unsigned numPrimitives_;
     /// Number of batches this frame.
     unsigned numBatches_;
+    /// Number of render state changes this frame.
+    unsigned numStateChanges_;
+    /// Number of avoided redundant render state changes this frame.
+    unsigned numAvoidedStateChanges_;
+    /// Number of shader parameter bytes uploaded this frame.
+    unsigned numParameterBytes_;
     /// Largest scratch buffer request this frame.
     unsigned maxScratchBufferRequest_;
     /// GPU objects.
     PODVector<GPUObject*> gpuObjects_;
+    /// Occlusion query objects by handle. Created on first use.
+    PODVector<void*> occlusionQueries_;
+    /// Free occlusion query handles.
+    PODVector<unsigned> freeOcclusionQueries_;
+    /// GPU profiling blocks of the frames in flight.
+    Vector<GPUProfileBlock> gpuProfileBlocks_[NUM_GPU_PROFILE_FRAMES];
+    /// Number of GPU profiling blocks begun on each frame in flight.
+    unsigned numGPUProfileBlocks_[NUM_GPU_PROFILE_FRAMES];
+    /// GPU profiling timestamp queries of the frames in flight, two per block. Created on first use.
+    PODVector<void*> gpuTimestampQueries_[NUM_GPU_PROFILE_FRAMES];
+    /// GPU profiling timestamp disjoint queries of the frames in flight.
+    void* gpuDisjointQueries_[NUM_GPU_PROFILE_FRAMES];
+    /// Open GPU profiling blocks.
+    PODVector<unsigned> gpuProfileStack_;
+    /// GPU profiling blocks of the latest completed frame.
+    Vector<GPUProfileBlock> gpuProfileResults_;
+    /// Current GPU profiling frame in flight.
+    unsigned gpuProfileFrame_;
+    /// GPU profiling flag.
+    bool gpuProfiling_;
+    /// GPU profiling of the current frame begun flag.
+    bool gpuProfileFrameActive_;
     /// Scratch buffers.
     Vector<ScratchBuffer> scratchBuffers_;
     /// Shadow map dummy color texture format.
@@ -625,6 +760,8 @@ private:
     SharedPtr<ShaderPrecache> shaderPrecache_;
     /// Allowed screen orientations.
     String orientations_;
+    /// Shader defines kept in the fallback permutation.
+    String shaderFallbackDefines_;
     /// Graphics API name.
     String apiName_;
 
@@ -29,15 +29,80 @@
 namespace Urho3D
 {
 
+RenderThread::RenderThread(GraphicsImpl* impl) :
+    impl_(impl),
+    commandList_(0),
+    vsync_(false),
+    pending_(false)
+{
+}
+
+void RenderThread::ThreadFunction()
+{
+    for (;;)
+    {
+        frameReady_.Wait();
+        if (!shouldRun_)
+            break;
+        
+        {
+            MutexLock lock(impl_->immediateContextMutex_);
+            
+            // Executing without restoring the state leaves the immediate context in the default state
+            impl_->immediateContext_->ExecuteCommandList(commandList_, FALSE);
+            commandList_->Release();
+            commandList_ = 0;
+            impl_->swapChain_->Present(vsync_ ? 1 : 0, 0);
+        }
+        
+        frameDone_.Set();
+    }
+}
+
+void RenderThread::Submit(ID3D11CommandList* commandList, bool vsync)
+{
+    WaitIdle();
+    
+    if (!commandList)
+        return;
+    
+    commandList_ = commandList;
+    vsync_ = vsync;
+    pending_ = true;
+    frameReady_.Set();
+}
+
+void RenderThread::WaitIdle()
+{
+    if (pending_)
+    {
+        frameDone_.Wait();
+        pending_ = false;
+    }
+}
+
+void RenderThread::Quit()
+{
+    WaitIdle();
+    shouldRun_ = false;
+    frameReady_.Set();
+    Stop();
+}
+
 GraphicsImpl::GraphicsImpl() :
     window_(0),
     device_(0),
     deviceContext_(0),
+    immediateContext_(0),
+    deferredContext_(0),
+    renderThread_(0),
     swapChain_(0),
     defaultRenderTargetView_(0),
     defaultDepthTexture_(0),
     defaultDepthStencilView_(0),
-    depthStencilView_(0)
+    depthStencilView_(0),
+    indirectBuffer_(0),
+    indirectBufferSize_(0)
 {
     for (unsigned i = 0; i < MAX_RENDERTARGETS; ++i)
         renderTargetViews_[i] = 0;
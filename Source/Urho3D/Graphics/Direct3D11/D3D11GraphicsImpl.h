@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include "../../Core/Condition.h"
+#include "../../Core/Mutex.h"
+#include "../../Core/Thread.h"
 #include "../../Math/Color.h"
 #include "../../Graphics/GraphicsDefs.h"
 
@@ -32,10 +35,45 @@
 namespace Urho3D
 {
 
+class GraphicsImpl;
+
+/// Thread that executes the command lists recorded on the main thread and presents them, so that the next frame can be recorded meanwhile.
+class URHO3D_API RenderThread : public Thread
+{
+public:
+    /// Construct.
+    RenderThread(GraphicsImpl* impl);
+    
+    /// Execute and present frames.
+    virtual void ThreadFunction();
+    
+    /// Submit a frame's command list for execution and presentation. Waits until the previous frame has been presented.
+    void Submit(ID3D11CommandList* commandList, bool vsync);
+    /// Wait until the submitted frame has been presented.
+    void WaitIdle();
+    /// Wait until idle and stop the thread.
+    void Quit();
+    
+private:
+    /// Graphics implementation.
+    GraphicsImpl* impl_;
+    /// Command list to execute.
+    ID3D11CommandList* commandList_;
+    /// Frame submitted condition.
+    Condition frameReady_;
+    /// Frame presented condition.
+    Condition frameDone_;
+    /// Vertical sync flag of the submitted frame.
+    bool vsync_;
+    /// Submitted frame pending flag. Accessed only from the main thread.
+    bool pending_;
+};
+
 /// %Graphics implementation. Holds API-specific objects.
 class URHO3D_API GraphicsImpl
 {
     friend class Graphics;
+    friend class RenderThread;
     
 public:
     /// Construct.
@@ -43,8 +81,12 @@ public:
     
     /// Return Direct3D device.
     ID3D11Device* GetDevice() const { return device_; }
-    /// Return Direct3D immediate device context.
+    /// Return Direct3D device context in use for rendering. This is the deferred context while recording a command list.
     ID3D11DeviceContext* GetDeviceContext() const { return deviceContext_; }
+    /// Return Direct3D immediate device context. Lock the immediate context mutex when using it, as the render thread may be executing on it.
+    ID3D11DeviceContext* GetImmediateContext() const { return immediateContext_; }
+    /// Return mutex for using the immediate device context.
+    Mutex& GetImmediateContextMutex() { return immediateContextMutex_; }
     /// Return swapchain.
     IDXGISwapChain* GetSwapChain() const { return swapChain_; }
     /// Return window.
@@ -55,8 +97,16 @@ private:
     SDL_Window* window_;
     /// Graphics device.
     ID3D11Device* device_;
-    /// Immediate device context.
+    /// Device context in use for rendering.
     ID3D11DeviceContext* deviceContext_;
+    /// Immediate device context.
+    ID3D11DeviceContext* immediateContext_;
+    /// Deferred device context for recording command lists. Created on first use.
+    ID3D11DeviceContext* deferredContext_;
+    /// Render thread, null if not in use.
+    RenderThread* renderThread_;
+    /// Mutex for using the immediate device context.
+    Mutex immediateContextMutex_;
     /// Swap chain.
     IDXGISwapChain* swapChain_;
     /// Default (backbuffer) rendertarget view.
@@ -87,6 +137,10 @@ private:
     unsigned vertexSizes_[MAX_VERTEX_STREAMS];
     /// Vertex stream offsets per buffer.
     unsigned vertexOffsets_[MAX_VERTEX_STREAMS];
+    /// Buffer for indirect draw arguments.
+    ID3D11Buffer* indirectBuffer_;
+    /// Indirect draw argument buffer size in bytes.
+    unsigned indirectBufferSize_;
 };
 
 }
@@ -179,6 +179,10 @@ bool IndexBuffer::SetDataRange(const void* data, unsigned start, unsigned count,
     if (shadowData_ && shadowData_.Get() + start * indexSize_ != data)
         memcpy(shadowData_.Get() + start * indexSize_, data, count * indexSize_);
     
+    // A deferred context can only map with discard, so rewrite the whole buffer from the shadow data
+    if (object_ && dynamic_ && !discard && shadowData_ && graphics_->IsRecordingCommandList())
+        return SetData(shadowData_.Get());
+    
     if (object_)
     {
         if (dynamic_)
@@ -20,6 +20,8 @@
 // THE SOFTWARE.
 //
 
+#include "../../Core/Timer.h"
+#include "../../Core/WorkQueue.h"
 #include "../../IO/File.h"
 #include "../../IO/FileSystem.h"
 #include "../../Graphics/Graphics.h"
@@ -69,11 +71,7 @@ bool ShaderVariation::Create()
     }
 
     // Check for up-to-date bytecode on disk
-    String path, name, extension;
-    SplitPath(owner_->GetName(), path, name, extension);
-    extension = type_ == VS ? ".vs4" : ".ps4";
-    
-    String binaryShaderName = path + "Cache/" + name + "_" + StringHash(defines_).ToString() + extension;
+    String binaryShaderName = GetBinaryShaderName();
     
     if (!LoadByteCode(binaryShaderName))
     {
@@ -86,6 +84,59 @@ bool ShaderVariation::Create()
     }
     
     // Then create shader from the bytecode
+    return CreateFromByteCode();
+}
+
+bool ShaderVariation::CreateAsync()
+{
+    if (object_)
+        return true;
+    
+    // Check for the worker thread having finished compiling
+    if (compileItem_)
+    {
+        if (!compileItem_->completed_)
+            return false;
+        
+        compileItem_.Reset();
+        if (byteCode_.Empty())
+        {
+            if (compilerOutput_.Empty())
+                compilerOutput_ = "Could not compile shader";
+            return false;
+        }
+        if (owner_ && owner_->GetTimeStamp())
+            SaveByteCode(GetBinaryShaderName());
+        return CreateFromByteCode();
+    }
+    
+    Release();
+    
+    if (!graphics_)
+        return false;
+    
+    if (!owner_)
+    {
+        compilerOutput_ = "Owner shader has expired";
+        return false;
+    }
+    
+    if (LoadByteCode(GetBinaryShaderName()))
+        return CreateFromByteCode();
+    
+    // Compile in the lowest priority so that the frame's own work is never stalled. The source code and defines
+    // are not modified while the work item exists
+    WorkQueue* queue = owner_->GetSubsystem<WorkQueue>();
+    compileItem_ = new WorkItem();
+    compileItem_->workFunction_ = CompileWork;
+    compileItem_->aux_ = this;
+    compileItem_->priority_ = 0;
+    queue->AddWorkItem(compileItem_);
+    return false;
+}
+
+bool ShaderVariation::CreateFromByteCode()
+{
     ID3D11Device* device = graphics_->GetImpl()->GetDevice();
     if (type_ == VS)
     {
@@ -107,6 +158,8 @@ bool ShaderVariation::Create()
 
 void ShaderVariation::Release()
 {
+    WaitForCompile();
+    
     if (object_)
     {
         if (!graphics_)
@@ -158,6 +211,15 @@ Shader* ShaderVariation::GetOwner() const
     return owner_;
 }
 
+String ShaderVariation::GetBinaryShaderName() const
+{
+    String path, name, extension;
+    SplitPath(owner_->GetName(), path, name, extension);
+    extension = type_ == VS ? ".vs4" : ".ps4";
+    
+    return path + "Cache/" + name + "_" + StringHash(defines_).ToString() + extension;
+}
+
 bool ShaderVariation::LoadByteCode(const String& binaryShaderName)
 {
     ResourceCache* cache = owner_->GetSubsystem<ResourceCache>();
@@ -395,6 +457,28 @@ void ShaderVariation::ParseParameters(unsigned char* bufData, unsigned bufSize)
     reflection->Release();
 }
 
+void ShaderVariation::WaitForCompile()
+{
+    if (!compileItem_)
+        return;
+    
+    // The worker thread writes to this object, so wait for it if it has already started
+    WorkQueue* queue = graphics_ ? graphics_->GetSubsystem<WorkQueue>() : 0;
+    if (queue && !queue->RemoveWorkItem(compileItem_))
+    {
+        while (!compileItem_->completed_)
+            Time::Sleep(0);
+    }
+    
+    compileItem_.Reset();
+}
+
+void ShaderVariation::CompileWork(const WorkItem* item, unsigned threadIndex)
+{
+    ShaderVariation* variation = reinterpret_cast<ShaderVariation*>(item->aux_);
+    variation->Compile();
+}
+
 void ShaderVariation::SaveByteCode(const String& binaryShaderName)
 {
     ResourceCache* cache = owner_->GetSubsystem<ResourceCache>();
@@ -33,6 +33,7 @@ namespace Urho3D
 
 class ConstantBuffer;
 class Shader;
+struct WorkItem;
 
 /// %Shader parameter definition.
 struct ShaderParameter
@@ -86,6 +87,8 @@ public:
     
     /// Compile the shader. Return true if successful.
     bool Create();
+    /// Compile the shader in a worker thread if no up-to-date bytecode exists. Call again to check for completion. Return true once the shader has been created.
+    bool CreateAsync();
     /// Set name.
     void SetName(const String& name);
     /// Set defines.
@@ -113,14 +116,24 @@ public:
     const String& GetDefines() const { return defines_; }
     /// Return compile error/warning string.
     const String& GetCompilerOutput() const { return compilerOutput_; }
+    /// Return whether is being compiled in a worker thread.
+    bool IsCompiling() const { return compileItem_.NotNull(); }
     /// Return constant buffer data sizes.
     const unsigned* GetConstantBufferSizes() const { return &constantBufferSizes_[0]; }
 
 private:
+    /// Return the bytecode cache file name.
+    String GetBinaryShaderName() const;
     /// Load bytecode from a file. Return true if successful.
     bool LoadByteCode(const String& binaryShaderName);
     /// Compile from source. Return true if successful.
     bool Compile();
+    /// Create the shader from the bytecode. Return true if successful.
+    bool CreateFromByteCode();
+    /// Wait for an asynchronous compile to finish or cancel it.
+    void WaitForCompile();
+    /// Work function for compiling in a worker thread.
+    static void CompileWork(const WorkItem* item, unsigned threadIndex);
     /// Inspect the constant parameters and input layout (if applicable) from the shader bytecode.
     void ParseParameters(unsigned char* bufData, unsigned bufSize);
     /// Save bytecode to a file.
@@ -148,6 +161,8 @@ private:
     String defines_;
     /// Shader compile error string.
     String compilerOutput_;
+    /// Asynchronous compile work item.
+    SharedPtr<WorkItem> compileItem_;
 };
 
 }
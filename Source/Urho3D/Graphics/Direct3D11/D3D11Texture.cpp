@@ -89,6 +89,7 @@ Texture::Texture(Context* context) :
     depth_(0),
     shadowCompare_(false),
     filterMode_(FILTER_DEFAULT),
+    streamingMipsToSkip_(0),
     sRGB_(false),
     parametersDirty_(true)
 {
@@ -30,6 +30,7 @@
 #include "../../Core/Profiler.h"
 #include "../../Resource/ResourceCache.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../Graphics/TextureStreamer.h"
 #include "../../Resource/XMLFile.h"
 
 #include "../../DebugNew.h"
@@ -66,14 +67,28 @@ bool Texture2D::BeginLoad(Deserializer& source)
         return false;
     }
 
-    // Precalculate mip levels if async loading
-    if (GetAsyncLoadState() == ASYNC_LOADING)
-        loadImage_->PrecalculateLevels();
-    
     // Load the optional parameters file
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     String xmlName = ReplaceExtension(GetName(), ".xml");
     loadParameters_ = cache->GetTempResource<XMLFile>(xmlName, false);
+
+    // Compress to DXT if requested by the parameters file. When loading asynchronously this happens in the worker thread
+    if (loadParameters_ && loadParameters_->GetRoot().GetChild("compress").GetBool("enable") && !loadImage_->IsCompressed() &&
+        graphics_->GetFormat(CF_DXT5))
+    {
+        if ((loadImage_->GetWidth() & 3) || (loadImage_->GetHeight() & 3))
+            LOGWARNING("Texture " + GetName() + " size is not a multiple of 4, can not compress");
+        else
+        {
+            SharedPtr<Image> compressedImage = loadImage_->ConvertToDXT();
+            if (compressedImage)
+                loadImage_ = compressedImage;
+        }
+    }
+
+    // Precalculate mip levels if async loading
+    if (GetAsyncLoadState() == ASYNC_LOADING)
+        loadImage_->PrecalculateLevels();
     
     return true;
 }
@@ -88,6 +103,13 @@ bool Texture2D::EndLoad()
     CheckTextureBudget(GetTypeStatic());
 
     SetParameters(loadParameters_);
+    
+    // Let the texture streamer choose the initially loaded mip level
+    Renderer* renderer = GetSubsystem<Renderer>();
+    TextureStreamer* streamer = renderer ? renderer->GetTextureStreamer() : 0;
+    if (streamer)
+        streamer->AddTexture(this, loadImage_);
+    
     bool success = SetData(loadImage_);
     
     loadImage_.Reset();
@@ -335,7 +357,7 @@ bool Texture2D::SetData(SharedPtr<Image> image, bool useAlpha)
             needDecompress = true;
         }
         
-        unsigned mipsToSkip = mipsToSkip_[quality];
+        unsigned mipsToSkip = mipsToSkip_[quality] + streamingMipsToSkip_;
         if (mipsToSkip >= levels)
             mipsToSkip = levels - 1;
         while (mipsToSkip && (width / (1 << mipsToSkip) < 4 || height / (1 << mipsToSkip) < 4))
@@ -413,6 +435,8 @@ bool Texture2D::GetData(unsigned level, void* dest) const
     }
 
     unsigned srcSubResource = D3D11CalcSubresource(level, 0, levels_);
+    // The render thread may be executing on the immediate context
+    MutexLock lock(graphics_->GetImpl()->GetImmediateContextMutex());
     D3D11_BOX srcBox;
     srcBox.left = 0;
     srcBox.right = levelWidth;
@@ -420,7 +444,7 @@ bool Texture2D::GetData(unsigned level, void* dest) const
     srcBox.bottom = levelHeight;
     srcBox.front = 0;
     srcBox.back = 1;
-    graphics_->GetImpl()->GetDeviceContext()->CopySubresourceRegion(stagingTexture, 0, 0, 0, 0, (ID3D11Resource*)object_,
+    graphics_->GetImpl()->GetImmediateContext()->CopySubresourceRegion(stagingTexture, 0, 0, 0, 0, (ID3D11Resource*)object_,
         srcSubResource, &srcBox);
     
     D3D11_MAPPED_SUBRESOURCE mappedData;
@@ -428,12 +452,12 @@ bool Texture2D::GetData(unsigned level, void* dest) const
     unsigned rowSize = GetRowDataSize(levelWidth);
     unsigned numRows = IsCompressed() ? (levelHeight + 3) >> 2 : levelHeight;
 
-    graphics_->GetImpl()->GetDeviceContext()->Map((ID3D11Resource*)stagingTexture, 0, D3D11_MAP_READ, 0, &mappedData);
+    graphics_->GetImpl()->GetImmediateContext()->Map((ID3D11Resource*)stagingTexture, 0, D3D11_MAP_READ, 0, &mappedData);
     if (mappedData.pData)
     {
         for (unsigned row = 0; row < numRows; ++row)
             memcpy((unsigned char*)dest + row * rowSize, (unsigned char*)mappedData.pData + row * mappedData.RowPitch, rowSize);
-        graphics_->GetImpl()->GetDeviceContext()->Unmap((ID3D11Resource*)stagingTexture, 0);
+        graphics_->GetImpl()->GetImmediateContext()->Unmap((ID3D11Resource*)stagingTexture, 0);
         stagingTexture->Release();
         return true;
     }
@@ -619,6 +619,8 @@ bool TextureCube::GetData(CubeMapFace face, unsigned level, void* dest) const
     }
 
     unsigned srcSubResource = D3D11CalcSubresource(level, face, levels_);
+    // The render thread may be executing on the immediate context
+    MutexLock lock(graphics_->GetImpl()->GetImmediateContextMutex());
     D3D11_BOX srcBox;
     srcBox.left = 0;
     srcBox.right = levelWidth;
@@ -626,7 +628,7 @@ bool TextureCube::GetData(CubeMapFace face, unsigned level, void* dest) const
     srcBox.bottom = levelHeight;
     srcBox.front = 0;
     srcBox.back = 1;
-    graphics_->GetImpl()->GetDeviceContext()->CopySubresourceRegion(stagingTexture, 0, 0, 0, 0, (ID3D11Resource*)object_,
+    graphics_->GetImpl()->GetImmediateContext()->CopySubresourceRegion(stagingTexture, 0, 0, 0, 0, (ID3D11Resource*)object_,
         srcSubResource, &srcBox);
 
     D3D11_MAPPED_SUBRESOURCE mappedData;
@@ -634,12 +636,12 @@ bool TextureCube::GetData(CubeMapFace face, unsigned level, void* dest) const
     unsigned rowSize = GetRowDataSize(levelWidth);
     unsigned numRows = IsCompressed() ? (levelHeight + 3) >> 2 : levelHeight;
 
-    graphics_->GetImpl()->GetDeviceContext()->Map((ID3D11Resource*)stagingTexture, 0, D3D11_MAP_READ, 0, &mappedData);
+    graphics_->GetImpl()->GetImmediateContext()->Map((ID3D11Resource*)stagingTexture, 0, D3D11_MAP_READ, 0, &mappedData);
     if (mappedData.pData)
     {
         for (unsigned row = 0; row < numRows; ++row)
             memcpy((unsigned char*)dest + row * rowSize, (unsigned char*)mappedData.pData + row * mappedData.RowPitch, rowSize);
-        graphics_->GetImpl()->GetDeviceContext()->Unmap((ID3D11Resource*)stagingTexture, 0);
+        graphics_->GetImpl()->GetImmediateContext()->Unmap((ID3D11Resource*)stagingTexture, 0);
         stagingTexture->Release();
         return true;
     }
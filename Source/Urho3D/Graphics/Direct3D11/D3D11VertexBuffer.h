@@ -81,6 +81,10 @@ public:
     static unsigned GetVertexSize(unsigned elementMask);
     /// Return element offset from an element mask.
     static unsigned GetElementOffset(unsigned elementMask, VertexElement element);
+    /// Return element size in bytes from an element mask, taking packed formats into account.
+    static unsigned GetElementSize(unsigned elementMask, VertexElement element);
+    /// Return whether an element is stored in a packed format according to an element mask.
+    static bool IsElementPacked(unsigned elementMask, VertexElement element);
     
     /// Vertex element sizes.
     static const unsigned elementSize[];
@@ -90,6 +94,10 @@ public:
     static const unsigned elementSemanticIndices[];
     /// Vertex element formats.
     static const unsigned elementFormats[];
+    /// Packed vertex element sizes.
+    static const unsigned packedElementSize[];
+    /// Packed vertex element formats.
+    static const unsigned packedElementFormats[];
 
 private:
     /// Update offsets of vertex elements.
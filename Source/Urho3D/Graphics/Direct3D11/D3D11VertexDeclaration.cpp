@@ -50,7 +50,8 @@ VertexDeclaration::VertexDeclaration(Graphics* graphics, ShaderVariation* vertex
                     D3D11_INPUT_ELEMENT_DESC newDesc;
                     newDesc.SemanticName = VertexBuffer::elementSemantics[j];
                     newDesc.SemanticIndex = VertexBuffer::elementSemanticIndices[j];
-                    newDesc.Format = (DXGI_FORMAT)VertexBuffer::elementFormats[j];
+                    newDesc.Format = (DXGI_FORMAT)(VertexBuffer::IsElementPacked(vertexBuffers[i]->GetElementMask(),
+                        (VertexElement)j) ? VertexBuffer::packedElementFormats[j] : VertexBuffer::elementFormats[j]);
                     newDesc.InputSlot = (unsigned)i;
                     newDesc.AlignedByteOffset = vertexBuffers[i]->GetElementOffset((VertexElement)j);
                     newDesc.InputSlotClass = (j >= ELEMENT_INSTANCEMATRIX1 && j <= ELEMENT_INSTANCEMATRIX3) ?
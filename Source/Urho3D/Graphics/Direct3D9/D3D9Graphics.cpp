@@ -21,17 +21,21 @@
 //
 
 #include "../../Graphics/AnimatedModel.h"
+#include "../../Graphics/AnimatedModelGroup.h"
 #include "../../Graphics/Animation.h"
 #include "../../Graphics/AnimationController.h"
 #include "../../Graphics/Camera.h"
+#include "../../Graphics/CDLODTerrain.h"
 #include "../../Core/Context.h"
 #include "../../Graphics/CustomGeometry.h"
 #include "../../Graphics/DebugRenderer.h"
 #include "../../Graphics/DecalSet.h"
 #include "../../IO/File.h"
+#include "../../Graphics/GPUParticleEmitter.h"
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsEvents.h"
 #include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/ImpostorSet.h"
 #include "../../Graphics/IndexBuffer.h"
 #include "../../IO/Log.h"
 #include "../../Graphics/Material.h"
@@ -51,6 +55,7 @@
 #include "../../Graphics/Terrain.h"
 #include "../../Graphics/TerrainPatch.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../Graphics/Texture2DArray.h"
 #include "../../Graphics/Texture3D.h"
 #include "../../Graphics/TextureCube.h"
 #include "../../Core/Timer.h"
@@ -262,16 +267,22 @@ Graphics::Graphics(Context* context) :
     vsync_(false),
     tripleBuffer_(false),
     flushGPU_(false),
+    asyncShaders_(false),
     sRGB_(false),
     deviceLost_(false),
     queryIssued_(false),
     lightPrepassSupport_(false),
     deferredSupport_(false),
     instancingSupport_(false),
+    occlusionQuerySupport_(false),
+    timerQuerySupport_(false),
     sRGBSupport_(false),
     sRGBWriteSupport_(false),
     numPrimitives_(0),
     numBatches_(0),
+    numStateChanges_(0),
+    numAvoidedStateChanges_(0),
+    numParameterBytes_(0),
     maxScratchBufferRequest_(0),
     defaultTextureFilterMode_(FILTER_TRILINEAR),
     shaderProgram_(0),
@@ -282,6 +293,16 @@ Graphics::Graphics(Context* context) :
 {
     SetTextureUnitMappings();
     
+    gpuProfileFrame_ = 0;
+    gpuProfiling_ = false;
+    gpuProfileFrameActive_ = false;
+    for (unsigned i = 0; i < NUM_GPU_PROFILE_FRAMES; ++i)
+    {
+        numGPUProfileBlocks_[i] = 0;
+        gpuDisjointQueries_[i] = 0;
+        gpuFrequencyQueries_[i] = 0;
+    }
+    
     // Initialize SDL now. Graphics should be the first SDL-using subsystem to be created
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER | SDL_INIT_NOPARACHUTE);
     
@@ -317,6 +338,14 @@ Graphics::~Graphics()
         impl_->frameQuery_->Release();
         impl_->frameQuery_ = 0;
     }
+    for (PODVector<void*>::Iterator i = occlusionQueries_.Begin(); i != occlusionQueries_.End(); ++i)
+    {
+        if (*i)
+            ((IDirect3DQuery9*)*i)->Release();
+    }
+    occlusionQueries_.Clear();
+    freeOcclusionQueries_.Clear();
+    ReleaseGPUProfileQueries();
     if (impl_->device_)
     {
         impl_->device_->Release();
@@ -586,6 +615,24 @@ void Graphics::SetFlushGPU(bool enable)
     flushGPU_ = enable;
 }
 
+void Graphics::SetAsyncShaders(bool enable)
+{
+    asyncShaders_ = enable;
+}
+
+void Graphics::SetShaderFallbackDefines(const String& defines)
+{
+    shaderFallbackDefines_ = defines.Trimmed();
+}
+
+void Graphics::SetRenderThread(bool enable)
+{
+}
+
+void Graphics::SetShaderCacheDir(const String& path)
+{
+}
+
 void Graphics::SetOrientations(const String& orientations)
 {
     orientations_ = orientations.Trimmed();
@@ -778,6 +825,11 @@ bool Graphics::BeginFrame()
     
     numPrimitives_ = 0;
     numBatches_ = 0;
+    numStateChanges_ = 0;
+    numAvoidedStateChanges_ = 0;
+    numParameterBytes_ = 0;
+    
+    BeginGPUProfileFrame();
     
     SendEvent(E_BEGINRENDERING);
     
@@ -794,6 +846,8 @@ void Graphics::EndFrame()
         
         SendEvent(E_ENDRENDERING);
         
+        EndGPUProfileFrame();
+        
         impl_->device_->EndScene();
         impl_->device_->Present(0, 0, 0, 0);
     }
@@ -866,9 +920,15 @@ bool Graphics::ResolveToTexture(Texture2D* destination, const IntRect& viewport)
         (IDirect3DSurface9*)destination->GetRenderSurface()->GetSurface(), &destRect, D3DTEXF_NONE));
 }
 
+bool Graphics::CopyDepthTexture(Texture2D* destination, Texture2D* source)
+{
+    // StretchRect can not copy depth-stencil textures
+    return false;
+}
+
 void Graphics::Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount)
 {
-    if (!vertexCount)
+    if (!vertexCount || !vertexShader_ || !pixelShader_)
         return;
     
     ResetStreamFrequencies();
@@ -885,7 +945,7 @@ void Graphics::Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCou
 
 void Graphics::Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount)
 {
-    if (!indexCount)
+    if (!indexCount || !vertexShader_ || !pixelShader_)
         return;
     
     ResetStreamFrequencies();
@@ -903,7 +963,7 @@ void Graphics::Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount
 void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount,
     unsigned instanceCount)
 {
-    if (!indexCount || !instanceCount)
+    if (!indexCount || !instanceCount || !vertexShader_ || !pixelShader_)
         return;
     
     for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
@@ -928,6 +988,256 @@ void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned i
     ++numBatches_;
 }
 
+unsigned Graphics::CreateOcclusionQuery()
+{
+    if (!occlusionQuerySupport_)
+        return 0;
+    
+    // The query object itself is created on first use, which also recreates it after a device loss
+    unsigned index;
+    if (freeOcclusionQueries_.Size())
+    {
+        index = freeOcclusionQueries_.Back();
+        freeOcclusionQueries_.Pop();
+    }
+    else
+    {
+        index = occlusionQueries_.Size();
+        occlusionQueries_.Push(0);
+    }
+    
+    return index + 1;
+}
+
+void Graphics::DestroyOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size())
+        return;
+    
+    void*& object = occlusionQueries_[query - 1];
+    if (object)
+    {
+        ((IDirect3DQuery9*)object)->Release();
+        object = 0;
+    }
+    
+    freeOcclusionQueries_.Push(query - 1);
+}
+
+void Graphics::BeginOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size())
+        return;
+    
+    void*& object = occlusionQueries_[query - 1];
+    if (!object)
+    {
+        if (FAILED(impl_->device_->CreateQuery(D3DQUERYTYPE_OCCLUSION, (IDirect3DQuery9**)&object)))
+        {
+            object = 0;
+            return;
+        }
+    }
+    
+    ((IDirect3DQuery9*)object)->Issue(D3DISSUE_BEGIN);
+}
+
+void Graphics::EndOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size() || !occlusionQueries_[query - 1])
+        return;
+    
+    ((IDirect3DQuery9*)occlusionQueries_[query - 1])->Issue(D3DISSUE_END);
+}
+
+bool Graphics::GetOcclusionQueryResult(unsigned query, bool& visible)
+{
+    // If the query object has been lost, report visible
+    visible = true;
+    if (!query || query > occlusionQueries_.Size() || !occlusionQueries_[query - 1])
+        return true;
+    
+    DWORD samples = 0;
+    HRESULT hr = ((IDirect3DQuery9*)occlusionQueries_[query - 1])->GetData(&samples, sizeof samples, 0);
+    if (hr == S_FALSE)
+        return false;
+    
+    if (hr == S_OK)
+        visible = samples != 0;
+    return true;
+}
+
+void Graphics::SetGPUProfiling(bool enable)
+{
+    if (enable && !timerQuerySupport_)
+    {
+        LOGERROR("Timer queries not supported, can not enable GPU profiling");
+        return;
+    }
+    
+    if (enable == gpuProfiling_)
+        return;
+    
+    gpuProfiling_ = enable;
+    if (!enable)
+    {
+        ReleaseGPUProfileQueries();
+        gpuProfileResults_.Clear();
+    }
+}
+
+void Graphics::BeginGPUProfileBlock(const char* name)
+{
+    if (!gpuProfileFrameActive_)
+        return;
+    
+    unsigned frame = gpuProfileFrame_;
+    unsigned index = numGPUProfileBlocks_[frame];
+    PODVector<void*>& queries = gpuTimestampQueries_[frame];
+    
+    if (index < MAX_GPU_PROFILE_BLOCKS && queries.Size() <= index * 2)
+    {
+        IDirect3DQuery9* beginQuery = 0;
+        IDirect3DQuery9* endQuery = 0;
+        impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &beginQuery);
+        impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &endQuery);
+        if (beginQuery && endQuery)
+        {
+            queries.Push(beginQuery);
+            queries.Push(endQuery);
+        }
+        else
+        {
+            if (beginQuery)
+                beginQuery->Release();
+            if (endQuery)
+                endQuery->Release();
+        }
+    }
+    
+    // If out of blocks, push an invalid index so that the matching end is ignored
+    if (index >= MAX_GPU_PROFILE_BLOCKS || queries.Size() <= index * 2)
+    {
+        gpuProfileStack_.Push(M_MAX_UNSIGNED);
+        return;
+    }
+    
+    Vector<GPUProfileBlock>& blocks = gpuProfileBlocks_[frame];
+    if (blocks.Size() <= index)
+        blocks.Resize(index + 1);
+    blocks[index].name_ = name;
+    blocks[index].depth_ = gpuProfileStack_.Size();
+    
+    ((IDirect3DQuery9*)queries[index * 2])->Issue(D3DISSUE_END);
+    ++numGPUProfileBlocks_[frame];
+    gpuProfileStack_.Push(index);
+}
+
+void Graphics::EndGPUProfileBlock()
+{
+    if (!gpuProfileFrameActive_ || gpuProfileStack_.Empty())
+        return;
+    
+    unsigned index = gpuProfileStack_.Back();
+    gpuProfileStack_.Pop();
+    if (index != M_MAX_UNSIGNED)
+        ((IDirect3DQuery9*)gpuTimestampQueries_[gpuProfileFrame_][index * 2 + 1])->Issue(D3DISSUE_END);
+}
+
+void Graphics::BeginGPUProfileFrame()
+{
+    if (!gpuProfiling_)
+        return;
+    
+    gpuProfileFrame_ = (gpuProfileFrame_ + 1) % NUM_GPU_PROFILE_FRAMES;
+    unsigned frame = gpuProfileFrame_;
+    IDirect3DQuery9*& disjointQuery = (IDirect3DQuery9*&)gpuDisjointQueries_[frame];
+    IDirect3DQuery9*& frequencyQuery = (IDirect3DQuery9*&)gpuFrequencyQueries_[frame];
+    
+    // Read back the frame issued NUM_GPU_PROFILE_FRAMES ago. If its queries are still pending, its results are dropped
+    unsigned numBlocks = numGPUProfileBlocks_[frame];
+    if (numBlocks && disjointQuery && frequencyQuery)
+    {
+        BOOL disjoint = TRUE;
+        UINT64 frequency = 0;
+        if (disjointQuery->GetData(&disjoint, sizeof disjoint, 0) == S_OK && !disjoint &&
+            frequencyQuery->GetData(&frequency, sizeof frequency, 0) == S_OK && frequency)
+        {
+            const Vector<GPUProfileBlock>& blocks = gpuProfileBlocks_[frame];
+            const PODVector<void*>& queries = gpuTimestampQueries_[frame];
+            
+            gpuProfileResults_.Resize(numBlocks);
+            for (unsigned i = 0; i < numBlocks; ++i)
+            {
+                UINT64 beginTime = 0;
+                UINT64 endTime = 0;
+                GPUProfileBlock& result = gpuProfileResults_[i];
+                result = blocks[i];
+                if (((IDirect3DQuery9*)queries[i * 2])->GetData(&beginTime, sizeof beginTime, 0) == S_OK &&
+                    ((IDirect3DQuery9*)queries[i * 2 + 1])->GetData(&endTime, sizeof endTime, 0) == S_OK && endTime > beginTime)
+                    result.time_ = (float)((double)(endTime - beginTime) * 1000.0 / (double)frequency);
+            }
+        }
+    }
+    
+    numGPUProfileBlocks_[frame] = 0;
+    gpuProfileStack_.Clear();
+    
+    if (!disjointQuery && FAILED(impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, &disjointQuery)))
+    {
+        disjointQuery = 0;
+        return;
+    }
+    if (!frequencyQuery && FAILED(impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, &frequencyQuery)))
+    {
+        frequencyQuery = 0;
+        return;
+    }
+    
+    disjointQuery->Issue(D3DISSUE_BEGIN);
+    gpuProfileFrameActive_ = true;
+}
+
+void Graphics::EndGPUProfileFrame()
+{
+    if (!gpuProfileFrameActive_)
+        return;
+    
+    // Close the blocks left open
+    while (!gpuProfileStack_.Empty())
+        EndGPUProfileBlock();
+    
+    ((IDirect3DQuery9*)gpuDisjointQueries_[gpuProfileFrame_])->Issue(D3DISSUE_END);
+    ((IDirect3DQuery9*)gpuFrequencyQueries_[gpuProfileFrame_])->Issue(D3DISSUE_END);
+    gpuProfileFrameActive_ = false;
+}
+
+void Graphics::ReleaseGPUProfileQueries()
+{
+    for (unsigned i = 0; i < NUM_GPU_PROFILE_FRAMES; ++i)
+    {
+        for (PODVector<void*>::Iterator j = gpuTimestampQueries_[i].Begin(); j != gpuTimestampQueries_[i].End(); ++j)
+            ((IDirect3DQuery9*)*j)->Release();
+        gpuTimestampQueries_[i].Clear();
+        
+        if (gpuDisjointQueries_[i])
+        {
+            ((IDirect3DQuery9*)gpuDisjointQueries_[i])->Release();
+            gpuDisjointQueries_[i] = 0;
+        }
+        if (gpuFrequencyQueries_[i])
+        {
+            ((IDirect3DQuery9*)gpuFrequencyQueries_[i])->Release();
+            gpuFrequencyQueries_[i] = 0;
+        }
+        
+        numGPUProfileBlocks_[i] = 0;
+    }
+    
+    gpuProfileStack_.Clear();
+    gpuProfileFrameActive_ = false;
+}
+
 void Graphics::SetVertexBuffer(VertexBuffer* buffer)
 {
     // Note: this is not multi-instance safe
@@ -1028,14 +1338,43 @@ void Graphics::SetIndexBuffer(IndexBuffer* buffer)
             impl_->device_->SetIndices(0);
             
         indexBuffer_ = buffer;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
 {
+    // With asynchronous compiling, draw with the fallback permutations until both shaders are ready, or skip drawing
+    if (asyncShaders_ && vs && ps)
+    {
+        bool vsReady = IsShaderReady(vs);
+        bool psReady = IsShaderReady(ps);
+        if (!vsReady || !psReady)
+        {
+            ShaderVariation* fallbackVS = GetFallbackShader(vs);
+            ShaderVariation* fallbackPS = GetFallbackShader(ps);
+            if (fallbackVS && fallbackPS && IsShaderReady(fallbackVS) && IsShaderReady(fallbackPS))
+            {
+                vs = fallbackVS;
+                ps = fallbackPS;
+            }
+            else
+            {
+                vs = 0;
+                ps = 0;
+            }
+        }
+    }
+
     if (vs == vertexShader_ && ps == pixelShader_)
+    {
+        ++numAvoidedStateChanges_;
         return;
+    }
     
+    ++numStateChanges_;
     ClearParameterSources();
     
     if (vs != vertexShader_)
@@ -1126,10 +1465,7 @@ void Graphics::SetShaderParameter(StringHash param, const float* data, unsigned
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, data, count / 4);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, data, count / 4);
+    SetShaderConstants(i->second_.type_, i->second_.register_, data, count / 4);
 }
 
 void Graphics::SetShaderParameter(StringHash param, float value)
@@ -1141,10 +1477,7 @@ void Graphics::SetShaderParameter(StringHash param, float value)
     static Vector4 data(Vector4::ZERO);
     data.x_ = value;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, &data.x_, 1);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, &data.x_, 1);
+    SetShaderConstants(i->second_.type_, i->second_.register_, &data.x_, 1);
 }
 
 void Graphics::SetShaderParameter(StringHash param, bool value)
@@ -1168,10 +1501,7 @@ void Graphics::SetShaderParameter(StringHash param, const Color& color)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, color.Data(), 1);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, color.Data(), 1);
+    SetShaderConstants(i->second_.type_, i->second_.register_, color.Data(), 1);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
@@ -1184,10 +1514,7 @@ void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
     data.x_ = vector.x_;
     data.y_ = vector.y_;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, &data.x_, 1);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, &data.x_, 1);
+    SetShaderConstants(i->second_.type_, i->second_.register_, &data.x_, 1);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
@@ -1207,10 +1534,7 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
     data.m21_ = matrix.m21_;
     data.m22_ = matrix.m22_;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, &data.m00_, 3);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, &data.m00_, 3);
+    SetShaderConstants(i->second_.type_, i->second_.register_, &data.m00_, 3);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
@@ -1224,10 +1548,7 @@ void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
     data.y_ = vector.y_;
     data.z_ = vector.z_;
 
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, &data.x_, 1);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, &data.x_, 1);
+    SetShaderConstants(i->second_.type_, i->second_.register_, &data.x_, 1);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
@@ -1236,10 +1557,7 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, matrix.Data(), 4);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, matrix.Data(), 4);
+    SetShaderConstants(i->second_.type_, i->second_.register_, matrix.Data(), 4);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
@@ -1248,10 +1566,7 @@ void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, vector.Data(), 1);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, vector.Data(), 1);
+    SetShaderConstants(i->second_.type_, i->second_.register_, vector.Data(), 1);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
@@ -1260,10 +1575,7 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
     if (!shaderProgram_ || (i = shaderProgram_->parameters_.Find(param)) == shaderProgram_->parameters_.End())
         return;
     
-    if (i->second_.type_ == VS)
-        impl_->device_->SetVertexShaderConstantF(i->second_.register_, matrix.Data(), 3);
-    else
-        impl_->device_->SetPixelShaderConstantF(i->second_.register_, matrix.Data(), 3);
+    SetShaderConstants(i->second_.type_, i->second_.register_, matrix.Data(), 3);
 }
 
 void Graphics::SetShaderParameter(StringHash param, const Variant& value)
@@ -1370,7 +1682,10 @@ void Graphics::SetTexture(unsigned index, Texture* texture)
             impl_->device_->SetTexture(index, 0);
         
         textures_[index] = texture;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
     
     if (texture)
     {
@@ -1627,7 +1942,10 @@ void Graphics::SetBlendMode(BlendMode mode)
         }
         
         blendMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetColorWrite(bool enable)
@@ -1637,7 +1955,10 @@ void Graphics::SetColorWrite(bool enable)
         impl_->device_->SetRenderState(D3DRS_COLORWRITEENABLE, enable ? D3DCOLORWRITEENABLE_RED |
             D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA : 0);
         colorWrite_ = enable;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetCullMode(CullMode mode)
@@ -1646,7 +1967,10 @@ void Graphics::SetCullMode(CullMode mode)
     {
         impl_->device_->SetRenderState(D3DRS_CULLMODE, d3dCullMode[mode]);
         cullMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetDepthBias(float constantBias, float slopeScaledBias)
@@ -1669,7 +1993,10 @@ void Graphics::SetDepthTest(CompareMode mode)
     {
         impl_->device_->SetRenderState(D3DRS_ZFUNC, d3dCmpFunc[mode]);
         depthTestMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetDepthWrite(bool enable)
@@ -1678,7 +2005,10 @@ void Graphics::SetDepthWrite(bool enable)
     {
         impl_->device_->SetRenderState(D3DRS_ZWRITEENABLE, enable ? TRUE : FALSE);
         depthWrite_ = enable;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetFillMode(FillMode mode)
@@ -1687,7 +2017,10 @@ void Graphics::SetFillMode(FillMode mode)
     {
         impl_->device_->SetRenderState(D3DRS_FILLMODE, d3dFillMode[mode]);
         fillMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetScissorTest(bool enable, const Rect& rect, bool borderInclusive)
@@ -2559,6 +2892,12 @@ void Graphics::CheckFeatureSupport()
     if (impl_->deviceCaps_.DevCaps2 & D3DDEVCAPS2_STREAMOFFSET)
         instancingSupport_ = true;
     
+    // Passing a null query only checks for support
+    occlusionQuerySupport_ = SUCCEEDED(impl_->device_->CreateQuery(D3DQUERYTYPE_OCCLUSION, 0));
+    timerQuerySupport_ = SUCCEEDED(impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMP, 0)) &&
+        SUCCEEDED(impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, 0)) &&
+        SUCCEEDED(impl_->device_->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, 0));
+    
     // Check for sRGB read & write
     /// \todo Should be checked for each texture format separately
     sRGBSupport_ = impl_->CheckFormatSupport(D3DFMT_X8R8G8B8, D3DUSAGE_QUERY_SRGBREAD, D3DRTYPE_TEXTURE);
@@ -2596,6 +2935,19 @@ void Graphics::OnDeviceLost()
         impl_->frameQuery_ = 0;
     }
     
+    // Occlusion queries are recreated on their next use, so the handles stay valid
+    for (PODVector<void*>::Iterator i = occlusionQueries_.Begin(); i != occlusionQueries_.End(); ++i)
+    {
+        if (*i)
+        {
+            ((IDirect3DQuery9*)*i)->Release();
+            *i = 0;
+        }
+    }
+    
+    // Timer queries are recreated on demand when the next profiled frame begins
+    ReleaseGPUProfileQueries();
+    
     {
         MutexLock lock(gpuObjectMutex_);
 
@@ -2689,10 +3041,94 @@ void Graphics::ResetCachedState()
     impl_->srcBlend_ = D3DBLEND_ONE;
     impl_->destBlend_ = D3DBLEND_ZERO;
     impl_->blendOp_ = D3DBLENDOP_ADD;
+    memset(impl_->shaderConstantsValid_, 0, sizeof impl_->shaderConstantsValid_);
     
     queryIssued_ = false;
 }
 
+void Graphics::SetShaderConstants(ShaderType type, unsigned reg, const float* data, unsigned count)
+{
+    // Registers beyond the shadowed range are always set
+    if (reg + count <= MAX_SHADER_CONSTANT_REGISTERS)
+    {
+        float* dest = &impl_->shaderConstants_[type][reg * 4];
+        bool* valid = &impl_->shaderConstantsValid_[type][reg];
+        bool changed = false;
+        
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (!valid[i] || memcmp(&dest[i * 4], &data[i * 4], 4 * sizeof(float)))
+            {
+                changed = true;
+                break;
+            }
+        }
+        
+        if (!changed)
+        {
+            ++numAvoidedStateChanges_;
+            return;
+        }
+        
+        memcpy(dest, data, count * 4 * sizeof(float));
+        for (unsigned i = 0; i < count; ++i)
+            valid[i] = true;
+    }
+    
+    if (type == VS)
+        impl_->device_->SetVertexShaderConstantF(reg, data, count);
+    else
+        impl_->device_->SetPixelShaderConstantF(reg, data, count);
+    
+    numParameterBytes_ += count * 4 * sizeof(float);
+    ++numStateChanges_;
+}
+
+bool Graphics::IsShaderReady(ShaderVariation* shader)
+{
+    if (shader->GetGPUObject())
+        return true;
+    // If already attempted and failed, do not retry
+    if (!shader->GetCompilerOutput().Empty())
+        return false;
+    
+    if (shader->CreateAsync())
+        return true;
+    
+    if (!shader->IsCompiling())
+    {
+        LOGERROR("Failed to compile " + String(shader->GetShaderType() == VS ? "vertex" : "pixel") + " shader " +
+            shader->GetFullName() + ":\n" + shader->GetCompilerOutput());
+    }
+    return false;
+}
+
+ShaderVariation* Graphics::GetFallbackShader(ShaderVariation* shader) const
+{
+    if (shaderFallbackDefines_.Empty() || !shader->GetOwner())
+        return 0;
+    
+    // Keep only the defines that are listed for the fallback, comparing without a possible value
+    Vector<String> keepDefines = shaderFallbackDefines_.Split(' ');
+    Vector<String> defines = shader->GetDefines().Split(' ');
+    String fallbackDefines;
+    bool removed = false;
+    for (unsigned i = 0; i < defines.Size(); ++i)
+    {
+        String name = defines[i].Substring(0, defines[i].Find('='));
+        if (keepDefines.Contains(name))
+        {
+            if (!fallbackDefines.Empty())
+                fallbackDefines += ' ';
+            fallbackDefines += defines[i];
+        }
+        else
+            removed = true;
+    }
+    
+    return removed ? shader->GetOwner()->GetVariation(shader->GetShaderType(), fallbackDefines) : 0;
+}
+
 void Graphics::SetTextureUnitMappings()
 {
     textureUnits_["DiffMap"] = TU_DIFFUSE;
@@ -2722,6 +3158,7 @@ void RegisterGraphicsLibrary(Context* context)
     Technique::RegisterObject(context);
     Texture2D::RegisterObject(context);
     Texture3D::RegisterObject(context);
+    Texture2DArray::RegisterObject(context);
     TextureCube::RegisterObject(context);
     Camera::RegisterObject(context);
     Drawable::RegisterObject(context);
@@ -2730,14 +3167,18 @@ void RegisterGraphicsLibrary(Context* context)
     StaticModelGroup::RegisterObject(context);
     Skybox::RegisterObject(context);
     AnimatedModel::RegisterObject(context);
+    AnimatedModelGroup::RegisterObject(context);
     AnimationController::RegisterObject(context);
     BillboardSet::RegisterObject(context);
+    ImpostorSet::RegisterObject(context);
     ParticleEffect::RegisterObject(context);
     ParticleEmitter::RegisterObject(context);
+    GPUParticleEmitter::RegisterObject(context);
     CustomGeometry::RegisterObject(context);
     DecalSet::RegisterObject(context);
     Terrain::RegisterObject(context);
     TerrainPatch::RegisterObject(context);
+    CDLODTerrain::RegisterObject(context);
     DebugRenderer::RegisterObject(context);
     Octree::RegisterObject(context);
     Zone::RegisterObject(context);
@@ -40,6 +40,7 @@ GraphicsImpl::GraphicsImpl() :
     deviceType_(D3DDEVTYPE_HAL)
 {
     memset(&presentParams_, 0, sizeof presentParams_);
+    memset(shaderConstantsValid_, 0, sizeof shaderConstantsValid_);
 }
 
 bool GraphicsImpl::CheckFormatSupport(D3DFORMAT format, DWORD usage, D3DRESOURCETYPE type)
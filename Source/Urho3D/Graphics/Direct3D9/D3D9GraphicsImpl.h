@@ -30,6 +30,9 @@
 namespace Urho3D
 {
 
+/// Number of float constant registers shadowed per shader type.
+static const unsigned MAX_SHADER_CONSTANT_REGISTERS = 256;
+
 /// %Graphics implementation. Holds API-specific objects.
 class URHO3D_API GraphicsImpl
 {
@@ -101,6 +104,10 @@ private:
     D3DBLEND destBlend_;
     /// Blend operation.
     D3DBLENDOP blendOp_;
+    /// Float constant register values last set for vertex and pixel shaders.
+    float shaderConstants_[2][MAX_SHADER_CONSTANT_REGISTERS * 4];
+    /// Float constant register value valid flags for vertex and pixel shaders.
+    bool shaderConstantsValid_[2][MAX_SHADER_CONSTANT_REGISTERS];
 };
 
 }
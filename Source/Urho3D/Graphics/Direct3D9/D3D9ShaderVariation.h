@@ -32,6 +32,7 @@ namespace Urho3D
 {
 
 class Shader;
+struct WorkItem;
 
 /// %Shader parameter definition.
 struct ShaderParameter
@@ -77,6 +78,8 @@ public:
     
     /// Compile the shader. Return true if successful.
     bool Create();
+    /// Compile the shader in a worker thread if no up-to-date bytecode exists. Call again to check for completion. Return true once the shader has been created.
+    bool CreateAsync();
     /// Set name.
     void SetName(const String& name);
     /// Set defines.
@@ -94,6 +97,8 @@ public:
     String GetFullName() const { return name_ + "(" + defines_ + ")"; }
     /// Return compile error/warning string.
     const String& GetCompilerOutput() const { return compilerOutput_; }
+    /// Return whether is being compiled in a worker thread.
+    bool IsCompiling() const { return compileItem_.NotNull(); }
     /// Return whether uses a parameter.
     bool HasParameter(StringHash param) const { return parameters_.Contains(param); }
     /// Return whether uses a texture unit (only for pixel shaders.)
@@ -102,10 +107,18 @@ public:
     const HashMap<StringHash, ShaderParameter>& GetParameters() const { return parameters_; }
     
 private:
+    /// Return the bytecode cache file name.
+    String GetBinaryShaderName() const;
     /// Load bytecode from a file. Return true if successful.
     bool LoadByteCode(PODVector<unsigned>& byteCode, const String& binaryShaderName);
     /// Compile from source. Return true if successful.
     bool Compile(PODVector<unsigned>& byteCode);
+    /// Create the shader from bytecode. Return true if successful.
+    bool CreateFromByteCode(const PODVector<unsigned>& byteCode);
+    /// Wait for an asynchronous compile to finish or cancel it.
+    void WaitForCompile();
+    /// Work function for compiling in a worker thread.
+    static void CompileWork(const WorkItem* item, unsigned threadIndex);
     /// Inspect the constant parameters of the shader bytecode using MojoShader.
     void ParseParameters(unsigned char* bufData, unsigned bufSize);
     /// Strip comments from shader bytecode and store it.
@@ -123,6 +136,10 @@ private:
     String defines_;
     /// Shader compile error string.
     String compilerOutput_;
+    /// Asynchronous compile work item.
+    SharedPtr<WorkItem> compileItem_;
+    /// Bytecode compiled asynchronously.
+    PODVector<unsigned> asyncByteCode_;
     /// Shader parameters.
     HashMap<StringHash, ShaderParameter> parameters_;
     /// Texture unit use flags.
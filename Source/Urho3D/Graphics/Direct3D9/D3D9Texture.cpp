@@ -66,6 +66,7 @@ Texture::Texture(Context* context) :
     height_(0),
     depth_(0),
     filterMode_(FILTER_DEFAULT),
+    streamingMipsToSkip_(0),
     sRGB_(false)
 {
     for (int i = 0; i < MAX_COORDS; ++i)
@@ -30,6 +30,7 @@
 #include "../../Core/Profiler.h"
 #include "../../Resource/ResourceCache.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../Graphics/TextureStreamer.h"
 #include "../../Resource/XMLFile.h"
 
 #include "../../DebugNew.h"
@@ -74,14 +75,28 @@ bool Texture2D::BeginLoad(Deserializer& source)
         return false;
     }
 
-    // Precalculate mip levels if async loading
-    if (GetAsyncLoadState() == ASYNC_LOADING)
-        loadImage_->PrecalculateLevels();
-    
     // Load the optional parameters file
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     String xmlName = ReplaceExtension(GetName(), ".xml");
     loadParameters_ = cache->GetTempResource<XMLFile>(xmlName, false);
+
+    // Compress to DXT if requested by the parameters file. When loading asynchronously this happens in the worker thread
+    if (loadParameters_ && loadParameters_->GetRoot().GetChild("compress").GetBool("enable") && !loadImage_->IsCompressed() &&
+        graphics_->GetFormat(CF_DXT5))
+    {
+        if ((loadImage_->GetWidth() & 3) || (loadImage_->GetHeight() & 3))
+            LOGWARNING("Texture " + GetName() + " size is not a multiple of 4, can not compress");
+        else
+        {
+            SharedPtr<Image> compressedImage = loadImage_->ConvertToDXT();
+            if (compressedImage)
+                loadImage_ = compressedImage;
+        }
+    }
+
+    // Precalculate mip levels if async loading
+    if (GetAsyncLoadState() == ASYNC_LOADING)
+        loadImage_->PrecalculateLevels();
     
     return true;
 }
@@ -96,6 +111,13 @@ bool Texture2D::EndLoad()
     CheckTextureBudget(GetTypeStatic());
 
     SetParameters(loadParameters_);
+    
+    // Let the texture streamer choose the initially loaded mip level
+    Renderer* renderer = GetSubsystem<Renderer>();
+    TextureStreamer* streamer = renderer ? renderer->GetTextureStreamer() : 0;
+    if (streamer)
+        streamer->AddTexture(this, loadImage_);
+    
     bool success = SetData(loadImage_);
     
     loadImage_.Reset();
@@ -393,7 +415,7 @@ bool Texture2D::SetData(SharedPtr<Image> image, bool useAlpha)
             needDecompress = true;
         }
         
-        unsigned mipsToSkip = mipsToSkip_[quality];
+        unsigned mipsToSkip = mipsToSkip_[quality] + streamingMipsToSkip_;
         if (mipsToSkip >= levels)
             mipsToSkip = levels - 1;
         while (mipsToSkip && (width / (1 << mipsToSkip) < 4 || height / (1 << mipsToSkip) < 4))
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../../Core/Context.h"
+#include "../../Graphics/Graphics.h"
+#include "../../IO/Log.h"
+#include "../../Graphics/Texture2DArray.h"
+
+#include "../../DebugNew.h"
+
+namespace Urho3D
+{
+
+Texture2DArray::Texture2DArray(Context* context) :
+    Texture(context),
+    layers_(0)
+{
+}
+
+Texture2DArray::~Texture2DArray()
+{
+    Release();
+}
+
+void Texture2DArray::RegisterObject(Context* context)
+{
+    context->RegisterFactory<Texture2DArray>();
+}
+
+bool Texture2DArray::BeginLoad(Deserializer& source)
+{
+    // In headless mode, do not actually load the texture, just return success
+    if (!graphics_)
+        return true;
+    
+    LOGERROR("Failed to load texture array " + GetName() + ", unsupported on Direct3D9");
+    return false;
+}
+
+bool Texture2DArray::EndLoad()
+{
+    return true;
+}
+
+void Texture2DArray::Release()
+{
+}
+
+void Texture2DArray::SetLayers(unsigned layers)
+{
+    layers_ = layers;
+}
+
+bool Texture2DArray::SetSize(unsigned layers, int width, int height, unsigned format, TextureUsage usage)
+{
+    layers_ = layers;
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    usage_ = usage;
+    
+    return Create();
+}
+
+bool Texture2DArray::SetData(unsigned layer, unsigned level, int x, int y, int width, int height, const void* data)
+{
+    LOGERROR("No texture created, can not set data");
+    return false;
+}
+
+bool Texture2DArray::SetData(unsigned layer, SharedPtr<Image> image, bool useAlpha)
+{
+    LOGERROR("No texture created, can not set data");
+    return false;
+}
+
+bool Texture2DArray::Create()
+{
+    LOGERROR("Failed to create texture array, unsupported on Direct3D9");
+    return false;
+}
+
+}
@@ -47,6 +47,23 @@ const unsigned VertexBuffer::elementSize[] =
     4 * sizeof(float) // Instancematrix3
 };
 
+const unsigned VertexBuffer::packedElementSize[] =
+{
+    3 * sizeof(float), // Position
+    4 * sizeof(short), // Normal
+    4 * sizeof(unsigned char), // Color
+    2 * sizeof(short), // Texcoord1
+    2 * sizeof(short), // Texcoord2
+    3 * sizeof(float), // Cubetexcoord1
+    3 * sizeof(float), // Cubetexcoord2
+    4 * sizeof(short), // Tangent
+    4 * sizeof(unsigned char), // Blendweights
+    4 * sizeof(unsigned char), // Blendindices
+    4 * sizeof(float), // Instancematrix1
+    4 * sizeof(float), // Instancematrix2
+    4 * sizeof(float) // Instancematrix3
+};
+
 VertexBuffer::VertexBuffer(Context* context) :
     Object(context),
     GPUObject(GetSubsystem<Graphics>()),
@@ -327,7 +344,7 @@ void VertexBuffer::UpdateOffsets()
         if (elementMask_ & (1 << i))
         {
             elementOffset_[i] = elementOffset;
-            elementOffset += elementSize[i];
+            elementOffset += GetElementSize(elementMask_, (VertexElement)i);
         }
         else
             elementOffset_[i] = NO_ELEMENT;
@@ -345,7 +362,8 @@ unsigned long long VertexBuffer::GetBufferHash(unsigned streamIndex, unsigned us
         maskHash = ((unsigned long long)useMask) * 0x100000000ULL;
     
     bufferHash |= maskHash;
-    bufferHash <<= streamIndex * MAX_VERTEX_ELEMENTS;
+    // Reserve 16 bits per stream so that the packed format bits above the elements are included
+    bufferHash <<= streamIndex * 16;
     
     return bufferHash;
 }
@@ -357,7 +375,7 @@ unsigned VertexBuffer::GetVertexSize(unsigned elementMask)
     for (unsigned i = 0; i < MAX_VERTEX_ELEMENTS; ++i)
     {
         if (elementMask & (1 << i))
-            vertexSize += elementSize[i];
+            vertexSize += GetElementSize(elementMask, (VertexElement)i);
     }
     
     return vertexSize;
@@ -373,12 +391,37 @@ unsigned VertexBuffer::GetElementOffset(unsigned elementMask, VertexElement elem
             break;
         
         if (elementMask & (1 << i))
-            offset += elementSize[i];
+            offset += GetElementSize(elementMask, (VertexElement)i);
     }
     
     return offset;
 }
 
+unsigned VertexBuffer::GetElementSize(unsigned elementMask, VertexElement element)
+{
+    return IsElementPacked(elementMask, element) ? packedElementSize[element] : elementSize[element];
+}
+
+bool VertexBuffer::IsElementPacked(unsigned elementMask, VertexElement element)
+{
+    switch (element)
+    {
+    case ELEMENT_NORMAL:
+    case ELEMENT_TANGENT:
+        return (elementMask & MASK_PACKEDNORMALS) != 0;
+        
+    case ELEMENT_TEXCOORD1:
+    case ELEMENT_TEXCOORD2:
+        return (elementMask & MASK_PACKEDTEXCOORDS) != 0;
+        
+    case ELEMENT_BLENDWEIGHTS:
+        return (elementMask & MASK_PACKEDBLENDWEIGHTS) != 0;
+        
+    default:
+        return false;
+    }
+}
+
 bool VertexBuffer::Create()
 {
     Release();
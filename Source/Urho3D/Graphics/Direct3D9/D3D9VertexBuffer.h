@@ -85,9 +85,15 @@ public:
     static unsigned GetVertexSize(unsigned elementMask);
     /// Return element offset from an element mask.
     static unsigned GetElementOffset(unsigned elementMask, VertexElement element);
+    /// Return element size in bytes from an element mask, taking packed formats into account.
+    static unsigned GetElementSize(unsigned elementMask, VertexElement element);
+    /// Return whether an element is stored in a packed format according to an element mask.
+    static bool IsElementPacked(unsigned elementMask, VertexElement element);
     
     /// Vertex element sizes.
     static const unsigned elementSize[];
+    /// Packed vertex element sizes.
+    static const unsigned packedElementSize[];
     
 private:
     /// Update offsets of vertex elements.
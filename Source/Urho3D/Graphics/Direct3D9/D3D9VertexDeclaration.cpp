@@ -47,6 +47,23 @@ const BYTE d3dElementType[] =
     D3DDECLTYPE_FLOAT4 // Instancematrix3
 };
 
+const BYTE d3dPackedElementType[] =
+{
+    D3DDECLTYPE_FLOAT3, // Position
+    D3DDECLTYPE_SHORT4N, // Normal
+    D3DDECLTYPE_UBYTE4N, // Color
+    D3DDECLTYPE_FLOAT16_2, // Texcoord1
+    D3DDECLTYPE_FLOAT16_2, // Texcoord2
+    D3DDECLTYPE_FLOAT3, // Cubetexcoord1
+    D3DDECLTYPE_FLOAT3, // Cubetexcoord2
+    D3DDECLTYPE_SHORT4N, // Tangent
+    D3DDECLTYPE_UBYTE4N, // Blendweights
+    D3DDECLTYPE_UBYTE4, // Blendindices
+    D3DDECLTYPE_FLOAT4, // Instancematrix1
+    D3DDECLTYPE_FLOAT4, // Instancematrix2
+    D3DDECLTYPE_FLOAT4 // Instancematrix3
+};
+
 const BYTE d3dElementUsage[] =
 {
     D3DDECLUSAGE_POSITION, // Position
@@ -97,7 +114,8 @@ VertexDeclaration::VertexDeclaration(Graphics* graphics, unsigned elementMask) :
             newElement.stream_ = 0;
             newElement.element_ = element;
             newElement.offset_ = offset;
-            offset += VertexBuffer::elementSize[i];
+            newElement.packed_ = VertexBuffer::IsElementPacked(elementMask, element);
+            offset += VertexBuffer::GetElementSize(elementMask, element);
             
             elements.Push(newElement);
         }
@@ -136,6 +154,7 @@ VertexDeclaration::VertexDeclaration(Graphics* graphics, const PODVector<VertexB
                     newElement.stream_ = i;
                     newElement.element_ = element;
                     newElement.offset_ = buffers[i]->GetElementOffset(element);
+                    newElement.packed_ = VertexBuffer::IsElementPacked(buffers[i]->GetElementMask(), element);
                     usedElementMask |= 1 << j;
                     
                     elements.Push(newElement);
@@ -177,6 +196,7 @@ VertexDeclaration::VertexDeclaration(Graphics* graphics, const Vector<SharedPtr<
                     newElement.stream_ = i;
                     newElement.element_ = element;
                     newElement.offset_ = buffers[i]->GetElementOffset(element);
+                    newElement.packed_ = VertexBuffer::IsElementPacked(buffers[i]->GetElementMask(), element);
                     usedElementMask |= 1 << j;
                     
                     elements.Push(newElement);
@@ -202,7 +222,7 @@ void VertexDeclaration::Create(Graphics* graphics, const PODVector<VertexDeclara
     {
         dest->Stream = i->stream_;
         dest->Offset = i->offset_;
-        dest->Type = d3dElementType[i->element_];
+        dest->Type = i->packed_ ? d3dPackedElementType[i->element_] : d3dElementType[i->element_];
         dest->Method = D3DDECLMETHOD_DEFAULT;
         dest->Usage = d3dElementUsage[i->element_];
         dest->UsageIndex = d3dElementUsageIndex[i->element_];
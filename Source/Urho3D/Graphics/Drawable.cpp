@@ -44,6 +44,7 @@ SourceBatch::SourceBatch() :
     geometry_(0),
     worldTransform_(&Matrix3x4::IDENTITY),
     numWorldTransforms_(1),
+    numInstances_(0),
     geometryType_(GEOM_STATIC)
 {
 }
@@ -59,6 +60,7 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     castShadows_(false),
     occluder_(false),
     occludee_(true),
+    occlusionQuery_(false),
     updateQueued_(false),
     zoneDirty_(false),
     octant_(0),
@@ -68,6 +70,7 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     shadowMask_(DEFAULT_SHADOWMASK),
     zoneMask_(DEFAULT_ZONEMASK),
     viewFrameNumber_(0),
+    updateFrameNumber_(0),
     distance_(0.0f),
     lodDistance_(0.0f),
     drawDistance_(0.0f),
@@ -243,6 +246,12 @@ void Drawable::SetOccludee(bool enable)
     }
 }
 
+void Drawable::SetOcclusionQuery(bool enable)
+{
+    occlusionQuery_ = enable;
+    MarkNetworkUpdate();
+}
+
 void Drawable::MarkForUpdate()
 {
     if (!updateQueued_ && octant_)
@@ -389,7 +398,10 @@ void Drawable::AddToOctree()
     {
         Octree* octree = scene->GetComponent<Octree>();
         if (octree)
+        {
             octree->InsertDrawable(this);
+            octree->AddChangedBox(GetWorldBoundingBox());
+        }
         else
             LOGERROR("No Octree component in scene, drawable will not render");
     }
@@ -408,6 +420,9 @@ void Drawable::RemoveFromOctree()
         if (updateQueued_)
             octree->CancelUpdate(this);
         
+        // Record the region the drawable was last seen in as changed
+        octree->AddChangedBox(worldBoundingBox_);
+        
         // Perform subclass specific deinitialization if necessary
         OnRemoveFromOctree();
         
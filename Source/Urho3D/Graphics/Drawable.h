@@ -71,6 +71,8 @@ struct FrameInfo
     IntVector2 viewSize_;
     /// Camera being used.
     Camera* camera_;
+    /// Occlusion buffer of the view, or null if not used. Only set during the view's visibility check.
+    OcclusionBuffer* occlusionBuffer_;
 };
 
 /// Source data for a 3D geometry draw call.
@@ -91,6 +93,8 @@ struct SourceBatch
     const Matrix3x4* worldTransform_;
     /// Number of world transforms.
     unsigned numWorldTransforms_;
+    /// Number of hardware instances to draw for an instanced billboard geometry.
+    unsigned numInstances_;
     /// %Geometry type.
     GeometryType geometryType_;
 };
@@ -118,12 +122,16 @@ public:
     virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results);
     /// Update before octree reinsertion. Is called from a worker thread.
     virtual void Update(const FrameInfo& frame);
+    /// Return the relative cost of Update(), used to split the threaded drawable updates into balanced work items.
+    virtual unsigned GetUpdateCost() const { return 1; }
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     virtual void UpdateBatches(const FrameInfo& frame);
     /// Prepare geometry for rendering.
     virtual void UpdateGeometry(const FrameInfo& frame);
     /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
     virtual UpdateGeometryType GetUpdateGeometryType() { return UPDATE_NONE; }
+    /// Return draw call source data for the view that last updated the batches. Shadow batches always use GetBatches(). Called from the main thread.
+    virtual const Vector<SourceBatch>& GetViewBatches() { return batches_; }
     /// Return the geometry for a specific LOD level.
     virtual Geometry* GetLodGeometry(unsigned batchIndex, unsigned level);
     /// Return number of occlusion geometry triangles.
@@ -155,6 +163,8 @@ public:
     void SetOccluder(bool enable);
     /// Set occludee flag.
     void SetOccludee(bool enable);
+    /// Set whether to test visibility with hardware occlusion queries when enabled in the renderer. Useful for expensive drawables that are not hidden by the software occluders.
+    void SetOcclusionQuery(bool enable);
     /// Mark for update and octree reinsertion. Update is automatically queued when the drawable's scene node moves or changes scale.
     void MarkForUpdate();
     
@@ -186,6 +196,8 @@ public:
     bool IsOccluder() const { return occluder_; }
     /// Return occludee flag.
     bool IsOccludee() const { return occludee_; }
+    /// Return hardware occlusion query flag.
+    bool GetOcclusionQuery() const { return occlusionQuery_; }
     /// Return whether is in view this frame from any viewport camera. Excludes shadow map cameras.
     bool IsInView() const;
     /// Return whether is in view of a specific camera this frame. Pass in a null camera to allow any camera, including shadow map cameras.
@@ -215,6 +227,8 @@ public:
     Zone* GetZone() const { return zone_; }
     /// Return whether current zone is inconclusive or dirty due to the drawable moving.
     bool IsZoneDirty() const { return zoneDirty_; }
+    /// Return frame number on which the drawable was last updated in the octree due to moving, resizing or animation.
+    unsigned GetUpdateFrameNumber() const { return updateFrameNumber_; }
     /// Return distance from camera.
     float GetDistance() const { return distance_; }
     /// Return LOD scaled distance from camera.
@@ -286,6 +300,8 @@ protected:
     bool occluder_;
     /// Occludee flag.
     bool occludee_;
+    /// Hardware occlusion query flag.
+    bool occlusionQuery_;
     /// Octree update queued flag.
     bool updateQueued_;
     /// Zone inconclusive or dirtied flag.
@@ -304,6 +320,8 @@ protected:
     unsigned zoneMask_;
     /// Last visible frame number.
     unsigned viewFrameNumber_;
+    /// Last octree update frame number.
+    unsigned updateFrameNumber_;
     /// Current distance to camera.
     float distance_;
     /// LOD scaled distance.
@@ -47,4 +47,11 @@ EVENT(E_TERRAINCREATED, TerrainCreated)
     PARAM(P_NODE, Node);                    // Node pointer
 }
 
+/// Terrain heights changed within a region without recreating the geometry.
+EVENT(E_TERRAINHEIGHTCHANGED, TerrainHeightChanged)
+{
+    PARAM(P_NODE, Node);                    // Node pointer
+    PARAM(P_REGION, Region);                // IntRect, heightmap pixel coordinates (inclusive)
+}
+
 }
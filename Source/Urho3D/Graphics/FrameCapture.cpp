@@ -0,0 +1,467 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Graphics/Camera.h"
+#include "../Core/Context.h"
+#include "../IO/Deserializer.h"
+#include "../Graphics/FrameCapture.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../Graphics/Light.h"
+#include "../IO/Log.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
+#include "../Scene/Node.h"
+#include "../Graphics/Octree.h"
+#include "../Core/Profiler.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Scene.h"
+#include "../IO/Serializer.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../Graphics/View.h"
+#include "../Graphics/Zone.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Geometry table entry kinds.
+enum CapturedGeometryKind
+{
+    CGK_UNAVAILABLE = 0,
+    CGK_MODEL,
+    CGK_RAW
+};
+
+static void WriteNodeTransform(Node* node, Serializer& dest)
+{
+    dest.WriteVector3(node->GetWorldPosition());
+    dest.WriteQuaternion(node->GetWorldRotation());
+    dest.WriteVector3(node->GetWorldScale());
+}
+
+static void ReadNodeTransform(Node* node, Deserializer& source)
+{
+    Vector3 position = source.ReadVector3();
+    Quaternion rotation = source.ReadQuaternion();
+    Vector3 scale = source.ReadVector3();
+    node->SetTransform(position, rotation, scale);
+}
+
+CapturedDrawable::CapturedDrawable(Context* context) :
+    Drawable(context, DRAWABLE_GEOMETRY)
+{
+}
+
+CapturedDrawable::~CapturedDrawable()
+{
+}
+
+void CapturedDrawable::UpdateBatches(const FrameInfo& frame)
+{
+    distance_ = frame.camera_->GetDistance(capturedBoundingBox_.Center());
+
+    for (unsigned i = 0; i < batches_.Size(); ++i)
+        batches_[i].distance_ = distance_;
+}
+
+void CapturedDrawable::OnWorldBoundingBoxUpdate()
+{
+    worldBoundingBox_ = capturedBoundingBox_;
+}
+
+FrameCapture::FrameCapture(Context* context) :
+    Object(context),
+    numDrawables_(0),
+    numBatches_(0),
+    numSkippedBatches_(0)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+}
+
+bool FrameCapture::Save(View* view, Serializer& dest)
+{
+    PROFILE(SaveFrameCapture);
+
+    Camera* camera = view ? view->GetCamera() : 0;
+    if (!camera || !camera->GetNode())
+    {
+        LOGERROR("Null view or camera for frame capture");
+        return false;
+    }
+
+    const PODVector<Drawable*>& drawables = view->GetGeometries();
+    const PODVector<Light*>& lights = view->GetLights();
+
+    // Collect the zones and the geometries used by the visible drawables
+    PODVector<Zone*> zones;
+    if (view->GetCameraZone())
+        zones.Push(view->GetCameraZone());
+    HashMap<Geometry*, unsigned> geometryIndices;
+    PODVector<Geometry*> geometries;
+    for (unsigned i = 0; i < drawables.Size(); ++i)
+    {
+        Zone* zone = drawables[i]->GetZone();
+        if (zone && !zones.Contains(zone))
+            zones.Push(zone);
+
+        const Vector<SourceBatch>& batches = drawables[i]->GetBatches();
+        for (unsigned j = 0; j < batches.Size(); ++j)
+        {
+            Geometry* geometry = batches[j].geometry_;
+            if (geometry && !geometryIndices.Contains(geometry))
+            {
+                geometryIndices[geometry] = geometries.Size();
+                geometries.Push(geometry);
+            }
+        }
+    }
+
+    // Geometries that belong to a model resource are saved as references to it
+    modelGeometries_.Clear();
+    PODVector<Model*> models;
+    GetSubsystem<ResourceCache>()->GetResources<Model>(models);
+    for (unsigned i = 0; i < models.Size(); ++i)
+    {
+        const Vector<Vector<SharedPtr<Geometry> > >& modelGeometries = models[i]->GetGeometries();
+        for (unsigned j = 0; j < modelGeometries.Size(); ++j)
+        {
+            for (unsigned k = 0; k < modelGeometries[j].Size(); ++k)
+            {
+                ModelGeometryRef& ref = modelGeometries_[modelGeometries[j][k].Get()];
+                ref.modelName_ = models[i]->GetName();
+                ref.index_ = j;
+                ref.lodLevel_ = k;
+            }
+        }
+    }
+
+    dest.WriteFileID("UFCP");
+    dest.WriteUInt(FRAMECAPTURE_VERSION);
+    dest.WriteIntVector2(view->GetFrameInfo().viewSize_);
+
+    WriteNodeTransform(camera->GetNode(), dest);
+    camera->Serializable::Save(dest);
+
+    dest.WriteVLE(zones.Size());
+    for (unsigned i = 0; i < zones.Size(); ++i)
+    {
+        WriteNodeTransform(zones[i]->GetNode(), dest);
+        zones[i]->Serializable::Save(dest);
+    }
+
+    dest.WriteVLE(lights.Size());
+    for (unsigned i = 0; i < lights.Size(); ++i)
+    {
+        WriteNodeTransform(lights[i]->GetNode(), dest);
+        lights[i]->Serializable::Save(dest);
+    }
+
+    PODVector<bool> geometryAvailable(geometries.Size());
+    dest.WriteVLE(geometries.Size());
+    for (unsigned i = 0; i < geometries.Size(); ++i)
+        geometryAvailable[i] = WriteGeometry(geometries[i], dest);
+
+    numDrawables_ = drawables.Size();
+    numBatches_ = 0;
+    numSkippedBatches_ = 0;
+    dest.WriteVLE(drawables.Size());
+    for (unsigned i = 0; i < drawables.Size(); ++i)
+    {
+        Drawable* drawable = drawables[i];
+        const Vector<SourceBatch>& batches = drawable->GetBatches();
+
+        dest.WriteBoundingBox(drawable->GetWorldBoundingBox());
+        dest.WriteBool(drawable->GetCastShadows());
+        dest.WriteUInt(drawable->GetViewMask());
+        dest.WriteUInt(drawable->GetLightMask());
+        dest.WriteUInt(drawable->GetShadowMask());
+        dest.WriteUInt(drawable->GetZoneMask());
+
+        dest.WriteVLE(batches.Size());
+        for (unsigned j = 0; j < batches.Size(); ++j)
+        {
+            const SourceBatch& batch = batches[j];
+            if (!batch.geometry_ || !geometryAvailable[geometryIndices[batch.geometry_]])
+                ++numSkippedBatches_;
+            // Index 0 is reserved for batches without geometry
+            dest.WriteVLE(batch.geometry_ ? geometryIndices[batch.geometry_] + 1 : 0);
+            dest.WriteString(batch.material_ ? batch.material_->GetName() : String::EMPTY);
+            dest.WriteUByte(batch.geometryType_);
+            dest.WriteVLE(batch.numInstances_);
+
+            unsigned numWorldTransforms = batch.worldTransform_ ? batch.numWorldTransforms_ : 0;
+            dest.WriteVLE(numWorldTransforms);
+            for (unsigned k = 0; k < numWorldTransforms; ++k)
+                dest.WriteMatrix3x4(batch.worldTransform_[k]);
+        }
+        numBatches_ += batches.Size();
+    }
+
+    modelGeometries_.Clear();
+    return true;
+}
+
+bool FrameCapture::Load(Deserializer& source)
+{
+    PROFILE(LoadFrameCapture);
+
+    if (source.ReadFileID() != "UFCP")
+    {
+        LOGERROR(source.GetName() + " is not a valid frame capture file");
+        return false;
+    }
+    unsigned version = source.ReadUInt();
+    if (version != FRAMECAPTURE_VERSION)
+    {
+        LOGERROR("Unsupported frame capture version " + String(version) + " in " + source.GetName());
+        return false;
+    }
+
+    geometries_.Clear();
+    numDrawables_ = 0;
+    numBatches_ = 0;
+    numSkippedBatches_ = 0;
+
+    // The replay scene only renders, so its logic update is disabled
+    scene_ = new Scene(context_);
+    scene_->SetUpdateEnabled(false);
+    Octree* octree = scene_->CreateComponent<Octree>(LOCAL);
+
+    viewSize_ = source.ReadIntVector2();
+
+    Node* cameraNode = scene_->CreateChild("Camera", LOCAL);
+    ReadNodeTransform(cameraNode, source);
+    camera_ = cameraNode->CreateComponent<Camera>(LOCAL);
+    if (!camera_->Serializable::Load(source))
+        return false;
+    BoundingBox sceneBox(cameraNode->GetWorldPosition(), cameraNode->GetWorldPosition());
+
+    unsigned numZones = source.ReadVLE();
+    for (unsigned i = 0; i < numZones; ++i)
+    {
+        Node* zoneNode = scene_->CreateChild("Zone", LOCAL);
+        ReadNodeTransform(zoneNode, source);
+        if (!zoneNode->CreateComponent<Zone>(LOCAL)->Serializable::Load(source))
+            return false;
+    }
+
+    unsigned numLights = source.ReadVLE();
+    for (unsigned i = 0; i < numLights; ++i)
+    {
+        Node* lightNode = scene_->CreateChild("Light", LOCAL);
+        ReadNodeTransform(lightNode, source);
+        if (!lightNode->CreateComponent<Light>(LOCAL)->Serializable::Load(source))
+            return false;
+    }
+
+    unsigned numGeometries = source.ReadVLE();
+    PODVector<Geometry*> geometries(numGeometries);
+    for (unsigned i = 0; i < numGeometries; ++i)
+        geometries[i] = ReadGeometry(source);
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    numDrawables_ = source.ReadVLE();
+    for (unsigned i = 0; i < numDrawables_; ++i)
+    {
+        // The captured drawables use world space transforms, so their nodes stay at the origin
+        Node* node = scene_->CreateChild(String::EMPTY, LOCAL);
+        SharedPtr<CapturedDrawable> drawable(new CapturedDrawable(context_));
+
+        drawable->capturedBoundingBox_ = source.ReadBoundingBox();
+        drawable->SetCastShadows(source.ReadBool());
+        drawable->SetViewMask(source.ReadUInt());
+        drawable->SetLightMask(source.ReadUInt());
+        drawable->SetShadowMask(source.ReadUInt());
+        drawable->SetZoneMask(source.ReadUInt());
+        sceneBox.Merge(drawable->capturedBoundingBox_);
+
+        unsigned numBatches = source.ReadVLE();
+        PODVector<unsigned> transformOffsets;
+        for (unsigned j = 0; j < numBatches; ++j)
+        {
+            unsigned geometryIndex = source.ReadVLE();
+            String materialName = source.ReadString();
+            GeometryType geometryType = (GeometryType)source.ReadUByte();
+            unsigned numInstances = source.ReadVLE();
+            unsigned numWorldTransforms = source.ReadVLE();
+            unsigned transformOffset = drawable->worldTransforms_.Size();
+            for (unsigned k = 0; k < numWorldTransforms; ++k)
+                drawable->worldTransforms_.Push(source.ReadMatrix3x4());
+
+            Geometry* geometry = geometryIndex && geometryIndex <= numGeometries ? geometries[geometryIndex - 1] : 0;
+            if (!geometry || !numWorldTransforms)
+            {
+                ++numSkippedBatches_;
+                continue;
+            }
+
+            SourceBatch batch;
+            batch.geometry_ = geometry;
+            batch.material_ = materialName.Empty() ? (Material*)0 : cache->GetResource<Material>(materialName);
+            batch.geometryType_ = geometryType;
+            batch.numInstances_ = numInstances;
+            batch.numWorldTransforms_ = numWorldTransforms;
+            drawable->batches_.Push(batch);
+            transformOffsets.Push(transformOffset);
+            ++numBatches_;
+        }
+
+        // Point the batches to the transforms only once all have been read, as the transform vector may have been reallocated
+        for (unsigned j = 0; j < drawable->batches_.Size(); ++j)
+            drawable->batches_[j].worldTransform_ = &drawable->worldTransforms_[transformOffsets[j]];
+
+        node->AddComponent(drawable, 0, LOCAL);
+    }
+
+    // Size the octree to the captured frame
+    octree->SetSize(sceneBox, octree->GetNumLevels());
+
+    if (numSkippedBatches_)
+        LOGWARNINGF("Frame capture %s: %u batches without geometry data were skipped", source.GetName().CString(),
+            numSkippedBatches_);
+    return true;
+}
+
+bool FrameCapture::WriteGeometry(Geometry* geometry, Serializer& dest)
+{
+    HashMap<Geometry*, ModelGeometryRef>::ConstIterator i = modelGeometries_.Find(geometry);
+    if (i != modelGeometries_.End())
+    {
+        dest.WriteUByte(CGK_MODEL);
+        dest.WriteString(i->second_.modelName_);
+        dest.WriteVLE(i->second_.index_);
+        dest.WriteVLE(i->second_.lodLevel_);
+        return true;
+    }
+
+    // Other geometries can only be saved if their buffers have CPU-side shadow copies of the data
+    bool available = geometry->GetNumVertexBuffers() > 0;
+    for (unsigned j = 0; j < geometry->GetNumVertexBuffers(); ++j)
+    {
+        VertexBuffer* buffer = geometry->GetVertexBuffer(j);
+        if (!buffer || !buffer->GetShadowData())
+            available = false;
+    }
+    IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+    if (indexBuffer && !indexBuffer->GetShadowData())
+        available = false;
+
+    if (!available)
+    {
+        dest.WriteUByte(CGK_UNAVAILABLE);
+        return false;
+    }
+
+    dest.WriteUByte(CGK_RAW);
+    dest.WriteVLE(geometry->GetNumVertexBuffers());
+    for (unsigned j = 0; j < geometry->GetNumVertexBuffers(); ++j)
+    {
+        VertexBuffer* buffer = geometry->GetVertexBuffer(j);
+        dest.WriteUInt(buffer->GetVertexCount());
+        dest.WriteUInt(buffer->GetElementMask());
+        dest.WriteUInt(geometry->GetVertexElementMask(j));
+        dest.Write(buffer->GetShadowData(), buffer->GetVertexCount() * buffer->GetVertexSize());
+    }
+
+    dest.WriteBool(indexBuffer != 0);
+    if (indexBuffer)
+    {
+        dest.WriteUInt(indexBuffer->GetIndexCount());
+        dest.WriteBool(indexBuffer->GetIndexSize() == sizeof(unsigned));
+        dest.Write(indexBuffer->GetShadowData(), indexBuffer->GetIndexCount() * indexBuffer->GetIndexSize());
+    }
+
+    dest.WriteUByte(geometry->GetPrimitiveType());
+    dest.WriteUInt(geometry->GetIndexStart());
+    dest.WriteUInt(geometry->GetIndexCount());
+    dest.WriteUInt(geometry->GetVertexStart());
+    dest.WriteUInt(geometry->GetVertexCount());
+    return true;
+}
+
+Geometry* FrameCapture::ReadGeometry(Deserializer& source)
+{
+    unsigned char kind = source.ReadUByte();
+
+    if (kind == CGK_MODEL)
+    {
+        String modelName = source.ReadString();
+        unsigned index = source.ReadVLE();
+        unsigned lodLevel = source.ReadVLE();
+        Model* model = GetSubsystem<ResourceCache>()->GetResource<Model>(modelName);
+        return model ? model->GetGeometry(index, lodLevel) : 0;
+    }
+    else if (kind == CGK_RAW)
+    {
+        SharedPtr<Geometry> geometry(new Geometry(context_));
+        unsigned numVertexBuffers = source.ReadVLE();
+        geometry->SetNumVertexBuffers(numVertexBuffers);
+        for (unsigned j = 0; j < numVertexBuffers; ++j)
+        {
+            unsigned vertexCount = source.ReadUInt();
+            unsigned elementMask = source.ReadUInt();
+            unsigned geometryElementMask = source.ReadUInt();
+            SharedArrayPtr<unsigned char> data(new unsigned char[vertexCount * VertexBuffer::GetVertexSize(elementMask)]);
+            source.Read(data.Get(), vertexCount * VertexBuffer::GetVertexSize(elementMask));
+
+            SharedPtr<VertexBuffer> buffer(new VertexBuffer(context_));
+            buffer->SetShadowed(true);
+            buffer->SetSize(vertexCount, elementMask);
+            buffer->SetData(data.Get());
+            geometry->SetVertexBuffer(j, buffer, geometryElementMask);
+        }
+
+        if (source.ReadBool())
+        {
+            unsigned indexCount = source.ReadUInt();
+            bool largeIndices = source.ReadBool();
+            unsigned indexSize = largeIndices ? sizeof(unsigned) : sizeof(unsigned short);
+            SharedArrayPtr<unsigned char> data(new unsigned char[indexCount * indexSize]);
+            source.Read(data.Get(), indexCount * indexSize);
+
+            SharedPtr<IndexBuffer> buffer(new IndexBuffer(context_));
+            buffer->SetShadowed(true);
+            buffer->SetSize(indexCount, largeIndices);
+            buffer->SetData(data.Get());
+            geometry->SetIndexBuffer(buffer);
+        }
+
+        PrimitiveType type = (PrimitiveType)source.ReadUByte();
+        unsigned indexStart = source.ReadUInt();
+        unsigned indexCount = source.ReadUInt();
+        unsigned vertexStart = source.ReadUInt();
+        unsigned vertexCount = source.ReadUInt();
+        geometry->SetDrawRange(type, indexStart, indexCount, vertexStart, vertexCount, false);
+
+        geometries_.Push(geometry);
+        return geometry;
+    }
+    else
+        return 0;
+}
+
+}
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Graphics/Drawable.h"
+#include "../Math/Matrix3x4.h"
+
+namespace Urho3D
+{
+
+class Camera;
+class Deserializer;
+class Scene;
+class Serializer;
+class View;
+
+/// %Frame capture file format version.
+static const unsigned FRAMECAPTURE_VERSION = 1;
+
+/// Reference to a geometry of a model resource.
+struct ModelGeometryRef
+{
+    /// Model resource name.
+    String modelName_;
+    /// Geometry index.
+    unsigned index_;
+    /// LOD level.
+    unsigned lodLevel_;
+};
+
+/// Drawable that replays the captured batches of a drawable. Used in the replay scene of a frame capture.
+class URHO3D_API CapturedDrawable : public Drawable
+{
+    OBJECT(CapturedDrawable);
+
+    friend class FrameCapture;
+
+public:
+    /// Construct.
+    CapturedDrawable(Context* context);
+    /// Destruct.
+    virtual ~CapturedDrawable();
+
+    /// Calculate distance for rendering. The batches keep their captured world transforms.
+    virtual void UpdateBatches(const FrameInfo& frame);
+
+protected:
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate();
+
+private:
+    /// Captured world-space bounding box.
+    BoundingBox capturedBoundingBox_;
+    /// Captured world transforms of all batches.
+    PODVector<Matrix3x4> worldTransforms_;
+};
+
+/// Records the camera, zones, lights and visible batches of a rendered view into a stream and recreates them as a replay scene, which renders the same frame without the original scene logic.
+class URHO3D_API FrameCapture : public Object
+{
+    OBJECT(FrameCapture);
+
+public:
+    /// Construct.
+    FrameCapture(Context* context);
+    /// Destruct.
+    virtual ~FrameCapture();
+
+    /// Save a view that has just been rendered. Return true if successful.
+    bool Save(View* view, Serializer& dest);
+    /// Load a capture and create the replay scene. Return true if successful.
+    bool Load(Deserializer& source);
+
+    /// Return the replay scene.
+    Scene* GetScene() const { return scene_; }
+    /// Return the replay camera.
+    Camera* GetCamera() const { return camera_; }
+    /// Return the view size of the captured frame.
+    const IntVector2& GetViewSize() const { return viewSize_; }
+    /// Return number of captured drawables.
+    unsigned GetNumDrawables() const { return numDrawables_; }
+    /// Return number of captured batches.
+    unsigned GetNumBatches() const { return numBatches_; }
+    /// Return number of batches that could not be captured or replayed, because their geometry data was not available.
+    unsigned GetNumSkippedBatches() const { return numSkippedBatches_; }
+
+private:
+    /// Write a geometry table entry. Return true if the geometry data was available.
+    bool WriteGeometry(Geometry* geometry, Serializer& dest);
+    /// Read a geometry table entry. Return null if the geometry is not available.
+    Geometry* ReadGeometry(Deserializer& source);
+
+    /// Replay scene.
+    SharedPtr<Scene> scene_;
+    /// Replay camera.
+    WeakPtr<Camera> camera_;
+    /// Geometries created from raw captured vertex and index data.
+    Vector<SharedPtr<Geometry> > geometries_;
+    /// Model geometries by geometry pointer, for saving them as model references.
+    HashMap<Geometry*, ModelGeometryRef> modelGeometries_;
+    /// View size.
+    IntVector2 viewSize_;
+    /// Number of captured drawables.
+    unsigned numDrawables_;
+    /// Number of captured batches.
+    unsigned numBatches_;
+    /// Number of skipped batches.
+    unsigned numSkippedBatches_;
+};
+
+}
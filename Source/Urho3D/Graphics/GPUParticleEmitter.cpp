@@ -0,0 +1,692 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Graphics/Batch.h"
+#include "../Graphics/Camera.h"
+#include "../Core/Context.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/GPUParticleEmitter.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../IO/Log.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/ParticleEffect.h"
+#include "../Core/Profiler.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/ResourceEvents.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+#include "../Graphics/VertexBuffer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* GEOMETRY_CATEGORY;
+extern const char* faceCameraModeNames[];
+
+/// Vertex layout: start position, start velocity, quad corner, half size, and spawn time, time to live, rotation & rotation speed in the tangent.
+static const unsigned PARTICLE_VERTEX_MASK = MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TEXCOORD2 | MASK_TANGENT;
+static const unsigned SPAWN_TIME_OFFSET = 10;
+/// Emitter time after which the spawn times are rebased to zero.
+static const float TIME_REBASE_INTERVAL = 1000.0f;
+/// Frame time for unused animation frames. Must match the shaders' expectation of frames never being reached.
+static const float UNUSED_FRAME_TIME = 1.0e6f;
+/// Smallest damping or size change rate which uses the exponential solution. Must match the shaders.
+static const float MIN_EXPONENTIAL_RATE = 0.0001f;
+static const float QUAD_CORNERS[] = { 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+
+/// Return particle displacement from its start position after the given time.
+static Vector3 GetParticleOffset(const Vector3& velocity, const Vector3& force, float damping, float time)
+{
+    if (Abs(damping) > MIN_EXPONENTIAL_RATE)
+    {
+        Vector3 terminal = force / damping;
+        return terminal * time + (velocity - terminal) * ((1.0f - expf(-damping * time)) / damping);
+    }
+    else
+        return velocity * time + force * (0.5f * time * time);
+}
+
+/// Return the time at which one velocity component changes sign, or negative if it never does.
+static float GetTurningTime(float velocity, float force, float damping)
+{
+    if (Abs(damping) > MIN_EXPONENTIAL_RATE)
+    {
+        float terminal = force / damping;
+        float ratio = velocity != terminal ? -terminal / (velocity - terminal) : 0.0f;
+        return ratio > 0.0f ? -logf(ratio) / damping : -1.0f;
+    }
+    else
+        return force != 0.0f ? -velocity / force : -1.0f;
+}
+
+/// Return particle size scale after the given time.
+static float GetParticleScale(float sizeAdd, float sizeRate, float time)
+{
+    float scale;
+    if (Abs(sizeRate) > MIN_EXPONENTIAL_RATE)
+        scale = (1.0f + sizeAdd / sizeRate) * expf(sizeRate * time) - sizeAdd / sizeRate;
+    else
+        scale = 1.0f + sizeAdd * time;
+    return Max(scale, 0.0f);
+}
+
+GPUParticleEmitter::GPUParticleEmitter(Context* context) :
+    Drawable(context, DRAWABLE_GEOMETRY),
+    geometry_(new Geometry(context)),
+    vertexBuffer_(new VertexBuffer(context_)),
+    indexBuffer_(new IndexBuffer(context_)),
+    windowStartTime_(0.0f),
+    time_(0.0f),
+    periodTimer_(0.0f),
+    emissionTimer_(0.0f),
+    lastTimeStep_(0.0f),
+    nextParticle_(0),
+    dirtyStart_(0),
+    dirtyCount_(0),
+    lastUpdateFrameNumber_(M_MAX_UNSIGNED),
+    faceCameraMode_(FC_ROTATE_XYZ),
+    emitting_(true),
+    needUpdate_(false),
+    bufferDirty_(true)
+{
+    // Particles are written once at emission and then only partially updated, so keep a CPU copy instead of a dynamic buffer
+    vertexBuffer_->SetShadowed(true);
+    geometry_->SetVertexBuffer(0, vertexBuffer_, PARTICLE_VERTEX_MASK);
+    geometry_->SetIndexBuffer(indexBuffer_);
+
+    batches_.Resize(1);
+    batches_[0].geometry_ = geometry_;
+    batches_[0].geometryType_ = GEOM_PARTICLE;
+    batches_[0].worldTransform_ = &transforms_[0];
+    batches_[0].numWorldTransforms_ = 2;
+
+    SetNumParticles(DEFAULT_NUM_PARTICLES);
+}
+
+GPUParticleEmitter::~GPUParticleEmitter()
+{
+}
+
+void GPUParticleEmitter::RegisterObject(Context* context)
+{
+    context->RegisterFactory<GPUParticleEmitter>(GEOMETRY_CATEGORY);
+
+    ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Effect", GetEffectAttr, SetEffectAttr, ResourceRef, ResourceRef(ParticleEffect::GetTypeStatic()), AM_DEFAULT);
+    ENUM_ATTRIBUTE("Face Camera Mode", faceCameraMode_, faceCameraModeNames, FC_ROTATE_XYZ, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
+    ATTRIBUTE("Is Emitting", bool, emitting_, true, AM_FILE);
+    ATTRIBUTE("Period Timer", float, periodTimer_, 0.0f, AM_FILE | AM_NOEDIT);
+    ATTRIBUTE("Emission Timer", float, emissionTimer_, 0.0f, AM_FILE | AM_NOEDIT);
+    COPY_BASE_ATTRIBUTES(Drawable);
+}
+
+void GPUParticleEmitter::OnSetEnabled()
+{
+    Drawable::OnSetEnabled();
+
+    Scene* scene = GetScene();
+    if (scene)
+    {
+        if (IsEnabledEffective())
+            SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(GPUParticleEmitter, HandleScenePostUpdate));
+        else
+            UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
+    }
+}
+
+void GPUParticleEmitter::Update(const FrameInfo& frame)
+{
+    if (!effect_ || !needUpdate_)
+        return;
+
+    // The emitter time only advances while the particles are being updated, so that invisible emitters freeze in place
+    time_ += lastTimeStep_;
+
+    // Check active/inactive period switching
+    periodTimer_ += lastTimeStep_;
+    if (emitting_)
+    {
+        float activeTime = effect_->GetActiveTime();
+        if (activeTime && periodTimer_ >= activeTime)
+        {
+            emitting_ = false;
+            periodTimer_ -= activeTime;
+        }
+    }
+    else
+    {
+        float inactiveTime = effect_->GetInactiveTime();
+        if (inactiveTime && periodTimer_ >= inactiveTime)
+        {
+            emitting_ = true;
+            periodTimer_ -= inactiveTime;
+        }
+        // If emitter has an indefinite stop interval, keep period timer reset to allow restarting emission in the editor
+        if (inactiveTime == 0.0f)
+            periodTimer_ = 0.0f;
+    }
+
+    // Start a new bounds window when all particles of the previous one are certain to have died
+    bool boundsChanged = false;
+    if (time_ - windowStartTime_ >= effect_->GetMaxTimeToLive())
+    {
+        windowBoxes_[1] = windowBoxes_[0];
+        windowBoxes_[0].Clear();
+        windowStartTime_ = time_;
+        boundsChanged = true;
+    }
+
+    // Check for emitting new particles. There is no per-frame limit besides the capacity, as emission is cheap
+    if (emitting_)
+    {
+        emissionTimer_ += lastTimeStep_;
+
+        float intervalMin = 1.0f / effect_->GetMaxEmissionRate();
+        float intervalMax = 1.0f / effect_->GetMinEmissionRate();
+
+        // If emission timer has a longer delay than max. interval, clamp it
+        if (emissionTimer_ < -intervalMax)
+            emissionTimer_ = -intervalMax;
+
+        unsigned counter = deathTimes_.Size();
+
+        while (emissionTimer_ > 0.0f && counter)
+        {
+            // Backdate the particle by how late it is, so that high emission rates give an even stream instead of bursts
+            float age = Min(emissionTimer_, lastTimeStep_);
+            emissionTimer_ -= Lerp(intervalMin, intervalMax, Random(1.0f));
+            if (EmitNewParticle(age))
+            {
+                --counter;
+                boundsChanged = true;
+            }
+            else
+                break;
+        }
+    }
+
+    if (time_ >= TIME_REBASE_INTERVAL)
+        RebaseTime();
+
+    if (material_)
+    {
+        material_->SetShaderParameter("ParticleTime", time_);
+        // In relative mode the force is applied in the emitter's local space
+        Vector3 force = effect_->GetConstantForce();
+        if (effect_->IsRelative())
+            force = node_->GetWorldRotation().Inverse() * force;
+        material_->SetShaderParameter("ParticleForce", Vector4(force, effect_->GetDampingForce()));
+    }
+
+    if (boundsChanged)
+        OnMarkedDirty(node_);
+
+    needUpdate_ = false;
+}
+
+void GPUParticleEmitter::UpdateBatches(const FrameInfo& frame)
+{
+    distance_ = frame.camera_->GetDistance(GetWorldBoundingBox().Center());
+
+    batches_[0].distance_ = distance_;
+    batches_[0].material_ = material_;
+    // Particle positioning
+    transforms_[0] = effect_ && effect_->IsRelative() ? node_->GetWorldTransform() : Matrix3x4::IDENTITY;
+    // Particle rotation
+    transforms_[1] = Matrix3x4(Vector3::ZERO, faceCameraMode_ != FC_NONE ? frame.camera_->GetFaceCameraRotation(
+        node_->GetWorldPosition(), node_->GetWorldRotation(), faceCameraMode_) : node_->GetWorldRotation(), Vector3::ONE);
+}
+
+void GPUParticleEmitter::UpdateGeometry(const FrameInfo& frame)
+{
+    if (indexBuffer_->IsDataLost())
+        UpdateIndexBuffer();
+
+    if (bufferDirty_ || dirtyCount_ || vertexBuffer_->IsDataLost())
+        UpdateVertexBuffer();
+
+    // If using camera facing, re-update the rotation for the current view now
+    if (faceCameraMode_ != FC_NONE)
+    {
+        transforms_[1] = Matrix3x4(Vector3::ZERO, frame.camera_->GetFaceCameraRotation(node_->GetWorldPosition(),
+            node_->GetWorldRotation(), faceCameraMode_), Vector3::ONE);
+    }
+}
+
+UpdateGeometryType GPUParticleEmitter::GetUpdateGeometryType()
+{
+    if (bufferDirty_ || dirtyCount_ || vertexBuffer_->IsDataLost() || indexBuffer_->IsDataLost())
+        return UPDATE_MAIN_THREAD;
+    else if (faceCameraMode_ != FC_NONE)
+        return UPDATE_WORKER_THREAD;
+    else
+        return UPDATE_NONE;
+}
+
+void GPUParticleEmitter::SetEffect(ParticleEffect* effect)
+{
+    if (effect == effect_)
+        return;
+
+    // Unsubscribe from the reload event of previous effect (if any), then subscribe to the new
+    if (effect_)
+        UnsubscribeFromEvent(effect_, E_RELOADFINISHED);
+
+    effect_ = effect;
+
+    if (effect_)
+        SubscribeToEvent(effect_, E_RELOADFINISHED, HANDLER(GPUParticleEmitter, HandleEffectReloadFinished));
+
+    Reset();
+    ApplyEffect();
+    MarkNetworkUpdate();
+}
+
+void GPUParticleEmitter::SetNumParticles(unsigned num)
+{
+    // Prevent negative value being assigned from the editor
+    if (num > M_MAX_INT)
+        num = 0;
+    if (num > MAX_GPU_PARTICLES)
+        num = MAX_GPU_PARTICLES;
+
+    if (num == deathTimes_.Size())
+        return;
+
+    deathTimes_.Resize(num);
+    UpdateBufferSize();
+}
+
+void GPUParticleEmitter::SetEmitting(bool enable)
+{
+    if (enable != emitting_)
+    {
+        emitting_ = enable;
+        periodTimer_ = 0.0f;
+        // Note: network update does not need to be marked as this is a file only attribute
+    }
+}
+
+void GPUParticleEmitter::SetFaceCameraMode(FaceCameraMode mode)
+{
+    faceCameraMode_ = mode;
+    MarkNetworkUpdate();
+}
+
+void GPUParticleEmitter::ResetEmissionTimer()
+{
+    emissionTimer_ = 0.0f;
+}
+
+void GPUParticleEmitter::RemoveAllParticles()
+{
+    // Zeroed vertices have zero time to live, which the shaders treat as dead
+    unsigned char* data = vertexBuffer_->GetShadowData();
+    if (data)
+        memset(data, 0, vertexBuffer_->GetVertexCount() * vertexBuffer_->GetVertexSize());
+    for (unsigned i = 0; i < deathTimes_.Size(); ++i)
+        deathTimes_[i] = 0.0f;
+
+    time_ = 0.0f;
+    windowStartTime_ = 0.0f;
+    windowBoxes_[0].Clear();
+    windowBoxes_[1].Clear();
+    nextParticle_ = 0;
+    dirtyCount_ = 0;
+    bufferDirty_ = true;
+
+    OnMarkedDirty(node_);
+}
+
+void GPUParticleEmitter::Reset()
+{
+    RemoveAllParticles();
+    ResetEmissionTimer();
+    SetEmitting(true);
+}
+
+void GPUParticleEmitter::ApplyEffect()
+{
+    if (!effect_)
+        return;
+
+    // Each emitter needs its own material, as the simulation parameters and the emitter time are material shader parameters
+    Material* material = effect_->GetMaterial();
+    material_ = material ? material->Clone() : SharedPtr<Material>();
+    SetNumParticles(effect_->GetNumParticles());
+    UpdateEffectParameters();
+}
+
+Material* GPUParticleEmitter::GetMaterial() const
+{
+    return material_;
+}
+
+void GPUParticleEmitter::SetEffectAttr(const ResourceRef& value)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    SetEffect(cache->GetResource<ParticleEffect>(value.name_));
+}
+
+ResourceRef GPUParticleEmitter::GetEffectAttr() const
+{
+    return GetResourceRef(effect_, ParticleEffect::GetTypeStatic());
+}
+
+void GPUParticleEmitter::OnNodeSet(Node* node)
+{
+    Drawable::OnNodeSet(node);
+
+    if (node)
+    {
+        Scene* scene = GetScene();
+        if (scene && IsEnabledEffective())
+            SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(GPUParticleEmitter, HandleScenePostUpdate));
+    }
+}
+
+void GPUParticleEmitter::OnWorldBoundingBoxUpdate()
+{
+    BoundingBox box;
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        if (windowBoxes_[i].defined_)
+            box.Merge(windowBoxes_[i]);
+    }
+
+    if (box.defined_ && effect_ && effect_->IsRelative())
+        box = box.Transformed(node_->GetWorldTransform());
+
+    // Always merge the node's own position to ensure particle emitter updates continue when the relative mode is switched
+    box.Merge(node_->GetWorldPosition());
+
+    worldBoundingBox_ = box;
+}
+
+bool GPUParticleEmitter::EmitNewParticle(float age)
+{
+    unsigned char* data = vertexBuffer_->GetShadowData();
+    if (!data || deathTimes_.Empty() || deathTimes_[nextParticle_] > time_)
+        return false;
+
+    unsigned index = nextParticle_;
+    bool relative = effect_->IsRelative();
+
+    Vector3 startPos;
+    Vector3 startDir;
+
+    switch (effect_->GetEmitterType())
+    {
+    case EMITTER_SPHERE:
+        {
+            Vector3 dir(
+                Random(2.0f) - 1.0f,
+                Random(2.0f) - 1.0f,
+                Random(2.0f) - 1.0f
+            );
+            dir.Normalize();
+            startPos = effect_->GetEmitterSize() * dir * 0.5f;
+        }
+        break;
+
+    case EMITTER_BOX:
+        {
+            const Vector3& emitterSize = effect_->GetEmitterSize();
+            startPos = Vector3(
+                Random(emitterSize.x_) - emitterSize.x_ * 0.5f,
+                Random(emitterSize.y_) - emitterSize.y_ * 0.5f,
+                Random(emitterSize.z_) - emitterSize.z_ * 0.5f
+            );
+        }
+        break;
+    }
+
+    startDir = effect_->GetRandomDirection();
+    startDir.Normalize();
+
+    if (!relative)
+    {
+        startPos = node_->GetWorldTransform() * startPos;
+        startDir = node_->GetWorldRotation() * startDir;
+    }
+
+    Vector3 velocity = effect_->GetRandomVelocity() * startDir;
+    Vector2 size = effect_->GetRandomSize();
+    float timeToLive = effect_->GetRandomTimeToLive();
+    float rotation = effect_->GetRandomRotation();
+    float rotationSpeed = effect_->GetRandomRotationSpeed();
+    float spawnTime = time_ - age;
+
+    float* dest = reinterpret_cast<float*>(data + index * 4 * vertexBuffer_->GetVertexSize());
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        dest[0] = startPos.x_; dest[1] = startPos.y_; dest[2] = startPos.z_;
+        dest[3] = velocity.x_; dest[4] = velocity.y_; dest[5] = velocity.z_;
+        dest[6] = QUAD_CORNERS[i * 2]; dest[7] = QUAD_CORNERS[i * 2 + 1];
+        dest[8] = size.x_; dest[9] = size.y_;
+        dest[10] = spawnTime; dest[11] = timeToLive; dest[12] = rotation; dest[13] = rotationSpeed;
+        dest += 14;
+    }
+
+    deathTimes_[index] = spawnTime + timeToLive;
+    if (++nextParticle_ >= deathTimes_.Size())
+        nextParticle_ = 0;
+    if (!dirtyCount_)
+        dirtyStart_ = index;
+    ++dirtyCount_;
+
+    // Grow the bounds by the whole trajectory: each velocity component changes sign at most once, so the extremes are at
+    // the start, the end, or at the turning points
+    Vector3 force = effect_->GetConstantForce();
+    if (relative)
+        force = node_->GetWorldRotation().Inverse() * force;
+    float damping = effect_->GetDampingForce();
+    BoundingBox trajectory(startPos, startPos);
+    trajectory.Merge(startPos + GetParticleOffset(velocity, force, damping, timeToLive));
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        float turningTime = GetTurningTime(velocity.Data()[i], force.Data()[i], damping);
+        if (turningTime > 0.0f && turningTime < timeToLive)
+            trajectory.Merge(startPos + GetParticleOffset(velocity, force, damping, turningTime));
+    }
+
+    // The size scale is monotonic, so its maximum is at either end of the lifetime
+    float maxScale = Max(1.0f, GetParticleScale(effect_->GetSizeAdd(), effect_->GetSizeMul() - 1.0f, timeToLive));
+    Vector3 edge = Vector3::ONE * (size.Length() * maxScale);
+    windowBoxes_[0].Merge(BoundingBox(trajectory.min_ - edge, trajectory.max_ + edge));
+
+    return true;
+}
+
+void GPUParticleEmitter::UpdateBufferSize()
+{
+    unsigned numParticles = deathTimes_.Size();
+
+    vertexBuffer_->SetSize(numParticles * 4, PARTICLE_VERTEX_MASK);
+    indexBuffer_->SetSize(numParticles * 6, numParticles * 4 > 65536);
+    geometry_->SetDrawRange(TRIANGLE_LIST, 0, numParticles * 6, false);
+
+    UpdateIndexBuffer();
+    RemoveAllParticles();
+}
+
+void GPUParticleEmitter::UpdateIndexBuffer()
+{
+    unsigned numParticles = deathTimes_.Size();
+    if (!numParticles)
+        return;
+
+    // Indices do not change for a given particle capacity
+    void* dest = indexBuffer_->Lock(0, numParticles * 6, true);
+    if (!dest)
+        return;
+
+    bool largeIndices = indexBuffer_->GetIndexSize() == sizeof(unsigned);
+    unsigned short* shortDest = static_cast<unsigned short*>(dest);
+    unsigned* intDest = static_cast<unsigned*>(dest);
+    unsigned vertexIndex = 0;
+
+    for (unsigned i = 0; i < numParticles; ++i)
+    {
+        unsigned indices[] = { vertexIndex, vertexIndex + 1, vertexIndex + 2, vertexIndex + 2, vertexIndex + 3, vertexIndex };
+        for (unsigned j = 0; j < 6; ++j)
+        {
+            if (largeIndices)
+                *intDest++ = indices[j];
+            else
+                *shortDest++ = (unsigned short)indices[j];
+        }
+        vertexIndex += 4;
+    }
+
+    indexBuffer_->Unlock();
+    indexBuffer_->ClearDataLost();
+}
+
+void GPUParticleEmitter::UpdateVertexBuffer()
+{
+    PROFILE(UpdateGPUParticles);
+
+    unsigned char* data = vertexBuffer_->GetShadowData();
+    unsigned numParticles = deathTimes_.Size();
+    if (!data || !numParticles)
+        return;
+
+    unsigned vertexSize = vertexBuffer_->GetVertexSize();
+
+    if (bufferDirty_ || vertexBuffer_->IsDataLost() || dirtyCount_ >= numParticles)
+        vertexBuffer_->SetData(data);
+    else
+    {
+        // Upload only the newly emitted particles, which may wrap around the end of the ring buffer
+        unsigned firstCount = Min((int)dirtyCount_, (int)(numParticles - dirtyStart_));
+        vertexBuffer_->SetDataRange(data + dirtyStart_ * 4 * vertexSize, dirtyStart_ * 4, firstCount * 4);
+        if (firstCount < dirtyCount_)
+            vertexBuffer_->SetDataRange(data, 0, (dirtyCount_ - firstCount) * 4);
+    }
+
+    vertexBuffer_->ClearDataLost();
+    bufferDirty_ = false;
+    dirtyCount_ = 0;
+}
+
+void GPUParticleEmitter::RebaseTime()
+{
+    unsigned char* data = vertexBuffer_->GetShadowData();
+    if (!data)
+        return;
+
+    unsigned vertexSize = vertexBuffer_->GetVertexSize();
+    unsigned numVertices = vertexBuffer_->GetVertexCount();
+    for (unsigned i = 0; i < numVertices; ++i)
+        *reinterpret_cast<float*>(data + i * vertexSize + SPAWN_TIME_OFFSET * sizeof(float)) -= time_;
+    for (unsigned i = 0; i < deathTimes_.Size(); ++i)
+        deathTimes_[i] -= time_;
+
+    windowStartTime_ -= time_;
+    time_ = 0.0f;
+    bufferDirty_ = true;
+}
+
+void GPUParticleEmitter::UpdateEffectParameters()
+{
+    if (!effect_ || !material_)
+        return;
+
+    const Vector<ColorFrame>& colorFrames = effect_->GetColorFrames();
+    const Vector<TextureFrame>& textureFrames = effect_->GetTextureFrames();
+    if (colorFrames.Size() > MAX_GPU_PARTICLE_FRAMES || textureFrames.Size() > MAX_GPU_PARTICLE_FRAMES)
+        LOGWARNING("GPU particle emitter only uses the first " + String(MAX_GPU_PARTICLE_FRAMES) + " color and texture frames");
+
+    // Unused frames repeat the last frame's value with a time that is never reached
+    float colorTimes[MAX_GPU_PARTICLE_FRAMES];
+    float uvTimes[MAX_GPU_PARTICLE_FRAMES];
+    for (unsigned i = 0; i < MAX_GPU_PARTICLE_FRAMES; ++i)
+    {
+        Color color;
+        if (colorFrames.Empty())
+            colorTimes[i] = i ? UNUSED_FRAME_TIME : 0.0f;
+        else if (i < colorFrames.Size())
+        {
+            color = colorFrames[i].color_;
+            colorTimes[i] = colorFrames[i].time_;
+        }
+        else
+        {
+            color = colorFrames.Back().color_;
+            colorTimes[i] = UNUSED_FRAME_TIME;
+        }
+
+        Rect uv = Rect::POSITIVE;
+        if (textureFrames.Empty())
+            uvTimes[i] = i ? UNUSED_FRAME_TIME : 0.0f;
+        else if (i < textureFrames.Size())
+        {
+            uv = textureFrames[i].uv_;
+            uvTimes[i] = textureFrames[i].time_;
+        }
+        else
+        {
+            uv = textureFrames.Back().uv_;
+            uvTimes[i] = UNUSED_FRAME_TIME;
+        }
+
+        material_->SetShaderParameter("ParticleColor" + String(i), color);
+        material_->SetShaderParameter("ParticleUV" + String(i), Vector4(uv.min_.x_, uv.min_.y_, uv.max_.x_, uv.max_.y_));
+    }
+
+    material_->SetShaderParameter("ParticleColorTimes", Vector4(colorTimes));
+    material_->SetShaderParameter("ParticleUVTimes", Vector4(uvTimes));
+    material_->SetShaderParameter("ParticleSize", Vector2(effect_->GetSizeAdd(), effect_->GetSizeMul() - 1.0f));
+    material_->SetShaderParameter("ParticleTime", time_);
+    material_->SetShaderParameter("ParticleForce", Vector4(effect_->GetConstantForce(), effect_->GetDampingForce()));
+}
+
+void GPUParticleEmitter::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+    // Store scene's timestep and use it instead of global timestep, as time scale may be other than 1
+    using namespace ScenePostUpdate;
+
+    lastTimeStep_ = eventData[P_TIMESTEP].GetFloat();
+
+    // If no invisible update, check that the emitter is in view (framenumber has changed)
+    if ((effect_ && effect_->GetUpdateInvisible()) || viewFrameNumber_ != lastUpdateFrameNumber_)
+    {
+        lastUpdateFrameNumber_ = viewFrameNumber_;
+        needUpdate_ = true;
+        MarkForUpdate();
+    }
+}
+
+void GPUParticleEmitter::HandleEffectReloadFinished(StringHash eventType, VariantMap& eventData)
+{
+    // When particle effect file is live-edited, remove existing particles and reapply the effect parameters
+    Reset();
+    ApplyEffect();
+}
+
+}
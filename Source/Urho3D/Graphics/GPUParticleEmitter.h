@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Graphics/Drawable.h"
+#include "../Math/Matrix3x4.h"
+
+namespace Urho3D
+{
+
+class IndexBuffer;
+class ParticleEffect;
+class VertexBuffer;
+
+/// Maximum number of particles in a GPU particle emitter.
+static const unsigned MAX_GPU_PARTICLES = 1024 * 1024;
+/// Maximum number of color or texture animation frames evaluated by the GPU particle shaders.
+static const unsigned MAX_GPU_PARTICLE_FRAMES = 4;
+
+/// %Particle emitter component that simulates the particles in the vertex shader. Each particle is written to the vertex buffer once at emission, after which its position, size, rotation, color and texture frame are evaluated in closed form from its age, so the CPU cost does not depend on the number of live particles.
+class URHO3D_API GPUParticleEmitter : public Drawable
+{
+    OBJECT(GPUParticleEmitter);
+
+public:
+    /// Construct.
+    GPUParticleEmitter(Context* context);
+    /// Destruct.
+    virtual ~GPUParticleEmitter();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Handle enabled/disabled state change.
+    virtual void OnSetEnabled();
+    /// Update before octree reinsertion. Is called from a worker thread.
+    virtual void Update(const FrameInfo& frame);
+    /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
+    virtual void UpdateBatches(const FrameInfo& frame);
+    /// Prepare geometry for rendering. Called from a worker thread if possible (no GPU update.)
+    virtual void UpdateGeometry(const FrameInfo& frame);
+    /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
+    virtual UpdateGeometryType GetUpdateGeometryType();
+
+    /// Set particle effect.
+    void SetEffect(ParticleEffect* effect);
+    /// Set maximum number of particles.
+    void SetNumParticles(unsigned num);
+    /// Set whether should be emitting. If the state was changed, also resets the emission period timer.
+    void SetEmitting(bool enable);
+    /// Set how the particles should rotate in relation to the camera. Default is to follow camera rotation on all axes (FC_ROTATE_XYZ.)
+    void SetFaceCameraMode(FaceCameraMode mode);
+    /// Reset the emission period timer.
+    void ResetEmissionTimer();
+    /// Remove all current particles.
+    void RemoveAllParticles();
+    /// Reset the particle emitter completely. Removes current particles, sets emitting state on, and resets the emission timer.
+    void Reset();
+    /// Apply not continuously updated values such as the material, the number of particles and the animation frames from the particle effect. Call this if you change the effect programmatically.
+    void ApplyEffect();
+
+    /// Return particle effect.
+    ParticleEffect* GetEffect() const { return effect_; }
+    /// Return material. This is a copy of the effect's material, which holds the simulation shader parameters.
+    Material* GetMaterial() const;
+    /// Return maximum number of particles.
+    unsigned GetNumParticles() const { return deathTimes_.Size(); }
+    /// Return whether is currently emitting.
+    bool IsEmitting() const { return emitting_; }
+    /// Return how the particles rotate in relation to the camera.
+    FaceCameraMode GetFaceCameraMode() const { return faceCameraMode_; }
+
+    /// Set particles effect attribute.
+    void SetEffectAttr(const ResourceRef& value);
+    /// Return particles effect attribute.
+    ResourceRef GetEffectAttr() const;
+
+protected:
+    /// Handle node being assigned.
+    virtual void OnNodeSet(Node* node);
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate();
+
+    /// Write a new particle to the next slot of the ring buffer, backdated by the given age. Return true if there was room.
+    bool EmitNewParticle(float age);
+
+private:
+    /// Resize the vertex and index buffers to the particle capacity. Removes all particles.
+    void UpdateBufferSize();
+    /// Write the quad indices of all particle slots.
+    void UpdateIndexBuffer();
+    /// Upload the particles emitted since the last geometry update.
+    void UpdateVertexBuffer();
+    /// Subtract the elapsed emitter time from all particle spawn times to retain floating point precision.
+    void RebaseTime();
+    /// Set the effect-specific simulation shader parameters to the material.
+    void UpdateEffectParameters();
+    /// Handle scene post-update event.
+    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle live reload of the particle effect.
+    void HandleEffectReloadFinished(StringHash eventType, VariantMap& eventData);
+
+    /// Particle effect.
+    SharedPtr<ParticleEffect> effect_;
+    /// Material with the simulation shader parameters.
+    SharedPtr<Material> material_;
+    /// Geometry.
+    SharedPtr<Geometry> geometry_;
+    /// Vertex buffer, shadowed so that only the newly emitted particles need to be uploaded.
+    SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Index buffer.
+    SharedPtr<IndexBuffer> indexBuffer_;
+    /// Transform matrices for position and particle orientation.
+    Matrix3x4 transforms_[2];
+    /// Emitter time at which each particle slot becomes free.
+    PODVector<float> deathTimes_;
+    /// Bounding boxes of the particles emitted during the current and the previous bounds window, in emitter space.
+    BoundingBox windowBoxes_[2];
+    /// Start time of the current bounds window.
+    float windowStartTime_;
+    /// Emitter time.
+    float time_;
+    /// Active/inactive period timer.
+    float periodTimer_;
+    /// New particle emission timer.
+    float emissionTimer_;
+    /// Last scene timestep.
+    float lastTimeStep_;
+    /// Next particle slot to emit to.
+    unsigned nextParticle_;
+    /// First particle slot emitted since the last upload.
+    unsigned dirtyStart_;
+    /// Number of particle slots emitted since the last upload.
+    unsigned dirtyCount_;
+    /// Rendering framenumber on which was last updated.
+    unsigned lastUpdateFrameNumber_;
+    /// Particle orientation mode.
+    FaceCameraMode faceCameraMode_;
+    /// Currently emitting flag.
+    bool emitting_;
+    /// Need update flag.
+    bool needUpdate_;
+    /// Whole vertex buffer needs upload flag.
+    bool bufferDirty_;
+};
+
+}
@@ -43,7 +43,9 @@ Geometry::Geometry(Context* context) :
     rawVertexSize_(0),
     rawElementMask_(0),
     rawIndexSize_(0),
-    lodDistance_(0.0f)
+    lodDistance_(0.0f),
+    triangleBVHEnabled_(false),
+    triangleBVHDirty_(true)
 {
     SetNumVertexBuffers(1);
 }
@@ -90,12 +92,14 @@ bool Geometry::SetVertexBuffer(unsigned index, VertexBuffer* buffer, unsigned el
     }
     
     GetPositionBufferIndex();
+    MarkTriangleBVHDirty();
     return true;
 }
 
 void Geometry::SetIndexBuffer(IndexBuffer* buffer)
 {
     indexBuffer_ = buffer;
+    MarkTriangleBVHDirty();
 }
 
 bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned indexCount, bool getUsedVertexRange)
@@ -131,6 +135,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned in
         vertexCount_ = 0;
     }
     
+    MarkTriangleBVHDirty();
     return true;
 }
 
@@ -158,6 +163,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned in
     vertexStart_ = minVertex;
     vertexCount_ = vertexCount;
     
+    MarkTriangleBVHDirty();
     return true;
 }
 
@@ -174,12 +180,27 @@ void Geometry::SetRawVertexData(SharedArrayPtr<unsigned char> data, unsigned ver
     rawVertexData_ = data;
     rawVertexSize_ = vertexSize;
     rawElementMask_ = elementMask;
+    MarkTriangleBVHDirty();
 }
 
 void Geometry::SetRawIndexData(SharedArrayPtr<unsigned char> data, unsigned indexSize)
 {
     rawIndexData_ = data;
     rawIndexSize_ = indexSize;
+    MarkTriangleBVHDirty();
+}
+
+void Geometry::SetTriangleBVHEnabled(bool enable)
+{
+    triangleBVHEnabled_ = enable;
+    MarkTriangleBVHDirty();
+}
+
+void Geometry::MarkTriangleBVHDirty()
+{
+    MutexLock lock(triangleBVHMutex_);
+    triangleBVH_.Clear();
+    triangleBVHDirty_ = true;
 }
 
 void Geometry::Draw(Graphics* graphics)
@@ -345,7 +366,10 @@ float Geometry::GetHitDistance(const Ray& ray, Vector3* outNormal) const
     
     GetRawData(vertexData, vertexSize, indexData, indexSize, elementMask);
     
-    if (vertexData && indexData)
+    const TriangleBVH* bvh = GetTriangleBVH(vertexData, vertexSize, indexData, indexSize);
+    if (bvh)
+        return bvh->HitDistance(ray, vertexData, vertexSize, outNormal);
+    else if (vertexData && indexData)
         return ray.HitDistance(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_, outNormal);
     else if (vertexData)
         return ray.HitDistance(vertexData, vertexSize, vertexStart_, vertexCount_, outNormal);
@@ -363,7 +387,10 @@ bool Geometry::IsInside(const Ray& ray) const
     
     GetRawData(vertexData, vertexSize, indexData, indexSize, elementMask);
     
-    if (vertexData && indexData)
+    const TriangleBVH* bvh = GetTriangleBVH(vertexData, vertexSize, indexData, indexSize);
+    if (bvh)
+        return bvh->IsInside(ray, vertexData, vertexSize);
+    else if (vertexData && indexData)
         return ray.InsideGeometry(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_);
     else if (vertexData)
         return ray.InsideGeometry(vertexData, vertexSize, vertexStart_, vertexCount_);
@@ -386,4 +413,23 @@ void Geometry::GetPositionBufferIndex()
     positionBufferIndex_ = M_MAX_UNSIGNED;
 }
 
+const TriangleBVH* Geometry::GetTriangleBVH(const unsigned char* vertexData, unsigned vertexSize, const unsigned char* indexData,
+    unsigned indexSize) const
+{
+    if (!triangleBVHEnabled_ || primitiveType_ != TRIANGLE_LIST || !vertexData)
+        return 0;
+    
+    MutexLock lock(triangleBVHMutex_);
+    if (triangleBVHDirty_)
+    {
+        if (indexData)
+            triangleBVH_.Build(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_);
+        else
+            triangleBVH_.Build(vertexData, vertexSize, vertexStart_, vertexCount_);
+        triangleBVHDirty_ = false;
+    }
+    
+    return &triangleBVH_;
+}
+
 }
@@ -23,7 +23,9 @@
 #pragma once
 
 #include "../Container/ArrayPtr.h"
+#include "../Core/Mutex.h"
 #include "../Graphics/GraphicsDefs.h"
+#include "../Graphics/TriangleBVH.h"
 #include "../Core/Object.h"
 
 namespace Urho3D
@@ -61,6 +63,10 @@ public:
     void SetRawVertexData(SharedArrayPtr<unsigned char> data, unsigned vertexSize, unsigned elementMask);
     /// Override raw index data to be returned for CPU-side operations.
     void SetRawIndexData(SharedArrayPtr<unsigned char> data, unsigned indexSize);
+    /// Set whether to accelerate precise ray queries with a triangle bounding volume hierarchy built on the first query. Only for triangle lists.
+    void SetTriangleBVHEnabled(bool enable);
+    /// Mark the triangle bounding volume hierarchy for rebuild on the next query. Call after modifying the vertex or index data in place.
+    void MarkTriangleBVHDirty();
     /// Draw.
     void Draw(Graphics* graphics);
     
@@ -98,12 +104,16 @@ public:
     float GetHitDistance(const Ray& ray, Vector3* outNormal = 0) const;
     /// Return whether or not the ray is inside geometry.
     bool IsInside(const Ray& ray) const;
+    /// Return whether precise ray queries use a triangle bounding volume hierarchy.
+    bool IsTriangleBVHEnabled() const { return triangleBVHEnabled_; }
     /// Return whether has empty draw range.
     bool IsEmpty() const { return indexCount_ == 0 && vertexCount_ == 0; }
     
 private:
     /// Locate vertex buffer with position data.
     void GetPositionBufferIndex();
+    /// Return the triangle bounding volume hierarchy, building it first if necessary, or null if not in use.
+    const TriangleBVH* GetTriangleBVH(const unsigned char* vertexData, unsigned vertexSize, const unsigned char* indexData, unsigned indexSize) const;
     
     /// Vertex buffers.
     Vector<SharedPtr<VertexBuffer> > vertexBuffers_;
@@ -135,6 +145,14 @@ private:
     unsigned rawIndexSize_;
     /// LOD distance.
     float lodDistance_;
+    /// Triangle bounding volume hierarchy for ray queries.
+    mutable TriangleBVH triangleBVH_;
+    /// Triangle bounding volume hierarchy build mutex, as ray queries may be processed in worker threads.
+    mutable Mutex triangleBVHMutex_;
+    /// Triangle bounding volume hierarchy enabled flag.
+    bool triangleBVHEnabled_;
+    /// Triangle bounding volume hierarchy needs rebuild flag.
+    mutable bool triangleBVHDirty_;
 };
 
 }
@@ -51,9 +51,13 @@ extern URHO3D_API const StringHash VSP_VOFFSET("VOffset");
 extern URHO3D_API const StringHash VSP_ZONE("Zone");
 extern URHO3D_API const StringHash VSP_LIGHTMATRICES("LightMatrices");
 extern URHO3D_API const StringHash VSP_SKINMATRICES("SkinMatrices");
+extern URHO3D_API const StringHash VSP_SKINMATRIXOFFSET("SkinMatrixOffset");
 extern URHO3D_API const StringHash VSP_VERTEXLIGHTS("VertexLights");
+extern URHO3D_API const StringHash VSP_ARRAYLAYERS("ArrayLayers");
 extern URHO3D_API const StringHash PSP_AMBIENTCOLOR("AmbientColor");
 extern URHO3D_API const StringHash PSP_CAMERAPOS("CameraPosPS");
+extern URHO3D_API const StringHash PSP_CLUSTERPARAMS("ClusterParams");
+extern URHO3D_API const StringHash PSP_CLUSTERVIEWPROJ("ClusterViewProj");
 extern URHO3D_API const StringHash PSP_DELTATIME("DeltaTimePS");
 extern URHO3D_API const StringHash PSP_DEPTHRECONSTRUCT("DepthReconstruct");
 extern URHO3D_API const StringHash PSP_ELAPSEDTIME("ElapsedTimePS");
@@ -70,11 +74,15 @@ extern URHO3D_API const StringHash PSP_MATSPECCOLOR("MatSpecColor");
 extern URHO3D_API const StringHash PSP_NEARCLIP("NearClipPS");
 extern URHO3D_API const StringHash PSP_FARCLIP("FarClipPS");
 extern URHO3D_API const StringHash PSP_SHADOWCUBEADJUST("ShadowCubeAdjust");
+extern URHO3D_API const StringHash PSP_SHADOWCUBESCALE("ShadowCubeScale");
 extern URHO3D_API const StringHash PSP_SHADOWDEPTHFADE("ShadowDepthFade");
 extern URHO3D_API const StringHash PSP_SHADOWINTENSITY("ShadowIntensity");
 extern URHO3D_API const StringHash PSP_SHADOWMAPINVSIZE("ShadowMapInvSize");
 extern URHO3D_API const StringHash PSP_SHADOWSPLITS("ShadowSplits");
 extern URHO3D_API const StringHash PSP_LIGHTMATRICES("LightMatricesPS");
+extern URHO3D_API const StringHash PSP_DEPTHPYRAMIDSRCINVSIZE("DepthPyramidSrcInvSize");
+extern URHO3D_API const StringHash PSP_DEPTHPYRAMIDDESTSIZE("DepthPyramidDestSize");
+extern URHO3D_API const StringHash PSP_UPSAMPLEINVSIZE("UpsampleInvSize");
 
 extern URHO3D_API const Vector3 DOT_SCALE(1 / 3.0f, 1 / 3.0f, 1 / 3.0f);
 
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/HashBase.h"
+#include "../Container/Str.h"
 #include "../Math/StringHash.h"
 
 namespace Urho3D
@@ -55,8 +56,11 @@ enum GeometryType
     GEOM_SKINNED = 1,
     GEOM_INSTANCED = 2,
     GEOM_BILLBOARD = 3,
-    GEOM_STATIC_NOINSTANCING = 4,
-    MAX_GEOMETRYTYPES = 4,
+    GEOM_SKINNED_INSTANCED = 4,
+    GEOM_PARTICLE = 5,
+    GEOM_BILLBOARD_INSTANCED = 6,
+    GEOM_STATIC_NOINSTANCING = 7,
+    MAX_GEOMETRYTYPES = 7,
 };
 
 /// Blending mode.
@@ -243,8 +247,10 @@ enum TextureUnit
     TU_ENVIRONMENT = 4,
 #ifdef DESKTOP_GRAPHICS
     TU_VOLUMEMAP = 5,
+    TU_SKINMATRICES = 5,
     TU_CUSTOM1 = 6,
     TU_CUSTOM2 = 7,
+    TU_HEIGHTMAP = 7,
     TU_LIGHTRAMP = 8,
     TU_LIGHTSHAPE = 9,
     TU_SHADOWMAP = 10,
@@ -252,6 +258,7 @@ enum TextureUnit
     TU_INDIRECTION = 12,
     TU_DEPTHBUFFER = 13,
     TU_LIGHTBUFFER = 14,
+    TU_LIGHTCLUSTERS = 14,
     TU_ZONE = 15,
     MAX_MATERIAL_TEXTURE_UNITS = 8,
     MAX_TEXTURE_UNITS = 16
@@ -274,6 +281,21 @@ enum FaceCameraMode
     FC_LOOKAT_Y
 };
 
+/// Arguments of one indexed indirect draw. The layout matches the OpenGL and Direct3D11 indirect draw commands.
+struct IndirectDrawCommand
+{
+    /// Number of indices per instance.
+    unsigned indexCount_;
+    /// Number of instances.
+    unsigned instanceCount_;
+    /// First index.
+    unsigned indexStart_;
+    /// Value added to the indices before reading the vertices.
+    int baseVertex_;
+    /// First instance of the instanced vertex streams.
+    unsigned instanceStart_;
+};
+
 // Inbuilt shader parameters.
 extern URHO3D_API const StringHash VSP_AMBIENTSTARTCOLOR;
 extern URHO3D_API const StringHash VSP_AMBIENTENDCOLOR;
@@ -297,9 +319,13 @@ extern URHO3D_API const StringHash VSP_VOFFSET;
 extern URHO3D_API const StringHash VSP_ZONE;
 extern URHO3D_API const StringHash VSP_LIGHTMATRICES;
 extern URHO3D_API const StringHash VSP_SKINMATRICES;
+extern URHO3D_API const StringHash VSP_SKINMATRIXOFFSET;
 extern URHO3D_API const StringHash VSP_VERTEXLIGHTS;
+extern URHO3D_API const StringHash VSP_ARRAYLAYERS;
 extern URHO3D_API const StringHash PSP_AMBIENTCOLOR;
 extern URHO3D_API const StringHash PSP_CAMERAPOS;
+extern URHO3D_API const StringHash PSP_CLUSTERPARAMS;
+extern URHO3D_API const StringHash PSP_CLUSTERVIEWPROJ;
 extern URHO3D_API const StringHash PSP_DELTATIME;
 extern URHO3D_API const StringHash PSP_DEPTHRECONSTRUCT;
 extern URHO3D_API const StringHash PSP_ELAPSEDTIME;
@@ -316,11 +342,15 @@ extern URHO3D_API const StringHash PSP_MATSPECCOLOR;
 extern URHO3D_API const StringHash PSP_NEARCLIP;
 extern URHO3D_API const StringHash PSP_FARCLIP;
 extern URHO3D_API const StringHash PSP_SHADOWCUBEADJUST;
+extern URHO3D_API const StringHash PSP_SHADOWCUBESCALE;
 extern URHO3D_API const StringHash PSP_SHADOWDEPTHFADE;
 extern URHO3D_API const StringHash PSP_SHADOWINTENSITY;
 extern URHO3D_API const StringHash PSP_SHADOWMAPINVSIZE;
 extern URHO3D_API const StringHash PSP_SHADOWSPLITS;
 extern URHO3D_API const StringHash PSP_LIGHTMATRICES;
+extern URHO3D_API const StringHash PSP_DEPTHPYRAMIDSRCINVSIZE;
+extern URHO3D_API const StringHash PSP_DEPTHPYRAMIDDESTSIZE;
+extern URHO3D_API const StringHash PSP_UPSAMPLEINVSIZE;
 
 // Scale calculation from bounding box diagonal.
 extern URHO3D_API const Vector3 DOT_SCALE;
@@ -353,12 +383,43 @@ static const unsigned MASK_BLENDINDICES = 0x200;
 static const unsigned MASK_INSTANCEMATRIX1 = 0x400;
 static const unsigned MASK_INSTANCEMATRIX2 = 0x800;
 static const unsigned MASK_INSTANCEMATRIX3 = 0x1000;
+// Packed storage formats, combined with the element mask: normals and tangents as 16-bit normalized integers, texcoords as
+// 16-bit half floats and blend weights as 8-bit normalized integers. The shaders receive them as floats as usual
+static const unsigned MASK_PACKEDNORMALS = 0x2000;
+static const unsigned MASK_PACKEDTEXCOORDS = 0x4000;
+static const unsigned MASK_PACKEDBLENDWEIGHTS = 0x8000;
+static const unsigned MASK_PACKEDFORMATS = MASK_PACKEDNORMALS | MASK_PACKEDTEXCOORDS | MASK_PACKEDBLENDWEIGHTS;
 static const unsigned MASK_DEFAULT = 0xffffffff;
 static const unsigned NO_ELEMENT = 0xffffffff;
 
 static const int MAX_RENDERTARGETS = 4;
 static const int MAX_VERTEX_STREAMS = 4;
 static const int MAX_CONSTANT_REGISTERS = 256;
+/// Maximum number of instances per draw call when drawing with texture array layers. The layers are packed four to a vector in a uniform array.
+static const unsigned MAX_ARRAY_LAYER_INSTANCES = 128;
 
 static const int BITS_PER_COMPONENT = 8;
+
+/// Number of frames in flight for GPU profiling. The timer queries of a frame are read back when its slot is reused, to not stall.
+static const unsigned NUM_GPU_PROFILE_FRAMES = 4;
+/// Maximum number of GPU profiling blocks per frame.
+static const unsigned MAX_GPU_PROFILE_BLOCKS = 128;
+
+/// GPU time measured for a profiling block.
+struct GPUProfileBlock
+{
+    /// Construct.
+    GPUProfileBlock() :
+        depth_(0),
+        time_(0.0f)
+    {
+    }
+    
+    /// Block name.
+    String name_;
+    /// Nesting depth.
+    unsigned depth_;
+    /// GPU time in milliseconds.
+    float time_;
+};
 }
@@ -109,5 +109,13 @@ EVENT(E_DEVICERESET, DeviceReset)
 {
 }
 
+/// Shader precaching progress. Sent from the main thread after each shader combination, so a loading screen may be rendered in the handler.
+EVENT(E_SHADERPRECACHEPROGRESS, ShaderPrecacheProgress)
+{
+    PARAM(P_PROGRESS, Progress);            // float
+    PARAM(P_LOADEDCOMBINATIONS, LoadedCombinations); // int
+    PARAM(P_TOTALCOMBINATIONS, TotalCombinations); // int
+}
+
 
 }
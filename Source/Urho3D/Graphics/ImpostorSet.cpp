@@ -0,0 +1,305 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Graphics/Batch.h"
+#include "../Graphics/Camera.h"
+#include "../Core/Context.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/GraphicsEvents.h"
+#include "../Graphics/ImpostorSet.h"
+#include "../Graphics/Light.h"
+#include "../IO/Log.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/Octree.h"
+#include "../Graphics/RenderSurface.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Scene.h"
+#include "../Graphics/StaticModelGroup.h"
+#include "../Graphics/Technique.h"
+#include "../Graphics/Texture2D.h"
+#include "../Graphics/Viewport.h"
+#include "../Graphics/Zone.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const int MIN_IMPOSTOR_FRAME_SIZE = 16;
+static const int MAX_IMPOSTOR_ATLAS_SIZE = 4096;
+
+/// Return the number of atlas grid columns for a number of impostor frames.
+static unsigned GetImpostorColumns(unsigned numFrames)
+{
+    unsigned columns = 1;
+    while (columns * columns < numFrames)
+        ++columns;
+    return columns;
+}
+
+ImpostorSet::ImpostorSet(Context* context) :
+    BillboardSet(context),
+    capturedFrames_(0),
+    captureFrames_(0)
+{
+    // Billboards are in world space at the instance positions, and turn only around the Y axis like the atlas frames
+    relative_ = false;
+    scaled_ = false;
+    sorted_ = true;
+    faceCameraMode_ = FC_ROTATE_Y;
+}
+
+ImpostorSet::~ImpostorSet()
+{
+}
+
+void ImpostorSet::RegisterObject(Context* context)
+{
+    context->RegisterFactory<ImpostorSet>();
+}
+
+void ImpostorSet::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results)
+{
+    // Do not return raycast hits, the group already returns the instances
+}
+
+void ImpostorSet::UpdateBatches(const FrameInfo& frame)
+{
+    StaticModelGroup* group = group_;
+    unsigned numInstances = group && group->impostorMaterial_ ? group->numWorldTransforms_ : 0;
+
+    // The billboards are rebuilt for each view, so only resize the buffers here instead of dirtying the bounding box
+    if (billboards_.Size() != numInstances)
+    {
+        billboards_.Resize(numInstances);
+        for (unsigned i = 0; i < numInstances; ++i)
+            billboards_[i].rotation_ = 0.0f;
+        MarkBuffersDirty(true);
+    }
+    else
+        MarkBuffersDirty(false);
+
+    if (numInstances)
+    {
+        float impostorDistance = group->impostorDistance_;
+        float fadeRange = Min(group->impostorFadeRange_, impostorDistance);
+        float fadeStart = impostorDistance - fadeRange;
+        unsigned numFrames = group->impostorFrames_;
+        unsigned columns = GetImpostorColumns(numFrames);
+        unsigned rows = (numFrames + columns - 1) / columns;
+        float frameAngle = 360.0f / numFrames;
+        Vector3 cameraPosition = frame.camera_->GetNode()->GetWorldPosition();
+        const BoundingBox& box = group->GetBoundingBox();
+        Vector3 boxCenter = box.Center();
+        float halfSize = 0.5f * GetImpostorSize(box);
+
+        for (unsigned i = 0; i < numInstances; ++i)
+        {
+            const Matrix3x4& transform = group->worldTransforms_[i];
+            Billboard& billboard = billboards_[i];
+            Vector3 center = transform * boxCenter;
+
+            // Also draw the impostor in the fade range, where the group still draws the model
+            float distance = frame.camera_->GetDistance(center);
+            billboard.enabled_ = distance >= fadeStart;
+            if (!billboard.enabled_)
+                continue;
+
+            Vector3 scale = transform.Scale();
+            billboard.position_ = center;
+            billboard.size_ = Vector2(halfSize * Max(scale.x_, scale.z_), halfSize * scale.y_);
+            billboard.color_ = Color(1.0f, 1.0f, 1.0f, fadeRange > 0.0f ? Min((distance - fadeStart) / fadeRange, 1.0f) : 1.0f);
+
+            // Choose the atlas frame that was rendered from the nearest angle to the camera direction in model space
+            Vector3 direction = transform.Rotation().Inverse() * (cameraPosition - center);
+            float angle = Atan2(-direction.x_, -direction.z_);
+            if (angle < 0.0f)
+                angle += 360.0f;
+            unsigned index = ((unsigned)(angle / frameAngle + 0.5f)) % numFrames;
+            unsigned column = index % columns;
+            unsigned row = index / columns;
+            billboard.uv_ = Rect((float)column / columns, (float)row / rows, (float)(column + 1) / columns, (float)(row + 1) /
+                rows);
+        }
+    }
+
+    BillboardSet::UpdateBatches(frame);
+}
+
+void ImpostorSet::SetGroup(StaticModelGroup* group)
+{
+    group_ = group;
+    SetMaterial(group ? group->GetImpostorMaterial() : (Material*)0);
+    MarkImpostorsDirty();
+}
+
+bool ImpostorSet::GenerateImpostor(unsigned numFrames, int frameSize)
+{
+    StaticModelGroup* group = group_;
+    Model* model = group ? group->GetModel() : (Model*)0;
+    if (!model)
+    {
+        LOGERROR("Can not generate impostor without a model");
+        return false;
+    }
+
+    // Do not render in headless mode
+    if (!GetSubsystem<Graphics>())
+        return false;
+
+    if (captureScene_)
+    {
+        LOGERROR("Impostor generation already in progress");
+        return false;
+    }
+
+    numFrames = Max((int)numFrames, 1);
+    unsigned columns = GetImpostorColumns(numFrames);
+    unsigned rows = (numFrames + columns - 1) / columns;
+    frameSize = Clamp(frameSize, MIN_IMPOSTOR_FRAME_SIZE, MAX_IMPOSTOR_ATLAS_SIZE / (int)columns);
+
+    SharedPtr<Texture2D> texture(new Texture2D(context_));
+    if (!texture->SetSize(columns * frameSize, rows * frameSize, Graphics::GetRGBAFormat(), TEXTURE_RENDERTARGET))
+    {
+        LOGERROR("Failed to create impostor atlas texture");
+        return false;
+    }
+    texture->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+    texture->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+
+    // Set up a scene with the model lit from above. The zone's fog color is used to clear the atlas, so use zero alpha to
+    // leave the background transparent
+    captureScene_ = new Scene(context_);
+    captureScene_->CreateComponent<Octree>();
+    Zone* zone = captureScene_->CreateComponent<Zone>();
+    zone->SetBoundingBox(BoundingBox(-M_LARGE_VALUE, M_LARGE_VALUE));
+    zone->SetAmbientColor(Color(0.5f, 0.5f, 0.5f));
+    zone->SetFogColor(Color(0.0f, 0.0f, 0.0f, 0.0f));
+    zone->SetFogStart(M_LARGE_VALUE);
+    zone->SetFogEnd(M_LARGE_VALUE);
+
+    Node* lightNode = captureScene_->CreateChild("Light");
+    lightNode->SetDirection(Vector3(0.5f, -1.0f, 0.5f));
+    Light* light = lightNode->CreateComponent<Light>();
+    light->SetLightType(LIGHT_DIRECTIONAL);
+
+    Node* modelNode = captureScene_->CreateChild("Model");
+    StaticModel* staticModel = modelNode->CreateComponent<StaticModel>();
+    staticModel->SetModel(model);
+    for (unsigned i = 0; i < group->GetNumGeometries(); ++i)
+        staticModel->SetMaterial(i, group->GetMaterial(i));
+
+    // Render each frame to its own viewport in the atlas, with an orthographic camera looking at the model center
+    const BoundingBox& box = model->GetBoundingBox();
+    float size = GetImpostorSize(box);
+    RenderSurface* surface = texture->GetRenderSurface();
+    surface->SetNumViewports(numFrames);
+    surface->SetUpdateMode(SURFACE_MANUALUPDATE);
+
+    for (unsigned i = 0; i < numFrames; ++i)
+    {
+        Node* cameraNode = captureScene_->CreateChild("Camera");
+        cameraNode->SetRotation(Quaternion(i * 360.0f / numFrames, Vector3::UP));
+        cameraNode->SetPosition(box.Center() - size * cameraNode->GetDirection());
+        Camera* camera = cameraNode->CreateComponent<Camera>();
+        camera->SetOrthographic(true);
+        camera->SetOrthoSize(size);
+        camera->SetAutoAspectRatio(false);
+        camera->SetAspectRatio(1.0f);
+        camera->SetNearClip(0.0f);
+        camera->SetFarClip(2.0f * size);
+
+        unsigned column = i % columns;
+        unsigned row = i / columns;
+        IntRect rect(column * frameSize, row * frameSize, (column + 1) * frameSize, (row + 1) * frameSize);
+        surface->SetViewport(i, new Viewport(context_, captureScene_, camera, rect));
+    }
+
+    surface->QueueUpdate();
+    captureTexture_ = texture;
+    capturedFrames_ = 0;
+    captureFrames_ = numFrames;
+    SubscribeToEvent(E_ENDVIEWRENDER, HANDLER(ImpostorSet, HandleEndViewRender));
+    SubscribeToEvent(E_ENDRENDERING, HANDLER(ImpostorSet, HandleEndRendering));
+
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    SharedPtr<Material> material(new Material(context_));
+    material->SetTechnique(0, cache->GetResource<Technique>("Techniques/DiffVColUnlitAlpha.xml"));
+    material->SetTexture(TU_DIFFUSE, texture);
+
+    group->SetImpostorFrames(numFrames);
+    group->SetImpostorMaterial(material);
+    return true;
+}
+
+void ImpostorSet::MarkImpostorsDirty()
+{
+    if (node_)
+        OnMarkedDirty(node_);
+}
+
+StaticModelGroup* ImpostorSet::GetGroup() const
+{
+    return group_;
+}
+
+float ImpostorSet::GetImpostorSize(const BoundingBox& box)
+{
+    Vector3 halfSize = box.HalfSize();
+    return 2.0f * Max(sqrtf(halfSize.x_ * halfSize.x_ + halfSize.z_ * halfSize.z_), halfSize.y_);
+}
+
+void ImpostorSet::OnWorldBoundingBoxUpdate()
+{
+    // Cover all instances, as any of them may turn into an impostor depending on the camera
+    StaticModelGroup* group = group_;
+    if (group)
+        worldBoundingBox_ = group->GetWorldBoundingBox();
+    else
+        worldBoundingBox_ = BoundingBox(node_->GetWorldPosition(), node_->GetWorldPosition());
+}
+
+void ImpostorSet::HandleEndViewRender(StringHash eventType, VariantMap& eventData)
+{
+    using namespace EndViewRender;
+
+    if (eventData[P_SCENE].GetPtr() == captureScene_)
+        ++capturedFrames_;
+}
+
+void ImpostorSet::HandleEndRendering(StringHash eventType, VariantMap& eventData)
+{
+    if (capturedFrames_ < captureFrames_)
+        return;
+
+    // The atlas keeps its contents, so the scene and viewports are no longer needed
+    if (captureTexture_)
+        captureTexture_->GetRenderSurface()->SetNumViewports(0);
+    captureTexture_.Reset();
+    captureScene_.Reset();
+    UnsubscribeFromEvent(E_ENDVIEWRENDER);
+    UnsubscribeFromEvent(E_ENDRENDERING);
+}
+
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Graphics/BillboardSet.h"
+
+namespace Urho3D
+{
+
+class Scene;
+class StaticModelGroup;
+class Texture2D;
+
+/// Camera-facing billboards that draw the distant instances of a StaticModelGroup from an impostor atlas. Created automatically by the group when impostors are enabled, and not saved.
+class URHO3D_API ImpostorSet : public BillboardSet
+{
+    OBJECT(ImpostorSet);
+
+public:
+    /// Construct.
+    ImpostorSet(Context* context);
+    /// Destruct.
+    virtual ~ImpostorSet();
+    /// Register object factory. BillboardSet must be registered first.
+    static void RegisterObject(Context* context);
+
+    /// Process octree raycast. May be called from a worker thread.
+    virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results);
+    /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
+    virtual void UpdateBatches(const FrameInfo& frame);
+
+    /// Set the group whose distant instances to draw.
+    void SetGroup(StaticModelGroup* group);
+    /// Render the group's model from evenly spaced angles around the Y axis into a new atlas texture, and set a material using it as the group's impostor material. The atlas is rendered on the next frame. Return true if successful.
+    bool GenerateImpostor(unsigned numFrames, int frameSize);
+    /// Mark the bounding box dirty after the group's instances have changed.
+    void MarkImpostorsDirty();
+
+    /// Return the group.
+    StaticModelGroup* GetGroup() const;
+
+    /// Return the billboard size of an impostor for a model bounding box. The billboard is square and covers the box rotated to any angle around the Y axis.
+    static float GetImpostorSize(const BoundingBox& box);
+
+protected:
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate();
+
+private:
+    /// Handle the end of a view rendering to count the rendered atlas frames.
+    void HandleEndViewRender(StringHash eventType, VariantMap& eventData);
+    /// Handle the end of rendering to release the capture scene once the atlas has been rendered.
+    void HandleEndRendering(StringHash eventType, VariantMap& eventData);
+
+    /// Group.
+    WeakPtr<StaticModelGroup> group_;
+    /// Scene used to render the impostor atlas, held until it has been rendered.
+    SharedPtr<Scene> captureScene_;
+    /// Atlas texture being rendered.
+    SharedPtr<Texture2D> captureTexture_;
+    /// Number of atlas frames rendered so far.
+    unsigned capturedFrames_;
+    /// Number of atlas frames to render.
+    unsigned captureFrames_;
+};
+
+}
@@ -35,6 +35,7 @@
 #include "../Core/StringUtils.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Texture2D.h"
+#include "../Graphics/Texture2DArray.h"
 #include "../Graphics/Texture3D.h"
 #include "../Graphics/TextureCube.h"
 #include "../Scene/ValueAnimation.h"
@@ -170,10 +171,12 @@ void ShaderParameterAnimationInfo::ApplyValue(const Variant& newValue)
 
 Material::Material(Context* context) :
     Resource(context),
+    arrayLayer_(0),
     auxViewFrameNumber_(0),
     shaderParameterHash_(0),
     occlusion_(true),
     specular_(false),
+    textureArrays_(false),
     subscribed_(false),
     batchedParameterUpdate_(false)
 {
@@ -224,7 +227,9 @@ bool Material::BeginLoad(Deserializer& source)
                     TextureUnit unit = TU_DIFFUSE;
                     if (textureElem.HasAttribute("unit"))
                         unit = ParseTextureUnitName(textureElem.GetAttribute("unit"));
-                    if (unit == TU_VOLUMEMAP)
+                    if (textureElem.GetAttributeLower("type") == "array")
+                        cache->BackgroundLoadResource<Texture2DArray>(name, true, this);
+                    else if (unit == TU_VOLUMEMAP)
                         cache->BackgroundLoadResource<Texture3D>(name, true, this);
                     else
                     #endif
@@ -234,6 +239,10 @@ bool Material::BeginLoad(Deserializer& source)
                     cache->BackgroundLoadResource<Texture2D>(name, true, this);
                 textureElem = textureElem.GetNext("texture");
             }
+            
+            XMLElement arrayMaterialElem = rootElem.GetChild("arraymaterial");
+            if (arrayMaterialElem)
+                cache->BackgroundLoadResource<Material>(arrayMaterialElem.GetAttribute("name"), true, this);
         }
 
         return true;
@@ -275,6 +284,24 @@ bool Material::Save(Serializer& dest) const
     return xml->Save(dest);
 }
 
+void Material::GetDependencies(Vector<ResourceRef>& dest) const
+{
+    for (unsigned i = 0; i < techniques_.Size(); ++i)
+    {
+        if (techniques_[i].technique_)
+            dest.Push(GetResourceRef(techniques_[i].technique_, Technique::GetTypeStatic()));
+    }
+
+    for (HashMap<TextureUnit, SharedPtr<Texture> >::ConstIterator i = textures_.Begin(); i != textures_.End(); ++i)
+    {
+        if (i->second_)
+            dest.Push(GetResourceRef(i->second_, Texture2D::GetTypeStatic()));
+    }
+
+    if (arrayMaterial_)
+        dest.Push(GetResourceRef(arrayMaterial_, Material::GetTypeStatic()));
+}
+
 bool Material::Load(const XMLElement& source)
 {
     ResetToDefaults();
@@ -323,7 +350,9 @@ bool Material::Load(const XMLElement& source)
             if (GetExtension(name) == ".xml")
             {
                 #ifdef DESKTOP_GRAPHICS
-                if (unit == TU_VOLUMEMAP)
+                if (textureElem.GetAttributeLower("type") == "array")
+                    SetTexture(unit, cache->GetResource<Texture2DArray>(name));
+                else if (unit == TU_VOLUMEMAP)
                     SetTexture(unit, cache->GetResource<Texture3D>(name));
                 else
                 #endif
@@ -389,6 +418,13 @@ bool Material::Load(const XMLElement& source)
     if (depthBiasElem)
         SetDepthBias(BiasParameters(depthBiasElem.GetFloat("constant"), depthBiasElem.GetFloat("slopescaled")));
 
+    XMLElement arrayMaterialElem = source.GetChild("arraymaterial");
+    if (arrayMaterialElem)
+    {
+        SetArrayMaterial(cache->GetResource<Material>(arrayMaterialElem.GetAttribute("name")));
+        SetArrayLayer(arrayMaterialElem.GetUInt("layer"));
+    }
+
     RefreshShaderParameterHash();
     RefreshMemoryUse();
     CheckOcclusion();
@@ -425,6 +461,8 @@ bool Material::Save(XMLElement& dest) const
             XMLElement textureElem = dest.CreateChild("texture");
             textureElem.SetString("unit", textureUnitNames[j]);
             textureElem.SetString("name", texture->GetName());
+            if (texture->GetType() == Texture2DArray::GetTypeStatic())
+                textureElem.SetString("type", "array");
         }
     }
 
@@ -465,6 +503,14 @@ bool Material::Save(XMLElement& dest) const
     depthBiasElem.SetFloat("constant", depthBias_.constantBias_);
     depthBiasElem.SetFloat("slopescaled", depthBias_.slopeScaledBias_);
 
+    // Write texture array material
+    if (arrayMaterial_)
+    {
+        XMLElement arrayMaterialElem = dest.CreateChild("arraymaterial");
+        arrayMaterialElem.SetString("name", arrayMaterial_->GetName());
+        arrayMaterialElem.SetUInt("layer", arrayLayer_);
+    }
+
     return true;
 }
 
@@ -572,7 +618,30 @@ void Material::SetTexture(TextureUnit unit, Texture* texture)
             textures_[unit] = texture;
         else
             textures_.Erase(unit);
+        
+        textureArrays_ = false;
+        for (HashMap<TextureUnit, SharedPtr<Texture> >::ConstIterator i = textures_.Begin(); i != textures_.End(); ++i)
+        {
+            if (i->second_ && i->second_->GetType() == Texture2DArray::GetTypeStatic())
+                textureArrays_ = true;
+        }
+    }
+}
+
+void Material::SetArrayMaterial(Material* material)
+{
+    if (material == this)
+    {
+        LOGERROR("Material can not be its own array material");
+        return;
     }
+    
+    arrayMaterial_ = material;
+}
+
+void Material::SetArrayLayer(unsigned layer)
+{
+    arrayLayer_ = layer;
 }
 
 void Material::SetUVTransform(const Vector2& offset, float rotation, const Vector2& repeat)
@@ -668,8 +737,11 @@ SharedPtr<Material> Material::Clone(const String& cloneName) const
     ret->techniques_ = techniques_;
     ret->shaderParameters_ = shaderParameters_;
     ret->textures_ = textures_;
+    ret->arrayMaterial_ = arrayMaterial_;
+    ret->arrayLayer_ = arrayLayer_;
     ret->occlusion_ = occlusion_;
     ret->specular_ = specular_;
+    ret->textureArrays_ = textureArrays_;
     ret->cullMode_ = cullMode_;
     ret->shadowCullMode_ = shadowCullMode_;
     ret->fillMode_ = fillMode_;
@@ -779,6 +851,9 @@ void Material::ResetToDefaults()
     SetTechnique(0, GetSubsystem<ResourceCache>()->GetResource<Technique>("Techniques/NoTexture.xml"));
 
     textures_.Clear();
+    textureArrays_ = false;
+    arrayMaterial_.Reset();
+    arrayLayer_ = 0;
 
     batchedParameterUpdate_ = true;
     shaderParameters_.Clear();
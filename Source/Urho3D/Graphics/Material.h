@@ -115,6 +115,8 @@ public:
     virtual bool EndLoad();
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
+    /// Return references to the techniques and textures used.
+    virtual void GetDependencies(Vector<ResourceRef>& dest) const;
 
     /// Load from an XML element. Return true if successful.
     bool Load(const XMLElement& source);
@@ -134,6 +136,10 @@ public:
     void SetShaderParameterAnimationSpeed(const String& name, float speed);
     /// Set texture.
     void SetTexture(TextureUnit unit, Texture* texture);
+    /// Set the texture array material to render with instead of this one when texture arrays are supported. This material is used as a fallback otherwise.
+    void SetArrayMaterial(Material* material);
+    /// Set the texture array layer to select when rendering with the array material.
+    void SetArrayLayer(unsigned layer);
     /// Set texture coordinate transform.
     void SetUVTransform(const Vector2& offset, float rotation, const Vector2& repeat);
     /// Set texture coordinate transform.
@@ -173,6 +179,12 @@ public:
     Texture* GetTexture(TextureUnit unit) const;
    /// Return all textures.
     const HashMap<TextureUnit, SharedPtr<Texture> >& GetTextures() const { return textures_; }
+    /// Return whether any of the textures is a texture array.
+    bool HasTextureArrays() const { return textureArrays_; }
+    /// Return the texture array material.
+    Material* GetArrayMaterial() const { return arrayMaterial_; }
+    /// Return the texture array layer.
+    unsigned GetArrayLayer() const { return arrayLayer_; }
     /// Return shader parameter.
     const Variant& GetShaderParameter(const String& name) const;
     /// Return shader parameter animation.
@@ -227,6 +239,10 @@ private:
     Vector<TechniqueEntry> techniques_;
     /// Textures.
     HashMap<TextureUnit, SharedPtr<Texture> > textures_;
+    /// Texture array material.
+    SharedPtr<Material> arrayMaterial_;
+    /// Texture array layer.
+    unsigned arrayLayer_;
     /// %Shader parameters.
     HashMap<StringHash, MaterialShaderParameter> shaderParameters_;
     /// %Shader parameters animation infos.
@@ -247,6 +263,8 @@ private:
     bool occlusion_;
     /// Specular lighting flag.
     bool specular_;
+    /// Texture array flag.
+    bool textureArrays_;
     /// Flag for whether is subscribed to animation updates.
     bool subscribed_;
     /// Flag to suppress parameter hash and memory use recalculation when setting multiple shader parameters (loading or resetting the material.)
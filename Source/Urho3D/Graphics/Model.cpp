@@ -21,13 +21,18 @@
 //
 
 #include "../Core/Context.h"
+#include "../Core/CoreEvents.h"
 #include "../IO/Deserializer.h"
+#include "../IO/File.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/IndexBuffer.h"
 #include "../IO/Log.h"
 #include "../Graphics/Model.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/Renderer.h"
+#include "../Resource/ResourceCache.h"
 #include "../IO/Serializer.h"
 #include "../Graphics/VertexBuffer.h"
 
@@ -59,7 +64,11 @@ unsigned LookupIndexBuffer(IndexBuffer* buffer, const Vector<SharedPtr<IndexBuff
 }
 
 Model::Model(Context* context) :
-    Resource(context)
+    Resource(context),
+    loadStep_(0),
+    cpuDataUsers_(0),
+    releaseCPUData_(false),
+    cpuDataReleased_(false)
 {
 }
 
@@ -87,6 +96,8 @@ bool Model::BeginLoad(Deserializer& source)
     morphs_.Clear();
     vertexBuffers_.Clear();
     indexBuffers_.Clear();
+    loadStep_ = 0;
+    cpuDataReleased_ = false;
     
     unsigned memoryUse = sizeof(Model);
     bool async = GetAsyncLoadState() == ASYNC_LOADING;
@@ -292,32 +303,52 @@ bool Model::BeginLoad(Deserializer& source)
 
 bool Model::EndLoad()
 {
-    // Upload vertex buffer data
-    for (unsigned i = 0; i < vertexBuffers_.Size(); ++i)
+    // Run the remaining steps, possibly continuing an incremental finish
+    bool finished = false;
+    while (!finished)
+        EndLoadStep(finished);
+    
+    return true;
+}
+
+bool Model::EndLoadStep(bool& finished)
+{
+    finished = false;
+    
+    // Upload one vertex buffer's data
+    if (loadStep_ < vertexBuffers_.Size())
     {
-        VertexBuffer* buffer = vertexBuffers_[i];
-        VertexBufferDesc& desc = loadVBData_[i];
+        VertexBuffer* buffer = vertexBuffers_[loadStep_];
+        VertexBufferDesc& desc = loadVBData_[loadStep_];
         if (desc.data_)
         {
             buffer->SetShadowed(true);
             buffer->SetSize(desc.vertexCount_, desc.elementMask_);
             buffer->SetData(desc.data_.Get());
+            // Release the staging copy now, as the buffer is shadowed
+            desc.data_.Reset();
         }
+        ++loadStep_;
+        return true;
     }
-
-    // Upload index buffer data
-    for (unsigned i = 0; i < indexBuffers_.Size(); ++i)
+    
+    // Upload one index buffer's data
+    unsigned ibIndex = loadStep_ - vertexBuffers_.Size();
+    if (ibIndex < indexBuffers_.Size())
     {
-        IndexBuffer* buffer = indexBuffers_[i];
-        IndexBufferDesc& desc = loadIBData_[i];
+        IndexBuffer* buffer = indexBuffers_[ibIndex];
+        IndexBufferDesc& desc = loadIBData_[ibIndex];
         if (desc.data_)
         {
             buffer->SetShadowed(true);
             buffer->SetSize(desc.indexCount_, desc.indexSize_ > sizeof(unsigned short));
             buffer->SetData(desc.data_.Get());
+            desc.data_.Reset();
         }
+        ++loadStep_;
+        return true;
     }
-
+    
     // Set up geometries
     for (unsigned i = 0; i < geometries_.Size(); ++i)
     {
@@ -328,17 +359,34 @@ bool Model::EndLoad()
             geometry->SetVertexBuffer(0, vertexBuffers_[desc.vbRef_]);
             geometry->SetIndexBuffer(indexBuffers_[desc.ibRef_]);
             geometry->SetDrawRange(desc.type_, desc.indexStart_, desc.indexCount_);
+            geometry->SetTriangleBVHEnabled(true);
         }
     }
 
     loadVBData_.Clear();
     loadIBData_.Clear();
     loadGeometries_.Clear();
+    loadStep_ = 0;
+    
+    // Drop the CPU-side copies now that the data is on the GPU, if so configured
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (renderer && renderer->GetReleaseModelCPUData())
+        SetReleaseCPUData(true);
+    if (releaseCPUData_ && !cpuDataUsers_)
+        ReleaseCPUData();
+    
+    finished = true;
     return true;
 }
 
 bool Model::Save(Serializer& dest) const
 {
+    if (!const_cast<Model*>(this)->RequestCPUData())
+    {
+        LOGERROR("Can not save model " + GetName() + " without CPU-side geometry data");
+        return false;
+    }
+    
     // Write ID
     if (!dest.WriteFileID("UMDL"))
         return false;
@@ -449,6 +497,7 @@ bool Model::SetVertexBuffers(const Vector<SharedPtr<VertexBuffer> >& buffers, co
         }
     }
     
+    KeepCPUData();
     vertexBuffers_ = buffers;
     morphRangeStarts_.Resize(buffers.Size());
     morphRangeCounts_.Resize(buffers.Size());
@@ -479,6 +528,7 @@ bool Model::SetIndexBuffers(const Vector<SharedPtr<IndexBuffer> >& buffers)
         }
     }
     
+    KeepCPUData();
     indexBuffers_ = buffers;
     return true;
 }
@@ -555,11 +605,73 @@ void Model::SetGeometryBoneMappings(const Vector<PODVector<unsigned> >& geometry
 
 void Model::SetMorphs(const Vector<ModelMorph>& morphs)
 {
+    // Morphing reads the original vertex data every time
+    if (!morphs.Empty())
+        KeepCPUData();
     morphs_ = morphs;
 }
 
+void Model::SetReleaseCPUData(bool enable)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    if (enable && (!morphs_.Empty() || !GetSubsystem<Graphics>() || !cache || !cache->Exists(GetName())))
+        enable = false;
+    
+    if (enable == releaseCPUData_)
+        return;
+    
+    releaseCPUData_ = enable;
+    if (releaseCPUData_)
+        SubscribeToEvent(E_DEVICERESET, HANDLER(Model, HandleDeviceReset));
+    else
+    {
+        UnsubscribeFromEvent(E_DEVICERESET);
+        if (cpuDataReleased_)
+            ReloadCPUData(false);
+    }
+    
+    // Release at the end of the frame, so that the data can still be read during it
+    if (releaseCPUData_ && !cpuDataUsers_ && !cpuDataReleased_)
+        SubscribeToEvent(E_ENDFRAME, HANDLER(Model, HandleEndFrame));
+}
+
+bool Model::RequestCPUData()
+{
+    if (!cpuDataReleased_)
+        return true;
+    
+    if (!ReloadCPUData(false))
+        return false;
+    
+    if (!cpuDataUsers_)
+        SubscribeToEvent(E_ENDFRAME, HANDLER(Model, HandleEndFrame));
+    return true;
+}
+
+bool Model::AddCPUDataUser()
+{
+    ++cpuDataUsers_;
+    return RequestCPUData();
+}
+
+void Model::RemoveCPUDataUser()
+{
+    if (!cpuDataUsers_)
+    {
+        LOGWARNING("Model " + GetName() + " has no CPU-side data users to remove");
+        return;
+    }
+    
+    --cpuDataUsers_;
+    if (!cpuDataUsers_ && releaseCPUData_ && !cpuDataReleased_)
+        SubscribeToEvent(E_ENDFRAME, HANDLER(Model, HandleEndFrame));
+}
+
 SharedPtr<Model> Model::Clone(const String& cloneName) const
 {
+    // The buffers are copied from their CPU-side data
+    const_cast<Model*>(this)->RequestCPUData();
+    
     SharedPtr<Model> ret(new Model(context_));
 
     ret->SetName(cloneName);
@@ -649,6 +761,7 @@ SharedPtr<Model> Model::Clone(const String& cloneName) const
                 cloneGeometry->SetDrawRange(origGeometry->GetPrimitiveType(), origGeometry->GetIndexStart(),
                     origGeometry->GetIndexCount(), origGeometry->GetVertexStart(), origGeometry->GetVertexCount(), false);
                 cloneGeometry->SetLodDistance(origGeometry->GetLodDistance());
+                cloneGeometry->SetTriangleBVHEnabled(origGeometry->IsTriangleBVHEnabled());
             }
             
             ret->geometries_[i][j] = cloneGeometry;
@@ -724,4 +837,117 @@ unsigned Model::GetMorphRangeCount(unsigned bufferIndex) const
     return bufferIndex < vertexBuffers_.Size() ? morphRangeCounts_[bufferIndex] : 0;
 }
 
+void Model::ReleaseCPUData()
+{
+    for (unsigned i = 0; i < vertexBuffers_.Size(); ++i)
+        vertexBuffers_[i]->SetShadowed(false);
+    for (unsigned i = 0; i < indexBuffers_.Size(); ++i)
+        indexBuffers_[i]->SetShadowed(false);
+    
+    cpuDataReleased_ = true;
+}
+
+bool Model::ReloadCPUData(bool upload)
+{
+    PROFILE(ReloadModelData);
+    
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    SharedPtr<File> file = cache ? cache->GetFile(GetName()) : SharedPtr<File>();
+    if (!file || file->ReadFileID() != "UMDL")
+    {
+        LOGERROR("Could not re-read CPU-side geometry data of model " + GetName());
+        return false;
+    }
+    
+    // The vertex and index buffers are stored first in the file. Check that they still match the buffers
+    bool valid = file->ReadUInt() == vertexBuffers_.Size();
+    for (unsigned i = 0; i < vertexBuffers_.Size() && valid; ++i)
+    {
+        VertexBuffer* buffer = vertexBuffers_[i];
+        unsigned vertexCount = file->ReadUInt();
+        unsigned elementMask = file->ReadUInt();
+        // Skip the morph range
+        file->ReadUInt();
+        file->ReadUInt();
+        
+        unsigned dataSize = vertexCount * buffer->GetVertexSize();
+        valid = vertexCount == buffer->GetVertexCount() && elementMask == buffer->GetElementMask();
+        if (valid)
+        {
+            buffer->SetShadowed(true);
+            valid = file->Read(buffer->GetShadowData(), dataSize) == dataSize;
+        }
+        if (valid && upload && dataSize)
+        {
+            buffer->SetData(buffer->GetShadowData());
+            buffer->ClearDataLost();
+        }
+    }
+    
+    valid = valid && file->ReadUInt() == indexBuffers_.Size();
+    for (unsigned i = 0; i < indexBuffers_.Size() && valid; ++i)
+    {
+        IndexBuffer* buffer = indexBuffers_[i];
+        unsigned indexCount = file->ReadUInt();
+        unsigned indexSize = file->ReadUInt();
+        
+        unsigned dataSize = indexCount * indexSize;
+        valid = indexCount == buffer->GetIndexCount() && indexSize == buffer->GetIndexSize();
+        if (valid)
+        {
+            buffer->SetShadowed(true);
+            valid = file->Read(buffer->GetShadowData(), dataSize) == dataSize;
+        }
+        if (valid && upload && dataSize)
+        {
+            buffer->SetData(buffer->GetShadowData());
+            buffer->ClearDataLost();
+        }
+    }
+    
+    if (!valid)
+    {
+        LOGERROR("Resource file of model " + GetName() + " no longer matches its buffers, could not re-read CPU-side geometry data");
+        // Drop any partially read data
+        ReleaseCPUData();
+        return false;
+    }
+    
+    cpuDataReleased_ = false;
+    return true;
+}
+
+void Model::KeepCPUData()
+{
+    if (cpuDataReleased_)
+        ReloadCPUData(false);
+    
+    releaseCPUData_ = false;
+    UnsubscribeFromEvent(E_DEVICERESET);
+}
+
+void Model::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    UnsubscribeFromEvent(E_ENDFRAME);
+    
+    if (releaseCPUData_ && !cpuDataUsers_ && !cpuDataReleased_)
+        ReleaseCPUData();
+}
+
+void Model::HandleDeviceReset(StringHash eventType, VariantMap& eventData)
+{
+    // Shadowed buffers restore their contents by themselves
+    if (!cpuDataReleased_)
+        return;
+    
+    bool dataLost = false;
+    for (unsigned i = 0; i < vertexBuffers_.Size(); ++i)
+        dataLost |= vertexBuffers_[i]->IsDataLost();
+    for (unsigned i = 0; i < indexBuffers_.Size(); ++i)
+        dataLost |= indexBuffers_[i]->IsDataLost();
+    
+    if (dataLost && ReloadCPUData(true))
+        ReleaseCPUData();
+}
+
 }
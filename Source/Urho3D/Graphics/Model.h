@@ -121,6 +121,8 @@ public:
     virtual bool BeginLoad(Deserializer& source);
     /// Finish resource loading. Always called from the main thread. Return true if successful.
     virtual bool EndLoad();
+    /// Perform one step of finishing background loading: upload one vertex or index buffer, or set up the geometries. Always called from the main thread.
+    virtual bool EndLoadStep(bool& finished);
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
     
@@ -146,6 +148,14 @@ public:
     void SetMorphs(const Vector<ModelMorph>& morphs);
     /// Clone the model. The geometry data is deep-copied and can be modified in the clone without affecting the original.
     SharedPtr<Model> Clone(const String& cloneName = String::EMPTY) const;
+    /// Set whether to release the CPU-side vertex and index data while it has no users. Released data is re-read from the resource file on demand. Models with vertex morphs or without a resource file always keep the data.
+    void SetReleaseCPUData(bool enable);
+    /// Make sure the CPU-side vertex and index data is available, re-reading it from the resource file if it has been released. Unless the data has users, it is released again at the end of the frame. Return true if available.
+    bool RequestCPUData();
+    /// Register a user that needs the CPU-side vertex and index data to stay available, for example an occluder. Return true if available.
+    bool AddCPUDataUser();
+    /// Unregister a user of the CPU-side vertex and index data. The data is released at the end of the frame when the last user is removed.
+    void RemoveCPUDataUser();
     
     /// Return bounding box.
     const BoundingBox& GetBoundingBox() const { return boundingBox_; }
@@ -183,8 +193,26 @@ public:
     unsigned GetMorphRangeStart(unsigned bufferIndex) const;
     /// Return vertex buffer morph range vertex count.
     unsigned GetMorphRangeCount(unsigned bufferIndex) const;
+    /// Return whether releases the CPU-side vertex and index data while it has no users.
+    bool GetReleaseCPUData() const { return releaseCPUData_; }
+    /// Return whether the CPU-side vertex and index data is currently available.
+    bool HasCPUData() const { return !cpuDataReleased_; }
+    /// Return number of registered CPU-side data users.
+    unsigned GetNumCPUDataUsers() const { return cpuDataUsers_; }
     
 private:
+    /// Release the CPU-side data of the vertex and index buffers.
+    void ReleaseCPUData();
+    /// Re-read the vertex and index data from the resource file, optionally uploading it to the GPU buffers again. Return true if successful.
+    bool ReloadCPUData(bool upload);
+    /// Stop releasing the CPU-side data before the buffers are modified, as they no longer match the resource file.
+    void KeepCPUData();
+    /// Handle end of frame. Release the CPU-side data if it has no users.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+    /// Handle graphics device reset. Restore lost buffer contents from the resource file.
+    void HandleDeviceReset(StringHash eventType, VariantMap& eventData);
+    
+
     /// Bounding box.
     BoundingBox boundingBox_;
     /// Skeleton.
@@ -211,6 +239,14 @@ private:
     Vector<IndexBufferDesc> loadIBData_;
     /// Geometry definitions for asynchronous loading.
     Vector<PODVector<GeometryDesc> > loadGeometries_;
+    /// Next step of incremental EndLoad.
+    unsigned loadStep_;
+    /// Number of registered CPU-side data users.
+    unsigned cpuDataUsers_;
+    /// Release CPU-side data flag.
+    bool releaseCPUData_;
+    /// CPU-side data released flag.
+    bool cpuDataReleased_;
 };
 
 }
@@ -21,8 +21,11 @@
 //
 
 #include "../Graphics/Camera.h"
+#include "../Core/Timer.h"
 #include "../IO/Log.h"
 #include "../Graphics/OcclusionBuffer.h"
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 
 #include <cstring>
 
@@ -38,6 +41,14 @@ static const unsigned CLIPMASK_Y_NEG = 0x8;
 static const unsigned CLIPMASK_Z_POS = 0x10;
 static const unsigned CLIPMASK_Z_NEG = 0x20;
 
+void RasterizeOcclusionBandWork(const WorkItem* item, unsigned threadIndex)
+{
+    OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+    PODVector<unsigned>* band = reinterpret_cast<PODVector<unsigned>*>(item->start_);
+
+    buffer->DrawBand(band - &buffer->bandTriangles_[0]);
+}
+
 OcclusionBuffer::OcclusionBuffer(Context* context) :
     Object(context),
     buffer_(0),
@@ -48,8 +59,11 @@ OcclusionBuffer::OcclusionBuffer(Context* context) :
     cullMode_(CULL_CCW),
     depthHierarchyDirty_(true),
     reverseCulling_(false),
+    temporal_(false),
+    hasReprojection_(false),
     nearClip_(0.0f),
-    farClip_(0.0f)
+    farClip_(0.0f),
+    historyFrameNumber_(0)
 {
 }
 
@@ -95,6 +109,17 @@ bool OcclusionBuffer::SetSize(int width, int height)
             break;
     }
     
+    // The previous frame depth can not be reprojected after a size change
+    historyBuffer_.Reset();
+    reprojectionBuffer_.Reset();
+    historyCamera_.Reset();
+    hasReprojection_ = false;
+    
+    // Split the rows into bands that can be rasterized in parallel
+    pendingTriangles_.Clear();
+    bandTriangles_.Clear();
+    bandTriangles_.Resize((height_ + OCCLUSION_BAND_HEIGHT - 1) / OCCLUSION_BAND_HEIGHT);
+    
     LOGDEBUG("Set occlusion buffer size " + String(width_) + "x" + String(height_) + " with " + 
         String(mipBuffers_.Size()) + " mip levels");
     
@@ -107,6 +132,7 @@ void OcclusionBuffer::SetView(Camera* camera)
     if (!camera)
         return;
     
+    camera_ = camera;
     view_ = camera->GetView();
     projection_ = camera->GetProjection(false);
     viewProj_ = projection_ * view_;
@@ -133,6 +159,19 @@ void OcclusionBuffer::SetCullMode(CullMode mode)
     cullMode_ = mode;
 }
 
+void OcclusionBuffer::SetTemporal(bool enable)
+{
+    temporal_ = enable;
+    
+    if (!temporal_)
+    {
+        historyBuffer_.Reset();
+        reprojectionBuffer_.Reset();
+        historyCamera_.Reset();
+        hasReprojection_ = false;
+    }
+}
+
 void OcclusionBuffer::Reset()
 {
     numTriangles_ = 0;
@@ -145,6 +184,10 @@ void OcclusionBuffer::Clear()
     
     Reset();
     
+    pendingTriangles_.Clear();
+    for (unsigned i = 0; i < bandTriangles_.Size(); ++i)
+        bandTriangles_[i].Clear();
+    
     int* dest = buffer_;
     int count = width_ * height_;
     
@@ -152,6 +195,15 @@ void OcclusionBuffer::Clear()
         *dest++ = 0x7fffffff;
     
     depthHierarchyDirty_ = true;
+    hasReprojection_ = false;
+    
+    // Reproject only the depth of the immediately preceding frame from the same camera
+    if (temporal_ && historyCamera_ && historyCamera_ == camera_)
+    {
+        Time* time = GetSubsystem<Time>();
+        if (time && historyFrameNumber_ + 1 == time->GetFrameNumber())
+            Reproject();
+    }
 }
 
 bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount)
@@ -183,6 +235,9 @@ bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsig
         index += 3;
     }
     
+    if (pendingTriangles_.Size() >= OCCLUSION_BATCH_TRIANGLES)
+        DrawTriangles();
+    
     return true;
 }
 
@@ -243,14 +298,84 @@ bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsig
         }
     }
     
+    if (pendingTriangles_.Size() >= OCCLUSION_BATCH_TRIANGLES)
+        DrawTriangles();
+    
     return true;
 }
 
+void OcclusionBuffer::DrawTriangles()
+{
+    if (pendingTriangles_.Empty())
+        return;
+    
+    PROFILE(RasterizeOcclusion);
+    
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() && bandTriangles_.Size() > 1)
+    {
+        // The bands do not share rows. Depth is written as a minimum, so the result does not depend on triangle order
+        for (unsigned i = 0; i < bandTriangles_.Size(); ++i)
+        {
+            if (bandTriangles_[i].Empty())
+                continue;
+            
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RasterizeOcclusionBandWork;
+            item->aux_ = this;
+            item->start_ = &bandTriangles_[i];
+            queue->AddWorkItem(item);
+        }
+        
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (unsigned i = 0; i < bandTriangles_.Size(); ++i)
+            DrawBand(i);
+    }
+    
+    pendingTriangles_.Clear();
+    for (unsigned i = 0; i < bandTriangles_.Size(); ++i)
+        bandTriangles_[i].Clear();
+}
+
 void OcclusionBuffer::BuildDepthHierarchy()
 {
     if (!buffer_)
         return;
     
+    DrawTriangles();
+    
+    if (temporal_)
+    {
+        // Store the depth of the occluders before merging in the reprojection, so that depth from moved occluders does
+        // not carry over to later frames
+        if (!historyBuffer_)
+            historyBuffer_ = new int[width_ * height_];
+        memcpy(historyBuffer_.Get(), buffer_, width_ * height_ * sizeof(int));
+        historyScreenProj_ = GetScreenProjection();
+        historyCamera_ = camera_;
+        Time* time = GetSubsystem<Time>();
+        historyFrameNumber_ = time ? time->GetFrameNumber() : 0;
+        
+        if (hasReprojection_)
+        {
+            int* dest = buffer_;
+            int* src = reprojectionBuffer_.Get();
+            int count = width_ * height_;
+            
+            while (count--)
+            {
+                if (*src < *dest)
+                    *dest = *src;
+                ++dest;
+                ++src;
+            }
+        }
+    }
+    
     // Build the first mip level from the pixel-level data
     int width = (width_ + 1) / 2;
     int height = (height_ + 1) / 2;
@@ -455,6 +580,30 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
     // If no conclusive result, finally check the pixel-level data
     int* row = buffer_ + rect.top_ * width_;
     int* endRow = buffer_ + rect.bottom_ * width_;
+    
+    // Until the depth hierarchy is built, the reprojected depth has not yet been merged to the buffer
+    if (hasReprojection_ && depthHierarchyDirty_)
+    {
+        int* reprojectedRow = reprojectionBuffer_.Get() + rect.top_ * width_;
+        while (row <= endRow)
+        {
+            int* src = row + rect.left_;
+            int* end = row + rect.right_;
+            int* reprojected = reprojectedRow + rect.left_;
+            while (src <= end)
+            {
+                if (z <= *src && z <= *reprojected)
+                    return true;
+                ++src;
+                ++reprojected;
+            }
+            row += width_;
+            reprojectedRow += width_;
+        }
+        
+        return false;
+    }
+    
     while (row <= endRow)
     {
         int* src = row + rect.left_;
@@ -522,6 +671,72 @@ void OcclusionBuffer::CalculateViewport()
     projOffsetScaleY_ = projection_.m11_ * scaleY_;
 }
 
+Matrix4 OcclusionBuffer::GetScreenProjection() const
+{
+    Matrix4 viewport(
+        scaleX_, 0.0f, 0.0f, offsetX_,
+        0.0f, scaleY_, 0.0f, offsetY_,
+        0.0f, 0.0f, OCCLUSION_Z_SCALE, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
+    
+    return viewport * viewProj_;
+}
+
+void OcclusionBuffer::Reproject()
+{
+    PROFILE(ReprojectOcclusion);
+    
+    if (!reprojectionBuffer_)
+        reprojectionBuffer_ = new int[width_ * height_];
+    
+    int* dest = reprojectionBuffer_.Get();
+    int count = width_ * height_;
+    while (count--)
+        *dest++ = 0x7fffffff;
+    
+    // Transform from the previous screen space directly to the current. The depth buffer stores Z / W, so each pixel
+    // is unprojected from its center at its stored depth
+    Matrix4 transform = GetScreenProjection() * historyScreenProj_.Inverse();
+    Vector4 xStep(transform.m00_, transform.m10_, transform.m20_, transform.m30_);
+    Vector4 zStep(transform.m02_, transform.m12_, transform.m22_, transform.m32_);
+    
+    for (int y = 0; y < height_; ++y)
+    {
+        const int* src = historyBuffer_.Get() + y * width_;
+        Vector4 rowStart = transform * Vector4(0.5f, (float)y + 0.5f, 0.0f, 1.0f);
+        
+        for (int x = 0; x < width_; ++x)
+        {
+            int depth = src[x];
+            // Pixels not covered by the occluders can not occlude anything
+            if (depth == 0x7fffffff)
+                continue;
+            
+            Vector4 projected = rowStart + xStep * (float)x + zStep * (float)depth;
+            // Reject points behind the camera
+            if (projected.w_ <= 0.0f)
+                continue;
+            
+            float invW = 1.0f / projected.w_;
+            float destX = projected.x_ * invW;
+            float destY = projected.y_ * invW;
+            float destZ = projected.z_ * invW;
+            if (destX < 0.0f || destY < 0.0f || destX >= (float)width_ || destY >= (float)height_ || destZ <= 0.0f ||
+                destZ >= OCCLUSION_Z_SCALE)
+                continue;
+            
+            // Push the depth back by the fixed bias to compensate for precision loss in the transform
+            int newDepth = (int)destZ + OCCLUSION_FIXED_BIAS;
+            int* pixel = reprojectionBuffer_.Get() + (int)destY * width_ + (int)destX;
+            if (newDepth < *pixel)
+                *pixel = newDepth;
+        }
+    }
+    
+    hasReprojection_ = true;
+}
+
 void OcclusionBuffer::DrawTriangle(Vector4* vertices)
 {
     unsigned clipMask = 0;
@@ -569,7 +784,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices)
         bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
         if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
         {
-            DrawTriangle2D(projected, clockwise);
+            AddTriangle(projected, clockwise);
             drawOk = true;
         }
     }
@@ -607,7 +822,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices)
                 bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
                 if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
                 {
-                    DrawTriangle2D(projected, clockwise);
+                    AddTriangle(projected, clockwise);
                     drawOk = true;
                 }
             }
@@ -618,6 +833,42 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices)
         ++numTriangles_;
 }
 
+void OcclusionBuffer::AddTriangle(const Vector3* vertices, bool clockwise)
+{
+    // Use the same row range as DrawTriangle2D()
+    float minY = Min(Min(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+    float maxY = Max(Max(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+    int topY = Max((int)minY, 0);
+    int bottomY = Min((int)maxY, height_);
+    if (topY >= bottomY)
+        return;
+    
+    unsigned index = pendingTriangles_.Size();
+    pendingTriangles_.Resize(index + 1);
+    OcclusionTriangle& triangle = pendingTriangles_[index];
+    triangle.vertices_[0] = vertices[0];
+    triangle.vertices_[1] = vertices[1];
+    triangle.vertices_[2] = vertices[2];
+    triangle.clockwise_ = clockwise;
+    
+    int lastBand = (bottomY - 1) / OCCLUSION_BAND_HEIGHT;
+    for (int i = topY / OCCLUSION_BAND_HEIGHT; i <= lastBand; ++i)
+        bandTriangles_[i].Push(index);
+}
+
+void OcclusionBuffer::DrawBand(unsigned index)
+{
+    const PODVector<unsigned>& triangles = bandTriangles_[index];
+    int minY = index * OCCLUSION_BAND_HEIGHT;
+    int maxY = Min(minY + OCCLUSION_BAND_HEIGHT, height_);
+    
+    for (PODVector<unsigned>::ConstIterator i = triangles.Begin(); i != triangles.End(); ++i)
+    {
+        const OcclusionTriangle& triangle = pendingTriangles_[*i];
+        DrawTriangle2D(triangle.vertices_, triangle.clockwise_, minY, maxY);
+    }
+}
+
 void OcclusionBuffer::ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles)
 {
     unsigned num = numTriangles;
@@ -748,7 +999,97 @@ struct Edge
     int invZStep_;
 };
 
-void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise)
+/// Draw the rows between a left edge, which also interpolates depth, and a right edge. Rows outside the minimum (inclusive) and maximum (exclusive) Y are skipped, but the edges are always stepped to the end row.
+static void DrawSpans(int* buffer, int width, Edge& left, Edge& right, int startY, int endY, int minY, int maxY, int dInvZdX)
+{
+    int y = startY;
+    int stopY = Min(endY, maxY);
+    
+    // Skip rows above the band
+    if (y < minY)
+    {
+        int skip = Min(minY, endY) - y;
+        left.x_ += left.xStep_ * skip;
+        left.invZ_ += left.invZStep_ * skip;
+        right.x_ += right.xStep_ * skip;
+        y += skip;
+    }
+    
+    while (y < stopY)
+    {
+        int* row = buffer + y * width;
+        int startX = left.x_ >> 16;
+        int endX = right.x_ >> 16;
+        int invZ = left.invZ_;
+        
+        // Do not let inexact clipping spill over to the neighbour rows, which may belong to another band
+        if (startX < 0)
+        {
+            invZ += dInvZdX * -startX;
+            startX = 0;
+        }
+        if (endX > width)
+            endX = width;
+        
+        int* dest = row + startX;
+        int* end = row + endX;
+        
+        #if defined(URHO3D_SIMD_SSE2)
+        if (end - dest >= 4)
+        {
+            __m128i z = _mm_set_epi32(invZ + 3 * dInvZdX, invZ + 2 * dInvZdX, invZ + dInvZdX, invZ);
+            __m128i zStep = _mm_set1_epi32(4 * dInvZdX);
+            while (end - dest >= 4)
+            {
+                __m128i depth = _mm_loadu_si128((__m128i*)dest);
+                __m128i closer = _mm_cmplt_epi32(z, depth);
+                _mm_storeu_si128((__m128i*)dest, _mm_or_si128(_mm_and_si128(closer, z), _mm_andnot_si128(closer, depth)));
+                z = _mm_add_epi32(z, zStep);
+                invZ += 4 * dInvZdX;
+                dest += 4;
+            }
+        }
+        #elif defined(URHO3D_SIMD_NEON)
+        if (end - dest >= 4)
+        {
+            int32x4_t z = vsetq_lane_s32(invZ + 3 * dInvZdX, vsetq_lane_s32(invZ + 2 * dInvZdX, vsetq_lane_s32(invZ + dInvZdX,
+                vdupq_n_s32(invZ), 1), 2), 3);
+            int32x4_t zStep = vdupq_n_s32(4 * dInvZdX);
+            while (end - dest >= 4)
+            {
+                vst1q_s32(dest, vminq_s32(z, vld1q_s32(dest)));
+                z = vaddq_s32(z, zStep);
+                invZ += 4 * dInvZdX;
+                dest += 4;
+            }
+        }
+        #endif
+        
+        while (dest < end)
+        {
+            if (invZ < *dest)
+                *dest = invZ;
+            invZ += dInvZdX;
+            ++dest;
+        }
+        
+        left.x_ += left.xStep_;
+        left.invZ_ += left.invZStep_;
+        right.x_ += right.xStep_;
+        ++y;
+    }
+    
+    // Step the edges past rows below the band, as the left edge may continue to the bottom half of the triangle
+    if (y < endY)
+    {
+        int skip = endY - y;
+        left.x_ += left.xStep_ * skip;
+        left.invZ_ += left.invZStep_ * skip;
+        right.x_ += right.xStep_ * skip;
+    }
+}
+
+void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, int minY, int maxY)
 {
     int top, middle, bottom;
     bool middleIsRight;
@@ -818,95 +1159,13 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise)
     
     if (middleIsRight)
     {
-        // Top half
-        int* row = buffer_ + topY * width_;
-        int* endRow = buffer_ + middleY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (topToMiddle.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            topToMiddle.x_ += topToMiddle.xStep_;
-            row += width_;
-        }
-        
-        // Bottom half
-        row = buffer_ + middleY * width_;
-        endRow = buffer_ + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (middleToBottom.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            middleToBottom.x_ += middleToBottom.xStep_;
-            row += width_;
-        }
+        DrawSpans(buffer_, width_, topToBottom, topToMiddle, topY, middleY, minY, maxY, gradients.dInvZdXInt_);
+        DrawSpans(buffer_, width_, topToBottom, middleToBottom, middleY, bottomY, minY, maxY, gradients.dInvZdXInt_);
     }
     else
     {
-        // Top half
-        int* row = buffer_ + topY * width_;
-        int* endRow = buffer_ + middleY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToMiddle.invZ_;
-            int* dest = row + (topToMiddle.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            topToMiddle.x_ += topToMiddle.xStep_;
-            topToMiddle.invZ_ += topToMiddle.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
-        }
-        
-        // Bottom half
-        row = buffer_ + middleY * width_;
-        endRow = buffer_ + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = middleToBottom.invZ_;
-            int* dest = row + (middleToBottom.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            middleToBottom.x_ += middleToBottom.xStep_;
-            middleToBottom.invZ_ += middleToBottom.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
-        }
+        DrawSpans(buffer_, width_, topToMiddle, topToBottom, topY, middleY, minY, maxY, gradients.dInvZdXInt_);
+        DrawSpans(buffer_, width_, middleToBottom, topToBottom, middleY, bottomY, minY, maxY, gradients.dInvZdXInt_);
     }
 }
 
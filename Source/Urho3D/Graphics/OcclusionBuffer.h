@@ -38,6 +38,7 @@ class IntRect;
 class VertexBuffer;
 struct Edge;
 struct Gradients;
+struct WorkItem;
 
 /// Occlusion hierarchy depth range.
 struct DepthValue
@@ -48,18 +49,31 @@ struct DepthValue
     int max_;
 };
 
+/// Projected triangle waiting for rasterization.
+struct OcclusionTriangle
+{
+    /// Screen space vertices.
+    Vector3 vertices_[3];
+    /// Clockwise winding flag.
+    bool clockwise_;
+};
+
 static const int OCCLUSION_MIN_SIZE = 8;
 static const int OCCLUSION_DEFAULT_MAX_TRIANGLES = 5000;
 static const float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static const int OCCLUSION_FIXED_BIAS = 16;
 static const float OCCLUSION_X_SCALE = 65536.0f;
 static const float OCCLUSION_Z_SCALE = 16777216.0f;
+static const int OCCLUSION_BAND_HEIGHT = 16;
+static const unsigned OCCLUSION_BATCH_TRIANGLES = 256;
 
 /// Software renderer for occlusion.
 class URHO3D_API OcclusionBuffer : public Object
 {
     OBJECT(OcclusionBuffer);
     
+    friend void RasterizeOcclusionBandWork(const WorkItem* item, unsigned threadIndex);
+    
 public:
     /// Construct.
     OcclusionBuffer(Context* context);
@@ -74,6 +88,8 @@ public:
     void SetMaxTriangles(unsigned triangles);
     /// Set culling mode.
     void SetCullMode(CullMode mode);
+    /// Set whether to reproject the previous frame's depth into the buffer when cleared, if it was rendered from the same camera.
+    void SetTemporal(bool enable);
     /// Reset number of triangles.
     void Reset();
     /// Clear the buffer.
@@ -82,7 +98,9 @@ public:
     bool Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
     /// Draw a triangle mesh to the buffer using indexed geometry.
     bool Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount);
-    /// Build reduced size mip levels.
+    /// Rasterize the triangles submitted by Draw() in horizontal bands using worker threads. Called automatically when enough triangles are waiting, and by BuildDepthHierarchy().
+    void DrawTriangles();
+    /// Rasterize waiting triangles and build reduced size mip levels.
     void BuildDepthHierarchy();
     /// Reset last used timer.
     void ResetUseTimer();
@@ -103,7 +121,13 @@ public:
     unsigned GetMaxTriangles() const { return maxTriangles_; }
     /// Return culling mode.
     CullMode GetCullMode() const { return cullMode_; }
-    /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
+    /// Return whether previous frame depth reprojection is enabled.
+    bool GetTemporal() const { return temporal_; }
+    /// Return whether the buffer contains reprojected depth from the previous frame.
+    bool HasReprojection() const { return hasReprojection_; }
+    /// Return the camera whose depth was stored for reprojection on the next frame.
+    Camera* GetHistoryCamera() const { return historyCamera_; }
+    /// Test a bounding box for visibility. For best performance, build depth hierarchy first. Triangles still waiting for rasterization are not taken into account.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
@@ -119,12 +143,20 @@ private:
     inline float SignedArea(const Vector3& v0, const Vector3& v1, const Vector3& v2) const;
     /// Calculate viewport transform.
     void CalculateViewport();
+    /// Return combined view, projection and viewport transform.
+    Matrix4 GetScreenProjection() const;
+    /// Reproject the stored depth of the previous frame into the reprojection buffer.
+    void Reproject();
     /// Draw a triangle.
     void DrawTriangle(Vector4* vertices);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise);
+    /// Queue a clipped triangle for rasterization into the bands it covers.
+    void AddTriangle(const Vector3* vertices, bool clockwise);
+    /// Rasterize the waiting triangles of a band.
+    void DrawBand(unsigned index);
+    /// Draw the rows of a clipped triangle that fall between minimum (inclusive) and maximum (exclusive) Y.
+    void DrawTriangle2D(const Vector3* vertices, bool clockwise, int minY, int maxY);
     
     /// Highest level depth buffer.
     int* buffer_;
@@ -142,6 +174,10 @@ private:
     bool depthHierarchyDirty_;
     /// Culling reverse flag.
     bool reverseCulling_;
+    /// Previous frame depth reprojection flag.
+    bool temporal_;
+    /// Reprojected depth in use flag.
+    bool hasReprojection_;
     /// View transform matrix.
     Matrix3x4 view_;
     /// Projection matrix.
@@ -170,6 +206,22 @@ private:
     SharedArrayPtr<int> fullBuffer_;
     /// Reduced size depth buffers.
     Vector<SharedArrayPtr<DepthValue> > mipBuffers_;
+    /// Previous frame depth rendered from the occluders only.
+    SharedArrayPtr<int> historyBuffer_;
+    /// Previous frame depth reprojected to the current view.
+    SharedArrayPtr<int> reprojectionBuffer_;
+    /// Combined view, projection and viewport transform of the previous frame.
+    Matrix4 historyScreenProj_;
+    /// Camera of the current view.
+    WeakPtr<Camera> camera_;
+    /// Camera of the previous frame depth.
+    WeakPtr<Camera> historyCamera_;
+    /// Frame number of the previous frame depth.
+    unsigned historyFrameNumber_;
+    /// Triangles waiting for rasterization.
+    PODVector<OcclusionTriangle> pendingTriangles_;
+    /// Indices of waiting triangles for each horizontal band.
+    Vector<PODVector<unsigned> > bandTriangles_;
 };
 
 }
@@ -32,6 +32,7 @@
 #include "../Container/Sort.h"
 #include "../Core/Timer.h"
 #include "../Core/WorkQueue.h"
+#include "../Graphics/Zone.h"
 
 #include "../DebugNew.h"
 
@@ -45,6 +46,19 @@ namespace Urho3D
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
 static const int RAYCASTS_PER_WORK_ITEM = 4;
+static const unsigned REINSERTIONS_PER_WORK_ITEM = 64;
+static const unsigned MIN_THREADED_REINSERTIONS = 256;
+static const unsigned DRAWABLE_UPDATE_ITEMS_PER_THREAD = 4;
+static const int ZONE_GRID_SIZE = 16;
+
+static const PODVector<Zone*> noZones;
+
+static const char* spatialIndexNames[] =
+{
+    "Octants",
+    "BVH",
+    0
+};
 
 extern const char* SUBSYSTEM_CATEGORY;
 
@@ -79,6 +93,16 @@ void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+void ReinsertDrawablesWork(const WorkItem* item, unsigned threadIndex)
+{
+    Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
+    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
+    unsigned index = start - &octree->drawableUpdates_[0];
+
+    octree->FindReinsertionTargets(index, index + (end - start));
+}
+
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -89,7 +113,8 @@ Octant::Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* r
     numDrawables_(0),
     parent_(parent),
     root_(root),
-    index_(index)
+    index_(index),
+    drawableBoxesDirty_(false)
 {
     Initialize(box);
 
@@ -101,6 +126,9 @@ Octant::~Octant()
 {
     if (root_)
     {
+        if (drawableBoxesDirty_)
+            root_->dirtyBoxOctants_.Remove(this);
+
         // Remove the drawables (if any) from this octant to the root octant
         for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
         {
@@ -108,6 +136,8 @@ Octant::~Octant()
             root_->drawables_.Push(*i);
             root_->QueueUpdate(*i);
         }
+        if (!drawables_.Empty())
+            root_->MarkDrawableBoxesDirty();
         drawables_.Clear();
         numDrawables_ = 0;
     }
@@ -153,35 +183,48 @@ void Octant::DeleteChild(unsigned index)
 
 void Octant::InsertDrawable(Drawable* drawable)
 {
-    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    Octant* octant = GetInsertionOctant(drawable, drawable->GetWorldBoundingBox(), true);
+    Octant* oldOctant = drawable->octant_;
+    if (oldOctant != octant)
+    {
+        // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+        octant->AddDrawable(drawable);
+        if (oldOctant)
+            oldOctant->RemoveDrawable(drawable, false);
+    }
+}
 
-    // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
-    // Also if drawable is outside the root octant bounds, insert to root
-    bool insertHere;
-    if (this == root_)
-        insertHere = !drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE || CheckDrawableFit(box);
-    else
-        insertHere = CheckDrawableFit(box);
+Octant* Octant::GetInsertionOctant(Drawable* drawable, const BoundingBox& box, bool create)
+{
+    Octant* octant = this;
 
-    if (insertHere)
+    for (;;)
     {
-        Octant* oldOctant = drawable->octant_;
-        if (oldOctant != this)
+        // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
+        // Also if drawable is outside the root octant bounds, insert to root. In bounding volume hierarchy mode all
+        // drawables are kept in the root
+        bool insertHere;
+        if (octant == root_ && root_->spatialIndex_ == SPATIAL_BVH)
+            insertHere = true;
+        else if (octant == root_)
         {
-            // Add first, then remove, because drawable count going to zero deletes the octree branch in question
-            AddDrawable(drawable);
-            if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+            insertHere = !drawable->IsOccludee() || octant->cullingBox_.IsInside(box) != INSIDE ||
+                octant->CheckDrawableFit(box);
         }
-    }
-    else
-    {
+        else
+            insertHere = octant->CheckDrawableFit(box);
+
+        if (insertHere)
+            return octant;
+
         Vector3 boxCenter = box.Center();
-        unsigned x = boxCenter.x_ < center_.x_ ? 0 : 1;
-        unsigned y = boxCenter.y_ < center_.y_ ? 0 : 2;
-        unsigned z = boxCenter.z_ < center_.z_ ? 0 : 4;
+        unsigned x = boxCenter.x_ < octant->center_.x_ ? 0 : 1;
+        unsigned y = boxCenter.y_ < octant->center_.y_ ? 0 : 2;
+        unsigned z = boxCenter.z_ < octant->center_.z_ ? 0 : 4;
 
-        GetOrCreateChild(x + y + z)->InsertDrawable(drawable);
+        if (!create && !octant->children_[x + y + z])
+            return octant;
+        octant = octant->GetOrCreateChild(x + y + z);
     }
 }
 
@@ -224,6 +267,56 @@ void Octant::ResetRoot()
     }
 }
 
+void Octant::MarkDrawableBoxesDirty()
+{
+    // In bounding volume hierarchy mode the root holds all drawables, so any change to them requires a rebuild
+    if (root_ && this == root_ && root_->spatialIndex_ == SPATIAL_BVH)
+        root_->bvhDirty_ = true;
+
+    if (!drawableBoxesDirty_ && root_)
+    {
+        drawableBoxesDirty_ = true;
+        root_->dirtyBoxOctants_.Push(this);
+    }
+}
+
+void Octant::MarkZonesDirty()
+{
+    if (root_)
+        root_->zonesDirty_ = true;
+}
+
+void Octant::UpdateDrawableBoxes()
+{
+    unsigned numDrawables = drawables_.Size();
+    unsigned numBlocks = (numDrawables + 3) / 4;
+    drawableBoxes_.Resize(numBlocks * FRUSTUM_BOX_BLOCK_SIZE);
+
+    for (unsigned i = 0; i < numBlocks * 4; ++i)
+    {
+        float* dest = &drawableBoxes_[(i / 4) * FRUSTUM_BOX_BLOCK_SIZE + (i & 3)];
+        Vector3 center;
+        Vector3 edge;
+
+        // Store center and half size the same way as Frustum::IsInsideFast() calculates them. Leave padding boxes empty
+        if (i < numDrawables)
+        {
+            const BoundingBox& box = drawables_[i]->GetWorldBoundingBox();
+            center = box.Center();
+            edge = center - box.min_;
+        }
+
+        dest[0] = center.x_;
+        dest[4] = center.y_;
+        dest[8] = center.z_;
+        dest[12] = edge.x_;
+        dest[16] = edge.y_;
+        dest[20] = edge.z_;
+    }
+
+    drawableBoxesDirty_ = false;
+}
+
 void Octant::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
 {
     if (debug && debug->IsInside(worldBoundingBox_))
@@ -264,7 +357,11 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         Drawable** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        // Use the batched bounding box test when this octant is partially visible and the boxes are up to date
+        if (!inside && !drawableBoxesDirty_)
+            query.TestDrawableBoxes(start, end, &drawableBoxes_[0]);
+        else
+            query.TestDrawables(start, end, inside);
     }
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
@@ -331,7 +428,10 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, 0, this),
-    numLevels_(DEFAULT_OCTREE_LEVELS)
+    numLevels_(DEFAULT_OCTREE_LEVELS),
+    spatialIndex_(SPATIAL_OCTANTS),
+    bvhDirty_(false),
+    zonesDirty_(false)
 {
     // Resize threaded ray query intermediate result vector according to number of worker threads
     WorkQueue* workQueue = GetSubsystem<WorkQueue>();
@@ -348,6 +448,7 @@ Octree::~Octree()
     // Reset root pointer from all child octants now so that they do not move their drawables to root
     drawableUpdates_.Clear();
     drawableReinsertions_.Clear();
+    dirtyBoxOctants_.Clear();
     ResetRoot();
 }
 
@@ -361,6 +462,8 @@ void Octree::RegisterObject(Context* context)
     ATTRIBUTE("Bounding Box Min", Vector3, worldBoundingBox_.min_, defaultBoundsMin, AM_DEFAULT);
     ATTRIBUTE("Bounding Box Max", Vector3, worldBoundingBox_.max_, defaultBoundsMax, AM_DEFAULT);
     ATTRIBUTE("Number of Levels", int, numLevels_, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    ENUM_ACCESSOR_ATTRIBUTE("Spatial Index", GetSpatialIndex, SetSpatialIndex, SpatialIndexType, spatialIndexNames,
+        SPATIAL_OCTANTS, AM_DEFAULT);
 }
 
 void Octree::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
@@ -377,6 +480,8 @@ void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
         PROFILE(OctreeDrawDebug);
 
         Octant::DrawDebugGeometry(debug, depthTest);
+        if (spatialIndex_ == SPATIAL_BVH)
+            bvh_.DrawDebugGeometry(debug, depthTest);
     }
 }
 
@@ -391,6 +496,32 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
     Initialize(box);
     numDrawables_ = drawables_.Size();
     numLevels_ = Max((int)numLevels, 1);
+    zonesDirty_ = true;
+}
+
+void Octree::SetSpatialIndex(SpatialIndexType type)
+{
+    if (type == spatialIndex_)
+        return;
+
+    spatialIndex_ = type;
+
+    // Move all drawables to the root
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+        DeleteChild(i);
+
+    bvh_.Clear();
+    bvhDirty_ = type == SPATIAL_BVH;
+
+    // When switching back to octants, the drawables need to be reinserted
+    if (type == SPATIAL_OCTANTS)
+    {
+        for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+        {
+            if (!(*i)->updateQueued_)
+                QueueUpdate(*i);
+        }
+    }
 }
 
 void Octree::Update(const FrameInfo& frame)
@@ -403,33 +534,9 @@ void Octree::Update(const FrameInfo& frame)
         // Perform updates in worker threads. Notify the scene that a threaded update is going on and components
         // (for example physics objects) should not perform non-threadsafe work when marked dirty
         Scene* scene = GetScene();
-        WorkQueue* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
         
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-        
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        UpdateDrawables(frame);
         scene->EndThreadedUpdate();
     }
     
@@ -451,35 +558,58 @@ void Octree::Update(const FrameInfo& frame)
     {
         PROFILE(ReinsertToOctree);
 
-        for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+        if (spatialIndex_ == SPATIAL_BVH)
         {
-            Drawable* drawable = *i;
-            drawable->updateQueued_ = false;
-            Octant* octant = drawable->GetOctant();
-            const BoundingBox& box = drawable->GetWorldBoundingBox();
-
-            // Skip if no octant or does not belong to this octree anymore
-            if (!octant || octant->GetRoot() != this)
-                continue;
-            // Skip if still fits the current octant
-            if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
-                continue;
-
-            InsertDrawable(drawable);
-
-            #ifdef _DEBUG
-            // Verify that the drawable will be culled correctly
-            octant = drawable->GetOctant();
-            if (octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
-            {
-                LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
-                    " octant box " + octant->GetCullingBox().ToString());
-            }
-            #endif
+            // In bounding volume hierarchy mode the drawables stay in the root, and the hierarchy is refitted below
+            for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+                (*i)->updateQueued_ = false;
         }
+        else
+            ReinsertDrawables();
+    }
+    
+    if (spatialIndex_ == SPATIAL_BVH && (bvhDirty_ || !drawableUpdates_.Empty()))
+    {
+        PROFILE(UpdateBVH);
+        
+        // Rebuild if drawables were added or removed, or if refitting the moved drawables degraded the hierarchy too much
+        if (bvhDirty_ || !bvh_.Refit(drawableUpdates_))
+        {
+            bvh_.Build(drawables_);
+            bvhDirty_ = false;
+        }
+    }
+    
+    // Record the update frame, so that drawables which have stayed unchanged can be recognized, for example for shadow caching.
+    // Also publish the changed regions, so that views can detect whether their contents have changed
+    changedBoxes_.Clear();
+    changedBoxes_.Swap(pendingChangedBoxes_);
+    for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+    {
+        (*i)->updateFrameNumber_ = frame.frameNumber_;
+        changedBoxes_.Push((*i)->GetWorldBoundingBox());
+        // Zones that moved within their octant are not seen by the octant add and remove
+        if ((*i)->GetDrawableFlags() & DRAWABLE_ZONE)
+            zonesDirty_ = true;
     }
     
     drawableUpdates_.Clear();
+    
+    if (zonesDirty_)
+    {
+        PROFILE(UpdateZoneGrid);
+        UpdateZoneGrid();
+    }
+    
+    // Rebuild the batched culling data of octants whose drawables were added, removed or moved
+    if (!dirtyBoxOctants_.Empty())
+    {
+        PROFILE(UpdateDrawableBoxes);
+        
+        for (PODVector<Octant*>::Iterator i = dirtyBoxOctants_.Begin(); i != dirtyBoxOctants_.End(); ++i)
+            (*i)->UpdateDrawableBoxes();
+        dirtyBoxOctants_.Clear();
+    }
 }
 
 void Octree::AddManualDrawable(Drawable* drawable)
@@ -488,6 +618,7 @@ void Octree::AddManualDrawable(Drawable* drawable)
         return;
 
     AddDrawable(drawable);
+    AddChangedBox(drawable->GetWorldBoundingBox());
 }
 
 void Octree::RemoveManualDrawable(Drawable* drawable)
@@ -497,13 +628,43 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 
     Octant* octant = drawable->GetOctant();
     if (octant && octant->GetRoot() == this)
+    {
+        AddChangedBox(drawable->worldBoundingBox_);
         octant->RemoveDrawable(drawable);
+    }
+}
+
+const PODVector<Zone*>* Octree::GetZones(const Vector3& position) const
+{
+    if (zonesDirty_)
+        return 0;
+    if (zoneCells_.Empty())
+        return &noZones;
+    
+    const Vector3& min = worldBoundingBox_.min_;
+    int x = (int)Clamp((position.x_ - min.x_) / zoneCellSize_.x_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+    int y = (int)Clamp((position.y_ - min.y_) / zoneCellSize_.y_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+    int z = (int)Clamp((position.z_ - min.z_) / zoneCellSize_.z_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+    return &zoneCells_[(z * ZONE_GRID_SIZE + y) * ZONE_GRID_SIZE + x];
 }
 
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+    
+    if (spatialIndex_ == SPATIAL_BVH)
+    {
+        // Until the hierarchy is rebuilt on the next update, test the drawables one by one
+        if (!bvhDirty_)
+            bvh_.GetDrawables(query);
+        else if (drawables_.Size())
+        {
+            Drawable** start = const_cast<Drawable**>(&drawables_[0]);
+            query.TestDrawables(start, start + drawables_.Size(), false);
+        }
+    }
+    else
+        GetDrawablesInternal(query, false);
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -516,13 +677,23 @@ void Octree::Raycast(RayOctreeQuery& query) const
 
     // If no worker threads or no triangle-level testing, do not create work items
     if (!queue->GetNumThreads() || query.level_ < RAY_TRIANGLE)
-        GetDrawablesInternal(query);
+    {
+        if (spatialIndex_ == SPATIAL_BVH)
+        {
+            rayQueryDrawables_.Clear();
+            GetRayDrawables(query, rayQueryDrawables_);
+            for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
+                (*i)->ProcessRayQuery(query, query.result_);
+        }
+        else
+            GetDrawablesInternal(query);
+    }
     else
     {
         // Threaded ray query: first get the drawables
         rayQuery_ = &query;
         rayQueryDrawables_.Clear();
-        GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+        GetRayDrawables(query, rayQueryDrawables_);
 
         // Check that amount of drawables is large enough to justify threading
         if (rayQueryDrawables_.Size() >= RAYCASTS_PER_WORK_ITEM * 2)
@@ -530,24 +701,7 @@ void Octree::Raycast(RayOctreeQuery& query) const
             for (unsigned i = 0; i < rayQueryResults_.Size(); ++i)
                 rayQueryResults_[i].Clear();
 
-            PODVector<Drawable*>::Iterator start = rayQueryDrawables_.Begin();
-            while (start != rayQueryDrawables_.End())
-            {
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = RaycastDrawablesWork;
-                item->aux_ = const_cast<Octree*>(this);
-
-                PODVector<Drawable*>::Iterator end = rayQueryDrawables_.End();
-                if (end - start > RAYCASTS_PER_WORK_ITEM)
-                    end = start + RAYCASTS_PER_WORK_ITEM;
-
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-
-                start = end;
-            }
+            queue->AddRangeWorkItems(rayQueryDrawables_, RAYCASTS_PER_WORK_ITEM, RaycastDrawablesWork, const_cast<Octree*>(this));
 
             // Merge per-thread results
             queue->Complete(M_MAX_UNSIGNED);
@@ -570,7 +724,7 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
     query.result_.Clear();
     rayQueryDrawables_.Clear();
-    GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+    GetRayDrawables(query, rayQueryDrawables_);
 
     // Sort by increasing hit distance to AABB
     for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
@@ -606,14 +760,21 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
 void Octree::QueueUpdate(Drawable* drawable)
 {
+    // The world bounding box has not been recalculated yet, so record it as the old region of the drawable
     Scene* scene = GetScene();
     if (scene && scene->IsThreadedUpdate())
     {
         MutexLock lock(octreeMutex_);
         drawableUpdates_.Push(drawable);
+        if (drawable->worldBoundingBox_.defined_)
+            pendingChangedBoxes_.Push(drawable->worldBoundingBox_);
     }
     else
+    {
         drawableUpdates_.Push(drawable);
+        if (drawable->worldBoundingBox_.defined_)
+            pendingChangedBoxes_.Push(drawable->worldBoundingBox_);
+    }
     
     drawable->updateQueued_ = true;
 }
@@ -624,12 +785,204 @@ void Octree::CancelUpdate(Drawable* drawable)
     drawable->updateQueued_ = false;
 }
 
+void Octree::AddChangedBox(const BoundingBox& box)
+{
+    if (box.defined_)
+        pendingChangedBoxes_.Push(box);
+}
+
 void Octree::DrawDebugGeometry(bool depthTest)
 {
     DebugRenderer* debug = GetComponent<DebugRenderer>();
     DrawDebugGeometry(debug, depthTest);
 }
 
+void Octree::UpdateDrawables(const FrameInfo& frame)
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    
+    // Split into work items of roughly equal cost instead of equal count, so that expensive drawables such as animated models
+    // with many bones and animations are spread over the threads instead of dominating single work items
+    unsigned totalCost = 0;
+    drawableUpdateCosts_.Resize(drawableUpdates_.Size());
+    for (unsigned i = 0; i < drawableUpdates_.Size(); ++i)
+    {
+        drawableUpdateCosts_[i] = drawableUpdates_[i]->GetUpdateCost();
+        totalCost += drawableUpdateCosts_[i];
+    }
+    
+    unsigned numItems = queue->GetNumThreads() ? (queue->GetNumThreads() + 1) * DRAWABLE_UPDATE_ITEMS_PER_THREAD : 1;
+    unsigned itemCost = (totalCost + numItems - 1) / numItems;
+    
+    unsigned start = 0;
+    unsigned cost = 0;
+    for (unsigned i = 0; i < drawableUpdates_.Size(); ++i)
+    {
+        cost += drawableUpdateCosts_[i];
+        if (cost >= itemCost || i == drawableUpdates_.Size() - 1)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = UpdateDrawablesWork;
+            item->aux_ = const_cast<FrameInfo*>(&frame);
+            item->start_ = &drawableUpdates_[start];
+            item->end_ = &drawableUpdates_[0] + i + 1;
+            queue->AddWorkItem(item);
+            
+            start = i + 1;
+            cost = 0;
+        }
+    }
+    
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+void Octree::ReinsertDrawables()
+{
+    unsigned numDrawables = drawableUpdates_.Size();
+    reinsertionSources_.Resize(numDrawables);
+    reinsertionTargets_.Resize(numDrawables);
+
+    // Finding the target octants does not modify the octree, so it can be done in worker threads
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue->GetNumThreads() && numDrawables >= MIN_THREADED_REINSERTIONS)
+    {
+        queue->AddRangeWorkItems(drawableUpdates_, REINSERTIONS_PER_WORK_ITEM, ReinsertDrawablesWork, this);
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+        FindReinsertionTargets(0, numDrawables);
+
+    // Link the drawables to their new octants, creating child octants as necessary. Add all drawables before removing
+    // any, because drawable count going to zero deletes an octant, and it could be the target of another drawable
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        Octant* source = reinsertionSources_[i];
+        if (!source)
+            continue;
+
+        // The world bounding box may have changed, so the octant's batched culling data must be refreshed
+        source->MarkDrawableBoxesDirty();
+
+        Drawable* drawable = drawableUpdates_[i];
+        Octant* target = reinsertionTargets_[i];
+        // Skip if still fits the current octant, or if this is a duplicate entry of an already moved drawable
+        if (!target || drawable->octant_ != source)
+        {
+            reinsertionTargets_[i] = 0;
+            continue;
+        }
+
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        target = target->GetInsertionOctant(drawable, box, true);
+        if (target == source)
+        {
+            reinsertionTargets_[i] = 0;
+            continue;
+        }
+
+        target->AddDrawable(drawable);
+        reinsertionTargets_[i] = target;
+
+        #ifdef _DEBUG
+        // Verify that the drawable will be culled correctly
+        if (target != this && target->GetCullingBox().IsInside(box) != INSIDE)
+        {
+            LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
+                " octant box " + target->GetCullingBox().ToString());
+        }
+        #endif
+    }
+
+    for (unsigned i = 0; i < numDrawables; ++i)
+    {
+        if (reinsertionTargets_[i])
+            reinsertionSources_[i]->RemoveDrawable(drawableUpdates_[i], false);
+    }
+}
+
+void Octree::FindReinsertionTargets(unsigned start, unsigned end)
+{
+    for (unsigned i = start; i < end; ++i)
+    {
+        Drawable* drawable = drawableUpdates_[i];
+        drawable->updateQueued_ = false;
+        Octant* octant = drawable->GetOctant();
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+
+        reinsertionSources_[i] = 0;
+        reinsertionTargets_[i] = 0;
+
+        // Skip if no octant or does not belong to this octree anymore
+        if (!octant || octant->GetRoot() != this)
+            continue;
+
+        reinsertionSources_[i] = octant;
+
+        // Skip if still fits the current octant
+        if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            continue;
+
+        // Descend only through existing octants, as creating them is left to the main thread
+        reinsertionTargets_[i] = GetInsertionOctant(drawable, box, false);
+    }
+}
+
+void Octree::GetRayDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    if (spatialIndex_ == SPATIAL_BVH && !bvhDirty_)
+        bvh_.GetDrawables(query, drawables);
+    else
+        GetDrawablesOnlyInternal(query, drawables);
+}
+
+void Octree::UpdateZoneGrid()
+{
+    zonesDirty_ = false;
+    
+    PODVector<Drawable*> zones;
+    BoxOctreeQuery query(zones, BoundingBox(-M_LARGE_VALUE, M_LARGE_VALUE), DRAWABLE_ZONE);
+    GetDrawables(query);
+    
+    if (zones.Empty())
+    {
+        zoneCells_.Clear();
+        return;
+    }
+    
+    zoneCells_.Resize(ZONE_GRID_SIZE * ZONE_GRID_SIZE * ZONE_GRID_SIZE);
+    for (unsigned i = 0; i < zoneCells_.Size(); ++i)
+        zoneCells_[i].Clear();
+    
+    // The grid covers the octree bounds. Zones and positions outside them are clamped to the border cells
+    const Vector3& min = worldBoundingBox_.min_;
+    Vector3 size = worldBoundingBox_.Size();
+    zoneCellSize_ = Vector3(Max(size.x_, M_EPSILON), Max(size.y_, M_EPSILON), Max(size.z_, M_EPSILON)) / (float)ZONE_GRID_SIZE;
+    
+    for (PODVector<Drawable*>::ConstIterator i = zones.Begin(); i != zones.End(); ++i)
+    {
+        Zone* zone = static_cast<Zone*>(*i);
+        const BoundingBox& box = zone->GetWorldBoundingBox();
+        Vector3 start = (box.min_ - min) / zoneCellSize_;
+        Vector3 end = (box.max_ - min) / zoneCellSize_;
+        int startX = (int)Clamp(start.x_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+        int startY = (int)Clamp(start.y_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+        int startZ = (int)Clamp(start.z_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+        int endX = (int)Clamp(end.x_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+        int endY = (int)Clamp(end.y_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+        int endZ = (int)Clamp(end.z_, 0.0f, (float)(ZONE_GRID_SIZE - 1));
+        
+        for (int z = startZ; z <= endZ; ++z)
+        {
+            for (int y = startY; y <= endY; ++y)
+            {
+                for (int x = startX; x <= endX; ++x)
+                    zoneCells_[(z * ZONE_GRID_SIZE + y) * ZONE_GRID_SIZE + x].Push(zone);
+            }
+        }
+    }
+}
+
 void Octree::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
 {
     // When running in headless mode, update the Octree manually during the RenderUpdate event
@@ -643,6 +996,7 @@ void Octree::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
     frame.frameNumber_ = GetSubsystem<Time>()->GetFrameNumber();
     frame.timeStep_ = eventData[P_TIMESTEP].GetFloat();
     frame.camera_ = 0;
+    frame.occlusionBuffer_ = 0;
     
     Update(frame);
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Graphics/BoundingVolumeHierarchy.h"
 #include "../Graphics/Drawable.h"
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
@@ -31,10 +32,20 @@ namespace Urho3D
 {
 
 class Octree;
+class Zone;
 
 static const int NUM_OCTANTS = 8;
 static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
 
+/// Spatial index used by the octree for queries.
+enum SpatialIndexType
+{
+    /// Hierarchy of octants. Moved drawables are reinserted.
+    SPATIAL_OCTANTS = 0,
+    /// Bounding volume hierarchy. Moved drawables only refit their nodes, which suits scenes with many moving objects.
+    SPATIAL_BVH
+};
+
 /// %Octree octant
 class URHO3D_API Octant
 {
@@ -52,12 +63,17 @@ public:
     void InsertDrawable(Drawable* drawable);
     /// Check if a drawable object fits.
     bool CheckDrawableFit(const BoundingBox& box) const;
+    /// Return the octant a drawable object should be inserted to, starting from this octant. If create is false, no child octants are created and the deepest existing octant on the path is returned instead.
+    Octant* GetInsertionOctant(Drawable* drawable, const BoundingBox& box, bool create);
     
     /// Add a drawable object to this octant.
     void AddDrawable(Drawable* drawable)
     {
         drawable->SetOctant(this);
         drawables_.Push(drawable);
+        MarkDrawableBoxesDirty();
+        if (drawable->GetDrawableFlags() & DRAWABLE_ZONE)
+            MarkZonesDirty();
         IncDrawableCount();
     }
     
@@ -68,6 +84,9 @@ public:
         {
             if (resetOctant)
                 drawable->SetOctant(0);
+            MarkDrawableBoxesDirty();
+            if (drawable->GetDrawableFlags() & DRAWABLE_ZONE)
+                MarkZonesDirty();
             DecDrawableCount();
         }
     }
@@ -91,6 +110,12 @@ public:
     void ResetRoot();
     /// Draw bounds to the debug graphics recursively.
     void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
+    /// Mark the drawable bounding boxes used for batched culling as needing a rebuild.
+    void MarkDrawableBoxesDirty();
+    /// Rebuild the drawable bounding boxes used for batched culling. Called by Octree after reinsertion.
+    void UpdateDrawableBoxes();
+    /// Mark the octree's zone lookup grid as needing a rebuild.
+    void MarkZonesDirty();
     
 protected:
     /// Initialize bounding box.
@@ -132,6 +157,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// Drawable world bounding boxes in structure-of-arrays blocks of four for batched culling.
+    PODVector<float> drawableBoxes_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS];
     /// World bounding box center.
@@ -148,12 +175,16 @@ protected:
     Octree* root_;
     /// Octant index relative to its siblings or ROOT_INDEX for root octant
     unsigned index_;
+    /// Drawable bounding boxes dirty flag. When set, queries test the drawables one by one.
+    bool drawableBoxesDirty_;
 };
 
 /// %Octree component. Should be added only to the root scene node
 class URHO3D_API Octree : public Component, public Octant
 {
+    friend class Octant;
     friend void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void ReinsertDrawablesWork(const WorkItem* item, unsigned threadIndex);
     
     OBJECT(Octree);
     
@@ -172,6 +203,8 @@ public:
     
     /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
     void SetSize(const BoundingBox& box, unsigned numLevels);
+    /// Set spatial index type. Drawable objects are moved to the root and reinserted or indexed on the next update.
+    void SetSpatialIndex(SpatialIndexType type);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -187,22 +220,56 @@ public:
     void RaycastSingle(RayOctreeQuery& query) const;
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
+    /// Return spatial index type.
+    SpatialIndexType GetSpatialIndex() const { return spatialIndex_; }
+    /// Return the world bounding boxes of drawable objects that were moved, changed, added or removed before the last update. Moved objects have both their old and new boxes included.
+    const PODVector<BoundingBox>& GetChangedBoxes() const { return changedBoxes_; }
+    /// Return the zones whose bounding boxes overlap the zone grid cell of a world position, or null if the grid has not been rebuilt since zones changed. The zones still need to be tested for containing the position. Can be called from worker threads.
+    const PODVector<Zone*>* GetZones(const Vector3& position) const;
     
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
     /// Cancel drawable object's update.
     void CancelUpdate(Drawable* drawable);
+    /// Record a world space region whose contents have changed, to be returned from GetChangedBoxes() after the next update.
+    void AddChangedBox(const BoundingBox& box);
     /// Visualize the component as debug geometry.
     void DrawDebugGeometry(bool depthTest);
     
 private:
     /// Handle render update in case of headless execution.
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    /// Update the drawable objects queued for update in work items of balanced cost.
+    void UpdateDrawables(const FrameInfo& frame);
+    /// Reinsert the drawable objects queued for update to the octants.
+    void ReinsertDrawables();
+    /// Find the source and target octants for a range of queued drawable objects. Does not modify the octree, so can be called from worker threads.
+    void FindReinsertionTargets(unsigned start, unsigned end);
+    /// Return drawable objects for a ray query from the current spatial index, without testing them.
+    void GetRayDrawables(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Rebuild the zone lookup grid.
+    void UpdateZoneGrid();
     
     /// Drawable objects that require update.
     PODVector<Drawable*> drawableUpdates_;
+    /// Update costs of the drawable objects that require update.
+    PODVector<unsigned> drawableUpdateCosts_;
     /// Drawable objects that require reinsertion.
     PODVector<Drawable*> drawableReinsertions_;
+    /// Current octants of the drawable objects being reinserted.
+    PODVector<Octant*> reinsertionSources_;
+    /// Octants to start the insertion of drawable objects from, or null if they stay in their current octant.
+    PODVector<Octant*> reinsertionTargets_;
+    /// Octants whose drawable bounding boxes need a rebuild.
+    PODVector<Octant*> dirtyBoxOctants_;
+    /// Changed world bounding boxes recorded since the last update.
+    PODVector<BoundingBox> pendingChangedBoxes_;
+    /// Changed world bounding boxes of the last update.
+    PODVector<BoundingBox> changedBoxes_;
+    /// Zones overlapping each cell of the zone lookup grid. Empty if there are no zones.
+    Vector<PODVector<Zone*> > zoneCells_;
+    /// Zone lookup grid cell size.
+    Vector3 zoneCellSize_;
     /// Mutex for octree reinsertions.
     Mutex octreeMutex_;
     /// Current threaded ray query.
@@ -211,8 +278,16 @@ private:
     mutable PODVector<Drawable*> rayQueryDrawables_;
     /// Threaded ray query intermediate results.
     mutable Vector<PODVector<RayQueryResult> > rayQueryResults_;
+    /// Bounding volume hierarchy when used as the spatial index.
+    BoundingVolumeHierarchy bvh_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Spatial index type.
+    SpatialIndexType spatialIndex_;
+    /// Bounding volume hierarchy needs rebuild flag. When set, queries test the drawables one by one.
+    bool bvhDirty_;
+    /// Zone lookup grid needs rebuild flag.
+    bool zonesDirty_;
 };
 
 }
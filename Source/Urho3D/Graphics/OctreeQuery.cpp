@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+static const unsigned DRAWABLE_BOX_BATCH_SIZE = 64;
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -115,4 +117,34 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawableBoxes(Drawable** start, Drawable** end, const float* boxes)
+{
+    unsigned char masks[DRAWABLE_BOX_BATCH_SIZE / 4];
+    Drawable* visible[DRAWABLE_BOX_BATCH_SIZE];
+    
+    while (start != end)
+    {
+        unsigned count = (unsigned)(end - start);
+        if (count > DRAWABLE_BOX_BATCH_SIZE)
+            count = DRAWABLE_BOX_BATCH_SIZE;
+        unsigned numBlocks = (count + 3) / 4;
+        
+        frustum_.IsInsideFastBatch(boxes, numBlocks, masks);
+        
+        unsigned numVisible = 0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (masks[i / 4] & (1 << (i & 3)))
+                visible[numVisible++] = start[i];
+        }
+        
+        // The frustum test is done, so let TestDrawables() only check the drawable flags
+        if (numVisible)
+            TestDrawables(visible, visible + numVisible, true);
+        
+        start += count;
+        boxes += numBlocks * FRUSTUM_BOX_BLOCK_SIZE;
+    }
+}
+
 }
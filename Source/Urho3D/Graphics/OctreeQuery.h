@@ -55,6 +55,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables of a partially visible octant, with their world bounding boxes in structure-of-arrays blocks of four. By default tests the drawables one by one.
+    virtual void TestDrawableBoxes(Drawable** start, Drawable** end, const float* boxes) { TestDrawables(start, end, false); }
     
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -149,6 +151,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Batched frustum test for drawables. Drawables that pass are given to TestDrawables() as fully inside.
+    virtual void TestDrawableBoxes(Drawable** start, Drawable** end, const float* boxes);
     
     /// Frustum.
     Frustum frustum_;
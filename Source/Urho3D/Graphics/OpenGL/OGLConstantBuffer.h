@@ -48,10 +48,10 @@ public:
     
     /// Set size and create GPU-side buffer. Return true on success.
     bool SetSize(unsigned size);
-    /// Set a generic parameter and mark buffer dirty.
-    void SetParameter(unsigned offset, unsigned size, const void* data);
-    /// Set a Vector3 array parameter and mark buffer dirty.
-    void SetVector3ArrayParameter(unsigned offset, unsigned rows, const void* data);
+    /// Set a generic parameter and mark buffer dirty if the value changed. Return true if changed.
+    bool SetParameter(unsigned offset, unsigned size, const void* data);
+    /// Set a Vector3 array parameter and mark buffer dirty if the value changed. Return true if changed.
+    bool SetVector3ArrayParameter(unsigned offset, unsigned rows, const void* data);
     /// Apply to GPU.
     void Apply();
 
@@ -59,6 +59,8 @@ public:
     unsigned GetSize() const { return size_; }
     /// Return whether has unapplied data.
     bool IsDirty() const { return dirty_; }
+    /// Return CPU-side copy of the data.
+    const unsigned char* GetShadowData() const { return shadowData_.Get(); }
 
 private:
     /// Create buffer.
@@ -21,19 +21,24 @@
 //
 
 #include "../../Graphics/AnimatedModel.h"
+#include "../../Graphics/AnimatedModelGroup.h"
 #include "../../Graphics/Animation.h"
 #include "../../Graphics/AnimationController.h"
 #include "../../Graphics/BillboardSet.h"
 #include "../../Graphics/Camera.h"
+#include "../../Graphics/CDLODTerrain.h"
 #include "../../Graphics/ConstantBuffer.h"
 #include "../../Core/Context.h"
 #include "../../Graphics/CustomGeometry.h"
 #include "../../Graphics/DebugRenderer.h"
 #include "../../Graphics/DecalSet.h"
 #include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
+#include "../../Graphics/GPUParticleEmitter.h"
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsEvents.h"
 #include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/ImpostorSet.h"
 #include "../../Graphics/IndexBuffer.h"
 #include "../../IO/Log.h"
 #include "../../Graphics/Material.h"
@@ -55,6 +60,7 @@
 #include "../../Graphics/Terrain.h"
 #include "../../Graphics/TerrainPatch.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../Graphics/Texture2DArray.h"
 #include "../../Graphics/Texture3D.h"
 #include "../../Graphics/TextureCube.h"
 #include "../../Graphics/VertexBuffer.h"
@@ -65,8 +71,14 @@
 #include "../../DebugNew.h"
 
 #ifdef GL_ES_VERSION_2_0
-#define GL_DEPTH_COMPONENT24 GL_DEPTH_COMPONENT24_OES
 #define glClearDepth glClearDepthf
+// The WebGL 2 headers already have these
+#ifndef GL_ES_VERSION_3_0
+#define GL_DEPTH_COMPONENT24 GL_DEPTH_COMPONENT24_OES
+#define GL_COLOR GL_COLOR_EXT
+#define GL_DEPTH GL_DEPTH_EXT
+#define GL_STENCIL GL_STENCIL_EXT
+#endif
 #endif
 
 #ifdef WIN32
@@ -156,9 +168,14 @@ static const unsigned glVertexAttrIndex[] =
     0, 1, 2, 3, 4, 8, 9, 5, 6, 7, 10, 11, 12
 };
 
+static const unsigned MAX_MATERIAL_CONSTANT_BUFFERS = 1024;
+static const unsigned MAX_VERTEX_ARRAYS = 4096;
+static const unsigned TEXTURE_UPLOAD_REGION_SIZE = 4 * 1024 * 1024;
+
 #ifdef GL_ES_VERSION_2_0
 static unsigned glesDepthStencilFormat = GL_DEPTH_COMPONENT16;
 static unsigned glesReadableDepthFormat = GL_DEPTH_COMPONENT;
+static PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferFunc = 0;
 #endif
 
 static String extensions;
@@ -224,8 +241,14 @@ Graphics::Graphics(Context* context_) :
     vsync_(false),
     tripleBuffer_(false),
     sRGB_(false),
+    flushGPU_(false),
     forceGL2_(false),
     instancingSupport_(false),
+    vertexArraySupport_(false),
+    indirectDrawSupport_(false),
+    framebufferDiscardSupport_(false),
+    occlusionQuerySupport_(false),
+    timerQuerySupport_(false),
     lightPrepassSupport_(false),
     deferredSupport_(false),
     anisotropySupport_(false),
@@ -236,6 +259,9 @@ Graphics::Graphics(Context* context_) :
     sRGBWriteSupport_(false),
     numPrimitives_(0),
     numBatches_(0),
+    numStateChanges_(0),
+    numAvoidedStateChanges_(0),
+    numParameterBytes_(0),
     maxScratchBufferRequest_(0),
     dummyColorFormat_(0),
     shadowMapFormat_(GL_DEPTH_COMPONENT16),
@@ -253,6 +279,12 @@ Graphics::Graphics(Context* context_) :
     SetTextureUnitMappings();
     ResetCachedState();
     
+    gpuProfileFrame_ = 0;
+    gpuProfiling_ = false;
+    gpuProfileFrameActive_ = false;
+    for (unsigned i = 0; i < NUM_GPU_PROFILE_FRAMES; ++i)
+        numGPUProfileBlocks_[i] = 0;
+    
     // Initialize SDL now. Graphics should be the first SDL-using subsystem to be created
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER | SDL_INIT_NOPARACHUTE);
     
@@ -422,6 +454,10 @@ bool Graphics::SetMode(int width, int height, bool fullscreen, bool borderless,
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, 0);
         }
+        #elif defined(GL_ES_VERSION_3_0)
+        // Request a WebGL 2 context unless forced to WebGL 1
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, forceGL2_ ? 2 : 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
         #else
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
@@ -570,6 +606,25 @@ void Graphics::SetSRGB(bool enable)
 
 void Graphics::SetFlushGPU(bool enable)
 {
+    flushGPU_ = enable;
+}
+
+void Graphics::SetAsyncShaders(bool enable)
+{
+}
+
+void Graphics::SetShaderFallbackDefines(const String& defines)
+{
+}
+
+void Graphics::SetRenderThread(bool enable)
+{
+}
+
+void Graphics::SetShaderCacheDir(const String& path)
+{
+    String trimmedPath = path.Trimmed();
+    shaderCacheDir_ = trimmedPath.Empty() ? String::EMPTY : AddTrailingSlash(trimmedPath);
 }
 
 void Graphics::SetForceGL2(bool enable)
@@ -645,6 +700,11 @@ bool Graphics::BeginFrame()
     
     numPrimitives_ = 0;
     numBatches_ = 0;
+    numStateChanges_ = 0;
+    numAvoidedStateChanges_ = 0;
+    numParameterBytes_ = 0;
+    
+    BeginGPUProfileFrame();
     
     SendEvent(E_BEGINRENDERING);
     
@@ -660,10 +720,35 @@ void Graphics::EndFrame()
     
     SendEvent(E_ENDRENDERING);
     
+    EndGPUProfileFrame();
+    
     SDL_GL_SwapWindow(impl_->window_);
     
+    #ifndef GL_ES_VERSION_2_0
+    // Let the CPU run at most one frame ahead of the GPU by waiting until the previous frame's commands have finished
+    if (impl_->frameFence_)
+    {
+        if (flushGPU_)
+        {
+            PROFILE(FlushGPU);
+            
+            GLenum result = glClientWaitSync(impl_->frameFence_, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (result == GL_TIMEOUT_EXPIRED)
+                result = glClientWaitSync(impl_->frameFence_, 0, 1000000);
+        }
+        glDeleteSync(impl_->frameFence_);
+        impl_->frameFence_ = 0;
+    }
+    if (flushGPU_ && gl3Support)
+        impl_->frameFence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    #endif
+    
     // Clean up too large scratch buffers
     CleanupScratchBuffers();
+    
+    // Release the material constant buffers if materials with changing parameters have created too many
+    if (materialConstantBuffers_.Size() > MAX_MATERIAL_CONSTANT_BUFFERS)
+        CleanupMaterialConstantBuffers();
 }
 
 void Graphics::Clear(unsigned flags, const Color& color, float depth, unsigned stencil)
@@ -718,6 +803,48 @@ void Graphics::Clear(unsigned flags, const Color& color, float depth, unsigned s
         glStencilMask(stencilWriteMask_);
 }
 
+void Graphics::DiscardFramebuffer(unsigned flags)
+{
+    if (!framebufferDiscardSupport_ || !flags)
+        return;
+    
+    // Make sure the framebuffer being discarded is the one currently set for rendering
+    PrepareDraw();
+    
+    // The default framebuffer uses different attachment names than framebuffer objects
+    bool defaultFramebuffer = impl_->boundFBO_ == 0;
+    GLenum attachments[MAX_RENDERTARGETS + 2];
+    unsigned numAttachments = 0;
+    
+    if (flags & CLEAR_COLOR)
+    {
+        if (defaultFramebuffer)
+            attachments[numAttachments++] = GL_COLOR;
+        else
+        {
+            #ifndef GL_ES_VERSION_2_0
+            for (unsigned i = 0; i < MAX_RENDERTARGETS; ++i)
+            {
+                if (renderTargets_[i] || !i)
+                    attachments[numAttachments++] = GL_COLOR_ATTACHMENT0 + i;
+            }
+            #else
+            attachments[numAttachments++] = GL_COLOR_ATTACHMENT0;
+            #endif
+        }
+    }
+    if (flags & CLEAR_DEPTH)
+        attachments[numAttachments++] = defaultFramebuffer ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    if (flags & CLEAR_STENCIL)
+        attachments[numAttachments++] = defaultFramebuffer ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+    
+    #ifndef GL_ES_VERSION_2_0
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, numAttachments, attachments);
+    #else
+    glDiscardFramebufferFunc(GL_FRAMEBUFFER, numAttachments, attachments);
+    #endif
+}
+
 bool Graphics::ResolveToTexture(Texture2D* destination, const IntRect& viewport)
 {
     if (!destination || !destination->GetRenderSurface())
@@ -746,6 +873,34 @@ bool Graphics::ResolveToTexture(Texture2D* destination, const IntRect& viewport)
     return true;
 }
 
+bool Graphics::CopyDepthTexture(Texture2D* destination, Texture2D* source)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!destination || !source || !destination->GetGPUObject() || !source->GetRenderSurface())
+        return false;
+    if (destination->GetWidth() != source->GetWidth() || destination->GetHeight() != source->GetHeight() ||
+        destination->GetFormat() != source->GetFormat())
+        return false;
+    
+    PROFILE(CopyDepthTexture);
+    
+    // Bind the source as the framebuffer depth attachment, then copy its depth values to the destination texture
+    SetRenderTarget(0, source->GetRenderSurface()->GetLinkedRenderTarget());
+    for (unsigned i = 1; i < MAX_RENDERTARGETS; ++i)
+        SetRenderTarget(i, (RenderSurface*)0);
+    SetDepthStencil(source);
+    PrepareDraw();
+    
+    SetTextureForUpdate(destination);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, source->GetWidth(), source->GetHeight());
+    SetTexture(0, 0);
+    
+    return true;
+    #else
+    return false;
+    #endif
+}
+
 void Graphics::Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount)
 {
     if (!vertexCount)
@@ -776,7 +931,8 @@ void Graphics::Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount
     
     GetGLPrimitiveType(indexCount, type, primitiveCount, glPrimitiveType);
     GLenum indexType = indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
-    glDrawElements(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexStart * indexSize));
+    glDrawElements(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexBuffer_->GetDataOffset() +
+        indexStart * indexSize));
 
     numPrimitives_ += primitiveCount;
     ++numBatches_;
@@ -784,7 +940,7 @@ void Graphics::Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount
 
 void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount, unsigned instanceCount)
 {
-    #ifndef GL_ES_VERSION_2_0
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
     if (!indexCount || !indexBuffer_ || !indexBuffer_->GetGPUObject() || !instancingSupport_)
         return;
     
@@ -796,22 +952,317 @@ void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned i
     
     GetGLPrimitiveType(indexCount, type, primitiveCount, glPrimitiveType);
     GLenum indexType = indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    #ifndef GL_ES_VERSION_2_0
     if (gl3Support)
     {
-        glDrawElementsInstanced(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexStart * indexSize),
-            instanceCount);
+        glDrawElementsInstanced(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexBuffer_->GetDataOffset() +
+            indexStart * indexSize), instanceCount);
     }
     else
     {
-        glDrawElementsInstancedARB(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexStart *
-            indexSize), instanceCount);
+        glDrawElementsInstancedARB(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexBuffer_->GetDataOffset() +
+            indexStart * indexSize), instanceCount);
     }
+    #else
+    // Emscripten routes this also to the ANGLE_instanced_arrays extension on WebGL 1
+    glDrawElementsInstanced(glPrimitiveType, indexCount, indexType, reinterpret_cast<const GLvoid*>(indexBuffer_->GetDataOffset() +
+        indexStart * indexSize), instanceCount);
+    #endif
     
     numPrimitives_ += instanceCount * primitiveCount;
     ++numBatches_;
     #endif
 }
 
+void Graphics::DrawIndirect(PrimitiveType type, const IndirectDrawCommand* commands, unsigned count)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!count || !commands || !indexBuffer_ || !indexBuffer_->GetGPUObject() || !indirectDrawSupport_)
+        return;
+    
+    PrepareDraw();
+    
+    unsigned indexSize = indexBuffer_->GetIndexSize();
+    unsigned dataSize = count * sizeof(IndirectDrawCommand);
+    
+    // The commands address indices from the start of the buffer object, so add the data offset of a dynamic index buffer
+    void* adjustedCommands = 0;
+    if (indexBuffer_->GetDataOffset())
+    {
+        adjustedCommands = ReserveScratchBuffer(dataSize);
+        if (!adjustedCommands)
+            return;
+        
+        memcpy(adjustedCommands, commands, dataSize);
+        IndirectDrawCommand* dest = (IndirectDrawCommand*)adjustedCommands;
+        for (unsigned i = 0; i < count; ++i)
+            dest[i].indexStart_ += indexBuffer_->GetDataOffset() / indexSize;
+    }
+    
+    if (!impl_->indirectBuffer_)
+        glGenBuffers(1, &impl_->indirectBuffer_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, impl_->indirectBuffer_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, dataSize, adjustedCommands ? adjustedCommands : commands, GL_STREAM_DRAW);
+    
+    if (adjustedCommands)
+        FreeScratchBuffer(adjustedCommands);
+    
+    unsigned primitiveCount;
+    GLenum glPrimitiveType;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        GetGLPrimitiveType(commands[i].indexCount_, type, primitiveCount, glPrimitiveType);
+        numPrimitives_ += commands[i].instanceCount_ * primitiveCount;
+    }
+    
+    glMultiDrawElementsIndirect(glPrimitiveType, indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, 0,
+        count, 0);
+    ++numBatches_;
+    #endif
+}
+
+unsigned Graphics::CreateOcclusionQuery()
+{
+    if (!occlusionQuerySupport_)
+        return 0;
+    
+    // The query object itself is created on first use, which also recreates it after a context loss
+    unsigned index;
+    if (freeOcclusionQueries_.Size())
+    {
+        index = freeOcclusionQueries_.Back();
+        freeOcclusionQueries_.Pop();
+    }
+    else
+    {
+        index = occlusionQueries_.Size();
+        occlusionQueries_.Push(0);
+    }
+    
+    return index + 1;
+}
+
+void Graphics::DestroyOcclusionQuery(unsigned query)
+{
+    if (!query || query > occlusionQueries_.Size())
+        return;
+    
+    #ifndef GL_ES_VERSION_2_0
+    unsigned& object = occlusionQueries_[query - 1];
+    if (object)
+    {
+        glDeleteQueries(1, &object);
+        object = 0;
+    }
+    #endif
+    
+    freeOcclusionQueries_.Push(query - 1);
+}
+
+void Graphics::BeginOcclusionQuery(unsigned query)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!query || query > occlusionQueries_.Size())
+        return;
+    
+    unsigned& object = occlusionQueries_[query - 1];
+    if (!object)
+        glGenQueries(1, &object);
+    glBeginQuery(GL_SAMPLES_PASSED, object);
+    #endif
+}
+
+void Graphics::EndOcclusionQuery(unsigned query)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!query || query > occlusionQueries_.Size() || !occlusionQueries_[query - 1])
+        return;
+    
+    glEndQuery(GL_SAMPLES_PASSED);
+    #endif
+}
+
+bool Graphics::GetOcclusionQueryResult(unsigned query, bool& visible)
+{
+    // If the query object has been lost, report visible
+    visible = true;
+    if (!query || query > occlusionQueries_.Size() || !occlusionQueries_[query - 1])
+        return true;
+    
+    #ifndef GL_ES_VERSION_2_0
+    unsigned object = occlusionQueries_[query - 1];
+    GLuint available = 0;
+    glGetQueryObjectuiv(object, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+    
+    GLuint samples = 0;
+    glGetQueryObjectuiv(object, GL_QUERY_RESULT, &samples);
+    visible = samples != 0;
+    #endif
+    
+    return true;
+}
+
+void Graphics::SetGPUProfiling(bool enable)
+{
+    if (enable && !timerQuerySupport_)
+    {
+        LOGERROR("Timer queries not supported, can not enable GPU profiling");
+        return;
+    }
+    
+    if (enable == gpuProfiling_)
+        return;
+    
+    gpuProfiling_ = enable;
+    if (!enable)
+    {
+        ReleaseGPUProfileQueries();
+        gpuProfileResults_.Clear();
+    }
+}
+
+void Graphics::BeginGPUProfileBlock(const char* name)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!gpuProfileFrameActive_)
+        return;
+    
+    unsigned frame = gpuProfileFrame_;
+    unsigned index = numGPUProfileBlocks_[frame];
+    PODVector<unsigned>& queries = gpuTimestampQueries_[frame];
+    
+    // If out of blocks, push an invalid index so that the matching end is ignored
+    if (index >= MAX_GPU_PROFILE_BLOCKS)
+    {
+        gpuProfileStack_.Push(M_MAX_UNSIGNED);
+        return;
+    }
+    
+    if (queries.Size() <= index * 2)
+    {
+        unsigned objects[2];
+        glGenQueries(2, objects);
+        queries.Push(objects[0]);
+        queries.Push(objects[1]);
+    }
+    
+    Vector<GPUProfileBlock>& blocks = gpuProfileBlocks_[frame];
+    if (blocks.Size() <= index)
+        blocks.Resize(index + 1);
+    blocks[index].name_ = name;
+    blocks[index].depth_ = gpuProfileStack_.Size();
+    
+    glQueryCounter(queries[index * 2], GL_TIMESTAMP);
+    ++numGPUProfileBlocks_[frame];
+    gpuProfileStack_.Push(index);
+    #endif
+}
+
+void Graphics::EndGPUProfileBlock()
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!gpuProfileFrameActive_ || gpuProfileStack_.Empty())
+        return;
+    
+    unsigned index = gpuProfileStack_.Back();
+    gpuProfileStack_.Pop();
+    if (index != M_MAX_UNSIGNED)
+        glQueryCounter(gpuTimestampQueries_[gpuProfileFrame_][index * 2 + 1], GL_TIMESTAMP);
+    #endif
+}
+
+void Graphics::BeginGPUProfileFrame()
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!gpuProfiling_)
+        return;
+    
+    gpuProfileFrame_ = (gpuProfileFrame_ + 1) % NUM_GPU_PROFILE_FRAMES;
+    unsigned frame = gpuProfileFrame_;
+    
+    // Read back the frame issued NUM_GPU_PROFILE_FRAMES ago. Queries complete in order, so checking the last one is
+    // enough. If it is still pending, the results are dropped
+    unsigned numBlocks = numGPUProfileBlocks_[frame];
+    if (numBlocks)
+    {
+        const Vector<GPUProfileBlock>& blocks = gpuProfileBlocks_[frame];
+        const PODVector<unsigned>& queries = gpuTimestampQueries_[frame];
+        
+        GLuint available = 0;
+        glGetQueryObjectuiv(queries[numBlocks * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            gpuProfileResults_.Resize(numBlocks);
+            for (unsigned i = 0; i < numBlocks; ++i)
+            {
+                GLuint64 beginTime = 0;
+                GLuint64 endTime = 0;
+                glGetQueryObjectui64v(queries[i * 2], GL_QUERY_RESULT, &beginTime);
+                glGetQueryObjectui64v(queries[i * 2 + 1], GL_QUERY_RESULT, &endTime);
+                
+                GPUProfileBlock& result = gpuProfileResults_[i];
+                result = blocks[i];
+                // Timestamps are in nanoseconds
+                if (endTime > beginTime)
+                    result.time_ = (float)((double)(endTime - beginTime) / 1000000.0);
+            }
+        }
+    }
+    
+    numGPUProfileBlocks_[frame] = 0;
+    gpuProfileStack_.Clear();
+    gpuProfileFrameActive_ = true;
+    #endif
+}
+
+void Graphics::EndGPUProfileFrame()
+{
+    if (!gpuProfileFrameActive_)
+        return;
+    
+    // Close the blocks left open
+    while (!gpuProfileStack_.Empty())
+        EndGPUProfileBlock();
+    
+    gpuProfileFrameActive_ = false;
+}
+
+void Graphics::ReleaseGPUProfileQueries()
+{
+    for (unsigned i = 0; i < NUM_GPU_PROFILE_FRAMES; ++i)
+    {
+        #ifndef GL_ES_VERSION_2_0
+        if (!gpuTimestampQueries_[i].Empty())
+            glDeleteQueries(gpuTimestampQueries_[i].Size(), &gpuTimestampQueries_[i][0]);
+        #endif
+        gpuTimestampQueries_[i].Clear();
+        numGPUProfileBlocks_[i] = 0;
+    }
+    
+    gpuProfileStack_.Clear();
+    gpuProfileFrameActive_ = false;
+}
+
+/// Set the attribute pointer of a vertex element. Add data offset of a dynamic buffer, and instance offset for the instance matrix pointers.
+static void SetVertexAttribPointer(VertexBuffer* buffer, VertexElement element, unsigned dataOffset, unsigned instanceOffset)
+{
+    unsigned vertexSize = buffer->GetVertexSize();
+    unsigned offset = dataOffset + (element >= ELEMENT_INSTANCEMATRIX1 ? instanceOffset * vertexSize : 0);
+    const GLvoid* pointer = reinterpret_cast<const GLvoid*>(buffer->GetElementOffset(element) + offset);
+    if (VertexBuffer::IsElementPacked(buffer->GetElementMask(), element))
+    {
+        glVertexAttribPointer(glVertexAttrIndex[element], VertexBuffer::packedElementComponents[element],
+            VertexBuffer::packedElementType[element], VertexBuffer::packedElementNormalize[element], vertexSize, pointer);
+    }
+    else
+    {
+        glVertexAttribPointer(glVertexAttrIndex[element], VertexBuffer::elementComponents[element], VertexBuffer::elementType[element],
+            VertexBuffer::elementNormalize[element], vertexSize, pointer);
+    }
+}
+
 void Graphics::SetVertexBuffer(VertexBuffer* buffer)
 {
     // Note: this is not multi-instance safe
@@ -839,22 +1290,40 @@ bool Graphics::SetVertexBuffers(const PODVector<VertexBuffer*>& buffers, const P
     bool changed = false;
     unsigned newAttributes = 0;
     
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+    if (vertexArraySupport_)
+    {
+        if (SetCachedVertexArray(buffers, elementMasks, instanceOffset))
+            return true;
+        
+        // The default vertex array object still has the attribute pointers it was last used with, so set all of them
+        if (impl_->boundVertexArray_ != &impl_->defaultVertexArray_)
+        {
+            BindVertexArray(&impl_->defaultVertexArray_);
+            changed = true;
+        }
+    }
+    #endif
+    
     for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
     {
         VertexBuffer* buffer = 0;
         unsigned elementMask = 0;
+        unsigned dataOffset = 0;
         
         if (i < buffers.Size() && buffers[i])
         {
             buffer = buffers[i];
+            dataOffset = buffer->GetDataOffset();
             if (elementMasks[i] == MASK_DEFAULT)
                 elementMask = buffer->GetElementMask();
             else
                 elementMask = buffer->GetElementMask() & elementMasks[i];
         }
         
-        // If buffer and element mask have stayed the same, skip to the next buffer
-        if (buffer == vertexBuffers_[i] && elementMask == elementMasks_[i] && instanceOffset == lastInstanceOffset_ && !changed)
+        // If buffer, element mask and data offset have stayed the same, skip to the next buffer
+        if (buffer == vertexBuffers_[i] && elementMask == elementMasks_[i] && dataOffset == vertexBufferOffsets_[i] &&
+            instanceOffset == lastInstanceOffset_ && !changed)
         {
             newAttributes |= elementMask;
             continue;
@@ -862,6 +1331,7 @@ bool Graphics::SetVertexBuffers(const PODVector<VertexBuffer*>& buffers, const P
         
         vertexBuffers_[i] = buffer;
         elementMasks_[i] = elementMask;
+        vertexBufferOffsets_[i] = dataOffset;
         changed = true;
         
         // Beware buffers with missing OpenGL objects, as binding a zero buffer object means accessing CPU memory for vertex data,
@@ -870,11 +1340,9 @@ bool Graphics::SetVertexBuffers(const PODVector<VertexBuffer*>& buffers, const P
             continue;
         
         SetVBO(buffer->GetGPUObject());
-        unsigned vertexSize = buffer->GetVertexSize();
         
         for (unsigned j = 0; j < MAX_VERTEX_ELEMENTS; ++j)
         {
-            unsigned attrIndex = glVertexAttrIndex[j];
             unsigned elementBit = 1 << j;
             
             if (elementMask & elementBit)
@@ -884,23 +1352,23 @@ bool Graphics::SetVertexBuffers(const PODVector<VertexBuffer*>& buffers, const P
                 // Enable attribute if not enabled yet
                 if ((impl_->enabledAttributes_ & elementBit) == 0)
                 {
-                    glEnableVertexAttribArray(attrIndex);
+                    glEnableVertexAttribArray(glVertexAttrIndex[j]);
                     impl_->enabledAttributes_ |= elementBit;
                 }
                 
-                // Set the attribute pointer. Add instance offset for the instance matrix pointers
-                unsigned offset = j >= ELEMENT_INSTANCEMATRIX1 ? instanceOffset * vertexSize : 0;
-                glVertexAttribPointer(attrIndex, VertexBuffer::elementComponents[j], VertexBuffer::elementType[j],
-                    VertexBuffer::elementNormalize[j], vertexSize, reinterpret_cast<const GLvoid*>(buffer->GetElementOffset((VertexElement)j)
-                    + offset));
+                SetVertexAttribPointer(buffer, (VertexElement)j, dataOffset, instanceOffset);
             }
         }
     }
     
     if (!changed)
+    {
+        ++numAvoidedStateChanges_;
         return true;
+    }
     
     lastInstanceOffset_ = instanceOffset;
+    ++numStateChanges_;
     
     // Now check which vertex attributes should be disabled
     unsigned disableAttributes = impl_->enabledAttributes_ & (~newAttributes);
@@ -929,19 +1397,43 @@ bool Graphics::SetVertexBuffers(const Vector<SharedPtr<VertexBuffer> >& buffers,
 void Graphics::SetIndexBuffer(IndexBuffer* buffer)
 {
     if (indexBuffer_ == buffer)
+    {
+        ++numAvoidedStateChanges_;
         return;
+    }
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer ? buffer->GetGPUObject() : 0);
+    unsigned object = buffer ? buffer->GetGPUObject() : 0;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object);
+    // The index buffer binding is part of the vertex array object state
+    if (impl_->boundVertexArray_)
+        impl_->boundVertexArray_->indexBuffer_ = object;
     indexBuffer_ = buffer;
+    ++numStateChanges_;
 }
 
 void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
 {
     if (vs == vertexShader_ && ps == pixelShader_)
+    {
+        ++numAvoidedStateChanges_;
         return;
+    }
+    
+    ++numStateChanges_;
+    
+    // If the combination has been linked already or its program binary is cached, the shaders do not need to be compiled
+    bool linked = false;
+    if (vs && ps && (!vs->GetGPUObject() || !ps->GetGPUObject()))
+    {
+        ShaderProgramMap::Iterator i = shaderPrograms_.Find(MakePair(vs, ps));
+        if (i != shaderPrograms_.End())
+            linked = i->second_->GetGPUObject() != 0;
+        else
+            linked = LoadProgramBinary(vs, ps);
+    }
     
     // Compile the shaders now if not yet compiled. If already attempted, do not retry
-    if (vs && !vs->GetGPUObject())
+    if (vs && !linked && !vs->GetGPUObject())
     {
         if (vs->GetCompilerOutput().Empty())
         {
@@ -960,7 +1452,7 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
             vs = 0;
     }
     
-    if (ps && !ps->GetGPUObject())
+    if (ps && !linked && !ps->GetGPUObject())
     {
         if (ps->GetCompilerOutput().Empty())
         {
@@ -1020,6 +1512,7 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
                 // Note: Link() calls glUseProgram() to set the texture sampler uniforms,
                 // so it is not necessary to call it again
                 shaderProgram_ = newProgram;
+                SaveProgramBinary(newProgram);
             }
             else
             {
@@ -1039,18 +1532,7 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
     {
         const SharedPtr<ConstantBuffer>* constantBuffers = shaderProgram_->GetConstantBuffers();
         for (unsigned i = 0; i < MAX_SHADER_PARAMETER_GROUPS * 2; ++i)
-        {
-            ConstantBuffer* buffer = constantBuffers[i].Get();
-            if (buffer != currentConstantBuffers_[i])
-            {
-                unsigned object = buffer ? buffer->GetGPUObject() : 0;
-                glBindBufferBase(GL_UNIFORM_BUFFER, i, object);
-                // Calling glBindBufferBase also affects the generic buffer binding point
-                impl_->boundUBO_ = object;
-                currentConstantBuffers_[i] = buffer;
-                ShaderProgram::ClearGlobalParameterSource((ShaderParameterGroup)(i % MAX_SHADER_PARAMETER_GROUPS));
-            }
-        }
+            SetConstantBuffer(i, constantBuffers[i].Get());
 
         SetShaderParameter(VSP_CLIPPLANE, useClipPlane_ ? clipPlane_ : Vector4(0.0f, 0.0f, 0.0f, 1.0f));
     }
@@ -1070,13 +1552,13 @@ void Graphics::SetShaderParameter(StringHash param, const float* data, unsigned
         {
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, count * sizeof(float), data);
+                SetBufferParameter(info->bufferPtr_, info->location_, count * sizeof(float), data);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, data, count * sizeof(float)))
+                return;
+
             switch (info->type_)
             {
             case GL_FLOAT:
@@ -1116,13 +1598,13 @@ void Graphics::SetShaderParameter(StringHash param, float value)
         {
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, sizeof(float), &value);
+                SetBufferParameter(info->bufferPtr_, info->location_, sizeof(float), &value);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, &value, sizeof(float)))
+                return;
+
             glUniform1fv(info->location_, 1, &value);
         }
     }
@@ -1142,13 +1624,13 @@ void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
         {
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, sizeof(Vector2), &vector);
+                SetBufferParameter(info->bufferPtr_, info->location_, sizeof(Vector2), &vector);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, &vector, sizeof(Vector2)))
+                return;
+
             // Check the uniform type to avoid mismatch
             switch (info->type_)
             {
@@ -1174,12 +1656,20 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
             if (info->bufferPtr_)
             {
                 ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetVector3ArrayParameter(info->location_, 3, &matrix);
+                bool wasDirty = buffer->IsDirty();
+                if (buffer->SetVector3ArrayParameter(info->location_, 3, &matrix))
+                {
+                    if (!wasDirty)
+                        dirtyConstantBuffers_.Push(buffer);
+                }
+                else
+                    ++numAvoidedStateChanges_;
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, matrix.Data(), sizeof(Matrix3)))
+                return;
+
             glUniformMatrix3fv(info->location_, 1, GL_FALSE, matrix.Data());
         }
     }
@@ -1194,13 +1684,13 @@ void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
         {
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, sizeof(Vector3), &vector);
+                SetBufferParameter(info->bufferPtr_, info->location_, sizeof(Vector3), &vector);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, &vector, sizeof(Vector3)))
+                return;
+
             // Check the uniform type to avoid mismatch
             switch (info->type_)
             {
@@ -1229,13 +1719,13 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
         {
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, sizeof(Matrix4), &matrix);
+                SetBufferParameter(info->bufferPtr_, info->location_, sizeof(Matrix4), &matrix);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, &matrix, sizeof(Matrix4)))
+                return;
+
             glUniformMatrix4fv(info->location_, 1, GL_FALSE, matrix.Data());
         }
     }
@@ -1250,13 +1740,13 @@ void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
         {
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, sizeof(Vector4), &vector);
+                SetBufferParameter(info->bufferPtr_, info->location_, sizeof(Vector4), &vector);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, &vector, sizeof(Vector4)))
+                return;
+
             // Check the uniform type to avoid mismatch
             switch (info->type_)
             {
@@ -1304,13 +1794,13 @@ void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
 
             if (info->bufferPtr_)
             {
-                ConstantBuffer* buffer = info->bufferPtr_;
-                if (!buffer->IsDirty())
-                    dirtyConstantBuffers_.Push(buffer);
-                buffer->SetParameter(info->location_, sizeof(Matrix4), &fullMatrix);
+                SetBufferParameter(info->bufferPtr_, info->location_, sizeof(Matrix4), &fullMatrix);
                 return;
             }
 
+            if (!CheckUniformUpdate(*info, &fullMatrix, sizeof(Matrix4)))
+                return;
+
             glUniformMatrix4fv(info->location_, 1, GL_FALSE, fullMatrix.Data());
         }
     }
@@ -1367,6 +1857,86 @@ bool Graphics::NeedParameterUpdate(ShaderParameterGroup group, const void* sourc
     return shaderProgram_ ? shaderProgram_->NeedParameterUpdate(group, source) : false;
 }
 
+bool Graphics::SetMaterialConstantBuffers(unsigned parameterHash, const HashMap<StringHash, MaterialShaderParameter>& parameters)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (!gl3Support || !shaderProgram_)
+        return false;
+    
+    const unsigned vsIndex = SP_MATERIAL;
+    const unsigned psIndex = SP_MATERIAL + MAX_SHADER_PARAMETER_GROUPS;
+    const SharedPtr<ConstantBuffer>* programBuffers = shaderProgram_->GetConstantBuffers();
+    ConstantBuffer* vsShared = programBuffers[vsIndex].Get();
+    ConstantBuffer* psShared = programBuffers[psIndex].Get();
+    if (!vsShared && !psShared)
+        return false;
+    
+    // The parameters can not be bound as buffers if the program uses some of them as individual uniforms
+    if (shaderProgram_ != materialBufferProgram_ || parameterHash != materialBufferHash_)
+    {
+        materialBufferProgram_ = shaderProgram_;
+        materialBufferHash_ = parameterHash;
+        materialBufferSupport_ = true;
+        for (HashMap<StringHash, MaterialShaderParameter>::ConstIterator i = parameters.Begin(); i != parameters.End(); ++i)
+        {
+            const ShaderParameter* info = shaderProgram_->GetParameter(i->first_);
+            if (info && !info->bufferPtr_)
+            {
+                materialBufferSupport_ = false;
+                break;
+            }
+        }
+    }
+    
+    if (!materialBufferSupport_)
+    {
+        // Restore the shared buffers in case the buffers of another material are bound
+        SetConstantBuffer(vsIndex, vsShared);
+        SetConstantBuffer(psIndex, psShared);
+        return false;
+    }
+    
+    Pair<unsigned, unsigned> vsKey(parameterHash, vsShared ? (vsIndex << 16) | vsShared->GetSize() : 0);
+    Pair<unsigned, unsigned> psKey(parameterHash, psShared ? (psIndex << 16) | psShared->GetSize() : 0);
+    HashMap<Pair<unsigned, unsigned>, SharedPtr<ConstantBuffer> >::Iterator vs = materialConstantBuffers_.Find(vsKey);
+    HashMap<Pair<unsigned, unsigned>, SharedPtr<ConstantBuffer> >::Iterator ps = materialConstantBuffers_.Find(psKey);
+    
+    if ((vsShared && vs == materialConstantBuffers_.End()) || (psShared && ps == materialConstantBuffers_.End()))
+    {
+        // Write the parameters through the shared buffers, which have the same layout, then keep copies of their data
+        for (HashMap<StringHash, MaterialShaderParameter>::ConstIterator i = parameters.Begin(); i != parameters.End(); ++i)
+            SetShaderParameter(i->first_, i->second_.value_);
+        // The shared buffers no longer hold the parameters of the material they were last set from
+        ShaderProgram::ClearGlobalParameterSource(SP_MATERIAL);
+        
+        if (vsShared && vs == materialConstantBuffers_.End())
+        {
+            SharedPtr<ConstantBuffer> newBuffer(new ConstantBuffer(context_));
+            newBuffer->SetSize(vsShared->GetSize());
+            newBuffer->SetParameter(0, vsShared->GetSize(), vsShared->GetShadowData());
+            newBuffer->Apply();
+            vs = materialConstantBuffers_.Insert(MakePair(vsKey, newBuffer));
+        }
+        if (psShared && ps == materialConstantBuffers_.End())
+        {
+            SharedPtr<ConstantBuffer> newBuffer(new ConstantBuffer(context_));
+            newBuffer->SetSize(psShared->GetSize());
+            newBuffer->SetParameter(0, psShared->GetSize(), psShared->GetShadowData());
+            newBuffer->Apply();
+            ps = materialConstantBuffers_.Insert(MakePair(psKey, newBuffer));
+        }
+    }
+    
+    if (vsShared)
+        SetConstantBuffer(vsIndex, vs->second_);
+    if (psShared)
+        SetConstantBuffer(psIndex, ps->second_);
+    return true;
+    #else
+    return false;
+    #endif
+}
+
 bool Graphics::HasShaderParameter(StringHash param)
 {
     return shaderProgram_ && shaderProgram_->HasParameter(param);
@@ -1447,9 +2017,12 @@ void Graphics::SetTexture(unsigned index, Texture* texture)
         }
         
         textures_[index] = texture;
+        ++numStateChanges_;
     }
     else
     {
+        ++numAvoidedStateChanges_;
+        
         if (texture && texture->GetParametersDirty())
         {
             if (impl_->activeTexture_ != index)
@@ -1476,6 +2049,53 @@ void Graphics::SetTextureForUpdate(Texture* texture)
     textures_[0] = texture;
 }
 
+const void* Graphics::BeginTextureUpload(const void* data, unsigned size)
+{
+    #ifndef GL_ES_VERSION_2_0
+    // Data larger than a region is uploaded directly from client memory
+    if (!gl3Support || !size || size > TEXTURE_UPLOAD_REGION_SIZE)
+        return data;
+    
+    if (!impl_->textureUploadBuffer_)
+    {
+        glGenBuffers(1, &impl_->textureUploadBuffer_);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, impl_->textureUploadBuffer_);
+        impl_->textureUploadRing_ = new BufferRing();
+        impl_->textureUploadRing_->Allocate(GL_PIXEL_UNPACK_BUFFER, TEXTURE_UPLOAD_REGION_SIZE);
+        impl_->textureUploadOffset_ = 0;
+    }
+    else
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, impl_->textureUploadBuffer_);
+    
+    // When the current region is full, move to the next one, waiting until the GPU has finished copying from it
+    if (impl_->textureUploadOffset_ + size > TEXTURE_UPLOAD_REGION_SIZE)
+    {
+        impl_->textureUploadRing_->Advance();
+        impl_->textureUploadOffset_ = 0;
+    }
+    
+    unsigned offset = impl_->textureUploadOffset_;
+    if (!impl_->textureUploadRing_->Write(GL_PIXEL_UNPACK_BUFFER, offset, size, data))
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return data;
+    }
+    
+    impl_->textureUploadOffset_ = (offset + size + 255) & ~255;
+    return reinterpret_cast<const void*>((size_t)(impl_->textureUploadRing_->GetRegionOffset() + offset));
+    #else
+    return data;
+    #endif
+}
+
+void Graphics::EndTextureUpload()
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (impl_->textureUploadBuffer_)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    #endif
+}
+
 void Graphics::SetDefaultTextureFilterMode(TextureFilterMode mode)
 {
     if (mode != defaultTextureFilterMode_)
@@ -1640,7 +2260,10 @@ void Graphics::SetBlendMode(BlendMode mode)
         }
         
         blendMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetColorWrite(bool enable)
@@ -1653,7 +2276,10 @@ void Graphics::SetColorWrite(bool enable)
             glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
         
         colorWrite_ = enable;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetCullMode(CullMode mode)
@@ -1670,7 +2296,10 @@ void Graphics::SetCullMode(CullMode mode)
         }
         
         cullMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetDepthBias(float constantBias, float slopeScaledBias)
@@ -1702,7 +2331,10 @@ void Graphics::SetDepthTest(CompareMode mode)
     {
         glDepthFunc(glCmpFunc[mode]);
         depthTestMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetDepthWrite(bool enable)
@@ -1711,7 +2343,10 @@ void Graphics::SetDepthWrite(bool enable)
     {
         glDepthMask(enable ? GL_TRUE : GL_FALSE);
         depthWrite_ = enable;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
 }
 
 void Graphics::SetFillMode(FillMode mode)
@@ -1721,7 +2356,10 @@ void Graphics::SetFillMode(FillMode mode)
     {
         glPolygonMode(GL_FRONT_AND_BACK, glFillMode[mode]);
         fillMode_ = mode;
+        ++numStateChanges_;
     }
+    else
+        ++numAvoidedStateChanges_;
     #endif
 }
 
@@ -2014,6 +2652,15 @@ unsigned Graphics::GetFormat(CompressedFormat format) const
     }
 }
 
+bool Graphics::GetDepthCopySupport() const
+{
+    #ifndef GL_ES_VERSION_2_0
+    return true;
+    #else
+    return false;
+    #endif
+}
+
 unsigned Graphics::GetMaxBones()
 {
     #ifdef RPI
@@ -2228,6 +2875,15 @@ void Graphics::FreeScratchBuffer(void* buffer)
     LOGWARNING("Reserved scratch buffer " + ToStringHex((unsigned)(size_t)buffer) + " not found");
 }
 
+void Graphics::CleanupMaterialConstantBuffers()
+{
+    // The current bindings may refer to the released buffers
+    currentConstantBuffers_[SP_MATERIAL] = 0;
+    currentConstantBuffers_[SP_MATERIAL + MAX_SHADER_PARAMETER_GROUPS] = 0;
+    materialConstantBuffers_.Clear();
+    materialBufferProgram_ = 0;
+}
+
 void Graphics::CleanupScratchBuffers()
 {
     for (Vector<ScratchBuffer>::Iterator i = scratchBuffers_.Begin(); i != scratchBuffers_.End(); ++i)
@@ -2301,6 +2957,48 @@ void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
 
     if (vertexShader_ == variation || pixelShader_ == variation)
         shaderProgram_ = 0;
+    
+    materialBufferProgram_ = 0;
+}
+
+void Graphics::CleanupVertexArrays(unsigned bufferObject)
+{
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+    if (!bufferObject || impl_->vertexArrays_.Empty())
+        return;
+    
+    for (HashMap<VertexArrayKey, VertexArrayObject>::Iterator i = impl_->vertexArrays_.Begin(); i != impl_->vertexArrays_.End();)
+    {
+        bool usesBuffer = false;
+        for (unsigned j = 0; j < MAX_VERTEX_STREAMS; ++j)
+        {
+            if (i->first_.buffers_[j] == bufferObject)
+            {
+                usesBuffer = true;
+                break;
+            }
+        }
+        
+        if (usesBuffer)
+        {
+            if (impl_->boundVertexArray_ == &i->second_)
+            {
+                BindVertexArray(&impl_->defaultVertexArray_);
+                // Make the next SetVertexBuffers() set all attribute pointers of the default vertex array object
+                impl_->boundVertexArray_ = 0;
+            }
+            glDeleteVertexArrays(1, &i->second_.object_);
+            i = impl_->vertexArrays_.Erase(i);
+        }
+        else
+        {
+            // A deleted index buffer stays attached to vertex array objects that are not bound, so force it to be rebound
+            if (i->second_.indexBuffer_ == bufferObject)
+                i->second_.indexBuffer_ = M_MAX_UNSIGNED;
+            ++i;
+        }
+    }
+    #endif
 }
 
 ConstantBuffer* Graphics::GetOrCreateConstantBuffer(unsigned bindingIndex, unsigned size)
@@ -2328,27 +3026,82 @@ void Graphics::Release(bool clearGPUObjects, bool closeWindow)
             // Shutting down: release all GPU objects that still exist
             // Shader programs are also GPU objects; clear them first to avoid list modification during iteration
             shaderPrograms_.Clear();
+            CleanupMaterialConstantBuffers();
 
             for (PODVector<GPUObject*>::Iterator i = gpuObjects_.Begin(); i != gpuObjects_.End(); ++i)
                 (*i)->Release();
             gpuObjects_.Clear();
+            
+            #ifndef GL_ES_VERSION_2_0
+            for (PODVector<unsigned>::Iterator i = occlusionQueries_.Begin(); i != occlusionQueries_.End(); ++i)
+            {
+                if (*i)
+                    glDeleteQueries(1, &(*i));
+            }
+            #endif
+            occlusionQueries_.Clear();
+            freeOcclusionQueries_.Clear();
         }
         else
         {
             // We are not shutting down, but recreating the context: mark GPU objects lost
             for (PODVector<GPUObject*>::Iterator i = gpuObjects_.Begin(); i != gpuObjects_.End(); ++i)
                 (*i)->OnDeviceLost();
+            
+            // Occlusion queries are recreated on their next use, so the handles stay valid
+            for (PODVector<unsigned>::Iterator i = occlusionQueries_.Begin(); i != occlusionQueries_.End(); ++i)
+                *i = 0;
                 
             // In this case clear shader programs last so that they do not attempt to delete their OpenGL program
-            // from a context that may no longer exist
+            // from a context that may no longer exist. The material constant buffer contents would not be restored
             shaderPrograms_.Clear();
+            CleanupMaterialConstantBuffers();
 
             SendEvent(E_DEVICELOST);
         }
     }
 
+    ReleaseGPUProfileQueries();
     CleanupFramebuffers();
     depthTextures_.Clear();
+    
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+    ClearVertexArrays();
+    if (impl_->defaultVertexArray_.object_)
+    {
+        if (!IsDeviceLost())
+            glDeleteVertexArrays(1, &impl_->defaultVertexArray_.object_);
+        impl_->defaultVertexArray_ = VertexArrayObject();
+    }
+    impl_->boundVertexArray_ = 0;
+    #endif
+    
+    #ifndef GL_ES_VERSION_2_0
+    if (impl_->indirectBuffer_)
+    {
+        if (!IsDeviceLost())
+            glDeleteBuffers(1, &impl_->indirectBuffer_);
+        impl_->indirectBuffer_ = 0;
+    }
+    if (impl_->textureUploadBuffer_)
+    {
+        if (!IsDeviceLost())
+        {
+            impl_->textureUploadRing_->ReleaseFences();
+            glDeleteBuffers(1, &impl_->textureUploadBuffer_);
+        }
+        delete impl_->textureUploadRing_;
+        impl_->textureUploadRing_ = 0;
+        impl_->textureUploadBuffer_ = 0;
+        impl_->textureUploadOffset_ = 0;
+    }
+    if (impl_->frameFence_)
+    {
+        if (!IsDeviceLost())
+            glDeleteSync(impl_->frameFence_);
+        impl_->frameFence_ = 0;
+    }
+    #endif
 
     // End fullscreen mode first to counteract transition and getting stuck problems on OS X
     #if defined(__APPLE__) && !defined(IOS)
@@ -2400,8 +3153,8 @@ void Graphics::Restore()
     {
         impl_->context_ = SDL_GL_CreateContext(impl_->window_);
 
-        #ifndef GL_ES_VERSION_2_0
-        // If we're trying to use OpenGL 3, but context creation fails, retry with 2
+        #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+        // If we're trying to use OpenGL 3 or WebGL 2, but context creation fails, retry with 2 or WebGL 1
         if (!forceGL2_ && !impl_->context_)
         {
             forceGL2_ = true;
@@ -2437,12 +3190,14 @@ void Graphics::Restore()
         if (!forceGL2_ && GLEW_VERSION_3_2)
         {
             gl3Support = true;
+            vertexArraySupport_ = true;
             apiName_ = "GL3";
 
-            // Create and bind a vertex array object that will stay in use throughout
-            unsigned vertexArrayObject;
-            glGenVertexArrays(1, &vertexArrayObject);
-            glBindVertexArray(vertexArrayObject);
+            // Create and bind the default vertex array object, used for vertex buffers that can not have a cached one
+            glGenVertexArrays(1, &impl_->defaultVertexArray_.object_);
+            glBindVertexArray(impl_->defaultVertexArray_.object_);
+            impl_->defaultVertexArray_.indexBuffer_ = 0;
+            impl_->boundVertexArray_ = &impl_->defaultVertexArray_;
         }
         else if (GLEW_VERSION_2_0)
         {
@@ -2453,6 +3208,7 @@ void Graphics::Restore()
             }
 
             gl3Support = false;
+            vertexArraySupport_ = false;
             apiName_ = "GL2";
         }
         else
@@ -2460,6 +3216,25 @@ void Graphics::Restore()
             LOGERROR("OpenGL 2.0 is required");
             return;
         }
+        #elif defined(GL_ES_VERSION_3_0)
+        // The shaders stay on GLSL ES 1.00 also on WebGL 2, but vertex array objects and instancing are used. The browser
+        // may also have fallen back to WebGL 1
+        String version((const char*)glGetString(GL_VERSION));
+        if (!forceGL2_ && version.Contains("OpenGL ES 3"))
+        {
+            vertexArraySupport_ = true;
+            apiName_ = "GLES3";
+
+            glGenVertexArrays(1, &impl_->defaultVertexArray_.object_);
+            glBindVertexArray(impl_->defaultVertexArray_.object_);
+            impl_->defaultVertexArray_.indexBuffer_ = 0;
+            impl_->boundVertexArray_ = &impl_->defaultVertexArray_;
+        }
+        else
+        {
+            vertexArraySupport_ = false;
+            apiName_ = "GLES2";
+        }
         #endif
 
         // Set up texture data read/write alignment. It is important that this is done before uploading any texture data
@@ -2723,6 +3498,10 @@ void Graphics::CheckFeatureSupport()
     deferredSupport_ = false;
     
     #ifndef GL_ES_VERSION_2_0
+    // Occlusion queries are part of core OpenGL since 1.5
+    occlusionQuerySupport_ = true;
+    timerQuerySupport_ = glQueryCounter && (GLEW_VERSION_3_3 || GLEW_ARB_timer_query);
+    
     int numSupportedRTs = 1;
     if (gl3Support)
     {
@@ -2736,6 +3515,11 @@ void Graphics::CheckFeatureSupport()
         glVertexAttribDivisor(ELEMENT_INSTANCEMATRIX1, 1);
         glVertexAttribDivisor(ELEMENT_INSTANCEMATRIX2, 1);
         glVertexAttribDivisor(ELEMENT_INSTANCEMATRIX3, 1);
+        
+        // Multi-draw indirect must also respect the base instance of the commands
+        indirectDrawSupport_ = glMultiDrawElementsIndirect && (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect &&
+            GLEW_ARB_base_instance));
+        framebufferDiscardSupport_ = glInvalidateFramebuffer && (GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata);
 
         glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &numSupportedRTs);
     }
@@ -2777,6 +3561,16 @@ void Graphics::CheckFeatureSupport()
     // Check for supported compressed texture formats
     #ifdef EMSCRIPTEN
     dxtTextureSupport_ = CheckExtension("WEBGL_compressed_texture_s3tc");
+    #ifdef GL_ES_VERSION_3_0
+    // Instancing is core in WebGL 2 and an extension in WebGL 1
+    instancingSupport_ = vertexArraySupport_ || CheckExtension("ANGLE_instanced_arrays");
+    if (instancingSupport_)
+    {
+        glVertexAttribDivisor(ELEMENT_INSTANCEMATRIX1, 1);
+        glVertexAttribDivisor(ELEMENT_INSTANCEMATRIX2, 1);
+        glVertexAttribDivisor(ELEMENT_INSTANCEMATRIX3, 1);
+    }
+    #endif
     #else
     dxtTextureSupport_ = CheckExtension("EXT_texture_compression_dxt1");
     etcTextureSupport_ = CheckExtension("OES_compressed_ETC1_RGB8_texture");
@@ -2812,7 +3606,14 @@ void Graphics::CheckFeatureSupport()
         dummyColorFormat_ = GetRGBAFormat();
         #endif
     }
+    
+    // Check for framebuffer discard, which allows tile-based GPUs to skip writing unneeded contents back to memory
+    if (CheckExtension("GL_EXT_discard_framebuffer"))
+        glDiscardFramebufferFunc = (PFNGLDISCARDFRAMEBUFFEREXTPROC)SDL_GL_GetProcAddress("glDiscardFramebufferEXT");
+    framebufferDiscardSupport_ = glDiscardFramebufferFunc != 0;
     #endif
+    
+    ShaderProgram::CheckBinarySupport();
 }
 
 void Graphics::PrepareDraw()
@@ -2821,7 +3622,14 @@ void Graphics::PrepareDraw()
     if (gl3Support)
     {
         for (PODVector<ConstantBuffer*>::Iterator i = dirtyConstantBuffers_.Begin(); i != dirtyConstantBuffers_.End(); ++i)
+        {
+            if ((*i)->IsDirty())
+            {
+                numParameterBytes_ += (*i)->GetSize();
+                ++numStateChanges_;
+            }
             (*i)->Apply();
+        }
         dirtyConstantBuffers_.Clear();
     }
     #endif
@@ -3033,6 +3841,31 @@ void Graphics::PrepareDraw()
     }
 }
 
+void Graphics::SetBufferParameter(ConstantBuffer* buffer, unsigned offset, unsigned size, const void* data)
+{
+    bool wasDirty = buffer->IsDirty();
+    if (buffer->SetParameter(offset, size, data))
+    {
+        if (!wasDirty)
+            dirtyConstantBuffers_.Push(buffer);
+    }
+    else
+        ++numAvoidedStateChanges_;
+}
+
+bool Graphics::CheckUniformUpdate(const ShaderParameter& param, const void* data, unsigned size)
+{
+    if (!shaderProgram_->SetParameterValue(param, data, size))
+    {
+        ++numAvoidedStateChanges_;
+        return false;
+    }
+    
+    numParameterBytes_ += (param.valueSize_ && param.valueSize_ < size) ? param.valueSize_ : size;
+    ++numStateChanges_;
+    return true;
+}
+
 void Graphics::CleanupFramebuffers()
 {
     if (!IsDeviceLost())
@@ -3051,12 +3884,133 @@ void Graphics::CleanupFramebuffers()
     impl_->frameBuffers_.Clear();
 }
 
+bool Graphics::SetCachedVertexArray(const PODVector<VertexBuffer*>& buffers, const PODVector<unsigned>& elementMasks,
+    unsigned instanceOffset)
+{
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+    VertexArrayKey key;
+    key.instanceOffset_ = instanceOffset;
+    bool changed = !impl_->boundVertexArray_ || instanceOffset != lastInstanceOffset_;
+    
+    for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
+    {
+        VertexBuffer* buffer = i < buffers.Size() ? buffers[i] : 0;
+        unsigned elementMask = 0;
+        
+        if (buffer)
+        {
+            // Buffers whose data offset changes (dynamic buffers in a ring) or without an OpenGL object use the default
+            // vertex array object instead
+            if (buffer->GetDataOffset() || !buffer->GetGPUObject())
+                return false;
+            
+            unsigned bufferMask = buffer->GetElementMask();
+            elementMask = elementMasks[i] == MASK_DEFAULT ? bufferMask : bufferMask & elementMasks[i];
+            key.buffers_[i] = buffer->GetGPUObject();
+            key.bufferMasks_[i] = bufferMask;
+            key.elementMasks_[i] = elementMask;
+        }
+        
+        if (buffer != vertexBuffers_[i] || elementMask != elementMasks_[i] || vertexBufferOffsets_[i])
+            changed = true;
+    }
+    
+    if (!changed)
+    {
+        ++numAvoidedStateChanges_;
+        return true;
+    }
+    
+    HashMap<VertexArrayKey, VertexArrayObject>::Iterator i = impl_->vertexArrays_.Find(key);
+    if (i == impl_->vertexArrays_.End())
+    {
+        if (impl_->vertexArrays_.Size() >= MAX_VERTEX_ARRAYS)
+            ClearVertexArrays();
+        
+        i = impl_->vertexArrays_.Insert(MakePair(key, VertexArrayObject()));
+        glGenVertexArrays(1, &i->second_.object_);
+        BindVertexArray(&i->second_);
+        
+        // Set up the attributes once, they are stored in the vertex array object
+        for (unsigned j = 0; j < MAX_VERTEX_STREAMS; ++j)
+        {
+            if (!key.elementMasks_[j])
+                continue;
+            
+            VertexBuffer* buffer = buffers[j];
+            SetVBO(buffer->GetGPUObject());
+            
+            for (unsigned k = 0; k < MAX_VERTEX_ELEMENTS; ++k)
+            {
+                if (key.elementMasks_[j] & (1 << k))
+                {
+                    glEnableVertexAttribArray(glVertexAttrIndex[k]);
+                    SetVertexAttribPointer(buffer, (VertexElement)k, 0, instanceOffset);
+                    // The instancing divisors are also part of the vertex array object state
+                    if (k >= ELEMENT_INSTANCEMATRIX1)
+                        glVertexAttribDivisor(glVertexAttrIndex[k], 1);
+                }
+            }
+        }
+    }
+    else
+        BindVertexArray(&i->second_);
+    
+    for (unsigned j = 0; j < MAX_VERTEX_STREAMS; ++j)
+    {
+        vertexBuffers_[j] = j < buffers.Size() ? buffers[j] : 0;
+        elementMasks_[j] = key.elementMasks_[j];
+        vertexBufferOffsets_[j] = 0;
+    }
+    lastInstanceOffset_ = instanceOffset;
+    ++numStateChanges_;
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+void Graphics::BindVertexArray(VertexArrayObject* vertexArray)
+{
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+    if (impl_->boundVertexArray_ != vertexArray)
+    {
+        glBindVertexArray(vertexArray->object_);
+        impl_->boundVertexArray_ = vertexArray;
+    }
+    
+    unsigned indexObject = indexBuffer_ ? indexBuffer_->GetGPUObject() : 0;
+    if (vertexArray->indexBuffer_ != indexObject)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexObject);
+        vertexArray->indexBuffer_ = indexObject;
+    }
+    #endif
+}
+
+void Graphics::ClearVertexArrays()
+{
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
+    if (impl_->boundVertexArray_ != &impl_->defaultVertexArray_)
+        impl_->boundVertexArray_ = 0;
+    
+    if (!IsDeviceLost())
+    {
+        for (HashMap<VertexArrayKey, VertexArrayObject>::Iterator i = impl_->vertexArrays_.Begin(); i !=
+            impl_->vertexArrays_.End(); ++i)
+            glDeleteVertexArrays(1, &i->second_.object_);
+    }
+    impl_->vertexArrays_.Clear();
+    #endif
+}
+
 void Graphics::ResetCachedState()
 {
     for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
     {
         vertexBuffers_[i] = 0;
         elementMasks_[i] = 0;
+        vertexBufferOffsets_[i] = 0;
     }
     
     for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
@@ -3114,6 +4068,9 @@ void Graphics::ResetCachedState()
     for (unsigned i = 0; i < MAX_SHADER_PARAMETER_GROUPS * 2; ++i)
         currentConstantBuffers_[i] = 0;
     dirtyConstantBuffers_.Clear();
+    materialBufferProgram_ = 0;
+    materialBufferHash_ = 0;
+    materialBufferSupport_ = false;
 }
 
 void Graphics::SetTextureUnitMappings()
@@ -3133,10 +4090,13 @@ void Graphics::SetTextureUnitMappings()
     textureUnits_["ShadowMap"] = TU_SHADOWMAP;
     #ifdef DESKTOP_GRAPHICS
     textureUnits_["VolumeMap"] = TU_VOLUMEMAP;
+    textureUnits_["SkinMatrixMap"] = TU_SKINMATRICES;
+    textureUnits_["HeightMap"] = TU_HEIGHTMAP;
     textureUnits_["FaceSelectCubeMap"] = TU_FACESELECT;
     textureUnits_["IndirectionCubeMap"] = TU_INDIRECTION;
     textureUnits_["DepthBuffer"] = TU_DEPTHBUFFER;
     textureUnits_["LightBuffer"] = TU_LIGHTBUFFER;
+    textureUnits_["LightClusterMap"] = TU_LIGHTCLUSTERS;
     textureUnits_["ZoneCubeMap"] = TU_ZONE;
     textureUnits_["ZoneVolumeMap"] = TU_ZONE;
     #endif
@@ -3230,6 +4190,21 @@ void Graphics::BindStencilAttachment(unsigned object, bool isRenderBuffer)
     }
 }
 
+void Graphics::SetConstantBuffer(unsigned index, ConstantBuffer* buffer)
+{
+    #ifndef GL_ES_VERSION_2_0
+    if (buffer != currentConstantBuffers_[index])
+    {
+        unsigned object = buffer ? buffer->GetGPUObject() : 0;
+        glBindBufferBase(GL_UNIFORM_BUFFER, index, object);
+        // Calling glBindBufferBase also affects the generic buffer binding point
+        impl_->boundUBO_ = object;
+        currentConstantBuffers_[index] = buffer;
+        ShaderProgram::ClearGlobalParameterSource((ShaderParameterGroup)(index % MAX_SHADER_PARAMETER_GROUPS));
+    }
+    #endif
+}
+
 bool Graphics::CheckFramebuffer()
 {
 #ifndef GL_ES_VERSION_2_0
@@ -3240,6 +4215,91 @@ bool Graphics::CheckFramebuffer()
         return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
 }
 
+static String GetProgramBinaryName(const String& cacheDir, ShaderVariation* vs, ShaderVariation* ps)
+{
+    return cacheDir + StringHash(vs->GetOwner()->GetName() + vs->GetDefines() + " " + ps->GetOwner()->GetName() +
+        ps->GetDefines()).ToString() + ".bin";
+}
+
+static unsigned GetProgramBinaryHash(ShaderVariation* vs, ShaderVariation* ps)
+{
+    // Cover everything that affects the compiled result, so that a binary of edited shader source is not used
+    String source = vs->GetOwner()->GetSourceCode(VS) + vs->GetDefines() + ps->GetOwner()->GetSourceCode(PS) +
+        ps->GetDefines() + String(Graphics::GetMaxBones()) + String(Graphics::GetGL3Support());
+    return StringHash(source).Value();
+}
+
+static String GetProgramBinaryDriver()
+{
+    return String((const char*)glGetString(GL_VENDOR)) + " " + String((const char*)glGetString(GL_RENDERER)) + " " +
+        String((const char*)glGetString(GL_VERSION));
+}
+
+bool Graphics::LoadProgramBinary(ShaderVariation* vs, ShaderVariation* ps)
+{
+    if (shaderCacheDir_.Empty() || !ShaderProgram::GetBinarySupport() || !vs->GetOwner() || !ps->GetOwner())
+        return false;
+    
+    String fileName = GetProgramBinaryName(shaderCacheDir_, vs, ps);
+    if (!GetSubsystem<FileSystem>()->FileExists(fileName))
+        return false;
+    
+    SharedPtr<File> file(new File(context_, fileName));
+    if (!file->IsOpen() || file->ReadFileID() != "UPRG")
+        return false;
+    
+    // A binary of changed shader source or from another driver is ignored and replaced once the shaders are relinked
+    if (file->ReadUInt() != GetProgramBinaryHash(vs, ps) || file->ReadString() != GetProgramBinaryDriver())
+        return false;
+    
+    unsigned format = file->ReadUInt();
+    PODVector<unsigned char> data(file->ReadUInt());
+    if (data.Empty() || file->Read(&data[0], data.Size()) != data.Size())
+        return false;
+    
+    PROFILE(LoadProgramBinary);
+    
+    SharedPtr<ShaderProgram> newProgram(new ShaderProgram(this, vs, ps));
+    if (!newProgram->LoadBinary(format, data))
+    {
+        LOGDEBUG("Driver rejected program binary of vertex shader " + vs->GetFullName() + " and pixel shader " +
+            ps->GetFullName());
+        return false;
+    }
+    
+    LOGDEBUG("Loaded program binary of vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+    shaderPrograms_[MakePair(vs, ps)] = newProgram;
+    return true;
+}
+
+void Graphics::SaveProgramBinary(ShaderProgram* program)
+{
+    ShaderVariation* vs = program->GetVertexShader();
+    ShaderVariation* ps = program->GetPixelShader();
+    if (shaderCacheDir_.Empty() || !ShaderProgram::GetBinarySupport() || !vs || !ps || !vs->GetOwner() || !ps->GetOwner())
+        return;
+    
+    unsigned format;
+    PODVector<unsigned char> data;
+    if (!program->GetBinary(format, data))
+        return;
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem->DirExists(shaderCacheDir_))
+        fileSystem->CreateDir(shaderCacheDir_);
+    
+    SharedPtr<File> file(new File(context_, GetProgramBinaryName(shaderCacheDir_, vs, ps), FILE_WRITE));
+    if (!file->IsOpen())
+        return;
+    
+    file->WriteFileID("UPRG");
+    file->WriteUInt(GetProgramBinaryHash(vs, ps));
+    file->WriteString(GetProgramBinaryDriver());
+    file->WriteUInt(format);
+    file->WriteUInt(data.Size());
+    file->Write(&data[0], data.Size());
+}
+
 void RegisterGraphicsLibrary(Context* context)
 {
     Animation::RegisterObject(context);
@@ -3249,6 +4309,7 @@ void RegisterGraphicsLibrary(Context* context)
     Technique::RegisterObject(context);
     Texture2D::RegisterObject(context);
     Texture3D::RegisterObject(context);
+    Texture2DArray::RegisterObject(context);
     TextureCube::RegisterObject(context);
     Camera::RegisterObject(context);
     Drawable::RegisterObject(context);
@@ -3257,14 +4318,18 @@ void RegisterGraphicsLibrary(Context* context)
     StaticModelGroup::RegisterObject(context);
     Skybox::RegisterObject(context);
     AnimatedModel::RegisterObject(context);
+    AnimatedModelGroup::RegisterObject(context);
     AnimationController::RegisterObject(context);
     BillboardSet::RegisterObject(context);
+    ImpostorSet::RegisterObject(context);
     ParticleEffect::RegisterObject(context);
     ParticleEmitter::RegisterObject(context);
+    GPUParticleEmitter::RegisterObject(context);
     CustomGeometry::RegisterObject(context);
     DecalSet::RegisterObject(context);
     Terrain::RegisterObject(context);
     TerrainPatch::RegisterObject(context);
+    CDLODTerrain::RegisterObject(context);
     DebugRenderer::RegisterObject(context);
     Octree::RegisterObject(context);
     Zone::RegisterObject(context);
@@ -52,6 +52,10 @@ class Vector3;
 class Vector4;
 class VertexBuffer;
 
+struct MaterialShaderParameter;
+struct ShaderParameter;
+struct VertexArrayObject;
+
 typedef HashMap<Pair<ShaderVariation*, ShaderVariation*>, SharedPtr<ShaderProgram> > ShaderProgramMap;
 
 static const unsigned NUM_SCREEN_BUFFERS = 2;
@@ -100,10 +104,18 @@ public:
     bool SetMode(int width, int height);
     /// Set whether the main window uses sRGB conversion on write.
     void SetSRGB(bool enable);
-    /// Set whether to flush the GPU command buffer to prevent multiple frames being queued and uneven frame timesteps. Not yet implemented on OpenGL.
+    /// Set whether to flush the GPU command buffer to prevent multiple frames being queued and uneven frame timesteps. Requires OpenGL 3.
     void SetFlushGPU(bool enable);
-    /// Set forced use of OpenGL 2 even if OpenGL 3 is available. Must be called before setting the screen mode for the first time. Default false.
+    /// Set whether to execute and present frames in a render thread. Not supported on OpenGL.
+    void SetRenderThread(bool enable);
+    /// Set forced use of OpenGL 2 even if OpenGL 3 is available, or WebGL 1 even if WebGL 2 is available. Must be called before setting the screen mode for the first time. Default false.
     void SetForceGL2(bool enable);
+    /// Set whether to compile shaders in worker threads. Not supported on OpenGL, where shaders are always compiled when first used.
+    void SetAsyncShaders(bool enable);
+    /// Set the shader defines to keep in the fallback permutation used while an asynchronously compiled shader is not ready. Not supported on OpenGL.
+    void SetShaderFallbackDefines(const String& defines);
+    /// Set the directory to store linked shader program binaries in, so that shaders do not need to be compiled and linked on later runs. Empty (default) disables the cache. Has no effect if the driver does not support program binaries.
+    void SetShaderCacheDir(const String& path);
     /// Set allowed screen orientations as a space-separated list of "LandscapeLeft", "LandscapeRight", "Portrait" and "PortraitUpsideDown". Affects currently only iOS platform.
     void SetOrientations(const String& orientations);
     /// Toggle between full screen and windowed mode. Return true if successful.
@@ -118,14 +130,42 @@ public:
     void EndFrame();
     /// Clear any or all of rendertarget, depth buffer and stencil buffer.
     void Clear(unsigned flags, const Color& color = Color(0.0f, 0.0f, 0.0f, 0.0f), float depth = 1.0f, unsigned stencil = 0);
+    /// Discard any or all of the current rendertarget, depth buffer and stencil buffer contents, when they are not needed anymore. Avoids writing them back to memory on tile-based GPUs.
+    void DiscardFramebuffer(unsigned flags);
     /// Resolve multisampled backbuffer to a texture rendertarget. The texture's size should match the viewport size.
     bool ResolveToTexture(Texture2D* destination, const IntRect& viewport);
+    /// Copy the contents of a depth-stencil texture to another of the same size and format. Return true on success.
+    bool CopyDepthTexture(Texture2D* destination, Texture2D* source);
     /// Draw non-indexed geometry.
     void Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount);
     /// Draw indexed geometry.
     void Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount);
     /// Draw indexed, instanced geometry.
     void DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount, unsigned instanceCount);
+    /// Draw several indexed, instanced geometries from the current index buffer and vertex buffers in one call, using the instance start of each command to offset the instanced vertex streams. Requires indirect draw support.
+    void DrawIndirect(PrimitiveType type, const IndirectDrawCommand* commands, unsigned count);
+    /// Create an occlusion query and return its handle, or 0 if not supported.
+    unsigned CreateOcclusionQuery();
+    /// Destroy an occlusion query.
+    void DestroyOcclusionQuery(unsigned query);
+    /// Begin an occlusion query. Draw calls until EndOcclusionQuery() are tested against the depth buffer.
+    void BeginOcclusionQuery(unsigned query);
+    /// End an occlusion query.
+    void EndOcclusionQuery(unsigned query);
+    /// Return the result of an occlusion query without waiting for the GPU. Return false if not available yet.
+    bool GetOcclusionQueryResult(unsigned query, bool& visible);
+    /// Set GPU profiling enabled. Measures the GPU time of the blocks between BeginGPUProfileBlock() and EndGPUProfileBlock() with timer queries, which are read back a few frames later.
+    void SetGPUProfiling(bool enable);
+    /// Begin a GPU profiling block. Blocks can be nested. No-op if GPU profiling is disabled or outside BeginFrame() and EndFrame().
+    void BeginGPUProfileBlock(const char* name);
+    /// End the current GPU profiling block.
+    void EndGPUProfileBlock();
+    /// Begin recording rendering commands to a command list. Not supported on OpenGL, always returns false.
+    bool BeginCommandList() { return false; }
+    /// End recording rendering commands. Not supported on OpenGL, always returns null.
+    void* EndCommandList() { return 0; }
+    /// Execute and release a recorded command list. Not supported on OpenGL.
+    void ExecuteCommandList(void* commandList) {}
     /// Set vertex buffer.
     void SetVertexBuffer(VertexBuffer* buffer);
     /// Set multiple vertex buffers.
@@ -158,6 +198,8 @@ public:
     void SetShaderParameter(StringHash param, const Variant& value);
     /// Check whether a shader parameter group needs update. Does not actually check whether parameters exist in the shaders.
     bool NeedParameterUpdate(ShaderParameterGroup group, const void* source);
+    /// Bind persistent constant buffers holding material shader parameters, identified by their hash, in place of the shared material constant buffers. The buffers are filled only when first used. Return true if the current shader program reads all the parameters from constant buffers, so that they do not need to be set individually. OpenGL 3 only.
+    bool SetMaterialConstantBuffers(unsigned parameterHash, const HashMap<StringHash, MaterialShaderParameter>& parameters);
     /// Check whether a shader parameter exists on the currently set shaders.
     bool HasShaderParameter(StringHash param);
     /// Check whether the current pixel shader uses a texture unit.
@@ -172,6 +214,10 @@ public:
     void SetTexture(unsigned index, Texture* texture);
     /// Bind texture unit 0 for update. Called by Texture.
     void SetTextureForUpdate(Texture* texture);
+    /// Copy texture data to the upload pixel buffer object and bind it for the following texture data call. Return the pointer to pass to the call, which is the original data if it was not staged. Called by Texture.
+    const void* BeginTextureUpload(const void* data, unsigned size);
+    /// Unbind the upload pixel buffer object after a texture data call. Called by Texture.
+    void EndTextureUpload();
     /// Set default texture filtering mode.
     void SetDefaultTextureFilterMode(TextureFilterMode mode);
     /// Set texture anisotropy.
@@ -254,7 +300,15 @@ public:
     /// Return whether the main window is using sRGB conversion on write.
     bool GetSRGB() const { return sRGB_; }
     /// Return whether the GPU command buffer is flushed each frame. Not yet implemented on OpenGL.
-    bool GetFlushGPU() const { return false; }
+    bool GetFlushGPU() const { return flushGPU_; }
+    /// Return whether frames are executed and presented in a render thread. Always false on OpenGL.
+    bool GetRenderThread() const { return false; }
+    /// Return whether compiles shaders in worker threads. Always false on OpenGL.
+    bool GetAsyncShaders() const { return false; }
+    /// Return the shader defines kept in the fallback permutation. Always empty on OpenGL.
+    const String& GetShaderFallbackDefines() const { return String::EMPTY; }
+    /// Return the shader program binary cache directory.
+    const String& GetShaderCacheDir() const { return shaderCacheDir_; }
     /// Return whether OpenGL 2 use is forced.
     bool GetForceGL2() const { return forceGL2_; }
     /// Return allowed screen orientations.
@@ -265,6 +319,12 @@ public:
     unsigned GetNumPrimitives() const { return numPrimitives_; }
     /// Return number of batches drawn this frame.
     unsigned GetNumBatches() const { return numBatches_; }
+    /// Return number of render state changes, texture and buffer binds and shader parameter updates sent to the GPU this frame.
+    unsigned GetNumStateChanges() const { return numStateChanges_; }
+    /// Return number of redundant render state changes, binds and shader parameter updates filtered out this frame.
+    unsigned GetNumAvoidedStateChanges() const { return numAvoidedStateChanges_; }
+    /// Return number of shader parameter bytes uploaded this frame.
+    unsigned GetNumParameterBytes() const { return numParameterBytes_; }
     /// Return dummy color texture format for shadow maps. 0 if not needed, may be nonzero on OS X to work around an Intel driver issue.
     unsigned GetDummyColorFormat() const { return dummyColorFormat_; }
     /// Return shadow map depth texture format, or 0 if not supported.
@@ -273,6 +333,28 @@ public:
     unsigned GetHiresShadowMapFormat() const { return hiresShadowMapFormat_; }
     /// Return whether hardware instancing is supported.
     bool GetInstancingSupport() const { return instancingSupport_; }
+    /// Return whether indirect drawing of several instanced geometries in one call is supported.
+    bool GetIndirectDrawSupport() const { return indirectDrawSupport_; }
+    /// Return whether discarding framebuffer contents is supported.
+    bool GetFramebufferDiscardSupport() const { return framebufferDiscardSupport_; }
+    /// Return whether 2D texture arrays are supported.
+    bool GetTextureArraySupport() const { return gl3Support; }
+    /// Return whether hardware occlusion queries are supported.
+    bool GetOcclusionQuerySupport() const { return occlusionQuerySupport_; }
+    /// Return whether GPU timer queries for GPU profiling are supported.
+    bool GetTimerQuerySupport() const { return timerQuerySupport_; }
+    /// Return whether GPU profiling is enabled.
+    bool GetGPUProfiling() const { return gpuProfiling_; }
+    /// Return the GPU profiling blocks of the latest frame whose timer queries have completed.
+    const Vector<GPUProfileBlock>& GetGPUProfileResults() const { return gpuProfileResults_; }
+    /// Return whether recording rendering commands to command lists is supported. Always false on OpenGL.
+    bool GetCommandListSupport() const { return false; }
+    /// Return whether is recording rendering commands to a command list. Always false on OpenGL.
+    bool IsRecordingCommandList() const { return false; }
+    /// Return whether skinning from a bone matrix texture is supported.
+    bool GetTextureSkinningSupport() const { return gl3Support; }
+    /// Return whether vertex shaders can fetch from textures, as needed by CDLOD terrain.
+    bool GetVertexTextureSupport() const { return gl3Support; }
     /// Return whether light pre-pass rendering is supported.
     bool GetLightPrepassSupport() const { return lightPrepassSupport_; }
     /// Return whether deferred rendering is supported.
@@ -283,6 +365,8 @@ public:
     bool GetHardwareShadowSupport() const { return true; }
     /// Return whether a readable hardware depth format is available.
     bool GetReadableDepthSupport() const { return GetReadableDepthFormat() != 0; }
+    /// Return whether depth-stencil textures can be copied. Not supported on OpenGL ES.
+    bool GetDepthCopySupport() const;
     /// Return whether sRGB conversion on texture sampling is supported.
     bool GetSRGBSupport() const { return sRGBSupport_; }
     /// Return whether sRGB conversion on rendertarget writing is supported.
@@ -299,6 +383,10 @@ public:
     ShaderVariation* GetShader(ShaderType type, const String& name, const String& defines = String::EMPTY) const;
     /// Return a shader variation by name and defines.
     ShaderVariation* GetShader(ShaderType type, const char* name, const char* defines) const;
+    /// Return the resource directory shaders are loaded from.
+    const String& GetShaderPath() const { return shaderPath_; }
+    /// Return the shader source file extension.
+    const String& GetShaderExtension() const { return shaderExtension_; }
     /// Return current vertex buffer by index.
     VertexBuffer* GetVertexBuffer(unsigned index) const;
     /// Return index buffer.
@@ -386,6 +474,8 @@ public:
     void CleanupRenderSurface(RenderSurface* surface);
     /// Clean up shader programs when a shader variation is released or destroyed.
     void CleanupShaderPrograms(ShaderVariation* variation);
+    /// Clean up cached vertex array objects that use a vertex or index buffer object which is about to be deleted.
+    void CleanupVertexArrays(unsigned bufferObject);
     /// Reserve a constant buffer.
     ConstantBuffer* GetOrCreateConstantBuffer(unsigned bindingIndex, unsigned size);
     /// Release/clear GPU objects and optionally close the window.
@@ -449,10 +539,26 @@ private:
     void CreateWindowIcon();
     /// Check supported rendering features.
     void CheckFeatureSupport();
+    /// Begin GPU profiling of a frame. Read back the results of the oldest frame in flight.
+    void BeginGPUProfileFrame();
+    /// End GPU profiling of a frame.
+    void EndGPUProfileFrame();
+    /// Release the GPU profiling timer queries.
+    void ReleaseGPUProfileQueries();
     /// Prepare for draw call. Update constant buffers and setup the FBO.
     void PrepareDraw();
+    /// Write a shader parameter to a constant buffer and queue the buffer for update if the value changed.
+    void SetBufferParameter(ConstantBuffer* buffer, unsigned offset, unsigned size, const void* data);
+    /// Check whether an individual uniform value differs from the last uploaded value. Return true if needs to be uploaded.
+    bool CheckUniformUpdate(const ShaderParameter& param, const void* data, unsigned size);
     /// Clean up all framebuffers. Called when destroying the context.
     void CleanupFramebuffers();
+    /// Bind a cached vertex array object for the vertex buffers, creating it if necessary. Return false if the buffers can not use a cached vertex array. GL3 only.
+    bool SetCachedVertexArray(const PODVector<VertexBuffer*>& buffers, const PODVector<unsigned>& elementMasks, unsigned instanceOffset);
+    /// Bind a vertex array object and the current index buffer to it, avoiding redundant operation. GL3 only.
+    void BindVertexArray(VertexArrayObject* vertexArray);
+    /// Delete all cached vertex array objects. GL3 only.
+    void ClearVertexArrays();
     /// Reset cached rendering state.
     void ResetCachedState();
     /// Initialize texture unit mappings.
@@ -471,6 +577,14 @@ private:
     void BindStencilAttachment(unsigned object, bool isRenderBuffer);
     /// Check FBO completeness using either extension or core functionality.
     bool CheckFramebuffer();
+    /// Bind a constant buffer to a binding index if not bound already.
+    void SetConstantBuffer(unsigned index, ConstantBuffer* buffer);
+    /// Release the material constant buffers.
+    void CleanupMaterialConstantBuffers();
+    /// Load the linked program of a shader combination from the program binary cache. Return true if successful.
+    bool LoadProgramBinary(ShaderVariation* vs, ShaderVariation* ps);
+    /// Store a linked program to the program binary cache.
+    void SaveProgramBinary(ShaderProgram* program);
     
     /// Mutex for accessing the GPU objects vector from several threads.
     Mutex gpuObjectMutex_;
@@ -502,10 +616,22 @@ private:
     bool tripleBuffer_;
     /// sRGB conversion on write flag for the main window.
     bool sRGB_;
+    /// Flush GPU command buffer flag.
+    bool flushGPU_;
     /// Force OpenGL 2 use flag.
     bool forceGL2_;
     /// Instancing support flag.
     bool instancingSupport_;
+    /// Vertex array object support flag. OpenGL 3 or WebGL 2 only.
+    bool vertexArraySupport_;
+    /// Indirect draw support flag.
+    bool indirectDrawSupport_;
+    /// Framebuffer discard support flag.
+    bool framebufferDiscardSupport_;
+    /// Occlusion query support flag.
+    bool occlusionQuerySupport_;
+    /// Timer query support flag.
+    bool timerQuerySupport_;
     /// Light prepass support flag.
     bool lightPrepassSupport_;
     /// Deferred rendering support flag.
@@ -526,10 +652,36 @@ private:
     unsigned numPrimitives_;
     /// Number of batches this frame.
     unsigned numBatches_;
+    /// Number of render state changes this frame.
+    unsigned numStateChanges_;
+    /// Number of avoided redundant render state changes this frame.
+    unsigned numAvoidedStateChanges_;
+    /// Number of shader parameter bytes uploaded this frame.
+    unsigned numParameterBytes_;
     /// Largest scratch buffer request this frame.
     unsigned maxScratchBufferRequest_;
     /// GPU objects.
     PODVector<GPUObject*> gpuObjects_;
+    /// Occlusion query objects by handle. Created on first use.
+    PODVector<unsigned> occlusionQueries_;
+    /// Free occlusion query handles.
+    PODVector<unsigned> freeOcclusionQueries_;
+    /// GPU profiling blocks of the frames in flight.
+    Vector<GPUProfileBlock> gpuProfileBlocks_[NUM_GPU_PROFILE_FRAMES];
+    /// Number of GPU profiling blocks begun on each frame in flight.
+    unsigned numGPUProfileBlocks_[NUM_GPU_PROFILE_FRAMES];
+    /// GPU profiling timestamp queries of the frames in flight, two per block. Created on first use.
+    PODVector<unsigned> gpuTimestampQueries_[NUM_GPU_PROFILE_FRAMES];
+    /// Open GPU profiling blocks.
+    PODVector<unsigned> gpuProfileStack_;
+    /// GPU profiling blocks of the latest completed frame.
+    Vector<GPUProfileBlock> gpuProfileResults_;
+    /// Current GPU profiling frame in flight.
+    unsigned gpuProfileFrame_;
+    /// GPU profiling flag.
+    bool gpuProfiling_;
+    /// GPU profiling of the current frame begun flag.
+    bool gpuProfileFrameActive_;
     /// Scratch buffers.
     Vector<ScratchBuffer> scratchBuffers_;
     /// Shadow map dummy color texture format.
@@ -542,6 +694,8 @@ private:
     VertexBuffer* vertexBuffers_[MAX_VERTEX_STREAMS];
     /// Element mask in use.
     unsigned elementMasks_[MAX_VERTEX_STREAMS];
+    /// Vertex buffer data offsets in use.
+    unsigned vertexBufferOffsets_[MAX_VERTEX_STREAMS];
     /// Index buffer in use.
     IndexBuffer* indexBuffer_;
     /// Vertex shader in use.
@@ -562,6 +716,14 @@ private:
     HashMap<unsigned, SharedPtr<ConstantBuffer> > constantBuffers_;
     /// Currently bound constant buffers.
     ConstantBuffer* currentConstantBuffers_[MAX_SHADER_PARAMETER_GROUPS * 2];
+    /// Persistent material constant buffers by material parameter hash and binding index / size.
+    HashMap<Pair<unsigned, unsigned>, SharedPtr<ConstantBuffer> > materialConstantBuffers_;
+    /// Shader program for which material constant buffer use was last checked.
+    ShaderProgram* materialBufferProgram_;
+    /// Material parameter hash for which material constant buffer use was last checked.
+    unsigned materialBufferHash_;
+    /// Result of the last material constant buffer use check.
+    bool materialBufferSupport_;
     /// Dirty constant buffers.
     PODVector<ConstantBuffer*> dirtyConstantBuffers_;
     /// Rendertargets in use.
@@ -630,6 +792,8 @@ private:
     SharedPtr<ShaderPrecache> shaderPrecache_;
     /// Allowed screen orientations.
     String orientations_;
+    /// Shader program binary cache directory.
+    String shaderCacheDir_;
     /// Graphics API name.
     String apiName_;
 
@@ -23,6 +23,8 @@
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
 
+#include <cstring>
+
 #include "../../DebugNew.h"
 
 namespace Urho3D
@@ -34,12 +36,100 @@ GraphicsImpl::GraphicsImpl() :
     systemFBO_(0),
     activeTexture_(0),
     enabledAttributes_(0),
+    boundVertexArray_(0),
     boundFBO_(0),
     boundVBO_(0),
     boundUBO_(0),
+    indirectBuffer_(0),
+    textureUploadBuffer_(0),
+    #ifndef GL_ES_VERSION_2_0
+    textureUploadRing_(0),
+    frameFence_(0),
+    #endif
+    textureUploadOffset_(0),
     pixelFormat_(0),
     fboDirty_(false)
 {
 }
 
+#ifndef GL_ES_VERSION_2_0
+BufferRing::BufferRing() :
+    regionSize_(0),
+    currentRegion_(0)
+{
+    for (unsigned i = 0; i < NUM_BUFFER_REGIONS; ++i)
+        fences_[i] = 0;
+}
+
+void BufferRing::Allocate(unsigned target, unsigned regionSize)
+{
+    ReleaseFences();
+    
+    regionSize_ = regionSize;
+    currentRegion_ = 0;
+    glBufferData(target, regionSize_ * NUM_BUFFER_REGIONS, 0, GL_STREAM_DRAW);
+}
+
+void BufferRing::Advance()
+{
+    // Fence the commands that may still read the current region
+    if (fences_[currentRegion_])
+        glDeleteSync(fences_[currentRegion_]);
+    fences_[currentRegion_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    currentRegion_ = (currentRegion_ + 1) % NUM_BUFFER_REGIONS;
+    WaitFence(currentRegion_);
+}
+
+void BufferRing::Synchronize()
+{
+    if (fences_[currentRegion_])
+        glDeleteSync(fences_[currentRegion_]);
+    fences_[currentRegion_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    WaitFence(currentRegion_);
+}
+
+void BufferRing::ReleaseFences()
+{
+    for (unsigned i = 0; i < NUM_BUFFER_REGIONS; ++i)
+    {
+        if (fences_[i])
+        {
+            glDeleteSync(fences_[i]);
+            fences_[i] = 0;
+        }
+    }
+}
+
+bool BufferRing::Write(unsigned target, unsigned offset, unsigned size, const void* data)
+{
+    if (!size || offset + size > regionSize_)
+        return false;
+    
+    void* dest = glMapBufferRange(target, GetRegionOffset() + offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+        GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!dest)
+        return false;
+    
+    memcpy(dest, data, size);
+    glUnmapBuffer(target);
+    return true;
+}
+
+void BufferRing::WaitFence(unsigned region)
+{
+    GLsync fence = fences_[region];
+    if (!fence)
+        return;
+    
+    // Flush the commands on the first wait so that the fence is guaranteed to signal
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, 0, 1000000);
+    
+    glDeleteSync(fence);
+    fences_[region] = 0;
+}
+#endif
+
 }
@@ -26,7 +26,10 @@
 #include "../../Container/HashMap.h"
 #include "../../Core/Timer.h"
 
-#if defined(ANDROID) || defined (RPI) || defined (EMSCRIPTEN)
+#if defined(EMSCRIPTEN) && defined(URHO3D_WEBGL2)
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#elif defined(ANDROID) || defined (RPI) || defined (EMSCRIPTEN)
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #elif defined(IOS)
@@ -93,6 +96,104 @@ struct FrameBufferObject
     unsigned drawBuffers_;
 };
 
+/// Key of a cached vertex array object: the vertex buffer objects and the vertex elements used from each.
+struct VertexArrayKey
+{
+    /// Construct with no buffers.
+    VertexArrayKey() :
+        instanceOffset_(0)
+    {
+        for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
+        {
+            buffers_[i] = 0;
+            bufferMasks_[i] = 0;
+            elementMasks_[i] = 0;
+        }
+    }
+
+    /// Test for equality with another key.
+    bool operator == (const VertexArrayKey& rhs) const
+    {
+        for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
+        {
+            if (buffers_[i] != rhs.buffers_[i] || bufferMasks_[i] != rhs.bufferMasks_[i] || elementMasks_[i] != rhs.elementMasks_[i])
+                return false;
+        }
+        return instanceOffset_ == rhs.instanceOffset_;
+    }
+
+    /// Return hash value for HashMap.
+    unsigned ToHash() const
+    {
+        unsigned hash = instanceOffset_;
+        for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
+            hash = hash * 31 + (buffers_[i] << 16) + elementMasks_[i];
+        return hash;
+    }
+
+    /// Vertex buffer objects.
+    unsigned buffers_[MAX_VERTEX_STREAMS];
+    /// Full element masks of the buffers, which define their vertex layout.
+    unsigned bufferMasks_[MAX_VERTEX_STREAMS];
+    /// Used element masks.
+    unsigned elementMasks_[MAX_VERTEX_STREAMS];
+    /// Instance offset for the instance matrix pointers.
+    unsigned instanceOffset_;
+};
+
+/// Cached vertex array object.
+struct VertexArrayObject
+{
+    /// Construct.
+    VertexArrayObject() :
+        object_(0),
+        indexBuffer_(0)
+    {
+    }
+
+    /// Vertex array object handle.
+    unsigned object_;
+    /// Bound index buffer object. M_MAX_UNSIGNED if the bound buffer has been deleted.
+    unsigned indexBuffer_;
+};
+
+#ifndef GL_ES_VERSION_2_0
+/// Number of regions in the GPU storage of a dynamic vertex or index buffer.
+static const unsigned NUM_BUFFER_REGIONS = 3;
+
+/// GPU storage of a dynamic vertex or index buffer on OpenGL 3, divided into regions that are written in turn. Each region is mapped unsynchronized and guarded by a fence, so that writing new data does not wait for the GPU to finish drawing with the previous data.
+class URHO3D_API BufferRing
+{
+public:
+    /// Construct.
+    BufferRing();
+    /// Allocate the storage for the buffer object currently bound to a target.
+    void Allocate(unsigned target, unsigned regionSize);
+    /// Move to the next region, waiting until the GPU has finished using it.
+    void Advance();
+    /// Wait until the GPU has finished using the current region.
+    void Synchronize();
+    /// Delete the fences. Must be called before destruction unless the device has been lost.
+    void ReleaseFences();
+    /// Write data to the current region of the buffer object currently bound to a target. Return true if successful.
+    bool Write(unsigned target, unsigned offset, unsigned size, const void* data);
+    
+    /// Return byte offset of the current region.
+    unsigned GetRegionOffset() const { return currentRegion_ * regionSize_; }
+    
+private:
+    /// Wait for and delete the fence of a region.
+    void WaitFence(unsigned region);
+    
+    /// Fences of the regions.
+    GLsync fences_[NUM_BUFFER_REGIONS];
+    /// Region byte size.
+    unsigned regionSize_;
+    /// Current region index.
+    unsigned currentRegion_;
+};
+#endif
+
 /// %Graphics subsystem implementation. Holds API-specific objects.
 class URHO3D_API GraphicsImpl
 {
@@ -113,14 +214,32 @@ private:
     unsigned systemFBO_;
     /// Active texture unit.
     unsigned activeTexture_;
-    /// Vertex attributes in use.
+    /// Vertex attributes in use in the default vertex array object.
     unsigned enabledAttributes_;
+    /// Default vertex array object for vertex buffers that can not use a cached one. GL3 only.
+    VertexArrayObject defaultVertexArray_;
+    /// Cached vertex array objects by vertex buffer configuration. GL3 only.
+    HashMap<VertexArrayKey, VertexArrayObject> vertexArrays_;
+    /// Currently bound vertex array object, or null if none. GL3 only.
+    VertexArrayObject* boundVertexArray_;
     /// Currently bound frame buffer object.
     unsigned boundFBO_;
     /// Currently bound vertex buffer object.
     unsigned boundVBO_;
     /// Currently bound uniform buffer object.
     unsigned boundUBO_;
+    /// Buffer object for indirect draw commands.
+    unsigned indirectBuffer_;
+    /// Pixel buffer object for staging texture uploads. GL3 only.
+    unsigned textureUploadBuffer_;
+    #ifndef GL_ES_VERSION_2_0
+    /// Regions of the texture upload buffer.
+    BufferRing* textureUploadRing_;
+    /// Fence of the previous frame's commands, for limiting the frames queued to the GPU. GL3 only.
+    GLsync frameFence_;
+    #endif
+    /// Write offset in the current region of the texture upload buffer.
+    unsigned textureUploadOffset_;
     /// Current pixel format.
     int pixelFormat_;
     /// Map for FBO's per resolution and format.
@@ -42,6 +42,9 @@ IndexBuffer::IndexBuffer(Context* context) :
     lockStart_(0),
     lockCount_(0),
     lockScratchData_(0),
+    ring_(0),
+    dataOffset_(0),
+    lockDiscard_(false),
     shadowed_(false),
     dynamic_(false)
 {
@@ -82,11 +85,22 @@ void IndexBuffer::Release()
             if (graphics_->GetIndexBuffer() == this)
                 graphics_->SetIndexBuffer(0);
             
+            graphics_->CleanupVertexArrays(object_);
             glDeleteBuffers(1, &object_);
+            #ifndef GL_ES_VERSION_2_0
+            if (ring_)
+                ring_->ReleaseFences();
+            #endif
         }
         
         object_ = 0;
     }
+    
+    #ifndef GL_ES_VERSION_2_0
+    delete ring_;
+    ring_ = 0;
+    #endif
+    dataOffset_ = 0;
 }
 
 void IndexBuffer::SetShadowed(bool enable)
@@ -144,7 +158,16 @@ bool IndexBuffer::SetData(const void* data)
         if (!graphics_->IsDeviceLost())
         {
             graphics_->SetIndexBuffer(this);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount_ * indexSize_, data, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+            if (ring_)
+            {
+                if (!UpdateRing(data, 0, indexCount_, true))
+                {
+                    LOGERROR("Failed to map index buffer");
+                    return false;
+                }
+            }
+            else
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount_ * indexSize_, data, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
         }
         else
         {
@@ -191,10 +214,20 @@ bool IndexBuffer::SetDataRange(const void* data, unsigned start, unsigned count,
         if (!graphics_->IsDeviceLost())
         {
             graphics_->SetIndexBuffer(this);
-            if (!discard || start != 0)
-                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, start * indexSize_, count * indexSize_, data);
-            else
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * indexSize_, data, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+            if (ring_)
+            {
+                if (!UpdateRing(data, start, count, discard))
+                {
+                    LOGERROR("Failed to map index buffer");
+                    return false;
+                }
+                return true;
+            }
+            
+            // Orphan the whole buffer when discarding, so that the driver does not need to wait for the GPU
+            if (discard)
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount_ * indexSize_, 0, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, start * indexSize_, count * indexSize_, data);
         }
         else
         {
@@ -231,6 +264,7 @@ void* IndexBuffer::Lock(unsigned start, unsigned count, bool discard)
     
     lockStart_ = start;
     lockCount_ = count;
+    lockDiscard_ = discard;
     
     if (shadowData_)
     {
@@ -252,12 +286,12 @@ void IndexBuffer::Unlock()
     switch (lockState_)
     {
     case LOCK_SHADOW:
-        SetDataRange(shadowData_.Get() + lockStart_ * indexSize_, lockStart_, lockCount_);
+        SetDataRange(shadowData_.Get() + lockStart_ * indexSize_, lockStart_, lockCount_, lockDiscard_);
         lockState_ = LOCK_NONE;
         break;
         
     case LOCK_SCRATCH:
-        SetDataRange(lockScratchData_, lockStart_, lockCount_);
+        SetDataRange(lockScratchData_, lockStart_, lockCount_, lockDiscard_);
         if (graphics_)
             graphics_->FreeScratchBuffer(lockScratchData_);
         lockScratchData_ = 0;
@@ -332,7 +366,14 @@ bool IndexBuffer::Create()
         }
         
         if (!object_)
+        {
+            #ifndef GL_ES_VERSION_2_0
+            // A ring left over from a lost device has no valid fences to delete
+            delete ring_;
+            ring_ = 0;
+            #endif
             glGenBuffers(1, &object_);
+        }
         if (!object_)
         {
             LOGERROR("Failed to create index buffer");
@@ -340,6 +381,26 @@ bool IndexBuffer::Create()
         }
         
         graphics_->SetIndexBuffer(this);
+        dataOffset_ = 0;
+        
+        #ifndef GL_ES_VERSION_2_0
+        // Dynamic buffers on OpenGL 3 are written unsynchronized in turns to several regions of a larger buffer
+        if (dynamic_ && Graphics::GetGL3Support())
+        {
+            if (!ring_)
+                ring_ = new BufferRing();
+            ring_->Allocate(GL_ELEMENT_ARRAY_BUFFER, indexCount_ * indexSize_);
+            return true;
+        }
+        
+        if (ring_)
+        {
+            ring_->ReleaseFences();
+            delete ring_;
+            ring_ = 0;
+        }
+        #endif
+        
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount_ * indexSize_, 0, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
     }
     
@@ -354,4 +415,34 @@ bool IndexBuffer::UpdateToGPU()
         return false;
 }
 
+bool IndexBuffer::UpdateRing(const void* data, unsigned start, unsigned count, bool discard)
+{
+    #ifndef GL_ES_VERSION_2_0
+    bool success;
+    
+    if (discard)
+    {
+        ring_->Advance();
+        success = ring_->Write(GL_ELEMENT_ARRAY_BUFFER, start * indexSize_, count * indexSize_, data);
+    }
+    else if (shadowData_)
+    {
+        // Data outside the range must be preserved, so copy it from the shadow data to the next region
+        ring_->Advance();
+        success = ring_->Write(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount_ * indexSize_, shadowData_.Get());
+    }
+    else
+    {
+        // Without shadow data the current region must be updated in place after the GPU has finished with it
+        ring_->Synchronize();
+        success = ring_->Write(GL_ELEMENT_ARRAY_BUFFER, start * indexSize_, count * indexSize_, data);
+    }
+    
+    dataOffset_ = ring_->GetRegionOffset();
+    return success;
+    #else
+    return false;
+    #endif
+}
+
 }
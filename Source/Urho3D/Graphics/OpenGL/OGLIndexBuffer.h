@@ -30,6 +30,8 @@
 namespace Urho3D
 {
 
+class BufferRing;
+
 /// Hardware index buffer.
 class URHO3D_API IndexBuffer : public Object, public GPUObject
 {
@@ -75,12 +77,16 @@ public:
     unsigned char* GetShadowData() const { return shadowData_.Get(); }
     /// Return shared array pointer to the CPU memory shadow data.
     SharedArrayPtr<unsigned char> GetShadowDataShared() const { return shadowData_; }
+    /// Return byte offset of the current data within the GPU buffer. Nonzero only for dynamic buffers on OpenGL 3.
+    unsigned GetDataOffset() const { return dataOffset_; }
     
 private:
     /// Create buffer.
     bool Create();
     /// Update the shadow data to the GPU buffer.
     bool UpdateToGPU();
+    /// Write a data range to the next region of the GPU buffer ring. Return true if successful.
+    bool UpdateRing(const void* data, unsigned start, unsigned count, bool discard);
     
     /// Shadow data.
     SharedArrayPtr<unsigned char> shadowData_;
@@ -96,6 +102,12 @@ private:
     unsigned lockCount_;
     /// Scratch buffer for fallback locking.
     void* lockScratchData_;
+    /// GPU buffer ring for dynamic data on OpenGL 3.
+    BufferRing* ring_;
+    /// Byte offset of the current data within the GPU buffer.
+    unsigned dataOffset_;
+    /// Lock discard flag.
+    bool lockDiscard_;
     /// Shadowed flag.
     bool shadowed_;
     /// Dynamic flag.
@@ -29,9 +29,25 @@
 
 #include "../../DebugNew.h"
 
+#if defined(ANDROID) || defined(RPI)
+#define GL_NUM_PROGRAM_BINARY_FORMATS GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#define GL_PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH_OES
+#define URHO3D_PROGRAM_BINARY
+#elif !defined(GL_ES_VERSION_2_0)
+#define URHO3D_PROGRAM_BINARY
+#endif
+
 namespace Urho3D
 {
 
+#if defined(ANDROID) || defined(RPI)
+static PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryFunc = 0;
+static PFNGLPROGRAMBINARYOESPROC glProgramBinaryFunc = 0;
+#elif !defined(GL_ES_VERSION_2_0)
+#define glGetProgramBinaryFunc glGetProgramBinary
+#define glProgramBinaryFunc glProgramBinary
+#endif
+
 const char* shaderParameterGroups[] = {
     "frame",
     "camera",
@@ -42,8 +58,37 @@ const char* shaderParameterGroups[] = {
     "custom"
 };
 
+static unsigned GetUniformSize(unsigned type)
+{
+    switch (type)
+    {
+    case GL_FLOAT:
+        return sizeof(float);
+        
+    case GL_FLOAT_VEC2:
+        return 2 * sizeof(float);
+        
+    case GL_FLOAT_VEC3:
+        return 3 * sizeof(float);
+        
+    case GL_FLOAT_VEC4:
+        return 4 * sizeof(float);
+        
+    case GL_FLOAT_MAT3:
+        return 9 * sizeof(float);
+        
+    case GL_FLOAT_MAT4:
+        return 16 * sizeof(float);
+        
+    default:
+        // Other types are not set through Graphics and are not cached
+        return 0;
+    }
+}
+
 unsigned ShaderProgram::globalFrameNumber = 0;
 const void* ShaderProgram::globalParameterSources[MAX_SHADER_PARAMETER_GROUPS];
+bool ShaderProgram::binarySupport = false;
 
 ShaderProgram::ShaderProgram(Graphics* graphics, ShaderVariation* vertexShader, ShaderVariation* pixelShader) :
     GPUObject(graphics),
@@ -90,6 +135,7 @@ void ShaderProgram::Release()
         object_ = 0;
         linkerOutput_.Clear();
         shaderParameters_.Clear();
+        parameterValues_.Clear();
         
         for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
             useTextureUnit_[i] = false;
@@ -125,12 +171,18 @@ bool ShaderProgram::Link()
     glBindAttribLocation(object_, 7, "iBlendIndices");
     glBindAttribLocation(object_, 8, "iCubeTexCoord");
     glBindAttribLocation(object_, 9, "iCubeTexCoord2");
-    #ifndef GL_ES_VERSION_2_0
+    #if !defined(GL_ES_VERSION_2_0) || defined(GL_ES_VERSION_3_0)
     glBindAttribLocation(object_, 10, "iInstanceMatrix1");
     glBindAttribLocation(object_, 11, "iInstanceMatrix2");
     glBindAttribLocation(object_, 12, "iInstanceMatrix3");
     #endif
     
+    #ifndef GL_ES_VERSION_2_0
+    // Desktop drivers only keep the program binary retrievable when requested before linking
+    if (binarySupport && !graphics_->GetShaderCacheDir().Empty())
+        glProgramParameteri(object_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    #endif
+    
     glAttachShader(object_, vertexShader_->GetGPUObject());
     glAttachShader(object_, pixelShader_->GetGPUObject());
     glLinkProgram(object_);
@@ -152,6 +204,76 @@ bool ShaderProgram::Link()
     if (!object_)
         return false;
     
+    ParseParameters();
+    return true;
+}
+
+bool ShaderProgram::LoadBinary(unsigned format, const PODVector<unsigned char>& data)
+{
+    Release();
+    
+    if (!binarySupport || !vertexShader_ || !pixelShader_ || data.Empty())
+        return false;
+    
+    #ifdef URHO3D_PROGRAM_BINARY
+    object_ = glCreateProgram();
+    if (!object_)
+    {
+        linkerOutput_ = "Could not create shader program";
+        return false;
+    }
+    
+    glProgramBinaryFunc(object_, format, &data[0], data.Size());
+    
+    // The driver may reject a binary it has produced earlier, for example after a driver update
+    int linked;
+    glGetProgramiv(object_, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(object_);
+        object_ = 0;
+        return false;
+    }
+    
+    linkerOutput_.Clear();
+    ParseParameters();
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+bool ShaderProgram::GetBinary(unsigned& format, PODVector<unsigned char>& data) const
+{
+    if (!binarySupport || !object_)
+        return false;
+    
+    #ifdef URHO3D_PROGRAM_BINARY
+    int length = 0;
+    glGetProgramiv(object_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    
+    data.Resize(length);
+    int outLength = 0;
+    GLenum binaryFormat = 0;
+    glGetProgramBinaryFunc(object_, length, &outLength, &binaryFormat, &data[0]);
+    if (outLength <= 0)
+    {
+        data.Clear();
+        return false;
+    }
+    
+    data.Resize(outLength);
+    format = binaryFormat;
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+void ShaderProgram::ParseParameters()
+{
     const int MAX_PARAMETER_NAME_LENGTH = 256;
     char uniformName[MAX_PARAMETER_NAME_LENGTH];
     int uniformCount;
@@ -159,6 +281,8 @@ bool ShaderProgram::Link()
     glUseProgram(object_);
     glGetProgramiv(object_, GL_ACTIVE_UNIFORMS, &uniformCount);
     
+    unsigned valueCacheSize = 0;
+    
     // Check for constant buffers
     #ifndef GL_ES_VERSION_2_0
     HashMap<unsigned, unsigned> blockToBinding;
@@ -272,6 +396,14 @@ bool ShaderProgram::Link()
             }
             #endif
 
+            // Reserve space for remembering the last uploaded value of an individual uniform
+            if (newParam.location_ >= 0 && !newParam.bufferPtr_)
+            {
+                newParam.valueOffset_ = valueCacheSize;
+                newParam.valueSize_ = GetUniformSize(type) * count;
+                valueCacheSize += newParam.valueSize_;
+            }
+
             if (newParam.location_ >= 0)
                 shaderParameters_[StringHash(paramName)] = newParam;
         }
@@ -303,7 +435,10 @@ bool ShaderProgram::Link()
     // Rehash the parameter map to ensure minimal load factor
     shaderParameters_.Rehash(NextPowerOfTwo(shaderParameters_.Size()));
     
-    return true;
+    // Uniforms of a newly linked program are initialized to zero
+    parameterValues_.Resize(valueCacheSize);
+    if (valueCacheSize)
+        memset(&parameterValues_[0], 0, valueCacheSize);
 }
 
 ShaderVariation* ShaderProgram::GetVertexShader() const
@@ -330,6 +465,23 @@ const ShaderParameter* ShaderProgram::GetParameter(StringHash param) const
         return 0;
 }
 
+bool ShaderProgram::SetParameterValue(const ShaderParameter& param, const void* data, unsigned size)
+{
+    // Types that are not cached are always uploaded
+    if (!param.valueSize_)
+        return true;
+    
+    if (size > param.valueSize_)
+        size = param.valueSize_;
+    
+    unsigned char* dest = &parameterValues_[param.valueOffset_];
+    if (!memcmp(dest, data, size))
+        return false;
+    
+    memcpy(dest, data, size);
+    return true;
+}
+
 bool ShaderProgram::NeedParameterUpdate(ShaderParameterGroup group, const void* source)
 {
     // If global framenumber has changed, invalidate all per-program parameter sources now
@@ -403,4 +555,29 @@ void ShaderProgram::ClearGlobalParameterSource(ShaderParameterGroup group)
     globalParameterSources[group] = (const void*)M_MAX_UNSIGNED;
 }
 
+void ShaderProgram::CheckBinarySupport()
+{
+    binarySupport = false;
+    
+    #ifdef URHO3D_PROGRAM_BINARY
+    #ifndef GL_ES_VERSION_2_0
+    // Program binaries are core in OpenGL 4.1. As with other extensions, GLEW may fail to report them in a GL3 context
+    if ((!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) || !glGetProgramBinary || !glProgramBinary)
+        return;
+    #else
+    if (!SDL_GL_ExtensionSupported("GL_OES_get_program_binary"))
+        return;
+    glGetProgramBinaryFunc = (PFNGLGETPROGRAMBINARYOESPROC)SDL_GL_GetProcAddress("glGetProgramBinaryOES");
+    glProgramBinaryFunc = (PFNGLPROGRAMBINARYOESPROC)SDL_GL_GetProcAddress("glProgramBinaryOES");
+    if (!glGetProgramBinaryFunc || !glProgramBinaryFunc)
+        return;
+    #endif
+    
+    // Some drivers expose the extension without supporting any binary formats
+    int numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    binarySupport = numFormats > 0;
+    #endif
+}
+
 }
@@ -39,7 +39,9 @@ struct ShaderParameter
 {
     /// Construct with defaults.
     ShaderParameter() :
-        bufferPtr_(0)
+        bufferPtr_(0),
+        valueOffset_(0),
+        valueSize_(0)
     {
     }
 
@@ -49,6 +51,10 @@ struct ShaderParameter
     unsigned type_;
     /// Constant buffer pointer.
     ConstantBuffer* bufferPtr_;
+    /// Byte offset of the last uploaded value in the program's value cache.
+    unsigned valueOffset_;
+    /// Byte size of the value in the value cache, or zero if not cached.
+    unsigned valueSize_;
 };
 
 /// Linked shader program on the GPU.
@@ -67,6 +73,10 @@ public:
     
     /// Link the shaders and examine the uniforms and samplers used. Return true if successful.
     bool Link();
+    /// Create from a linked program binary in the driver's format and examine the uniforms and samplers used. The shaders do not need to be compiled. Return true if successful.
+    bool LoadBinary(unsigned format, const PODVector<unsigned char>& data);
+    /// Retrieve the linked program binary in the driver's format. Return true if successful.
+    bool GetBinary(unsigned& format, PODVector<unsigned char>& data) const;
     
     /// Return the vertex shader.
     ShaderVariation* GetVertexShader() const;
@@ -87,13 +97,22 @@ public:
     bool NeedParameterUpdate(ShaderParameterGroup group, const void* source);
     /// Clear a parameter source. Affects only the current shader program if appropriate.
     void ClearParameterSource(ShaderParameterGroup group);
+    /// Compare an individual uniform value against the last uploaded value and remember it. Return true if it changed and needs to be uploaded.
+    bool SetParameterValue(const ShaderParameter& param, const void* data, unsigned size);
 
     /// Clear all parameter sources from all shader programs by incrementing the global parameter source framenumber.
     static void ClearParameterSources();
     /// Clear a global parameter source when constant buffers change.
     static void ClearGlobalParameterSource(ShaderParameterGroup group);
+    /// Check whether the driver supports retrieving and loading program binaries. Called by Graphics after context creation.
+    static void CheckBinarySupport();
+    /// Return whether program binaries are supported.
+    static bool GetBinarySupport() { return binarySupport; }
 
 private:
+    /// Examine the uniforms and samplers of the linked program.
+    void ParseParameters();
+
     /// Vertex shader.
     WeakPtr<ShaderVariation> vertexShader_;
     /// Pixel shader.
@@ -106,6 +125,8 @@ private:
     SharedPtr<ConstantBuffer> constantBuffers_[MAX_SHADER_PARAMETER_GROUPS * 2];
     /// Remembered shader parameter sources for individual uniform mode.
     const void* parameterSources_[MAX_SHADER_PARAMETER_GROUPS];
+    /// Last uploaded values of individual uniforms.
+    PODVector<unsigned char> parameterValues_;
     /// Shader link error string.
     String linkerOutput_;
     /// Shader parameter source framenumber.
@@ -115,6 +136,8 @@ private:
     static unsigned globalFrameNumber;
     /// Remembered global shader parameter sources for constant buffer mode.
     static const void* globalParameterSources[MAX_SHADER_PARAMETER_GROUPS];
+    /// Program binary support flag.
+    static bool binarySupport;
 };
 
 }
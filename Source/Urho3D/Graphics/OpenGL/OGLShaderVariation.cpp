@@ -77,13 +77,23 @@ void ShaderVariation::Release()
         object_ = 0;
         graphics_->CleanupShaderPrograms(this);
     }
+    else if (graphics_ && !graphics_->IsDeviceLost())
+    {
+        // Programs loaded from the program binary cache may use the variation without it being compiled
+        if (graphics_->GetVertexShader() == this || graphics_->GetPixelShader() == this)
+            graphics_->SetShaders(0, 0);
+        graphics_->CleanupShaderPrograms(this);
+    }
     
     compilerOutput_.Clear();
 }
 
 bool ShaderVariation::Create()
 {
-    Release();
+    // Do not release uncompiled variations, as that would drop the programs loaded for them from the program binary cache
+    if (object_)
+        Release();
+    compilerOutput_.Clear();
 
     if (!owner_)
     {
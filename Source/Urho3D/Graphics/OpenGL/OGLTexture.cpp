@@ -99,6 +99,7 @@ Texture::Texture(Context* context) :
     shadowCompare_(false),
     parametersDirty_(true),
     filterMode_(FILTER_DEFAULT),
+    streamingMipsToSkip_(0),
     sRGB_(false)
 {
     for (int i = 0; i < MAX_COORDS; ++i)
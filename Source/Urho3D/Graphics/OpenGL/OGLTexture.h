@@ -60,6 +60,8 @@ public:
     void SetBackupTexture(Texture* texture);
     /// Set mip levels to skip on a quality setting when loading. Ensures higher quality levels do not skip more.
     void SetMipsToSkip(int quality, int mips);
+    /// Set additional mip levels to skip when loading from a compressed image, on top of the texture quality setting. Used by texture streaming.
+    void SetStreamingMipsToSkip(unsigned mips) { streamingMipsToSkip_ = mips; }
     /// Dirty the parameters.
     void SetParametersDirty();
     /// Update changed parameters to OpenGL. Called by Graphics when binding the texture.
@@ -95,6 +97,8 @@ public:
     Texture* GetBackupTexture() const { return backupTexture_; }
     /// Return mip levels to skip on a quality setting when loading.
     int GetMipsToSkip(int quality) const;
+    /// Return additional mip levels to skip when loading from an image.
+    unsigned GetStreamingMipsToSkip() const { return streamingMipsToSkip_; }
     /// Return mip level width, or 0 if level does not exist.
     int GetLevelWidth(unsigned level) const;
     /// Return mip level width, or 0 if level does not exist.
@@ -155,6 +159,8 @@ protected:
     TextureAddressMode addressMode_[MAX_COORDS];
     /// Mip levels to skip when loading per texture quality setting.
     unsigned mipsToSkip_[MAX_TEXTURE_QUALITY_LEVELS];
+    /// Additional mip levels to skip when loading, set by texture streaming.
+    unsigned streamingMipsToSkip_;
     /// Border color.
     Color borderColor_;
     /// sRGB sampling and writing mode flag.
@@ -31,6 +31,7 @@
 #include "../../Graphics/Renderer.h"
 #include "../../Resource/ResourceCache.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../Graphics/TextureStreamer.h"
 #include "../../Resource/XMLFile.h"
 
 #include "../../DebugNew.h"
@@ -76,14 +77,28 @@ bool Texture2D::BeginLoad(Deserializer& source)
         return false;
     }
 
-    // Precalculate mip levels if async loading
-    if (GetAsyncLoadState() == ASYNC_LOADING)
-        loadImage_->PrecalculateLevels();
-    
     // Load the optional parameters file
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     String xmlName = ReplaceExtension(GetName(), ".xml");
     loadParameters_ = cache->GetTempResource<XMLFile>(xmlName, false);
+
+    // Compress to DXT if requested by the parameters file. When loading asynchronously this happens in the worker thread
+    if (loadParameters_ && loadParameters_->GetRoot().GetChild("compress").GetBool("enable") && !loadImage_->IsCompressed() &&
+        graphics_->GetFormat(CF_DXT5))
+    {
+        if ((loadImage_->GetWidth() & 3) || (loadImage_->GetHeight() & 3))
+            LOGWARNING("Texture " + GetName() + " size is not a multiple of 4, can not compress");
+        else
+        {
+            SharedPtr<Image> compressedImage = loadImage_->ConvertToDXT();
+            if (compressedImage)
+                loadImage_ = compressedImage;
+        }
+    }
+
+    // Precalculate mip levels if async loading
+    if (GetAsyncLoadState() == ASYNC_LOADING)
+        loadImage_->PrecalculateLevels();
     
     return true;
 }
@@ -98,6 +113,13 @@ bool Texture2D::EndLoad()
     CheckTextureBudget(GetTypeStatic());
 
     SetParameters(loadParameters_);
+    
+    // Let the texture streamer choose the initially loaded mip level
+    Renderer* renderer = GetSubsystem<Renderer>();
+    TextureStreamer* streamer = renderer ? renderer->GetTextureStreamer() : 0;
+    if (streamer)
+        streamer->AddTexture(this, loadImage_);
+    
     bool success = SetData(loadImage_);
     
     loadImage_.Reset();
@@ -241,21 +263,25 @@ bool Texture2D::SetData(unsigned level, int x, int y, int width, int height, con
     bool wholeLevel = x == 0 && y == 0 && width == levelWidth && height == levelHeight;
     unsigned format = GetSRGB() ? GetSRGBFormat(format_) : format_;
     
+    // Stage the data in a pixel buffer object if possible, so that the call does not wait for the driver to copy it
+    const void* source = graphics_->BeginTextureUpload(data, GetDataSize(width, height));
+    
     if (!IsCompressed())
     {
         if (wholeLevel)
-            glTexImage2D(target_, level, format, width, height, 0, GetExternalFormat(format_), GetDataType(format_), data);
+            glTexImage2D(target_, level, format, width, height, 0, GetExternalFormat(format_), GetDataType(format_), source);
         else
-            glTexSubImage2D(target_, level, x, y, width, height, GetExternalFormat(format_), GetDataType(format_), data);
+            glTexSubImage2D(target_, level, x, y, width, height, GetExternalFormat(format_), GetDataType(format_), source);
     }
     else
     {
         if (wholeLevel)
-            glCompressedTexImage2D(target_, level, format, width, height, 0, GetDataSize(width, height), data);
+            glCompressedTexImage2D(target_, level, format, width, height, 0, GetDataSize(width, height), source);
         else
-            glCompressedTexSubImage2D(target_, level, x, y, width, height, format, GetDataSize(width, height), data);
+            glCompressedTexSubImage2D(target_, level, x, y, width, height, format, GetDataSize(width, height), source);
     }
     
+    graphics_->EndTextureUpload();
     graphics_->SetTexture(0, 0);
     return true;
 }
@@ -355,7 +381,7 @@ bool Texture2D::SetData(SharedPtr<Image> image, bool useAlpha)
             needDecompress = true;
         }
         
-        unsigned mipsToSkip = mipsToSkip_[quality];
+        unsigned mipsToSkip = mipsToSkip_[quality] + streamingMipsToSkip_;
         if (mipsToSkip >= levels)
             mipsToSkip = levels - 1;
         while (mipsToSkip && (width / (1 << mipsToSkip) < 4 || height / (1 << mipsToSkip) < 4))
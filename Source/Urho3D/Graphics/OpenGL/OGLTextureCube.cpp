@@ -391,25 +391,29 @@ bool TextureCube::SetData(CubeMapFace face, unsigned level, int x, int y, int wi
     bool wholeLevel = x == 0 && y == 0 && width == levelWidth && height == levelHeight;
     unsigned format = GetSRGB() ? GetSRGBFormat(format_) : format_;
     
+    // Stage the data in a pixel buffer object if possible, so that the call does not wait for the driver to copy it
+    const void* source = graphics_->BeginTextureUpload(data, GetDataSize(width, height));
+    
     if (!IsCompressed())
     {
         if (wholeLevel)
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, format, width, height, 0, GetExternalFormat(format_),
-                GetDataType(format_), data);
+                GetDataType(format_), source);
         else
             glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, x, y, width, height, GetExternalFormat(format_),
-                GetDataType(format_), data);
+                GetDataType(format_), source);
     }
     else
     {
         if (wholeLevel)
             glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, format, width, height, 0,
-                GetDataSize(width, height), data);
+                GetDataSize(width, height), source);
         else
             glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, x, y, width, height, format,
-                GetDataSize(width, height), data);
+                GetDataSize(width, height), source);
     }
     
+    graphics_->EndTextureUpload();
     graphics_->SetTexture(0, 0);
     return true;
 }
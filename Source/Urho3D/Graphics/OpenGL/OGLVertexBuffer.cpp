@@ -29,6 +29,10 @@
 
 #include "../../DebugNew.h"
 
+#ifdef GL_ES_VERSION_2_0
+#define GL_HALF_FLOAT GL_HALF_FLOAT_OES
+#endif
+
 namespace Urho3D
 {
 
@@ -100,6 +104,74 @@ const unsigned VertexBuffer::elementNormalize[] =
     GL_FALSE // Instancematrix3
 };
 
+const unsigned VertexBuffer::packedElementSize[] =
+{
+    3 * sizeof(float), // Position
+    4 * sizeof(short), // Normal
+    4 * sizeof(unsigned char), // Color
+    2 * sizeof(short), // Texcoord1
+    2 * sizeof(short), // Texcoord2
+    3 * sizeof(float), // Cubetexcoord1
+    3 * sizeof(float), // Cubetexcoord2
+    4 * sizeof(short), // Tangent
+    4 * sizeof(unsigned char), // Blendweights
+    4 * sizeof(unsigned char), // Blendindices
+    4 * sizeof(float), // Instancematrix1
+    4 * sizeof(float), // Instancematrix2
+    4 * sizeof(float) // Instancematrix3
+};
+
+const unsigned VertexBuffer::packedElementType[] =
+{
+    GL_FLOAT, // Position
+    GL_SHORT, // Normal
+    GL_UNSIGNED_BYTE, // Color
+    GL_HALF_FLOAT, // Texcoord1
+    GL_HALF_FLOAT, // Texcoord2
+    GL_FLOAT, // Cubetexcoord1
+    GL_FLOAT, // Cubetexcoord2
+    GL_SHORT, // Tangent
+    GL_UNSIGNED_BYTE, // Blendweights
+    GL_UNSIGNED_BYTE, // Blendindices
+    GL_FLOAT, // Instancematrix1
+    GL_FLOAT, // Instancematrix2
+    GL_FLOAT // Instancematrix3
+};
+
+const unsigned VertexBuffer::packedElementComponents[] =
+{
+    3, // Position
+    4, // Normal
+    4, // Color
+    2, // Texcoord1
+    2, // Texcoord2
+    3, // Cubetexcoord1
+    3, // Cubetexcoord2
+    4, // Tangent
+    4, // Blendweights
+    4, // Blendindices
+    4, // Instancematrix1
+    4, // Instancematrix2
+    4 // Instancematrix3
+};
+
+const unsigned VertexBuffer::packedElementNormalize[] =
+{
+    GL_FALSE, // Position
+    GL_TRUE, // Normal
+    GL_TRUE, // Color
+    GL_FALSE, // Texcoord1
+    GL_FALSE, // Texcoord2
+    GL_FALSE, // Cubetexcoord1
+    GL_FALSE, // Cubetexcoord2
+    GL_TRUE, // Tangent
+    GL_TRUE, // Blendweights
+    GL_FALSE, // Blendindices
+    GL_FALSE, // Instancematrix1
+    GL_FALSE, // Instancematrix2
+    GL_FALSE // Instancematrix3
+};
+
 VertexBuffer::VertexBuffer(Context* context) :
     Object(context),
     GPUObject(GetSubsystem<Graphics>()),
@@ -109,6 +181,9 @@ VertexBuffer::VertexBuffer(Context* context) :
     lockStart_(0),
     lockCount_(0),
     lockScratchData_(0),
+    ring_(0),
+    dataOffset_(0),
+    lockDiscard_(false),
     shadowed_(false),
     dynamic_(false)
 {
@@ -155,11 +230,22 @@ void VertexBuffer::Release()
             }
             
             graphics_->SetVBO(0);
+            graphics_->CleanupVertexArrays(object_);
             glDeleteBuffers(1, &object_);
+            #ifndef GL_ES_VERSION_2_0
+            if (ring_)
+                ring_->ReleaseFences();
+            #endif
         }
         
         object_ = 0;
     }
+    
+    #ifndef GL_ES_VERSION_2_0
+    delete ring_;
+    ring_ = 0;
+    #endif
+    dataOffset_ = 0;
 }
 
 void VertexBuffer::SetShadowed(bool enable)
@@ -219,7 +305,16 @@ bool VertexBuffer::SetData(const void* data)
         if (!graphics_->IsDeviceLost())
         {
             graphics_->SetVBO(object_);
-            glBufferData(GL_ARRAY_BUFFER, vertexCount_ * vertexSize_, data, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+            if (ring_)
+            {
+                if (!UpdateRing(data, 0, vertexCount_, true))
+                {
+                    LOGERROR("Failed to map vertex buffer");
+                    return false;
+                }
+            }
+            else
+                glBufferData(GL_ARRAY_BUFFER, vertexCount_ * vertexSize_, data, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
         }
         else
         {
@@ -266,10 +361,20 @@ bool VertexBuffer::SetDataRange(const void* data, unsigned start, unsigned count
         if (!graphics_->IsDeviceLost())
         {
             graphics_->SetVBO(object_);
-            if (!discard || start != 0)
-                glBufferSubData(GL_ARRAY_BUFFER, start * vertexSize_, count * vertexSize_, data);
-            else
-                glBufferData(GL_ARRAY_BUFFER, count * vertexSize_, data, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+            if (ring_)
+            {
+                if (!UpdateRing(data, start, count, discard))
+                {
+                    LOGERROR("Failed to map vertex buffer");
+                    return false;
+                }
+                return true;
+            }
+            
+            // Orphan the whole buffer when discarding, so that the driver does not need to wait for the GPU
+            if (discard)
+                glBufferData(GL_ARRAY_BUFFER, vertexCount_ * vertexSize_, 0, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, start * vertexSize_, count * vertexSize_, data);
         }
         else
         {
@@ -306,6 +411,7 @@ void* VertexBuffer::Lock(unsigned start, unsigned count, bool discard)
     
     lockStart_ = start;
     lockCount_ = count;
+    lockDiscard_ = discard;
     
     if (shadowData_)
     {
@@ -327,12 +433,12 @@ void VertexBuffer::Unlock()
     switch (lockState_)
     {
     case LOCK_SHADOW:
-        SetDataRange(shadowData_.Get() + lockStart_ * vertexSize_, lockStart_, lockCount_);
+        SetDataRange(shadowData_.Get() + lockStart_ * vertexSize_, lockStart_, lockCount_, lockDiscard_);
         lockState_ = LOCK_NONE;
         break;
         
     case LOCK_SCRATCH:
-        SetDataRange(lockScratchData_, lockStart_, lockCount_);
+        SetDataRange(lockScratchData_, lockStart_, lockCount_, lockDiscard_);
         if (graphics_)
             graphics_->FreeScratchBuffer(lockScratchData_);
         lockScratchData_ = 0;
@@ -352,7 +458,7 @@ void VertexBuffer::UpdateOffsets()
         if (elementMask_ & (1 << i))
         {
             elementOffset_[i] = elementOffset;
-            elementOffset += elementSize[i];
+            elementOffset += GetElementSize(elementMask_, (VertexElement)i);
         }
         else
             elementOffset_[i] = NO_ELEMENT;
@@ -367,7 +473,7 @@ unsigned VertexBuffer::GetVertexSize(unsigned elementMask)
     for (unsigned i = 0; i < MAX_VERTEX_ELEMENTS; ++i)
     {
         if (elementMask & (1 << i))
-            vertexSize += elementSize[i];
+            vertexSize += GetElementSize(elementMask, (VertexElement)i);
     }
     
     return vertexSize;
@@ -380,12 +486,37 @@ unsigned VertexBuffer::GetElementOffset(unsigned elementMask, VertexElement elem
     for (unsigned i = 0; i != element; ++i)
     {
         if (elementMask & (1 << i))
-            offset += elementSize[i];
+            offset += GetElementSize(elementMask, (VertexElement)i);
     }
     
     return offset;
 }
 
+unsigned VertexBuffer::GetElementSize(unsigned elementMask, VertexElement element)
+{
+    return IsElementPacked(elementMask, element) ? packedElementSize[element] : elementSize[element];
+}
+
+bool VertexBuffer::IsElementPacked(unsigned elementMask, VertexElement element)
+{
+    switch (element)
+    {
+    case ELEMENT_NORMAL:
+    case ELEMENT_TANGENT:
+        return (elementMask & MASK_PACKEDNORMALS) != 0;
+        
+    case ELEMENT_TEXCOORD1:
+    case ELEMENT_TEXCOORD2:
+        return (elementMask & MASK_PACKEDTEXCOORDS) != 0;
+        
+    case ELEMENT_BLENDWEIGHTS:
+        return (elementMask & MASK_PACKEDBLENDWEIGHTS) != 0;
+        
+    default:
+        return false;
+    }
+}
+
 bool VertexBuffer::Create()
 {
     if (!vertexCount_ || !elementMask_)
@@ -403,7 +534,14 @@ bool VertexBuffer::Create()
         }
         
         if (!object_)
+        {
+            #ifndef GL_ES_VERSION_2_0
+            // A ring left over from a lost device has no valid fences to delete
+            delete ring_;
+            ring_ = 0;
+            #endif
             glGenBuffers(1, &object_);
+        }
         if (!object_)
         {
             LOGERROR("Failed to create vertex buffer");
@@ -411,6 +549,26 @@ bool VertexBuffer::Create()
         }
         
         graphics_->SetVBO(object_);
+        dataOffset_ = 0;
+        
+        #ifndef GL_ES_VERSION_2_0
+        // Dynamic buffers on OpenGL 3 are written unsynchronized in turns to several regions of a larger buffer
+        if (dynamic_ && Graphics::GetGL3Support())
+        {
+            if (!ring_)
+                ring_ = new BufferRing();
+            ring_->Allocate(GL_ARRAY_BUFFER, vertexCount_ * vertexSize_);
+            return true;
+        }
+        
+        if (ring_)
+        {
+            ring_->ReleaseFences();
+            delete ring_;
+            ring_ = 0;
+        }
+        #endif
+        
         glBufferData(GL_ARRAY_BUFFER, vertexCount_ * vertexSize_, 0, dynamic_ ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
     }
     
@@ -425,4 +583,34 @@ bool VertexBuffer::UpdateToGPU()
         return false;
 }
 
+bool VertexBuffer::UpdateRing(const void* data, unsigned start, unsigned count, bool discard)
+{
+    #ifndef GL_ES_VERSION_2_0
+    bool success;
+    
+    if (discard)
+    {
+        ring_->Advance();
+        success = ring_->Write(GL_ARRAY_BUFFER, start * vertexSize_, count * vertexSize_, data);
+    }
+    else if (shadowData_)
+    {
+        // Data outside the range must be preserved, so copy it from the shadow data to the next region
+        ring_->Advance();
+        success = ring_->Write(GL_ARRAY_BUFFER, 0, vertexCount_ * vertexSize_, shadowData_.Get());
+    }
+    else
+    {
+        // Without shadow data the current region must be updated in place after the GPU has finished with it
+        ring_->Synchronize();
+        success = ring_->Write(GL_ARRAY_BUFFER, start * vertexSize_, count * vertexSize_, data);
+    }
+    
+    dataOffset_ = ring_->GetRegionOffset();
+    return success;
+    #else
+    return false;
+    #endif
+}
+
 }
@@ -29,6 +29,8 @@
 namespace Urho3D
 {
 
+class BufferRing;
+
 /// Hardware vertex buffer.
 class URHO3D_API VertexBuffer : public Object, public GPUObject
 {
@@ -76,11 +78,17 @@ public:
     unsigned char* GetShadowData() const { return shadowData_.Get(); }
     /// Return shared array pointer to the CPU memory shadow data.
     SharedArrayPtr<unsigned char> GetShadowDataShared() const { return shadowData_; }
+    /// Return byte offset of the current data within the GPU buffer. Nonzero only for dynamic buffers on OpenGL 3.
+    unsigned GetDataOffset() const { return dataOffset_; }
     
     /// Return vertex size corresponding to a vertex element mask.
     static unsigned GetVertexSize(unsigned elementMask);
     /// Return element offset from an element mask.
     static unsigned GetElementOffset(unsigned elementMask, VertexElement element);
+    /// Return element size in bytes from an element mask, taking packed formats into account.
+    static unsigned GetElementSize(unsigned elementMask, VertexElement element);
+    /// Return whether an element is stored in a packed format according to an element mask.
+    static bool IsElementPacked(unsigned elementMask, VertexElement element);
     
     /// Vertex element sizes in bytes.
     static const unsigned elementSize[];
@@ -90,6 +98,14 @@ public:
     static const unsigned elementComponents[];
     /// Vertex element OpenGL normalization.
     static const unsigned elementNormalize[];
+    /// Packed vertex element sizes in bytes.
+    static const unsigned packedElementSize[];
+    /// Packed vertex element OpenGL types.
+    static const unsigned packedElementType[];
+    /// Packed vertex element OpenGL component counts.
+    static const unsigned packedElementComponents[];
+    /// Packed vertex element OpenGL normalization.
+    static const unsigned packedElementNormalize[];
 
 private:
     /// Update offsets of vertex elements.
@@ -98,6 +114,8 @@ private:
     bool Create();
     /// Update the shadow data to the GPU buffer.
     bool UpdateToGPU();
+    /// Write a data range to the next region of the GPU buffer ring. Return true if successful.
+    bool UpdateRing(const void* data, unsigned start, unsigned count, bool discard);
     
     /// Shadow data.
     SharedArrayPtr<unsigned char> shadowData_;
@@ -117,6 +135,12 @@ private:
     unsigned lockCount_;
     /// Scratch buffer for fallback locking.
     void* lockScratchData_;
+    /// GPU buffer ring for dynamic data on OpenGL 3.
+    BufferRing* ring_;
+    /// Byte offset of the current data within the GPU buffer.
+    unsigned dataOffset_;
+    /// Lock discard flag.
+    bool lockDiscard_;
     /// Shadowed flag.
     bool shadowed_;
     /// Dynamic flag.
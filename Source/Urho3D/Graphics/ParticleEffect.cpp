@@ -477,6 +477,12 @@ bool ParticleEffect::Save(Serializer& dest) const
     return xml->Save(dest);
 }
 
+void ParticleEffect::GetDependencies(Vector<ResourceRef>& dest) const
+{
+    if (material_)
+        dest.Push(GetResourceRef(material_, Material::GetTypeStatic()));
+}
+
 bool ParticleEffect::Save(XMLElement& dest) const
 {
     if (dest.IsNull())
@@ -117,6 +117,8 @@ public:
     virtual bool EndLoad();
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
+    /// Return references to the material used.
+    virtual void GetDependencies(Vector<ResourceRef>& dest) const;
     
     /// Save resource to XMLElement. Return true if successful.
     bool Save(XMLElement& dest) const;
@@ -29,6 +29,8 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 
+#include <cstring>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -38,6 +40,169 @@ extern const char* GEOMETRY_CATEGORY;
 extern const char* faceCameraModeNames[];
 static const unsigned MAX_PARTICLES_IN_FRAME = 100;
 
+/// Particle state channels. Each channel holds one float per particle.
+enum ParticleChannel
+{
+    PC_TIMER = 0,
+    PC_TIME_TO_LIVE,
+    PC_VELOCITY_X,
+    PC_VELOCITY_Y,
+    PC_VELOCITY_Z,
+    PC_POSITION_X,
+    PC_POSITION_Y,
+    PC_POSITION_Z,
+    PC_ROTATION,
+    PC_ROTATION_SPEED,
+    PC_SCALE,
+    PC_SIZE_X,
+    PC_SIZE_Y,
+    MAX_PARTICLE_CHANNELS
+};
+
+#if defined(URHO3D_SIMD_SSE)
+/// Select from a where the mask is set and from b elsewhere.
+static inline __m128 SelectPS(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+/// Advance the particles whose timer has not yet reached the time to live by one timestep.
+static void IntegrateParticles(float* data, unsigned count, float timeStep, const Vector3& force, float damping,
+    const Vector3& scaleVector, float sizeAdd, float sizeMul)
+{
+    float* timer = data + PC_TIMER * count;
+    float* timeToLive = data + PC_TIME_TO_LIVE * count;
+    float* velX = data + PC_VELOCITY_X * count;
+    float* velY = data + PC_VELOCITY_Y * count;
+    float* velZ = data + PC_VELOCITY_Z * count;
+    float* posX = data + PC_POSITION_X * count;
+    float* posY = data + PC_POSITION_Y * count;
+    float* posZ = data + PC_POSITION_Z * count;
+    float* rotation = data + PC_ROTATION * count;
+    float* rotationSpeed = data + PC_ROTATION_SPEED * count;
+    float* scale = data + PC_SCALE * count;
+
+    Vector3 forceStep = force * timeStep;
+    Vector3 posStep = scaleVector * timeStep;
+    float dampingStep = -damping * timeStep;
+    float scaleAdd = sizeAdd * timeStep;
+    float scaleMul = timeStep * (sizeMul - 1.0f) + 1.0f;
+    unsigned i = 0;
+
+#if defined(URHO3D_SIMD_SSE)
+    __m128 dt = _mm_set1_ps(timeStep);
+    __m128 fx = _mm_set1_ps(forceStep.x_);
+    __m128 fy = _mm_set1_ps(forceStep.y_);
+    __m128 fz = _mm_set1_ps(forceStep.z_);
+    __m128 sx = _mm_set1_ps(posStep.x_);
+    __m128 sy = _mm_set1_ps(posStep.y_);
+    __m128 sz = _mm_set1_ps(posStep.z_);
+    __m128 d = _mm_set1_ps(dampingStep);
+    __m128 add = _mm_set1_ps(scaleAdd);
+    __m128 mul = _mm_set1_ps(scaleMul);
+    __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 t = _mm_loadu_ps(timer + i);
+        __m128 live = _mm_cmplt_ps(t, _mm_loadu_ps(timeToLive + i));
+        _mm_storeu_ps(timer + i, SelectPS(live, _mm_add_ps(t, dt), t));
+
+        __m128 vx = _mm_loadu_ps(velX + i);
+        __m128 vy = _mm_loadu_ps(velY + i);
+        __m128 vz = _mm_loadu_ps(velZ + i);
+        __m128 nx = _mm_add_ps(vx, fx);
+        __m128 ny = _mm_add_ps(vy, fy);
+        __m128 nz = _mm_add_ps(vz, fz);
+        nx = _mm_add_ps(nx, _mm_mul_ps(nx, d));
+        ny = _mm_add_ps(ny, _mm_mul_ps(ny, d));
+        nz = _mm_add_ps(nz, _mm_mul_ps(nz, d));
+        _mm_storeu_ps(velX + i, SelectPS(live, nx, vx));
+        _mm_storeu_ps(velY + i, SelectPS(live, ny, vy));
+        _mm_storeu_ps(velZ + i, SelectPS(live, nz, vz));
+
+        __m128 px = _mm_loadu_ps(posX + i);
+        __m128 py = _mm_loadu_ps(posY + i);
+        __m128 pz = _mm_loadu_ps(posZ + i);
+        _mm_storeu_ps(posX + i, SelectPS(live, _mm_add_ps(px, _mm_mul_ps(nx, sx)), px));
+        _mm_storeu_ps(posY + i, SelectPS(live, _mm_add_ps(py, _mm_mul_ps(ny, sy)), py));
+        _mm_storeu_ps(posZ + i, SelectPS(live, _mm_add_ps(pz, _mm_mul_ps(nz, sz)), pz));
+
+        __m128 r = _mm_loadu_ps(rotation + i);
+        _mm_storeu_ps(rotation + i, SelectPS(live, _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(rotationSpeed + i), dt)), r));
+
+        __m128 s = _mm_loadu_ps(scale + i);
+        _mm_storeu_ps(scale + i, SelectPS(live, _mm_mul_ps(_mm_max_ps(_mm_add_ps(s, add), zero), mul), s));
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    float32x4_t dt = vdupq_n_f32(timeStep);
+    float32x4_t fx = vdupq_n_f32(forceStep.x_);
+    float32x4_t fy = vdupq_n_f32(forceStep.y_);
+    float32x4_t fz = vdupq_n_f32(forceStep.z_);
+    float32x4_t sx = vdupq_n_f32(posStep.x_);
+    float32x4_t sy = vdupq_n_f32(posStep.y_);
+    float32x4_t sz = vdupq_n_f32(posStep.z_);
+    float32x4_t d = vdupq_n_f32(dampingStep);
+    float32x4_t add = vdupq_n_f32(scaleAdd);
+    float32x4_t mul = vdupq_n_f32(scaleMul);
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t t = vld1q_f32(timer + i);
+        uint32x4_t live = vcltq_f32(t, vld1q_f32(timeToLive + i));
+        vst1q_f32(timer + i, vbslq_f32(live, vaddq_f32(t, dt), t));
+
+        float32x4_t vx = vld1q_f32(velX + i);
+        float32x4_t vy = vld1q_f32(velY + i);
+        float32x4_t vz = vld1q_f32(velZ + i);
+        float32x4_t nx = vaddq_f32(vx, fx);
+        float32x4_t ny = vaddq_f32(vy, fy);
+        float32x4_t nz = vaddq_f32(vz, fz);
+        nx = vmlaq_f32(nx, nx, d);
+        ny = vmlaq_f32(ny, ny, d);
+        nz = vmlaq_f32(nz, nz, d);
+        vst1q_f32(velX + i, vbslq_f32(live, nx, vx));
+        vst1q_f32(velY + i, vbslq_f32(live, ny, vy));
+        vst1q_f32(velZ + i, vbslq_f32(live, nz, vz));
+
+        float32x4_t px = vld1q_f32(posX + i);
+        float32x4_t py = vld1q_f32(posY + i);
+        float32x4_t pz = vld1q_f32(posZ + i);
+        vst1q_f32(posX + i, vbslq_f32(live, vmlaq_f32(px, nx, sx), px));
+        vst1q_f32(posY + i, vbslq_f32(live, vmlaq_f32(py, ny, sy), py));
+        vst1q_f32(posZ + i, vbslq_f32(live, vmlaq_f32(pz, nz, sz), pz));
+
+        float32x4_t r = vld1q_f32(rotation + i);
+        vst1q_f32(rotation + i, vbslq_f32(live, vmlaq_f32(r, vld1q_f32(rotationSpeed + i), dt), r));
+
+        float32x4_t s = vld1q_f32(scale + i);
+        vst1q_f32(scale + i, vbslq_f32(live, vmulq_f32(vmaxq_f32(vaddq_f32(s, add), zero), mul), s));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        if (timer[i] >= timeToLive[i])
+            continue;
+
+        timer[i] += timeStep;
+        float vx = velX[i] + forceStep.x_;
+        float vy = velY[i] + forceStep.y_;
+        float vz = velZ[i] + forceStep.z_;
+        vx += vx * dampingStep;
+        vy += vy * dampingStep;
+        vz += vz * dampingStep;
+        velX[i] = vx;
+        velY[i] = vy;
+        velZ[i] = vz;
+        posX[i] += vx * posStep.x_;
+        posY[i] += vy * posStep.y_;
+        posZ[i] += vz * posStep.z_;
+        rotation[i] += rotationSpeed[i] * timeStep;
+        scale[i] = Max(scale[i] + scaleAdd, 0.0f) * scaleMul;
+    }
+}
+
 ParticleEmitter::ParticleEmitter(Context* context) :
     BillboardSet(context),
     periodTimer_(0.0f),
@@ -70,7 +235,7 @@ void ParticleEmitter::RegisterObject(Context* context)
     ATTRIBUTE("Emission Timer", float, emissionTimer_, 0.0f, AM_FILE | AM_NOEDIT);
     COPY_BASE_ATTRIBUTES(Drawable);
     MIXED_ACCESSOR_ATTRIBUTE("Particles", GetParticlesAttr, SetParticlesAttr, VariantVector, Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
-    MIXED_ACCESSOR_ATTRIBUTE("Billboards", GetParticleBillboardsAttr, SetBillboardsAttr, VariantVector, Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
+    MIXED_ACCESSOR_ATTRIBUTE("Billboards", GetParticleBillboardsAttr, SetParticleBillboardsAttr, VariantVector, Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
     ATTRIBUTE("Serialize Particles", bool, serializeParticles_, true, AM_FILE);
 }
 
@@ -98,8 +263,9 @@ void ParticleEmitter::Update(const FrameInfo& frame)
         return;
 
     // If there is an amount mismatch between particles and billboards, correct it
-    if (particles_.Size() != billboards_.Size())
-        SetNumBillboards(particles_.Size());
+    unsigned numParticles = GetNumParticles();
+    if (numParticles != billboards_.Size())
+        SetNumBillboards(numParticles);
 
     bool needCommit = false;
 
@@ -161,79 +327,71 @@ void ParticleEmitter::Update(const FrameInfo& frame)
     if (scaled_ && !relative_)
         scaleVector = node_->GetWorldScale();
 
-    for (unsigned i = 0; i < particles_.Size(); ++i)
+    float* data = particleData_.Get();
+    const float* timer = data + PC_TIMER * numParticles;
+    const float* timeToLive = data + PC_TIME_TO_LIVE * numParticles;
+
+    // Time to live
+    for (unsigned i = 0; i < numParticles; ++i)
     {
-        Particle& particle = particles_[i];
         Billboard& billboard = billboards_[i];
-
-        if (billboard.enabled_)
+        if (billboard.enabled_ && timer[i] >= timeToLive[i])
         {
+            billboard.enabled_ = false;
             needCommit = true;
+        }
+    }
 
-            // Time to live
-            if (particle.timer_ >= particle.timeToLive_)
-            {
-                billboard.enabled_ = false;
-                continue;
-            }
-            particle.timer_ += lastTimeStep_;
-
-            // Velocity & position
-            const Vector3& constantForce = effect_->GetConstantForce();
-            if (constantForce != Vector3::ZERO)
-            {
-                if (relative_)
-                    particle.velocity_ += lastTimeStep_ * relativeConstantForce;
-                else
-                    particle.velocity_ += lastTimeStep_ * constantForce;
-            }
-
-            float dampingForce = effect_->GetDampingForce();
-            if (dampingForce != 0.0f)
-            {
-                Vector3 force = -dampingForce * particle.velocity_;
-                particle.velocity_ += lastTimeStep_ * force;
-            }
-            billboard.position_ += lastTimeStep_ * particle.velocity_ * scaleVector;
+    // Integrate velocity, position, rotation and scale of all live particles in one pass over the state channels
+    float sizeAdd = effect_->GetSizeAdd();
+    float sizeMul = effect_->GetSizeMul();
+    IntegrateParticles(data, numParticles, lastTimeStep_, relative_ ? relativeConstantForce : effect_->GetConstantForce(),
+        effect_->GetDampingForce(), scaleVector, sizeAdd, sizeMul);
+
+    const float* posX = data + PC_POSITION_X * numParticles;
+    const float* posY = data + PC_POSITION_Y * numParticles;
+    const float* posZ = data + PC_POSITION_Z * numParticles;
+    const float* rotation = data + PC_ROTATION * numParticles;
+    const float* scale = data + PC_SCALE * numParticles;
+    const float* sizeX = data + PC_SIZE_X * numParticles;
+    const float* sizeY = data + PC_SIZE_Y * numParticles;
+    bool sizing = sizeAdd != 0.0f || sizeMul != 1.0f;
+
+    for (unsigned i = 0; i < numParticles; ++i)
+    {
+        Billboard& billboard = billboards_[i];
 
-            // Rotation
-            billboard.rotation_ += lastTimeStep_ * particle.rotationSpeed_;
+        if (billboard.enabled_)
+        {
+            needCommit = true;
 
-            // Scaling
-            float sizeAdd = effect_->GetSizeAdd();
-            float sizeMul = effect_->GetSizeMul();
-            if (sizeAdd != 0.0f || sizeMul != 1.0f)
-            {
-                particle.scale_ += lastTimeStep_ * sizeAdd;
-                if (particle.scale_ < 0.0f)
-                    particle.scale_ = 0.0f;
-                if (sizeMul != 1.0f)
-                    particle.scale_ *= (lastTimeStep_ * (sizeMul - 1.0f)) + 1.0f;
-                billboard.size_ = particle.size_ * particle.scale_;
-            }
+            billboard.position_ = Vector3(posX[i], posY[i], posZ[i]);
+            billboard.rotation_ = rotation[i];
+            if (sizing)
+                billboard.size_ = Vector2(sizeX[i], sizeY[i]) * scale[i];
 
             // Color interpolation
-            unsigned& index = particle.colorIndex_;
+            unsigned& index = colorIndices_[i];
             const Vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
             if (index < colorFrames_.Size())
             {
                 if (index < colorFrames_.Size() - 1)
                 {
-                    if (particle.timer_ >= colorFrames_[index + 1].time_)
+                    if (timer[i] >= colorFrames_[index + 1].time_)
                         ++index;
                 }
                 if (index < colorFrames_.Size() - 1)
-                    billboard.color_ = colorFrames_[index].Interpolate(colorFrames_[index + 1], particle.timer_);
+                    billboard.color_ = colorFrames_[index].Interpolate(colorFrames_[index + 1], timer[i]);
                 else
                     billboard.color_ = colorFrames_[index].color_;
             }
 
             // Texture animation
-            unsigned& texIndex = particle.texIndex_;
+            unsigned& texIndex = texIndices_[i];
             const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
             if (textureFrames_.Size() && texIndex < textureFrames_.Size() - 1)
             {
-                if (particle.timer_ >= textureFrames_[texIndex + 1].time_)
+                if (timer[i] >= textureFrames_[texIndex + 1].time_)
                 {
                     billboard.uv_ = textureFrames_[texIndex + 1].uv_;
                     ++texIndex;
@@ -276,7 +434,25 @@ void ParticleEmitter::SetNumParticles(unsigned num)
     if (num > MAX_BILLBOARDS)
         num = MAX_BILLBOARDS;
 
-    particles_.Resize(num);
+    unsigned oldNum = GetNumParticles();
+    if (num != oldNum)
+    {
+        // Move each state channel to its new offset. Channels of new particles are zeroed so that they stay dead in
+        // the integration pass
+        SharedArrayPtr<float> newData(num ? new float[num * MAX_PARTICLE_CHANNELS] : (float*)0);
+        if (num)
+            memset(newData.Get(), 0, num * MAX_PARTICLE_CHANNELS * sizeof(float));
+        unsigned copyNum = Min((int)num, (int)oldNum);
+        if (copyNum)
+        {
+            for (unsigned i = 0; i < MAX_PARTICLE_CHANNELS; ++i)
+                memcpy(newData.Get() + i * num, particleData_.Get() + i * oldNum, copyNum * sizeof(float));
+        }
+        particleData_ = newData;
+        colorIndices_.Resize(num);
+        texIndices_.Resize(num);
+    }
+
     SetNumBillboards(num);
 }
 
@@ -345,44 +521,72 @@ void ParticleEmitter::SetParticlesAttr(const VariantVector& value)
     unsigned index = 0;
     SetNumParticles(index < value.Size() ? value[index++].GetUInt() : 0);
 
-    for (PODVector<Particle>::Iterator i = particles_.Begin(); i != particles_.End() && index < value.Size(); ++i)
+    unsigned numParticles = GetNumParticles();
+    float* data = particleData_.Get();
+    for (unsigned i = 0; i < numParticles && index < value.Size(); ++i)
     {
-        i->velocity_ = value[index++].GetVector3();
-        i->size_ = value[index++].GetVector2();
-        i->timer_ = value[index++].GetFloat();
-        i->timeToLive_ = value[index++].GetFloat();
-        i->scale_ = value[index++].GetFloat();
-        i->rotationSpeed_ = value[index++].GetFloat();
-        i->colorIndex_ = value[index++].GetInt();
-        i->texIndex_ = value[index++].GetInt();
+        const Vector3& velocity = value[index++].GetVector3();
+        data[PC_VELOCITY_X * numParticles + i] = velocity.x_;
+        data[PC_VELOCITY_Y * numParticles + i] = velocity.y_;
+        data[PC_VELOCITY_Z * numParticles + i] = velocity.z_;
+        const Vector2& size = value[index++].GetVector2();
+        data[PC_SIZE_X * numParticles + i] = size.x_;
+        data[PC_SIZE_Y * numParticles + i] = size.y_;
+        data[PC_TIMER * numParticles + i] = value[index++].GetFloat();
+        data[PC_TIME_TO_LIVE * numParticles + i] = value[index++].GetFloat();
+        data[PC_SCALE * numParticles + i] = value[index++].GetFloat();
+        data[PC_ROTATION_SPEED * numParticles + i] = value[index++].GetFloat();
+        colorIndices_[i] = value[index++].GetInt();
+        texIndices_[i] = value[index++].GetInt();
     }
 }
 
 VariantVector ParticleEmitter::GetParticlesAttr() const
 {
+    unsigned numParticles = GetNumParticles();
     VariantVector ret;
     if (!serializeParticles_)
     {
-        ret.Push(particles_.Size());
+        ret.Push(numParticles);
         return ret;
     }
 
-    ret.Reserve(particles_.Size() * 8 + 1);
-    ret.Push(particles_.Size());
-    for (PODVector<Particle>::ConstIterator i = particles_.Begin(); i != particles_.End(); ++i)
+    ret.Reserve(numParticles * 8 + 1);
+    ret.Push(numParticles);
+    const float* data = particleData_.Get();
+    for (unsigned i = 0; i < numParticles; ++i)
     {
-        ret.Push(i->velocity_);
-        ret.Push(i->size_);
-        ret.Push(i->timer_);
-        ret.Push(i->timeToLive_);
-        ret.Push(i->scale_);
-        ret.Push(i->rotationSpeed_);
-        ret.Push(i->colorIndex_);
-        ret.Push(i->texIndex_);
+        ret.Push(Vector3(data[PC_VELOCITY_X * numParticles + i], data[PC_VELOCITY_Y * numParticles + i],
+            data[PC_VELOCITY_Z * numParticles + i]));
+        ret.Push(Vector2(data[PC_SIZE_X * numParticles + i], data[PC_SIZE_Y * numParticles + i]));
+        ret.Push(data[PC_TIMER * numParticles + i]);
+        ret.Push(data[PC_TIME_TO_LIVE * numParticles + i]);
+        ret.Push(data[PC_SCALE * numParticles + i]);
+        ret.Push(data[PC_ROTATION_SPEED * numParticles + i]);
+        ret.Push(colorIndices_[i]);
+        ret.Push(texIndices_[i]);
     }
     return ret;
 }
 
+void ParticleEmitter::SetParticleBillboardsAttr(const VariantVector& value)
+{
+    SetBillboardsAttr(value);
+
+    // The integration works on the particle state, so take the loaded positions and rotations from the billboards
+    unsigned numParticles = GetNumParticles();
+    unsigned numBillboards = Min((int)numParticles, (int)billboards_.Size());
+    float* data = particleData_.Get();
+    for (unsigned i = 0; i < numBillboards; ++i)
+    {
+        const Billboard& billboard = billboards_[i];
+        data[PC_POSITION_X * numParticles + i] = billboard.position_.x_;
+        data[PC_POSITION_Y * numParticles + i] = billboard.position_.y_;
+        data[PC_POSITION_Z * numParticles + i] = billboard.position_.z_;
+        data[PC_ROTATION * numParticles + i] = billboard.rotation_;
+    }
+}
+
 VariantVector ParticleEmitter::GetParticleBillboardsAttr() const
 {
     VariantVector ret;
@@ -425,8 +629,8 @@ bool ParticleEmitter::EmitNewParticle()
     unsigned index = GetFreeParticle();
     if (index == M_MAX_UNSIGNED)
         return false;
-    assert(index < particles_.Size());
-    Particle& particle = particles_[index];
+    unsigned numParticles = GetNumParticles();
+    assert(index < numParticles);
     Billboard& billboard = billboards_[index];
 
     Vector3 startPos;
@@ -468,20 +672,30 @@ bool ParticleEmitter::EmitNewParticle()
         startDir = node_->GetWorldRotation() * startDir;
     };
 
-    particle.velocity_ = effect_->GetRandomVelocity() * startDir;
-    particle.size_ = effect_->GetRandomSize();
-    particle.timer_ = 0.0f;
-    particle.timeToLive_ = effect_->GetRandomTimeToLive();
-    particle.scale_ = 1.0f;
-    particle.rotationSpeed_ = effect_->GetRandomRotationSpeed();
-    particle.colorIndex_ = 0;
-    particle.texIndex_ = 0;
+    Vector3 velocity = effect_->GetRandomVelocity() * startDir;
+    Vector2 size = effect_->GetRandomSize();
+    float* data = particleData_.Get();
+    data[PC_VELOCITY_X * numParticles + index] = velocity.x_;
+    data[PC_VELOCITY_Y * numParticles + index] = velocity.y_;
+    data[PC_VELOCITY_Z * numParticles + index] = velocity.z_;
+    data[PC_POSITION_X * numParticles + index] = startPos.x_;
+    data[PC_POSITION_Y * numParticles + index] = startPos.y_;
+    data[PC_POSITION_Z * numParticles + index] = startPos.z_;
+    data[PC_SIZE_X * numParticles + index] = size.x_;
+    data[PC_SIZE_Y * numParticles + index] = size.y_;
+    data[PC_TIMER * numParticles + index] = 0.0f;
+    data[PC_TIME_TO_LIVE * numParticles + index] = effect_->GetRandomTimeToLive();
+    data[PC_SCALE * numParticles + index] = 1.0f;
+    data[PC_ROTATION_SPEED * numParticles + index] = effect_->GetRandomRotationSpeed();
+    colorIndices_[index] = 0;
+    texIndices_[index] = 0;
 
     billboard.position_ = startPos;
-    billboard.size_ = particles_[index].size_;
+    billboard.size_ = size;
     const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
     billboard.uv_ = textureFrames_.Size() ? textureFrames_[0].uv_ : Rect::POSITIVE;
     billboard.rotation_ = effect_->GetRandomRotation();
+    data[PC_ROTATION * numParticles + index] = billboard.rotation_;
     const Vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
     billboard.color_ = colorFrames_.Size() ? colorFrames_[0].color_ : Color();
     billboard.enabled_ = true;
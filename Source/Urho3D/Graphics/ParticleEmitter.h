@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/ArrayPtr.h"
 #include "../Graphics/BillboardSet.h"
 
 namespace Urho3D
@@ -29,27 +30,6 @@ namespace Urho3D
 
 class ParticleEffect;
 
-/// One particle in the particle system.
-struct Particle
-{
-    /// Velocity.
-    Vector3 velocity_;
-    /// Original billboard size.
-    Vector2 size_;
-    /// Time elapsed from creation.
-    float timer_;
-    /// Lifetime.
-    float timeToLive_;
-    /// Size scaling value.
-    float scale_;
-    /// Rotation speed.
-    float rotationSpeed_;
-    /// Current color animation index.
-    unsigned colorIndex_;
-    /// Current texture animation index.
-    unsigned texIndex_;
-};
-
 /// %Particle emitter component.
 class URHO3D_API ParticleEmitter : public BillboardSet
 {
@@ -88,7 +68,7 @@ public:
     /// Return particle effect.
     ParticleEffect* GetEffect() const { return effect_; }
     /// Return maximum number of particles.
-    unsigned GetNumParticles() const { return particles_.Size(); }
+    unsigned GetNumParticles() const { return colorIndices_.Size(); }
     /// Return whether is currently emitting.
     bool IsEmitting() const { return emitting_; }
     /// Return whether particles are to be serialized.
@@ -102,6 +82,8 @@ public:
     void SetParticlesAttr(const VariantVector& value);
     /// Return particles attribute. Returns particle amount only if particles are not to be serialized.
     VariantVector GetParticlesAttr() const;
+    /// Set billboards attribute. Also copies the positions and rotations to the particle state.
+    void SetParticleBillboardsAttr(const VariantVector& value);
     /// Return billboards attribute. Returns billboard amount only if particles are not to be serialized.
     VariantVector GetParticleBillboardsAttr() const;
 
@@ -122,8 +104,12 @@ private:
 
     /// Particle effect.
     SharedPtr<ParticleEffect> effect_;
-    /// Particles.
-    PODVector<Particle> particles_;
+    /// Particle state in structure-of-arrays layout: each state channel holds one float per particle, one channel after another.
+    SharedArrayPtr<float> particleData_;
+    /// Current color animation index of each particle.
+    PODVector<unsigned> colorIndices_;
+    /// Current texture animation index of each particle.
+    PODVector<unsigned> texIndices_;
     /// Active/inactive period timer.
     float periodTimer_;
     /// New particle emission timer.
@@ -41,6 +41,7 @@ static const char* commandTypeNames[] =
     "forwardlights",
     "lightvolumes",
     "renderui",
+    "depthpyramid",
     0
 };
 
@@ -141,6 +142,8 @@ void RenderPathCommand::Load(const XMLElement& element)
             markToStencil_ = element.GetBool("marktostencil");
         if (element.HasAttribute("vertexlights"))
             vertexLights_ = element.GetBool("vertexlights");
+        if (element.HasAttribute("clusteredlights"))
+            clusteredLights_ = element.GetBool("clusteredlights");
         break;
         
     case CMD_FORWARDLIGHTS:
@@ -149,6 +152,10 @@ void RenderPathCommand::Load(const XMLElement& element)
             useLitBase_ = element.GetBool("uselitbase");
         break;
         
+    case CMD_DEPTHPYRAMID:
+        if (element.HasAttribute("levels"))
+            depthPyramidLevels_ = element.GetUInt("levels");
+        // Fall through to read the optional custom downsample shaders
     case CMD_LIGHTVOLUMES:
     case CMD_QUAD:
         vertexShaderName_ = element.GetAttribute("vs");
@@ -163,6 +170,9 @@ void RenderPathCommand::Load(const XMLElement& element)
                 String blend = element.GetAttributeLower("blend");
                 blendMode_ = ((BlendMode)GetStringListIndex(blend.CString(), blendModeNames, BLEND_REPLACE));
             }
+            if (element.HasAttribute("scale"))
+                resolutionScale_ = Clamp(element.GetFloat("scale"), 0.125f, 1.0f);
+            upsampleDepthName_ = element.GetAttribute("upsampledepth");
 
             XMLElement parameterElem = element.GetChild("parameter");
             while (parameterElem)
@@ -187,6 +197,19 @@ void RenderPathCommand::Load(const XMLElement& element)
         outputs_[0].second_ = (CubeMapFace)element.GetInt("face");
     if (element.HasAttribute("depthstencil"))
         depthStencilName_ = element.GetAttribute("depthstencil");
+    if (element.HasAttribute("discard"))
+    {
+        Vector<String> discardNames = element.GetAttributeLower("discard").Split(' ');
+        for (unsigned i = 0; i < discardNames.Size(); ++i)
+        {
+            if (discardNames[i] == "color")
+                discardFlags_ |= CLEAR_COLOR;
+            else if (discardNames[i] == "depth")
+                discardFlags_ |= CLEAR_DEPTH;
+            else if (discardNames[i] == "stencil")
+                discardFlags_ |= CLEAR_STENCIL;
+        }
+    }
     // Check for defining multiple outputs
     XMLElement outputElem = element.GetChild("output");
     while (outputElem)
@@ -202,6 +225,13 @@ void RenderPathCommand::Load(const XMLElement& element)
         outputElem = outputElem.GetNext("output");
     }
     
+    // The depth pyramid levels are rendertargets named after the output, so the viewport can not be used
+    if (type_ == CMD_DEPTHPYRAMID && !outputs_[0].first_.Compare("viewport", false))
+    {
+        LOGERROR("Depth pyramid command must specify a named output");
+        enabled_ = false;
+    }
+    
     XMLElement textureElem = element.GetChild("texture");
     while (textureElem)
     {
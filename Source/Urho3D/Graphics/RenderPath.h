@@ -43,7 +43,8 @@ enum RenderCommandType
     CMD_QUAD,
     CMD_FORWARDLIGHTS,
     CMD_LIGHTVOLUMES,
-    CMD_RENDERUI
+    CMD_RENDERUI,
+    CMD_DEPTHPYRAMID
 };
 
 /// Rendering path sorting modes.
@@ -107,12 +108,16 @@ struct RenderPathCommand
     /// Construct.
     RenderPathCommand() :
         clearFlags_(0),
+        discardFlags_(0),
         blendMode_(BLEND_REPLACE),
         enabled_(true),
         useFogColor_(false),
         markToStencil_(false),
         useLitBase_(true),
-        vertexLights_(false)
+        vertexLights_(false),
+        clusteredLights_(false),
+        depthPyramidLevels_(0),
+        resolutionScale_(1.0f)
     {
     }
     
@@ -184,6 +189,8 @@ struct RenderPathCommand
     float clearDepth_;
     /// Clear stencil value. Affects clear command only.
     unsigned clearStencil_;
+    /// Framebuffer contents (clear flags) to discard after the command, as they are not needed anymore. Avoids writing them back to memory on tile-based GPUs.
+    unsigned discardFlags_;
     /// Blend mode. Affects quad command only.
     BlendMode blendMode_;
     /// Enabled flag.
@@ -196,6 +203,14 @@ struct RenderPathCommand
     bool useLitBase_;
     /// Vertex lights flag.
     bool vertexLights_;
+    /// Clustered forward lights flag.
+    bool clusteredLights_;
+    /// Maximum number of depth pyramid levels, or 0 to halve down to 1x1. Affects depth pyramid command only.
+    unsigned depthPyramidLevels_;
+    /// Resolution scale relative to the output. Below 1 the quad is rendered to a temporary buffer and upsampled. Affects quad command only.
+    float resolutionScale_;
+    /// Depth texture name for depth-aware upsampling of a reduced resolution quad. When empty, upsampling is bilinear. Affects quad command only.
+    String upsampleDepthName_;
 };
 
 /// Rendering path definition.
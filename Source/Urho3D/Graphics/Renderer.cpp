@@ -23,6 +23,8 @@
 #include "../Graphics/Camera.h"
 #include "../Core/CoreEvents.h"
 #include "../Graphics/DebugRenderer.h"
+#include "../IO/File.h"
+#include "../Graphics/FrameCapture.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
@@ -30,6 +32,7 @@
 #include "../Graphics/IndexBuffer.h"
 #include "../IO/Log.h"
 #include "../Graphics/Material.h"
+#include "../Core/MemoryTracker.h"
 #include "../Graphics/OcclusionBuffer.h"
 #include "../Graphics/Octree.h"
 #include "../Core/Profiler.h"
@@ -37,10 +40,12 @@
 #include "../Graphics/RenderPath.h"
 #include "../Resource/ResourceCache.h"
 #include "../Scene/Scene.h"
+#include "../Graphics/ShaderPrecache.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Texture2D.h"
 #include "../Graphics/TextureCube.h"
+#include "../Graphics/TextureStreamer.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../Graphics/View.h"
 #include "../Resource/XMLFile.h"
@@ -169,6 +174,18 @@ static const unsigned short spotLightIndexData[] =
     7, 6, 5
 };
 
+static const float boxVertexData[] =
+{
+    0.5f, 0.5f, -0.5f,
+    0.5f, -0.5f, -0.5f,
+    -0.5f, -0.5f, -0.5f,
+    -0.5f, 0.5f, -0.5f,
+    0.5f, 0.5f, 0.5f,
+    0.5f, -0.5f, 0.5f,
+    -0.5f, -0.5f, 0.5f,
+    -0.5f, 0.5f, 0.5f,
+};
+
 static const char* shadowVariations[] =
 {
     #ifdef URHO3D_OPENGL
@@ -190,7 +207,10 @@ static const char* geometryVSVariations[] =
     "",
     "SKINNED ",
     "INSTANCED ",
-    "BILLBOARD "
+    "BILLBOARD ",
+    "SKINNED SKINTEXTURE SKININSTANCED ",
+    "GPUPARTICLE ",
+    "INSTANCEDBILLBOARD "
 };
 
 static const char* lightVSVariations[] =
@@ -246,8 +266,17 @@ static const char* heightFogVariations[] =
     "HEIGHTFOG "
 };
 
+static const char* clusteredVariations[] =
+{
+    "",
+    "CLUSTERED "
+};
+
 static const unsigned INSTANCING_BUFFER_MASK = MASK_INSTANCEMATRIX1 | MASK_INSTANCEMATRIX2 | MASK_INSTANCEMATRIX3;
 static const unsigned MAX_BUFFER_AGE = 1000;
+static const unsigned MAX_SHADOW_CACHE_FRAMES = 60;
+/// Skinning matrices per bone matrix texture row. Must match the skinning shader code.
+static const unsigned SKIN_MATRICES_PER_ROW = 256;
 
 Renderer::Renderer(Context* context) :
     Object(context),
@@ -257,6 +286,7 @@ Renderer::Renderer(Context* context) :
     textureQuality_(QUALITY_HIGH),
     materialQuality_(QUALITY_HIGH),
     shadowMapSize_(1024),
+    shadowAtlasSize_(0),
     shadowQuality_(SHADOWQUALITY_HIGH_16BIT),
     maxShadowMaps_(1),
     minInstances_(2),
@@ -266,14 +296,28 @@ Renderer::Renderer(Context* context) :
     occluderSizeThreshold_(0.025f),
     mobileShadowBiasMul_(2.0f),
     mobileShadowBiasAdd_(0.0001f),
+    resolutionScale_(1.0f),
+    dynamicResolutionTarget_(1000.0f / 60.0f),
+    minResolutionScale_(0.5f),
     numOcclusionBuffers_(0),
+    numSharedCullResults_(0),
     numShadowCameras_(0),
     shadersChangedFrameNumber_(M_MAX_UNSIGNED),
+    numSkinMatrices_(0),
+    numUploadedSkinMatrices_(0),
     hdrRendering_(false),
     specularLighting_(true),
     drawShadows_(true),
     reuseShadowMaps_(true),
+    shadowCache_(false),
+    shadowAtlasDirty_(true),
     dynamicInstancing_(true),
+    indirectDraw_(true),
+    temporalOcclusion_(false),
+    dynamicResolution_(false),
+    gpuOcclusion_(false),
+    textureSkinning_(false),
+    releaseModelCPUData_(false),
     shadersDirty_(true),
     initialized_(false),
     resetViews_(false)
@@ -410,6 +454,30 @@ void Renderer::SetReuseShadowMaps(bool enable)
     reuseShadowMaps_ = enable;
 }
 
+void Renderer::SetShadowCache(bool enable)
+{
+    // Release the cached shadow maps when disabled
+    if (!enable)
+        shadowMapCaches_.Clear();
+    
+    shadowCache_ = enable;
+}
+
+void Renderer::SetShadowAtlasSize(int size)
+{
+    if (size > 0)
+        size = NextPowerOfTwo(Max(size, SHADOW_MIN_PIXELS));
+    else
+        size = 0;
+    
+    if (size != shadowAtlasSize_)
+    {
+        shadowAtlasSize_ = size;
+        shadowAtlas_.Reset();
+        shadowAtlasDirty_ = true;
+    }
+}
+
 void Renderer::SetMaxShadowMaps(int shadowMaps)
 {
     if (shadowMaps < 1)
@@ -431,6 +499,11 @@ void Renderer::SetDynamicInstancing(bool enable)
     dynamicInstancing_ = enable;
 }
 
+void Renderer::SetIndirectDraw(bool enable)
+{
+    indirectDraw_ = enable;
+}
+
 void Renderer::SetMinInstances(int instances)
 {
     minInstances_ = Max(instances, 2);
@@ -462,16 +535,75 @@ void Renderer::SetMobileShadowBiasAdd(float add)
     mobileShadowBiasAdd_ = add;
 }
 
+void Renderer::SetResolutionScale(float scale)
+{
+    resolutionScale_ = Clamp(scale, 0.25f, 1.0f);
+}
+
+void Renderer::SetDynamicResolution(bool enable)
+{
+    // Return to full resolution when the controller is switched off
+    if (!enable && dynamicResolution_)
+        resolutionScale_ = 1.0f;
+    dynamicResolution_ = enable;
+}
+
+void Renderer::SetDynamicResolutionTarget(float frameTime)
+{
+    dynamicResolutionTarget_ = Max(frameTime, 1.0f);
+}
+
+void Renderer::SetMinResolutionScale(float scale)
+{
+    minResolutionScale_ = Clamp(scale, 0.25f, 1.0f);
+}
+
 void Renderer::SetOccluderSizeThreshold(float screenSize)
 {
     occluderSizeThreshold_ = Max(screenSize, 0.0f);
 }
 
+void Renderer::SetTemporalOcclusion(bool enable)
+{
+    temporalOcclusion_ = enable;
+}
+
+void Renderer::SetGPUOcclusion(bool enable)
+{
+    gpuOcclusion_ = enable;
+}
+
+void Renderer::SetTextureSkinning(bool enable)
+{
+    if (!graphics_->GetTextureSkinningSupport())
+        enable = false;
+    
+    if (enable != textureSkinning_)
+    {
+        textureSkinning_ = enable;
+        // The skinned shader variations change
+        shadersDirty_ = true;
+    }
+}
+
+void Renderer::SetTextureStreaming(bool enable)
+{
+    if (enable && !textureStreamer_)
+        textureStreamer_ = new TextureStreamer(context_);
+    else if (!enable)
+        textureStreamer_.Reset();
+}
+
 void Renderer::ReloadShaders()
 {
     shadersDirty_ = true;
 }
 
+void Renderer::CaptureFrame(const String& fileName)
+{
+    captureFileName_ = fileName;
+}
+
 Viewport* Renderer::GetViewport(unsigned index) const
 {
     return index < viewports_.Size() ? viewports_[index] : (Viewport*)0;
@@ -549,6 +681,7 @@ unsigned Renderer::GetNumOccluders(bool allViews) const
 void Renderer::Update(float timeStep)
 {
     PROFILE(UpdateViews);
+    MEMORY_TAG(MEMTAG_RENDER);
     
     views_.Clear();
     
@@ -561,14 +694,23 @@ void Renderer::Update(float timeStep)
     frame_.frameNumber_ = GetSubsystem<Time>()->GetFrameNumber();
     frame_.timeStep_ = timeStep;
     frame_.camera_ = 0;
+    frame_.occlusionBuffer_ = 0;
     numShadowCameras_ = 0;
     numOcclusionBuffers_ = 0;
+    numSharedCullResults_ = 0;
     updatedOctrees_.Clear();
     
     // Reload shaders now if needed
     if (shadersDirty_)
         LoadShaders();
     
+    if (dynamicResolution_)
+        UpdateDynamicResolution(timeStep);
+    
+    // Upload the texture mip levels loaded since the last frame, and start loading more according to the last frame's views
+    if (textureStreamer_)
+        textureStreamer_->Update(frame_.frameNumber_);
+    
     // Queue update of the main viewports. Use reverse order, as rendering order is also reverse
     // to render auxiliary views before dependant main views
     for (unsigned i = viewports_.Size() - 1; i < viewports_.Size(); --i)
@@ -624,6 +766,14 @@ void Renderer::Update(float timeStep)
                 debug->SetView(viewport->GetCamera());
         }
         
+        // Skip the update and rendering of an incrementally updated texture view when nothing it shows has changed, as the
+        // texture keeps the previous contents
+        if (!view->CheckUpdateNeeded(frame_))
+        {
+            views_.Pop();
+            continue;
+        }
+        
         // Update view. This may queue further views. View will send update begin/end events once its state is set
         ResetShadowMapAllocations(); // Each view can reuse the same shadow maps
         view->Update(frame_);
@@ -643,6 +793,8 @@ void Renderer::Update(float timeStep)
 
 void Renderer::Render()
 {
+    MEMORY_TAG(MEMTAG_RENDER);
+    
     // Engine does not render when window is closed or device is lost
     assert(graphics_ && graphics_->IsInitialized() && !graphics_->IsDeviceLost());
     
@@ -655,6 +807,11 @@ void Renderer::Render()
     graphics_->SetDefaultTextureFilterMode(textureFilterMode_);
     graphics_->SetTextureAnisotropy(textureAnisotropy_);
     
+    // Start collecting the skinning matrices of the frame from the beginning of the bone matrix texture
+    skinMatrixOffsets_.Clear();
+    numSkinMatrices_ = 0;
+    numUploadedSkinMatrices_ = 0;
+    
     // If no views, just clear the screen
     if (views_.Empty())
     {
@@ -668,6 +825,9 @@ void Renderer::Render()
         
         numPrimitives_ = 0;
         numBatches_ = 0;
+        numStateChanges_ = 0;
+        numAvoidedStateChanges_ = 0;
+        numParameterBytes_ = 0;
     }
     else
     {
@@ -696,9 +856,12 @@ void Renderer::Render()
             SendEvent(E_ENDVIEWRENDER, eventData);
         }
         
-        // Copy the number of batches & primitives from Graphics so that we can account for 3D geometry only
+        // Copy the number of batches, primitives & state changes from Graphics so that we can account for 3D geometry only
         numPrimitives_ = graphics_->GetNumPrimitives();
         numBatches_ = graphics_->GetNumBatches();
+        numStateChanges_ = graphics_->GetNumStateChanges();
+        numAvoidedStateChanges_ = graphics_->GetNumAvoidedStateChanges();
+        numParameterBytes_ = graphics_->GetNumParameterBytes();
     }
     
     // Remove unused occlusion buffers and renderbuffers
@@ -790,61 +953,8 @@ Geometry* Renderer::GetQuadGeometry()
 
 Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight)
 {
-    LightType type = light->GetLightType();
-    const FocusParameters& parameters = light->GetShadowFocus();
-    float size = (float)shadowMapSize_ * light->GetShadowResolution();
-    // Automatically reduce shadow map size when far away
-    if (parameters.autoSize_ && type != LIGHT_DIRECTIONAL)
-    {
-        const Matrix3x4& view = camera->GetView();
-        const Matrix4& projection = camera->GetProjection();
-        BoundingBox lightBox;
-        float lightPixels;
-        
-        if (type == LIGHT_POINT)
-        {
-            // Calculate point light pixel size from the projection of its diagonal
-            Vector3 center = view * light->GetNode()->GetWorldPosition();
-            float extent = 0.58f * light->GetRange();
-            lightBox.Define(center + Vector3(extent, extent, extent), center - Vector3(extent, extent, extent));
-        }
-        else
-        {
-            // Calculate spot light pixel size from the projection of its frustum far vertices
-            Frustum lightFrustum = light->GetFrustum().Transformed(view);
-            lightBox.Define(&lightFrustum.vertices_[4], 4);
-        }
-        
-        Vector2 projectionSize = lightBox.Projected(projection).Size();
-        lightPixels = Max(0.5f * (float)viewWidth * projectionSize.x_, 0.5f * (float)viewHeight * projectionSize.y_);
-        
-        // Clamp pixel amount to a sufficient minimum to avoid self-shadowing artifacts due to loss of precision
-        if (lightPixels < SHADOW_MIN_PIXELS)
-            lightPixels = SHADOW_MIN_PIXELS;
-        
-        size = Min(size, lightPixels);
-    }
-    
-    /// \todo Allow to specify maximum shadow maps per resolution, as smaller shadow maps take less memory
-    int width = NextPowerOfTwo((unsigned)size);
-    int height = width;
-    
-    // Adjust the size for directional or point light shadow map atlases
-    if (type == LIGHT_DIRECTIONAL)
-    {
-        unsigned numSplits = light->GetNumShadowSplits();
-        if (numSplits > 1)
-            width *= 2;
-        if (numSplits > 2)
-            height *= 2;
-    }
-    else if (type == LIGHT_POINT)
-    {
-        width *= 2;
-        height *= 3;
-    }
-    
-    int searchKey = (width << 16) | height;
+    IntVector2 size = CalculateShadowMapSize(light, camera, viewWidth, viewHeight);
+    int searchKey = (size.x_ << 16) | size.y_;
     if (shadowMaps_.Contains(searchKey))
     {
         // If shadow maps are reused, always return the first
@@ -864,61 +974,49 @@ Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWid
         }
     }
     
-    unsigned shadowMapFormat = (shadowQuality_ & SHADOWQUALITY_LOW_24BIT) ? graphics_->GetHiresShadowMapFormat() :
-        graphics_->GetShadowMapFormat();
-    if (!shadowMapFormat)
-        return 0;
-    
-    SharedPtr<Texture2D> newShadowMap(new Texture2D(context_));
-    int retries = 3;
-    unsigned dummyColorFormat = graphics_->GetDummyColorFormat();
+    // If failed to create, store a null pointer so that we will not retry
+    SharedPtr<Texture2D> newShadowMap = CreateShadowMap(size.x_, size.y_);
+    shadowMaps_[searchKey].Push(newShadowMap);
+    if (!reuseShadowMaps_)
+        shadowMapAllocations_[searchKey].Push(light);
     
-    while (retries)
+    return newShadowMap;
+}
+
+ShadowMapCache* Renderer::GetShadowMapCache(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight)
+{
+    ShadowMapCache& cache = shadowMapCaches_[light];
+    // If the light pointer was reused by a new light, start over
+    if (cache.light_.Get() != light)
     {
-        if (!newShadowMap->SetSize(width, height, shadowMapFormat, TEXTURE_DEPTHSTENCIL))
-        {
-            width >>= 1;
-            height >>= 1;
-            --retries;
-        }
-        else
-        {
-            #ifndef GL_ES_VERSION_2_0
-            // OpenGL (desktop) and D3D11: shadow compare mode needs to be specifically enabled for the shadow map
-            newShadowMap->SetFilterMode(FILTER_BILINEAR);
-            newShadowMap->SetShadowCompare(true);
-            #endif
-            #ifndef URHO3D_OPENGL
-            // Direct3D9: when shadow compare must be done manually, use nearest filtering so that the filtering of point lights
-            // and other shadowed lights matches
-            newShadowMap->SetFilterMode(graphics_->GetHardwareShadowSupport() ? FILTER_BILINEAR : FILTER_NEAREST);
-            #endif
-            // Create dummy color texture for the shadow map if necessary: Direct3D9, or OpenGL when working around an OS X +
-            // Intel driver bug
-            if (dummyColorFormat)
-            {
-                // If no dummy color rendertarget for this size exists yet, create one now
-                if (!colorShadowMaps_.Contains(searchKey))
-                {
-                    colorShadowMaps_[searchKey] = new Texture2D(context_);
-                    colorShadowMaps_[searchKey]->SetSize(width, height, dummyColorFormat, TEXTURE_RENDERTARGET);
-                }
-                // Link the color rendertarget to the shadow map
-                newShadowMap->GetRenderSurface()->SetLinkedRenderTarget(colorShadowMaps_[searchKey]->GetRenderSurface());
-            }
-            break;
-        }
+        cache = ShadowMapCache();
+        cache.light_ = light;
     }
+    cache.frameNumber_ = frame_.frameNumber_;
     
-    // If failed to set size, store a null pointer so that we will not retry
-    if (!retries)
-        newShadowMap.Reset();
+    // Reallocate the shadow map when its size changes, for example due to shadow map auto-sizing. Do not retry after failure
+    // unless the size changes
+    IntVector2 size = CalculateShadowMapSize(light, camera, viewWidth, viewHeight);
+    if (cache.shadowMapSize_ != size)
+    {
+        cache.shadowMap_ = CreateShadowMap(size.x_, size.y_);
+        cache.shadowMapSize_ = size;
+        cache.valid_ = false;
+    }
     
-    shadowMaps_[searchKey].Push(newShadowMap);
-    if (!reuseShadowMaps_)
-        shadowMapAllocations_[searchKey].Push(light);
+    return cache.shadowMap_ ? &cache : 0;
+}
+
+Texture2D* Renderer::GetShadowAtlas()
+{
+    // Do not retry after failure until the size or shadow quality changes
+    if (shadowAtlasDirty_)
+    {
+        shadowAtlas_ = shadowAtlasSize_ ? CreateShadowMap(shadowAtlasSize_, shadowAtlasSize_) : SharedPtr<Texture2D>();
+        shadowAtlasDirty_ = false;
+    }
     
-    return newShadowMap;
+    return shadowAtlas_;
 }
 
 Texture* Renderer::GetScreenBuffer(int width, int height, unsigned format, bool cubemap, bool filtered, bool srgb, unsigned persistentKey)
@@ -1025,17 +1123,52 @@ OcclusionBuffer* Renderer::GetOcclusionBuffer(Camera* camera)
         occlusionBuffers_.Push(newBuffer);
     }
     
+    // Prefer the buffer that was used for the same camera on the previous frame, so that its depth can be reprojected
+    if (temporalOcclusion_)
+    {
+        for (unsigned i = numOcclusionBuffers_ + 1; i < occlusionBuffers_.Size(); ++i)
+        {
+            if (occlusionBuffers_[i]->GetHistoryCamera() == camera)
+            {
+                Swap(occlusionBuffers_[i], occlusionBuffers_[numOcclusionBuffers_]);
+                break;
+            }
+        }
+    }
+    
     int width = occlusionBufferSize_;
     int height = (int)((float)occlusionBufferSize_ / camera->GetAspectRatio() + 0.5f);
     
     OcclusionBuffer* buffer = occlusionBuffers_[numOcclusionBuffers_++];
     buffer->SetSize(width, height);
     buffer->SetView(camera);
+    buffer->SetTemporal(temporalOcclusion_);
     buffer->ResetUseTimer();
     
     return buffer;
 }
 
+SharedCullResult& Renderer::GetSharedCullResult(Octree* octree, unsigned group, unsigned viewMask)
+{
+    for (unsigned i = 0; i < numSharedCullResults_; ++i)
+    {
+        SharedCullResult& result = sharedCullResults_[i];
+        if (result.octree_ == octree && result.group_ == group && result.viewMask_ == viewMask)
+            return result;
+    }
+    
+    if (numSharedCullResults_ == sharedCullResults_.Size())
+        sharedCullResults_.Resize(numSharedCullResults_ + 1);
+    
+    SharedCullResult& result = sharedCullResults_[numSharedCullResults_++];
+    result.octree_ = octree;
+    result.group_ = group;
+    result.viewMask_ = viewMask;
+    result.sphere_.Clear();
+    result.drawables_.Clear();
+    return result;
+}
+
 Camera* Renderer::GetShadowCamera()
 {
     MutexLock lock(rendererMutex_);
@@ -1055,14 +1188,19 @@ Camera* Renderer::GetShadowCamera()
     return camera;
 }
 
+bool Renderer::GetPassShadersLoaded(Pass* pass) const
+{
+    return pass->GetVertexShaders().Size() && pass->GetPixelShaders().Size() && pass->GetShadersLoadedFrameNumber() ==
+        shadersChangedFrameNumber_;
+}
+
 void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows)
 {
     // Check if shaders are unloaded or need reloading
     Pass* pass = batch.pass_;
     Vector<SharedPtr<ShaderVariation> >& vertexShaders = pass->GetVertexShaders();
     Vector<SharedPtr<ShaderVariation> >& pixelShaders = pass->GetPixelShaders();
-    if (!vertexShaders.Size() || !pixelShaders.Size() || pass->GetShadersLoadedFrameNumber() !=
-        shadersChangedFrameNumber_)
+    if (!GetPassShadersLoaded(pass))
     {
         // First release all previous shaders, then load
         pass->ReleaseShaders();
@@ -1151,13 +1289,18 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows)
                 batch.vertexShader_ = vertexShaders[vsi];
             }
             
-            batch.pixelShader_ = pixelShaders[heightFog ? 1 : 0];
+            // Clustered forward lighting is applied in the vertex lit (ambient) passes
+            unsigned psi = heightFog ? 1 : 0;
+            if (batch.clusteredLights_ && pass->GetLightingMode() == LIGHTING_PERVERTEX)
+                psi += 2;
+            batch.pixelShader_ = pixelShaders[psi];
         }
     }
     
     // Log error if shaders could not be assigned, but only once per technique
     if (!batch.vertexShader_ || !batch.pixelShader_)
     {
+        MutexLock lock(rendererMutex_);
         if (!shaderErrorDisplayed_.Contains(tech))
         {
             shaderErrorDisplayed_.Insert(tech);
@@ -1166,6 +1309,85 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows)
     }
 }
 
+void Renderer::StorePassShaders(Pass* pass, ShaderPrecache* precache, unsigned geometryTypes, unsigned lightTypes, bool specular)
+{
+    if (!pass || !precache)
+        return;
+    
+    if (!GetPassShadersLoaded(pass))
+    {
+        pass->ReleaseShaders();
+        LoadPassShaders(pass);
+    }
+    
+    Vector<SharedPtr<ShaderVariation> >& vertexShaders = pass->GetVertexShaders();
+    Vector<SharedPtr<ShaderVariation> >& pixelShaders = pass->GetPixelShaders();
+    if (vertexShaders.Empty() || pixelShaders.Empty())
+        return;
+    
+    // Apply the same geometry type substitutions as SetBatchShaders(). Static geometry can also be drawn instanced
+    if (geometryTypes & (1 << GEOM_STATIC_NOINSTANCING))
+        geometryTypes |= 1 << GEOM_STATIC;
+    if (!GetDynamicInstancing())
+    {
+        if (geometryTypes & (1 << GEOM_INSTANCED))
+            geometryTypes |= 1 << GEOM_STATIC;
+        geometryTypes &= ~(1 << GEOM_INSTANCED);
+    }
+    else if (geometryTypes & (1 << GEOM_STATIC))
+        geometryTypes |= 1 << GEOM_INSTANCED;
+    
+    for (unsigned g = 0; g < MAX_GEOMETRYTYPES; ++g)
+    {
+        if (!(geometryTypes & (1 << g)))
+            continue;
+        
+        if (pass->GetLightingMode() == LIGHTING_PERPIXEL)
+        {
+            for (unsigned j = 0; j < MAX_LIGHT_PS_VARIATIONS * 2; ++j)
+            {
+                unsigned psi = j % MAX_LIGHT_PS_VARIATIONS;
+                if ((psi & LPS_SPEC) && (!specularLighting_ || !specular))
+                    continue;
+                if ((psi & LPS_SHADOW) && !drawShadows_)
+                    continue;
+                
+                unsigned vsi = g * MAX_LIGHT_VS_VARIATIONS + ((psi & LPS_SHADOW) ? LVS_SHADOW : 0);
+                LightType lightType;
+                switch (psi & (LPS_SPOT | LPS_POINT))
+                {
+                case LPS_NONE:
+                    lightType = LIGHT_DIRECTIONAL;
+                    vsi += LVS_DIR;
+                    break;
+                    
+                case LPS_SPOT:
+                    lightType = LIGHT_SPOT;
+                    vsi += LVS_SPOT;
+                    break;
+                    
+                default:
+                    lightType = LIGHT_POINT;
+                    vsi += LVS_POINT;
+                    break;
+                }
+                
+                if (lightTypes & (1 << lightType))
+                    precache->StoreShaders(vertexShaders[vsi], pixelShaders[j]);
+            }
+        }
+        else
+        {
+            unsigned numVertexShaders = pass->GetLightingMode() == LIGHTING_PERVERTEX ? MAX_VERTEXLIGHT_VS_VARIATIONS : 1;
+            for (unsigned j = 0; j < numVertexShaders; ++j)
+            {
+                for (unsigned k = 0; k < pixelShaders.Size(); ++k)
+                    precache->StoreShaders(vertexShaders[g * numVertexShaders + j], pixelShaders[k]);
+            }
+        }
+    }
+}
+
 void Renderer::SetLightVolumeBatchShaders(Batch& batch, const String& vsName, const String& psName, const String& vsDefines, const String& psDefines)
 {
     assert(deferredLightPSVariations_.Size());
@@ -1204,15 +1426,37 @@ void Renderer::SetLightVolumeBatchShaders(Batch& batch, const String& vsName, co
         psi += DLPS_ORTHO;
     }
     
-    if (vsDefines.Length())
-        batch.vertexShader_ = graphics_->GetShader(VS, vsName, deferredLightVSVariations[vsi] + vsDefines);
-    else
-        batch.vertexShader_ = graphics_->GetShader(VS, vsName, deferredLightVSVariations[vsi]);
+    // Instanced point light volumes read the light position, color and range from the instance data
+    String vsVariation(deferredLightVSVariations[vsi]);
+    String psVariation(deferredLightPSVariations_[psi]);
+    if (batch.geometryType_ == GEOM_INSTANCED)
+    {
+        vsVariation += "INSTANCED ";
+        psVariation += "INSTANCED ";
+    }
+    
+    batch.vertexShader_ = graphics_->GetShader(VS, vsName, vsVariation + vsDefines);
+    batch.pixelShader_ = graphics_->GetShader(PS, psName, psVariation + psDefines);
+}
 
-    if (psDefines.Length())
-        batch.pixelShader_ = graphics_->GetShader(PS, psName, deferredLightPSVariations_[psi] + psDefines);
-    else
-        batch.pixelShader_ = graphics_->GetShader(PS, psName, deferredLightPSVariations_[psi]);
+void Renderer::SaveFrameCapture(View* view)
+{
+    if (captureFileName_.Empty())
+        return;
+    
+    String fileName = captureFileName_;
+    captureFileName_.Clear();
+    
+    File file(context_);
+    if (!file.Open(fileName, FILE_WRITE))
+        return;
+    
+    SharedPtr<FrameCapture> capture(new FrameCapture(context_));
+    if (capture->Save(view, file))
+    {
+        LOGINFOF("Captured frame to %s: %u drawables, %u batches, %u batches skipped", fileName.CString(),
+            capture->GetNumDrawables(), capture->GetNumBatches(), capture->GetNumSkippedBatches());
+    }
 }
 
 void Renderer::SetCullMode(CullMode mode, Camera* camera)
@@ -1229,6 +1473,84 @@ void Renderer::SetCullMode(CullMode mode, Camera* camera)
     graphics_->SetCullMode(mode);
 }
 
+unsigned Renderer::GetSkinMatrixOffset(const Matrix3x4* matrices, unsigned num)
+{
+    HashMap<const Matrix3x4*, unsigned>::ConstIterator i = skinMatrixOffsets_.Find(matrices);
+    if (i != skinMatrixOffsets_.End())
+        return i->second_;
+    
+    unsigned offset = numSkinMatrices_;
+    numSkinMatrices_ += num;
+    unsigned numRows = (numSkinMatrices_ + SKIN_MATRICES_PER_ROW - 1) / SKIN_MATRICES_PER_ROW;
+    if (skinMatrices_.Size() < numRows * SKIN_MATRICES_PER_ROW)
+        skinMatrices_.Resize(numRows * SKIN_MATRICES_PER_ROW);
+    
+    for (unsigned j = 0; j < num; ++j)
+        skinMatrices_[offset + j] = matrices[j];
+    
+    skinMatrixOffsets_[matrices] = offset;
+    return offset;
+}
+
+void Renderer::UpdateSkinMatrixTexture()
+{
+    if (numUploadedSkinMatrices_ == numSkinMatrices_)
+        return;
+    
+    PROFILE(UpdateSkinMatrixTexture);
+    
+    // Each matrix takes 3 texels, one per row of the matrix
+    int width = SKIN_MATRICES_PER_ROW * 3;
+    int numRows = (numSkinMatrices_ + SKIN_MATRICES_PER_ROW - 1) / SKIN_MATRICES_PER_ROW;
+    int firstRow = numUploadedSkinMatrices_ / SKIN_MATRICES_PER_ROW;
+    
+    if (!skinMatrixTexture_ || skinMatrixTexture_->GetHeight() < numRows)
+    {
+        if (!skinMatrixTexture_)
+        {
+            skinMatrixTexture_ = new Texture2D(context_);
+            skinMatrixTexture_->SetNumLevels(1);
+            skinMatrixTexture_->SetFilterMode(FILTER_NEAREST);
+        }
+        
+        if (!skinMatrixTexture_->SetSize(width, NextPowerOfTwo(numRows), Graphics::GetRGBAFloat32Format(), TEXTURE_DYNAMIC))
+        {
+            LOGERROR("Failed to create bone matrix texture");
+            return;
+        }
+        
+        // A new texture has no contents, so upload everything added this frame
+        firstRow = 0;
+    }
+    
+    skinMatrixTexture_->SetData(0, 0, firstRow, width, numRows - firstRow, &skinMatrices_[firstRow * SKIN_MATRICES_PER_ROW]);
+    numUploadedSkinMatrices_ = numSkinMatrices_;
+}
+
+bool Renderer::UpdateLightClusterTexture(const Vector4* data, int numRows)
+{
+    PROFILE(UpdateLightClusterTexture);
+    
+    if (!lightClusterTexture_)
+    {
+        lightClusterTexture_ = new Texture2D(context_);
+        lightClusterTexture_->SetNumLevels(1);
+        lightClusterTexture_->SetFilterMode(FILTER_NEAREST);
+        lightClusterTexture_->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+        lightClusterTexture_->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+        
+        if (!lightClusterTexture_->SetSize(LIGHT_CLUSTER_TEXTURE_WIDTH, LIGHT_CLUSTER_TEXTURE_HEIGHT,
+            Graphics::GetRGBAFloat32Format(), TEXTURE_DYNAMIC))
+        {
+            LOGERROR("Failed to create light cluster texture");
+            lightClusterTexture_.Reset();
+            return false;
+        }
+    }
+    
+    return lightClusterTexture_->SetData(0, 0, 0, LIGHT_CLUSTER_TEXTURE_WIDTH, numRows, data);
+}
+
 bool Renderer::ResizeInstancingBuffer(unsigned numInstances)
 {
     if (!instancingBuffer_ || !dynamicInstancing_)
@@ -1366,6 +1688,120 @@ const Rect& Renderer::GetLightScissor(Light* light, Camera* camera)
     }
 }
 
+IntVector2 Renderer::CalculateShadowMapSize(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight) const
+{
+    LightType type = light->GetLightType();
+    const FocusParameters& parameters = light->GetShadowFocus();
+    float size = (float)shadowMapSize_ * light->GetShadowResolution();
+    // Automatically reduce shadow map size when far away
+    if (parameters.autoSize_ && type != LIGHT_DIRECTIONAL)
+    {
+        const Matrix3x4& view = camera->GetView();
+        const Matrix4& projection = camera->GetProjection();
+        BoundingBox lightBox;
+        float lightPixels;
+        
+        if (type == LIGHT_POINT)
+        {
+            // Calculate point light pixel size from the projection of its diagonal
+            Vector3 center = view * light->GetNode()->GetWorldPosition();
+            float extent = 0.58f * light->GetRange();
+            lightBox.Define(center + Vector3(extent, extent, extent), center - Vector3(extent, extent, extent));
+        }
+        else
+        {
+            // Calculate spot light pixel size from the projection of its frustum far vertices
+            Frustum lightFrustum = light->GetFrustum().Transformed(view);
+            lightBox.Define(&lightFrustum.vertices_[4], 4);
+        }
+        
+        Vector2 projectionSize = lightBox.Projected(projection).Size();
+        lightPixels = Max(0.5f * (float)viewWidth * projectionSize.x_, 0.5f * (float)viewHeight * projectionSize.y_);
+        
+        // Clamp pixel amount to a sufficient minimum to avoid self-shadowing artifacts due to loss of precision
+        if (lightPixels < SHADOW_MIN_PIXELS)
+            lightPixels = SHADOW_MIN_PIXELS;
+        
+        size = Min(size, lightPixels);
+    }
+    
+    /// \todo Allow to specify maximum shadow maps per resolution, as smaller shadow maps take less memory
+    int width = NextPowerOfTwo((unsigned)size);
+    int height = width;
+    
+    // Adjust the size for directional or point light shadow map atlases
+    if (type == LIGHT_DIRECTIONAL)
+    {
+        unsigned numSplits = light->GetNumShadowSplits();
+        if (numSplits > 1)
+            width *= 2;
+        if (numSplits > 2)
+            height *= 2;
+    }
+    else if (type == LIGHT_POINT)
+    {
+        width *= 2;
+        height *= 3;
+    }
+    
+    return IntVector2(width, height);
+}
+
+SharedPtr<Texture2D> Renderer::CreateShadowMap(int width, int height)
+{
+    int searchKey = (width << 16) | height;
+    unsigned shadowMapFormat = (shadowQuality_ & SHADOWQUALITY_LOW_24BIT) ? graphics_->GetHiresShadowMapFormat() :
+        graphics_->GetShadowMapFormat();
+    if (!shadowMapFormat)
+        return SharedPtr<Texture2D>();
+    
+    SharedPtr<Texture2D> newShadowMap(new Texture2D(context_));
+    int retries = 3;
+    unsigned dummyColorFormat = graphics_->GetDummyColorFormat();
+    
+    while (retries)
+    {
+        if (!newShadowMap->SetSize(width, height, shadowMapFormat, TEXTURE_DEPTHSTENCIL))
+        {
+            width >>= 1;
+            height >>= 1;
+            --retries;
+        }
+        else
+        {
+            #ifndef GL_ES_VERSION_2_0
+            // OpenGL (desktop) and D3D11: shadow compare mode needs to be specifically enabled for the shadow map
+            newShadowMap->SetFilterMode(FILTER_BILINEAR);
+            newShadowMap->SetShadowCompare(true);
+            #endif
+            #ifndef URHO3D_OPENGL
+            // Direct3D9: when shadow compare must be done manually, use nearest filtering so that the filtering of point lights
+            // and other shadowed lights matches
+            newShadowMap->SetFilterMode(graphics_->GetHardwareShadowSupport() ? FILTER_BILINEAR : FILTER_NEAREST);
+            #endif
+            // Create dummy color texture for the shadow map if necessary: Direct3D9, or OpenGL when working around an OS X +
+            // Intel driver bug
+            if (dummyColorFormat)
+            {
+                // If no dummy color rendertarget for this size exists yet, create one now
+                if (!colorShadowMaps_.Contains(searchKey))
+                {
+                    colorShadowMaps_[searchKey] = new Texture2D(context_);
+                    colorShadowMaps_[searchKey]->SetSize(width, height, dummyColorFormat, TEXTURE_RENDERTARGET);
+                }
+                // Link the color rendertarget to the shadow map
+                newShadowMap->GetRenderSurface()->SetLinkedRenderTarget(colorShadowMaps_[searchKey]->GetRenderSurface());
+            }
+            break;
+        }
+    }
+    
+    if (!retries)
+        newShadowMap.Reset();
+    
+    return newShadowMap;
+}
+
 void Renderer::PrepareViewRender()
 {
     ResetScreenBufferAllocations();
@@ -1403,6 +1839,13 @@ void Renderer::RemoveUnusedBuffers()
             screenBuffers_.Erase(current);
         }
     }
+    
+    for (HashMap<Light*, ShadowMapCache>::Iterator i = shadowMapCaches_.Begin(); i != shadowMapCaches_.End();)
+    {
+        HashMap<Light*, ShadowMapCache>::Iterator current = i++;
+        if (current->second_.light_.Expired() || frame_.frameNumber_ - current->second_.frameNumber_ > MAX_SHADOW_CACHE_FRAMES)
+            shadowMapCaches_.Erase(current);
+    }
 }
 
 void Renderer::ResetShadowMapAllocations()
@@ -1488,6 +1931,13 @@ void Renderer::LoadPassShaders(Pass* pass)
     Vector<SharedPtr<ShaderVariation> >& vertexShaders = pass->GetVertexShaders();
     Vector<SharedPtr<ShaderVariation> >& pixelShaders = pass->GetPixelShaders();
     
+    // Skinned geometry reads the matrices from the bone matrix texture if texture skinning is enabled
+    const char* geometryVariations[MAX_GEOMETRYTYPES];
+    for (unsigned i = 0; i < MAX_GEOMETRYTYPES; ++i)
+        geometryVariations[i] = geometryVSVariations[i];
+    if (textureSkinning_)
+        geometryVariations[GEOM_SKINNED] = "SKINNED SKINTEXTURE ";
+    
     // Forget all the old shaders
     vertexShaders.Clear();
     pixelShaders.Clear();
@@ -1504,7 +1954,7 @@ void Renderer::LoadPassShaders(Pass* pass)
             unsigned l = j % MAX_LIGHT_VS_VARIATIONS;
             
             vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(), pass->GetVertexShaderDefines() + " " +
-                lightVSVariations[l] + geometryVSVariations[g]);
+                lightVSVariations[l] + geometryVariations[g]);
         }
         for (unsigned j = 0; j < MAX_LIGHT_PS_VARIATIONS * 2; ++j)
         {
@@ -1532,7 +1982,7 @@ void Renderer::LoadPassShaders(Pass* pass)
                 unsigned g = j / MAX_VERTEXLIGHT_VS_VARIATIONS;
                 unsigned l = j % MAX_VERTEXLIGHT_VS_VARIATIONS;
                 vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(), pass->GetVertexShaderDefines() + " " +
-                    vertexLightVSVariations[l] + geometryVSVariations[g]);
+                    vertexLightVSVariations[l] + geometryVariations[g]);
             }
         }
         else
@@ -1541,15 +1991,17 @@ void Renderer::LoadPassShaders(Pass* pass)
             for (unsigned j = 0; j < MAX_GEOMETRYTYPES; ++j)
             {
                 vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(), pass->GetVertexShaderDefines() + " " +
-                    geometryVSVariations[j]);
+                    geometryVariations[j]);
             }
         }
         
-        pixelShaders.Resize(2);
-        for (unsigned j = 0; j < 2; ++j)
+        // Vertex lit passes also have the clustered forward lighting variations
+        unsigned numPixelShaders = pass->GetLightingMode() == LIGHTING_PERVERTEX ? 4 : 2;
+        pixelShaders.Resize(numPixelShaders);
+        for (unsigned j = 0; j < numPixelShaders; ++j)
         {
             pixelShaders[j] = graphics_->GetShader(PS, pass->GetPixelShader(), pass->GetPixelShaderDefines() + " " +
-                heightFogVariations[j]);
+                heightFogVariations[j & 1] + clusteredVariations[j >> 1]);
         }
     }
     
@@ -1628,6 +2080,17 @@ void Renderer::CreateGeometries()
     pointLightGeometry_->SetIndexBuffer(plib);
     pointLightGeometry_->SetDrawRange(TRIANGLE_LIST, 0, plib->GetIndexCount());
     
+    // The box has the same vertex order as the spot light volume, so its index data can be shared
+    SharedPtr<VertexBuffer> bvb(new VertexBuffer(context_));
+    bvb->SetShadowed(true);
+    bvb->SetSize(8, MASK_POSITION);
+    bvb->SetData(boxVertexData);
+    
+    boxGeometry_ = new Geometry(context_);
+    boxGeometry_->SetVertexBuffer(0, bvb);
+    boxGeometry_->SetIndexBuffer(slib);
+    boxGeometry_->SetDrawRange(TRIANGLE_LIST, 0, slib->GetIndexCount());
+    
     #if !defined(URHO3D_OPENGL) || !defined(GL_ES_VERSION_2_0)
     if (graphics_->GetShadowMapFormat())
     {
@@ -1716,7 +2179,10 @@ void Renderer::ResetShadowMaps()
 {
     shadowMaps_.Clear();
     shadowMapAllocations_.Clear();
+    shadowMapCaches_.Clear();
     colorShadowMaps_.Clear();
+    shadowAtlas_.Reset();
+    shadowAtlasDirty_ = true;
 }
 
 void Renderer::ResetBuffers()
@@ -1726,6 +2192,34 @@ void Renderer::ResetBuffers()
     screenBufferAllocations_.Clear();
 }
 
+void Renderer::UpdateDynamicResolution(float timeStep)
+{
+    // Prefer the GPU time of the top level profiling blocks, which is read back a few frames late. Without GPU profiling
+    // fall back to the whole frame time, which is only meaningful when GPU bound
+    float frameTime = timeStep * 1000.0f;
+    if (graphics_->GetGPUProfiling())
+    {
+        float gpuTime = 0.0f;
+        const Vector<GPUProfileBlock>& blocks = graphics_->GetGPUProfileResults();
+        for (unsigned i = 0; i < blocks.Size(); ++i)
+        {
+            if (!blocks[i].depth_)
+                gpuTime += blocks[i].time_;
+        }
+        if (gpuTime > 0.0f)
+            frameTime = gpuTime;
+    }
+    
+    // Leave a dead band around the target to avoid oscillation. Fill cost scales with the pixel count, so the scale changes
+    // by the square root of the time ratio, limited per frame and quantized to avoid reallocating screen buffers constantly
+    if (frameTime > dynamicResolutionTarget_ * 1.05f || frameTime < dynamicResolutionTarget_ * 0.85f)
+    {
+        float desiredScale = resolutionScale_ * sqrtf(dynamicResolutionTarget_ / Max(frameTime, M_EPSILON));
+        desiredScale = Clamp(desiredScale, resolutionScale_ - 0.05f, resolutionScale_ + 0.05f);
+        resolutionScale_ = Clamp(floorf(desiredScale * 20.0f + 0.5f) / 20.0f, minResolutionScale_, 1.0f);
+    }
+}
+
 void Renderer::HandleScreenMode(StringHash eventType, VariantMap& eventData)
 {
     if (!initialized_)
@@ -26,7 +26,10 @@
 #include "../Math/Color.h"
 #include "../Graphics/Drawable.h"
 #include "../Container/HashSet.h"
+#include "../Graphics/Light.h"
 #include "../Core/Mutex.h"
+#include "../Math/Sphere.h"
+#include "../Graphics/Texture2D.h"
 #include "../Graphics/Viewport.h"
 
 namespace Urho3D
@@ -43,16 +46,32 @@ class Graphics;
 class RenderPath;
 class RenderSurface;
 class ResourceCache;
+class ShaderPrecache;
 class Skeleton;
 class OcclusionBuffer;
 class Texture;
 class Texture2D;
 class TextureCube;
+class TextureStreamer;
 class View;
 class Zone;
 
 static const int SHADOW_MIN_PIXELS = 64;
 static const int INSTANCING_BUFFER_DEFAULT_SIZE = 1024;
+/// Light cluster grid dimensions. Must match the clustered lighting shader code.
+static const int NUM_CLUSTERS_X = 16;
+static const int NUM_CLUSTERS_Y = 8;
+static const int NUM_CLUSTERS_Z = 24;
+static const int NUM_CLUSTERS = NUM_CLUSTERS_X * NUM_CLUSTERS_Y * NUM_CLUSTERS_Z;
+/// Maximum lights per view in the light cluster texture.
+static const unsigned MAX_CLUSTER_LIGHTS = 256;
+/// Maximum lights referenced by a single cluster.
+static const unsigned MAX_LIGHTS_PER_CLUSTER = 32;
+/// Light cluster texture layout: row 0 holds the light data, rows 1-3 the grid and the rest the light index lists.
+static const int LIGHT_CLUSTER_TEXTURE_WIDTH = 1024;
+static const int LIGHT_CLUSTER_TEXTURE_HEIGHT = 16;
+static const int LIGHT_CLUSTER_GRID_ROW = 1;
+static const int LIGHT_CLUSTER_INDEX_ROW = LIGHT_CLUSTER_GRID_ROW + NUM_CLUSTERS / LIGHT_CLUSTER_TEXTURE_WIDTH;
 
 /// Light vertex shader variations.
 enum LightVSVariation
@@ -147,6 +166,56 @@ enum DeferredLightPSVariation
     MAX_DEFERRED_LIGHT_PS_VARIATIONS
 };
 
+/// Shadow map of a light's static shadow casters, kept across frames.
+struct ShadowMapCache
+{
+    /// Construct.
+    ShadowMapCache() :
+        numSplits_(0),
+        frameNumber_(0),
+        valid_(false)
+    {
+    }
+    
+    /// Light.
+    WeakPtr<Light> light_;
+    /// Shadow map containing the static shadow caster depth.
+    SharedPtr<Texture2D> shadowMap_;
+    /// Static shadow casters rendered into the shadow map.
+    PODVector<Drawable*> shadowCasters_;
+    /// Static shadow caster end indices per split.
+    unsigned shadowCasterEnd_[MAX_LIGHT_SPLITS];
+    /// Shadow camera view matrices per split.
+    Matrix3x4 shadowViews_[MAX_LIGHT_SPLITS];
+    /// Shadow camera projection matrices per split.
+    Matrix4 shadowProjections_[MAX_LIGHT_SPLITS];
+    /// Depth bias used for rendering.
+    BiasParameters shadowBias_;
+    /// Shadow map size the shadow map was requested with.
+    IntVector2 shadowMapSize_;
+    /// Shadow split count.
+    unsigned numSplits_;
+    /// Frame number on which the cache was last used.
+    unsigned frameNumber_;
+    /// Shadow map contents up to date flag.
+    bool valid_;
+};
+
+/// Octree query result shared by the views of a cull group during one frame.
+struct SharedCullResult
+{
+    /// Octree.
+    Octree* octree_;
+    /// Cull group.
+    unsigned group_;
+    /// Camera view mask.
+    unsigned viewMask_;
+    /// Query volume enclosing the view frustums.
+    Sphere sphere_;
+    /// Zones, lights and geometries inside the query volume.
+    PODVector<Drawable*> drawables_;
+};
+
 /// High-level rendering subsystem. Manages drawing of 3D views.
 class URHO3D_API Renderer : public Object
 {
@@ -188,8 +257,14 @@ public:
     void SetReuseShadowMaps(bool enable);
     /// Set maximum number of shadow maps created for one resolution. Only has effect if reuse of shadow maps is disabled.
     void SetMaxShadowMaps(int shadowMaps);
+    /// Set caching of static shadow caster depth for shadowed point and spot lights. Default false.
+    void SetShadowCache(bool enable);
+    /// Set shadow atlas texture size. When nonzero, the shadow maps of shadowed lights are packed into one atlas texture of this size, with their resolution reduced as necessary to fit. Default 0 (disabled.)
+    void SetShadowAtlasSize(int size);
     /// Set dynamic instancing on/off.
     void SetDynamicInstancing(bool enable);
+    /// Set indirect drawing of instanced groups that share render state and buffers on/off. Has effect only if supported by the hardware.
+    void SetIndirectDraw(bool enable);
     /// Set minimum number of instances required in a batch group to render as instanced.
     void SetMinInstances(int instances);
     /// Set maximum number of sorted instances per batch group. If exceeded, instances are rendered unsorted.
@@ -200,12 +275,32 @@ public:
     void SetOcclusionBufferSize(int size);
     /// Set required screen size (1.0 = full screen) for occluders.
     void SetOccluderSizeThreshold(float screenSize);
+    /// Set whether to reproject the previous frame's occlusion depth of each camera into the occlusion buffer before rendering occluders.
+    void SetTemporalOcclusion(bool enable);
+    /// Set whether to cull drawables that request it by hardware occlusion queries of their bounding boxes. The results are used on later frames, so visibility lags by one or more frames.
+    void SetGPUOcclusion(bool enable);
+    /// Set whether to read skinning matrices from a per-frame bone matrix texture instead of shader constants. This removes the per-geometry bone limit of the constants. Requires OpenGL 3 or Direct3D11.
+    void SetTextureSkinning(bool enable);
+    /// Set mip level streaming of compressed file textures on/off. Only affects textures loaded afterward, so should be enabled before loading resources.
+    void SetTextureStreaming(bool enable);
+    /// Set whether models release their CPU-side vertex and index data after uploading it to the GPU, and re-read it from the resource file on demand. Only affects models loaded afterward.
+    void SetReleaseModelCPUData(bool enable) { releaseModelCPUData_ = enable; }
+    /// Set resolution scale of the backbuffer views. The scene is rendered at the scaled size and upscaled to the viewport. Default 1.
+    void SetResolutionScale(float scale);
+    /// Set whether to adjust the resolution scale automatically to reach the target frame time.
+    void SetDynamicResolution(bool enable);
+    /// Set target frame time in milliseconds for dynamic resolution. Default 16.7.
+    void SetDynamicResolutionTarget(float frameTime);
+    /// Set minimum resolution scale for dynamic resolution. Default 0.5.
+    void SetMinResolutionScale(float scale);
     /// Set shadow depth bias multiplier for mobile platforms (OpenGL ES.) No effect on desktops. Default 2.
     void SetMobileShadowBiasMul(float mul);
     /// Set shadow depth bias addition for mobile platforms (OpenGL ES.)  No effect on desktops. Default 0.0001.
     void SetMobileShadowBiasAdd(float add);
     /// Force reload of shaders.
     void ReloadShaders();
+    /// Capture the next frame of the first backbuffer view into a file, which the FrameReplay tool can render without the original scene.
+    void CaptureFrame(const String& fileName);
     
     /// Return number of backbuffer viewports.
     unsigned GetNumViewports() const { return viewports_.Size(); }
@@ -235,8 +330,14 @@ public:
     bool GetReuseShadowMaps() const { return reuseShadowMaps_; }
     /// Return maximum number of shadow maps per resolution.
     int GetMaxShadowMaps() const { return maxShadowMaps_; }
+    /// Return whether static shadow caster depth is cached.
+    bool GetShadowCache() const { return shadowCache_; }
+    /// Return shadow atlas texture size, or 0 if disabled.
+    int GetShadowAtlasSize() const { return shadowAtlasSize_; }
     /// Return whether dynamic instancing is in use.
     bool GetDynamicInstancing() const { return dynamicInstancing_; }
+    /// Return whether indirect drawing of instanced groups is enabled.
+    bool GetIndirectDraw() const { return indirectDraw_; }
     /// Return minimum number of instances required in a batch group to render as instanced.
     int GetMinInstances() const { return minInstances_; }
     /// Return maximum number of sorted instances per batch group.
@@ -247,6 +348,26 @@ public:
     int GetOcclusionBufferSize() const { return occlusionBufferSize_; }
     /// Return occluder screen size threshold.
     float GetOccluderSizeThreshold() const { return occluderSizeThreshold_; }
+    /// Return whether previous frame occlusion depth is reprojected.
+    bool GetTemporalOcclusion() const { return temporalOcclusion_; }
+    /// Return whether hardware occlusion queries are used.
+    bool GetGPUOcclusion() const { return gpuOcclusion_; }
+    /// Return whether skinning matrices are read from the bone matrix texture.
+    bool GetTextureSkinning() const { return textureSkinning_; }
+    /// Return whether texture mip level streaming is enabled.
+    bool GetTextureStreaming() const { return textureStreamer_.NotNull(); }
+    /// Return the texture streamer, or null if texture streaming is disabled.
+    TextureStreamer* GetTextureStreamer() const { return textureStreamer_; }
+    /// Return whether models release their CPU-side vertex and index data after upload.
+    bool GetReleaseModelCPUData() const { return releaseModelCPUData_; }
+    /// Return resolution scale of the backbuffer views.
+    float GetResolutionScale() const { return resolutionScale_; }
+    /// Return whether dynamic resolution is enabled.
+    bool GetDynamicResolution() const { return dynamicResolution_; }
+    /// Return target frame time in milliseconds for dynamic resolution.
+    float GetDynamicResolutionTarget() const { return dynamicResolutionTarget_; }
+    /// Return minimum resolution scale for dynamic resolution.
+    float GetMinResolutionScale() const { return minResolutionScale_; }
     /// Return shadow depth bias multiplier for mobile platforms.
     float GetMobileShadowBiasMul() const { return mobileShadowBiasMul_; }
     /// Return shadow depth bias addition for mobile platforms.
@@ -257,6 +378,12 @@ public:
     unsigned GetNumPrimitives() const { return numPrimitives_; }
     /// Return number of batches rendered.
     unsigned GetNumBatches() const { return numBatches_; }
+    /// Return number of render state changes, binds and shader parameter updates sent to the GPU.
+    unsigned GetNumStateChanges() const { return numStateChanges_; }
+    /// Return number of redundant render state changes, binds and shader parameter updates avoided.
+    unsigned GetNumAvoidedStateChanges() const { return numAvoidedStateChanges_; }
+    /// Return number of shader parameter bytes uploaded.
+    unsigned GetNumParameterBytes() const { return numParameterBytes_; }
     /// Return number of geometries rendered.
     unsigned GetNumGeometries(bool allViews = false) const;
     /// Return number of lights rendered.
@@ -277,10 +404,16 @@ public:
     TextureCube* GetFaceSelectCubeMap() const { return faceSelectCubeMap_; }
     /// Return the shadowed pointlight indirection cube map.
     TextureCube* GetIndirectionCubeMap() const { return indirectionCubeMap_; }
+    /// Return the bone matrix texture.
+    Texture2D* GetSkinMatrixTexture() const { return skinMatrixTexture_; }
+    /// Return the light cluster texture for clustered forward lighting.
+    Texture2D* GetLightClusterTexture() const { return lightClusterTexture_; }
     /// Return the instancing vertex buffer
     VertexBuffer* GetInstancingBuffer() const { return dynamicInstancing_ ? instancingBuffer_ : (VertexBuffer*)0; }
     /// Return the frame update parameters.
     const FrameInfo& GetFrameInfo() const { return frame_; }
+    /// Return whether a frame capture has been requested.
+    bool IsFrameCapturePending() const { return !captureFileName_.Empty(); }
     
     /// Update for rendering. Called by HandleRenderUpdate().
     void Update(float timeStep);
@@ -297,22 +430,44 @@ public:
     Geometry* GetLightGeometry(Light* light);
     /// Return quad geometry used in postprocessing.
     Geometry* GetQuadGeometry();
+    /// Return unit box geometry used in occlusion queries.
+    Geometry* GetBoxGeometry() { return boxGeometry_; }
     /// Allocate a shadow map. If shadow map reuse is disabled, a different map is returned each time.
     Texture2D* GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight);
+    /// Return the static shadow caster cache of a light, allocating or resizing its shadow map to the size a shadow map from GetShadowMap() would have. Return null if the shadow map can not be created.
+    ShadowMapCache* GetShadowMapCache(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight);
+    /// Return the shadow atlas texture, creating it if necessary. Return null if the shadow atlas is disabled or can not be created.
+    Texture2D* GetShadowAtlas();
+    /// Calculate shadow map dimensions for a light.
+    IntVector2 CalculateShadowMapSize(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight) const;
     /// Allocate a rendertarget or depth-stencil texture for deferred rendering or postprocessing. Should only be called during actual rendering, not before.
     Texture* GetScreenBuffer(int width, int height, unsigned format, bool cubemap, bool filtered, bool srgb, unsigned persistentKey = 0);
     /// Allocate a depth-stencil surface that does not need to be readable. Should only be called during actual rendering, not before.
     RenderSurface* GetDepthStencil(int width, int height);
     /// Allocate an occlusion buffer.
     OcclusionBuffer* GetOcclusionBuffer(Camera* camera);
+    /// Return the octree query result shared by the views of a cull group on the current frame. The query volume is undefined when the group's first view asks for it. Called by View.
+    SharedCullResult& GetSharedCullResult(Octree* octree, unsigned group, unsigned viewMask);
     /// Allocate a temporary shadow camera and a scene node for it. Is thread-safe.
     Camera* GetShadowCamera();
-    /// Choose shaders for a forward rendering batch.
+    /// Return whether the shaders of a pass are loaded and up to date. If not, SetBatchShaders() for the pass must be called from the main thread, as it loads the shaders.
+    bool GetPassShadersLoaded(Pass* pass) const;
+    /// Choose shaders for a forward rendering batch. Can be called from worker threads for passes with loaded shaders.
     void SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows = true);
+    /// Store the shader combinations a pass can be rendered with into a shader precache, according to the current settings. Geometry and light types are bitmasks of (1 << GeometryType) and (1 << LightType), specular tells whether specular lighting of the pass can occur at all.
+    void StorePassShaders(Pass* pass, ShaderPrecache* precache, unsigned geometryTypes = M_MAX_UNSIGNED, unsigned lightTypes = M_MAX_UNSIGNED, bool specular = true);
     /// Choose shaders for a deferred light volume batch.
     void SetLightVolumeBatchShaders(Batch& batch, const String& vsName, const String& psName, const String& vsDefines, const String& psDefines);
+    /// Save the requested frame capture of a rendered view. Called by View.
+    void SaveFrameCapture(View* view);
     /// Set cull mode while taking possible projection flipping into account.
     void SetCullMode(CullMode mode, Camera* camera);
+    /// Return the index of the first of a set of skinning matrices in the bone matrix texture, adding them for the current frame if not added yet. Called by View and Batch.
+    unsigned GetSkinMatrixOffset(const Matrix3x4* matrices, unsigned num);
+    /// Upload the skinning matrices added since the last upload to the bone matrix texture. Called by View and Batch.
+    void UpdateSkinMatrixTexture();
+    /// Upload rows of light cluster data, creating the light cluster texture if necessary. Called by View.
+    bool UpdateLightClusterTexture(const Vector4* data, int numRows);
     /// Ensure sufficient size of the instancing vertex buffer. Return true if successful.
     bool ResizeInstancingBuffer(unsigned numInstances);
     /// Save the screen buffer allocation status. Called by View.
@@ -343,9 +498,11 @@ private:
     void CreateInstancingBuffer();
     /// Create point light shadow indirection texture data.
     void SetIndirectionTextureData();
+    /// Create a shadow map texture. The size is reduced if creation fails at full size. Return null on failure.
+    SharedPtr<Texture2D> CreateShadowMap(int width, int height);
     /// Prepare for rendering of a new view.
     void PrepareViewRender();
-    /// Remove unused occlusion and screen buffers.
+    /// Remove unused occlusion and screen buffers, and shadow map caches of lights not rendered recently.
     void RemoveUnusedBuffers();
     /// Reset shadow map allocation counts.
     void ResetShadowMapAllocations();
@@ -355,6 +512,8 @@ private:
     void ResetShadowMaps();
     /// Remove all occlusion and screen buffers.
     void ResetBuffers();
+    /// Adjust the resolution scale toward the dynamic resolution target frame time.
+    void UpdateDynamicResolution(float timeStep);
     /// Handle screen mode event.
     void HandleScreenMode(StringHash eventType, VariantMap& eventData);
     /// Handle render update event.
@@ -364,16 +523,30 @@ private:
     WeakPtr<Graphics> graphics_;
     /// Default renderpath.
     SharedPtr<RenderPath> defaultRenderPath_;
+    /// Texture mip level streamer.
+    SharedPtr<TextureStreamer> textureStreamer_;
     /// Default zone.
     SharedPtr<Zone> defaultZone_;
+    /// Requested frame capture file name.
+    String captureFileName_;
     /// Directional light quad geometry.
     SharedPtr<Geometry> dirLightGeometry_;
     /// Spot light volume geometry.
     SharedPtr<Geometry> spotLightGeometry_;
     /// Point light volume geometry.
     SharedPtr<Geometry> pointLightGeometry_;
+    /// Unit box geometry.
+    SharedPtr<Geometry> boxGeometry_;
     /// Instance stream vertex buffer.
     SharedPtr<VertexBuffer> instancingBuffer_;
+    /// Bone matrix texture for texture skinning.
+    SharedPtr<Texture2D> skinMatrixTexture_;
+    /// Light cluster texture for clustered forward lighting.
+    SharedPtr<Texture2D> lightClusterTexture_;
+    /// Skinning matrices of the current frame, padded to full texture rows.
+    PODVector<Matrix3x4> skinMatrices_;
+    /// Offsets of the current frame's skinning matrix sets in the bone matrix texture.
+    HashMap<const Matrix3x4*, unsigned> skinMatrixOffsets_;
     /// Default material.
     SharedPtr<Material> defaultMaterial_;
     /// Default range attenuation texture.
@@ -388,12 +561,18 @@ private:
     Vector<SharedPtr<Node> > shadowCameraNodes_;
     /// Reusable occlusion buffers.
     Vector<SharedPtr<OcclusionBuffer> > occlusionBuffers_;
+    /// Octree query results of cull groups.
+    Vector<SharedCullResult> sharedCullResults_;
     /// Shadow maps by resolution.
     HashMap<int, Vector<SharedPtr<Texture2D> > > shadowMaps_;
     /// Shadow map dummy color buffers by resolution.
     HashMap<int, SharedPtr<Texture2D> > colorShadowMaps_;
+    /// Shadow atlas texture.
+    SharedPtr<Texture2D> shadowAtlas_;
     /// Shadow map allocations by resolution.
     HashMap<int, PODVector<Light*> > shadowMapAllocations_;
+    /// Static shadow caster caches by light.
+    HashMap<Light*, ShadowMapCache> shadowMapCaches_;
     /// Screen buffers by resolution and format.
     HashMap<long long, Vector<SharedPtr<Texture> > > screenBuffers_;
     /// Current screen buffer allocations by resolution and format.
@@ -412,7 +591,7 @@ private:
     HashSet<Octree*> updatedOctrees_;
     /// Techniques for which missing shader error has been displayed.
     HashSet<Technique*> shaderErrorDisplayed_;
-    /// Mutex for shadow camera allocation.
+    /// Mutex for shadow camera allocation and shader error logging.
     Mutex rendererMutex_;
     /// Current variation names for deferred light volume shaders.
     Vector<String> deferredLightPSVariations_;
@@ -428,6 +607,8 @@ private:
     int materialQuality_;
     /// Shadow map resolution.
     int shadowMapSize_;
+    /// Shadow atlas size.
+    int shadowAtlasSize_;
     /// Shadow quality.
     int shadowQuality_;
     /// Maximum number of shadow maps per resolution.
@@ -446,16 +627,34 @@ private:
     float mobileShadowBiasMul_;
     /// Mobile platform shadow depth bias addition.
     float mobileShadowBiasAdd_;
+    /// Backbuffer view resolution scale.
+    float resolutionScale_;
+    /// Dynamic resolution target frame time in milliseconds.
+    float dynamicResolutionTarget_;
+    /// Dynamic resolution minimum scale.
+    float minResolutionScale_;
     /// Number of occlusion buffers in use.
     unsigned numOcclusionBuffers_;
+    /// Number of cull group octree query results in use.
+    unsigned numSharedCullResults_;
     /// Number of temporary shadow cameras in use.
     unsigned numShadowCameras_;
     /// Number of primitives (3D geometry only.)
     unsigned numPrimitives_;
     /// Number of batches (3D geometry only.)
     unsigned numBatches_;
+    /// Number of render state changes (3D geometry only.)
+    unsigned numStateChanges_;
+    /// Number of avoided render state changes (3D geometry only.)
+    unsigned numAvoidedStateChanges_;
+    /// Number of shader parameter bytes uploaded (3D geometry only.)
+    unsigned numParameterBytes_;
     /// Frame number on which shaders last changed.
     unsigned shadersChangedFrameNumber_;
+    /// Number of skinning matrices added on the current frame.
+    unsigned numSkinMatrices_;
+    /// Number of skinning matrices uploaded to the bone matrix texture on the current frame.
+    unsigned numUploadedSkinMatrices_;
     /// Current stencil value for light optimization.
     unsigned char lightStencilValue_;
     /// HDR rendering flag.
@@ -466,8 +665,24 @@ private:
     bool drawShadows_;
     /// Shadow map reuse flag.
     bool reuseShadowMaps_;
+    /// Static shadow caster cache flag.
+    bool shadowCache_;
+    /// Shadow atlas needs to be (re)created flag.
+    bool shadowAtlasDirty_;
     /// Dynamic instancing flag.
     bool dynamicInstancing_;
+    /// Indirect draw flag.
+    bool indirectDraw_;
+    /// Temporal occlusion flag.
+    bool temporalOcclusion_;
+    /// Dynamic resolution flag.
+    bool dynamicResolution_;
+    /// Hardware occlusion query flag.
+    bool gpuOcclusion_;
+    /// Texture skinning flag.
+    bool textureSkinning_;
+    /// Release model CPU-side data flag.
+    bool releaseModelCPUData_;
     /// Shaders need reloading flag.
     bool shadersDirty_;
     /// Initialized flag.
@@ -23,10 +23,15 @@
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
 #include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Graphics/Shader.h"
 #include "../Graphics/ShaderPrecache.h"
 #include "../Graphics/ShaderVariation.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
 
 #include "../DebugNew.h"
 
@@ -109,8 +114,22 @@ void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
     XMLFile xmlFile(graphics->GetContext());
     xmlFile.Load(source);
     
+    // Preprocess the shader sources in the background loading thread first
+    ResourceCache* cache = graphics->GetSubsystem<ResourceCache>();
+    HashSet<String> shaderNames;
     XMLElement shader = xmlFile.GetRoot().GetChild("shader");
     while (shader)
+    {
+        shaderNames.Insert(shader.GetAttribute("vs"));
+        shaderNames.Insert(shader.GetAttribute("ps"));
+        shader = shader.GetNext("shader");
+    }
+    for (HashSet<String>::ConstIterator i = shaderNames.Begin(); i != shaderNames.End(); ++i)
+        cache->BackgroundLoadResource<Shader>(graphics->GetShaderPath() + *i + graphics->GetShaderExtension());
+    
+    PODVector<Pair<ShaderVariation*, ShaderVariation*> > combinations;
+    shader = xmlFile.GetRoot().GetChild("shader");
+    while (shader)
     {
         String vsDefines = shader.GetAttribute("vsdefines");
         String psDefines = shader.GetAttribute("psdefines");
@@ -124,14 +143,63 @@ void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
         }
         #endif
         
+        // Getting the variations waits for the shader sources to finish loading
         ShaderVariation* vs = graphics->GetShader(VS, shader.GetAttribute("vs"), vsDefines);
         ShaderVariation* ps = graphics->GetShader(PS, shader.GetAttribute("ps"), psDefines);
-        // Set the shaders active to actually compile them
-        graphics->SetShaders(vs, ps);
+        if (vs && ps)
+        {
+            combinations.Push(MakePair(vs, ps));
+            
+            // On Direct3D compile the bytecode in worker threads, all combinations at once
+            #ifndef URHO3D_OPENGL
+            if (!vs->GetGPUObject() && vs->GetCompilerOutput().Empty())
+                vs->CreateAsync();
+            if (!ps->GetGPUObject() && ps->GetCompilerOutput().Empty())
+                ps->CreateAsync();
+            #endif
+        }
         
         shader = shader.GetNext("shader");
     }
     
+    #ifndef URHO3D_OPENGL
+    WorkQueue* queue = graphics->GetSubsystem<WorkQueue>();
+    #endif
+    
+    for (unsigned i = 0; i < combinations.Size(); ++i)
+    {
+        ShaderVariation* vs = combinations[i].first_;
+        ShaderVariation* ps = combinations[i].second_;
+        
+        #ifndef URHO3D_OPENGL
+        // Wait for the combination to compile. The GPU objects are created here in the main thread
+        while (vs->IsCompiling() || ps->IsCompiling())
+        {
+            // Without worker threads the low priority compile work would only run at the beginning of the next frame
+            if (!queue->GetNumThreads())
+                queue->Complete(0);
+            else
+                Time::Sleep(1);
+            
+            if (vs->IsCompiling())
+                vs->CreateAsync();
+            if (ps->IsCompiling())
+                ps->CreateAsync();
+        }
+        #endif
+        
+        // Set the shaders active to actually compile and link them
+        graphics->SetShaders(vs, ps);
+        
+        using namespace ShaderPrecacheProgress;
+        
+        VariantMap& eventData = graphics->GetEventDataMap();
+        eventData[P_PROGRESS] = (float)(i + 1) / (float)combinations.Size();
+        eventData[P_LOADEDCOMBINATIONS] = (int)(i + 1);
+        eventData[P_TOTALCOMBINATIONS] = (int)combinations.Size();
+        graphics->SendEvent(E_SHADERPRECACHEPROGRESS, eventData);
+    }
+    
     LOGDEBUG("End precaching shaders");
 }
 
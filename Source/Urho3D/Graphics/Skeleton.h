@@ -47,7 +47,8 @@ struct Bone
         initialScale_(Vector3::ONE),
         animated_(true),
         collisionMask_(0),
-        radius_(0.0f)
+        radius_(0.0f),
+        animationLodDistance_(0.0f)
     {
     }
     
@@ -73,6 +74,8 @@ struct Bone
     float radius_;
     /// Local-space bounding box.
     BoundingBox boundingBox_;
+    /// Animation LOD distance beyond which the bone is left in its initial pose. 0 to always animate.
+    float animationLodDistance_;
     /// Scene node.
     WeakPtr<Node> node_;
 };
@@ -62,6 +62,7 @@ void StaticModel::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Material", GetMaterialsAttr, SetMaterialsAttr, ResourceRefList, ResourceRefList(Material::GetTypeStatic()), AM_DEFAULT);
     ATTRIBUTE("Is Occluder", bool, occluder_, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
+    ATTRIBUTE("Occlusion Query", bool, occlusionQuery_, false, AM_DEFAULT);
     ATTRIBUTE("Cast Shadows", bool, castShadows_, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
@@ -88,7 +89,8 @@ void StaticModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQuer
         Vector3 normal = -query.ray_.direction_;
         unsigned hitBatch = M_MAX_UNSIGNED;
 
-        if (level == RAY_TRIANGLE && distance < query.maxDistance_)
+        // If the model's CPU-side data has been released, the hit on the oriented bounding box is returned instead
+        if (level == RAY_TRIANGLE && distance < query.maxDistance_ && (!model_ || model_->HasCPUData()))
         {
             distance = M_INFINITY;
 
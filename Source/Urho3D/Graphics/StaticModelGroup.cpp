@@ -24,9 +24,12 @@
 #include "../Graphics/Camera.h"
 #include "../Core/Context.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/ImpostorSet.h"
+#include "../IO/Log.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/OcclusionBuffer.h"
 #include "../Graphics/OctreeQuery.h"
+#include "../Resource/ResourceCache.h"
 #include "../Scene/Scene.h"
 #include "../Graphics/StaticModelGroup.h"
 
@@ -37,8 +40,41 @@ namespace Urho3D
 
 extern const char* GEOMETRY_CATEGORY;
 
+static const float DEFAULT_IMPOSTOR_FADE_RANGE = 10.0f;
+static const unsigned DEFAULT_IMPOSTOR_FRAMES = 8;
+static const unsigned MAX_IMPOSTOR_FRAMES = 64;
+
+/// Choose the LOD level of a geometry for a LOD distance the same way as StaticModel.
+static unsigned GetLodLevel(const Vector<SharedPtr<Geometry> >& batchGeometries, float lodDistance)
+{
+    unsigned j;
+    
+    for (j = 1; j < batchGeometries.Size(); ++j)
+    {
+        if (batchGeometries[j] && lodDistance <= batchGeometries[j]->GetLodDistance())
+            break;
+    }
+    
+    return j - 1;
+}
+
+StaticModelGroupView::StaticModelGroupView() :
+    camera_(0),
+    occlusionBuffer_(0),
+    frameNumber_(M_MAX_UNSIGNED)
+{
+}
+
+StaticModelGroupView::~StaticModelGroupView()
+{
+}
+
 StaticModelGroup::StaticModelGroup(Context* context) :
     StaticModel(context),
+    lastView_(0),
+    impostorDistance_(0.0f),
+    impostorFadeRange_(DEFAULT_IMPOSTOR_FADE_RANGE),
+    impostorFrames_(DEFAULT_IMPOSTOR_FRAMES),
     nodeIDsDirty_(false)
 {
     // Initialize the default node IDs attribute
@@ -55,6 +91,10 @@ void StaticModelGroup::RegisterObject(Context* context)
 
     COPY_BASE_ATTRIBUTES(StaticModel);
     ACCESSOR_ATTRIBUTE("Instance Nodes", GetNodeIDsAttr, SetNodeIDsAttr, VariantVector, Variant::emptyVariantVector, AM_DEFAULT | AM_NODEIDVECTOR);
+    ACCESSOR_ATTRIBUTE("Impostor Distance", GetImpostorDistance, SetImpostorDistance, float, 0.0f, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Impostor Fade Range", GetImpostorFadeRange, SetImpostorFadeRange, float, DEFAULT_IMPOSTOR_FADE_RANGE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Impostor Frames", GetImpostorFrames, SetImpostorFrames, unsigned, DEFAULT_IMPOSTOR_FRAMES, AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Impostor Material", GetImpostorMaterialAttr, SetImpostorMaterialAttr, ResourceRef, ResourceRef(Material::GetTypeStatic()), AM_DEFAULT);
 }
 
 void StaticModelGroup::ApplyAttributes()
@@ -91,6 +131,7 @@ void StaticModelGroup::ApplyAttributes()
     }
     
     worldTransforms_.Resize(instanceNodes_.Size());
+    nearTransforms_.Resize(instanceNodes_.Size());
     nodeIDsDirty_ = false;
     OnMarkedDirty(GetNode());
 }
@@ -165,20 +206,36 @@ void StaticModelGroup::UpdateBatches(const FrameInfo& frame)
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
     distance_ = frame.camera_->GetDistance(worldBoundingBox.Center());
     
+    const Matrix3x4* transforms = numWorldTransforms_ ? &worldTransforms_[0] : &Matrix3x4::IDENTITY;
+    unsigned numTransforms = numWorldTransforms_;
+    
+    // Leave out the instances that are drawn as impostors. The impostor set uses the same distance test
+    if (impostorDistance_ > 0.0f && impostorMaterial_ && impostorSet_ && numWorldTransforms_)
+    {
+        Vector3 center = boundingBox_.Center();
+        numTransforms = 0;
+        for (unsigned i = 0; i < numWorldTransforms_; ++i)
+        {
+            if (frame.camera_->GetDistance(worldTransforms_[i] * center) < impostorDistance_)
+                nearTransforms_[numTransforms++] = worldTransforms_[i];
+        }
+        transforms = numTransforms ? &nearTransforms_[0] : &Matrix3x4::IDENTITY;
+    }
+    
     if (batches_.Size() > 1)
     {
         for (unsigned i = 0; i < batches_.Size(); ++i)
         {
             batches_[i].distance_ = frame.camera_->GetDistance(worldTransform * geometryData_[i].center_);
-            batches_[i].worldTransform_ = numWorldTransforms_ ? &worldTransforms_[0] : &Matrix3x4::IDENTITY;
-            batches_[i].numWorldTransforms_ = numWorldTransforms_;
+            batches_[i].worldTransform_ = transforms;
+            batches_[i].numWorldTransforms_ = numTransforms;
         }
     }
     else if (batches_.Size() == 1)
     {
         batches_[0].distance_ = distance_;
-        batches_[0].worldTransform_ = numWorldTransforms_ ? &worldTransforms_[0] : &Matrix3x4::IDENTITY;
-        batches_[0].numWorldTransforms_ = numWorldTransforms_;
+        batches_[0].worldTransform_ = transforms;
+        batches_[0].numWorldTransforms_ = numTransforms;
     }
     
     float scale = worldBoundingBox.Size().DotProduct(DOT_SCALE);
@@ -189,6 +246,33 @@ void StaticModelGroup::UpdateBatches(const FrameInfo& frame)
         lodDistance_ = newLodDistance;
         CalculateLodLevels();
     }
+    
+    // The batches above contain all instances and are used for shadows. For the view itself, cull the instances
+    // individually and choose their LOD levels
+    StaticModelGroupView* view = GetViewForUpdate(frame);
+    if (view)
+        UpdateViewBatches(*view, frame);
+}
+
+const Vector<SourceBatch>& StaticModelGroup::GetViewBatches()
+{
+    if (!lastView_)
+        return batches_;
+    
+    // The materials are only assigned here in the main thread, as reference counting is not thread-safe
+    unsigned batchIndex = 0;
+    for (unsigned i = 0; i < geometries_.Size() && batchIndex < lastView_->batches_.Size(); ++i)
+    {
+        unsigned numLevels = Max((int)geometries_[i].Size(), 1);
+        for (unsigned j = 0; j < numLevels && batchIndex < lastView_->batches_.Size(); ++j)
+        {
+            SourceBatch& batch = lastView_->batches_[batchIndex++];
+            if (batch.material_ != batches_[i].material_)
+                batch.material_ = batches_[i].material_;
+        }
+    }
+    
+    return lastView_->batches_;
 }
 
 unsigned StaticModelGroup::GetNumOccluderTriangles()
@@ -310,11 +394,200 @@ void StaticModelGroup::RemoveAllInstanceNodes()
     MarkNetworkUpdate();
 }
 
+void StaticModelGroup::SetImpostorDistance(float distance)
+{
+    impostorDistance_ = Max(distance, 0.0f);
+    UpdateImpostorSet();
+    MarkNetworkUpdate();
+}
+
+void StaticModelGroup::SetImpostorFadeRange(float range)
+{
+    impostorFadeRange_ = Max(range, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void StaticModelGroup::SetImpostorFrames(unsigned num)
+{
+    impostorFrames_ = Clamp((int)num, 1, (int)MAX_IMPOSTOR_FRAMES);
+    MarkNetworkUpdate();
+}
+
+void StaticModelGroup::SetImpostorMaterial(Material* material)
+{
+    impostorMaterial_ = material;
+    if (impostorSet_)
+        impostorSet_->SetMaterial(material);
+    MarkNetworkUpdate();
+}
+
+bool StaticModelGroup::GenerateImpostor(int frameSize)
+{
+    if (!impostorSet_)
+    {
+        LOGERROR("Impostor distance must be set before generating the impostor");
+        return false;
+    }
+    
+    return impostorSet_->GenerateImpostor(impostorFrames_, frameSize);
+}
+
+StaticModelGroupView* StaticModelGroup::GetViewForUpdate(const FrameInfo& frame)
+{
+    MutexLock lock(viewMutex_);
+    
+    StaticModelGroupView* view = 0;
+    for (List<StaticModelGroupView>::Iterator i = views_.Begin(); i != views_.End(); ++i)
+    {
+        if (i->camera_ == frame.camera_)
+        {
+            view = &(*i);
+            break;
+        }
+    }
+    
+    // Reuse the data of a view that has not been rendered on this frame, or add new
+    if (!view)
+    {
+        for (List<StaticModelGroupView>::Iterator i = views_.Begin(); i != views_.End(); ++i)
+        {
+            if (i->frameNumber_ != frame.frameNumber_)
+            {
+                view = &(*i);
+                break;
+            }
+        }
+    }
+    if (!view)
+    {
+        views_.Push(StaticModelGroupView());
+        view = &views_.Back();
+    }
+    
+    lastView_ = view;
+    
+    // Occluders have their batches updated before the occlusion buffer exists, so cull again once it does. Other repeated
+    // updates come from the light threads processing shadow casters, and must not touch the data
+    if (view->camera_ == frame.camera_ && view->frameNumber_ == frame.frameNumber_ && (view->occlusionBuffer_ ||
+        !frame.occlusionBuffer_))
+        return 0;
+    
+    view->camera_ = frame.camera_;
+    view->occlusionBuffer_ = frame.occlusionBuffer_;
+    view->frameNumber_ = frame.frameNumber_;
+    return view;
+}
+
+void StaticModelGroup::UpdateViewBatches(StaticModelGroupView& view, const FrameInfo& frame)
+{
+    unsigned numBatches = 0;
+    unsigned numLodLists = 0;
+    for (unsigned i = 0; i < geometries_.Size(); ++i)
+    {
+        unsigned numLevels = geometries_[i].Size();
+        numBatches += Max((int)numLevels, 1);
+        if (numLevels > 1)
+            ++numLodLists;
+    }
+    view.batches_.Resize(numBatches);
+    
+    Camera* camera = frame.camera_;
+    const Frustum& frustum = camera->GetFrustum();
+    OcclusionBuffer* buffer = occludee_ ? frame.occlusionBuffer_ : 0;
+    // If the whole group is inside the frustum, the instances do not need to be tested against it
+    bool testFrustum = frustum.IsInside(GetWorldBoundingBox()) != INSIDE;
+    
+    // Instances beyond the draw distance are culled, and beyond the impostor distance drawn by the impostor set
+    float maxDistance = drawDistance_ > 0.0f ? drawDistance_ : M_INFINITY;
+    if (impostorDistance_ > 0.0f && impostorMaterial_ && impostorSet_)
+        maxDistance = Min(maxDistance, impostorDistance_);
+    
+    view.transforms_.Resize(numWorldTransforms_ * (numLodLists + 1));
+    view.lodDistances_.Resize(numWorldTransforms_);
+    view.lodLevels_.Resize(numWorldTransforms_);
+    
+    Vector3 center = boundingBox_.Center();
+    unsigned numVisible = 0;
+    
+    for (unsigned i = 0; i < numWorldTransforms_; ++i)
+    {
+        const Matrix3x4& transform = worldTransforms_[i];
+        float distance = camera->GetDistance(transform * center);
+        if (distance >= maxDistance)
+            continue;
+        
+        BoundingBox box = boundingBox_.Transformed(transform);
+        if (testFrustum && frustum.IsInsideFast(box) == OUTSIDE)
+            continue;
+        if (buffer && !buffer->IsVisible(box))
+            continue;
+        
+        view.lodDistances_[numVisible] = camera->GetLodDistance(distance, box.Size().DotProduct(DOT_SCALE), lodBias_);
+        view.transforms_[numVisible++] = transform;
+    }
+    
+    const Matrix3x4* visible = numVisible ? &view.transforms_[0] : &Matrix3x4::IDENTITY;
+    unsigned batchIndex = 0;
+    unsigned listStart = numWorldTransforms_;
+    
+    for (unsigned i = 0; i < geometries_.Size(); ++i)
+    {
+        const Vector<SharedPtr<Geometry> >& batchGeometries = geometries_[i];
+        unsigned numLevels = batchGeometries.Size();
+        
+        // Without LOD levels the geometry uses the visible instances as is
+        if (numLevels <= 1)
+        {
+            SourceBatch& batch = view.batches_[batchIndex++];
+            batch.distance_ = batches_[i].distance_;
+            batch.geometry_ = batches_[i].geometry_;
+            batch.worldTransform_ = visible;
+            batch.numWorldTransforms_ = numVisible;
+            continue;
+        }
+        
+        // Count the instances on each LOD level, then copy them sorted by level so that each level is one batch
+        view.lodOffsets_.Resize(numLevels);
+        for (unsigned j = 0; j < numLevels; ++j)
+            view.lodOffsets_[j] = 0;
+        for (unsigned j = 0; j < numVisible; ++j)
+        {
+            unsigned level = GetLodLevel(batchGeometries, view.lodDistances_[j]);
+            view.lodLevels_[j] = level;
+            ++view.lodOffsets_[level];
+        }
+        
+        Matrix3x4* dest = numVisible ? &view.transforms_[listStart] : 0;
+        unsigned start = 0;
+        for (unsigned j = 0; j < numLevels; ++j)
+        {
+            unsigned count = view.lodOffsets_[j];
+            SourceBatch& batch = view.batches_[batchIndex++];
+            batch.distance_ = batches_[i].distance_;
+            batch.geometry_ = batchGeometries[j];
+            batch.worldTransform_ = count ? dest + start : &Matrix3x4::IDENTITY;
+            batch.numWorldTransforms_ = count;
+            view.lodOffsets_[j] = start;
+            start += count;
+        }
+        
+        for (unsigned j = 0; j < numVisible; ++j)
+            dest[view.lodOffsets_[view.lodLevels_[j]]++] = visible[j];
+        
+        listStart += numWorldTransforms_;
+    }
+}
+
 Node* StaticModelGroup::GetInstanceNode(unsigned index) const
 {
     return index < instanceNodes_.Size() ? instanceNodes_[index] : (Node*)0;
 }
 
+ImpostorSet* StaticModelGroup::GetImpostorSet() const
+{
+    return impostorSet_;
+}
+
 void StaticModelGroup::SetNodeIDsAttr(const VariantVector& value)
 {
     // Just remember the node IDs. They need to go through the SceneResolver, and we actually find the nodes during
@@ -347,9 +620,40 @@ void StaticModelGroup::SetNodeIDsAttr(const VariantVector& value)
     nodeIDsDirty_ = true;
 }
 
+void StaticModelGroup::SetImpostorMaterialAttr(const ResourceRef& value)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    SetImpostorMaterial(cache->GetResource<Material>(value.name_));
+}
+
+ResourceRef StaticModelGroup::GetImpostorMaterialAttr() const
+{
+    return GetResourceRef(impostorMaterial_, Material::GetTypeStatic());
+}
+
+void StaticModelGroup::OnNodeSet(Node* node)
+{
+    StaticModel::OnNodeSet(node);
+    
+    if (node)
+        UpdateImpostorSet();
+}
+
+void StaticModelGroup::OnMarkedDirty(Node* node)
+{
+    StaticModel::OnMarkedDirty(node);
+    
+    // Instance nodes moving also changes the impostor set's bounding box
+    if (impostorSet_)
+        impostorSet_->MarkImpostorsDirty();
+}
+
 void StaticModelGroup::OnNodeSetEnabled(Node* node)
 {
     Drawable::OnMarkedDirty(node);
+    
+    if (impostorSet_)
+        impostorSet_->MarkImpostorsDirty();
 }
 
 void StaticModelGroup::OnWorldBoundingBoxUpdate()
@@ -384,6 +688,7 @@ void StaticModelGroup::UpdateNodeIDs()
     nodeIDsAttr_.Clear();
     nodeIDsAttr_.Push(numInstances);
     worldTransforms_.Resize(numInstances);
+    nearTransforms_.Resize(numInstances);
     numWorldTransforms_ = 0; // For safety. OnWorldBoundingBoxUpdate() will calculate the proper amount
     
     for (unsigned i = 0; i < numInstances; ++i)
@@ -393,4 +698,23 @@ void StaticModelGroup::UpdateNodeIDs()
     }
 }
 
+void StaticModelGroup::UpdateImpostorSet()
+{
+    if (!node_)
+        return;
+    
+    if (impostorDistance_ > 0.0f && !impostorSet_)
+    {
+        impostorSet_ = node_->CreateComponent<ImpostorSet>(LOCAL);
+        impostorSet_->SetTemporary(true);
+        impostorSet_->SetViewMask(GetViewMask());
+        impostorSet_->SetGroup(this);
+    }
+    else if (impostorDistance_ <= 0.0f && impostorSet_)
+    {
+        node_->RemoveComponent(impostorSet_);
+        impostorSet_.Reset();
+    }
+}
+
 }
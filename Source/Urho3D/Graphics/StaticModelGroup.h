@@ -22,16 +22,48 @@
 
 #pragma once
 
+#include "../Container/List.h"
+#include "../Core/Mutex.h"
 #include "../Graphics/StaticModel.h"
 
 namespace Urho3D
 {
 
-/// Renders several object instances while culling and receiving light as one unit. Can be used as a CPU-side optimization, but note that also regular StaticModels will use instanced rendering if possible.
+class ImpostorSet;
+
+/// Culled and LOD-sorted instances of a StaticModelGroup for one view camera.
+struct StaticModelGroupView
+{
+    /// Construct.
+    StaticModelGroupView();
+    /// Destruct.
+    ~StaticModelGroupView();
+    
+    /// Camera of the view.
+    Camera* camera_;
+    /// Occlusion buffer used in the last culling.
+    OcclusionBuffer* occlusionBuffer_;
+    /// Frame number of the last culling.
+    unsigned frameNumber_;
+    /// Source batches, one for each LOD level of each geometry.
+    Vector<SourceBatch> batches_;
+    /// Transforms of the visible instances, followed by a copy sorted by LOD level for each geometry that has LOD levels.
+    PODVector<Matrix3x4> transforms_;
+    /// LOD distances of the visible instances.
+    PODVector<float> lodDistances_;
+    /// LOD levels of the visible instances.
+    PODVector<unsigned> lodLevels_;
+    /// Instance counts and write offsets of the LOD levels.
+    PODVector<unsigned> lodOffsets_;
+};
+
+/// Renders several object instances while receiving light as one unit. The instances are culled and their LOD levels chosen individually in each view. Can be used as a CPU-side optimization, but note that also regular StaticModels will use instanced rendering if possible.
 class URHO3D_API StaticModelGroup : public StaticModel
 {
     OBJECT(StaticModelGroup);
     
+    friend class ImpostorSet;
+    
 public:
     /// Construct.
     StaticModelGroup(Context* context);
@@ -46,6 +78,8 @@ public:
     virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results);
     /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
     virtual void UpdateBatches(const FrameInfo& frame);
+    /// Return draw call source data of the instances visible in the view that last updated the batches. Called from the main thread.
+    virtual const Vector<SourceBatch>& GetViewBatches();
     /// Return number of occlusion geometry triangles.
     virtual unsigned GetNumOccluderTriangles();
     /// Draw to occlusion buffer. Return true if did not run out of triangles.
@@ -57,35 +91,86 @@ public:
     void RemoveInstanceNode(Node* node);
     /// Remove all instance scene nodes.
     void RemoveAllInstanceNodes();
+    /// Set distance from the camera beyond which instances are drawn as impostor billboards instead of the model. 0 disables impostors (default.)
+    void SetImpostorDistance(float distance);
+    /// Set distance range before the impostor distance over which the impostors fade in on top of the models.
+    void SetImpostorFadeRange(float range);
+    /// Set number of view angles around the Y axis in the impostor atlas. The frames are laid out left to right and top to bottom in a square grid.
+    void SetImpostorFrames(unsigned num);
+    /// Set impostor material. Its diffuse texture should be an atlas of the model rendered from the view angles, and it should use vertex color alpha for fading.
+    void SetImpostorMaterial(Material* material);
+    /// Render the model into a new impostor atlas at the current number of frames, and use it in the impostor material. Requires the impostor distance to be set. The atlas is rendered on the next frame. Return true if successful.
+    bool GenerateImpostor(int frameSize = 128);
     
     /// Return number of instance nodes.
     unsigned GetNumInstanceNodes() const { return instanceNodes_.Size(); }
     /// Return instance node by index.
     Node* GetInstanceNode(unsigned index) const;
+    /// Return impostor distance.
+    float GetImpostorDistance() const { return impostorDistance_; }
+    /// Return impostor fade range.
+    float GetImpostorFadeRange() const { return impostorFadeRange_; }
+    /// Return number of view angles in the impostor atlas.
+    unsigned GetImpostorFrames() const { return impostorFrames_; }
+    /// Return impostor material.
+    Material* GetImpostorMaterial() const { return impostorMaterial_; }
+    /// Return the impostor billboards component, or null if impostors are disabled.
+    ImpostorSet* GetImpostorSet() const;
     
     /// Set node IDs attribute.
     void SetNodeIDsAttr(const VariantVector& value);
+    /// Set impostor material attribute.
+    void SetImpostorMaterialAttr(const ResourceRef& value);
     /// Return node IDs attribute.
     const VariantVector& GetNodeIDsAttr() const { return nodeIDsAttr_; }
+    /// Return impostor material attribute.
+    ResourceRef GetImpostorMaterialAttr() const;
     
 protected:
+    /// Handle node being assigned.
+    virtual void OnNodeSet(Node* node);
+    /// Handle node transform being dirtied.
+    virtual void OnMarkedDirty(Node* node);
     /// Handle scene node enabled status changing.
     virtual void OnNodeSetEnabled(Node* node);
     /// Recalculate the world-space bounding box.
     virtual void OnWorldBoundingBoxUpdate();
     
-private:
     /// Update node IDs attribute and ensure the transforms vector has the right size.
     void UpdateNodeIDs();
+    /// Create or remove the impostor billboards component as necessary.
+    void UpdateImpostorSet();
+    /// Return the per-view data for the view camera and make it the last view. Return null if the instances have already been culled for it on this frame.
+    StaticModelGroupView* GetViewForUpdate(const FrameInfo& frame);
+    /// Cull the instances against the view and sort them by LOD level into the view batches.
+    void UpdateViewBatches(StaticModelGroupView& view, const FrameInfo& frame);
     
     /// Instance nodes.
     Vector<WeakPtr<Node> > instanceNodes_;
     /// World transforms of valid (existing and visible) instances.
     PODVector<Matrix3x4> worldTransforms_;
+    /// World transforms of the instances closer than the impostor distance on the last view.
+    PODVector<Matrix3x4> nearTransforms_;
+    /// Impostor material.
+    SharedPtr<Material> impostorMaterial_;
+    /// Impostor billboards component.
+    WeakPtr<ImpostorSet> impostorSet_;
+    /// Per-view culled instances. A list is used so that the data stays in place while new views are added.
+    List<StaticModelGroupView> views_;
+    /// Per-view data of the view that last updated the batches.
+    StaticModelGroupView* lastView_;
+    /// Mutex for finding the per-view data from worker threads.
+    Mutex viewMutex_;
     /// IDs of instance nodes for serialization.
     mutable VariantVector nodeIDsAttr_;
     /// Number of valid instance node transforms.
     unsigned numWorldTransforms_;
+    /// Impostor distance.
+    float impostorDistance_;
+    /// Impostor fade range.
+    float impostorFadeRange_;
+    /// Number of view angles in the impostor atlas.
+    unsigned impostorFrames_;
     /// Whether node IDs have been set and nodes should be searched for during ApplyAttributes.
     bool nodeIDsDirty_;
 };
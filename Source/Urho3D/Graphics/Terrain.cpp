@@ -352,6 +352,61 @@ void Terrain::ApplyHeightMap()
         CreateGeometry();
 }
 
+void Terrain::SetHeightValue(const IntVector2& position, float height)
+{
+    if (!heightData_ || position.x_ < 0 || position.y_ < 0 || position.x_ >= numVertices_.x_ || position.y_ >= numVertices_.y_)
+        return;
+
+    heightData_[(numVertices_.y_ - 1 - position.y_) * numVertices_.x_ + position.x_] = height;
+}
+
+void Terrain::ApplyHeightMapRegion(const IntRect& region)
+{
+    if (!heightData_ || !node_ || patches_.Empty())
+        return;
+
+    PROFILE(ApplyHeightMapRegion);
+
+    // Convert to the vertically reversed internal coordinates
+    int startX = Max(region.left_, 0);
+    int endX = Min(region.right_, numVertices_.x_ - 1);
+    int startZ = Max(numVertices_.y_ - 1 - region.bottom_, 0);
+    int endZ = Min(numVertices_.y_ - 1 - region.top_, numVertices_.y_ - 1);
+    if (startX > endX || startZ > endZ)
+        return;
+
+    // Normals use the neighbor vertices, and the LOD errors interpolate up to the coarsest LOD step ahead. Patches share
+    // the vertices on their edges, so a vertex can belong to two patches on each axis
+    int lodExpand = 1 << (numLodLevels_ - 1);
+    int startPatchX = Max(startX - lodExpand - 1, 0) / patchSize_;
+    int endPatchX = Min((endX + 1) / patchSize_, numPatches_.x_ - 1);
+    int startPatchZ = Max(startZ - lodExpand - 1, 0) / patchSize_;
+    int endPatchZ = Min((endZ + 1) / patchSize_, numPatches_.y_ - 1);
+
+    for (int z = startPatchZ; z <= endPatchZ; ++z)
+    {
+        for (int x = startPatchX; x <= endPatchX; ++x)
+        {
+            TerrainPatch* patch = GetPatch(x, z);
+            if (!patch)
+                continue;
+
+            int patchX = x * patchSize_;
+            int patchZ = z * patchSize_;
+            if (startX - 1 <= patchX + patchSize_ && endX + 1 >= patchX && startZ - 1 <= patchZ + patchSize_ && endZ + 1 >= patchZ)
+                UpdatePatchGeometry(patch, Max(startZ - 1 - patchZ, 0), Min(endZ + 1 - patchZ, patchSize_));
+            CalculateLodErrors(patch);
+        }
+    }
+
+    using namespace TerrainHeightChanged;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_NODE] = node_;
+    eventData[P_REGION] = IntRect(startX, numVertices_.y_ - 1 - endZ, endX, numVertices_.y_ - 1 - startZ);
+    node_->SendEvent(E_TERRAINHEIGHTCHANGED, eventData);
+}
+
 Image* Terrain::GetHeightMap() const
 {
     return heightMap_;
@@ -450,10 +505,27 @@ IntVector2 Terrain::WorldToHeightMap(const Vector3& worldPosition) const
     Vector3 position = node_->GetWorldTransform().Inverse() * worldPosition;
     int xPos = (int)((position.x_ - patchWorldOrigin_.x_) / spacing_.x_);
     int zPos = (int)((position.z_ - patchWorldOrigin_.y_) / spacing_.z_);
-    Clamp(xPos, 0, numVertices_.x_);
-    Clamp(zPos, 0, numVertices_.y_);
+    xPos = Clamp(xPos, 0, numVertices_.x_ - 1);
+    zPos = Clamp(zPos, 0, numVertices_.y_ - 1);
 
-    return IntVector2(xPos, numVertices_.y_ - zPos);
+    return IntVector2(xPos, numVertices_.y_ - 1 - zPos);
+}
+
+Vector3 Terrain::HeightMapToWorld(const IntVector2& position) const
+{
+    if (!node_)
+        return Vector3::ZERO;
+
+    int xPos = position.x_;
+    int zPos = numVertices_.y_ - 1 - position.y_;
+    Vector3 localPosition(patchWorldOrigin_.x_ + (float)xPos * spacing_.x_, GetRawHeight(xPos, zPos), patchWorldOrigin_.y_ +
+        (float)zPos * spacing_.z_);
+    return node_->GetWorldTransform() * localPosition;
+}
+
+float Terrain::GetHeightValue(const IntVector2& position) const
+{
+    return GetRawHeight(position.x_, numVertices_.y_ - 1 - position.y_);
 }
 
 void Terrain::CreatePatchGeometry(TerrainPatch* patch)
@@ -472,53 +544,15 @@ void Terrain::CreatePatchGeometry(TerrainPatch* patch)
     SharedArrayPtr<unsigned char> cpuVertexData(new unsigned char[row * row * sizeof(Vector3)]);
 
     float* vertexData = (float*)vertexBuffer->Lock(0, vertexBuffer->GetVertexCount());
-    float* positionData = (float*)cpuVertexData.Get();
     BoundingBox box;
 
     if (vertexData)
     {
-        const IntVector2& coords = patch->GetCoordinates();
-
-        for (int z = 0; z <= patchSize_; ++z)
-        {
-            for (int x = 0; x <= patchSize_; ++x)
-            {
-                int xPos = coords.x_ * patchSize_ + x;
-                int zPos = coords.y_ * patchSize_ + z;
-
-                // Position
-                Vector3 position((float)x * spacing_.x_, GetRawHeight(xPos, zPos), (float)z * spacing_.z_);
-                *vertexData++ = position.x_;
-                *vertexData++ = position.y_;
-                *vertexData++ = position.z_;
-                *positionData++ = position.x_;
-                *positionData++ = position.y_;
-                *positionData++ = position.z_;
-
-                box.Merge(position);
-
-                // Normal
-                Vector3 normal = GetRawNormal(xPos, zPos);
-                *vertexData++ = normal.x_;
-                *vertexData++ = normal.y_;
-                *vertexData++ = normal.z_;
-
-                // Texture coordinate
-                Vector2 texCoord((float)xPos / (float)numVertices_.x_, 1.0f - (float)zPos / (float)numVertices_.y_);
-                *vertexData++ = texCoord.x_;
-                *vertexData++ = texCoord.y_;
-
-                // Tangent
-                Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
-                *vertexData++ = xyz.x_;
-                *vertexData++ = xyz.y_;
-                *vertexData++ = xyz.z_;
-                *vertexData++ = 1.0f;
-            }
-        }
-
+        WritePatchVertices(patch, vertexData, (float*)cpuVertexData.Get(), 0, patchSize_);
         vertexBuffer->Unlock();
         vertexBuffer->ClearDataLost();
+
+        box.Define((const Vector3*)cpuVertexData.Get(), row * row);
     }
 
     patch->SetBoundingBox(box);
@@ -543,6 +577,42 @@ void Terrain::CreatePatchGeometry(TerrainPatch* patch)
     patch->ResetLod();
 }
 
+void Terrain::UpdatePatchGeometry(TerrainPatch* patch, int firstRow, int lastRow)
+{
+    PROFILE(UpdatePatchGeometry);
+
+    unsigned row = patchSize_ + 1;
+    VertexBuffer* vertexBuffer = patch->GetVertexBuffer();
+    SharedArrayPtr<unsigned char> cpuVertexData;
+    SharedArrayPtr<unsigned char> cpuIndexData;
+    unsigned vertexSize;
+    unsigned indexSize;
+    unsigned elementMask;
+    patch->GetGeometry()->GetRawDataShared(cpuVertexData, vertexSize, cpuIndexData, indexSize, elementMask);
+
+    // Fall back to full regeneration if the geometry does not exist yet or its contents were lost
+    if (vertexBuffer->GetVertexCount() != row * row || vertexBuffer->IsDataLost() || !cpuVertexData)
+    {
+        CreatePatchGeometry(patch);
+        return;
+    }
+
+    float* vertexData = (float*)vertexBuffer->Lock(firstRow * row, (lastRow - firstRow + 1) * row);
+    if (!vertexData)
+        return;
+
+    // The CPU-side positions are shared by all the patch geometries, so updating them in place also updates the occlusion
+    // and raycast geometry
+    float* positionData = (float*)cpuVertexData.Get();
+    WritePatchVertices(patch, vertexData, positionData + firstRow * row * 3, firstRow, lastRow);
+    vertexBuffer->Unlock();
+
+    // Heights may also have decreased, so the bounding box is recalculated from all vertices
+    BoundingBox box;
+    box.Define((const Vector3*)positionData, row * row);
+    patch->SetBoundingBox(box);
+}
+
 void Terrain::UpdatePatchLod(TerrainPatch* patch)
 {
     Geometry* geometry = patch->GetGeometry();
@@ -1056,6 +1126,47 @@ void Terrain::CreateIndexData()
     indexBuffer_->SetData(&indices[0]);
 }
 
+void Terrain::WritePatchVertices(TerrainPatch* patch, float* vertexData, float* positionData, int firstRow, int lastRow) const
+{
+    const IntVector2& coords = patch->GetCoordinates();
+
+    for (int z = firstRow; z <= lastRow; ++z)
+    {
+        for (int x = 0; x <= patchSize_; ++x)
+        {
+            int xPos = coords.x_ * patchSize_ + x;
+            int zPos = coords.y_ * patchSize_ + z;
+
+            // Position
+            Vector3 position((float)x * spacing_.x_, GetRawHeight(xPos, zPos), (float)z * spacing_.z_);
+            *vertexData++ = position.x_;
+            *vertexData++ = position.y_;
+            *vertexData++ = position.z_;
+            *positionData++ = position.x_;
+            *positionData++ = position.y_;
+            *positionData++ = position.z_;
+
+            // Normal
+            Vector3 normal = GetRawNormal(xPos, zPos);
+            *vertexData++ = normal.x_;
+            *vertexData++ = normal.y_;
+            *vertexData++ = normal.z_;
+
+            // Texture coordinate
+            Vector2 texCoord((float)xPos / (float)numVertices_.x_, 1.0f - (float)zPos / (float)numVertices_.y_);
+            *vertexData++ = texCoord.x_;
+            *vertexData++ = texCoord.y_;
+
+            // Tangent
+            Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
+            *vertexData++ = xyz.x_;
+            *vertexData++ = xyz.y_;
+            *vertexData++ = xyz.z_;
+            *vertexData++ = 1.0f;
+        }
+    }
+}
+
 float Terrain::GetRawHeight(int x, int z) const
 {
     if (!heightData_)
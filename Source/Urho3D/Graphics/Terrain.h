@@ -87,6 +87,10 @@ public:
     void SetOccludee(bool enable);
     /// Apply changes from the heightmap image.
     void ApplyHeightMap();
+    /// Set terrain-space height of a vertex in heightmap pixel coordinates. Is applied to the geometry by ApplyHeightMapRegion(). The heightmap image is not modified, so ApplyHeightMap() reverts the change.
+    void SetHeightValue(const IntVector2& position, float height);
+    /// Update the vertices, bounding boxes and LOD errors of only the patches affected by height changes within a heightmap pixel region (inclusive), and send E_TERRAINHEIGHTCHANGED so that collision shapes update their heightfield in place.
+    void ApplyHeightMapRegion(const IntRect& region);
 
     /// Return patch quads per side.
     int GetPatchSize() const { return patchSize_; }
@@ -112,6 +116,10 @@ public:
     Vector3 GetNormal(const Vector3& worldPosition) const;
     /// Convert world position to heightmap pixel position. Note that the internal height data representation is reversed vertically, but in the heightmap image north is at the top.
     IntVector2 WorldToHeightMap(const Vector3& worldPosition) const;
+    /// Convert heightmap pixel position to world position, including the height.
+    Vector3 HeightMapToWorld(const IntVector2& position) const;
+    /// Return terrain-space height of a vertex in heightmap pixel coordinates.
+    float GetHeightValue(const IntVector2& position) const;
     /// Return raw height data.
     SharedArrayPtr<float> GetHeightData() const { return heightData_; }
     /// Return draw distance.
@@ -141,6 +149,8 @@ public:
 
     /// Regenerate patch geometry.
     void CreatePatchGeometry(TerrainPatch* patch);
+    /// Rewrite a range of vertex rows of the patch geometry and recalculate its bounding box.
+    void UpdatePatchGeometry(TerrainPatch* patch, int firstRow, int lastRow);
     /// Update patch based on LOD and neighbor LOD.
     void UpdatePatchLod(TerrainPatch* patch);
     /// Set heightmap attribute.
@@ -159,6 +169,8 @@ private:
     void CreateGeometry();
     /// Create index data shared by all patches.
     void CreateIndexData();
+    /// Write vertex rows of a patch to the vertex buffer and the CPU-side position data.
+    void WritePatchVertices(TerrainPatch* patch, float* vertexData, float* positionData, int firstRow, int lastRow) const;
     /// Return an uninterpolated terrain height value, clamping to edges.
     float GetRawHeight(int x, int z) const;
     /// Return a source terrain height value, clamping to edges. The source data is used for smoothing.
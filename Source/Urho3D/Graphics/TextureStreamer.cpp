@@ -0,0 +1,342 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../IO/File.h"
+#include "../Resource/Image.h"
+#include "../IO/Log.h"
+#include "../Core/Profiler.h"
+#include "../Resource/ResourceCache.h"
+#include "../Container/Sort.h"
+#include "../Graphics/Texture2D.h"
+#include "../Graphics/TextureStreamer.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Texture reload executed in a worker thread.
+struct StreamingRequest : public RefCounted
+{
+    /// Texture to upload to. Only accessed in the main thread.
+    WeakPtr<Texture2D> texture_;
+    /// Resource cache for opening the file.
+    ResourceCache* cache_;
+    /// Texture file name.
+    String name_;
+    /// Mip levels to skip when uploading.
+    unsigned mipsToSkip_;
+    /// Loaded image, or null if loading failed.
+    SharedPtr<Image> image_;
+    /// Work item.
+    SharedPtr<WorkItem> item_;
+};
+
+static void LoadStreamedImageWork(const WorkItem* item, unsigned threadIndex)
+{
+    StreamingRequest* request = reinterpret_cast<StreamingRequest*>(item->aux_);
+    SharedPtr<File> file = request->cache_->GetFile(request->name_, false);
+    if (!file)
+        return;
+    
+    SharedPtr<Image> image(new Image(request->cache_->GetContext()));
+    if (image->Load(*file))
+        request->image_ = image;
+}
+
+static bool CompareStreamingPriority(const StreamedTexture* lhs, const StreamedTexture* rhs)
+{
+    // Releasing mip levels comes first to free memory, then the largest resolution increases
+    bool lhsDrop = lhs->targetMipsToSkip_ > lhs->mipsToSkip_;
+    bool rhsDrop = rhs->targetMipsToSkip_ > rhs->mipsToSkip_;
+    if (lhsDrop != rhsDrop)
+        return lhsDrop;
+    return Abs((int)lhs->targetMipsToSkip_ - (int)lhs->mipsToSkip_) > Abs((int)rhs->targetMipsToSkip_ - (int)rhs->mipsToSkip_);
+}
+
+/// Return estimated memory use of a texture at a mip skip level, based on its current memory use.
+static unsigned EstimateMemoryUse(const StreamedTexture& entry, unsigned mipsToSkip)
+{
+    unsigned memoryUse = entry.texture_->GetMemoryUse();
+    if (mipsToSkip < entry.mipsToSkip_)
+        return memoryUse << (2 * (entry.mipsToSkip_ - mipsToSkip));
+    else
+        return memoryUse >> (2 * (mipsToSkip - entry.mipsToSkip_));
+}
+
+TextureStreamer::TextureStreamer(Context* context) :
+    Object(context),
+    memoryBudget_(0),
+    minSize_(64),
+    maxPendingReloads_(2),
+    keepFrames_(60)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // The worker threads may still refer to the requests, so wait for those that already started
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue)
+        return;
+    
+    for (unsigned i = 0; i < requests_.Size(); ++i)
+    {
+        if (!queue->RemoveWorkItem(requests_[i]->item_))
+        {
+            while (!requests_[i]->item_->completed_)
+                Time::Sleep(1);
+        }
+    }
+}
+
+void TextureStreamer::SetMinSize(int size)
+{
+    minSize_ = Max(size, 1);
+}
+
+void TextureStreamer::SetMaxPendingReloads(unsigned reloads)
+{
+    maxPendingReloads_ = Max((int)reloads, 1);
+}
+
+void TextureStreamer::AddTexture(Texture2D* texture, Image* image)
+{
+    if (!texture || !image)
+        return;
+    
+    // Only compressed images with a stored mip chain are streamed. Uncompressed images such as UI textures are typically
+    // not drawn through views, and would never be requested at a higher resolution
+    if (!image->IsCompressed() || image->GetNumCompressedLevels() < 2)
+    {
+        textures_.Erase(texture);
+        texture->SetStreamingMipsToSkip(0);
+        return;
+    }
+    
+    StreamedTexture& entry = textures_[texture];
+    entry.texture_ = texture;
+    entry.width_ = image->GetWidth();
+    entry.height_ = image->GetHeight();
+    entry.levels_ = image->GetNumCompressedLevels();
+    
+    // Skip down to the initial load size, but keep at least 4x4 blocks
+    unsigned maxMipsToSkip = 0;
+    while (maxMipsToSkip + 1 < entry.levels_ && (Max(entry.width_, entry.height_) >> (maxMipsToSkip + 1)) >= minSize_ &&
+        (Min(entry.width_, entry.height_) >> (maxMipsToSkip + 1)) >= 4)
+        ++maxMipsToSkip;
+    
+    entry.maxMipsToSkip_ = maxMipsToSkip;
+    entry.mipsToSkip_ = maxMipsToSkip;
+    entry.targetMipsToSkip_ = maxMipsToSkip;
+    entry.lastRequestFrameNumber_ = 0;
+    texture->SetStreamingMipsToSkip(maxMipsToSkip);
+}
+
+void TextureStreamer::RequestTexture(Texture2D* texture, float screenSize, unsigned frameNumber)
+{
+    HashMap<Texture2D*, StreamedTexture>::Iterator i = textures_.Find(texture);
+    if (i == textures_.End() || i->second_.texture_ != texture)
+        return;
+    
+    StreamedTexture& entry = i->second_;
+    if (entry.lastRequestFrameNumber_ != frameNumber)
+    {
+        entry.requiredScreenSize_ = screenSize;
+        entry.lastRequestFrameNumber_ = frameNumber;
+    }
+    else if (screenSize > entry.requiredScreenSize_)
+        entry.requiredScreenSize_ = screenSize;
+}
+
+void TextureStreamer::Update(unsigned frameNumber)
+{
+    PROFILE(UpdateTextureStreaming);
+    
+    FinishRequests();
+    
+    // Forget destroyed textures
+    for (HashMap<Texture2D*, StreamedTexture>::Iterator i = textures_.Begin(); i != textures_.End();)
+    {
+        if (i->second_.texture_.Expired())
+            i = textures_.Erase(i);
+        else
+            ++i;
+    }
+    
+    UpdateTargets(frameNumber);
+    StartRequests();
+}
+
+unsigned TextureStreamer::GetMemoryUse() const
+{
+    unsigned memoryUse = 0;
+    for (HashMap<Texture2D*, StreamedTexture>::ConstIterator i = textures_.Begin(); i != textures_.End(); ++i)
+    {
+        if (i->second_.texture_)
+            memoryUse += i->second_.texture_->GetMemoryUse();
+    }
+    return memoryUse;
+}
+
+void TextureStreamer::FinishRequests()
+{
+    for (Vector<SharedPtr<StreamingRequest> >::Iterator i = requests_.Begin(); i != requests_.End();)
+    {
+        StreamingRequest* request = *i;
+        if (!request->item_->completed_)
+        {
+            ++i;
+            continue;
+        }
+        
+        Texture2D* texture = request->texture_;
+        HashMap<Texture2D*, StreamedTexture>::Iterator j = texture ? textures_.Find(texture) : textures_.End();
+        if (j != textures_.End() && j->second_.texture_ == texture)
+        {
+            StreamedTexture& entry = j->second_;
+            entry.pending_ = false;
+            
+            if (request->image_)
+            {
+                texture->SetStreamingMipsToSkip(request->mipsToSkip_);
+                if (texture->SetData(request->image_))
+                    entry.mipsToSkip_ = request->mipsToSkip_;
+                else
+                    texture->SetStreamingMipsToSkip(entry.mipsToSkip_);
+            }
+            else
+            {
+                // Do not retry a file that can not be loaded
+                LOGERROR("Failed to reload streamed texture " + request->name_);
+                entry.maxMipsToSkip_ = entry.mipsToSkip_;
+            }
+        }
+        
+        i = requests_.Erase(i);
+    }
+}
+
+void TextureStreamer::UpdateTargets(unsigned frameNumber)
+{
+    unsigned totalMemoryUse = 0;
+    
+    for (HashMap<Texture2D*, StreamedTexture>::Iterator i = textures_.Begin(); i != textures_.End(); ++i)
+    {
+        StreamedTexture& entry = i->second_;
+        
+        // Textures not requested recently go back to the initial size. Otherwise skip as many levels as possible while
+        // still having at least one texel per pixel of the requested screen size
+        unsigned target = entry.maxMipsToSkip_;
+        if (entry.lastRequestFrameNumber_ && frameNumber - entry.lastRequestFrameNumber_ <= keepFrames_)
+        {
+            float screenSize = Max(entry.requiredScreenSize_, 1.0f);
+            float texels = (float)Max(entry.width_, entry.height_);
+            target = 0;
+            while (target < entry.maxMipsToSkip_ && texels * 0.5f >= screenSize)
+            {
+                texels *= 0.5f;
+                ++target;
+            }
+        }
+        
+        entry.targetMipsToSkip_ = target;
+        totalMemoryUse += EstimateMemoryUse(entry, target);
+    }
+    
+    if (!memoryBudget_)
+        return;
+    
+    // Over budget: lower the resolution of the largest textures until the estimate fits
+    while (totalMemoryUse > memoryBudget_)
+    {
+        StreamedTexture* largest = 0;
+        unsigned largestMemoryUse = 0;
+        
+        for (HashMap<Texture2D*, StreamedTexture>::Iterator i = textures_.Begin(); i != textures_.End(); ++i)
+        {
+            StreamedTexture& entry = i->second_;
+            if (entry.targetMipsToSkip_ >= entry.maxMipsToSkip_)
+                continue;
+            
+            unsigned memoryUse = EstimateMemoryUse(entry, entry.targetMipsToSkip_);
+            if (memoryUse > largestMemoryUse)
+            {
+                largest = &entry;
+                largestMemoryUse = memoryUse;
+            }
+        }
+        
+        if (!largest)
+            break;
+        
+        ++largest->targetMipsToSkip_;
+        totalMemoryUse -= largestMemoryUse;
+        totalMemoryUse += EstimateMemoryUse(*largest, largest->targetMipsToSkip_);
+    }
+}
+
+void TextureStreamer::StartRequests()
+{
+    if (requests_.Size() >= maxPendingReloads_)
+        return;
+    
+    PODVector<StreamedTexture*> candidates;
+    for (HashMap<Texture2D*, StreamedTexture>::Iterator i = textures_.Begin(); i != textures_.End(); ++i)
+    {
+        StreamedTexture& entry = i->second_;
+        if (!entry.pending_ && entry.targetMipsToSkip_ != entry.mipsToSkip_)
+            candidates.Push(&entry);
+    }
+    if (candidates.Empty())
+        return;
+    
+    Sort(candidates.Begin(), candidates.End(), CompareStreamingPriority);
+    
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    
+    for (unsigned i = 0; i < candidates.Size() && requests_.Size() < maxPendingReloads_; ++i)
+    {
+        StreamedTexture& entry = *candidates[i];
+        
+        SharedPtr<StreamingRequest> request(new StreamingRequest());
+        request->texture_ = entry.texture_;
+        request->cache_ = cache;
+        request->name_ = entry.texture_->GetName();
+        request->mipsToSkip_ = entry.targetMipsToSkip_;
+        
+        // Use an own work item instead of the pool, so that it stays valid for polling after completion
+        request->item_ = new WorkItem();
+        request->item_->workFunction_ = LoadStreamedImageWork;
+        request->item_->aux_ = request.Get();
+        request->item_->priority_ = 0;
+        
+        entry.pending_ = true;
+        requests_.Push(request);
+        queue->AddWorkItem(request->item_);
+    }
+}
+
+}
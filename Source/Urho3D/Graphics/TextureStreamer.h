@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/Ptr.h"
+#include "../Container/Vector.h"
+#include "../Core/Object.h"
+
+namespace Urho3D
+{
+
+class Image;
+class Texture2D;
+struct StreamingRequest;
+
+/// Streaming state of a texture.
+struct StreamedTexture
+{
+    /// Construct.
+    StreamedTexture() :
+        width_(0),
+        height_(0),
+        levels_(0),
+        mipsToSkip_(0),
+        maxMipsToSkip_(0),
+        targetMipsToSkip_(0),
+        requiredScreenSize_(0.0f),
+        lastRequestFrameNumber_(0),
+        pending_(false)
+    {
+    }
+    
+    /// Texture.
+    WeakPtr<Texture2D> texture_;
+    /// Full resolution width.
+    int width_;
+    /// Full resolution height.
+    int height_;
+    /// Mip levels available in the source image.
+    unsigned levels_;
+    /// Mip levels currently skipped.
+    unsigned mipsToSkip_;
+    /// Maximum mip levels to skip, which is also the initially loaded level.
+    unsigned maxMipsToSkip_;
+    /// Mip levels to skip to reach on the next reload.
+    unsigned targetMipsToSkip_;
+    /// Largest screen size in pixels requested on the last request frame.
+    float requiredScreenSize_;
+    /// Frame number of the last request.
+    unsigned lastRequestFrameNumber_;
+    /// Reload in progress flag.
+    bool pending_;
+};
+
+/// %Texture mip level streamer. Loads compressed file textures at low resolution first, then reloads them with more or less mip levels in worker threads according to the screen size requested by views, within a memory budget.
+class URHO3D_API TextureStreamer : public Object
+{
+    OBJECT(TextureStreamer);
+    
+public:
+    /// Construct.
+    TextureStreamer(Context* context);
+    /// Destruct. Cancel or wait for pending reloads.
+    ~TextureStreamer();
+    
+    /// Set memory budget in bytes for the streamed textures. 0 is unlimited.
+    void SetMemoryBudget(unsigned budget) { memoryBudget_ = budget; }
+    /// Set size in pixels of the largest dimension a texture is initially loaded at. Default 64.
+    void SetMinSize(int size);
+    /// Set maximum number of reloads in progress at once. Default 2.
+    void SetMaxPendingReloads(unsigned reloads);
+    /// Set number of frames a texture keeps its resolution after it was last requested. Default 60.
+    void SetKeepFrames(unsigned frames) { keepFrames_ = frames; }
+    
+    /// Register a texture for streaming before its data is set from the image. Set the mip levels to skip on the initial load. Called by Texture2D.
+    void AddTexture(Texture2D* texture, Image* image);
+    /// Request a texture to be resident at a screen size in pixels on the current frame. Called by View.
+    void RequestTexture(Texture2D* texture, float screenSize, unsigned frameNumber);
+    /// Finish completed reloads and start new ones. Called by Renderer.
+    void Update(unsigned frameNumber);
+    
+    /// Return memory budget.
+    unsigned GetMemoryBudget() const { return memoryBudget_; }
+    /// Return initial load size.
+    int GetMinSize() const { return minSize_; }
+    /// Return maximum number of reloads in progress at once.
+    unsigned GetMaxPendingReloads() const { return maxPendingReloads_; }
+    /// Return number of frames a texture keeps its resolution after it was last requested.
+    unsigned GetKeepFrames() const { return keepFrames_; }
+    /// Return number of streamed textures.
+    unsigned GetNumTextures() const { return textures_.Size(); }
+    /// Return number of reloads in progress.
+    unsigned GetNumPendingReloads() const { return requests_.Size(); }
+    /// Return memory use of the streamed textures.
+    unsigned GetMemoryUse() const;
+    
+private:
+    /// Upload the reloaded images of completed requests.
+    void FinishRequests();
+    /// Choose the mip levels to skip for each texture from the requests and the memory budget.
+    void UpdateTargets(unsigned frameNumber);
+    /// Queue reloads of textures whose mip levels to skip differ from the target.
+    void StartRequests();
+    
+    /// Streamed textures.
+    HashMap<Texture2D*, StreamedTexture> textures_;
+    /// Reloads in progress.
+    Vector<SharedPtr<StreamingRequest> > requests_;
+    /// Memory budget.
+    unsigned memoryBudget_;
+    /// Initial load size.
+    int minSize_;
+    /// Maximum reloads in progress at once.
+    unsigned maxPendingReloads_;
+    /// Frames a texture keeps its resolution.
+    unsigned keepFrames_;
+};
+
+}
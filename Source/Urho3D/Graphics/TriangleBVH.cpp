@@ -0,0 +1,315 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Graphics/TriangleBVH.h"
+#include "../Math/Ray.h"
+#include "../Container/Swap.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned TRIANGLE_BVH_LEAF_SIZE = 4;
+
+static inline const Vector3& GetVertex(const unsigned char* vertices, unsigned vertexSize, unsigned index)
+{
+    return *((const Vector3*)(&vertices[index * vertexSize]));
+}
+
+TriangleBVH::TriangleBVH()
+{
+}
+
+void TriangleBVH::Build(const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount)
+{
+    Clear();
+
+    if (!vertexData || !indexData)
+        return;
+
+    indices_.Resize(indexCount / 3 * 3);
+
+    // 16-bit indices
+    if (indexSize == sizeof(unsigned short))
+    {
+        const unsigned short* indices = ((const unsigned short*)indexData) + indexStart;
+        for (unsigned i = 0; i < indices_.Size(); ++i)
+            indices_[i] = indices[i];
+    }
+    // 32-bit indices
+    else
+    {
+        const unsigned* indices = ((const unsigned*)indexData) + indexStart;
+        for (unsigned i = 0; i < indices_.Size(); ++i)
+            indices_[i] = indices[i];
+    }
+
+    BuildNodes((const unsigned char*)vertexData, vertexSize);
+}
+
+void TriangleBVH::Build(const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount)
+{
+    Clear();
+
+    if (!vertexData)
+        return;
+
+    indices_.Resize(vertexCount / 3 * 3);
+    for (unsigned i = 0; i < indices_.Size(); ++i)
+        indices_[i] = vertexStart + i;
+
+    BuildNodes((const unsigned char*)vertexData, vertexSize);
+}
+
+void TriangleBVH::Clear()
+{
+    nodes_.Clear();
+    indices_.Clear();
+    boxes_.Clear();
+    centers_.Clear();
+}
+
+float TriangleBVH::HitDistance(const Ray& ray, const void* vertexData, unsigned vertexSize, Vector3* outNormal) const
+{
+    float nearest = M_INFINITY;
+    if (vertexData && nodes_.Size() && ray.HitDistance(nodes_[0].box_) < M_INFINITY)
+        HitDistanceInternal(ray, (const unsigned char*)vertexData, vertexSize, 0, nearest, outNormal);
+    return nearest;
+}
+
+bool TriangleBVH::IsInside(const Ray& ray, const void* vertexData, unsigned vertexSize) const
+{
+    float frontFace = M_INFINITY;
+    float backFace = M_INFINITY;
+    if (vertexData && nodes_.Size() && ray.HitDistance(nodes_[0].box_) < M_INFINITY)
+        IsInsideInternal(ray, (const unsigned char*)vertexData, vertexSize, 0, frontFace, backFace);
+
+    // If the closest face is a backface, the ray originates from the inside of the geometry
+    if (frontFace != M_INFINITY || backFace != M_INFINITY)
+        return backFace < frontFace;
+    else
+        return false;
+}
+
+void TriangleBVH::BuildNodes(const unsigned char* vertices, unsigned vertexSize)
+{
+    unsigned numTriangles = indices_.Size() / 3;
+    if (!numTriangles)
+        return;
+
+    boxes_.Resize(numTriangles);
+    centers_.Resize(numTriangles);
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        BoundingBox& box = boxes_[i];
+        box.Clear();
+        box.Merge(GetVertex(vertices, vertexSize, indices_[i * 3]));
+        box.Merge(GetVertex(vertices, vertexSize, indices_[i * 3 + 1]));
+        box.Merge(GetVertex(vertices, vertexSize, indices_[i * 3 + 2]));
+        centers_[i] = box.Center();
+    }
+
+    // A balanced hierarchy with small leaves has less than half as many nodes as triangles
+    nodes_.Reserve(numTriangles / TRIANGLE_BVH_LEAF_SIZE * 2 + 1);
+    nodes_.Resize(1);
+    BuildNode(0, 0, numTriangles);
+
+    boxes_.Clear();
+    centers_.Clear();
+}
+
+void TriangleBVH::BuildNode(unsigned index, unsigned start, unsigned end)
+{
+    unsigned count = end - start;
+
+    if (count <= TRIANGLE_BVH_LEAF_SIZE)
+    {
+        TriangleBVHNode& node = nodes_[index];
+        node.first_ = start;
+        node.count_ = count;
+        node.box_.Clear();
+        for (unsigned i = start; i < end; ++i)
+            node.box_.Merge(boxes_[i]);
+        return;
+    }
+
+    // Split at the median along the longest axis of the centers to keep the hierarchy balanced
+    BoundingBox centerBox;
+    for (unsigned i = start; i < end; ++i)
+        centerBox.Merge(centers_[i]);
+
+    Vector3 size = centerBox.Size();
+    unsigned axis = 0;
+    if (size.y_ > size.x_)
+        axis = 1;
+    if (size.z_ > size.Data()[axis])
+        axis = 2;
+
+    unsigned mid = start + count / 2;
+    SelectNth(start, end, mid, axis);
+
+    // Allocate both children at once. Note that this may reallocate the node vector
+    unsigned child = nodes_.Size();
+    nodes_.Resize(child + 2);
+    nodes_[index].first_ = child;
+    nodes_[index].count_ = 0;
+    BuildNode(child, start, mid);
+    BuildNode(child + 1, mid, end);
+
+    nodes_[index].box_ = nodes_[child].box_;
+    nodes_[index].box_.Merge(nodes_[child + 1].box_);
+}
+
+void TriangleBVH::SelectNth(unsigned start, unsigned end, unsigned nth, unsigned axis)
+{
+    int low = start;
+    int high = end - 1;
+
+    while (low < high)
+    {
+        float pivot = centers_[(low + high) / 2].Data()[axis];
+        int i = low - 1;
+        int j = high + 1;
+
+        // Hoare partition: afterward [low, j] are not greater and [j + 1, high] are not less than the pivot
+        for (;;)
+        {
+            do
+                ++i;
+            while (centers_[i].Data()[axis] < pivot);
+            do
+                --j;
+            while (centers_[j].Data()[axis] > pivot);
+
+            if (i >= j)
+                break;
+
+            SwapTriangles(i, j);
+        }
+
+        if ((int)nth <= j)
+            high = j;
+        else
+            low = j + 1;
+    }
+}
+
+void TriangleBVH::SwapTriangles(unsigned first, unsigned second)
+{
+    Swap(boxes_[first], boxes_[second]);
+    Swap(centers_[first], centers_[second]);
+    Swap(indices_[first * 3], indices_[second * 3]);
+    Swap(indices_[first * 3 + 1], indices_[second * 3 + 1]);
+    Swap(indices_[first * 3 + 2], indices_[second * 3 + 2]);
+}
+
+void TriangleBVH::HitDistanceInternal(const Ray& ray, const unsigned char* vertices, unsigned vertexSize, unsigned index,
+    float& nearest, Vector3* outNormal) const
+{
+    const TriangleBVHNode& node = nodes_[index];
+
+    if (node.count_)
+    {
+        Vector3 normal;
+        const unsigned* indices = &indices_[node.first_ * 3];
+        const unsigned* indicesEnd = indices + node.count_ * 3;
+
+        while (indices < indicesEnd)
+        {
+            const Vector3& v0 = GetVertex(vertices, vertexSize, indices[0]);
+            const Vector3& v1 = GetVertex(vertices, vertexSize, indices[1]);
+            const Vector3& v2 = GetVertex(vertices, vertexSize, indices[2]);
+            float distance = ray.HitDistance(v0, v1, v2, outNormal ? &normal : 0);
+            if (distance < nearest)
+            {
+                nearest = distance;
+                if (outNormal)
+                    *outNormal = normal;
+            }
+            indices += 3;
+        }
+    }
+    else
+    {
+        // Visit the nearer child first so that the farther one can often be rejected by the hit found
+        unsigned nearChild = node.first_;
+        unsigned farChild = node.first_ + 1;
+        float nearDistance = ray.HitDistance(nodes_[nearChild].box_);
+        float farDistance = ray.HitDistance(nodes_[farChild].box_);
+        if (farDistance < nearDistance)
+        {
+            Swap(nearChild, farChild);
+            Swap(nearDistance, farDistance);
+        }
+
+        if (nearDistance < nearest)
+            HitDistanceInternal(ray, vertices, vertexSize, nearChild, nearest, outNormal);
+        if (farDistance < nearest)
+            HitDistanceInternal(ray, vertices, vertexSize, farChild, nearest, outNormal);
+    }
+}
+
+void TriangleBVH::IsInsideInternal(const Ray& ray, const unsigned char* vertices, unsigned vertexSize, unsigned index,
+    float& frontFace, float& backFace) const
+{
+    const TriangleBVHNode& node = nodes_[index];
+
+    if (node.count_)
+    {
+        const unsigned* indices = &indices_[node.first_ * 3];
+        const unsigned* indicesEnd = indices + node.count_ * 3;
+
+        while (indices < indicesEnd)
+        {
+            const Vector3& v0 = GetVertex(vertices, vertexSize, indices[0]);
+            const Vector3& v1 = GetVertex(vertices, vertexSize, indices[1]);
+            const Vector3& v2 = GetVertex(vertices, vertexSize, indices[2]);
+            float frontFaceDistance = ray.HitDistance(v0, v1, v2);
+            // A backface is a regular face with the vertices in the opposite order
+            float backFaceDistance = ray.HitDistance(v2, v1, v0);
+            frontFace = Min(frontFaceDistance > 0.0f ? frontFaceDistance : M_INFINITY, frontFace);
+            backFace = Min(backFaceDistance > 0.0f ? backFaceDistance : M_INFINITY, backFace);
+            indices += 3;
+        }
+    }
+    else
+    {
+        // A child can only change the result if it may contain a hit closer than either of the current faces
+        unsigned nearChild = node.first_;
+        unsigned farChild = node.first_ + 1;
+        float nearDistance = ray.HitDistance(nodes_[nearChild].box_);
+        float farDistance = ray.HitDistance(nodes_[farChild].box_);
+        if (farDistance < nearDistance)
+        {
+            Swap(nearChild, farChild);
+            Swap(nearDistance, farDistance);
+        }
+
+        if (nearDistance < Max(frontFace, backFace))
+            IsInsideInternal(ray, vertices, vertexSize, nearChild, frontFace, backFace);
+        if (farDistance < Max(frontFace, backFace))
+            IsInsideInternal(ray, vertices, vertexSize, farChild, frontFace, backFace);
+    }
+}
+
+}
@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+class Ray;
+
+/// Triangle bounding volume hierarchy node.
+struct TriangleBVHNode
+{
+    /// Local space bounding box of the node and its triangles.
+    BoundingBox box_;
+    /// Index of the first child node, or of the first triangle for a leaf node.
+    unsigned first_;
+    /// Number of triangles for a leaf node, zero for an internal node.
+    unsigned count_;
+};
+
+/// Bounding volume hierarchy of the triangles of a geometry, used to accelerate precise ray queries. Stores vertex indices only, so the vertex data must be supplied again for queries.
+class URHO3D_API TriangleBVH
+{
+public:
+    /// Construct empty.
+    TriangleBVH();
+
+    /// Build from indexed triangle list data.
+    void Build(const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount);
+    /// Build from non-indexed triangle list data.
+    void Build(const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
+    /// Remove all triangles and nodes.
+    void Clear();
+
+    /// Return ray hit distance to the nearest triangle or infinity if no hit. Optionally return hit normal.
+    float HitDistance(const Ray& ray, const void* vertexData, unsigned vertexSize, Vector3* outNormal = 0) const;
+    /// Return whether the ray originates from inside the triangles, ie. the closest triangle hit is a backface.
+    bool IsInside(const Ray& ray, const void* vertexData, unsigned vertexSize) const;
+    /// Return number of nodes.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return number of triangles.
+    unsigned GetNumTriangles() const { return indices_.Size() / 3; }
+    /// Return whether has no triangles.
+    bool IsEmpty() const { return nodes_.Empty(); }
+
+private:
+    /// Calculate triangle bounding boxes and build the nodes once the vertex indices have been collected.
+    void BuildNodes(const unsigned char* vertices, unsigned vertexSize);
+    /// Build a node from a range of triangles recursively.
+    void BuildNode(unsigned index, unsigned start, unsigned end);
+    /// Partially sort a range of triangles so that the nth one is at its sorted position along an axis.
+    void SelectNth(unsigned start, unsigned end, unsigned nth, unsigned axis);
+    /// Swap two triangles during build.
+    void SwapTriangles(unsigned first, unsigned second);
+    /// Return ray hit distance recursively.
+    void HitDistanceInternal(const Ray& ray, const unsigned char* vertices, unsigned vertexSize, unsigned index, float& nearest, Vector3* outNormal) const;
+    /// Return nearest front and back face hit distances recursively.
+    void IsInsideInternal(const Ray& ray, const unsigned char* vertices, unsigned vertexSize, unsigned index, float& frontFace, float& backFace) const;
+
+    /// Nodes. Children are always stored after their parent and next to each other.
+    PODVector<TriangleBVHNode> nodes_;
+    /// Vertex indices of the triangles in leaf node order, three per triangle.
+    PODVector<unsigned> indices_;
+    /// Triangle bounding boxes during build.
+    PODVector<BoundingBox> boxes_;
+    /// Triangle bounding box centers during build.
+    PODVector<Vector3> centers_;
+};
+
+}
@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../Math/AreaAllocator.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../IO/FileSystem.h"
@@ -42,6 +43,7 @@
 #include "../Graphics/Texture2D.h"
 #include "../Graphics/Texture3D.h"
 #include "../Graphics/TextureCube.h"
+#include "../Graphics/TextureStreamer.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../Graphics/View.h"
 #include "../UI/UI.h"
@@ -62,6 +64,15 @@ static const Vector3* directions[] =
     &Vector3::BACK
 };
 
+/// Nearest normalized depth of the light cluster grid's exponential depth slices.
+static const float MIN_CLUSTER_DEPTH = 0.0005f;
+/// Number of frames a shadow caster must stay unchanged before it is rendered into the shadow map cache.
+static const unsigned SHADOW_CACHE_STATIC_FRAMES = 30;
+/// Radius multiplier of the query sphere shared by a cull group, so that nearby views such as the other stereo eye fit inside it.
+static const float CULL_GROUP_SPHERE_MARGIN = 1.05f;
+/// Minimum number of visible geometries per base batch work item.
+static const unsigned MIN_BASE_BATCH_GEOMETRIES = 128;
+
 /// %Frustum octree query for shadowcasters.
 class ShadowCasterOctreeQuery : public FrustumOctreeQuery
 {
@@ -175,6 +186,7 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
     Vector3 absViewZ = viewZ.Abs();
     unsigned cameraViewMask = view->camera_->GetViewMask();
     bool cameraZoneOverride = view->cameraZoneOverride_;
+    bool gpuOcclusion = view->gpuOcclusion_;
     PerThreadSceneResult& result = view->sceneResults_[threadIndex];
     
     while (start != end)
@@ -183,6 +195,18 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
 
         if (!buffer || !drawable->IsOccludee() || buffer->IsVisible(drawable->GetWorldBoundingBox()))
         {
+            // Skip the drawable if its hardware occlusion query on the previous frame found it occluded. The queries are
+            // only read here; they are updated in the main thread after visibility checking
+            if (gpuOcclusion && drawable->GetOcclusionQuery() && drawable->IsOccludee() && (drawable->GetDrawableFlags() &
+                DRAWABLE_GEOMETRY))
+            {
+                result.occlusionQueryCandidates_.Push(drawable);
+                HashMap<Drawable*, DrawableOcclusionQuery>::ConstIterator i = view->occlusionQueries_.Find(drawable);
+                if (i != view->occlusionQueries_.End() && i->second_.occluded_ && i->second_.drawable_.Get() == drawable &&
+                    i->second_.lastFrameNumber_ + 1 == view->frame_.frameNumber_)
+                    continue;
+            }
+            
             drawable->UpdateBatches(view->frame_);
             // If draw distance non-zero, update and check it
             float maxDistance = drawable->GetDrawDistance();
@@ -241,6 +265,35 @@ void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
     view->ProcessLight(*query, threadIndex);
 }
 
+void BuildShadowBatchesWork(const WorkItem* item, unsigned threadIndex)
+{
+    View* view = reinterpret_cast<View*>(item->aux_);
+    LightQueryResult* query = reinterpret_cast<LightQueryResult*>(item->start_);
+    
+    view->BuildShadowBatches(*query, threadIndex);
+}
+
+void GetBaseBatchesWork(const WorkItem* item, unsigned threadIndex)
+{
+    View* view = reinterpret_cast<View*>(item->aux_);
+    BaseBatchResult* result = reinterpret_cast<BaseBatchResult*>(item->start_);
+    
+    for (Drawable** i = result->start_; i != result->end_; ++i)
+        view->AddBaseBatches(*i, result, threadIndex);
+}
+
+void AssignLightClustersWork(const WorkItem* item, unsigned threadIndex)
+{
+    View* view = reinterpret_cast<View*>(item->aux_);
+    view->AssignLightClusters(reinterpret_cast<unsigned char*>(item->start_), reinterpret_cast<unsigned char*>(item->end_));
+}
+
+void PackLightClustersWork(const WorkItem* item, unsigned threadIndex)
+{
+    View* view = reinterpret_cast<View*>(item->aux_);
+    view->PackLightClusters();
+}
+
 void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
 {
     const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
@@ -281,7 +334,180 @@ void SortShadowQueueWork(const WorkItem* item, unsigned threadIndex)
 {
     LightBatchQueue* start = reinterpret_cast<LightBatchQueue*>(item->start_);
     for (unsigned i = 0; i < start->shadowSplits_.Size(); ++i)
+    {
         start->shadowSplits_[i].shadowBatches_.SortFrontToBack();
+        start->shadowSplits_[i].staticBatches_.SortFrontToBack();
+    }
+}
+
+/// %Shadow atlas area request of a light.
+struct ShadowAtlasRequest
+{
+    /// Light query result.
+    LightQueryResult* query_;
+    /// Requested shadow map size.
+    IntVector2 size_;
+};
+
+/// Compare shadow atlas requests: the largest shadow maps first, as they cover the most screen space and are the hardest to fit. Ties go to the light closer to the camera.
+static bool CompareShadowAtlasRequests(const ShadowAtlasRequest& lhs, const ShadowAtlasRequest& rhs)
+{
+    int lhsArea = lhs.size_.x_ * lhs.size_.y_;
+    int rhsArea = rhs.size_.x_ * rhs.size_.y_;
+    if (lhsArea != rhsArea)
+        return lhsArea > rhsArea;
+    return lhs.query_->light_->GetDistance() < rhs.query_->light_->GetDistance();
+}
+
+/// Range of render path commands using a rendertarget during a view's rendering.
+struct RenderTargetLifetime
+{
+    /// Construct.
+    RenderTargetLifetime() :
+        index_(0),
+        first_(M_MAX_INT),
+        last_(-1),
+        readFirst_(false)
+    {
+    }
+
+    /// Index in the render path's rendertargets.
+    unsigned index_;
+    /// First command using the rendertarget.
+    int first_;
+    /// Last command using the rendertarget.
+    int last_;
+    /// Whether the first use reads the rendertarget, so it depends on earlier contents.
+    bool readFirst_;
+};
+
+/// Compare rendertarget lifetimes by first use.
+static bool CompareRenderTargetLifetimes(const RenderTargetLifetime& lhs, const RenderTargetLifetime& rhs)
+{
+    return lhs.first_ < rhs.first_;
+}
+
+/// Record the use of a named texture by a render path command.
+static void MarkRenderTargetUse(HashMap<StringHash, RenderTargetLifetime>& lifetimes, const String& name, int command, bool read)
+{
+    if (name.Empty())
+        return;
+
+    RenderTargetLifetime& lifetime = lifetimes[StringHash(name)];
+    if (command < lifetime.first_)
+    {
+        lifetime.first_ = command;
+        lifetime.readFirst_ = read;
+    }
+    lifetime.last_ = Max(lifetime.last_, command);
+}
+
+/// Return whether a render path command is the last use of a non-persistent rendertarget, so its contents can be discarded.
+static bool IsLastRenderTargetUse(const RenderPath* renderPath, const HashMap<StringHash, RenderTargetLifetime>& lifetimes,
+    const String& name, int command)
+{
+    if (name.Empty())
+        return false;
+    
+    StringHash nameHash(name);
+    HashMap<StringHash, RenderTargetLifetime>::ConstIterator i = lifetimes.Find(nameHash);
+    if (i == lifetimes.End() || i->second_.last_ != command)
+        return false;
+    
+    for (unsigned j = 0; j < renderPath->renderTargets_.Size(); ++j)
+    {
+        const RenderTargetInfo& rtInfo = renderPath->renderTargets_[j];
+        if (rtInfo.enabled_ && StringHash(rtInfo.name_) == nameHash)
+            return !rtInfo.persistent_;
+    }
+    
+    return false;
+}
+
+/// Return the light cluster grid depth slice of a normalized depth value.
+static int GetClusterSlice(float depth, float sliceScale, float sliceBias)
+{
+    if (depth <= MIN_CLUSTER_DEPTH)
+        return 0;
+    return Clamp((int)floorf(logf(depth) * sliceScale + sliceBias), 0, NUM_CLUSTERS_Z - 1);
+}
+
+/// Return the GPU profiling block name of a renderpath command: its tag, pass or shader if defined.
+static const char* GetGPUProfileName(const RenderPathCommand& command)
+{
+    if (!command.tag_.Empty())
+        return command.tag_.CString();
+    
+    switch (command.type_)
+    {
+    case CMD_CLEAR:
+        return "Clear";
+        
+    case CMD_SCENEPASS:
+        return command.pass_.CString();
+        
+    case CMD_QUAD:
+        return command.pixelShaderName_.Empty() ? "Quad" : command.pixelShaderName_.CString();
+        
+    case CMD_FORWARDLIGHTS:
+        return "ForwardLights";
+        
+    case CMD_LIGHTVOLUMES:
+        return "LightVolumes";
+        
+    case CMD_RENDERUI:
+        return "RenderUI";
+        
+    case CMD_DEPTHPYRAMID:
+        return "DepthPyramid";
+        
+    default:
+        return "Unknown";
+    }
+}
+
+/// Return the rendertarget name of a depth pyramid level. Level 0 uses the command's output name.
+static String GetDepthPyramidLevelName(const String& name, unsigned level)
+{
+    return level ? name + String(level) : name;
+}
+
+/// Return the number of depth pyramid levels for a view size. Each level halves the previous rounding up, until 1x1.
+static unsigned GetNumDepthPyramidLevels(const IntVector2& viewSize, unsigned maxLevels)
+{
+    unsigned levels = 1;
+    IntVector2 size = viewSize;
+    while ((size.x_ > 1 || size.y_ > 1) && (!maxLevels || levels < maxLevels))
+    {
+        size = IntVector2((size.x_ + 1) / 2, (size.y_ + 1) / 2);
+        ++levels;
+    }
+    return levels;
+}
+
+/// Run an octree query's drawable test on a cull group's shared octree query result.
+static void TestSharedDrawables(OctreeQuery& query, const PODVector<Drawable*>& drawables)
+{
+    query.result_.Clear();
+    if (drawables.Size())
+    {
+        Drawable** start = const_cast<Drawable**>(&drawables[0]);
+        query.TestDrawables(start, start + drawables.Size(), false);
+    }
+}
+
+/// Return the technique of a material that a batch pass belongs to, or null if not found.
+static Technique* GetPassTechnique(Material* material, Pass* pass)
+{
+    const Vector<TechniqueEntry>& techniques = material->GetTechniques();
+    for (unsigned i = 0; i < techniques.Size(); ++i)
+    {
+        Technique* tech = techniques[i].technique_;
+        if (tech && tech->GetPass(pass->GetIndex()) == pass)
+            return tech;
+    }
+    
+    return 0;
 }
 
 View::View(Context* context) :
@@ -294,17 +520,31 @@ View::View(Context* context) :
     cameraZone_(0),
     farClipZone_(0),
     renderTarget_(0),
-    substituteRenderTarget_(0)
+    substituteRenderTarget_(0),
+    shadowAtlas_(0),
+    gpuOcclusion_(false),
+    incrementalUpdate_(false),
+    lastDirShadows_(false),
+    maxUpdateInterval_(0),
+    cullGroup_(0),
+    lastCheckFrameNumber_(0),
+    lastUpdateFrameNumber_(0),
+    lastCamera_(0),
+    lastRenderPath_(0)
 {
     // Create octree query and scene results vector for each thread
     unsigned numThreads = GetSubsystem<WorkQueue>()->GetNumThreads() + 1; // Worker threads + main thread
     tempDrawables_.Resize(numThreads);
     sceneResults_.Resize(numThreads);
+    shadowResults_.Resize(numThreads);
+    baseBatchResults_.Resize(numThreads);
     frame_.camera_ = 0;
+    frame_.occlusionBuffer_ = 0;
 }
 
 View::~View()
 {
+    ReleaseOcclusionQueries();
 }
 
 bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
@@ -323,6 +563,7 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
 
     drawDebug_ = viewport->GetDrawDebug();
     hasScenePasses_ = false;
+    clusteredLighting_ = false;
     lightVolumeCommand_ = 0;
     
     // Make sure that all necessary batch queues exist
@@ -366,6 +607,14 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
             info.allowInstancing_ = command.sortMode_ != SORT_BACKTOFRONT;
             info.markToStencil_ = !noStencil_ && command.markToStencil_;
             info.vertexLights_ = command.vertexLights_;
+            #ifdef DESKTOP_GRAPHICS
+            info.clusteredLights_ = command.clusteredLights_;
+            #else
+            // The light cluster texture requires floating point textures
+            info.clusteredLights_ = false;
+            #endif
+            if (info.clusteredLights_)
+                clusteredLighting_ = true;
             
             // Check scenepass metadata for defining custom passes which interact with lighting
             if (!command.metadata_.Empty())
@@ -450,6 +699,10 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
             useLitBase_ = command.useLitBase_;
     }
     
+    // The clustered lights are added in the base pass, so it can not be replaced by a lit base pass
+    if (clusteredLighting_)
+        useLitBase_ = false;
+    
     // Validate the rect and calculate size. If zero rect, use whole rendertarget size
     int rtWidth = renderTarget ? renderTarget->GetWidth() : graphics_->GetWidth();
     int rtHeight = renderTarget ? renderTarget->GetHeight() : graphics_->GetHeight();
@@ -477,6 +730,15 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
     }
     #endif
     
+    // Backbuffer views can be rendered at a reduced resolution. The scene is then rendered to a substitute rendertarget,
+    // which is upscaled to the view rectangle at the end
+    float resolutionScale = renderer_->GetResolutionScale();
+    if (!renderTarget_ && resolutionScale < 1.0f)
+    {
+        viewSize_ = IntVector2(Max((int)(viewSize_.x_ * resolutionScale + 0.5f), 1), Max((int)(viewSize_.y_ *
+            resolutionScale + 0.5f), 1));
+    }
+    
     drawShadows_ = renderer_->GetDrawShadows();
     materialQuality_ = renderer_->GetMaterialQuality();
     maxOccluderTriangles_ = renderer_->GetMaxOccluderTriangles();
@@ -495,12 +757,25 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
     if (viewSize_.y_ > viewSize_.x_ * 4)
         maxOccluderTriangles_ = 0;
     
+    // Hardware occlusion queries test against the scene depth buffer, so they need scene passes
+    gpuOcclusion_ = hasScenePasses_ && renderer_->GetGPUOcclusion() && graphics_->GetOcclusionQuerySupport() &&
+        !(viewOverrideFlags & VO_DISABLE_OCCLUSION);
+    
+    // Incremental update relies on the rendertarget texture keeping the previous contents, so it is not possible on the
+    // backbuffer
+    incrementalUpdate_ = viewport->GetIncrementalUpdate() && renderTarget_;
+    maxUpdateInterval_ = viewport->GetMaxUpdateInterval();
+    cullGroup_ = viewport->GetCullGroup();
+    if (!incrementalUpdate_)
+        lastUpdateFrameNumber_ = 0;
+    
     return true;
 }
 
 void View::Update(const FrameInfo& frame)
 {
     frame_.camera_ = camera_;
+    frame_.occlusionBuffer_ = 0;
     frame_.timeStep_ = frame.timeStep_;
     frame_.frameNumber_ = frame.frameNumber_;
     frame_.viewSize_ = viewSize_;
@@ -523,7 +798,10 @@ void View::Update(const FrameInfo& frame)
     lights_.Clear();
     zones_.Clear();
     occluders_.Clear();
+    occlusionQueryDrawables_.Clear();
     vertexLightQueues_.Clear();
+    clusterLights_.Clear();
+    numClusterDataRows_ = 0;
     for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
         i->second_.Clear(maxSortedInstances);
     
@@ -539,10 +817,75 @@ void View::Update(const FrameInfo& frame)
     
     GetDrawables();
     GetBatches();
+    
+    // Store the state which the next incremental update check compares against
+    if (incrementalUpdate_)
+    {
+        lastUpdateFrameNumber_ = frame_.frameNumber_;
+        lastCamera_ = camera_;
+        lastRenderPath_ = renderPath_;
+        lastViewRect_ = viewRect_;
+        lastCameraView_ = camera_->GetView();
+        lastCameraProjection_ = camera_->GetProjection();
+        lastDirShadows_ = false;
+        lastShadowLightBoxes_.Clear();
+        for (Vector<LightBatchQueue>::ConstIterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+        {
+            if (i->shadowSplits_.Empty())
+                continue;
+            if (i->light_->GetLightType() == LIGHT_DIRECTIONAL)
+                lastDirShadows_ = true;
+            else
+                lastShadowLightBoxes_.Push(i->light_->GetWorldBoundingBox());
+        }
+    }
 
     renderer_->SendEvent(E_ENDVIEWUPDATE, eventData);
 }
 
+bool View::CheckUpdateNeeded(const FrameInfo& frame)
+{
+    if (!incrementalUpdate_)
+        return true;
+    
+    // Octree changes are only reported for the latest update, so the check must not have missed a frame
+    bool checkedLastFrame = lastCheckFrameNumber_ + 1 == frame.frameNumber_;
+    lastCheckFrameNumber_ = frame.frameNumber_;
+    if (!lastUpdateFrameNumber_ || !checkedLastFrame || !camera_ || !octree_)
+        return true;
+    if (maxUpdateInterval_ && frame.frameNumber_ - lastUpdateFrameNumber_ >= maxUpdateInterval_)
+        return true;
+    
+    Texture* texture = renderTarget_->GetParentTexture();
+    if (!texture || texture->IsDataLost())
+        return true;
+    
+    if (camera_ != lastCamera_ || renderPath_ != lastRenderPath_ || viewRect_ != lastViewRect_ || camera_->GetView() !=
+        lastCameraView_ || camera_->GetProjection() != lastCameraProjection_)
+        return true;
+    
+    const PODVector<BoundingBox>& changedBoxes = octree_->GetChangedBoxes();
+    if (changedBoxes.Empty())
+        return false;
+    // Directional light shadow casters may be anywhere
+    if (lastDirShadows_)
+        return true;
+    
+    const Frustum& frustum = camera_->GetFrustum();
+    for (PODVector<BoundingBox>::ConstIterator i = changedBoxes.Begin(); i != changedBoxes.End(); ++i)
+    {
+        if (frustum.IsInsideFast(*i) != OUTSIDE)
+            return true;
+        for (PODVector<BoundingBox>::ConstIterator j = lastShadowLightBoxes_.Begin(); j != lastShadowLightBoxes_.End(); ++j)
+        {
+            if (j->IsInsideFast(*i) != OUTSIDE)
+                return true;
+        }
+    }
+    
+    return false;
+}
+
 void View::Render()
 {
     if (hasScenePasses_ && (!octree_ || !camera_))
@@ -551,6 +894,14 @@ void View::Render()
     // Actually update geometry data now
     UpdateGeometries();
     
+    // Gather the skinning matrices of the view to the bone matrix texture in one upload
+    if (renderer_->GetTextureSkinning())
+        UpdateSkinMatrices();
+    
+    // Upload the light cluster grid built during the update
+    if (numClusterDataRows_)
+        renderer_->UpdateLightClusterTexture(&clusterData_[0], numClusterDataRows_);
+    
     // Allocate screen buffers as necessary
     AllocateScreenBuffers();
     
@@ -598,29 +949,35 @@ void View::Render()
     graphics_->SetScissorTest(false);
     graphics_->SetStencilTest(false);
 
-    // Draw the associated debug geometry now if enabled
-    if (drawDebug_ && octree_ && camera_)
+    // Render the hardware occlusion queries and the associated debug geometry now if enabled. Both need the scene depth
+    DebugRenderer* debug = (drawDebug_ && octree_ && camera_) ? octree_->GetComponent<DebugRenderer>() : 0;
+    if (debug && (!debug->IsEnabledEffective() || !debug->HasContent()))
+        debug = 0;
+    
+    if (debug || occlusionQueryDrawables_.Size())
     {
-        DebugRenderer* debug = octree_->GetComponent<DebugRenderer>();
-        if (debug && debug->IsEnabledEffective() && debug->HasContent())
+        // If used resolve from backbuffer, blit first to the backbuffer to ensure correct depth buffer on OpenGL
+        // Otherwise use the last rendertarget and blit after debug geometry
+        if (usedResolve_ && currentRenderTarget_ != renderTarget_)
         {
-            // If used resolve from backbuffer, blit first to the backbuffer to ensure correct depth buffer on OpenGL
-            // Otherwise use the last rendertarget and blit after debug geometry
-            if (usedResolve_ && currentRenderTarget_ != renderTarget_)
-            {
-                BlitFramebuffer(currentRenderTarget_->GetParentTexture(), renderTarget_, false);
-                currentRenderTarget_ = renderTarget_;
-            }
-
-            graphics_->SetRenderTarget(0, currentRenderTarget_);
-            for (unsigned i = 1; i < MAX_RENDERTARGETS; ++i)
-                graphics_->SetRenderTarget(i, (RenderSurface*)0);
-            graphics_->SetDepthStencil(GetDepthStencil(currentRenderTarget_));
-            IntVector2 rtSizeNow = graphics_->GetRenderTargetDimensions();
-            IntRect viewport = (currentRenderTarget_ == renderTarget_) ? viewRect_ : IntRect(0, 0, rtSizeNow.x_,
-                rtSizeNow.y_);
-            graphics_->SetViewport(viewport);
+            BlitFramebuffer(currentRenderTarget_->GetParentTexture(), renderTarget_, false);
+            currentRenderTarget_ = renderTarget_;
+        }
 
+        graphics_->SetRenderTarget(0, currentRenderTarget_);
+        for (unsigned i = 1; i < MAX_RENDERTARGETS; ++i)
+            graphics_->SetRenderTarget(i, (RenderSurface*)0);
+        graphics_->SetDepthStencil(GetDepthStencil(currentRenderTarget_));
+        IntVector2 rtSizeNow = graphics_->GetRenderTargetDimensions();
+        IntRect viewport = (currentRenderTarget_ == renderTarget_) ? viewRect_ : IntRect(0, 0, rtSizeNow.x_,
+            rtSizeNow.y_);
+        graphics_->SetViewport(viewport);
+        
+        if (occlusionQueryDrawables_.Size())
+            RenderOcclusionQueries();
+        
+        if (debug)
+        {
             debug->SetView(camera_);
             debug->Render();
         }
@@ -636,6 +993,10 @@ void View::Render()
     if (currentRenderTarget_ != renderTarget_)
         BlitFramebuffer(currentRenderTarget_->GetParentTexture(), renderTarget_, !usedResolve_);
     
+    // Save a requested frame capture while the camera and the visible objects are still known
+    if (!renderTarget_ && renderer_->IsFrameCapturePending())
+        renderer_->SaveFrameCapture(this);
+    
     // "Forget" the scene, camera, octree and zone after rendering
     scene_ = 0;
     camera_ = 0;
@@ -644,6 +1005,7 @@ void View::Render()
     farClipZone_ = 0;
     occlusionBuffer_ = 0;
     frame_.camera_ = 0;
+    frame_.occlusionBuffer_ = 0;
 }
 
 Graphics* View::GetGraphics() const
@@ -723,6 +1085,13 @@ void View::SetCameraShaderParameters(Camera* camera, bool setProjection)
         
         graphics_->SetShaderParameter(VSP_VIEWPROJ, projection * camera->GetView());
     }
+    
+    // The light cluster grid is only valid for the view's own camera
+    if (clusteredLighting_ && camera == camera_)
+    {
+        graphics_->SetShaderParameter(PSP_CLUSTERVIEWPROJ, clusterViewProj_);
+        graphics_->SetShaderParameter(PSP_CLUSTERPARAMS, clusterParams_);
+    }
 }
 
 void View::SetGBufferShaderParameters(const IntVector2& texSize, const IntRect& viewRect)
@@ -756,11 +1125,16 @@ void View::GetDrawables()
     
     WorkQueue* queue = GetSubsystem<WorkQueue>();
     PODVector<Drawable*>& tempDrawables = tempDrawables_[0];
+    // Views of a cull group cull the group's shared octree query result instead of querying the octree themselves
+    const PODVector<Drawable*>* sharedDrawables = cullGroup_ ? GetSharedDrawables() : 0;
     
     // Get zones and occluders first
     {
         ZoneOccluderOctreeQuery query(tempDrawables, camera_->GetFrustum(), DRAWABLE_GEOMETRY | DRAWABLE_ZONE, camera_->GetViewMask());
-        octree_->GetDrawables(query);
+        if (sharedDrawables)
+            TestSharedDrawables(query, *sharedDrawables);
+        else
+            octree_->GetDrawables(query);
     }
     
     highestZonePriority_ = M_MIN_INT;
@@ -828,15 +1202,24 @@ void View::GetDrawables()
     {
         OccludedFrustumOctreeQuery query(tempDrawables, camera_->GetFrustum(), occlusionBuffer_, DRAWABLE_GEOMETRY |
             DRAWABLE_LIGHT, camera_->GetViewMask());
-        octree_->GetDrawables(query);
+        if (sharedDrawables)
+            TestSharedDrawables(query, *sharedDrawables);
+        else
+            octree_->GetDrawables(query);
     }
     else
     {
         FrustumOctreeQuery query(tempDrawables, camera_->GetFrustum(), DRAWABLE_GEOMETRY | 
             DRAWABLE_LIGHT, camera_->GetViewMask());
-        octree_->GetDrawables(query);
+        if (sharedDrawables)
+            TestSharedDrawables(query, *sharedDrawables);
+        else
+            octree_->GetDrawables(query);
     }
     
+    // Read back the hardware occlusion queries of previous frames before the visibility check uses them
+    UpdateOcclusionQueries();
+    
     // Check drawable occlusion, find zones for moved drawables and collect geometries & lights in worker threads
     {
         for (unsigned i = 0; i < sceneResults_.Size(); ++i)
@@ -845,36 +1228,21 @@ void View::GetDrawables()
             
             result.geometries_.Clear();
             result.lights_.Clear();
+            result.occlusionQueryCandidates_.Clear();
             result.minZ_ = M_INFINITY;
             result.maxZ_ = 0.0f;
         }
         
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.Size() / numWorkItems;
-        
-        PODVector<Drawable*>::Iterator start = tempDrawables.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            PODVector<Drawable*>::Iterator end = tempDrawables.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-            
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-            
-            start = end;
-        }
-        
+        // Expose the occlusion buffer to drawables that cull parts of themselves, such as StaticModelGroup instances
+        frame_.occlusionBuffer_ = occlusionBuffer_;
+        queue->AddRangeWorkItems(tempDrawables, 0, CheckVisibilityWork, this);
         queue->Complete(M_MAX_UNSIGNED);
+        frame_.occlusionBuffer_ = 0;
     }
     
+    if (gpuOcclusion_)
+        QueueOcclusionQueries();
+    
     // Combine lights, geometries & scene Z range from the threads
     geometries_.Clear();
     lights_.Clear();
@@ -916,6 +1284,37 @@ void View::GetDrawables()
     Sort(lights_.Begin(), lights_.End(), CompareLights);
 }
 
+const PODVector<Drawable*>* View::GetSharedDrawables()
+{
+    SharedCullResult& result = renderer_->GetSharedCullResult(octree_, cullGroup_, camera_->GetViewMask());
+    const Frustum& frustum = camera_->GetFrustum();
+    
+    // The group's first view on the frame queries a sphere around its camera that encloses its frustum. Views sharing the
+    // camera position, such as the other faces of a cube texture, fit inside it
+    if (!result.sphere_.defined_)
+    {
+        PROFILE(GetSharedDrawables);
+        
+        Vector3 cameraPos = cameraNode_->GetWorldPosition();
+        float radius = 0.0f;
+        for (unsigned i = 0; i < NUM_FRUSTUM_VERTICES; ++i)
+            radius = Max(radius, (frustum.vertices_[i] - cameraPos).Length());
+        
+        result.sphere_.Define(cameraPos, radius * CULL_GROUP_SPHERE_MARGIN);
+        SphereOctreeQuery query(result.drawables_, result.sphere_, DRAWABLE_GEOMETRY | DRAWABLE_LIGHT | DRAWABLE_ZONE,
+            camera_->GetViewMask());
+        octree_->GetDrawables(query);
+    }
+    
+    for (unsigned i = 0; i < NUM_FRUSTUM_VERTICES; ++i)
+    {
+        if (result.sphere_.IsInside(frustum.vertices_[i]) == OUTSIDE)
+            return 0;
+    }
+    
+    return &result.drawables_;
+}
+
 void View::GetBatches()
 {
     if (!octree_ || !camera_)
@@ -926,7 +1325,13 @@ void View::GetBatches()
     
     ProcessLights();
     GetLightBatches();
+    if (clusteredLighting_)
+        BuildLightClusters();
     GetBaseBatches();
+    
+    // The light cluster work overlaps the base batch generation, make sure it has finished
+    if (clusteredLighting_)
+        GetSubsystem<WorkQueue>()->Complete(M_MAX_UNSIGNED);
 }
 
 void View::ProcessLights()
@@ -963,25 +1368,40 @@ void View::GetLightBatches()
     {
         PROFILE(GetLightBatches);
         
-        // Preallocate light queues: per-pixel lights which have lit geometries
+        // Preallocate light queues: per-pixel lights which have lit geometries. With clustered forward lighting, unshadowed
+        // point and spot lights are instead collected for the light cluster grid
         unsigned numLightQueues = 0;
         unsigned usedLightQueues = 0;
-        for (Vector<LightQueryResult>::ConstIterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+        for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
         {
-            if (!i->light_->GetPerVertex() && i->litGeometries_.Size())
+            Light* light = i->light_;
+            i->clustered_ = false;
+            if (light->GetPerVertex() || i->litGeometries_.Empty())
+                continue;
+            
+            if (clusteredLighting_ && light->GetLightType() != LIGHT_DIRECTIONAL && !i->numSplits_ && !light->IsNegative() &&
+                clusterLights_.Size() < MAX_CLUSTER_LIGHTS)
+            {
+                i->clustered_ = true;
+                clusterLights_.Push(light);
+            }
+            else
                 ++numLightQueues;
         }
         
         lightQueues_.Resize(numLightQueues);
         maxLightsDrawables_.Clear();
         unsigned maxSortedInstances = renderer_->GetMaxSortedInstances();
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        
+        AllocateShadowAtlas();
         
         for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
         {
             LightQueryResult& query = *i;
             
-            // If light has no affected geometries, no need to process further
-            if (query.litGeometries_.Empty())
+            // If light has no affected geometries or is shaded through the light cluster grid, no need to process further
+            if (query.litGeometries_.Empty() || query.clustered_)
                 continue;
             
             Light* light = query.light_;
@@ -997,17 +1417,57 @@ void View::GetLightBatches()
                 lightQueue.light_ = light;
                 lightQueue.negative_ = light->IsNegative();
                 lightQueue.shadowMap_ = 0;
+                lightQueue.shadowMapCache_ = 0;
+                lightQueue.shadowMapArea_ = IntRect::ZERO;
                 lightQueue.litBaseBatches_.Clear(maxSortedInstances);
                 lightQueue.litBatches_.Clear(maxSortedInstances);
                 lightQueue.volumeBatches_.Clear();
+                lightQueue.volumeGroupIndex_ = M_MAX_UNSIGNED;
                 
                 // Allocate shadow map now
                 if (shadowSplits > 0)
                 {
-                    lightQueue.shadowMap_ = renderer_->GetShadowMap(light, camera_, viewSize_.x_, viewSize_.y_);
-                    // If did not manage to get a shadow map, convert the light to unshadowed
+                    // When caching static shadow casters, use the cached shadow map directly if there are no other shadow
+                    // casters. Otherwise the cache is copied to a regular shadow map, which requires matching size
+                    ShadowMapCache* cache = query.shadowCached_ ? renderer_->GetShadowMapCache(light, camera_, viewSize_.x_,
+                        viewSize_.y_) : 0;
+                    bool dynamicCasters = false;
+                    if (cache)
+                    {
+                        for (PODVector<Drawable*>::ConstIterator j = query.shadowCasters_.Begin(); j != query.shadowCasters_.End();
+                            ++j)
+                        {
+                            if (!IsStaticShadowCaster(*j))
+                            {
+                                dynamicCasters = true;
+                                break;
+                            }
+                        }
+                    }
+                    
+                    if (cache && !dynamicCasters)
+                        lightQueue.shadowMap_ = cache->shadowMap_;
+                    else if (query.shadowAtlasArea_.Width())
+                    {
+                        lightQueue.shadowMap_ = shadowAtlas_;
+                        lightQueue.shadowMapArea_ = query.shadowAtlasArea_;
+                    }
+                    else
+                    {
+                        lightQueue.shadowMap_ = renderer_->GetShadowMap(light, camera_, viewSize_.x_, viewSize_.y_);
+                        if (cache && (!graphics_->GetDepthCopySupport() || !lightQueue.shadowMap_ ||
+                            lightQueue.shadowMap_->GetWidth() != cache->shadowMap_->GetWidth() ||
+                            lightQueue.shadowMap_->GetHeight() != cache->shadowMap_->GetHeight()))
+                            cache = 0;
+                    }
+                    lightQueue.shadowMapCache_ = cache;
+                    
+                    // If did not manage to get a shadow map, convert the light to unshadowed. Outside the shadow atlas the
+                    // light uses the whole shadow map
                     if (!lightQueue.shadowMap_)
                         shadowSplits = 0;
+                    else if (!lightQueue.shadowMapArea_.Width())
+                        lightQueue.shadowMapArea_ = IntRect(0, 0, lightQueue.shadowMap_->GetWidth(), lightQueue.shadowMap_->GetHeight());
                 }
                 
                 // Setup shadow batch queues
@@ -1020,51 +1480,22 @@ void View::GetLightBatches()
                     shadowQueue.nearSplit_ = query.shadowNearSplits_[j];
                     shadowQueue.farSplit_ = query.shadowFarSplits_[j];
                     shadowQueue.shadowBatches_.Clear(maxSortedInstances);
+                    shadowQueue.staticBatches_.Clear(maxSortedInstances);
                     
                     // Setup the shadow split viewport and finalize shadow camera parameters
-                    shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, lightQueue.shadowMap_);
+                    shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, lightQueue.shadowMapArea_);
                     FinalizeShadowCamera(shadowCamera, light, shadowQueue.shadowViewport_, query.shadowCasterBox_[j]);
-                    
-                    // Loop through shadow casters
-                    for (PODVector<Drawable*>::ConstIterator k = query.shadowCasters_.Begin() + query.shadowCasterBegin_[j];
-                        k < query.shadowCasters_.Begin() + query.shadowCasterEnd_[j]; ++k)
-                    {
-                        Drawable* drawable = *k;
-                        // If drawable is not in actual view frustum, mark it in view here and check its geometry update type
-                        if (!drawable->IsInView(frame_, true))
-                        {
-                            drawable->MarkInView(frame_.frameNumber_);
-                            UpdateGeometryType type = drawable->GetUpdateGeometryType();
-                            if (type == UPDATE_MAIN_THREAD)
-                                nonThreadedGeometries_.Push(drawable);
-                            else if (type == UPDATE_WORKER_THREAD)
-                                threadedGeometries_.Push(drawable);
-                        }
-                        
-                        Zone* zone = GetZone(drawable);
-                        const Vector<SourceBatch>& batches = drawable->GetBatches();
-                        
-                        for (unsigned l = 0; l < batches.Size(); ++l)
-                        {
-                            const SourceBatch& srcBatch = batches[l];
-                            
-                            Technique* tech = GetTechnique(drawable, srcBatch.material_);
-                            if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
-                                continue;
-                            
-                            Pass* pass = tech->GetSupportedPass(Technique::shadowPassIndex);
-                            // Skip if material has no shadow pass
-                            if (!pass)
-                                continue;
-                            
-                            Batch destBatch(srcBatch);
-                            destBatch.pass_ = pass;
-                            destBatch.camera_ = shadowCamera;
-                            destBatch.zone_ = zone;
-                            
-                            AddBatchToQueue(shadowQueue.shadowBatches_, destBatch, tech);
-                        }
-                    }
+                }
+                
+                // Build the shadow batches in a worker thread while the lit geometries are processed
+                if (shadowSplits)
+                {
+                    SharedPtr<WorkItem> item = queue->GetFreeItem();
+                    item->priority_ = M_MAX_UNSIGNED;
+                    item->workFunction_ = BuildShadowBatchesWork;
+                    item->aux_ = this;
+                    item->start_ = &query;
+                    queue->AddWorkItem(item);
                 }
                 
                 // Process lit geometries
@@ -1111,6 +1542,12 @@ void View::GetLightBatches()
                 }
             }
         }
+        
+        // Ensure all shadow batches have been built, then merge the per-thread results
+        queue->Complete(M_MAX_UNSIGNED);
+        MergeShadowResults();
+        
+        GetLightVolumeGroups();
     }
     
     // Process drawables with limited per-pixel light count
@@ -1136,10 +1573,86 @@ void View::GetLightBatches()
     }
 }
 
+void View::GetLightVolumeGroups()
+{
+    lightVolumeGroups_.Clear();
+    lightVolumeInstances_.Clear();
+    lightVolumeGroupKeys_.Clear();
+    lightVolumeAllocator_.Reset();
+    
+    if (!deferred_ || !renderer_->GetDynamicInstancing() || !graphics_->GetInstancingSupport())
+        return;
+    
+    PROFILE(GetLightVolumeGroups);
+    
+    // Reserve the instance data up front, as the group instances point to it
+    lightVolumeInstances_.Reserve(lightQueues_.Size());
+    Vector3 cameraPos = cameraNode_->GetWorldPosition();
+    
+    for (unsigned i = 0; i < lightQueues_.Size(); ++i)
+    {
+        LightBatchQueue& lightQueue = lightQueues_[i];
+        if (lightQueue.volumeBatches_.Size() != 1)
+            continue;
+        
+        // Only plain point lights can be instanced: spot lights need their projection matrix, and shadow maps, shape
+        // textures and custom ramp textures are per-light shader state
+        Light* light = lightQueue.light_;
+        if (light->GetLightType() != LIGHT_POINT || lightQueue.shadowMap_ || light->GetShapeTexture() ||
+            light->GetRampTexture())
+            continue;
+        
+        // Group by the render state chosen in SetupLightVolumeBatch() and the shader variation
+        Vector3 lightPos = light->GetNode()->GetWorldPosition();
+        float range = light->GetRange();
+        bool inside = Sphere(lightPos, range * 1.25f).Distance(cameraPos) < camera_->GetNearClip() * 2.0f;
+        bool specular = renderer_->GetSpecularLighting() && light->GetSpecularIntensity() > 0.0f;
+        unsigned long long key = ((unsigned long long)light->GetLightMask() << 3) | (light->IsNegative() ? 1 : 0) |
+            (specular ? 2 : 0) | (inside ? 4 : 0);
+        
+        unsigned groupIndex = 0;
+        while (groupIndex < lightVolumeGroupKeys_.Size() && lightVolumeGroupKeys_[groupIndex] != key)
+            ++groupIndex;
+        
+        if (groupIndex == lightVolumeGroups_.Size())
+        {
+            BatchGroup newGroup(lightQueue.volumeBatches_[0]);
+            newGroup.geometryType_ = GEOM_INSTANCED;
+            newGroup.instances_.SetAllocator(&lightVolumeAllocator_);
+            renderer_->SetLightVolumeBatchShaders(newGroup, lightVolumeCommand_->vertexShaderName_,
+                lightVolumeCommand_->pixelShaderName_, lightVolumeCommand_->vertexShaderDefines_,
+                lightVolumeCommand_->pixelShaderDefines_);
+            lightVolumeGroups_.Push(newGroup);
+            lightVolumeGroupKeys_.Push(key);
+        }
+        
+        // Same fade calculation as in Batch::Prepare()
+        float fade = 1.0f;
+        float fadeEnd = light->GetDrawDistance();
+        float fadeStart = light->GetFadeDistance();
+        if (fadeEnd > 0.0f && fadeStart > 0.0f && fadeStart < fadeEnd)
+            fade = Min(1.0f - (light->GetDistance() - fadeStart) / (fadeEnd - fadeStart), 1.0f);
+        Color color = Color(light->GetEffectiveColor().Abs(), light->GetEffectiveSpecularIntensity()) * fade;
+        
+        lightVolumeInstances_.Push(Matrix3x4(
+            lightPos.x_, lightPos.y_, lightPos.z_, range,
+            color.r_, color.g_, color.b_, color.a_,
+            1.0f / Max(range, M_EPSILON), 0.0f, 0.0f, 0.0f
+        ));
+        lightVolumeGroups_[groupIndex].instances_.Push(InstanceData(&lightVolumeInstances_.Back(), light->GetDistance()));
+        lightQueue.volumeGroupIndex_ = groupIndex;
+    }
+}
+
 void View::GetBaseBatches()
 {
     PROFILE(GetBaseBatches);
     
+    // For texture streaming, scale drawable size in world units (divided by distance if perspective) to screen pixels
+    TextureStreamer* streamer = renderer_->GetTextureStreamer();
+    float pixelScale = streamer ? (float)viewSize_.y_ * 0.5f / camera_->GetHalfViewSize() : 0.0f;
+    
+    // Collect geometry updates, texture streaming requests and auxiliary views on the main thread first
     for (PODVector<Drawable*>::ConstIterator i = geometries_.Begin(); i != geometries_.End(); ++i)
     {
         Drawable* drawable = *i;
@@ -1149,82 +1662,373 @@ void View::GetBaseBatches()
         else if (type == UPDATE_WORKER_THREAD)
             threadedGeometries_.Push(drawable);
         
-        const Vector<SourceBatch>& batches = drawable->GetBatches();
-        bool vertexLightsProcessed = false;
-
-        for (unsigned j = 0; j < batches.Size(); ++j)
+        const Vector<SourceBatch>& batches = drawable->GetViewBatches();
+        
+        if (streamer)
         {
-            const SourceBatch& srcBatch = batches[j];
-            
-            // Check here if the material refers to a rendertarget texture with camera(s) attached
-            // Only check this for backbuffer views (null rendertarget)
-            if (srcBatch.material_ && srcBatch.material_->GetAuxViewFrameNumber() != frame_.frameNumber_ && !renderTarget_)
-                CheckMaterialForAuxView(srcBatch.material_);
+            // Assume the textures cover the drawable's bounding box once
+            float screenSize = drawable->GetWorldBoundingBox().Size().Length() * pixelScale;
+            if (!camera_->IsOrthographic())
+                screenSize /= Max(drawable->GetDistance(), camera_->GetNearClip());
             
-            Technique* tech = GetTechnique(drawable, srcBatch.material_);
-            if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
-                continue;
-            
-            // Check each of the scene passes
-            for (unsigned k = 0; k < scenePasses_.Size(); ++k)
+            for (unsigned j = 0; j < batches.Size(); ++j)
             {
-                ScenePassInfo& info = scenePasses_[k];
-                // Skip forward base pass if the corresponding litbase pass already exists
-                if (info.passIndex_ == basePassIndex_ && j < 32 && drawable->HasBasePass(j))
-                    continue;
-
-                Pass* pass = tech->GetSupportedPass(info.passIndex_);
-                if (!pass)
-                    continue;
-                
-                Batch destBatch(srcBatch);
-                destBatch.pass_ = pass;
-                destBatch.camera_ = camera_;
-                destBatch.zone_ = GetZone(drawable);
-                destBatch.isBase_ = true;
-                destBatch.lightMask_ = GetLightMask(drawable);
-
-                if (info.vertexLights_)
-                {
-                    const PODVector<Light*>& drawableVertexLights = drawable->GetVertexLights();
-                    if (drawableVertexLights.Size() && !vertexLightsProcessed)
-                    {
-                        // Limit vertex lights. If this is a deferred opaque batch, remove converted per-pixel lights,
-                        // as they will be rendered as light volumes in any case, and drawing them also as vertex lights
-                        // would result in double lighting
-                        drawable->LimitVertexLights(deferred_ && destBatch.pass_->GetBlendMode() == BLEND_REPLACE);
-                        vertexLightsProcessed = true;
-                    }
-
-                    if (drawableVertexLights.Size())
-                    {
-                        // Find a vertex light queue. If not found, create new
-                        unsigned long long hash = GetVertexLightQueueHash(drawableVertexLights);
-                        HashMap<unsigned long long, LightBatchQueue>::Iterator i = vertexLightQueues_.Find(hash);
-                        if (i == vertexLightQueues_.End())
-                        {
-                            i = vertexLightQueues_.Insert(MakePair(hash, LightBatchQueue()));
-                            i->second_.light_ = 0;
-                            i->second_.shadowMap_ = 0;
-                            i->second_.vertexLights_ = drawableVertexLights;
-                        }
-                        
-                        destBatch.lightQueue_ = &(i->second_);
-                    }
-                }
-                else
-                    destBatch.lightQueue_ = 0;
-                
-                bool allowInstancing = info.allowInstancing_;
-                if (allowInstancing && info.markToStencil_ && destBatch.lightMask_ != (destBatch.zone_->GetLightMask() & 0xff))
-                    allowInstancing = false;
-                
-                AddBatchToQueue(*info.batchQueue_, destBatch, tech, allowInstancing);
+                if (batches[j].material_)
+                    RequestStreamedTextures(streamer, batches[j].material_, screenSize);
             }
         }
-    }
-}
-
+        
+        // Check here if the material refers to a rendertarget texture with camera(s) attached
+        // Only check this for backbuffer views (null rendertarget)
+        if (!renderTarget_)
+        {
+            for (unsigned j = 0; j < batches.Size(); ++j)
+            {
+                Material* material = batches[j].material_;
+                if (material && material->GetAuxViewFrameNumber() != frame_.frameNumber_)
+                    CheckMaterialForAuxView(material);
+            }
+        }
+    }
+    
+    // With enough geometries, build the batches in work items that each add to their own batch queues. The queues are merged
+    // in geometry order, so that the result does not depend on which threads ran the work items
+    unsigned numResults = Min((int)baseBatchResults_.Size(), (int)(geometries_.Size() / MIN_BASE_BATCH_GEOMETRIES));
+    if (numResults <= 1)
+    {
+        for (PODVector<Drawable*>::ConstIterator i = geometries_.Begin(); i != geometries_.End(); ++i)
+            AddBaseBatches(*i, 0, 0);
+        return;
+    }
+    
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    int maxSortedInstances = renderer_->GetMaxSortedInstances();
+    Drawable** start = geometries_.Begin().ptr_;
+    unsigned geometriesPerResult = geometries_.Size() / numResults;
+    
+    for (unsigned i = 0; i < numResults; ++i)
+    {
+        BaseBatchResult& result = baseBatchResults_[i];
+        result.start_ = start + i * geometriesPerResult;
+        result.end_ = i < numResults - 1 ? result.start_ + geometriesPerResult : geometries_.End().ptr_;
+        result.queues_.Resize(scenePasses_.Size());
+        for (unsigned j = 0; j < result.queues_.Size(); ++j)
+            result.queues_[j].Clear(maxSortedInstances);
+        result.deferred_.Clear();
+        
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = GetBaseBatchesWork;
+        item->aux_ = this;
+        item->start_ = &result;
+        queue->AddWorkItem(item);
+    }
+    
+    queue->Complete(M_MAX_UNSIGNED);
+    
+    for (unsigned i = 0; i < numResults; ++i)
+    {
+        BaseBatchResult& result = baseBatchResults_[i];
+        for (unsigned j = 0; j < scenePasses_.Size(); ++j)
+            MergeBaseBatches(*scenePasses_[j].batchQueue_, result.queues_[j]);
+    }
+    
+    // Finally add the batches that needed shaders loaded
+    for (unsigned i = 0; i < numResults; ++i)
+    {
+        PODVector<DeferredBaseBatches>& deferred = baseBatchResults_[i].deferred_;
+        for (PODVector<DeferredBaseBatches>::ConstIterator j = deferred.Begin(); j != deferred.End(); ++j)
+            AddBaseBatches(j->drawable_, 0, 0, j->firstBatch_, j->firstPass_, j->vertexLightsProcessed_);
+        deferred.Clear();
+    }
+}
+
+void View::AddBaseBatches(Drawable* drawable, BaseBatchResult* result, unsigned threadIndex, unsigned firstBatch,
+    unsigned firstPass, bool vertexLightsProcessed)
+{
+    const Vector<SourceBatch>& batches = drawable->GetViewBatches();
+    
+    for (unsigned j = firstBatch; j < batches.Size(); ++j)
+    {
+        const SourceBatch& srcBatch = batches[j];
+        
+        unsigned arrayLayer;
+        Material* material = GetArrayMaterial(srcBatch.material_, arrayLayer);
+        Technique* tech = GetTechnique(drawable, material);
+        if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
+            continue;
+        
+        // Check each of the scene passes
+        for (unsigned k = j == firstBatch ? firstPass : 0; k < scenePasses_.Size(); ++k)
+        {
+            ScenePassInfo& info = scenePasses_[k];
+            // Skip forward base pass if the corresponding litbase pass already exists
+            if (info.passIndex_ == basePassIndex_ && j < 32 && drawable->HasBasePass(j))
+                continue;
+
+            Pass* pass = tech->GetSupportedPass(info.passIndex_);
+            if (!pass)
+                continue;
+            
+            // Shaders can only be loaded on the main thread, so on worker threads leave the rest of the batches to it
+            if (threadIndex && !renderer_->GetPassShadersLoaded(pass))
+            {
+                DeferredBaseBatches deferred;
+                deferred.drawable_ = drawable;
+                deferred.firstBatch_ = j;
+                deferred.firstPass_ = k;
+                deferred.vertexLightsProcessed_ = vertexLightsProcessed;
+                result->deferred_.Push(deferred);
+                return;
+            }
+            
+            Batch destBatch(srcBatch);
+            destBatch.material_ = material;
+            destBatch.arrayLayer_ = arrayLayer;
+            destBatch.pass_ = pass;
+            destBatch.camera_ = camera_;
+            destBatch.zone_ = GetZone(drawable);
+            destBatch.isBase_ = true;
+            destBatch.clusteredLights_ = info.clusteredLights_;
+            destBatch.lightMask_ = GetLightMask(drawable);
+
+            if (info.vertexLights_)
+            {
+                const PODVector<Light*>& drawableVertexLights = drawable->GetVertexLights();
+                if (drawableVertexLights.Size() && !vertexLightsProcessed)
+                {
+                    // Limit vertex lights. If this is a deferred opaque batch, remove converted per-pixel lights,
+                    // as they will be rendered as light volumes in any case, and drawing them also as vertex lights
+                    // would result in double lighting
+                    drawable->LimitVertexLights(deferred_ && destBatch.pass_->GetBlendMode() == BLEND_REPLACE);
+                    vertexLightsProcessed = true;
+                }
+
+                if (drawableVertexLights.Size())
+                {
+                    // Find a vertex light queue. If not found, create new
+                    unsigned long long hash = GetVertexLightQueueHash(drawableVertexLights);
+                    MutexLock lock(vertexLightQueueMutex_);
+                    HashMap<unsigned long long, LightBatchQueue>::Iterator i = vertexLightQueues_.Find(hash);
+                    if (i == vertexLightQueues_.End())
+                    {
+                        i = vertexLightQueues_.Insert(MakePair(hash, LightBatchQueue()));
+                        i->second_.light_ = 0;
+                        i->second_.shadowMap_ = 0;
+                        i->second_.vertexLights_ = drawableVertexLights;
+                    }
+                    
+                    destBatch.lightQueue_ = &(i->second_);
+                }
+            }
+            else
+                destBatch.lightQueue_ = 0;
+            
+            bool allowInstancing = info.allowInstancing_;
+            if (allowInstancing && info.markToStencil_ && destBatch.lightMask_ != (destBatch.zone_->GetLightMask() & 0xff))
+                allowInstancing = false;
+            
+            AddBatchToQueue(result ? result->queues_[k] : *info.batchQueue_, destBatch, tech, allowInstancing);
+        }
+    }
+}
+
+void View::MergeBaseBatches(BatchQueue& dest, BatchQueue& src)
+{
+    dest.batches_.Push(src.batches_);
+    
+    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = src.batchGroups_.Begin(); i != src.batchGroups_.End(); ++i)
+    {
+        const BatchGroup& srcGroup = i->second_;
+        HashMap<BatchGroupKey, BatchGroup>::Iterator j = dest.batchGroups_.Find(i->first_);
+        if (j == dest.batchGroups_.End())
+        {
+            // Copy the instance data to the destination queue's allocator, as the source queue is cleared on the next frame
+            BatchGroup newGroup(static_cast<const Batch&>(srcGroup));
+            newGroup.instances_.SetAllocator(&dest.instanceAllocator_);
+            j = dest.batchGroups_.Insert(MakePair(i->first_, newGroup));
+            j->second_.instances_ = srcGroup.instances_;
+            continue;
+        }
+        
+        BatchGroup& destGroup = j->second_;
+        int oldSize = destGroup.instances_.Size();
+        for (unsigned k = 0; k < srcGroup.instances_.Size(); ++k)
+            destGroup.instances_.Push(srcGroup.instances_[k]);
+        
+        // Convert to using instancing shaders when the combined instances reach the instancing limit. The groups share the
+        // shader selection inputs, so if the source group already uses instancing shaders, they can be copied
+        if (oldSize < minInstances_ && (int)destGroup.instances_.Size() >= minInstances_ && destGroup.geometryType_ !=
+            GEOM_INSTANCED)
+        {
+            if (srcGroup.geometryType_ == GEOM_INSTANCED)
+            {
+                destGroup.geometryType_ = GEOM_INSTANCED;
+                destGroup.vertexShader_ = srcGroup.vertexShader_;
+                destGroup.pixelShader_ = srcGroup.pixelShader_;
+                destGroup.CalculateSortKey();
+            }
+            else
+            {
+                Technique* tech = GetPassTechnique(destGroup.material_, destGroup.pass_);
+                if (tech)
+                {
+                    destGroup.geometryType_ = GEOM_INSTANCED;
+                    renderer_->SetBatchShaders(destGroup, tech);
+                    destGroup.CalculateSortKey();
+                }
+            }
+        }
+    }
+}
+
+void View::BuildLightClusters()
+{
+    PROFILE(BuildLightClusters);
+    
+    const Matrix3x4& view = camera_->GetView();
+    const Matrix4& projection = camera_->GetProjection();
+    float farClip = camera_->GetFarClip();
+    
+    // Depth slices are distributed exponentially in normalized depth, which is the same for perspective and orthographic
+    // cameras as the latter have the near clip at zero
+    float minDepth = Max(camera_->GetNearClip() / farClip, MIN_CLUSTER_DEPTH);
+    float sliceScale = -(float)NUM_CLUSTERS_Z / logf(minDepth);
+    float sliceBias = (float)NUM_CLUSTERS_Z;
+    clusterViewProj_ = projection * view;
+    clusterParams_ = Vector4((float)NUM_CLUSTERS_X, (float)NUM_CLUSTERS_Y, sliceScale, sliceBias);
+    
+    clusterData_.Resize(LIGHT_CLUSTER_TEXTURE_WIDTH * LIGHT_CLUSTER_TEXTURE_HEIGHT);
+    clusterLightBounds_.Resize(clusterLights_.Size());
+    
+    for (unsigned i = 0; i < clusterLights_.Size(); ++i)
+    {
+        Light* light = clusterLights_[i];
+        Node* lightNode = light->GetNode();
+        LightType type = light->GetLightType();
+        
+        // Get the screen tile range from the projected light volume and the depth slice range from its view space bounds
+        BoundingBox viewBox(light->GetWorldBoundingBox().Transformed(view));
+        Rect rect;
+        if (type == LIGHT_SPOT)
+            rect = light->GetFrustum().Transformed(view).Projected(projection);
+        else
+            rect = viewBox.Projected(projection);
+        
+        LightClusterBounds& bounds = clusterLightBounds_[i];
+        bounds.minX_ = Clamp((int)floorf((rect.min_.x_ * 0.5f + 0.5f) * NUM_CLUSTERS_X), 0, NUM_CLUSTERS_X - 1);
+        bounds.maxX_ = Clamp((int)floorf((rect.max_.x_ * 0.5f + 0.5f) * NUM_CLUSTERS_X), 0, NUM_CLUSTERS_X - 1);
+        bounds.minY_ = Clamp((int)floorf((rect.min_.y_ * 0.5f + 0.5f) * NUM_CLUSTERS_Y), 0, NUM_CLUSTERS_Y - 1);
+        bounds.maxY_ = Clamp((int)floorf((rect.max_.y_ * 0.5f + 0.5f) * NUM_CLUSTERS_Y), 0, NUM_CLUSTERS_Y - 1);
+        bounds.minZ_ = GetClusterSlice(viewBox.min_.z_ / farClip, sliceScale, sliceBias);
+        bounds.maxZ_ = GetClusterSlice(viewBox.max_.z_ / farClip, sliceScale, sliceBias);
+        
+        // Store the light parameters in the vertex light layout, followed by the specular intensity
+        float invRange = 1.0f / Max(light->GetRange(), M_EPSILON);
+        float cutoff = -1.0f;
+        float invCutoff = 1.0f;
+        Vector3 direction = Vector3::ZERO;
+        if (type == LIGHT_SPOT)
+        {
+            cutoff = Cos(light->GetFov() * 0.5f);
+            invCutoff = 1.0f / (1.0f - cutoff);
+            direction = -lightNode->GetWorldDirection();
+        }
+        
+        float fade = 1.0f;
+        float fadeEnd = light->GetDrawDistance();
+        float fadeStart = light->GetFadeDistance();
+        if (fadeEnd > 0.0f && fadeStart > 0.0f && fadeStart < fadeEnd)
+            fade = Min(1.0f - (light->GetDistance() - fadeStart) / (fadeEnd - fadeStart), 1.0f);
+        
+        Color color = light->GetEffectiveColor() * fade;
+        float specIntensity = renderer_->GetSpecularLighting() ? light->GetSpecularIntensity() : 0.0f;
+        Vector4* lightData = &clusterData_[i * 4];
+        lightData[0] = Vector4(color.r_, color.g_, color.b_, invRange);
+        lightData[1] = Vector4(direction, cutoff);
+        lightData[2] = Vector4(lightNode->GetWorldPosition(), invCutoff);
+        lightData[3] = Vector4(specIntensity, 0.0f, 0.0f, 0.0f);
+    }
+    
+    // Assign the lights to clusters in parallel, at least one depth slice per work item. The texture data is packed in a work
+    // item that depends on all of them, so the main thread goes on to the base batches instead of waiting
+    clusterLightCounts_.Resize(NUM_CLUSTERS);
+    clusterLightIndices_.Resize(NUM_CLUSTERS * MAX_LIGHTS_PER_CLUSTER);
+    
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned char* begin = &clusterLightCounts_[0];
+    unsigned char* end = begin + NUM_CLUSTERS;
+    unsigned chunkSize = queue->GetChunkSize(NUM_CLUSTERS, NUM_CLUSTERS_X * NUM_CLUSTERS_Y);
+    
+    SharedPtr<WorkItem> packItem = queue->GetFreeItem();
+    packItem->priority_ = M_MAX_UNSIGNED;
+    packItem->workFunction_ = PackLightClustersWork;
+    packItem->aux_ = this;
+    
+    Vector<SharedPtr<WorkItem> > assignItems;
+    for (unsigned char* start = begin; start < end; start += chunkSize)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = AssignLightClustersWork;
+        item->aux_ = this;
+        item->start_ = start;
+        item->end_ = (unsigned)(end - start) > chunkSize ? start + chunkSize : end;
+        queue->AddDependency(packItem, item);
+        assignItems.Push(item);
+    }
+    
+    for (unsigned i = 0; i < assignItems.Size(); ++i)
+        queue->AddWorkItem(assignItems[i]);
+    queue->AddWorkItem(packItem);
+}
+
+void View::AssignLightClusters(unsigned char* start, unsigned char* end)
+{
+    for (unsigned char* count = start; count < end; ++count)
+    {
+        int cluster = (int)(count - &clusterLightCounts_[0]);
+        int x = cluster % NUM_CLUSTERS_X;
+        int y = (cluster / NUM_CLUSTERS_X) % NUM_CLUSTERS_Y;
+        int z = cluster / (NUM_CLUSTERS_X * NUM_CLUSTERS_Y);
+        unsigned char* indices = &clusterLightIndices_[cluster * MAX_LIGHTS_PER_CLUSTER];
+        unsigned numLights = 0;
+        
+        for (unsigned i = 0; i < clusterLightBounds_.Size() && numLights < MAX_LIGHTS_PER_CLUSTER; ++i)
+        {
+            const LightClusterBounds& bounds = clusterLightBounds_[i];
+            if (z >= bounds.minZ_ && z <= bounds.maxZ_ && y >= bounds.minY_ && y <= bounds.maxY_ && x >= bounds.minX_ &&
+                x <= bounds.maxX_)
+                indices[numLights++] = (unsigned char)i;
+        }
+        
+        *count = (unsigned char)numLights;
+    }
+}
+
+void View::PackLightClusters()
+{
+    // Write the cluster grid and the compacted light index lists. Lists which do not fit anymore are truncated
+    Vector4* grid = &clusterData_[LIGHT_CLUSTER_GRID_ROW * LIGHT_CLUSTER_TEXTURE_WIDTH];
+    Vector4* indexData = &clusterData_[LIGHT_CLUSTER_INDEX_ROW * LIGHT_CLUSTER_TEXTURE_WIDTH];
+    unsigned maxIndices = (LIGHT_CLUSTER_TEXTURE_HEIGHT - LIGHT_CLUSTER_INDEX_ROW) * LIGHT_CLUSTER_TEXTURE_WIDTH;
+    unsigned numIndices = 0;
+    
+    for (unsigned i = 0; i < NUM_CLUSTERS; ++i)
+    {
+        unsigned count = clusterLightCounts_[i];
+        if (count > maxIndices - numIndices)
+            count = maxIndices - numIndices;
+        
+        grid[i] = Vector4((float)numIndices, (float)count, 0.0f, 0.0f);
+        const unsigned char* indices = &clusterLightIndices_[i * MAX_LIGHTS_PER_CLUSTER];
+        for (unsigned j = 0; j < count; ++j)
+            indexData[numIndices++] = Vector4((float)indices[j], 0.0f, 0.0f, 0.0f);
+    }
+    
+    numClusterDataRows_ = LIGHT_CLUSTER_INDEX_ROW + (numIndices + LIGHT_CLUSTER_TEXTURE_WIDTH - 1) / LIGHT_CLUSTER_TEXTURE_WIDTH;
+}
+
 void View::UpdateGeometries()
 {
     PROFILE(SortAndUpdateGeometry);
@@ -1284,26 +2088,7 @@ void View::UpdateGeometries()
                 }
             }
             
-            int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-            int drawablesPerItem = threadedGeometries_.Size() / numWorkItems;
-            
-            PODVector<Drawable*>::Iterator start = threadedGeometries_.Begin();
-            for (int i = 0; i < numWorkItems; ++i)
-            {
-                PODVector<Drawable*>::Iterator end = threadedGeometries_.End();
-                if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                    end = start + drawablesPerItem;
-                
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = UpdateDrawableGeometriesWork;
-                item->aux_ = const_cast<FrameInfo*>(&frame_);
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-                
-                start = end;
-            }
+            queue->AddRangeWorkItems(threadedGeometries_, 0, UpdateDrawableGeometriesWork, const_cast<FrameInfo*>(&frame_));
         }
         
         // While the work queue is processed, update non-threaded geometries
@@ -1319,7 +2104,7 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
 {
     Light* light = lightQueue.light_;
     Zone* zone = GetZone(drawable);
-    const Vector<SourceBatch>& batches = drawable->GetBatches();
+    const Vector<SourceBatch>& batches = drawable->GetViewBatches();
     
     bool allowLitBase = useLitBase_ && !lightQueue.negative_ && light == drawable->GetFirstLight() &&
         drawable->GetVertexLights().Empty() && !zone->GetAmbientGradient();
@@ -1328,7 +2113,9 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
     {
         const SourceBatch& srcBatch = batches[i];
         
-        Technique* tech = GetTechnique(drawable, srcBatch.material_);
+        unsigned arrayLayer;
+        Material* material = GetArrayMaterial(srcBatch.material_, arrayLayer);
+        Technique* tech = GetTechnique(drawable, material);
         if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
             continue;
         
@@ -1337,6 +2124,8 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
             continue;
         
         Batch destBatch(srcBatch);
+        destBatch.material_ = material;
+        destBatch.arrayLayer_ = arrayLayer;
         bool isLitAlpha = false;
         
         // Check for lit base pass. Because it uses the replace blend mode, it must be ensured to be the first light
@@ -1380,14 +2169,20 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
         else if (alphaQueue)
         {
             // Transparent batches can not be instanced, and shadows on transparencies can only be rendered if shadow maps are
-            // not reused
-            AddBatchToQueue(*alphaQueue, destBatch, tech, false, !renderer_->GetReuseShadowMaps());
+            // not reused, or the shadow map is in the shadow atlas
+            bool allowShadows = !renderer_->GetReuseShadowMaps() || (lightQueue.shadowMap_ && lightQueue.shadowMap_ ==
+                shadowAtlas_);
+            AddBatchToQueue(*alphaQueue, destBatch, tech, false, allowShadows);
         }
     }
 }
 
 void View::ExecuteRenderPathCommands()
 {
+    // The shadow atlas holds the shadow maps of several lights, so render all of them first
+    if (shadowAtlas_)
+        RenderShadowAtlas();
+    
     // If not reusing shadowmaps, render all of them first
     if (!renderer_->GetReuseShadowMaps() && renderer_->GetDrawShadows() && !lightQueues_.Empty())
     {
@@ -1395,7 +2190,7 @@ void View::ExecuteRenderPathCommands()
         
         for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
         {
-            if (i->shadowMap_)
+            if (i->shadowMap_ && i->shadowMap_ != shadowAtlas_)
                 RenderShadowMap(*i);
         }
     }
@@ -1497,6 +2292,10 @@ void View::ExecuteRenderPathCommands()
                     currentRenderTarget_ = substituteRenderTarget_ ? substituteRenderTarget_ : renderTarget_;
             }
 
+            // Time each command separately when GPU profiling is enabled
+            graphics_->BeginGPUProfileBlock(GetGPUProfileName(command));
+            renderTargetsSet_ = false;
+            
             switch (command.type_)
             {
             case CMD_CLEAR:
@@ -1521,6 +2320,10 @@ void View::ExecuteRenderPathCommands()
                         
                         SetRenderTargets(command);
                         bool allowDepthWrite = SetTextures(command);
+                        #ifdef DESKTOP_GRAPHICS
+                        if (command.clusteredLights_)
+                            graphics_->SetTexture(TU_LIGHTCLUSTERS, renderer_->GetLightClusterTexture());
+                        #endif
                         graphics_->SetClipPlane(camera_->GetUseClipping(), camera_->GetClipPlane(), camera_->GetView(), camera_->GetProjection());
                         queue.Draw(this, command.markToStencil_, false, allowDepthWrite);
                     }
@@ -1531,9 +2334,14 @@ void View::ExecuteRenderPathCommands()
                 {
                     PROFILE(RenderQuad);
                     
-                    SetRenderTargets(command);
-                    SetTextures(command);
-                    RenderQuad(command);
+                    if (command.resolutionScale_ < 1.0f && command.outputs_.Size() == 1)
+                        RenderScaledQuad(command);
+                    else
+                    {
+                        SetRenderTargets(command);
+                        SetTextures(command);
+                        RenderQuad(command);
+                    }
                 }
                 break;
                 
@@ -1548,7 +2356,7 @@ void View::ExecuteRenderPathCommands()
                     for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
                     {
                         // If reusing shadowmaps, render each of them before the lit batches
-                        if (renderer_->GetReuseShadowMaps() && i->shadowMap_)
+                        if (renderer_->GetReuseShadowMaps() && i->shadowMap_ && i->shadowMap_ != shadowAtlas_)
                         {
                             RenderShadowMap(*i);
                             SetRenderTargets(command);
@@ -1585,7 +2393,7 @@ void View::ExecuteRenderPathCommands()
                     for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
                     {
                         // If reusing shadowmaps, render each of them before the lit batches
-                        if (renderer_->GetReuseShadowMaps() && i->shadowMap_)
+                        if (renderer_->GetReuseShadowMaps() && i->shadowMap_ && i->shadowMap_ != shadowAtlas_)
                         {
                             RenderShadowMap(*i);
                             SetRenderTargets(command);
@@ -1593,6 +2401,11 @@ void View::ExecuteRenderPathCommands()
                         
                         SetTextures(command);
                         
+                        // Skip lights which are drawn as part of an instanced light volume group
+                        if (i->volumeGroupIndex_ != M_MAX_UNSIGNED &&
+                            lightVolumeGroups_[i->volumeGroupIndex_].startIndex_ != M_MAX_UNSIGNED)
+                            continue;
+                        
                         for (unsigned j = 0; j < i->volumeBatches_.Size(); ++j)
                         {
                             SetupLightVolumeBatch(i->volumeBatches_[j]);
@@ -1600,11 +2413,25 @@ void View::ExecuteRenderPathCommands()
                         }
                     }
                     
+                    for (Vector<BatchGroup>::Iterator i = lightVolumeGroups_.Begin(); i != lightVolumeGroups_.End(); ++i)
+                    {
+                        if (i->startIndex_ == M_MAX_UNSIGNED)
+                            continue;
+                        
+                        SetTextures(command);
+                        SetupLightVolumeBatch(*i);
+                        i->Draw(this, false);
+                    }
+                    
                     graphics_->SetScissorTest(false);
                     graphics_->SetStencilTest(false);
                 }
                 break;
             
+            case CMD_DEPTHPYRAMID:
+                RenderDepthPyramid(command);
+                break;
+                
             case CMD_RENDERUI:
                 {
                     SetRenderTargets(command);
@@ -1615,6 +2442,13 @@ void View::ExecuteRenderPathCommands()
             default:
                 break;
             }
+            
+            // Discard the contents which are not needed after this command. Skip if the command rendered nothing, in which
+            // case the framebuffer still belongs to an earlier command
+            if (renderTargetsSet_ && i < discardFlags_.Size() && discardFlags_[i])
+                graphics_->DiscardFramebuffer(discardFlags_[i]);
+            
+            graphics_->EndGPUProfileBlock();
 
             // If current command output to the viewport, mark it modified
             if (viewportWrite)
@@ -1625,6 +2459,7 @@ void View::ExecuteRenderPathCommands()
 
 void View::SetRenderTargets(RenderPathCommand& command)
 {
+    renderTargetsSet_ = true;
     unsigned index = 0;
     bool useColorWrite = true;
     bool useCustomDepth = false;
@@ -1783,6 +2618,14 @@ void View::RenderQuad(RenderPathCommand& command)
         graphics_->SetShaderParameter(offsetsName, Vector2(pixelUVOffset.x_ / width, pixelUVOffset.y_ / height));
     }
     
+    // Depth pyramid levels are not defined by the renderpath, but expose their inverse sizes the same way
+    for (unsigned i = 0; i < depthPyramidTargets_.Size(); ++i)
+    {
+        Texture* texture = renderTargets_[depthPyramidTargets_[i]];
+        graphics_->SetShaderParameter(depthPyramidTargets_[i] + "InvSize", Vector2(1.0f / (float)texture->GetWidth(),
+            1.0f / (float)texture->GetHeight()));
+    }
+    
     graphics_->SetBlendMode(command.blendMode_);
     graphics_->SetDepthTest(CMP_ALWAYS);
     graphics_->SetDepthWrite(false);
@@ -1794,6 +2637,144 @@ void View::RenderQuad(RenderPathCommand& command)
     DrawFullscreenQuad(false);
 }
 
+void View::RenderScaledQuad(RenderPathCommand& command)
+{
+    if (command.vertexShaderName_.Empty() || command.pixelShaderName_.Empty())
+        return;
+    
+    // Find out the actual destination, then render the quad into a reduced size buffer of the same format instead
+    SetRenderTargets(command);
+    RenderSurface* destination = graphics_->GetRenderTarget(0);
+    IntRect destRect = graphics_->GetViewport();
+    IntVector2 destSize(destRect.Width(), destRect.Height());
+    Texture* destTexture = destination ? destination->GetParentTexture() : (Texture*)0;
+    
+    IntVector2 size(Max((int)(destSize.x_ * command.resolutionScale_ + 0.5f), 1), Max((int)(destSize.y_ *
+        command.resolutionScale_ + 0.5f), 1));
+    Texture* buffer = renderer_->GetScreenBuffer(size.x_, size.y_, destTexture ? destTexture->GetFormat() :
+        Graphics::GetRGBFormat(), false, true, destTexture ? destTexture->GetSRGB() : graphics_->GetSRGB());
+    RenderSurface* bufferSurface = GetRenderSurfaceFromTexture(buffer);
+    
+    graphics_->SetRenderTarget(0, bufferSurface);
+    graphics_->SetDepthStencil(GetDepthStencil(bufferSurface));
+    graphics_->SetViewport(IntRect(0, 0, size.x_, size.y_));
+    SetTextures(command);
+    
+    // The command's blend mode is used when upsampling into the destination
+    BlendMode blendMode = command.blendMode_;
+    command.blendMode_ = BLEND_REPLACE;
+    RenderQuad(command);
+    command.blendMode_ = blendMode;
+    
+    // Upsample with depth-aware weights if a depth texture is given, so that edges of the reduced resolution result do not
+    // bleed across depth discontinuities. Otherwise upsample bilinearly
+    Texture* depthTexture = 0;
+    #ifdef DESKTOP_GRAPHICS
+    if (!command.upsampleDepthName_.Empty())
+        depthTexture = FindNamedTexture(command.upsampleDepthName_, false, false);
+    #endif
+    
+    graphics_->SetRenderTarget(0, destination);
+    graphics_->SetDepthStencil(GetDepthStencil(destination));
+    graphics_->SetViewport(destRect);
+    
+    #ifdef DESKTOP_GRAPHICS
+    if (depthTexture)
+    {
+        static const String upsampleShaderName("BilateralUpsample");
+        graphics_->SetShaders(graphics_->GetShader(VS, upsampleShaderName), graphics_->GetShader(PS, upsampleShaderName,
+            depthTexture->GetFormat() == Graphics::GetReadableDepthFormat() ? "HWDEPTH" : ""));
+        SetCameraShaderParameters(camera_, false);
+        graphics_->SetShaderParameter(PSP_UPSAMPLEINVSIZE, Vector2(1.0f / (float)size.x_, 1.0f / (float)size.y_));
+        graphics_->SetTexture(TU_DEPTHBUFFER, depthTexture);
+    }
+    else
+    #endif
+    {
+        static const String copyShaderName("CopyFramebuffer");
+        graphics_->SetShaders(graphics_->GetShader(VS, copyShaderName), graphics_->GetShader(PS, copyShaderName));
+    }
+    
+    // Address the destination pixel centers, which is also where the viewport-sized depth texture is sampled
+    SetGBufferShaderParameters(destSize, IntRect(0, 0, destSize.x_, destSize.y_));
+    graphics_->SetTexture(TU_DIFFUSE, buffer);
+    
+    graphics_->SetBlendMode(blendMode);
+    graphics_->SetDepthTest(CMP_ALWAYS);
+    graphics_->SetDepthWrite(false);
+    
+    DrawFullscreenQuad(false);
+}
+
+void View::RenderDepthPyramid(RenderPathCommand& command)
+{
+    // The depth pyramid levels are only allocated on desktop graphics
+    #ifdef DESKTOP_GRAPHICS
+    const String& name = command.outputs_[0].first_;
+    Texture* source = FindNamedTexture(command.textureNames_[TU_DEPTHBUFFER], false, false);
+    if (!source || !renderTargets_.Contains(name))
+        return;
+    
+    // The first level copies the depth texture, the rest take the min & max of 2x2 texel blocks from the previous level
+    static const String defaultShaderName("DepthPyramid");
+    const String& vsName = command.vertexShaderName_.Empty() ? defaultShaderName : command.vertexShaderName_;
+    const String& psName = command.pixelShaderName_.Empty() ? defaultShaderName : command.pixelShaderName_;
+    String firstDefines = source->GetFormat() == Graphics::GetReadableDepthFormat() ? "FIRSTLEVEL HWDEPTH " : "FIRSTLEVEL ";
+    ShaderVariation* vs = graphics_->GetShader(VS, vsName, command.vertexShaderDefines_);
+    ShaderVariation* firstPS = graphics_->GetShader(PS, psName, firstDefines + command.pixelShaderDefines_);
+    ShaderVariation* downsamplePS = graphics_->GetShader(PS, psName, command.pixelShaderDefines_);
+    
+    graphics_->SetBlendMode(BLEND_REPLACE);
+    graphics_->SetDepthTest(CMP_ALWAYS);
+    graphics_->SetDepthWrite(false);
+    graphics_->SetFillMode(FILL_SOLID);
+    graphics_->SetClipPlane(false);
+    graphics_->SetScissorTest(false);
+    graphics_->SetStencilTest(false);
+    graphics_->SetColorWrite(true);
+    for (unsigned i = 1; i < MAX_RENDERTARGETS; ++i)
+        graphics_->SetRenderTarget(i, (RenderSurface*)0);
+    
+    unsigned numLevels = GetNumDepthPyramidLevels(viewSize_, command.depthPyramidLevels_);
+    for (unsigned i = 0; i < numLevels; ++i)
+    {
+        HashMap<StringHash, Texture*>::ConstIterator j = renderTargets_.Find(GetDepthPyramidLevelName(name, i));
+        if (j == renderTargets_.End())
+            break;
+        
+        Texture* dest = j->second_;
+        RenderSurface* destSurface = GetRenderSurfaceFromTexture(dest);
+        IntVector2 destSize(dest->GetWidth(), dest->GetHeight());
+        
+        graphics_->SetTexture(TU_DIFFUSE, 0);
+        graphics_->SetTexture(TU_DEPTHBUFFER, 0);
+        graphics_->SetRenderTarget(0, destSurface);
+        // The renderer's pooled depth-stencil could be the sampled depth texture itself, so render without one where possible
+        #if !defined(URHO3D_OPENGL) && !defined(URHO3D_D3D11)
+        graphics_->SetDepthStencil(GetDepthStencil(destSurface));
+        #else
+        graphics_->SetDepthStencil((RenderSurface*)0);
+        #endif
+        graphics_->SetViewport(IntRect(0, 0, destSize.x_, destSize.y_));
+        graphics_->SetShaders(vs, i ? downsamplePS : firstPS);
+        
+        SetGlobalShaderParameters();
+        SetCameraShaderParameters(camera_, false);
+        SetGBufferShaderParameters(destSize, IntRect(0, 0, destSize.x_, destSize.y_));
+        graphics_->SetShaderParameter(PSP_DEPTHPYRAMIDSRCINVSIZE, Vector2(1.0f / (float)source->GetWidth(), 1.0f /
+            (float)source->GetHeight()));
+        graphics_->SetShaderParameter(PSP_DEPTHPYRAMIDDESTSIZE, Vector2((float)destSize.x_, (float)destSize.y_));
+        graphics_->SetTexture(i ? TU_DIFFUSE : TU_DEPTHBUFFER, source);
+        
+        DrawFullscreenQuad(false);
+        source = dest;
+    }
+    
+    graphics_->SetTexture(TU_DIFFUSE, 0);
+    graphics_->SetTexture(TU_DEPTHBUFFER, 0);
+    #endif
+}
+
 bool View::IsNecessary(const RenderPathCommand& command)
 {
     return command.enabled_ && command.outputs_.Size() && (command.type_ != CMD_SCENEPASS ||
@@ -1914,6 +2895,10 @@ void View::AllocateScreenBuffers()
         }
     }
     
+    // If rendering at a reduced resolution, need to reserve a buffer to upscale from
+    if (viewSize_ != viewRect_.Size())
+        needSubstitute = true;
+    
     // Follow final rendertarget format, or use RGB to match the backbuffer format
     unsigned format = renderTarget_ ? renderTarget_->GetParentTexture()->GetFormat() : Graphics::GetRGBFormat();
     
@@ -1984,7 +2969,51 @@ void View::AllocateScreenBuffers()
     if (numViewportTextures == 1 && substituteRenderTarget_)
         viewportTextures_[1] = substituteRenderTarget_->GetParentTexture();
     
-    // Allocate extra render targets defined by the rendering path
+    // Find the range of commands using each rendertarget. Reads are marked first so that a command both reading and writing
+    // a rendertarget counts as reading its earlier contents
+    HashMap<StringHash, RenderTargetLifetime> useRanges;
+    for (unsigned i = 0; i < renderPath_->commands_.Size(); ++i)
+    {
+        const RenderPathCommand& command = renderPath_->commands_[i];
+        if (!IsNecessary(command))
+            continue;
+        for (unsigned j = 0; j < MAX_TEXTURE_UNITS; ++j)
+            MarkRenderTargetUse(useRanges, command.textureNames_[j], i, true);
+        MarkRenderTargetUse(useRanges, command.upsampleDepthName_, i, true);
+        MarkRenderTargetUse(useRanges, command.depthStencilName_, i, false);
+        for (unsigned j = 0; j < command.outputs_.Size(); ++j)
+            MarkRenderTargetUse(useRanges, command.outputs_[j].first_, i, false);
+    }
+    
+    // Discard the rendertarget contents the commands specify, and when supported also the contents of non-persistent
+    // rendertargets after their last use, so that tile-based GPUs do not need to write them back to memory
+    discardFlags_.Resize(renderPath_->commands_.Size());
+    for (unsigned i = 0; i < renderPath_->commands_.Size(); ++i)
+    {
+        const RenderPathCommand& command = renderPath_->commands_[i];
+        discardFlags_[i] = command.discardFlags_;
+        if (!graphics_->GetFramebufferDiscardSupport() || !IsNecessary(command) || command.type_ == CMD_DEPTHPYRAMID)
+            continue;
+        
+        if (IsLastRenderTargetUse(renderPath_, useRanges, command.depthStencilName_, i))
+            discardFlags_[i] |= CLEAR_DEPTH | CLEAR_STENCIL;
+        bool discardColor = true;
+        for (unsigned j = 0; j < command.outputs_.Size(); ++j)
+        {
+            if (!IsLastRenderTargetUse(renderPath_, useRanges, command.outputs_[j].first_, i))
+            {
+                discardColor = false;
+                break;
+            }
+        }
+        if (discardColor)
+            discardFlags_[i] |= CLEAR_COLOR;
+    }
+
+    // Calculate the sizes of the extra render targets defined by the rendering path, and sort them by first use
+    PODVector<IntVector2> rtSizes;
+    PODVector<RenderTargetLifetime> lifetimes;
+    rtSizes.Resize(renderPath_->renderTargets_.Size());
     for (unsigned i = 0; i < renderPath_->renderTargets_.Size(); ++i)
     {
         const RenderTargetInfo& rtInfo = renderPath_->renderTargets_[i];
@@ -2005,13 +3034,81 @@ void View::AllocateScreenBuffers()
             height = (float)viewSize_.y_ * height;
         }
         
-        int intWidth = (int)(width + 0.5f);
-        int intHeight = (int)(height + 0.5f);
+        rtSizes[i] = IntVector2((int)(width + 0.5f), (int)(height + 0.5f));
+
+        HashMap<StringHash, RenderTargetLifetime>::ConstIterator j = useRanges.Find(StringHash(rtInfo.name_));
+        RenderTargetLifetime lifetime = j != useRanges.End() ? j->second_ : RenderTargetLifetime();
+        lifetime.index_ = i;
+        lifetimes.Push(lifetime);
+    }
+    Sort(lifetimes.Begin(), lifetimes.End(), CompareRenderTargetLifetimes);
+
+    // Allocate the render targets. A non-persistent rendertarget that is written before being read can alias the screen buffer
+    // of an earlier one with the same parameters whose last use has passed, which saves memory with long postprocess chains
+    PODVector<RenderTargetLifetime> aliasable;
+    for (unsigned i = 0; i < lifetimes.Size(); ++i)
+    {
+        const RenderTargetLifetime& lifetime = lifetimes[i];
+        const RenderTargetInfo& rtInfo = renderPath_->renderTargets_[lifetime.index_];
+        const IntVector2& size = rtSizes[lifetime.index_];
+        bool canAlias = !rtInfo.persistent_ && !lifetime.readFirst_ && lifetime.last_ >= 0;
+        Texture* texture = 0;
+
+        if (canAlias)
+        {
+            for (unsigned j = 0; j < aliasable.Size(); ++j)
+            {
+                RenderTargetLifetime& other = aliasable[j];
+                const RenderTargetInfo& otherInfo = renderPath_->renderTargets_[other.index_];
+                if (other.last_ < lifetime.first_ && rtSizes[other.index_] == size && otherInfo.format_ == rtInfo.format_ &&
+                    otherInfo.cubemap_ == rtInfo.cubemap_ && otherInfo.filtered_ == rtInfo.filtered_ && otherInfo.sRGB_ == rtInfo.sRGB_)
+                {
+                    texture = renderTargets_[otherInfo.name_];
+                    other.last_ = lifetime.last_;
+                    break;
+                }
+            }
+        }
+
+        if (!texture)
+        {
+            // If the rendertarget is persistent, key it with a hash derived from the RT name and the view's pointer
+            texture = renderer_->GetScreenBuffer(size.x_, size.y_, rtInfo.format_, rtInfo.cubemap_, rtInfo.filtered_, rtInfo.sRGB_,
+                rtInfo.persistent_ ? StringHash(rtInfo.name_).Value() + (unsigned)(size_t)this : 0);
+            if (canAlias)
+                aliasable.Push(lifetime);
+        }
+
+        renderTargets_[rtInfo.name_] = texture;
+    }
+    
+    // Allocate the depth pyramid levels. The first level is viewport-sized, and the rest halve the size rounding up, so that
+    // each texel of a level covers the whole 2x2 block below it
+    // Depth pyramids need floating point rendertargets, so they are only supported on desktop graphics
+    depthPyramidTargets_.Clear();
+    #ifdef DESKTOP_GRAPHICS
+    for (unsigned i = 0; i < renderPath_->commands_.Size(); ++i)
+    {
+        const RenderPathCommand& command = renderPath_->commands_[i];
+        if (command.type_ != CMD_DEPTHPYRAMID || !IsNecessary(command))
+            continue;
+        
+        const String& name = command.outputs_[0].first_;
+        if (!name.Compare("viewport", false))
+            continue;
         
-        // If the rendertarget is persistent, key it with a hash derived from the RT name and the view's pointer
-        renderTargets_[rtInfo.name_] = renderer_->GetScreenBuffer(intWidth, intHeight, rtInfo.format_, rtInfo.cubemap_, rtInfo.filtered_,
-            rtInfo.sRGB_, rtInfo.persistent_ ? StringHash(rtInfo.name_).Value() + (unsigned)(size_t)this : 0);
+        IntVector2 size = viewSize_;
+        unsigned numLevels = GetNumDepthPyramidLevels(viewSize_, command.depthPyramidLevels_);
+        for (unsigned j = 0; j < numLevels; ++j)
+        {
+            String levelName = GetDepthPyramidLevelName(name, j);
+            renderTargets_[levelName] = renderer_->GetScreenBuffer(size.x_, size.y_, Graphics::GetRGFloat32Format(), false,
+                false, false);
+            depthPyramidTargets_.Push(levelName);
+            size = IntVector2((size.x_ + 1) / 2, (size.y_ + 1) / 2);
+        }
     }
+    #endif
 }
 
 void View::BlitFramebuffer(Texture* source, RenderSurface* destination, bool depthWrite)
@@ -2133,9 +3230,10 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
     for (unsigned i = 0; i < occluders.Size(); ++i)
     {
         Drawable* occluder = occluders[i];
-        if (i > 0)
+        if (i > 0 || buffer->HasReprojection())
         {
-            // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary
+            // For subsequent occluders, or when the previous frame's depth was reprojected, do a test against the
+            // pixel-level occlusion buffer to see if rendering is necessary
             if (!buffer->IsVisible(occluder->GetWorldBoundingBox()))
                 continue;
         }
@@ -2148,6 +3246,171 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
     buffer->BuildDepthHierarchy();
 }
 
+void View::UpdateSkinMatrices()
+{
+    PROFILE(UpdateSkinMatrices);
+    
+    for (PODVector<Drawable*>::ConstIterator i = geometries_.Begin(); i != geometries_.End(); ++i)
+        AddSkinMatrices(*i);
+    
+    for (Vector<LightQueryResult>::ConstIterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+    {
+        for (PODVector<Drawable*>::ConstIterator j = i->shadowCasters_.Begin(); j != i->shadowCasters_.End(); ++j)
+            AddSkinMatrices(*j);
+    }
+    
+    renderer_->UpdateSkinMatrixTexture();
+}
+
+void View::AddSkinMatrices(Drawable* drawable)
+{
+    const Vector<SourceBatch>& batches = drawable->GetBatches();
+    for (Vector<SourceBatch>::ConstIterator i = batches.Begin(); i != batches.End(); ++i)
+    {
+        if ((i->geometryType_ == GEOM_SKINNED || i->geometryType_ == GEOM_SKINNED_INSTANCED) && i->worldTransform_)
+            renderer_->GetSkinMatrixOffset(i->worldTransform_, i->numWorldTransforms_);
+    }
+}
+
+void View::UpdateOcclusionQueries()
+{
+    // Results are only valid for the camera they were rendered with
+    if (!gpuOcclusion_ || occlusionQueryCamera_.Get() != camera_)
+    {
+        ReleaseOcclusionQueries();
+        occlusionQueryCamera_ = camera_;
+    }
+    
+    for (HashMap<Drawable*, DrawableOcclusionQuery>::Iterator i = occlusionQueries_.Begin(); i != occlusionQueries_.End();)
+    {
+        DrawableOcclusionQuery& state = i->second_;
+        
+        // Forget drawables that were destroyed or not in the view frustum on the previous frame
+        if (!state.drawable_ || state.lastFrameNumber_ + 1 < frame_.frameNumber_)
+        {
+            if (state.query_)
+                freeOcclusionQueries_.Push(state.query_);
+            i = occlusionQueries_.Erase(i);
+            continue;
+        }
+        
+        // Do not wait for the GPU; a query that has not finished yet is checked again on the next frame
+        bool visible;
+        if (state.query_ && graphics_->GetOcclusionQueryResult(state.query_, visible))
+        {
+            state.occluded_ = !visible;
+            freeOcclusionQueries_.Push(state.query_);
+            state.query_ = 0;
+        }
+        
+        ++i;
+    }
+}
+
+void View::QueueOcclusionQueries()
+{
+    Vector3 cameraPos = cameraNode_->GetWorldPosition();
+    Vector3 nearMargin = Vector3::ONE * camera_->GetNearClip() * 2.0f;
+    
+    for (unsigned i = 0; i < sceneResults_.Size(); ++i)
+    {
+        PODVector<Drawable*>& candidates = sceneResults_[i].occlusionQueryCandidates_;
+        for (PODVector<Drawable*>::ConstIterator j = candidates.Begin(); j != candidates.End(); ++j)
+        {
+            Drawable* drawable = *j;
+            DrawableOcclusionQuery& state = occlusionQueries_[drawable];
+            
+            // Reset the state if the drawable is new, or a new drawable reuses the address of a destroyed one
+            if (state.drawable_.Get() != drawable)
+            {
+                if (state.query_)
+                    freeOcclusionQueries_.Push(state.query_);
+                state = DrawableOcclusionQuery();
+                state.drawable_ = drawable;
+            }
+            state.lastFrameNumber_ = frame_.frameNumber_;
+            
+            // Wait for the previous query to finish before issuing a new one
+            if (state.query_)
+                continue;
+            
+            // The bounding box would be clipped by the near plane when the camera is at or inside it, which could give false
+            // occlusion. Consider such drawables visible without a query
+            const BoundingBox& box = drawable->GetWorldBoundingBox();
+            if (BoundingBox(box.min_ - nearMargin, box.max_ + nearMargin).IsInside(cameraPos) != OUTSIDE)
+            {
+                state.occluded_ = false;
+                continue;
+            }
+            
+            occlusionQueryDrawables_.Push(drawable);
+        }
+    }
+}
+
+void View::RenderOcclusionQueries()
+{
+    PROFILE(RenderOcclusionQueries);
+    
+    Geometry* geometry = renderer_->GetBoxGeometry();
+    
+    graphics_->SetBlendMode(BLEND_REPLACE);
+    graphics_->SetColorWrite(false);
+    graphics_->SetDepthWrite(false);
+    graphics_->SetDepthTest(CMP_LESSEQUAL);
+    graphics_->SetCullMode(CULL_NONE);
+    graphics_->SetShaders(graphics_->GetShader(VS, "Stencil"), graphics_->GetShader(PS, "Stencil"));
+    graphics_->SetShaderParameter(VSP_VIEWPROJ, camera_->GetProjection() * camera_->GetView());
+    
+    for (PODVector<Drawable*>::ConstIterator i = occlusionQueryDrawables_.Begin(); i != occlusionQueryDrawables_.End(); ++i)
+    {
+        HashMap<Drawable*, DrawableOcclusionQuery>::Iterator j = occlusionQueries_.Find(*i);
+        if (j == occlusionQueries_.End())
+            continue;
+        
+        unsigned query;
+        if (freeOcclusionQueries_.Size())
+        {
+            query = freeOcclusionQueries_.Back();
+            freeOcclusionQueries_.Pop();
+        }
+        else
+            query = graphics_->CreateOcclusionQuery();
+        if (!query)
+            break;
+        
+        const BoundingBox& box = (*i)->GetWorldBoundingBox();
+        graphics_->SetShaderParameter(VSP_MODEL, Matrix3x4(box.Center(), Quaternion::IDENTITY, box.Size()));
+        graphics_->BeginOcclusionQuery(query);
+        geometry->Draw(graphics_);
+        graphics_->EndOcclusionQuery(query);
+        j->second_.query_ = query;
+    }
+    
+    graphics_->ClearTransformSources();
+    graphics_->SetColorWrite(true);
+    graphics_->SetDepthWrite(true);
+    occlusionQueryDrawables_.Clear();
+}
+
+void View::ReleaseOcclusionQueries()
+{
+    if (graphics_)
+    {
+        for (HashMap<Drawable*, DrawableOcclusionQuery>::ConstIterator i = occlusionQueries_.Begin(); i !=
+            occlusionQueries_.End(); ++i)
+        {
+            if (i->second_.query_)
+                graphics_->DestroyOcclusionQuery(i->second_.query_);
+        }
+        for (PODVector<unsigned>::ConstIterator i = freeOcclusionQueries_.Begin(); i != freeOcclusionQueries_.End(); ++i)
+            graphics_->DestroyOcclusionQuery(*i);
+    }
+    
+    occlusionQueries_.Clear();
+    freeOcclusionQueries_.Clear();
+}
+
 void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
 {
     Light* light = query.light_;
@@ -2164,6 +3427,8 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
     if (isShadowed && type == LIGHT_POINT)
         isShadowed = false;
     #endif
+    // Static shadow casters can be cached for point and spot lights, as their shadow cameras do not depend on the view
+    query.shadowCached_ = isShadowed && type != LIGHT_DIRECTIONAL && renderer_->GetShadowCache();
     // Get lit geometries. They must match the light mask and be inside the main camera frustum to be considered
     PODVector<Drawable*>& tempDrawables = tempDrawables_[threadIndex];
     query.litGeometries_.Clear();
@@ -2217,12 +3482,17 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
     
     // Process each split for shadow casters
     query.shadowCasters_.Clear();
+    query.staticShadowCasters_.Clear();
     for (unsigned i = 0; i < query.numSplits_; ++i)
     {
         Camera* shadowCamera = query.shadowCameras_[i];
         const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
         query.shadowCasterBegin_[i] = query.shadowCasterEnd_[i] = query.shadowCasters_.Size();
         
+        // The cache holds all splits regardless of their visibility, so that it stays valid when the camera moves
+        if (query.shadowCached_)
+            ProcessStaticShadowCasters(query, tempDrawables, i);
+        
         // For point light check that the face is visible: if not, can skip the split
         if (type == LIGHT_POINT && frustum.IsInsideFast(BoundingBox(shadowCameraFrustum)) == OUTSIDE)
             continue;
@@ -2313,8 +3583,9 @@ void View::ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawabl
         
         if (IsShadowCasterVisible(drawable, lightViewBox, shadowCamera, lightView, lightViewFrustum, lightViewFrustumBox))
         {
-            // Merge to shadow caster bounding box (only needed for focused spot lights) and add to the list
-            if (type == LIGHT_SPOT && light->GetShadowFocus().focus_)
+            // Merge to shadow caster bounding box (only needed for focused spot lights) and add to the list. Cached lights
+            // are not focused, as the focus would depend on the visible shadow casters
+            if (type == LIGHT_SPOT && light->GetShadowFocus().focus_ && !query.shadowCached_)
             {
                 lightProjBox = lightViewBox.Projected(lightProj);
                 query.shadowCasterBox_[splitIndex].Merge(lightProjBox);
@@ -2326,6 +3597,193 @@ void View::ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawabl
     query.shadowCasterEnd_[splitIndex] = query.shadowCasters_.Size();
 }
 
+void View::ProcessStaticShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex)
+{
+    Light* light = query.light_;
+    const Frustum& shadowCameraFrustum = query.shadowCameras_[splitIndex]->GetFrustum();
+    LightType type = light->GetLightType();
+    unsigned begin = query.staticShadowCasters_.Size();
+    
+    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if (!drawable->GetCastShadows() || !IsStaticShadowCaster(drawable))
+            continue;
+        if (!(GetShadowMask(drawable) & light->GetLightMask()))
+            continue;
+        if (type == LIGHT_POINT && shadowCameraFrustum.IsInsideFast(drawable->GetWorldBoundingBox()) == OUTSIDE)
+            continue;
+        
+        // Check shadow distance the same way as for the visible shadow casters
+        if (!drawable->IsInView(frame_, true))
+            drawable->UpdateBatches(frame_);
+        float maxShadowDistance = drawable->GetShadowDistance();
+        float drawDistance = drawable->GetDrawDistance();
+        if (drawDistance > 0.0f && (maxShadowDistance <= 0.0f || drawDistance < maxShadowDistance))
+            maxShadowDistance = drawDistance;
+        if (maxShadowDistance > 0.0f && drawable->GetDistance() > maxShadowDistance)
+            continue;
+        
+        query.staticShadowCasters_.Push(drawable);
+    }
+    
+    // Sort so that the list can be compared to the cached one regardless of octree query order
+    Sort(query.staticShadowCasters_.Begin() + begin, query.staticShadowCasters_.End());
+    query.staticShadowCasterEnd_[splitIndex] = query.staticShadowCasters_.Size();
+}
+
+bool View::IsStaticShadowCaster(Drawable* drawable) const
+{
+    return frame_.frameNumber_ - drawable->GetUpdateFrameNumber() > SHADOW_CACHE_STATIC_FRAMES;
+}
+
+void View::BuildShadowBatches(LightQueryResult& query, unsigned threadIndex)
+{
+    LightBatchQueue& lightQueue = *query.light_->GetLightQueue();
+    
+    for (unsigned i = 0; i < lightQueue.shadowSplits_.Size(); ++i)
+    {
+        ShadowBatchQueue& shadowQueue = lightQueue.shadowSplits_[i];
+        
+        // Loop through shadow casters
+        for (PODVector<Drawable*>::ConstIterator j = query.shadowCasters_.Begin() + query.shadowCasterBegin_[i];
+            j < query.shadowCasters_.Begin() + query.shadowCasterEnd_[i]; ++j)
+        {
+            // Static shadow casters are rendered from the cache
+            if (lightQueue.shadowMapCache_ && IsStaticShadowCaster(*j))
+                continue;
+            AddShadowBatches(shadowQueue.shadowBatches_, *j, shadowQueue.shadowCamera_, threadIndex);
+        }
+    }
+    
+    if (lightQueue.shadowMapCache_)
+        UpdateShadowMapCache(query, lightQueue, threadIndex);
+}
+
+void View::MergeShadowResults()
+{
+    for (unsigned i = 0; i < shadowResults_.Size(); ++i)
+    {
+        PODVector<DeferredShadowCaster>& deferredCasters = shadowResults_[i].deferredCasters_;
+        for (PODVector<DeferredShadowCaster>::ConstIterator j = deferredCasters.Begin(); j != deferredCasters.End(); ++j)
+            AddShadowBatches(*j->queue_, j->drawable_, j->shadowCamera_, 0, j->firstBatch_);
+        deferredCasters.Clear();
+    }
+    
+    // Several lights may have found the same shadow caster, so check whether it has already been marked
+    for (unsigned i = 0; i < shadowResults_.Size(); ++i)
+    {
+        PODVector<Drawable*>& geometries = shadowResults_[i].geometries_;
+        for (PODVector<Drawable*>::ConstIterator j = geometries.Begin(); j != geometries.End(); ++j)
+        {
+            Drawable* drawable = *j;
+            if (drawable->IsInView(frame_, true))
+                continue;
+            
+            drawable->MarkInView(frame_.frameNumber_);
+            UpdateGeometryType type = drawable->GetUpdateGeometryType();
+            if (type == UPDATE_MAIN_THREAD)
+                nonThreadedGeometries_.Push(drawable);
+            else if (type == UPDATE_WORKER_THREAD)
+                threadedGeometries_.Push(drawable);
+        }
+        geometries.Clear();
+    }
+}
+
+void View::UpdateShadowMapCache(LightQueryResult& query, LightBatchQueue& lightQueue, unsigned threadIndex)
+{
+    ShadowMapCache* cache = lightQueue.shadowMapCache_;
+    const BiasParameters& bias = query.light_->GetShadowBias();
+    unsigned numSplits = lightQueue.shadowSplits_.Size();
+    
+    // The cached depth stays valid as long as the shadow cameras, depth bias and static shadow casters are unchanged
+    bool valid = cache->valid_ && cache->numSplits_ == numSplits && cache->shadowBias_.constantBias_ == bias.constantBias_ &&
+        cache->shadowBias_.slopeScaledBias_ == bias.slopeScaledBias_ &&
+        cache->shadowCasters_.Size() == query.staticShadowCasters_.Size();
+    for (unsigned i = 0; i < numSplits && valid; ++i)
+    {
+        Camera* shadowCamera = lightQueue.shadowSplits_[i].shadowCamera_;
+        valid = cache->shadowCasterEnd_[i] == query.staticShadowCasterEnd_[i] && cache->shadowViews_[i] == shadowCamera->GetView() &&
+            cache->shadowProjections_[i] == shadowCamera->GetProjection();
+    }
+    if (valid && !query.staticShadowCasters_.Empty())
+    {
+        valid = !memcmp(&cache->shadowCasters_[0], &query.staticShadowCasters_[0], query.staticShadowCasters_.Size() *
+            sizeof(Drawable*));
+    }
+    if (valid)
+        return;
+    
+    // Store the new state and queue the static shadow casters. The cache becomes valid once it has been rendered
+    cache->valid_ = false;
+    cache->numSplits_ = numSplits;
+    cache->shadowBias_ = bias;
+    cache->shadowCasters_ = query.staticShadowCasters_;
+    
+    for (unsigned i = 0; i < numSplits; ++i)
+    {
+        ShadowBatchQueue& shadowQueue = lightQueue.shadowSplits_[i];
+        Camera* shadowCamera = shadowQueue.shadowCamera_;
+        cache->shadowCasterEnd_[i] = query.staticShadowCasterEnd_[i];
+        cache->shadowViews_[i] = shadowCamera->GetView();
+        cache->shadowProjections_[i] = shadowCamera->GetProjection();
+        
+        unsigned begin = i ? query.staticShadowCasterEnd_[i - 1] : 0;
+        for (unsigned j = begin; j < query.staticShadowCasterEnd_[i]; ++j)
+            AddShadowBatches(shadowQueue.staticBatches_, query.staticShadowCasters_[j], shadowCamera, threadIndex);
+    }
+}
+
+void View::AddShadowBatches(BatchQueue& queue, Drawable* drawable, Camera* shadowCamera, unsigned threadIndex,
+    unsigned firstBatch)
+{
+    // If drawable is not in actual view frustum, it needs to be marked in view and its geometry updated. This is done on the
+    // main thread once all shadow batches have been built
+    if (!firstBatch && !drawable->IsInView(frame_, true))
+        shadowResults_[threadIndex].geometries_.Push(drawable);
+    
+    Zone* zone = GetZone(drawable);
+    const Vector<SourceBatch>& batches = drawable->GetBatches();
+    
+    for (unsigned i = firstBatch; i < batches.Size(); ++i)
+    {
+        const SourceBatch& srcBatch = batches[i];
+        
+        unsigned arrayLayer;
+        Material* material = GetArrayMaterial(srcBatch.material_, arrayLayer);
+        Technique* tech = GetTechnique(drawable, material);
+        if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
+            continue;
+        
+        Pass* pass = tech->GetSupportedPass(Technique::shadowPassIndex);
+        // Skip if material has no shadow pass
+        if (!pass)
+            continue;
+        
+        // Shaders can only be loaded on the main thread, so on worker threads leave the rest of the batches to it
+        if (threadIndex && !renderer_->GetPassShadersLoaded(pass))
+        {
+            DeferredShadowCaster deferred;
+            deferred.queue_ = &queue;
+            deferred.drawable_ = drawable;
+            deferred.shadowCamera_ = shadowCamera;
+            deferred.firstBatch_ = i;
+            shadowResults_[threadIndex].deferredCasters_.Push(deferred);
+            return;
+        }
+        
+        Batch destBatch(srcBatch);
+        destBatch.material_ = material;
+        destBatch.arrayLayer_ = arrayLayer;
+        destBatch.pass_ = pass;
+        destBatch.camera_ = shadowCamera;
+        destBatch.zone_ = zone;
+        
+        AddBatchToQueue(queue, destBatch, tech);
+    }
+}
+
 bool View::IsShadowCasterVisible(Drawable* drawable, BoundingBox lightViewBox, Camera* shadowCamera, const Matrix3x4& lightView,
     const Frustum& lightViewFrustum, const BoundingBox& lightViewFrustumBox)
 {
@@ -2362,10 +3820,69 @@ bool View::IsShadowCasterVisible(Drawable* drawable, BoundingBox lightViewBox, C
     }
 }
 
-IntRect View::GetShadowMapViewport(Light* light, unsigned splitIndex, Texture2D* shadowMap)
+void View::AllocateShadowAtlas()
 {
-    unsigned width = shadowMap->GetWidth();
-    unsigned height = shadowMap->GetHeight();
+    shadowAtlas_ = 0;
+    for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+        i->shadowAtlasArea_ = IntRect::ZERO;
+    
+    if (!renderer_->GetShadowAtlasSize() || !renderer_->GetDrawShadows())
+        return;
+    
+    // Collect the shadowed per-pixel lights. Lights using the static shadow caster cache keep their own shadow maps
+    PODVector<ShadowAtlasRequest> requests;
+    for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+    {
+        if (!i->numSplits_ || i->shadowCached_ || i->clustered_ || i->light_->GetPerVertex() || i->litGeometries_.Empty())
+            continue;
+        
+        ShadowAtlasRequest request;
+        request.query_ = &(*i);
+        request.size_ = renderer_->CalculateShadowMapSize(i->light_, camera_, viewSize_.x_, viewSize_.y_);
+        requests.Push(request);
+    }
+    
+    if (requests.Empty())
+        return;
+    
+    Texture2D* atlas = renderer_->GetShadowAtlas();
+    if (!atlas)
+        return;
+    
+    Sort(requests.Begin(), requests.End(), CompareShadowAtlasRequests);
+    
+    // The areas are allocated again on each frame, so that the screen size changes of the lights are followed. As the
+    // allocation order is stable, the areas only move when the requested sizes change
+    AreaAllocator allocator(atlas->GetWidth(), atlas->GetHeight(), false);
+    for (PODVector<ShadowAtlasRequest>::Iterator i = requests.Begin(); i != requests.End(); ++i)
+    {
+        // Halve the resolution until the shadow map fits. If it does not fit at the minimum resolution, a regular shadow map
+        // is used instead
+        IntVector2 size = i->size_;
+        for (;;)
+        {
+            int x, y;
+            if (allocator.Allocate(size.x_, size.y_, x, y))
+            {
+                i->query_->shadowAtlasArea_ = IntRect(x, y, x + size.x_, y + size.y_);
+                shadowAtlas_ = atlas;
+                break;
+            }
+            
+            if (size.x_ / 2 < SHADOW_MIN_PIXELS || size.y_ / 2 < SHADOW_MIN_PIXELS)
+                break;
+            size.x_ /= 2;
+            size.y_ /= 2;
+        }
+    }
+}
+
+IntRect View::GetShadowMapViewport(Light* light, unsigned splitIndex, const IntRect& shadowMapArea)
+{
+    int left = shadowMapArea.left_;
+    int top = shadowMapArea.top_;
+    int width = shadowMapArea.Width();
+    int height = shadowMapArea.Height();
     
     switch (light->GetLightType())
     {
@@ -2373,20 +3890,20 @@ IntRect View::GetShadowMapViewport(Light* light, unsigned splitIndex, Texture2D*
         {
             int numSplits = light->GetNumShadowSplits();
             if (numSplits == 1)
-                return IntRect(0, 0, width, height);
+                return shadowMapArea;
             else if (numSplits == 2)
-                return IntRect(splitIndex * width / 2, 0, (splitIndex + 1) * width / 2, height);
+                return IntRect(left + splitIndex * width / 2, top, left + (splitIndex + 1) * width / 2, top + height);
             else
-                return IntRect((splitIndex & 1) * width / 2, (splitIndex / 2) * height / 2, ((splitIndex & 1) + 1) * width / 2,
-                    (splitIndex / 2 + 1) * height / 2);
+                return IntRect(left + (splitIndex & 1) * width / 2, top + (splitIndex / 2) * height / 2, left + ((splitIndex & 1) +
+                    1) * width / 2, top + (splitIndex / 2 + 1) * height / 2);
         }
         
     case LIGHT_SPOT:
-        return IntRect(0, 0, width, height);
+        return shadowMapArea;
         
     case LIGHT_POINT:
-        return IntRect((splitIndex & 1) * width / 2, (splitIndex / 2) * height / 3, ((splitIndex & 1) + 1) * width / 2,
-            (splitIndex / 2 + 1) * height / 3);
+        return IntRect(left + (splitIndex & 1) * width / 2, top + (splitIndex / 2) * height / 3, left + ((splitIndex & 1) + 1) *
+            width / 2, top + (splitIndex / 2 + 1) * height / 3);
     }
     
     return IntRect();
@@ -2555,7 +4072,7 @@ void View::FinalizeShadowCamera(Camera* shadowCamera, Light* light, const IntRec
         QuantizeDirLightShadowCamera(shadowCamera, light, shadowViewport, shadowBox);
     }
     
-    if (type == LIGHT_SPOT && parameters.focus_)
+    if (type == LIGHT_SPOT && parameters.focus_ && shadowCasterBox.defined_)
     {
         float viewSizeX = Max(Abs(shadowCasterBox.min_.x_), Abs(shadowCasterBox.max_.x_));
         float viewSizeY = Max(Abs(shadowCasterBox.min_.y_), Abs(shadowCasterBox.max_.y_));
@@ -2656,11 +4173,19 @@ void View::FindZone(Drawable* drawable)
         newZone = lastZone;
     else
     {
-        for (PODVector<Zone*>::Iterator i = zones_.Begin(); i != zones_.End(); ++i)
+        // Test only the zones overlapping the octree's zone grid cell at the center. If the grid has not been rebuilt since
+        // zones changed, test the zones in view instead
+        const PODVector<Zone*>* zones = octree_->GetZones(center);
+        if (!zones)
+            zones = &zones_;
+        unsigned viewMask = camera_->GetViewMask();
+        
+        for (PODVector<Zone*>::ConstIterator i = zones->Begin(); i != zones->End(); ++i)
         {
             Zone* zone = *i;
             int priority = zone->GetPriority();
-            if (priority > bestPriority && (drawable->GetZoneMask() & zone->GetZoneMask()) && zone->IsInside(center))
+            if (priority > bestPriority && (zone->GetViewMask() & viewMask) && (drawable->GetZoneMask() &
+                zone->GetZoneMask()) && zone->IsInside(center))
             {
                 newZone = zone;
                 bestPriority = priority;
@@ -2705,6 +4230,16 @@ Technique* View::GetTechnique(Drawable* drawable, Material* material)
     }
 }
 
+Material* View::GetArrayMaterial(Material* material, unsigned& layer) const
+{
+    layer = 0;
+    if (!material || !material->GetArrayMaterial() || !graphics_->GetTextureArraySupport())
+        return material;
+    
+    layer = material->GetArrayLayer();
+    return material->GetArrayMaterial();
+}
+
 void View::CheckMaterialForAuxView(Material* material)
 {
     const HashMap<TextureUnit, SharedPtr<Texture> >& textures = material->GetTextures();
@@ -2739,6 +4274,18 @@ void View::CheckMaterialForAuxView(Material* material)
     material->MarkForAuxView(frame_.frameNumber_);
 }
 
+void View::RequestStreamedTextures(TextureStreamer* streamer, Material* material, float screenSize)
+{
+    const HashMap<TextureUnit, SharedPtr<Texture> >& textures = material->GetTextures();
+    
+    for (HashMap<TextureUnit, SharedPtr<Texture> >::ConstIterator i = textures.Begin(); i != textures.End(); ++i)
+    {
+        Texture* texture = i->second_.Get();
+        if (texture && texture->GetType() == Texture2D::GetTypeStatic())
+            streamer->RequestTexture(static_cast<Texture2D*>(texture), screenSize, frame_.frameNumber_);
+    }
+}
+
 void View::AddBatchToQueue(BatchQueue& batchQueue, Batch& batch, Technique* tech, bool allowInstancing, bool allowShadows)
 {
     if (!batch.material_)
@@ -2758,6 +4305,7 @@ void View::AddBatchToQueue(BatchQueue& batchQueue, Batch& batch, Technique* tech
             // Create a new group based on the batch
             // In case the group remains below the instancing limit, do not enable instancing shaders yet
             BatchGroup newGroup(batch);
+            newGroup.instances_.SetAllocator(&batchQueue.instanceAllocator_);
             newGroup.geometryType_ = GEOM_STATIC;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows);
             newGroup.CalculateSortKey();
@@ -2808,11 +4356,21 @@ void View::PrepareInstancingBuffer()
     for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
     {
         for (unsigned j = 0; j < i->shadowSplits_.Size(); ++j)
+        {
             totalInstances += i->shadowSplits_[j].shadowBatches_.GetNumInstances();
+            totalInstances += i->shadowSplits_[j].staticBatches_.GetNumInstances();
+        }
         totalInstances += i->litBaseBatches_.GetNumInstances();
         totalInstances += i->litBatches_.GetNumInstances();
     }
     
+    // Light volume groups below the instancing limit are drawn as individual volumes instead
+    for (Vector<BatchGroup>::ConstIterator i = lightVolumeGroups_.Begin(); i != lightVolumeGroups_.End(); ++i)
+    {
+        if ((int)i->instances_.Size() >= minInstances_)
+            totalInstances += i->instances_.Size();
+    }
+    
     if (!totalInstances || !renderer_->ResizeInstancingBuffer(totalInstances))
         return;
 
@@ -2828,11 +4386,20 @@ void View::PrepareInstancingBuffer()
     for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
     {
         for (unsigned j = 0; j < i->shadowSplits_.Size(); ++j)
+        {
             i->shadowSplits_[j].shadowBatches_.SetTransforms(dest, freeIndex);
+            i->shadowSplits_[j].staticBatches_.SetTransforms(dest, freeIndex);
+        }
         i->litBaseBatches_.SetTransforms(dest, freeIndex);
         i->litBatches_.SetTransforms(dest, freeIndex);
     }
     
+    for (Vector<BatchGroup>::Iterator i = lightVolumeGroups_.Begin(); i != lightVolumeGroups_.End(); ++i)
+    {
+        if ((int)i->instances_.Size() >= minInstances_)
+            i->SetTransforms(dest, freeIndex);
+    }
+    
     instancingBuffer->Unlock();
 }
 
@@ -2887,20 +4454,73 @@ void View::SetupLightVolumeBatch(Batch& batch)
 void View::RenderShadowMap(const LightBatchQueue& queue)
 {
     PROFILE(RenderShadowMap);
+    graphics_->BeginGPUProfileBlock("ShadowMap");
     
-    Texture2D* shadowMap = queue.shadowMap_;
+    ShadowMapCache* cache = queue.shadowMapCache_;
     graphics_->SetTexture(TU_SHADOWMAP, 0);
     
     graphics_->SetColorWrite(false);
     graphics_->SetFillMode(FILL_SOLID);
     graphics_->SetClipPlane(false);
     graphics_->SetStencilTest(false);
+    
+    // If the static shadow caster cache is out of date, render it first
+    if (cache && !cache->valid_)
+    {
+        RenderShadowSplits(queue, cache->shadowMap_, true, true);
+        cache->valid_ = true;
+    }
+    
+    // Render the other shadow casters, unless the cached shadow map is used as is. When caching, start from a copy of the
+    // static shadow caster depth instead of clearing
+    if (!cache || queue.shadowMap_ != cache->shadowMap_)
+    {
+        bool copied = cache && graphics_->CopyDepthTexture(queue.shadowMap_, cache->shadowMap_);
+        RenderShadowSplits(queue, queue.shadowMap_, false, !copied);
+    }
+    
+    graphics_->SetColorWrite(true);
+    graphics_->SetDepthBias(0.0f, 0.0f);
+    graphics_->EndGPUProfileBlock();
+}
+
+void View::RenderShadowAtlas()
+{
+    PROFILE(RenderShadowAtlas);
+    graphics_->BeginGPUProfileBlock("ShadowAtlas");
+    
+    graphics_->SetTexture(TU_SHADOWMAP, 0);
+    
+    graphics_->SetColorWrite(false);
+    graphics_->SetFillMode(FILL_SOLID);
+    graphics_->SetClipPlane(false);
+    graphics_->SetStencilTest(false);
+    
+    // Clear the whole atlas once, then render each light into its own area
+    bool clear = true;
+    for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+    {
+        if (i->shadowMap_ == shadowAtlas_)
+        {
+            RenderShadowSplits(*i, shadowAtlas_, false, clear);
+            clear = false;
+        }
+    }
+    
+    graphics_->SetColorWrite(true);
+    graphics_->SetDepthBias(0.0f, 0.0f);
+    graphics_->EndGPUProfileBlock();
+}
+
+void View::RenderShadowSplits(const LightBatchQueue& queue, Texture2D* shadowMap, bool staticCasters, bool clear)
+{
     graphics_->SetRenderTarget(0, shadowMap->GetRenderSurface()->GetLinkedRenderTarget());
     for (unsigned i = 1; i < MAX_RENDERTARGETS; ++i)
         graphics_->SetRenderTarget(i, (RenderSurface*)0);
     graphics_->SetDepthStencil(shadowMap);
     graphics_->SetViewport(IntRect(0, 0, shadowMap->GetWidth(), shadowMap->GetHeight()));
-    graphics_->Clear(CLEAR_DEPTH);
+    if (clear)
+        graphics_->Clear(CLEAR_DEPTH);
 
     // Set shadow depth bias
     const BiasParameters& parameters = queue.light_->GetShadowBias();
@@ -2928,15 +4548,13 @@ void View::RenderShadowMap(const LightBatchQueue& queue)
         graphics_->SetDepthBias(multiplier * parameters.constantBias_ + addition, multiplier * parameters.slopeScaledBias_);
         
         const ShadowBatchQueue& shadowQueue = queue.shadowSplits_[i];
-        if (!shadowQueue.shadowBatches_.IsEmpty())
+        const BatchQueue& batches = staticCasters ? shadowQueue.staticBatches_ : shadowQueue.shadowBatches_;
+        if (!batches.IsEmpty())
         {
             graphics_->SetViewport(shadowQueue.shadowViewport_);
-            shadowQueue.shadowBatches_.Draw(this, false, false, true);
+            batches.Draw(this, false, false, true);
         }
     }
-    
-    graphics_->SetColorWrite(true);
-    graphics_->SetDepthBias(0.0f, 0.0f);
 }
 
 RenderSurface* View::GetDepthStencil(RenderSurface* renderTarget)
@@ -26,6 +26,7 @@
 #include "../Container/HashSet.h"
 #include "../Graphics/Light.h"
 #include "../Container/List.h"
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../Math/Polyhedron.h"
 #include "../Graphics/Zone.h"
@@ -46,6 +47,7 @@ class RenderSurface;
 class Technique;
 class Texture;
 class Texture2D;
+class TextureStreamer;
 class Viewport;
 class Zone;
 struct RenderPathCommand;
@@ -72,8 +74,18 @@ struct LightQueryResult
     float shadowNearSplits_[MAX_LIGHT_SPLITS];
     /// Shadow camera far splits (directional lights only.)
     float shadowFarSplits_[MAX_LIGHT_SPLITS];
+    /// Static shadow casters for the shadow map cache, also including those not visible in the view.
+    PODVector<Drawable*> staticShadowCasters_;
+    /// Static shadow caster end indices. Each split begins where the previous one ends.
+    unsigned staticShadowCasterEnd_[MAX_LIGHT_SPLITS];
     /// Shadow map split count.
     unsigned numSplits_;
+    /// Shadow atlas area allocated for the light. Zero size if not using the shadow atlas.
+    IntRect shadowAtlasArea_;
+    /// Shadow map cache flag.
+    bool shadowCached_;
+    /// Clustered forward light flag. If set, the light is shaded through the light cluster grid instead of a light queue.
+    bool clustered_;
 };
 
 /// Scene render pass info.
@@ -89,6 +101,8 @@ struct ScenePassInfo
     bool useScissor_;
     /// Vertex light flag.
     bool vertexLights_;
+    /// Clustered forward light flag.
+    bool clusteredLights_;
     /// Batch queue.
     BatchQueue* batchQueue_;
 };
@@ -104,6 +118,94 @@ struct PerThreadSceneResult
     float minZ_;
     /// Scene maximum Z value.
     float maxZ_;
+    /// Visible geometries that want a hardware occlusion query.
+    PODVector<Drawable*> occlusionQueryCandidates_;
+};
+
+/// Hardware occlusion query state of a drawable.
+struct DrawableOcclusionQuery
+{
+    /// Construct.
+    DrawableOcclusionQuery() :
+        query_(0),
+        lastFrameNumber_(0),
+        occluded_(false)
+    {
+    }
+    
+    /// Drawable.
+    WeakPtr<Drawable> drawable_;
+    /// Pending query handle, or 0 if no query is in flight.
+    unsigned query_;
+    /// Frame number on which the drawable was last in the view frustum.
+    unsigned lastFrameNumber_;
+    /// Latest query result.
+    bool occluded_;
+};
+
+/// Shadow caster whose remaining batches are left for the main thread to add, as their shaders need loading.
+struct DeferredShadowCaster
+{
+    /// Shadow batch queue to add to.
+    BatchQueue* queue_;
+    /// Shadow caster.
+    Drawable* drawable_;
+    /// Shadow camera.
+    Camera* shadowCamera_;
+    /// Index of the first source batch to add.
+    unsigned firstBatch_;
+};
+
+/// Per-thread shadow batch building results, merged on the main thread.
+struct PerThreadShadowResult
+{
+    /// Shadow casters outside the view frustum.
+    PODVector<Drawable*> geometries_;
+    /// Shadow casters left for the main thread.
+    PODVector<DeferredShadowCaster> deferredCasters_;
+};
+
+/// Visible geometry whose remaining base pass batches are left for the main thread to add, as their shaders need loading.
+struct DeferredBaseBatches
+{
+    /// Drawable.
+    Drawable* drawable_;
+    /// Index of the first source batch to add.
+    unsigned firstBatch_;
+    /// Index of the first scene pass to add for the first source batch.
+    unsigned firstPass_;
+    /// Vertex lights already limited flag.
+    bool vertexLightsProcessed_;
+};
+
+/// Base pass batches built from a range of the visible geometries in a work item, merged on the main thread in range order.
+struct BaseBatchResult
+{
+    /// Start of the geometry range.
+    Drawable** start_;
+    /// End of the geometry range.
+    Drawable** end_;
+    /// Batch queues by scene pass.
+    Vector<BatchQueue> queues_;
+    /// Geometries left for the main thread.
+    PODVector<DeferredBaseBatches> deferred_;
+};
+
+/// Range of the light cluster grid covered by a clustered forward light.
+struct LightClusterBounds
+{
+    /// Left tile.
+    int minX_;
+    /// Right tile.
+    int maxX_;
+    /// Bottom tile.
+    int minY_;
+    /// Top tile.
+    int maxY_;
+    /// Nearest depth slice.
+    int minZ_;
+    /// Farthest depth slice.
+    int maxZ_;
 };
 
 static const unsigned MAX_VIEWPORT_TEXTURES = 2;
@@ -113,6 +215,10 @@ class URHO3D_API View : public Object
 {
     friend void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex);
     friend void ProcessLightWork(const WorkItem* item, unsigned threadIndex);
+    friend void BuildShadowBatchesWork(const WorkItem* item, unsigned threadIndex);
+    friend void GetBaseBatchesWork(const WorkItem* item, unsigned threadIndex);
+    friend void AssignLightClustersWork(const WorkItem* item, unsigned threadIndex);
+    friend void PackLightClustersWork(const WorkItem* item, unsigned threadIndex);
     
     OBJECT(View);
     
@@ -126,6 +232,8 @@ public:
     bool Define(RenderSurface* renderTarget, Viewport* viewport);
     /// Update and cull objects and construct rendering batches.
     void Update(const FrameInfo& frame);
+    /// Return whether the view needs to be updated and rendered on this frame. Always true unless the viewport uses incremental update. Called by Renderer on each frame after the octree update.
+    bool CheckUpdateNeeded(const FrameInfo& frame);
     /// Render batches.
     void Render();
     
@@ -139,6 +247,8 @@ public:
     Octree* GetOctree() const { return octree_; }
     /// Return camera.
     Camera* GetCamera() const { return camera_; }
+    /// Return the zone the camera is in. Valid from Update() until the end of Render().
+    Zone* GetCameraZone() const { return cameraZone_; }
     /// Return information of the frame being rendered.
     const FrameInfo& GetFrameInfo() const { return frame_; }
     /// Return the rendertarget. 0 if using the backbuffer.
@@ -153,6 +263,8 @@ public:
     const PODVector<Light*>& GetLights() const { return lights_; }
     /// Return light batch queues.
     const Vector<LightBatchQueue>& GetLightQueues() const { return lightQueues_; }
+    /// Return lights shaded through the light cluster grid.
+    const PODVector<Light*>& GetClusterLights() const { return clusterLights_; }
     /// Set global (per-frame) shader parameters. Called by Batch and internally by View.
     void SetGlobalShaderParameters();
     /// Set camera-specific shader parameters. Called by Batch and internally by View.
@@ -163,14 +275,28 @@ public:
 private:
     /// Query the octree for drawable objects.
     void GetDrawables();
+    /// Return the cull group's shared octree query result for this view, querying it first if this is the group's first view on the frame. Return null if the view frustum does not fit inside the shared query volume.
+    const PODVector<Drawable*>* GetSharedDrawables();
     /// Construct batches from the drawable objects.
     void GetBatches();
     /// Get lit geometries and shadowcasters for visible lights.
     void ProcessLights();
     /// Get batches from lit geometries and shadowcasters.
     void GetLightBatches();
+    /// Group similar unshadowed point light volumes into instanced draw calls.
+    void GetLightVolumeGroups();
     /// Get unlit batches.
     void GetBaseBatches();
+    /// Add the base pass batches of a visible geometry, to a work item's batch queues if result is non-null, otherwise to the scene pass queues. On worker threads, batches whose shaders need loading are left for the main thread.
+    void AddBaseBatches(Drawable* drawable, BaseBatchResult* result, unsigned threadIndex, unsigned firstBatch = 0, unsigned firstPass = 0, bool vertexLightsProcessed = false);
+    /// Merge a work item's base pass batch queue to a scene pass queue.
+    void MergeBaseBatches(BatchQueue& dest, BatchQueue& src);
+    /// Assign the clustered forward lights to the cluster grid and build the light cluster texture data. The work is left running in the worker threads.
+    void BuildLightClusters();
+    /// Assign the clustered forward lights to a range of clusters, given as pointers to their light counts.
+    void AssignLightClusters(unsigned char* start, unsigned char* end);
+    /// Write the cluster grid and the light index lists to the light cluster texture data.
+    void PackLightClusters();
     /// Update geometries and sort batches.
     void UpdateGeometries();
     /// Get pixel lit batches for a certain light and drawable.
@@ -183,6 +309,10 @@ private:
     bool SetTextures(RenderPathCommand& command);
     /// Perform a quad rendering command.
     void RenderQuad(RenderPathCommand& command);
+    /// Perform a quad rendering command at a reduced resolution, then upsample into the output.
+    void RenderScaledQuad(RenderPathCommand& command);
+    /// Perform a depth pyramid command: downsample the depth texture into a min/max mip chain of rendertargets.
+    void RenderDepthPyramid(RenderPathCommand& command);
     /// Check if a command is enabled and has content to render. To be called only after render update has completed for the frame.
     bool IsNecessary(const RenderPathCommand& command);
     /// Check if a command reads the destination render target.
@@ -201,10 +331,34 @@ private:
     void UpdateOccluders(PODVector<Drawable*>& occluders, Camera* camera);
     /// Draw occluders to occlusion buffer.
     void DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& occluders);
+    /// Add the skinning matrices of visible geometries and shadow casters to the bone matrix texture.
+    void UpdateSkinMatrices();
+    /// Add the skinning matrices of a drawable's skinned batches to the bone matrix texture.
+    void AddSkinMatrices(Drawable* drawable);
+    /// Read back finished hardware occlusion queries and forget drawables that have left the view.
+    void UpdateOcclusionQueries();
+    /// Select the visible drawables that get a new hardware occlusion query this frame.
+    void QueueOcclusionQueries();
+    /// Render the bounding boxes of the queued drawables as hardware occlusion queries.
+    void RenderOcclusionQueries();
+    /// Destroy all hardware occlusion queries.
+    void ReleaseOcclusionQueries();
     /// Query for lit geometries and shadow casters for a light.
     void ProcessLight(LightQueryResult& query, unsigned threadIndex);
     /// Process shadow casters' visibilities and build their combined view- or projection-space bounding box.
     void ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex);
+    /// Collect the static shadow casters of a split for the shadow map cache.
+    void ProcessStaticShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex);
+    /// Return whether a shadow caster has stayed unchanged long enough to be rendered into the shadow map cache.
+    bool IsStaticShadowCaster(Drawable* drawable) const;
+    /// Compare the shadow map cache of a light queue to the current shadow cameras and static shadow casters, and queue the static shadow casters for rendering if it is out of date.
+    void UpdateShadowMapCache(LightQueryResult& query, LightBatchQueue& lightQueue, unsigned threadIndex);
+    /// Build the shadow batches of a light's shadow splits. Called from a worker thread.
+    void BuildShadowBatches(LightQueryResult& query, unsigned threadIndex);
+    /// Merge the per-thread shadow batch building results: add the deferred shadow casters' batches and mark the shadow casters outside the view frustum in view.
+    void MergeShadowResults();
+    /// Add the shadow batches of a drawable to a shadow batch queue, starting from a source batch index. On worker threads, batches whose shaders need loading are deferred to the main thread.
+    void AddShadowBatches(BatchQueue& queue, Drawable* drawable, Camera* shadowCamera, unsigned threadIndex, unsigned firstBatch = 0);
     /// Set up initial shadow camera view(s).
     void SetupShadowCameras(LightQueryResult& query);
     /// Set up a directional light shadow camera
@@ -215,14 +369,20 @@ private:
     void QuantizeDirLightShadowCamera(Camera* shadowCamera, Light* light, const IntRect& shadowViewport, const BoundingBox& viewBox);
     /// Check visibility of one shadow caster.
     bool IsShadowCasterVisible(Drawable* drawable, BoundingBox lightViewBox, Camera* shadowCamera, const Matrix3x4& lightView, const Frustum& lightViewFrustum, const BoundingBox& lightViewFrustumBox);
-    /// Return the viewport for a shadow map split.
-    IntRect GetShadowMapViewport(Light* light, unsigned splitIndex, Texture2D* shadowMap);
+    /// Allocate shadow atlas areas for the shadowed lights, reducing resolution as necessary to fit.
+    void AllocateShadowAtlas();
+    /// Return the viewport for a shadow map split within the shadow map area of a light.
+    IntRect GetShadowMapViewport(Light* light, unsigned splitIndex, const IntRect& shadowMapArea);
     /// Find and set a new zone for a drawable when it has moved.
     void FindZone(Drawable* drawable);
     /// Return material technique, considering the drawable's LOD distance.
     Technique* GetTechnique(Drawable* drawable, Material* material);
+    /// Return the texture array material to render a material with and the array layer to select. Return the material itself and layer 0 if it has no array material or texture arrays are not supported.
+    Material* GetArrayMaterial(Material* material, unsigned& layer) const;
     /// Check if material should render an auxiliary view (if it has a camera attached.)
     void CheckMaterialForAuxView(Material* material);
+    /// Request the streamed textures of a material at a screen size in pixels.
+    void RequestStreamedTextures(TextureStreamer* streamer, Material* material, float screenSize);
     /// Choose shaders for a batch and add it to queue.
     void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
     /// Prepare instancing buffer by filling it with all instance transforms.
@@ -231,6 +391,10 @@ private:
     void SetupLightVolumeBatch(Batch& batch);
     /// Render a shadow map.
     void RenderShadowMap(const LightBatchQueue& queue);
+    /// Render the shadow maps of all lights using the shadow atlas.
+    void RenderShadowAtlas();
+    /// Render either the static or the other shadow casters of a light queue to a shadow map.
+    void RenderShadowSplits(const LightBatchQueue& queue, Texture2D* shadowMap, bool staticCasters, bool clear);
     /// Return the proper depth-stencil surface to use for a rendertarget.
     RenderSurface* GetDepthStencil(RenderSurface* renderTarget);
     /// Helper function to get the render surface from a texture. 2D textures will always return the first face only.
@@ -298,6 +462,8 @@ private:
     Texture* currentViewportTexture_;
     /// Dummy texture for D3D9 depth only rendering.
     Texture* depthOnlyDummyTexture_;
+    /// Shadow atlas texture used on the current frame, or null if not used.
+    Texture2D* shadowAtlas_;
     /// Viewport rectangle.
     IntRect viewRect_;
     /// Viewport size.
@@ -328,18 +494,50 @@ private:
     bool deferredAmbient_;
     /// Forward light base pass optimization flag. If in use, combine the base pass and first light for all opaque objects.
     bool useLitBase_;
+    /// Clustered forward lighting flag. Set when any scene pass shades the unshadowed point and spot lights through the light cluster grid.
+    bool clusteredLighting_;
     /// Has scene passes flag. If no scene passes, view can be defined without a valid scene or camera to only perform quad rendering.
     bool hasScenePasses_;
     /// Whether is using a custom readable depth texture without a stencil channel.
     bool noStencil_;
     /// Draw debug geometry flag. Copied from the viewport.
     bool drawDebug_;
+    /// Hardware occlusion query flag.
+    bool gpuOcclusion_;
+    /// Incremental update flag. Copied from the viewport when rendering to a texture.
+    bool incrementalUpdate_;
+    /// Directional light shadows on the last incremental update flag. If set, any octree change may affect the view.
+    bool lastDirShadows_;
+    /// Maximum frames between incremental updates. Copied from the viewport.
+    unsigned maxUpdateInterval_;
+    /// Cull group. Copied from the viewport.
+    unsigned cullGroup_;
+    /// Frame number of the last incremental update check.
+    unsigned lastCheckFrameNumber_;
+    /// Frame number of the last incremental update, or 0 if none.
+    unsigned lastUpdateFrameNumber_;
+    /// Camera of the last incremental update. Only compared, not dereferenced.
+    Camera* lastCamera_;
+    /// Renderpath of the last incremental update. Only compared, not dereferenced.
+    RenderPath* lastRenderPath_;
+    /// View rectangle of the last incremental update.
+    IntRect lastViewRect_;
+    /// Camera view matrix of the last incremental update.
+    Matrix3x4 lastCameraView_;
+    /// Camera projection matrix of the last incremental update.
+    Matrix4 lastCameraProjection_;
+    /// World bounding boxes of the point and spot lights that were shadowed on the last incremental update. Changes inside them may affect shadows in view.
+    PODVector<BoundingBox> lastShadowLightBoxes_;
     /// Renderpath.
     RenderPath* renderPath_;
     /// Per-thread octree query results.
     Vector<PODVector<Drawable*> > tempDrawables_;
     /// Per-thread geometries, lights and Z range collection results.
     Vector<PerThreadSceneResult> sceneResults_;
+    /// Per-thread shadow batch building results.
+    Vector<PerThreadShadowResult> shadowResults_;
+    /// Base pass batch building results per work item.
+    Vector<BaseBatchResult> baseBatchResults_;
     /// Visible zones.
     PODVector<Zone*> zones_;
     /// Visible geometry objects.
@@ -352,11 +550,23 @@ private:
     PODVector<Drawable*> occluders_;
     /// Lights.
     PODVector<Light*> lights_;
+    /// Drawables to render hardware occlusion queries for.
+    PODVector<Drawable*> occlusionQueryDrawables_;
+    /// Unused hardware occlusion query handles.
+    PODVector<unsigned> freeOcclusionQueries_;
+    /// Hardware occlusion query states by drawable.
+    HashMap<Drawable*, DrawableOcclusionQuery> occlusionQueries_;
+    /// Camera the hardware occlusion query results belong to.
+    WeakPtr<Camera> occlusionQueryCamera_;
     
     /// Drawables that limit their maximum light count.
     HashSet<Drawable*> maxLightsDrawables_;
     /// Rendertargets defined by the renderpath.
     HashMap<StringHash, Texture*> renderTargets_;
+    /// Names of the depth pyramid level rendertargets allocated for the current frame.
+    Vector<String> depthPyramidTargets_;
+    /// Framebuffer contents (clear flags) to discard after each renderpath command.
+    PODVector<unsigned> discardFlags_;
     /// Intermediate light processing results.
     Vector<LightQueryResult> lightQueryResults_;
     /// Info for scene render passes defined by the renderpath.
@@ -365,6 +575,32 @@ private:
     Vector<LightBatchQueue> lightQueues_;
     /// Per-vertex light queues.
     HashMap<unsigned long long, LightBatchQueue> vertexLightQueues_;
+    /// Mutex for creating per-vertex light queues from the base batch work items.
+    Mutex vertexLightQueueMutex_;
+    /// Lights shaded through the light cluster grid.
+    PODVector<Light*> clusterLights_;
+    /// Instanced point light volume draw calls.
+    Vector<BatchGroup> lightVolumeGroups_;
+    /// Per-light instance data of the instanced light volumes: position & range, color & specular intensity, inverse range.
+    PODVector<Matrix3x4> lightVolumeInstances_;
+    /// Grouping keys of the instanced light volume draw calls.
+    PODVector<unsigned long long> lightVolumeGroupKeys_;
+    /// Instance list allocator for the instanced light volume draw calls.
+    LinearAllocator lightVolumeAllocator_;
+    /// Cluster grid ranges of the clustered lights.
+    PODVector<LightClusterBounds> clusterLightBounds_;
+    /// Number of lights in each cluster.
+    PODVector<unsigned char> clusterLightCounts_;
+    /// Light indices of each cluster, MAX_LIGHTS_PER_CLUSTER per cluster.
+    PODVector<unsigned char> clusterLightIndices_;
+    /// Light cluster texture data: light parameters, cluster grid and compacted light index lists.
+    PODVector<Vector4> clusterData_;
+    /// Number of used light cluster texture rows.
+    int numClusterDataRows_;
+    /// View-projection matrix the light cluster grid was built with.
+    Matrix4 clusterViewProj_;
+    /// Light cluster grid shader parameters: tile counts and depth slice scale and bias.
+    Vector4 clusterParams_;
     /// Batch queues by pass index.
     HashMap<unsigned, BatchQueue> batchQueues_;
     /// Index of the GBuffer pass.
@@ -383,6 +619,8 @@ private:
     const RenderPathCommand* lightVolumeCommand_;
     /// Flag for scene being resolved from the backbuffer.
     bool usedResolve_;
+    /// Flag for the current renderpath command having set its rendertargets.
+    bool renderTargetsSet_;
 };
 
 }
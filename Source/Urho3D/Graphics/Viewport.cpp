@@ -39,7 +39,10 @@ namespace Urho3D
 Viewport::Viewport(Context* context) :
     Object(context),
     rect_(IntRect::ZERO),
-    drawDebug_(true)
+    maxUpdateInterval_(0),
+    cullGroup_(0),
+    drawDebug_(true),
+    incrementalUpdate_(false)
 {
     SetRenderPath((RenderPath*)0);
 }
@@ -49,7 +52,10 @@ Viewport::Viewport(Context* context, Scene* scene, Camera* camera, RenderPath* r
     scene_(scene),
     camera_(camera),
     rect_(IntRect::ZERO),
-    drawDebug_(true)
+    maxUpdateInterval_(0),
+    cullGroup_(0),
+    drawDebug_(true),
+    incrementalUpdate_(false)
 {
     SetRenderPath(renderPath);
 }
@@ -59,7 +65,10 @@ Viewport::Viewport(Context* context, Scene* scene, Camera* camera, const IntRect
     scene_(scene),
     camera_(camera),
     rect_(rect),
-    drawDebug_(true)
+    maxUpdateInterval_(0),
+    cullGroup_(0),
+    drawDebug_(true),
+    incrementalUpdate_(false)
 {
     SetRenderPath(renderPath);
 }
@@ -88,6 +97,21 @@ void Viewport::SetDrawDebug(bool enable)
     drawDebug_ = enable;
 }
 
+void Viewport::SetIncrementalUpdate(bool enable)
+{
+    incrementalUpdate_ = enable;
+}
+
+void Viewport::SetMaxUpdateInterval(unsigned frames)
+{
+    maxUpdateInterval_ = frames;
+}
+
+void Viewport::SetCullGroup(unsigned group)
+{
+    cullGroup_ = group;
+}
+
 void Viewport::SetRenderPath(RenderPath* renderPath)
 {
     if (renderPath)
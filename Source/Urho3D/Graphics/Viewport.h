@@ -64,6 +64,12 @@ public:
     void SetRenderPath(XMLFile* file);
     /// Set whether to render debug geometry. Default true.
     void SetDrawDebug(bool enable);
+    /// Set incremental update. When enabled and rendering to a texture, the view is not updated or rendered again while the camera and the octree contents it can see stay unchanged. Default false.
+    void SetIncrementalUpdate(bool enable);
+    /// Set maximum number of frames an incrementally updated view can stay without update, for changes that are not detected, such as material or light color changes. 0 (default) is unlimited.
+    void SetMaxUpdateInterval(unsigned frames);
+    /// Set cull group. Views of the same scene in the same nonzero group, such as the faces of a cube texture or the eyes of a stereo pair, share one octree query per frame and only cull its result against their own frustums. Default 0 (no sharing.)
+    void SetCullGroup(unsigned group);
     
     /// Return scene.
     Scene* GetScene() const;
@@ -77,6 +83,12 @@ public:
     RenderPath* GetRenderPath() const;
     /// Return whether to draw debug geometry.
     bool GetDrawDebug() const { return drawDebug_; }
+    /// Return whether incremental update is enabled.
+    bool GetIncrementalUpdate() const { return incrementalUpdate_; }
+    /// Return maximum number of frames between incremental updates.
+    unsigned GetMaxUpdateInterval() const { return maxUpdateInterval_; }
+    /// Return cull group.
+    unsigned GetCullGroup() const { return cullGroup_; }
     /// Return ray corresponding to normalized screen coordinates.
     Ray GetScreenRay(int x, int y) const;
     // Convert a world space point to normalized screen coordinates.
@@ -98,8 +110,14 @@ private:
     SharedPtr<RenderPath> renderPath_;
     /// Internal rendering structure.
     SharedPtr<View> view_;
+    /// Maximum frames between incremental updates.
+    unsigned maxUpdateInterval_;
+    /// Cull group.
+    unsigned cullGroup_;
     /// Debug draw flag.
     bool drawDebug_;
+    /// Incremental update flag.
+    bool incrementalUpdate_;
 };
 
 }
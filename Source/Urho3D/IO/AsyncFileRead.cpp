@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../IO/File.h"
+#include "../IO/Log.h"
+#include "../IO/PackageFile.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Work function for asynchronous file reads.
+static void AsyncFileReadWork(const WorkItem* item, unsigned threadIndex)
+{
+    AsyncFileRead* read = reinterpret_cast<AsyncFileRead*>(item->aux_);
+
+    // Use an own file handle, so that reads in flight do not disturb each other or the original file's position
+    SharedPtr<File> file(new File(read->context_));
+    bool opened = read->package_ ? file->Open(read->package_, read->fileName_) : file->Open(read->fileName_);
+    if (opened && file->Seek(read->position_) == read->position_)
+        read->bytesRead_ = file->Read(read->buffer_, read->size_);
+
+    if (read->callback_)
+        read->callback_(read);
+}
+
+AsyncFileRead::AsyncFileRead(Context* context) :
+    context_(context),
+    position_(0),
+    size_(0),
+    buffer_(0),
+    bytesRead_(0),
+    callback_(0),
+    userData_(0)
+{
+}
+
+AsyncFileRead::~AsyncFileRead()
+{
+    if (item_ && !item_->completed_)
+    {
+        WorkQueue* queue = context_->GetSubsystem<WorkQueue>();
+        if (!queue || !queue->RemoveWorkItem(item_))
+        {
+            // The worker thread refers to this request, so its read must finish first
+            while (!item_->completed_)
+                Time::Sleep(0);
+        }
+    }
+}
+
+bool AsyncFileRead::IsCompleted() const
+{
+    return item_ && item_->completed_;
+}
+
+SharedPtr<AsyncFileRead> File::ReadAsync(unsigned position, unsigned size, void* buffer, AsyncReadCallback callback, void* userData)
+{
+    if (!IsOpen())
+        return SharedPtr<AsyncFileRead>();
+
+    if (mode_ == FILE_WRITE)
+    {
+        LOGERROR("File not opened for reading");
+        return SharedPtr<AsyncFileRead>();
+    }
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue)
+    {
+        LOGERROR("No work queue for asynchronous reading of file " + GetName());
+        return SharedPtr<AsyncFileRead>();
+    }
+
+    if (position > size_)
+        position = size_;
+    if (size > size_ - position)
+        size = size_ - position;
+
+    SharedPtr<AsyncFileRead> read(new AsyncFileRead(context_));
+    read->package_ = package_;
+    read->fileName_ = openName_;
+    read->position_ = position;
+    read->size_ = size;
+    read->buffer_ = buffer;
+    read->callback_ = callback;
+    read->userData_ = userData;
+
+    // Use an own work item instead of the pool, so that it stays valid for polling after completion
+    read->item_ = new WorkItem();
+    read->item_->workFunction_ = AsyncFileReadWork;
+    read->item_->aux_ = read.Get();
+    read->item_->priority_ = 0;
+    queue->AddWorkItem(read->item_);
+
+    return read;
+}
+
+}
@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../IO/BitStream.h"
+#include "../Math/Quaternion.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Largest magnitude of the three smallest components of a unit quaternion.
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+
+static inline unsigned GetMaxQuantized(unsigned numBits)
+{
+    return numBits >= 32 ? 0xffffffff : (1u << numBits) - 1;
+}
+
+BitWriter::BitWriter() :
+    numBits_(0)
+{
+}
+
+void BitWriter::WriteBits(unsigned value, unsigned numBits)
+{
+    if (numBits > 32)
+        numBits = 32;
+
+    for (unsigned i = 0; i < numBits; ++i)
+    {
+        unsigned bitIndex = numBits_ & 7;
+        if (!bitIndex)
+            buffer_.Push(0);
+        if (value & (1u << i))
+            buffer_.Back() |= (unsigned char)(1u << bitIndex);
+        ++numBits_;
+    }
+}
+
+void BitWriter::WriteBool(bool value)
+{
+    WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteQuantizedFloat(float value, float min, float max, unsigned numBits)
+{
+    unsigned maxQuantized = GetMaxQuantized(numBits);
+    float range = max - min;
+    float normalized = range > 0.0f ? Clamp((value - min) / range, 0.0f, 1.0f) : 0.0f;
+    WriteBits((unsigned)((double)normalized * maxQuantized + 0.5), numBits);
+}
+
+void BitWriter::WriteSmallestThree(const Quaternion& value, unsigned numBits)
+{
+    float components[4] = { value.w_, value.x_, value.y_, value.z_ };
+
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so flip the sign to make the omitted component positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    WriteBits(largest, 2);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+            WriteQuantizedFloat(components[i] * sign, -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, numBits);
+    }
+}
+
+void BitWriter::Clear()
+{
+    buffer_.Clear();
+    numBits_ = 0;
+}
+
+BitReader::BitReader(const void* data, unsigned size) :
+    data_((const unsigned char*)data),
+    size_(data ? size : 0),
+    position_(0)
+{
+}
+
+unsigned BitReader::ReadBits(unsigned numBits)
+{
+    if (numBits > 32)
+        numBits = 32;
+
+    unsigned value = 0;
+    for (unsigned i = 0; i < numBits; ++i)
+    {
+        if (position_ < size_ * 8 && (data_[position_ >> 3] & (1u << (position_ & 7))))
+            value |= 1u << i;
+        ++position_;
+    }
+
+    return value;
+}
+
+bool BitReader::ReadBool()
+{
+    return ReadBits(1) != 0;
+}
+
+float BitReader::ReadQuantizedFloat(float min, float max, unsigned numBits)
+{
+    unsigned maxQuantized = GetMaxQuantized(numBits);
+    unsigned quantized = ReadBits(numBits);
+    return maxQuantized ? (float)(min + (double)quantized / maxQuantized * (max - min)) : min;
+}
+
+Quaternion BitReader::ReadSmallestThree(unsigned numBits)
+{
+    unsigned largest = ReadBits(2);
+    float components[4];
+    float sumSquares = 0.0f;
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            components[i] = ReadQuantizedFloat(-SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, numBits);
+            sumSquares += components[i] * components[i];
+        }
+    }
+
+    components[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+    Quaternion ret(components[0], components[1], components[2], components[3]);
+    ret.Normalize();
+    return ret;
+}
+
+unsigned GetQuantizationBits(float min, float max, float precision)
+{
+    if (max <= min || precision <= 0.0f)
+        return 32;
+
+    double steps = (double)(max - min) / precision;
+    unsigned bits = 1;
+    while (bits < 32 && (double)GetMaxQuantized(bits) < steps)
+        ++bits;
+
+    return bits;
+}
+
+}
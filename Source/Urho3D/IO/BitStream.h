@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+
+namespace Urho3D
+{
+
+class Quaternion;
+
+/// Bit-granular stream writer into an internal byte buffer.
+class URHO3D_API BitWriter
+{
+public:
+    /// Construct empty.
+    BitWriter();
+
+    /// Write the lowest bits of a value. Up to 32 bits can be written at once.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a bool as a single bit.
+    void WriteBool(bool value);
+    /// Write a float quantized to a range with the specified number of bits. Values outside the range are clamped.
+    void WriteQuantizedFloat(float value, float min, float max, unsigned numBits);
+    /// Write a unit quaternion in the smallest three format: the index of the largest component and the three others quantized with the specified number of bits each.
+    void WriteSmallestThree(const Quaternion& value, unsigned numBits);
+    /// Clear the written data.
+    void Clear();
+
+    /// Return the written data. The last byte is padded with zero bits.
+    const unsigned char* GetData() const { return buffer_.Size() ? &buffer_[0] : 0; }
+    /// Return number of written bytes, including the partial last byte.
+    unsigned GetSize() const { return buffer_.Size(); }
+    /// Return number of written bits.
+    unsigned GetNumBits() const { return numBits_; }
+
+private:
+    /// Byte buffer.
+    PODVector<unsigned char> buffer_;
+    /// Number of written bits.
+    unsigned numBits_;
+};
+
+/// Bit-granular stream reader from a memory area.
+class URHO3D_API BitReader
+{
+public:
+    /// Construct with a pointer and size in bytes.
+    BitReader(const void* data, unsigned size);
+
+    /// Read bits into the lowest bits of the return value. Up to 32 bits can be read at once. Reading past the end returns zero bits.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a bool from a single bit.
+    bool ReadBool();
+    /// Read a float quantized to a range with the specified number of bits.
+    float ReadQuantizedFloat(float min, float max, unsigned numBits);
+    /// Read a unit quaternion in the smallest three format.
+    Quaternion ReadSmallestThree(unsigned numBits);
+
+    /// Return number of bits read.
+    unsigned GetPosition() const { return position_; }
+    /// Return whether the end of data has been reached.
+    bool IsEof() const { return position_ >= size_ * 8; }
+
+private:
+    /// Data.
+    const unsigned char* data_;
+    /// Size in bytes.
+    unsigned size_;
+    /// Read position in bits.
+    unsigned position_;
+};
+
+/// Return the number of bits needed to quantize a range with the specified precision.
+URHO3D_API unsigned GetQuantizationBits(float min, float max, float precision);
+
+}
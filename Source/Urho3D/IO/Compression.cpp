@@ -26,12 +26,101 @@
 #include "../IO/Serializer.h"
 #include "../IO/VectorBuffer.h"
 
+#include <cstring>
 #include <LZ4/lz4.h>
 #include <LZ4/lz4hc.h>
 
 namespace Urho3D
 {
 
+/// Maximum distance LZ4 can refer back to, which limits the useful dictionary size.
+static const unsigned LZ4_MAX_DICTIONARY_SIZE = 65536;
+/// Minimum input buffer size required by the LZ4 streaming functions.
+static const unsigned LZ4_MIN_STREAM_BUFFER_SIZE = 196608;
+
+LZ4Codec::LZ4Codec(bool highCompression) :
+    highCompression_(highCompression)
+{
+}
+
+unsigned LZ4Codec::GetCompressBound(unsigned srcSize) const
+{
+    return LZ4_compressBound(srcSize);
+}
+
+unsigned LZ4Codec::Compress(void* dest, const void* src, unsigned srcSize)
+{
+    if (!dest || !src || !srcSize)
+        return 0;
+    
+    if (dictionary_.Empty())
+        return highCompression_ ? LZ4_compressHC((const char*)src, (char*)dest, srcSize) : LZ4_compress((const char*)src,
+            (char*)dest, srcSize);
+    
+    // Compress the dictionary and the data as consecutive dependent blocks, so that the data can refer back to the
+    // dictionary. Only the data block is output
+    unsigned dictSize = dictionary_.Size();
+    unsigned bufferSize = dictSize + srcSize;
+    if (bufferSize < LZ4_MIN_STREAM_BUFFER_SIZE)
+        bufferSize = LZ4_MIN_STREAM_BUFFER_SIZE;
+    SharedArrayPtr<char> input(new char[bufferSize]);
+    SharedArrayPtr<char> dictOutput(new char[LZ4_compressBound(dictSize)]);
+    memcpy(input.Get(), &dictionary_[0], dictSize);
+    memcpy(input.Get() + dictSize, src, srcSize);
+    
+    unsigned destSize = 0;
+    if (highCompression_)
+    {
+        void* stream = LZ4_createHC(input.Get());
+        if (!stream)
+            return 0;
+        LZ4_compressHC_continue(stream, input.Get(), dictOutput.Get(), dictSize);
+        destSize = LZ4_compressHC_continue(stream, input.Get() + dictSize, (char*)dest, srcSize);
+        LZ4_freeHC(stream);
+    }
+    else
+    {
+        void* stream = LZ4_create(input.Get());
+        if (!stream)
+            return 0;
+        LZ4_compress_continue(stream, input.Get(), dictOutput.Get(), dictSize);
+        destSize = LZ4_compress_continue(stream, input.Get() + dictSize, (char*)dest, srcSize);
+        LZ4_free(stream);
+    }
+    
+    return destSize;
+}
+
+bool LZ4Codec::Decompress(void* dest, unsigned destSize, const void* src, unsigned srcSize)
+{
+    if (!dest || !src || !destSize)
+        return false;
+    
+    if (dictionary_.Empty())
+        return LZ4_decompress_safe((const char*)src, (char*)dest, srcSize, destSize) == (int)destSize;
+    
+    // Decompress right after a copy of the dictionary, so that back references into it resolve
+    unsigned dictSize = dictionary_.Size();
+    SharedArrayPtr<char> output(new char[dictSize + destSize]);
+    memcpy(output.Get(), &dictionary_[0], dictSize);
+    if (LZ4_decompress_safe_withPrefix64k((const char*)src, output.Get() + dictSize, srcSize, destSize) != (int)destSize)
+        return false;
+    
+    memcpy(dest, output.Get() + dictSize, destSize);
+    return true;
+}
+
+void LZ4Codec::SetDictionary(const PODVector<unsigned char>& dictionary)
+{
+    if (dictionary.Size() <= LZ4_MAX_DICTIONARY_SIZE)
+        dictionary_ = dictionary;
+    else
+    {
+        dictionary_.Resize(LZ4_MAX_DICTIONARY_SIZE);
+        memcpy(&dictionary_[0], &dictionary[dictionary.Size() - LZ4_MAX_DICTIONARY_SIZE], LZ4_MAX_DICTIONARY_SIZE);
+    }
+}
+
 unsigned EstimateCompressBound(unsigned srcSize)
 {
     return LZ4_compressBound(srcSize);
@@ -53,8 +142,12 @@ unsigned DecompressData(void* dest, const void* src, unsigned destSize)
         return LZ4_decompress_fast((const char*)src, (char*)dest, destSize);
 }
 
-bool CompressStream(Serializer& dest, Deserializer& src)
+bool CompressStream(Serializer& dest, Deserializer& src, CompressionCodec* codec)
 {
+    LZ4Codec defaultCodec;
+    if (!codec)
+        codec = &defaultCodec;
+    
     unsigned srcSize = src.GetSize() - src.GetPosition();
     // Prepend the source and dest. data size in the stream so that we know to buffer & uncompress the right amount
     if (!srcSize)
@@ -64,14 +157,17 @@ bool CompressStream(Serializer& dest, Deserializer& src)
         return true;
     }
     
-    unsigned maxDestSize = LZ4_compressBound(srcSize);
+    unsigned maxDestSize = codec->GetCompressBound(srcSize);
     SharedArrayPtr<unsigned char> srcBuffer(new unsigned char[srcSize]);
     SharedArrayPtr<unsigned char> destBuffer(new unsigned char[maxDestSize]);
     
     if (src.Read(srcBuffer, srcSize) != srcSize)
         return false;
     
-    unsigned destSize = LZ4_compressHC((const char*)srcBuffer.Get(), (char*)destBuffer.Get(), srcSize);
+    unsigned destSize = codec->Compress(destBuffer.Get(), srcBuffer.Get(), srcSize);
+    if (!destSize)
+        return false;
+    
     bool success = true;
     success &= dest.WriteUInt(srcSize);
     success &= dest.WriteUInt(destSize);
@@ -79,8 +175,12 @@ bool CompressStream(Serializer& dest, Deserializer& src)
     return success;
 }
 
-bool DecompressStream(Serializer& dest, Deserializer& src)
+bool DecompressStream(Serializer& dest, Deserializer& src, CompressionCodec* codec)
 {
+    LZ4Codec defaultCodec;
+    if (!codec)
+        codec = &defaultCodec;
+    
     if (src.IsEof())
         return false;
     
@@ -98,24 +198,26 @@ bool DecompressStream(Serializer& dest, Deserializer& src)
     if (src.Read(srcBuffer, srcSize) != srcSize)
         return false;
     
-    LZ4_decompress_fast((const char*)srcBuffer.Get(), (char*)destBuffer.Get(), destSize);
+    if (!codec->Decompress(destBuffer.Get(), destSize, srcBuffer.Get(), srcSize))
+        return false;
+    
     return dest.Write(destBuffer, destSize) == destSize;
 }
 
-VectorBuffer CompressVectorBuffer(VectorBuffer& src)
+VectorBuffer CompressVectorBuffer(VectorBuffer& src, CompressionCodec* codec)
 {
     VectorBuffer ret;
     src.Seek(0);
-    CompressStream(ret, src);
+    CompressStream(ret, src, codec);
     ret.Seek(0);
     return ret;
 }
 
-VectorBuffer DecompressVectorBuffer(VectorBuffer& src)
+VectorBuffer DecompressVectorBuffer(VectorBuffer& src, CompressionCodec* codec)
 {
     VectorBuffer ret;
     src.Seek(0);
-    DecompressStream(ret, src);
+    DecompressStream(ret, src, codec);
     ret.Seek(0);
     return ret;
 }
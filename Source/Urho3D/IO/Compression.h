@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include "../Container/RefCounted.h"
+#include "../Container/Vector.h"
+
 namespace Urho3D
 {
 
@@ -29,19 +32,62 @@ class Deserializer;
 class Serializer;
 class VectorBuffer;
 
+/// Compression algorithm for the stream and VectorBuffer compression functions. Subclass to plug in other algorithms, for example Zstandard. Both ends must use the same codec and settings.
+class URHO3D_API CompressionCodec : public RefCounted
+{
+public:
+    /// Destruct.
+    virtual ~CompressionCodec() {}
+    
+    /// Return worst case compressed output size in bytes for given input size.
+    virtual unsigned GetCompressBound(unsigned srcSize) const = 0;
+    /// Compress data and return the compressed data size, or 0 on failure. The destination buffer must be at least GetCompressBound() bytes.
+    virtual unsigned Compress(void* dest, const void* src, unsigned srcSize) = 0;
+    /// Decompress data of known uncompressed size. Return true on success.
+    virtual bool Decompress(void* dest, unsigned destSize, const void* src, unsigned srcSize) = 0;
+};
+
+/// LZ4 compression codec with an optional preset dictionary. A dictionary of typical content, such as samples of small XML or JSON files, improves compression of data too small to compress well on its own.
+class URHO3D_API LZ4Codec : public CompressionCodec
+{
+public:
+    /// Construct. High compression mode is slower to compress but has the same decompression speed.
+    LZ4Codec(bool highCompression = true);
+    
+    /// Return worst case compressed output size in bytes for given input size.
+    virtual unsigned GetCompressBound(unsigned srcSize) const;
+    /// Compress data and return the compressed data size, or 0 on failure.
+    virtual unsigned Compress(void* dest, const void* src, unsigned srcSize);
+    /// Decompress data of known uncompressed size. Return true on success.
+    virtual bool Decompress(void* dest, unsigned destSize, const void* src, unsigned srcSize);
+    
+    /// Set the preset dictionary. Only the last 64 KB are used. Empty to disable.
+    void SetDictionary(const PODVector<unsigned char>& dictionary);
+    /// Return the preset dictionary.
+    const PODVector<unsigned char>& GetDictionary() const { return dictionary_; }
+    /// Return whether uses high compression mode.
+    bool GetHighCompression() const { return highCompression_; }
+    
+private:
+    /// Preset dictionary.
+    PODVector<unsigned char> dictionary_;
+    /// High compression mode flag.
+    bool highCompression_;
+};
+
 /// Estimate and return worst case LZ4 compressed output size in bytes for given input size.
 URHO3D_API unsigned EstimateCompressBound(unsigned srcSize);
 /// Compress data using the LZ4 algorithm and return the compressed data size. The needed destination buffer worst-case size is given by EstimateCompressBound().
 URHO3D_API unsigned CompressData(void* dest, const void* src, unsigned srcSize);
 /// Uncompress data using the LZ4 algorithm. The uncompressed data size must be known. Return the number of compressed data bytes consumed.
 URHO3D_API unsigned DecompressData(void* dest, const void* src, unsigned destSize);
-/// Compress a source stream (from current position to the end) to the destination stream using the LZ4 algorithm. Return true on success.
-URHO3D_API bool CompressStream(Serializer& dest, Deserializer& src);
-/// Decompress a compressed source stream produced using CompressStream() to the destination stream. Return true on success.
-URHO3D_API bool DecompressStream(Serializer& dest, Deserializer& src);
-/// Compress a VectorBuffer using the LZ4 algorithm and return the compressed result buffer.
-URHO3D_API VectorBuffer CompressVectorBuffer(VectorBuffer& src);
-/// Decompress a VectorBuffer produced using CompressVectorBuffer().
-URHO3D_API VectorBuffer DecompressVectorBuffer(VectorBuffer& src);
+/// Compress a source stream (from current position to the end) to the destination stream using the given codec, or LZ4 if null. Return true on success.
+URHO3D_API bool CompressStream(Serializer& dest, Deserializer& src, CompressionCodec* codec = 0);
+/// Decompress a compressed source stream produced using CompressStream() with the same codec to the destination stream. Return true on success.
+URHO3D_API bool DecompressStream(Serializer& dest, Deserializer& src, CompressionCodec* codec = 0);
+/// Compress a VectorBuffer using the given codec, or LZ4 if null, and return the compressed result buffer.
+URHO3D_API VectorBuffer CompressVectorBuffer(VectorBuffer& src, CompressionCodec* codec = 0);
+/// Decompress a VectorBuffer produced using CompressVectorBuffer() with the same codec.
+URHO3D_API VectorBuffer DecompressVectorBuffer(VectorBuffer& src, CompressionCodec* codec = 0);
 
 }
@@ -60,13 +60,17 @@ static const unsigned SKIP_BUFFER_SIZE = 1024;
 
 File::File(Context* context) :
     Object(context),
+    package_(0),
     mode_(FILE_READ),
     handle_(0),
+    mapping_(0),
+    mappedData_(0),
     #ifdef ANDROID
     assetHandle_(0),
     #endif
     readBufferOffset_(0),
     readBufferSize_(0),
+    compressedBlockSize_(0),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -77,13 +81,17 @@ File::File(Context* context) :
 
 File::File(Context* context, const String& fileName, FileMode mode) :
     Object(context),
+    package_(0),
     mode_(FILE_READ),
     handle_(0),
+    mapping_(0),
+    mappedData_(0),
     #ifdef ANDROID
     assetHandle_(0),
     #endif
     readBufferOffset_(0),
     readBufferSize_(0),
+    compressedBlockSize_(0),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -95,13 +103,17 @@ File::File(Context* context, const String& fileName, FileMode mode) :
 
 File::File(Context* context, PackageFile* package, const String& fileName) :
     Object(context),
+    package_(0),
     mode_(FILE_READ),
     handle_(0),
+    mapping_(0),
+    mappedData_(0),
     #ifdef ANDROID
     assetHandle_(0),
     #endif
     readBufferOffset_(0),
     readBufferSize_(0),
+    compressedBlockSize_(0),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -145,6 +157,8 @@ bool File::Open(const String& fileName, FileMode mode)
         else
         {
             fileName_ = fileName;
+            openName_ = fileName;
+            package_ = 0;
             mode_ = mode;
             position_ = 0;
             offset_ = 0;
@@ -187,6 +201,8 @@ bool File::Open(const String& fileName, FileMode mode)
     }
 
     fileName_ = fileName;
+    openName_ = fileName;
+    package_ = 0;
     mode_ = mode;
     position_ = 0;
     offset_ = 0;
@@ -220,18 +236,31 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
-    #ifdef WIN32
-    handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
-    #else
-    handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
-    #endif
-    if (!handle_)
+    // Read directly from the package's memory mapping if it exists
+    PackageFileMapping* mapping = package->GetMapping();
+    if (mapping)
     {
-        LOGERROR("Could not open package file " + fileName);
-        return false;
+        mapping->AddRef();
+        mapping_ = mapping;
+        mappedData_ = mapping->GetData() + entry->offset_;
+    }
+    else
+    {
+        #ifdef WIN32
+        handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
+        #else
+        handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
+        #endif
+        if (!handle_)
+        {
+            LOGERROR("Could not open package file " + fileName);
+            return false;
+        }
     }
 
     fileName_ = fileName;
+    openName_ = fileName;
+    package_ = package;
     mode_ = FILE_READ;
     offset_ = entry->offset_;
     checksum_ = entry->checksum_;
@@ -241,16 +270,38 @@ bool File::Open(PackageFile* package, const String& fileName)
     readSyncNeeded_ = false;
     writeSyncNeeded_ = false;
 
-    fseek((FILE*)handle_, offset_, SEEK_SET);
+    if (handle_)
+    {
+        fseek((FILE*)handle_, offset_, SEEK_SET);
+
+        // Read the block offset table for random access to compressed data
+        if (compressed_ && package->HasBlockIndex())
+        {
+            unsigned numBlocks = 0;
+            fread(&numBlocks, sizeof numBlocks, 1, (FILE*)handle_);
+            fread(&compressedBlockSize_, sizeof compressedBlockSize_, 1, (FILE*)handle_);
+            blockOffsets_.Resize(numBlocks);
+            if (numBlocks && fread(&blockOffsets_[0], numBlocks * sizeof(unsigned), 1, (FILE*)handle_) != 1)
+            {
+                LOGERROR("Could not read block index of " + fileName + " from package file");
+                Close();
+                return false;
+            }
+            for (unsigned i = 0; i < numBlocks; ++i)
+                blockOffsets_[i] += offset_;
+            if (numBlocks)
+                fseek((FILE*)handle_, blockOffsets_[0], SEEK_SET);
+        }
+    }
     return true;
 }
 
 unsigned File::Read(void* dest, unsigned size)
 {
     #ifdef ANDROID
-    if (!handle_ && !assetHandle_)
+    if (!handle_ && !assetHandle_ && !mappedData_)
     #else
-    if (!handle_)
+    if (!handle_ && !mappedData_)
     #endif
     {
         // Do not log the error further here to prevent spamming the stderr stream
@@ -294,6 +345,13 @@ unsigned File::Read(void* dest, unsigned size)
         return size;
     }
     #endif
+    if (mappedData_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
     if (compressed_)
     {
         unsigned sizeLeft = size;
@@ -312,8 +370,10 @@ unsigned File::Read(void* dest, unsigned size)
 
                 if (!readBuffer_)
                 {
-                    readBuffer_ = new unsigned char[unpackedSize];
-                    inputBuffer_ = new unsigned char[LZ4_compressBound(unpackedSize)];
+                    // After a seek the first block read may be the shorter last block, so allocate for the full block size
+                    unsigned bufferSize = unpackedSize > compressedBlockSize_ ? unpackedSize : compressedBlockSize_;
+                    readBuffer_ = new unsigned char[bufferSize];
+                    inputBuffer_ = new unsigned char[LZ4_compressBound(bufferSize)];
                 }
 
                 /// \todo Handle errors
@@ -359,9 +419,9 @@ unsigned File::Read(void* dest, unsigned size)
 unsigned File::Seek(unsigned position)
 {
     #ifdef ANDROID
-    if (!handle_ && !assetHandle_)
+    if (!handle_ && !assetHandle_ && !mappedData_)
     #else
-    if (!handle_)
+    if (!handle_ && !mappedData_)
     #endif
     {
         // Do not log the error further here to prevent spamming the stderr stream
@@ -382,8 +442,44 @@ unsigned File::Seek(unsigned position)
         return position_;
     }
     #endif
+    if (mappedData_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     if (compressed_)
     {
+        // Seek within the current decompressed block without reading
+        unsigned blockStart = position_ - readBufferOffset_;
+        if (readBuffer_ && readBufferSize_ && position >= blockStart && position < blockStart + readBufferSize_)
+        {
+            readBufferOffset_ = position - blockStart;
+            position_ = position;
+            return position_;
+        }
+
+        // With a block index, jump to the block containing the position and skip only within it
+        if (!blockOffsets_.Empty())
+        {
+            readBufferOffset_ = 0;
+            readBufferSize_ = 0;
+            if (position >= size_)
+            {
+                position_ = size_;
+                return position_;
+            }
+
+            unsigned block = position / compressedBlockSize_;
+            fseek((FILE*)handle_, blockOffsets_[block], SEEK_SET);
+            position_ = block * compressedBlockSize_;
+
+            unsigned char skipBuffer[SKIP_BUFFER_SIZE];
+            while (position > position_)
+                Read(skipBuffer, Min((int)position - position_, (int)SKIP_BUFFER_SIZE));
+            return position_;
+        }
+
         // Start over from the beginning
         if (position == 0)
         {
@@ -493,6 +589,19 @@ void File::Close()
 
     readBuffer_.Reset();
     inputBuffer_.Reset();
+    blockOffsets_.Clear();
+    compressedBlockSize_ = 0;
+
+    if (mapping_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+        mappedData_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
 
     if (handle_)
     {
@@ -519,9 +628,9 @@ void File::SetName(const String& name)
 bool File::IsOpen() const
 {
     #ifdef ANDROID
-        return handle_ != 0 || assetHandle_ != 0;
+        return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
     #else
-        return handle_ != 0;
+        return handle_ != 0 || mappedData_ != 0;
     #endif
 }
 
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/ArrayPtr.h"
+#include "../Container/Vector.h"
 #include "../IO/Deserializer.h"
 #include "../IO/Serializer.h"
 #include "../Core/Object.h"
@@ -42,7 +43,47 @@ enum FileMode
     FILE_READWRITE
 };
 
+class File;
 class PackageFile;
+class PackageFileMapping;
+struct AsyncFileRead;
+struct WorkItem;
+
+/// Completion callback of an asynchronous file read. Called from the worker thread that performed the read.
+typedef void (*AsyncReadCallback)(AsyncFileRead* read);
+
+/// Asynchronous file read request. Must stay referenced until completed; the destination buffer must not be accessed before that.
+struct URHO3D_API AsyncFileRead : public RefCounted
+{
+    /// Construct.
+    AsyncFileRead(Context* context);
+    /// Destruct. Cancel the read if not started yet, or wait for it to finish.
+    ~AsyncFileRead();
+
+    /// Return whether the read has completed.
+    bool IsCompleted() const;
+
+    /// Execution context.
+    Context* context_;
+    /// Package to read from, or null to read from the filesystem.
+    SharedPtr<PackageFile> package_;
+    /// Name of the file in the filesystem or within the package.
+    String fileName_;
+    /// Position to read from.
+    unsigned position_;
+    /// Number of bytes to read.
+    unsigned size_;
+    /// Destination buffer.
+    void* buffer_;
+    /// Number of bytes actually read. Valid after completion.
+    unsigned bytesRead_;
+    /// Completion callback, or null to only poll for completion.
+    AsyncReadCallback callback_;
+    /// User data pointer for the callback.
+    void* userData_;
+    /// Work item.
+    SharedPtr<WorkItem> item_;
+};
 
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public Deserializer, public Serializer
@@ -70,6 +111,8 @@ public:
     /// Return a checksum of the file contents using the SDBM hash algorithm.
     virtual unsigned GetChecksum();
     
+    /// Read bytes from a position in a worker thread, without using or changing the file position. Many reads can be in flight at the same time. The optional callback is called from the worker thread on completion. Return the read request, or null if the file is not open for reading. Must be called from the main thread.
+    SharedPtr<AsyncFileRead> ReadAsync(unsigned position, unsigned size, void* buffer, AsyncReadCallback callback = 0, void* userData = 0);
     /// Open a filesystem file. Return true if successful.
     bool Open(const String& fileName, FileMode mode = FILE_READ);
     /// Open from within a package file. Return true if successful.
@@ -89,14 +132,24 @@ public:
     void* GetHandle() const { return handle_; }
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
+    /// Return the file contents when opened from a memory mapped package, or null otherwise. Valid until the file is closed. Can be wrapped in a MemoryBuffer to read without copying.
+    const unsigned char* GetMappedData() const { return mappedData_; }
     
 private:
     /// File name.
     String fileName_;
+    /// File name used to open the file, before any renaming. Used to reopen the file for asynchronous reads.
+    String openName_;
+    /// Package the file was opened from, or null for a filesystem file. Not owned.
+    PackageFile* package_;
     /// Open mode.
     FileMode mode_;
     /// File handle.
     void* handle_;
+    /// Memory mapping of the package file, when reading from a mapped package.
+    PackageFileMapping* mapping_;
+    /// Start of the file contents within the memory mapping.
+    const unsigned char* mappedData_;
     #ifdef ANDROID
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
@@ -109,6 +162,10 @@ private:
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
     unsigned readBufferSize_;
+    /// Package file offsets of the compressed blocks, when the package has a block index.
+    PODVector<unsigned> blockOffsets_;
+    /// Uncompressed size of each compressed block except the last, when the package has a block index.
+    unsigned compressedBlockSize_;
     /// Start position within a package file, 0 for regular files.
     unsigned offset_;
     /// Content checksum.
@@ -341,4 +341,26 @@ bool FileWatcher::GetNextChange(String& dest)
     }
 }
 
+bool FileWatcher::GetChanges(Vector<String>& dest)
+{
+    MutexLock lock(changesMutex_);
+    
+    if (changes_.Empty())
+        return false;
+    
+    // Hold back the whole batch while any file is still being modified, so that files saved together are returned together
+    unsigned delayMsec = (unsigned)(delay_ * 1000.0f);
+    for (HashMap<String, Timer>::Iterator i = changes_.Begin(); i != changes_.End(); ++i)
+    {
+        if (i->second_.GetMSec(false) < delayMsec)
+            return false;
+    }
+    
+    dest.Reserve(dest.Size() + changes_.Size());
+    for (HashMap<String, Timer>::Iterator i = changes_.Begin(); i != changes_.End(); ++i)
+        dest.Push(i->first_);
+    changes_.Clear();
+    return true;
+}
+
 }
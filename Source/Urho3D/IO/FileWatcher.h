@@ -57,6 +57,8 @@ public:
     void AddChange(const String& fileName);
     /// Return a file change (true if was found, false if not.)
     bool GetNextChange(String& dest);
+    /// Return all pending file changes at once when none of them has changed within the delay. Return true if changes were returned.
+    bool GetChanges(Vector<String>& dest);
     
     /// Return the path being watched, or empty if not watching.
     const String& GetPath() const { return path_; }
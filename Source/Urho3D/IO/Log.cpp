@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../Core/Condition.h"
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../IO/File.h"
@@ -56,8 +57,130 @@ const char* logLevelPrefixes[] =
 static Log* logInstance = 0;
 static bool threadErrorDisplayed = false;
 
+/// Write a formatted message to the standard output and log file without flushing.
+static void WriteOutput(File* file, const String& message, bool error, bool print, bool newLine)
+{
+    #if !defined(ANDROID) && !defined(IOS)
+    if (print)
+    {
+        if (newLine)
+            PrintUnicodeLine(message, error);
+        else
+            PrintUnicode(message, error);
+    }
+    #endif
+
+    if (file)
+    {
+        if (newLine)
+            file->WriteLine(message);
+        else
+            file->Write(message.CString(), message.Length());
+    }
+}
+
+/// Log output queued for the background writer.
+struct QueuedLogOutput
+{
+    /// Construct undefined.
+    QueuedLogOutput()
+    {
+    }
+    
+    /// Construct with parameters.
+    QueuedLogOutput(const String& message, bool error, bool print, bool newLine) :
+        message_(message),
+        error_(error),
+        print_(print),
+        newLine_(newLine)
+    {
+    }
+    
+    /// Formatted message text.
+    String message_;
+    /// Error flag.
+    bool error_;
+    /// Print to standard output flag.
+    bool print_;
+    /// Line output flag.
+    bool newLine_;
+};
+
+/// Background thread writing queued log output to the standard output and log file.
+class LogWriter : public Thread
+{
+public:
+    /// Construct.
+    LogWriter(Log* log) :
+        log_(log)
+    {
+    }
+    
+    /// Write out queued output whenever woken up.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            wakeup_.Wait();
+            Flush();
+        }
+    }
+    
+    /// Queue output and wake up the thread.
+    void Queue(const String& message, bool error, bool print, bool newLine)
+    {
+        {
+            MutexLock lock(queueMutex_);
+            queue_.Push(QueuedLogOutput(message, error, print, newLine));
+        }
+        wakeup_.Set();
+    }
+    
+    /// Write out all queued output on the calling thread.
+    void Flush()
+    {
+        // Outputting under the output mutex keeps the order of messages when both threads flush
+        MutexLock outputLock(log_->outputMutex_);
+        {
+            MutexLock lock(queueMutex_);
+            if (queue_.Empty())
+                return;
+            output_.Swap(queue_);
+        }
+        
+        // Flush the file once per batch instead of once per message
+        for (unsigned i = 0; i < output_.Size(); ++i)
+            WriteOutput(log_->logFile_, output_[i].message_, output_[i].error_, output_[i].print_, output_[i].newLine_);
+        if (log_->logFile_)
+            log_->logFile_->Flush();
+        output_.Clear();
+    }
+    
+    /// Stop the thread and write out the remaining output.
+    void Quit()
+    {
+        shouldRun_ = false;
+        wakeup_.Set();
+        Stop();
+        Flush();
+    }
+    
+private:
+    /// Log subsystem.
+    Log* log_;
+    /// Mutex for the queue.
+    Mutex queueMutex_;
+    /// Wakeup condition.
+    Condition wakeup_;
+    /// Queued output.
+    Vector<QueuedLogOutput> queue_;
+    /// Output being written. Accessed under the output mutex.
+    Vector<QueuedLogOutput> output_;
+};
+
 Log::Log(Context* context) :
     Object(context),
+    writer_(0),
 #ifdef _DEBUG
     level_(LOG_DEBUG),
 #else
@@ -74,6 +197,8 @@ Log::Log(Context* context) :
 
 Log::~Log()
 {
+    SetAsync(false);
+    CloseBinary();
     logInstance = 0;
 }
 
@@ -90,20 +215,28 @@ void Log::Open(const String& fileName)
             Close();
     }
 
-    logFile_ = new File(context_);
-    if (logFile_->Open(fileName, FILE_WRITE))
+    SharedPtr<File> newFile(new File(context_));
+    bool success = newFile->Open(fileName, FILE_WRITE);
+    {
+        MutexLock lock(outputMutex_);
+        if (success)
+            logFile_ = newFile;
+    }
+    
+    if (success)
         Write(LOG_INFO, "Opened log file " + fileName);
     else
-    {
-        logFile_.Reset();
         Write(LOG_ERROR, "Failed to create log file " + fileName);
-    }
     #endif
 }
 
 void Log::Close()
 {
     #if !defined(ANDROID) && !defined(IOS)
+    if (writer_)
+        writer_->Flush();
+    
+    MutexLock lock(outputMutex_);
     if (logFile_ && logFile_->IsOpen())
     {
         logFile_->Close();
@@ -112,6 +245,42 @@ void Log::Close()
     #endif
 }
 
+void Log::OpenBinary(const String& fileName)
+{
+    if (fileName.Empty())
+        return;
+    CloseBinary();
+    
+    SharedPtr<File> newFile(new File(context_));
+    if (!newFile->Open(fileName, FILE_WRITE))
+    {
+        Write(LOG_ERROR, "Failed to create binary log file " + fileName);
+        return;
+    }
+    
+    newFile->WriteFileID("ULOG");
+    newFile->WriteString(Time::GetTimeStamp());
+    
+    {
+        MutexLock lock(binaryMutex_);
+        binaryFile_ = newFile;
+        binaryFormats_.Clear();
+        binaryTimer_.Reset();
+    }
+    
+    Write(LOG_INFO, "Opened binary log file " + fileName);
+}
+
+void Log::CloseBinary()
+{
+    MutexLock lock(binaryMutex_);
+    if (binaryFile_)
+    {
+        binaryFile_->Close();
+        binaryFile_.Reset();
+    }
+}
+
 void Log::SetLevel(int level)
 {
     assert(level >= LOG_DEBUG && level < LOG_NONE);
@@ -129,14 +298,37 @@ void Log::SetQuiet(bool quiet)
     quiet_ = quiet;
 }
 
+void Log::SetAsync(bool enable)
+{
+    if (enable == (writer_ != 0))
+        return;
+    
+    if (enable)
+    {
+        writer_ = new LogWriter(this);
+        if (!writer_->Run())
+        {
+            delete writer_;
+            writer_ = 0;
+        }
+    }
+    else
+    {
+        writer_->Quit();
+        delete writer_;
+        writer_ = 0;
+    }
+}
+
 void Log::Write(int level, const String& message)
 {
     assert(level >= LOG_DEBUG && level < LOG_NONE);
 
-    // If not in the main thread, store message for later processing
+    // If not in the main thread, store message for later processing. Check the level first to not lock the mutex for
+    // messages which would be discarded
     if (!Thread::IsMainThread())
     {
-        if (logInstance)
+        if (logInstance && logInstance->level_ <= level)
         {
             MutexLock lock(logInstance->logMutex_);
             logInstance->threadMessages_.Push(StoredLogMessage(message, level, false));
@@ -149,34 +341,32 @@ void Log::Write(int level, const String& message)
     if (!logInstance || logInstance->level_ > level || logInstance->inWrite_)
         return;
 
-    String formattedMessage = logLevelPrefixes[level];
-    formattedMessage += ": " + message;
-    logInstance->lastMessage_ = message;
-
+    // Build the formatted message in one buffer instead of concatenating temporaries
+    String formattedMessage;
+    formattedMessage.Reserve(message.Length() + 48);
     if (logInstance->timeStamp_)
-        formattedMessage = "[" + Time::GetTimeStamp() + "] " + formattedMessage;
+    {
+        formattedMessage += '[';
+        formattedMessage += Time::GetTimeStamp();
+        formattedMessage += "] ";
+    }
+    formattedMessage += logLevelPrefixes[level];
+    formattedMessage += ": ";
+    formattedMessage += message;
+    logInstance->lastMessage_ = message;
 
+    bool print = false;
     #if defined(ANDROID)
     int androidLevel = ANDROID_LOG_DEBUG + level;
     __android_log_print(androidLevel, "Urho3D", "%s", message.CString());
     #elif defined(IOS)
     SDL_IOS_LogMessage(message.CString());
     #else
-    if (logInstance->quiet_)
-    {
-        // If in quiet mode, still print the error message to the standard error stream
-        if (level == LOG_ERROR)
-            PrintUnicodeLine(formattedMessage, true);
-    }
-    else
-        PrintUnicodeLine(formattedMessage, level == LOG_ERROR);
+    // If in quiet mode, still print the error message to the standard error stream
+    print = !logInstance->quiet_ || level == LOG_ERROR;
     #endif
 
-    if (logInstance->logFile_)
-    {
-        logInstance->logFile_->WriteLine(formattedMessage);
-        logInstance->logFile_->Flush();
-    }
+    logInstance->Output(formattedMessage, level == LOG_ERROR, print, true);
 
     logInstance->inWrite_ = true;
 
@@ -210,6 +400,7 @@ void Log::WriteRaw(const String& message, bool error)
 
     logInstance->lastMessage_ = message;
 
+    bool print = false;
     #if defined(ANDROID)
     if (logInstance->quiet_)
     {
@@ -221,21 +412,11 @@ void Log::WriteRaw(const String& message, bool error)
     #elif defined(IOS)
     SDL_IOS_LogMessage(message.CString());
     #else
-    if (logInstance->quiet_)
-    {
-        // If in quiet mode, still print the error message to the standard error stream
-        if (error)
-            PrintUnicode(message, true);
-    }
-    else
-        PrintUnicode(message, error);
+    // If in quiet mode, still print the error message to the standard error stream
+    print = !logInstance->quiet_ || error;
     #endif
 
-    if (logInstance->logFile_)
-    {
-        logInstance->logFile_->Write(message.CString(), message.Length());
-        logInstance->logFile_->Flush();
-    }
+    logInstance->Output(message, error, print, false);
 
     logInstance->inWrite_ = true;
 
@@ -249,6 +430,102 @@ void Log::WriteRaw(const String& message, bool error)
     logInstance->inWrite_ = false;
 }
 
+void Log::WriteStructured(int level, const String& format, const VariantVector& arguments)
+{
+    assert(level >= LOG_DEBUG && level < LOG_NONE);
+    
+    if (!logInstance || logInstance->level_ > level)
+        return;
+    
+    // Write directly from any thread, as only the arguments are serialized
+    {
+        MutexLock lock(logInstance->binaryMutex_);
+        File* file = logInstance->binaryFile_;
+        if (file)
+        {
+            StringHash formatHash(format);
+            if (!logInstance->binaryFormats_.Contains(formatHash))
+            {
+                file->WriteUByte(BINARYLOG_FORMAT);
+                file->WriteStringHash(formatHash);
+                file->WriteString(format);
+                logInstance->binaryFormats_.Insert(formatHash);
+            }
+            
+            file->WriteUByte(BINARYLOG_MESSAGE);
+            file->WriteUInt(logInstance->binaryTimer_.GetMSec(false));
+            file->WriteUByte((unsigned char)level);
+            file->WriteStringHash(formatHash);
+            file->WriteVLE(arguments.Size());
+            for (unsigned i = 0; i < arguments.Size(); ++i)
+                file->WriteVariant(arguments[i]);
+            // Errors may precede a crash, so do not leave them buffered
+            if (level == LOG_ERROR)
+                file->Flush();
+            return;
+        }
+    }
+    
+    Write(level, FormatStructured(format, arguments));
+}
+
+String Log::FormatStructured(const String& format, const VariantVector& arguments)
+{
+    String ret;
+    ret.Reserve(format.Length());
+    
+    unsigned pos = 0;
+    while (pos < format.Length())
+    {
+        // Replace {n} with the argument, copy anything else as is
+        if (format[pos] == '{')
+        {
+            unsigned end = format.Find('}', pos + 1);
+            if (end != String::NPOS && end > pos + 1)
+            {
+                bool isIndex = true;
+                for (unsigned i = pos + 1; i < end; ++i)
+                {
+                    if (!IsDigit((unsigned)format[i]))
+                    {
+                        isIndex = false;
+                        break;
+                    }
+                }
+                
+                if (isIndex)
+                {
+                    unsigned index = ToUInt(format.Substring(pos + 1, end - pos - 1));
+                    if (index < arguments.Size())
+                        ret += arguments[index].ToString();
+                    pos = end + 1;
+                    continue;
+                }
+            }
+        }
+        
+        ret += format[pos++];
+    }
+    
+    return ret;
+}
+
+void Log::Output(const String& message, bool error, bool print, bool newLine)
+{
+    if (writer_)
+    {
+        writer_->Queue(message, error, print, newLine);
+        // Write errors out before returning, as they may precede a crash
+        if (error)
+            writer_->Flush();
+        return;
+    }
+    
+    WriteOutput(logFile_, message, error, print, newLine);
+    if (logFile_)
+        logFile_->Flush();
+}
+
 void Log::HandleEndFrame(StringHash eventType, VariantMap& eventData)
 {
     // If the MainThreadID is not valid, processing this loop can potentially be endless
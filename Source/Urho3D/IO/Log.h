@@ -24,8 +24,10 @@
 
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
+#include "../Container/HashSet.h"
 #include "../Core/Object.h"
 #include "../Core/StringUtils.h"
+#include "../Core/Timer.h"
 
 namespace Urho3D
 {
@@ -43,7 +45,13 @@ static const int LOG_ERROR = 3;
 /// Disable all log messages.
 static const int LOG_NONE = 4;
 
+/// Binary log record defining a format string.
+static const unsigned char BINARYLOG_FORMAT = 0;
+/// Binary log record of a structured message.
+static const unsigned char BINARYLOG_MESSAGE = 1;
+
 class File;
+class LogWriter;
 
 /// Stored log message from another thread.
 struct StoredLogMessage
@@ -84,12 +92,18 @@ public:
     void Open(const String& fileName);
     /// Close the log file.
     void Close();
+    /// Open the binary log file for structured messages.
+    void OpenBinary(const String& fileName);
+    /// Close the binary log file.
+    void CloseBinary();
     /// Set logging level.
     void SetLevel(int level);
     /// Set whether to timestamp log messages.
     void SetTimeStamp(bool enable);
     /// Set quiet mode ie. only print error entries to standard error stream (which is normally redirected to console also). Output to log file is not affected by this mode.
     void SetQuiet(bool quiet);
+    /// Set whether to write to the log file and standard output on a background thread. Error messages are still written out before returning.
+    void SetAsync(bool enable);
 
     /// Return logging level.
     int GetLevel() const { return level_; }
@@ -99,22 +113,46 @@ public:
     String GetLastMessage() const { return lastMessage_; }
     /// Return whether log is in quiet mode (only errors printed to standard error stream).
     bool IsQuiet() const { return quiet_; }
+    /// Return whether writing to the log file and standard output on a background thread.
+    bool IsAsync() const { return writer_ != 0; }
+    /// Return whether the binary log file is open.
+    bool IsBinaryOpen() const { return binaryFile_ != 0; }
 
     /// Write to the log. If logging level is higher than the level of the message, the message is ignored.
     static void Write(int level, const String& message);
     /// Write raw output to the log.
     static void WriteRaw(const String& message, bool error = false);
+    /// Write a structured message, whose format string has {0}, {1} etc. placeholders for the arguments. The binary log stores each format string once and the arguments as typed values without formatting. If the binary log is not open, writes the formatted message to the text log instead.
+    static void WriteStructured(int level, const String& format, const VariantVector& arguments);
+    /// Return a structured message formatted as text.
+    static String FormatStructured(const String& format, const VariantVector& arguments);
 
 private:
+    friend class LogWriter;
+    
+    /// Output a formatted message to the standard output and log file, or queue it to the background writer.
+    void Output(const String& message, bool error, bool print, bool newLine);
     /// Handle end of frame. Process the threaded log messages.
     void HandleEndFrame(StringHash eventType, VariantMap& eventData);
     
     /// Mutex for threaded operation.
     Mutex logMutex_;
+    /// Mutex for writing to the standard output and log file.
+    Mutex outputMutex_;
+    /// Background writer thread, null if writing synchronously.
+    LogWriter* writer_;
     /// Log messages from other threads.
     List<StoredLogMessage> threadMessages_;
     /// Log file.
     SharedPtr<File> logFile_;
+    /// Mutex for writing to the binary log.
+    Mutex binaryMutex_;
+    /// Binary log file.
+    SharedPtr<File> binaryFile_;
+    /// Format strings already stored in the binary log.
+    HashSet<StringHash> binaryFormats_;
+    /// Time since opening the binary log.
+    Timer binaryTimer_;
     /// Last log message.
     String lastMessage_;
     /// Logging level.
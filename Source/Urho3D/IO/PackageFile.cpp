@@ -20,18 +20,113 @@
 // THE SOFTWARE.
 //
 
+#include "../Container/Sort.h"
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+/// Maximum file name length looked up without allocating a lowercased copy.
+static const unsigned LOOKUP_BUFFER_LENGTH = 256;
+
+PackageFileMapping::PackageFileMapping(unsigned char* data, unsigned size) :
+    data_(data),
+    size_(size),
+    refs_(1)
+{
+}
+
+PackageFileMapping::~PackageFileMapping()
+{
+    #ifdef WIN32
+    UnmapViewOfFile(data_);
+    #else
+    munmap(data_, size_);
+    #endif
+}
+
+PackageFileMapping* PackageFileMapping::Create(const String& fileName)
+{
+    unsigned char* data = 0;
+    unsigned size = 0;
+    
+    #ifdef WIN32
+    HANDLE file = CreateFileW(GetWideNativePath(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+    
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && fileSize.QuadPart <= M_MAX_UNSIGNED)
+    {
+        // The view stays valid after the mapping and file handles are closed
+        HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping)
+        {
+            data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = (unsigned)fileSize.QuadPart;
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    #else
+    int fd = open(GetNativePath(fileName).CString(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+    
+    // The mapping stays valid after the descriptor is closed
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0 && (unsigned long long)st.st_size <= M_MAX_UNSIGNED)
+    {
+        void* ptr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED)
+        {
+            data = (unsigned char*)ptr;
+            size = (unsigned)st.st_size;
+        }
+    }
+    close(fd);
+    #endif
+    
+    return data ? new PackageFileMapping(data, size) : 0;
+}
+
+void PackageFileMapping::AddRef()
+{
+    MutexLock lock(refMutex_);
+    ++refs_;
+}
+
+void PackageFileMapping::ReleaseRef()
+{
+    refMutex_.Acquire();
+    bool last = --refs_ == 0;
+    refMutex_.Release();
+    
+    // The releaser of the last reference is the only one with access, so it is safe to delete outside the lock
+    if (last)
+        delete this;
+}
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    mapping_(0),
+    compressed_(false),
+    blockIndex_(false)
 {
 }
 
@@ -39,13 +134,18 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    mapping_(0),
+    compressed_(false),
+    blockIndex_(false)
 {
     Open(fileName, startOffset);
 }
 
 PackageFile::~PackageFile()
 {
+    // Files opened from the package keep their own references to the mapping
+    if (mapping_)
+        mapping_->ReleaseRef();
 }
 
 bool PackageFile::Open(const String& fileName, unsigned startOffset)
@@ -62,10 +162,16 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     if (!file->IsOpen())
         return false;
     
+    if (mapping_)
+    {
+        mapping_->ReleaseRef();
+        mapping_ = 0;
+    }
+    
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "ULZS")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -82,7 +188,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
         
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "ULZS")
         {
             LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -92,7 +198,8 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id == "ULZ4" || id == "ULZS";
+    blockIndex_ = id == "ULZS";
     
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
@@ -110,21 +217,78 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             entries_[entryName.ToLower()] = newEntry;
     }
     
+    // Map uncompressed packages for reading the files without file system calls. Compressed files are decompressed
+    // block by block through a file handle as before
+    if (!compressed_)
+    {
+        mapping_ = PackageFileMapping::Create(fileName);
+        if (mapping_ && mapping_->GetSize() != totalSize_)
+        {
+            mapping_->ReleaseRef();
+            mapping_ = 0;
+        }
+    }
+    
     return true;
 }
 
 bool PackageFile::Exists(const String& fileName) const
 {
-    return entries_.Find(fileName.ToLower()) != entries_.End();
+    return GetEntry(fileName) != 0;
 }
 
 const PackageEntry* PackageFile::GetEntry(const String& fileName) const
 {
-    HashMap<String, PackageEntry>::ConstIterator i = entries_.Find(fileName.ToLower());
+    HashMap<String, PackageEntry>::ConstIterator i;
+    unsigned length = fileName.Length();
+    if (length <= LOOKUP_BUFFER_LENGTH)
+    {
+        // Lowercase into a stack buffer and look up through a view, so that the lookup does not allocate a String
+        char buffer[LOOKUP_BUFFER_LENGTH];
+        const char* name = fileName.CString();
+        for (unsigned j = 0; j < length; ++j)
+            buffer[j] = (char)tolower(name[j]);
+        i = entries_.FindAs(StringView(buffer, length));
+    }
+    else
+        i = entries_.Find(fileName.ToLower());
+    
     if (i != entries_.End())
         return &i->second_;
     else
         return 0;
 }
 
+unsigned PackageFile::CalculateChecksum() const
+{
+    // The checksum runs over the uncompressed data of all files in the order they are stored
+    PODVector<Pair<unsigned, const String*> > order;
+    for (HashMap<String, PackageEntry>::ConstIterator i = entries_.Begin(); i != entries_.End(); ++i)
+        order.Push(MakePair(i->second_.offset_, &i->first_));
+    Sort(order.Begin(), order.End());
+    
+    unsigned checksum = 0;
+    unsigned char buffer[4096];
+    
+    for (unsigned i = 0; i < order.Size(); ++i)
+    {
+        File file(context_, const_cast<PackageFile*>(this), *order[i].second_);
+        if (!file.IsOpen())
+            return 0;
+        
+        unsigned remaining = file.GetSize();
+        while (remaining)
+        {
+            unsigned count = file.Read(buffer, Min((int)remaining, (int)sizeof buffer));
+            if (!count)
+                return 0;
+            for (unsigned j = 0; j < count; ++j)
+                checksum = SDBMHash(checksum, buffer[j]);
+            remaining -= count;
+        }
+    }
+    
+    return checksum;
+}
+
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
 namespace Urho3D
@@ -38,7 +39,45 @@ struct PackageEntry
     unsigned checksum_;
 };
 
+/// Read-only memory mapping of a whole package file. Shared by the package and the files opened from it, and reference counted under a mutex so that the files can be closed in any thread.
+class URHO3D_API PackageFileMapping
+{
+public:
+    /// Map a file. Return null if the file can not be mapped.
+    static PackageFileMapping* Create(const String& fileName);
+    
+    /// Add a reference.
+    void AddRef();
+    /// Release a reference. Unmap and destroy when the last reference is released.
+    void ReleaseRef();
+    
+    /// Return the mapped file contents.
+    const unsigned char* GetData() const { return data_; }
+    /// Return the mapped size.
+    unsigned GetSize() const { return size_; }
+    
+private:
+    /// Construct with mapped memory.
+    PackageFileMapping(unsigned char* data, unsigned size);
+    /// Destruct. Unmap the memory.
+    ~PackageFileMapping();
+    /// Prevent copy construction.
+    PackageFileMapping(const PackageFileMapping& rhs);
+    /// Prevent assignment.
+    PackageFileMapping& operator = (const PackageFileMapping& rhs);
+    
+    /// Reference count mutex.
+    Mutex refMutex_;
+    /// Mapped memory.
+    unsigned char* data_;
+    /// Mapped size.
+    unsigned size_;
+    /// Reference count.
+    unsigned refs_;
+};
+
 /// Stores files of a directory tree sequentially for convenient access.
+/// Uncompressed packages are memory mapped when possible, so that files within them are read without file system calls.
 class URHO3D_API PackageFile : public Object
 {
     OBJECT(PackageFile);
@@ -71,8 +110,14 @@ public:
     unsigned GetChecksum() const { return checksum_; }
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
+    /// Return whether compressed files begin with a block offset table, allowing random access seeks.
+    bool HasBlockIndex() const { return blockIndex_; }
     /// Return list of entry names
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
+    /// Return the memory mapping of the package file, or null if not mapped.
+    PackageFileMapping* GetMapping() const { return mapping_; }
+    /// Calculate the checksum of the actual file contents for comparing against GetChecksum(). Reads all files, so may be slow. Safe to call from a worker thread.
+    unsigned CalculateChecksum() const;
     
 private:
     /// File entries.
@@ -85,8 +130,12 @@ private:
     unsigned totalSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Memory mapping of the package file.
+    PackageFileMapping* mapping_;
     /// Compressed flag.
     bool compressed_;
+    /// Compressed block offset table flag.
+    bool blockIndex_;
 };
 
 }
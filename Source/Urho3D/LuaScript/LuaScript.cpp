@@ -21,6 +21,7 @@
 //
 
 #include "../Core/CoreEvents.h"
+#include "../Core/MemoryTracker.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/File.h"
 #include "../IO/Log.h"
@@ -220,6 +221,7 @@ void LuaScript::RemoveEventHandlersExcept(const Vector<String>& exceptionNames)
 bool LuaScript::ExecuteFile(const String& fileName)
 {
     PROFILE(ExecuteFile);
+    MEMORY_TAG(MEMTAG_SCRIPT);
 
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     LuaFile* luaFile = cache->GetResource<LuaFile>(fileName);
@@ -245,6 +247,8 @@ bool LuaScript::ExecuteString(const String& string)
 
 bool LuaScript::ExecuteFunction(const String& functionName)
 {
+    MEMORY_TAG(MEMTAG_SCRIPT);
+
     LuaFunction* function = GetFunction(functionName);
     return function && function->BeginCall() && function->EndCall();
 }
@@ -385,10 +385,7 @@ template<typename T> int tolua_pushurho3dpodvectorusertype(lua_State* L, const P
     lua_newtable(L);
     for (unsigned i = 0; i < vector.Size(); ++i)
     {
-        void* tolua_obj = Mtolua_new((T)(vector[i]));
-        tolua_pushusertype(L, tolua_obj, typeName);
-        tolua_register_gc(L,lua_gettop(L));
-
+        ToluaPushValueType<T>(L, vector[i], typeName);
         lua_rawseti(L, -2, i + 1);
     }
 
@@ -445,3 +442,36 @@ void ToluaPushObject(lua_State*L, void* data, const char* type)
 {
     tolua_pushusertype(L, data, data ? static_cast<Object*>(data)->GetTypeName().CString() : type);
 }
+
+void* ToluaNewValueType(lua_State* L, unsigned size, const char* type)
+{
+    // The userdata holds the tolua++ object pointer followed by the value itself, so Lua owns the memory and frees it
+    // on collection. The value types are trivially destructible, so the class __gc finalizer needs no registration
+    void** box = (void**)lua_newuserdata(L, sizeof(void*) + size);
+    void* value = box + 1;
+    *box = value;
+
+    luaL_getmetatable(L, type);
+    // Register in the ubox table like tolua_pushusertype, so that references to the value (e.g. returned by the
+    // assignment operators) map back to this userdata instead of creating a non-owning alias
+    lua_pushstring(L, "tolua_ubox");
+    lua_rawget(L, -2);
+    if (lua_isnil(L, -1))
+    {
+        lua_pop(L, 1);
+        lua_pushstring(L, "tolua_ubox");
+        lua_rawget(L, LUA_REGISTRYINDEX);
+    }
+    lua_pushlightuserdata(L, value);
+    lua_pushvalue(L, -4);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+    lua_setmetatable(L, -2);
+
+#ifdef LUA_VERSION_NUM
+    lua_pushvalue(L, TOLUA_NOPEER);
+    lua_setfenv(L, -2);
+#endif
+
+    return value;
+}
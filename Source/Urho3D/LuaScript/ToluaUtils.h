@@ -33,6 +33,8 @@
 #include "../Math/Vector2.h"
 #include "../Math/Vector3.h"
 
+#include <new>
+
 struct lua_State;
 
 namespace Urho3D
@@ -168,3 +170,11 @@ template<> int ToluaPushPODVector<Pass*>(lua_State* L, void* data, const char* t
 /// Push Object to Lua.
 void ToluaPushObject(lua_State*L, void* data, const char* type);
 
+/// Push a new value type userdata which stores the value inline and return the storage for the value.
+void* ToluaNewValueType(lua_State* L, unsigned size, const char* type);
+/// Push a copy of a trivially destructible value type to Lua without a separate heap allocation or garbage collection registration.
+template<typename T> void ToluaPushValueType(lua_State* L, const T& value, const char* type)
+{
+    new(ToluaNewValueType(L, sizeof(T), type)) T(value);
+}
+
@@ -62,6 +62,14 @@ function post_output_hook(package)
 
     replace("\t", "  ")
 
+    -- Push math value types returned by value inline in their userdata instead of as a heap copy registered for garbage collection
+    result = string.gsub(result, 'void%* tolua_obj = [^\n]-Mtolua_new%(%(([%w_]+)%)%(tolua_ret%)%);%s*tolua_pushusertype%(tolua_S,tolua_obj,"([%w_]+)"%);%s*tolua_register_gc%(tolua_S,lua_gettop%(tolua_S%)%);',
+        function(newType, pushType)
+            if newType == pushType and _value_types[newType] then
+                return 'ToluaPushValueType<' .. newType .. '>(tolua_S,tolua_ret,"' .. newType .. '");'
+            end
+        end)
+
     replace([[#ifndef __cplusplus
 #include "stdlib.h"
 #endif
@@ -108,6 +116,9 @@ function post_output_hook(package)
 #endif]])
 end
 
+-- Trivially destructible math types which are pushed by value without a separate heap allocation.
+_value_types = { Color = true, IntRect = true, IntVector2 = true, Quaternion = true, Rect = true, Vector2 = true, Vector3 = true, Vector4 = true }
+
 _push_functions['Component'] = "ToluaPushObject"
 _push_functions['Resource'] = "ToluaPushObject"
 _push_functions['UIElement'] = "ToluaPushObject"
@@ -185,6 +185,95 @@ Rect Frustum::Projected(const Matrix4& projection) const
     return rect;
 }
 
+void Frustum::IsInsideFastBatch(const float* blocks, unsigned numBlocks, unsigned char* masks) const
+{
+#if defined(URHO3D_SIMD_SSE)
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        __m128 centerX = _mm_loadu_ps(blocks);
+        __m128 centerY = _mm_loadu_ps(blocks + 4);
+        __m128 centerZ = _mm_loadu_ps(blocks + 8);
+        __m128 edgeX = _mm_loadu_ps(blocks + 12);
+        __m128 edgeY = _mm_loadu_ps(blocks + 16);
+        __m128 edgeZ = _mm_loadu_ps(blocks + 20);
+        __m128 outside = _mm_setzero_ps();
+        
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            const Plane& plane = planes_[j];
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.normal_.x_), centerX),
+                _mm_mul_ps(_mm_set1_ps(plane.normal_.y_), centerY)), _mm_mul_ps(_mm_set1_ps(plane.normal_.z_), centerZ)),
+                _mm_set1_ps(plane.d_));
+            __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.absNormal_.x_), edgeX),
+                _mm_mul_ps(_mm_set1_ps(plane.absNormal_.y_), edgeY)), _mm_mul_ps(_mm_set1_ps(plane.absNormal_.z_), edgeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist)));
+        }
+        
+        masks[i] = (unsigned char)(~_mm_movemask_ps(outside) & 0xf);
+        blocks += FRUSTUM_BOX_BLOCK_SIZE;
+    }
+#elif defined(URHO3D_SIMD_NEON)
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        float32x4_t centerX = vld1q_f32(blocks);
+        float32x4_t centerY = vld1q_f32(blocks + 4);
+        float32x4_t centerZ = vld1q_f32(blocks + 8);
+        float32x4_t edgeX = vld1q_f32(blocks + 12);
+        float32x4_t edgeY = vld1q_f32(blocks + 16);
+        float32x4_t edgeZ = vld1q_f32(blocks + 20);
+        uint32x4_t outside = vdupq_n_u32(0);
+        
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            const Plane& plane = planes_[j];
+            float32x4_t dist = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.d_), centerX, plane.normal_.x_), centerY,
+                plane.normal_.y_), centerZ, plane.normal_.z_);
+            float32x4_t absDist = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(edgeX, plane.absNormal_.x_), edgeY, plane.absNormal_.y_),
+                edgeZ, plane.absNormal_.z_);
+            outside = vorrq_u32(outside, vcltq_f32(dist, vnegq_f32(absDist)));
+        }
+        
+        unsigned mask = 0;
+        if (!vgetq_lane_u32(outside, 0))
+            mask |= 1;
+        if (!vgetq_lane_u32(outside, 1))
+            mask |= 2;
+        if (!vgetq_lane_u32(outside, 2))
+            mask |= 4;
+        if (!vgetq_lane_u32(outside, 3))
+            mask |= 8;
+        masks[i] = (unsigned char)mask;
+        blocks += FRUSTUM_BOX_BLOCK_SIZE;
+    }
+#else
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        unsigned mask = 0xf;
+        
+        for (unsigned j = 0; j < 4; ++j)
+        {
+            for (unsigned k = 0; k < NUM_FRUSTUM_PLANES; ++k)
+            {
+                const Plane& plane = planes_[k];
+                float dist = plane.normal_.x_ * blocks[j] + plane.normal_.y_ * blocks[4 + j] + plane.normal_.z_ * blocks[8 + j] +
+                    plane.d_;
+                float absDist = plane.absNormal_.x_ * blocks[12 + j] + plane.absNormal_.y_ * blocks[16 + j] +
+                    plane.absNormal_.z_ * blocks[20 + j];
+                
+                if (dist < -absDist)
+                {
+                    mask &= ~(1 << j);
+                    break;
+                }
+            }
+        }
+        
+        masks[i] = (unsigned char)mask;
+        blocks += FRUSTUM_BOX_BLOCK_SIZE;
+    }
+#endif
+}
+
 void Frustum::UpdatePlanes()
 {
     planes_[PLANE_NEAR].Define(vertices_[2], vertices_[1], vertices_[0]);
@@ -44,6 +44,8 @@ enum FrustumPlane
 
 static const unsigned NUM_FRUSTUM_PLANES = 6;
 static const unsigned NUM_FRUSTUM_VERTICES = 8;
+/// Number of floats in a structure-of-arrays block of four bounding boxes: center X, Y, Z and half size X, Y, Z for each box.
+static const unsigned FRUSTUM_BOX_BLOCK_SIZE = 24;
 
 /// Convex constructed of 6 planes.
 class URHO3D_API Frustum
@@ -151,6 +153,9 @@ public:
         return INSIDE;
     }
     
+    /// Test blocks of four bounding boxes in structure-of-arrays form for being (partially) inside. Write a bitmask per block with a bit set for each box that is not outside.
+    void IsInsideFastBatch(const float* blocks, unsigned numBlocks, unsigned char* masks) const;
+    
     /// Return distance of a point to the frustum, or 0 if inside.
     float Distance(const Vector3& point) const
     {
@@ -27,6 +27,22 @@
 #include <cstdlib>
 #include <cmath>
 
+// SSE is enabled by the URHO3D_SSE build option, but only used when the target CPU actually supports it. NEON is used when the
+// chosen ARM ABI enables it
+#if defined(URHO3D_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define URHO3D_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define URHO3D_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// SSE2 integer operations are additionally available on all 64-bit x86 targets, and on 32-bit targets compiled for SSE2
+#if defined(URHO3D_SIMD_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define URHO3D_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -161,6 +177,48 @@ inline unsigned CountSetBits(unsigned value)
     return count;
 }
 
+/// Convert a float to a 16-bit half float, rounding to nearest. Overflow becomes infinity and denormals are flushed to zero.
+inline unsigned short FloatToHalf(float value)
+{
+    union { float f_; unsigned u_; } bits;
+    bits.f_ = value;
+    unsigned sign = (bits.u_ >> 16) & 0x8000;
+    int exponent = (int)((bits.u_ >> 23) & 0xff) - 127 + 15;
+    unsigned mantissa = bits.u_ & 0x7fffff;
+
+    if (exponent >= 31)
+        return (unsigned short)(sign | ((bits.u_ & 0x7f800000) == 0x7f800000 && mantissa ? 0x7e00 : 0x7c00));
+    if (exponent <= 0)
+        return (unsigned short)sign;
+
+    unsigned half = sign | ((unsigned)exponent << 10) | (mantissa >> 13);
+    // A carry out of the mantissa correctly increments the exponent
+    if (mantissa & 0x1000)
+        ++half;
+    return (unsigned short)half;
+}
+
+/// Convert a 16-bit half float to a float.
+inline float HalfToFloat(unsigned short value)
+{
+    unsigned sign = (unsigned)(value & 0x8000) << 16;
+    unsigned exponent = (value >> 10) & 0x1f;
+    unsigned mantissa = value & 0x3ff;
+    union { float f_; unsigned u_; } bits;
+
+    if (!exponent)
+    {
+        // Zero or denormal
+        float result = (float)mantissa * (1.0f / 16777216.0f);
+        return sign ? -result : result;
+    }
+    else if (exponent == 31)
+        bits.u_ = sign | 0x7f800000 | (mantissa << 13);
+    else
+        bits.u_ = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    return bits.f_;
+}
+
 /// Update a hash with the given 8-bit value using the SDBM algorithm.
 inline unsigned SDBMHash(unsigned hash, unsigned char c) { return c + (hash << 6) + (hash << 16) - hash; }
 /// Return a random float between 0.0 (inclusive) and 1.0 (exclusive.)
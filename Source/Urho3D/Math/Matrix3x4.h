@@ -215,21 +215,29 @@ public:
     /// Multiply a Vector3 which is assumed to represent position.
     Vector3 operator * (const Vector3& rhs) const
     {
+#if defined(URHO3D_SIMD_SSE)
+        return TransformSSE(_mm_set_ps(1.0f, rhs.z_, rhs.y_, rhs.x_));
+#else
         return Vector3(
             (m00_ * rhs.x_ + m01_ * rhs.y_ + m02_ * rhs.z_ + m03_),
             (m10_ * rhs.x_ + m11_ * rhs.y_ + m12_ * rhs.z_ + m13_),
             (m20_ * rhs.x_ + m21_ * rhs.y_ + m22_ * rhs.z_ + m23_)
         );
+#endif
     }
     
     /// Multiply a Vector4.
     Vector3 operator * (const Vector4& rhs) const
     {
+#if defined(URHO3D_SIMD_SSE)
+        return TransformSSE(_mm_loadu_ps(&rhs.x_));
+#else
         return Vector3(
             (m00_ * rhs.x_ + m01_ * rhs.y_ + m02_ * rhs.z_ + m03_ * rhs.w_),
             (m10_ * rhs.x_ + m11_ * rhs.y_ + m12_ * rhs.z_ + m13_ * rhs.w_),
             (m20_ * rhs.x_ + m21_ * rhs.y_ + m22_ * rhs.z_ + m23_ * rhs.w_)
         );
+#endif
     }
     
     /// Add a matrix.
@@ -292,6 +300,28 @@ public:
     /// Multiply a matrix.
     Matrix3x4 operator * (const Matrix3x4& rhs) const
     {
+#if defined(URHO3D_SIMD_SSE)
+        // Each result row is a linear combination of the right-hand rows, with the implicit fourth row (0, 0, 0, 1)
+        Matrix3x4 ret;
+        __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+        __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+        __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+        __m128 r3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+        _mm_storeu_ps(&ret.m00_, MultiplyRowSSE(_mm_loadu_ps(&m00_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m10_, MultiplyRowSSE(_mm_loadu_ps(&m10_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m20_, MultiplyRowSSE(_mm_loadu_ps(&m20_), r0, r1, r2, r3));
+        return ret;
+#elif defined(URHO3D_SIMD_NEON)
+        Matrix3x4 ret;
+        float32x4_t r0 = vld1q_f32(&rhs.m00_);
+        float32x4_t r1 = vld1q_f32(&rhs.m10_);
+        float32x4_t r2 = vld1q_f32(&rhs.m20_);
+        float32x4_t r3 = vsetq_lane_f32(1.0f, vdupq_n_f32(0.0f), 3);
+        vst1q_f32(&ret.m00_, MultiplyRowNEON(&m00_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m10_, MultiplyRowNEON(&m10_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m20_, MultiplyRowNEON(&m20_, r0, r1, r2, r3));
+        return ret;
+#else
         return Matrix3x4(
             m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_,
             m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_,
@@ -306,11 +336,35 @@ public:
             m20_ * rhs.m02_ + m21_ * rhs.m12_ + m22_ * rhs.m22_,
             m20_ * rhs.m03_ + m21_ * rhs.m13_ + m22_ * rhs.m23_ + m23_
         );
+#endif
     }
     
     /// Multiply a 4x4 matrix.
     Matrix4 operator * (const Matrix4& rhs) const
     {
+#if defined(URHO3D_SIMD_SSE)
+        Matrix4 ret;
+        __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+        __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+        __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+        __m128 r3 = _mm_loadu_ps(&rhs.m30_);
+        _mm_storeu_ps(&ret.m00_, MultiplyRowSSE(_mm_loadu_ps(&m00_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m10_, MultiplyRowSSE(_mm_loadu_ps(&m10_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m20_, MultiplyRowSSE(_mm_loadu_ps(&m20_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m30_, r3);
+        return ret;
+#elif defined(URHO3D_SIMD_NEON)
+        Matrix4 ret;
+        float32x4_t r0 = vld1q_f32(&rhs.m00_);
+        float32x4_t r1 = vld1q_f32(&rhs.m10_);
+        float32x4_t r2 = vld1q_f32(&rhs.m20_);
+        float32x4_t r3 = vld1q_f32(&rhs.m30_);
+        vst1q_f32(&ret.m00_, MultiplyRowNEON(&m00_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m10_, MultiplyRowNEON(&m10_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m20_, MultiplyRowNEON(&m20_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m30_, r3);
+        return ret;
+#else
         return Matrix4(
             m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_ + m03_ * rhs.m30_,
             m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_ + m03_ * rhs.m31_,
@@ -329,6 +383,7 @@ public:
             rhs.m32_,
             rhs.m33_
         );
+#endif
     }
     
     /// Set translation elements.
@@ -485,6 +540,17 @@ public:
     static const Matrix3x4 ZERO;
     /// Identity matrix.
     static const Matrix3x4 IDENTITY;
+    
+private:
+#ifdef URHO3D_SIMD_SSE
+    /// Transform a vector whose components are in the SSE register lanes.
+    Vector3 TransformSSE(__m128 vec) const
+    {
+        __m128 ret = DotRowsSSE(vec, _mm_loadu_ps(&m00_), _mm_loadu_ps(&m10_), _mm_loadu_ps(&m20_), _mm_setzero_ps());
+        return Vector3(_mm_cvtss_f32(ret), _mm_cvtss_f32(_mm_shuffle_ps(ret, ret, _MM_SHUFFLE(1, 1, 1, 1))),
+            _mm_cvtss_f32(_mm_movehl_ps(ret, ret)));
+    }
+#endif
 };
 
 /// Multiply a 3x4 matrix with a scalar.
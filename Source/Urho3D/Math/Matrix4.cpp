@@ -40,6 +40,29 @@ const Matrix4 Matrix4::IDENTITY;
 
 Matrix4 Matrix4::operator * (const Matrix3x4& rhs) const
 {
+#if defined(URHO3D_SIMD_SSE)
+    Matrix4 ret;
+    __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+    __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+    __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+    __m128 r3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    _mm_storeu_ps(&ret.m00_, MultiplyRowSSE(_mm_loadu_ps(&m00_), r0, r1, r2, r3));
+    _mm_storeu_ps(&ret.m10_, MultiplyRowSSE(_mm_loadu_ps(&m10_), r0, r1, r2, r3));
+    _mm_storeu_ps(&ret.m20_, MultiplyRowSSE(_mm_loadu_ps(&m20_), r0, r1, r2, r3));
+    _mm_storeu_ps(&ret.m30_, MultiplyRowSSE(_mm_loadu_ps(&m30_), r0, r1, r2, r3));
+    return ret;
+#elif defined(URHO3D_SIMD_NEON)
+    Matrix4 ret;
+    float32x4_t r0 = vld1q_f32(&rhs.m00_);
+    float32x4_t r1 = vld1q_f32(&rhs.m10_);
+    float32x4_t r2 = vld1q_f32(&rhs.m20_);
+    float32x4_t r3 = vsetq_lane_f32(1.0f, vdupq_n_f32(0.0f), 3);
+    vst1q_f32(&ret.m00_, MultiplyRowNEON(&m00_, r0, r1, r2, r3));
+    vst1q_f32(&ret.m10_, MultiplyRowNEON(&m10_, r0, r1, r2, r3));
+    vst1q_f32(&ret.m20_, MultiplyRowNEON(&m20_, r0, r1, r2, r3));
+    vst1q_f32(&ret.m30_, MultiplyRowNEON(&m30_, r0, r1, r2, r3));
+    return ret;
+#else
     return Matrix4(
         m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_,
         m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_,
@@ -58,6 +81,7 @@ Matrix4 Matrix4::operator * (const Matrix3x4& rhs) const
         m30_ * rhs.m02_ + m31_ * rhs.m12_ + m32_ * rhs.m22_,
         m30_ * rhs.m03_ + m31_ * rhs.m13_ + m32_ * rhs.m23_ + m33_
     );
+#endif
 }
 
 void Matrix4::Decompose(Vector3& translation, Quaternion& rotation, Vector3& scale) const
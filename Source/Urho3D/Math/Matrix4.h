@@ -28,6 +28,41 @@
 namespace Urho3D
 {
 
+#if defined(URHO3D_SIMD_SSE)
+/// Multiply a matrix row with a matrix given as its rows. Return the resulting row.
+inline __m128 MultiplyRowSSE(__m128 row, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+    return _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), r0),
+        _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), r1)),
+        _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), r2),
+        _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), r3))
+    );
+}
+
+/// Return the dot products of a vector with four matrix rows.
+inline __m128 DotRowsSSE(__m128 vec, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+    r0 = _mm_mul_ps(r0, vec);
+    r1 = _mm_mul_ps(r1, vec);
+    r2 = _mm_mul_ps(r2, vec);
+    r3 = _mm_mul_ps(r3, vec);
+    // Add pairwise so that lanes 0-1 hold partial sums for rows 0-1 and lanes 2-3 for rows 2-3, then add the halves
+    __m128 t0 = _mm_add_ps(_mm_unpacklo_ps(r0, r1), _mm_unpackhi_ps(r0, r1));
+    __m128 t1 = _mm_add_ps(_mm_unpacklo_ps(r2, r3), _mm_unpackhi_ps(r2, r3));
+    return _mm_add_ps(_mm_movelh_ps(t0, t1), _mm_movehl_ps(t1, t0));
+}
+#elif defined(URHO3D_SIMD_NEON)
+/// Multiply a matrix row with a matrix given as its rows. Return the resulting row.
+inline float32x4_t MultiplyRowNEON(const float* row, float32x4_t r0, float32x4_t r1, float32x4_t r2, float32x4_t r3)
+{
+    float32x4_t ret = vmulq_n_f32(r0, row[0]);
+    ret = vmlaq_n_f32(ret, r1, row[1]);
+    ret = vmlaq_n_f32(ret, r2, row[2]);
+    return vmlaq_n_f32(ret, r3, row[3]);
+}
+#endif
+
 class Matrix3x4;
 
 /// 4x4 matrix for arbitrary linear transforms including projection.
@@ -207,6 +242,13 @@ public:
     /// Multiply a Vector3 which is assumed to represent position.
     Vector3 operator * (const Vector3& rhs) const
     {
+#ifdef URHO3D_SIMD_SSE
+        __m128 ret = DotRowsSSE(_mm_set_ps(1.0f, rhs.z_, rhs.y_, rhs.x_), _mm_loadu_ps(&m00_), _mm_loadu_ps(&m10_),
+            _mm_loadu_ps(&m20_), _mm_loadu_ps(&m30_));
+        ret = _mm_div_ps(ret, _mm_shuffle_ps(ret, ret, _MM_SHUFFLE(3, 3, 3, 3)));
+        return Vector3(_mm_cvtss_f32(ret), _mm_cvtss_f32(_mm_shuffle_ps(ret, ret, _MM_SHUFFLE(1, 1, 1, 1))),
+            _mm_cvtss_f32(_mm_movehl_ps(ret, ret)));
+#else
         float invW = 1.0f / (m30_ * rhs.x_ + m31_ * rhs.y_ + m32_ * rhs.z_ + m33_);
         
         return Vector3(
@@ -214,17 +256,25 @@ public:
             (m10_ * rhs.x_ + m11_ * rhs.y_ + m12_ * rhs.z_ + m13_) * invW,
             (m20_ * rhs.x_ + m21_ * rhs.y_ + m22_ * rhs.z_ + m23_) * invW
         );
+#endif
     }
     
     /// Multiply a Vector4.
     Vector4 operator * (const Vector4& rhs) const
     {
+#ifdef URHO3D_SIMD_SSE
+        Vector4 ret;
+        _mm_storeu_ps(&ret.x_, DotRowsSSE(_mm_loadu_ps(&rhs.x_), _mm_loadu_ps(&m00_), _mm_loadu_ps(&m10_), _mm_loadu_ps(&m20_),
+            _mm_loadu_ps(&m30_)));
+        return ret;
+#else
         return Vector4(
             m00_ * rhs.x_ + m01_ * rhs.y_ + m02_ * rhs.z_ + m03_ * rhs.w_,
             m10_ * rhs.x_ + m11_ * rhs.y_ + m12_ * rhs.z_ + m13_ * rhs.w_,
             m20_ * rhs.x_ + m21_ * rhs.y_ + m22_ * rhs.z_ + m23_ * rhs.w_,
             m30_ * rhs.x_ + m31_ * rhs.y_ + m32_ * rhs.z_ + m33_ * rhs.w_
         );
+#endif
     }
     
     /// Add a matrix.
@@ -299,6 +349,29 @@ public:
     /// Multiply a matrix.
     Matrix4 operator * (const Matrix4& rhs) const
     {
+#if defined(URHO3D_SIMD_SSE)
+        Matrix4 ret;
+        __m128 r0 = _mm_loadu_ps(&rhs.m00_);
+        __m128 r1 = _mm_loadu_ps(&rhs.m10_);
+        __m128 r2 = _mm_loadu_ps(&rhs.m20_);
+        __m128 r3 = _mm_loadu_ps(&rhs.m30_);
+        _mm_storeu_ps(&ret.m00_, MultiplyRowSSE(_mm_loadu_ps(&m00_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m10_, MultiplyRowSSE(_mm_loadu_ps(&m10_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m20_, MultiplyRowSSE(_mm_loadu_ps(&m20_), r0, r1, r2, r3));
+        _mm_storeu_ps(&ret.m30_, MultiplyRowSSE(_mm_loadu_ps(&m30_), r0, r1, r2, r3));
+        return ret;
+#elif defined(URHO3D_SIMD_NEON)
+        Matrix4 ret;
+        float32x4_t r0 = vld1q_f32(&rhs.m00_);
+        float32x4_t r1 = vld1q_f32(&rhs.m10_);
+        float32x4_t r2 = vld1q_f32(&rhs.m20_);
+        float32x4_t r3 = vld1q_f32(&rhs.m30_);
+        vst1q_f32(&ret.m00_, MultiplyRowNEON(&m00_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m10_, MultiplyRowNEON(&m10_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m20_, MultiplyRowNEON(&m20_, r0, r1, r2, r3));
+        vst1q_f32(&ret.m30_, MultiplyRowNEON(&m30_, r0, r1, r2, r3));
+        return ret;
+#else
         return Matrix4(
             m00_ * rhs.m00_ + m01_ * rhs.m10_ + m02_ * rhs.m20_ + m03_ * rhs.m30_,
             m00_ * rhs.m01_ + m01_ * rhs.m11_ + m02_ * rhs.m21_ + m03_ * rhs.m31_,
@@ -317,6 +390,7 @@ public:
             m30_ * rhs.m02_ + m31_ * rhs.m12_ + m32_ * rhs.m22_ + m33_ * rhs.m32_,
             m30_ * rhs.m03_ + m31_ * rhs.m13_ + m32_ * rhs.m23_ + m33_ * rhs.m33_
         );
+#endif
     }
     
     /// Multiply with a 3x4 matrix.
@@ -414,6 +488,19 @@ public:
     /// Return transpose
     Matrix4 Transpose() const
     {
+#ifdef URHO3D_SIMD_SSE
+        Matrix4 ret;
+        __m128 r0 = _mm_loadu_ps(&m00_);
+        __m128 r1 = _mm_loadu_ps(&m10_);
+        __m128 r2 = _mm_loadu_ps(&m20_);
+        __m128 r3 = _mm_loadu_ps(&m30_);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&ret.m00_, r0);
+        _mm_storeu_ps(&ret.m10_, r1);
+        _mm_storeu_ps(&ret.m20_, r2);
+        _mm_storeu_ps(&ret.m30_, r3);
+        return ret;
+#else
         return Matrix4(
             m00_,
             m10_,
@@ -432,6 +519,7 @@ public:
             m23_,
             m33_
         );
+#endif
     }
     
     /// Test for equality with another matrix with epsilon.
@@ -481,6 +569,17 @@ public:
     {
         for (unsigned i = 0; i < count; ++i)
         {
+#ifdef URHO3D_SIMD_SSE
+            __m128 r0 = _mm_loadu_ps(src);
+            __m128 r1 = _mm_loadu_ps(src + 4);
+            __m128 r2 = _mm_loadu_ps(src + 8);
+            __m128 r3 = _mm_loadu_ps(src + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(dest, r0);
+            _mm_storeu_ps(dest + 4, r1);
+            _mm_storeu_ps(dest + 8, r2);
+            _mm_storeu_ps(dest + 12, r3);
+#else
             dest[0] = src[0];
             dest[1] = src[4];
             dest[2] = src[8];
@@ -497,6 +596,7 @@ public:
             dest[13] = src[7];
             dest[14] = src[11];
             dest[15] = src[15];
+#endif
             
             dest += 16;
             src += 16;
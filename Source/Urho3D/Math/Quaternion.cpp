@@ -251,7 +251,14 @@ Quaternion Quaternion::Slerp(Quaternion rhs, float t) const
         t2 = t;
     }
     
+#ifdef URHO3D_SIMD_SSE
+    Quaternion ret;
+    _mm_storeu_ps(&ret.w_, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&w_), _mm_set1_ps(t1)), _mm_mul_ps(_mm_loadu_ps(&rhs.w_),
+        _mm_set1_ps(t2))));
+    return ret;
+#else
     return *this * t1 + rhs * t2;
+#endif
 }
 
 Quaternion Quaternion::Nlerp(Quaternion rhs, float t, bool shortestPath) const
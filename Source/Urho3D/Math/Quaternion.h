@@ -149,12 +149,29 @@ public:
     /// Multiply a quaternion.
     Quaternion operator * (const Quaternion& rhs) const
     {
+#ifdef URHO3D_SIMD_SSE
+        // Register lanes hold (w, x, y, z). Each left-hand component multiplies a permutation of the right-hand quaternion,
+        // with the sign flips applied by XOR
+        __m128 q1 = _mm_loadu_ps(&w_);
+        __m128 q2 = _mm_loadu_ps(&rhs.w_);
+        __m128 ret = _mm_mul_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(0, 0, 0, 0)), q2);
+        ret = _mm_add_ps(ret, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(1, 1, 1, 1)),
+            _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(2, 3, 0, 1))), _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f)));
+        ret = _mm_add_ps(ret, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(2, 2, 2, 2)),
+            _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(1, 0, 3, 2))), _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f)));
+        ret = _mm_add_ps(ret, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(q1, q1, _MM_SHUFFLE(3, 3, 3, 3)),
+            _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0, 1, 2, 3))), _mm_set_ps(0.0f, 0.0f, -0.0f, -0.0f)));
+        Quaternion result;
+        _mm_storeu_ps(&result.w_, ret);
+        return result;
+#else
         return Quaternion(
             w_ * rhs.w_ - x_ * rhs.x_ - y_ * rhs.y_ - z_ * rhs.z_,
             w_ * rhs.x_ + x_ * rhs.w_ + y_ * rhs.z_ - z_ * rhs.y_,
             w_ * rhs.y_ + y_ * rhs.w_ + z_ * rhs.x_ - x_ * rhs.z_,
             w_ * rhs.z_ + z_ * rhs.w_ + x_ * rhs.y_ - y_ * rhs.x_
         );
+#endif
     }
     
     /// Multiply a Vector3.
@@ -51,9 +51,9 @@ unsigned StringHash::Calculate(const char* str)
     
     while (*str)
     {
-        // Perform the actual hashing as case-insensitive
+        // Perform the actual hashing as case-insensitive. Lowercase only ASCII letters to match CalculateLiteral()
         char c = *str;
-        hash = SDBMHash(hash, tolower(c));
+        hash = SDBMHash(hash, c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
         ++str;
     }
     
@@ -24,9 +24,36 @@
 
 #include "../Container/Str.h"
 
+#if defined(_MSC_VER)
+#define URHO3D_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define URHO3D_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define URHO3D_FORCE_INLINE inline
+#endif
+
 namespace Urho3D
 {
 
+/// Compile-time unrolled case-insensitive hash of a fixed number of characters. The result is the same as StringHash::Calculate().
+template <unsigned N> struct StringHashLiteral
+{
+    /// Hash the characters into an initial hash value.
+    static URHO3D_FORCE_INLINE unsigned Calculate(const char* str, unsigned hash)
+    {
+        // Lowercase only ASCII letters, as tolower() does in the C locale, and combine with the same formula as SDBMHash()
+        unsigned c = (unsigned char)(*str >= 'A' && *str <= 'Z' ? *str + ('a' - 'A') : *str);
+        return StringHashLiteral<N - 1>::Calculate(str + 1, c + (hash << 6) + (hash << 16) - hash);
+    }
+};
+
+/// End of compile-time unrolled hash.
+template <> struct StringHashLiteral<0>
+{
+    /// Return the hash value.
+    static URHO3D_FORCE_INLINE unsigned Calculate(const char*, unsigned hash) { return hash; }
+};
+
 /// 32-bit hash value for a string.
 class URHO3D_API StringHash
 {
@@ -95,6 +122,8 @@ public:
     
     /// Calculate hash value case-insensitively from a C string.
     static unsigned Calculate(const char* str);
+    /// Calculate hash value case-insensitively from a string literal. The hashing is unrolled at compile time so that an optimizing compiler reduces it to a constant. Must not be used for character buffers, as their whole length would be hashed.
+    template <unsigned N> static URHO3D_FORCE_INLINE unsigned CalculateLiteral(const char (&str)[N]) { return StringHashLiteral<N - 1>::Calculate(str, 0); }
     
     /// Zero hash.
     static const StringHash ZERO;
@@ -27,10 +27,12 @@
 #include "../Navigation/DetourCrowdManager.h"
 #include "../Navigation/DynamicNavigationMesh.h"
 #include "../IO/Log.h"
+#include "../Core/MemoryTracker.h"
 #include "../Navigation/NavigationEvents.h"
 #include "../Navigation/NavigationMesh.h"
 #include "../Scene/Node.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Container/Vector.h"
@@ -50,15 +52,82 @@ namespace Urho3D
 extern const char* NAVIGATION_CATEGORY;
 
 static const unsigned DEFAULT_MAX_AGENTS = 512;
+/// Number of agents processed by one work item in a parallel crowd update pass.
+static const unsigned AGENT_TASK_GRAIN = 16;
+
+/// Runs a range of a DetourCrowd update pass. Used with WorkQueue::ParallelFor().
+struct CrowdTaskProcessor
+{
+    /// Construct.
+    CrowdTaskProcessor(dtCrowdTaskFunction task, void* data) :
+        task_(task),
+        data_(data)
+    {
+    }
+
+    /// Update a range of agents.
+    void operator () (int* start, int* end, unsigned threadIndex)
+    {
+        task_(data_, *start, *(end - 1) + 1, (int)threadIndex);
+    }
+
+    /// Task function.
+    dtCrowdTaskFunction task_;
+    /// Task data.
+    void* data_;
+};
+
+/// Runs the DetourCrowd update passes on the work queue.
+class CrowdTaskExecutor : public dtCrowdTaskExecutor
+{
+public:
+    /// Construct.
+    CrowdTaskExecutor(DetourCrowdManager* manager) :
+        manager_(manager)
+    {
+    }
+
+    /// Return the number of threads for updating the crowd, including the main thread.
+    virtual int getNumThreads()
+    {
+        WorkQueue* queue = manager_->GetSubsystem<WorkQueue>();
+        return queue ? (int)queue->GetNumThreads() + 1 : 1;
+    }
+
+    /// Run a crowd update pass in parallel using the work queue.
+    virtual void run(dtCrowdTaskFunction task, void* data, int count)
+    {
+        if (count <= 0)
+            return;
+
+        if ((int)taskIndices_.Size() < count)
+        {
+            unsigned oldSize = taskIndices_.Size();
+            taskIndices_.Resize(count);
+            for (unsigned i = oldSize; i < taskIndices_.Size(); ++i)
+                taskIndices_[i] = i;
+        }
+
+        CrowdTaskProcessor processor(task, data);
+        manager_->GetSubsystem<WorkQueue>()->ParallelFor(&taskIndices_[0], &taskIndices_[0] + count, AGENT_TASK_GRAIN, processor);
+    }
+
+private:
+    /// Crowd manager.
+    DetourCrowdManager* manager_;
+    /// Agent indices for the work queue.
+    PODVector<int> taskIndices_;
+};
 
 DetourCrowdManager::DetourCrowdManager(Context* context) :
     Component(context),
-    maxAgents_(DEFAULT_MAX_AGENTS),
     crowd_(0),
     navigationMesh_(0),
-    agentDebug_(0)
+    maxAgents_(DEFAULT_MAX_AGENTS),
+    parallelUpdate_(false),
+    agentDebug_(0),
+    taskExecutor_(0)
 {
-    agentBuffer_.Resize(maxAgents_);
 }
 
 DetourCrowdManager::~DetourCrowdManager()
@@ -67,6 +136,8 @@ DetourCrowdManager::~DetourCrowdManager()
     crowd_ = 0;
     delete agentDebug_;
     agentDebug_ = 0;
+    delete taskExecutor_;
+    taskExecutor_ = 0;
 }
 
 void DetourCrowdManager::RegisterObject(Context* context)
@@ -74,6 +145,7 @@ void DetourCrowdManager::RegisterObject(Context* context)
     context->RegisterFactory<DetourCrowdManager>(NAVIGATION_CATEGORY);
 
     ACCESSOR_ATTRIBUTE("Max Agents", GetMaxAgents, SetMaxAgents, unsigned, DEFAULT_MAX_AGENTS, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Parallel Update", GetParallelUpdate, SetParallelUpdate, bool, false, AM_DEFAULT);
 }
 
 void DetourCrowdManager::SetNavigationMesh(NavigationMesh* navMesh)
@@ -94,10 +166,12 @@ void DetourCrowdManager::SetAreaCost(unsigned filterID, unsigned areaID, float w
 
 void DetourCrowdManager::SetMaxAgents(unsigned agentCt)
 {
+    if (agentCt == maxAgents_)
+        return;
+
     maxAgents_ = agentCt;
-    if (crowd_ && crowd_->getAgentCount() > 0)
-        LOGERROR("DetourCrowdManager contains active agents, their state will be lost");
-    agentBuffer_.Resize(maxAgents_);
+    if (crowd_ && !agents_.Empty())
+        LOGWARNING("DetourCrowdManager contains active agents, their state will be lost");
     CreateCrowd();
     if (crowd_)
     {
@@ -117,6 +191,19 @@ void DetourCrowdManager::SetMaxAgents(unsigned agentCt)
     MarkNetworkUpdate();
 }
 
+void DetourCrowdManager::SetParallelUpdate(bool enable)
+{
+    if (enable == parallelUpdate_)
+        return;
+
+    parallelUpdate_ = enable;
+    if (enable && !taskExecutor_)
+        taskExecutor_ = new CrowdTaskExecutor(this);
+    if (crowd_ && !crowd_->setTaskExecutor(enable ? taskExecutor_ : 0))
+        LOGERROR("Could not initialize parallel DetourCrowd update");
+    MarkNetworkUpdate();
+}
+
 void DetourCrowdManager::SetCrowdTarget(const Vector3& position, int startId, int endId)
 {
     startId = Max(0, startId);
@@ -170,7 +257,7 @@ float DetourCrowdManager::GetAreaCost(unsigned filterID, unsigned areaID) const
 
 unsigned DetourCrowdManager::GetAgentCount() const
 {
-    return crowd_ ? crowd_->getAgentCount() : 0;
+    return agents_.Size();
 }
 
 void DetourCrowdManager::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -244,6 +331,9 @@ bool DetourCrowdManager::CreateCrowd()
         LOGERROR("Could not initialize DetourCrowd");
         return false;
     }
+    agentBuffer_.Resize(maxAgents_);
+    if (parallelUpdate_ && !crowd_->setTaskExecutor(taskExecutor_))
+        LOGERROR("Could not initialize parallel DetourCrowd update");
 
     // Setup local avoidance params to different qualities.
     dtObstacleAvoidanceParams params;
@@ -454,6 +544,8 @@ Vector3 DetourCrowdManager::GetClosestWalkablePosition(Vector3 pos) const
 
 void DetourCrowdManager::Update(float delta)
 {
+    MEMORY_TAG(MEMTAG_NAVIGATION);
+    
     if (!crowd_)
         return;
 
@@ -32,6 +32,7 @@ namespace Urho3D
 {
 
 class CrowdAgent;
+class CrowdTaskExecutor;
 class NavigationMesh;
 
 enum NavigationQuality
@@ -69,6 +70,8 @@ public:
     void SetAreaCost(unsigned filterTypeID, unsigned areaID, float weight);
     /// Set the maximum number of agents.
     void SetMaxAgents(unsigned agentCt);
+    /// Set whether to update the crowd agents in parallel using the work queue.
+    void SetParallelUpdate(bool enable);
     /// Set the crowd move target. The move target is applied to all crowd agents within the id range, excluding crowd agent which does not have acceleration.
     void SetCrowdTarget(const Vector3& position, int startId = 0, int endId = M_MAX_INT);
     /// Reset the crowd move target to all crowd agents within the id range, excluding crowd agent which does not have acceleration.
@@ -82,6 +85,8 @@ public:
     float GetAreaCost(unsigned filterTypeID, unsigned areaID) const;
     /// Get the maximum number of agents.
     unsigned GetMaxAgents() const { return maxAgents_; }
+    /// Return whether the crowd agents are updated in parallel.
+    bool GetParallelUpdate() const { return parallelUpdate_; }
     /// Get the current number of active agents.
     unsigned GetAgentCount() const;
 
@@ -135,12 +140,16 @@ private:
     WeakPtr<NavigationMesh> navigationMesh_;
     /// Max agents for the crowd.
     unsigned maxAgents_;
+    /// Parallel update flag.
+    bool parallelUpdate_;
     /// Internal debug information.
     dtCrowdAgentDebugInfo* agentDebug_;
     /// Container for fetching agents from DetourCrowd during update.
     PODVector<dtCrowdAgent*> agentBuffer_;
     /// Container for fetching agents from DetourCrowd during update.
     PODVector<CrowdAgent*> agents_;
+    /// Work queue executor for the parallel update.
+    CrowdTaskExecutor* taskExecutor_;
 };
 
 }
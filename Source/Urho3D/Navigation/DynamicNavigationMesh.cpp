@@ -35,6 +35,8 @@
 #include "../Navigation/Obstacle.h"
 #include "../Navigation/OffMeshConnection.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 
@@ -59,6 +61,8 @@ namespace Urho3D
 extern const char* NAVIGATION_CATEGORY;
 
 static const int DEFAULT_MAX_OBSTACLES = 1024;
+static const int DEFAULT_TILE_UPDATE_MS = 2;
+static const int TILE_ALLOCATOR_SIZE = 32000;
 
 struct DynamicNavigationMesh::TileCacheData
 {
@@ -66,6 +70,78 @@ struct DynamicNavigationMesh::TileCacheData
     int dataSize;
 };
 
+/// Tile cache tile to build.
+struct TileCacheTask
+{
+    /// Tile X coordinate.
+    int x_;
+    /// Tile Z coordinate.
+    int z_;
+    /// Number of layers built.
+    int numLayers_;
+    /// Built layers.
+    DynamicNavigationMesh::TileCacheData tiles_[TILECACHE_MAXLAYERS];
+};
+
+/// Builds the tile cache layers of a range of tiles. Used with WorkQueue::ParallelFor().
+struct TileCacheBuilder
+{
+    /// Construct.
+    TileCacheBuilder(DynamicNavigationMesh& navMesh, Vector<NavigationGeometryInfo>& geometryList) :
+        navMesh_(navMesh),
+        geometryList_(geometryList)
+    {
+    }
+
+    /// Build a range of tiles.
+    void operator () (TileCacheTask* start, TileCacheTask* end, unsigned threadIndex)
+    {
+        for (TileCacheTask* task = start; task < end; ++task)
+            task->numLayers_ = navMesh_.BuildTile(geometryList_, task->x_, task->z_, task->tiles_);
+    }
+
+    /// Navigation mesh.
+    DynamicNavigationMesh& navMesh_;
+    /// Geometries to build from.
+    Vector<NavigationGeometryInfo>& geometryList_;
+};
+
+/// Tile cache tile to rebuild because of obstacle changes.
+struct TileRebuildTask
+{
+    /// Tile reference.
+    dtCompressedTileRef ref_;
+    /// Built navigation mesh tile data, or null if the tile became empty.
+    unsigned char* data_;
+    /// Built data size.
+    int dataSize_;
+    /// Build status.
+    dtStatus status_;
+};
+
+/// Rebuilds the navigation mesh data of a range of tile cache tiles. Used with WorkQueue::ParallelFor().
+struct TileRebuilder
+{
+    /// Construct.
+    TileRebuilder(dtTileCache* tileCache, PODVector<dtTileCacheAlloc*>& allocators) :
+        tileCache_(tileCache),
+        allocators_(allocators)
+    {
+    }
+
+    /// Rebuild a range of tiles using the calling thread's allocator.
+    void operator () (TileRebuildTask* start, TileRebuildTask* end, unsigned threadIndex)
+    {
+        for (TileRebuildTask* task = start; task < end; ++task)
+            task->status_ = tileCache_->buildNavMeshTileData(task->ref_, allocators_[threadIndex], &task->data_, &task->dataSize_);
+    }
+
+    /// Tile cache.
+    dtTileCache* tileCache_;
+    /// Allocators per thread.
+    PODVector<dtTileCacheAlloc*>& allocators_;
+};
+
 struct TileCompressor : public dtTileCacheCompressor
 {
     virtual int maxCompressedSize(const int bufferSize)
@@ -97,8 +173,13 @@ struct MeshProcess : public dtTileCacheMeshProcess
     PODVector<unsigned char> offMeshAreas_;
     PODVector<unsigned char> offMeshDir_;
 
+    bool hasConnections_;
+    bool threaded_;
+
     inline MeshProcess(DynamicNavigationMesh* owner) :
-        owner_(owner)
+        owner_(owner),
+        hasConnections_(false),
+        threaded_(false)
     {
     }
 
@@ -112,14 +193,46 @@ struct MeshProcess : public dtTileCacheMeshProcess
                 polyFlags[i] = RC_WALKABLE_AREA;
         }
 
-        BoundingBox bounds;
-        rcVcopy(&bounds.min_.x_, params->bmin);
-        rcVcopy(&bounds.max_.x_, params->bmin);
+        // When processing in worker threads, the connections have been collected beforehand in the main thread
+        if (!threaded_)
+        {
+            BoundingBox bounds;
+            rcVcopy(&bounds.min_.x_, params->bmin);
+            rcVcopy(&bounds.max_.x_, params->bmin);
+            UpdateConnectionData(bounds);
+        }
 
+        if (hasConnections_)
+        {
+            params->offMeshConCount = offMeshRadii_.Size();
+            params->offMeshConVerts = &offMeshVertices_[0].x_;
+            params->offMeshConRad = &offMeshRadii_[0];
+            params->offMeshConFlags = &offMeshFlags_[0];
+            params->offMeshConAreas = &offMeshAreas_[0];
+            params->offMeshConDir = &offMeshDir_[0];
+        }
+    }
+
+    /// Collect the off-mesh connections, then process tiles without accessing the scene until EndThreadedProcess(). Called from the main thread.
+    void BeginThreadedProcess()
+    {
+        UpdateConnectionData(owner_->GetBoundingBox());
+        threaded_ = true;
+    }
+
+    /// Return to collecting the off-mesh connections for each processed tile.
+    void EndThreadedProcess()
+    {
+        threaded_ = false;
+    }
+
+    void UpdateConnectionData(const BoundingBox& bounds)
+    {
         // collect off-mesh connections
         PODVector<OffMeshConnection*> offMeshConnections = owner_->CollectOffMeshConnections(bounds);
 
-        if (offMeshConnections.Size() > 0)
+        hasConnections_ = offMeshConnections.Size() > 0;
+        if (hasConnections_)
         {
             if (offMeshConnections.Size() != offMeshRadii_.Size())
             {
@@ -139,12 +252,6 @@ struct MeshProcess : public dtTileCacheMeshProcess
                     offMeshDir_.Push(connection->IsBidirectional() ? DT_OFFMESH_CON_BIDIR : 0);
                 }
             }
-            params->offMeshConCount = offMeshRadii_.Size();
-            params->offMeshConVerts = &offMeshVertices_[0].x_;
-            params->offMeshConRad = &offMeshRadii_[0];
-            params->offMeshConFlags = &offMeshFlags_[0];
-            params->offMeshConAreas = &offMeshAreas_[0];
-            params->offMeshConDir = &offMeshDir_[0];
         }
     }
 
@@ -212,12 +319,13 @@ DynamicNavigationMesh::DynamicNavigationMesh(Context* context) :
     NavigationMesh(context),
     tileCache_(0),
     maxObstacles_(1024),
+    tileUpdateMs_(DEFAULT_TILE_UPDATE_MS),
     drawObstacles_(false)
 {
     //64 is the largest tile-size that DetourTileCache will tolerate without silently failing
     tileSize_ = 64;
     partitionType_ = NAVMESH_PARTITION_MONOTONE;
-    allocator_ = new LinearAllocator(32000); //32kb to start
+    allocator_ = new LinearAllocator(TILE_ALLOCATOR_SIZE); //32kb to start
     compressor_ = new TileCompressor();
     meshProcessor_ = new MeshProcess(this);
 }
@@ -231,6 +339,9 @@ DynamicNavigationMesh::~DynamicNavigationMesh()
     compressor_ = 0;
     delete meshProcessor_;
     meshProcessor_ = 0;
+    for (unsigned i = 0; i < threadAllocators_.Size(); ++i)
+        delete threadAllocators_[i];
+    threadAllocators_.Clear();
 }
 
 void DynamicNavigationMesh::RegisterObject(Context* context)
@@ -239,6 +350,7 @@ void DynamicNavigationMesh::RegisterObject(Context* context)
 
     COPY_BASE_ATTRIBUTES(NavigationMesh);
     ACCESSOR_ATTRIBUTE("Max Obstacles", GetMaxObstacles, SetMaxObstacles, unsigned, DEFAULT_MAX_OBSTACLES, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Tile Update Ms", GetTileUpdateMs, SetTileUpdateMs, int, DEFAULT_TILE_UPDATE_MS, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Draw Obstacles", GetDrawObstacles, SetDrawObstacles, bool, false, AM_DEFAULT);
 }
 
@@ -342,29 +454,8 @@ bool DynamicNavigationMesh::Build()
         }
 
         // Build each tile
-        unsigned numTiles = 0;
-
-        for (int z = 0; z < numTilesZ_; ++z)
-        {
-            for (int x = 0; x < numTilesX_; ++x)
-            {
-                TileCacheData tiles[TILECACHE_MAXLAYERS];
-                int layerCt = BuildTile(geometryList, x, z, tiles);
-                for (int i = 0; i < layerCt; ++i)
-                {
-                    dtCompressedTileRef tileRef;
-                    int status = tileCache_->addTile(tiles[i].data, tiles[i].dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
-                    if (dtStatusFailed(status))
-                    {
-                        dtFree(tiles[i].data);
-                        tiles[i].data = 0x0;
-                    }
-                }
-                ++numTiles;
-            }
-            for (int x = 0; x < numTilesX_; ++x)
-                tileCache_->buildNavMeshTilesAt(x, z, navMesh_);
-        }
+        unsigned numTiles = numTilesX_ * numTilesZ_;
+        BuildTiles(geometryList, IntVector2::ZERO, IntVector2(numTilesX_ - 1, numTilesZ_ - 1));
 
         // For a full build it's necessary to update the nav mesh
         // not doing so will cause dependent components to crash, like DetourCrowdManager
@@ -411,97 +502,54 @@ bool DynamicNavigationMesh::Build(const BoundingBox& boundingBox)
     if (!node_->GetWorldScale().Equals(Vector3::ONE))
         LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
 
-    BoundingBox localSpaceBox = boundingBox.Transformed(node_->GetWorldTransform().Inverse());
-
-    float tileEdgeLength = (float)tileSize_ * cellSize_;
-
     Vector<NavigationGeometryInfo> geometryList;
     CollectGeometries(geometryList);
 
-    int sx = Clamp((int)((localSpaceBox.min_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
-    int sz = Clamp((int)((localSpaceBox.min_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
-    int ex = Clamp((int)((localSpaceBox.max_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
-    int ez = Clamp((int)((localSpaceBox.max_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
-
-    unsigned numTiles = 0;
-
-    for (int z = sz; z <= ez; ++z)
-    {
-        for (int x = sx; x <= ex; ++x)
-        {
-            dtCompressedTileRef existing[TILECACHE_MAXLAYERS];
-            const int existingCt = tileCache_->getTilesAt(x, z, existing, TILECACHE_MAXLAYERS);
-            for (int i = 0; i < existingCt; ++i)
-            {
-                unsigned char* data = 0x0;
-                if (!dtStatusFailed(tileCache_->removeTile(existing[i], &data, 0)) && data != 0x0)
-                    dtFree(data);
-            }
+    IntVector2 from, to;
+    GetTileRange(boundingBox, from, to);
 
-            TileCacheData tiles[TILECACHE_MAXLAYERS];
-            int layerCt = BuildTile(geometryList, x, z, tiles);
-            for (int i = 0; i < layerCt; ++i)
-            {
-                dtCompressedTileRef tileRef;
-                int status = tileCache_->addTile(tiles[i].data, tiles[i].dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
-                if (dtStatusFailed(status))
-                {
-                    dtFree(tiles[i].data);
-                    tiles[i].data = 0x0;
-                }
-                else
-                {
-                    tileCache_->buildNavMeshTile(tileRef, navMesh_);
-                    ++numTiles;
-                }
-            }
-        }
-    }
+    unsigned numTiles = BuildTiles(geometryList, from, to);
 
     LOGDEBUG("Rebuilt " + String(numTiles) + " tiles of the navigation mesh");
     return true;
 }
 
+bool DynamicNavigationMesh::BuildAsync(const BoundingBox& boundingBox)
+{
+    // The tile cache is updated in the main thread on every scene update and can not have tiles swapped in from the
+    // background, so rebuild immediately. The layers are still built in worker threads
+    bool success = Build(boundingBox);
+    if (success)
+        SendAsyncBuildFinished(boundingBox);
+    return success;
+}
+
 
 void DynamicNavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
 {
     if (!debug || !navMesh_ || !node_)
         return;
 
-    const Matrix3x4& worldTransform = node_->GetWorldTransform();
-
     const dtNavMesh* navMesh = navMesh_;
 
+    PODVector<const dtMeshTile*> tiles;
     for (int z = 0; z < numTilesZ_; ++z)
     {
         for (int x = 0; x < numTilesX_; ++x)
         {
             // Get the layers from the tile-cache
-            const dtMeshTile* tiles[TILECACHE_MAXLAYERS];
-            int tileCount = navMesh->getTilesAt(x, z, tiles, TILECACHE_MAXLAYERS);
+            const dtMeshTile* layers[TILECACHE_MAXLAYERS];
+            int tileCount = navMesh->getTilesAt(x, z, layers, TILECACHE_MAXLAYERS);
             for (int i = 0; i < tileCount; ++i)
             {
-                const dtMeshTile* tile = tiles[i];
-                if (!tile)
-                    continue;
-
-                for (int i = 0; i < tile->header->polyCount; ++i)
-                {
-                    dtPoly* poly = tile->polys + i;
-                    for (unsigned j = 0; j < poly->vertCount; ++j)
-                    {
-                        debug->AddLine(
-                            worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[j] * 3]),
-                            worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[(j + 1) % poly->vertCount] * 3]),
-                            Color::YELLOW,
-                            depthTest
-                            );
-                    }
-                }
+                if (layers[i])
+                    tiles.Push(layers[i]);
             }
         }
     }
 
+    DrawDebugTiles(debug, depthTest, tiles);
+
     Scene* scene = GetScene();
     if (scene)
     {
@@ -665,24 +713,86 @@ PODVector<unsigned char> DynamicNavigationMesh::GetNavigationDataAttr() const
     return ret.GetBuffer();
 }
 
-int DynamicNavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int x, int z, TileCacheData* tiles)
+unsigned DynamicNavigationMesh::BuildTiles(Vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
 {
-    PROFILE(BuildNavigationMeshTile);
+    PODVector<TileCacheTask> tasks;
+    for (int z = from.y_; z <= to.y_; ++z)
+    {
+        for (int x = from.x_; x <= to.x_; ++x)
+        {
+            TileCacheTask task;
+            task.x_ = x;
+            task.z_ = z;
+            task.numLayers_ = 0;
+            tasks.Push(task);
+        }
+    }
 
-    tileCache_->removeTile(navMesh_->getTileRefAt(x, z, 0), 0, 0);
+    // Build the layers in parallel. The tile cache is not thread-safe, so add the layers afterward in order
+    TileCacheBuilder builder(*this, geometryList);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(tasks, 1, builder);
+    else
+        builder(tasks.Begin().ptr_, tasks.End().ptr_, 0);
 
-    float tileEdgeLength = (float)tileSize_ * cellSize_;
+    unsigned numLayers = 0;
+    for (unsigned i = 0; i < tasks.Size(); ++i)
+    {
+        TileCacheTask& task = tasks[i];
+        int x = task.x_;
+        int z = task.z_;
+
+        tileCache_->removeTile(navMesh_->getTileRefAt(x, z, 0), 0, 0);
+
+        dtCompressedTileRef existing[TILECACHE_MAXLAYERS];
+        const int existingCt = tileCache_->getTilesAt(x, z, existing, TILECACHE_MAXLAYERS);
+        for (int j = 0; j < existingCt; ++j)
+        {
+            unsigned char* data = 0x0;
+            if (!dtStatusFailed(tileCache_->removeTile(existing[j], &data, 0)) && data != 0x0)
+                dtFree(data);
+        }
 
-    BoundingBox tileBoundingBox(Vector3(
-        boundingBox_.min_.x_ + tileEdgeLength * (float)x,
-        boundingBox_.min_.y_,
-        boundingBox_.min_.z_ + tileEdgeLength * (float)z
-        ),
-        Vector3(
-        boundingBox_.min_.x_ + tileEdgeLength * (float)(x + 1),
-        boundingBox_.max_.y_,
-        boundingBox_.min_.z_ + tileEdgeLength * (float)(z + 1)
-        ));
+        for (int j = 0; j < task.numLayers_; ++j)
+        {
+            dtCompressedTileRef tileRef;
+            int status = tileCache_->addTile(task.tiles_[j].data, task.tiles_[j].dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
+            if (dtStatusFailed(status))
+            {
+                dtFree(task.tiles_[j].data);
+                task.tiles_[j].data = 0x0;
+            }
+            else
+            {
+                tileCache_->buildNavMeshTile(tileRef, navMesh_);
+                ++numLayers;
+            }
+        }
+
+        // Send a notification of the rebuild of this tile to anyone interested
+        if (task.numLayers_)
+        {
+            BoundingBox tileBoundingBox = GetTileBoundingBox(x, z);
+
+            using namespace NavigationAreaRebuilt;
+            VariantMap& eventData = GetContext()->GetEventDataMap();
+            eventData[P_NODE] = GetNode();
+            eventData[P_MESH] = this;
+            eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
+            eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
+            SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+        }
+    }
+
+    return numLayers;
+}
+
+int DynamicNavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int x, int z, TileCacheData* tiles)
+{
+    PROFILE(BuildNavigationMeshTile);
+
+    BoundingBox tileBoundingBox = GetTileBoundingBox(x, z);
 
     DynamicNavBuildData build(allocator_);
 
@@ -837,17 +947,6 @@ int DynamicNavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryLis
             ++retCt;
     }
 
-    // Send a notification of the rebuild of this tile to anyone interested
-    {
-        using namespace NavigationAreaRebuilt;
-        VariantMap& eventData = GetContext()->GetEventDataMap();
-        eventData[P_NODE] = GetNode();
-        eventData[P_MESH] = this;
-        eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
-        eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
-        SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
-    }
-
     return retCt;
 }
 
@@ -900,7 +999,7 @@ void DynamicNavigationMesh::AddObstacle(Obstacle* obstacle, bool silent)
         // Because dtTileCache doesn't process obstacle requests while updating tiles 
         // it's necessary update until sufficient request space is available
         while (tileCache_->isObstacleQueueFull())
-            tileCache_->update(1, navMesh_);
+            UpdateTileCache(0);
 
         if (dtStatusFailed(tileCache_->addObstacle(pos, obstacle->GetRadius(), obstacle->GetHeight(), &refHolder)))
         {
@@ -940,7 +1039,7 @@ void DynamicNavigationMesh::RemoveObstacle(Obstacle* obstacle, bool silent)
         // Because dtTileCache doesn't process obstacle requests while updating tiles 
         // it's necessary update until sufficient request space is available
         while (tileCache_->isObstacleQueueFull())
-            tileCache_->update(1, navMesh_);
+            UpdateTileCache(0);
 
         if (dtStatusFailed(tileCache_->removeObstacle(obstacle->obstacleId_)))
         {
@@ -968,7 +1067,69 @@ void DynamicNavigationMesh::HandleSceneSubsystemUpdate(StringHash eventType, Var
     using namespace SceneSubsystemUpdate;
 
     if (tileCache_ && navMesh_ && IsEnabledEffective())
-        tileCache_->update(eventData[P_TIMESTEP].GetFloat(), navMesh_);
+        UpdateTileCache(tileUpdateMs_);
+}
+
+void DynamicNavigationMesh::UpdateTileCache(int maxMs)
+{
+    PROFILE(UpdateTileCache);
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned numThreads = queue ? queue->GetNumThreads() + 1 : 1;
+    while (threadAllocators_.Size() < numThreads)
+        threadAllocators_.Push(new LinearAllocator(TILE_ALLOCATOR_SIZE));
+
+    MeshProcess* meshProcess = static_cast<MeshProcess*>(meshProcessor_);
+    PODVector<TileRebuildTask> tasks;
+    HiresTimer timer;
+    bool threaded = false;
+
+    for (;;)
+    {
+        // Process pending obstacle requests and get the tiles they affect
+        const dtCompressedTileRef* tiles;
+        int numTiles;
+        tileCache_->beginUpdate(&tiles, &numTiles);
+        if (!numTiles)
+            break;
+
+        if (!threaded)
+        {
+            meshProcess->BeginThreadedProcess();
+            threaded = true;
+        }
+
+        // Rebuild a batch of tiles in parallel. The tile cache and navigation mesh are modified afterward in order
+        unsigned batchSize = (unsigned)Min(numTiles, (int)numThreads);
+        tasks.Resize(batchSize);
+        for (unsigned i = 0; i < batchSize; ++i)
+        {
+            tasks[i].ref_ = tiles[i];
+            tasks[i].data_ = 0;
+            tasks[i].dataSize_ = 0;
+        }
+
+        TileRebuilder rebuilder(tileCache_, threadAllocators_);
+        if (queue && batchSize > 1)
+            queue->ParallelFor(tasks, 1, rebuilder);
+        else
+            rebuilder(tasks.Begin().ptr_, tasks.End().ptr_, 0);
+
+        for (unsigned i = 0; i < batchSize; ++i)
+        {
+            TileRebuildTask& task = tasks[i];
+            if (dtStatusFailed(task.status_) || dtStatusFailed(tileCache_->replaceNavMeshTile(task.ref_, navMesh_, task.data_,
+                task.dataSize_)))
+                LOGWARNING("Failed to rebuild navigation mesh tile");
+        }
+        tileCache_->endUpdate((int)batchSize);
+
+        if (timer.GetUSec(false) >= (long long)maxMs * 1000)
+            break;
+    }
+
+    if (threaded)
+        meshProcess->EndThreadedProcess();
 }
 
 }
@@ -43,6 +43,9 @@ class URHO3D_API DynamicNavigationMesh : public NavigationMesh
     OBJECT(DynamicNavigationMesh)
     friend class Obstacle;
     friend struct MeshProcess;
+    friend struct TileCacheTask;
+    friend struct TileCacheBuilder;
+    friend struct TileRebuilder;
 
 public:
     /// Constructor.
@@ -57,6 +60,8 @@ public:
     virtual bool Build();
     /// Build/rebuild a portion of the navigation mesh.
     virtual bool Build(const BoundingBox& boundingBox);
+    /// Rebuild a portion of the navigation mesh immediately, as the tile cache can not be swapped in from the background, and send E_NAVIGATION_ASYNC_BUILD_FINISHED.
+    virtual bool BuildAsync(const BoundingBox& boundingBox);
     /// Visualize the component as debug geometry.
     virtual void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
     /// Add debug geometry to the debug renderer.
@@ -72,6 +77,11 @@ public:
     /// Return the maximum number of obstacles allowed.
     unsigned GetMaxObstacles() const { return maxObstacles_; }
 
+    /// Set the time budget in milliseconds for rebuilding tiles affected by obstacle changes per scene update. At least one batch of tiles is always rebuilt.
+    void SetTileUpdateMs(int ms) { tileUpdateMs_ = Max(ms, 0); }
+    /// Return the time budget in milliseconds for rebuilding tiles per scene update.
+    int GetTileUpdateMs() const { return tileUpdateMs_; }
+
     /// Draw debug geometry for Obstacles.
     void SetDrawObstacles(bool enable) { drawObstacles_ = enable; }
     /// Return whether to draw Obstacles.
@@ -92,8 +102,12 @@ protected:
     /// Used by Obstacle class to remove itself from the tile cache, if 'silent' an event will not be raised.
     void RemoveObstacle(Obstacle*, bool silent = false);
 
-    /// Build one tile of the navigation mesh. Return true if successful.
+    /// Build the tile cache layers of one tile without modifying the tile cache, so that it can be called from worker threads. Return the number of layers built.
     int BuildTile(Vector<NavigationGeometryInfo>& geometryList, int x, int z, TileCacheData*);
+    /// Build a rectangular range of tiles into the tile cache and the navigation mesh, using worker threads if available. Return the number of layers built.
+    unsigned BuildTiles(Vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to);
+    /// Rebuild the tiles affected by obstacle changes in batches using worker threads if available, until the time budget in milliseconds is spent or no tiles remain.
+    void UpdateTileCache(int maxMs);
     /// Off-mesh connections to be rebuilt in the mesh processor.
     PODVector<OffMeshConnection*> CollectOffMeshConnections(const BoundingBox& bounds);
     /// Release the navigation mesh, query, and tile cache.
@@ -111,8 +125,12 @@ private:
     dtTileCacheCompressor* compressor_;
     /// Mesh processer used by Detour, in this case a 'pass-through' processor.
     dtTileCacheMeshProcess* meshProcessor_;
+    /// Allocators for rebuilding tiles in worker threads, one per thread.
+    PODVector<dtTileCacheAlloc*> threadAllocators_;
     /// Maximum number of obstacle objects allowed.
     unsigned maxObstacles_;
+    /// Time budget in milliseconds for rebuilding tiles per scene update.
+    int tileUpdateMs_;
     /// Debug draw Obstacles.
     bool drawObstacles_;
 };
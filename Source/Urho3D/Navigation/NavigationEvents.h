@@ -43,6 +43,33 @@ EVENT(E_NAVIGATION_AREA_REBUILT, NavigationAreaRebuilt)
     PARAM(P_BOUNDSMAX, BoundsMax); // Vector3
 }
 
+/// Background rebuild of part of the navigation mesh has finished and the tiles have been swapped in.
+EVENT(E_NAVIGATION_ASYNC_BUILD_FINISHED, NavigationAsyncBuildFinished)
+{
+    PARAM(P_NODE, Node); // Node pointer
+    PARAM(P_MESH, Mesh); // NavigationMesh pointer
+    PARAM(P_BOUNDSMIN, BoundsMin); // Vector3
+    PARAM(P_BOUNDSMAX, BoundsMax); // Vector3
+}
+
+/// Queued path request has finished. The path can be taken with NavigationMesh::GetPathResult().
+EVENT(E_NAVIGATION_PATH_READY, NavigationPathReady)
+{
+    PARAM(P_NODE, Node); // Node pointer
+    PARAM(P_MESH, Mesh); // NavigationMesh pointer
+    PARAM(P_REQUESTID, RequestID); // unsigned
+    PARAM(P_SUCCESS, Success); // bool
+}
+
+/// Flow field has been computed, or recomputed after the navigation mesh changed. It can be sampled with NavigationMesh::GetFlowDirection().
+EVENT(E_NAVIGATION_FLOW_FIELD_READY, NavigationFlowFieldReady)
+{
+    PARAM(P_NODE, Node); // Node pointer
+    PARAM(P_MESH, Mesh); // NavigationMesh pointer
+    PARAM(P_FLOWFIELDID, FlowFieldID); // unsigned
+    PARAM(P_SUCCESS, Success); // bool
+}
+
 /// Crowd agent has been repositioned.
 EVENT(E_CROWD_AGENT_REPOSITION, CrowdAgentReposition)
 {
@@ -29,6 +29,8 @@
 #include "../Navigation/DynamicNavigationMesh.h"
 #include "../Graphics/Geometry.h"
 #include "../IO/Log.h"
+#include "../Core/MemoryTracker.h"
+#include "../Core/Mutex.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Graphics/Model.h"
 #include "../Navigation/NavArea.h"
@@ -39,7 +41,10 @@
 #include "../Navigation/Obstacle.h"
 #include "../Navigation/OffMeshConnection.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
 #include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
 #include "../Graphics/StaticModel.h"
 #include "../Graphics/TerrainPatch.h"
 #include "../IO/VectorBuffer.h"
@@ -80,8 +85,17 @@ static const float DEFAULT_EDGE_MAX_LENGTH = 12.0f;
 static const float DEFAULT_EDGE_MAX_ERROR = 1.3f;
 static const float DEFAULT_DETAIL_SAMPLE_DISTANCE = 6.0f;
 static const float DEFAULT_DETAIL_SAMPLE_MAX_ERROR = 1.0f;
+static const int DEFAULT_PATH_QUERY_BUDGET = 1;
 
 static const int MAX_POLYS = 2048;
+/// Search iterations between checks of the path query time budget.
+static const int PATH_QUERY_ITERATIONS = 32;
+/// Polygons expanded between checks of the path query time budget when computing flow fields.
+static const int FLOW_FIELD_ITERATIONS = 64;
+/// Number of tile borders a hierarchical path is refined through from the start.
+static const unsigned HIERARCHICAL_REFINE_PORTALS = 2;
+/// Region index of polygons which do not belong to a region in the hierarchical graph.
+static const unsigned short NO_REGION = 0xffff;
 
 
 /// Temporary data for finding a path.
@@ -99,269 +113,1349 @@ struct FindPathData
     unsigned char pathAreras_[MAX_POLYS];
 };
 
-NavigationMesh::NavigationMesh(Context* context) :
-    Component(context),
-    navMesh_(0),
-    navMeshQuery_(0),
-    queryFilter_(new dtQueryFilter()),
-    pathData_(new FindPathData()),
-    tileSize_(DEFAULT_TILE_SIZE),
-    cellSize_(DEFAULT_CELL_SIZE),
-    cellHeight_(DEFAULT_CELL_HEIGHT),
-    agentHeight_(DEFAULT_AGENT_HEIGHT),
-    agentRadius_(DEFAULT_AGENT_RADIUS),
-    agentMaxClimb_(DEFAULT_AGENT_MAX_CLIMB),
-    agentMaxSlope_(DEFAULT_AGENT_MAX_SLOPE),
-    regionMinSize_(DEFAULT_REGION_MIN_SIZE),
-    regionMergeSize_(DEFAULT_REGION_MERGE_SIZE),
-    edgeMaxLength_(DEFAULT_EDGE_MAX_LENGTH),
-    edgeMaxError_(DEFAULT_EDGE_MAX_ERROR),
-    detailSampleDistance_(DEFAULT_DETAIL_SAMPLE_DISTANCE),
-    detailSampleMaxError_(DEFAULT_DETAIL_SAMPLE_MAX_ERROR),
-    padding_(Vector3::ONE),
-    numTilesX_(0),
-    numTilesZ_(0),
-    partitionType_(NAVMESH_PARTITION_WATERSHED),
-    keepInterResults_(false),
-    drawOffMeshConnections_(false),
-    drawNavAreas_(false)
+/// Navigation mesh tile to build.
+struct NavigationTileTask
 {
-}
+    /// Construct.
+    NavigationTileTask(int x, int z) :
+        x_(x),
+        z_(z),
+        navData_(0),
+        navDataSize_(0),
+        success_(false)
+    {
+    }
 
-NavigationMesh::~NavigationMesh()
+    /// Tile X coordinate.
+    int x_;
+    /// Tile Z coordinate.
+    int z_;
+    /// Built Detour data.
+    unsigned char* navData_;
+    /// Built Detour data size.
+    int navDataSize_;
+    /// Build success flag.
+    bool success_;
+};
+
+/// Recast build settings of one navigation mesh tile, captured from the navigation mesh component.
+struct NavigationTileSettings
 {
-    ReleaseNavigationMesh();
+    /// Recast configuration.
+    rcConfig cfg_;
+    /// Tile X coordinate.
+    int x_;
+    /// Tile Z coordinate.
+    int z_;
+    /// Navigation agent height.
+    float agentHeight_;
+    /// Navigation agent radius.
+    float agentRadius_;
+    /// Navigation agent max vertical climb.
+    float agentMaxClimb_;
+    /// Type of the heightfield partitioning.
+    NavmeshPartitionType partitionType_;
+};
 
-    delete queryFilter_;
-    queryFilter_ = 0;
+/// Navigation mesh tile rebuilt in the background.
+struct NavigationAsyncTile
+{
+    /// Construct.
+    NavigationAsyncTile() :
+        navData_(0),
+        navDataSize_(0),
+        success_(false),
+        batch_(0)
+    {
+    }
 
-    delete pathData_;
-    pathData_ = 0;
-}
+    /// Destruct. Free the Detour data if it was not added to the navigation mesh.
+    ~NavigationAsyncTile()
+    {
+        dtFree(navData_);
+    }
 
-void NavigationMesh::RegisterObject(Context* context)
+    /// Build settings.
+    NavigationTileSettings settings_;
+    /// Geometry gathered in the main thread, and intermediate build results.
+    SimpleNavBuildData build_;
+    /// Built Detour data.
+    unsigned char* navData_;
+    /// Built Detour data size.
+    int navDataSize_;
+    /// Build success flag.
+    bool success_;
+    /// Index of the rebuild request.
+    unsigned batch_;
+    /// World-space bounding box of the rebuild request.
+    BoundingBox boundingBox_;
+    /// Work item.
+    SharedPtr<WorkItem> item_;
+};
+
+/// Queued path request between local space points. Identical requests share one.
+struct NavigationPathRequest
 {
-    context->RegisterFactory<NavigationMesh>(NAVIGATION_CATEGORY);
+    /// Construct.
+    NavigationPathRequest(const Vector3& start, const Vector3& end, const Vector3& extents) :
+        start_(start),
+        end_(end),
+        extents_(extents),
+        success_(false)
+    {
+    }
 
-    ACCESSOR_ATTRIBUTE("Tile Size", GetTileSize, SetTileSize, int, DEFAULT_TILE_SIZE, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Cell Height", GetCellHeight, SetCellHeight, float, DEFAULT_CELL_HEIGHT, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Agent Height", GetAgentHeight, SetAgentHeight, float, DEFAULT_AGENT_HEIGHT, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Agent Radius", GetAgentRadius, SetAgentRadius, float, DEFAULT_AGENT_RADIUS, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Agent Max Climb", GetAgentMaxClimb, SetAgentMaxClimb, float, DEFAULT_AGENT_MAX_CLIMB, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Agent Max Slope", GetAgentMaxSlope, SetAgentMaxSlope, float, DEFAULT_AGENT_MAX_SLOPE, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Region Min Size", GetRegionMinSize, SetRegionMinSize, float, DEFAULT_REGION_MIN_SIZE, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Region Merge Size", GetRegionMergeSize, SetRegionMergeSize, float, DEFAULT_REGION_MERGE_SIZE, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Edge Max Length", GetEdgeMaxLength, SetEdgeMaxLength, float, DEFAULT_EDGE_MAX_LENGTH, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Edge Max Error", GetEdgeMaxError, SetEdgeMaxError, float, DEFAULT_EDGE_MAX_ERROR, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Detail Sample Distance", GetDetailSampleDistance, SetDetailSampleDistance, float, DEFAULT_DETAIL_SAMPLE_DISTANCE, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Detail Sample Max Error", GetDetailSampleMaxError, SetDetailSampleMaxError, float, DEFAULT_DETAIL_SAMPLE_MAX_ERROR, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Bounding Box Padding", GetPadding, SetPadding, Vector3, Vector3::ONE, AM_DEFAULT);
-    MIXED_ACCESSOR_ATTRIBUTE("Navigation Data", GetNavigationDataAttr, SetNavigationDataAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_FILE | AM_NOEDIT);
-    ENUM_ACCESSOR_ATTRIBUTE("Partition Type", GetPartitionType, SetPartitionType, NavmeshPartitionType, navmeshPartitionTypeNames, NAVMESH_PARTITION_WATERSHED, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Draw OffMeshConnections", GetDrawOffMeshConnections, SetDrawOffMeshConnections, bool, false, AM_DEFAULT);
-    ACCESSOR_ATTRIBUTE("Draw NavAreas", GetDrawNavAreas, SetDrawNavAreas, bool, false, AM_DEFAULT);
-}
+    /// Start point.
+    Vector3 start_;
+    /// End point.
+    Vector3 end_;
+    /// Search extents of the start and end polygons.
+    Vector3 extents_;
+    /// Request IDs waiting for this path.
+    PODVector<unsigned> ids_;
+    /// Path points.
+    PODVector<Vector3> path_;
+    /// Success flag.
+    bool success_;
+};
 
-void NavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+/// Navigation mesh query for advancing one sliced path request at a time. One exists per thread.
+struct NavigationPathQuery
 {
-    if (!debug || !navMesh_ || !node_)
-        return;
+    /// Construct.
+    NavigationPathQuery() :
+        query_(0),
+        request_(0),
+        startRef_(0),
+        endRef_(0),
+        restarted_(false),
+        polys_(MAX_POLYS),
+        pathPoints_(MAX_POLYS)
+    {
+    }
 
-    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    /// Destruct.
+    ~NavigationPathQuery()
+    {
+        dtFreeNavMeshQuery(query_);
+    }
 
-    const dtNavMesh* navMesh = navMesh_;
+    /// Detour navigation mesh query.
+    dtNavMeshQuery* query_;
+    /// Request being searched.
+    NavigationPathRequest* request_;
+    /// Start polygon.
+    dtPolyRef startRef_;
+    /// End polygon.
+    dtPolyRef endRef_;
+    /// Whether the search has been restarted after the polygons changed.
+    bool restarted_;
+    /// Polygons on the path.
+    PODVector<dtPolyRef> polys_;
+    /// Points on the path.
+    PODVector<Vector3> pathPoints_;
+    /// Requests finished during the update.
+    PODVector<NavigationPathRequest*> finished_;
+};
 
-    for (int z = 0; z < numTilesZ_; ++z)
+/// Advances the queued path requests within a time budget. Used with WorkQueue::ParallelFor() on the path queries.
+struct NavigationPathProcessor
+{
+    /// Construct.
+    NavigationPathProcessor(PODVector<NavigationPathRequest*>& requests, const dtQueryFilter* filter, long long budget) :
+        requests_(requests),
+        filter_(filter),
+        budget_(budget),
+        nextRequest_(0)
     {
-        for (int x = 0; x < numTilesX_; ++x)
-        {
-            for (int i = 0; i < 128; ++i)
-            {
-                const dtMeshTile* tile = navMesh->getTileAt(x, z, i);
-                if (!tile)
-                    continue;
+    }
 
-                for (int i = 0; i < tile->header->polyCount; ++i)
-                {
-                    dtPoly* poly = tile->polys + i;
-                    for (unsigned j = 0; j < poly->vertCount; ++j)
-                    {
-                        debug->AddLine(
-                            worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[j] * 3]),
-                            worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[(j + 1) % poly->vertCount] * 3]),
-                            Color::YELLOW,
-                            depthTest
-                            );
-                    }
-                }
-            }
-        }
+    /// Advance a range of path queries until out of time or requests.
+    void operator () (NavigationPathQuery** start, NavigationPathQuery** end, unsigned threadIndex)
+    {
+        for (NavigationPathQuery** i = start; i < end; ++i)
+            Process(**i);
     }
 
-    Scene* scene = GetScene();
-    if (scene)
+    /// Advance one path query.
+    void Process(NavigationPathQuery& query)
     {
-        // Draw OffMeshConnection components
-        if (drawOffMeshConnections_)
+        while (timer_.GetUSec(false) < budget_)
         {
-            PODVector<Node*> connections;
-            scene->GetChildrenWithComponent<OffMeshConnection>(connections, true);
-            for (unsigned i = 0; i < connections.Size(); ++i)
+            if (!query.request_)
             {
-                OffMeshConnection* connection = connections[i]->GetComponent<OffMeshConnection>();
-                if (connection && connection->IsEnabledEffective())
-                    connection->DrawDebugGeometry(debug, depthTest);
+                query.request_ = TakeRequest();
+                if (!query.request_)
+                    return;
+
+                query.restarted_ = false;
+                if (!StartSearch(query))
+                {
+                    Finish(query);
+                    continue;
+                }
             }
-        }
 
-        // Draw NavArea components
-        if (drawNavAreas_)
-        {
-            PODVector<Node*> areas;
-            scene->GetChildrenWithComponent<NavArea>(areas, true);
-            for (unsigned i = 0; i < areas.Size(); ++i)
+            dtStatus status = query.query_->updateSlicedFindPath(PATH_QUERY_ITERATIONS, 0);
+            if (dtStatusInProgress(status))
+                continue;
+
+            if (dtStatusFailed(status))
             {
-                NavArea* area = areas[i]->GetComponent<NavArea>();
-                if (area && area->IsEnabledEffective())
-                    area->DrawDebugGeometry(debug, depthTest);
+                // Polygons may have disappeared due to tiles being rebuilt between frames. Search from the beginning once
+                if (!query.restarted_)
+                {
+                    query.restarted_ = true;
+                    if (StartSearch(query))
+                        continue;
+                }
             }
+            else
+                FinishPath(query);
+
+            Finish(query);
         }
     }
-}
 
-void NavigationMesh::SetMeshName(const String& newName)
-{
-    meshName_ = newName;
-}
+    /// Take the next queued request.
+    NavigationPathRequest* TakeRequest()
+    {
+        MutexLock lock(mutex_);
+        return nextRequest_ < requests_.Size() ? requests_[nextRequest_++] : 0;
+    }
 
-void NavigationMesh::SetTileSize(int size)
-{
-    tileSize_ = Max(size, 16);
+    /// Find the start and end polygons and begin the sliced search. Return true if successful.
+    bool StartSearch(NavigationPathQuery& query)
+    {
+        NavigationPathRequest& request = *query.request_;
+        query.query_->findNearestPoly(&request.start_.x_, &request.extents_.x_, filter_, &query.startRef_, 0);
+        query.query_->findNearestPoly(&request.end_.x_, &request.extents_.x_, filter_, &query.endRef_, 0);
+        if (!query.startRef_ || !query.endRef_)
+            return false;
 
-    MarkNetworkUpdate();
-}
+        return !dtStatusFailed(query.query_->initSlicedFindPath(query.startRef_, query.endRef_, &request.start_.x_,
+            &request.end_.x_, filter_));
+    }
 
-void NavigationMesh::SetCellSize(float size)
-{
-    cellSize_ = Max(size, M_EPSILON);
+    /// Gather the path points of a finished search.
+    void FinishPath(NavigationPathQuery& query)
+    {
+        NavigationPathRequest& request = *query.request_;
+        int numPolys = 0;
+        int numPathPoints = 0;
 
-    MarkNetworkUpdate();
-}
+        query.query_->finalizeSlicedFindPath(&query.polys_[0], &numPolys, MAX_POLYS);
+        if (!numPolys)
+            return;
 
-void NavigationMesh::SetCellHeight(float height)
-{
-    cellHeight_ = Max(height, M_EPSILON);
+        Vector3 actualEnd = request.end_;
 
-    MarkNetworkUpdate();
-}
+        // If full path was not found, clamp end point to the end polygon
+        if (query.polys_[numPolys - 1] != query.endRef_)
+            query.query_->closestPointOnPoly(query.polys_[numPolys - 1], &request.end_.x_, &actualEnd.x_, 0);
 
-void NavigationMesh::SetAgentHeight(float height)
-{
-    agentHeight_ = Max(height, M_EPSILON);
+        query.query_->findStraightPath(&request.start_.x_, &actualEnd.x_, &query.polys_[0], numPolys,
+            &query.pathPoints_[0].x_, 0, 0, &numPathPoints, MAX_POLYS);
 
-    MarkNetworkUpdate();
-}
+        request.path_ = PODVector<Vector3>(&query.pathPoints_[0], numPathPoints);
+        request.success_ = true;
+    }
 
-void NavigationMesh::SetAgentRadius(float radius)
-{
-    agentRadius_ = Max(radius, M_EPSILON);
+    /// Move the request to the finished list.
+    void Finish(NavigationPathQuery& query)
+    {
+        query.finished_.Push(query.request_);
+        query.request_ = 0;
+    }
 
-    MarkNetworkUpdate();
-}
+    /// Queued requests.
+    PODVector<NavigationPathRequest*>& requests_;
+    /// Query filter.
+    const dtQueryFilter* filter_;
+    /// Time budget in microseconds.
+    long long budget_;
+    /// Timer for the budget.
+    HiresTimer timer_;
+    /// Index of the next queued request to take.
+    unsigned nextRequest_;
+    /// Mutex for taking requests.
+    Mutex mutex_;
+};
 
-void NavigationMesh::SetAgentMaxClimb(float maxClimb)
+/// Polygon of a flow field.
+struct NavigationFlowPoly
 {
-    agentMaxClimb_ = Max(maxClimb, M_EPSILON);
+    /// Polygon reference, or 0 if the polygon has not been reached.
+    dtPolyRef ref_;
+    /// Travel cost from the position to the goal.
+    float cost_;
+    /// Midpoint of the portal leading towards the goal, or the goal in the goal polygon.
+    Vector3 position_;
+    /// Portal start point.
+    Vector3 portalStart_;
+    /// Portal end point.
+    Vector3 portalEnd_;
+    /// Index of the next polygon towards the goal, or M_MAX_UNSIGNED in the goal polygon.
+    unsigned next_;
+};
 
-    MarkNetworkUpdate();
-}
+/// Polygon waiting to be expanded in a flow field search.
+struct NavigationFlowNode
+{
+    /// Travel cost to the goal.
+    float cost_;
+    /// Index of the polygon in the flow field.
+    unsigned index_;
+    /// Polygon reference.
+    dtPolyRef ref_;
+};
 
-void NavigationMesh::SetAgentMaxSlope(float maxSlope)
+/// Flow field towards a local space goal over the polygons of the navigation mesh, computed with a Dijkstra search from the goal. Identical requests share one.
+struct NavigationFlowField
 {
-    agentMaxSlope_ = Max(maxSlope, 0.0f);
+    /// Construct.
+    NavigationFlowField(const Vector3& goal, const Vector3& extents) :
+        goal_(goal),
+        extents_(extents),
+        version_(0),
+        searchVersion_(0),
+        ready_(false),
+        success_(false),
+        searchSuccess_(false)
+    {
+    }
 
-    MarkNetworkUpdate();
-}
+    /// Goal point.
+    Vector3 goal_;
+    /// Search extents of the goal polygon.
+    Vector3 extents_;
+    /// Flow field IDs sharing this field.
+    PODVector<unsigned> ids_;
+    /// First polygon index of each tile, followed by the number of polygons.
+    PODVector<unsigned> tileStart_;
+    /// Polygons by tile and polygon index.
+    PODVector<NavigationFlowPoly> polys_;
+    /// Navigation mesh version the polygons were computed for, or 0 if they need to be recomputed.
+    unsigned version_;
+    /// Tile start indices of the search in progress.
+    PODVector<unsigned> searchTileStart_;
+    /// Polygons of the search in progress.
+    PODVector<NavigationFlowPoly> searchPolys_;
+    /// Polygons waiting to be expanded, as a binary heap ordered by cost.
+    PODVector<NavigationFlowNode> open_;
+    /// Navigation mesh version of the search in progress, or 0 if not searching.
+    unsigned searchVersion_;
+    /// Whether the polygons have been computed at least once.
+    bool ready_;
+    /// Whether the goal was found on the navigation mesh.
+    bool success_;
+    /// Whether the goal was found in the search in progress.
+    bool searchSuccess_;
+};
 
-void NavigationMesh::SetRegionMinSize(float size)
+/// Add a node to a search heap ordered by cost.
+template <class T> static void PushSearchNode(PODVector<T>& heap, const T& node)
 {
-    regionMinSize_ = Max(size, M_EPSILON);
-
-    MarkNetworkUpdate();
+    unsigned i = heap.Size();
+    heap.Push(node);
+    while (i > 0)
+    {
+        unsigned parent = (i - 1) / 2;
+        if (heap[parent].cost_ <= node.cost_)
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = node;
 }
 
-void NavigationMesh::SetRegionMergeSize(float size)
+/// Remove and return the lowest cost node of a search heap.
+template <class T> static T PopSearchNode(PODVector<T>& heap)
 {
-    regionMergeSize_ = Max(size, M_EPSILON);
+    T top = heap[0];
+    T last = heap.Back();
+    heap.Pop();
 
-    MarkNetworkUpdate();
+    unsigned size = heap.Size();
+    if (size)
+    {
+        unsigned i = 0;
+        for (;;)
+        {
+            unsigned child = i * 2 + 1;
+            if (child >= size)
+                break;
+            if (child + 1 < size && heap[child + 1].cost_ < heap[child].cost_)
+                ++child;
+            if (last.cost_ <= heap[child].cost_)
+                break;
+            heap[i] = heap[child];
+            i = child;
+        }
+        heap[i] = last;
+    }
+
+    return top;
 }
 
-void NavigationMesh::SetEdgeMaxLength(float length)
+/// Return a value which changes whenever tiles are added to or removed from the navigation mesh. Never returns 0.
+static unsigned GetNavMeshVersion(const dtNavMesh* navMesh)
 {
-    edgeMaxLength_ = Max(length, M_EPSILON);
+    unsigned version = (unsigned)(size_t)navMesh;
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+        if (tile->header)
+            version = version * 31 + (tile->salt ^ (unsigned)(size_t)tile->header);
+    }
 
-    MarkNetworkUpdate();
+    return version ? version : 1;
 }
 
-void NavigationMesh::SetEdgeMaxError(float error)
+/// Return the computed flow field polygon of a polygon reference, or null if it was not reached or has changed.
+static const NavigationFlowPoly* GetFlowPoly(const dtNavMesh* navMesh, const NavigationFlowField& field, dtPolyRef ref)
 {
-    edgeMaxError_ = Max(error, M_EPSILON);
+    unsigned salt, tileIndex, polyIndex;
+    navMesh->decodePolyId(ref, salt, tileIndex, polyIndex);
+    if (tileIndex + 1 >= field.tileStart_.Size())
+        return 0;
 
-    MarkNetworkUpdate();
+    unsigned index = field.tileStart_[tileIndex] + polyIndex;
+    if (index >= field.tileStart_[tileIndex + 1])
+        return 0;
+
+    const NavigationFlowPoly& poly = field.polys_[index];
+    return poly.ref_ == ref ? &poly : 0;
 }
 
-void NavigationMesh::SetDetailSampleDistance(float distance)
+/// Return the closest point on a line segment.
+static Vector3 ClosestPointOnSegment(const Vector3& point, const Vector3& start, const Vector3& end)
 {
-    detailSampleDistance_ = Max(distance, M_EPSILON);
+    Vector3 segment = end - start;
+    float lengthSquared = segment.LengthSquared();
+    if (lengthSquared < M_EPSILON)
+        return start;
 
-    MarkNetworkUpdate();
+    return start + segment * Clamp((point - start).DotProduct(segment) / lengthSquared, 0.0f, 1.0f);
 }
 
-void NavigationMesh::SetDetailSampleMaxError(float error)
+/// Advances flow field searches within a time budget. Used with WorkQueue::ParallelFor() on the flow fields being searched.
+struct NavigationFlowFieldProcessor
 {
-    detailSampleMaxError_ = Max(error, M_EPSILON);
+    /// Construct.
+    NavigationFlowFieldProcessor(const dtNavMesh* navMesh, const dtQueryFilter* filter, long long budget) :
+        navMesh_(navMesh),
+        filter_(filter),
+        budget_(budget)
+    {
+    }
 
-    MarkNetworkUpdate();
-}
+    /// Advance a range of flow fields until out of time.
+    void operator () (NavigationFlowField** start, NavigationFlowField** end, unsigned threadIndex)
+    {
+        for (NavigationFlowField** i = start; i < end; ++i)
+            Process(**i);
+    }
 
-void NavigationMesh::SetPadding(const Vector3& padding)
-{
-    padding_ = padding;
+    /// Advance the search of one flow field.
+    void Process(NavigationFlowField& field)
+    {
+        while (!field.open_.Empty() && timer_.GetUSec(false) < budget_)
+        {
+            for (int i = 0; i < FLOW_FIELD_ITERATIONS && !field.open_.Empty(); ++i)
+                Expand(field);
+        }
+    }
 
-    MarkNetworkUpdate();
-}
+    /// Expand the lowest cost polygon to the neighbours that can reach it.
+    void Expand(NavigationFlowField& field)
+    {
+        NavigationFlowNode node = PopSearchNode(field.open_);
+        // Skip polygons already reached at a lower cost
+        if (node.cost_ > field.searchPolys_[node.index_].cost_)
+            return;
 
-bool NavigationMesh::Build()
-{
-    PROFILE(BuildNavigationMesh);
+        const Vector3 position = field.searchPolys_[node.index_].position_;
 
-    // Release existing navigation data and zero the bounding box
-    ReleaseNavigationMesh();
+        const dtMeshTile* tile = 0;
+        const dtPoly* poly = 0;
+        navMesh_->getTileAndPolyByRefUnsafe(node.ref_, &tile, &poly);
 
-    if (!node_)
-        return false;
+        for (unsigned i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+        {
+            const dtLink& link = tile->links[i];
+            if (!link.ref)
+                continue;
 
-    if (!node_->GetWorldScale().Equals(Vector3::ONE))
-        LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
+            // Off-mesh connections are one-way, so they can not be followed backwards from the goal
+            const dtMeshTile* neighbourTile = 0;
+            const dtPoly* neighbourPoly = 0;
+            navMesh_->getTileAndPolyByRefUnsafe(link.ref, &neighbourTile, &neighbourPoly);
+            if (neighbourPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION || !filter_->passFilter(link.ref,
+                neighbourTile, neighbourPoly))
+                continue;
 
-    Vector<NavigationGeometryInfo> geometryList;
-    CollectGeometries(geometryList);
+            // The portal is the shared edge, or part of it on tile borders
+            Vector3 portalStart(&tile->verts[poly->verts[link.edge] * 3]);
+            Vector3 portalEnd(&tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3]);
+            if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+            {
+                Vector3 edgeStart = portalStart;
+                portalStart = edgeStart.Lerp(portalEnd, link.bmin / 255.0f);
+                portalEnd = edgeStart.Lerp(portalEnd, link.bmax / 255.0f);
+            }
 
-    if (geometryList.Empty())
-        return true; // Nothing to do
+            Vector3 portalMid = (portalStart + portalEnd) * 0.5f;
+            float cost = node.cost_ + filter_->getCost(&portalMid.x_, &position.x_, 0, 0, 0, node.ref_, tile, poly, 0, 0, 0);
 
-    // Build the combined bounding box
-    for (unsigned i = 0; i < geometryList.Size(); ++i)
-        boundingBox_.Merge(geometryList[i].boundingBox_);
+            unsigned salt, tileIndex, polyIndex;
+            navMesh_->decodePolyId(link.ref, salt, tileIndex, polyIndex);
+            unsigned index = field.searchTileStart_[tileIndex] + polyIndex;
+            NavigationFlowPoly& neighbour = field.searchPolys_[index];
+            if (neighbour.ref_ == link.ref && cost >= neighbour.cost_)
+                continue;
 
-    // Expand bounding box by padding
-    boundingBox_.min_ -= padding_;
-    boundingBox_.max_ += padding_;
+            neighbour.ref_ = link.ref;
+            neighbour.cost_ = cost;
+            neighbour.position_ = portalMid;
+            neighbour.portalStart_ = portalStart;
+            neighbour.portalEnd_ = portalEnd;
+            neighbour.next_ = node.index_;
+
+            NavigationFlowNode next;
+            next.cost_ = cost;
+            next.index_ = index;
+            next.ref_ = link.ref;
+            PushSearchNode(field.open_, next);
+        }
+    }
 
-    {
-        PROFILE(BuildNavigationMesh);
+    /// Navigation mesh.
+    const dtNavMesh* navMesh_;
+    /// Query filter.
+    const dtQueryFilter* filter_;
+    /// Time budget in microseconds.
+    long long budget_;
+    /// Timer for the budget.
+    HiresTimer timer_;
+};
+
+/// Connection from a region of a tile to a region of a neighbour tile in the hierarchical graph.
+struct NavigationTilePortal
+{
+    /// Point on the shared tile border.
+    Vector3 position_;
+    /// Region in the tile.
+    unsigned short region_;
+    /// Region in the neighbour tile.
+    unsigned short neighbourRegion_;
+    /// Neighbour tile index.
+    unsigned neighbourTile_;
+};
+
+/// Tile of the hierarchical graph. The polygons of the tile connected to each other within the tile form a region.
+struct NavigationGraphTile
+{
+    /// Construct.
+    NavigationGraphTile() :
+        header_(0),
+        salt_(0)
+    {
+    }
+
+    /// Detour tile header the regions were computed for.
+    const dtMeshHeader* header_;
+    /// Detour tile salt the regions were computed for.
+    unsigned salt_;
+    /// Region of each polygon.
+    PODVector<unsigned short> polyRegions_;
+    /// Portals to the neighbour tiles.
+    PODVector<NavigationTilePortal> portals_;
+};
+
+/// Hierarchical graph of the tile regions of a navigation mesh, for searching long paths.
+struct NavigationTileGraph
+{
+    /// Construct.
+    NavigationTileGraph() :
+        navMesh_(0)
+    {
+    }
+
+    /// Navigation mesh.
+    const dtNavMesh* navMesh_;
+    /// Tiles by tile index.
+    Vector<NavigationGraphTile> tiles_;
+    /// Index of the first portal of each tile in the search, followed by the number of portals.
+    PODVector<unsigned> portalStart_;
+    /// Portals by search index.
+    PODVector<const NavigationTilePortal*> portals_;
+};
+
+/// Portal waiting to be expanded in a hierarchical graph search.
+struct NavigationGraphNode
+{
+    /// Cost from the start plus the estimated cost to the end.
+    float cost_;
+    /// Portal search index.
+    unsigned index_;
+};
+
+/// A* search from a start region to an end region over the portals of the hierarchical graph.
+struct NavigationGraphSearch
+{
+    /// Construct.
+    NavigationGraphSearch(const NavigationTileGraph& graph, const Vector3& end, unsigned endTile, unsigned short endRegion) :
+        graph_(graph),
+        end_(end),
+        endTile_(endTile),
+        endRegion_(endRegion),
+        goal_(graph.portals_.Size())
+    {
+        costs_.Resize(goal_ + 1);
+        parents_.Resize(goal_ + 1);
+        closed_.Resize(goal_ + 1);
+        for (unsigned i = 0; i <= goal_; ++i)
+        {
+            costs_[i] = M_INFINITY;
+            closed_[i] = false;
+        }
+    }
+
+    /// Search from a start point. Return true if the end was reached.
+    bool Run(unsigned startTile, unsigned short startRegion, const Vector3& start)
+    {
+        ExpandRegion(startTile, startRegion, start, 0.0f, M_MAX_UNSIGNED);
+
+        while (!open_.Empty())
+        {
+            NavigationGraphNode node = PopSearchNode(open_);
+            if (closed_[node.index_])
+                continue;
+
+            closed_[node.index_] = true;
+            if (node.index_ == goal_)
+                return true;
+
+            const NavigationTilePortal& portal = *graph_.portals_[node.index_];
+            ExpandRegion(portal.neighbourTile_, portal.neighbourRegion_, portal.position_, costs_[node.index_], node.index_);
+        }
+
+        return false;
+    }
+
+    /// Reach the portals leaving a region, and the end if it is in the region.
+    void ExpandRegion(unsigned tile, unsigned short region, const Vector3& position, float cost, unsigned parent)
+    {
+        if (tile == endTile_ && region == endRegion_)
+            Reach(goal_, cost + (end_ - position).Length(), 0.0f, parent);
+
+        const PODVector<NavigationTilePortal>& portals = graph_.tiles_[tile].portals_;
+        unsigned first = graph_.portalStart_[tile];
+        for (unsigned i = 0; i < portals.Size(); ++i)
+        {
+            if (portals[i].region_ == region)
+                Reach(first + i, cost + (portals[i].position_ - position).Length(), (end_ - portals[i].position_).Length(), parent);
+        }
+    }
+
+    /// Reach a portal with a cost from the start.
+    void Reach(unsigned index, float cost, float heuristic, unsigned parent)
+    {
+        if (closed_[index] || cost >= costs_[index])
+            return;
+
+        costs_[index] = cost;
+        parents_[index] = parent;
+
+        NavigationGraphNode node;
+        node.cost_ = cost + heuristic;
+        node.index_ = index;
+        PushSearchNode(open_, node);
+    }
+
+    /// Hierarchical graph.
+    const NavigationTileGraph& graph_;
+    /// End point.
+    Vector3 end_;
+    /// End tile index.
+    unsigned endTile_;
+    /// End region.
+    unsigned short endRegion_;
+    /// Search index of the end.
+    unsigned goal_;
+    /// Cost from the start by search index.
+    PODVector<float> costs_;
+    /// Previous portal by search index.
+    PODVector<unsigned> parents_;
+    /// Closed flags by search index.
+    PODVector<bool> closed_;
+    /// Portals waiting to be expanded.
+    PODVector<NavigationGraphNode> open_;
+};
+
+/// Find the regions of a tile for the hierarchical graph.
+static void BuildTileRegions(const dtNavMesh* navMesh, const dtMeshTile* tile, unsigned tileIndex, NavigationGraphTile& graphTile)
+{
+    graphTile.polyRegions_.Clear();
+    if (!tile->header)
+        return;
+
+    unsigned numPolys = (unsigned)tile->header->polyCount;
+    graphTile.polyRegions_.Resize(numPolys);
+    for (unsigned i = 0; i < numPolys; ++i)
+        graphTile.polyRegions_[i] = NO_REGION;
+
+    unsigned short numRegions = 0;
+    PODVector<unsigned> stack;
+    for (unsigned i = 0; i < numPolys; ++i)
+    {
+        if (graphTile.polyRegions_[i] != NO_REGION || tile->polys[i].getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+            continue;
+
+        // Flood fill through the links within the tile
+        unsigned short region = numRegions++;
+        graphTile.polyRegions_[i] = region;
+        stack.Push(i);
+        while (stack.Size())
+        {
+            const dtPoly& poly = tile->polys[stack.Back()];
+            stack.Pop();
+
+            for (unsigned j = poly.firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+            {
+                dtPolyRef ref = tile->links[j].ref;
+                if (!ref || navMesh->decodePolyIdTile(ref) != tileIndex)
+                    continue;
+
+                unsigned neighbour = navMesh->decodePolyIdPoly(ref);
+                if (graphTile.polyRegions_[neighbour] != NO_REGION || tile->polys[neighbour].getType() ==
+                    DT_POLYTYPE_OFFMESH_CONNECTION)
+                    continue;
+
+                graphTile.polyRegions_[neighbour] = region;
+                stack.Push(neighbour);
+            }
+        }
+    }
+}
+
+/// Find the portals from the regions of a tile to the regions of its neighbour tiles for the hierarchical graph.
+static void BuildTilePortals(const dtNavMesh* navMesh, const dtMeshTile* tile, unsigned tileIndex, NavigationTileGraph& graph)
+{
+    NavigationGraphTile& graphTile = graph.tiles_[tileIndex];
+    graphTile.portals_.Clear();
+    if (!tile->header)
+        return;
+
+    // Average the border edges between each pair of regions, then pick the edge closest to the average, so that the portal is not in a gap between edges
+    PODVector<Vector3> averages;
+    PODVector<unsigned> edgeCounts;
+    PODVector<float> closestDistances;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int i = 0; i < tile->header->polyCount; ++i)
+        {
+            const dtPoly& poly = tile->polys[i];
+            unsigned short region = graphTile.polyRegions_[i];
+            if (region == NO_REGION)
+                continue;
+
+            for (unsigned j = poly.firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+            {
+                const dtLink& link = tile->links[j];
+                if (!link.ref || link.side == 0xff)
+                    continue;
+
+                unsigned neighbourTile = navMesh->decodePolyIdTile(link.ref);
+                unsigned neighbourPoly = navMesh->decodePolyIdPoly(link.ref);
+                const PODVector<unsigned short>& neighbourRegions = graph.tiles_[neighbourTile].polyRegions_;
+                if (neighbourTile == tileIndex || neighbourPoly >= neighbourRegions.Size() ||
+                    neighbourRegions[neighbourPoly] == NO_REGION)
+                    continue;
+
+                unsigned short neighbourRegion = neighbourRegions[neighbourPoly];
+                Vector3 edgeStart(&tile->verts[poly.verts[link.edge] * 3]);
+                Vector3 edgeEnd(&tile->verts[poly.verts[(link.edge + 1) % poly.vertCount] * 3]);
+                Vector3 edgeMid = edgeStart.Lerp(edgeEnd, (link.bmin + link.bmax) * 0.5f / 255.0f);
+
+                unsigned index = 0;
+                for (; index < graphTile.portals_.Size(); ++index)
+                {
+                    const NavigationTilePortal& portal = graphTile.portals_[index];
+                    if (portal.region_ == region && portal.neighbourTile_ == neighbourTile && portal.neighbourRegion_ ==
+                        neighbourRegion)
+                        break;
+                }
+
+                if (!pass)
+                {
+                    if (index == graphTile.portals_.Size())
+                    {
+                        NavigationTilePortal portal;
+                        portal.region_ = region;
+                        portal.neighbourRegion_ = neighbourRegion;
+                        portal.neighbourTile_ = neighbourTile;
+                        graphTile.portals_.Push(portal);
+                        averages.Push(Vector3::ZERO);
+                        edgeCounts.Push(0);
+                    }
+                    averages[index] += edgeMid;
+                    ++edgeCounts[index];
+                }
+                else
+                {
+                    float distance = (edgeMid - averages[index]).LengthSquared();
+                    if (distance < closestDistances[index])
+                    {
+                        closestDistances[index] = distance;
+                        graphTile.portals_[index].position_ = edgeMid;
+                    }
+                }
+            }
+        }
+
+        if (!pass)
+        {
+            closestDistances.Resize(graphTile.portals_.Size());
+            for (unsigned i = 0; i < graphTile.portals_.Size(); ++i)
+            {
+                averages[i] /= (float)edgeCounts[i];
+                closestDistances[i] = M_INFINITY;
+            }
+        }
+    }
+}
+
+/// Builds the data of a range of navigation mesh tiles. Used with WorkQueue::ParallelFor().
+struct NavigationTileBuilder
+{
+    /// Construct.
+    NavigationTileBuilder(NavigationMesh& navMesh, Vector<NavigationGeometryInfo>& geometryList) :
+        navMesh_(navMesh),
+        geometryList_(geometryList)
+    {
+    }
+
+    /// Build a range of tiles.
+    void operator () (NavigationTileTask* start, NavigationTileTask* end, unsigned threadIndex)
+    {
+        for (NavigationTileTask* task = start; task < end; ++task)
+            task->success_ = navMesh_.BuildTileData(geometryList_, task->x_, task->z_, task->navData_, task->navDataSize_);
+    }
+
+    /// Navigation mesh.
+    NavigationMesh& navMesh_;
+    /// Geometries to build from.
+    Vector<NavigationGeometryInfo>& geometryList_;
+};
+
+/// Build the Detour data of one tile from captured settings and geometry. Does not access the navigation mesh component, so it is safe to call from worker threads.
+static bool BuildTileNavData(const NavigationTileSettings& settings, SimpleNavBuildData& build, unsigned char*& navData,
+    int& navDataSize)
+{
+    const rcConfig& cfg = settings.cfg_;
+
+    if (build.vertices_.Empty() || build.indices_.Empty())
+        return true; // Nothing to do
+
+    build.heightField_ = rcAllocHeightfield();
+    if (!build.heightField_)
+    {
+        LOGERROR("Could not allocate heightfield");
+        return false;
+    }
+
+    if (!rcCreateHeightfield(build.ctx_, *build.heightField_, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs,
+        cfg.ch))
+    {
+        LOGERROR("Could not create heightfield");
+        return false;
+    }
+
+    unsigned numTriangles = build.indices_.Size() / 3;
+    SharedArrayPtr<unsigned char> triAreas(new unsigned char[numTriangles]);
+    memset(triAreas.Get(), 0, numTriangles);
+
+    rcMarkWalkableTriangles(build.ctx_, cfg.walkableSlopeAngle, &build.vertices_[0].x_, build.vertices_.Size(),
+        &build.indices_[0], numTriangles, triAreas.Get());
+    rcRasterizeTriangles(build.ctx_, &build.vertices_[0].x_, build.vertices_.Size(), &build.indices_[0],
+        triAreas.Get(), numTriangles, *build.heightField_, cfg.walkableClimb);
+    rcFilterLowHangingWalkableObstacles(build.ctx_, cfg.walkableClimb, *build.heightField_);
+
+    rcFilterWalkableLowHeightSpans(build.ctx_, cfg.walkableHeight, *build.heightField_);
+    rcFilterLedgeSpans(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_);
+
+    build.compactHeightField_ = rcAllocCompactHeightfield();
+    if (!build.compactHeightField_)
+    {
+        LOGERROR("Could not allocate create compact heightfield");
+        return false;
+    }
+    if (!rcBuildCompactHeightfield(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_,
+        *build.compactHeightField_))
+    {
+        LOGERROR("Could not build compact heightfield");
+        return false;
+    }
+    if (!rcErodeWalkableArea(build.ctx_, cfg.walkableRadius, *build.compactHeightField_))
+    {
+        LOGERROR("Could not erode compact heightfield");
+        return false;
+    }
+
+    // Mark area volumes
+    for (unsigned i = 0; i < build.navAreas_.Size(); ++i)
+        rcMarkBoxArea(build.ctx_, &build.navAreas_[i].bounds_.min_.x_, &build.navAreas_[i].bounds_.max_.x_, build.navAreas_[i].areaID_, *build.compactHeightField_);
+
+    if (settings.partitionType_ == NAVMESH_PARTITION_WATERSHED)
+    {
+        if (!rcBuildDistanceField(build.ctx_, *build.compactHeightField_))
+        {
+            LOGERROR("Could not build distance field");
+            return false;
+        }
+        if (!rcBuildRegions(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea,
+            cfg.mergeRegionArea))
+        {
+            LOGERROR("Could not build regions");
+            return false;
+        }
+    }
+    else
+    {
+        if (!rcBuildRegionsMonotone(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+        {
+            LOGERROR("Could not build monotone regions");
+            return false;
+        }
+    }
+
+    build.contourSet_ = rcAllocContourSet();
+    if (!build.contourSet_)
+    {
+        LOGERROR("Could not allocate contour set");
+        return false;
+    }
+    if (!rcBuildContours(build.ctx_, *build.compactHeightField_, cfg.maxSimplificationError, cfg.maxEdgeLen,
+        *build.contourSet_))
+    {
+        LOGERROR("Could not create contours");
+        return false;
+    }
+
+    build.polyMesh_ = rcAllocPolyMesh();
+    if (!build.polyMesh_)
+    {
+        LOGERROR("Could not allocate poly mesh");
+        return false;
+    }
+    if (!rcBuildPolyMesh(build.ctx_, *build.contourSet_, cfg.maxVertsPerPoly, *build.polyMesh_))
+    {
+        LOGERROR("Could not triangulate contours");
+        return false;
+    }
+
+    build.polyMeshDetail_ = rcAllocPolyMeshDetail();
+    if (!build.polyMeshDetail_)
+    {
+        LOGERROR("Could not allocate detail mesh");
+        return false;
+    }
+    if (!rcBuildPolyMeshDetail(build.ctx_, *build.polyMesh_, *build.compactHeightField_, cfg.detailSampleDist,
+        cfg.detailSampleMaxError, *build.polyMeshDetail_))
+    {
+        LOGERROR("Could not build detail mesh");
+        return false;
+    }
+
+    // Set polygon flags
+    /// \todo Assignment of flags from navigation areas?
+    for (int i = 0; i < build.polyMesh_->npolys; ++i)
+    {
+        if (build.polyMesh_->areas[i] != RC_NULL_AREA)
+            build.polyMesh_->flags[i] = 0x1;
+    }
+
+    dtNavMeshCreateParams params;
+    memset(&params, 0, sizeof params);
+    params.verts = build.polyMesh_->verts;
+    params.vertCount = build.polyMesh_->nverts;
+    params.polys = build.polyMesh_->polys;
+    params.polyAreas = build.polyMesh_->areas;
+    params.polyFlags = build.polyMesh_->flags;
+    params.polyCount = build.polyMesh_->npolys;
+    params.nvp = build.polyMesh_->nvp;
+    params.detailMeshes = build.polyMeshDetail_->meshes;
+    params.detailVerts = build.polyMeshDetail_->verts;
+    params.detailVertsCount = build.polyMeshDetail_->nverts;
+    params.detailTris = build.polyMeshDetail_->tris;
+    params.detailTriCount = build.polyMeshDetail_->ntris;
+    params.walkableHeight = settings.agentHeight_;
+    params.walkableRadius = settings.agentRadius_;
+    params.walkableClimb = settings.agentMaxClimb_;
+    params.tileX = settings.x_;
+    params.tileY = settings.z_;
+    rcVcopy(params.bmin, build.polyMesh_->bmin);
+    rcVcopy(params.bmax, build.polyMesh_->bmax);
+    params.cs = cfg.cs;
+    params.ch = cfg.ch;
+    params.buildBvTree = true;
+
+    // Add off-mesh connections if have them
+    if (build.offMeshRadii_.Size())
+    {
+        params.offMeshConCount = build.offMeshRadii_.Size();
+        params.offMeshConVerts = &build.offMeshVertices_[0].x_;
+        params.offMeshConRad = &build.offMeshRadii_[0];
+        params.offMeshConFlags = &build.offMeshFlags_[0];
+        params.offMeshConAreas = &build.offMeshAreas_[0];
+        params.offMeshConDir = &build.offMeshDir_[0];
+    }
+
+    if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+    {
+        LOGERROR("Could not build navigation mesh tile data");
+        return false;
+    }
+
+    return true;
+}
+
+static void BuildTileAsyncWork(const WorkItem* item, unsigned threadIndex)
+{
+    NavigationAsyncTile* tile = reinterpret_cast<NavigationAsyncTile*>(item->aux_);
+    tile->success_ = BuildTileNavData(tile->settings_, tile->build_, tile->navData_, tile->navDataSize_);
+}
+
+NavigationMesh::NavigationMesh(Context* context) :
+    Component(context),
+    navMesh_(0),
+    navMeshQuery_(0),
+    queryFilter_(new dtQueryFilter()),
+    pathData_(new FindPathData()),
+    tileGraph_(0),
+    tileSize_(DEFAULT_TILE_SIZE),
+    cellSize_(DEFAULT_CELL_SIZE),
+    cellHeight_(DEFAULT_CELL_HEIGHT),
+    agentHeight_(DEFAULT_AGENT_HEIGHT),
+    agentRadius_(DEFAULT_AGENT_RADIUS),
+    agentMaxClimb_(DEFAULT_AGENT_MAX_CLIMB),
+    agentMaxSlope_(DEFAULT_AGENT_MAX_SLOPE),
+    regionMinSize_(DEFAULT_REGION_MIN_SIZE),
+    regionMergeSize_(DEFAULT_REGION_MERGE_SIZE),
+    edgeMaxLength_(DEFAULT_EDGE_MAX_LENGTH),
+    edgeMaxError_(DEFAULT_EDGE_MAX_ERROR),
+    detailSampleDistance_(DEFAULT_DETAIL_SAMPLE_DISTANCE),
+    detailSampleMaxError_(DEFAULT_DETAIL_SAMPLE_MAX_ERROR),
+    padding_(Vector3::ONE),
+    numTilesX_(0),
+    numTilesZ_(0),
+    partitionType_(NAVMESH_PARTITION_WATERSHED),
+    keepInterResults_(false),
+    asyncBatch_(0),
+    pathQueryBudget_(DEFAULT_PATH_QUERY_BUDGET),
+    hierarchicalPathfinding_(false),
+    nextPathRequestID_(1),
+    nextFlowFieldID_(1),
+    drawOffMeshConnections_(false),
+    drawNavAreas_(false),
+    debugTilesHash_(0)
+{
+}
+
+NavigationMesh::~NavigationMesh()
+{
+    ReleaseNavigationMesh();
+
+    for (unsigned i = 0; i < pathRequests_.Size(); ++i)
+        delete pathRequests_[i];
+    pathRequests_.Clear();
+
+    for (unsigned i = 0; i < flowFields_.Size(); ++i)
+        delete flowFields_[i];
+    flowFields_.Clear();
+
+    delete queryFilter_;
+    queryFilter_ = 0;
+
+    delete pathData_;
+    pathData_ = 0;
+}
+
+void NavigationMesh::RegisterObject(Context* context)
+{
+    context->RegisterFactory<NavigationMesh>(NAVIGATION_CATEGORY);
+
+    ACCESSOR_ATTRIBUTE("Tile Size", GetTileSize, SetTileSize, int, DEFAULT_TILE_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cell Height", GetCellHeight, SetCellHeight, float, DEFAULT_CELL_HEIGHT, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Agent Height", GetAgentHeight, SetAgentHeight, float, DEFAULT_AGENT_HEIGHT, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Agent Radius", GetAgentRadius, SetAgentRadius, float, DEFAULT_AGENT_RADIUS, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Agent Max Climb", GetAgentMaxClimb, SetAgentMaxClimb, float, DEFAULT_AGENT_MAX_CLIMB, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Agent Max Slope", GetAgentMaxSlope, SetAgentMaxSlope, float, DEFAULT_AGENT_MAX_SLOPE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Region Min Size", GetRegionMinSize, SetRegionMinSize, float, DEFAULT_REGION_MIN_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Region Merge Size", GetRegionMergeSize, SetRegionMergeSize, float, DEFAULT_REGION_MERGE_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Edge Max Length", GetEdgeMaxLength, SetEdgeMaxLength, float, DEFAULT_EDGE_MAX_LENGTH, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Edge Max Error", GetEdgeMaxError, SetEdgeMaxError, float, DEFAULT_EDGE_MAX_ERROR, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Detail Sample Distance", GetDetailSampleDistance, SetDetailSampleDistance, float, DEFAULT_DETAIL_SAMPLE_DISTANCE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Detail Sample Max Error", GetDetailSampleMaxError, SetDetailSampleMaxError, float, DEFAULT_DETAIL_SAMPLE_MAX_ERROR, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Bounding Box Padding", GetPadding, SetPadding, Vector3, Vector3::ONE, AM_DEFAULT);
+    MIXED_ACCESSOR_ATTRIBUTE("Navigation Data", GetNavigationDataAttr, SetNavigationDataAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_FILE | AM_NOEDIT);
+    ENUM_ACCESSOR_ATTRIBUTE("Partition Type", GetPartitionType, SetPartitionType, NavmeshPartitionType, navmeshPartitionTypeNames, NAVMESH_PARTITION_WATERSHED, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Draw OffMeshConnections", GetDrawOffMeshConnections, SetDrawOffMeshConnections, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Draw NavAreas", GetDrawNavAreas, SetDrawNavAreas, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Path Query Budget", GetPathQueryBudget, SetPathQueryBudget, int, DEFAULT_PATH_QUERY_BUDGET, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Hierarchical Pathfinding", GetHierarchicalPathfinding, SetHierarchicalPathfinding, bool, false, AM_DEFAULT);
+}
+
+void NavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+{
+    if (!debug || !navMesh_ || !node_)
+        return;
+
+    const dtNavMesh* navMesh = navMesh_;
+
+    PODVector<const dtMeshTile*> tiles;
+    for (int z = 0; z < numTilesZ_; ++z)
+    {
+        for (int x = 0; x < numTilesX_; ++x)
+        {
+            for (int i = 0; i < 128; ++i)
+            {
+                const dtMeshTile* tile = navMesh->getTileAt(x, z, i);
+                if (tile)
+                    tiles.Push(tile);
+            }
+        }
+    }
+
+    DrawDebugTiles(debug, depthTest, tiles);
+
+    Scene* scene = GetScene();
+    if (scene)
+    {
+        // Draw OffMeshConnection components
+        if (drawOffMeshConnections_)
+        {
+            PODVector<Node*> connections;
+            scene->GetChildrenWithComponent<OffMeshConnection>(connections, true);
+            for (unsigned i = 0; i < connections.Size(); ++i)
+            {
+                OffMeshConnection* connection = connections[i]->GetComponent<OffMeshConnection>();
+                if (connection && connection->IsEnabledEffective())
+                    connection->DrawDebugGeometry(debug, depthTest);
+            }
+        }
+
+        // Draw NavArea components
+        if (drawNavAreas_)
+        {
+            PODVector<Node*> areas;
+            scene->GetChildrenWithComponent<NavArea>(areas, true);
+            for (unsigned i = 0; i < areas.Size(); ++i)
+            {
+                NavArea* area = areas[i]->GetComponent<NavArea>();
+                if (area && area->IsEnabledEffective())
+                    area->DrawDebugGeometry(debug, depthTest);
+            }
+        }
+    }
+}
+
+void NavigationMesh::DrawDebugTiles(DebugRenderer* debug, bool depthTest, const PODVector<const dtMeshTile*>& tiles)
+{
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    bool record = !debug->IsRecordingPersistentGeometry();
+    StringHash key(GetTypeName() + String(GetID()));
+
+    if (record)
+    {
+        // The reference of a tile changes whenever it is rebuilt, so the hash of the references tells whether the tiles changed
+        unsigned hash = depthTest ? 1 : 2;
+        for (unsigned i = 0; i < tiles.Size(); ++i)
+            hash = hash * 31 + (unsigned)navMesh_->getTileRef(tiles[i]);
+        if (hash == debugTilesHash_ && debug->DrawPersistentGeometry(key, worldTransform))
+            return;
+
+        debugTilesHash_ = hash;
+        debug->BeginPersistentGeometry(key);
+    }
+
+    // The persistent geometry is recorded in local space, so that moving the navigation mesh node does not require recording again
+    const Matrix3x4& transform = record ? Matrix3x4::IDENTITY : worldTransform;
+    for (unsigned i = 0; i < tiles.Size(); ++i)
+    {
+        const dtMeshTile* tile = tiles[i];
+        for (int j = 0; j < tile->header->polyCount; ++j)
+        {
+            dtPoly* poly = tile->polys + j;
+            for (unsigned k = 0; k < poly->vertCount; ++k)
+            {
+                debug->AddLine(
+                    transform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[k] * 3]),
+                    transform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[(k + 1) % poly->vertCount] * 3]),
+                    Color::YELLOW,
+                    depthTest
+                    );
+            }
+        }
+    }
+
+    if (record)
+        debug->EndPersistentGeometry(worldTransform);
+}
+
+void NavigationMesh::SetMeshName(const String& newName)
+{
+    meshName_ = newName;
+}
+
+void NavigationMesh::SetTileSize(int size)
+{
+    tileSize_ = Max(size, 16);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetCellSize(float size)
+{
+    cellSize_ = Max(size, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetCellHeight(float height)
+{
+    cellHeight_ = Max(height, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentHeight(float height)
+{
+    agentHeight_ = Max(height, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentRadius(float radius)
+{
+    agentRadius_ = Max(radius, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentMaxClimb(float maxClimb)
+{
+    agentMaxClimb_ = Max(maxClimb, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentMaxSlope(float maxSlope)
+{
+    agentMaxSlope_ = Max(maxSlope, 0.0f);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetRegionMinSize(float size)
+{
+    regionMinSize_ = Max(size, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetRegionMergeSize(float size)
+{
+    regionMergeSize_ = Max(size, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetEdgeMaxLength(float length)
+{
+    edgeMaxLength_ = Max(length, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetEdgeMaxError(float error)
+{
+    edgeMaxError_ = Max(error, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetDetailSampleDistance(float distance)
+{
+    detailSampleDistance_ = Max(distance, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetDetailSampleMaxError(float error)
+{
+    detailSampleMaxError_ = Max(error, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetPathQueryBudget(int ms)
+{
+    pathQueryBudget_ = Max(ms, 1);
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetHierarchicalPathfinding(bool enable)
+{
+    hierarchicalPathfinding_ = enable;
+    if (!enable)
+    {
+        delete tileGraph_;
+        tileGraph_ = 0;
+    }
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetPadding(const Vector3& padding)
+{
+    padding_ = padding;
+
+    MarkNetworkUpdate();
+}
+
+bool NavigationMesh::Build()
+{
+    PROFILE(BuildNavigationMesh);
+    MEMORY_TAG(MEMTAG_NAVIGATION);
+
+    // Release existing navigation data and zero the bounding box
+    ReleaseNavigationMesh();
+
+    if (!node_)
+        return false;
+
+    if (!node_->GetWorldScale().Equals(Vector3::ONE))
+        LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
+
+    Vector<NavigationGeometryInfo> geometryList;
+    CollectGeometries(geometryList);
+
+    if (geometryList.Empty())
+        return true; // Nothing to do
+
+    // Build the combined bounding box
+    for (unsigned i = 0; i < geometryList.Size(); ++i)
+        boundingBox_.Merge(geometryList[i].boundingBox_);
+
+    // Expand bounding box by padding
+    boundingBox_.min_ -= padding_;
+    boundingBox_.max_ += padding_;
+
+    {
+        PROFILE(BuildNavigationMesh);
 
         // Calculate number of tiles
         int gridW = 0, gridH = 0;
@@ -404,19 +1498,13 @@ bool NavigationMesh::Build()
         }
 
         // Build each tile
-        unsigned numTiles = 0;
-
-        for (int z = 0; z < numTilesZ_; ++z)
-        {
-            for (int x = 0; x < numTilesX_; ++x)
-            {
-                if (BuildTile(geometryList, x, z))
-                    ++numTiles;
-            }
-        }
+        unsigned numTiles = BuildTiles(geometryList, IntVector2::ZERO, IntVector2(numTilesX_ - 1, numTilesZ_ - 1));
 
         LOGDEBUG("Built navigation mesh with " + String(numTiles) + " tiles");
 
+        if (hierarchicalPathfinding_)
+            UpdateTileGraph();
+
         // Send a notification event to concerned parties that we've been fully rebuilt
         {
             using namespace NavigationMeshRebuilt;
@@ -433,6 +1521,7 @@ bool NavigationMesh::Build()
 bool NavigationMesh::Build(const BoundingBox& boundingBox)
 {
     PROFILE(BuildPartialNavigationMesh);
+    MEMORY_TAG(MEMTAG_NAVIGATION);
 
     if (!node_)
         return false;
@@ -446,30 +1535,80 @@ bool NavigationMesh::Build(const BoundingBox& boundingBox)
     if (!node_->GetWorldScale().Equals(Vector3::ONE))
         LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
 
-    BoundingBox localSpaceBox = boundingBox.Transformed(node_->GetWorldTransform().Inverse());
+    Vector<NavigationGeometryInfo> geometryList;
+    CollectGeometries(geometryList);
 
-    float tileEdgeLength = (float)tileSize_ * cellSize_;
+    IntVector2 from, to;
+    GetTileRange(boundingBox, from, to);
+
+    unsigned numTiles = BuildTiles(geometryList, from, to);
+
+    LOGDEBUG("Rebuilt " + String(numTiles) + " tiles of the navigation mesh");
+    return true;
+}
+
+bool NavigationMesh::BuildAsync(const BoundingBox& boundingBox)
+{
+    PROFILE(BuildNavigationMeshAsync);
+    MEMORY_TAG(MEMTAG_NAVIGATION);
+
+    if (!node_)
+        return false;
+
+    if (!navMesh_)
+    {
+        LOGERROR("Navigation mesh must first be built fully before it can be rebuilt in the background");
+        return false;
+    }
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue)
+    {
+        // Without the work queue there is nothing to run the build on, so rebuild immediately
+        bool success = Build(boundingBox);
+        if (success)
+            SendAsyncBuildFinished(boundingBox);
+        return success;
+    }
+
+    if (!node_->GetWorldScale().Equals(Vector3::ONE))
+        LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
 
     Vector<NavigationGeometryInfo> geometryList;
     CollectGeometries(geometryList);
 
-    int sx = Clamp((int)((localSpaceBox.min_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
-    int sz = Clamp((int)((localSpaceBox.min_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
-    int ex = Clamp((int)((localSpaceBox.max_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
-    int ez = Clamp((int)((localSpaceBox.max_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
+    IntVector2 from, to;
+    GetTileRange(boundingBox, from, to);
 
-    unsigned numTiles = 0;
+    // Gather the tile geometry in the main thread, as it reads components and GPU-side geometry data. The worker
+    // threads only run the Recast and Detour build steps, and the results are swapped in when the whole request is done
+    if (asyncTiles_.Empty())
+        SubscribeToEvent(queue, E_WORKITEMCOMPLETED, HANDLER(NavigationMesh, HandleWorkItemCompleted));
 
-    for (int z = sz; z <= ez; ++z)
+    ++asyncBatch_;
+    for (int z = from.y_; z <= to.y_; ++z)
     {
-        for (int x = sx; x <= ex; ++x)
+        for (int x = from.x_; x <= to.x_; ++x)
         {
-            if (BuildTile(geometryList, x, z))
-                ++numTiles;
+            NavigationAsyncTile* tile = new NavigationAsyncTile();
+            GetTileSettings(x, z, tile->settings_);
+            BoundingBox expandedBox(*reinterpret_cast<const Vector3*>(tile->settings_.cfg_.bmin),
+                *reinterpret_cast<const Vector3*>(tile->settings_.cfg_.bmax));
+            GetTileGeometry(&tile->build_, geometryList, expandedBox);
+            tile->batch_ = asyncBatch_;
+            tile->boundingBox_ = boundingBox;
+
+            tile->item_ = new WorkItem();
+            tile->item_->workFunction_ = BuildTileAsyncWork;
+            tile->item_->aux_ = tile;
+            tile->item_->priority_ = 0;
+            tile->item_->sendEvent_ = true;
+            asyncTiles_.Push(tile);
+            queue->AddWorkItem(tile->item_);
         }
     }
 
-    LOGDEBUG("Rebuilt " + String(numTiles) + " tiles of the navigation mesh");
+    LOGDEBUG("Queued " + String((to.x_ - from.x_ + 1) * (to.y_ - from.y_ + 1)) + " tiles of the navigation mesh for rebuild");
     return true;
 }
 
@@ -541,6 +1680,14 @@ void NavigationMesh::FindPath(PODVector<Vector3>& dest, const Vector3& start, co
     if (!startRef || !endRef)
         return;
 
+    // Long paths are searched through the hierarchical graph, refining only the part near the start
+    if (hierarchicalPathfinding_ && FindHierarchicalPath(dest, localStart, localEnd, startRef, endRef, extents))
+    {
+        for (unsigned i = 0; i < dest.Size(); ++i)
+            dest[i] = transform * dest[i];
+        return;
+    }
+
     int numPolys = 0;
     int numPathPoints = 0;
 
@@ -647,6 +1794,193 @@ Vector3 NavigationMesh::Raycast(const Vector3& start, const Vector3& end, const
     return start.Lerp(end, t);
 }
 
+unsigned NavigationMesh::RequestPath(const Vector3& start, const Vector3& end, const Vector3& extents)
+{
+    Scene* scene = GetScene();
+    if (!scene)
+    {
+        LOGERROR("Navigation mesh must be in a scene to queue path requests");
+        return 0;
+    }
+
+    // Navigation data is in local space. Transform path points from world to local
+    Matrix3x4 inverse = node_->GetWorldTransform().Inverse();
+    Vector3 localStart = inverse * start;
+    Vector3 localEnd = inverse * end;
+
+    unsigned id = nextPathRequestID_++;
+    if (!nextPathRequestID_)
+        nextPathRequestID_ = 1;
+
+    // Join an identical request which has not finished yet, either queued or being searched
+    NavigationPathRequest* request = 0;
+    for (unsigned i = 0; i < pathRequests_.Size() && !request; ++i)
+    {
+        NavigationPathRequest* queued = pathRequests_[i];
+        if (queued->start_ == localStart && queued->end_ == localEnd && queued->extents_ == extents)
+            request = queued;
+    }
+    for (unsigned i = 0; i < pathQueries_.Size() && !request; ++i)
+    {
+        NavigationPathRequest* active = pathQueries_[i]->request_;
+        if (active && active->start_ == localStart && active->end_ == localEnd && active->extents_ == extents)
+            request = active;
+    }
+
+    if (!request)
+    {
+        request = new NavigationPathRequest(localStart, localEnd, extents);
+        pathRequests_.Push(request);
+    }
+
+    request->ids_.Push(id);
+    pathRequestIDs_[id] = request;
+
+    if (!HasSubscribedToEvent(scene, E_SCENEPOSTUPDATE))
+        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(NavigationMesh, HandleScenePostUpdate));
+
+    return id;
+}
+
+bool NavigationMesh::GetPathResult(unsigned requestID, PODVector<Vector3>& dest)
+{
+    dest.Clear();
+
+    HashMap<unsigned, PODVector<Vector3> >::Iterator i = pathResults_.Find(requestID);
+    if (i == pathResults_.End())
+        return false;
+
+    dest = i->second_;
+    pathResults_.Erase(i);
+    return true;
+}
+
+void NavigationMesh::CancelPathRequest(unsigned requestID)
+{
+    pathResults_.Erase(requestID);
+
+    HashMap<unsigned, NavigationPathRequest*>::Iterator i = pathRequestIDs_.Find(requestID);
+    if (i == pathRequestIDs_.End())
+        return;
+
+    NavigationPathRequest* request = i->second_;
+    pathRequestIDs_.Erase(i);
+    request->ids_.Remove(requestID);
+
+    // A request being searched is discarded when it finishes
+    if (request->ids_.Empty() && pathRequests_.Remove(request))
+        delete request;
+}
+
+unsigned NavigationMesh::RequestFlowField(const Vector3& goal, const Vector3& extents)
+{
+    Scene* scene = GetScene();
+    if (!scene)
+    {
+        LOGERROR("Navigation mesh must be in a scene to request flow fields");
+        return 0;
+    }
+
+    // Navigation data is in local space. Transform the goal from world to local
+    Vector3 localGoal = node_->GetWorldTransform().Inverse() * goal;
+
+    unsigned id = nextFlowFieldID_++;
+    if (!nextFlowFieldID_)
+        nextFlowFieldID_ = 1;
+
+    NavigationFlowField* field = 0;
+    for (unsigned i = 0; i < flowFields_.Size() && !field; ++i)
+    {
+        if (flowFields_[i]->goal_ == localGoal && flowFields_[i]->extents_ == extents)
+            field = flowFields_[i];
+    }
+
+    if (!field)
+    {
+        field = new NavigationFlowField(localGoal, extents);
+        flowFields_.Push(field);
+    }
+
+    field->ids_.Push(id);
+    flowFieldIDs_[id] = field;
+
+    if (!HasSubscribedToEvent(scene, E_SCENEPOSTUPDATE))
+        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(NavigationMesh, HandleScenePostUpdate));
+
+    return id;
+}
+
+void NavigationMesh::ReleaseFlowField(unsigned flowFieldID)
+{
+    HashMap<unsigned, NavigationFlowField*>::Iterator i = flowFieldIDs_.Find(flowFieldID);
+    if (i == flowFieldIDs_.End())
+        return;
+
+    NavigationFlowField* field = i->second_;
+    flowFieldIDs_.Erase(i);
+    field->ids_.Remove(flowFieldID);
+
+    if (field->ids_.Empty())
+    {
+        flowFields_.Remove(field);
+        delete field;
+    }
+}
+
+bool NavigationMesh::IsFlowFieldReady(unsigned flowFieldID) const
+{
+    return GetReadyFlowField(flowFieldID) != 0;
+}
+
+Vector3 NavigationMesh::GetFlowDirection(unsigned flowFieldID, const Vector3& point, const Vector3& extents)
+{
+    NavigationFlowField* field = GetReadyFlowField(flowFieldID);
+    if (!field || !InitializeQuery())
+        return Vector3::ZERO;
+
+    const Matrix3x4& transform = node_->GetWorldTransform();
+    Vector3 localPoint = transform.Inverse() * point;
+    Vector3 nearestPoint;
+
+    dtPolyRef pointRef;
+    navMeshQuery_->findNearestPoly(&localPoint.x_, &extents.x_, queryFilter_, &pointRef, &nearestPoint.x_);
+    const NavigationFlowPoly* poly = pointRef ? GetFlowPoly(navMesh_, *field, pointRef) : 0;
+    if (!poly)
+        return Vector3::ZERO;
+
+    // Head for the closest point of the portal towards the goal. When already on the portal, head for the next one
+    Vector3 target = ClosestPointOnSegment(nearestPoint, poly->portalStart_, poly->portalEnd_);
+    if ((target - nearestPoint).LengthSquared() < M_EPSILON && poly->next_ != M_MAX_UNSIGNED)
+    {
+        const NavigationFlowPoly& next = field->polys_[poly->next_];
+        target = ClosestPointOnSegment(nearestPoint, next.portalStart_, next.portalEnd_);
+    }
+
+    Vector3 direction = transform * target - transform * nearestPoint;
+    return direction.LengthSquared() < M_EPSILON ? Vector3::ZERO : direction.Normalized();
+}
+
+float NavigationMesh::GetFlowCost(unsigned flowFieldID, const Vector3& point, const Vector3& extents)
+{
+    NavigationFlowField* field = GetReadyFlowField(flowFieldID);
+    if (!field || !InitializeQuery())
+        return M_INFINITY;
+
+    Vector3 localPoint = node_->GetWorldTransform().Inverse() * point;
+    Vector3 nearestPoint;
+
+    dtPolyRef pointRef;
+    navMeshQuery_->findNearestPoly(&localPoint.x_, &extents.x_, queryFilter_, &pointRef, &nearestPoint.x_);
+    const NavigationFlowPoly* poly = pointRef ? GetFlowPoly(navMesh_, *field, pointRef) : 0;
+    if (!poly)
+        return M_INFINITY;
+
+    const dtMeshTile* tile = 0;
+    const dtPoly* pointPoly = 0;
+    navMesh_->getTileAndPolyByRefUnsafe(pointRef, &tile, &pointPoly);
+    return poly->cost_ + (poly->position_ - nearestPoint).Length() * queryFilter_->getAreaCost(pointPoly->getArea());
+}
+
 void NavigationMesh::DrawDebugGeometry(bool depthTest)
 {
     Scene* scene = GetScene();
@@ -662,6 +1996,8 @@ void NavigationMesh::SetAreaCost(unsigned areaID, float cost)
 {
     if (queryFilter_)
         queryFilter_->setAreaCost((int)areaID, cost);
+
+    InvalidateFlowFields();
 }
 
 BoundingBox NavigationMesh::GetWorldBoundingBox() const
@@ -805,6 +2141,8 @@ void NavigationMesh::CollectGeometries(Vector<NavigationGeometryInfo>& geometryL
         if (connection->IsEnabledEffective() && connection->GetEndPoint())
         {
             const Matrix3x4& transform = connection->GetNode()->GetWorldTransform();
+            // Update the end point transform now, as the tile geometry may be read in worker threads
+            connection->GetEndPoint()->GetWorldTransform();
 
             NavigationGeometryInfo info;
             info.component_ = connection;
@@ -886,7 +2224,13 @@ void NavigationMesh::CollectGeometries(Vector<NavigationGeometryInfo>& geometryL
             NavigationGeometryInfo info;
 
             if (drawable->GetType() == StaticModel::GetTypeStatic())
-                info.lodLevel_ = static_cast<StaticModel*>(drawable)->GetOcclusionLodLevel();
+            {
+                StaticModel* staticModel = static_cast<StaticModel*>(drawable);
+                info.lodLevel_ = staticModel->GetOcclusionLodLevel();
+                // The tile geometry is read during this frame, possibly in worker threads, so make sure the CPU-side data is available now
+                if (staticModel->GetModel())
+                    staticModel->GetModel()->RequestCPUData();
+            }
             else if (drawable->GetType() == TerrainPatch::GetTypeStatic())
                 info.lodLevel_ = 0;
             else
@@ -1080,12 +2424,83 @@ bool NavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int
 {
     PROFILE(BuildNavigationMeshTile);
 
+    unsigned char* navData = 0;
+    int navDataSize = 0;
+    if (!BuildTileData(geometryList, x, z, navData, navDataSize))
+    {
+        // Remove previous tile (if any)
+        AddTile(x, z, 0, 0);
+        return false;
+    }
+
+    return AddTile(x, z, navData, navDataSize);
+}
+
+unsigned NavigationMesh::BuildTiles(Vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
+{
+    PODVector<NavigationTileTask> tasks;
+    for (int z = from.y_; z <= to.y_; ++z)
+    {
+        for (int x = from.x_; x <= to.x_; ++x)
+            tasks.Push(NavigationTileTask(x, z));
+    }
+
+    // Build the tile data in parallel. The navigation mesh is not thread-safe, so add the tiles afterward in order
+    NavigationTileBuilder builder(*this, geometryList);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(tasks, 1, builder);
+    else
+        builder(tasks.Begin().ptr_, tasks.End().ptr_, 0);
+
+    unsigned numTiles = 0;
+    for (unsigned i = 0; i < tasks.Size(); ++i)
+    {
+        const NavigationTileTask& task = tasks[i];
+        if (!task.success_)
+            AddTile(task.x_, task.z_, 0, 0);
+        else if (AddTile(task.x_, task.z_, task.navData_, task.navDataSize_))
+            ++numTiles;
+    }
+
+    return numTiles;
+}
+
+bool NavigationMesh::AddTile(int x, int z, unsigned char* navData, int navDataSize)
+{
     // Remove previous tile (if any)
     navMesh_->removeTile(navMesh_->getTileRefAt(x, z, 0), 0, 0);
 
+    if (!navData)
+        return true;
+
+    if (dtStatusFailed(navMesh_->addTile(navData, navDataSize, DT_TILE_FREE_DATA, 0, 0)))
+    {
+        LOGERROR("Failed to add navigation mesh tile");
+        dtFree(navData);
+        return false;
+    }
+
+    // Send a notification of the rebuild of this tile to anyone interested
+    {
+        BoundingBox tileBoundingBox = GetTileBoundingBox(x, z);
+
+        using namespace NavigationAreaRebuilt;
+        VariantMap& eventData = GetContext()->GetEventDataMap();
+        eventData[P_NODE] = GetNode();
+        eventData[P_MESH] = this;
+        eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
+        eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
+        SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+    }
+    return true;
+}
+
+BoundingBox NavigationMesh::GetTileBoundingBox(int x, int z) const
+{
     float tileEdgeLength = (float)tileSize_ * cellSize_;
 
-    BoundingBox tileBoundingBox(Vector3(
+    return BoundingBox(Vector3(
         boundingBox_.min_.x_ + tileEdgeLength * (float)x,
         boundingBox_.min_.y_,
         boundingBox_.min_.z_ + tileEdgeLength * (float)z
@@ -1095,10 +2510,13 @@ bool NavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int
         boundingBox_.max_.y_,
         boundingBox_.min_.z_ + tileEdgeLength * (float)(z + 1)
     ));
+}
 
-    SimpleNavBuildData build;
+void NavigationMesh::GetTileSettings(int x, int z, NavigationTileSettings& settings) const
+{
+    BoundingBox tileBoundingBox = GetTileBoundingBox(x, z);
 
-    rcConfig cfg;
+    rcConfig& cfg = settings.cfg_;
     memset(&cfg, 0, sizeof cfg);
     cfg.cs = cellSize_;
     cfg.ch = cellHeight_;
@@ -1125,221 +2543,569 @@ bool NavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int
     cfg.bmax[0] += cfg.borderSize * cfg.cs;
     cfg.bmax[2] += cfg.borderSize * cfg.cs;
 
-    BoundingBox expandedBox(*reinterpret_cast<Vector3*>(cfg.bmin), *reinterpret_cast<Vector3*>(cfg.bmax));
-    GetTileGeometry(&build, geometryList, expandedBox);
+    settings.x_ = x;
+    settings.z_ = z;
+    settings.agentHeight_ = agentHeight_;
+    settings.agentRadius_ = agentRadius_;
+    settings.agentMaxClimb_ = agentMaxClimb_;
+    settings.partitionType_ = partitionType_;
+}
 
-    if (build.vertices_.Empty() || build.indices_.Empty())
-        return true; // Nothing to do
+void NavigationMesh::GetTileRange(const BoundingBox& boundingBox, IntVector2& from, IntVector2& to) const
+{
+    BoundingBox localSpaceBox = boundingBox.Transformed(node_->GetWorldTransform().Inverse());
 
-    build.heightField_ = rcAllocHeightfield();
-    if (!build.heightField_)
-    {
-        LOGERROR("Could not allocate heightfield");
-        return false;
-    }
+    float tileEdgeLength = (float)tileSize_ * cellSize_;
 
-    if (!rcCreateHeightfield(build.ctx_, *build.heightField_, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs,
-        cfg.ch))
-    {
-        LOGERROR("Could not create heightfield");
-        return false;
-    }
+    from.x_ = Clamp((int)((localSpaceBox.min_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
+    from.y_ = Clamp((int)((localSpaceBox.min_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
+    to.x_ = Clamp((int)((localSpaceBox.max_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
+    to.y_ = Clamp((int)((localSpaceBox.max_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
+}
 
-    unsigned numTriangles = build.indices_.Size() / 3;
-    SharedArrayPtr<unsigned char> triAreas(new unsigned char[numTriangles]);
-    memset(triAreas.Get(), 0, numTriangles);
+bool NavigationMesh::BuildTileData(Vector<NavigationGeometryInfo>& geometryList, int x, int z, unsigned char*& navData,
+    int& navDataSize)
+{
+    PROFILE(BuildNavigationMeshTileData);
 
-    rcMarkWalkableTriangles(build.ctx_, cfg.walkableSlopeAngle, &build.vertices_[0].x_, build.vertices_.Size(),
-        &build.indices_[0], numTriangles, triAreas.Get());
-    rcRasterizeTriangles(build.ctx_, &build.vertices_[0].x_, build.vertices_.Size(), &build.indices_[0],
-        triAreas.Get(), numTriangles, *build.heightField_, cfg.walkableClimb);
-    rcFilterLowHangingWalkableObstacles(build.ctx_, cfg.walkableClimb, *build.heightField_);
+    NavigationTileSettings settings;
+    GetTileSettings(x, z, settings);
 
-    rcFilterWalkableLowHeightSpans(build.ctx_, cfg.walkableHeight, *build.heightField_);
-    rcFilterLedgeSpans(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_);
+    SimpleNavBuildData build;
+    BoundingBox expandedBox(*reinterpret_cast<const Vector3*>(settings.cfg_.bmin), *reinterpret_cast<const Vector3*>(settings.cfg_.bmax));
+    GetTileGeometry(&build, geometryList, expandedBox);
 
-    build.compactHeightField_ = rcAllocCompactHeightfield();
-    if (!build.compactHeightField_)
+    return BuildTileNavData(settings, build, navData, navDataSize);
+}
+
+bool NavigationMesh::InitializeQuery()
+{
+    if (!navMesh_ || !node_)
+        return false;
+
+    if (navMeshQuery_)
+        return true;
+
+    navMeshQuery_ = dtAllocNavMeshQuery();
+    if (!navMeshQuery_)
     {
-        LOGERROR("Could not allocate create compact heightfield");
+        LOGERROR("Could not create navigation mesh query");
         return false;
     }
-    if (!rcBuildCompactHeightfield(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_,
-        *build.compactHeightField_))
+
+    if (dtStatusFailed(navMeshQuery_->init(navMesh_, MAX_POLYS)))
     {
-        LOGERROR("Could not build compact heightfield");
+        LOGERROR("Could not init navigation mesh query");
         return false;
     }
-    if (!rcErodeWalkableArea(build.ctx_, cfg.walkableRadius, *build.compactHeightField_))
+
+    return true;
+}
+
+void NavigationMesh::CancelAsyncBuild()
+{
+    if (asyncTiles_.Empty())
+        return;
+
+    // The worker threads may still refer to the tiles, so wait for those that already started
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    for (unsigned i = 0; i < asyncTiles_.Size(); ++i)
     {
-        LOGERROR("Could not erode compact heightfield");
-        return false;
+        NavigationAsyncTile* tile = asyncTiles_[i];
+        if (!queue->RemoveWorkItem(tile->item_))
+        {
+            while (!tile->item_->completed_)
+                Time::Sleep(0);
+        }
+        delete tile;
     }
 
-    // Mark area volumes
-    for (unsigned i = 0; i < build.navAreas_.Size(); ++i)
-        rcMarkBoxArea(build.ctx_, &build.navAreas_[i].bounds_.min_.x_, &build.navAreas_[i].bounds_.max_.x_, build.navAreas_[i].areaID_, *build.compactHeightField_);
+    asyncTiles_.Clear();
+    UnsubscribeFromEvent(queue, E_WORKITEMCOMPLETED);
+}
+
+void NavigationMesh::SendAsyncBuildFinished(const BoundingBox& boundingBox)
+{
+    using namespace NavigationAsyncBuildFinished;
+
+    VariantMap& eventData = GetContext()->GetEventDataMap();
+    eventData[P_NODE] = GetNode();
+    eventData[P_MESH] = this;
+    eventData[P_BOUNDSMIN] = Variant(boundingBox.min_);
+    eventData[P_BOUNDSMAX] = Variant(boundingBox.max_);
+    SendEvent(E_NAVIGATION_ASYNC_BUILD_FINISHED, eventData);
+}
 
-    if (this->partitionType_ == NAVMESH_PARTITION_WATERSHED)
+void NavigationMesh::HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData)
+{
+    // Swap in the requests whose tiles are all done, in submission order so that a later request for the same tiles wins
+    while (!asyncTiles_.Empty())
     {
-        if (!rcBuildDistanceField(build.ctx_, *build.compactHeightField_))
+        unsigned batch = asyncTiles_[0]->batch_;
+        unsigned numBatchTiles = 0;
+        while (numBatchTiles < asyncTiles_.Size() && asyncTiles_[numBatchTiles]->batch_ == batch)
         {
-            LOGERROR("Could not build distance field");
-            return false;
+            if (!asyncTiles_[numBatchTiles]->item_->completed_)
+                return;
+            ++numBatchTiles;
         }
-        if (!rcBuildRegions(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea,
-            cfg.mergeRegionArea))
+
+        // Detach the tiles first, as the rebuild events may cause the navigation mesh to be rebuilt again
+        PODVector<NavigationAsyncTile*> tiles(asyncTiles_.Begin().ptr_, numBatchTiles);
+        asyncTiles_.Erase(0, numBatchTiles);
+        if (asyncTiles_.Empty())
+            UnsubscribeFromEvent(GetSubsystem<WorkQueue>(), E_WORKITEMCOMPLETED);
+
+        BoundingBox boundingBox = tiles[0]->boundingBox_;
+        unsigned numTiles = 0;
+        for (unsigned i = 0; i < tiles.Size(); ++i)
         {
-            LOGERROR("Could not build regions");
-            return false;
+            NavigationAsyncTile* tile = tiles[i];
+            if (!tile->success_)
+                AddTile(tile->settings_.x_, tile->settings_.z_, 0, 0);
+            else
+            {
+                // The navigation mesh takes ownership of the data
+                unsigned char* navData = tile->navData_;
+                tile->navData_ = 0;
+                if (AddTile(tile->settings_.x_, tile->settings_.z_, navData, tile->navDataSize_))
+                    ++numTiles;
+            }
+            delete tile;
         }
+
+        LOGDEBUG("Rebuilt " + String(numTiles) + " tiles of the navigation mesh in the background");
+        SendAsyncBuildFinished(boundingBox);
     }
-    else
+}
+
+bool NavigationMesh::InitializePathQueries()
+{
+    if (!navMesh_)
+        return false;
+
+    if (!pathQueries_.Empty())
+        return true;
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned numQueries = queue ? queue->GetNumThreads() + 1 : 1;
+
+    for (unsigned i = 0; i < numQueries; ++i)
     {
-        if (!rcBuildRegionsMonotone(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+        NavigationPathQuery* query = new NavigationPathQuery();
+        pathQueries_.Push(query);
+
+        query->query_ = dtAllocNavMeshQuery();
+        if (!query->query_)
         {
-            LOGERROR("Could not build monotone regions");
+            LOGERROR("Could not create navigation mesh query");
+            ReleasePathQueries();
             return false;
         }
-    }
 
-    build.contourSet_ = rcAllocContourSet();
-    if (!build.contourSet_)
-    {
-        LOGERROR("Could not allocate contour set");
-        return false;
+        if (dtStatusFailed(query->query_->init(navMesh_, MAX_POLYS)))
+        {
+            LOGERROR("Could not init navigation mesh query");
+            ReleasePathQueries();
+            return false;
+        }
     }
-    if (!rcBuildContours(build.ctx_, *build.compactHeightField_, cfg.maxSimplificationError, cfg.maxEdgeLen,
-        *build.contourSet_))
+
+    return true;
+}
+
+void NavigationMesh::ReleasePathQueries()
+{
+    // Requests being searched start over when the queries are recreated
+    unsigned numRequests = 0;
+    for (unsigned i = 0; i < pathQueries_.Size(); ++i)
     {
-        LOGERROR("Could not create contours");
-        return false;
+        if (pathQueries_[i]->request_)
+            pathRequests_.Insert(numRequests++, pathQueries_[i]->request_);
+        delete pathQueries_[i];
     }
 
-    build.polyMesh_ = rcAllocPolyMesh();
-    if (!build.polyMesh_)
+    pathQueries_.Clear();
+}
+
+void NavigationMesh::UpdatePathRequests()
+{
+    PROFILE(UpdatePathRequests);
+
+    if (!node_ || !InitializePathQueries())
+        return;
+
+    // Advance the searches in every thread within the time budget. The navigation mesh is not modified meanwhile
+    NavigationPathProcessor processor(pathRequests_, queryFilter_, (long long)pathQueryBudget_ * 1000);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(pathQueries_, 1, processor);
+    else
+        processor(pathQueries_.Begin().ptr_, pathQueries_.End().ptr_, 0);
+
+    pathRequests_.Erase(0, processor.nextRequest_);
+
+    // Store the results before sending the events, so that the event handlers can queue new requests
+    const Matrix3x4& transform = node_->GetWorldTransform();
+    PODVector<unsigned> finishedIDs;
+    PODVector<bool> finishedSuccess;
+    for (unsigned i = 0; i < pathQueries_.Size(); ++i)
     {
-        LOGERROR("Could not allocate poly mesh");
-        return false;
+        PODVector<NavigationPathRequest*>& finished = pathQueries_[i]->finished_;
+        for (unsigned j = 0; j < finished.Size(); ++j)
+        {
+            NavigationPathRequest* request = finished[j];
+
+            // Transform path result back to world space
+            PODVector<Vector3> path(request->path_.Size());
+            for (unsigned k = 0; k < path.Size(); ++k)
+                path[k] = transform * request->path_[k];
+
+            for (unsigned k = 0; k < request->ids_.Size(); ++k)
+            {
+                unsigned id = request->ids_[k];
+                pathRequestIDs_.Erase(id);
+                pathResults_[id] = path;
+                finishedIDs.Push(id);
+                finishedSuccess.Push(request->success_);
+            }
+
+            delete request;
+        }
+
+        finished.Clear();
     }
-    if (!rcBuildPolyMesh(build.ctx_, *build.contourSet_, cfg.maxVertsPerPoly, *build.polyMesh_))
+
+    if (finishedIDs.Size())
     {
-        LOGERROR("Could not triangulate contours");
-        return false;
+        WeakPtr<NavigationMesh> self(this);
+
+        using namespace NavigationPathReady;
+
+        for (unsigned i = 0; i < finishedIDs.Size() && self; ++i)
+        {
+            VariantMap& eventData = GetContext()->GetEventDataMap();
+            eventData[P_NODE] = GetNode();
+            eventData[P_MESH] = this;
+            eventData[P_REQUESTID] = finishedIDs[i];
+            eventData[P_SUCCESS] = finishedSuccess[i];
+            SendEvent(E_NAVIGATION_PATH_READY, eventData);
+        }
     }
+}
 
-    build.polyMeshDetail_ = rcAllocPolyMeshDetail();
-    if (!build.polyMeshDetail_)
+void NavigationMesh::UpdateFlowFields()
+{
+    PROFILE(UpdateFlowFields);
+
+    if (!node_ || !InitializeQuery())
+        return;
+
+    // Start searching the flow fields which are out of date. The previous results can be sampled meanwhile
+    unsigned version = GetNavMeshVersion(navMesh_);
+    PODVector<NavigationFlowField*> searching;
+    for (unsigned i = 0; i < flowFields_.Size(); ++i)
     {
-        LOGERROR("Could not allocate detail mesh");
-        return false;
+        NavigationFlowField* field = flowFields_[i];
+        if (field->version_ == version)
+            continue;
+
+        if (field->searchVersion_ != version)
+        {
+            field->searchVersion_ = version;
+            field->open_.Clear();
+
+            unsigned numTiles = (unsigned)navMesh_->getMaxTiles();
+            unsigned numPolys = 0;
+            field->searchTileStart_.Resize(numTiles + 1);
+            for (unsigned j = 0; j < numTiles; ++j)
+            {
+                field->searchTileStart_[j] = numPolys;
+                const dtMeshTile* tile = static_cast<const dtNavMesh*>(navMesh_)->getTile((int)j);
+                if (tile->header)
+                    numPolys += tile->header->polyCount;
+            }
+            field->searchTileStart_[numTiles] = numPolys;
+
+            field->searchPolys_.Resize(numPolys);
+            for (unsigned j = 0; j < numPolys; ++j)
+            {
+                field->searchPolys_[j].ref_ = 0;
+                field->searchPolys_[j].cost_ = M_INFINITY;
+            }
+
+            dtPolyRef goalRef;
+            Vector3 goal;
+            navMeshQuery_->findNearestPoly(&field->goal_.x_, &field->extents_.x_, queryFilter_, &goalRef, &goal.x_);
+            field->searchSuccess_ = goalRef != 0;
+            if (goalRef)
+            {
+                unsigned salt, tileIndex, polyIndex;
+                navMesh_->decodePolyId(goalRef, salt, tileIndex, polyIndex);
+                NavigationFlowNode node;
+                node.cost_ = 0.0f;
+                node.index_ = field->searchTileStart_[tileIndex] + polyIndex;
+                node.ref_ = goalRef;
+
+                NavigationFlowPoly& poly = field->searchPolys_[node.index_];
+                poly.ref_ = goalRef;
+                poly.cost_ = 0.0f;
+                poly.position_ = poly.portalStart_ = poly.portalEnd_ = goal;
+                poly.next_ = M_MAX_UNSIGNED;
+                PushSearchNode(field->open_, node);
+            }
+        }
+
+        searching.Push(field);
     }
-    if (!rcBuildPolyMeshDetail(build.ctx_, *build.polyMesh_, *build.compactHeightField_, cfg.detailSampleDist,
-        cfg.detailSampleMaxError, *build.polyMeshDetail_))
+
+    if (searching.Empty())
+        return;
+
+    // Advance the searches in every thread within the time budget. The navigation mesh is not modified meanwhile
+    NavigationFlowFieldProcessor processor(navMesh_, queryFilter_, (long long)pathQueryBudget_ * 1000);
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue)
+        queue->ParallelFor(searching, 1, processor);
+    else
+        processor(searching.Begin().ptr_, searching.End().ptr_, 0);
+
+    PODVector<unsigned> finishedIDs;
+    PODVector<bool> finishedSuccess;
+    for (unsigned i = 0; i < searching.Size(); ++i)
     {
-        LOGERROR("Could not build detail mesh");
-        return false;
+        NavigationFlowField* field = searching[i];
+        if (!field->open_.Empty())
+            continue;
+
+        field->tileStart_.Swap(field->searchTileStart_);
+        field->polys_.Swap(field->searchPolys_);
+        field->version_ = field->searchVersion_;
+        field->searchVersion_ = 0;
+        field->ready_ = true;
+        field->success_ = field->searchSuccess_;
+
+        for (unsigned j = 0; j < field->ids_.Size(); ++j)
+        {
+            finishedIDs.Push(field->ids_[j]);
+            finishedSuccess.Push(field->success_);
+        }
     }
 
-    // Set polygon flags
-    /// \todo Assignment of flags from navigation areas?
-    for (int i = 0; i < build.polyMesh_->npolys; ++i)
+    if (finishedIDs.Size())
     {
-        if (build.polyMesh_->areas[i] != RC_NULL_AREA)
-            build.polyMesh_->flags[i] = 0x1;
+        WeakPtr<NavigationMesh> self(this);
+
+        using namespace NavigationFlowFieldReady;
+
+        for (unsigned i = 0; i < finishedIDs.Size() && self; ++i)
+        {
+            VariantMap& eventData = GetContext()->GetEventDataMap();
+            eventData[P_NODE] = GetNode();
+            eventData[P_MESH] = this;
+            eventData[P_FLOWFIELDID] = finishedIDs[i];
+            eventData[P_SUCCESS] = finishedSuccess[i];
+            SendEvent(E_NAVIGATION_FLOW_FIELD_READY, eventData);
+        }
     }
+}
 
-    unsigned char* navData = 0;
-    int navDataSize = 0;
+void NavigationMesh::InvalidateFlowFields()
+{
+    for (unsigned i = 0; i < flowFields_.Size(); ++i)
+        flowFields_[i]->version_ = flowFields_[i]->searchVersion_ = 0;
+}
 
-    dtNavMeshCreateParams params;
-    memset(&params, 0, sizeof params);
-    params.verts = build.polyMesh_->verts;
-    params.vertCount = build.polyMesh_->nverts;
-    params.polys = build.polyMesh_->polys;
-    params.polyAreas = build.polyMesh_->areas;
-    params.polyFlags = build.polyMesh_->flags;
-    params.polyCount = build.polyMesh_->npolys;
-    params.nvp = build.polyMesh_->nvp;
-    params.detailMeshes = build.polyMeshDetail_->meshes;
-    params.detailVerts = build.polyMeshDetail_->verts;
-    params.detailVertsCount = build.polyMeshDetail_->nverts;
-    params.detailTris = build.polyMeshDetail_->tris;
-    params.detailTriCount = build.polyMeshDetail_->ntris;
-    params.walkableHeight = agentHeight_;
-    params.walkableRadius = agentRadius_;
-    params.walkableClimb = agentMaxClimb_;
-    params.tileX = x;
-    params.tileY = z;
-    rcVcopy(params.bmin, build.polyMesh_->bmin);
-    rcVcopy(params.bmax, build.polyMesh_->bmax);
-    params.cs = cfg.cs;
-    params.ch = cfg.ch;
-    params.buildBvTree = true;
+NavigationFlowField* NavigationMesh::GetReadyFlowField(unsigned flowFieldID) const
+{
+    HashMap<unsigned, NavigationFlowField*>::ConstIterator i = flowFieldIDs_.Find(flowFieldID);
+    return i != flowFieldIDs_.End() && i->second_->ready_ ? i->second_ : 0;
+}
 
-    // Add off-mesh connections if have them
-    if (build.offMeshRadii_.Size())
+void NavigationMesh::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+    WeakPtr<NavigationMesh> self(this);
+
+    if (HasPathRequests())
+        UpdatePathRequests();
+    if (self)
+        UpdateFlowFields();
+
+    // Flow fields need to be checked every frame for changes in the navigation mesh
+    if (self && !HasPathRequests() && flowFields_.Empty())
+        UnsubscribeFromEvent(GetScene(), E_SCENEPOSTUPDATE);
+}
+
+void NavigationMesh::UpdateTileGraph()
+{
+    if (!navMesh_)
+        return;
+
+    if (!tileGraph_)
+        tileGraph_ = new NavigationTileGraph();
+
+    NavigationTileGraph& graph = *tileGraph_;
+    const dtNavMesh* navMesh = navMesh_;
+    unsigned numTiles = (unsigned)navMesh->getMaxTiles();
+    if (graph.navMesh_ != navMesh || graph.tiles_.Size() != numTiles)
     {
-        params.offMeshConCount = build.offMeshRadii_.Size();
-        params.offMeshConVerts = &build.offMeshVertices_[0].x_;
-        params.offMeshConRad = &build.offMeshRadii_[0];
-        params.offMeshConFlags = &build.offMeshFlags_[0];
-        params.offMeshConAreas = &build.offMeshAreas_[0];
-        params.offMeshConDir = &build.offMeshDir_[0];
+        graph.navMesh_ = navMesh;
+        graph.tiles_.Clear();
+        graph.tiles_.Resize(numTiles);
     }
 
-    if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+    // Find the regions of the tiles added or removed since the last update
+    PODVector<IntVector2> changedCoords;
+    PODVector<unsigned> changedTiles;
+    for (unsigned i = 0; i < numTiles; ++i)
     {
-        LOGERROR("Could not build navigation mesh tile data");
-        return false;
+        const dtMeshTile* tile = navMesh->getTile((int)i);
+        NavigationGraphTile& graphTile = graph.tiles_[i];
+        if (graphTile.header_ == tile->header && graphTile.salt_ == tile->salt)
+            continue;
+
+        if (graphTile.header_)
+            changedCoords.Push(IntVector2(graphTile.header_->x, graphTile.header_->y));
+        if (tile->header)
+            changedCoords.Push(IntVector2(tile->header->x, tile->header->y));
+
+        graphTile.header_ = tile->header;
+        graphTile.salt_ = tile->salt;
+        BuildTileRegions(navMesh, tile, i, graphTile);
+        changedTiles.Push(i);
     }
 
-    if (dtStatusFailed(navMesh_->addTile(navData, navDataSize, DT_TILE_FREE_DATA, 0, 0)))
+    if (changedTiles.Empty())
+        return;
+
+    PROFILE(UpdateTileGraph);
+
+    // The portals of the changed tiles and all tiles next to them refer to the changed regions
+    HashSet<unsigned> portalTiles;
+    for (unsigned i = 0; i < changedTiles.Size(); ++i)
+        portalTiles.Insert(changedTiles[i]);
+
+    static const int MAX_LAYERS = 32;
+    const dtMeshTile* neighbours[MAX_LAYERS];
+    for (unsigned i = 0; i < changedCoords.Size(); ++i)
     {
-        LOGERROR("Failed to add navigation mesh tile");
-        dtFree(navData);
-        return false;
+        for (int z = changedCoords[i].y_ - 1; z <= changedCoords[i].y_ + 1; ++z)
+        {
+            for (int x = changedCoords[i].x_ - 1; x <= changedCoords[i].x_ + 1; ++x)
+            {
+                int numNeighbours = navMesh->getTilesAt(x, z, neighbours, MAX_LAYERS);
+                for (int j = 0; j < numNeighbours; ++j)
+                    portalTiles.Insert(navMesh->decodePolyIdTile(navMesh->getTileRef(neighbours[j])));
+            }
+        }
     }
 
-    // Send a notification of the rebuild of this tile to anyone interested
+    for (HashSet<unsigned>::ConstIterator i = portalTiles.Begin(); i != portalTiles.End(); ++i)
+        BuildTilePortals(navMesh, navMesh->getTile((int)*i), *i, graph);
+
+    // Number the portals for searching
+    graph.portalStart_.Resize(numTiles + 1);
+    graph.portals_.Clear();
+    for (unsigned i = 0; i < numTiles; ++i)
     {
-        using namespace NavigationAreaRebuilt;
-        VariantMap& eventData = GetContext()->GetEventDataMap();
-        eventData[P_NODE] = GetNode();
-        eventData[P_MESH] = this;
-        eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
-        eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
-        SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+        graph.portalStart_[i] = graph.portals_.Size();
+        const PODVector<NavigationTilePortal>& portals = graph.tiles_[i].portals_;
+        for (unsigned j = 0; j < portals.Size(); ++j)
+            graph.portals_.Push(&portals[j]);
     }
-    return true;
+    graph.portalStart_[numTiles] = graph.portals_.Size();
 }
 
-bool NavigationMesh::InitializeQuery()
+bool NavigationMesh::FindHierarchicalPath(PODVector<Vector3>& dest, const Vector3& start, const Vector3& end, unsigned startRef,
+    unsigned endRef, const Vector3& extents)
 {
-    if (!navMesh_ || !node_)
+    unsigned startTile = navMesh_->decodePolyIdTile(startRef);
+    unsigned endTile = navMesh_->decodePolyIdTile(endRef);
+    if (startTile == endTile)
         return false;
 
-    if (navMeshQuery_)
-        return true;
+    PROFILE(FindHierarchicalPath);
 
-    navMeshQuery_ = dtAllocNavMeshQuery();
-    if (!navMeshQuery_)
-    {
-        LOGERROR("Could not create navigation mesh query");
+    UpdateTileGraph();
+    const NavigationTileGraph& graph = *tileGraph_;
+    unsigned short startRegion = graph.tiles_[startTile].polyRegions_[navMesh_->decodePolyIdPoly(startRef)];
+    unsigned short endRegion = graph.tiles_[endTile].polyRegions_[navMesh_->decodePolyIdPoly(endRef)];
+    if (startRegion == NO_REGION || endRegion == NO_REGION)
         return false;
-    }
 
-    if (dtStatusFailed(navMeshQuery_->init(navMesh_, MAX_POLYS)))
-    {
-        LOGERROR("Could not init navigation mesh query");
+    // Off-mesh connections are not part of the graph, so leave unreachable ends to the regular search
+    NavigationGraphSearch search(graph, end, endTile, endRegion);
+    if (!search.Run(startTile, startRegion, start))
         return false;
-    }
 
+    PODVector<unsigned> route;
+    for (unsigned i = search.parents_[search.goal_]; i != M_MAX_UNSIGNED; i = search.parents_[i])
+        route.Insert(0, i);
+
+    // A short route is refined completely by the regular search
+    if (route.Size() <= HIERARCHICAL_REFINE_PORTALS)
+        return false;
+
+    Vector3 refineEnd = graph.portals_[route[HIERARCHICAL_REFINE_PORTALS - 1]]->position_;
+    dtPolyRef refineRef;
+    navMeshQuery_->findNearestPoly(&refineEnd.x_, &extents.x_, queryFilter_, &refineRef, 0);
+    if (!refineRef)
+        return false;
+
+    int numPolys = 0;
+    int numPathPoints = 0;
+    navMeshQuery_->findPath(startRef, refineRef, &start.x_, &refineEnd.x_, queryFilter_, pathData_->polys_, &numPolys, MAX_POLYS);
+    if (!numPolys || pathData_->polys_[numPolys - 1] != refineRef)
+        return false;
+
+    navMeshQuery_->findStraightPath(&start.x_, &refineEnd.x_, pathData_->polys_, numPolys, &pathData_->pathPoints_[0].x_,
+        pathData_->pathFlags_, pathData_->pathPolys_, &numPathPoints, MAX_POLYS);
+
+    dest.Clear();
+    for (int i = 0; i < numPathPoints; ++i)
+        dest.Push(pathData_->pathPoints_[i]);
+    for (unsigned i = HIERARCHICAL_REFINE_PORTALS; i < route.Size(); ++i)
+        dest.Push(graph.portals_[route[i]]->position_);
+
+    Vector3 actualEnd = end;
+    navMeshQuery_->closestPointOnPoly(endRef, &end.x_, &actualEnd.x_, 0);
+    dest.Push(actualEnd);
     return true;
 }
 
+bool NavigationMesh::HasPathRequests() const
+{
+    if (!pathRequests_.Empty())
+        return true;
+
+    for (unsigned i = 0; i < pathQueries_.Size(); ++i)
+    {
+        if (pathQueries_[i]->request_)
+            return true;
+    }
+
+    return false;
+}
+
 void NavigationMesh::ReleaseNavigationMesh()
 {
+    CancelAsyncBuild();
+    ReleasePathQueries();
+
+    // Polygon references of a new navigation mesh may coincide with the old ones, so the flow fields can not be sampled until recomputed
+    for (unsigned i = 0; i < flowFields_.Size(); ++i)
+    {
+        NavigationFlowField* field = flowFields_[i];
+        field->tileStart_.Clear();
+        field->polys_.Clear();
+        field->open_.Clear();
+        field->version_ = field->searchVersion_ = 0;
+        field->ready_ = false;
+    }
+
+    delete tileGraph_;
+    tileGraph_ = 0;
+
     dtFreeNavMesh(navMesh_);
     navMesh_ = 0;
 
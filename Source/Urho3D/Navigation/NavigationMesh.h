@@ -30,6 +30,7 @@
 
 class dtNavMesh;
 class dtNavMeshQuery;
+struct dtMeshTile;
 class dtQueryFilter;
 struct dtNavMeshCreateParams;
 class rcContext;
@@ -53,6 +54,12 @@ class Geometry;
 
 struct FindPathData;
 struct NavBuildData;
+struct NavigationAsyncTile;
+struct NavigationFlowField;
+struct NavigationPathQuery;
+struct NavigationPathRequest;
+struct NavigationTileGraph;
+struct NavigationTileSettings;
 
 /// Description of a navigation mesh geometry component, with transform and bounds information.
 struct NavigationGeometryInfo
@@ -72,6 +79,7 @@ class URHO3D_API NavigationMesh : public Component
 {
     OBJECT(NavigationMesh);
     friend class DetourCrowdManager;
+    friend struct NavigationTileBuilder;
 
 public:
     /// Construct.
@@ -114,16 +122,36 @@ public:
     void SetPadding(const Vector3& padding);
     /// Set the cost of an area.
     void SetAreaCost(unsigned areaID, float cost);
+    /// Set the time in milliseconds per frame spent on queued path requests in each thread.
+    void SetPathQueryBudget(int ms);
+    /// Set whether FindPath() searches long paths through a graph of the connected regions of each tile and only refines the part near the start.
+    void SetHierarchicalPathfinding(bool enable);
     /// Rebuild the navigation mesh. Return true if successful.
     virtual bool Build();
     /// Rebuild part of the navigation mesh contained by the world-space bounding box. Return true if successful.
     virtual bool Build(const BoundingBox& boundingBox);
+    /// Rebuild part of the navigation mesh contained by the world-space bounding box in worker threads. The geometry is collected immediately, and the rebuilt tiles are swapped in at the beginning of a later frame, after which E_NAVIGATION_ASYNC_BUILD_FINISHED is sent. Return true if the rebuild was queued.
+    virtual bool BuildAsync(const BoundingBox& boundingBox);
     /// Find the nearest point on the navigation mesh to a given point. Extens specifies how far out from the specified point to check along each axis.
     Vector3 FindNearestPoint(const Vector3& point, const Vector3& extents=Vector3::ONE);
     /// Try to move along the surface from one point to another.
     Vector3 MoveAlongSurface(const Vector3& start, const Vector3& end, const Vector3& extents=Vector3::ONE, int maxVisited=3);
-    /// Find a path between world space points. Return non-empty list of points if successful. Extents specifies how far off the navigation mesh the points can be.
+    /// Find a path between world space points. Return non-empty list of points if successful. Extents specifies how far off the navigation mesh the points can be. With hierarchical pathfinding, the points of a long path after the first tiles are waypoints between tiles, which should be refined by calling FindPath() again on the way.
     void FindPath(PODVector<Vector3>& dest, const Vector3& start, const Vector3& end, const Vector3& extents = Vector3::ONE);
+    /// Queue a path request between world space points. The paths are searched in worker threads during the scene post-update within the path query time budget, possibly over several frames, after which E_NAVIGATION_PATH_READY is sent. Identical unfinished requests are searched only once. Return a nonzero request ID, or 0 if failed.
+    unsigned RequestPath(const Vector3& start, const Vector3& end, const Vector3& extents = Vector3::ONE);
+    /// Take the result of a finished path request. The path is empty if it was not found. Return true if the request had finished.
+    bool GetPathResult(unsigned requestID, PODVector<Vector3>& dest);
+    /// Cancel a path request, or discard its result.
+    void CancelPathRequest(unsigned requestID);
+    /// Request a flow field towards a world space goal, which gives the direction towards the goal from any point of the navigation mesh. The field is computed in worker threads during the scene post-update within the path query time budget, possibly over several frames, after which E_NAVIGATION_FLOW_FIELD_READY is sent. It is recomputed when the navigation mesh tiles change. Identical requests share one field. Return a nonzero flow field ID, or 0 if failed.
+    unsigned RequestFlowField(const Vector3& goal, const Vector3& extents = Vector3::ONE);
+    /// Release a flow field.
+    void ReleaseFlowField(unsigned flowFieldID);
+    /// Return the world space direction of travel towards the goal of a flow field from a world space point, or zero if the goal is not reachable or has been reached.
+    Vector3 GetFlowDirection(unsigned flowFieldID, const Vector3& point, const Vector3& extents = Vector3::ONE);
+    /// Return the travel cost from a world space point to the goal of a flow field, or M_INFINITY if the goal is not reachable.
+    float GetFlowCost(unsigned flowFieldID, const Vector3& point, const Vector3& extents = Vector3::ONE);
     /// Return a random point on the navigation mesh.
     Vector3 GetRandomPoint();
     /// Return a random point on the navigation mesh within a circle. The circle radius is only a guideline and in practice the returned point may be further away.
@@ -167,6 +195,14 @@ public:
     float GetDetailSampleMaxError() const { return detailSampleMaxError_; }
     /// Return navigation mesh bounding box padding.
     const Vector3& GetPadding() const { return padding_; }
+    /// Return the time in milliseconds per frame spent on queued path requests in each thread.
+    int GetPathQueryBudget() const { return pathQueryBudget_; }
+    /// Return whether long paths are searched hierarchically.
+    bool GetHierarchicalPathfinding() const { return hierarchicalPathfinding_; }
+    /// Return number of unfinished path requests.
+    unsigned GetNumPathRequests() const { return pathRequestIDs_.Size(); }
+    /// Return whether a flow field has been computed and can be sampled.
+    bool IsFlowFieldReady(unsigned flowFieldID) const;
     /// Get the current cost of an area
     float GetAreaCost(unsigned areaID) const;
     /// Return whether has been initialized with valid navigation data.
@@ -177,6 +213,8 @@ public:
     BoundingBox GetWorldBoundingBox() const;
     /// Return number of tiles.
     IntVector2 GetNumTiles() const { return IntVector2(numTilesX_, numTilesZ_); }
+    /// Return whether background rebuilds are pending.
+    bool IsBuildingAsync() const { return !asyncTiles_.Empty(); }
 
     /// Set the partition type used for polygon generation.
     void SetPartitionType(NavmeshPartitionType aType);
@@ -209,10 +247,51 @@ protected:
     void AddTriMeshGeometry(NavBuildData* build, Geometry* geometry, const Matrix3x4& transform);
     /// Build one tile of the navigation mesh. Return true if successful.
     virtual bool BuildTile(Vector<NavigationGeometryInfo>& geometryList, int x, int z);
+    /// Build a rectangular range of tiles, using worker threads if available. Return the number of tiles built.
+    unsigned BuildTiles(Vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to);
+    /// Build the Detour data of one tile without modifying the navigation mesh, so that it can be called from worker threads. Data is null if the tile is empty. Return true if successful.
+    bool BuildTileData(Vector<NavigationGeometryInfo>& geometryList, int x, int z, unsigned char*& navData, int& navDataSize);
+    /// Replace a tile of the navigation mesh with built data. Takes ownership of the data. Return true if successful.
+    bool AddTile(int x, int z, unsigned char* navData, int navDataSize);
+    /// Return the bounding box of a tile.
+    BoundingBox GetTileBoundingBox(int x, int z) const;
+    /// Capture the build settings of a tile.
+    void GetTileSettings(int x, int z, NavigationTileSettings& settings) const;
+    /// Return the range of tiles touched by a world-space bounding box.
+    void GetTileRange(const BoundingBox& boundingBox, IntVector2& from, IntVector2& to) const;
+    /// Cancel pending background rebuilds, waiting for the tiles already being built.
+    void CancelAsyncBuild();
+    /// Send the background rebuild finished event.
+    void SendAsyncBuildFinished(const BoundingBox& boundingBox);
+    /// Handle completion of a background tile build.
+    void HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData);
+    /// Ensure that the path queries of each thread are initialized. Return true if successful.
+    bool InitializePathQueries();
+    /// Release the path queries. The requests being searched are queued again.
+    void ReleasePathQueries();
+    /// Advance the queued path requests and send the results.
+    void UpdatePathRequests();
+    /// Update the hierarchical graph from the tiles added or removed since the last update.
+    void UpdateTileGraph();
+    /// Find a local space path through the hierarchical graph, refined near the start. Return false if the regular search should be used instead.
+    bool FindHierarchicalPath(PODVector<Vector3>& dest, const Vector3& start, const Vector3& end, unsigned startRef, unsigned endRef,
+        const Vector3& extents);
+    /// Return whether there are path requests queued or being searched.
+    bool HasPathRequests() const;
+    /// Advance the flow fields which are not up to date with the navigation mesh and send the results.
+    void UpdateFlowFields();
+    /// Recompute all flow fields, for example after the area costs have changed.
+    void InvalidateFlowFields();
+    /// Return the flow field of an ID, if it has been computed.
+    NavigationFlowField* GetReadyFlowField(unsigned flowFieldID) const;
+    /// Handle scene post-update.
+    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
     /// Ensure that the navigation mesh query is initialized. Return true if successful.
     bool InitializeQuery();
     /// Release the navigation mesh and the query.
     virtual void ReleaseNavigationMesh();
+    /// Draw the polygons of tiles as persistent debug geometry, which is recorded again only when the tiles have changed.
+    void DrawDebugTiles(DebugRenderer* debug, bool depthTest, const PODVector<const dtMeshTile*>& tiles);
 
     /// Identifying name for this navigation mesh.
     String meshName_;
@@ -224,6 +303,8 @@ protected:
     dtQueryFilter* queryFilter_;
     /// Temporary data for finding a path.
     FindPathData* pathData_;
+    /// Hierarchical graph of tile regions for long paths.
+    NavigationTileGraph* tileGraph_;
     /// Tile size.
     int tileSize_;
     /// Cell size.
@@ -265,11 +346,37 @@ protected:
     bool keepInterResults_;
     /// Internal build resources for creating the navmesh.
     HashMap<Pair<int, int>, NavBuildData*> builds_;
+    /// Tiles being rebuilt in the background, in request order.
+    PODVector<NavigationAsyncTile*> asyncTiles_;
+    /// Index of the latest background rebuild request.
+    unsigned asyncBatch_;
+    /// Queued path requests not yet being searched.
+    PODVector<NavigationPathRequest*> pathRequests_;
+    /// Path queries for each thread.
+    PODVector<NavigationPathQuery*> pathQueries_;
+    /// Unfinished path requests by ID.
+    HashMap<unsigned, NavigationPathRequest*> pathRequestIDs_;
+    /// Finished paths by request ID.
+    HashMap<unsigned, PODVector<Vector3> > pathResults_;
+    /// Path query time budget per frame in milliseconds.
+    int pathQueryBudget_;
+    /// Hierarchical pathfinding flag.
+    bool hierarchicalPathfinding_;
+    /// Next path request ID.
+    unsigned nextPathRequestID_;
+    /// Flow fields.
+    PODVector<NavigationFlowField*> flowFields_;
+    /// Flow fields by ID.
+    HashMap<unsigned, NavigationFlowField*> flowFieldIDs_;
+    /// Next flow field ID.
+    unsigned nextFlowFieldID_;
 
     /// Debug draw OffMeshConnection components.
     bool drawOffMeshConnections_;
     /// Debug draw NavArea components.
     bool drawNavAreas_;
+    /// Hash of the tiles recorded as persistent debug geometry.
+    unsigned debugTilesHash_;
 };
 
 /// Register Navigation library objects.
@@ -24,8 +24,12 @@
 #include "../Network/Connection.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
+#include "../Network/InterestGrid.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
+#include "../Core/Mutex.h"
+#include "../IO/Compression.h"
+#include "../Container/Sort.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkEvents.h"
 #include "../Network/NetworkPriority.h"
@@ -36,6 +40,7 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Scene/SmoothedTransform.h"
+#include "../Core/WorkQueue.h"
 
 #include <kNet/kNet.h>
 
@@ -44,33 +49,215 @@
 namespace Urho3D
 {
 
+/// Mutex for changing the replication state lists and weak references of nodes and components, which are shared by all connections. Server updates of the connections may run in parallel.
+static Mutex replicationMutex;
+
 static const int STATS_INTERVAL_MSEC = 2000;
+/// Number of sent controls remembered for client-side prediction, covering the whole 8-bit timestamp range.
+static const unsigned CONTROLS_HISTORY_SIZE = 256;
+/// Package data bytes allowed in the outbound message queue.
+static const unsigned PACKAGE_QUEUE_BYTES = 1024 * 1024;
+/// Maximum messages taken for decoding per frame, same as kNet processes by default.
+static const unsigned MAX_RECEIVED_MESSAGES = 100;
+/// Remote event batch parameter type for an integer stored as a zigzag-encoded VLE.
+static const unsigned char VAR_COMPACTINT = MAX_VAR_TYPES;
+/// Largest zigzag-encoded integer that fits in a VLE.
+static const unsigned MAX_COMPACTINT = 0x1fffffff;
 
 PackageDownload::PackageDownload() :
-    totalFragments_(0),
+    fileSize_(0),
+    receivedBytes_(0),
     checksum_(0),
-    initiated_(false)
+    initiated_(false),
+    verified_(false)
+{
+}
+
+PackageUpload::PackageUpload()
+{
+}
+
+DecodedMessage::DecodedMessage() :
+    message_(0),
+    msgID_(0),
+    decoded_(false),
+    timeStamp_(0),
+    hasPosition_(false),
+    hasRotation_(false)
+{
+}
+
+static void ReadControls(MemoryBuffer& msg, DecodedMessage& message)
+{
+    message.controls_.buttons_ = msg.ReadUInt();
+    message.controls_.yaw_ = msg.ReadFloat();
+    message.controls_.pitch_ = msg.ReadFloat();
+    message.controls_.extraData_ = msg.ReadVariantMap();
+    message.timeStamp_ = msg.ReadUByte();
+    
+    // Client may or may not send observer position & rotation for interest management
+    message.hasPosition_ = !msg.IsEof();
+    if (message.hasPosition_)
+        message.position_ = msg.ReadVector3();
+    message.hasRotation_ = !msg.IsEof();
+    if (message.hasRotation_)
+        message.rotation_ = msg.ReadPackedQuaternion();
+}
+
+static unsigned InternHash(StringHash hash, HashMap<StringHash, unsigned>& indices, PODVector<StringHash>& hashes)
+{
+    HashMap<StringHash, unsigned>::ConstIterator i = indices.Find(hash);
+    if (i != indices.End())
+        return i->second_;
+    
+    unsigned index = hashes.Size();
+    indices[hash] = index;
+    hashes.Push(hash);
+    return index;
+}
+
+static void WriteCompactVariant(Serializer& dest, const Variant& value)
+{
+    // Small integers are common in gameplay events and are stored as zigzag-encoded VLE's. Other types use the normal
+    // variant serialization
+    if (value.GetType() == VAR_INT)
+    {
+        int intValue = value.GetInt();
+        unsigned zigzag = ((unsigned)intValue << 1) ^ (unsigned)(intValue >> 31);
+        if (zigzag <= MAX_COMPACTINT)
+        {
+            dest.WriteUByte(VAR_COMPACTINT);
+            dest.WriteVLE(zigzag);
+            return;
+        }
+    }
+    
+    dest.WriteUByte((unsigned char)value.GetType());
+    dest.WriteVariantData(value);
+}
+
+static Variant ReadCompactVariant(Deserializer& source)
+{
+    unsigned char type = source.ReadUByte();
+    if (type == VAR_COMPACTINT)
+    {
+        unsigned zigzag = source.ReadVLE();
+        return Variant((int)((zigzag >> 1) ^ (0u - (zigzag & 1))));
+    }
+    else if (type < MAX_VAR_TYPES)
+        return source.ReadVariant((VariantType)type);
+    else
+        return Variant::EMPTY;
+}
+
+static void WriteRemoteEventBatch(VectorBuffer& dest, const PODVector<StringHash>& hashes, unsigned numEvents,
+    const VectorBuffer& events)
+{
+    dest.Clear();
+    dest.WriteVLE(hashes.Size());
+    for (unsigned i = 0; i < hashes.Size(); ++i)
+        dest.WriteStringHash(hashes[i]);
+    dest.WriteVLE(numEvents);
+    dest.Write(events.GetData(), events.GetSize());
+}
+
+static void ReadRemoteEvents(int msgID, MemoryBuffer& msg, Vector<RemoteEvent>& events)
+{
+    events.Clear();
+    
+    if (msgID != MSG_REMOTEEVENTS)
+    {
+        events.Resize(1);
+        RemoteEvent& remoteEvent = events.Back();
+        remoteEvent.senderID_ = msgID == MSG_REMOTENODEEVENT ? msg.ReadNetID() : 0;
+        remoteEvent.eventType_ = msg.ReadStringHash();
+        remoteEvent.eventData_ = msg.ReadVariantMap();
+        remoteEvent.inOrder_ = false;
+        return;
+    }
+    
+    // Read the event type and parameter name hashes of the batch
+    unsigned numHashes = msg.ReadVLE();
+    if (numHashes > msg.GetSize() / sizeof(unsigned))
+    {
+        LOGWARNING("Malformed remote event batch, discarding");
+        return;
+    }
+    PODVector<StringHash> hashes(numHashes);
+    for (unsigned i = 0; i < numHashes; ++i)
+        hashes[i] = msg.ReadStringHash();
+    
+    unsigned numEvents = msg.ReadVLE();
+    for (unsigned i = 0; i < numEvents && !msg.IsEof(); ++i)
+    {
+        unsigned typeAndSender = msg.ReadVLE();
+        unsigned senderID = (typeAndSender & 1) ? msg.ReadNetID() : 0;
+        unsigned numParams = msg.ReadVLE();
+        if ((typeAndSender >> 1) >= numHashes)
+        {
+            LOGWARNING("Malformed remote event batch, discarding the rest");
+            return;
+        }
+        
+        events.Resize(events.Size() + 1);
+        RemoteEvent& remoteEvent = events.Back();
+        remoteEvent.senderID_ = senderID;
+        remoteEvent.eventType_ = hashes[typeAndSender >> 1];
+        remoteEvent.inOrder_ = false;
+        
+        for (unsigned j = 0; j < numParams && !msg.IsEof(); ++j)
+        {
+            unsigned keyIndex = msg.ReadVLE();
+            if (keyIndex >= numHashes)
+            {
+                LOGWARNING("Malformed remote event batch, discarding the rest");
+                events.Pop();
+                return;
+            }
+            remoteEvent.eventData_[hashes[keyIndex]] = ReadCompactVariant(msg);
+        }
+    }
+}
+
+static String GetPackageCacheFileName(const String& cacheDir, const PackageDownload& download)
 {
+    // Prepend the checksum to the filename to allow multiple versions
+    return cacheDir + ToStringHex(download.checksum_) + "_" + download.name_;
 }
 
-PackageUpload::PackageUpload() :
-    fragment_(0),
-    totalFragments_(0)
+static void VerifyPackageWork(const WorkItem* item, unsigned threadIndex)
 {
+    PackageDownload* download = reinterpret_cast<PackageDownload*>(item->aux_);
+    download->verified_ = download->package_->GetTotalSize() == download->fileSize_ &&
+        download->package_->CalculateChecksum() == download->checksum_;
 }
 
 Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::MessageConnection> connection) :
     Object(context),
     timeStamp_(0),
     connection_(connection),
+    packageFragmentSize_(PACKAGE_FRAGMENT_SIZE),
+    packageMessagesPending_(0),
+    interestRadius_(0.0f),
+    serverTime_(0),
+    initialStateBytes_(0),
+    ackedTimeStamp_(0),
     sendMode_(OPSM_NONE),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
-    logStatistics_(false)
+    logStatistics_(false),
+    trafficProfiling_(false),
+    interestActive_(false),
+    initialState_(false),
+    bulkTransfer_(false)
 {
     sceneState_.connection_ = this;
     
+    // The server connection on the client remembers sent controls for replaying them during prediction
+    if (!isClient_)
+        controlsHistory_.Resize(CONTROLS_HISTORY_SIZE);
+    
     // Store address and port now for accurate logging (kNet may already have destroyed the socket on disconnection,
     // in which case we would log a zero address:port on disconnect)
     kNet::EndPoint endPoint = connection_->RemoteEndPoint();
@@ -81,6 +268,13 @@ Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::Me
 
 Connection::~Connection()
 {
+    // The worker threads may still be verifying downloaded packages
+    StopPackageVerifications();
+    
+    // Return messages that were received but not applied
+    for (unsigned i = 0; i < receivedMessages_.Size(); ++i)
+        connection_->FreeMessage(receivedMessages_[i].message_);
+    
     // Reset scene (remove possible owner references), as this connection is about to be destroyed
     SetScene(0);
 }
@@ -106,6 +300,10 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         return;
     }
     
+    // Node creations buffered for the bulk initial state must be sent before any later in-order message
+    if (inOrder && msgID != MSG_CREATENODES && initialStateBuffer_.GetSize())
+        FlushInitialState();
+    
     kNet::NetworkMessage *msg = connection_->StartNewMessage(msgID, numBytes);
     if (!msg)
     {
@@ -121,16 +319,18 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         memcpy(msg->data, data, numBytes);
     
     connection_->EndAndQueueMessage(msg);
+    
+    if (trafficProfiling_)
+    {
+        TrafficStats& stats = messageTraffic_[msgID];
+        ++stats.messagesSent_;
+        stats.bytesSent_ += numBytes;
+    }
 }
 
 void Connection::SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData)
 {
-    RemoteEvent queuedEvent;
-    queuedEvent.senderID_ = 0;
-    queuedEvent.eventType_ = eventType;
-    queuedEvent.eventData_ = eventData;
-    queuedEvent.inOrder_ = inOrder;
-    remoteEvents_.Push(queuedEvent);
+    QueueRemoteEvent(0, eventType, inOrder, eventData);
 }
 
 void Connection::SendRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData)
@@ -151,12 +351,7 @@ void Connection::SendRemoteEvent(Node* node, StringHash eventType, bool inOrder,
         return;
     }
     
-    RemoteEvent queuedEvent;
-    queuedEvent.senderID_ = node->GetID();
-    queuedEvent.eventType_ = eventType;
-    queuedEvent.eventData_ = eventData;
-    queuedEvent.inOrder_ = inOrder;
-    remoteEvents_.Push(queuedEvent);
+    QueueRemoteEvent(node->GetID(), eventType, inOrder, eventData);
 }
 
 void Connection::SetScene(Scene* newScene)
@@ -177,6 +372,7 @@ void Connection::SetScene(Scene* newScene)
     if (isClient_)
     {
         sceneState_.Clear();
+        interestNodes_.Clear();
         
         // When scene is assigned on the server, instruct the client to load it. This may require downloading packages
         const Vector<SharedPtr<PackageFile> >& packages = scene_->GetRequiredPackageFiles();
@@ -218,6 +414,28 @@ void Connection::SetPosition(const Vector3& position)
         sendMode_ = OPSM_POSITION;
 }
 
+void Connection::SetInterestRadius(float radius)
+{
+    interestRadius_ = Max(radius, 0.0f);
+}
+
+void Connection::SetTrafficProfiling(bool enable)
+{
+    trafficProfiling_ = enable;
+}
+
+void Connection::ResetTrafficStats()
+{
+    messageTraffic_.Clear();
+    nodeTraffic_.Clear();
+    componentTraffic_.Clear();
+}
+
+void Connection::SetPredictedNode(Node* node)
+{
+    predictedNode_ = node;
+}
+
 void Connection::SetRotation(const Quaternion& rotation)
 {
     rotation_ = rotation;
@@ -240,25 +458,65 @@ void Connection::Disconnect(int waitMSec)
     connection_->Disconnect(waitMSec);
 }
 
-void Connection::SendServerUpdate()
+static void MarkHierarchyDirty(Node* node, HashSet<unsigned>& dirtyNodes)
+{
+    if (node->GetID() >= FIRST_LOCAL_ID)
+        return;
+    
+    dirtyNodes.Insert(node->GetID());
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        MarkHierarchyDirty(*i, dirtyNodes);
+}
+
+void Connection::SendServerUpdate(InterestGrid* interestGrid)
 {
     if (!scene_ || !sceneLoaded_)
         return;
     
+    Network* network = GetSubsystem<Network>();
+    serverTime_ = network ? (unsigned short)network->GetServerTime() : 0;
+    unsigned initialStateBudget = network ? network->GetInitialStateBudget() : 0;
+    bulkTransfer_ = initialState_ && initialStateBudget;
+    initialStateBytes_ = 0;
+    
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
     nodesToProcess_.Insert(sceneID);
     ProcessNode(sceneID);
     
+    // When using spatial interest management, send removal of nodes that left interest and mark entered nodes dirty
+    if (interestGrid && interestRadius_ > 0.0f && interestGrid->GetScene() == scene_)
+        UpdateInterest(interestGrid);
+    else if (interestActive_)
+    {
+        // Interest management was turned off: nodes that were left out need to be sent now
+        interestActive_ = false;
+        interestNodes_.Clear();
+        const Vector<SharedPtr<Node> >& children = scene_->GetChildren();
+        for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+            MarkHierarchyDirty(*i, sceneState_.dirtyNodes_);
+    }
+    
     // Then go through all dirtied nodes
     nodesToProcess_.Insert(sceneState_.dirtyNodes_);
     nodesToProcess_.Erase(sceneID); // Do not process the root node twice
     
-    while (nodesToProcess_.Size())
+    if (bulkTransfer_)
     {
-        unsigned nodeID = nodesToProcess_.Front();
-        ProcessNode(nodeID);
+        ProcessInitialState(initialStateBudget);
+        FlushInitialState();
+        bulkTransfer_ = false;
+    }
+    else
+    {
+        initialState_ = false;
+        while (nodesToProcess_.Size())
+        {
+            unsigned nodeID = nodesToProcess_.Front();
+            ProcessNode(nodeID);
+        }
     }
 }
 
@@ -279,6 +537,8 @@ void Connection::SendClientUpdate()
         msg_.WritePackedQuaternion(rotation_);
     SendMessage(MSG_CONTROLS, false, false, msg_, CONTROLS_CONTENT_ID);
 
+    if (controlsHistory_.Size())
+        controlsHistory_[timeStamp_] = controls_;
     ++timeStamp_;
 }
 
@@ -300,6 +560,16 @@ void Connection::SendRemoteEvents()
     
     PROFILE(SendRemoteEvents);
     
+    if (GetSubsystem<Network>()->GetRemoteEventBatching())
+    {
+        // The in-order and unordered events are sent in separate batches, each keeping the queued order of its events
+        SendRemoteEventBatches(true);
+        SendRemoteEventBatches(false);
+        remoteEvents_.Clear();
+        coalescedEvents_.Clear();
+        return;
+    }
+    
     for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
     {
         msg_.Clear();
@@ -319,32 +589,105 @@ void Connection::SendRemoteEvents()
     }
     
     remoteEvents_.Clear();
+    coalescedEvents_.Clear();
 }
 
-void Connection::SendPackages()
+void Connection::SendRemoteEventBatches(bool inOrder)
 {
-    while (!uploads_.Empty() && connection_->NumOutboundMessagesPending() < 1000)
+    HashMap<StringHash, unsigned> hashIndices;
+    PODVector<StringHash> hashes;
+    VectorBuffer events;
+    unsigned numEvents = 0;
+    
+    for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
     {
-        unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
+        if (i->inOrder_ != inOrder)
+            continue;
         
+        // The type index is shifted left to leave room for the sender node flag
+        events.WriteVLE((InternHash(i->eventType_, hashIndices, hashes) << 1) | (i->senderID_ ? 1 : 0));
+        if (i->senderID_)
+            events.WriteNetID(i->senderID_);
+        events.WriteVLE(i->eventData_.Size());
+        for (VariantMap::ConstIterator j = i->eventData_.Begin(); j != i->eventData_.End(); ++j)
+        {
+            events.WriteVLE(InternHash(j->first_, hashIndices, hashes));
+            WriteCompactVariant(events, j->second_);
+        }
+        ++numEvents;
+        
+        if (events.GetSize() >= REMOTE_EVENT_BATCH_SIZE)
+        {
+            WriteRemoteEventBatch(msg_, hashes, numEvents, events);
+            SendMessage(MSG_REMOTEEVENTS, true, inOrder, msg_);
+            hashIndices.Clear();
+            hashes.Clear();
+            events.Clear();
+            numEvents = 0;
+        }
+    }
+    
+    if (numEvents)
+    {
+        WriteRemoteEventBatch(msg_, hashes, numEvents, events);
+        SendMessage(MSG_REMOTEEVENTS, true, inOrder, msg_);
+    }
+}
+
+void Connection::SendPackages()
+{
+    if (uploads_.Empty())
+        return;
+    
+    // Grow the fragments while the connection drains the queue between updates, shrink them if it does not drain at all
+    unsigned pending = connection_->NumOutboundMessagesPending();
+    if (!pending)
+        packageFragmentSize_ = Min((int)packageFragmentSize_ * 2, (int)MAX_PACKAGE_FRAGMENT_SIZE);
+    else if (pending >= packageMessagesPending_)
+        packageFragmentSize_ = Max((int)packageFragmentSize_ / 2, (int)PACKAGE_FRAGMENT_SIZE);
+    
+    unsigned char buffer[MAX_PACKAGE_FRAGMENT_SIZE];
+    CompressionCodec* codec = GetSubsystem<Network>()->GetPackageCodec();
+    SharedArrayPtr<unsigned char> compressBuffer;
+    if (codec)
+        compressBuffer = new unsigned char[codec->GetCompressBound(packageFragmentSize_)];
+    
+    while (!uploads_.Empty() && connection_->NumOutboundMessagesPending() < PACKAGE_QUEUE_BYTES / packageFragmentSize_)
+    {
         for (HashMap<StringHash, PackageUpload>::Iterator i = uploads_.Begin(); i != uploads_.End();)
         {
             HashMap<StringHash, PackageUpload>::Iterator current = i++;
             PackageUpload& upload = current->second_;
-            unsigned fragmentSize = Min((int)(upload.file_->GetSize() - upload.file_->GetPosition()), (int)PACKAGE_FRAGMENT_SIZE);
+            unsigned offset = upload.file_->GetPosition();
+            unsigned fragmentSize = Min((int)(upload.file_->GetSize() - offset), (int)packageFragmentSize_);
             upload.file_->Read(buffer, fragmentSize);
             
             msg_.Clear();
             msg_.WriteStringHash(current->first_);
-            msg_.WriteUInt(upload.fragment_++);
-            msg_.Write(buffer, fragmentSize);
-            SendMessage(MSG_PACKAGEDATA, true, false, msg_);
+            msg_.WriteUInt(offset);
+            // Send compressed only if it actually saves space
+            unsigned compressedSize = codec ? codec->Compress(compressBuffer.Get(), buffer, fragmentSize) : 0;
+            if (compressedSize && compressedSize < fragmentSize)
+            {
+                msg_.WriteBool(true);
+                msg_.WriteVLE(fragmentSize);
+                msg_.Write(compressBuffer.Get(), compressedSize);
+            }
+            else
+            {
+                msg_.WriteBool(false);
+                msg_.Write(buffer, fragmentSize);
+            }
+            // Send in order so that the client's partial file is always a valid beginning of the package for resuming
+            SendMessage(MSG_PACKAGEDATA, true, true, msg_);
             
             // Check if upload finished
-            if (upload.fragment_ == upload.totalFragments_)
+            if (upload.file_->GetPosition() >= upload.file_->GetSize())
                 uploads_.Erase(current);
         }
     }
+    
+    packageMessagesPending_ = connection_->NumOutboundMessagesPending();
 }
 
 void Connection::ProcessPendingLatestData()
@@ -361,9 +704,8 @@ void Connection::ProcessPendingLatestData()
         {
             MemoryBuffer msg(current->second_);
             msg.ReadNetID(); // Skip the node ID
-            node->ReadLatestDataUpdate(msg);
-            // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
-            // Furthermore it would propagate to components and child nodes, which is not desired in this case
+            unsigned short serverTime = msg.ReadUShort();
+            ProcessNodeLatestData(node, serverTime, msg);
             nodeLatestData_.Erase(current);
         }
     }
@@ -388,6 +730,8 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
 {
     bool processed = true;
     
+    AddMessageTraffic(msgID, msg.GetSize());
+    
     switch (msgID)
     {
         case MSG_IDENTITY:
@@ -416,6 +760,7 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
             break;
             
         case MSG_CREATENODE:
+        case MSG_CREATENODES:
         case MSG_NODEDELTAUPDATE:
         case MSG_NODELATESTDATA:
         case MSG_REMOVENODE:
@@ -428,6 +773,7 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
             
         case MSG_REMOTEEVENT:
         case MSG_REMOTENODEEVENT:
+        case MSG_REMOTEEVENTS:
             ProcessRemoteEvent(msgID, msg);
             break;
 
@@ -443,6 +789,123 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
     return processed;
 }
 
+void Connection::ReceiveMessages()
+{
+    while (receivedMessages_.Size() < MAX_RECEIVED_MESSAGES)
+    {
+        kNet::NetworkMessage* message = connection_->ReceiveMessage();
+        if (!message)
+            break;
+        
+        receivedMessages_.Resize(receivedMessages_.Size() + 1);
+        DecodedMessage& decoded = receivedMessages_.Back();
+        decoded.message_ = message;
+        decoded.msgID_ = message->id;
+    }
+}
+
+void Connection::DecodeMessages()
+{
+    for (unsigned i = 0; i < receivedMessages_.Size(); ++i)
+        DecodeMessage(receivedMessages_[i]);
+}
+
+void Connection::ApplyMessages()
+{
+    if (receivedMessages_.Empty())
+        return;
+    
+    Network* network = GetSubsystem<Network>();
+    
+    for (unsigned i = 0; i < receivedMessages_.Size(); ++i)
+    {
+        DecodedMessage& message = receivedMessages_[i];
+        kNet::NetworkMessage* raw = message.message_;
+        
+        if (message.decoded_)
+        {
+            AddMessageTraffic(message.msgID_, (unsigned)raw->Size());
+            
+            switch (message.msgID_)
+            {
+            case MSG_IDENTITY:
+                identity_ = message.eventData_;
+                OnIdentityReceived();
+                break;
+                
+            case MSG_CONTROLS:
+                ApplyControls(message);
+                break;
+                
+            case MSG_CREATENODES:
+                if (scene_)
+                    ProcessInitialStateNodes(message.data_);
+                break;
+                
+            case MSG_REMOTEEVENT:
+            case MSG_REMOTENODEEVENT:
+            case MSG_REMOTEEVENTS:
+                for (unsigned j = 0; j < message.remoteEvents_.Size(); ++j)
+                    ApplyRemoteEvent(message.remoteEvents_[j]);
+                break;
+            }
+        }
+        else
+        {
+            // The packet ID is not used by the message handler
+            network->HandleMessage(connection_, 0, raw->id, raw->Size() ? raw->data : 0, raw->Size());
+        }
+        
+        connection_->FreeMessage(raw);
+    }
+    
+    receivedMessages_.Clear();
+}
+
+void Connection::DecodeMessage(DecodedMessage& message)
+{
+    kNet::NetworkMessage* raw = message.message_;
+    MemoryBuffer msg(raw->data, (unsigned)raw->Size());
+    
+    // Only decode messages that are valid for this connection's direction, the rest are handled (and warned about)
+    // by the main thread. Messages that need the scene, such as node and component updates, are also left to it
+    switch (message.msgID_)
+    {
+    case MSG_IDENTITY:
+        if (IsClient())
+        {
+            message.eventData_ = msg.ReadVariantMap();
+            message.decoded_ = true;
+        }
+        break;
+        
+    case MSG_CONTROLS:
+        if (IsClient())
+        {
+            ReadControls(msg, message);
+            message.decoded_ = true;
+        }
+        break;
+        
+    case MSG_CREATENODES:
+        if (!IsClient())
+        {
+            // On failure leave an empty state, the error has been logged
+            if (!DecompressInitialState(msg, message.data_))
+                message.data_.Clear();
+            message.decoded_ = true;
+        }
+        break;
+        
+    case MSG_REMOTEEVENT:
+    case MSG_REMOTENODEEVENT:
+    case MSG_REMOTEEVENTS:
+        ReadRemoteEvents(message.msgID_, msg, message.remoteEvents_);
+        message.decoded_ = true;
+        break;
+    }
+}
+
 void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
 {
     if (IsClient())
@@ -531,6 +994,8 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 node->CreateComponent<SmoothedTransform>(LOCAL);
             }
             
+            AddNodeTraffic(nodeID, msg.GetSize(), false);
+            
             // Read initial attributes, then snap the motion smoothing immediately to the end
             node->ReadDeltaUpdate(msg);
             SmoothedTransform* transform = node->GetComponent<SmoothedTransform>();
@@ -552,6 +1017,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             {
                 --numComponents;
                 
+                unsigned componentStart = msg.GetPosition();
                 StringHash type = msg.ReadStringHash();
                 unsigned componentID = msg.ReadNetID();
                 
@@ -574,14 +1040,27 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 // Read initial attributes and apply
                 component->ReadDeltaUpdate(msg);
                 component->ApplyAttributes();
+                
+                // The component's bytes are already counted to the node as part of the message
+                if (trafficProfiling_)
+                    componentTraffic_[type].bytesReceived_ += msg.GetPosition() - componentStart;
             }
         }
         break;
         
+    case MSG_CREATENODES:
+        {
+            PODVector<unsigned char> data;
+            if (DecompressInitialState(msg, data))
+                ProcessInitialStateNodes(data);
+        }
+        break;
+        
     case MSG_NODEDELTAUPDATE:
         {
             unsigned nodeID = msg.ReadNetID();
             Node* node = scene_->GetNode(nodeID);
+            AddNodeTraffic(nodeID, msg.GetSize(), false);
             if (node)
             {
                 node->ReadDeltaUpdate(msg);
@@ -603,13 +1082,11 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
     case MSG_NODELATESTDATA:
         {
             unsigned nodeID = msg.ReadNetID();
+            unsigned short serverTime = msg.ReadUShort();
             Node* node = scene_->GetNode(nodeID);
+            AddNodeTraffic(nodeID, msg.GetSize(), false);
             if (node)
-            {
-                node->ReadLatestDataUpdate(msg);
-                // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
-                // Furthermore it would propagate to components and child nodes, which is not desired in this case
-            }
+                ProcessNodeLatestData(node, serverTime, msg);
             else
             {
                 // Latest data messages may be received out-of-order relative to node creation, so cache if necessary
@@ -655,6 +1132,8 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                     return;
                 }
                 
+                AddComponentTraffic(component, msg.GetSize(), false);
+                
                 // Read initial attributes and apply
                 component->ReadDeltaUpdate(msg);
                 component->ApplyAttributes();
@@ -670,6 +1149,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
+                AddComponentTraffic(component, msg.GetSize(), false);
                 component->ReadDeltaUpdate(msg);
                 component->ApplyAttributes();
             }
@@ -684,6 +1164,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             Component* component = scene_->GetComponent(componentID);
             if (component)
             {
+                AddComponentTraffic(component, msg.GetSize(), false);
                 if (component->ReadLatestDataUpdate(msg))
                     component->ApplyAttributes();
             }
@@ -709,6 +1190,86 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
     }
 }
 
+bool Connection::DecompressInitialState(MemoryBuffer& msg, PODVector<unsigned char>& data)
+{
+    unsigned dataSize = msg.ReadVLE();
+    bool compressed = msg.ReadBool();
+    data.Resize(dataSize);
+    if (compressed)
+    {
+        CompressionCodec* codec = GetSubsystem<Network>()->GetSceneCodec();
+        const unsigned char* src = msg.GetData() + msg.GetPosition();
+        unsigned srcSize = msg.GetSize() - msg.GetPosition();
+        if (dataSize && (codec ? !codec->Decompress(&data[0], dataSize, src, srcSize) : !DecompressData(&data[0], src,
+            dataSize)))
+        {
+            LOGERROR("Could not decompress initial scene state, check that the scene codec matches the server");
+            return false;
+        }
+    }
+    else if (dataSize)
+        data.Resize(msg.Read(&data[0], dataSize));
+    
+    return true;
+}
+
+void Connection::ProcessInitialStateNodes(const PODVector<unsigned char>& data)
+{
+    // Process the contained node creations in order
+    MemoryBuffer chunk(data);
+    while (!chunk.IsEof())
+    {
+        unsigned size = chunk.ReadVLE();
+        unsigned position = chunk.GetPosition();
+        if (position + size > chunk.GetSize())
+        {
+            LOGERROR("Malformed initial scene state chunk");
+            return;
+        }
+        
+        MemoryBuffer nodeMsg(chunk.GetData() + position, size);
+        ProcessSceneUpdate(MSG_CREATENODE, nodeMsg);
+        chunk.Seek(position + size);
+    }
+}
+
+void Connection::ProcessNodeLatestData(Node* node, unsigned short serverTime, MemoryBuffer& msg)
+{
+    // Every update advances the snapshot timeline, but only non-predicted nodes buffer it for interpolation
+    scene_->BeginNetworkSnapshot(serverTime);
+    
+    if (node != predictedNode_)
+    {
+        node->ReadLatestDataUpdate(msg);
+        // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
+        // Furthermore it would propagate to components and child nodes, which is not desired in this case
+        scene_->EndNetworkSnapshot();
+        return;
+    }
+    
+    scene_->EndNetworkSnapshot();
+    
+    // The latest data begins with the latest controls timestamp received by the server
+    unsigned position = msg.GetPosition();
+    ackedTimeStamp_ = msg.ReadUByte();
+    msg.Seek(position);
+    
+    // Apply the authoritative state immediately, then let the application replay the unacknowledged controls on top
+    node->ReadLatestDataUpdate(msg);
+    SmoothedTransform* transform = node->GetComponent<SmoothedTransform>();
+    if (transform)
+        transform->Update(1.0f, 0.0f);
+    
+    using namespace NetworkReconcile;
+    
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_CONNECTION] = this;
+    eventData[P_NODE] = node;
+    eventData[P_TIMESTAMP] = (unsigned)ackedTimeStamp_;
+    eventData[P_NUMCONTROLS] = GetNumUnackedControls();
+    SendEvent(E_NETWORKRECONCILE, eventData);
+}
+
 void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
 {
     switch (msgID)
@@ -722,6 +1283,8 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
         else
         {
             String name = msg.ReadString();
+            // A resumed download continues from an offset
+            unsigned offset = msg.IsEof() ? 0 : msg.ReadUInt();
             
             if (!scene_)
             {
@@ -748,18 +1311,21 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                     
                     // Try to open the file now
                     SharedPtr<File> file(new File(context_, packageFullName));
-                    if (!file->IsOpen())
+                    if (!file->IsOpen() || offset > file->GetSize())
                     {
                         LOGERROR("Failed to transmit package file " + name);
                         SendPackageError(name);
                         return;
                     }
                     
-                    LOGINFO("Transmitting package file " + name + " to client " + ToString());
+                    if (offset)
+                        LOGINFO("Resuming transmission of package file " + name + " to client " + ToString() + " from offset " +
+                            String(offset));
+                    else
+                        LOGINFO("Transmitting package file " + name + " to client " + ToString());
                     
+                    file->Seek(offset);
                     uploads_[nameHash].file_ = file;
-                    uploads_[nameHash].fragment_ = 0;
-                    uploads_[nameHash].totalFragments_ = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
                     return;
                 }
             }
@@ -782,7 +1348,7 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
             StringHash nameHash = msg.ReadStringHash();
             
             HashMap<StringHash, PackageDownload>::Iterator i = downloads_.Find(nameHash);
-            // In case of being unable to create the package file into the cache, we will still receive all data from the server.
+            // After a failed download we will still receive the rest of the data already sent by the server.
             // Simply disregard it
             if (i == downloads_.End())
                 return;
@@ -796,50 +1362,71 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                 return;
             }
             
-            // If file has not yet been opened, try to open now. Prepend the checksum to the filename to allow multiple versions
             if (!download.file_)
             {
-                download.file_ = new File(context_, GetSubsystem<Network>()->GetPackageCacheDir() + ToStringHex(download.checksum_) + "_" + download.name_, FILE_WRITE);
-                if (!download.file_->IsOpen())
+                LOGWARNING("Received unexpected data for package " + download.name_);
+                return;
+            }
+            
+            // Fragments arrive in order, so append the data to the end of the partial file
+            unsigned char buffer[MAX_PACKAGE_FRAGMENT_SIZE];
+            unsigned offset = msg.ReadUInt();
+            bool compressed = msg.ReadBool();
+            unsigned fragmentSize;
+            
+            if (compressed)
+            {
+                CompressionCodec* codec = GetSubsystem<Network>()->GetPackageCodec();
+                fragmentSize = msg.ReadVLE();
+                unsigned compressedSize = msg.GetSize() - msg.GetPosition();
+                if (!codec || fragmentSize > MAX_PACKAGE_FRAGMENT_SIZE || !codec->Decompress(buffer, fragmentSize, msg.GetData() +
+                    msg.GetPosition(), compressedSize))
                 {
+                    LOGERROR("Could not decompress package fragment, check that the package codec matches the server");
                     OnPackageDownloadFailed(download.name_);
                     return;
                 }
             }
+            else
+            {
+                fragmentSize = msg.GetSize() - msg.GetPosition();
+                if (fragmentSize > MAX_PACKAGE_FRAGMENT_SIZE)
+                    fragmentSize = MAX_PACKAGE_FRAGMENT_SIZE;
+                msg.Read(buffer, fragmentSize);
+            }
             
-            // Write the fragment data to the proper index
-            unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
-            unsigned index = msg.ReadUInt();
-            unsigned fragmentSize = msg.GetSize() - msg.GetPosition();
+            if (offset != download.receivedBytes_ || download.receivedBytes_ + fragmentSize > download.fileSize_)
+            {
+                LOGERROR("Received package " + download.name_ + " data at unexpected offset " + String(offset));
+                OnPackageDownloadFailed(download.name_);
+                return;
+            }
             
-            msg.Read(buffer, fragmentSize);
-            download.file_->Seek(index * PACKAGE_FRAGMENT_SIZE);
             download.file_->Write(buffer, fragmentSize);
-            download.receivedFragments_.Insert(index);
+            download.receivedBytes_ += fragmentSize;
             
-            // Check if all fragments received
-            if (download.receivedFragments_.Size() == download.totalFragments_)
+            // When all data received, verify the checksum in a worker thread before taking the package into use.
+            // ProcessPendingDownloads() picks up the result
+            if (download.receivedBytes_ == download.fileSize_)
             {
-                LOGINFO("Package " + download.name_ + " downloaded successfully");
-                
-                // Instantiate the package and add to the resource system, as we will need it to load the scene
+                String partName = download.file_->GetName();
                 download.file_->Close();
-                GetSubsystem<ResourceCache>()->AddPackageFile(download.file_->GetName(), true);
+                download.file_.Reset();
                 
-                // Then start the next download if there are more
-                downloads_.Erase(i);
-                if (downloads_.Empty())
-                    OnPackagesReady();
-                else
+                download.package_ = new PackageFile(context_);
+                if (!download.package_->Open(partName))
                 {
-                    PackageDownload& nextDownload = downloads_.Begin()->second_;
-                    
-                    LOGINFO("Requesting package " + nextDownload.name_ + " from server");
-                    msg_.Clear();
-                    msg_.WriteString(nextDownload.name_);
-                    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-                    nextDownload.initiated_ = true;
+                    download.package_.Reset();
+                    GetSubsystem<FileSystem>()->Delete(partName);
+                    OnPackageDownloadFailed(download.name_);
+                    return;
                 }
+                
+                download.verifyItem_ = new WorkItem();
+                download.verifyItem_->workFunction_ = VerifyPackageWork;
+                download.verifyItem_->aux_ = &download;
+                download.verifyItem_->priority_ = 0;
+                GetSubsystem<WorkQueue>()->AddWorkItem(download.verifyItem_);
             }
         }
         break;
@@ -855,7 +1442,11 @@ void Connection::ProcessIdentity(int msgID, MemoryBuffer& msg)
     }
     
     identity_ = msg.ReadVariantMap();
-    
+    OnIdentityReceived();
+}
+
+void Connection::OnIdentityReceived()
+{
     using namespace ClientIdentity;
     
     VariantMap eventData = identity_;
@@ -876,20 +1467,19 @@ void Connection::ProcessControls(int msgID, MemoryBuffer& msg)
         return;
     }
     
-    Controls newControls;
-    newControls.buttons_ = msg.ReadUInt();
-    newControls.yaw_ = msg.ReadFloat();
-    newControls.pitch_ = msg.ReadFloat();
-    newControls.extraData_ = msg.ReadVariantMap();
-    
-    SetControls(newControls);
-    timeStamp_ = msg.ReadUByte();
+    DecodedMessage message;
+    ReadControls(msg, message);
+    ApplyControls(message);
+}
 
-    // Client may or may not send observer position & rotation for interest management
-    if (!msg.IsEof())
-        position_ = msg.ReadVector3();
-    if (!msg.IsEof())
-        rotation_ = msg.ReadPackedQuaternion();
+void Connection::ApplyControls(const DecodedMessage& message)
+{
+    SetControls(message.controls_);
+    timeStamp_ = message.timeStamp_;
+    if (message.hasPosition_)
+        position_ = message.position_;
+    if (message.hasRotation_)
+        rotation_ = message.rotation_;
 }
 
 void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
@@ -918,6 +1508,7 @@ void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
     else
     {
         sceneLoaded_ = true;
+        initialState_ = true;
         
         using namespace ClientSceneLoaded;
         
@@ -928,48 +1519,69 @@ void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
 }
 
 void Connection::ProcessRemoteEvent(int msgID, MemoryBuffer& msg)
+{
+    Vector<RemoteEvent> events;
+    ReadRemoteEvents(msgID, msg, events);
+    for (unsigned i = 0; i < events.Size(); ++i)
+        ApplyRemoteEvent(events[i]);
+}
+
+void Connection::ApplyRemoteEvent(RemoteEvent& remoteEvent)
 {
     using namespace RemoteEventData;
     
-    if (msgID == MSG_REMOTEEVENT)
+    if (remoteEvent.senderID_ && !scene_)
     {
-        StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
-        {
-            LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
-        }
-        
-        VariantMap eventData = msg.ReadVariantMap();
-        eventData[P_CONNECTION] = this;
-        SendEvent(eventType, eventData);
+        LOGERROR("Can not receive remote node event without an assigned scene");
+        return;
+    }
+    
+    if (!GetSubsystem<Network>()->CheckRemoteEvent(remoteEvent.eventType_))
+    {
+        LOGWARNING("Discarding not allowed remote event " + remoteEvent.eventType_.ToString());
+        return;
     }
+    
+    VariantMap& eventData = remoteEvent.eventData_;
+    eventData[P_CONNECTION] = this;
+    
+    if (!remoteEvent.senderID_)
+        SendEvent(remoteEvent.eventType_, eventData);
     else
     {
-        if (!scene_)
-        {
-            LOGERROR("Can not receive remote node event without an assigned scene");
-            return;
-        }
-        
-        unsigned nodeID = msg.ReadNetID();
-        StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
+        Node* sender = scene_->GetNode(remoteEvent.senderID_);
+        if (!sender)
         {
-            LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
+            LOGWARNING("Missing sender for remote node event, discarding");
             return;
         }
-        
-        VariantMap eventData = msg.ReadVariantMap();
-        Node* sender = scene_->GetNode(nodeID);
-        if (!sender)
+        sender->SendEvent(remoteEvent.eventType_, eventData);
+    }
+}
+
+void Connection::QueueRemoteEvent(unsigned senderID, StringHash eventType, bool inOrder, const VariantMap& eventData)
+{
+    // A coalesced event replaces the data of the same sender's queued event of the same type, keeping its queue position
+    if (GetSubsystem<Network>()->IsRemoteEventCoalesced(eventType))
+    {
+        Pair<unsigned, StringHash> key(senderID, eventType);
+        HashMap<Pair<unsigned, StringHash>, unsigned>::ConstIterator i = coalescedEvents_.Find(key);
+        if (i != coalescedEvents_.End())
         {
-            LOGWARNING("Missing sender for remote node event, discarding");
+            RemoteEvent& queuedEvent = remoteEvents_[i->second_];
+            queuedEvent.eventData_ = eventData;
+            queuedEvent.inOrder_ |= inOrder;
             return;
         }
-        eventData[P_CONNECTION] = this;
-        sender->SendEvent(eventType, eventData);
+        coalescedEvents_[key] = remoteEvents_.Size();
     }
+    
+    RemoteEvent queuedEvent;
+    queuedEvent.senderID_ = senderID;
+    queuedEvent.eventType_ = eventType;
+    queuedEvent.eventData_ = eventData;
+    queuedEvent.inOrder_ = inOrder;
+    remoteEvents_.Push(queuedEvent);
 }
 
 kNet::MessageConnection* Connection::GetMessageConnection() const
@@ -982,6 +1594,32 @@ Scene* Connection::GetScene() const
     return scene_;
 }
 
+TrafficStats Connection::GetTotalTraffic() const
+{
+    TrafficStats total;
+    for (HashMap<int, TrafficStats>::ConstIterator i = messageTraffic_.Begin(); i != messageTraffic_.End(); ++i)
+        total.Add(i->second_);
+    return total;
+}
+
+Node* Connection::GetPredictedNode() const
+{
+    return predictedNode_;
+}
+
+unsigned Connection::GetNumUnackedControls() const
+{
+    return controlsHistory_.Size() ? (unsigned char)(timeStamp_ - ackedTimeStamp_ - 1) : 0;
+}
+
+const Controls& Connection::GetUnackedControls(unsigned index) const
+{
+    if (index >= GetNumUnackedControls())
+        return controls_;
+    
+    return controlsHistory_[(unsigned char)(ackedTimeStamp_ + 1 + index)];
+}
+
 bool Connection::IsConnected() const
 {
     return connection_->GetConnectionState() == kNet::ConnectionOK;
@@ -1012,7 +1650,7 @@ float Connection::GetDownloadProgress() const
     for (HashMap<StringHash, PackageDownload>::ConstIterator i = downloads_.Begin(); i != downloads_.End(); ++i)
     {
         if (i->second_.initiated_)
-            return (float)i->second_.receivedFragments_.Size() / (float)i->second_.totalFragments_;
+            return i->second_.fileSize_ ? (float)i->second_.receivedBytes_ / (float)i->second_.fileSize_ : 1.0f;
     }
     return 1.0f;
 }
@@ -1083,6 +1721,8 @@ void Connection::ProcessNode(unsigned nodeID)
             // would be enough. However, this may be better due to the client not possibly having updated parenting
             // information at the time of receiving this message
             SendMessage(MSG_REMOVENODE, true, true, msg_);
+            
+            MutexLock lock(replicationMutex);
             sceneState_.nodeStates_.Erase(nodeID);
         }
         else
@@ -1092,11 +1732,12 @@ void Connection::ProcessNode(unsigned nodeID)
     {
         // Replication state not found: this is a new node
         Node* node = scene_->GetNode(nodeID);
-        if (node)
+        if (node && IsInInterest(node))
             ProcessNewNode(node);
         else
         {
-            // Did not find the new node (may have been created, then removed immediately): erase from dirty set.
+            // Did not find the new node (may have been created, then removed immediately), or it is outside interest:
+            // erase from dirty set. It will be marked dirty again once it enters interest
             sceneState_.dirtyNodes_.Erase(nodeID);
         }
     }
@@ -1113,14 +1754,34 @@ void Connection::ProcessNewNode(Node* node)
             ProcessNode(nodeID);
     }
     
-    msg_.Clear();
-    msg_.WriteNetID(node->GetID());
-    
     NodeReplicationState& nodeState = sceneState_.nodeStates_[node->GetID()];
     nodeState.connection_ = this;
     nodeState.sceneState_ = &sceneState_;
-    nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    {
+        MutexLock lock(replicationMutex);
+        
+        nodeState.node_ = node;
+        node->AddReplicationState(&nodeState);
+        
+        for (unsigned i = 0; i < components.Size(); ++i)
+        {
+            Component* component = components[i];
+            // Check if component is not to be replicated
+            if (component->GetID() >= FIRST_LOCAL_ID)
+                continue;
+            
+            ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
+            componentState.connection_ = this;
+            componentState.nodeState_ = &nodeState;
+            componentState.component_ = component;
+            component->AddReplicationState(&componentState);
+        }
+    }
+    
+    msg_.Clear();
+    msg_.WriteNetID(node->GetID());
     
     // Write node's attributes
     node->WriteInitialDeltaUpdate(msg_, timeStamp_);
@@ -1136,7 +1797,6 @@ void Connection::ProcessNewNode(Node* node)
     
     // Write node's components
     msg_.WriteVLE(node->GetNumNetworkComponents());
-    const Vector<SharedPtr<Component> >& components = node->GetComponents();
     for (unsigned i = 0; i < components.Size(); ++i)
     {
         Component* component = components[i];
@@ -1144,23 +1804,102 @@ void Connection::ProcessNewNode(Node* node)
         if (component->GetID() >= FIRST_LOCAL_ID)
             continue;
         
-        ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
-        componentState.connection_ = this;
-        componentState.nodeState_ = &nodeState;
-        componentState.component_ = component;
-        component->AddReplicationState(&componentState);
-        
+        unsigned componentStart = msg_.GetSize();
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
         component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+        
+        // The component's bytes are counted to the node as part of the message
+        if (trafficProfiling_)
+            componentTraffic_[component->GetType()].bytesSent_ += msg_.GetSize() - componentStart;
     }
     
-    SendMessage(MSG_CREATENODE, true, true, msg_);
+    if (bulkTransfer_)
+    {
+        // Buffer for sending in a compressed chunk
+        initialStateBuffer_.WriteVLE(msg_.GetSize());
+        initialStateBuffer_.Write(msg_.GetData(), msg_.GetSize());
+        initialStateBytes_ += msg_.GetSize();
+        if (initialStateBuffer_.GetSize() >= INITIAL_STATE_CHUNK_SIZE)
+            FlushInitialState();
+    }
+    else
+        SendMessage(MSG_CREATENODE, true, true, msg_);
+    AddNodeTraffic(node->GetID(), msg_.GetSize(), true);
     
     nodeState.markedDirty_ = false;
     sceneState_.dirtyNodes_.Erase(node->GetID());
 }
 
+void Connection::ProcessInitialState(unsigned budget)
+{
+    // Create the nodes nearest to the observer first, so that the client's surroundings appear first
+    PODVector<Pair<float, unsigned> > order;
+    order.Reserve(nodesToProcess_.Size());
+    for (HashSet<unsigned>::ConstIterator i = nodesToProcess_.Begin(); i != nodesToProcess_.End(); ++i)
+    {
+        Node* node = scene_->GetNode(*i);
+        float distance = node && sendMode_ != OPSM_NONE ? (node->GetWorldPosition() - position_).LengthSquared() : 0.0f;
+        order.Push(MakePair(distance, *i));
+    }
+    Sort(order.Begin(), order.End());
+    
+    bool deferred = false;
+    for (PODVector<Pair<float, unsigned> >::ConstIterator i = order.Begin(); i != order.End(); ++i)
+    {
+        unsigned nodeID = i->second_;
+        if (!nodesToProcess_.Contains(nodeID))
+            continue;
+        
+        // When over the budget, leave new nodes dirty for the next update. Existing nodes are always updated
+        if (initialStateBytes_ >= budget && !sceneState_.nodeStates_.Contains(nodeID))
+        {
+            nodesToProcess_.Erase(nodeID);
+            deferred = true;
+            continue;
+        }
+        
+        ProcessNode(nodeID);
+    }
+    
+    if (!deferred)
+        initialState_ = false;
+}
+
+void Connection::FlushInitialState()
+{
+    if (!initialStateBuffer_.GetSize())
+        return;
+    
+    CompressionCodec* codec = GetSubsystem<Network>()->GetSceneCodec();
+    unsigned srcSize = initialStateBuffer_.GetSize();
+    unsigned bound = codec ? codec->GetCompressBound(srcSize) : EstimateCompressBound(srcSize);
+    
+    // Reserve space for the size header and compressed flag, then compress after them
+    initialStateChunk_.Clear();
+    initialStateChunk_.WriteVLE(srcSize);
+    initialStateChunk_.WriteBool(true);
+    unsigned headerSize = initialStateChunk_.GetSize();
+    initialStateChunk_.Resize(headerSize + bound);
+    unsigned char* dest = initialStateChunk_.GetModifiableData() + headerSize;
+    unsigned compressedSize = codec ? codec->Compress(dest, initialStateBuffer_.GetData(), srcSize) : CompressData(dest,
+        initialStateBuffer_.GetData(), srcSize);
+    
+    // Send uncompressed if compression failed or did not save space
+    if (compressedSize && compressedSize < srcSize)
+        initialStateChunk_.Resize(headerSize + compressedSize);
+    else
+    {
+        initialStateChunk_.Resize(headerSize - 1);
+        initialStateChunk_.Seek(headerSize - 1);
+        initialStateChunk_.WriteBool(false);
+        initialStateChunk_.Write(initialStateBuffer_.GetData(), srcSize);
+    }
+    
+    initialStateBuffer_.Clear();
+    SendMessage(MSG_CREATENODES, true, true, initialStateChunk_);
+}
+
 void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState)
 {
     // Process depended upon nodes first, if they are dirty
@@ -1203,9 +1942,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
+            msg_.WriteUShort(serverTime_);
             node->WriteLatestDataUpdate(msg_, timeStamp_);
             
             SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            AddNodeTraffic(node->GetID(), msg_.GetSize(), true);
         }
         
         // Send deltaupdate if remaining dirty bits, or vars have changed
@@ -1236,6 +1977,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             }
             
             SendMessage(MSG_NODEDELTAUPDATE, true, true, msg_);
+            AddNodeTraffic(node->GetID(), msg_.GetSize(), true);
             
             nodeState.dirtyAttributes_.ClearAll();
             nodeState.dirtyVars_.Clear();
@@ -1256,6 +1998,8 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.WriteNetID(current->first_);
             
             SendMessage(MSG_REMOVECOMPONENT, true, true, msg_);
+            
+            MutexLock lock(replicationMutex);
             nodeState.componentStates_.Erase(current);
         }
         else
@@ -1284,6 +2028,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     component->WriteLatestDataUpdate(msg_, timeStamp_);
                     
                     SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
+                    AddComponentTraffic(component, msg_.GetSize(), true);
                 }
                 
                 // Send deltaupdate if remaining dirty bits
@@ -1294,6 +2039,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
                     
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
+                    AddComponentTraffic(component, msg_.GetSize(), true);
                     
                     componentState.dirtyAttributes_.ClearAll();
                 }
@@ -1319,8 +2065,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
                 componentState.connection_ = this;
                 componentState.nodeState_ = &nodeState;
-                componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                {
+                    MutexLock lock(replicationMutex);
+                    componentState.component_ = component;
+                    component->AddReplicationState(&componentState);
+                }
                 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
@@ -1329,6 +2078,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 component->WriteInitialDeltaUpdate(msg_, timeStamp_);
                 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
+                AddComponentTraffic(component, msg_.GetSize(), true);
             }
         }
     }
@@ -1337,6 +2087,114 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     sceneState_.dirtyNodes_.Erase(node->GetID());
 }
 
+void Connection::UpdateInterest(InterestGrid* interestGrid)
+{
+    PROFILE(UpdateInterest);
+    
+    if (!interestActive_)
+    {
+        // Interest management was turned on: treat the nodes sent so far as being within interest, so that the ones
+        // outside get removed from the client
+        interestActive_ = true;
+        interestNodes_.Clear();
+        for (HashMap<unsigned, NodeReplicationState>::ConstIterator i = sceneState_.nodeStates_.Begin();
+            i != sceneState_.nodeStates_.End(); ++i)
+        {
+            Node* node = i->second_.node_;
+            if (node && node->GetParent() == scene_)
+                interestNodes_.Insert(i->first_);
+        }
+    }
+    
+    newInterestNodes_.Clear();
+    interestGrid->GetNodes(newInterestNodes_, position_, interestRadius_);
+    
+    // Nodes owned by this connection are always within interest
+    const PODVector<unsigned>* ownedNodes = interestGrid->GetOwnedNodes(this);
+    if (ownedNodes)
+    {
+        for (PODVector<unsigned>::ConstIterator i = ownedNodes->Begin(); i != ownedNodes->End(); ++i)
+            newInterestNodes_.Insert(*i);
+    }
+    
+    // After the swap, newInterestNodes_ holds the previous interest set
+    interestNodes_.Swap(newInterestNodes_);
+    
+    for (HashSet<unsigned>::ConstIterator i = newInterestNodes_.Begin(); i != newInterestNodes_.End(); ++i)
+    {
+        if (!interestNodes_.Contains(*i))
+        {
+            // Removed nodes are handled by the normal update. A node that was moved into a hierarchy still within
+            // interest is kept
+            Node* node = scene_->GetNode(*i);
+            if (node && (node->GetParent() == scene_ || !IsInInterest(node)))
+                RemoveFromInterest(node);
+        }
+    }
+    
+    for (HashSet<unsigned>::ConstIterator i = interestNodes_.Begin(); i != interestNodes_.End(); ++i)
+    {
+        if (!newInterestNodes_.Contains(*i))
+        {
+            Node* node = scene_->GetNode(*i);
+            if (node)
+                MarkHierarchyDirty(node, sceneState_.dirtyNodes_);
+        }
+    }
+}
+
+void Connection::RemoveFromInterest(Node* node)
+{
+    // Removing the root of the hierarchy on the client also removes its children
+    msg_.Clear();
+    msg_.WriteNetID(node->GetID());
+    SendMessage(MSG_REMOVENODE, true, true, msg_);
+    
+    PODVector<Node*> nodes;
+    node->GetChildren(nodes, true);
+    nodes.Push(node);
+    
+    MutexLock lock(replicationMutex);
+    
+    for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        unsigned nodeID = (*i)->GetID();
+        if (nodeID >= FIRST_LOCAL_ID)
+            continue;
+        
+        sceneState_.dirtyNodes_.Erase(nodeID);
+        nodesToProcess_.Erase(nodeID);
+        
+        HashMap<unsigned, NodeReplicationState>::Iterator j = sceneState_.nodeStates_.Find(nodeID);
+        if (j == sceneState_.nodeStates_.End())
+            continue;
+        
+        // Detach the replication states, so that the node and its components no longer mark this connection dirty
+        NodeReplicationState& nodeState = j->second_;
+        for (HashMap<unsigned, ComponentReplicationState>::Iterator k = nodeState.componentStates_.Begin();
+            k != nodeState.componentStates_.End(); ++k)
+        {
+            Component* component = k->second_.component_;
+            if (component)
+                component->RemoveReplicationState(&k->second_);
+        }
+        (*i)->RemoveReplicationState(&nodeState);
+        sceneState_.nodeStates_.Erase(j);
+    }
+}
+
+bool Connection::IsInInterest(Node* node) const
+{
+    if (!interestActive_)
+        return true;
+    
+    // Interest is decided by the top-level node of the hierarchy
+    while (node->GetParent() && node->GetParent() != scene_)
+        node = node->GetParent();
+    
+    return node == scene_.Get() || interestNodes_.Contains(node->GetID());
+}
+
 bool Connection::RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
@@ -1416,17 +2274,143 @@ void Connection::RequestPackage(const String& name, unsigned fileSize, unsigned
     
     PackageDownload& download = downloads_[nameHash];
     download.name_ = name;
-    download.totalFragments_ = (fileSize + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+    download.fileSize_ = fileSize;
     download.checksum_ = checksum;
     
-    // Start download now only if no existing downloads, else wait for the existing ones to finish
-    if (downloads_.Size() == 1)
+    StartPackageDownloads();
+}
+
+bool Connection::StartPackageDownload(PackageDownload& download)
+{
+    // The data goes to a partial file first. It is kept on disconnect, so that the download can later be resumed
+    String partName = GetPackageCacheFileName(GetSubsystem<Network>()->GetPackageCacheDir(), download) + ".part";
+    download.file_ = new File(context_, partName, FILE_READWRITE);
+    if (!download.file_->IsOpen())
+        return false;
+    
+    // Discard a partial file that can not be the beginning of this package
+    unsigned offset = download.file_->GetSize();
+    if (offset > download.fileSize_)
     {
-        LOGINFO("Requesting package " + name + " from server");
-        msg_.Clear();
-        msg_.WriteString(name);
-        SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-        download.initiated_ = true;
+        if (!download.file_->Open(partName, FILE_WRITE))
+            return false;
+        offset = 0;
+    }
+    download.file_->Seek(offset);
+    download.receivedBytes_ = offset;
+    download.initiated_ = true;
+    
+    if (offset)
+        LOGINFO("Resuming download of package " + download.name_ + " from server at offset " + String(offset));
+    else
+        LOGINFO("Requesting package " + download.name_ + " from server");
+    
+    msg_.Clear();
+    msg_.WriteString(download.name_);
+    msg_.WriteUInt(offset);
+    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
+    return true;
+}
+
+void Connection::StartPackageDownloads()
+{
+    unsigned numInitiated = 0;
+    for (HashMap<StringHash, PackageDownload>::ConstIterator i = downloads_.Begin(); i != downloads_.End(); ++i)
+    {
+        if (i->second_.initiated_)
+            ++numInitiated;
+    }
+    
+    for (HashMap<StringHash, PackageDownload>::Iterator i = downloads_.Begin(); i != downloads_.End() &&
+        numInitiated < MAX_PACKAGE_DOWNLOADS; ++i)
+    {
+        if (i->second_.initiated_)
+            continue;
+        
+        if (!StartPackageDownload(i->second_))
+        {
+            OnPackageDownloadFailed(i->second_.name_);
+            return;
+        }
+        ++numInitiated;
+    }
+}
+
+void Connection::ProcessPendingDownloads()
+{
+    if (downloads_.Empty())
+        return;
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    const String& packageCacheDir = GetSubsystem<Network>()->GetPackageCacheDir();
+    bool finished = false;
+    
+    for (HashMap<StringHash, PackageDownload>::Iterator i = downloads_.Begin(); i != downloads_.End();)
+    {
+        PackageDownload& download = i->second_;
+        if (!download.verifyItem_ || !download.verifyItem_->completed_)
+        {
+            ++i;
+            continue;
+        }
+        
+        // Release the package file before renaming it
+        String fileName = GetPackageCacheFileName(packageCacheDir, download);
+        String partName = fileName + ".part";
+        download.verifyItem_.Reset();
+        download.package_.Reset();
+        
+        if (!download.verified_)
+        {
+            LOGERROR("Checksum of downloaded package " + download.name_ + " does not match");
+            fileSystem->Delete(partName);
+            OnPackageDownloadFailed(download.name_);
+            return;
+        }
+        
+        if (fileSystem->FileExists(fileName))
+            fileSystem->Delete(fileName);
+        if (!fileSystem->Rename(partName, fileName))
+        {
+            OnPackageDownloadFailed(download.name_);
+            return;
+        }
+        
+        LOGINFO("Package " + download.name_ + " downloaded successfully");
+        
+        // Instantiate the package and add to the resource system, as we will need it to load the scene
+        GetSubsystem<ResourceCache>()->AddPackageFile(fileName, true);
+        i = downloads_.Erase(i);
+        finished = true;
+    }
+    
+    // Then start the next downloads if there are more
+    if (finished)
+    {
+        if (downloads_.Empty())
+            OnPackagesReady();
+        else
+            StartPackageDownloads();
+    }
+}
+
+void Connection::StopPackageVerifications()
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    
+    for (HashMap<StringHash, PackageDownload>::Iterator i = downloads_.Begin(); i != downloads_.End(); ++i)
+    {
+        PackageDownload& download = i->second_;
+        if (!download.verifyItem_)
+            continue;
+        
+        if (!queue->RemoveWorkItem(download.verifyItem_))
+        {
+            while (!download.verifyItem_->completed_)
+                Time::Sleep(1);
+        }
+        download.verifyItem_.Reset();
+        download.package_.Reset();
     }
 }
 
@@ -1451,7 +2435,9 @@ void Connection::OnSceneLoadFailed()
 void Connection::OnPackageDownloadFailed(const String& name)
 {
     LOGERROR("Download of package " + name + " failed");
-    // As one package failed, we can not join the scene in any case. Clear the downloads
+    // As one package failed, we can not join the scene in any case. Clear the downloads. Their partial files are kept for
+    // resuming later
+    StopPackageVerifications();
     downloads_.Clear();
     OnSceneLoadFailed();
 }
@@ -1507,4 +2493,54 @@ void Connection::ProcessPackageInfo(int msgID, MemoryBuffer& msg)
     RequestNeededPackages(1, msg);
 }
 
+void Connection::AddMessageTraffic(int msgID, unsigned bytes)
+{
+    if (trafficProfiling_)
+    {
+        TrafficStats& stats = messageTraffic_[msgID];
+        ++stats.messagesReceived_;
+        stats.bytesReceived_ += bytes;
+    }
+}
+
+void Connection::AddNodeTraffic(unsigned nodeID, unsigned bytes, bool sent)
+{
+    if (!trafficProfiling_)
+        return;
+    
+    TrafficStats& stats = nodeTraffic_[nodeID];
+    if (sent)
+    {
+        ++stats.messagesSent_;
+        stats.bytesSent_ += bytes;
+    }
+    else
+    {
+        ++stats.messagesReceived_;
+        stats.bytesReceived_ += bytes;
+    }
+}
+
+void Connection::AddComponentTraffic(Component* component, unsigned bytes, bool sent)
+{
+    if (!trafficProfiling_)
+        return;
+    
+    TrafficStats& stats = componentTraffic_[component->GetType()];
+    if (sent)
+    {
+        ++stats.messagesSent_;
+        stats.bytesSent_ += bytes;
+    }
+    else
+    {
+        ++stats.messagesReceived_;
+        stats.bytesReceived_ += bytes;
+    }
+    
+    Node* node = component->GetNode();
+    if (node)
+        AddNodeTraffic(node->GetID(), bytes, sent);
+}
+
 }
@@ -39,12 +39,15 @@
 namespace Urho3D
 {
 
+class Component;
 class File;
 class MemoryBuffer;
+class InterestGrid;
 class Node;
 class Scene;
 class Serializable;
 class PackageFile;
+struct WorkItem;
 
 /// Queued remote event.
 struct RemoteEvent
@@ -65,18 +68,24 @@ struct PackageDownload
     /// Construct with defaults.
     PackageDownload();
     
-    /// Destination file.
+    /// Destination file, written under a temporary name until the download is complete and verified.
     SharedPtr<File> file_;
-    /// Already received fragments.
-    HashSet<unsigned> receivedFragments_;
+    /// Downloaded package being verified.
+    SharedPtr<PackageFile> package_;
+    /// Checksum verification work item.
+    SharedPtr<WorkItem> verifyItem_;
     /// Package name.
     String name_;
-    /// Total number of fragments.
-    unsigned totalFragments_;
+    /// Total size in bytes.
+    unsigned fileSize_;
+    /// Received bytes, including those of an earlier partial download.
+    unsigned receivedBytes_;
     /// Checksum.
     unsigned checksum_;
     /// Download initiated flag.
     bool initiated_;
+    /// Checksum verification result. Written by the work item.
+    bool verified_;
 };
 
 /// Package file send transfer.
@@ -85,12 +94,71 @@ struct PackageUpload
     /// Construct with defaults.
     PackageUpload();
     
-    /// Source file.
+    /// Source file. Its position is the offset of the next fragment.
     SharedPtr<File> file_;
-    /// Current fragment index.
-    unsigned fragment_;
-    /// Total number of fragments
-    unsigned totalFragments_;
+};
+
+/// Traffic byte and message counters of a message type, node or component type.
+struct TrafficStats
+{
+    /// Construct with zero counters.
+    TrafficStats() :
+        messagesSent_(0),
+        bytesSent_(0),
+        messagesReceived_(0),
+        bytesReceived_(0)
+    {
+    }
+    
+    /// Add another set of counters.
+    void Add(const TrafficStats& rhs)
+    {
+        messagesSent_ += rhs.messagesSent_;
+        bytesSent_ += rhs.bytesSent_;
+        messagesReceived_ += rhs.messagesReceived_;
+        bytesReceived_ += rhs.bytesReceived_;
+    }
+    
+    /// Number of messages sent.
+    unsigned messagesSent_;
+    /// Payload bytes sent.
+    unsigned bytesSent_;
+    /// Number of messages received.
+    unsigned messagesReceived_;
+    /// Payload bytes received.
+    unsigned bytesReceived_;
+};
+
+/// Received message, decoded by a worker thread and waiting to be applied in the main thread.
+struct DecodedMessage
+{
+    /// Construct with defaults.
+    DecodedMessage();
+    
+    /// kNet message holding the raw data. Freed after applying.
+    kNet::NetworkMessage* message_;
+    /// Message ID.
+    int msgID_;
+    /// Decoded flag. If false, the raw data is processed in the main thread.
+    bool decoded_;
+    /// Remote events. A batch message may contain several.
+    Vector<RemoteEvent> remoteEvents_;
+    /// Identity data.
+    VariantMap eventData_;
+    /// Client controls.
+    Controls controls_;
+    /// Client controls timestamp.
+    unsigned char timeStamp_;
+    /// Observer position.
+    Vector3 position_;
+    /// Observer rotation.
+    Quaternion rotation_;
+    /// Observer position included flag.
+    bool hasPosition_;
+    /// Observer rotation included flag.
+    bool hasRotation_;
+    /// Decompressed initial scene state.
+    PODVector<unsigned char> data_;
 };
 
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
@@ -130,14 +198,22 @@ public:
     void SetPosition(const Vector3& position);
     /// Set the observer rotation for interest management, to be sent to the server. Note: not used by the NetworkPriority component.
     void SetRotation(const Quaternion& rotation);
+    /// Set the node controlled by this client for client-side prediction. Its server updates are applied without smoothing, followed by the E_NETWORKRECONCILE event.
+    void SetPredictedNode(Node* node);
+    /// Set the radius around the observer position within which nodes are replicated, when spatial interest management is used on the server. 0 (default) replicates all nodes.
+    void SetInterestRadius(float radius);
     /// Set the connection pending status. Called by Network.
     void SetConnectPending(bool connectPending);
     /// Set whether to log data in/out statistics.
     void SetLogStatistics(bool enable);
+    /// Set whether to count sent and received bytes per message ID, node and component type.
+    void SetTrafficProfiling(bool enable);
+    /// Reset the traffic counters.
+    void ResetTrafficStats();
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
-    /// Send scene update messages. Called by Network.
-    void SendServerUpdate();
+    /// Send scene update messages, optionally restricted by a spatial interest grid. Called by Network, possibly from a worker thread in parallel with other connections.
+    void SendServerUpdate(InterestGrid* interestGrid = 0);
     /// Send latest controls from the client. Called by Network.
     void SendClientUpdate();
     /// Send queued remote events. Called by Network.
@@ -146,8 +222,16 @@ public:
     void SendPackages();
     /// Process pending latest data for nodes and components.
     void ProcessPendingLatestData();
+    /// Finish package downloads whose checksum verification has completed. Called by Network.
+    void ProcessPendingDownloads();
     /// Process a message from the server or client. Called by Network.
     bool ProcessMessage(int msgID, MemoryBuffer& msg);
+    /// Take received messages from the kNet connection for decoding. Called by Network.
+    void ReceiveMessages();
+    /// Decode the received messages. Called by Network, possibly from a worker thread in parallel with other connections.
+    void DecodeMessages();
+    /// Apply the decoded messages in the order they were received. Called by Network.
+    void ApplyMessages();
     
     /// Return the kNet message connection.
     kNet::MessageConnection* GetMessageConnection() const;
@@ -159,10 +243,22 @@ public:
     const Controls& GetControls() const { return controls_; }
     /// Return the controls timestamp, sent from client to server along each control update.
     unsigned char GetTimeStamp() const { return timeStamp_; }
+    /// Return the predicted node.
+    Node* GetPredictedNode() const;
+    /// Return the latest controls timestamp the server had received, as reported along the predicted node's last update.
+    unsigned char GetAckedTimeStamp() const { return ackedTimeStamp_; }
+    /// Return number of sent controls the server had not yet received at the predicted node's last update.
+    unsigned GetNumUnackedControls() const;
+    /// Return sent controls not yet received by the server by index, oldest first. Return the current controls if index is out of range.
+    const Controls& GetUnackedControls(unsigned index) const;
     /// Return the observer position sent by the client for interest management.
     const Vector3& GetPosition() const { return position_; }
     /// Return the observer rotation sent by the client for interest management.
     const Quaternion& GetRotation() const { return rotation_; }
+    /// Return the interest management radius.
+    float GetInterestRadius() const { return interestRadius_; }
+    /// Return number of top-level nodes currently within interest.
+    unsigned GetNumInterestNodes() const { return interestNodes_.Size(); }
     /// Return whether is a client connection.
     bool IsClient() const { return isClient_; }
     /// Return whether is fully connected.
@@ -173,6 +269,16 @@ public:
     bool IsSceneLoaded() const { return sceneLoaded_; }
     /// Return whether to log data in/out statistics.
     bool GetLogStatistics() const { return logStatistics_; }
+    /// Return whether traffic profiling is enabled.
+    bool GetTrafficProfiling() const { return trafficProfiling_; }
+    /// Return traffic counters by message ID.
+    const HashMap<int, TrafficStats>& GetMessageTraffic() const { return messageTraffic_; }
+    /// Return scene replication traffic counters by node ID. Includes the node's component messages.
+    const HashMap<unsigned, TrafficStats>& GetNodeTraffic() const { return nodeTraffic_; }
+    /// Return scene replication traffic counters by component type.
+    const HashMap<StringHash, TrafficStats>& GetComponentTraffic() const { return componentTraffic_; }
+    /// Return total traffic counters of all messages.
+    TrafficStats GetTotalTraffic() const;
     /// Return remote address.
     String GetAddress() const { return address_; }
     /// Return remote port.
@@ -207,57 +313,123 @@ private:
     void ProcessSceneChecksumError(int msgID, MemoryBuffer& msg);
     /// Process a scene update message from the server. Called by Network.
     void ProcessSceneUpdate(int msgID, MemoryBuffer& msg);
+    /// Decompress the initial scene state of a CreateNodes message. Return true on success.
+    bool DecompressInitialState(MemoryBuffer& msg, PODVector<unsigned char>& data);
+    /// Process the node creations of a decompressed initial scene state.
+    void ProcessInitialStateNodes(const PODVector<unsigned char>& data);
+    /// Apply a time-stamped node latest data update from the server.
+    void ProcessNodeLatestData(Node* node, unsigned short serverTime, MemoryBuffer& msg);
     /// Process package download related messages. Called by Network.
     void ProcessPackageDownload(int msgID, MemoryBuffer& msg);
     /// Process an Identity message from the client. Called by Network.
     void ProcessIdentity(int msgID, MemoryBuffer& msg);
     /// Process a Controls message from the client. Called by Network.
     void ProcessControls(int msgID, MemoryBuffer& msg);
+    /// Apply decoded client controls.
+    void ApplyControls(const DecodedMessage& message);
     /// Process a SceneLoaded message from the client. Called by Network.
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Send a decoded remote event if it is allowed.
+    void ApplyRemoteEvent(RemoteEvent& remoteEvent);
+    /// Queue a remote event, or replace the data of an already queued event if the event type is coalesced.
+    void QueueRemoteEvent(unsigned senderID, StringHash eventType, bool inOrder, const VariantMap& eventData);
+    /// Send the queued remote events of one ordering mode batched in MSG_REMOTEEVENTS messages.
+    void SendRemoteEventBatches(bool inOrder);
+    /// Decode a received message if its type can be decoded outside the main thread.
+    void DecodeMessage(DecodedMessage& message);
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
     /// Process a node that the client has not yet received.
     void ProcessNewNode(Node* node);
+    /// Process the dirty nodes during the bulk initial state transfer, nearest to the observer first and deferring new nodes over the budget.
+    void ProcessInitialState(unsigned budget);
+    /// Compress and send the buffered node creations of the bulk initial state transfer.
+    void FlushInitialState();
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Update the set of top-level nodes within interest and queue nodes that entered or left it.
+    void UpdateInterest(InterestGrid* interestGrid);
+    /// Send removal of a node hierarchy that left interest and forget its replication state.
+    void RemoveFromInterest(Node* node);
+    /// Return whether a node is within interest.
+    bool IsInInterest(Node* node) const;
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set)
     bool RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg);
-    /// Initiate a package download.
+    /// Queue a package download and start it if there are free download slots.
     void RequestPackage(const String& name, unsigned fileSize, unsigned checksum);
+    /// Open the partial file of a package download and request the rest of the data from the server. Return true on success.
+    bool StartPackageDownload(PackageDownload& download);
+    /// Start more queued package downloads if there are free download slots.
+    void StartPackageDownloads();
+    /// Cancel or wait for the package checksum verifications still in progress.
+    void StopPackageVerifications();
     /// Send an error reply for a package download.
     void SendPackageError(const String& name);
     /// Handle scene load failure on the server or client.
     void OnSceneLoadFailed();
     /// Handle a package download failure on the client.
     void OnPackageDownloadFailed(const String& name);
+    /// Handle a received client identity by sending the identity event, and disconnect if it is denied.
+    void OnIdentityReceived();
     /// Handle all packages loaded successfully. Also called directly on MSG_LOADSCENE if there are none.
     void OnPackagesReady();
+    /// Count received traffic of a message ID.
+    void AddMessageTraffic(int msgID, unsigned bytes);
+    /// Count scene replication traffic of a node.
+    void AddNodeTraffic(unsigned nodeID, unsigned bytes, bool sent);
+    /// Count scene replication traffic of a component, also to its node.
+    void AddComponentTraffic(Component* component, unsigned bytes, bool sent);
     
     /// kNet message connection.
     kNet::SharedPtr<kNet::MessageConnection> connection_;
     /// Scene.
     WeakPtr<Scene> scene_;
+    /// Node controlled by this client for client-side prediction.
+    WeakPtr<Node> predictedNode_;
+    /// Sent controls indexed by timestamp.
+    Vector<Controls> controlsHistory_;
     /// Network replication state of the scene.
     SceneReplicationState sceneState_;
     /// Waiting or ongoing package file receive transfers.
     HashMap<StringHash, PackageDownload> downloads_;
     /// Ongoing package send transfers.
     HashMap<StringHash, PackageUpload> uploads_;
+    /// Current package fragment size, adapted to how fast the connection drains the outbound queue.
+    unsigned packageFragmentSize_;
+    /// Outbound messages pending at the previous package send.
+    unsigned packageMessagesPending_;
     /// Pending latest data for not yet received nodes.
     HashMap<unsigned, PODVector<unsigned char> > nodeLatestData_;
     /// Pending latest data for not yet received components.
     HashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
     /// Node ID's to process during a replication update.
     HashSet<unsigned> nodesToProcess_;
+    /// Top-level node ID's within interest.
+    HashSet<unsigned> interestNodes_;
+    /// Top-level node ID's within interest on the current update.
+    HashSet<unsigned> newInterestNodes_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Buffered node creations of the bulk initial state transfer.
+    VectorBuffer initialStateBuffer_;
+    /// Compressed initial state chunk buffer.
+    VectorBuffer initialStateChunk_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
+    /// Indices of queued coalesced remote events by sender node ID and event type.
+    HashMap<Pair<unsigned, StringHash>, unsigned> coalescedEvents_;
+    /// Received messages waiting to be decoded and applied.
+    Vector<DecodedMessage> receivedMessages_;
+    /// Traffic counters by message ID.
+    HashMap<int, TrafficStats> messageTraffic_;
+    /// Traffic counters by node ID.
+    HashMap<unsigned, TrafficStats> nodeTraffic_;
+    /// Traffic counters by component type.
+    HashMap<StringHash, TrafficStats> componentTraffic_;
     /// Scene file to load once all packages (if any) have been downloaded.
     String sceneFileName_;
     /// Statistics timer.
@@ -270,6 +442,14 @@ private:
     Vector3 position_;
     /// Observer rotation for interest management.
     Quaternion rotation_;
+    /// Interest management radius.
+    float interestRadius_;
+    /// Server time of the update being sent.
+    unsigned short serverTime_;
+    /// Uncompressed initial state bytes sent on the current update.
+    unsigned initialStateBytes_;
+    /// Latest controls timestamp received by the server, as reported along the predicted node's update.
+    unsigned char ackedTimeStamp_;
     /// Send mode for the observer position & rotation.
     ObserverPositionSendMode sendMode_;
     /// Client connection flag.
@@ -280,6 +460,14 @@ private:
     bool sceneLoaded_;
     /// Show statistics flag.
     bool logStatistics_;
+    /// Traffic profiling flag.
+    bool trafficProfiling_;
+    /// Interest management in use on the current update flag.
+    bool interestActive_;
+    /// Bulk initial state transfer in progress flag.
+    bool initialState_;
+    /// Buffering node creations for the bulk initial state transfer on the current update flag.
+    bool bulkTransfer_;
 };
 
 }
@@ -0,0 +1,782 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Network/HttpClient.h"
+#include "../Network/HttpRequest.h"
+#include "../Core/StringUtils.h"
+#include "../Core/Timer.h"
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+#ifdef WIN32
+typedef SOCKET SocketHandle;
+#else
+typedef int SocketHandle;
+static const SocketHandle INVALID_SOCKET = -1;
+#endif
+
+/// Maximum simultaneous connections to one host.
+static const unsigned MAX_CONNECTIONS_PER_HOST = 6;
+/// Time after which an idle connection is closed.
+static const unsigned KEEP_ALIVE_MSEC = 30000;
+/// Maximum time to wait for socket activity, so that new requests and freed read buffer space are noticed.
+static const unsigned SELECT_TIMEOUT_MSEC = 5;
+/// Time to sleep when there are no connections.
+static const unsigned IDLE_SLEEP_MSEC = 5;
+/// Maximum received data buffered per connection before the request has read buffer space for it.
+static const unsigned INPUT_BUFFER_SIZE = 16384;
+/// Maximum size of the response headers.
+static const unsigned MAX_HEADERS_SIZE = 65536;
+
+/// HTTP response parsing state.
+enum HttpParseState
+{
+    HPS_HEADERS = 0,
+    HPS_BODY,
+    HPS_CHUNK_SIZE,
+    HPS_CHUNK_DATA,
+    HPS_CHUNK_END,
+    HPS_TRAILERS
+};
+
+/// Socket connection to a host, serving one request at a time and kept open between requests if the server allows.
+struct HttpConnection
+{
+    /// Construct.
+    HttpConnection(SocketHandle socket, const String& hostKey) :
+        socket_(socket),
+        hostKey_(hostKey),
+        request_(0),
+        outputPosition_(0),
+        parseState_(HPS_HEADERS),
+        bodyRemaining_(0),
+        untilClose_(false),
+        keepAlive_(false),
+        connected_(false),
+        reused_(false),
+        received_(false),
+        closed_(false),
+        closing_(false)
+    {
+    }
+    
+    /// Socket.
+    SocketHandle socket_;
+    /// Host name and port.
+    String hostKey_;
+    /// Current request, or null if idle.
+    HttpRequest* request_;
+    /// Request data to send.
+    String output_;
+    /// Sent bytes of the request data.
+    unsigned outputPosition_;
+    /// Received data not yet parsed or passed to the request.
+    PODVector<unsigned char> input_;
+    /// Response parsing state.
+    HttpParseState parseState_;
+    /// Remaining bytes of the response body or current chunk.
+    unsigned bodyRemaining_;
+    /// Response body ends when the server closes the connection.
+    bool untilClose_;
+    /// Connection can be reused after the response.
+    bool keepAlive_;
+    /// Non-blocking connect has completed.
+    bool connected_;
+    /// Connection has served an earlier request.
+    bool reused_;
+    /// Data of the current response has been received.
+    bool received_;
+    /// Server has closed the connection.
+    bool closed_;
+    /// Connection should be closed by the worker thread.
+    bool closing_;
+    /// Time since the connection became idle.
+    Timer idleTimer_;
+};
+
+static void CloseSocket(SocketHandle socket)
+{
+    #ifdef WIN32
+    closesocket(socket);
+    #else
+    close(socket);
+    #endif
+}
+
+static bool IsWouldBlockError()
+{
+    #ifdef WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+    #else
+    return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINPROGRESS || errno == EINTR;
+    #endif
+}
+
+static String GetHostKey(const String& host, int port)
+{
+    return host.ToLower() + ":" + String(port);
+}
+
+static unsigned FindLineEnd(const PODVector<unsigned char>& data, unsigned start = 0)
+{
+    for (unsigned i = start; i + 1 < data.Size(); ++i)
+    {
+        if (data[i] == '\r' && data[i + 1] == '\n')
+            return i;
+    }
+    return M_MAX_UNSIGNED;
+}
+
+HttpClient::HttpClient()
+{
+}
+
+HttpClient::~HttpClient()
+{
+    Stop();
+    
+    for (unsigned i = 0; i < connections_.Size(); ++i)
+    {
+        CloseSocket(connections_[i]->socket_);
+        delete connections_[i];
+    }
+    connections_.Clear();
+}
+
+void HttpClient::ThreadFunction()
+{
+    while (shouldRun_)
+    {
+        ResolveHosts();
+        
+        fd_set readSet;
+        fd_set writeSet;
+        fd_set exceptSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        FD_ZERO(&exceptSet);
+        int maxSocket = 0;
+        bool hasSockets = false;
+        
+        {
+            MutexLock lock(mutex_);
+            
+            CloseConnections();
+            StartRequests();
+            
+            for (unsigned i = 0; i < connections_.Size(); ++i)
+            {
+                HttpConnection* connection = connections_[i];
+                if (connection->closing_)
+                    continue;
+                
+                // Stop reading when the request can not take more data, so that the server is throttled by TCP
+                if (connection->connected_ && !connection->closed_ && connection->input_.Size() < INPUT_BUFFER_SIZE)
+                    FD_SET(connection->socket_, &readSet);
+                if (!connection->connected_ || connection->outputPosition_ < connection->output_.Length())
+                    FD_SET(connection->socket_, &writeSet);
+                // Windows reports a failed non-blocking connect as an exception
+                if (!connection->connected_)
+                    FD_SET(connection->socket_, &exceptSet);
+                
+                maxSocket = Max(maxSocket, (int)connection->socket_);
+                hasSockets = true;
+            }
+        }
+        
+        if (!hasSockets)
+        {
+            Time::Sleep(IDLE_SLEEP_MSEC);
+            continue;
+        }
+        
+        timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = SELECT_TIMEOUT_MSEC * 1000;
+        if (select(maxSocket + 1, &readSet, &writeSet, &exceptSet, &timeout) < 0)
+        {
+            FD_ZERO(&readSet);
+            FD_ZERO(&writeSet);
+            FD_ZERO(&exceptSet);
+        }
+        
+        MutexLock lock(mutex_);
+        
+        // Connections may have been marked for closing meanwhile, but only this thread closes them
+        for (unsigned i = 0; i < connections_.Size(); ++i)
+        {
+            HttpConnection* connection = connections_[i];
+            if (!connection->closing_)
+            {
+                ProcessConnection(connection, FD_ISSET(connection->socket_, &readSet) != 0, FD_ISSET(connection->socket_,
+                    &writeSet) != 0, FD_ISSET(connection->socket_, &exceptSet) != 0);
+            }
+        }
+    }
+}
+
+void HttpClient::AddRequest(HttpRequest* request)
+{
+    {
+        MutexLock lock(mutex_);
+        queuedRequests_.Push(request);
+    }
+    
+    if (!IsStarted())
+        Run();
+}
+
+void HttpClient::RemoveRequest(HttpRequest* request)
+{
+    MutexLock lock(mutex_);
+    
+    queuedRequests_.Remove(request);
+    
+    for (unsigned i = 0; i < connections_.Size(); ++i)
+    {
+        if (connections_[i]->request_ == request)
+        {
+            // The rest of the response would have to be read before reuse, so just close
+            connections_[i]->request_ = 0;
+            connections_[i]->closing_ = true;
+        }
+    }
+}
+
+unsigned HttpClient::GetNumQueuedRequests() const
+{
+    MutexLock lock(mutex_);
+    return queuedRequests_.Size();
+}
+
+unsigned HttpClient::GetNumConnections() const
+{
+    MutexLock lock(mutex_);
+    return connections_.Size();
+}
+
+unsigned HttpClient::GetNumIdleConnections() const
+{
+    MutexLock lock(mutex_);
+    
+    unsigned numIdle = 0;
+    for (unsigned i = 0; i < connections_.Size(); ++i)
+    {
+        if (!connections_[i]->request_ && !connections_[i]->closing_)
+            ++numIdle;
+    }
+    return numIdle;
+}
+
+void HttpClient::ResolveHosts()
+{
+    Vector<String> hosts;
+    
+    {
+        MutexLock lock(mutex_);
+        for (unsigned i = 0; i < queuedRequests_.Size(); ++i)
+        {
+            const String& host = queuedRequests_[i]->host_;
+            if (!resolvedHosts_.Contains(host) && !hosts.Contains(host))
+                hosts.Push(host);
+        }
+    }
+    
+    if (hosts.Empty())
+        return;
+    
+    // Resolve without holding the mutex, as the DNS query may block
+    PODVector<unsigned> addresses;
+    for (unsigned i = 0; i < hosts.Size(); ++i)
+    {
+        unsigned address = 0;
+        addrinfo hints;
+        memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = 0;
+        if (!getaddrinfo(hosts[i].CString(), 0, &hints, &result) && result)
+            address = ((sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+        if (result)
+            freeaddrinfo(result);
+        addresses.Push(address);
+    }
+    
+    MutexLock lock(mutex_);
+    
+    for (unsigned i = 0; i < hosts.Size(); ++i)
+    {
+        if (addresses[i])
+        {
+            resolvedHosts_[hosts[i]] = addresses[i];
+            continue;
+        }
+        
+        for (unsigned j = 0; j < queuedRequests_.Size();)
+        {
+            if (queuedRequests_[j]->host_ == hosts[i])
+            {
+                queuedRequests_[j]->SetState(HTTP_ERROR, "Could not resolve host " + hosts[i]);
+                queuedRequests_.Erase(j);
+            }
+            else
+                ++j;
+        }
+    }
+}
+
+void HttpClient::StartRequests()
+{
+    for (unsigned i = 0; i < queuedRequests_.Size();)
+    {
+        HttpRequest* request = queuedRequests_[i];
+        HashMap<String, unsigned>::ConstIterator address = resolvedHosts_.Find(request->host_);
+        if (address == resolvedHosts_.End())
+        {
+            ++i;
+            continue;
+        }
+        
+        // Prefer an idle connection to the same host, then a new connection if the host limit allows
+        String hostKey = GetHostKey(request->host_, request->port_);
+        HttpConnection* connection = 0;
+        unsigned numHostConnections = 0;
+        for (unsigned j = 0; j < connections_.Size(); ++j)
+        {
+            HttpConnection* candidate = connections_[j];
+            if (candidate->closing_ || candidate->hostKey_ != hostKey)
+                continue;
+            ++numHostConnections;
+            if (!candidate->request_ && !connection)
+                connection = candidate;
+        }
+        
+        if (!connection)
+        {
+            if (numHostConnections >= MAX_CONNECTIONS_PER_HOST)
+            {
+                ++i;
+                continue;
+            }
+            
+            connection = OpenConnection(hostKey, address->second_, request->port_);
+            if (!connection)
+            {
+                request->SetState(HTTP_ERROR, "Could not connect to " + hostKey);
+                queuedRequests_.Erase(i);
+                continue;
+            }
+        }
+        else
+            connection->reused_ = true;
+        
+        String& output = connection->output_;
+        output = request->verb_ + " " + request->path_ + " HTTP/1.1\r\n";
+        output += "Host: " + request->host_ + (request->port_ != 80 ? ":" + String(request->port_) : String::EMPTY) + "\r\n";
+        output += "Connection: keep-alive\r\n";
+        for (unsigned j = 0; j < request->headers_.Size(); ++j)
+        {
+            // Trim and only add non-empty header strings
+            String header = request->headers_[j].Trimmed();
+            if (header.Length())
+                output += header + "\r\n";
+        }
+        if (!request->postData_.Empty())
+            output += "Content-Length: " + String(request->postData_.Length()) + "\r\n";
+        output += "\r\n";
+        output += request->postData_;
+        
+        connection->request_ = request;
+        connection->outputPosition_ = 0;
+        connection->input_.Clear();
+        connection->parseState_ = HPS_HEADERS;
+        connection->bodyRemaining_ = 0;
+        connection->untilClose_ = false;
+        connection->keepAlive_ = false;
+        connection->received_ = false;
+        queuedRequests_.Erase(i);
+    }
+}
+
+HttpConnection* HttpClient::OpenConnection(const String& hostKey, unsigned address, int port)
+{
+    SocketHandle socketHandle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socketHandle == INVALID_SOCKET)
+        return 0;
+    
+    #ifdef WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(socketHandle, FIONBIO, &nonBlocking);
+    #else
+    fcntl(socketHandle, F_SETFL, fcntl(socketHandle, F_GETFL, 0) | O_NONBLOCK);
+    #ifdef SO_NOSIGPIPE
+    int noSigPipe = 1;
+    setsockopt(socketHandle, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof noSigPipe);
+    #endif
+    #endif
+    
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = address;
+    addr.sin_port = htons((unsigned short)port);
+    
+    if (connect(socketHandle, (sockaddr*)&addr, sizeof addr) != 0 && !IsWouldBlockError())
+    {
+        CloseSocket(socketHandle);
+        return 0;
+    }
+    
+    HttpConnection* connection = new HttpConnection(socketHandle, hostKey);
+    connections_.Push(connection);
+    return connection;
+}
+
+void HttpClient::ProcessConnection(HttpConnection* connection, bool readable, bool writable, bool failed)
+{
+    if (!connection->connected_)
+    {
+        if (!writable && !failed)
+            return;
+        
+        int error = 0;
+        socklen_t errorLength = sizeof error;
+        getsockopt(connection->socket_, SOL_SOCKET, SO_ERROR, (char*)&error, &errorLength);
+        if (failed || error)
+        {
+            FailConnection(connection, "Could not connect to " + connection->hostKey_);
+            return;
+        }
+        connection->connected_ = true;
+    }
+    
+    if (writable && connection->outputPosition_ < connection->output_.Length())
+    {
+        #ifdef MSG_NOSIGNAL
+        int flags = MSG_NOSIGNAL;
+        #else
+        int flags = 0;
+        #endif
+        int sent = send(connection->socket_, connection->output_.CString() + connection->outputPosition_,
+            connection->output_.Length() - connection->outputPosition_, flags);
+        if (sent < 0 && !IsWouldBlockError())
+        {
+            FailConnection(connection, "Could not send request to " + connection->hostKey_);
+            return;
+        }
+        if (sent > 0)
+            connection->outputPosition_ += sent;
+    }
+    
+    if (readable)
+    {
+        unsigned char buffer[INPUT_BUFFER_SIZE];
+        int received = recv(connection->socket_, (char*)buffer, INPUT_BUFFER_SIZE - connection->input_.Size(), 0);
+        if (received > 0)
+        {
+            unsigned oldSize = connection->input_.Size();
+            connection->input_.Resize(oldSize + received);
+            memcpy(&connection->input_[oldSize], buffer, received);
+            if (connection->request_)
+                connection->received_ = true;
+        }
+        else if (!received || !IsWouldBlockError())
+            connection->closed_ = true;
+    }
+    
+    // An idle connection closed by the server, or sending data outside a request, can not be reused
+    if (!connection->request_)
+    {
+        if (connection->closed_ || !connection->input_.Empty())
+            connection->closing_ = true;
+        return;
+    }
+    
+    // Parse also without new data, as the request may have made space in its read buffer
+    ProcessInput(connection);
+    
+    if (connection->request_ && connection->closed_)
+    {
+        if (connection->untilClose_ && connection->parseState_ == HPS_BODY)
+        {
+            // The response ends at the close once all data has been passed to the request
+            if (connection->input_.Empty())
+                FinishResponse(connection);
+        }
+        else
+            FailConnection(connection, "Connection to " + connection->hostKey_ + " closed before the response was complete");
+    }
+}
+
+void HttpClient::ProcessInput(HttpConnection* connection)
+{
+    PODVector<unsigned char>& input = connection->input_;
+    HttpRequest* request = connection->request_;
+    unsigned consumed = 0;
+    
+    while (connection->request_ && consumed < input.Size())
+    {
+        switch (connection->parseState_)
+        {
+        case HPS_HEADERS:
+            {
+                unsigned headersEnd = M_MAX_UNSIGNED;
+                for (unsigned i = consumed; i + 3 < input.Size(); ++i)
+                {
+                    if (input[i] == '\r' && input[i + 1] == '\n' && input[i + 2] == '\r' && input[i + 3] == '\n')
+                    {
+                        headersEnd = i;
+                        break;
+                    }
+                }
+                if (headersEnd == M_MAX_UNSIGNED)
+                {
+                    if (input.Size() - consumed > MAX_HEADERS_SIZE)
+                        FailConnection(connection, "Malformed response headers from " + connection->hostKey_);
+                    // Wait for the rest of the headers. The input buffer is allowed to grow until they are complete
+                    input.Erase(0, consumed);
+                    return;
+                }
+                
+                String headers((const char*)&input[consumed], headersEnd - consumed);
+                consumed = headersEnd + 4;
+                if (!ParseHeaders(connection, headers))
+                {
+                    FailConnection(connection, "Malformed response headers from " + connection->hostKey_);
+                    return;
+                }
+            }
+            break;
+            
+        case HPS_BODY:
+        case HPS_CHUNK_DATA:
+            {
+                unsigned size = Min((int)(input.Size() - consumed), (int)request->GetFreeSpace());
+                if (!connection->untilClose_)
+                    size = Min((int)size, (int)connection->bodyRemaining_);
+                if (!size)
+                {
+                    // Wait for the request to read data
+                    input.Erase(0, consumed);
+                    return;
+                }
+                
+                request->WriteResponseData(&input[consumed], size);
+                consumed += size;
+                if (connection->untilClose_)
+                    break;
+                
+                connection->bodyRemaining_ -= size;
+                if (!connection->bodyRemaining_)
+                {
+                    if (connection->parseState_ == HPS_BODY)
+                        FinishResponse(connection);
+                    else
+                        connection->parseState_ = HPS_CHUNK_END;
+                }
+            }
+            break;
+            
+        case HPS_CHUNK_SIZE:
+        case HPS_CHUNK_END:
+        case HPS_TRAILERS:
+            {
+                unsigned lineEnd = FindLineEnd(input, consumed);
+                if (lineEnd == M_MAX_UNSIGNED)
+                {
+                    input.Erase(0, consumed);
+                    return;
+                }
+                
+                String line((const char*)&input[consumed], lineEnd - consumed);
+                consumed = lineEnd + 2;
+                
+                if (connection->parseState_ == HPS_CHUNK_END)
+                    connection->parseState_ = HPS_CHUNK_SIZE;
+                else if (connection->parseState_ == HPS_TRAILERS)
+                {
+                    // Trailer headers are ignored, the response ends at an empty line
+                    if (line.Empty())
+                        FinishResponse(connection);
+                }
+                else
+                {
+                    // Ignore chunk extensions
+                    unsigned extension = line.Find(';');
+                    if (extension != String::NPOS)
+                        line = line.Substring(0, extension);
+                    line = line.Trimmed();
+                    if (line.Empty())
+                    {
+                        FailConnection(connection, "Malformed chunk size from " + connection->hostKey_);
+                        return;
+                    }
+                    connection->bodyRemaining_ = strtoul(line.CString(), 0, 16);
+                    connection->parseState_ = connection->bodyRemaining_ ? HPS_CHUNK_DATA : HPS_TRAILERS;
+                }
+            }
+            break;
+        }
+    }
+    
+    input.Erase(0, Min((int)consumed, (int)input.Size()));
+}
+
+bool HttpClient::ParseHeaders(HttpConnection* connection, const String& headers)
+{
+    Vector<String> lines = headers.Split('\n');
+    if (lines.Empty())
+        return false;
+    
+    // Status line, eg. "HTTP/1.1 200 OK"
+    Vector<String> status = lines[0].Trimmed().Split(' ');
+    if (status.Size() < 2 || !status[0].StartsWith("HTTP/", false))
+        return false;
+    int statusCode = ToInt(status[1]);
+    
+    // Informational responses are followed by the actual response
+    if (statusCode >= 100 && statusCode < 200)
+        return true;
+    
+    connection->keepAlive_ = status[0] != "HTTP/1.0";
+    bool chunked = false;
+    bool hasLength = false;
+    unsigned contentLength = 0;
+    
+    for (unsigned i = 1; i < lines.Size(); ++i)
+    {
+        unsigned colon = lines[i].Find(':');
+        if (colon == String::NPOS)
+            continue;
+        String name = lines[i].Substring(0, colon).Trimmed().ToLower();
+        String value = lines[i].Substring(colon + 1).Trimmed().ToLower();
+        
+        if (name == "content-length")
+        {
+            hasLength = true;
+            contentLength = ToUInt(value);
+        }
+        else if (name == "transfer-encoding")
+            chunked = value.Contains("chunked");
+        else if (name == "connection")
+        {
+            if (value.Contains("close"))
+                connection->keepAlive_ = false;
+            else if (value.Contains("keep-alive"))
+                connection->keepAlive_ = true;
+        }
+    }
+    
+    connection->request_->SetState(HTTP_OPEN);
+    
+    // Responses to HEAD and some status codes never have a body
+    if (connection->request_->verb_.Compare("HEAD", false) == 0 || statusCode == 204 || statusCode == 304)
+        FinishResponse(connection);
+    else if (chunked)
+        connection->parseState_ = HPS_CHUNK_SIZE;
+    else if (hasLength)
+    {
+        connection->parseState_ = HPS_BODY;
+        connection->bodyRemaining_ = contentLength;
+        if (!contentLength)
+            FinishResponse(connection);
+    }
+    else
+    {
+        connection->parseState_ = HPS_BODY;
+        connection->untilClose_ = true;
+        connection->keepAlive_ = false;
+    }
+    
+    return true;
+}
+
+void HttpClient::FinishResponse(HttpConnection* connection)
+{
+    connection->request_->SetState(HTTP_CLOSED);
+    connection->request_ = 0;
+    connection->output_.Clear();
+    connection->outputPosition_ = 0;
+    connection->parseState_ = HPS_HEADERS;
+    connection->idleTimer_.Reset();
+    if (!connection->keepAlive_ || connection->closed_)
+        connection->closing_ = true;
+}
+
+void HttpClient::FailConnection(HttpConnection* connection, const String& error)
+{
+    HttpRequest* request = connection->request_;
+    connection->request_ = 0;
+    connection->closing_ = true;
+    if (!request)
+        return;
+    
+    // The server may have closed an idle connection just as it was reused, so send the request again on a new connection
+    if (connection->reused_ && !connection->received_)
+    {
+        queuedRequests_.Insert(0, request);
+        return;
+    }
+    
+    request->SetState(HTTP_ERROR, error);
+    // The host address may have changed
+    if (!connection->connected_)
+        resolvedHosts_.Erase(request->host_);
+}
+
+void HttpClient::CloseConnections()
+{
+    for (unsigned i = 0; i < connections_.Size();)
+    {
+        HttpConnection* connection = connections_[i];
+        if (!connection->request_ && !connection->closing_ && connection->idleTimer_.GetMSec(false) > KEEP_ALIVE_MSEC)
+            connection->closing_ = true;
+        
+        if (connection->closing_)
+        {
+            CloseSocket(connection->socket_);
+            delete connection;
+            connections_.Erase(i);
+        }
+        else
+            ++i;
+    }
+}
+
+}
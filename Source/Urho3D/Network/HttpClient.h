@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Mutex.h"
+#include "../Container/RefCounted.h"
+#include "../Core/Thread.h"
+
+namespace Urho3D
+{
+
+class HttpRequest;
+struct HttpConnection;
+
+/// Worker thread that serves all HTTP requests with non-blocking sockets. Keeps finished HTTP/1.1 connections open for reuse by later requests to the same host.
+class URHO3D_API HttpClient : public RefCounted, public Thread
+{
+public:
+    /// Construct. The worker thread is started on the first request.
+    HttpClient();
+    /// Destruct. Stop the worker thread and close all connections.
+    ~HttpClient();
+    
+    /// Process the sockets in the worker thread until stopped.
+    virtual void ThreadFunction();
+    
+    /// Queue a request. Called by HttpRequest in the main thread.
+    void AddRequest(HttpRequest* request);
+    /// Remove a request, closing its connection if the response is not complete. Called by HttpRequest in the main thread.
+    void RemoveRequest(HttpRequest* request);
+    
+    /// Return number of requests waiting for a connection.
+    unsigned GetNumQueuedRequests() const;
+    /// Return number of open connections, including the idle ones.
+    unsigned GetNumConnections() const;
+    /// Return number of idle connections kept open for reuse.
+    unsigned GetNumIdleConnections() const;
+    
+private:
+    /// Resolve the host names of queued requests that have not been resolved yet. Called without the mutex held.
+    void ResolveHosts();
+    /// Assign queued requests to idle or new connections.
+    void StartRequests();
+    /// Open a new connection to a resolved host. Return null on failure.
+    HttpConnection* OpenConnection(const String& hostKey, unsigned address, int port);
+    /// Send or receive data and parse the response of a connection.
+    void ProcessConnection(HttpConnection* connection, bool readable, bool writable, bool failed);
+    /// Parse received data and pass the response body to the request.
+    void ProcessInput(HttpConnection* connection);
+    /// Parse the response headers. Return false if they are malformed.
+    bool ParseHeaders(HttpConnection* connection, const String& headers);
+    /// Finish the response of a connection, returning it to the idle pool if it can be reused.
+    void FinishResponse(HttpConnection* connection);
+    /// Handle a connection error. Retry the request on a new connection if a reused connection was closed before any response.
+    void FailConnection(HttpConnection* connection, const String& error);
+    /// Close connections marked for closing and idle connections that have expired.
+    void CloseConnections();
+    
+    /// Requests waiting for a connection.
+    PODVector<HttpRequest*> queuedRequests_;
+    /// Open connections. Only the worker thread creates and destroys them.
+    PODVector<HttpConnection*> connections_;
+    /// Resolved IPv4 addresses by host name.
+    HashMap<String, unsigned> resolvedHosts_;
+    /// Mutex for the requests and connections.
+    mutable Mutex mutex_;
+};
+
+}
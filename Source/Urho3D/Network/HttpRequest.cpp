@@ -20,28 +20,29 @@
 // THE SOFTWARE.
 //
 
+#include "../Network/HttpClient.h"
 #include "../Network/HttpRequest.h"
 #include "../IO/Log.h"
 #include "../Core/Profiler.h"
 #include "../Core/Timer.h"
 
-#include <Civetweb/civetweb.h>
-
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
-static const unsigned ERROR_BUFFER_SIZE = 256;
 static const unsigned READ_BUFFER_SIZE = 65536; // Must be a power of two
 
-HttpRequest::HttpRequest(const String& url, const String& verb, const Vector<String>& headers, const String& postData) :
+HttpRequest::HttpRequest(HttpClient* client, const String& url, const String& verb, const Vector<String>& headers,
+    const String& postData) :
+    client_(client),
     url_(url.Trimmed()),
     verb_(!verb.Empty() ? verb : "GET"),
     headers_(headers),
     postData_(postData),
+    path_("/"),
+    port_(80),
     state_(HTTP_INITIALIZING),
-    httpReadBuffer_(new unsigned char[READ_BUFFER_SIZE]),
     readBuffer_(new unsigned char[READ_BUFFER_SIZE]),
     readPosition_(0),
     writePosition_(0)
@@ -52,143 +53,45 @@ HttpRequest::HttpRequest(const String& url, const String& verb, const Vector<Str
     
     LOGDEBUG("HTTP " + verb_ + " request to URL " + url_);
     
-    // Start the worker thread to actually create the connection and read the response data.
-    Run();
-}
-
-HttpRequest::~HttpRequest()
-{
-    Stop();
-}
-
-void HttpRequest::ThreadFunction()
-{
     String protocol = "http";
-    String host;
-    String path = "/";
-    int port = 80;
-    
     unsigned protocolEnd = url_.Find("://");
     if (protocolEnd != String::NPOS)
     {
         protocol = url_.Substring(0, protocolEnd);
-        host = url_.Substring(protocolEnd + 3);
+        host_ = url_.Substring(protocolEnd + 3);
     }
     else
-        host = url_;
+        host_ = url_;
     
-    unsigned pathStart = host.Find('/');
+    unsigned pathStart = host_.Find('/');
     if (pathStart != String::NPOS)
     {
-        path = host.Substring(pathStart);
-        host = host.Substring(0, pathStart);
+        path_ = host_.Substring(pathStart);
+        host_ = host_.Substring(0, pathStart);
     }
     
-    unsigned portStart = host.Find(':');
+    unsigned portStart = host_.Find(':');
     if (portStart != String::NPOS)
     {
-        port = ToInt(host.Substring(portStart + 1));
-        host = host.Substring(0, portStart);
+        port_ = ToInt(host_.Substring(portStart + 1));
+        host_ = host_.Substring(0, portStart);
     }
     
-    char errorBuffer[ERROR_BUFFER_SIZE];
-    memset(errorBuffer, 0, sizeof(errorBuffer));
-    
-    String headersStr;
-    for (unsigned i = 0; i < headers_.Size(); ++i)
+    /// \todo HTTPS is not supported, as there is no TLS implementation
+    if (protocol.Compare("http", false))
     {
-        // Trim and only add non-empty header strings
-        String header = headers_[i].Trimmed();
-        if (header.Length())
-            headersStr += header + "\r\n";
-    }
-    
-    // Initiate the connection. This may block due to DNS query
-    /// \todo SSL mode will not actually work unless Civetweb's SSL mode is initialized with an external SSL DLL
-    mg_connection* connection = 0;
-    if (postData_.Empty())
-    {
-        connection = mg_download(host.CString(), port, protocol.Compare("https", false) ? 0 : 1, errorBuffer, sizeof(errorBuffer),
-            "%s %s HTTP/1.0\r\n"
-            "Host: %s\r\n"
-            "%s"
-            "\r\n", verb_.CString(), path.CString(), host.CString(), headersStr.CString());
-    }
-    else
-    {
-        connection = mg_download(host.CString(), port, protocol.Compare("https", false) ? 0 : 1, errorBuffer, sizeof(errorBuffer),
-            "%s %s HTTP/1.0\r\n"
-            "Host: %s\r\n"
-            "%s"
-            "Content-Length: %d\r\n"
-            "\r\n"
-            "%s", verb_.CString(), path.CString(), host.CString(), headersStr.CString(), postData_.Length(), postData_.CString());
-    }
-    
-    {
-        MutexLock lock(mutex_);
-        state_ = connection ? HTTP_OPEN : HTTP_ERROR;
-        
-        // If no connection could be made, store the error and exit
-        if (state_ == HTTP_ERROR)
-        {
-            error_ = String(&errorBuffer[0]);
-            return;
-        }
-    }
-    
-    // Loop while should run, read data from the connection, copy to the main thread buffer if there is space
-    while (shouldRun_)
-    {
-        // Read less than full buffer to be able to distinguish between full and empty ring buffer. Reading may block
-        int bytesRead = mg_read(connection, httpReadBuffer_.Get(), READ_BUFFER_SIZE / 4);
-        if (bytesRead <= 0)
-            break;
-        
-        mutex_.Acquire();
-        
-        // Wait until enough space in the main thread's ring buffer
-        for (;;)
-        {
-            unsigned spaceInBuffer = READ_BUFFER_SIZE - ((writePosition_ - readPosition_) & (READ_BUFFER_SIZE - 1));
-            if ((int)spaceInBuffer > bytesRead || !shouldRun_)
-                break;
-            
-            mutex_.Release();
-            Time::Sleep(5);
-            mutex_.Acquire();
-        }
-        
-        if (!shouldRun_)
-        {
-            mutex_.Release();
-            break;
-        }
-        
-        if (writePosition_ + bytesRead <= READ_BUFFER_SIZE)
-            memcpy(readBuffer_.Get() + writePosition_, httpReadBuffer_.Get(), bytesRead);
-        else
-        {
-            // Handle ring buffer wrap
-            unsigned part1 = READ_BUFFER_SIZE - writePosition_;
-            unsigned part2 = bytesRead - part1;
-            memcpy(readBuffer_.Get() + writePosition_, httpReadBuffer_.Get(), part1);
-            memcpy(readBuffer_.Get(), httpReadBuffer_.Get() + part1, part2);
-        }
-        
-        writePosition_ += bytesRead;
-        writePosition_ &= READ_BUFFER_SIZE - 1;
-        
-        mutex_.Release();
+        state_ = HTTP_ERROR;
+        error_ = "Unsupported protocol " + protocol;
+        return;
     }
     
-    // Close the connection
-    mg_close_connection(connection);
-    
-    {
-        MutexLock lock(mutex_);
-        state_ = HTTP_CLOSED;
-    }
+    // The client's worker thread creates the connection and reads the response data
+    client_->AddRequest(this);
+}
+
+HttpRequest::~HttpRequest()
+{
+    client_->RemoveRequest(this);
 }
 
 unsigned HttpRequest::Read(void* dest, unsigned size)
@@ -272,6 +175,39 @@ unsigned HttpRequest::GetAvailableSize() const
     return const_cast<HttpRequest*>(this)->CheckEofAndAvailableSize();
 }
 
+unsigned HttpRequest::GetFreeSpace() const
+{
+    MutexLock lock(mutex_);
+    // Leave one byte unused to be able to distinguish between full and empty ring buffer
+    return READ_BUFFER_SIZE - 1 - ((writePosition_ - readPosition_) & (READ_BUFFER_SIZE - 1));
+}
+
+void HttpRequest::WriteResponseData(const unsigned char* data, unsigned size)
+{
+    MutexLock lock(mutex_);
+    
+    if (writePosition_ + size <= READ_BUFFER_SIZE)
+        memcpy(readBuffer_.Get() + writePosition_, data, size);
+    else
+    {
+        // Handle ring buffer wrap
+        unsigned part1 = READ_BUFFER_SIZE - writePosition_;
+        unsigned part2 = size - part1;
+        memcpy(readBuffer_.Get() + writePosition_, data, part1);
+        memcpy(readBuffer_.Get(), data + part1, part2);
+    }
+    
+    writePosition_ += size;
+    writePosition_ &= READ_BUFFER_SIZE - 1;
+}
+
+void HttpRequest::SetState(HttpRequestState state, const String& error)
+{
+    MutexLock lock(mutex_);
+    state_ = state;
+    error_ = error;
+}
+
 unsigned HttpRequest::CheckEofAndAvailableSize()
 {
     unsigned bytesAvailable = (writePosition_ - readPosition_) & (READ_BUFFER_SIZE - 1);
@@ -25,12 +25,13 @@
 #include "../Container/ArrayPtr.h"
 #include "../IO/Deserializer.h"
 #include "../Core/Mutex.h"
-#include "../Container/RefCounted.h"
-#include "../Core/Thread.h"
+#include "../Container/Ptr.h"
 
 namespace Urho3D
 {
 
+class HttpClient;
+
 /// HTTP connection state
 enum HttpRequestState
 {
@@ -40,18 +41,17 @@ enum HttpRequestState
     HTTP_CLOSED
 };
 
-/// An HTTP connection with response data stream.
-class HttpRequest : public RefCounted, public Deserializer, public Thread
+/// An HTTP request with response data stream. The response body is streamed into the read buffer by the HttpClient worker thread.
+class HttpRequest : public RefCounted, public Deserializer
 {
+    friend class HttpClient;
+    
 public:
-    /// Construct with parameters.
-    HttpRequest(const String& url, const String& verb, const Vector<String>& headers, const String& postData);
-    /// Destruct. Release the connection object.
+    /// Construct with parameters and queue on the client.
+    HttpRequest(HttpClient* client, const String& url, const String& verb, const Vector<String>& headers, const String& postData);
+    /// Destruct. Remove from the client, which closes the connection if the response is not complete.
     ~HttpRequest();
     
-    /// Process the connection in the worker thread until closed.
-    virtual void ThreadFunction();
-    
     /// Read response data from the HTTP connection and return number of bytes actually read. While the connection is open, will block while trying to read the specified size. To avoid blocking, only read up to as many bytes as GetAvailableSize() returns.
     virtual unsigned Read(void* dest, unsigned size);
     /// Set position from the beginning of the stream. Not supported.
@@ -73,7 +73,15 @@ public:
 private:
     /// Check for end of the data stream and return available size in buffer. Must only be called when the mutex is held by the main thread.
     unsigned CheckEofAndAvailableSize();
+    /// Return free space in the read buffer. Called by the client.
+    unsigned GetFreeSpace() const;
+    /// Append response body data to the read buffer, which must have enough free space. Called by the client.
+    void WriteResponseData(const unsigned char* data, unsigned size);
+    /// Set connection state and error. Called by the client.
+    void SetState(HttpRequestState state, const String& error = String::EMPTY);
     
+    /// Client that performs the request.
+    SharedPtr<HttpClient> client_;
     /// URL.
     String url_;
     /// Verb.
@@ -84,13 +92,17 @@ private:
     Vector<String> headers_;
     /// POST data.
     String postData_;
+    /// Host name parsed from the URL.
+    String host_;
+    /// Path parsed from the URL.
+    String path_;
+    /// Port parsed from the URL.
+    int port_;
     /// Connection state.
     HttpRequestState state_;
     /// Mutex for synchronizing the worker and the main thread.
     mutable Mutex mutex_;
-    /// Read buffer for the worker thread.
-    SharedArrayPtr<unsigned char> httpReadBuffer_;
-    /// Read buffer for the main thread.
+    /// Ring buffer of response data, written by the worker thread and read by the main thread.
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Read buffer read cursor.
     unsigned readPosition_;
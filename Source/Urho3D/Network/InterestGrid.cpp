@@ -0,0 +1,189 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const int CELL_COORD_BITS = 21;
+static const int CELL_COORD_OFFSET = 1 << (CELL_COORD_BITS - 1);
+static const unsigned long long CELL_COORD_MASK = (1ULL << CELL_COORD_BITS) - 1;
+static const float MIN_CELL_SIZE = 0.001f;
+
+static inline int GetCellCoord(float value, float cellSize)
+{
+    return (int)floorf(value / cellSize);
+}
+
+InterestGrid::InterestGrid(Scene* scene, float cellSize) :
+    scene_(scene),
+    cellSize_(Max(cellSize, MIN_CELL_SIZE)),
+    updateNumber_(0)
+{
+}
+
+InterestGrid::~InterestGrid()
+{
+}
+
+void InterestGrid::SetCellSize(float size)
+{
+    size = Max(size, MIN_CELL_SIZE);
+    if (size != cellSize_)
+    {
+        cellSize_ = size;
+        cells_.Clear();
+        nodeCells_.Clear();
+    }
+}
+
+void InterestGrid::Update()
+{
+    if (!scene_)
+        return;
+
+    ++updateNumber_;
+    for (HashMap<Connection*, PODVector<unsigned> >::Iterator i = ownedNodes_.Begin(); i != ownedNodes_.End(); ++i)
+        i->second_.Clear();
+
+    const Vector<SharedPtr<Node> >& children = scene_->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+    {
+        Node* node = *i;
+        unsigned nodeID = node->GetID();
+        if (nodeID >= FIRST_LOCAL_ID)
+            continue;
+
+        unsigned long long cell = GetCellKey(node->GetWorldPosition());
+        HashMap<unsigned, NodeEntry>::Iterator j = nodeCells_.Find(nodeID);
+        if (j == nodeCells_.End())
+        {
+            NodeEntry& entry = nodeCells_[nodeID];
+            entry.cell_ = cell;
+            entry.updateNumber_ = updateNumber_;
+            cells_[cell].Push(nodeID);
+        }
+        else
+        {
+            if (j->second_.cell_ != cell)
+            {
+                RemoveFromCell(j->second_.cell_, nodeID);
+                cells_[cell].Push(nodeID);
+                j->second_.cell_ = cell;
+            }
+            j->second_.updateNumber_ = updateNumber_;
+        }
+
+        Connection* owner = node->GetOwner();
+        if (owner)
+            ownedNodes_[owner].Push(nodeID);
+    }
+
+    // Drop nodes that were not seen, as they have been removed or reparented
+    for (HashMap<unsigned, NodeEntry>::Iterator i = nodeCells_.Begin(); i != nodeCells_.End();)
+    {
+        if (i->second_.updateNumber_ != updateNumber_)
+        {
+            RemoveFromCell(i->second_.cell_, i->first_);
+            i = nodeCells_.Erase(i);
+        }
+        else
+            ++i;
+    }
+
+    // Drop owner entries of connections that no longer own top-level nodes
+    for (HashMap<Connection*, PODVector<unsigned> >::Iterator i = ownedNodes_.Begin(); i != ownedNodes_.End();)
+    {
+        if (i->second_.Empty())
+            i = ownedNodes_.Erase(i);
+        else
+            ++i;
+    }
+}
+
+void InterestGrid::GetNodes(HashSet<unsigned>& dest, const Vector3& center, float radius) const
+{
+    int minX = GetCellCoord(center.x_ - radius, cellSize_);
+    int minY = GetCellCoord(center.y_ - radius, cellSize_);
+    int minZ = GetCellCoord(center.z_ - radius, cellSize_);
+    int maxX = GetCellCoord(center.x_ + radius, cellSize_);
+    int maxY = GetCellCoord(center.y_ + radius, cellSize_);
+    int maxZ = GetCellCoord(center.z_ + radius, cellSize_);
+
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int y = minY; y <= maxY; ++y)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                HashMap<unsigned long long, PODVector<unsigned> >::ConstIterator i = cells_.Find(GetCellKey(x, y, z));
+                if (i == cells_.End())
+                    continue;
+
+                const PODVector<unsigned>& nodeIDs = i->second_;
+                for (PODVector<unsigned>::ConstIterator j = nodeIDs.Begin(); j != nodeIDs.End(); ++j)
+                    dest.Insert(*j);
+            }
+        }
+    }
+}
+
+const PODVector<unsigned>* InterestGrid::GetOwnedNodes(Connection* connection) const
+{
+    HashMap<Connection*, PODVector<unsigned> >::ConstIterator i = ownedNodes_.Find(connection);
+    return i != ownedNodes_.End() ? &i->second_ : 0;
+}
+
+Scene* InterestGrid::GetScene() const
+{
+    return scene_;
+}
+
+unsigned long long InterestGrid::GetCellKey(const Vector3& position) const
+{
+    return GetCellKey(GetCellCoord(position.x_, cellSize_), GetCellCoord(position.y_, cellSize_), GetCellCoord(position.z_, cellSize_));
+}
+
+unsigned long long InterestGrid::GetCellKey(int x, int y, int z)
+{
+    return ((unsigned long long)(x + CELL_COORD_OFFSET) & CELL_COORD_MASK) |
+        (((unsigned long long)(y + CELL_COORD_OFFSET) & CELL_COORD_MASK) << CELL_COORD_BITS) |
+        (((unsigned long long)(z + CELL_COORD_OFFSET) & CELL_COORD_MASK) << (2 * CELL_COORD_BITS));
+}
+
+void InterestGrid::RemoveFromCell(unsigned long long cell, unsigned nodeID)
+{
+    HashMap<unsigned long long, PODVector<unsigned> >::Iterator i = cells_.Find(cell);
+    if (i == cells_.End())
+        return;
+
+    i->second_.Remove(nodeID);
+    if (i->second_.Empty())
+        cells_.Erase(i);
+}
+
+}
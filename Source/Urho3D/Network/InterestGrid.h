@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/HashSet.h"
+#include "../Container/Ptr.h"
+#include "../Math/Vector3.h"
+
+namespace Urho3D
+{
+
+class Connection;
+class Node;
+class Scene;
+
+/// Uniform grid of a scene's top-level replicated nodes for spatial network interest management.
+class URHO3D_API InterestGrid : public RefCounted
+{
+public:
+    /// Construct with scene and cell size.
+    InterestGrid(Scene* scene, float cellSize);
+    /// Destruct.
+    ~InterestGrid();
+
+    /// Set cell size. Causes all nodes to be re-inserted on the next update.
+    void SetCellSize(float size);
+    /// Update the cells of moved, added and removed top-level replicated nodes. Called by Network once per update.
+    void Update();
+    /// Return IDs of the top-level replicated nodes in cells overlapping a sphere.
+    void GetNodes(HashSet<unsigned>& dest, const Vector3& center, float radius) const;
+    /// Return IDs of the top-level replicated nodes owned by a connection.
+    const PODVector<unsigned>* GetOwnedNodes(Connection* connection) const;
+
+    /// Return scene.
+    Scene* GetScene() const;
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+    /// Return number of indexed nodes.
+    unsigned GetNumNodes() const { return nodeCells_.Size(); }
+
+private:
+    /// Per-node grid entry.
+    struct NodeEntry
+    {
+        /// Cell key.
+        unsigned long long cell_;
+        /// Update number when last seen.
+        unsigned updateNumber_;
+    };
+
+    /// Return cell key for a world position.
+    unsigned long long GetCellKey(const Vector3& position) const;
+    /// Return cell key for integer cell coordinates.
+    static unsigned long long GetCellKey(int x, int y, int z);
+    /// Remove a node ID from a cell.
+    void RemoveFromCell(unsigned long long cell, unsigned nodeID);
+
+    /// Scene.
+    WeakPtr<Scene> scene_;
+    /// Node IDs by cell key.
+    HashMap<unsigned long long, PODVector<unsigned> > cells_;
+    /// Grid entries by node ID.
+    HashMap<unsigned, NodeEntry> nodeCells_;
+    /// Top-level node IDs by owner connection.
+    HashMap<Connection*, PODVector<unsigned> > ownedNodes_;
+    /// Cell size.
+    float cellSize_;
+    /// Update counter for detecting removed nodes.
+    unsigned updateNumber_;
+};
+
+}
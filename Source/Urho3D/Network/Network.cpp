@@ -22,8 +22,10 @@
 
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
+#include "../Core/MemoryTracker.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/FileSystem.h"
+#include "../Network/HttpClient.h"
 #include "../Network/HttpRequest.h"
 #include "../Input/InputEvents.h"
 #include "../IO/IOEvents.h"
@@ -35,6 +37,7 @@
 #include "../Core/Profiler.h"
 #include "../Network/Protocol.h"
 #include "../Scene/Scene.h"
+#include "../Core/WorkQueue.h"
 
 #include <kNet/kNet.h>
 
@@ -44,6 +47,49 @@ namespace Urho3D
 {
 
 static const int DEFAULT_UPDATE_FPS = 30;
+static const float DEFAULT_INTEREST_CELL_SIZE = 50.0f;
+
+/// Sends the server updates of a range of client connections. Used with WorkQueue::ParallelFor().
+struct ServerUpdateSender
+{
+    /// Construct.
+    ServerUpdateSender(Network* network) :
+        network_(network)
+    {
+    }
+    
+    /// Send the server updates of a range of connections.
+    void operator () (Connection** start, Connection** end, unsigned threadIndex)
+    {
+        for (Connection** i = start; i != end; ++i)
+            (*i)->SendServerUpdate(network_->GetInterestGrid((*i)->GetScene()));
+    }
+    
+    /// Network subsystem.
+    Network* network_;
+};
+
+/// Decodes the received messages of a range of connections. Used with WorkQueue::ParallelFor().
+struct MessageDecoder
+{
+    /// Decode the received messages of a range of connections.
+    void operator () (SharedPtr<Connection>* start, SharedPtr<Connection>* end, unsigned threadIndex)
+    {
+        for (SharedPtr<Connection>* i = start; i != end; ++i)
+            (*i)->DecodeMessages();
+    }
+};
+
+/// Bring node world transforms up to date recursively, so that the server updates only read them.
+static void UpdateWorldTransforms(Node* node)
+{
+    if (node->IsDirty())
+        node->GetWorldTransform();
+    
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        UpdateWorldTransforms(*i);
+}
 
 Network::Network(Context* context) :
     Object(context),
@@ -51,13 +97,15 @@ Network::Network(Context* context) :
     simulatedLatency_(0),
     simulatedPacketLoss_(0.0f),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
-    updateAcc_(0.0f)
+    updateAcc_(0.0f),
+    interestCellSize_(DEFAULT_INTEREST_CELL_SIZE),
+    serverTime_(0),
+    initialStateBudget_(0),
+    parallelMessageDecoding_(false),
+    remoteEventBatching_(false)
 {
     network_ = new kNet::Network();
     
-    // Register Network library object factories
-    RegisterNetworkLibrary(context_);
-    
     SubscribeToEvent(E_BEGINFRAME, HANDLER(Network, HandleBeginFrame));
     SubscribeToEvent(E_RENDERUPDATE, HANDLER(Network, HandleRenderUpdate));
     
@@ -339,6 +387,13 @@ void Network::SetUpdateFps(int fps)
     updateAcc_ = 0.0f;
 }
 
+void Network::SetInterestCellSize(float size)
+{
+    interestCellSize_ = Max(size, M_EPSILON);
+    for (HashMap<Scene*, SharedPtr<InterestGrid> >::Iterator i = interestGrids_.Begin(); i != interestGrids_.End(); ++i)
+        i->second_->SetCellSize(interestCellSize_);
+}
+
 void Network::SetSimulatedLatency(int ms)
 {
     simulatedLatency_ = Max(ms, 0);
@@ -372,6 +427,14 @@ void Network::UnregisterAllRemoteEvents()
     allowedRemoteEvents_.Clear();
 }
 
+void Network::SetRemoteEventCoalescing(StringHash eventType, bool enable)
+{
+    if (enable)
+        coalescedRemoteEvents_.Insert(eventType);
+    else
+        coalescedRemoteEvents_.Erase(eventType);
+}
+
 void Network::SetPackageCacheDir(const String& path)
 {
     packageCacheDir_ = AddTrailingSlash(path);
@@ -402,8 +465,12 @@ SharedPtr<HttpRequest> Network::MakeHttpRequest(const String& url, const String&
 {
     PROFILE(MakeHttpRequest);
     
+    // All requests share one client, which reuses their connections
+    if (!httpClient_)
+        httpClient_ = new HttpClient();
+    
     // The initialization of the request will take time, can not know at this point if it has an error or not
-    SharedPtr<HttpRequest> request(new HttpRequest(url, verb, headers, postData));
+    SharedPtr<HttpRequest> request(new HttpRequest(httpClient_, url, verb, headers, postData));
     return request;
 }
 
@@ -436,6 +503,12 @@ Vector<SharedPtr<Connection> > Network::GetClientConnections() const
     return ret;
 }
 
+InterestGrid* Network::GetInterestGrid(Scene* scene) const
+{
+    HashMap<Scene*, SharedPtr<InterestGrid> >::ConstIterator i = interestGrids_.Find(scene);
+    return i != interestGrids_.End() ? i->second_.Get() : (InterestGrid*)0;
+}
+
 bool Network::IsServerRunning() const
 {
     return network_->GetServer();
@@ -446,21 +519,33 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.Contains(eventType);
 }
 
+bool Network::IsRemoteEventCoalesced(StringHash eventType) const
+{
+    return coalescedRemoteEvents_.Contains(eventType);
+}
+
 void Network::Update(float timeStep)
 {
     PROFILE(UpdateNetwork);
+    MEMORY_TAG(MEMTAG_NETWORK);
+    
+    if (parallelMessageDecoding_)
+        ProcessDecodedMessages();
     
     // Process server connection if it exists
     if (serverConnection_)
     {
         kNet::MessageConnection* connection = serverConnection_->GetMessageConnection();
         
-        // Receive new messages
+        // Receive new messages, or with parallel decoding those left over, and check the connection state
         connection->Process();
         
         // Process latest data messages waiting for the correct nodes or components to be created
         serverConnection_->ProcessPendingLatestData();
         
+        // Finish package downloads that have been verified
+        serverConnection_->ProcessPendingDownloads();
+        
         // Check for state transitions
         kNet::ConnectionState state = connection->GetConnectionState();
         if (serverConnection_->IsConnectPending() && state == kNet::ConnectionOK)
@@ -480,6 +565,7 @@ void Network::Update(float timeStep)
 void Network::PostUpdate(float timeStep)
 {
     PROFILE(PostUpdateNetwork);
+    MEMORY_TAG(MEMTAG_NETWORK);
     
     // Check if periodic update should happen now
     updateAcc_ += timeStep;
@@ -493,6 +579,9 @@ void Network::PostUpdate(float timeStep)
         
         if (IsServerRunning())
         {
+            // Take the time stamp once so that all connections send the same time for this update
+            serverTime_ = serverTimer_.GetMSec(false);
+            
             // Collect and prepare all networked scenes
             {
                 PROFILE(PrepareServerUpdate);
@@ -508,16 +597,39 @@ void Network::PostUpdate(float timeStep)
                 
                 for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
                     (*i)->PrepareNetworkUpdate();
+                
+                UpdateInterestGrids();
             }
             
             {
                 PROFILE(SendServerUpdate);
                 
-                // Then send server updates for each client connection
+                // Then send server updates for each client connection. Each connection serializes into its own
+                // message buffer, so with several connections and worker threads they are processed in parallel
+                WorkQueue* queue = GetSubsystem<WorkQueue>();
+                if (queue && queue->GetNumThreads() && clientConnections_.Size() > 1)
+                {
+                    for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+                        UpdateWorldTransforms(*i);
+                    
+                    updateConnections_.Clear();
+                    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+                        i != clientConnections_.End(); ++i)
+                        updateConnections_.Push(i->second_);
+                    
+                    ServerUpdateSender sender(this);
+                    queue->ParallelFor(updateConnections_, 1, sender);
+                }
+                else
+                {
+                    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+                        i != clientConnections_.End(); ++i)
+                        i->second_->SendServerUpdate(GetInterestGrid(i->second_->GetScene()));
+                }
+                
                 for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
                     i != clientConnections_.End(); ++i)
                 {
-                    i->second_->SendServerUpdate();
                     i->second_->SendRemoteEvents();
                     i->second_->SendPackages();
                 }
@@ -592,6 +704,81 @@ void Network::ConfigureNetworkSimulator()
         i->second_->ConfigureNetworkSimulator(simulatedLatency_, simulatedPacketLoss_);
 }
 
+void Network::ProcessDecodedMessages()
+{
+    decodeConnections_.Clear();
+    if (serverConnection_)
+        decodeConnections_.Push(serverConnection_);
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+        i != clientConnections_.End(); ++i)
+        decodeConnections_.Push(i->second_);
+    
+    for (unsigned i = 0; i < decodeConnections_.Size(); ++i)
+        decodeConnections_[i]->ReceiveMessages();
+    
+    {
+        PROFILE(DecodeMessages);
+        
+        // Each connection decodes into its own message list, so the connections can be decoded in parallel
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        if (queue && queue->GetNumThreads() && decodeConnections_.Size() > 1)
+        {
+            MessageDecoder decoder;
+            queue->ParallelFor(decodeConnections_.Begin().ptr_, decodeConnections_.End().ptr_, 1, decoder);
+        }
+        else
+        {
+            for (unsigned i = 0; i < decodeConnections_.Size(); ++i)
+                decodeConnections_[i]->DecodeMessages();
+        }
+    }
+    
+    {
+        PROFILE(ApplyMessages);
+        
+        // The connections are held by the list, as event handlers may disconnect them while their messages are applied
+        for (unsigned i = 0; i < decodeConnections_.Size(); ++i)
+            decodeConnections_[i]->ApplyMessages();
+    }
+    
+    // Do not keep disconnected connections alive
+    decodeConnections_.Clear();
+}
+
+void Network::UpdateInterestGrids()
+{
+    // Find the scenes where at least one client connection uses interest management
+    HashSet<Scene*> interestScenes;
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::ConstIterator i = clientConnections_.Begin();
+        i != clientConnections_.End(); ++i)
+    {
+        Scene* scene = i->second_->GetScene();
+        if (scene && i->second_->GetInterestRadius() > 0.0f)
+            interestScenes.Insert(scene);
+    }
+    
+    for (HashMap<Scene*, SharedPtr<InterestGrid> >::Iterator i = interestGrids_.Begin(); i != interestGrids_.End();)
+    {
+        if (!interestScenes.Contains(i->first_) || i->second_->GetScene() != i->first_)
+            i = interestGrids_.Erase(i);
+        else
+            ++i;
+    }
+    
+    if (interestScenes.Empty())
+        return;
+    
+    PROFILE(UpdateInterestGrids);
+    
+    for (HashSet<Scene*>::ConstIterator i = interestScenes.Begin(); i != interestScenes.End(); ++i)
+    {
+        SharedPtr<InterestGrid>& grid = interestGrids_[*i];
+        if (!grid)
+            grid = new InterestGrid(*i, interestCellSize_);
+        grid->Update();
+    }
+}
+
 void RegisterNetworkLibrary(Context* context)
 {
     NetworkPriority::RegisterObject(context);
@@ -25,6 +25,8 @@
 #include "../Network/Connection.h"
 #include "../Container/HashSet.h"
 #include "../Core/Object.h"
+#include "../IO/Compression.h"
+#include "../Network/InterestGrid.h"
 #include "../IO/VectorBuffer.h"
 
 #include <kNet/IMessageHandler.h>
@@ -33,6 +35,7 @@
 namespace Urho3D
 {
 
+class HttpClient;
 class HttpRequest;
 class MemoryBuffer;
 class Scene;
@@ -83,6 +86,8 @@ public:
     void BroadcastRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
     /// Set network update FPS.
     void SetUpdateFps(int fps);
+    /// Set the cell size of the spatial interest grids used for client connections that have a non-zero interest radius.
+    void SetInterestCellSize(float size);
     /// Set simulated latency in milliseconds. This adds a fixed delay before sending each packet.
     void SetSimulatedLatency(int ms);
     /// Set simulated packet loss probability between 0.0 - 1.0.
@@ -93,8 +98,20 @@ public:
     void UnregisterRemoteEvent(StringHash eventType);
     /// Unregister all remote events.
     void UnregisterAllRemoteEvents();
+    /// Set whether a remote event type is coalesced when sending: sending it again before the next network update replaces the data of the event already queued from the same sender, so that only the latest value is sent.
+    void SetRemoteEventCoalescing(StringHash eventType, bool enable);
+    /// Set whether to send the queued remote events of each connection batched into a few messages, with the event types and parameter names stored once per batch and small integers compacted. Default false.
+    void SetRemoteEventBatching(bool enable) { remoteEventBatching_ = enable; }
     /// Set the package download cache directory.
     void SetPackageCacheDir(const String& path);
+    /// Set the codec for compressing package transfer fragments, or null to send them uncompressed. The server and the clients must use the same codec and settings, such as the dictionary.
+    void SetPackageCodec(CompressionCodec* codec) { packageCodec_ = codec; }
+    /// Set the maximum uncompressed bytes of initial scene state to send to a newly joined client per network update. When non-zero, the nodes are sent nearest to the client's observer position first, in compressed chunks spread over several updates. 0 (default) sends each node in its own message at once.
+    void SetInitialStateBudget(unsigned bytes) { initialStateBudget_ = bytes; }
+    /// Set the codec for compressing the bulk initial scene state, or null to use LZ4. The server and the clients must use the same codec and settings.
+    void SetSceneCodec(CompressionCodec* codec) { sceneCodec_ = codec; }
+    /// Set whether to decode received controls, remote events, identities and initial scene state on the WorkQueue worker threads, in parallel for each connection, before applying them in the main thread. Default false.
+    void SetParallelMessageDecoding(bool enable) { parallelMessageDecoding_ = enable; }
     /// Trigger all client connections in the specified scene to download a package file from the server. Can be used to download additional resource packages when clients are already joined in the scene. The package must have been added as a requirement to the scene, or else the eventual download will fail.
     void SendPackageToClients(Scene* scene, PackageFile* package);
     /// Perform an HTTP request to the specified URL. Empty verb defaults to a GET request. Return a request object which can be used to read the response data.
@@ -102,6 +119,12 @@ public:
 
     /// Return network update FPS.
     int GetUpdateFps() const { return updateFps_; }
+    /// Return the spatial interest grid cell size.
+    float GetInterestCellSize() const { return interestCellSize_; }
+    /// Return the spatial interest grid of a scene, or null if no client connection in the scene uses interest management.
+    InterestGrid* GetInterestGrid(Scene* scene) const;
+    /// Return the server time in milliseconds of the current network update. Sent to the clients for snapshot interpolation.
+    unsigned GetServerTime() const { return serverTime_; }
     /// Return simulated latency in milliseconds.
     int GetSimulatedLatency() const { return simulatedLatency_; }
     /// Return simulated packet loss probability.
@@ -116,8 +139,22 @@ public:
     bool IsServerRunning() const;
     /// Return whether a remote event is allowed to be received.
     bool CheckRemoteEvent(StringHash eventType) const;
+    /// Return whether a remote event type is coalesced when sending.
+    bool IsRemoteEventCoalesced(StringHash eventType) const;
+    /// Return whether remote events are sent batched.
+    bool GetRemoteEventBatching() const { return remoteEventBatching_; }
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
+    /// Return the package transfer codec.
+    CompressionCodec* GetPackageCodec() const { return packageCodec_; }
+    /// Return the per-update initial scene state budget in bytes.
+    unsigned GetInitialStateBudget() const { return initialStateBudget_; }
+    /// Return the bulk initial scene state codec.
+    CompressionCodec* GetSceneCodec() const { return sceneCodec_; }
+    /// Return whether received messages are decoded on the worker threads.
+    bool GetParallelMessageDecoding() const { return parallelMessageDecoding_; }
+    /// Return the client that performs HTTP requests, or null if no requests have been made.
+    HttpClient* GetHttpClient() const { return httpClient_; }
     
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
@@ -135,6 +172,10 @@ private:
     void OnServerDisconnected();
     /// Reconfigure network simulator parameters on all existing connections.
     void ConfigureNetworkSimulator();
+    /// Create, update and remove the spatial interest grids of the networked scenes.
+    void UpdateInterestGrids();
+    /// Receive messages from all connections, decode them in parallel and apply them in the main thread.
+    void ProcessDecodedMessages();
     
     /// kNet instance.
     kNet::Network* network_;
@@ -146,8 +187,16 @@ private:
     HashSet<StringHash> allowedRemoteEvents_;
     /// Remote event fixed blacklist.
     HashSet<StringHash> blacklistedRemoteEvents_;
+    /// Remote events coalesced when sending.
+    HashSet<StringHash> coalescedRemoteEvents_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
+    /// Client connections to send a server update to.
+    PODVector<Connection*> updateConnections_;
+    /// Connections to decode received messages for.
+    Vector<SharedPtr<Connection> > decodeConnections_;
+    /// Spatial interest grids by scene.
+    HashMap<Scene*, SharedPtr<InterestGrid> > interestGrids_;
     /// Update FPS.
     int updateFps_;
     /// Simulated latency (send delay) in milliseconds.
@@ -158,8 +207,26 @@ private:
     float updateInterval_;
     /// Update time accumulator.
     float updateAcc_;
+    /// Spatial interest grid cell size.
+    float interestCellSize_;
+    /// Server time of the current network update in milliseconds.
+    unsigned serverTime_;
+    /// Server time timer.
+    Timer serverTimer_;
     /// Package cache directory.
     String packageCacheDir_;
+    /// Package transfer codec.
+    SharedPtr<CompressionCodec> packageCodec_;
+    /// Bulk initial scene state codec.
+    SharedPtr<CompressionCodec> sceneCodec_;
+    /// Initial scene state bytes per connection per update.
+    unsigned initialStateBudget_;
+    /// Parallel message decoding flag.
+    bool parallelMessageDecoding_;
+    /// Remote event batching flag.
+    bool remoteEventBatching_;
+    /// HTTP request client, created on the first request.
+    SharedPtr<HttpClient> httpClient_;
 };
 
 /// Register Network library objects.
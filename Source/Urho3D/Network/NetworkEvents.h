@@ -91,6 +91,15 @@ EVENT(E_NETWORKSCENELOADFAILED, NetworkSceneLoadFailed)
     PARAM(P_CONNECTION, Connection);      // Connection pointer
 }
 
+/// Client: authoritative update of the predicted node has been applied. Replay the unacknowledged controls on top of it.
+EVENT(E_NETWORKRECONCILE, NetworkReconcile)
+{
+    PARAM(P_CONNECTION, Connection);      // Connection pointer
+    PARAM(P_NODE, Node);                  // Node pointer
+    PARAM(P_TIMESTAMP, TimeStamp);        // unsigned
+    PARAM(P_NUMCONTROLS, NumControls);    // unsigned
+}
+
 /// Remote event: adds Connection parameter to the event data
 EVENT(E_REMOTEEVENTDATA, RemoteEventData)
 {
@@ -0,0 +1,269 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/CoreEvents.h"
+#include "../Core/ObjectPool.h"
+#include "../Core/Profiler.h"
+#include "../Core/StringUtils.h"
+#include "../Core/Timer.h"
+#include "../Graphics/Renderer.h"
+#include "../IO/Log.h"
+#include "../Network/ProfilerServer.h"
+#include "../Resource/ResourceCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <Civetweb/civetweb.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Time in milliseconds after the last client request until frame data collection stops.
+static const unsigned CLIENT_TIMEOUT_MSEC = 5000;
+/// Default number of recent frames kept.
+static const unsigned DEFAULT_MAX_FRAMES = 120;
+/// Default maximum profiling block depth.
+static const unsigned DEFAULT_MAX_DEPTH = 4;
+static const int LINE_MAX_LENGTH = 256;
+
+/// Handle a profiler data request in a Civetweb server thread.
+static int HandleProfilerRequest(mg_connection* connection, void* cbdata)
+{
+    ProfilerServer* server = static_cast<ProfilerServer*>(cbdata);
+    const mg_request_info* info = mg_get_request_info(connection);
+    
+    // The client passes the last frame number it has received, to get only the newer frames
+    unsigned sinceFrameNumber = 0;
+    if (info->query_string)
+    {
+        char value[LINE_MAX_LENGTH];
+        if (mg_get_var(info->query_string, strlen(info->query_string), "since", value, sizeof(value)) > 0)
+            sinceFrameNumber = ToUInt(value);
+    }
+    
+    String data = server->GetFrames(sinceFrameNumber);
+    mg_printf(connection, "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %u\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Cache-Control: no-cache\r\n"
+        "\r\n", data.Length());
+    mg_write(connection, data.CString(), data.Length());
+    return 1;
+}
+
+ProfilerServer::ProfilerServer(Context* context) :
+    Object(context),
+    server_(0),
+    firstFrame_(0),
+    maxFrames_(DEFAULT_MAX_FRAMES),
+    maxDepth_(DEFAULT_MAX_DEPTH),
+    port_(0),
+    lastRequestTime_(0),
+    hasRequests_(false)
+{
+}
+
+ProfilerServer::~ProfilerServer()
+{
+    Stop();
+}
+
+bool ProfilerServer::Start(unsigned short port)
+{
+    Stop();
+    
+    String portStr(port);
+    const char* options[] = {
+        "listening_ports", portStr.CString(),
+        "num_threads", "1",
+        0
+    };
+    
+    mg_callbacks callbacks;
+    memset(&callbacks, 0, sizeof callbacks);
+    
+    server_ = mg_start(&callbacks, 0, options);
+    if (!server_)
+    {
+        LOGERROR("Failed to start profiler server on port " + portStr);
+        return false;
+    }
+    
+    mg_set_request_handler(server_, "/", HandleProfilerRequest, this);
+    port_ = port;
+    SubscribeToEvent(E_BEGINFRAME, HANDLER(ProfilerServer, HandleBeginFrame));
+    
+    LOGINFO("Started profiler server on port " + portStr);
+    return true;
+}
+
+void ProfilerServer::Stop()
+{
+    if (!server_)
+        return;
+    
+    // Wait for the server threads to finish before the frames can be released
+    mg_stop(server_);
+    server_ = 0;
+    port_ = 0;
+    hasRequests_ = false;
+    UnsubscribeFromEvent(E_BEGINFRAME);
+    
+    MutexLock lock(framesMutex_);
+    frames_.Clear();
+    firstFrame_ = 0;
+    
+    LOGINFO("Stopped profiler server");
+}
+
+void ProfilerServer::SetMaxFrames(unsigned frames)
+{
+    MutexLock lock(framesMutex_);
+    
+    maxFrames_ = Max((int)frames, 1);
+    frames_.Clear();
+    firstFrame_ = 0;
+}
+
+void ProfilerServer::SetMaxDepth(unsigned depth)
+{
+    maxDepth_ = Max((int)depth, 1);
+}
+
+String ProfilerServer::GetFrames(unsigned sinceFrameNumber)
+{
+    lastRequestTime_ = Time::GetSystemTime();
+    hasRequests_ = true;
+    
+    String output("{\"frames\":[");
+    bool first = true;
+    
+    MutexLock lock(framesMutex_);
+    for (unsigned i = 0; i < frames_.Size(); ++i)
+    {
+        const ProfilerServerFrame& frame = frames_[(firstFrame_ + i) % frames_.Size()];
+        if (frame.frameNumber_ <= sinceFrameNumber)
+            continue;
+        
+        if (!first)
+            output += ',';
+        output += frame.data_;
+        first = false;
+    }
+    
+    output += "]}\n";
+    return output;
+}
+
+void ProfilerServer::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    // Collect nothing unless a client has polled recently
+    if (!hasRequests_)
+        return;
+    if (Time::GetSystemTime() - lastRequestTime_ > CLIENT_TIMEOUT_MSEC)
+    {
+        hasRequests_ = false;
+        return;
+    }
+    
+    using namespace BeginFrame;
+    
+    // The frame number has already been advanced, and the profiler and renderer hold the previous frame's data
+    unsigned frameNumber = eventData[P_FRAMENUMBER].GetUInt();
+    if (frameNumber > 1)
+        CollectFrame(frameNumber - 1);
+}
+
+void ProfilerServer::CollectFrame(unsigned frameNumber)
+{
+    char line[LINE_MAX_LENGTH];
+    ProfilerServerFrame frame;
+    frame.frameNumber_ = frameNumber;
+    
+    Time* time = GetSubsystem<Time>();
+    snprintf(line, LINE_MAX_LENGTH, "{\"frame\":%u,\"timeStep\":%.3f", frameNumber, time ? time->GetTimeStep() * 1000.0f : 0.0f);
+    frame.data_.Append(line);
+    
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    snprintf(line, LINE_MAX_LENGTH, ",\"memory\":{\"resources\":%u,\"pooledObjects\":%u,\"poolReserved\":%u}", cache ? cache->GetTotalMemoryUse() : 0,
+        ObjectPool::GetNumAllocated(), ObjectPool::GetReservedMemory());
+    frame.data_.Append(line);
+    
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+    {
+        snprintf(line, LINE_MAX_LENGTH, ",\"renderer\":{\"views\":%u,\"batches\":%u,\"primitives\":%u}", renderer->GetNumViews(),
+            renderer->GetNumBatches(), renderer->GetNumPrimitives());
+        frame.data_.Append(line);
+    }
+    
+    Profiler* profiler = GetSubsystem<Profiler>();
+    if (profiler)
+    {
+        frame.data_.Append(",\"blocks\":[");
+        bool first = true;
+        WriteBlocks(profiler->GetRootBlock(), frame.data_, 0, first);
+        frame.data_.Append("]");
+    }
+    
+    frame.data_.Append("}");
+    
+    MutexLock lock(framesMutex_);
+    if (frames_.Size() < maxFrames_)
+        frames_.Push(frame);
+    else
+    {
+        // Overwrite the oldest frame
+        frames_[firstFrame_].frameNumber_ = frame.frameNumber_;
+        frames_[firstFrame_].data_.Swap(frame.data_);
+        firstFrame_ = (firstFrame_ + 1) % frames_.Size();
+    }
+}
+
+void ProfilerServer::WriteBlocks(const ProfilerBlock* block, String& dest, unsigned depth, bool& first) const
+{
+    char line[LINE_MAX_LENGTH];
+    
+    for (PODVector<ProfilerBlock*>::ConstIterator i = block->children_.Begin(); i != block->children_.End(); ++i)
+    {
+        const ProfilerBlock* child = *i;
+        if (!child->frameCount_)
+            continue;
+        
+        // The name is escaped separately, so the formatted part has a bounded length
+        dest.Append(first ? "{\"name\":" : ",{\"name\":");
+        AppendJSONString(dest, child->name_);
+        snprintf(line, LINE_MAX_LENGTH, ",\"depth\":%u,\"count\":%u,\"time\":%.3f,\"maxTime\":%.3f}", depth, child->frameCount_,
+            child->frameTime_ / 1000.0f, child->frameMaxTime_ / 1000.0f);
+        dest.Append(line);
+        first = false;
+        
+        if (depth + 1 < maxDepth_)
+            WriteBlocks(child, dest, depth + 1, first);
+    }
+}
+
+}
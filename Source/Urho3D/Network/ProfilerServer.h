@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/Mutex.h"
+#include "../Core/Object.h"
+
+struct mg_context;
+
+namespace Urho3D
+{
+
+class ProfilerBlock;
+
+/// Profiling data of one frame kept for the profiler server clients.
+struct ProfilerServerFrame
+{
+    /// Frame number.
+    unsigned frameNumber_;
+    /// Frame data as a JSON object.
+    String data_;
+};
+
+/// %Profiler server subsystem. Serves the profiling block timings, memory use and rendering statistics of the recent frames as JSON over HTTP, so that they can be viewed remotely. Data is only collected while clients are polling.
+class URHO3D_API ProfilerServer : public Object
+{
+    OBJECT(ProfilerServer);
+    
+public:
+    /// Construct.
+    ProfilerServer(Context* context);
+    /// Destruct. Stop the server.
+    virtual ~ProfilerServer();
+    
+    /// Start listening to HTTP requests on a TCP port. Return true if successful.
+    bool Start(unsigned short port);
+    /// Stop the server.
+    void Stop();
+    /// Set number of recent frames kept for the clients.
+    void SetMaxFrames(unsigned frames);
+    /// Set maximum profiling block depth in the frame data.
+    void SetMaxDepth(unsigned depth);
+    
+    /// Return whether the server is started.
+    bool IsStarted() const { return server_ != 0; }
+    /// Return the listening port.
+    unsigned short GetPort() const { return port_; }
+    /// Return number of recent frames kept for the clients.
+    unsigned GetMaxFrames() const { return maxFrames_; }
+    /// Return maximum profiling block depth in the frame data.
+    unsigned GetMaxDepth() const { return maxDepth_; }
+    /// Return the kept frames newer than the specified frame number as a JSON object. Is thread-safe. Called from the server threads.
+    String GetFrames(unsigned sinceFrameNumber);
+    
+private:
+    /// Handle frame begin event. Collect the previous frame's data if clients are polling.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Collect the previous frame's data.
+    void CollectFrame(unsigned frameNumber);
+    /// Write the profiling blocks of the previous frame recursively.
+    void WriteBlocks(const ProfilerBlock* block, String& dest, unsigned depth, bool& first) const;
+    
+    /// Civetweb server context.
+    mg_context* server_;
+    /// Recent frames in a ring buffer.
+    Vector<ProfilerServerFrame> frames_;
+    /// Index of the oldest frame in the ring buffer.
+    unsigned firstFrame_;
+    /// Mutex for the frames.
+    Mutex framesMutex_;
+    /// Number of recent frames kept.
+    unsigned maxFrames_;
+    /// Maximum profiling block depth.
+    unsigned maxDepth_;
+    /// Listening port.
+    unsigned short port_;
+    /// System time of the last client request.
+    volatile unsigned lastRequestTime_;
+    /// Client request received flag.
+    volatile bool hasRequests_;
+};
+
+}
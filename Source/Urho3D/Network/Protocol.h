@@ -31,10 +31,10 @@ static const int MSG_IDENTITY = 0x5;
 static const int MSG_CONTROLS = 0x6;
 /// Client->server: scene has been loaded and client is ready to proceed.
 static const int MSG_SCENELOADED = 0x7;
-/// Client->server: request a package file.
+/// Client->server: request a package file, optionally from a byte offset to resume a partial download.
 static const int MSG_REQUESTPACKAGE = 0x8;
 
-/// Server->client: package file data fragment.
+/// Server->client: package file data fragment at a byte offset. Fragments of a package are sent in order.
 static const int MSG_PACKAGEDATA = 0x9;
 /// Server->client: load new scene. In case of empty filename the client should just empty the scene.
 static const int MSG_LOADSCENE = 0xa;
@@ -44,7 +44,7 @@ static const int MSG_SCENECHECKSUMERROR = 0xb;
 static const int MSG_CREATENODE = 0xc;
 /// Server->client: node delta update.
 static const int MSG_NODEDELTAUPDATE = 0xd;
-/// Server->client: node latest data update.
+/// Server->client: node latest data update. Preceded by the low 16 bits of the server time in milliseconds for snapshot interpolation.
 static const int MSG_NODELATESTDATA = 0xe;
 /// Server->client: remove node.
 static const int MSG_REMOVENODE = 0xf;
@@ -63,10 +63,22 @@ static const int MSG_REMOTEEVENT = 0x14;
 static const int MSG_REMOTENODEEVENT = 0x15;
 /// Server->client: info about package.
 static const int MSG_PACKAGEINFO = 0x16;
+/// Server->client: compressed chunk of node creations during the bulk initial state transfer.
+static const int MSG_CREATENODES = 0x17;
+/// Client->server and server->client: batch of remote events and remote node events, with the event types and parameter names stored once per batch.
+static const int MSG_REMOTEEVENTS = 0x18;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
-/// Package file fragment size.
+/// Initial and minimum package file fragment size.
 static const unsigned PACKAGE_FRAGMENT_SIZE = 1024;
+/// Maximum package file fragment size, reached when the connection keeps up with the transfer.
+static const unsigned MAX_PACKAGE_FRAGMENT_SIZE = 16384;
+/// Maximum number of package files downloaded simultaneously.
+static const unsigned MAX_PACKAGE_DOWNLOADS = 4;
+/// Uncompressed size after which a bulk initial state chunk is sent.
+static const unsigned INITIAL_STATE_CHUNK_SIZE = 8192;
+/// Size of the encoded events after which a remote event batch is sent.
+static const unsigned REMOTE_EVENT_BATCH_SIZE = 8192;
 
 }
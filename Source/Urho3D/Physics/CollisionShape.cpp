@@ -27,7 +27,10 @@
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/IndexBuffer.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Core/MemoryTracker.h"
 #include "../Graphics/Model.h"
 #include "../Physics/PhysicsUtils.h"
 #include "../Physics/PhysicsWorld.h"
@@ -79,10 +82,60 @@ static const char* typeNames[] =
 
 extern const char* PHYSICS_CATEGORY;
 
+/// Accumulate bytes to a geometry checksum.
+static unsigned HashBytes(unsigned hash, const unsigned char* data, unsigned size)
+{
+    for (unsigned i = 0; i < size; ++i)
+        hash = SDBMHash(hash, data[i]);
+    return hash;
+}
+
+/// Triangle info map which allows saving and loading its contents as cooked data.
+struct TriangleInfoMap : public btTriangleInfoMap
+{
+    /// Save the triangle infos.
+    void Save(Serializer& dest) const
+    {
+        dest.WriteUInt(m_keyArray.size());
+        for (int i = 0; i < m_keyArray.size(); ++i)
+        {
+            const btTriangleInfo& info = m_valueArray[i];
+            dest.WriteInt(m_keyArray[i].getUid1());
+            dest.WriteInt(info.m_flags);
+            dest.WriteFloat(info.m_edgeV0V1Angle);
+            dest.WriteFloat(info.m_edgeV1V2Angle);
+            dest.WriteFloat(info.m_edgeV2V0Angle);
+        }
+    }
+
+    /// Load the triangle infos. Return true if successful.
+    bool Load(Deserializer& source)
+    {
+        unsigned numInfos = source.ReadUInt();
+        if (numInfos > (source.GetSize() - source.GetPosition()) / (5 * sizeof(int)))
+            return false;
+
+        for (unsigned i = 0; i < numInfos; ++i)
+        {
+            int key = source.ReadInt();
+            btTriangleInfo info;
+            info.m_flags = source.ReadInt();
+            info.m_edgeV0V1Angle = source.ReadFloat();
+            info.m_edgeV1V2Angle = source.ReadFloat();
+            info.m_edgeV2V0Angle = source.ReadFloat();
+            insert(btHashInt(key), info);
+        }
+
+        return true;
+    }
+};
+
 class TriangleMeshInterface : public btTriangleIndexVertexArray
 {
 public:
-    TriangleMeshInterface(Model* model, unsigned lodLevel) : btTriangleIndexVertexArray()
+    TriangleMeshInterface(Model* model, unsigned lodLevel) :
+        btTriangleIndexVertexArray(),
+        checksum_(0)
     {
         unsigned numGeometries = model->GetNumGeometries();
         unsigned totalTriangles = 0;
@@ -128,6 +181,12 @@ public:
             m_indexedMeshes.push_back(meshIndex);
             
             totalTriangles += meshIndex.m_numTriangles;
+
+            // Checksum the indices and the positions of the referenced vertices to validate cooked data
+            checksum_ = HashBytes(checksum_, &indexData[indexStart * indexSize], indexCount * indexSize);
+            unsigned vertexEnd = geometry->GetVertexStart() + geometry->GetVertexCount();
+            for (unsigned j = geometry->GetVertexStart(); j < vertexEnd; ++j)
+                checksum_ = HashBytes(checksum_, &vertexData[j * vertexSize], sizeof(Vector3));
         }
 
         // Bullet will not work properly with quantized AABB compression, if the triangle count is too large. Use a conservative
@@ -135,7 +194,9 @@ public:
         useQuantize_ = totalTriangles <= QUANTIZE_MAX_TRIANGLES;
     }
 
-    TriangleMeshInterface(CustomGeometry* custom) : btTriangleIndexVertexArray()
+    TriangleMeshInterface(CustomGeometry* custom) :
+        btTriangleIndexVertexArray(),
+        checksum_(0)
     {
         const Vector<PODVector<CustomGeometryVertex> >& srcVertices = custom->GetVertices();
         unsigned totalVertexCount = 0;
@@ -184,33 +245,50 @@ public:
 
     /// OK to use quantization flag.
     bool useQuantize_;
+    /// Checksum of the source geometry.
+    unsigned checksum_;
 
 private:
     /// Shared vertex/index data used in the collision
     Vector<SharedArrayPtr<unsigned char> > dataArrays_;
 };
 
-TriangleMeshData::TriangleMeshData(Model* model, unsigned lodLevel) :
+TriangleMeshData::TriangleMeshData(Model* model, unsigned lodLevel, Deserializer* cooked) :
     meshInterface_(0),
     shape_(0),
-    infoMap_(0)
+    infoMap_(0),
+    bvhBuffer_(0),
+    checksum_(0),
+    cooked_(false)
 {
+    // Re-read the model's CPU-side geometry data if it was released after upload. The mesh interface keeps references to it
+    model->RequestCPUData();
     meshInterface_ = new TriangleMeshInterface(model, lodLevel);
-    shape_ = new btBvhTriangleMeshShape(meshInterface_, meshInterface_->useQuantize_, true);
+    checksum_ = meshInterface_->checksum_;
+    infoMap_ = new TriangleInfoMap();
+
+    if (cooked && LoadCooked(*cooked))
+    {
+        cooked_ = true;
+        return;
+    }
 
-    infoMap_ = new btTriangleInfoMap();
+    shape_ = new btBvhTriangleMeshShape(meshInterface_, meshInterface_->useQuantize_, true);
     btGenerateInternalEdgeInfo(shape_, infoMap_);
 }
 
 TriangleMeshData::TriangleMeshData(CustomGeometry* custom) :
     meshInterface_(0),
     shape_(0),
-    infoMap_(0)
+    infoMap_(0),
+    bvhBuffer_(0),
+    checksum_(0),
+    cooked_(false)
 {
     meshInterface_ = new TriangleMeshInterface(custom);
     shape_ = new btBvhTriangleMeshShape(meshInterface_, meshInterface_->useQuantize_, true);
 
-    infoMap_ = new btTriangleInfoMap();
+    infoMap_ = new TriangleInfoMap();
     btGenerateInternalEdgeInfo(shape_, infoMap_);
 }
 
@@ -219,6 +297,14 @@ TriangleMeshData::~TriangleMeshData()
     delete shape_;
     shape_ = 0;
 
+    // A BVH loaded from cooked data lives in-place in its buffer and is not owned by the shape
+    if (bvhBuffer_)
+    {
+        static_cast<btOptimizedBvh*>(bvhBuffer_)->~btOptimizedBvh();
+        btAlignedFree(bvhBuffer_);
+        bvhBuffer_ = 0;
+    }
+
     delete meshInterface_;
     meshInterface_ = 0;
 
@@ -226,8 +312,88 @@ TriangleMeshData::~TriangleMeshData()
     infoMap_ = 0;
 }
 
-ConvexData::ConvexData(Model* model, unsigned lodLevel)
+bool TriangleMeshData::SaveCooked(Serializer& dest) const
 {
+    btOptimizedBvh* bvh = shape_ ? shape_->getOptimizedBvh() : 0;
+    if (!bvh)
+        return false;
+
+    unsigned bvhSize = bvh->calculateSerializeBufferSize();
+    void* buffer = btAlignedAlloc(bvhSize, 16);
+    if (!bvh->serializeInPlace(buffer, bvhSize, false))
+    {
+        btAlignedFree(buffer);
+        LOGERROR("Failed to serialize triangle mesh BVH");
+        return false;
+    }
+
+    dest.WriteFileID("UCTM");
+    dest.WriteUInt(checksum_);
+    // The BVH is stored in its in-memory layout, so record the layout size to reject data cooked on another platform
+    dest.WriteUInt(sizeof(btOptimizedBvh));
+    dest.WriteUInt(bvhSize);
+    dest.Write(buffer, bvhSize);
+    static_cast<TriangleInfoMap*>(infoMap_)->Save(dest);
+
+    btAlignedFree(buffer);
+    return true;
+}
+
+bool TriangleMeshData::LoadCooked(Deserializer& source)
+{
+    if (source.ReadFileID() != "UCTM")
+    {
+        LOGERROR(source.GetName() + " is not a valid cooked triangle mesh file");
+        return false;
+    }
+
+    if (source.ReadUInt() != checksum_)
+    {
+        LOGDEBUG("Cooked triangle mesh " + source.GetName() + " does not match the model geometry, rebuilding");
+        return false;
+    }
+    if (source.ReadUInt() != sizeof(btOptimizedBvh))
+    {
+        LOGDEBUG("Cooked triangle mesh " + source.GetName() + " is from an incompatible platform, rebuilding");
+        return false;
+    }
+
+    unsigned bvhSize = source.ReadUInt();
+    if (bvhSize < sizeof(btOptimizedBvh) || bvhSize > source.GetSize() - source.GetPosition())
+    {
+        LOGERROR("Cooked triangle mesh " + source.GetName() + " is truncated");
+        return false;
+    }
+
+    bvhBuffer_ = btAlignedAlloc(bvhSize, 16);
+    btOptimizedBvh* bvh = 0;
+    if (source.Read(bvhBuffer_, bvhSize) == bvhSize)
+        bvh = btOptimizedBvh::deSerializeInPlace(bvhBuffer_, bvhSize, false);
+    if (!bvh || !static_cast<TriangleInfoMap*>(infoMap_)->Load(source))
+    {
+        LOGERROR("Failed to load cooked triangle mesh " + source.GetName());
+        if (bvh)
+            bvh->~btOptimizedBvh();
+        btAlignedFree(bvhBuffer_);
+        bvhBuffer_ = 0;
+        infoMap_->clear();
+        return false;
+    }
+
+    shape_ = new btBvhTriangleMeshShape(meshInterface_, meshInterface_->useQuantize_, false);
+    shape_->setOptimizedBvh(bvh);
+    shape_->setTriangleInfoMap(infoMap_);
+    return true;
+}
+
+ConvexData::ConvexData(Model* model, unsigned lodLevel, Deserializer* cooked) :
+    vertexCount_(0),
+    indexCount_(0),
+    checksum_(0),
+    cooked_(false)
+{
+    model->RequestCPUData();
+    
     PODVector<Vector3> vertices;
     unsigned numGeometries = model->GetNumGeometries();
 
@@ -264,10 +430,20 @@ ConvexData::ConvexData(Model* model, unsigned lodLevel)
         }
     }
 
-    BuildHull(vertices);
+    if (vertices.Size())
+        checksum_ = HashBytes(0, reinterpret_cast<const unsigned char*>(&vertices[0]), vertices.Size() * sizeof(Vector3));
+
+    if (cooked && LoadCooked(*cooked))
+        cooked_ = true;
+    else
+        BuildHull(vertices);
 }
 
-ConvexData::ConvexData(CustomGeometry* custom)
+ConvexData::ConvexData(CustomGeometry* custom) :
+    vertexCount_(0),
+    indexCount_(0),
+    checksum_(0),
+    cooked_(false)
 {
     const Vector<PODVector<CustomGeometryVertex> >& srcVertices = custom->GetVertices();
     PODVector<Vector3> vertices;
@@ -320,10 +496,63 @@ ConvexData::~ConvexData()
 {
 }
 
+bool ConvexData::SaveCooked(Serializer& dest) const
+{
+    dest.WriteFileID("UCCH");
+    dest.WriteUInt(checksum_);
+    dest.WriteUInt(vertexCount_);
+    if (vertexCount_)
+        dest.Write(vertexData_.Get(), vertexCount_ * sizeof(Vector3));
+    dest.WriteUInt(indexCount_);
+    if (indexCount_)
+        dest.Write(indexData_.Get(), indexCount_ * sizeof(unsigned));
+    return true;
+}
+
+bool ConvexData::LoadCooked(Deserializer& source)
+{
+    if (source.ReadFileID() != "UCCH")
+    {
+        LOGERROR(source.GetName() + " is not a valid cooked convex hull file");
+        return false;
+    }
+
+    if (source.ReadUInt() != checksum_)
+    {
+        LOGDEBUG("Cooked convex hull " + source.GetName() + " does not match the model geometry, rebuilding");
+        return false;
+    }
+
+    unsigned vertexCount = source.ReadUInt();
+    if (vertexCount > (source.GetSize() - source.GetPosition()) / sizeof(Vector3))
+    {
+        LOGERROR("Cooked convex hull " + source.GetName() + " is truncated");
+        return false;
+    }
+    SharedArrayPtr<Vector3> vertexData(new Vector3[vertexCount]);
+    source.Read(vertexData.Get(), vertexCount * sizeof(Vector3));
+
+    unsigned indexCount = source.ReadUInt();
+    if (indexCount > (source.GetSize() - source.GetPosition()) / sizeof(unsigned))
+    {
+        LOGERROR("Cooked convex hull " + source.GetName() + " is truncated");
+        return false;
+    }
+    SharedArrayPtr<unsigned> indexData(new unsigned[indexCount]);
+    source.Read(indexData.Get(), indexCount * sizeof(unsigned));
+
+    vertexData_ = vertexData;
+    vertexCount_ = vertexCount;
+    indexData_ = indexData;
+    indexCount_ = indexCount;
+    return true;
+}
+
 HeightfieldData::HeightfieldData(Terrain* terrain, unsigned lodLevel) :
     heightData_(terrain->GetHeightData()),
     spacing_(terrain->GetSpacing()),
     size_(terrain->GetNumVertices()),
+    skip_(1),
     minHeight_(0.0f),
     maxHeight_(0.0f)
 {
@@ -359,6 +588,7 @@ HeightfieldData::HeightfieldData(Terrain* terrain, unsigned lodLevel) :
 
             size_ = lodSize;
             spacing_ = lodSpacing;
+            skip_ = skip;
             heightData_ = lodHeightData;
         }
 
@@ -378,6 +608,37 @@ HeightfieldData::~HeightfieldData()
 {
 }
 
+bool HeightfieldData::UpdateRegion(Terrain* terrain, const IntRect& region)
+{
+    SharedArrayPtr<float> sourceData = terrain->GetHeightData();
+    const IntVector2& sourceSize = terrain->GetNumVertices();
+    if (!heightData_ || !sourceData)
+        return false;
+
+    // Convert to the vertically reversed internal coordinates, then to the heights of this LOD level
+    int startX = (Max(region.left_, 0) + skip_ - 1) / skip_;
+    int endX = Min(region.right_ / skip_, size_.x_ - 1);
+    int startY = (Max(sourceSize.y_ - 1 - region.bottom_, 0) + skip_ - 1) / skip_;
+    int endY = Min((sourceSize.y_ - 1 - region.top_) / skip_, size_.y_ - 1);
+    // On LOD level 0 the terrain's height data is used directly, so only the height range needs to be checked
+    bool copy = heightData_ != sourceData;
+    bool inRange = true;
+
+    for (int y = startY; y <= endY; ++y)
+    {
+        for (int x = startX; x <= endX; ++x)
+        {
+            float height = sourceData[y * skip_ * sourceSize.x_ + x * skip_];
+            if (copy)
+                heightData_[y * size_.x_ + x] = height;
+            if (height < minHeight_ || height > maxHeight_)
+                inRange = false;
+        }
+    }
+
+    return inRange;
+}
+
 bool HasDynamicBuffers(Model* model, unsigned lodLevel)
 {
     unsigned numGeometries = model->GetNumGeometries();
@@ -404,6 +665,40 @@ bool HasDynamicBuffers(Model* model, unsigned lodLevel)
     return false;
 }
 
+/// Create triangle mesh or convex hull geometry data from a model, using cooked data from the resource cache if it exists. Optionally save the cooked data next to the model if it had to be built.
+template <class T> T* CreateCookedGeometry(Model* model, unsigned lodLevel, ShapeType type, bool saveCooked)
+{
+    // Procedurally created models have no name and can not be cooked
+    if (model->GetName().Empty())
+        return new T(model, lodLevel);
+
+    ResourceCache* cache = model->GetSubsystem<ResourceCache>();
+    String cookedName = GetCookedGeometryName(model->GetName(), lodLevel, type);
+    SharedPtr<File> cookedFile;
+    if (cache->Exists(cookedName))
+        cookedFile = cache->GetFile(cookedName, false);
+
+    T* data = new T(model, lodLevel, cookedFile.Get());
+    if (data->cooked_ || !saveCooked)
+        return data;
+
+    // If the model is loaded from a package, the cooked data can not be saved next to it
+    String modelFileName = cache->GetResourceFileName(model->GetName());
+    if (modelFileName.Empty())
+        return data;
+
+    FileSystem* fileSystem = model->GetSubsystem<FileSystem>();
+    String path = GetPath(modelFileName) + "Cache/";
+    if (!fileSystem->DirExists(path))
+        fileSystem->CreateDir(path);
+
+    File file(model->GetContext(), path + GetFileNameAndExtension(cookedName), FILE_WRITE);
+    if (file.IsOpen())
+        data->SaveCooked(file);
+
+    return data;
+}
+
 CollisionShape::CollisionShape(Context* context) :
     Component(context),
     shape_(0),
@@ -931,6 +1226,7 @@ void CollisionShape::OnNodeSet(Node* node)
 
         // Terrain collision shape depends on the terrain component's geometry updates. Subscribe to them
         SubscribeToEvent(node, E_TERRAINCREATED, HANDLER(CollisionShape, HandleTerrainCreated));
+        SubscribeToEvent(node, E_TERRAINHEIGHTCHANGED, HANDLER(CollisionShape, HandleTerrainHeightChanged));
     }
 }
 
@@ -991,6 +1287,7 @@ btCompoundShape* CollisionShape::GetParentCompoundShape()
 void CollisionShape::UpdateShape()
 {
     PROFILE(UpdateCollisionShape);
+    MEMORY_TAG(MEMTAG_PHYSICS);
 
     ReleaseShape();
 
@@ -1055,12 +1352,14 @@ void CollisionShape::UpdateShape()
                 HashMap<Pair<Model*, unsigned>, SharedPtr<CollisionGeometryData> >::Iterator j = cache.Find(id);
                 if (j != cache.End())
                     geometry_ = j->second_;
+                // Check if model has dynamic buffers, do not cache or cook in that case
+                else if (HasDynamicBuffers(model_, lodLevel_))
+                    geometry_ = new TriangleMeshData(model_, lodLevel_);
                 else
                 {
-                    geometry_ = new TriangleMeshData(model_, lodLevel_);
-                    // Check if model has dynamic buffers, do not cache in that case
-                    if (!HasDynamicBuffers(model_, lodLevel_))
-                        cache[id] = geometry_;
+                    geometry_ = CreateCookedGeometry<TriangleMeshData>(model_, lodLevel_, SHAPE_TRIANGLEMESH,
+                        physicsWorld_->GetSaveCookedGeometry());
+                    cache[id] = geometry_;
                 }
 
                 TriangleMeshData* triMesh = static_cast<TriangleMeshData*>(geometry_.Get());
@@ -1094,12 +1393,14 @@ void CollisionShape::UpdateShape()
                 HashMap<Pair<Model*, unsigned>, SharedPtr<CollisionGeometryData> >::Iterator j = cache.Find(id);
                 if (j != cache.End())
                     geometry_ = j->second_;
+                // Check if model has dynamic buffers, do not cache or cook in that case
+                else if (HasDynamicBuffers(model_, lodLevel_))
+                    geometry_ = new ConvexData(model_, lodLevel_);
                 else
                 {
-                    geometry_ = new ConvexData(model_, lodLevel_);
-                    // Check if model has dynamic buffers, do not cache in that case
-                    if (!HasDynamicBuffers(model_, lodLevel_))
-                        cache[id] = geometry_;
+                    geometry_ = CreateCookedGeometry<ConvexData>(model_, lodLevel_, SHAPE_CONVEXHULL,
+                        physicsWorld_->GetSaveCookedGeometry());
+                    cache[id] = geometry_;
                 }
 
                 ConvexData* convex = static_cast<ConvexData*>(geometry_.Get());
@@ -1155,6 +1456,53 @@ void CollisionShape::HandleTerrainCreated(StringHash eventType, VariantMap& even
     }
 }
 
+void CollisionShape::HandleTerrainHeightChanged(StringHash eventType, VariantMap& eventData)
+{
+    if (shapeType_ != SHAPE_TERRAIN)
+        return;
+
+    using namespace TerrainHeightChanged;
+
+    Terrain* terrain = GetComponent<Terrain>();
+    HeightfieldData* heightfield = static_cast<HeightfieldData*>(geometry_.Get());
+    if (!terrain || !heightfield || heightfield->size_ != IntVector2((terrain->GetNumVertices().x_ - 1) / heightfield->skip_ + 1,
+        (terrain->GetNumVertices().y_ - 1) / heightfield->skip_ + 1))
+    {
+        // Terrain and shape do not match, so recreate fully
+        UpdateShape();
+        NotifyRigidBody();
+        return;
+    }
+
+    // Bullet reads the heights directly from the height data, but caches the height range and centers the shape on it
+    const IntRect& region = eventData[P_REGION].GetIntRect();
+    if (!heightfield->UpdateRegion(terrain, region))
+    {
+        UpdateShape();
+        NotifyRigidBody();
+    }
+
+    // Wake up the rigid bodies above the changed region so that they react to the new ground
+    if (physicsWorld_)
+    {
+        BoundingBox box;
+        box.Merge(terrain->HeightMapToWorld(IntVector2(region.left_, region.top_)));
+        box.Merge(terrain->HeightMapToWorld(IntVector2(region.right_, region.top_)));
+        box.Merge(terrain->HeightMapToWorld(IntVector2(region.left_, region.bottom_)));
+        box.Merge(terrain->HeightMapToWorld(IntVector2(region.right_, region.bottom_)));
+        box.min_.y_ = -M_LARGE_VALUE;
+        box.max_.y_ = M_LARGE_VALUE;
+
+        PODVector<RigidBody*> bodies;
+        physicsWorld_->GetRigidBodies(bodies, box);
+        for (PODVector<RigidBody*>::Iterator i = bodies.Begin(); i != bodies.End(); ++i)
+        {
+            if (*i != rigidBody_)
+                (*i)->Activate();
+        }
+    }
+}
+
 void CollisionShape::HandleModelReloadFinished(StringHash eventType, VariantMap& eventData)
 {
     if (physicsWorld_)
@@ -1166,4 +1514,33 @@ void CollisionShape::HandleModelReloadFinished(StringHash eventType, VariantMap&
     }
 }
 
+String GetCookedGeometryName(const String& modelName, unsigned lodLevel, ShapeType type)
+{
+    return GetPath(modelName) + "Cache/" + GetFileName(modelName) + "_" + String(lodLevel) + (type == SHAPE_CONVEXHULL ?
+        ".hull" : ".trimesh");
+}
+
+bool CookGeometry(Model* model, unsigned lodLevel, ShapeType type, Serializer& dest)
+{
+    if (!model || !model->GetNumGeometries())
+    {
+        LOGERROR("Null model or model without geometries, can not cook collision geometry");
+        return false;
+    }
+
+    if (type == SHAPE_TRIANGLEMESH)
+    {
+        SharedPtr<TriangleMeshData> data(new TriangleMeshData(model, lodLevel));
+        return data->SaveCooked(dest);
+    }
+    else if (type == SHAPE_CONVEXHULL)
+    {
+        SharedPtr<ConvexData> data(new ConvexData(model, lodLevel));
+        return data->SaveCooked(dest);
+    }
+
+    LOGERROR("Only triangle mesh and convex hull collision geometry can be cooked");
+    return false;
+}
+
 }
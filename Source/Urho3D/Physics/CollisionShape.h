@@ -38,10 +38,12 @@ namespace Urho3D
 {
 
 class CustomGeometry;
+class Deserializer;
 class Geometry;
 class Model;
 class PhysicsWorld;
 class RigidBody;
+class Serializer;
 class Terrain;
 class TriangleMeshInterface;
 
@@ -67,26 +69,39 @@ struct CollisionGeometryData : public RefCounted
 /// Triangle mesh geometry data.
 struct TriangleMeshData : public CollisionGeometryData
 {
-    /// Construct from a model.
-    TriangleMeshData(Model* model, unsigned lodLevel);
+    /// Construct from a model. If cooked data is given and matches the model geometry, the BVH and internal edge info are loaded from it instead of being built.
+    TriangleMeshData(Model* model, unsigned lodLevel, Deserializer* cooked = 0);
     /// Construct from a custom geometry.
     TriangleMeshData(CustomGeometry* custom);
     /// Destruct. Free geometry data.
     ~TriangleMeshData();
 
+    /// Save the BVH and internal edge info as cooked data. Return true if successful.
+    bool SaveCooked(Serializer& dest) const;
+
     /// Bullet triangle mesh interface.
     TriangleMeshInterface* meshInterface_;
     /// Bullet triangle mesh collision shape.
     btBvhTriangleMeshShape* shape_;
     /// Bullet triangle info map.
     btTriangleInfoMap* infoMap_;
+    /// Aligned buffer holding a BVH loaded from cooked data, or null if the BVH was built.
+    void* bvhBuffer_;
+    /// Checksum of the source geometry.
+    unsigned checksum_;
+    /// Loaded from cooked data flag.
+    bool cooked_;
+
+private:
+    /// Load the BVH and internal edge info from cooked data. Return true if successful.
+    bool LoadCooked(Deserializer& source);
 };
 
 /// Convex hull geometry data.
 struct ConvexData : public CollisionGeometryData
 {
-    /// Construct from a model.
-    ConvexData(Model* model, unsigned lodLevel);
+    /// Construct from a model. If cooked data is given and matches the model geometry, the hull is loaded from it instead of being built.
+    ConvexData(Model* model, unsigned lodLevel, Deserializer* cooked = 0);
     /// Construct from a custom geometry.
     ConvexData(CustomGeometry* custom);
     /// Destruct. Free geometry data.
@@ -94,6 +109,8 @@ struct ConvexData : public CollisionGeometryData
 
     /// Build the convex hull from vertices.
     void BuildHull(const PODVector<Vector3>& vertices);
+    /// Save the hull as cooked data. Return true if successful.
+    bool SaveCooked(Serializer& dest) const;
 
     /// Vertex data.
     SharedArrayPtr<Vector3> vertexData_;
@@ -103,6 +120,14 @@ struct ConvexData : public CollisionGeometryData
     SharedArrayPtr<unsigned> indexData_;
     /// Number of indices.
     unsigned indexCount_;
+    /// Checksum of the source geometry.
+    unsigned checksum_;
+    /// Loaded from cooked data flag.
+    bool cooked_;
+
+private:
+    /// Load the hull from cooked data. Return true if successful.
+    bool LoadCooked(Deserializer& source);
 };
 
 /// Heightfield geometry data.
@@ -113,12 +138,17 @@ struct HeightfieldData : public CollisionGeometryData
     /// Destruct. Free geometry data.
     ~HeightfieldData();
 
+    /// Copy changed heights from the terrain within a heightmap pixel region (inclusive.) Return false if the heights went outside the height range, in which case the shape needs to be recreated.
+    bool UpdateRegion(Terrain* terrain, const IntRect& region);
+
     /// Height data. On LOD level 0 the original height data will be used.
     SharedArrayPtr<float> heightData_;
     /// Vertex spacing.
     Vector3 spacing_;
     /// Heightmap size.
     IntVector2 size_;
+    /// Terrain vertex step between the heights.
+    int skip_;
     /// Minimum height.
     float minHeight_;
     /// Maximum height.
@@ -231,6 +261,8 @@ private:
     void UpdateShape();
     /// Update terrain collision shape from the terrain component.
     void HandleTerrainCreated(StringHash eventType, VariantMap& eventData);
+    /// Update terrain collision shape heights in place after a terrain region has changed.
+    void HandleTerrainHeightChanged(StringHash eventType, VariantMap& eventData);
     /// Update trimesh or convex shape after a model has reloaded itself.
     void HandleModelReloadFinished(StringHash eventType, VariantMap& eventData);
 
@@ -264,4 +296,9 @@ private:
     bool recreateShape_;
 };
 
+/// Return the resource name of cooked collision geometry for a model LOD level. Only triangle mesh and convex hull shapes can be cooked.
+URHO3D_API String GetCookedGeometryName(const String& modelName, unsigned lodLevel, ShapeType type);
+/// Build triangle mesh or convex hull collision geometry from a model LOD level and save it as cooked data. Return true if successful.
+URHO3D_API bool CookGeometry(Model* model, unsigned lodLevel, ShapeType type, Serializer& dest);
+
 }
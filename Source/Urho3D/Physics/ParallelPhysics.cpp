@@ -0,0 +1,319 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Physics/ParallelPhysics.h"
+
+#include <Bullet/BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <Bullet/BulletCollision/CollisionDispatch/btSimulationIslandManager.h>
+#include <Bullet/BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h>
+
+namespace Urho3D
+{
+
+static const int MIN_PARALLEL_PAIRS = 64;
+static const unsigned PAIR_GRAIN_SIZE = 16;
+
+/// Return the simulation island of a constraint. Same as in btDiscreteDynamicsWorld.
+static inline int GetConstraintIslandId(const btTypedConstraint* constraint)
+{
+    const btCollisionObject& bodyA = constraint->getRigidBodyA();
+    const btCollisionObject& bodyB = constraint->getRigidBodyB();
+    return bodyA.getIslandTag() >= 0 ? bodyA.getIslandTag() : bodyB.getIslandTag();
+}
+
+/// Constraint island order predicate. Same as in btDiscreteDynamicsWorld.
+struct ConstraintIslandCompare
+{
+    /// Compare constraints.
+    bool operator () (const btTypedConstraint* lhs, const btTypedConstraint* rhs) const
+    {
+        return GetConstraintIslandId(lhs) < GetConstraintIslandId(rhs);
+    }
+};
+
+/// Processes the narrowphase of a range of overlapping pairs. Used with WorkQueue::ParallelFor().
+struct PairProcessor
+{
+    /// Construct.
+    PairProcessor(btCollisionDispatcher& dispatcher, const btDispatcherInfo& dispatchInfo) :
+        dispatcher_(dispatcher),
+        dispatchInfo_(dispatchInfo)
+    {
+    }
+    
+    /// Process a range of pairs.
+    void operator () (btBroadphasePair* start, btBroadphasePair* end, unsigned threadIndex)
+    {
+        btNearCallback nearCallback = dispatcher_.getNearCallback();
+        for (btBroadphasePair* pair = start; pair < end; ++pair)
+            nearCallback(*pair, dispatcher_, dispatchInfo_);
+    }
+    
+    /// Collision dispatcher.
+    btCollisionDispatcher& dispatcher_;
+    /// Dispatch info.
+    const btDispatcherInfo& dispatchInfo_;
+};
+
+/// Gathers the simulation islands into batches for solving in parallel.
+struct IslandCollector : public btSimulationIslandManager::IslandCallback
+{
+    /// Construct.
+    IslandCollector(ParallelDynamicsWorld& world, btContactSolverInfo& solverInfo, btTypedConstraint** constraints, int numConstraints) :
+        world_(world),
+        solverInfo_(solverInfo),
+        constraints_(constraints),
+        numConstraints_(numConstraints),
+        currentBatch_(M_MAX_UNSIGNED)
+    {
+    }
+    
+    /// Add an island to a batch.
+    virtual void processIsland(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds, int islandId)
+    {
+        // If islands are not split, solve everything at once
+        if (islandId < 0)
+        {
+            world_.getConstraintSolver()->solveGroup(bodies, numBodies, manifolds, numManifolds, constraints_, numConstraints_,
+                solverInfo_, world_.getDebugDrawer(), world_.getDispatcher());
+            return;
+        }
+        
+        // Find the constraints of this island. They are sorted by island
+        btTypedConstraint** islandConstraints = 0;
+        int numIslandConstraints = 0;
+        int i = 0;
+        for (; i < numConstraints_; ++i)
+        {
+            if (GetConstraintIslandId(constraints_[i]) == islandId)
+            {
+                islandConstraints = &constraints_[i];
+                break;
+            }
+        }
+        for (; i < numConstraints_ && GetConstraintIslandId(constraints_[i]) == islandId; ++i)
+            ++numIslandConstraints;
+        
+        bool kinematic = false;
+        for (i = 0; i < numManifolds && !kinematic; ++i)
+            kinematic = manifolds[i]->getBody0()->isKinematicObject() || manifolds[i]->getBody1()->isKinematicObject();
+        for (i = 0; i < numIslandConstraints && !kinematic; ++i)
+        {
+            kinematic = islandConstraints[i]->getRigidBodyA().isKinematicObject() ||
+                islandConstraints[i]->getRigidBodyB().isKinematicObject();
+        }
+        
+        unsigned index = 0;
+        if (!kinematic)
+        {
+            if (currentBatch_ == M_MAX_UNSIGNED)
+                currentBatch_ = world_.AddBatch();
+            index = currentBatch_;
+        }
+        
+        IslandBatch& batch = world_.batches_[index];
+        for (i = 0; i < numBodies; ++i)
+            batch.bodies_.Push(bodies[i]);
+        for (i = 0; i < numManifolds; ++i)
+            batch.manifolds_.Push(manifolds[i]);
+        for (i = 0; i < numIslandConstraints; ++i)
+            batch.constraints_.Push(islandConstraints[i]);
+        
+        // Small islands are combined into one batch like btDiscreteDynamicsWorld does, to reduce the solver overhead
+        if (!kinematic && (solverInfo_.m_minimumSolverBatchSize <= 1 ||
+            (int)(batch.manifolds_.Size() + batch.constraints_.Size()) > solverInfo_.m_minimumSolverBatchSize))
+            currentBatch_ = M_MAX_UNSIGNED;
+    }
+    
+    /// Dynamics world.
+    ParallelDynamicsWorld& world_;
+    /// Solver info.
+    btContactSolverInfo& solverInfo_;
+    /// Constraints sorted by island.
+    btTypedConstraint** constraints_;
+    /// Number of constraints.
+    int numConstraints_;
+    /// Index of the batch being filled, or M_MAX_UNSIGNED if a new batch should be started.
+    unsigned currentBatch_;
+};
+
+/// Solves a range of island batches. Used with WorkQueue::ParallelFor().
+struct IslandSolver
+{
+    /// Construct.
+    IslandSolver(ParallelDynamicsWorld& world, btContactSolverInfo& solverInfo) :
+        world_(world),
+        solverInfo_(solverInfo)
+    {
+    }
+    
+    /// Solve a range of batches.
+    void operator () (IslandBatch* start, IslandBatch* end, unsigned threadIndex)
+    {
+        btConstraintSolver* solver = world_.GetThreadSolver(threadIndex);
+        
+        for (IslandBatch* batch = start; batch < end; ++batch)
+        {
+            if (batch->bodies_.Empty() && batch->manifolds_.Empty() && batch->constraints_.Empty())
+                continue;
+            
+            solver->solveGroup(batch->bodies_.Size() ? &batch->bodies_[0] : 0, batch->bodies_.Size(),
+                batch->manifolds_.Size() ? &batch->manifolds_[0] : 0, batch->manifolds_.Size(),
+                batch->constraints_.Size() ? &batch->constraints_[0] : 0, batch->constraints_.Size(), solverInfo_, 0,
+                world_.getDispatcher());
+        }
+    }
+    
+    /// Dynamics world.
+    ParallelDynamicsWorld& world_;
+    /// Solver info.
+    btContactSolverInfo& solverInfo_;
+};
+
+ParallelCollisionDispatcher::ParallelCollisionDispatcher(btCollisionConfiguration* collisionConfiguration) :
+    btCollisionDispatcher(collisionConfiguration),
+    parallel_(false)
+{
+}
+
+btPersistentManifold* ParallelCollisionDispatcher::getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1)
+{
+    if (!parallel_)
+        return btCollisionDispatcher::getNewManifold(b0, b1);
+    
+    MutexLock lock(allocationMutex_);
+    return btCollisionDispatcher::getNewManifold(b0, b1);
+}
+
+void ParallelCollisionDispatcher::releaseManifold(btPersistentManifold* manifold)
+{
+    if (!parallel_)
+    {
+        btCollisionDispatcher::releaseManifold(manifold);
+        return;
+    }
+    
+    MutexLock lock(allocationMutex_);
+    btCollisionDispatcher::releaseManifold(manifold);
+}
+
+void* ParallelCollisionDispatcher::allocateCollisionAlgorithm(int size)
+{
+    if (!parallel_)
+        return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+    
+    MutexLock lock(allocationMutex_);
+    return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+}
+
+void ParallelCollisionDispatcher::freeCollisionAlgorithm(void* ptr)
+{
+    if (!parallel_)
+    {
+        btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+        return;
+    }
+    
+    MutexLock lock(allocationMutex_);
+    btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+}
+
+void ParallelCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo,
+    btDispatcher* dispatcher)
+{
+    int numPairs = pairCache->getNumOverlappingPairs();
+    
+    if (!workQueue_ || !workQueue_->GetNumThreads() || numPairs < MIN_PARALLEL_PAIRS ||
+        dispatchInfo.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE)
+    {
+        btCollisionDispatcher::dispatchAllCollisionPairs(pairCache, dispatchInfo, dispatcher);
+        return;
+    }
+    
+    // The default pair callback never removes pairs from the cache, so the pair array can be processed directly
+    btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+    PairProcessor processor(*this, dispatchInfo);
+    parallel_ = true;
+    workQueue_->ParallelFor(pairs, pairs + numPairs, PAIR_GRAIN_SIZE, processor);
+    parallel_ = false;
+}
+
+ParallelDynamicsWorld::ParallelDynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* broadphase,
+    btConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration) :
+    btDiscreteDynamicsWorld(dispatcher, broadphase, constraintSolver, collisionConfiguration),
+    numBatches_(0)
+{
+}
+
+ParallelDynamicsWorld::~ParallelDynamicsWorld()
+{
+    for (unsigned i = 0; i < threadSolvers_.Size(); ++i)
+        delete threadSolvers_[i];
+}
+
+void ParallelDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
+{
+    if (!workQueue_ || !workQueue_->GetNumThreads())
+    {
+        btDiscreteDynamicsWorld::solveConstraints(solverInfo);
+        return;
+    }
+    
+    m_sortedConstraints.resize(m_constraints.size());
+    for (int i = 0; i < m_constraints.size(); ++i)
+        m_sortedConstraints[i] = m_constraints[i];
+    m_sortedConstraints.quickSort(ConstraintIslandCompare());
+    btTypedConstraint** constraints = m_sortedConstraints.size() ? &m_sortedConstraints[0] : 0;
+    
+    // Gather the islands into batches. The first batch holds the islands that touch kinematic bodies
+    numBatches_ = 0;
+    AddBatch();
+    IslandCollector collector(*this, solverInfo, constraints, m_sortedConstraints.size());
+    m_constraintSolver->prepareSolve(getNumCollisionObjects(), getDispatcher()->getNumManifolds());
+    m_islandManager->buildAndProcessIslands(getDispatcher(), this, &collector);
+    
+    // Each thread needs its own solver, as the solver keeps its working data in member variables
+    unsigned numThreads = workQueue_->GetNumThreads();
+    while (threadSolvers_.Size() < numThreads)
+        threadSolvers_.Push(new btSequentialImpulseConstraintSolver());
+    
+    IslandSolver solver(*this, solverInfo);
+    workQueue_->ParallelFor(&batches_[0], &batches_[0] + numBatches_, 1, solver);
+    
+    m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
+}
+
+unsigned ParallelDynamicsWorld::AddBatch()
+{
+    if (numBatches_ >= batches_.Size())
+        batches_.Resize(numBatches_ + 1);
+    
+    batches_[numBatches_].Clear();
+    return numBatches_++;
+}
+
+btConstraintSolver* ParallelDynamicsWorld::GetThreadSolver(unsigned threadIndex)
+{
+    return threadIndex ? threadSolvers_[threadIndex - 1] : m_constraintSolver;
+}
+
+}
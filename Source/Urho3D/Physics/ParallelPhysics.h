@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Container/Vector.h"
+#include "../Core/Mutex.h"
+#include "../Core/WorkQueue.h"
+
+#include <Bullet/BulletCollision/CollisionDispatch/btCollisionDispatcher.h>
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+
+class btSequentialImpulseConstraintSolver;
+
+namespace Urho3D
+{
+
+/// Bullet collision dispatcher which processes the overlapping pairs in parallel using the work queue.
+class ParallelCollisionDispatcher : public btCollisionDispatcher
+{
+public:
+    /// Construct.
+    ParallelCollisionDispatcher(btCollisionConfiguration* collisionConfiguration);
+    
+    /// Create a contact manifold.
+    virtual btPersistentManifold* getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1);
+    /// Destroy a contact manifold.
+    virtual void releaseManifold(btPersistentManifold* manifold);
+    /// Allocate memory for a collision algorithm.
+    virtual void* allocateCollisionAlgorithm(int size);
+    /// Free memory of a collision algorithm.
+    virtual void freeCollisionAlgorithm(void* ptr);
+    /// Process the narrowphase of all overlapping pairs.
+    virtual void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo, btDispatcher* dispatcher);
+    
+    /// Set work queue to use. Null disables parallel processing.
+    void SetWorkQueue(WorkQueue* queue) { workQueue_ = queue; }
+    
+private:
+    /// Work queue.
+    WeakPtr<WorkQueue> workQueue_;
+    /// Mutex for manifold and algorithm allocation while processing in parallel.
+    Mutex allocationMutex_;
+    /// Processing in parallel flag.
+    bool parallel_;
+};
+
+/// Bodies, contact manifolds and constraints of one or more simulation islands, solved as a group.
+struct IslandBatch
+{
+    /// Clear for reuse.
+    void Clear()
+    {
+        bodies_.Clear();
+        manifolds_.Clear();
+        constraints_.Clear();
+    }
+    
+    /// Rigid bodies.
+    PODVector<btCollisionObject*> bodies_;
+    /// Contact manifolds.
+    PODVector<btPersistentManifold*> manifolds_;
+    /// Constraints.
+    PODVector<btTypedConstraint*> constraints_;
+};
+
+/// Bullet dynamics world which solves the simulation islands in parallel using the work queue.
+class ParallelDynamicsWorld : public btDiscreteDynamicsWorld
+{
+    friend struct IslandCollector;
+    friend struct IslandSolver;
+    
+public:
+    /// Construct.
+    ParallelDynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* broadphase, btConstraintSolver* constraintSolver,
+        btCollisionConfiguration* collisionConfiguration);
+    /// Destruct.
+    virtual ~ParallelDynamicsWorld();
+    
+    /// Set work queue to use. Null disables parallel solving.
+    void SetWorkQueue(WorkQueue* queue) { workQueue_ = queue; }
+    /// Synchronize the motion states of active bodies to transforms interpolated between the last two fixed steps, when the steps have been taken one at a time.
+    void SynchronizeInterpolated(btScalar localTime, btScalar fixedTimeStep)
+    {
+        m_localTime = localTime;
+        m_fixedTimeStep = fixedTimeStep;
+        synchronizeMotionStates();
+    }
+    
+protected:
+    /// Solve the contacts and constraints of all simulation islands.
+    virtual void solveConstraints(btContactSolverInfo& solverInfo);
+    
+private:
+    /// Add a cleared island batch to the end of the batch list and return its index.
+    unsigned AddBatch();
+    /// Return the constraint solver to use from a work queue thread.
+    btConstraintSolver* GetThreadSolver(unsigned threadIndex);
+    
+    /// Work queue.
+    WeakPtr<WorkQueue> workQueue_;
+    /// Island batches. The first is reserved for the islands that touch kinematic bodies, as the solver writes to those bodies and they may be shared between islands.
+    Vector<IslandBatch> batches_;
+    /// Number of island batches in use.
+    unsigned numBatches_;
+    /// Constraint solvers for the worker threads.
+    PODVector<btSequentialImpulseConstraintSolver*> threadSolvers_;
+};
+
+}
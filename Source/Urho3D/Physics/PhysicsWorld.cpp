@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../IO/Log.h"
+#include "../Core/MemoryTracker.h"
 #include "../Graphics/Model.h"
 #include "../Core/Mutex.h"
 #include "../Physics/PhysicsEvents.h"
@@ -32,6 +33,8 @@
 #include "../Physics/PhysicsWorld.h"
 #include "../Core/Profiler.h"
 #include "../Math/Ray.h"
+#include "../Physics/ParallelPhysics.h"
+#include "../Scene/LogicComponent.h"
 #include "../Physics/RigidBody.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
@@ -55,7 +58,10 @@ const char* PHYSICS_CATEGORY = "Physics";
 extern const char* SUBSYSTEM_CATEGORY;
 
 static const int MAX_SOLVER_ITERATIONS = 256;
+static const unsigned RAYCAST_BATCH_GRAIN_SIZE = 16;
 static const int DEFAULT_FPS = 60;
+static const unsigned DEFAULT_NUM_SNAPSHOTS = 16;
+static const float UNFREEZE_DISTANCE_FACTOR = 0.9f;
 static const Vector3 DEFAULT_GRAVITY = Vector3(0.0f, -9.81f, 0.0f);
 
 static bool CompareRaycastResults(const PhysicsRaycastResult& lhs, const PhysicsRaycastResult& rhs)
@@ -110,6 +116,203 @@ struct PhysicsQueryCallback : public btCollisionWorld::ContactResultCallback
     unsigned collisionMask_;
 };
 
+/// Traverse a broadphase tree with a ray or a swept AABB. Same as btDbvt::rayTestInternal(), but uses a caller-supplied stack so that queries can run in parallel.
+template <class T> static void RayTestTree(const btDbvtNode* root, const btVector3& rayFrom, const btVector3& rayDirectionInverse,
+    const unsigned signs[3], btScalar lambdaMax, const btVector3& aabbMin, const btVector3& aabbMax, PODVector<const btDbvtNode*>& stack,
+    T& tester)
+{
+    if (!root)
+        return;
+
+    stack.Clear();
+    stack.Push(root);
+    btVector3 bounds[2];
+
+    while (!stack.Empty())
+    {
+        const btDbvtNode* node = stack.Back();
+        stack.Pop();
+
+        bounds[0] = node->volume.Mins() - aabbMax;
+        bounds[1] = node->volume.Maxs() - aabbMin;
+        btScalar tMin = 1.0f;
+        if (btRayAabb2(rayFrom, rayDirectionInverse, signs, bounds, tMin, 0.0f, lambdaMax))
+        {
+            if (node->isinternal())
+            {
+                stack.Push(node->childs[0]);
+                stack.Push(node->childs[1]);
+            }
+            else
+                tester.Test(static_cast<btCollisionObject*>(static_cast<btBroadphaseProxy*>(node->data)->m_clientObject));
+        }
+    }
+}
+
+/// Traverse both broadphase trees with a ray or a swept AABB.
+template <class T> static void RayTestBroadphase(btDbvtBroadphase* broadphase, const btVector3& rayFrom, const btVector3& rayTo,
+    const btVector3& aabbMin, const btVector3& aabbMax, PODVector<const btDbvtNode*>& stack, T& tester)
+{
+    btVector3 rayDir = rayTo - rayFrom;
+    if (rayDir.fuzzyZero())
+        return;
+    rayDir.normalize();
+
+    btVector3 rayDirectionInverse(rayDir[0] == 0.0f ? BT_LARGE_FLOAT : 1.0f / rayDir[0], rayDir[1] == 0.0f ? BT_LARGE_FLOAT :
+        1.0f / rayDir[1], rayDir[2] == 0.0f ? BT_LARGE_FLOAT : 1.0f / rayDir[2]);
+    unsigned signs[3] = { rayDirectionInverse[0] < 0.0f, rayDirectionInverse[1] < 0.0f, rayDirectionInverse[2] < 0.0f };
+    btScalar lambdaMax = rayDir.dot(rayTo - rayFrom);
+
+    RayTestTree(broadphase->m_sets[0].m_root, rayFrom, rayDirectionInverse, signs, lambdaMax, aabbMin, aabbMax, stack, tester);
+    RayTestTree(broadphase->m_sets[1].m_root, rayFrom, rayDirectionInverse, signs, lambdaMax, aabbMin, aabbMax, stack, tester);
+}
+
+/// Collision object tester for batched raycasts.
+struct BatchRayTester
+{
+    /// Construct.
+    BatchRayTester(const btVector3& rayFrom, const btVector3& rayTo, btCollisionWorld::RayResultCallback& callback) :
+        rayFrom_(btQuaternion::getIdentity(), rayFrom),
+        rayTo_(btQuaternion::getIdentity(), rayTo),
+        callback_(callback)
+    {
+    }
+
+    /// Test a collision object.
+    void Test(btCollisionObject* object)
+    {
+        if (callback_.m_closestHitFraction == 0.0f || !callback_.needsCollision(object->getBroadphaseHandle()))
+            return;
+
+        btCollisionWorld::rayTestSingle(rayFrom_, rayTo_, object, object->getCollisionShape(), object->getWorldTransform(), callback_);
+    }
+
+    /// Ray start transform.
+    btTransform rayFrom_;
+    /// Ray end transform.
+    btTransform rayTo_;
+    /// Result callback.
+    btCollisionWorld::RayResultCallback& callback_;
+};
+
+/// Collision object tester for batched sphere sweeps.
+struct BatchSweepTester
+{
+    /// Construct.
+    BatchSweepTester(const btConvexShape* shape, const btVector3& rayFrom, const btVector3& rayTo,
+        btCollisionWorld::ConvexResultCallback& callback) :
+        shape_(shape),
+        rayFrom_(btQuaternion::getIdentity(), rayFrom),
+        rayTo_(btQuaternion::getIdentity(), rayTo),
+        callback_(callback)
+    {
+    }
+
+    /// Test a collision object.
+    void Test(btCollisionObject* object)
+    {
+        if (callback_.m_closestHitFraction == 0.0f || !callback_.needsCollision(object->getBroadphaseHandle()))
+            return;
+
+        btCollisionWorld::objectQuerySingle(shape_, rayFrom_, rayTo_, object, object->getCollisionShape(), object->getWorldTransform(),
+            callback_, 0.0f);
+    }
+
+    /// Swept shape.
+    const btConvexShape* shape_;
+    /// Sweep start transform.
+    btTransform rayFrom_;
+    /// Sweep end transform.
+    btTransform rayTo_;
+    /// Result callback.
+    btCollisionWorld::ConvexResultCallback& callback_;
+};
+
+/// Performs a range of batched raycast and sphere sweep queries. Used with WorkQueue::ParallelFor().
+struct RaycastBatchProcessor
+{
+    /// Construct.
+    RaycastBatchProcessor(btDbvtBroadphase* broadphase, const PhysicsRaycastQuery* queries, PhysicsRaycastResult* results,
+        Vector<PODVector<const btDbvtNode*> >& stacks) :
+        broadphase_(broadphase),
+        queries_(queries),
+        results_(results),
+        stacks_(stacks)
+    {
+    }
+
+    /// Process a range of queries, given as pointers to their results.
+    void operator () (PhysicsRaycastResult* start, PhysicsRaycastResult* end, unsigned threadIndex)
+    {
+        PODVector<const btDbvtNode*>& stack = stacks_[threadIndex];
+
+        for (PhysicsRaycastResult* result = start; result < end; ++result)
+        {
+            const PhysicsRaycastQuery& query = queries_[result - results_];
+            btVector3 rayFrom = ToBtVector3(query.ray_.origin_);
+            btVector3 rayTo = ToBtVector3(query.ray_.origin_ + query.maxDistance_ * query.ray_.direction_);
+            const btCollisionObject* hitObject = 0;
+
+            if (query.radius_ > 0.0f)
+            {
+                btSphereShape shape(query.radius_);
+                btVector3 aabbMin, aabbMax;
+                shape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+
+                btCollisionWorld::ClosestConvexResultCallback convexCallback(rayFrom, rayTo);
+                convexCallback.m_collisionFilterGroup = (short)0xffff;
+                convexCallback.m_collisionFilterMask = query.collisionMask_;
+                BatchSweepTester tester(&shape, rayFrom, rayTo, convexCallback);
+                RayTestBroadphase(broadphase_, rayFrom, rayTo, aabbMin, aabbMax, stack, tester);
+
+                if (convexCallback.hasHit())
+                {
+                    hitObject = convexCallback.m_hitCollisionObject;
+                    result->position_ = ToVector3(convexCallback.m_hitPointWorld);
+                    result->normal_ = ToVector3(convexCallback.m_hitNormalWorld);
+                }
+            }
+            else
+            {
+                btCollisionWorld::ClosestRayResultCallback rayCallback(rayFrom, rayTo);
+                rayCallback.m_collisionFilterGroup = (short)0xffff;
+                rayCallback.m_collisionFilterMask = query.collisionMask_;
+                BatchRayTester tester(rayFrom, rayTo, rayCallback);
+                RayTestBroadphase(broadphase_, rayFrom, rayTo, btVector3(0.0f, 0.0f, 0.0f), btVector3(0.0f, 0.0f, 0.0f), stack, tester);
+
+                if (rayCallback.hasHit())
+                {
+                    hitObject = rayCallback.m_collisionObject;
+                    result->position_ = ToVector3(rayCallback.m_hitPointWorld);
+                    result->normal_ = ToVector3(rayCallback.m_hitNormalWorld);
+                }
+            }
+
+            if (hitObject)
+            {
+                result->distance_ = (result->position_ - query.ray_.origin_).Length();
+                result->body_ = static_cast<RigidBody*>(hitObject->getUserPointer());
+            }
+            else
+            {
+                result->position_ = Vector3::ZERO;
+                result->normal_ = Vector3::ZERO;
+                result->distance_ = M_INFINITY;
+                result->body_ = 0;
+            }
+        }
+    }
+
+    /// Broadphase.
+    btDbvtBroadphase* broadphase_;
+    /// Queries.
+    const PhysicsRaycastQuery* queries_;
+    /// Results.
+    PhysicsRaycastResult* results_;
+    /// Traversal stacks per thread.
+    Vector<PODVector<const btDbvtNode*> >& stacks_;
+};
+
 PhysicsWorld::PhysicsWorld(Context* context) :
     Component(context),
     collisionConfiguration_(0),
@@ -120,9 +323,17 @@ PhysicsWorld::PhysicsWorld(Context* context) :
     fps_(DEFAULT_FPS),
     maxSubSteps_(0),
     timeAcc_(0.0f),
+    simulationStep_(0),
+    numSnapshots_(DEFAULT_NUM_SNAPSHOTS),
+    nextSnapshot_(0),
     maxNetworkAngularVelocity_(DEFAULT_MAX_NETWORK_ANGULAR_VELOCITY),
+    freezeDistance_(0.0f),
+    numFrozenBodies_(0),
     interpolation_(true),
     internalEdge_(true),
+    parallelSimulation_(false),
+    deterministic_(false),
+    saveCookedGeometry_(false),
     applyingTransforms_(false),
     debugRenderer_(0),
     debugMode_(btIDebugDraw::DBG_DrawWireframe | btIDebugDraw::DBG_DrawConstraints | btIDebugDraw::DBG_DrawConstraintLimits)
@@ -130,10 +341,10 @@ PhysicsWorld::PhysicsWorld(Context* context) :
     gContactAddedCallback = CustomMaterialCombinerCallback;
 
     collisionConfiguration_ = new btDefaultCollisionConfiguration();
-    collisionDispatcher_ = new btCollisionDispatcher(collisionConfiguration_);
+    collisionDispatcher_ = new ParallelCollisionDispatcher(collisionConfiguration_);
     broadphase_ = new btDbvtBroadphase();
     solver_ = new btSequentialImpulseConstraintSolver();
-    world_ = new btDiscreteDynamicsWorld(collisionDispatcher_, broadphase_, solver_, collisionConfiguration_);
+    world_ = new ParallelDynamicsWorld(collisionDispatcher_, broadphase_, solver_, collisionConfiguration_);
 
     world_->setGravity(ToBtVector3(DEFAULT_GRAVITY));
     world_->getDispatchInfo().m_useContinuous = true;
@@ -186,6 +397,9 @@ void PhysicsWorld::RegisterObject(Context* context)
     ATTRIBUTE("Interpolation", bool, interpolation_, true, AM_FILE);
     ATTRIBUTE("Internal Edge Utility", bool, internalEdge_, true, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Split Impulse", GetSplitImpulse, SetSplitImpulse, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Parallel Simulation", GetParallelSimulation, SetParallelSimulation, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Deterministic", GetDeterministic, SetDeterministic, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Freeze Distance", GetFreezeDistance, SetFreezeDistance, float, 0.0f, AM_DEFAULT);
 }
 
 bool PhysicsWorld::isVisible(const btVector3& aabbMin, const btVector3& aabbMax)
@@ -231,6 +445,9 @@ void PhysicsWorld::draw3dText(const btVector3& location, const char* textString)
 void PhysicsWorld::Update(float timeStep)
 {
     PROFILE(UpdatePhysics);
+    MEMORY_TAG(MEMTAG_PHYSICS);
+
+    UpdateSimulationLod();
 
     float internalTimeStep = 1.0f / fps_;
     int maxSubSteps = (int)(timeStep * fps_) + 1;
@@ -242,35 +459,179 @@ void PhysicsWorld::Update(float timeStep)
     else if (maxSubSteps_ > 0)
         maxSubSteps = Min(maxSubSteps, maxSubSteps_);
 
+    // Deterministic mode always takes whole fixed steps
+    if (deterministic_ && maxSubSteps_ < 0)
+    {
+        internalTimeStep = 1.0f / fps_;
+        maxSubSteps = (int)(timeStep * fps_) + 1;
+    }
+
     delayedWorldTransforms_.Clear();
 
-    if (interpolation_)
+    if (interpolation_ && !deterministic_)
+    {
         world_->stepSimulation(timeStep, maxSubSteps, internalTimeStep);
+        ApplyDelayedWorldTransforms();
+    }
     else
     {
+        // In deterministic mode count the steps here, as the time accumulator is part of the snapshots
         timeAcc_ += timeStep;
         while (timeAcc_ >= internalTimeStep && maxSubSteps > 0)
         {
             world_->stepSimulation(internalTimeStep, 0, internalTimeStep);
+            // Apply after each step so that fixed update logic sees the transforms of the previous step, as before
+            if (!interpolation_)
+                ApplyDelayedWorldTransforms();
             timeAcc_ -= internalTimeStep;
             --maxSubSteps;
         }
+
+        if (interpolation_)
+        {
+            static_cast<ParallelDynamicsWorld*>(world_)->SynchronizeInterpolated(Min(timeAcc_, internalTimeStep),
+                internalTimeStep);
+            ApplyDelayedWorldTransforms();
+        }
+    }
+}
+
+bool PhysicsWorld::HasSnapshot(unsigned step) const
+{
+    for (unsigned i = 0; i < snapshots_.Size(); ++i)
+    {
+        if (snapshots_[i].valid_ && snapshots_[i].step_ == step)
+            return true;
+    }
+
+    return false;
+}
+
+void PhysicsWorld::UpdateParallelSimulation()
+{
+    WorkQueue* queue = parallelSimulation_ && !deterministic_ ? GetSubsystem<WorkQueue>() : 0;
+    static_cast<ParallelCollisionDispatcher*>(collisionDispatcher_)->SetWorkQueue(queue);
+    static_cast<ParallelDynamicsWorld*>(world_)->SetWorkQueue(queue);
+}
+
+void PhysicsWorld::ResetCollisionState()
+{
+    btCollisionObjectArray& objects = world_->getCollisionObjectArray();
+    PODVector<Pair<short, short> > filters((unsigned)objects.size());
+
+    // Destroying the proxies also removes their contact pairs and manifolds
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        btBroadphaseProxy* proxy = objects[i]->getBroadphaseHandle();
+        if (proxy)
+        {
+            filters[i] = MakePair(proxy->m_collisionFilterGroup, proxy->m_collisionFilterMask);
+            broadphase_->destroyProxy(proxy, collisionDispatcher_);
+            objects[i]->setBroadphaseHandle(0);
+        }
+    }
+
+    // Once empty, the broadphase resets its trees and counters. Readd the objects in their existing order
+    broadphase_->resetPool(collisionDispatcher_);
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        btCollisionObject* object = objects[i];
+        btVector3 aabbMin, aabbMax;
+        object->getCollisionShape()->getAabb(object->getWorldTransform(), aabbMin, aabbMax);
+        object->setBroadphaseHandle(broadphase_->createProxy(aabbMin, aabbMax, object->getCollisionShape()->getShapeType(),
+            object, filters[i].first_, filters[i].second_, collisionDispatcher_, 0));
+    }
+
+    solver_->reset();
+}
+
+void PhysicsWorld::UpdateSimulationLod()
+{
+    // Drop the observers whose nodes have been destroyed
+    for (Vector<WeakPtr<Node> >::Iterator i = observers_.Begin(); i != observers_.End();)
+    {
+        if (i->Expired())
+            i = observers_.Erase(i);
+        else
+            ++i;
+    }
+
+    bool enabled = freezeDistance_ > 0.0f && !observers_.Empty();
+    if (!enabled && !numFrozenBodies_)
+        return;
+
+    PROFILE(UpdateSimulationLod);
+
+    PODVector<Vector3> observerPositions;
+    observerPositions.Reserve(observers_.Size());
+    for (Vector<WeakPtr<Node> >::ConstIterator i = observers_.Begin(); i != observers_.End(); ++i)
+        observerPositions.Push((*i)->GetWorldPosition());
+
+    // Use a smaller distance for unfreezing so that bodies at the boundary do not toggle on every frame
+    float freezeDistanceSquared = freezeDistance_ * freezeDistance_;
+    float unfreezeDistance = freezeDistance_ * UNFREEZE_DISTANCE_FACTOR;
+    float unfreezeDistanceSquared = unfreezeDistance * unfreezeDistance;
+
+    numFrozenBodies_ = 0;
+
+    for (PODVector<RigidBody*>::ConstIterator i = rigidBodies_.Begin(); i != rigidBodies_.End(); ++i)
+    {
+        RigidBody* rigidBody = *i;
+        btRigidBody* body = rigidBody->GetBody();
+        bool canFreeze = enabled && body && body->getBroadphaseHandle() && rigidBody->GetMass() > 0.0f &&
+            !rigidBody->IsKinematic();
+
+        if (!canFreeze)
+        {
+            rigidBody->SetFrozen(false);
+            continue;
+        }
+
+        Vector3 position = ToVector3(body->getWorldTransform().getOrigin());
+        float minDistanceSquared = M_INFINITY;
+        for (PODVector<Vector3>::ConstIterator j = observerPositions.Begin(); j != observerPositions.End(); ++j)
+            minDistanceSquared = Min(minDistanceSquared, (position - *j).LengthSquared());
+
+        if (!rigidBody->IsFrozen() && minDistanceSquared > freezeDistanceSquared)
+            rigidBody->SetFrozen(true);
+        else if (rigidBody->IsFrozen() && minDistanceSquared < unfreezeDistanceSquared)
+            rigidBody->SetFrozen(false);
+
+        if (rigidBody->IsFrozen())
+            ++numFrozenBodies_;
     }
+}
+
+PhysicsSnapshot* PhysicsWorld::FindSnapshot(unsigned step)
+{
+    for (unsigned i = 0; i < snapshots_.Size(); ++i)
+    {
+        if (snapshots_[i].valid_ && snapshots_[i].step_ == step)
+            return &snapshots_[i];
+    }
+
+    return 0;
+}
+
+void PhysicsWorld::ApplyDelayedWorldTransforms()
+{
+    PROFILE(ApplyPhysicsTransforms);
 
-    // Apply delayed (parented) world transforms now
     while (!delayedWorldTransforms_.Empty())
     {
         for (HashMap<RigidBody*, DelayedWorldTransform>::Iterator i = delayedWorldTransforms_.Begin();
-            i != delayedWorldTransforms_.End(); ++i)
+            i != delayedWorldTransforms_.End();)
         {
             const DelayedWorldTransform& transform = i->second_;
 
-            // If parent's transform has already been assigned, can proceed
-            if (!delayedWorldTransforms_.Contains(transform.parentRigidBody_))
+            // If not parented to a rigid body, or parent's transform has already been assigned, can proceed
+            if (!transform.parentRigidBody_ || !delayedWorldTransforms_.Contains(transform.parentRigidBody_))
             {
                 transform.rigidBody_->ApplyWorldTransform(transform.worldPosition_, transform.worldRotation_);
-                delayedWorldTransforms_.Erase(i);
+                i = delayedWorldTransforms_.Erase(i);
             }
+            else
+                ++i;
         }
     }
 }
@@ -327,6 +688,153 @@ void PhysicsWorld::SetSplitImpulse(bool enable)
     MarkNetworkUpdate();
 }
 
+void PhysicsWorld::SetParallelSimulation(bool enable)
+{
+    parallelSimulation_ = enable;
+    UpdateParallelSimulation();
+
+    MarkNetworkUpdate();
+}
+
+void PhysicsWorld::SetDeterministic(bool enable)
+{
+    deterministic_ = enable;
+    UpdateParallelSimulation();
+    if (enable)
+        world_->getSolverInfo().m_solverMode &= ~SOLVER_RANDMIZE_ORDER;
+
+    MarkNetworkUpdate();
+}
+
+void PhysicsWorld::SetNumSnapshots(unsigned num)
+{
+    numSnapshots_ = Max((int)num, 1);
+    snapshots_.Clear();
+    nextSnapshot_ = 0;
+}
+
+void PhysicsWorld::SaveSnapshot()
+{
+    PROFILE(SavePhysicsSnapshot);
+
+    if (snapshots_.Size() != numSnapshots_)
+        snapshots_.Resize(numSnapshots_);
+
+    // Saving twice on the same step replaces the earlier snapshot
+    PhysicsSnapshot* snapshot = FindSnapshot(simulationStep_);
+    if (!snapshot)
+    {
+        snapshot = &snapshots_[nextSnapshot_];
+        nextSnapshot_ = (nextSnapshot_ + 1) % numSnapshots_;
+    }
+
+    snapshot->step_ = simulationStep_;
+    snapshot->timeAcc_ = timeAcc_;
+    snapshot->bodies_.Clear();
+    snapshot->states_.Clear();
+    snapshot->previousCollisions_ = previousCollisions_;
+    snapshot->valid_ = true;
+
+    for (PODVector<RigidBody*>::ConstIterator i = rigidBodies_.Begin(); i != rigidBodies_.End(); ++i)
+    {
+        btRigidBody* body = (*i)->GetBody();
+        if (!body || !body->getBroadphaseHandle() || body->isStaticOrKinematicObject())
+            continue;
+
+        RigidBodyState state;
+        body->getWorldTransform().getOpenGLMatrix(state.worldTransform_);
+        body->getInterpolationWorldTransform().getOpenGLMatrix(state.interpolationWorldTransform_);
+        state.linearVelocity_ = ToVector3(body->getLinearVelocity());
+        state.angularVelocity_ = ToVector3(body->getAngularVelocity());
+        state.interpolationLinearVelocity_ = ToVector3(body->getInterpolationLinearVelocity());
+        state.interpolationAngularVelocity_ = ToVector3(body->getInterpolationAngularVelocity());
+        state.deactivationTime_ = body->getDeactivationTime();
+        state.hitFraction_ = body->getHitFraction();
+        state.activationState_ = body->getActivationState();
+
+        // Frozen bodies are saved as simulated ones, as the freezing is only an optimization
+        if ((*i)->IsFrozen())
+        {
+            state.linearVelocity_ = (*i)->GetLinearVelocity();
+            state.angularVelocity_ = (*i)->GetAngularVelocity();
+            state.interpolationLinearVelocity_ = state.linearVelocity_;
+            state.interpolationAngularVelocity_ = state.angularVelocity_;
+            state.activationState_ = ACTIVE_TAG;
+        }
+
+        snapshot->bodies_.Push(WeakPtr<RigidBody>(*i));
+        snapshot->states_.Push(state);
+    }
+
+    // The contact caches and the broadphase can not be restored, so reset them also now for the resimulation to match
+    if (deterministic_)
+        ResetCollisionState();
+}
+
+bool PhysicsWorld::RestoreSnapshot(unsigned step)
+{
+    PROFILE(RestorePhysicsSnapshot);
+
+    PhysicsSnapshot* snapshot = FindSnapshot(step);
+    if (!snapshot)
+    {
+        LOGERROR("No physics snapshot of simulation step " + String(step));
+        return false;
+    }
+
+    delayedWorldTransforms_.Clear();
+
+    for (unsigned i = 0; i < snapshot->bodies_.Size(); ++i)
+    {
+        RigidBody* rigidBody = snapshot->bodies_[i];
+        btRigidBody* body = rigidBody ? rigidBody->GetBody() : 0;
+        if (!body || !body->getBroadphaseHandle())
+            continue;
+
+        // The simulation LOD update freezes the body again if it is still out of range
+        rigidBody->SetFrozen(false);
+
+        const RigidBodyState& state = snapshot->states_[i];
+        btTransform transform;
+        transform.setFromOpenGLMatrix(state.worldTransform_);
+        body->setCenterOfMassTransform(transform);
+        transform.setFromOpenGLMatrix(state.interpolationWorldTransform_);
+        body->setInterpolationWorldTransform(transform);
+        body->setLinearVelocity(ToBtVector3(state.linearVelocity_));
+        body->setAngularVelocity(ToBtVector3(state.angularVelocity_));
+        body->setInterpolationLinearVelocity(ToBtVector3(state.interpolationLinearVelocity_));
+        body->setInterpolationAngularVelocity(ToBtVector3(state.interpolationAngularVelocity_));
+        body->forceActivationState(state.activationState_);
+        body->setDeactivationTime(state.deactivationTime_);
+        body->setHitFraction(state.hitFraction_);
+        body->clearForces();
+
+        // Move the scene node through the motion state
+        rigidBody->setWorldTransform(body->getWorldTransform());
+    }
+
+    ApplyDelayedWorldTransforms();
+    ResetCollisionState();
+
+    previousCollisions_ = snapshot->previousCollisions_;
+    timeAcc_ = snapshot->timeAcc_;
+    simulationStep_ = step;
+
+    // The later snapshots belong to the discarded simulation
+    for (unsigned i = 0; i < snapshots_.Size(); ++i)
+    {
+        if (snapshots_[i].valid_ && snapshots_[i].step_ > step)
+            snapshots_[i].valid_ = false;
+    }
+
+    return true;
+}
+
+void PhysicsWorld::SetSaveCookedGeometry(bool enable)
+{
+    saveCookedGeometry_ = enable;
+}
+
 void PhysicsWorld::SetMaxNetworkAngularVelocity(float velocity)
 {
     maxNetworkAngularVelocity_ = Clamp(velocity, 1.0f, 32767.0f);
@@ -334,6 +842,44 @@ void PhysicsWorld::SetMaxNetworkAngularVelocity(float velocity)
     MarkNetworkUpdate();
 }
 
+void PhysicsWorld::SetFreezeDistance(float distance)
+{
+    freezeDistance_ = Max(distance, 0.0f);
+
+    MarkNetworkUpdate();
+}
+
+void PhysicsWorld::AddObserver(Node* node)
+{
+    if (!node)
+        return;
+
+    for (Vector<WeakPtr<Node> >::ConstIterator i = observers_.Begin(); i != observers_.End(); ++i)
+    {
+        if (*i == node)
+            return;
+    }
+
+    observers_.Push(WeakPtr<Node>(node));
+}
+
+void PhysicsWorld::RemoveObserver(Node* node)
+{
+    for (Vector<WeakPtr<Node> >::Iterator i = observers_.Begin(); i != observers_.End(); ++i)
+    {
+        if (*i == node)
+        {
+            observers_.Erase(i);
+            return;
+        }
+    }
+}
+
+void PhysicsWorld::RemoveAllObservers()
+{
+    observers_.Clear();
+}
+
 void PhysicsWorld::Raycast(PODVector<PhysicsRaycastResult>& result, const Ray& ray, float maxDistance, unsigned collisionMask)
 {
     PROFILE(PhysicsRaycast);
@@ -493,6 +1039,27 @@ void PhysicsWorld::ConvexCast(PhysicsRaycastResult& result, btCollisionShape* sh
     }
 }
 
+void PhysicsWorld::RaycastSingleBatch(PODVector<PhysicsRaycastResult>& result, const PODVector<PhysicsRaycastQuery>& queries)
+{
+    PROFILE(PhysicsRaycastSingleBatch);
+
+    result.Resize(queries.Size());
+    if (queries.Empty())
+        return;
+
+    // The broadphase keeps a single traversal stack of its own, so the queries traverse it with one stack per thread instead
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned numThreads = queue ? queue->GetNumThreads() + 1 : 1;
+    if (queryStacks_.Size() < numThreads)
+        queryStacks_.Resize(numThreads);
+
+    RaycastBatchProcessor processor(static_cast<btDbvtBroadphase*>(broadphase_), &queries[0], &result[0], queryStacks_);
+    if (queue)
+        queue->ParallelFor(&result[0], &result[0] + result.Size(), RAYCAST_BATCH_GRAIN_SIZE, processor);
+    else
+        processor(&result[0], &result[0] + result.Size(), 0);
+}
+
 void PhysicsWorld::RemoveCachedGeometry(Model* model)
 {
     for (HashMap<Pair<Model*, unsigned>, SharedPtr<CollisionGeometryData> >::Iterator i = triMeshCache_.Begin();
@@ -679,6 +1246,8 @@ void PhysicsWorld::PreStep(float timeStep)
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPRESTEP, eventData);
+    if (scene_)
+        scene_->UpdateLogicComponents(USE_FIXEDUPDATE, timeStep);
 
     // Start profiling block for the actual simulation step
 #ifdef URHO3D_PROFILING
@@ -696,6 +1265,8 @@ void PhysicsWorld::PostStep(float timeStep)
         profiler->EndBlock();
 #endif
 
+    ++simulationStep_;
+
     SendCollisionEvents();
 
     // Send post-step event
@@ -705,6 +1276,8 @@ void PhysicsWorld::PostStep(float timeStep)
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
     SendEvent(E_PHYSICSPOSTSTEP, eventData);
+    if (scene_)
+        scene_->UpdateLogicComponents(USE_FIXEDPOSTUPDATE, timeStep);
 }
 
 void PhysicsWorld::SendCollisionEvents()
@@ -917,6 +1490,11 @@ void PhysicsWorld::SendCollisionEvents()
 
 void RegisterPhysicsLibrary(Context* context)
 {
+#ifdef URHO3D_MEMORY_TRACKING
+    // Account Bullet's own allocations, which do not go through operator new. Must be set before any Bullet object is created
+    btAlignedAllocSetCustom(MemoryTracker::Allocate, MemoryTracker::Free);
+#endif
+    
     CollisionShape::RegisterObject(context);
     RigidBody::RegisterObject(context);
     Constraint::RegisterObject(context);
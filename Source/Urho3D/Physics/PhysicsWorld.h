@@ -25,6 +25,7 @@
 #include "../Math/BoundingBox.h"
 #include "../Scene/Component.h"
 #include "../Container/HashSet.h"
+#include "../Math/Ray.h"
 #include "../Math/Sphere.h"
 #include "../Math/Vector3.h"
 #include "../IO/VectorBuffer.h"
@@ -40,6 +41,8 @@ class btDispatcher;
 class btDynamicsWorld;
 class btPersistentManifold;
 
+struct btDbvtNode;
+
 namespace Urho3D
 {
 
@@ -78,12 +81,42 @@ struct URHO3D_API PhysicsRaycastResult
     RigidBody* body_;
 };
 
-/// Delayed world transform assignment for parented rigidbodies.
+/// Physics raycast or sphere sweep query for batched execution.
+struct URHO3D_API PhysicsRaycastQuery
+{
+    /// Construct with defaults.
+    PhysicsRaycastQuery() :
+        maxDistance_(0.0f),
+        radius_(0.0f),
+        collisionMask_(M_MAX_UNSIGNED)
+    {
+    }
+
+    /// Construct with parameters.
+    PhysicsRaycastQuery(const Ray& ray, float maxDistance, unsigned collisionMask = M_MAX_UNSIGNED, float radius = 0.0f) :
+        ray_(ray),
+        maxDistance_(maxDistance),
+        radius_(radius),
+        collisionMask_(collisionMask)
+    {
+    }
+
+    /// Ray.
+    Ray ray_;
+    /// Maximum distance along the ray.
+    float maxDistance_;
+    /// Sphere radius for a sweep, or 0 for a raycast.
+    float radius_;
+    /// Collision mask.
+    unsigned collisionMask_;
+};
+
+/// Delayed world transform assignment for rigidbodies after the simulation step.
 struct DelayedWorldTransform
 {
     /// Rigid body.
     RigidBody* rigidBody_;
-    /// Parent rigid body.
+    /// Parent rigid body, or null if not parented to a rigid body.
     RigidBody* parentRigidBody_;
     /// New world position.
     Vector3 worldPosition_;
@@ -91,6 +124,54 @@ struct DelayedWorldTransform
     Quaternion worldRotation_;
 };
 
+/// Simulation state of a moving rigid body in a physics snapshot.
+struct RigidBodyState
+{
+    /// World transform as an OpenGL matrix, which preserves the exact values.
+    btScalar worldTransform_[16];
+    /// Interpolation world transform as an OpenGL matrix.
+    btScalar interpolationWorldTransform_[16];
+    /// Linear velocity.
+    Vector3 linearVelocity_;
+    /// Angular velocity.
+    Vector3 angularVelocity_;
+    /// Interpolation linear velocity.
+    Vector3 interpolationLinearVelocity_;
+    /// Interpolation angular velocity.
+    Vector3 interpolationAngularVelocity_;
+    /// Time spent below the deactivation threshold.
+    float deactivationTime_;
+    /// Continuous collision hit fraction.
+    float hitFraction_;
+    /// Activation state.
+    int activationState_;
+};
+
+/// Physics world state snapshot of a simulation step for rollback and resimulation.
+struct PhysicsSnapshot
+{
+    /// Construct as invalid.
+    PhysicsSnapshot() :
+        step_(0),
+        timeAcc_(0.0f),
+        valid_(false)
+    {
+    }
+
+    /// Simulation step number.
+    unsigned step_;
+    /// Fixed step time accumulator.
+    float timeAcc_;
+    /// Moving rigid bodies.
+    Vector<WeakPtr<RigidBody> > bodies_;
+    /// Rigid body states.
+    PODVector<RigidBodyState> states_;
+    /// Collision pairs of the step, used to decide which collisions are new on the next step.
+    HashMap<Pair<WeakPtr<RigidBody>, WeakPtr<RigidBody> >, btPersistentManifold* > previousCollisions_;
+    /// Valid flag.
+    bool valid_;
+};
+
 static const float DEFAULT_MAX_NETWORK_ANGULAR_VELOCITY = 100.0f;
 
 /// Physics simulation world component. Should be added only to the root scene node.
@@ -144,8 +225,28 @@ public:
     void SetInternalEdge(bool enable);
     /// Set split impulse collision mode. This is more accurate, but slower. Disabled by default.
     void SetSplitImpulse(bool enable);
+    /// Set whether to process the narrowphase and solve the simulation islands in parallel using the work queue. The results are not deterministic between runs. Disabled by default.
+    void SetParallelSimulation(bool enable);
+    /// Set deterministic mode. The fixed steps are then counted by PhysicsWorld instead of Bullet, parallel simulation is not used, and saving or restoring a snapshot resets the collision state, so that resimulating from a snapshot reproduces the original simulation. Disabled by default.
+    void SetDeterministic(bool enable);
+    /// Set number of snapshots kept in the ring buffer. Default 16.
+    void SetNumSnapshots(unsigned num);
+    /// Save the state of all moving rigid bodies to the snapshot ring buffer, replacing the oldest snapshot. The snapshot is identified by the current simulation step number.
+    void SaveSnapshot();
+    /// Restore the rigid body states saved on a simulation step and discard the later snapshots. Return true if the snapshot was found.
+    bool RestoreSnapshot(unsigned step);
+    /// Set whether to save cooked triangle mesh and convex hull geometry to a Cache subdirectory next to the model when it had to be built, so that later loads skip the build. Cooked geometry that exists is always used. Disabled by default.
+    void SetSaveCookedGeometry(bool enable);
     /// Set maximum angular velocity for network replication.
     void SetMaxNetworkAngularVelocity(float velocity);
+    /// Set distance from the nearest observer beyond which moving rigid bodies are frozen. Frozen bodies keep colliding as static obstacles but are not simulated. 0 (default) disables.
+    void SetFreezeDistance(float distance);
+    /// Add an observer node, such as the player or camera, that keeps the rigid bodies near it simulated.
+    void AddObserver(Node* node);
+    /// Remove an observer node.
+    void RemoveObserver(Node* node);
+    /// Remove all observer nodes.
+    void RemoveAllObservers();
     /// Perform a physics world raycast and return all hits.
     void Raycast(PODVector<PhysicsRaycastResult>& result, const Ray& ray, float maxDistance, unsigned collisionMask = M_MAX_UNSIGNED);
     /// Perform a physics world raycast and return the closest hit.
@@ -156,6 +257,8 @@ public:
     void ConvexCast(PhysicsRaycastResult& result, CollisionShape* shape, const Vector3& startPos, const Quaternion& startRot, const Vector3& endPos, const Quaternion& endRot, unsigned collisionMask = M_MAX_UNSIGNED);
     /// Perform a physics world swept convex test using a user-supplied Bullet collision shape and return the first hit.
     void ConvexCast(PhysicsRaycastResult& result, btCollisionShape* shape, const Vector3& startPos, const Quaternion& startRot, const Vector3& endPos, const Quaternion& endRot, unsigned collisionMask = M_MAX_UNSIGNED);
+    /// Perform a batch of raycasts and sphere sweeps in parallel using the work queue. Return the closest hit of each query, in the same order as the queries. Must be called from the main thread outside the simulation step.
+    void RaycastSingleBatch(PODVector<PhysicsRaycastResult>& result, const PODVector<PhysicsRaycastQuery>& queries);
     /// Invalidate cached collision geometry for a model.
     void RemoveCachedGeometry(Model* model);
     /// Return rigid bodies by a sphere query.
@@ -177,10 +280,28 @@ public:
     bool GetInternalEdge() const { return internalEdge_; }
     /// Return whether split impulse collision mode is enabled.
     bool GetSplitImpulse() const;
+    /// Return whether the simulation is processed in parallel.
+    bool GetParallelSimulation() const { return parallelSimulation_; }
+    /// Return whether deterministic mode is enabled.
+    bool GetDeterministic() const { return deterministic_; }
+    /// Return number of snapshots kept in the ring buffer.
+    unsigned GetNumSnapshots() const { return numSnapshots_; }
+    /// Return whether a snapshot of a simulation step exists.
+    bool HasSnapshot(unsigned step) const;
+    /// Return number of simulation steps taken.
+    unsigned GetSimulationStep() const { return simulationStep_; }
+    /// Return whether built collision geometry is saved as cooked data.
+    bool GetSaveCookedGeometry() const { return saveCookedGeometry_; }
     /// Return simulation steps per second.
     int GetFps() const { return fps_; }
     /// Return maximum angular velocity for network replication.
     float GetMaxNetworkAngularVelocity() const { return maxNetworkAngularVelocity_; }
+    /// Return distance from the nearest observer beyond which moving rigid bodies are frozen.
+    float GetFreezeDistance() const { return freezeDistance_; }
+    /// Return number of observer nodes.
+    unsigned GetNumObservers() const { return observers_.Size(); }
+    /// Return number of rigid bodies frozen on the last simulation LOD update.
+    unsigned GetNumFrozenBodies() const { return numFrozenBodies_; }
 
     /// Add a rigid body to keep track of. Called by RigidBody.
     void AddRigidBody(RigidBody* body);
@@ -231,6 +352,16 @@ private:
     void PostStep(float timeStep);
     /// Send accumulated collision events.
     void SendCollisionEvents();
+    /// Apply the world transforms synchronized from the simulation to the scene nodes, parents before children.
+    void ApplyDelayedWorldTransforms();
+    /// Update the work queue used by the collision dispatcher and the dynamics world.
+    void UpdateParallelSimulation();
+    /// Recreate the broadphase, removing all contact pairs and manifolds, and reset the solver, so that the next step only depends on the rigid body states.
+    void ResetCollisionState();
+    /// Return the snapshot of a simulation step, or null if not found.
+    PhysicsSnapshot* FindSnapshot(unsigned step);
+    /// Freeze the moving rigid bodies far from all observers and unfreeze the ones that came back into range.
+    void UpdateSimulationLod();
 
     /// Bullet collision configuration.
     btCollisionConfiguration* collisionConfiguration_;
@@ -254,7 +385,7 @@ private:
     HashMap<Pair<WeakPtr<RigidBody>, WeakPtr<RigidBody> >, btPersistentManifold* > currentCollisions_;
     /// Collision pairs on the previous frame. Used to check if a collision is "new." Manifolds are not guaranteed to exist anymore.
     HashMap<Pair<WeakPtr<RigidBody>, WeakPtr<RigidBody> >, btPersistentManifold* > previousCollisions_;
-    /// Delayed (parented) world transform assignments.
+    /// Delayed world transform assignments.
     HashMap<RigidBody*, DelayedWorldTransform> delayedWorldTransforms_;
     /// Cache for trimesh geometry data by model and LOD level.
     HashMap<Pair<Model*, unsigned>, SharedPtr<CollisionGeometryData> > triMeshCache_;
@@ -266,18 +397,40 @@ private:
     VariantMap nodeCollisionData_;
     /// Preallocated buffer for physics collision contact data.
     VectorBuffer contacts_;
+    /// Broadphase traversal stacks for batched queries, one per work queue thread.
+    Vector<PODVector<const btDbvtNode*> > queryStacks_;
+    /// Snapshot ring buffer.
+    Vector<PhysicsSnapshot> snapshots_;
+    /// Observer nodes for simulation LOD.
+    Vector<WeakPtr<Node> > observers_;
     /// Simulation substeps per second.
     unsigned fps_;
     /// Maximum number of simulation substeps per frame. 0 (default) unlimited, or negative values for adaptive timestep.
     int maxSubSteps_;
-    /// Time accumulator for non-interpolated mode.
+    /// Time accumulator for non-interpolated and deterministic modes.
     float timeAcc_;
+    /// Number of simulation steps taken.
+    unsigned simulationStep_;
+    /// Number of snapshots kept.
+    unsigned numSnapshots_;
+    /// Ring buffer index of the next snapshot to save.
+    unsigned nextSnapshot_;
     /// Maximum angular velocity for network replication.
     float maxNetworkAngularVelocity_;
+    /// Observer distance beyond which moving rigid bodies are frozen.
+    float freezeDistance_;
+    /// Number of frozen rigid bodies.
+    unsigned numFrozenBodies_;
     /// Interpolation flag.
     bool interpolation_;
     /// Use internal edge utility flag.
     bool internalEdge_;
+    /// Parallel simulation flag.
+    bool parallelSimulation_;
+    /// Deterministic mode flag.
+    bool deterministic_;
+    /// Save cooked geometry flag.
+    bool saveCookedGeometry_;
     /// Applying transforms flag.
     bool applyingTransforms_;
     /// Debug renderer.
@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
+#include "../Core/MemoryTracker.h"
 #include "../Physics/PhysicsUtils.h"
 #include "../Physics/PhysicsWorld.h"
 #include "../Core/Profiler.h"
@@ -48,6 +49,8 @@ static const float DEFAULT_RESTITUTION = 0.0f;
 static const float DEFAULT_ROLLING_FRICTION = 0.0f;
 static const unsigned DEFAULT_COLLISION_LAYER = 0x1;
 static const unsigned DEFAULT_COLLISION_MASK = M_MAX_UNSIGNED;
+static const float SYNC_POSITION_THRESHOLD = 0.0001f;
+static const float SYNC_ROTATION_THRESHOLD = 0.00001f;
 
 static const char* collisionEventModeNames[] =
 {
@@ -72,13 +75,16 @@ RigidBody::RigidBody(Context* context) :
     collisionEventMode_(COLLISION_ACTIVE),
     lastPosition_(Vector3::ZERO),
     lastRotation_(Quaternion::IDENTITY),
+    frozenLinearVelocity_(Vector3::ZERO),
+    frozenAngularVelocity_(Vector3::ZERO),
     kinematic_(false),
     trigger_(false),
     useGravity_(true),
     hasSmoothedTransform_(false),
     readdBody_(false),
     inWorld_(false),
-    enableMassUpdate_(true)
+    enableMassUpdate_(true),
+    frozen_(false)
 {
     compoundShape_ = new btCompoundShape();
     shiftedCompoundShape_ = new btCompoundShape();
@@ -170,33 +176,24 @@ void RigidBody::getWorldTransform(btTransform &worldTrans) const
 
 void RigidBody::setWorldTransform(const btTransform &worldTrans)
 {
-    Quaternion newWorldRotation = ToQuaternion(worldTrans.getRotation());
-    Vector3 newWorldPosition = ToVector3(worldTrans.getOrigin()) - newWorldRotation * centerOfMass_;
-    RigidBody* parentRigidBody = 0;
-
     // It is possible that the RigidBody component has been kept alive via a shared pointer,
     // while its scene node has already been destroyed
-    if (node_)
+    if (node_ && physicsWorld_)
     {
-        // If the rigid body is parented to another rigid body, can not set the transform immediately.
-        // In that case store it to PhysicsWorld for delayed assignment
+        // Bullet only synchronizes the active bodies. Store the transform to PhysicsWorld, which applies all of them
+        // after the simulation step. If the rigid body is parented to another rigid body, the parent's transform
+        // will be applied first
+        DelayedWorldTransform delayed;
+        delayed.rigidBody_ = this;
+        delayed.parentRigidBody_ = 0;
+        delayed.worldRotation_ = ToQuaternion(worldTrans.getRotation());
+        delayed.worldPosition_ = ToVector3(worldTrans.getOrigin()) - delayed.worldRotation_ * centerOfMass_;
+
         Node* parent = node_->GetParent();
         if (parent != GetScene() && parent)
-            parentRigidBody = parent->GetComponent<RigidBody>();
-
-        if (!parentRigidBody)
-            ApplyWorldTransform(newWorldPosition, newWorldRotation);
-        else
-        {
-            DelayedWorldTransform delayed;
-            delayed.rigidBody_ = this;
-            delayed.parentRigidBody_ = parentRigidBody;
-            delayed.worldPosition_ = newWorldPosition;
-            delayed.worldRotation_ = newWorldRotation;
-            physicsWorld_->AddDelayedWorldTransform(delayed);
-        }
+            delayed.parentRigidBody_ = parent->GetComponent<RigidBody>();
 
-        MarkNetworkUpdate();
+        physicsWorld_->AddDelayedWorldTransform(delayed);
     }
 }
 
@@ -287,7 +284,12 @@ void RigidBody::SetTransform(const Vector3& position, const Quaternion& rotation
 
 void RigidBody::SetLinearVelocity(const Vector3& velocity)
 {
-    if (body_)
+    if (frozen_)
+    {
+        frozenLinearVelocity_ = velocity;
+        MarkNetworkUpdate();
+    }
+    else if (body_)
     {
         body_->setLinearVelocity(ToBtVector3(velocity));
         if (velocity != Vector3::ZERO)
@@ -325,7 +327,12 @@ void RigidBody::SetLinearDamping(float damping)
 
 void RigidBody::SetAngularVelocity(const Vector3& velocity)
 {
-    if (body_)
+    if (frozen_)
+    {
+        frozenAngularVelocity_ = velocity;
+        MarkNetworkUpdate();
+    }
+    else if (body_)
     {
         body_->setAngularVelocity(ToBtVector3(velocity));
         if (velocity != Vector3::ZERO)
@@ -563,6 +570,34 @@ void RigidBody::ResetForces()
         body_->clearForces();
 }
 
+void RigidBody::SetFrozen(bool enable)
+{
+    if (enable == frozen_ || !body_)
+        return;
+
+    if (enable)
+    {
+        frozenLinearVelocity_ = ToVector3(body_->getLinearVelocity());
+        frozenAngularVelocity_ = ToVector3(body_->getAngularVelocity());
+        body_->setLinearVelocity(btVector3(0.0f, 0.0f, 0.0f));
+        body_->setAngularVelocity(btVector3(0.0f, 0.0f, 0.0f));
+        body_->setInterpolationLinearVelocity(btVector3(0.0f, 0.0f, 0.0f));
+        body_->setInterpolationAngularVelocity(btVector3(0.0f, 0.0f, 0.0f));
+        body_->forceActivationState(DISABLE_SIMULATION);
+        frozen_ = true;
+    }
+    else
+    {
+        frozen_ = false;
+        body_->forceActivationState(kinematic_ ? DISABLE_DEACTIVATION : ACTIVE_TAG);
+        body_->setDeactivationTime(0.0f);
+        // Contact solving may have written velocities to the frozen body, so restore the kept ones
+        body_->setLinearVelocity(ToBtVector3(frozenLinearVelocity_));
+        body_->setAngularVelocity(ToBtVector3(frozenAngularVelocity_));
+        body_->clearForces();
+    }
+}
+
 void RigidBody::Activate()
 {
     if (body_ && mass_ > 0.0f)
@@ -607,6 +642,8 @@ Quaternion RigidBody::GetRotation() const
 
 Vector3 RigidBody::GetLinearVelocity() const
 {
+    if (frozen_)
+        return frozenLinearVelocity_;
     return body_ ? ToVector3(body_->getLinearVelocity()) : Vector3::ZERO;
 }
 
@@ -632,6 +669,8 @@ float RigidBody::GetLinearDamping() const
 
 Vector3 RigidBody::GetAngularVelocity() const
 {
+    if (frozen_)
+        return frozenAngularVelocity_;
     return body_ ? ToVector3(body_->getAngularVelocity()) : Vector3::ZERO;
 }
 
@@ -705,6 +744,12 @@ void RigidBody::ApplyWorldTransform(const Vector3& newWorldPosition, const Quate
     if (!node_ || !physicsWorld_)
         return;
 
+    // If the body has practically not moved since the last applied transform, skip dirtying the node hierarchy
+    Quaternion rotationDelta = newWorldRotation - lastRotation_;
+    if ((newWorldPosition - lastPosition_).LengthSquared() < SYNC_POSITION_THRESHOLD * SYNC_POSITION_THRESHOLD &&
+        rotationDelta.DotProduct(rotationDelta) < SYNC_ROTATION_THRESHOLD * SYNC_ROTATION_THRESHOLD)
+        return;
+
     physicsWorld_->SetApplyingTransforms(true);
 
     // Apply transform to the SmoothedTransform component instead of node transform if available
@@ -721,13 +766,13 @@ void RigidBody::ApplyWorldTransform(const Vector3& newWorldPosition, const Quate
     }
     else
     {
-        node_->SetWorldPosition(newWorldPosition);
-        node_->SetWorldRotation(newWorldRotation);
+        node_->SetWorldTransform(newWorldPosition, newWorldRotation);
         lastPosition_ = node_->GetWorldPosition();
         lastRotation_ = node_->GetWorldRotation();
     }
 
     physicsWorld_->SetApplyingTransforms(false);
+    MarkNetworkUpdate();
 }
 
 void RigidBody::UpdateMass()
@@ -930,6 +975,8 @@ void RigidBody::OnNodeSet(Node* node)
 
 void RigidBody::AddBodyToWorld()
 {
+    MEMORY_TAG(MEMTAG_PHYSICS);
+
     if (!physicsWorld_)
         return;
 
@@ -985,7 +1032,7 @@ void RigidBody::AddBodyToWorld()
     else
         flags &= ~btCollisionObject::CF_KINEMATIC_OBJECT;
     body_->setCollisionFlags(flags);
-    body_->forceActivationState(kinematic_ ? DISABLE_DEACTIVATION : ISLAND_SLEEPING);
+    body_->forceActivationState(frozen_ ? DISABLE_SIMULATION : (kinematic_ ? DISABLE_DEACTIVATION : ISLAND_SLEEPING));
 
     if (!IsEnabledEffective())
         return;
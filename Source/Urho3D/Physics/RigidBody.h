@@ -126,6 +126,8 @@ public:
     void SetCollisionLayerAndMask(unsigned layer, unsigned mask);
     /// Set collision event signaling mode. Default is to signal when rigid bodies are active.
     void SetCollisionEventMode(CollisionEventMode mode);
+    /// Set frozen state. A frozen rigid body stays in the world as a collision object, but is not simulated until unfrozen, and its velocities are kept aside. Called by the physics world's simulation LOD.
+    void SetFrozen(bool enable);
     /// Apply force to center of mass.
     void ApplyForce(const Vector3& force);
     /// Apply force at local position.
@@ -205,6 +207,8 @@ public:
     bool IsTrigger() const { return trigger_; }
     /// Return whether rigid body is active (not sleeping.)
     bool IsActive() const;
+    /// Return whether rigid body is frozen by the simulation LOD.
+    bool IsFrozen() const { return frozen_; }
     /// Return collision layer.
     unsigned GetCollisionLayer() const { return collisionLayer_; }
     /// Return collision mask.
@@ -214,7 +218,7 @@ public:
     /// Return colliding rigid bodies from the last simulation step.
     void GetCollidingBodies(PODVector<RigidBody*>& result) const;
 
-    /// Apply new world transform after a simulation step. Called internally.
+    /// Apply new world transform after a simulation step, unless it is practically unchanged from the last applied. Called internally.
     void ApplyWorldTransform(const Vector3& newWorldPosition, const Quaternion& newWorldRotation);
     /// Update mass and inertia to the Bullet rigid body.
     void UpdateMass();
@@ -275,6 +279,10 @@ private:
     mutable Vector3 lastPosition_;
     /// Last interpolated rotation from the simulation.
     mutable Quaternion lastRotation_;
+    /// Linear velocity kept while frozen.
+    Vector3 frozenLinearVelocity_;
+    /// Angular velocity kept while frozen.
+    Vector3 frozenAngularVelocity_;
     /// Kinematic flag.
     bool kinematic_;
     /// Trigger flag.
@@ -289,6 +297,8 @@ private:
     bool inWorld_;
     /// Mass update enable flag.
     bool enableMassUpdate_;
+    /// Frozen by simulation LOD flag.
+    bool frozen_;
 };
 
 }
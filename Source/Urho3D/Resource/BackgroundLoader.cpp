@@ -33,74 +33,150 @@
 namespace Urho3D
 {
 
+/// Background loader thread.
+class BackgroundLoaderThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoaderThread(BackgroundLoader* owner) :
+        owner_(owner)
+    {
+    }
+    
+    /// Load queued resources until stopped.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            if (!owner_->LoadNextResource())
+                Time::Sleep(5);
+        }
+    }
+    
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+};
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(1)
+{
+}
+
+BackgroundLoader::~BackgroundLoader()
+{
+    StopThreads();
+}
+
+void BackgroundLoader::SetNumThreads(unsigned num)
 {
+    num = Max((int)num, 1);
+    if (num == numThreads_)
+        return;
+    
+    numThreads_ = num;
+    
+    // Restart with the new thread count if loading is in progress. Resources being loaded keep their state, so they are
+    // finished normally
+    if (!threads_.Empty())
+    {
+        StopThreads();
+        StartThreads();
+    }
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::StartThreads()
 {
-    while (shouldRun_)
+    if (!threads_.Empty())
+        return;
+    
+    for (unsigned i = 0; i < numThreads_; ++i)
     {
-        backgroundLoadMutex_.Acquire();
+        SharedPtr<BackgroundLoaderThread> thread(new BackgroundLoaderThread(this));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    // Stop() waits for the current resource of each thread to finish BeginLoad()
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Stop();
+    threads_.Clear();
+}
+
+bool BackgroundLoader::LoadNextResource()
+{
+    backgroundLoadMutex_.Acquire();
+    
+    // Search for the highest priority queued resource that has not been loaded yet. Queue order is kept for equal priority
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.End();
+    for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Begin();
+        j != backgroundLoadQueue_.End(); ++j)
+    {
+        if (j->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED && (i == backgroundLoadQueue_.End() ||
+            j->second_.priority_ > i->second_.priority_))
+            i = j;
+    }
+    
+    if (i == backgroundLoadQueue_.End())
+    {
+        // No resources to load found
+        backgroundLoadMutex_.Release();
+        return false;
+    }
+    
+    BackgroundLoadItem& item = i->second_;
+    Resource* resource = item.resource_;
+    // Claim the resource while still holding the mutex so that other loader threads do not pick it. We can be sure that
+    // the item is not removed from the queue as long as it is in the "loading" state
+    resource->SetAsyncLoadState(ASYNC_LOADING);
+    backgroundLoadMutex_.Release();
+    
+    bool success = false;
+    SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+    if (file)
+    {
+#ifdef URHO3D_PROFILING
+        // Only visible in the profiler timeline, as the loader threads are not the main thread
+        String profileBlockName("BeginLoad" + resource->GetTypeName());
         
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
+        Profiler* profiler = owner_->GetSubsystem<Profiler>();
+        if (profiler)
+            profiler->BeginBlock(profileBlockName.CString());
+#endif
+        success = resource->BeginLoad(*file);
+#ifdef URHO3D_PROFILING
+        if (profiler)
+            profiler->EndBlock();
+#endif
+    }
+    
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End(); ++i)
         {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
         
-        if (i == backgroundLoadQueue_.End())
-        {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
-        }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-            
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
-            
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End();
-                    ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j =
-                        backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
-                
-                item.dependents_.Clear();
-            }
-            
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
-        }
+        item.dependents_.Clear();
     }
+    
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    backgroundLoadMutex_.Release();
+    return true;
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller,
+    int priority)
 {
     StringHash nameHash(name);
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
@@ -113,6 +189,7 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
     
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = priority;
     
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -148,18 +225,53 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
             BackgroundLoadItem& callerItem = j->second_;
             item.dependents_.Insert(callerKey);
             callerItem.dependencies_.Insert(key);
+            // The caller can not finish before its dependencies, so load them at least with the caller's priority
+            if (callerItem.priority_ > item.priority_)
+                item.priority_ = callerItem.priority_;
         }
         else
             LOGWARNING("Resource " + caller->GetName() + " requested for a background loaded resource but was not in the background load queue");
     }
     
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    // Start the background loader threads now
+    StartThreads();
     
     return true;
 }
 
+bool BackgroundLoader::CancelResource(StringHash type, StringHash nameHash)
+{
+    Pair<StringHash, StringHash> key = MakePair(type, nameHash);
+    
+    MutexLock lock(backgroundLoadMutex_);
+    
+    // Only resources that no loader thread has picked up yet can be cancelled
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+    if (i == backgroundLoadQueue_.End() || i->second_.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+        return false;
+    
+    BackgroundLoadItem& item = i->second_;
+    // Release resources waiting on this one, and unlink resources this one was waiting on
+    for (HashSet<Pair<StringHash, StringHash> >::Iterator j = item.dependents_.Begin(); j != item.dependents_.End(); ++j)
+    {
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator k = backgroundLoadQueue_.Find(*j);
+        if (k != backgroundLoadQueue_.End())
+            k->second_.dependencies_.Erase(key);
+    }
+    for (HashSet<Pair<StringHash, StringHash> >::Iterator j = item.dependencies_.Begin(); j != item.dependencies_.End(); ++j)
+    {
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator k = backgroundLoadQueue_.Find(*j);
+        if (k != backgroundLoadQueue_.End())
+            k->second_.dependents_.Erase(key);
+    }
+    
+    LOGDEBUG("Cancelled background loading of resource " + item.resource_->GetName());
+    
+    item.resource_->SetAsyncLoadState(ASYNC_DONE);
+    backgroundLoadQueue_.Erase(i);
+    return true;
+}
+
 void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 {
     backgroundLoadMutex_.Acquire();
@@ -169,6 +281,15 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
+        // Load the waited resource and its direct dependencies before anything else still in the queue
+        i->second_.priority_ = M_MAX_INT;
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator j = i->second_.dependencies_.Begin();
+            j != i->second_.dependencies_.End(); ++j)
+        {
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator k = backgroundLoadQueue_.Find(*j);
+            if (k != backgroundLoadQueue_.End())
+                k->second_.priority_ = M_MAX_INT;
+        }
         backgroundLoadMutex_.Release();
         
         {
@@ -193,8 +314,9 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
                 LOGDEBUG("Waited " + String(waitTimer.GetUSec(false) / 1000) + " ms for background loaded resource " + resource->GetName());
         }
         
-        // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
-        FinishBackgroundLoading(i->second_);
+        // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this.
+        // Any remaining incremental finishing steps are run at once as the resource is needed now
+        FinishBackgroundLoading(i->second_, false);
         
         backgroundLoadMutex_.Acquire();
         backgroundLoadQueue_.Erase(i);
@@ -206,32 +328,49 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    if (!threads_.Empty())
     {
         HiresTimer timer;
+        bool timeOut = false;
 
         backgroundLoadMutex_.Acquire();
         
-        for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-            i != backgroundLoadQueue_.End();)
+        // Resources finishing in several steps stay in the queue, so keep making passes over it while there is time left
+        while (!timeOut)
         {
-            Resource* resource = i->second_.resource_;
-            unsigned numDeps = i->second_.dependencies_.Size();
-            AsyncLoadState state = resource->GetAsyncLoadState();
-            if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
-                ++i;
-            else
+            bool stepped = false;
+            
+            for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
+                i != backgroundLoadQueue_.End();)
             {
-                // Finishing a resource may need it to wait for other resources to load, in which case we can not
-                // hold on to the mutex
-                backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second_);
-                backgroundLoadMutex_.Acquire();
-                i = backgroundLoadQueue_.Erase(i);
+                Resource* resource = i->second_.resource_;
+                unsigned numDeps = i->second_.dependencies_.Size();
+                AsyncLoadState state = resource->GetAsyncLoadState();
+                if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
+                    ++i;
+                else
+                {
+                    // Finishing a resource may need it to wait for other resources to load, in which case we can not
+                    // hold on to the mutex
+                    backgroundLoadMutex_.Release();
+                    bool finished = FinishBackgroundLoading(i->second_, true);
+                    backgroundLoadMutex_.Acquire();
+                    if (finished)
+                        i = backgroundLoadQueue_.Erase(i);
+                    else
+                        ++i;
+                    stepped = true;
+                }
+                
+                // Break when the time limit passed so that we keep sufficient FPS
+                if (timer.GetUSec(false) >= maxMs * 1000)
+                {
+                    timeOut = true;
+                    break;
+                }
             }
             
-            // Break when the time limit passed so that we keep sufficient FPS
-            if (timer.GetUSec(false) >= maxMs * 1000)
+            if (!stepped)
                 break;
         }
         
@@ -245,7 +384,7 @@ unsigned BackgroundLoader::GetNumQueuedResources() const
     return backgroundLoadQueue_.Size();
 }
 
-void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
+bool BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item, bool incremental)
 {
     Resource* resource = item.resource_;
     
@@ -253,6 +392,8 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     // If BeginLoad() phase was successful, call EndLoad() and get the final success/failure result
     if (success)
     {
+        bool finished = true;
+        
 #ifdef URHO3D_PROFILING
         String profileBlockName("Finish" + resource->GetTypeName());
         
@@ -260,13 +401,21 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
         if (profiler)
             profiler->BeginBlock(profileBlockName.CString());
 #endif
-        LOGDEBUG("Finishing background loaded resource " + resource->GetName());
-        success = resource->EndLoad();
+        if (incremental)
+            success = resource->EndLoadStep(finished);
+        else
+            success = resource->EndLoad();
         
 #ifdef URHO3D_PROFILING
         if (profiler)
             profiler->EndBlock();
 #endif
+        
+        // Wait for the next step if more remain
+        if (success && !finished)
+            return false;
+        
+        LOGDEBUG("Finished background loaded resource " + resource->GetName());
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
     
@@ -293,6 +442,8 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     // Store to the cache; use same mechanism as for manual resources
     if (success || owner_->GetReturnFailedResources())
         owner_->AddManualResource(resource);
+    
+    return true;
 }
 
 }
@@ -33,6 +33,7 @@
 namespace Urho3D
 {
 
+class BackgroundLoaderThread;
 class Resource;
 class ResourceCache;
 
@@ -45,36 +46,55 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     HashSet<Pair<StringHash, StringHash> > dependents_;
+    /// Load priority. Queued resources with higher priority are loaded first.
+    int priority_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+/// Background loader of resources using a pool of loader threads. Owned by the ResourceCache.
+class BackgroundLoader : public RefCounted
 {
+    friend class BackgroundLoaderThread;
+    
 public:
     /// Construct.
     BackgroundLoader(ResourceCache* owner);
+    /// Destruct. Stop the loader threads.
+    ~BackgroundLoader();
     
-    /// Resource background loading loop.
-    virtual void ThreadFunction();
-    
+    /// Set number of loader threads. Running threads finish their current resource and are restarted on the next queued resource. Default 1.
+    void SetNumThreads(unsigned num);
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
+    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, int priority = 0);
+    /// Cancel loading of a resource that is still waiting in the queue. Return true if cancelled, false if not queued or already loading.
+    bool CancelResource(StringHash type, StringHash nameHash);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
-    /// Process resources that are ready to finish.
+    /// Process resources that are ready to finish. Resources that finish incrementally are stepped until the time budget is used.
     void FinishResources(int maxMs);
     
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
     
 private:
-    /// Finish one background loaded resource.
-    void FinishBackgroundLoading(BackgroundLoadItem& item);
+    /// Start the loader threads if not running yet.
+    void StartThreads();
+    /// Stop and destroy the loader threads.
+    void StopThreads();
+    /// Run BeginLoad() on the highest priority queued resource. Called from the loader threads. Return false if there was nothing to load.
+    bool LoadNextResource();
+    /// Perform one finishing step of a background loaded resource, or finish it completely. Return true when finished.
+    bool FinishBackgroundLoading(BackgroundLoadItem& item, bool incremental);
     
     /// Resource cache.
     ResourceCache* owner_;
+    /// Loader threads.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Number of loader threads to start.
+    unsigned numThreads_;
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
@@ -1065,4 +1065,232 @@ void FlipBlockHorizontal(unsigned char* dest, unsigned char* src, CompressedForm
     }
 }
 
+// DXT compression by fitting the endpoints to the principal axis of the block colors
+
+static unsigned short Pack565(const float* color)
+{
+    int r = Clamp((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = Clamp((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = Clamp((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void Expand565(unsigned short value, int* color)
+{
+    int r = (value >> 11) & 0x1f;
+    int g = (value >> 5) & 0x3f;
+    int b = value & 0x1f;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void CompressColorDXT(unsigned char* block, const unsigned char* rgba)
+{
+    // Find the principal axis of the block colors from their covariance by power iteration
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        for (unsigned j = 0; j < 3; ++j)
+            mean[j] += rgba[i * 4 + j];
+    }
+    for (unsigned j = 0; j < 3; ++j)
+        mean[j] *= 1.0f / 16.0f;
+
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        float r = rgba[i * 4] - mean[0];
+        float g = rgba[i * 4 + 1] - mean[1];
+        float b = rgba[i * 4 + 2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float maxComponent = Max(Abs(x), Max(Abs(y), Abs(z)));
+        if (maxComponent < M_EPSILON)
+            break;
+        axis[0] = x / maxComponent;
+        axis[1] = y / maxComponent;
+        axis[2] = z / maxComponent;
+    }
+
+    // Use the colors with the extreme projections on the axis as the endpoints
+    unsigned minIndex = 0;
+    unsigned maxIndex = 0;
+    float minProjection = M_INFINITY;
+    float maxProjection = -M_INFINITY;
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        float projection = rgba[i * 4] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2];
+        if (projection < minProjection)
+        {
+            minProjection = projection;
+            minIndex = i;
+        }
+        if (projection > maxProjection)
+        {
+            maxProjection = projection;
+            maxIndex = i;
+        }
+    }
+
+    float maxColor[3];
+    float minColor[3];
+    for (unsigned j = 0; j < 3; ++j)
+    {
+        maxColor[j] = rgba[maxIndex * 4 + j];
+        minColor[j] = rgba[minIndex * 4 + j];
+    }
+
+    // Keep the first endpoint greater so that the four-color mode is used also in DXT1
+    unsigned short color0 = Pack565(maxColor);
+    unsigned short color1 = Pack565(minColor);
+    if (color0 < color1)
+        Swap(color0, color1);
+
+    block[0] = (unsigned char)(color0 & 0xff);
+    block[1] = (unsigned char)(color0 >> 8);
+    block[2] = (unsigned char)(color1 & 0xff);
+    block[3] = (unsigned char)(color1 >> 8);
+
+    if (color0 == color1)
+    {
+        block[4] = block[5] = block[6] = block[7] = 0;
+        return;
+    }
+
+    int palette[4][3];
+    Expand565(color0, palette[0]);
+    Expand565(color1, palette[1]);
+    for (unsigned j = 0; j < 3; ++j)
+    {
+        palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+        palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+    }
+
+    for (unsigned y = 0; y < 4; ++y)
+    {
+        unsigned char indices = 0;
+        for (unsigned x = 0; x < 4; ++x)
+        {
+            const unsigned char* pixel = rgba + (y * 4 + x) * 4;
+            unsigned bestIndex = 0;
+            int bestError = M_MAX_INT;
+            for (unsigned k = 0; k < 4; ++k)
+            {
+                int dr = pixel[0] - palette[k][0];
+                int dg = pixel[1] - palette[k][1];
+                int db = pixel[2] - palette[k][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = k;
+                }
+            }
+            indices |= (unsigned char)(bestIndex << (x * 2));
+        }
+        block[4 + y] = indices;
+    }
+}
+
+static void CompressAlphaDXT5(unsigned char* block, const unsigned char* rgba)
+{
+    int maxAlpha = 0;
+    int minAlpha = 255;
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        maxAlpha = Max(maxAlpha, (int)rgba[i * 4 + 3]);
+        minAlpha = Min(minAlpha, (int)rgba[i * 4 + 3]);
+    }
+
+    block[0] = (unsigned char)maxAlpha;
+    block[1] = (unsigned char)minAlpha;
+    for (unsigned i = 2; i < 8; ++i)
+        block[i] = 0;
+    if (maxAlpha == minAlpha)
+        return;
+
+    // The first value is greater, so the decoder uses the eight-value codebook
+    int codes[8];
+    codes[0] = maxAlpha;
+    codes[1] = minAlpha;
+    for (int i = 1; i < 7; ++i)
+        codes[1 + i] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+
+    for (unsigned half = 0; half < 2; ++half)
+    {
+        unsigned value = 0;
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            int alpha = rgba[(half * 8 + i) * 4 + 3];
+            unsigned bestIndex = 0;
+            int bestError = M_MAX_INT;
+            for (unsigned k = 0; k < 8; ++k)
+            {
+                int error = Abs(alpha - codes[k]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = k;
+                }
+            }
+            value |= bestIndex << (i * 3);
+        }
+        block[2 + half * 3] = (unsigned char)(value & 0xff);
+        block[3 + half * 3] = (unsigned char)((value >> 8) & 0xff);
+        block[4 + half * 3] = (unsigned char)((value >> 16) & 0xff);
+    }
+}
+
+void CompressImageDXT(unsigned char* dest, const unsigned char* rgba, int width, int height, CompressedFormat format)
+{
+    if (format != CF_DXT1 && format != CF_DXT5)
+        return;
+
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            // Gather the block, replicating edge pixels when the image size is not a multiple of 4
+            unsigned char blockRgba[16 * 4];
+            for (int py = 0; py < 4; ++py)
+            {
+                for (int px = 0; px < 4; ++px)
+                {
+                    int sx = Min(x + px, width - 1);
+                    int sy = Min(y + py, height - 1);
+                    const unsigned char* src = rgba + (sy * width + sx) * 4;
+                    unsigned char* blockPixel = blockRgba + (py * 4 + px) * 4;
+                    for (unsigned i = 0; i < 4; ++i)
+                        blockPixel[i] = src[i];
+                }
+            }
+
+            if (format == CF_DXT5)
+            {
+                CompressAlphaDXT5(dest, blockRgba);
+                CompressColorDXT(dest + 8, blockRgba);
+                dest += 16;
+            }
+            else
+            {
+                CompressColorDXT(dest, blockRgba);
+                dest += 8;
+            }
+        }
+    }
+}
+
 }
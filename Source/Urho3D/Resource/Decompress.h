@@ -33,6 +33,8 @@ URHO3D_API void DecompressImageDXT(unsigned char* dest, const void* blocks, int
 URHO3D_API void DecompressImageETC(unsigned char* dest, const void* blocks, int width, int height);
 /// Decompress a PVRTC compressed image to RGBA.
 URHO3D_API void DecompressImagePVRTC(unsigned char* dest, const void* blocks, int width, int height, CompressedFormat format);
+/// Compress an RGBA image to DXT1 or DXT5. The destination must hold 8 (DXT1) or 16 (DXT5) bytes per each started 4x4 block.
+URHO3D_API void CompressImageDXT(unsigned char* dest, const unsigned char* rgba, int width, int height, CompressedFormat format);
 /// Flip a compressed block vertically.
 URHO3D_API void FlipBlockVertical(unsigned char* dest, unsigned char* src, CompressedFormat format);
 /// Flip a compressed block horizontally.
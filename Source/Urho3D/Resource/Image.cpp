@@ -48,6 +48,17 @@ extern "C" unsigned char *stbi_write_png_to_mem(unsigned char *pixels, int strid
 #define FOURCC_DXT4 (MAKEFOURCC('D','X','T','4'))
 #define FOURCC_DXT5 (MAKEFOURCC('D','X','T','5'))
 
+#define DDSD_CAPS 0x00000001
+#define DDSD_HEIGHT 0x00000002
+#define DDSD_WIDTH 0x00000004
+#define DDSD_PIXELFORMAT 0x00001000
+#define DDSD_MIPMAPCOUNT 0x00020000
+#define DDSD_LINEARSIZE 0x00080000
+#define DDPF_FOURCC 0x00000004
+#define DDSCAPS_COMPLEX 0x00000008
+#define DDSCAPS_TEXTURE 0x00001000
+#define DDSCAPS_MIPMAP 0x00400000
+
 namespace Urho3D
 {
 
@@ -1048,6 +1059,65 @@ bool Image::SaveJPG(const String & fileName, int quality) const
         return false;
 }
 
+bool Image::SaveDDS(const String& fileName, unsigned sourceHash) const
+{
+    PROFILE(SaveImageDDS);
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem && !fileSystem->CheckAccess(GetPath(fileName)))
+    {
+        LOGERROR("Access denied to " + fileName);
+        return false;
+    }
+
+    unsigned fourCC;
+    switch (compressedFormat_)
+    {
+    case CF_DXT1:
+        fourCC = FOURCC_DXT1;
+        break;
+
+    case CF_DXT3:
+        fourCC = FOURCC_DXT3;
+        break;
+
+    case CF_DXT5:
+        fourCC = FOURCC_DXT5;
+        break;
+
+    default:
+        LOGERROR("Can only save DXT compressed image to DDS");
+        return false;
+    }
+
+    if (!data_ || depth_ > 1)
+        return false;
+
+    DDSurfaceDesc2 ddsd;
+    memset(&ddsd, 0, sizeof ddsd);
+    ddsd.dwSize_ = sizeof ddsd;
+    ddsd.dwFlags_ = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    ddsd.dwWidth_ = width_;
+    ddsd.dwHeight_ = height_;
+    ddsd.dwLinearSize_ = GetCompressedLevel(0).dataSize_;
+    ddsd.dwMipMapCount_ = numCompressedLevels_;
+    ddsd.dwReserved_ = sourceHash;
+    ddsd.ddpfPixelFormat_.dwSize_ = sizeof ddsd.ddpfPixelFormat_;
+    ddsd.ddpfPixelFormat_.dwFlags_ = DDPF_FOURCC;
+    ddsd.ddpfPixelFormat_.dwFourCC_ = fourCC;
+    ddsd.ddsCaps_.dwCaps_ = DDSCAPS_TEXTURE;
+    if (numCompressedLevels_ > 1)
+        ddsd.ddsCaps_.dwCaps_ |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+    File outFile(context_, fileName, FILE_WRITE);
+    if (!outFile.IsOpen())
+        return false;
+
+    outFile.WriteFileID("DDS ");
+    outFile.Write(&ddsd, sizeof ddsd);
+    return outFile.Write(data_.Get(), GetMemoryUse()) == GetMemoryUse();
+}
+
 Color Image::GetPixel(int x, int y) const
 {
     return GetPixel(x, y, 0);
@@ -1301,8 +1371,34 @@ SharedPtr<Image> Image::GetNextLevel() const
                 const unsigned char* inUpper = &pixelDataIn[(y*2)*width_*4];
                 const unsigned char* inLower = &pixelDataIn[(y*2+1)*width_*4];
                 unsigned char* out = &pixelDataOut[y*widthOut*4];
+                int x = 0;
+
+#ifdef URHO3D_SIMD_SSE2
+                // Filter 4 output pixels at a time with 16-bit sums, which gives the same result as the scalar loop
+                __m128i zero = _mm_setzero_si128();
+                for (; x + 16 <= widthOut*4; x += 16)
+                {
+                    __m128i upper0 = _mm_loadu_si128((const __m128i*)&inUpper[x*2]);
+                    __m128i upper1 = _mm_loadu_si128((const __m128i*)&inUpper[x*2+16]);
+                    __m128i lower0 = _mm_loadu_si128((const __m128i*)&inLower[x*2]);
+                    __m128i lower1 = _mm_loadu_si128((const __m128i*)&inLower[x*2+16]);
+                    // Sum the rows, two input pixels per register
+                    __m128i sum0 = _mm_add_epi16(_mm_unpacklo_epi8(upper0, zero), _mm_unpacklo_epi8(lower0, zero));
+                    __m128i sum1 = _mm_add_epi16(_mm_unpackhi_epi8(upper0, zero), _mm_unpackhi_epi8(lower0, zero));
+                    __m128i sum2 = _mm_add_epi16(_mm_unpacklo_epi8(upper1, zero), _mm_unpacklo_epi8(lower1, zero));
+                    __m128i sum3 = _mm_add_epi16(_mm_unpackhi_epi8(upper1, zero), _mm_unpackhi_epi8(lower1, zero));
+                    // Add the horizontally adjacent pixels into the low half of each register
+                    sum0 = _mm_add_epi16(sum0, _mm_srli_si128(sum0, 8));
+                    sum1 = _mm_add_epi16(sum1, _mm_srli_si128(sum1, 8));
+                    sum2 = _mm_add_epi16(sum2, _mm_srli_si128(sum2, 8));
+                    sum3 = _mm_add_epi16(sum3, _mm_srli_si128(sum3, 8));
+                    __m128i out01 = _mm_srli_epi16(_mm_unpacklo_epi64(sum0, sum1), 2);
+                    __m128i out23 = _mm_srli_epi16(_mm_unpacklo_epi64(sum2, sum3), 2);
+                    _mm_storeu_si128((__m128i*)&out[x], _mm_packus_epi16(out01, out23));
+                }
+#endif
 
-                for (int x = 0; x < widthOut*4; x += 4)
+                for (; x < widthOut*4; x += 4)
                 {
                     out[x] = ((unsigned)inUpper[x*2] + inUpper[x*2+4] + inLower[x*2] + inLower[x*2+4]) >> 2;
                     out[x+1] = ((unsigned)inUpper[x*2+1] + inUpper[x*2+5] + inLower[x*2+1] + inLower[x*2+5]) >> 2;
@@ -1491,6 +1587,97 @@ SharedPtr<Image> Image::ConvertToRGBA() const
     return ret;
 }
 
+SharedPtr<Image> Image::ConvertToDXT(CompressedFormat format, bool mipmaps) const
+{
+    if (IsCompressed())
+    {
+        LOGERROR("Can not convert compressed image to DXT");
+        return SharedPtr<Image>();
+    }
+    if (components_ < 1 || components_ > 4)
+    {
+        LOGERROR("Illegal number of image components for conversion to DXT");
+        return SharedPtr<Image>();
+    }
+    if (!data_ || depth_ > 1)
+    {
+        LOGERROR("Can only convert 2D image with data to DXT");
+        return SharedPtr<Image>();
+    }
+
+    PROFILE(ConvertImageToDXT);
+
+    // Choose DXT5 only if there is alpha to preserve
+    if (format == CF_NONE)
+    {
+        format = CF_DXT1;
+        if (components_ == 2 || components_ == 4)
+        {
+            const unsigned char* alpha = data_.Get() + components_ - 1;
+            for (int i = 0; i < width_ * height_; ++i, alpha += components_)
+            {
+                if (*alpha < 255)
+                {
+                    format = CF_DXT5;
+                    break;
+                }
+            }
+        }
+    }
+    if (format != CF_DXT1 && format != CF_DXT5)
+    {
+        LOGERROR("Unsupported compressed format for conversion to DXT");
+        return SharedPtr<Image>();
+    }
+
+    unsigned blockSize = format == CF_DXT1 ? 8 : 16;
+    unsigned numLevels = 1;
+    unsigned dataSize = 0;
+    for (int width = width_, height = height_;; width = Max(width / 2, 1), height = Max(height / 2, 1))
+    {
+        dataSize += ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+        if (!mipmaps || (width == 1 && height == 1))
+            break;
+        ++numLevels;
+    }
+
+    SharedPtr<Image> ret(new Image(context_));
+    ret->width_ = width_;
+    ret->height_ = height_;
+    ret->depth_ = 1;
+    ret->components_ = format == CF_DXT1 ? 3 : 4;
+    ret->compressedFormat_ = format;
+    ret->numCompressedLevels_ = numLevels;
+    ret->data_ = new unsigned char[dataSize];
+    ret->SetMemoryUse(dataSize);
+
+    // Compress each level; the mip levels are generated by filtering the previous uncompressed level
+    unsigned char* dest = ret->data_.Get();
+    const Image* level = this;
+    SharedPtr<Image> nextLevel;
+    for (unsigned i = 0; i < numLevels; ++i)
+    {
+        if (level->components_ == 4)
+            CompressImageDXT(dest, level->data_.Get(), level->width_, level->height_, format);
+        else
+        {
+            SharedPtr<Image> rgbaLevel = level->ConvertToRGBA();
+            CompressImageDXT(dest, rgbaLevel->data_.Get(), level->width_, level->height_, format);
+        }
+        dest += ((level->width_ + 3) / 4) * ((level->height_ + 3) / 4) * blockSize;
+
+        if (i + 1 < numLevels)
+        {
+            nextLevel = level->GetNextLevel();
+            if (!nextLevel)
+                return SharedPtr<Image>();
+            level = nextLevel;
+        }
+    }
+
+    return ret;
+}
+
 CompressedLevel Image::GetCompressedLevel(unsigned index) const
 {
     CompressedLevel level;
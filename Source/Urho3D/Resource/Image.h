@@ -138,6 +138,8 @@ public:
     bool SaveTGA(const String& fileName) const;
     /// Save in JPG format with compression quality. Return true if successful.
     bool SaveJPG(const String& fileName, int quality) const;
+    /// Save in DDS format. Only DXT compressed images are supported. A nonzero source hash is stored in the header so that asset pipeline tools can detect unchanged sources. Return true if successful.
+    bool SaveDDS(const String& fileName, unsigned sourceHash = 0) const;
 
     /// Return a 2D pixel color.
     Color GetPixel(int x, int y) const;
@@ -171,6 +173,8 @@ public:
     SharedPtr<Image> GetNextLevel() const;
     /// Return image converted to 4-component (RGBA) to circumvent modern rendering API's not supporting e.g. the luminance-alpha format.
     SharedPtr<Image> ConvertToRGBA() const;
+    /// Return image compressed to DXT1 or DXT5, optionally with a full mip chain, or null if failed. With CF_NONE the format is chosen by whether the image has translucent pixels. 3D images are not supported.
+    SharedPtr<Image> ConvertToDXT(CompressedFormat format = CF_NONE, bool mipmaps = true) const;
     /// Return a compressed mip level.
     CompressedLevel GetCompressedLevel(unsigned index) const;
     /// Return subimage from the image by the defined rect or null if failed. 3D images are not supported. You must free the subimage yourself.
@@ -28,6 +28,10 @@
 #include "../Core/Profiler.h"
 #include "../Resource/ResourceCache.h"
 #include "../IO/Serializer.h"
+
+#ifdef URHO3D_SSE
+#define RAPIDJSON_SSE2
+#endif
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/prettywriter.h>
@@ -39,6 +43,98 @@ using namespace rapidjson;
 namespace Urho3D
 {
 
+/// Padding after loaded JSON data, as the SIMD whitespace skipping reads 16 bytes at a time.
+static const unsigned JSON_BUFFER_PADDING = 16;
+/// Chunk size for streaming parsing.
+static const unsigned JSON_STREAM_CHUNK_SIZE = 65536;
+
+/// rapidjson input stream reading a Deserializer in chunks.
+class DeserializerReadStream
+{
+public:
+    typedef char Ch;
+    
+    /// Construct.
+    DeserializerReadStream(Deserializer& source) :
+        source_(&source),
+        buffer_(new char[JSON_STREAM_CHUNK_SIZE + 1]),
+        current_(0),
+        end_(0),
+        count_(0)
+    {
+        Read();
+    }
+    
+    /// Return current character, or zero at the end.
+    Ch Peek() const { return buffer_[current_]; }
+    /// Return current character and advance.
+    Ch Take()
+    {
+        Ch c = buffer_[current_];
+        if (current_ < end_ && ++current_ == end_)
+            Read();
+        return c;
+    }
+    /// Return number of characters read.
+    size_t Tell() const { return count_ + current_; }
+    
+    // Writing is only used by in-place parsing
+    void Put(Ch) { assert(false); }
+    Ch* PutBegin() { assert(false); return 0; }
+    size_t PutEnd(Ch*) { assert(false); return 0; }
+    
+private:
+    /// Read the next chunk.
+    void Read()
+    {
+        count_ += end_;
+        end_ = source_->IsEof() ? 0 : source_->Read(buffer_.Get(), JSON_STREAM_CHUNK_SIZE);
+        buffer_[end_] = '\0';
+        current_ = 0;
+    }
+    
+    /// Source stream. A pointer, as the parser copies the stream.
+    Deserializer* source_;
+    /// Chunk buffer shared between the copies.
+    SharedArrayPtr<char> buffer_;
+    /// Position in the chunk.
+    unsigned current_;
+    /// Size of the chunk.
+    unsigned end_;
+    /// Number of characters in the preceding chunks.
+    size_t count_;
+};
+
+/// rapidjson reader handler forwarding to a JSONSAXHandler.
+struct SAXHandlerAdapter
+{
+    typedef char Ch;
+    
+    /// Construct.
+    SAXHandlerAdapter(JSONSAXHandler& handler) :
+        handler_(handler)
+    {
+    }
+    
+    /// Forward rapidjson events.
+    
+    void Null() { handler_.OnNull(); }
+    void Bool(bool b) { handler_.OnBool(b); }
+    void Int(int i) { handler_.OnNumber((double)i); }
+    void Uint(unsigned i) { handler_.OnNumber((double)i); }
+    void Int64(int64_t i) { handler_.OnNumber((double)i); }
+    void Uint64(uint64_t i) { handler_.OnNumber((double)i); }
+    void Double(double d) { handler_.OnNumber(d); }
+    void String(const Ch* str, SizeType length, bool) { handler_.OnString(str, length); }
+    void StartObject() { handler_.OnStartObject(); }
+    void EndObject(SizeType memberCount) { handler_.OnEndObject(memberCount); }
+    void StartArray() { handler_.OnStartArray(); }
+    void EndArray(SizeType elementCount) { handler_.OnEndArray(elementCount); }
+    
+    /// Handler.
+    JSONSAXHandler& handler_;
+};
+
 JSONFile::JSONFile(Context* context) :
     Resource(context),
     document_(new Document())
@@ -65,22 +161,40 @@ bool JSONFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    SharedArrayPtr<char> buffer(new char[dataSize + 1]);
+    // Parse in place, so that strings point to the kept buffer instead of being copied
+    SharedArrayPtr<char> buffer(new char[dataSize + JSON_BUFFER_PADDING]);
     if (source.Read(buffer.Get(), dataSize) != dataSize)
         return false;
-    buffer[dataSize] = '\0';
+    memset(buffer.Get() + dataSize, 0, JSON_BUFFER_PADDING);
 
-    if (document_->Parse<0>(buffer).HasParseError())
+    if (document_->ParseInsitu<0>(buffer.Get()).HasParseError())
     {
         LOGERROR("Could not parse JSON data from " + source.GetName());
         return false;
     }
 
+    buffer_ = buffer;
+
     SetMemoryUse(dataSize);
 
     return true;
 }
 
+bool JSONFile::ParseSAX(Deserializer& source, JSONSAXHandler& handler)
+{
+    DeserializerReadStream stream(source);
+    SAXHandlerAdapter adapter(handler);
+    Reader reader;
+    if (!reader.Parse<0>(stream, adapter))
+    {
+        LOGERRORF("Could not parse JSON data from %s: %s at offset %u", source.GetName().CString(), reader.GetParseError(),
+            (unsigned)reader.GetErrorOffset());
+        return false;
+    }
+    
+    return true;
+}
+
 bool JSONFile::Save(Serializer& dest) const
 {
     return Save(dest, "\t");
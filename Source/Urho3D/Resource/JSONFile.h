@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/ArrayPtr.h"
 #include "../Resource/Resource.h"
 #include "../Resource/JSONValue.h"
 
@@ -34,6 +35,33 @@ namespace rapidjson
 namespace Urho3D
 {
 
+class Deserializer;
+
+/// Receiver of JSON parsing events from a streaming parse, which does not build a document.
+class URHO3D_API JSONSAXHandler
+{
+public:
+    /// Destruct.
+    virtual ~JSONSAXHandler() {}
+    
+    /// Handle a null value.
+    virtual void OnNull() {}
+    /// Handle a boolean value.
+    virtual void OnBool(bool value) {}
+    /// Handle a number value.
+    virtual void OnNumber(double value) {}
+    /// Handle a string value, or an object member name. The string is valid only during the call.
+    virtual void OnString(const char* value, unsigned length) {}
+    /// Handle start of an object.
+    virtual void OnStartObject() {}
+    /// Handle end of an object.
+    virtual void OnEndObject(unsigned memberCount) {}
+    /// Handle start of an array.
+    virtual void OnStartArray() {}
+    /// Handle end of an array.
+    virtual void OnEndArray(unsigned elementCount) {}
+};
+
 /// JSON document resource.
 class URHO3D_API JSONFile : public Resource
 {
@@ -62,9 +90,14 @@ public:
     /// Return rapidjson document.
     rapidjson::Document* GetDocument() const { return document_; }
 
+    /// Parse JSON data from a stream without building a document, passing the values to a handler in document order. The stream is read in chunks, so memory use does not grow with the data size. Return true if successful.
+    static bool ParseSAX(Deserializer& source, JSONSAXHandler& handler);
+
 private:
     /// Rapid JSON document.
     rapidjson::Document* document_;
+    /// Loaded data, which the document strings point to after the in-place parse.
+    SharedArrayPtr<char> buffer_;
 };
 
 }
@@ -75,6 +75,12 @@ bool Resource::EndLoad()
     return true;
 }
 
+bool Resource::EndLoadStep(bool& finished)
+{
+    finished = true;
+    return EndLoad();
+}
+
 bool Resource::Save(Serializer& dest) const
 {
     LOGERROR("Save not supported for " + GetTypeName());
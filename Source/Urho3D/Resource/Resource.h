@@ -62,8 +62,12 @@ public:
     virtual bool BeginLoad(Deserializer& source);
     /// Finish resource loading. Always called from the main thread. Return true if successful.
     virtual bool EndLoad();
+    /// Perform one step of finishing background loading, so that large GPU uploads can be spread over several frames. Always called from the main thread. Set finished true when done and return true if successful. Default calls EndLoad() as a single step.
+    virtual bool EndLoadStep(bool& finished);
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
+    /// Return references to the other resources this resource directly depends on. Used to build the resource manifest of a saved scene.
+    virtual void GetDependencies(Vector<ResourceRef>& dest) const {}
     
     /// Set name.
     void SetName(const String& name);
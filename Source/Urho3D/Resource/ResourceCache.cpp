@@ -23,6 +23,7 @@
 #include "../Resource/BackgroundLoader.h"
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
+#include "../Container/Sort.h"
 #include "../IO/FileSystem.h"
 #include "../IO/FileWatcher.h"
 #include "../Resource/Image.h"
@@ -62,17 +63,34 @@ static const char* checkDirs[] = {
 
 static const SharedPtr<Resource> noResource;
 
+static bool StartsWithNoCase(const String& str, const char* prefix, unsigned prefixLength)
+{
+    if (str.Length() < prefixLength)
+        return false;
+
+    const char* chars = str.CString();
+    for (unsigned i = 0; i < prefixLength; ++i)
+    {
+        if (tolower(chars[i]) != tolower(prefix[i]))
+            return false;
+    }
+
+    return true;
+}
+
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
-    finishBackgroundResourcesMs_(5)
+    packageIndexDirty_(false),
+    finishBackgroundResourcesMs_(5),
+    totalMemoryBudget_(0)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
     
-    // Create resource background loader. Its thread will start on the first background request
+    // Create resource background loader. Its threads will start on the first background request
     backgroundLoader_ = new BackgroundLoader(this);
     
     // Subscribe BeginFrame for handling directory watchers and background loaded resource finalization
@@ -135,6 +153,7 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
         packages_.Insert(priority, SharedPtr<PackageFile>(package));
     else
         packages_.Push(SharedPtr<PackageFile>(package));
+    packageIndexDirty_ = true;
     
     LOGINFO("Added resource package " + package->GetName());
     return true;
@@ -162,6 +181,7 @@ bool ResourceCache::AddManualResource(Resource* resource)
     }
     
     resource->ResetUseTimer();
+    MutexLock lock(resourceGroupMutex_);
     resourceGroups_[resource->GetType()].resources_[resource->GetNameHash()] = resource;
     UpdateResourceGroup(resource->GetType());
     return true;
@@ -205,6 +225,7 @@ void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResource
                 ReleasePackageResources(*i, forceRelease);
             LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            packageIndexDirty_ = true;
             return;
         }
     }
@@ -225,6 +246,7 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
                 ReleasePackageResources(*i, forceRelease);
             LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            packageIndexDirty_ = true;
             return;
         }
     }
@@ -232,6 +254,7 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
 
 void ResourceCache::ReleaseResource(StringHash type, const String& name, bool force)
 {
+    MutexLock lock(resourceGroupMutex_);
     StringHash nameHash(name);
     const SharedPtr<Resource>& existingRes = FindResource(type, nameHash);
     if (!existingRes)
@@ -247,6 +270,7 @@ void ResourceCache::ReleaseResource(StringHash type, const String& name, bool fo
 
 void ResourceCache::ReleaseResources(StringHash type, bool force)
 {
+    MutexLock lock(resourceGroupMutex_);
     bool released = false;
     
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
@@ -271,6 +295,7 @@ void ResourceCache::ReleaseResources(StringHash type, bool force)
 
 void ResourceCache::ReleaseResources(StringHash type, const String& partialName, bool force)
 {
+    MutexLock lock(resourceGroupMutex_);
     bool released = false;
     
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
@@ -300,6 +325,7 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
 {
     // Some resources refer to others, like materials to textures. Release twice to ensure these get released.
     // This is not necessary if forcing release
+    MutexLock lock(resourceGroupMutex_);
     unsigned repeat = force ? 1 : 2;
     
     while (repeat--)
@@ -330,6 +356,7 @@ void ResourceCache::ReleaseResources(const String& partialName, bool force)
 
 void ResourceCache::ReleaseAllResources(bool force)
 {
+    MutexLock lock(resourceGroupMutex_);
     unsigned repeat = force ? 1 : 2;
     
     while (repeat--)
@@ -384,44 +411,61 @@ bool ResourceCache::ReloadResource(Resource* resource)
 
 void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
 {
-    StringHash fileNameHash(fileName);
-    // If the filename is a resource we keep track of, reload it
-    const SharedPtr<Resource>& resource = FindResource(fileNameHash);
-    if (resource)
-    {
-        LOGDEBUG("Reloading changed resource " + fileName);
-        ReloadResource(resource);
-    }
-    // Always perform dependency resource check for resource loaded from XML file as it could be used in inheritance
-    if (!resource || GetExtension(resource->GetName()) == ".xml")
+    Vector<String> fileNames;
+    fileNames.Push(fileName);
+    ReloadResourcesWithDependencies(fileNames);
+}
+
+void ResourceCache::ReloadResourcesWithDependencies(const Vector<String>& fileNames)
+{
+    // Reloading a resource may modify the dependency tracking structure. Therefore collect the resources we need to
+    // reload first. A resource that changed itself and depends on other changed files, or depends on several of them,
+    // is reloaded only once
+    Vector<SharedPtr<Resource> > toReload;
+    HashSet<StringHash> queued;
+    
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
     {
-        // Check if this is a dependency resource, reload dependents
-        HashMap<StringHash, HashSet<StringHash> >::ConstIterator j = dependentResources_.Find(fileNameHash);
-        if (j != dependentResources_.End())
+        const String& fileName = fileNames[i];
+        StringHash fileNameHash(fileName);
+        // If the filename is a resource we keep track of, reload it
+        const SharedPtr<Resource>& resource = FindResource(fileNameHash);
+        if (resource && !queued.Contains(fileNameHash))
         {
-            // Reloading a resource may modify the dependency tracking structure. Therefore collect the
-            // resources we need to reload first
-            Vector<SharedPtr<Resource> > dependents;
-            dependents.Reserve(j->second_.Size());
-            
-            for (HashSet<StringHash>::ConstIterator k = j->second_.Begin(); k != j->second_.End(); ++k)
-            {
-                const SharedPtr<Resource>& dependent = FindResource(*k);
-                if (dependent)
-                    dependents.Push(dependent);
-            }
-            
-            for (unsigned k = 0; k < dependents.Size(); ++k)
+            LOGDEBUG("Reloading changed resource " + fileName);
+            queued.Insert(fileNameHash);
+            toReload.Push(resource);
+        }
+        // Always perform dependency resource check for resource loaded from XML file as it could be used in inheritance
+        if (!resource || GetExtension(resource->GetName()) == ".xml")
+        {
+            // Check if this is a dependency resource, reload dependents
+            HashMap<StringHash, HashSet<StringHash> >::ConstIterator j = dependentResources_.Find(fileNameHash);
+            if (j != dependentResources_.End())
             {
-                LOGDEBUG("Reloading resource " + dependents[k]->GetName() + " depending on " + fileName);
-                ReloadResource(dependents[k]);
+                for (HashSet<StringHash>::ConstIterator k = j->second_.Begin(); k != j->second_.End(); ++k)
+                {
+                    if (queued.Contains(*k))
+                        continue;
+                    const SharedPtr<Resource>& dependent = FindResource(*k);
+                    if (dependent)
+                    {
+                        LOGDEBUG("Reloading resource " + dependent->GetName() + " depending on " + fileName);
+                        queued.Insert(*k);
+                        toReload.Push(dependent);
+                    }
+                }
             }
         }
     }
+    
+    for (unsigned i = 0; i < toReload.Size(); ++i)
+        ReloadResource(toReload[i]);
 }
 
 void ResourceCache::SetMemoryBudget(StringHash type, unsigned budget)
 {
+    MutexLock lock(resourceGroupMutex_);
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
@@ -503,20 +547,15 @@ Resource* ResourceCache::GetExistingResource(StringHash type, const String& name
 {
     String name = SanitateResourceName(nameIn);
 
-    if (!Thread::IsMainThread())
-    {
-        LOGERROR("Attempted to get resource " + name + " from outside the main thread");
-        return 0;
-    }
-
     // If empty name, return null pointer immediately
     if (name.Empty())
         return 0;
 
     StringHash nameHash(name);
 
-    const SharedPtr<Resource>& existing = FindResource(type, nameHash);
-    return existing;
+    // Hold the lock until the pointer has been read, as the main thread may modify the resource group meanwhile
+    MutexLock lock(resourceGroupMutex_);
+    return FindResource(type, nameHash).Get();
 }
 
 Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
@@ -525,7 +564,8 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
 
     if (!Thread::IsMainThread())
     {
-        LOGERROR("Attempted to get resource " + name + " from outside the main thread");
+        LOGERROR("Attempted to get resource " + name + " from outside the main thread, use GetExistingResource() or "
+            "BackgroundLoadResource() instead");
         return 0;
     }
 
@@ -587,13 +627,20 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     
     // Store to cache
     resource->ResetUseTimer();
+    MutexLock lock(resourceGroupMutex_);
     resourceGroups_[type].resources_[nameHash] = resource;
     UpdateResourceGroup(type);
     
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller)
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+    backgroundLoader_->SetNumThreads(num);
+}
+
+bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller,
+    int priority)
 {
     // If empty name, fail immediately
     String name = SanitateResourceName(nameIn);
@@ -602,10 +649,22 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
     
     // First check if already exists as a loaded resource
     StringHash nameHash(name);
-    if (FindResource(type, nameHash) != noResource)
+    {
+        MutexLock lock(resourceGroupMutex_);
+        if (FindResource(type, nameHash) != noResource)
+            return false;
+    }
+    
+    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller, priority);
+}
+
+bool ResourceCache::CancelBackgroundLoadResource(StringHash type, const String& nameIn)
+{
+    String name = SanitateResourceName(nameIn);
+    if (name.Empty())
         return false;
     
-    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
+    return backgroundLoader_->CancelResource(type, StringHash(name));
 }
 
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String& nameIn, bool sendEventOnFailure)
@@ -666,6 +725,11 @@ unsigned ResourceCache::GetNumBackgroundLoadResources() const
     return backgroundLoader_->GetNumQueuedResources();
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+    return backgroundLoader_->GetNumThreads();
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
@@ -689,11 +753,8 @@ bool ResourceCache::Exists(const String& nameIn) const
     if (name.Empty())
         return false;
     
-    for (unsigned i = 0; i < packages_.Size(); ++i)
-    {
-        if (packages_[i]->Exists(name))
-            return true;
-    }
+    if (FindPackage(name))
+        return true;
     
     FileSystem* fileSystem = GetSubsystem<FileSystem>();
     for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
@@ -787,6 +848,10 @@ String ResourceCache::GetPreferredResourceDir(const String& path) const
 
 String ResourceCache::SanitateResourceName(const String& nameIn) const
 {
+    // Most names are already clean, so check first whether there is anything to sanitate to avoid building temporaries
+    if (IsSanitaryResourceName(nameIn))
+        return nameIn;
+
     // Sanitate unsupported constructs from the resource name
     String name = GetInternalPath(nameIn);
     name.Replace("../", "");
@@ -816,6 +881,39 @@ String ResourceCache::SanitateResourceName(const String& nameIn) const
     return name.Trimmed();
 }
 
+bool ResourceCache::IsSanitaryResourceName(const String& name) const
+{
+    if (name.Empty())
+        return true;
+
+    const char* chars = name.CString();
+    unsigned length = name.Length();
+    if (chars[0] == ' ' || chars[0] == 9 || chars[length - 1] == ' ' || chars[length - 1] == 9)
+        return false;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        if (chars[i] == '\\' || (chars[i] == '.' && chars[i + 1] == '/'))
+            return false;
+    }
+
+    if (resourceDirs_.Size())
+    {
+        const String& exePath = GetSubsystem<FileSystem>()->GetProgramDir();
+        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+        {
+            const String& resourceDir = resourceDirs_[i];
+            if (name.StartsWith(resourceDir, false))
+                return false;
+            // Also check the resource directory relative to the executable path
+            if (resourceDir.Length() > exePath.Length() && resourceDir.StartsWith(exePath) &&
+                StartsWithNoCase(name, resourceDir.CString() + exePath.Length(), resourceDir.Length() - exePath.Length()))
+                return false;
+        }
+    }
+
+    return true;
+}
+
 String ResourceCache::SanitateResourceDirName(const String& nameIn) const
 {
     String fixedPath = AddTrailingSlash(nameIn);
@@ -864,7 +962,7 @@ void ResourceCache::ResetDependencies(Resource* resource)
 
 const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHash nameHash)
 {
-    MutexLock lock(resourceMutex_);
+    MutexLock lock(resourceGroupMutex_);
 
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
@@ -878,7 +976,7 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash type, StringHa
 
 const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
 {
-    MutexLock lock(resourceMutex_);
+    MutexLock lock(resourceGroupMutex_);
 
     for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
     {
@@ -892,6 +990,7 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
 
 void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 {
+    MutexLock lock(resourceGroupMutex_);
     HashSet<StringHash> affectedGroups;
     
     const HashMap<String, PackageEntry>& entries = package->GetEntries();
@@ -923,6 +1022,7 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 
 void ResourceCache::UpdateResourceGroup(StringHash type)
 {
+    MutexLock lock(resourceGroupMutex_);
     HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i == resourceGroups_.End())
         return;
@@ -954,6 +1054,8 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
         {
             LOGDEBUG("Resource group " + oldestResource->second_->GetTypeName() + " over memory budget, releasing resource " +
                 oldestResource->second_->GetName());
+            // The callers may hold the lock, so the event is sent later by SendResourceEvictedEvents()
+            evictedResources_.Push(MakePair(type, oldestResource->second_));
             i->second_.resources_.Erase(oldestResource);
         }
         else
@@ -961,22 +1063,193 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     }
 }
 
-void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+/// Unused resource considered for release under the total memory budget.
+struct EvictionCandidate
+{
+    /// Resource type.
+    StringHash type_;
+    /// Resource name hash.
+    StringHash nameHash_;
+    /// Time since last use in milliseconds.
+    unsigned useTimer_;
+};
+
+static bool CompareEvictionCandidates(const EvictionCandidate& lhs, const EvictionCandidate& rhs)
+{
+    return lhs.useTimer_ > rhs.useTimer_;
+}
+
+void ResourceCache::UpdateMemoryBudgets()
+{
+    bool hasBudgets = totalMemoryBudget_ != 0;
+    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End() &&
+        !hasBudgets; ++i)
+    {
+        if (i->second_.memoryBudget_)
+            hasBudgets = true;
+    }
+    if (!hasBudgets)
+    {
+        // Report the resources released before the budgets were removed
+        SendResourceEvictedEvents();
+        return;
+    }
+    
+    PROFILE(UpdateMemoryBudgets);
+    
+    // Resources referenced outside the cache are in use now. Refresh their timers every frame so that the time since
+    // last use is exact when they are released, instead of dating from the last budget check
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+            j != i->second_.resources_.End(); ++j)
+        {
+            if (j->second_.Refs() > 1)
+                j->second_->ResetUseTimer();
+        }
+    }
+    
+    // Enforce the per-type budgets, then the total budget
+    PODVector<StringHash> overBudget;
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_)
+            overBudget.Push(i->first_);
+    }
+    for (unsigned i = 0; i < overBudget.Size(); ++i)
+        UpdateResourceGroup(overBudget[i]);
+    
+    // Also report the resources released by budget checks during loading since the last frame
+    SendResourceEvictedEvents();
+    
+    for (unsigned i = 0; i < overBudget.Size(); ++i)
+    {
+        HashMap<StringHash, ResourceGroup>::ConstIterator j = resourceGroups_.Find(overBudget[i]);
+        if (j != resourceGroups_.End() && j->second_.memoryBudget_ && j->second_.memoryUse_ > j->second_.memoryBudget_)
+        {
+            using namespace MemoryBudgetExceeded;
+            
+            VariantMap& eventData = GetEventDataMap();
+            eventData[P_RESOURCETYPE] = overBudget[i];
+            eventData[P_MEMORYUSE] = j->second_.memoryUse_;
+            eventData[P_MEMORYBUDGET] = j->second_.memoryBudget_;
+            SendEvent(E_MEMORYBUDGETEXCEEDED, eventData);
+        }
+    }
+    
+    EnforceTotalMemoryBudget();
+}
+
+void ResourceCache::EnforceTotalMemoryBudget()
 {
-    for (unsigned i = 0; i < fileWatchers_.Size(); ++i)
+    if (!totalMemoryBudget_)
+        return;
+    
+    unsigned totalUse = GetTotalMemoryUse();
+    if (totalUse <= totalMemoryBudget_)
+        return;
+    
     {
-        String fileName;
-        while (fileWatchers_[i]->GetNextChange(fileName))
+        MutexLock lock(resourceGroupMutex_);
+        PODVector<EvictionCandidate> candidates;
+        for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        {
+            for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+                j != i->second_.resources_.End(); ++j)
+            {
+                if (j->second_.Refs() == 1)
+                {
+                    EvictionCandidate candidate;
+                    candidate.type_ = i->first_;
+                    candidate.nameHash_ = j->first_;
+                    candidate.useTimer_ = j->second_->GetUseTimer();
+                    candidates.Push(candidate);
+                }
+            }
+        }
+        
+        // Release the least recently used first. No event handlers run before the lock is released, so the candidates stay valid
+        Sort(candidates.Begin(), candidates.End(), CompareEvictionCandidates);
+        
+        for (unsigned i = 0; i < candidates.Size() && totalUse > totalMemoryBudget_; ++i)
         {
-            ReloadResourceWithDependencies(fileName);
+            ResourceGroup& group = resourceGroups_[candidates[i].type_];
+            HashMap<StringHash, SharedPtr<Resource> >::Iterator j = group.resources_.Find(candidates[i].nameHash_);
+            
+            LOGDEBUG("Over total memory budget, releasing resource " + j->second_->GetName());
+            unsigned memoryUse = j->second_->GetMemoryUse();
+            evictedResources_.Push(MakePair(candidates[i].type_, j->second_));
+            group.resources_.Erase(j);
+            group.memoryUse_ -= memoryUse;
+            totalUse -= memoryUse;
+        }
+    }
+    
+    // Send the events without holding the lock, as the handlers may load or release resources
+    SendResourceEvictedEvents();
+    
+    totalUse = GetTotalMemoryUse();
+    if (totalUse > totalMemoryBudget_)
+    {
+        using namespace MemoryBudgetExceeded;
+        
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_RESOURCETYPE] = StringHash();
+        eventData[P_MEMORYUSE] = totalUse;
+        eventData[P_MEMORYBUDGET] = totalMemoryBudget_;
+        SendEvent(E_MEMORYBUDGETEXCEEDED, eventData);
+    }
+}
+
+void ResourceCache::SendResourceEvictedEvents()
+{
+    // Take the list first, as the handlers may cause more resources to be released
+    Vector<Pair<StringHash, SharedPtr<Resource> > > evicted;
+    evicted.Swap(evictedResources_);
+    
+    for (unsigned i = 0; i < evicted.Size(); ++i)
+    {
+        using namespace ResourceEvicted;
+        
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_RESOURCETYPE] = evicted[i].first_;
+        eventData[P_RESOURCENAME] = evicted[i].second_->GetName();
+        SendEvent(E_RESOURCEEVICTED, eventData);
+    }
+}
 
+void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    if (!fileWatchers_.Empty())
+    {
+        // Collect the settled changes of all watched directories into one batch, so that resources depending on
+        // several changed files are reloaded only once
+        Vector<String> changedFiles;
+        Vector<String> changedPaths;
+        for (unsigned i = 0; i < fileWatchers_.Size(); ++i)
+        {
+            unsigned start = changedFiles.Size();
+            if (fileWatchers_[i]->GetChanges(changedFiles))
+            {
+                for (unsigned j = start; j < changedFiles.Size(); ++j)
+                    changedPaths.Push(fileWatchers_[i]->GetPath() + changedFiles[j]);
+            }
+        }
+        
+        if (!changedFiles.Empty())
+        {
+            ReloadResourcesWithDependencies(changedFiles);
+            
             // Finally send a general file changed event even if the file was not a tracked resource
             using namespace FileChanged;
-
-            VariantMap& eventData = GetEventDataMap();
-            eventData[P_FILENAME] = fileWatchers_[i]->GetPath() + fileName;
-            eventData[P_RESOURCENAME] = fileName;
-            SendEvent(E_FILECHANGED, eventData);
+            
+            for (unsigned i = 0; i < changedFiles.Size(); ++i)
+            {
+                VariantMap& eventData = GetEventDataMap();
+                eventData[P_FILENAME] = changedPaths[i];
+                eventData[P_RESOURCENAME] = changedFiles[i];
+                SendEvent(E_FILECHANGED, eventData);
+            }
         }
     }
     
@@ -985,6 +1258,8 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         PROFILE(FinishBackgroundResources);
         backgroundLoader_->FinishResources(finishBackgroundResourcesMs_);
     }
+    
+    UpdateMemoryBudgets();
 }
 
 File* ResourceCache::SearchResourceDirs(const String& nameIn)
@@ -1011,15 +1286,63 @@ File* ResourceCache::SearchResourceDirs(const String& nameIn)
 
 File* ResourceCache::SearchPackages(const String& nameIn)
 {
+    PackageFile* package = FindPackage(nameIn);
+    return package ? new File(context_, package, nameIn) : 0;
+}
+
+PackageFile* ResourceCache::FindPackage(const String& name) const
+{
+    if (packageIndexDirty_)
+        RebuildPackageIndex();
+    
+    // StringHash is case-insensitive like the package entry names, so the name does not need to be lowercased
+    StringHash nameHash(name);
+    if (!packageIndexCollisions_.Contains(nameHash))
+    {
+        // A name that is in no package may still share the hash of an indexed name, so confirm the hit
+        HashMap<StringHash, PackageFile*>::ConstIterator i = packageIndex_.Find(nameHash);
+        return i != packageIndex_.End() && i->second_->Exists(name) ? i->second_ : 0;
+    }
+    
     for (unsigned i = 0; i < packages_.Size(); ++i)
     {
-        if (packages_[i]->Exists(nameIn))
-            return new File(context_, packages_[i], nameIn);
+        if (packages_[i]->Exists(name))
+            return packages_[i];
     }
-
+    
     return 0;
 }
 
+void ResourceCache::RebuildPackageIndex() const
+{
+    PROFILE(RebuildPackageIndex);
+    
+    packageIndex_.Clear();
+    packageIndexCollisions_.Clear();
+    
+    // The names are only needed while building, to detect hash collisions
+    HashMap<StringHash, String> names;
+    for (unsigned i = 0; i < packages_.Size(); ++i)
+    {
+        const HashMap<String, PackageEntry>& entries = packages_[i]->GetEntries();
+        for (HashMap<String, PackageEntry>::ConstIterator j = entries.Begin(); j != entries.End(); ++j)
+        {
+            StringHash nameHash(j->first_);
+            HashMap<StringHash, String>::ConstIterator k = names.Find(nameHash);
+            if (k == names.End())
+            {
+                // Packages are in priority order, so the first package containing the file wins
+                names[nameHash] = j->first_;
+                packageIndex_[nameHash] = packages_[i];
+            }
+            else if (k->second_ != j->first_)
+                packageIndexCollisions_.Insert(nameHash);
+        }
+    }
+    
+    packageIndexDirty_ = false;
+}
+
 void RegisterResourceLibrary(Context* context)
 {
     Image::RegisterObject(context);
@@ -116,8 +116,12 @@ public:
     bool ReloadResource(Resource* resource);
     /// Reload a resource based on filename. Causes also reload of dependent resources if necessary.
     void ReloadResourceWithDependencies(const String &fileName);
+    /// Reload resources based on a batch of filenames, including dependent resources. Each resource is reloaded at most once.
+    void ReloadResourcesWithDependencies(const Vector<String>& fileNames);
     /// Set memory budget for a specific resource type, default 0 is unlimited.
     void SetMemoryBudget(StringHash type, unsigned budget);
+    /// Set total memory budget for all resource types. Unused resources are released in least recently used order, regardless of type, when it is exceeded. 0 disables.
+    void SetTotalMemoryBudget(unsigned budget) { totalMemoryBudget_ = budget; }
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
@@ -126,6 +130,8 @@ public:
     void SetSearchPackagesFirst(bool value) { searchPackagesFirst_ = value; }
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of background loader threads. Default 1.
+    void SetNumBackgroundLoadThreads(unsigned num);
     /// Set the resource router object. By default there is none, so the routing process is skipped.
     void SetResourceRouter(ResourceRouter* router) { resourceRouter_ = router; }
     
@@ -135,13 +141,15 @@ public:
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
     SharedPtr<Resource> GetTempResource(StringHash type, const String& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    /// Background load a resource. An event will be sent when complete. Queued resources with higher priority are loaded first. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
+    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0, int priority = 0);
+    /// Cancel a background load that has not started yet. No event will be sent for it. Return true if cancelled, false if not queued or already loading. Can be called from outside the main thread.
+    bool CancelBackgroundLoadResource(StringHash type, const String& name);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
-    /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist.
+    /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist. Can be called from outside the main thread; the resources are only released by the main thread, so the caller must make sure that it does not release the resource while in use, for example by holding a reference to it or by completing the work before the main thread continues.
     Resource* GetExistingResource(StringHash type, const String& name);
     /// Return all loaded resources.
     const HashMap<StringHash, ResourceGroup>& GetAllResources() const { return resourceGroups_; }
@@ -156,7 +164,7 @@ public:
     /// Template version of loading a resource without storing it to the cache.
     template <class T> SharedPtr<T> GetTempResource(const String& name, bool sendEventOnFailure = true);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0, int priority = 0);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(PODVector<T*>& result) const;
     /// Return whether a file exists by name.
@@ -167,6 +175,8 @@ public:
     unsigned GetMemoryUse(StringHash type) const;
     /// Return total memory use for all resources.
     unsigned GetTotalMemoryUse() const;
+    /// Return total memory budget for all resource types.
+    unsigned GetTotalMemoryBudget() const { return totalMemoryBudget_; }
     /// Return full absolute file name of resource if possible.
     String GetResourceFileName(const String& name) const;
     /// Return whether automatic resource reloading is enabled.
@@ -177,6 +187,8 @@ public:
     bool GetSearchPackagesFirst() const { return searchPackagesFirst_; }
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
+    /// Return number of background loader threads.
+    unsigned GetNumBackgroundLoadThreads() const;
     /// Return the resource router.
     ResourceRouter* GetResourceRouter() const { return resourceRouter_; }
 
@@ -184,6 +196,8 @@ public:
     String GetPreferredResourceDir(const String& path) const;
     /// Remove unsupported constructs from the resource name to prevent ambiguity, and normalize absolute filename to resource path relative if possible.
     String SanitateResourceName(const String& name) const;
+    /// Return whether a resource name needs no sanitation.
+    bool IsSanitaryResourceName(const String& name) const;
     /// Remove unnecessary constructs from a resource directory name and ensure it to be an absolute path.
     String SanitateResourceDirName(const String& name) const;
     /// Store a dependency for a resource. If a dependency file changes, the resource will be reloaded.
@@ -200,15 +214,27 @@ private:
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Refresh the use timers of resources in use and enforce the memory budgets. Called once per frame.
+    void UpdateMemoryBudgets();
+    /// Release least recently used unused resources of all types until within the total memory budget.
+    void EnforceTotalMemoryBudget();
+    /// Send the resource evicted events of the resources released since the last call. Must not be called while holding the resource group mutex.
+    void SendResourceEvictedEvents();
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     File* SearchResourceDirs(const String& nameIn);
     /// Search resource packages for file.
     File* SearchPackages(const String& nameIn);
+    /// Return the highest priority package containing a file, or null if none. Rebuild the package index first if necessary.
+    PackageFile* FindPackage(const String& name) const;
+    /// Rebuild the merged index of files in all packages.
+    void RebuildPackageIndex() const;
     
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
+    /// Mutex for the resource groups, which are modified only by the main thread but can be searched from any thread. Held only for the lookups and modifications, not while loading.
+    mutable Mutex resourceGroupMutex_;
     /// Resources by type.
     HashMap<StringHash, ResourceGroup> resourceGroups_;
     /// Resource load directories.
@@ -217,6 +243,10 @@ private:
     Vector<SharedPtr<FileWatcher> > fileWatchers_;
     /// Package files.
     Vector<SharedPtr<PackageFile> > packages_;
+    /// Highest priority package for each file name hash in all packages.
+    mutable HashMap<StringHash, PackageFile*> packageIndex_;
+    /// File name hashes shared by different names, which need to be searched from the packages one by one.
+    mutable HashSet<StringHash> packageIndexCollisions_;
     /// Dependent resources. Only used with automatic reload to eg. trigger reload of a cube texture when any of its faces change.
     HashMap<StringHash, HashSet<StringHash> > dependentResources_;
     /// Resource background loader.
@@ -229,8 +259,14 @@ private:
     bool returnFailedResources_;
     /// Search priority flag.
     bool searchPackagesFirst_;
+    /// Package index needs rebuild flag.
+    mutable bool packageIndexDirty_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Total memory budget for all resource types.
+    unsigned totalMemoryBudget_;
+    /// Resources released to stay within the memory budgets, with their types, waiting for the evicted event. Kept alive so that they are also destroyed outside the lock. Main thread only.
+    Vector<Pair<StringHash, SharedPtr<Resource> > > evictedResources_;
 };
 
 template <class T> T* ResourceCache::GetExistingResource(const String& name)
@@ -251,10 +287,10 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& nam
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller, int priority)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
 }
 
 template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
@@ -67,6 +67,21 @@ EVENT(E_UNKNOWNRESOURCETYPE, UnknownResourceType)
     PARAM(P_RESOURCETYPE, ResourceType);            // StringHash
 }
 
+/// Unused resource released from the cache to stay within a memory budget.
+EVENT(E_RESOURCEEVICTED, ResourceEvicted)
+{
+    PARAM(P_RESOURCETYPE, ResourceType);            // StringHash
+    PARAM(P_RESOURCENAME, ResourceName);            // String
+}
+
+/// Resource memory use is over a budget and no unused resources are left to release. Sent once per frame while over budget.
+EVENT(E_MEMORYBUDGETEXCEEDED, MemoryBudgetExceeded)
+{
+    PARAM(P_RESOURCETYPE, ResourceType);            // StringHash, zero for the total budget
+    PARAM(P_MEMORYUSE, MemoryUse);                  // unsigned
+    PARAM(P_MEMORYBUDGET, MemoryBudget);            // unsigned
+}
+
 /// Resource background loading finished.
 EVENT(E_RESOURCEBACKGROUNDLOADED, ResourceBackgroundLoaded)
 {
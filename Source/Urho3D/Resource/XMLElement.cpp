@@ -663,7 +663,7 @@ Vector<String> XMLElement::GetAttributeNames() const
 
 bool XMLElement::GetBool(const String& name) const
 {
-    return ToBool(GetAttribute(name));
+    return ToBool(GetAttributeCString(name.CString()));
 }
 
 BoundingBox XMLElement::GetBoundingBox() const
@@ -679,7 +679,7 @@ BoundingBox XMLElement::GetBoundingBox() const
 PODVector<unsigned char> XMLElement::GetBuffer(const String& name) const
 {
     PODVector<unsigned char> ret;
-    StringToBuffer(ret, GetAttribute(name));
+    StringToBuffer(ret, GetAttributeCString(name.CString()));
     return ret;
 }
 
@@ -698,47 +698,47 @@ bool XMLElement::GetBuffer(const String& name, void* dest, unsigned size) const
 
 Color XMLElement::GetColor(const String& name) const
 {
-    return ToColor(GetAttribute(name));
+    return ToColor(GetAttributeCString(name.CString()));
 }
 
 float XMLElement::GetFloat(const String& name) const
 {
-    return ToFloat(GetAttribute(name));
+    return ToFloat(GetAttributeCString(name.CString()));
 }
 
 unsigned XMLElement::GetUInt(const String& name) const
 {
-    return ToUInt(GetAttribute(name));
+    return ToUInt(GetAttributeCString(name.CString()));
 }
 
 int XMLElement::GetInt(const String& name) const
 {
-    return ToInt(GetAttribute(name));
+    return ToInt(GetAttributeCString(name.CString()));
 }
 
 IntRect XMLElement::GetIntRect(const String& name) const
 {
-    return ToIntRect(GetAttribute(name));
+    return ToIntRect(GetAttributeCString(name.CString()));
 }
 
 IntVector2 XMLElement::GetIntVector2(const String& name) const
 {
-    return ToIntVector2(GetAttribute(name));
+    return ToIntVector2(GetAttributeCString(name.CString()));
 }
 
 Quaternion XMLElement::GetQuaternion(const String& name) const
 {
-    return ToQuaternion(GetAttribute(name));
+    return ToQuaternion(GetAttributeCString(name.CString()));
 }
 
 Rect XMLElement::GetRect(const String& name) const
 {
-    return ToRect(GetAttribute(name));
+    return ToRect(GetAttributeCString(name.CString()));
 }
 
 Variant XMLElement::GetVariant() const
 {
-    VariantType type = Variant::GetTypeFromName(GetAttribute("type"));
+    VariantType type = Variant::GetTypeFromName(GetAttributeCString("type"));
     return GetVariantValue(type);
 }
 
@@ -821,42 +821,42 @@ VariantMap XMLElement::GetVariantMap() const
 
 Vector2 XMLElement::GetVector2(const String& name) const
 {
-    return ToVector2(GetAttribute(name));
+    return ToVector2(GetAttributeCString(name.CString()));
 }
 
 Vector3 XMLElement::GetVector3(const String& name) const
 {
-    return ToVector3(GetAttribute(name));
+    return ToVector3(GetAttributeCString(name.CString()));
 }
 
 Vector4 XMLElement::GetVector4(const String& name) const
 {
-    return ToVector4(GetAttribute(name));
+    return ToVector4(GetAttributeCString(name.CString()));
 }
 
 Vector4 XMLElement::GetVector(const String& name) const
 {
-    return ToVector4(GetAttribute(name), true);
+    return ToVector4(GetAttributeCString(name.CString()), true);
 }
 
 Variant XMLElement::GetVectorVariant(const String& name) const
 {
-    return ToVectorVariant(GetAttribute(name));
+    return ToVectorVariant(GetAttributeCString(name.CString()));
 }
 
 Matrix3 XMLElement::GetMatrix3(const String& name) const
 {
-    return ToMatrix3(GetAttribute(name));
+    return ToMatrix3(GetAttributeCString(name.CString()));
 }
 
 Matrix3x4 XMLElement::GetMatrix3x4(const String& name) const
 {
-    return ToMatrix3x4(GetAttribute(name));
+    return ToMatrix3x4(GetAttributeCString(name.CString()));
 }
 
 Matrix4 XMLElement::GetMatrix4(const String& name) const
 {
-    return ToMatrix4(GetAttribute(name));
+    return ToMatrix4(GetAttributeCString(name.CString()));
 }
 
 XMLFile* XMLElement::GetFile() const
@@ -88,11 +88,18 @@ bool XMLFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    SharedArrayPtr<char> buffer(new char[dataSize]);
-    if (source.Read(buffer.Get(), dataSize) != dataSize)
+    // Parse in place from a buffer allocated with pugixml's allocator, which the document takes ownership of. This avoids
+    // copying the whole data and allocating the strings separately. A zero size allocation is avoided for unnamed sources
+    char* buffer = (char*)pugi::get_memory_allocation_function()(Max((int)dataSize, 1));
+    if (!buffer)
         return false;
+    if (source.Read(buffer, dataSize) != dataSize)
+    {
+        pugi::get_memory_deallocation_function()(buffer);
+        return false;
+    }
 
-    if (!document_->load_buffer(buffer.Get(), dataSize))
+    if (!document_->load_buffer_inplace_own(buffer, dataSize))
     {
         LOGERROR("Could not parse XML data from " + source.GetName());
         document_->reset();
@@ -55,11 +55,9 @@ AttributeAnimationInfo::~AttributeAnimationInfo()
 void AttributeAnimationInfo::ApplyValue(const Variant& newValue)
 {
     Animatable* animatable = static_cast<Animatable*>(target_.Get());
+    // ApplyAttributes() is called once by Animatable after all its attribute animations have been applied
     if (animatable)
-    {
         animatable->OnSetAttribute(attributeInfo_, newValue);
-        animatable->ApplyAttributes();
-    }
 }
 
 Animatable::Animatable(Context* context) :
@@ -342,6 +340,9 @@ void Animatable::UpdateAttributeAnimations(float timeStep)
     if (!animationEnabled_)
         return;
 
+    if (attributeAnimationInfos_.Empty())
+        return;
+
     Vector<String> finishedNames;
     for (HashMap<String, SharedPtr<AttributeAnimationInfo> >::ConstIterator i = attributeAnimationInfos_.Begin(); i != attributeAnimationInfos_.End(); ++i)
     {
@@ -349,6 +350,8 @@ void Animatable::UpdateAttributeAnimations(float timeStep)
             finishedNames.Push(i->second_->GetAttributeInfo().name_);
     }
 
+    ApplyAttributes();
+
     for (unsigned i = 0; i < finishedNames.Size(); ++i)
         SetAttributeAnimation(finishedNames[i], 0);
 }
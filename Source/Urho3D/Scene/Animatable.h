@@ -97,6 +97,9 @@ public:
     /// Return attribute animation speed.
     float GetAttributeAnimationSpeed(const String& name) const;
 
+    /// Update attribute animations. Called by Scene.
+    void UpdateAttributeAnimations(float timeStep);
+
     /// Set object animation attribute.
     void SetObjectAnimationAttr(const ResourceRef& value);
     /// Return object animation attribute.
@@ -113,8 +116,6 @@ protected:
     void OnObjectAnimationAdded(ObjectAnimation* objectAnimation);
     /// Handle object animation removed.
     void OnObjectAnimationRemoved(ObjectAnimation* objectAnimation);
-    /// Update attribute animations.
-    void UpdateAttributeAnimations(float timeStep);
     /// Is animated network attribute.
     bool IsAnimatedNetworkAttribute(const AttributeInfo& attrInfo) const;
     /// Return attribute animation info.
@@ -132,6 +132,12 @@ void Component::AddReplicationState(ComponentReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Component::RemoveReplicationState(ComponentReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 void Component::PrepareNetworkUpdate()
 {
     if (!networkState_)
@@ -143,29 +149,39 @@ void Component::PrepareNetworkUpdate()
 
     unsigned numAttributes = attributes->Size();
 
+    // With dirty tracking only the marked attributes need to be compared, except on the first update
+    bool checkAll = !networkDirtyTracking_;
     if (networkState_->currentValues_.Size() != numAttributes)
     {
+        checkAll = true;
         networkState_->currentValues_.Resize(numAttributes);
         networkState_->previousValues_.Resize(numAttributes);
 
-        // Copy the default attribute values to the previous state as a starting point
+        // Copy the default attribute values to the current and previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            networkState_->currentValues_[i] = attributes->At(i).defaultValue_;
             networkState_->previousValues_[i] = attributes->At(i).defaultValue_;
+        }
     }
 
     // Check for attribute changes
+    DirtyBits changedBits;
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
 
+        if (!checkAll && !networkState_->markedAttributes_.IsSet(i))
+            continue;
         if (animationEnabled_ && IsAnimatedNetworkAttribute(attr))
             continue;
 
-        OnGetAttribute(attr, networkState_->currentValues_[i]);
-
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        // Compare in the attribute's native type first, so that unchanged attributes are not copied into the current values
+        if (!IsAttributeEqual(attr, networkState_->previousValues_[i]))
         {
+            OnGetAttribute(attr, networkState_->currentValues_[i]);
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            changedBits.Set(i);
 
             // Mark the attribute dirty in all replication states that are tracking this component
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
@@ -185,6 +201,12 @@ void Component::PrepareNetworkUpdate()
         }
     }
 
+    networkState_->markedAttributes_.ClearAll();
+
+    // Encode the changes once for all connections
+    if (changedBits.Count())
+        EncodeNetworkUpdate(changedBits);
+
     networkUpdate_ = false;
 }
 
@@ -202,14 +224,16 @@ void Component::CleanupConnection(Connection* connection)
 
 void Component::OnAttributeAnimationAdded()
 {
-    if (attributeAnimationInfos_.Size() == 1)
-        SubscribeToEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE, HANDLER(Component, HandleAttributeAnimationUpdate));
+    Scene* scene = GetScene();
+    if (attributeAnimationInfos_.Size() == 1 && scene)
+        scene->AddAnimatedObject(this);
 }
 
 void Component::OnAttributeAnimationRemoved()
 {
-    if (attributeAnimationInfos_.Empty())
-        UnsubscribeFromEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE);
+    Scene* scene = GetScene();
+    if (attributeAnimationInfos_.Empty() && scene)
+        scene->RemoveAnimatedObject(this);
 }
 
 void Component::OnNodeSet(Node* node)
@@ -253,10 +277,4 @@ void Component::GetComponents(PODVector<Component*>& dest, StringHash type) cons
         dest.Clear();
 }
 
-void Component::HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace AttributeAnimationUpdate;
-
-    UpdateAttributeAnimations(eventData[P_TIMESTEP].GetFloat());
-}
 }
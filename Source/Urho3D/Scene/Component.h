@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Core/ObjectPool.h"
 #include "../Scene/Animatable.h"
 
 namespace Urho3D
@@ -38,6 +39,7 @@ class URHO3D_API Component : public Animatable
 {
     OBJECT(Component);
     BASEOBJECT(Component);
+    POOLED_OBJECT();
 
     friend class Node;
     friend class Scene;
@@ -87,6 +89,8 @@ public:
 
     /// Add a replication state that is tracking this component.
     void AddReplicationState(ComponentReplicationState* state);
+    /// Remove a replication state that is no longer tracking this component.
+    void RemoveReplicationState(ComponentReplicationState* state);
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
     /// Clean up all references to a network connection that is about to be removed.
@@ -99,6 +103,8 @@ protected:
     virtual void OnAttributeAnimationRemoved();
     /// Handle scene node being assigned at creation.
     virtual void OnNodeSet(Node* node);
+    /// Handle the component being added to a scene, or removed from it when null. Called by Scene.
+    virtual void OnSceneSet(Scene* scene) {}
     /// Handle scene node transform dirtied.
     virtual void OnMarkedDirty(Node* node);
     /// Handle scene node enabled status changing.
@@ -107,8 +113,6 @@ protected:
     void SetID(unsigned id);
     /// Set scene node. Called by Node when creating the component.
     void SetNode(Node* node);
-    /// Handle scene attribute animation update event.
-    void HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData);
 
     /// Scene node.
     Node* node_;
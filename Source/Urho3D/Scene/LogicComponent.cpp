@@ -22,12 +22,7 @@
 
 #include "../IO/Log.h"
 #include "../Scene/LogicComponent.h"
-#ifdef URHO3D_PHYSICS
-#include "../Physics/PhysicsEvents.h"
-#include "../Physics/PhysicsWorld.h"
-#endif
 #include "../Scene/Scene.h"
-#include "../Scene/SceneEvents.h"
 
 namespace Urho3D
 {
@@ -36,12 +31,17 @@ LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
-    delayedStartCalled_(false)
+    delayedStartCalled_(false),
+    updateScene_(0),
+    updateGroup_(0),
+    updateIndex_(0)
 {
 }
 
 LogicComponent::~LogicComponent()
 {
+    if (updateScene_)
+        updateScene_->RemoveLogicComponent(this);
 }
 
 void LogicComponent::OnSetEnabled()
@@ -90,6 +90,19 @@ void LogicComponent::OnNodeSet(Node* node)
     }
 }
 
+void LogicComponent::OnSceneSet(Scene* scene)
+{
+    if (scene)
+        UpdateEventSubscription();
+    else
+    {
+        // Leaving the scene: stop receiving updates from it
+        if (updateScene_)
+            updateScene_->RemoveLogicComponent(this);
+        currentEventMask_ = 0;
+    }
+}
+
 void LogicComponent::UpdateEventSubscription()
 {
     // If scene node is not assigned yet, no need to update subscription
@@ -103,110 +116,43 @@ void LogicComponent::UpdateEventSubscription()
         return;
     }
     
-    bool enabled = IsEnabledEffective();
-    
-    bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
-    if (needUpdate && !(currentEventMask_ & USE_UPDATE))
-    {
-        SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(LogicComponent, HandleSceneUpdate));
-        currentEventMask_ |= USE_UPDATE;
-    }
-    else if (!needUpdate && (currentEventMask_ & USE_UPDATE))
+    currentEventMask_ = 0;
+    if (IsEnabledEffective())
     {
-        UnsubscribeFromEvent(scene, E_SCENEUPDATE);
-        currentEventMask_ &= ~USE_UPDATE;
+        currentEventMask_ = updateEventMask_;
+        // The update phase is needed also for executing the delayed start
+        if (!delayedStartCalled_)
+            currentEventMask_ |= USE_UPDATE;
     }
     
-    bool needPostUpdate = enabled && (updateEventMask_ & USE_POSTUPDATE);
-    if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
-    {
-        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, HANDLER(LogicComponent, HandleScenePostUpdate));
-        currentEventMask_ |= USE_POSTUPDATE;
-    }
-    else if (!needUpdate && (currentEventMask_ & USE_POSTUPDATE))
-    {
-        UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
-        currentEventMask_ &= ~USE_POSTUPDATE;
-    }
-
-#ifdef URHO3D_PHYSICS
-    PhysicsWorld* world = scene->GetComponent<PhysicsWorld>();
-    if (!world)
-        return;
-
-    bool needFixedUpdate = enabled && (updateEventMask_ & USE_FIXEDUPDATE);
-    if (needFixedUpdate && !(currentEventMask_ & USE_FIXEDUPDATE))
-    {
-        SubscribeToEvent(world, E_PHYSICSPRESTEP, HANDLER(LogicComponent, HandlePhysicsPreStep));
-        currentEventMask_ |= USE_FIXEDUPDATE;
-    }
-    else if (!needFixedUpdate && (currentEventMask_ & USE_FIXEDUPDATE))
+    Scene* updateScene = currentEventMask_ ? scene : 0;
+    if (updateScene != updateScene_)
     {
-        UnsubscribeFromEvent(world, E_PHYSICSPRESTEP);
-        currentEventMask_ &= ~USE_FIXEDUPDATE;
+        if (updateScene_)
+            updateScene_->RemoveLogicComponent(this);
+        if (updateScene)
+            updateScene->AddLogicComponent(this);
     }
-    
-    bool needFixedPostUpdate = enabled && (updateEventMask_ & USE_FIXEDPOSTUPDATE);
-    if (needFixedPostUpdate && !(currentEventMask_ & USE_FIXEDPOSTUPDATE))
-    {
-        SubscribeToEvent(world, E_PHYSICSPOSTSTEP, HANDLER(LogicComponent, HandlePhysicsPostStep));
-        currentEventMask_ |= USE_FIXEDPOSTUPDATE;
-    }
-    else if (!needFixedPostUpdate && (currentEventMask_ & USE_FIXEDPOSTUPDATE))
-    {
-        UnsubscribeFromEvent(world, E_PHYSICSPOSTSTEP);
-        currentEventMask_ &= ~USE_FIXEDPOSTUPDATE;
-    }
-#endif 
 }
 
-void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::CallUpdate(float timeStep)
 {
-    using namespace SceneUpdate;
-    
     // Execute user-defined delayed start function before first update
     if (!delayedStartCalled_)
     {
         DelayedStart();
         delayedStartCalled_ = true;
         
-        // If did not need actual update events, unsubscribe now
+        // If did not need actual update calls, stop them now
         if (!(updateEventMask_ & USE_UPDATE))
         {
-            UnsubscribeFromEvent(GetScene(), E_SCENEUPDATE);
-            currentEventMask_ &= ~USE_UPDATE;
+            UpdateEventSubscription();
             return;
         }
     }
     
     // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
-}
-
-void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace ScenePostUpdate;
-    
-    // Execute user-defined post-update function
-    PostUpdate(eventData[P_TIMESTEP].GetFloat());
-}
-
-#ifdef URHO3D_PHYSICS
-void LogicComponent::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData)
-{
-    using namespace PhysicsPreStep;
-    
-    // Execute user-defined fixed update function
-    FixedUpdate(eventData[P_TIMESTEP].GetFloat());
-}
-
-void LogicComponent::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
-{
-    using namespace PhysicsPostStep;
-    
-    // Execute user-defined fixed post-update function
-    FixedPostUpdate(eventData[P_TIMESTEP].GetFloat());
+    Update(timeStep);
 }
-#endif
 
 }
@@ -36,17 +36,19 @@ static const unsigned char USE_FIXEDUPDATE = 0x4;
 /// Bitmask for using the physics post-update event.
 static const unsigned char USE_FIXEDPOSTUPDATE = 0x8;
 
-/// Helper base class for user-defined game logic components that hooks up to update events and forwards them to virtual functions similar to ScriptInstance class.
+/// Helper base class for user-defined game logic components that receives update calls from the scene and forwards them to virtual functions similar to ScriptInstance class. The scene calls the components grouped by type without event dispatch.
 class URHO3D_API LogicComponent : public Component
 {
     OBJECT(LogicComponent);
     
+    friend class Scene;
+    
     /// Construct.
     LogicComponent(Context* context);
     /// Destruct.
     virtual ~LogicComponent();
     
-    /// Handle enabled/disabled state change. Changes update event subscription.
+    /// Handle enabled/disabled state change. Changes update registration.
     virtual void OnSetEnabled();
     /// Called when the component is added to a scene node. Other components may not yet exist.
     virtual void Start() {}
@@ -63,10 +65,10 @@ class URHO3D_API LogicComponent : public Component
     /// Called on physics post-update, fixed timestep.
     virtual void FixedPostUpdate(float timeStep);
     
-    /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
+    /// Set what update phases should be called. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(unsigned char mask);
     
-    /// Return what update events are subscribed to.
+    /// Return what update phases are called.
     unsigned char GetUpdateEventMask() const { return updateEventMask_; }
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
@@ -74,26 +76,27 @@ class URHO3D_API LogicComponent : public Component
 protected:
     /// Handle scene node being assigned at creation.
     virtual void OnNodeSet(Node* node);
+    /// Handle the component being added to or removed from the scene.
+    virtual void OnSceneSet(Scene* scene);
     
 private:
-    /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
+    /// Register to or unregister from the scene update based on current enabled state and update event mask.
     void UpdateEventSubscription();
-    /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
-    /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
-#ifdef URHO3D_PHYSICS
-    /// Handle physics pre-step event.
-    void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
-    /// Handle physics post-step event.
-    void HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData);
-#endif
-    /// Requested event subscription mask.
+    /// Execute the delayed start if not yet done, then the update. Called by Scene.
+    void CallUpdate(float timeStep);
+    
+    /// Requested update phase mask.
     unsigned char updateEventMask_;
-    /// Current event subscription mask.
+    /// Current update phase mask.
     unsigned char currentEventMask_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Scene the component is registered to for updates.
+    Scene* updateScene_;
+    /// Index of the scene's update group of the component type. Stored so that removal does not depend on the virtual type.
+    unsigned updateGroup_;
+    /// Index within the scene's update group of the component type.
+    unsigned updateIndex_;
 };
 
 }
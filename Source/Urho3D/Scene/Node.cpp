@@ -38,6 +38,30 @@
 namespace Urho3D
 {
 
+/// Bulk binary format version.
+static const unsigned BULK_FORMAT_VERSION = 1;
+/// Bulk format component block layout: one column of values per attribute.
+static const unsigned BULK_LAYOUT_COLUMNS = 0;
+/// Bulk format component block layout: one serialized buffer per component, used when attributes are instance-specific.
+static const unsigned BULK_LAYOUT_ROWS = 1;
+/// Bits per component for the smallest three encoding of the network rotation.
+static const unsigned NET_ROTATION_BITS = 15;
+
+static unsigned GetNumFileAttributes(const Vector<AttributeInfo>* attributes)
+{
+    unsigned count = 0;
+    if (attributes)
+    {
+        for (unsigned i = 0; i < attributes->Size(); ++i)
+        {
+            if (attributes->At(i).mode_ & AM_FILE)
+                ++count;
+        }
+    }
+
+    return count;
+}
+
 Node::Node(Context* context) :
     Animatable(context),
     networkUpdate_(false),
@@ -77,8 +101,11 @@ void Node::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Scale", GetScale, SetScale, Vector3, Vector3::ONE, AM_DEFAULT);
     ATTRIBUTE("Variables", VariantMap, vars_, Variant::emptyVariantMap, AM_FILE); // Network replication of vars uses custom data
     ACCESSOR_ATTRIBUTE("Network Position", GetNetPositionAttr, SetNetPositionAttr, Vector3, Vector3::ZERO, AM_NET | AM_LATESTDATA | AM_NOEDIT);
-    ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_NET | AM_LATESTDATA | AM_NOEDIT);
+    ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, Quaternion, Quaternion::IDENTITY, AM_NET | AM_LATESTDATA | AM_NOEDIT);
     ACCESSOR_ATTRIBUTE("Network Parent Node", GetNetParentAttr, SetNetParentAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_NET | AM_NOEDIT);
+
+    // Send the rotation in the smallest three format, which has about the precision of a 16-bit packed quaternion in fewer bytes
+    context->SetAttributeNetworkEncoding<Node>("Network Rotation", AttributeEncoding(NET_ROTATION_BITS));
 }
 
 bool Node::Load(Deserializer& source, bool setInstanceDefault)
@@ -223,6 +250,12 @@ void Node::AddReplicationState(NodeReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Node::RemoveReplicationState(NodeReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 bool Node::SaveXML(Serializer& dest, const String& indentation) const
 {
     SharedPtr<XMLFile> xml(new XMLFile(context_));
@@ -233,12 +266,171 @@ bool Node::SaveXML(Serializer& dest, const String& indentation) const
     return xml->Save(dest, indentation);
 }
 
+bool Node::LoadBulk(Deserializer& source)
+{
+    SceneResolver resolver;
+
+    // Read attributes, components and child nodes
+    bool success = LoadBulk(source, resolver);
+    if (success)
+    {
+        resolver.Resolve();
+        ApplyAttributes();
+    }
+
+    return success;
+}
+
+bool Node::SaveBulk(Serializer& dest) const
+{
+    // Flatten the persistent node hierarchy. Index 0 is this node, and each node is stored after its parent
+    PODVector<const Node*> nodes;
+    PODVector<unsigned> parents;
+    nodes.Push(this);
+    parents.Push(0);
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        const Vector<SharedPtr<Node> >& children = nodes[i]->children_;
+        for (unsigned j = 0; j < children.Size(); ++j)
+        {
+            if (children[j]->IsTemporary())
+                continue;
+            nodes.Push(children[j]);
+            parents.Push(i);
+        }
+    }
+
+    // Collect the persistent components and their distinct types
+    PODVector<Component*> components;
+    PODVector<unsigned> owners;
+    PODVector<unsigned> typeIndices;
+    Vector<StringHash> types;
+    Vector<PODVector<Component*> > typeComponents;
+    HashMap<StringHash, unsigned> typeLookup;
+    for (unsigned i = 0; i < nodes.Size(); ++i)
+    {
+        const Vector<SharedPtr<Component> >& nodeComponents = nodes[i]->components_;
+        for (unsigned j = 0; j < nodeComponents.Size(); ++j)
+        {
+            Component* component = nodeComponents[j];
+            if (component->IsTemporary())
+                continue;
+
+            HashMap<StringHash, unsigned>::ConstIterator k = typeLookup.Find(component->GetType());
+            if (k == typeLookup.End())
+            {
+                k = typeLookup.Insert(MakePair(component->GetType(), types.Size()));
+                types.Push(component->GetType());
+                typeComponents.Resize(types.Size());
+            }
+
+            typeComponents[k->second_].Push(component);
+            components.Push(component);
+            owners.Push(i);
+            typeIndices.Push(k->second_);
+        }
+    }
+
+    // Write version, own ID and attributes
+    dest.WriteVLE(BULK_FORMAT_VERSION);
+    dest.WriteUInt(id_);
+    if (!Animatable::Save(dest))
+        return false;
+
+    // Write the node table, then the node attributes as one column per attribute
+    dest.WriteVLE(nodes.Size() - 1);
+    for (unsigned i = 1; i < nodes.Size(); ++i)
+    {
+        dest.WriteUInt(nodes[i]->id_);
+        dest.WriteVLE(parents[i]);
+    }
+
+    const Vector<AttributeInfo>* nodeAttributes = context_->GetAttributes(Node::GetTypeStatic());
+    dest.WriteVLE(GetNumFileAttributes(nodeAttributes));
+    for (unsigned i = 0; i < nodeAttributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = nodeAttributes->At(i);
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+
+        for (unsigned j = 1; j < nodes.Size(); ++j)
+            nodes[j]->WriteAttributeData(attr, dest);
+    }
+
+    // Write the component table, so that components can be created in their original order
+    dest.WriteVLE(types.Size());
+    for (unsigned i = 0; i < types.Size(); ++i)
+        dest.WriteStringHash(types[i]);
+    dest.WriteVLE(components.Size());
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        dest.WriteVLE(typeIndices[i]);
+        dest.WriteVLE(owners[i]);
+        dest.WriteUInt(components[i]->GetID());
+    }
+
+    // Write the attributes of each component type as a separate block, so that unknown types can be skipped
+    for (unsigned i = 0; i < types.Size(); ++i)
+    {
+        const PODVector<Component*>& instances = typeComponents[i];
+
+        // Use columns only if all instances share the type's registered attributes
+        const Vector<AttributeInfo>* attributes = context_->GetAttributes(types[i]);
+        bool useColumns = attributes != 0;
+        for (unsigned j = 0; j < instances.Size() && useColumns; ++j)
+        {
+            if (instances[j]->GetAttributes() != attributes)
+                useColumns = false;
+        }
+
+        VectorBuffer block;
+        if (useColumns)
+        {
+            block.WriteVLE(BULK_LAYOUT_COLUMNS);
+            block.WriteVLE(GetNumFileAttributes(attributes));
+            for (unsigned j = 0; j < attributes->Size(); ++j)
+            {
+                const AttributeInfo& attr = attributes->At(j);
+                if (!(attr.mode_ & AM_FILE))
+                    continue;
+
+                for (unsigned k = 0; k < instances.Size(); ++k)
+                    instances[k]->WriteAttributeData(attr, block);
+            }
+        }
+        else
+        {
+            block.WriteVLE(BULK_LAYOUT_ROWS);
+            for (unsigned j = 0; j < instances.Size(); ++j)
+            {
+                VectorBuffer compBuffer;
+                if (!instances[j]->Save(compBuffer))
+                    return false;
+                block.WriteVLE(compBuffer.GetSize());
+                block.Write(compBuffer.GetData(), compBuffer.GetSize());
+            }
+        }
+
+        dest.WriteVLE(block.GetSize());
+        if (dest.Write(block.GetData(), block.GetSize()) != block.GetSize())
+        {
+            LOGERROR("Could not save node, writing to stream failed");
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void Node::SetName(const String& name)
 {
     if (name != name_)
     {
+        StringHash oldNameHash = nameHash_;
         name_ = name;
         nameHash_ = name_;
+        if (scene_)
+            scene_->NodeRenamed(this, oldNameHash);
 
         MarkNetworkUpdate();
 
@@ -342,8 +534,11 @@ void Node::SetWorldScale(const Vector3& scale)
 
 void Node::SetWorldTransform(const Vector3& position, const Quaternion& rotation)
 {
-    SetWorldPosition(position);
-    SetWorldRotation(rotation);
+    // Set both at once to dirty the node and its children only once
+    if (parent_ == scene_ || !parent_)
+        SetTransform(position, rotation);
+    else
+        SetTransform(parent_->GetWorldTransform().Inverse() * position, parent_->GetWorldRotation().Inverse() * rotation);
 }
 
 void Node::SetWorldTransform(const Vector3& position, const Quaternion& rotation, float scale)
@@ -540,10 +735,42 @@ void Node::SetOwner(Connection* owner)
 }
 
 void Node::MarkDirty()
+{
+    // If already dirty, the child nodes are dirty as well and the listeners have been notified
+    if (dirty_)
+        return;
+
+    // Inside a scene transform edit the listener notification is deferred until the edit ends
+    bool deferred = scene_ && scene_->MarkTransformDirty(this);
+
+    MarkDirtyRecursive(!deferred);
+}
+
+void Node::NotifyMarkedDirtyRecursive()
+{
+    NotifyListeners();
+
+    for (Vector<SharedPtr<Node> >::Iterator i = children_.Begin(); i != children_.End(); ++i)
+        (*i)->NotifyMarkedDirtyRecursive();
+}
+
+void Node::MarkDirtyRecursive(bool notify)
 {
     dirty_ = true;
 
     // Notify listener components first, then mark child nodes
+    if (notify)
+        NotifyListeners();
+
+    for (Vector<SharedPtr<Node> >::Iterator i = children_.Begin(); i != children_.End(); ++i)
+    {
+        if (!(*i)->dirty_)
+            (*i)->MarkDirtyRecursive(notify);
+    }
+}
+
+void Node::NotifyListeners()
+{
     for (Vector<WeakPtr<Component> >::Iterator i = listeners_.Begin(); i != listeners_.End();)
     {
         if (*i)
@@ -555,9 +782,6 @@ void Node::MarkDirty()
         else
             i = listeners_.Erase(i);
     }
-
-    for (Vector<SharedPtr<Node> >::Iterator i = children_.Begin(); i != children_.End(); ++i)
-        (*i)->MarkDirty();
 }
 
 Node* Node::CreateChild(const String& name, CreateMode mode, unsigned id)
@@ -1087,14 +1311,13 @@ void Node::SetNetPositionAttr(const Vector3& value)
         SetPosition(value);
 }
 
-void Node::SetNetRotationAttr(const PODVector<unsigned char>& value)
+void Node::SetNetRotationAttr(const Quaternion& value)
 {
-    MemoryBuffer buf(value);
     SmoothedTransform* transform = GetComponent<SmoothedTransform>();
     if (transform)
-        transform->SetTargetRotation(buf.ReadPackedQuaternion());
+        transform->SetTargetRotation(value);
     else
-        SetRotation(buf.ReadPackedQuaternion());
+        SetRotation(value);
 }
 
 void Node::SetNetParentAttr(const PODVector<unsigned char>& value)
@@ -1139,11 +1362,9 @@ const Vector3& Node::GetNetPositionAttr() const
     return position_;
 }
 
-const PODVector<unsigned char>& Node::GetNetRotationAttr() const
+const Quaternion& Node::GetNetRotationAttr() const
 {
-    attrBuffer_.Clear();
-    attrBuffer_.WritePackedQuaternion(rotation_);
-    return attrBuffer_.GetBuffer();
+    return rotation_;
 }
 
 const PODVector<unsigned char>& Node::GetNetParentAttr() const
@@ -1217,6 +1438,140 @@ bool Node::Load(Deserializer& source, SceneResolver& resolver, bool readChildren
     return true;
 }
 
+bool Node::LoadBulk(Deserializer& source, SceneResolver& resolver, bool rewriteIDs, CreateMode mode)
+{
+    // Remove all children and components first in case this is not a fresh load
+    RemoveAllChildren();
+    RemoveAllComponents();
+
+    unsigned version = source.ReadVLE();
+    if (version != BULK_FORMAT_VERSION)
+    {
+        LOGERROR("Unsupported bulk format version " + String(version) + " in " + source.GetName());
+        return false;
+    }
+
+    // Store own old ID for resolving possible references
+    resolver.AddNode(source.ReadUInt(), this);
+    if (!Animatable::Load(source))
+        return false;
+
+    // Create the whole node hierarchy first
+    unsigned numNodes = source.ReadVLE() + 1;
+    PODVector<Node*> nodes(numNodes);
+    nodes[0] = this;
+    for (unsigned i = 1; i < numNodes; ++i)
+    {
+        unsigned nodeID = source.ReadUInt();
+        unsigned parentIndex = source.ReadVLE();
+        if (parentIndex >= i || source.IsEof())
+        {
+            LOGERROR("Corrupt node table in bulk data " + source.GetName());
+            return false;
+        }
+
+        Node* newNode = nodes[parentIndex]->CreateChild(rewriteIDs ? 0 : nodeID, (mode == REPLICATED && nodeID < FIRST_LOCAL_ID) ?
+            REPLICATED : LOCAL);
+        resolver.AddNode(nodeID, newNode);
+        nodes[i] = newNode;
+    }
+
+    const Vector<AttributeInfo>* nodeAttributes = context_->GetAttributes(Node::GetTypeStatic());
+    if (source.ReadVLE() != GetNumFileAttributes(nodeAttributes))
+    {
+        LOGERROR("Node attributes in bulk data " + source.GetName() + " do not match the registered attributes");
+        return false;
+    }
+
+    for (unsigned i = 0; i < nodeAttributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = nodeAttributes->At(i);
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+
+        for (unsigned j = 1; j < numNodes; ++j)
+            nodes[j]->OnSetAttribute(attr, source.ReadVariant(attr.type_));
+    }
+
+    // Create the components in their original order, grouped by type for setting the attributes
+    unsigned numTypes = source.ReadVLE();
+    Vector<StringHash> types(numTypes);
+    for (unsigned i = 0; i < numTypes; ++i)
+        types[i] = source.ReadStringHash();
+
+    Vector<PODVector<Component*> > typeComponents(numTypes);
+    unsigned numComponents = source.ReadVLE();
+    for (unsigned i = 0; i < numComponents; ++i)
+    {
+        unsigned typeIndex = source.ReadVLE();
+        unsigned ownerIndex = source.ReadVLE();
+        unsigned compID = source.ReadUInt();
+        if (typeIndex >= numTypes || ownerIndex >= numNodes)
+        {
+            LOGERROR("Corrupt component table in bulk data " + source.GetName());
+            return false;
+        }
+
+        Component* newComponent = nodes[ownerIndex]->SafeCreateComponent(String::EMPTY, types[typeIndex],
+            (mode == REPLICATED && compID < FIRST_LOCAL_ID) ? REPLICATED : LOCAL, rewriteIDs ? 0 : compID);
+        if (newComponent)
+            resolver.AddComponent(compID, newComponent);
+        typeComponents[typeIndex].Push(newComponent);
+    }
+
+    for (unsigned i = 0; i < numTypes; ++i)
+    {
+        if (source.IsEof())
+        {
+            LOGERROR("Unexpected end of bulk data " + source.GetName());
+            return false;
+        }
+
+        VectorBuffer block(source, source.ReadVLE());
+        const PODVector<Component*>& instances = typeComponents[i];
+
+        if (block.ReadVLE() == BULK_LAYOUT_COLUMNS)
+        {
+            // Do not abort if the attributes do not match, as the block is nested and we can skip to the next
+            const Vector<AttributeInfo>* attributes = context_->GetAttributes(types[i]);
+            if (!attributes || block.ReadVLE() != GetNumFileAttributes(attributes))
+            {
+                LOGWARNING("Attributes of component type " + types[i].ToString() + " in bulk data do not match the registered "
+                    "attributes, skipping");
+                continue;
+            }
+
+            for (unsigned j = 0; j < attributes->Size(); ++j)
+            {
+                const AttributeInfo& attr = attributes->At(j);
+                if (!(attr.mode_ & AM_FILE))
+                    continue;
+
+                for (unsigned k = 0; k < instances.Size(); ++k)
+                {
+                    Variant value = block.ReadVariant(attr.type_);
+                    if (instances[k])
+                        instances[k]->OnSetAttribute(attr, value);
+                }
+            }
+        }
+        else
+        {
+            for (unsigned j = 0; j < instances.Size(); ++j)
+            {
+                VectorBuffer compBuffer(block, block.ReadVLE());
+                // Skip type and ID, which are already known from the component table
+                compBuffer.ReadStringHash();
+                compBuffer.ReadUInt();
+                if (instances[j])
+                    instances[j]->Load(compBuffer);
+            }
+        }
+    }
+
+    return true;
+}
+
 bool Node::LoadXML(const XMLElement& source, SceneResolver& resolver, bool readChildren, bool rewriteIDs, CreateMode mode)
 {
     // Remove all children and components first in case this is not a fresh load
@@ -1293,29 +1648,39 @@ void Node::PrepareNetworkUpdate()
     const Vector<AttributeInfo>* attributes = networkState_->attributes_;
     unsigned numAttributes = attributes->Size();
 
+    // With dirty tracking only the marked attributes need to be compared, except on the first update
+    bool checkAll = !networkDirtyTracking_;
     if (networkState_->currentValues_.Size() != numAttributes)
     {
+        checkAll = true;
         networkState_->currentValues_.Resize(numAttributes);
         networkState_->previousValues_.Resize(numAttributes);
 
-        // Copy the default attribute values to the previous state as a starting point
+        // Copy the default attribute values to the current and previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            networkState_->currentValues_[i] = attributes->At(i).defaultValue_;
             networkState_->previousValues_[i] = attributes->At(i).defaultValue_;
+        }
     }
 
     // Check for attribute changes
+    DirtyBits changedBits;
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
 
+        if (!checkAll && !networkState_->markedAttributes_.IsSet(i))
+            continue;
         if (animationEnabled_ && IsAnimatedNetworkAttribute(attr))
             continue;
 
-        OnGetAttribute(attr, networkState_->currentValues_[i]);
-
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        // Compare in the attribute's native type first, so that unchanged attributes are not copied into the current values
+        if (!IsAttributeEqual(attr, networkState_->previousValues_[i]))
         {
+            OnGetAttribute(attr, networkState_->currentValues_[i]);
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            changedBits.Set(i);
 
             // Mark the attribute dirty in all replication states that are tracking this node
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin(); j !=
@@ -1335,6 +1700,12 @@ void Node::PrepareNetworkUpdate()
         }
     }
 
+    networkState_->markedAttributes_.ClearAll();
+
+    // Encode the changes once for all connections
+    if (changedBits.Count())
+        EncodeNetworkUpdate(changedBits);
+
     // Finally check for user var changes
     for (VariantMap::ConstIterator i = vars_.Begin(); i != vars_.End(); ++i)
     {
@@ -1490,14 +1861,16 @@ void Node::SetTransformSilent(const Vector3& position, const Quaternion& rotatio
 
 void Node::OnAttributeAnimationAdded()
 {
-    if (attributeAnimationInfos_.Size() == 1)
-        SubscribeToEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE, HANDLER(Node, HandleAttributeAnimationUpdate));
+    Scene* scene = GetScene();
+    if (attributeAnimationInfos_.Size() == 1 && scene)
+        scene->AddAnimatedObject(this);
 }
 
 void Node::OnAttributeAnimationRemoved()
 {
-    if (attributeAnimationInfos_.Empty())
-        UnsubscribeFromEvent(GetScene(), E_ATTRIBUTEANIMATIONUPDATE);
+    Scene* scene = GetScene();
+    if (attributeAnimationInfos_.Empty() && scene)
+        scene->RemoveAnimatedObject(this);
 }
 
 void Node::SetObjectAttributeAnimation(const String& name, ValueAnimation* attributeAnimation, WrapMode wrapMode, float speed)
@@ -1807,11 +2180,4 @@ void Node::RemoveComponent(Vector<SharedPtr<Component> >::Iterator i)
     components_.Erase(i);
 }
 
-void Node::HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace AttributeAnimationUpdate;
-
-    UpdateAttributeAnimations(eventData[P_TIMESTEP].GetFloat());
-}
-
 }
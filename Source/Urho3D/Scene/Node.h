@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Core/ObjectPool.h"
 #include "../Math/Matrix3x4.h"
 #include "../Scene/Animatable.h"
 #include "../IO/VectorBuffer.h"
@@ -56,6 +57,7 @@ class URHO3D_API Node : public Animatable
 {
     OBJECT(Node);
     BASEOBJECT(Node);
+    POOLED_OBJECT();
 
     friend class Connection;
 
@@ -83,9 +85,15 @@ public:
     virtual void MarkNetworkUpdate();
     /// Add a replication state that is tracking this node.
     virtual void AddReplicationState(NodeReplicationState* state);
+    /// Remove a replication state that is no longer tracking this node.
+    void RemoveReplicationState(NodeReplicationState* state);
 
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
+    /// Load from the bulk binary format. Removes all existing child nodes and components first. Return true if successful.
+    bool LoadBulk(Deserializer& source);
+    /// Save to the bulk binary format, which stores the node hierarchy as a flat table and component attributes in per-type columns for faster loading. Return true if successful.
+    bool SaveBulk(Serializer& dest) const;
     /// Set name of the scene node. Names are not required to be unique.
     void SetName(const String& name);
     /// Set position in parent space. If the scene node is on the root level (is child of the scene itself), this is same as world space.
@@ -190,6 +198,8 @@ public:
     void SetOwner(Connection* owner);
     /// Mark node and child nodes to need world transform recalculation. Notify listener components.
     void MarkDirty();
+    /// Notify listener components of this node and child nodes of a deferred transform change. Called by Scene when a transform edit ends.
+    void NotifyMarkedDirtyRecursive();
     /// Create a child scene node (with specified ID if provided).
     Node* CreateChild(const String& name = String::EMPTY, CreateMode mode = REPLICATED, unsigned id = 0);
     /// Add a child scene node at a specific index. If index is not explicitly specified or is greater than current children size, append the new child at the end.
@@ -426,19 +436,21 @@ public:
     /// Set network position attribute.
     void SetNetPositionAttr(const Vector3& value);
     /// Set network rotation attribute.
-    void SetNetRotationAttr(const PODVector<unsigned char>& value);
+    void SetNetRotationAttr(const Quaternion& value);
     /// Set network parent attribute.
     void SetNetParentAttr(const PODVector<unsigned char>& value);
     /// Return network position attribute.
     const Vector3& GetNetPositionAttr() const;
     /// Return network rotation attribute.
-    const PODVector<unsigned char>& GetNetRotationAttr() const;
+    const Quaternion& GetNetRotationAttr() const;
     /// Return network parent attribute.
     const PODVector<unsigned char>& GetNetParentAttr() const;
     /// Load components and optionally load child nodes.
     bool Load(Deserializer& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false, CreateMode mode = REPLICATED);
     /// Load components from XML data and optionally load child nodes.
     bool LoadXML(const XMLElement& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false, CreateMode mode = REPLICATED);
+    /// Load own attributes, child nodes and components from the bulk binary format.
+    bool LoadBulk(Deserializer& source, SceneResolver& resolver, bool rewriteIDs = false, CreateMode mode = REPLICATED);
     /// Return the depended on nodes to order network updates.
     const PODVector<Node*>& GetDependencyNodes() const { return dependencyNodes_; }
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
@@ -484,6 +496,10 @@ private:
     Component* SafeCreateComponent(const String& typeName, StringHash type, CreateMode mode, unsigned id);
     /// Recalculate the world transform.
     void UpdateWorldTransform() const;
+    /// Mark this node and its non-dirty child nodes dirty and optionally notify listener components.
+    void MarkDirtyRecursive(bool notify);
+    /// Notify listener components that the transform has changed.
+    void NotifyListeners();
     /// Remove child node by iterator.
     void RemoveChild(Vector<SharedPtr<Node> >::Iterator i);
     /// Return child nodes recursively.
@@ -496,8 +512,6 @@ private:
     Node* CloneRecursive(Node* parent, SceneResolver& resolver, CreateMode mode);
     /// Remove a component from this node with the specified iterator.
     void RemoveComponent(Vector<SharedPtr<Component> >::Iterator i);
-    /// Handle attribute animation update event.
-    void HandleAttributeAnimationUpdate(StringHash eventType, VariantMap& eventData);
 
     /// World-space transform matrix.
     mutable Matrix3x4 worldTransform_;
@@ -0,0 +1,531 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/VectorBuffer.h"
+#include "../Core/Profiler.h"
+#include "../Scene/Component.h"
+#include "../Scene/Prefab.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+#include "../Resource/XMLFile.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Parse the attributes of an XML node or component element. Return false if some attribute did not match the attribute descriptions.
+static bool CompileAttributesXML(const XMLElement& source, const Vector<AttributeInfo>* attributes, Vector<PrefabAttribute>& dest)
+{
+    if (!attributes)
+        return !source.GetChild("attribute");
+
+    bool allFound = true;
+    XMLElement attrElem = source.GetChild("attribute");
+    unsigned startIndex = 0;
+
+    while (attrElem)
+    {
+        String name = attrElem.GetAttribute("name");
+        unsigned i = startIndex;
+        unsigned attempts = attributes->Size();
+
+        while (attempts)
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if ((attr.mode_ & AM_FILE) && !attr.name_.Compare(name, true))
+            {
+                Variant varValue;
+
+                // If enums specified, do enum lookup and int assignment. Otherwise assign the variant directly
+                if (attr.enumNames_)
+                {
+                    String value = attrElem.GetAttribute("value");
+                    int enumValue = 0;
+                    const char** enumPtr = attr.enumNames_;
+                    while (*enumPtr && value.Compare(*enumPtr, false))
+                    {
+                        ++enumPtr;
+                        ++enumValue;
+                    }
+                    if (*enumPtr)
+                        varValue = enumValue;
+                    else
+                        LOGWARNING("Unknown enum value " + value + " in attribute " + attr.name_);
+                }
+                else
+                    varValue = attrElem.GetVariantValue(attr.type_);
+
+                if (!varValue.IsEmpty())
+                    dest.Push(PrefabAttribute(i, varValue));
+
+                startIndex = (i + 1) % attributes->Size();
+                break;
+            }
+            else
+            {
+                i = (i + 1) % attributes->Size();
+                --attempts;
+            }
+        }
+
+        if (!attempts)
+            allFound = false;
+
+        attrElem = attrElem.GetNext("attribute");
+    }
+
+    return allFound;
+}
+
+/// Return whether an XML element has attribute animations.
+static bool HasAnimationsXML(const XMLElement& source)
+{
+    return source.GetChild("objectanimation") || source.GetChild("attributeanimation");
+}
+
+Prefab::Prefab(Context* context) :
+    Resource(context),
+    useResolver_(false)
+{
+}
+
+Prefab::~Prefab()
+{
+}
+
+void Prefab::RegisterObject(Context* context)
+{
+    context->RegisterFactory<Prefab>();
+}
+
+bool Prefab::BeginLoad(Deserializer& source)
+{
+    if (GetExtension(source.GetName()) == ".xml")
+    {
+        SharedPtr<XMLFile> xml(new XMLFile(context_));
+        if (!xml->Load(source))
+            return false;
+        return Compile(xml);
+    }
+    else
+    {
+        // Read the whole file into memory first, as compiling reads it in small pieces
+        VectorBuffer buffer(source, source.GetSize());
+        return Compile(buffer);
+    }
+}
+
+bool Prefab::Compile(Deserializer& source)
+{
+    Reset();
+
+    bool success = CompileNode(source, 0);
+    ResolveIDReferences();
+    if (!success)
+        Reset();
+    return success;
+}
+
+bool Prefab::Compile(XMLFile* source)
+{
+    Reset();
+
+    if (!source)
+    {
+        LOGERROR("Null XML file for compiling prefab");
+        return false;
+    }
+
+    XMLElement rootElem = source->GetRoot();
+    if (!rootElem)
+    {
+        LOGERROR("No root element in " + source->GetName());
+        return false;
+    }
+
+    xmlFile_ = source;
+    bool success = CompileNodeXML(rootElem, 0);
+    ResolveIDReferences();
+    if (!success)
+        Reset();
+    return success;
+}
+
+Node* Prefab::Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    if (!parent)
+    {
+        LOGERROR("Null parent for instantiating prefab");
+        return 0;
+    }
+    if (nodes_.Empty())
+    {
+        LOGERROR("Prefab " + GetName() + " is not compiled");
+        return 0;
+    }
+
+    PROFILE(InstantiatePrefab);
+
+    SceneResolver resolver;
+    const Vector<AttributeInfo>* nodeAttributes = context_->GetAttributes(Node::GetTypeStatic());
+
+    // Create the nodes. Each node comes after its parent, so the parent has always been created already
+    instanceNodes_.Resize(nodes_.Size());
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        const PrefabNode& prefabNode = nodes_[i];
+        Node* node;
+        if (i)
+        {
+            node = instanceNodes_[prefabNode.parentIndex_]->CreateChild(0, (mode == REPLICATED && prefabNode.id_ <
+                FIRST_LOCAL_ID) ? REPLICATED : LOCAL);
+        }
+        else
+            node = parent->CreateChild(0, mode);
+
+        if (prefabNode.element_)
+            node->Animatable::LoadXML(prefabNode.element_);
+        else
+        {
+            for (unsigned j = 0; j < prefabNode.attributes_.Size(); ++j)
+                node->OnSetAttribute(nodeAttributes->At(prefabNode.attributes_[j].index_), prefabNode.attributes_[j].value_);
+        }
+
+        instanceNodes_[i] = node;
+        if (useResolver_)
+            resolver.AddNode(prefabNode.id_, node);
+    }
+
+    // Create the components
+    instanceComponents_.Resize(components_.Size());
+    for (unsigned i = 0; i < components_.Size(); ++i)
+    {
+        const PrefabComponent& prefabComponent = components_[i];
+        Node* node = instanceNodes_[prefabComponent.nodeIndex_];
+        // Do not create replicated components to local nodes, as that may lead to component ID overwrite
+        CreateMode componentMode = (mode == REPLICATED && prefabComponent.id_ < FIRST_LOCAL_ID && node->GetID() < FIRST_LOCAL_ID) ?
+            REPLICATED : LOCAL;
+        Component* component = node->CreateComponent(prefabComponent.type_, componentMode);
+        instanceComponents_[i] = component;
+        if (!component)
+            continue;
+
+        if (prefabComponent.data_.Size())
+        {
+            MemoryBuffer buffer(prefabComponent.data_);
+            // Skip type and ID
+            buffer.ReadStringHash();
+            buffer.ReadUInt();
+            component->Load(buffer);
+        }
+        else if (prefabComponent.element_)
+            component->LoadXML(prefabComponent.element_);
+        else
+        {
+            const Vector<AttributeInfo>* attributes = component->GetAttributes();
+            for (unsigned j = 0; j < prefabComponent.attributes_.Size(); ++j)
+                component->OnSetAttribute(attributes->At(prefabComponent.attributes_[j].index_), prefabComponent.attributes_[j].value_);
+        }
+
+        if (useResolver_)
+            resolver.AddComponent(prefabComponent.id_, component);
+    }
+
+    // Remap node and component ID attributes. These were resolved to indices when compiling, unless some components
+    // were loaded from their serialized data and may contain IDs that are not known in advance
+    if (useResolver_)
+        resolver.Resolve();
+    else
+    {
+        for (unsigned i = 0; i < idReferences_.Size(); ++i)
+        {
+            const PrefabIDReference& ref = idReferences_[i];
+            Component* component = instanceComponents_[ref.componentIndex_];
+            if (!component)
+                continue;
+
+            if (ref.mode_ & AM_NODEID)
+                component->SetAttribute(ref.attributeIndex_, Variant(instanceNodes_[ref.targets_[0]]->GetID()));
+            else if (ref.mode_ & AM_COMPONENTID)
+            {
+                Component* target = instanceComponents_[ref.targets_[0]];
+                if (target)
+                    component->SetAttribute(ref.attributeIndex_, Variant(target->GetID()));
+            }
+            else
+            {
+                // The first index stores the number of IDs redundantly. This is for editing
+                VariantVector newIDs;
+                newIDs.Push(ref.targets_.Size());
+                for (unsigned j = 0; j < ref.targets_.Size(); ++j)
+                    newIDs.Push(ref.targets_[j] != M_MAX_UNSIGNED ? instanceNodes_[ref.targets_[j]]->GetID() : 0);
+                component->SetAttribute(ref.attributeIndex_, newIDs);
+            }
+        }
+    }
+
+    Node* root = instanceNodes_[0];
+    instanceNodes_.Clear();
+    instanceComponents_.Clear();
+
+    root->ApplyAttributes();
+    root->SetTransform(position, rotation);
+    return root;
+}
+
+void Prefab::Reset()
+{
+    xmlFile_.Reset();
+    nodes_.Clear();
+    components_.Clear();
+    idReferences_.Clear();
+    nodeIndices_.Clear();
+    componentIndices_.Clear();
+    useResolver_ = false;
+    SetMemoryUse(0);
+}
+
+bool Prefab::CompileNode(Deserializer& source, unsigned parentIndex)
+{
+    if (source.IsEof())
+    {
+        LOGERROR("Unexpected end of node data in prefab " + GetName());
+        return false;
+    }
+
+    unsigned index = nodes_.Size();
+    nodes_.Resize(index + 1);
+    {
+        PrefabNode& node = nodes_[index];
+        node.id_ = source.ReadUInt();
+        node.parentIndex_ = parentIndex;
+        nodeIndices_[node.id_] = index;
+
+        const Vector<AttributeInfo>* attributes = context_->GetAttributes(Node::GetTypeStatic());
+        for (unsigned i = 0; i < attributes->Size(); ++i)
+        {
+            const AttributeInfo& attr = attributes->At(i);
+            if (attr.mode_ & AM_FILE)
+                node.attributes_.Push(PrefabAttribute(i, source.ReadVariant(attr.type_)));
+        }
+    }
+
+    unsigned numComponents = source.ReadVLE();
+    for (unsigned i = 0; i < numComponents; ++i)
+    {
+        VectorBuffer compBuffer(source, source.ReadVLE());
+        StringHash compType = compBuffer.ReadStringHash();
+        unsigned compID = compBuffer.ReadUInt();
+
+        if (context_->GetTypeName(compType).Empty())
+        {
+            LOGWARNING("Component type " + compType.ToString() + " not known, skipping in prefab " + GetName());
+            continue;
+        }
+
+        componentIndices_[compID] = components_.Size();
+        components_.Resize(components_.Size() + 1);
+        PrefabComponent& component = components_.Back();
+        component.type_ = compType;
+        component.id_ = compID;
+        component.nodeIndex_ = index;
+
+        const Vector<AttributeInfo>* attributes = context_->GetAttributes(compType);
+        if (attributes)
+        {
+            for (unsigned j = 0; j < attributes->Size() && !compBuffer.IsEof(); ++j)
+            {
+                const AttributeInfo& attr = attributes->At(j);
+                if (attr.mode_ & AM_FILE)
+                    component.attributes_.Push(PrefabAttribute(j, compBuffer.ReadVariant(attr.type_)));
+            }
+        }
+
+        // If data remains, the component has instance-specific attributes. Keep the serialized data to load on instantiation
+        if (!compBuffer.IsEof())
+        {
+            component.attributes_.Clear();
+            component.data_ = compBuffer.GetBuffer();
+            useResolver_ = true;
+        }
+    }
+
+    unsigned numChildren = source.ReadVLE();
+    for (unsigned i = 0; i < numChildren; ++i)
+    {
+        if (!CompileNode(source, index))
+            return false;
+    }
+
+    return true;
+}
+
+bool Prefab::CompileNodeXML(const XMLElement& source, unsigned parentIndex)
+{
+    unsigned index = nodes_.Size();
+    nodes_.Resize(index + 1);
+    {
+        PrefabNode& node = nodes_[index];
+        node.id_ = source.GetUInt("id");
+        node.parentIndex_ = parentIndex;
+        nodeIndices_[node.id_] = index;
+
+        if (HasAnimationsXML(source))
+            node.element_ = source;
+        else
+            CompileAttributesXML(source, context_->GetAttributes(Node::GetTypeStatic()), node.attributes_);
+    }
+
+    XMLElement compElem = source.GetChild("component");
+    while (compElem)
+    {
+        String typeName = compElem.GetAttribute("type");
+        StringHash compType(typeName);
+        unsigned compID = compElem.GetUInt("id");
+
+        if (context_->GetTypeName(compType).Empty())
+            LOGWARNING("Component type " + typeName + " not known, skipping in prefab " + GetName());
+        else
+        {
+            componentIndices_[compID] = components_.Size();
+            components_.Resize(components_.Size() + 1);
+            PrefabComponent& component = components_.Back();
+            component.type_ = compType;
+            component.id_ = compID;
+            component.nodeIndex_ = index;
+
+            // If some attribute is not found, the component has instance-specific attributes. Keep the element to load on instantiation
+            if (!CompileAttributesXML(compElem, context_->GetAttributes(compType), component.attributes_) ||
+                HasAnimationsXML(compElem))
+            {
+                component.attributes_.Clear();
+                component.element_ = compElem;
+                useResolver_ = true;
+            }
+        }
+
+        compElem = compElem.GetNext("component");
+    }
+
+    XMLElement childElem = source.GetChild("node");
+    while (childElem)
+    {
+        if (!CompileNodeXML(childElem, index))
+            return false;
+        childElem = childElem.GetNext("node");
+    }
+
+    return true;
+}
+
+void Prefab::ResolveIDReferences()
+{
+    unsigned memoryUse = sizeof(Prefab) + nodes_.Size() * sizeof(PrefabNode) + components_.Size() * sizeof(PrefabComponent);
+
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+        memoryUse += nodes_[i].attributes_.Size() * sizeof(PrefabAttribute);
+
+    for (unsigned i = 0; i < components_.Size(); ++i)
+    {
+        const PrefabComponent& component = components_[i];
+        memoryUse += component.attributes_.Size() * sizeof(PrefabAttribute) + component.data_.Size();
+
+        const Vector<AttributeInfo>* attributes = context_->GetAttributes(component.type_);
+        if (!attributes)
+            continue;
+
+        for (unsigned j = 0; j < component.attributes_.Size(); ++j)
+        {
+            const PrefabAttribute& attribute = component.attributes_[j];
+            const AttributeInfo& info = attributes->At(attribute.index_);
+
+            PrefabIDReference ref;
+            ref.componentIndex_ = i;
+            ref.attributeIndex_ = attribute.index_;
+            ref.mode_ = info.mode_;
+
+            if (info.mode_ & AM_NODEID)
+            {
+                unsigned oldNodeID = attribute.value_.GetUInt();
+                if (!oldNodeID)
+                    continue;
+
+                HashMap<unsigned, unsigned>::ConstIterator k = nodeIndices_.Find(oldNodeID);
+                if (k != nodeIndices_.End())
+                {
+                    ref.targets_.Push(k->second_);
+                    idReferences_.Push(ref);
+                }
+                else
+                    LOGWARNING("Could not resolve node ID " + String(oldNodeID));
+            }
+            else if (info.mode_ & AM_COMPONENTID)
+            {
+                unsigned oldComponentID = attribute.value_.GetUInt();
+                if (!oldComponentID)
+                    continue;
+
+                HashMap<unsigned, unsigned>::ConstIterator k = componentIndices_.Find(oldComponentID);
+                if (k != componentIndices_.End())
+                {
+                    ref.targets_.Push(k->second_);
+                    idReferences_.Push(ref);
+                }
+                else
+                    LOGWARNING("Could not resolve component ID " + String(oldComponentID));
+            }
+            else if (info.mode_ & AM_NODEIDVECTOR)
+            {
+                const VariantVector& oldNodeIDs = attribute.value_.GetVariantVector();
+                if (oldNodeIDs.Empty())
+                    continue;
+
+                for (unsigned k = 1; k < oldNodeIDs.Size(); ++k)
+                {
+                    unsigned oldNodeID = oldNodeIDs[k].GetUInt();
+                    HashMap<unsigned, unsigned>::ConstIterator l = nodeIndices_.Find(oldNodeID);
+                    if (l != nodeIndices_.End())
+                        ref.targets_.Push(l->second_);
+                    else
+                    {
+                        // If node was not found, retain number of elements, just store ID 0
+                        ref.targets_.Push(M_MAX_UNSIGNED);
+                        LOGWARNING("Could not resolve node ID " + String(oldNodeID));
+                    }
+                }
+                idReferences_.Push(ref);
+            }
+        }
+    }
+
+    // The ID mappings are only needed while compiling
+    nodeIndices_.Clear();
+    componentIndices_.Clear();
+    SetMemoryUse(memoryUse);
+}
+
+}
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Resource/Resource.h"
+#include "../Resource/XMLElement.h"
+#include "../Scene/Node.h"
+
+namespace Urho3D
+{
+
+class XMLFile;
+
+/// Attribute value of a compiled prefab node or component.
+struct PrefabAttribute
+{
+    /// Construct undefined.
+    PrefabAttribute() :
+        index_(0)
+    {
+    }
+
+    /// Construct with attribute index and value.
+    PrefabAttribute(unsigned index, const Variant& value) :
+        index_(index),
+        value_(value)
+    {
+    }
+
+    /// Index into the attribute descriptions of the object type.
+    unsigned index_;
+    /// Value.
+    Variant value_;
+};
+
+/// Compiled prefab node.
+struct PrefabNode
+{
+    /// Original ID, used to choose the replication mode.
+    unsigned id_;
+    /// Index of the parent node. The root node has itself as parent.
+    unsigned parentIndex_;
+    /// Attribute values.
+    Vector<PrefabAttribute> attributes_;
+    /// Source element if the node has attribute animations, which are then loaded from XML on instantiation.
+    XMLElement element_;
+};
+
+/// Compiled prefab component.
+struct PrefabComponent
+{
+    /// Component type.
+    StringHash type_;
+    /// Original ID, used to choose the replication mode.
+    unsigned id_;
+    /// Index of the owner node.
+    unsigned nodeIndex_;
+    /// Attribute values.
+    Vector<PrefabAttribute> attributes_;
+    /// Serialized binary data if the component has instance-specific attributes, which are then loaded on instantiation.
+    PODVector<unsigned char> data_;
+    /// Source element if the component has instance-specific attributes or attribute animations, which are then loaded on instantiation.
+    XMLElement element_;
+};
+
+/// Node or component ID attribute of a compiled prefab component, resolved to node or component indices.
+struct PrefabIDReference
+{
+    /// Index of the component holding the attribute.
+    unsigned componentIndex_;
+    /// Index into the attribute descriptions of the component type.
+    unsigned attributeIndex_;
+    /// Attribute mode, which tells whether the IDs refer to nodes or components and whether it is a vector.
+    unsigned mode_;
+    /// Indices of the referenced nodes or components. M_MAX_UNSIGNED if the reference could not be resolved.
+    PODVector<unsigned> targets_;
+};
+
+/// Node prefab compiled once from a binary or XML node file, for repeated fast instantiation without parsing or ID resolving.
+class URHO3D_API Prefab : public Resource
+{
+    OBJECT(Prefab);
+
+public:
+    /// Construct.
+    Prefab(Context* context);
+    /// Destruct.
+    virtual ~Prefab();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+
+    /// Compile from binary node data saved with Node::Save(). Return true if successful.
+    bool Compile(Deserializer& source);
+    /// Compile from the root node element of an XML file. Return true if successful.
+    bool Compile(XMLFile* source);
+    /// Instantiate as a child of the given node. Return the instance root node if successful.
+    Node* Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+
+    /// Return number of nodes including the root.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return number of components.
+    unsigned GetNumComponents() const { return components_.Size(); }
+    /// Return compiled nodes. The root node is first, and each node comes after its parent.
+    const Vector<PrefabNode>& GetNodes() const { return nodes_; }
+    /// Return compiled components.
+    const Vector<PrefabComponent>& GetComponents() const { return components_; }
+
+private:
+    /// Clear the compiled data.
+    void Reset();
+    /// Compile a binary node and its children recursively.
+    bool CompileNode(Deserializer& source, unsigned parentIndex);
+    /// Compile an XML node and its children recursively.
+    bool CompileNodeXML(const XMLElement& source, unsigned parentIndex);
+    /// Resolve node and component ID attributes to indices after compiling.
+    void ResolveIDReferences();
+
+    /// Source XML file, kept alive for nodes and components that are loaded from XML on instantiation.
+    SharedPtr<XMLFile> xmlFile_;
+    /// Compiled nodes.
+    Vector<PrefabNode> nodes_;
+    /// Compiled components.
+    Vector<PrefabComponent> components_;
+    /// ID attributes to remap on instantiation.
+    Vector<PrefabIDReference> idReferences_;
+    /// Original node IDs to node indices, used while compiling.
+    HashMap<unsigned, unsigned> nodeIndices_;
+    /// Original component IDs to component indices, used while compiling.
+    HashMap<unsigned, unsigned> componentIndices_;
+    /// Whether instantiation needs a SceneResolver, because some components are loaded from their serialized data.
+    bool useResolver_;
+    /// Nodes of the instance being created, reused to avoid allocation.
+    PODVector<Node*> instanceNodes_;
+    /// Components of the instance being created, reused to avoid allocation.
+    PODVector<Component*> instanceComponents_;
+};
+
+}
@@ -26,6 +26,7 @@
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
 #include "../Container/Ptr.h"
+#include "../IO/VectorBuffer.h"
 #include "../Math/StringHash.h"
 
 #include <cstring>
@@ -112,6 +113,11 @@ struct URHO3D_API DirtyBits
             return false;
     }
     
+    /// Test for equality with another set of bits.
+    bool operator == (const DirtyBits& rhs) const { return count_ == rhs.count_ && !memcmp(data_, rhs.data_, MAX_NETWORK_ATTRIBUTES / 8); }
+    /// Test for inequality with another set of bits.
+    bool operator != (const DirtyBits& rhs) const { return !(*this == rhs); }
+    
     /// Return number of set bits.
     unsigned Count() const { return count_; }
     
@@ -140,6 +146,14 @@ struct URHO3D_API NetworkState
     PODVector<ReplicationState*> replicationStates_;
     /// Previous user variables.
     VariantMap previousVars_;
+    /// Attributes marked changed when network dirty tracking is enabled.
+    DirtyBits markedAttributes_;
+    /// Attributes included in the shared delta update data.
+    DirtyBits deltaBits_;
+    /// Delta update data of the last changed attributes without the timestamp, encoded once for all connections.
+    VectorBuffer deltaData_;
+    /// Latest data update data without the timestamp, encoded once for all connections.
+    VectorBuffer latestData_;
     /// Bitmask for intercepting network messages. Used on the client only.
     unsigned long long interceptMask_;
 };
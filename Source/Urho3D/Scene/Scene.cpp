@@ -23,18 +23,27 @@
 #include "../Scene/Component.h"
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
+#include "../IO/Compression.h"
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Scene/LogicComponent.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Core/MemoryTracker.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../IO/PackageFile.h"
+#include "../Scene/Prefab.h"
 #include "../Core/Profiler.h"
 #include "../Scene/ReplicationState.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
+#include "../Scene/SceneStreamer.h"
 #include "../Scene/SmoothedTransform.h"
+#include "../Container/Sort.h"
 #include "../Scene/SplinePath.h"
+#include "../Core/Timer.h"
 #include "../Scene/UnknownComponent.h"
 #include "../Scene/ValueAnimation.h"
 #include "../Core/WorkQueue.h"
@@ -51,6 +60,145 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+/// Network clock error in seconds above which the client snaps to the newest server time.
+static const float MAX_NETWORK_CLOCK_ERROR = 0.5f;
+/// Network clock correction rate per second towards the newest server time.
+static const float NETWORK_CLOCK_CORRECTION = 2.0f;
+/// Identifier at the end of a binary scene file with a resource manifest.
+static const char* MANIFEST_ID = "URMF";
+/// Identifier of a save file written by Scene::SaveAsync().
+static const char* SAVE_ID = "USSV";
+
+AsyncSaveState::AsyncSaveState() :
+    context_(0),
+    savedNodes_(0),
+    incremental_(false),
+    hasSavedHashes_(false),
+    success_(false)
+{
+}
+
+static unsigned HashSaveNode(const AsyncSaveNode& node, const unsigned char* data)
+{
+    // Include the parent ID so that a reparented node is saved even if its own data did not change
+    unsigned hash = node.parentID_;
+    for (unsigned i = 0; i < node.size_; ++i)
+        hash = SDBMHash(hash, data[node.offset_ + i]);
+    return hash;
+}
+
+static void AsyncSaveWork(const WorkItem* item, unsigned threadIndex)
+{
+    AsyncSaveState& state = *reinterpret_cast<AsyncSaveState*>(item->aux_);
+    const unsigned char* data = state.data_.GetData();
+    bool incremental = state.incremental_ && state.hasSavedHashes_;
+    
+    // Compare the content hashes to the previous save to find the changed nodes
+    PODVector<unsigned> savedNodes;
+    state.newHashes_.Clear();
+    for (unsigned i = 0; i < state.nodes_.Size(); ++i)
+    {
+        const AsyncSaveNode& node = state.nodes_[i];
+        unsigned hash = HashSaveNode(node, data);
+        state.newHashes_[node.id_] = hash;
+        
+        if (incremental)
+        {
+            HashMap<unsigned, unsigned>::ConstIterator j = state.savedHashes_.Find(node.id_);
+            if (j != state.savedHashes_.End() && j->second_ == hash)
+                continue;
+        }
+        savedNodes.Push(i);
+    }
+    
+    VectorBuffer payload;
+    if (incremental)
+    {
+        PODVector<unsigned> removedNodes;
+        for (HashMap<unsigned, unsigned>::ConstIterator i = state.savedHashes_.Begin(); i != state.savedHashes_.End(); ++i)
+        {
+            if (!state.newHashes_.Contains(i->first_))
+                removedNodes.Push(i->first_);
+        }
+        payload.WriteVLE(removedNodes.Size());
+        for (unsigned i = 0; i < removedNodes.Size(); ++i)
+            payload.WriteUInt(removedNodes[i]);
+    }
+    else
+        payload.WriteVLE(0);
+    
+    payload.WriteVLE(savedNodes.Size());
+    for (unsigned i = 0; i < savedNodes.Size(); ++i)
+    {
+        const AsyncSaveNode& node = state.nodes_[savedNodes[i]];
+        payload.WriteUInt(node.id_);
+        payload.WriteUInt(node.parentID_);
+        payload.WriteVLE(node.size_);
+        payload.Write(data + node.offset_, node.size_);
+    }
+    payload.Seek(0);
+    
+    // Write to a temporary file first, so that a failed save does not destroy the previous file
+    File file(state.context_, state.fileName_ + ".tmp", FILE_WRITE);
+    state.success_ = file.IsOpen() && file.WriteFileID(SAVE_ID) && file.WriteBool(incremental) && CompressStream(file, payload);
+    state.incremental_ = incremental;
+    state.savedNodes_ = savedNodes.Size();
+}
+
+static void AddManifestEntry(ResourceCache* cache, StringHash type, const String& name, Vector<ResourceRef>& dest, HashSet<StringHash>& added)
+{
+    String sanitatedName = cache->SanitateResourceName(name);
+    if (sanitatedName.Empty())
+        return;
+
+    StringHash nameHash(sanitatedName);
+    if (added.Contains(nameHash))
+        return;
+
+    added.Insert(nameHash);
+    dest.Push(ResourceRef(type, sanitatedName));
+}
+
+static void CollectResourceRefs(ResourceCache* cache, const Node* node, Vector<ResourceRef>& dest, HashSet<StringHash>& added)
+{
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        if (component->IsTemporary())
+            continue;
+
+        const Vector<AttributeInfo>* attributes = component->GetAttributes();
+        if (!attributes)
+            continue;
+
+        for (unsigned j = 0; j < attributes->Size(); ++j)
+        {
+            const AttributeInfo& attr = attributes->At(j);
+            if (!(attr.mode_ & AM_FILE))
+                continue;
+
+            if (attr.type_ == VAR_RESOURCEREF)
+            {
+                ResourceRef ref = component->GetAttribute(j).GetResourceRef();
+                AddManifestEntry(cache, ref.type_, ref.name_, dest, added);
+            }
+            else if (attr.type_ == VAR_RESOURCEREFLIST)
+            {
+                ResourceRefList refList = component->GetAttribute(j).GetResourceRefList();
+                for (unsigned k = 0; k < refList.names_.Size(); ++k)
+                    AddManifestEntry(cache, refList.type_, refList.names_[k], dest, added);
+            }
+        }
+    }
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        if (!children[i]->IsTemporary())
+            CollectResourceRefs(cache, children[i], dest, added);
+    }
+}
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -64,9 +212,22 @@ Scene::Scene(Context* context) :
     elapsedTime_(0),
     smoothingConstant_(DEFAULT_SMOOTHING_CONSTANT),
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
+    interpolationDelay_(0.0f),
+    networkTime_(0.0f),
+    snapshotTime_(0.0f),
+    latestSnapshotTime_(0.0f),
+    latestServerTime_(0),
+    hasSnapshots_(false),
+    inNetworkSnapshot_(false),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    asyncSaving_(false),
+    threadedUpdate_(false),
+    batchTransformUpdate_(false),
+    lookupIndexEnabled_(false),
+    transformEditDepth_(0),
+    logicUpdateDepth_(0),
+    logicComponentsDirty_(false)
 {
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
@@ -78,15 +239,26 @@ Scene::Scene(Context* context) :
 
 Scene::~Scene()
 {
+    // The save work item reads the captured state owned by the scene, so it must finish first
+    if (asyncSaving_)
+    {
+        WorkQueue* queue = GetSubsystem<WorkQueue>();
+        if (!queue || !queue->RemoveWorkItem(asyncSave_.workItem_))
+        {
+            while (!asyncSave_.workItem_->completed_)
+                Time::Sleep(1);
+        }
+    }
+    
     // Remove root-level components first, so that scene subsystems such as the octree destroy themselves. This will speed up
     // the removal of child nodes' components
     RemoveAllComponents();
     RemoveAllChildren();
 
     // Remove scene reference and owner from all nodes that still exist
-    for (HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         i->second_->ResetScene();
-    for (HashMap<unsigned, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
         i->second_->ResetScene();
 }
 
@@ -105,16 +277,20 @@ void Scene::RegisterObject(Context* context)
     ATTRIBUTE("Next Local Component ID", int, localComponentID_, FIRST_LOCAL_ID, AM_FILE | AM_NOEDIT);
     ATTRIBUTE("Variables", VariantMap, vars_, Variant::emptyVariantMap, AM_FILE); // Network replication of vars uses custom data
     MIXED_ACCESSOR_ATTRIBUTE("Variable Names", GetVarNamesAttr, SetVarNamesAttr, String, String::EMPTY, AM_FILE | AM_NOEDIT);
+    ACCESSOR_ATTRIBUTE("Interpolation Delay", GetInterpolationDelay, SetInterpolationDelay, float, 0.0f, AM_DEFAULT);
 }
 
 bool Scene::Load(Deserializer& source, bool setInstanceDefault)
 {
     PROFILE(LoadScene);
+    MEMORY_TAG(MEMTAG_SCENE);
 
     StopAsyncLoading();
 
     // Check ID
-    if (source.ReadFileID() != "USCN")
+    String fileID = source.ReadFileID();
+    bool bulk = fileID == "USCB";
+    if (fileID != "USCN" && !bulk)
     {
         LOGERROR(source.GetName() + " is not a valid scene file");
         return false;
@@ -125,7 +301,7 @@ bool Scene::Load(Deserializer& source, bool setInstanceDefault)
     Clear();
 
     // Load the whole scene, then perform post-load if successfully loaded
-    if (Node::Load(source, setInstanceDefault))
+    if (bulk ? Node::LoadBulk(source) : Node::Load(source, setInstanceDefault))
     {
         FinishLoading(&source);
         return true;
@@ -151,6 +327,32 @@ bool Scene::Save(Serializer& dest) const
 
     if (Node::Save(dest))
     {
+        SaveResourceManifest(dest);
+        FinishSaving(&dest);
+        return true;
+    }
+    else
+        return false;
+}
+
+bool Scene::SaveBulk(Serializer& dest) const
+{
+    PROFILE(SaveSceneBulk);
+
+    // Write ID first
+    if (!dest.WriteFileID("USCB"))
+    {
+        LOGERROR("Could not save scene, writing to stream failed");
+        return false;
+    }
+
+    Deserializer* ptr = dynamic_cast<Deserializer*>(&dest);
+    if (ptr)
+        LOGINFO("Saving scene to " + ptr->GetName());
+
+    if (Node::SaveBulk(dest))
+    {
+        SaveResourceManifest(dest);
         FinishSaving(&dest);
         return true;
     }
@@ -161,6 +363,7 @@ bool Scene::Save(Serializer& dest) const
 bool Scene::LoadXML(const XMLElement& source, bool setInstanceDefault)
 {
     PROFILE(LoadSceneXML);
+    MEMORY_TAG(MEMTAG_SCENE);
 
     StopAsyncLoading();
 
@@ -189,7 +392,7 @@ void Scene::AddReplicationState(NodeReplicationState* state)
     Node::AddReplicationState(state);
 
     // This is the first update for a new connection. Mark all replicated nodes dirty
-    for (HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         state->sceneState_->dirtyNodes_.Insert(i->first_);
 }
 
@@ -224,6 +427,7 @@ bool Scene::SaveXML(Serializer& dest, const String& indentation) const
     XMLElement rootElem = xml->CreateRoot("scene");
     if (!SaveXML(rootElem))
         return false;
+    SaveResourceManifestXML(rootElem);
 
     Deserializer* ptr = dynamic_cast<Deserializer*>(&dest);
     if (ptr)
@@ -249,7 +453,14 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
     StopAsyncLoading();
 
     // Check ID
-    bool isSceneFile = file->ReadFileID() == "USCN";
+    String fileID = file->ReadFileID();
+    if (fileID == "USCB")
+    {
+        LOGERROR(file->GetName() + " is a bulk format scene file, which can not be loaded asynchronously");
+        return false;
+    }
+
+    bool isSceneFile = fileID == "USCN";
     if (!isSceneFile)
     {
         // In resource load mode can load also object prefabs, which have no identifier
@@ -282,7 +493,8 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
             PROFILE(FindResourcesToPreload);
 
             unsigned currentPos = file->GetPosition();
-            PreloadResources(file, isSceneFile);
+            if (!isSceneFile || !PreloadResourceManifest(file))
+                PreloadResources(file, isSceneFile);
             file->Seek(currentPos);
         }
 
@@ -305,7 +517,8 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
         PROFILE(FindResourcesToPreload);
 
         LOGINFO("Preloading resources from " + file->GetName());
-        PreloadResources(file, isSceneFile);
+        if (!isSceneFile || !PreloadResourceManifest(file))
+            PreloadResources(file, isSceneFile);
     }
 
     return true;
@@ -347,7 +560,8 @@ bool Scene::LoadAsyncXML(File* file, LoadMode mode)
         {
             PROFILE(FindResourcesToPreload);
 
-            PreloadResourcesXML(rootElement);
+            PreloadResourcesXML(rootElement, asyncProgress_.resources_);
+            asyncProgress_.totalResources_ = asyncProgress_.resources_.Size();
         }
 
         // Store own old ID for resolving possible root node references
@@ -374,7 +588,8 @@ bool Scene::LoadAsyncXML(File* file, LoadMode mode)
         PROFILE(FindResourcesToPreload);
 
         LOGINFO("Preloading resources from " + file->GetName());
-        PreloadResourcesXML(xml->GetRoot());
+        PreloadResourcesXML(xml->GetRoot(), asyncProgress_.resources_);
+        asyncProgress_.totalResources_ = asyncProgress_.resources_.Size();
     }
 
     return true;
@@ -390,9 +605,152 @@ void Scene::StopAsyncLoading()
     resolver_.Reset();
 }
 
+bool Scene::SaveAsync(const String& fileName, bool incremental)
+{
+    PROFILE(SaveSceneAsync);
+    
+    if (asyncSaving_)
+    {
+        LOGWARNING("Asynchronous save of " + asyncSave_.fileName_ + " is still in progress, can not start another");
+        return false;
+    }
+    
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue)
+    {
+        LOGERROR("Can not save scene asynchronously without the work queue");
+        return false;
+    }
+    
+    LOGINFO("Saving scene asynchronously to " + fileName);
+    
+    // Serialize the nodes to memory now. Comparing to the previous save, compressing and writing happen in the work item
+    asyncSave_.context_ = context_;
+    asyncSave_.fileName_ = fileName;
+    asyncSave_.incremental_ = incremental;
+    asyncSave_.data_.Clear();
+    asyncSave_.nodes_.Clear();
+    CaptureAsyncSave(this, 0);
+    
+    WorkItem* item = new WorkItem();
+    item->workFunction_ = AsyncSaveWork;
+    item->aux_ = &asyncSave_;
+    item->priority_ = 0;
+    asyncSave_.workItem_ = item;
+    asyncSaving_ = true;
+    queue->AddWorkItem(asyncSave_.workItem_);
+    return true;
+}
+
+void Scene::CompleteAsyncSaving()
+{
+    if (!asyncSaving_)
+        return;
+    
+    // If no worker has started the save yet, write it in this thread
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (queue->RemoveWorkItem(asyncSave_.workItem_))
+        AsyncSaveWork(asyncSave_.workItem_, 0);
+    else
+    {
+        while (!asyncSave_.workItem_->completed_)
+            Time::Sleep(1);
+    }
+    
+    FinishAsyncSaving();
+}
+
+bool Scene::ApplySave(Deserializer& source)
+{
+    PROFILE(ApplySave);
+    MEMORY_TAG(MEMTAG_SCENE);
+    
+    if (source.ReadFileID() != SAVE_ID)
+    {
+        LOGERROR(source.GetName() + " is not a valid scene save file");
+        return false;
+    }
+    
+    bool incremental = source.ReadBool();
+    VectorBuffer payload;
+    if (!DecompressStream(payload, source))
+    {
+        LOGERROR("Could not decompress scene save file " + source.GetName());
+        return false;
+    }
+    payload.Seek(0);
+    
+    LOGINFO("Applying " + String(incremental ? "incremental" : "full") + " scene save " + source.GetName());
+    
+    // A full save replaces the scene content. Clear() also ends the comparison to the previous asynchronous save;
+    // for an incremental save it is ended explicitly, as the scene content changes
+    if (!incremental)
+        Clear();
+    else
+    {
+        StopAsyncLoading();
+        CompleteAsyncSaving();
+        asyncSave_.hasSavedHashes_ = false;
+    }
+    
+    unsigned numRemoved = payload.ReadVLE();
+    for (unsigned i = 0; i < numRemoved && !payload.IsEof(); ++i)
+    {
+        Node* node = GetNode(payload.ReadUInt());
+        if (node && node != this)
+            node->Remove();
+    }
+    
+    // Apply the nodes in hierarchy order, so that the parent of a new node already exists
+    Vector<WeakPtr<Component> > loadedComponents;
+    unsigned numNodes = payload.ReadVLE();
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        unsigned nodeID = payload.ReadUInt();
+        unsigned parentID = payload.ReadUInt();
+        unsigned size = payload.ReadVLE();
+        unsigned position = payload.GetPosition();
+        if (position + size > payload.GetSize())
+        {
+            LOGERROR("Corrupt node data in scene save file " + source.GetName());
+            return false;
+        }
+        payload.Seek(position + size);
+        
+        Node* node = nodeID == GetID() ? this : GetNode(nodeID);
+        if (node != this)
+        {
+            Node* parent = GetNode(parentID);
+            if (!parent)
+            {
+                LOGWARNING("Missing parent node " + String(parentID) + " for node " + String(nodeID) + " in scene save file, skipping");
+                continue;
+            }
+            
+            if (!node)
+                node = parent->CreateChild(nodeID, nodeID < FIRST_LOCAL_ID ? REPLICATED : LOCAL);
+            else if (node->GetParent() != parent)
+                parent->AddChild(node);
+        }
+        
+        MemoryBuffer nodeData(payload.GetData() + position, size);
+        ApplySaveNode(node, nodeData, loadedComponents);
+    }
+    
+    // Apply attributes once all nodes exist, as they may refer to each other by ID
+    for (unsigned i = 0; i < loadedComponents.Size(); ++i)
+    {
+        if (loadedComponents[i])
+            loadedComponents[i]->ApplyAttributes();
+    }
+    
+    return true;
+}
+
 Node* Scene::Instantiate(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
 {
     PROFILE(Instantiate);
+    MEMORY_TAG(MEMTAG_SCENE);
 
     SceneResolver resolver;
     unsigned nodeID = source.ReadInt();
@@ -413,9 +771,42 @@ Node* Scene::Instantiate(Deserializer& source, const Vector3& position, const Qu
     }
 }
 
+Node* Scene::Instantiate(Prefab* prefab, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    if (!prefab)
+    {
+        LOGERROR("Null prefab for instantiation");
+        return 0;
+    }
+
+    return prefab->Instantiate(this, position, rotation, mode);
+}
+
+Node* Scene::InstantiateBulk(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    PROFILE(InstantiateBulk);
+
+    SceneResolver resolver;
+    // Rewrite IDs when instantiating
+    Node* node = CreateChild(0, mode);
+    if (node->LoadBulk(source, resolver, true, mode))
+    {
+        resolver.Resolve();
+        node->ApplyAttributes();
+        node->SetTransform(position, rotation);
+        return node;
+    }
+    else
+    {
+        node->Remove();
+        return 0;
+    }
+}
+
 Node* Scene::InstantiateXML(const XMLElement& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
 {
     PROFILE(InstantiateXML);
+    MEMORY_TAG(MEMTAG_SCENE);
 
     SceneResolver resolver;
     unsigned nodeID = source.GetInt("id");
@@ -448,6 +839,11 @@ Node* Scene::InstantiateXML(Deserializer& source, const Vector3& position, const
 void Scene::Clear(bool clearReplicated, bool clearLocal)
 {
     StopAsyncLoading();
+    
+    // An incremental save after clearing would not be relative to any save file, so begin again with a full save
+    CompleteAsyncSaving();
+    asyncSave_.hasSavedHashes_ = false;
+    asyncSave_.savedHashes_.Clear();
 
     RemoveChildren(clearReplicated, clearLocal, true);
     RemoveComponents(clearReplicated, clearLocal);
@@ -466,6 +862,7 @@ void Scene::Clear(bool clearReplicated, bool clearLocal)
     {
         replicatedNodeID_ = FIRST_REPLICATED_ID;
         replicatedComponentID_ = FIRST_REPLICATED_ID;
+        hasSnapshots_ = false;
     }
     if (clearLocal)
     {
@@ -497,6 +894,12 @@ void Scene::SetSnapThreshold(float threshold)
     Node::MarkNetworkUpdate();
 }
 
+void Scene::SetInterpolationDelay(float delay)
+{
+    interpolationDelay_ = Max(delay, 0.0f);
+    Node::MarkNetworkUpdate();
+}
+
 void Scene::SetAsyncLoadingMs(int ms)
 {
     asyncLoadingMs_ = Max(ms, 1);
@@ -540,7 +943,7 @@ Node* Scene::GetNode(unsigned id) const
 {
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Find(id);
         if (i != replicatedNodes_.End())
             return i->second_;
         else
@@ -548,7 +951,7 @@ Node* Scene::GetNode(unsigned id) const
     }
     else
     {
-        HashMap<unsigned, Node*>::ConstIterator i = localNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::ConstIterator i = localNodes_.Find(id);
         if (i != localNodes_.End())
             return i->second_;
         else
@@ -560,7 +963,7 @@ Component* Scene::GetComponent(unsigned id) const
 {
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Component*>::ConstIterator i = replicatedComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::ConstIterator i = replicatedComponents_.Find(id);
         if (i != replicatedComponents_.End())
             return i->second_;
         else
@@ -568,7 +971,7 @@ Component* Scene::GetComponent(unsigned id) const
     }
     else
     {
-        HashMap<unsigned, Component*>::ConstIterator i = localComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::ConstIterator i = localComponents_.Find(id);
         if (i != localComponents_.End())
             return i->second_;
         else
@@ -595,6 +998,8 @@ const String& Scene::GetVarName(StringHash hash) const
 
 void Scene::Update(float timeStep)
 {
+    MEMORY_TAG(MEMTAG_SCENE);
+
     if (asyncLoading_)
     {
         UpdateAsyncLoading();
@@ -615,8 +1020,28 @@ void Scene::Update(float timeStep)
 
     // Update variable timestep logic
     SendEvent(E_SCENEUPDATE, eventData);
+    UpdateLogicComponents(USE_UPDATE, timeStep);
 
-    // Update scene attribute animation.
+    // Update scene attribute animation. Nodes and components are updated directly, other objects such as materials
+    // through the event
+    if (!animatedObjects_.Empty())
+    {
+        PROFILE(UpdateAttributeAnimations);
+
+        // Objects may be added or removed during the update. Removed objects are nulled and compacted afterward
+        for (unsigned i = 0; i < animatedObjects_.Size(); ++i)
+        {
+            Animatable* object = animatedObjects_[i];
+            if (object)
+                object->UpdateAttributeAnimations(timeStep);
+        }
+
+        for (unsigned i = animatedObjects_.Size() - 1; i < animatedObjects_.Size(); --i)
+        {
+            if (!animatedObjects_[i])
+                animatedObjects_.Erase(i);
+        }
+    }
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
 
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
@@ -629,15 +1054,32 @@ void Scene::Update(float timeStep)
         float constant = 1.0f - Clamp(powf(2.0f, -timeStep * smoothingConstant_), 0.0f, 1.0f);
         float squaredSnapThreshold = snapThreshold_ * snapThreshold_;
 
+        // Advance the network clock, steering it gradually towards the newest received server time
+        if (hasSnapshots_)
+        {
+            networkTime_ += timeStep;
+            float error = latestSnapshotTime_ - networkTime_;
+            if (Abs(error) > MAX_NETWORK_CLOCK_ERROR)
+                networkTime_ = latestSnapshotTime_;
+            else
+                networkTime_ += error * Min(timeStep * NETWORK_CLOCK_CORRECTION, 1.0f);
+        }
+
         using namespace UpdateSmoothing;
 
         smoothingData_[P_CONSTANT] = constant;
         smoothingData_[P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold;
+        smoothingData_[P_INTERPOLATIONTIME] = IsInterpolating() ? GetInterpolationTime() : -M_INFINITY;
         SendEvent(E_UPDATESMOOTHING, smoothingData_);
     }
 
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
+    UpdateLogicComponents(USE_POSTUPDATE, timeStep);
+
+    // Recalculate the world transforms moved during the update, so that rendering finds them clean
+    if (batchTransformUpdate_)
+        UpdateTransforms();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -645,6 +1087,406 @@ void Scene::Update(float timeStep)
     elapsedTime_ += timeStep;
 }
 
+void Scene::AddLogicComponent(LogicComponent* component)
+{
+    if (!component || component->updateScene_)
+        return;
+
+    StringHash type = component->GetType();
+    unsigned index = 0;
+    while (index < logicComponentGroups_.Size() && logicComponentGroups_[index].type_ != type)
+        ++index;
+
+    if (index == logicComponentGroups_.Size())
+    {
+        // New groups are put in type order, or appended and sorted after the update phase, so that the group indices being
+        // iterated stay stable
+        if (!logicUpdateDepth_)
+        {
+            index = 0;
+            while (index < logicComponentGroups_.Size() && logicComponentGroups_[index].type_ < type)
+                ++index;
+        }
+        else
+            logicComponentsDirty_ = true;
+
+        LogicComponentGroup group;
+        group.type_ = type;
+        logicComponentGroups_.Insert(index, group);
+
+        // Renumber the components of the groups that were shifted by the insert
+        for (unsigned i = index + 1; i < logicComponentGroups_.Size(); ++i)
+        {
+            PODVector<LogicComponent*>& components = logicComponentGroups_[i].components_;
+            for (unsigned j = 0; j < components.Size(); ++j)
+            {
+                if (components[j])
+                    components[j]->updateGroup_ = i;
+            }
+        }
+    }
+
+    PODVector<LogicComponent*>& components = logicComponentGroups_[index].components_;
+    component->updateScene_ = this;
+    component->updateGroup_ = index;
+    component->updateIndex_ = components.Size();
+    components.Push(component);
+}
+
+void Scene::RemoveLogicComponent(LogicComponent* component)
+{
+    if (!component || component->updateScene_ != this)
+        return;
+
+    // Use the stored group index instead of GetType(), which returns the base type when called from the destructor
+    unsigned groupIndex = component->updateGroup_;
+    if (groupIndex < logicComponentGroups_.Size())
+    {
+        PODVector<LogicComponent*>& components = logicComponentGroups_[groupIndex].components_;
+        unsigned index = component->updateIndex_;
+        if (index < components.Size() && components[index] == component)
+        {
+            if (logicUpdateDepth_)
+            {
+                // Leave a hole so that the phase being run does not skip or repeat components
+                components[index] = 0;
+                logicComponentsDirty_ = true;
+            }
+            else
+            {
+                components[index] = components.Back();
+                components[index]->updateIndex_ = index;
+                components.Pop();
+            }
+        }
+    }
+
+    component->updateScene_ = 0;
+}
+
+void Scene::UpdateLogicComponents(unsigned char phase, float timeStep)
+{
+    PROFILE(UpdateLogicComponents);
+
+    ++logicUpdateDepth_;
+
+    // Components and groups added during the phase are only updated from the next phase on. Capture all group sizes
+    // first, as a component updated earlier may add components to a later group
+    unsigned numGroups = logicComponentGroups_.Size();
+    PODVector<unsigned> groupSizes(numGroups);
+    for (unsigned i = 0; i < numGroups; ++i)
+        groupSizes[i] = logicComponentGroups_[i].components_.Size();
+    
+    for (unsigned i = 0; i < numGroups; ++i)
+    {
+        unsigned numComponents = groupSizes[i];
+        for (unsigned j = 0; j < numComponents; ++j)
+        {
+            // Re-read the component each time, as the previous update may have removed it or reallocated the array
+            LogicComponent* component = logicComponentGroups_[i].components_[j];
+            if (!component || !(component->currentEventMask_ & phase))
+                continue;
+
+            switch (phase)
+            {
+            case USE_UPDATE:
+                component->CallUpdate(timeStep);
+                break;
+
+            case USE_POSTUPDATE:
+                component->PostUpdate(timeStep);
+                break;
+
+            case USE_FIXEDUPDATE:
+                component->FixedUpdate(timeStep);
+                break;
+
+            case USE_FIXEDPOSTUPDATE:
+                component->FixedPostUpdate(timeStep);
+                break;
+            }
+        }
+    }
+
+    if (!--logicUpdateDepth_ && logicComponentsDirty_)
+        CleanupLogicComponents();
+}
+
+static bool CompareLogicComponentGroups(const LogicComponentGroup& lhs, const LogicComponentGroup& rhs)
+{
+    return lhs.type_ < rhs.type_;
+}
+
+void Scene::CleanupLogicComponents()
+{
+    Sort(logicComponentGroups_.Begin(), logicComponentGroups_.End(), CompareLogicComponentGroups);
+
+    // Compact the holes and renumber the components, as sorting may have moved their groups
+    for (unsigned i = 0; i < logicComponentGroups_.Size(); ++i)
+    {
+        PODVector<LogicComponent*>& components = logicComponentGroups_[i].components_;
+        unsigned dest = 0;
+        for (unsigned j = 0; j < components.Size(); ++j)
+        {
+            LogicComponent* component = components[j];
+            if (component)
+            {
+                component->updateGroup_ = i;
+                component->updateIndex_ = dest;
+                components[dest++] = component;
+            }
+        }
+        components.Resize(dest);
+    }
+
+    logicComponentsDirty_ = false;
+}
+
+/// Minimum number of nodes per work item in the batched transform update.
+static const unsigned TRANSFORM_UPDATE_GRAIN_SIZE = 256;
+
+/// Recalculates the world transforms of a range of nodes on the same hierarchy level. Used with WorkQueue::ParallelFor().
+struct TransformUpdater
+{
+    void operator () (Node** start, Node** end, unsigned threadIndex)
+    {
+        while (start != end)
+        {
+            (*start)->GetWorldTransform();
+            ++start;
+        }
+    }
+};
+
+/// Add a node and its subtree to the transform update levels by hierarchy depth.
+static void GatherTransformLevels(Node* node, unsigned depth, Vector<PODVector<Node*> >& levels)
+{
+    if (levels.Size() <= depth)
+        levels.Resize(depth + 1);
+    levels[depth].Push(node);
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        GatherTransformLevels(i->Get(), depth + 1, levels);
+}
+
+void Scene::SetLookupIndexEnabled(bool enable)
+{
+    if (enable == lookupIndexEnabled_)
+        return;
+
+    lookupIndexEnabled_ = enable;
+    nodeNameIndex_.Clear();
+    componentTypeIndex_.Clear();
+    if (!enable)
+        return;
+
+    // Build from the ID maps, which contain all nodes and components of the scene
+    for (FlatHashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+        AddToNameIndex(i->second_, i->second_->GetNameHash());
+    for (FlatHashMap<unsigned, Node*>::ConstIterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
+        AddToNameIndex(i->second_, i->second_->GetNameHash());
+    for (FlatHashMap<unsigned, Component*>::ConstIterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
+        componentTypeIndex_[i->second_->GetType()].Push(i->second_);
+    for (FlatHashMap<unsigned, Component*>::ConstIterator i = localComponents_.Begin(); i != localComponents_.End(); ++i)
+        componentTypeIndex_[i->second_->GetType()].Push(i->second_);
+}
+
+Node* Scene::GetNodeByName(StringHash nameHash) const
+{
+    if (!lookupIndexEnabled_)
+        return GetChild(nameHash, true);
+
+    HashMap<StringHash, PODVector<Node*> >::ConstIterator i = nodeNameIndex_.Find(nameHash);
+    return i != nodeNameIndex_.End() ? i->second_.Front() : 0;
+}
+
+void Scene::GetNodesByName(PODVector<Node*>& dest, StringHash nameHash) const
+{
+    dest.Clear();
+
+    if (!lookupIndexEnabled_)
+    {
+        PODVector<Node*> nodes;
+        GetChildren(nodes, true);
+        for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+        {
+            if ((*i)->GetNameHash() == nameHash)
+                dest.Push(*i);
+        }
+        return;
+    }
+
+    HashMap<StringHash, PODVector<Node*> >::ConstIterator i = nodeNameIndex_.Find(nameHash);
+    if (i != nodeNameIndex_.End())
+        dest = i->second_;
+}
+
+void Scene::GetComponentsByType(PODVector<Component*>& dest, StringHash type) const
+{
+    if (!lookupIndexEnabled_)
+    {
+        // Include the scene's own components, which Node::GetComponents() also returns
+        GetComponents(dest, type, true);
+        return;
+    }
+
+    dest.Clear();
+    HashMap<StringHash, PODVector<Component*> >::ConstIterator i = componentTypeIndex_.Find(type);
+    if (i != componentTypeIndex_.End())
+        dest = i->second_;
+}
+
+void Scene::SetBatchTransformUpdate(bool enable)
+{
+    batchTransformUpdate_ = enable;
+    if (!enable)
+        dirtyTransforms_.Clear();
+}
+
+void Scene::UpdateTransforms()
+{
+    if (dirtyTransforms_.Empty())
+        return;
+
+    PROFILE(UpdateTransforms);
+
+    HashSet<Node*> roots;
+    for (Vector<WeakPtr<Node> >::ConstIterator i = dirtyTransforms_.Begin(); i != dirtyTransforms_.End(); ++i)
+    {
+        if (i->NotNull())
+            roots.Insert(i->Get());
+    }
+    dirtyTransforms_.Clear();
+
+    for (unsigned i = 0; i < transformLevels_.Size(); ++i)
+        transformLevels_[i].Clear();
+
+    for (HashSet<Node*>::ConstIterator i = roots.Begin(); i != roots.End(); ++i)
+    {
+        Node* root = *i;
+        if (root->GetScene() != this || !root->IsDirty())
+            continue;
+
+        // Skip if an ancestor is also in the list, as its subtree contains this node
+        unsigned depth = 0;
+        bool covered = false;
+        for (Node* parent = root->GetParent(); parent; parent = parent->GetParent())
+        {
+            if (roots.Contains(parent))
+            {
+                covered = true;
+                break;
+            }
+            ++depth;
+        }
+        if (covered)
+            continue;
+
+        // Ensure the ancestors are clean, so that the parallel update never walks outside its own level
+        if (root->GetParent())
+            root->GetParent()->GetWorldTransform();
+
+        // All children of a dirty node are dirty as well, so the whole subtree is gathered
+        GatherTransformLevels(root, depth, transformLevels_);
+    }
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    TransformUpdater updater;
+    for (unsigned i = 0; i < transformLevels_.Size(); ++i)
+        queue->ParallelFor(transformLevels_[i], TRANSFORM_UPDATE_GRAIN_SIZE, updater);
+}
+
+bool Scene::MarkTransformDirty(Node* node)
+{
+    // Nodes may be moved from worker threads during a threaded update, so do not touch the lists then
+    if (threadedUpdate_)
+        return false;
+
+    if (batchTransformUpdate_)
+        dirtyTransforms_.Push(WeakPtr<Node>(node));
+
+    if (transformEditDepth_)
+    {
+        deferredDirtyNodes_.Push(WeakPtr<Node>(node));
+        return true;
+    }
+    else
+        return false;
+}
+
+void Scene::BeginTransformEdit()
+{
+    ++transformEditDepth_;
+}
+
+void Scene::EndTransformEdit()
+{
+    if (!transformEditDepth_)
+    {
+        LOGERROR("EndTransformEdit called without BeginTransformEdit");
+        return;
+    }
+
+    if (--transformEditDepth_ || deferredDirtyNodes_.Empty())
+        return;
+
+    PROFILE(EndTransformEdit);
+
+    HashSet<Node*> nodes;
+    for (Vector<WeakPtr<Node> >::ConstIterator i = deferredDirtyNodes_.Begin(); i != deferredDirtyNodes_.End(); ++i)
+    {
+        if (i->NotNull() && (*i)->GetScene() == this)
+            nodes.Insert(i->Get());
+    }
+    deferredDirtyNodes_.Clear();
+
+    for (HashSet<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        // Skip if an ancestor was moved as well, as its notification covers this node
+        bool covered = false;
+        for (Node* parent = (*i)->GetParent(); parent; parent = parent->GetParent())
+        {
+            if (nodes.Contains(parent))
+            {
+                covered = true;
+                break;
+            }
+        }
+
+        if (!covered)
+            (*i)->NotifyMarkedDirtyRecursive();
+    }
+}
+
+void Scene::BeginNetworkSnapshot(unsigned short serverTime)
+{
+    if (!hasSnapshots_)
+    {
+        // Start the snapshot timeline from the first received update
+        latestServerTime_ = serverTime;
+        latestSnapshotTime_ = 0.0f;
+        networkTime_ = 0.0f;
+        hasSnapshots_ = true;
+    }
+
+    // The time stamp wraps around every 65 seconds; interpret it relative to the newest update, allowing out of order arrival
+    short delta = (short)(serverTime - latestServerTime_);
+    snapshotTime_ = latestSnapshotTime_ + (float)delta * 0.001f;
+    if (delta > 0)
+    {
+        latestServerTime_ = serverTime;
+        latestSnapshotTime_ = snapshotTime_;
+    }
+
+    inNetworkSnapshot_ = true;
+}
+
+void Scene::EndNetworkSnapshot()
+{
+    inNetworkSnapshot_ = false;
+}
+
 void Scene::BeginThreadedUpdate()
 {
     // Check the work queue subsystem whether it actually has created worker threads. If not, do not enter threaded mode.
@@ -766,10 +1608,12 @@ void Scene::NodeAdded(Node* node)
     // If node with same ID exists, remove the scene reference from it and overwrite with the new node
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Find(id);
         if (i != replicatedNodes_.End() && i->second_ != node)
         {
             LOGWARNING("Overwriting node with ID " + String(id));
+            if (lookupIndexEnabled_)
+                RemoveFromNameIndex(i->second_, i->second_->GetNameHash());
             i->second_->ResetScene();
         }
 
@@ -780,15 +1624,20 @@ void Scene::NodeAdded(Node* node)
     }
     else
     {
-        HashMap<unsigned, Node*>::Iterator i = localNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::Iterator i = localNodes_.Find(id);
         if (i != localNodes_.End() && i->second_ != node)
         {
             LOGWARNING("Overwriting node with ID " + String(id));
+            if (lookupIndexEnabled_)
+                RemoveFromNameIndex(i->second_, i->second_->GetNameHash());
             i->second_->ResetScene();
         }
 
         localNodes_[id] = node;
     }
+
+    if (lookupIndexEnabled_)
+        AddToNameIndex(node, node->GetNameHash());
 }
 
 void Scene::NodeRemoved(Node* node)
@@ -805,6 +1654,9 @@ void Scene::NodeRemoved(Node* node)
     else
         localNodes_.Erase(id);
 
+    if (lookupIndexEnabled_)
+        RemoveFromNameIndex(node, node->GetNameHash());
+
     node->SetID(0);
     node->SetScene(0);
     // Remove components and child nodes as well
@@ -824,7 +1676,7 @@ void Scene::ComponentAdded(Component* component)
     unsigned id = component->GetID();
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Find(id);
         if (i != replicatedComponents_.End() && i->second_ != component)
         {
             LOGWARNING("Overwriting component with ID " + String(id));
@@ -835,7 +1687,7 @@ void Scene::ComponentAdded(Component* component)
     }
     else
     {
-        HashMap<unsigned, Component*>::Iterator i = localComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::Iterator i = localComponents_.Find(id);
         if (i != localComponents_.End() && i->second_ != component)
         {
             LOGWARNING("Overwriting component with ID " + String(id));
@@ -844,6 +1696,16 @@ void Scene::ComponentAdded(Component* component)
 
         localComponents_[id] = component;
     }
+
+    if (lookupIndexEnabled_)
+    {
+        // A component whose ID was overwritten stays in its node, so it is only indexed once
+        PODVector<Component*>& components = componentTypeIndex_[component->GetType()];
+        if (!components.Contains(component))
+            components.Push(component);
+    }
+
+    component->OnSceneSet(this);
 }
 
 void Scene::ComponentRemoved(Component* component)
@@ -857,7 +1719,48 @@ void Scene::ComponentRemoved(Component* component)
     else
         localComponents_.Erase(id);
 
+    if (lookupIndexEnabled_)
+    {
+        HashMap<StringHash, PODVector<Component*> >::Iterator i = componentTypeIndex_.Find(component->GetType());
+        if (i != componentTypeIndex_.End())
+        {
+            i->second_.Remove(component);
+            if (i->second_.Empty())
+                componentTypeIndex_.Erase(i);
+        }
+    }
+
     component->SetID(0);
+    component->OnSceneSet(0);
+}
+
+void Scene::NodeRenamed(Node* node, StringHash oldNameHash)
+{
+    if (!lookupIndexEnabled_ || node->GetScene() != this)
+        return;
+
+    RemoveFromNameIndex(node, oldNameHash);
+    AddToNameIndex(node, node->GetNameHash());
+}
+
+void Scene::AddToNameIndex(Node* node, StringHash nameHash)
+{
+    // Unnamed nodes are not indexed, and the scene is not its own child
+    if (nameHash == StringHash::ZERO || node == this)
+        return;
+
+    nodeNameIndex_[nameHash].Push(node);
+}
+
+void Scene::RemoveFromNameIndex(Node* node, StringHash nameHash)
+{
+    HashMap<StringHash, PODVector<Node*> >::Iterator i = nodeNameIndex_.Find(nameHash);
+    if (i != nodeNameIndex_.End())
+    {
+        i->second_.Remove(node);
+        if (i->second_.Empty())
+            nodeNameIndex_.Erase(i);
+    }
 }
 
 void Scene::SetVarNamesAttr(const String& value)
@@ -908,10 +1811,10 @@ void Scene::CleanupConnection(Connection* connection)
 {
     Node::CleanupConnection(connection);
 
-    for (HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         i->second_->CleanupConnection(connection);
 
-    for (HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
+    for (FlatHashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
         i->second_->CleanupConnection(connection);
 }
 
@@ -958,10 +1861,31 @@ void Scene::MarkReplicationDirty(Node* node)
     }
 }
 
+void Scene::AddAnimatedObject(Animatable* object)
+{
+    if (object)
+        animatedObjects_.Push(WeakPtr<Animatable>(object));
+}
+
+void Scene::RemoveAnimatedObject(Animatable* object)
+{
+    for (unsigned i = 0; i < animatedObjects_.Size(); ++i)
+    {
+        if (animatedObjects_[i] == object)
+        {
+            animatedObjects_[i].Reset();
+            break;
+        }
+    }
+}
+
 void Scene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 {
     using namespace Update;
 
+    if (asyncSaving_)
+        UpdateAsyncSaving();
+
     if (updateEnabled_)
         Update(eventData[P_TIMESTEP].GetFloat());
 }
@@ -1054,6 +1978,130 @@ void Scene::FinishAsyncLoading()
     SendEvent(E_ASYNCLOADFINISHED, eventData);
 }
 
+void Scene::UpdateAsyncSaving()
+{
+    if (asyncSave_.workItem_->completed_)
+        FinishAsyncSaving();
+}
+
+void Scene::FinishAsyncSaving()
+{
+    const String& fileName = asyncSave_.fileName_;
+    bool success = asyncSave_.success_;
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    
+    if (success)
+    {
+        if (fileSystem->FileExists(fileName))
+            fileSystem->Delete(fileName);
+        success = fileSystem->Rename(fileName + ".tmp", fileName);
+    }
+    
+    if (success)
+    {
+        // The hashes of this save are the base for the next incremental save
+        asyncSave_.savedHashes_.Swap(asyncSave_.newHashes_);
+        asyncSave_.hasSavedHashes_ = true;
+        LOGINFO("Saved " + String(asyncSave_.savedNodes_) + " nodes asynchronously to " + fileName);
+    }
+    else
+    {
+        fileSystem->Delete(fileName + ".tmp");
+        LOGERROR("Failed to save scene asynchronously to " + fileName);
+    }
+    
+    asyncSave_.newHashes_.Clear();
+    asyncSave_.data_.Clear();
+    asyncSave_.nodes_.Clear();
+    asyncSave_.workItem_.Reset();
+    asyncSaving_ = false;
+    
+    using namespace AsyncSaveFinished;
+    
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_SCENE] = this;
+    eventData[P_FILENAME] = fileName;
+    eventData[P_SUCCESS] = success;
+    eventData[P_NUMNODES] = asyncSave_.savedNodes_;
+    SendEvent(E_ASYNCSAVEFINISHED, eventData);
+}
+
+void Scene::CaptureAsyncSave(Node* node, unsigned parentID)
+{
+    VectorBuffer& dest = asyncSave_.data_;
+    AsyncSaveNode saveNode;
+    saveNode.id_ = node->GetID();
+    saveNode.parentID_ = parentID;
+    saveNode.offset_ = dest.GetSize();
+    
+    // Same layout as Node::Save() up to the child nodes, which are recorded separately
+    node->Animatable::Save(dest);
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    dest.WriteVLE(node->GetNumPersistentComponents());
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        if (component->IsTemporary())
+            continue;
+        
+        VectorBuffer compBuffer;
+        component->Save(compBuffer);
+        dest.WriteVLE(compBuffer.GetSize());
+        dest.Write(compBuffer.GetData(), compBuffer.GetSize());
+    }
+    
+    saveNode.size_ = dest.GetSize() - saveNode.offset_;
+    asyncSave_.nodes_.Push(saveNode);
+    
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        if (!children[i]->IsTemporary())
+            CaptureAsyncSave(children[i], saveNode.id_);
+    }
+}
+
+void Scene::ApplySaveNode(Node* node, Deserializer& source, Vector<WeakPtr<Component> >& loadedComponents)
+{
+    node->Animatable::Load(source);
+    
+    // Load into existing components where the ID and type match, so that e.g. the octree of the scene is kept
+    HashSet<Component*> keptComponents;
+    unsigned numComponents = source.ReadVLE();
+    for (unsigned i = 0; i < numComponents; ++i)
+    {
+        VectorBuffer compBuffer(source, source.ReadVLE());
+        StringHash compType = compBuffer.ReadStringHash();
+        unsigned compID = compBuffer.ReadUInt();
+        
+        Component* component = GetComponent(compID);
+        if (component && (component->GetType() != compType || component->GetNode() != node))
+        {
+            component->Remove();
+            component = 0;
+        }
+        if (!component)
+            component = node->CreateComponent(compType, compID < FIRST_LOCAL_ID ? REPLICATED : LOCAL, compID);
+        if (component)
+        {
+            keptComponents.Insert(component);
+            component->Load(compBuffer);
+            loadedComponents.Push(WeakPtr<Component>(component));
+        }
+    }
+    
+    // Remove the persistent components that were no longer in the node when it was saved
+    PODVector<Component*> removeComponents;
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        if (!components[i]->IsTemporary() && !keptComponents.Contains(components[i]))
+            removeComponents.Push(components[i]);
+    }
+    for (unsigned i = 0; i < removeComponents.Size(); ++i)
+        node->RemoveComponent(removeComponents[i]);
+}
+
 void Scene::FinishLoading(Deserializer* source)
 {
     if (source)
@@ -1146,10 +2194,109 @@ void Scene::PreloadResources(File* file, bool isSceneFile)
         PreloadResources(file, false);
 }
 
-void Scene::PreloadResourcesXML(const XMLElement& element)
+bool Scene::PreloadResourceManifest(File* file)
 {
+    unsigned size = file->GetSize();
+    unsigned currentPos = file->GetPosition();
+    if (size < currentPos + 2 * sizeof(unsigned))
+        return false;
+
+    file->Seek(size - 2 * sizeof(unsigned));
+    unsigned manifestSize = file->ReadUInt();
+    if (file->ReadFileID() != MANIFEST_ID || manifestSize > size - currentPos - 2 * sizeof(unsigned))
+    {
+        file->Seek(currentPos);
+        return false;
+    }
+
     ResourceCache* cache = GetSubsystem<ResourceCache>();
 
+    // The manifest holds the whole dependency closure, so all resources can be queued at once instead of waiting for the
+    // parent resources to finish loading before their dependencies are found
+    file->Seek(size - 2 * sizeof(unsigned) - manifestSize);
+    unsigned numResources = file->ReadVLE();
+    for (unsigned i = 0; i < numResources && !file->IsEof(); ++i)
+    {
+        ResourceRef ref = file->ReadResourceRef();
+        if (cache->BackgroundLoadResource(ref.type_, ref.name_))
+        {
+            ++asyncProgress_.totalResources_;
+            asyncProgress_.resources_.Insert(StringHash(ref.name_));
+        }
+    }
+
+    file->Seek(currentPos);
+    return true;
+}
+
+void Scene::SaveResourceManifest(Serializer& dest) const
+{
+    Vector<ResourceRef> manifest;
+    GetResourceManifest(manifest);
+
+    VectorBuffer buffer;
+    buffer.WriteVLE(manifest.Size());
+    for (unsigned i = 0; i < manifest.Size(); ++i)
+        buffer.WriteResourceRef(manifest[i]);
+
+    // Write the size and identifier last, so that the manifest can be found by seeking from the end of the file
+    dest.Write(buffer.GetData(), buffer.GetSize());
+    dest.WriteUInt(buffer.GetSize());
+    dest.WriteFileID(MANIFEST_ID);
+}
+
+void Scene::SaveResourceManifestXML(XMLElement& dest) const
+{
+    Vector<ResourceRef> manifest;
+    GetResourceManifest(manifest);
+
+    XMLElement manifestElem = dest.CreateChild("resourcemanifest");
+    for (unsigned i = 0; i < manifest.Size(); ++i)
+        manifestElem.CreateChild("resource").SetResourceRef(manifest[i]);
+}
+
+void Scene::GetResourceManifest(Vector<ResourceRef>& dest) const
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    HashSet<StringHash> added;
+
+    dest.Clear();
+    CollectResourceRefs(cache, this, dest, added);
+
+    // Append the dependencies of the loaded resources; the list grows while iterating, which resolves the whole closure
+    Vector<ResourceRef> dependencies;
+    for (unsigned i = 0; i < dest.Size(); ++i)
+    {
+        Resource* resource = cache->GetExistingResource(dest[i].type_, dest[i].name_);
+        if (!resource)
+            continue;
+
+        dependencies.Clear();
+        resource->GetDependencies(dependencies);
+        for (unsigned j = 0; j < dependencies.Size(); ++j)
+            AddManifestEntry(cache, dependencies[j].type_, dependencies[j].name_, dest, added);
+    }
+}
+
+void Scene::PreloadResourcesXML(const XMLElement& element, HashSet<StringHash>& resources)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    // If a resource manifest was saved with the scene, queue the whole dependency closure at once
+    XMLElement manifestElem = element.GetChild("resourcemanifest");
+    if (manifestElem)
+    {
+        XMLElement resourceElem = manifestElem.GetChild("resource");
+        while (resourceElem)
+        {
+            ResourceRef ref = resourceElem.GetResourceRef();
+            if (cache->BackgroundLoadResource(ref.type_, ref.name_))
+                resources.Insert(StringHash(ref.name_));
+            resourceElem = resourceElem.GetNext("resource");
+        }
+        return;
+    }
+
     // Node or Scene attributes do not include any resources; therefore skip to the components
     XMLElement compElem = element.GetChild("component");
     while (compElem)
@@ -1178,10 +2325,7 @@ void Scene::PreloadResourcesXML(const XMLElement& element)
                             String name = cache->SanitateResourceName(ref.name_);
                             bool success = cache->BackgroundLoadResource(ref.type_, name);
                             if (success)
-                            {
-                                ++asyncProgress_.totalResources_;
-                                asyncProgress_.resources_.Insert(StringHash(name));
-                            }
+                                resources.Insert(StringHash(name));
                         }
                         else if (attr.type_ == VAR_RESOURCEREFLIST)
                         {
@@ -1191,10 +2335,7 @@ void Scene::PreloadResourcesXML(const XMLElement& element)
                                 String name = cache->SanitateResourceName(refList.names_[k]);
                                 bool success = cache->BackgroundLoadResource(refList.type_, name);
                                 if (success)
-                                {
-                                    ++asyncProgress_.totalResources_;
-                                    asyncProgress_.resources_.Insert(StringHash(name));
-                                }
+                                    resources.Insert(StringHash(name));
                             }
                         }
 
@@ -1218,7 +2359,7 @@ void Scene::PreloadResourcesXML(const XMLElement& element)
     XMLElement childElem = element.GetChild("node");
     while (childElem)
     {
-        PreloadResourcesXML(childElem);
+        PreloadResourcesXML(childElem, resources);
         childElem = childElem.GetNext("node");
     }
 }
@@ -1227,11 +2368,13 @@ void RegisterSceneLibrary(Context* context)
 {
     ValueAnimation::RegisterObject(context);
     ObjectAnimation::RegisterObject(context);
+    Prefab::RegisterObject(context);
     Node::RegisterObject(context);
     Scene::RegisterObject(context);
     SmoothedTransform::RegisterObject(context);
     UnknownComponent::RegisterObject(context);
     SplinePath::RegisterObject(context);
+    SceneStreamer::RegisterObject(context);
 }
 
 }
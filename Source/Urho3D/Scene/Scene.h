@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 #include "../Core/Mutex.h"
 #include "../Scene/Node.h"
@@ -32,7 +33,10 @@ namespace Urho3D
 {
 
 class File;
+class LogicComponent;
 class PackageFile;
+class Prefab;
+struct WorkItem;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
 static const unsigned LAST_REPLICATED_ID = 0xffffff;
@@ -73,6 +77,58 @@ struct AsyncProgress
     unsigned totalNodes_;
 };
 
+/// Node captured for an asynchronous save.
+struct AsyncSaveNode
+{
+    /// Node ID.
+    unsigned id_;
+    /// Parent node ID, or 0 for the scene.
+    unsigned parentID_;
+    /// Offset of the node's own attributes and components in the captured data.
+    unsigned offset_;
+    /// Size of the node's own attributes and components.
+    unsigned size_;
+};
+
+/// Scene state captured for an asynchronous save. Written to the file by a work item.
+struct AsyncSaveState
+{
+    /// Construct.
+    AsyncSaveState();
+    
+    /// Context for opening the file in the work item.
+    Context* context_;
+    /// Work item writing the file.
+    SharedPtr<WorkItem> workItem_;
+    /// Destination file name.
+    String fileName_;
+    /// Serialized own attributes and components of the captured nodes.
+    VectorBuffer data_;
+    /// Captured nodes in hierarchy order.
+    PODVector<AsyncSaveNode> nodes_;
+    /// Content hashes of the nodes in the previous save by node ID.
+    HashMap<unsigned, unsigned> savedHashes_;
+    /// Content hashes of the captured nodes by node ID. Written by the work item.
+    HashMap<unsigned, unsigned> newHashes_;
+    /// Number of nodes written. Written by the work item.
+    unsigned savedNodes_;
+    /// Incremental save flag.
+    bool incremental_;
+    /// Previous save exists to compare against flag.
+    bool hasSavedHashes_;
+    /// Success flag. Written by the work item.
+    bool success_;
+};
+
+/// Logic components of one type, updated directly by the scene.
+struct LogicComponentGroup
+{
+    /// Component type.
+    StringHash type_;
+    /// Components. May contain null holes while an update phase is running.
+    PODVector<LogicComponent*> components_;
+};
+
 /// Root scene node, represents the whole scene.
 class URHO3D_API Scene : public Node
 {
@@ -89,7 +145,7 @@ public:
     /// Register object factory. Node must be registered first.
     static void RegisterObject(Context* context);
 
-    /// Load from binary data. Removes all existing child nodes and components first. Return true if successful.
+    /// Load from binary data, either the regular or the bulk scene format. Removes all existing child nodes and components first. Return true if successful.
     virtual bool Load(Deserializer& source, bool setInstanceDefault = false);
     /// Save to binary data. Return true if successful.
     virtual bool Save(Serializer& dest) const;
@@ -104,14 +160,30 @@ public:
     bool LoadXML(Deserializer& source);
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
+    /// Save to the bulk binary format, which loads faster than the regular binary format but can not be loaded asynchronously. Return true if successful.
+    bool SaveBulk(Serializer& dest) const;
     /// Load from a binary file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
     bool LoadAsync(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
     /// Load from an XML file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
     bool LoadAsyncXML(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
     /// Stop asynchronous loading.
     void StopAsyncLoading();
+    /// Capture the scene state and write it to a save file in a worker thread. The file is compressed and can be loaded with ApplySave(). An incremental save contains only the nodes changed since the previous asynchronous save and the IDs of the nodes removed since; if there is no previous save, or the scene has been cleared or loaded since, a full save is written instead. Return true if started successfully.
+    bool SaveAsync(const String& fileName, bool incremental = false);
+    /// Block until the asynchronous save in progress has been written.
+    void CompleteAsyncSaving();
+    /// Load a save file written with SaveAsync(). A full save replaces the scene content, while an incremental save is applied on top of the content loaded from the previous saves. Return true if successful.
+    bool ApplySave(Deserializer& source);
+    /// Queue background loading of the resources referenced by the components of an XML node element and its child nodes. Add the name hashes of the queued resources to the set.
+    void PreloadResourcesXML(const XMLElement& element, HashSet<StringHash>& resources);
+    /// Return the resource manifest: resources referenced by the saveable components, followed by the dependencies of already loaded resources recursively. Each resource is listed once.
+    void GetResourceManifest(Vector<ResourceRef>& dest) const;
     /// Instantiate scene content from binary data. Return root node if successful.
     Node* Instantiate(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+    /// Instantiate a compiled prefab. Return root node if successful.
+    Node* Instantiate(Prefab* prefab, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+    /// Instantiate scene content from bulk binary data saved with Node::SaveBulk(). Return root node if successful.
+    Node* InstantiateBulk(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
     /// Instantiate scene content from XML data. Return root node if successful.
     Node* InstantiateXML(const XMLElement& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
     /// Instantiate scene content from XML data. Return root node if successful.
@@ -128,8 +200,12 @@ public:
     void SetSmoothingConstant(float constant);
     /// Set network client motion smoothing snap threshold.
     void SetSnapThreshold(float threshold);
+    /// Set network client snapshot interpolation delay in seconds. When above zero, node transforms are interpolated between time-stamped server updates instead of exponentially smoothed. 0 (default) disables.
+    void SetInterpolationDelay(float delay);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Enable or disable the index of nodes by name and components by type. When enabled, it is built from the current content and then kept up to date as nodes and components are added, removed or renamed. Disabled by default.
+    void SetLookupIndexEnabled(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -145,10 +221,22 @@ public:
     Node* GetNode(unsigned id) const;
     /// Return component from the whole scene by ID, or null if not found.
     Component* GetComponent(unsigned id) const;
+    /// Return whether the lookup index is enabled.
+    bool IsLookupIndexEnabled() const { return lookupIndexEnabled_; }
+    /// Return a node with the given name from the whole scene, or null if not found. Constant time if the lookup index is enabled. If several nodes have the name, which one is returned is unspecified.
+    Node* GetNodeByName(StringHash nameHash) const;
+    /// Return all nodes with the given name from the whole scene, in unspecified order. Constant time per node if the lookup index is enabled.
+    void GetNodesByName(PODVector<Node*>& dest, StringHash nameHash) const;
+    /// Return all components of the given type from the whole scene, in unspecified order. Constant time per component if the lookup index is enabled.
+    void GetComponentsByType(PODVector<Component*>& dest, StringHash type) const;
+    /// Template version of returning all components of a type from the whole scene.
+    template <class T> void GetComponentsByType(PODVector<T*>& dest) const;
     /// Return whether updates are enabled.
     bool IsUpdateEnabled() const { return updateEnabled_; }
     /// Return whether an asynchronous loading operation is in progress.
     bool IsAsyncLoading() const { return asyncLoading_; }
+    /// Return whether an asynchronous save is being written.
+    bool IsAsyncSaving() const { return asyncSaving_; }
     /// Return asynchronous loading progress between 0.0 and 1.0, or 1.0 if not in progress.
     float GetAsyncProgress() const;
     /// Return the load mode of the current asynchronous loading operation.
@@ -165,6 +253,18 @@ public:
     float GetSmoothingConstant() const { return smoothingConstant_; }
     /// Return motion smoothing snap threshold.
     float GetSnapThreshold() const { return snapThreshold_; }
+    /// Return snapshot interpolation delay in seconds.
+    float GetInterpolationDelay() const { return interpolationDelay_; }
+    /// Return whether snapshot interpolation is in use: enabled and server time stamps have been received.
+    bool IsInterpolating() const { return interpolationDelay_ > 0.0f && hasSnapshots_; }
+    /// Return the estimated current server time in seconds on the client's snapshot timeline.
+    float GetNetworkTime() const { return networkTime_; }
+    /// Return the server time in seconds at which snapshots are currently sampled, ie. network time minus the interpolation delay.
+    float GetInterpolationTime() const { return networkTime_ - interpolationDelay_; }
+    /// Return whether a time-stamped network update is being applied.
+    bool IsInNetworkSnapshot() const { return inNetworkSnapshot_; }
+    /// Return the time in seconds of the network update being applied.
+    float GetSnapshotTime() const { return snapshotTime_; }
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
     /// Return required package files.
@@ -176,12 +276,36 @@ public:
     void Update(float timeStep);
     /// Begin a threaded update. During threaded update components can choose to delay dirty processing.
     void BeginThreadedUpdate();
+    /// Begin applying a network update stamped with the low 16 bits of the server time in milliseconds. Called by Connection.
+    void BeginNetworkSnapshot(unsigned short serverTime);
+    /// End applying a time-stamped network update. Called by Connection.
+    void EndNetworkSnapshot();
     /// End a threaded update. Notify components that marked themselves for delayed dirty processing.
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Set whether dirty world transforms are collected and recalculated in parallel at the end of the scene update.
+    void SetBatchTransformUpdate(bool enable);
+    /// Return whether batched world transform update is enabled.
+    bool IsBatchTransformUpdate() const { return batchTransformUpdate_; }
+    /// Recalculate the world transforms of all nodes marked dirty since the last update, one hierarchy level at a time using worker threads. Called at the end of Update if batching is enabled.
+    void UpdateTransforms();
+    /// Begin a transform edit. Until the matching EndTransformEdit, moved nodes are only flagged dirty and listener components are not notified. Can be nested.
+    void BeginTransformEdit();
+    /// End a transform edit. When the outermost edit ends, notify the listener components of each moved subtree once.
+    void EndTransformEdit();
+    /// Return whether a transform edit is in progress.
+    bool IsTransformEditing() const { return transformEditDepth_ > 0; }
+    /// Register a node whose transform became dirty for the batched transform update and the transform edit. Return true if the listener notification should be deferred. Called by Node.
+    bool MarkTransformDirty(Node* node);
+    /// Add a logic component to be updated directly by the scene. Called by LogicComponent.
+    void AddLogicComponent(LogicComponent* component);
+    /// Remove a logic component from the direct update. Called by LogicComponent.
+    void RemoveLogicComponent(LogicComponent* component);
+    /// Run an update phase (USE_UPDATE, USE_POSTUPDATE, USE_FIXEDUPDATE or USE_FIXEDPOSTUPDATE) of the logic components, grouped by type. Called by Scene for the variable timestep phases and by PhysicsWorld for the fixed timestep phases.
+    void UpdateLogicComponents(unsigned char phase, float timeStep);
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
     /// Get free component ID, either non-local or local.
@@ -194,6 +318,8 @@ public:
     void ComponentAdded(Component* component);
     /// Component removed. Remove from ID map.
     void ComponentRemoved(Component* component);
+    /// Node name changed. Update the lookup index. Called by Node.
+    void NodeRenamed(Node* node, StringHash oldNameHash);
     /// Set node user variable reverse mappings.
     void SetVarNamesAttr(const String& value);
     /// Return node user variable reverse mappings.
@@ -208,8 +334,16 @@ public:
     void MarkNetworkUpdate(Component* component);
     /// Mark a node dirty in scene replication states. The node does not need to have own replication state yet.
     void MarkReplicationDirty(Node* node);
+    /// Add a node or component with attribute animations to be updated on each scene update.
+    void AddAnimatedObject(Animatable* object);
+    /// Remove a node or component from the attribute animation update.
+    void RemoveAnimatedObject(Animatable* object);
 
 private:
+    /// Add a node to the name lookup index.
+    void AddToNameIndex(Node* node, StringHash nameHash);
+    /// Remove a node from the name lookup index.
+    void RemoveFromNameIndex(Node* node, StringHash nameHash);
     /// Handle the logic update event to update the scene, if active.
     void HandleUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle a background loaded resource completing.
@@ -218,25 +352,41 @@ private:
     void UpdateAsyncLoading();
     /// Finish asynchronous loading.
     void FinishAsyncLoading();
+    /// Check whether the asynchronous save has been written and finish it.
+    void UpdateAsyncSaving();
+    /// Finish an asynchronous save whose work item has completed. Rename the file into place and send the finished event.
+    void FinishAsyncSaving();
+    /// Capture the own attributes and components of a node and its persistent child nodes for an asynchronous save.
+    void CaptureAsyncSave(Node* node, unsigned parentID);
+    /// Load the own attributes and components of a node from a save file. Update existing components with matching ID and type in place, and remove the others. Add the loaded components to the vector.
+    void ApplySaveNode(Node* node, Deserializer& source, Vector<WeakPtr<Component> >& loadedComponents);
     /// Finish loading. Sets the scene filename and checksum.
     void FinishLoading(Deserializer* source);
     /// Finish saving. Sets the scene filename and checksum.
     void FinishSaving(Serializer* dest) const;
     /// Preload resources from a binary scene or object prefab file.
     void PreloadResources(File* file, bool isSceneFile);
-    /// Preload resources from an XML scene or object prefab file.
-    void PreloadResourcesXML(const XMLElement& element);
+    /// Queue background loading of all resources in the manifest at the end of a binary scene file. Return true if the file had a manifest.
+    bool PreloadResourceManifest(File* file);
+    /// Write the resource manifest to the end of a binary scene file.
+    void SaveResourceManifest(Serializer& dest) const;
+    /// Write the resource manifest as a child element of an XML scene root element.
+    void SaveResourceManifestXML(XMLElement& dest) const;
+    /// Compact the holes left by logic components removed during an update phase and restore the type order of the groups.
+    void CleanupLogicComponents();
 
     /// Replicated scene nodes by ID.
-    HashMap<unsigned, Node*> replicatedNodes_;
+    FlatHashMap<unsigned, Node*> replicatedNodes_;
     /// Local scene nodes by ID.
-    HashMap<unsigned, Node*> localNodes_;
+    FlatHashMap<unsigned, Node*> localNodes_;
     /// Replicated components by ID.
-    HashMap<unsigned, Component*> replicatedComponents_;
+    FlatHashMap<unsigned, Component*> replicatedComponents_;
     /// Local components by ID.
-    HashMap<unsigned, Component*> localComponents_;
+    FlatHashMap<unsigned, Component*> localComponents_;
     /// Asynchronous loading progress.
     AsyncProgress asyncProgress_;
+    /// Asynchronous save state.
+    AsyncSaveState asyncSave_;
     /// Node and component ID resolver for asynchronous loading.
     SceneResolver resolver_;
     /// Source file name.
@@ -253,6 +403,20 @@ private:
     PODVector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
     Mutex sceneMutex_;
+    /// Nodes marked dirty since the last batched transform update.
+    Vector<WeakPtr<Node> > dirtyTransforms_;
+    /// Lookup index of named nodes by name hash.
+    HashMap<StringHash, PODVector<Node*> > nodeNameIndex_;
+    /// Lookup index of components by type.
+    HashMap<StringHash, PODVector<Component*> > componentTypeIndex_;
+    /// Nodes moved during the transform edit whose listener notification is deferred.
+    Vector<WeakPtr<Node> > deferredDirtyNodes_;
+    /// Dirty nodes grouped by hierarchy depth for the batched transform update.
+    Vector<PODVector<Node*> > transformLevels_;
+    /// Logic components by type for the direct update phases.
+    Vector<LogicComponentGroup> logicComponentGroups_;
+    /// Nodes and components with attribute animations.
+    Vector<WeakPtr<Animatable> > animatedObjects_;
     /// Preallocated event data map for smoothing update events.
     VariantMap smoothingData_;
     /// Next free non-local node ID.
@@ -275,14 +439,42 @@ private:
     float smoothingConstant_;
     /// Motion smoothing snap threshold.
     float snapThreshold_;
+    /// Snapshot interpolation delay.
+    float interpolationDelay_;
+    /// Estimated current server time on the snapshot timeline.
+    float networkTime_;
+    /// Time of the network update being applied.
+    float snapshotTime_;
+    /// Time of the newest received network update.
+    float latestSnapshotTime_;
+    /// Raw 16-bit server time of the newest received network update.
+    unsigned short latestServerTime_;
+    /// Time-stamped network updates received flag.
+    bool hasSnapshots_;
+    /// Applying a time-stamped network update flag.
+    bool inNetworkSnapshot_;
     /// Update enabled flag.
     bool updateEnabled_;
     /// Asynchronous loading flag.
     bool asyncLoading_;
+    /// Asynchronous saving flag.
+    bool asyncSaving_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Batched world transform update flag.
+    bool batchTransformUpdate_;
+    /// Lookup index enabled flag.
+    bool lookupIndexEnabled_;
+    /// Transform edit nesting depth.
+    unsigned transformEditDepth_;
+    /// Logic update phase nesting depth.
+    unsigned logicUpdateDepth_;
+    /// Logic components removed or groups added during an update phase flag.
+    bool logicComponentsDirty_;
 };
 
+template <class T> void Scene::GetComponentsByType(PODVector<T*>& dest) const { GetComponentsByType(reinterpret_cast<PODVector<Component*>&>(dest), T::GetTypeStatic()); }
+
 /// Register Scene library objects.
 void URHO3D_API RegisterSceneLibrary(Context* context);
 
@@ -46,6 +46,7 @@ EVENT(E_UPDATESMOOTHING, UpdateSmoothing)
 {
     PARAM(P_CONSTANT, Constant);            // float
     PARAM(P_SQUAREDSNAPTHRESHOLD, SquaredSnapThreshold);  // float
+    PARAM(P_INTERPOLATIONTIME, InterpolationTime);  // float, -infinity if snapshot interpolation is not in use
 }
 
 /// Scene drawable update finished. Custom animation (eg. IK) can be done at this point.
@@ -110,6 +111,31 @@ EVENT(E_ASYNCLOADFINISHED, AsyncLoadFinished)
     PARAM(P_SCENE, Scene);                  // Scene pointer
 };
 
+/// Asynchronous scene save finished.
+EVENT(E_ASYNCSAVEFINISHED, AsyncSaveFinished)
+{
+    PARAM(P_SCENE, Scene);                  // Scene pointer
+    PARAM(P_FILENAME, FileName);            // String
+    PARAM(P_SUCCESS, Success);              // bool
+    PARAM(P_NUMNODES, NumNodes);            // int
+};
+
+/// Scene streaming cell has been loaded and instantiated.
+EVENT(E_SCENECELLLOADED, SceneCellLoaded)
+{
+    PARAM(P_SCENE, Scene);                  // Scene pointer
+    PARAM(P_NODE, Node);                    // Node pointer (cell root)
+    PARAM(P_CELL, Cell);                    // IntVector2
+};
+
+/// Scene streaming cell is about to be unloaded.
+EVENT(E_SCENECELLUNLOADED, SceneCellUnloaded)
+{
+    PARAM(P_SCENE, Scene);                  // Scene pointer
+    PARAM(P_NODE, Node);                    // Node pointer (cell root)
+    PARAM(P_CELL, Cell);                    // IntVector2
+};
+
 /// A child node has been added to a parent node.
 EVENT(E_NODEADDED, NodeAdded)
 {
@@ -0,0 +1,454 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../Core/Timer.h"
+#include "../IO/Log.h"
+#include "../Core/Profiler.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/ResourceEvents.h"
+#include "../Resource/XMLFile.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+#include "../Scene/SceneStreamer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* SUBSYSTEM_CATEGORY;
+
+static const float DEFAULT_CELL_SIZE = 100.0f;
+static const float DEFAULT_LOAD_DISTANCE = 200.0f;
+static const float DEFAULT_UNLOAD_DISTANCE = 250.0f;
+static const char* DEFAULT_CELL_FILE_FORMAT = "Cells/Cell_%d_%d.xml";
+
+/// Return hash map key for cell coordinates.
+static unsigned GetCellKey(const IntVector2& coords)
+{
+    return ((unsigned)(coords.x_ & 0xffff) << 16) | (unsigned)(coords.y_ & 0xffff);
+}
+
+SceneStreamer::SceneStreamer(Context* context) :
+    Component(context),
+    cellFileFormat_(DEFAULT_CELL_FILE_FORMAT),
+    cellSize_(DEFAULT_CELL_SIZE),
+    loadDistance_(DEFAULT_LOAD_DISTANCE),
+    unloadDistance_(DEFAULT_UNLOAD_DISTANCE),
+    targetIdAttr_(0)
+{
+}
+
+SceneStreamer::~SceneStreamer()
+{
+}
+
+void SceneStreamer::RegisterObject(Context* context)
+{
+    context->RegisterFactory<SceneStreamer>(SUBSYSTEM_CATEGORY);
+    
+    ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Load Distance", GetLoadDistance, SetLoadDistance, float, DEFAULT_LOAD_DISTANCE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Unload Distance", GetUnloadDistance, SetUnloadDistance, float, DEFAULT_UNLOAD_DISTANCE, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Cell File Format", GetCellFileFormat, SetCellFileFormat, String, String(DEFAULT_CELL_FILE_FORMAT), AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Target", GetTargetIdAttr, SetTargetIdAttr, unsigned, 0, AM_DEFAULT | AM_NODEID);
+}
+
+void SceneStreamer::ApplyAttributes()
+{
+    if (targetIdAttr_)
+    {
+        Scene* scene = GetScene();
+        if (scene)
+            target_ = scene->GetNode(targetIdAttr_);
+        targetIdAttr_ = 0;
+    }
+}
+
+void SceneStreamer::SetCellSize(float size)
+{
+    size = Max(size, M_EPSILON);
+    if (size != cellSize_)
+    {
+        // Existing cells no longer correspond to the coordinates
+        UnloadAllCells();
+        cellSize_ = size;
+        MarkNetworkUpdate();
+    }
+}
+
+void SceneStreamer::SetLoadDistance(float distance)
+{
+    loadDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::SetUnloadDistance(float distance)
+{
+    unloadDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::SetCellFileFormat(const String& format)
+{
+    if (format != cellFileFormat_)
+    {
+        UnloadAllCells();
+        cellFileFormat_ = format;
+        MarkNetworkUpdate();
+    }
+}
+
+void SceneStreamer::SetTarget(Node* target)
+{
+    target_ = target;
+    targetIdAttr_ = 0;
+    MarkNetworkUpdate();
+}
+
+void SceneStreamer::UnloadAllCells()
+{
+    for (HashMap<unsigned, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        if (!BeginUnload(cell) && cell.node_)
+            cell.node_->Remove();
+    }
+    
+    cells_.Clear();
+}
+
+String SceneStreamer::GetCellFileName(const IntVector2& coords) const
+{
+    return ToString(cellFileFormat_.CString(), coords.x_, coords.y_);
+}
+
+IntVector2 SceneStreamer::GetCellCoords(const Vector3& position) const
+{
+    return IntVector2((int)floorf(position.x_ / cellSize_), (int)floorf(position.z_ / cellSize_));
+}
+
+unsigned SceneStreamer::GetNumLoadedCells() const
+{
+    unsigned numLoaded = 0;
+    for (HashMap<unsigned, StreamingCell>::ConstIterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ == CELL_LOADED)
+            ++numLoaded;
+    }
+    return numLoaded;
+}
+
+bool SceneStreamer::IsCellLoaded(const IntVector2& coords) const
+{
+    HashMap<unsigned, StreamingCell>::ConstIterator i = cells_.Find(GetCellKey(coords));
+    return i != cells_.End() && i->second_.state_ == CELL_LOADED;
+}
+
+Node* SceneStreamer::GetCellNode(const IntVector2& coords) const
+{
+    HashMap<unsigned, StreamingCell>::ConstIterator i = cells_.Find(GetCellKey(coords));
+    return i != cells_.End() ? i->second_.node_.Get() : 0;
+}
+
+void SceneStreamer::SetTargetIdAttr(unsigned value)
+{
+    // The node may not exist yet when loading, so resolve in ApplyAttributes()
+    targetIdAttr_ = value;
+    target_.Reset();
+}
+
+unsigned SceneStreamer::GetTargetIdAttr() const
+{
+    return target_ ? target_->GetID() : targetIdAttr_;
+}
+
+void SceneStreamer::OnNodeSet(Node* node)
+{
+    if (node)
+    {
+        Scene* scene = GetScene();
+        if (scene)
+            SubscribeToEvent(scene, E_SCENEUPDATE, HANDLER(SceneStreamer, HandleSceneUpdate));
+        SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, HANDLER(SceneStreamer, HandleResourceBackgroundLoaded));
+    }
+    else
+    {
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+        UnsubscribeFromEvent(E_RESOURCEBACKGROUNDLOADED);
+    }
+}
+
+void SceneStreamer::UpdateCells()
+{
+    if (!node_ || !target_)
+        return;
+    
+    Vector3 position = node_->GetWorldTransform().Inverse() * target_->GetWorldPosition();
+    
+    // Unload cells that have moved out of range
+    for (HashMap<unsigned, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End();)
+    {
+        StreamingCell& cell = i->second_;
+        if (cell.state_ != CELL_UNLOADING && GetCellDistance(position, cell.coords_) > unloadDistance_ && BeginUnload(cell))
+            i = cells_.Erase(i);
+        else
+            ++i;
+    }
+    
+    // Queue loading of new cells in range. Nearer cells get a higher background loading priority
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    IntVector2 minCoords = GetCellCoords(position - Vector3(loadDistance_, 0.0f, loadDistance_));
+    IntVector2 maxCoords = GetCellCoords(position + Vector3(loadDistance_, 0.0f, loadDistance_));
+    
+    for (int z = minCoords.y_; z <= maxCoords.y_; ++z)
+    {
+        for (int x = minCoords.x_; x <= maxCoords.x_; ++x)
+        {
+            IntVector2 coords(x, z);
+            unsigned key = GetCellKey(coords);
+            if (cells_.Contains(key))
+                continue;
+            
+            float distance = GetCellDistance(position, coords);
+            if (distance > loadDistance_)
+                continue;
+            
+            StreamingCell& cell = cells_[key];
+            cell.coords_ = coords;
+            cell.fileName_ = cache->SanitateResourceName(GetCellFileName(coords));
+            
+            if (!cache->Exists(cell.fileName_))
+                cell.state_ = CELL_EMPTY;
+            else if (!cache->BackgroundLoadResource<XMLFile>(cell.fileName_, true, 0, -(int)distance))
+            {
+                // Either already loaded, or queued by someone else, in which case wait for the loaded event
+                cell.xmlFile_ = cache->GetExistingResource<XMLFile>(cell.fileName_);
+                if (cell.xmlFile_)
+                {
+                    cell.state_ = CELL_LOADING_RESOURCES;
+                    GetScene()->PreloadResourcesXML(cell.xmlFile_->GetRoot(), cell.resources_);
+                }
+            }
+        }
+    }
+}
+
+void SceneStreamer::UpdateCellNodes()
+{
+    HiresTimer loadTimer;
+    long long maxUSec = GetScene()->GetAsyncLoadingMs() * 1000;
+    
+    for (HashMap<unsigned, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End();)
+    {
+        StreamingCell& cell = i->second_;
+        
+        if (cell.state_ == CELL_LOADING_RESOURCES && cell.resources_.Empty())
+            BeginInstantiate(cell);
+        
+        // Instantiate one root-level child node at a time until out of time
+        if (cell.state_ == CELL_INSTANTIATING)
+        {
+            Node* cellNode = cell.node_;
+            if (!cellNode)
+            {
+                // Removed from outside
+                cell.xmlFile_.Reset();
+                cell.state_ = CELL_EMPTY;
+            }
+            else
+            {
+                while (cell.nextElement_ && loadTimer.GetUSec(false) < maxUSec)
+                {
+                    unsigned nodeID = cell.nextElement_.GetInt("id");
+                    Node* newNode = cellNode->CreateChild(0, LOCAL);
+                    cell.resolver_.AddNode(nodeID, newNode);
+                    newNode->LoadXML(cell.nextElement_, cell.resolver_, true, true, LOCAL);
+                    cell.nextElement_ = cell.nextElement_.GetNext("node");
+                }
+                
+                if (!cell.nextElement_)
+                    FinishInstantiate(cell);
+            }
+        }
+        
+        // Remove one root-level child node at a time until out of time, then the cell root node
+        if (cell.state_ == CELL_UNLOADING)
+        {
+            Node* cellNode = cell.node_;
+            while (cellNode && cellNode->GetNumChildren() && loadTimer.GetUSec(false) < maxUSec)
+                cellNode->RemoveChild(cellNode->GetChildren().Back());
+            
+            if (!cellNode || !cellNode->GetNumChildren())
+            {
+                if (cellNode)
+                    cellNode->Remove();
+                i = cells_.Erase(i);
+                continue;
+            }
+        }
+        
+        ++i;
+    }
+}
+
+void SceneStreamer::BeginInstantiate(StreamingCell& cell)
+{
+    XMLElement rootElement = cell.xmlFile_->GetRoot();
+    
+    // The cell file's root element is loaded into the cell root node, but its children are instantiated incrementally
+    Node* cellNode = node_->CreateChild(0, LOCAL);
+    cell.resolver_.AddNode(rootElement.GetInt("id"), cellNode);
+    if (!cellNode->LoadXML(rootElement, cell.resolver_, false, true, LOCAL))
+    {
+        LOGERROR("Failed to load scene streaming cell " + cell.fileName_);
+        cellNode->Remove();
+        cell.resolver_.Reset();
+        cell.xmlFile_.Reset();
+        cell.state_ = CELL_EMPTY;
+        return;
+    }
+    
+    // Cells are loaded again from their own files, so do not save them with the scene
+    cellNode->SetTemporary(true);
+    cell.node_ = cellNode;
+    cell.nextElement_ = rootElement.GetChild("node");
+    cell.state_ = CELL_INSTANTIATING;
+}
+
+void SceneStreamer::FinishInstantiate(StreamingCell& cell)
+{
+    cell.resolver_.Resolve();
+    cell.node_->ApplyAttributes();
+    cell.nextElement_ = XMLElement::EMPTY;
+    cell.xmlFile_.Reset();
+    GetSubsystem<ResourceCache>()->ReleaseResource(XMLFile::GetTypeStatic(), cell.fileName_);
+    cell.state_ = CELL_LOADED;
+    
+    using namespace SceneCellLoaded;
+    
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_SCENE] = GetScene();
+    eventData[P_NODE] = cell.node_.Get();
+    eventData[P_CELL] = cell.coords_;
+    SendEvent(E_SCENECELLLOADED, eventData);
+}
+
+bool SceneStreamer::BeginUnload(StreamingCell& cell)
+{
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    
+    switch (cell.state_)
+    {
+    case CELL_LOADING_FILE:
+        cache->CancelBackgroundLoadResource(XMLFile::GetTypeStatic(), cell.fileName_);
+        return true;
+        
+    case CELL_LOADING_RESOURCES:
+        // The resources continue loading to the cache, to be released by its memory budgets
+        cell.xmlFile_.Reset();
+        cache->ReleaseResource(XMLFile::GetTypeStatic(), cell.fileName_);
+        return true;
+        
+    case CELL_LOADED:
+        {
+            using namespace SceneCellUnloaded;
+            
+            VariantMap& eventData = GetEventDataMap();
+            eventData[P_SCENE] = GetScene();
+            eventData[P_NODE] = cell.node_.Get();
+            eventData[P_CELL] = cell.coords_;
+            SendEvent(E_SCENECELLUNLOADED, eventData);
+        }
+        cell.state_ = CELL_UNLOADING;
+        return false;
+        
+    case CELL_INSTANTIATING:
+        cell.resolver_.Reset();
+        cell.nextElement_ = XMLElement::EMPTY;
+        cell.xmlFile_.Reset();
+        cache->ReleaseResource(XMLFile::GetTypeStatic(), cell.fileName_);
+        cell.state_ = CELL_UNLOADING;
+        return false;
+        
+    case CELL_UNLOADING:
+        return false;
+        
+    default:
+        return true;
+    }
+}
+
+float SceneStreamer::GetCellDistance(const Vector3& position, const IntVector2& coords) const
+{
+    float minX = coords.x_ * cellSize_;
+    float minZ = coords.y_ * cellSize_;
+    float dx = Max(Max(minX - position.x_, position.x_ - (minX + cellSize_)), 0.0f);
+    float dz = Max(Max(minZ - position.z_, position.z_ - (minZ + cellSize_)), 0.0f);
+    return sqrtf(dx * dx + dz * dz);
+}
+
+void SceneStreamer::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+    if (!IsEnabledEffective())
+        return;
+    
+    PROFILE(UpdateSceneStreaming);
+    
+    UpdateCells();
+    UpdateCellNodes();
+}
+
+void SceneStreamer::HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ResourceBackgroundLoaded;
+    
+    const String& name = eventData[P_RESOURCENAME].GetString();
+    StringHash nameHash(name);
+    
+    for (HashMap<unsigned, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        
+        if (cell.state_ == CELL_LOADING_FILE && cell.fileName_ == name)
+        {
+            Resource* resource = static_cast<Resource*>(eventData[P_RESOURCE].GetPtr());
+            if (eventData[P_SUCCESS].GetBool() && resource && resource->GetType() == XMLFile::GetTypeStatic())
+            {
+                cell.xmlFile_ = static_cast<XMLFile*>(resource);
+                cell.state_ = CELL_LOADING_RESOURCES;
+                GetScene()->PreloadResourcesXML(cell.xmlFile_->GetRoot(), cell.resources_);
+            }
+            else
+            {
+                LOGERROR("Failed to load scene streaming cell " + name);
+                cell.state_ = CELL_EMPTY;
+            }
+        }
+        else if (cell.state_ == CELL_LOADING_RESOURCES)
+            cell.resources_.Erase(nameHash);
+    }
+}
+
+}
@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashSet.h"
+#include "../Math/Vector2.h"
+#include "../Scene/Component.h"
+#include "../Scene/SceneResolver.h"
+#include "../Resource/XMLFile.h"
+
+namespace Urho3D
+{
+
+/// Scene streaming cell state.
+enum StreamingCellState
+{
+    /// Loading the cell file in the background.
+    CELL_LOADING_FILE = 0,
+    /// Loading the resources referenced by the cell in the background.
+    CELL_LOADING_RESOURCES,
+    /// Instantiating the cell's nodes incrementally.
+    CELL_INSTANTIATING,
+    /// Fully loaded.
+    CELL_LOADED,
+    /// Removing the cell's nodes incrementally.
+    CELL_UNLOADING,
+    /// No cell file exists, or loading failed.
+    CELL_EMPTY
+};
+
+/// Scene streaming cell.
+struct StreamingCell
+{
+    /// Construct.
+    StreamingCell() :
+        state_(CELL_LOADING_FILE)
+    {
+    }
+    
+    /// Cell coordinates.
+    IntVector2 coords_;
+    /// Cell file name.
+    String fileName_;
+    /// State.
+    StreamingCellState state_;
+    /// Cell file, kept until instantiated.
+    SharedPtr<XMLFile> xmlFile_;
+    /// Next child node element to instantiate.
+    XMLElement nextElement_;
+    /// Resource name hashes left to load.
+    HashSet<StringHash> resources_;
+    /// Node and component ID resolver for the instantiation.
+    SceneResolver resolver_;
+    /// Cell root node.
+    WeakPtr<Node> node_;
+};
+
+/// %Scene streaming component. Divides the XZ plane into square cells, each loaded from its own XML node prefab file. Cells are loaded in the background, instantiated incrementally and unloaded according to their distance from a target node.
+class URHO3D_API SceneStreamer : public Component
+{
+    OBJECT(SceneStreamer);
+    
+public:
+    /// Construct.
+    SceneStreamer(Context* context);
+    /// Destruct.
+    virtual ~SceneStreamer();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+    
+    /// Apply attribute changes that can not be applied immediately.
+    virtual void ApplyAttributes();
+    
+    /// Set cell size in world units.
+    void SetCellSize(float size);
+    /// Set distance from the target within which cells are loaded.
+    void SetLoadDistance(float distance);
+    /// Set distance from the target beyond which cells are unloaded. Should be larger than the load distance to avoid loading and unloading repeatedly at cell borders.
+    void SetUnloadDistance(float distance);
+    /// Set cell file name format. The cell X and Z coordinates are substituted for two %d format specifiers.
+    void SetCellFileFormat(const String& format);
+    /// Set target node whose position drives the streaming, typically the camera or player.
+    void SetTarget(Node* target);
+    /// Unload all cells immediately.
+    void UnloadAllCells();
+    
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+    /// Return load distance.
+    float GetLoadDistance() const { return loadDistance_; }
+    /// Return unload distance.
+    float GetUnloadDistance() const { return unloadDistance_; }
+    /// Return cell file name format.
+    const String& GetCellFileFormat() const { return cellFileFormat_; }
+    /// Return target node.
+    Node* GetTarget() const { return target_; }
+    /// Return cell file name for cell coordinates.
+    String GetCellFileName(const IntVector2& coords) const;
+    /// Return cell coordinates for a position in the component's node space.
+    IntVector2 GetCellCoords(const Vector3& position) const;
+    /// Return number of cells in any state.
+    unsigned GetNumCells() const { return cells_.Size(); }
+    /// Return number of fully loaded cells.
+    unsigned GetNumLoadedCells() const;
+    /// Return whether a cell is fully loaded.
+    bool IsCellLoaded(const IntVector2& coords) const;
+    /// Return cell root node, or null if not instantiated.
+    Node* GetCellNode(const IntVector2& coords) const;
+    
+    /// Set target node ID attribute.
+    void SetTargetIdAttr(unsigned value);
+    /// Return target node ID attribute.
+    unsigned GetTargetIdAttr() const;
+    
+protected:
+    /// Handle node being assigned.
+    virtual void OnNodeSet(Node* node);
+    
+private:
+    /// Queue loading of cells within the load distance and unloading of cells beyond the unload distance.
+    void UpdateCells();
+    /// Instantiate and remove cell nodes within the time budget.
+    void UpdateCellNodes();
+    /// Start instantiating a cell whose file and resources have been loaded.
+    void BeginInstantiate(StreamingCell& cell);
+    /// Finish instantiating a cell.
+    void FinishInstantiate(StreamingCell& cell);
+    /// Begin unloading a cell. Return true if nothing was instantiated and the cell can be forgotten immediately.
+    bool BeginUnload(StreamingCell& cell);
+    /// Return distance from a position to the nearest point of a cell in the XZ plane.
+    float GetCellDistance(const Vector3& position, const IntVector2& coords) const;
+    /// Handle scene update event.
+    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle a background loaded resource completing.
+    void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData);
+    
+    /// Cells by packed coordinates.
+    HashMap<unsigned, StreamingCell> cells_;
+    /// Target node.
+    WeakPtr<Node> target_;
+    /// Cell file name format.
+    String cellFileFormat_;
+    /// Cell size.
+    float cellSize_;
+    /// Load distance.
+    float loadDistance_;
+    /// Unload distance.
+    float unloadDistance_;
+    /// Target node ID from attributes, to be resolved in ApplyAttributes().
+    unsigned targetIdAttr_;
+};
+
+}
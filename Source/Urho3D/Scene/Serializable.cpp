@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 //
 
+#include "../IO/BitStream.h"
 #include "../Core/Context.h"
 #include "../IO/Deserializer.h"
 #include "../IO/Log.h"
@@ -52,9 +53,193 @@ static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, con
     return netAttrIndex; // Could not remap
 }
 
+/// Return the number of bits of a bit-packed network attribute, or 0 if it is written in full precision.
+static unsigned GetPackedBits(const AttributeInfo& attr)
+{
+    const AttributeEncoding& encoding = attr.encoding_;
+
+    if (encoding.mode_ == AEM_QUANTIZED)
+    {
+        switch (attr.type_)
+        {
+        case VAR_FLOAT:
+            return encoding.bits_;
+
+        case VAR_VECTOR2:
+            return 2 * encoding.bits_;
+
+        case VAR_VECTOR3:
+            return 3 * encoding.bits_;
+
+        case VAR_VECTOR4:
+            return 4 * encoding.bits_;
+
+        default:
+            break;
+        }
+    }
+    else if (encoding.mode_ == AEM_SMALLEST_THREE && attr.type_ == VAR_QUATERNION)
+        return 2 + 3 * encoding.bits_;
+
+    return 0;
+}
+
+/// Write a bit-packed network attribute.
+static void WritePackedAttribute(BitWriter& dest, const AttributeInfo& attr, const Variant& value)
+{
+    const AttributeEncoding& encoding = attr.encoding_;
+    float min = encoding.min_;
+    float max = encoding.max_;
+    unsigned bits = encoding.bits_;
+
+    switch (attr.type_)
+    {
+    case VAR_FLOAT:
+        dest.WriteQuantizedFloat(value.GetFloat(), min, max, bits);
+        break;
+
+    case VAR_VECTOR2:
+        {
+            const Vector2& vector = value.GetVector2();
+            dest.WriteQuantizedFloat(vector.x_, min, max, bits);
+            dest.WriteQuantizedFloat(vector.y_, min, max, bits);
+        }
+        break;
+
+    case VAR_VECTOR3:
+        {
+            const Vector3& vector = value.GetVector3();
+            dest.WriteQuantizedFloat(vector.x_, min, max, bits);
+            dest.WriteQuantizedFloat(vector.y_, min, max, bits);
+            dest.WriteQuantizedFloat(vector.z_, min, max, bits);
+        }
+        break;
+
+    case VAR_VECTOR4:
+        {
+            const Vector4& vector = value.GetVector4();
+            dest.WriteQuantizedFloat(vector.x_, min, max, bits);
+            dest.WriteQuantizedFloat(vector.y_, min, max, bits);
+            dest.WriteQuantizedFloat(vector.z_, min, max, bits);
+            dest.WriteQuantizedFloat(vector.w_, min, max, bits);
+        }
+        break;
+
+    case VAR_QUATERNION:
+        dest.WriteSmallestThree(value.GetQuaternion(), bits);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/// Read a bit-packed network attribute.
+static Variant ReadPackedAttribute(BitReader& source, const AttributeInfo& attr)
+{
+    const AttributeEncoding& encoding = attr.encoding_;
+    float min = encoding.min_;
+    float max = encoding.max_;
+    unsigned bits = encoding.bits_;
+
+    switch (attr.type_)
+    {
+    case VAR_FLOAT:
+        return source.ReadQuantizedFloat(min, max, bits);
+
+    case VAR_VECTOR2:
+        {
+            float x = source.ReadQuantizedFloat(min, max, bits);
+            float y = source.ReadQuantizedFloat(min, max, bits);
+            return Vector2(x, y);
+        }
+
+    case VAR_VECTOR3:
+        {
+            float x = source.ReadQuantizedFloat(min, max, bits);
+            float y = source.ReadQuantizedFloat(min, max, bits);
+            float z = source.ReadQuantizedFloat(min, max, bits);
+            return Vector3(x, y, z);
+        }
+
+    case VAR_VECTOR4:
+        {
+            float x = source.ReadQuantizedFloat(min, max, bits);
+            float y = source.ReadQuantizedFloat(min, max, bits);
+            float z = source.ReadQuantizedFloat(min, max, bits);
+            float w = source.ReadQuantizedFloat(min, max, bits);
+            return Vector4(x, y, z, w);
+        }
+
+    case VAR_QUATERNION:
+        return source.ReadSmallestThree(bits);
+
+    default:
+        return Variant::EMPTY;
+    }
+}
+
+/// Write the network attributes selected by the bits: full precision attributes first in index order, followed by the bit-packed attributes.
+static void WriteNetworkAttributes(Serializer& dest, const Vector<AttributeInfo>& attributes, const Vector<Variant>& values,
+    const DirtyBits& attributeBits)
+{
+    BitWriter packed;
+
+    for (unsigned i = 0; i < attributes.Size(); ++i)
+    {
+        if (!attributeBits.IsSet(i))
+            continue;
+
+        const AttributeInfo& attr = attributes[i];
+        if (GetPackedBits(attr))
+            WritePackedAttribute(packed, attr, values[i]);
+        else
+            dest.WriteVariantData(values[i]);
+    }
+
+    if (packed.GetSize())
+        dest.Write(packed.GetData(), packed.GetSize());
+}
+
+/// Return the bits of the latest data attributes.
+static DirtyBits GetLatestDataBits(const Vector<AttributeInfo>& attributes)
+{
+    DirtyBits ret;
+    for (unsigned i = 0; i < attributes.Size(); ++i)
+    {
+        if (attributes[i].mode_ & AM_LATESTDATA)
+            ret.Set(i);
+    }
+
+    return ret;
+}
+
+AttributeEncoding::AttributeEncoding(float min, float max, float precision) :
+    mode_(AEM_QUANTIZED),
+    min_(min),
+    max_(max),
+    bits_(GetQuantizationBits(min, max, precision))
+{
+}
+
+bool AttributeAccessor::Write(const Serializable* ptr, Serializer& dest) const
+{
+    Variant value;
+    Get(ptr, value);
+    return dest.WriteVariantData(value);
+}
+
+bool AttributeAccessor::Equals(const Serializable* ptr, const Variant& value) const
+{
+    Variant current;
+    Get(ptr, current);
+    return current == value;
+}
+
 Serializable::Serializable(Context* context) :
     Object(context),
     networkState_(0),
+    networkDirtyTracking_(false),
     instanceDefaultValues_(0),
     temporary_(false)
 {
@@ -292,17 +477,13 @@ bool Serializable::Save(Serializer& dest) const
     if (!attributes)
         return true;
 
-    Variant value;
-
     for (unsigned i = 0; i < attributes->Size(); ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
         if (!(attr.mode_ & AM_FILE))
             continue;
 
-        OnGetAttribute(attr, value);
-
-        if (!dest.WriteVariantData(value))
+        if (!WriteAttributeData(attr, dest))
         {
             LOGERROR("Could not save " + GetTypeName() + ", writing to stream failed");
             return false;
@@ -559,6 +740,29 @@ void Serializable::SetInterceptNetworkUpdate(const String& attributeName, bool e
     }
 }
 
+void Serializable::SetNetworkDirtyTracking(bool enable)
+{
+    if (enable != networkDirtyTracking_)
+    {
+        networkDirtyTracking_ = enable;
+        // Compare all attributes once on the next update, as changes made before may not have been marked
+        if (enable && networkState_)
+        {
+            unsigned numAttributes = GetNumNetworkAttributes();
+            for (unsigned i = 0; i < numAttributes; ++i)
+                networkState_->markedAttributes_.Set(i);
+        }
+        MarkNetworkUpdate();
+    }
+}
+
+void Serializable::MarkNetworkAttributeDirty(unsigned index)
+{
+    AllocateNetworkState();
+    networkState_->markedAttributes_.Set(index);
+    MarkNetworkUpdate();
+}
+
 void Serializable::AllocateNetworkState()
 {
     if (!networkState_)
@@ -595,12 +799,7 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
     // First write the change bitfield, then attribute data for non-default attributes
     dest.WriteUByte(timeStamp);
     dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteNetworkAttributes(dest, *attributes, networkState_->currentValues_, attributeBits);
 }
 
 void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
@@ -620,13 +819,16 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     // First write the change bitfield, then attribute data for changed attributes
     // Note: the attribute bits should not contain LATESTDATA attributes
     dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
 
-    for (unsigned i = 0; i < numAttributes; ++i)
+    // If the shared data encoded by PrepareNetworkUpdate() has the same attributes, copy it instead of re-encoding
+    if (networkState_->deltaData_.GetSize() && networkState_->deltaBits_ == attributeBits)
     {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        dest.Write(networkState_->deltaData_.GetData(), networkState_->deltaData_.GetSize());
+        return;
     }
+
+    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
+    WriteNetworkAttributes(dest, *attributes, networkState_->currentValues_, attributeBits);
 }
 
 void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
@@ -641,14 +843,55 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
     dest.WriteUByte(timeStamp);
 
+    if (networkState_->latestData_.GetSize())
+    {
+        dest.Write(networkState_->latestData_.GetData(), networkState_->latestData_.GetSize());
+        return;
+    }
+
+    WriteNetworkAttributes(dest, *attributes, networkState_->currentValues_, GetLatestDataBits(*attributes));
+}
+
+void Serializable::EncodeNetworkUpdate(const DirtyBits& changedBits)
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    networkState_->deltaBits_.ClearAll();
+    networkState_->deltaData_.Clear();
+
+    // Sharing pays off only when several connections are tracking this object
+    if (!attributes || networkState_->replicationStates_.Size() < 2)
+    {
+        networkState_->latestData_.Clear();
+        return;
+    }
+
+    unsigned numAttributes = attributes->Size();
+    bool latestDataChanged = false;
+
     for (unsigned i = 0; i < numAttributes; ++i)
     {
-        if (attributes->At(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        if (changedBits.IsSet(i))
+        {
+            if (attributes->At(i).mode_ & AM_LATESTDATA)
+                latestDataChanged = true;
+            else
+                networkState_->deltaBits_.Set(i);
+        }
+    }
+
+    if (networkState_->deltaBits_.Count())
+    {
+        networkState_->deltaData_.Write(networkState_->deltaBits_.data_, (numAttributes + 7) >> 3);
+        WriteNetworkAttributes(networkState_->deltaData_, *attributes, networkState_->currentValues_, networkState_->deltaBits_);
+    }
+
+    // The latest data stays valid as long as none of its attributes change
+    if (latestDataChanged || !networkState_->latestData_.GetSize())
+    {
+        networkState_->latestData_.Clear();
+        WriteNetworkAttributes(networkState_->latestData_, *attributes, networkState_->currentValues_, GetLatestDataBits(*attributes));
     }
 }
 
@@ -660,78 +903,239 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
 
     unsigned numAttributes = attributes->Size();
     DirtyBits attributeBits;
-    bool changed = false;
 
-    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
     source.Read(attributeBits.data_, (numAttributes + 7) >> 3);
 
+    return ReadNetworkAttributes(source, *attributes, attributeBits, timeStamp);
+}
+
+bool Serializable::ReadLatestDataUpdate(Deserializer& source)
+{
+    const Vector<AttributeInfo>* attributes = GetNetworkAttributes();
+    if (!attributes)
+        return false;
+
+    unsigned char timeStamp = source.ReadUByte();
+
+    return ReadNetworkAttributes(source, *attributes, GetLatestDataBits(*attributes), timeStamp);
+}
+
+bool Serializable::ReadNetworkAttributes(Deserializer& source, const Vector<AttributeInfo>& attributes, const DirtyBits& attributeBits,
+    unsigned char timeStamp)
+{
+    unsigned numAttributes = attributes.Size();
+    unsigned numPackedBits = 0;
+    bool changed = false;
+
+    // Full precision attributes come first in index order, followed by the bit-packed attributes
     for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
     {
-        if (attributeBits.IsSet(i))
+        if (!attributeBits.IsSet(i))
+            continue;
+
+        const AttributeInfo& attr = attributes[i];
+        unsigned packedBits = GetPackedBits(attr);
+        if (packedBits)
+            numPackedBits += packedBits;
+        else
+            changed |= ApplyNetworkAttribute(attr, i, source.ReadVariant(attr.type_), timeStamp);
+    }
+
+    if (numPackedBits && !source.IsEof())
+    {
+        PODVector<unsigned char> packedData((numPackedBits + 7) >> 3);
+        packedData.Resize(source.Read(&packedData[0], packedData.Size()));
+        BitReader packed(packedData.Size() ? &packedData[0] : 0, packedData.Size());
+
+        for (unsigned i = 0; i < numAttributes && !packed.IsEof(); ++i)
         {
-            const AttributeInfo& attr = attributes->At(i);
-            if (!(interceptMask & (1ULL << i)))
-            {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
-                changed = true;
-            }
-            else
-            {
-                using namespace InterceptNetworkUpdate;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_SERIALIZABLE] = this;
-                eventData[P_TIMESTAMP] = (unsigned)timeStamp;
-                eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
-                eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
-                SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
-            }
+            const AttributeInfo& attr = attributes[i];
+            if (attributeBits.IsSet(i) && GetPackedBits(attr))
+                changed |= ApplyNetworkAttribute(attr, i, ReadPackedAttribute(packed, attr), timeStamp);
         }
     }
 
     return changed;
 }
 
-bool Serializable::ReadLatestDataUpdate(Deserializer& source)
+bool Serializable::ApplyNetworkAttribute(const AttributeInfo& attr, unsigned index, const Variant& value, unsigned char timeStamp)
 {
-    const Vector<AttributeInfo>* attributes = GetNetworkAttributes();
-    if (!attributes)
+    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
+
+    if (!(interceptMask & (1ULL << index)))
+    {
+        OnSetAttribute(attr, value);
+        return true;
+    }
+    else
+    {
+        using namespace InterceptNetworkUpdate;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_SERIALIZABLE] = this;
+        eventData[P_TIMESTAMP] = (unsigned)timeStamp;
+        eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, index);
+        eventData[P_NAME] = attr.name_;
+        eventData[P_VALUE] = value;
+        SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
         return false;
+    }
+}
 
-    unsigned numAttributes = attributes->Size();
-    bool changed = false;
+bool Serializable::WriteAttributeData(const AttributeInfo& attr, Serializer& dest) const
+{
+    // Attributes that point elsewhere than the Serializable, such as script object members, may be handled specially by
+    // subclasses, so always read them through OnGetAttribute()
+    if (attr.ptr_)
+    {
+        Variant value;
+        OnGetAttribute(attr, value);
+        return dest.WriteVariantData(value);
+    }
 
-    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
-    unsigned char timeStamp = source.ReadUByte();
+    if (attr.accessor_)
+        return attr.accessor_->Write(this, dest);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    const void* src = reinterpret_cast<const unsigned char*>(this) + attr.offset_;
+
+    switch (attr.type_)
     {
-        const AttributeInfo& attr = attributes->At(i);
-        if (attr.mode_ & AM_LATESTDATA)
+    case VAR_INT:
+        // If enum type, use the low 8 bits only
+        if (attr.enumNames_)
+            return dest.WriteInt(*(reinterpret_cast<const unsigned char*>(src)));
+        else
+            return dest.WriteInt(*(reinterpret_cast<const int*>(src)));
+
+    case VAR_BOOL:
+        return dest.WriteBool(*(reinterpret_cast<const bool*>(src)));
+
+    case VAR_FLOAT:
+        return dest.WriteFloat(*(reinterpret_cast<const float*>(src)));
+
+    case VAR_VECTOR2:
+        return dest.WriteVector2(*(reinterpret_cast<const Vector2*>(src)));
+
+    case VAR_VECTOR3:
+        return dest.WriteVector3(*(reinterpret_cast<const Vector3*>(src)));
+
+    case VAR_VECTOR4:
+        return dest.WriteVector4(*(reinterpret_cast<const Vector4*>(src)));
+
+    case VAR_QUATERNION:
+        return dest.WriteQuaternion(*(reinterpret_cast<const Quaternion*>(src)));
+
+    case VAR_COLOR:
+        return dest.WriteColor(*(reinterpret_cast<const Color*>(src)));
+
+    case VAR_STRING:
+        return dest.WriteString(*(reinterpret_cast<const String*>(src)));
+
+    case VAR_BUFFER:
+        return dest.WriteBuffer(*(reinterpret_cast<const PODVector<unsigned char>*>(src)));
+
+    case VAR_RESOURCEREF:
+        return dest.WriteResourceRef(*(reinterpret_cast<const ResourceRef*>(src)));
+
+    case VAR_RESOURCEREFLIST:
+        return dest.WriteResourceRefList(*(reinterpret_cast<const ResourceRefList*>(src)));
+
+    case VAR_VARIANTVECTOR:
+        return dest.WriteVariantVector(*(reinterpret_cast<const VariantVector*>(src)));
+
+    case VAR_VARIANTMAP:
+        return dest.WriteVariantMap(*(reinterpret_cast<const VariantMap*>(src)));
+
+    case VAR_INTRECT:
+        return dest.WriteIntRect(*(reinterpret_cast<const IntRect*>(src)));
+
+    case VAR_INTVECTOR2:
+        return dest.WriteIntVector2(*(reinterpret_cast<const IntVector2*>(src)));
+
+    default:
         {
-            if (!(interceptMask & (1ULL << i)))
-            {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
-                changed = true;
-            }
-            else
-            {
-                using namespace InterceptNetworkUpdate;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_SERIALIZABLE] = this;
-                eventData[P_TIMESTAMP] = (unsigned)timeStamp;
-                eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
-                eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
-                SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
-            }
+            Variant value;
+            OnGetAttribute(attr, value);
+            return dest.WriteVariantData(value);
         }
     }
+}
 
-    return changed;
+bool Serializable::IsAttributeEqual(const AttributeInfo& attr, const Variant& value) const
+{
+    if (attr.ptr_)
+    {
+        Variant current;
+        OnGetAttribute(attr, current);
+        return current == value;
+    }
+
+    if (attr.accessor_)
+        return attr.accessor_->Equals(this, value);
+
+    const void* src = reinterpret_cast<const unsigned char*>(this) + attr.offset_;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        if (attr.enumNames_)
+            return value == (int)*(reinterpret_cast<const unsigned char*>(src));
+        else
+            return value == *(reinterpret_cast<const int*>(src));
+
+    case VAR_BOOL:
+        return value == *(reinterpret_cast<const bool*>(src));
+
+    case VAR_FLOAT:
+        return value == *(reinterpret_cast<const float*>(src));
+
+    case VAR_VECTOR2:
+        return value == *(reinterpret_cast<const Vector2*>(src));
+
+    case VAR_VECTOR3:
+        return value == *(reinterpret_cast<const Vector3*>(src));
+
+    case VAR_VECTOR4:
+        return value == *(reinterpret_cast<const Vector4*>(src));
+
+    case VAR_QUATERNION:
+        return value == *(reinterpret_cast<const Quaternion*>(src));
+
+    case VAR_COLOR:
+        return value == *(reinterpret_cast<const Color*>(src));
+
+    case VAR_STRING:
+        return value == *(reinterpret_cast<const String*>(src));
+
+    case VAR_BUFFER:
+        return value == *(reinterpret_cast<const PODVector<unsigned char>*>(src));
+
+    case VAR_RESOURCEREF:
+        return value == *(reinterpret_cast<const ResourceRef*>(src));
+
+    case VAR_RESOURCEREFLIST:
+        return value == *(reinterpret_cast<const ResourceRefList*>(src));
+
+    case VAR_VARIANTVECTOR:
+        return value == *(reinterpret_cast<const VariantVector*>(src));
+
+    case VAR_VARIANTMAP:
+        return value == *(reinterpret_cast<const VariantMap*>(src));
+
+    case VAR_INTRECT:
+        return value == *(reinterpret_cast<const IntRect*>(src));
+
+    case VAR_INTVECTOR2:
+        return value == *(reinterpret_cast<const IntVector2*>(src));
+
+    default:
+        {
+            Variant current;
+            OnGetAttribute(attr, current);
+            return current == value;
+        }
+    }
 }
 
 Variant Serializable::GetAttribute(unsigned index) const
@@ -24,6 +24,7 @@
 
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
+#include "../IO/Serializer.h"
 
 #include <cstddef>
 
@@ -32,7 +33,6 @@ namespace Urho3D
 
 class Connection;
 class Deserializer;
-class Serializer;
 class XMLElement;
 
 struct DirtyBits;
@@ -85,6 +85,10 @@ public:
     void SetTemporary(bool enable);
     /// Enable interception of an attribute from network updates. Intercepted attributes are sent as events instead of applying directly. This can be used to implement client side prediction.
     void SetInterceptNetworkUpdate(const String& attributeName, bool enable);
+    /// Set whether changed network attributes are marked explicitly with MarkNetworkAttributeDirty(). When enabled, network updates only compare the marked attributes instead of all of them.
+    void SetNetworkDirtyTracking(bool enable);
+    /// Mark a network attribute changed by its index in the network attributes, and mark for the next network update. Required for each change when network dirty tracking is enabled.
+    void MarkNetworkAttributeDirty(unsigned index);
     /// Allocate network attribute state.
     void AllocateNetworkState();
     /// Write initial delta network update.
@@ -97,6 +101,8 @@ public:
     bool ReadDeltaUpdate(Deserializer& source);
     /// Read and apply a network latest data update. Return true if attributes were changed.
     bool ReadLatestDataUpdate(Deserializer& source);
+    /// Write an attribute value to a stream in the same format as Serializer::WriteVariantData(). Offset and accessor attributes are written from their native type without a Variant. Return true if successful.
+    bool WriteAttributeData(const AttributeInfo& attr, Serializer& dest) const;
 
     /// Return attribute value by index. Return empty if illegal index.
     Variant GetAttribute(unsigned index) const;
@@ -112,16 +118,29 @@ public:
     unsigned GetNumNetworkAttributes() const;
     /// Return whether is temporary.
     bool IsTemporary() const { return temporary_; }
+    /// Return whether an attribute's current value equals a value. Offset and accessor attributes are compared in their native type without a Variant.
+    bool IsAttributeEqual(const AttributeInfo& attr, const Variant& value) const;
+    /// Return whether changed network attributes are marked explicitly.
+    bool GetNetworkDirtyTracking() const { return networkDirtyTracking_; }
     /// Return whether an attribute's network updates are being intercepted.
     bool GetInterceptNetworkUpdate(const String& attributeName) const;
     /// Return the network attribute state, if allocated.
     NetworkState* GetNetworkState() const { return networkState_; }
 
 protected:
+    /// Encode the delta and latest data updates of changed network attributes once, to be shared by all connections. Called by PrepareNetworkUpdate().
+    void EncodeNetworkUpdate(const DirtyBits& changedBits);
+
     /// Network attribute state.
     NetworkState* networkState_;
+    /// Network dirty tracking flag.
+    bool networkDirtyTracking_;
 
 private:
+    /// Read network attributes selected by the bits and apply or intercept them. Return true if attributes were changed.
+    bool ReadNetworkAttributes(Deserializer& source, const Vector<AttributeInfo>& attributes, const DirtyBits& attributeBits, unsigned char timeStamp);
+    /// Apply a network attribute, or send it as an event if intercepted. Return true if applied.
+    bool ApplyNetworkAttribute(const AttributeInfo& attr, unsigned index, const Variant& value, unsigned char timeStamp);
     /// Set instance-level default value. Allocate the internal data structure as necessary.
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
@@ -165,6 +184,22 @@ public:
         (classPtr->*setFunction_)((U)value.GetInt());
     }
 
+    /// Invoke getter function and write the value to a stream.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return dest.WriteInt((int)(classPtr->*getFunction_)());
+    }
+
+    /// Invoke getter function and compare the value.
+    virtual bool Equals(const Serializable* ptr, const Variant& value) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return value == (int)(classPtr->*getFunction_)();
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -215,6 +250,49 @@ template<typename T> struct MixedAttributeTrait
     typedef const T& ParameterType;
 };
 
+/// Write an int attribute value.
+inline bool WriteAttributeValue(Serializer& dest, int value) { return dest.WriteInt(value); }
+/// Write an unsigned attribute value.
+inline bool WriteAttributeValue(Serializer& dest, unsigned value) { return dest.WriteUInt(value); }
+/// Write a bool attribute value.
+inline bool WriteAttributeValue(Serializer& dest, bool value) { return dest.WriteBool(value); }
+/// Write a float attribute value.
+inline bool WriteAttributeValue(Serializer& dest, float value) { return dest.WriteFloat(value); }
+/// Write a Vector2 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Vector2& value) { return dest.WriteVector2(value); }
+/// Write a Vector3 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Vector3& value) { return dest.WriteVector3(value); }
+/// Write a Vector4 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Vector4& value) { return dest.WriteVector4(value); }
+/// Write a Quaternion attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Quaternion& value) { return dest.WriteQuaternion(value); }
+/// Write a Color attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Color& value) { return dest.WriteColor(value); }
+/// Write a String attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const String& value) { return dest.WriteString(value); }
+/// Write a StringHash attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const StringHash& value) { return dest.WriteUInt(value.Value()); }
+/// Write a buffer attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const PODVector<unsigned char>& value) { return dest.WriteBuffer(value); }
+/// Write a ResourceRef attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const ResourceRef& value) { return dest.WriteResourceRef(value); }
+/// Write a ResourceRefList attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const ResourceRefList& value) { return dest.WriteResourceRefList(value); }
+/// Write a VariantVector attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const VariantVector& value) { return dest.WriteVariantVector(value); }
+/// Write a VariantMap attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const VariantMap& value) { return dest.WriteVariantMap(value); }
+/// Write an IntRect attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const IntRect& value) { return dest.WriteIntRect(value); }
+/// Write an IntVector2 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const IntVector2& value) { return dest.WriteIntVector2(value); }
+/// Write a Matrix3 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Matrix3& value) { return dest.WriteMatrix3(value); }
+/// Write a Matrix3x4 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Matrix3x4& value) { return dest.WriteMatrix3x4(value); }
+/// Write a Matrix4 attribute value.
+inline bool WriteAttributeValue(Serializer& dest, const Matrix4& value) { return dest.WriteMatrix4(value); }
+
 /// Template implementation of the attribute accessor invoke helper class.
 template <typename T, typename U, typename Trait> class AttributeAccessorImpl : public AttributeAccessor
 {
@@ -247,6 +325,22 @@ public:
         (classPtr->*setFunction_)(value.Get<U>());
     }
 
+    /// Invoke getter function and write the value to a stream.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return WriteAttributeValue(dest, (classPtr->*getFunction_)());
+    }
+
+    /// Invoke getter function and compare the value.
+    virtual bool Equals(const Serializable* ptr, const Variant& value) const
+    {
+        assert(ptr);
+        const T* classPtr = static_cast<const T*>(ptr);
+        return value == (classPtr->*getFunction_)();
+    }
+
     /// Class-specific pointer to getter function.
     GetFunctionPtr getFunction_;
     /// Class-specific pointer to setter function.
@@ -88,25 +88,56 @@ void SmoothedTransform::Update(float constant, float squaredSnapThreshold)
         }
     }
 
-    // If smoothing has completed, unsubscribe from the update event
-    if (!smoothingMask_)
+    CheckCompleted();
+}
+
+void SmoothedTransform::UpdateInterpolation(float time, float squaredSnapThreshold)
+{
+    if (!node_ || snapshots_.Empty())
     {
-        UnsubscribeFromEvent(GetScene(), E_UPDATESMOOTHING);
-        subscribed_ = false;
+        snapshots_.Clear();
+        smoothingMask_ = SMOOTH_NONE;
+        CheckCompleted();
+        return;
+    }
+
+    // Discard snapshots that the interpolation time has passed, except the one to interpolate from
+    while (snapshots_.Size() > 1 && snapshots_[1].time_ <= time)
+        snapshots_.Erase(0);
+
+    const TransformSnapshot& from = snapshots_[0];
+    if (time < from.time_)
+        return;
+
+    if (snapshots_.Size() == 1)
+    {
+        // Reached the newest snapshot: hold it until more arrive
+        node_->SetTransform(from.position_, from.rotation_);
+        snapshots_.Clear();
+        smoothingMask_ = SMOOTH_NONE;
+    }
+    else
+    {
+        const TransformSnapshot& to = snapshots_[1];
+
+        // If position snaps, go to the end of the interval
+        if ((to.position_ - from.position_).LengthSquared() > squaredSnapThreshold)
+            node_->SetTransform(to.position_, to.rotation_);
+        else
+        {
+            float t = Clamp((time - from.time_) / (to.time_ - from.time_), 0.0f, 1.0f);
+            node_->SetTransform(from.position_.Lerp(to.position_, t), from.rotation_.Slerp(to.rotation_, t));
+        }
     }
+
+    CheckCompleted();
 }
 
 void SmoothedTransform::SetTargetPosition(const Vector3& position)
 {
     targetPosition_ = position;
     smoothingMask_ |= SMOOTH_POSITION;
-
-    // Subscribe to smoothing update if not yet subscribed
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    OnTargetChanged();
 
     SendEvent(E_TARGETPOSITION);
 }
@@ -115,12 +146,7 @@ void SmoothedTransform::SetTargetRotation(const Quaternion& rotation)
 {
     targetRotation_ = rotation;
     smoothingMask_ |= SMOOTH_ROTATION;
-
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    OnTargetChanged();
 
     SendEvent(E_TARGETROTATION);
 }
@@ -173,7 +199,77 @@ void SmoothedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap&
 
     float constant = eventData[P_CONSTANT].GetFloat();
     float squaredSnapThreshold = eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat();
+    if (snapshots_.Size())
+    {
+        float time = eventData[P_INTERPOLATIONTIME].GetFloat();
+        if (time > -M_INFINITY)
+        {
+            UpdateInterpolation(time, squaredSnapThreshold);
+            return;
+        }
+
+        // Interpolation was turned off: continue with exponential smoothing towards the newest target
+        snapshots_.Clear();
+    }
+
     Update(constant, squaredSnapThreshold);
 }
 
+void SmoothedTransform::OnTargetChanged()
+{
+    Scene* scene = GetScene();
+    if (node_ && scene && scene->IsInterpolating() && scene->IsInNetworkSnapshot())
+    {
+        float time = scene->GetSnapshotTime();
+
+        if (snapshots_.Empty())
+        {
+            // Start interpolating from the current transform
+            TransformSnapshot current;
+            current.time_ = Min(scene->GetInterpolationTime(), time);
+            current.position_ = node_->GetPosition();
+            current.rotation_ = node_->GetRotation();
+            snapshots_.Push(current);
+        }
+
+        // Position and rotation of the same update arrive separately, so update the snapshot if the time matches.
+        // Older updates that arrive out of order are discarded
+        TransformSnapshot& newest = snapshots_.Back();
+        if (time == newest.time_)
+        {
+            newest.position_ = targetPosition_;
+            newest.rotation_ = targetRotation_;
+        }
+        else if (time > newest.time_)
+        {
+            TransformSnapshot snapshot;
+            snapshot.time_ = time;
+            snapshot.position_ = targetPosition_;
+            snapshot.rotation_ = targetRotation_;
+            snapshots_.Push(snapshot);
+            if (snapshots_.Size() > MAX_TRANSFORM_SNAPSHOTS)
+                snapshots_.Erase(0);
+        }
+    }
+    else
+        snapshots_.Clear();
+
+    // Subscribe to smoothing update if not yet subscribed
+    if (!subscribed_)
+    {
+        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, HANDLER(SmoothedTransform, HandleUpdateSmoothing));
+        subscribed_ = true;
+    }
+}
+
+void SmoothedTransform::CheckCompleted()
+{
+    // If smoothing has completed, unsubscribe from the update event
+    if (!smoothingMask_ && subscribed_)
+    {
+        UnsubscribeFromEvent(GetScene(), E_UPDATESMOOTHING);
+        subscribed_ = false;
+    }
+}
+
 }
@@ -33,6 +33,19 @@ static const unsigned SMOOTH_NONE = 0;
 static const unsigned SMOOTH_POSITION = 1;
 /// Ongoing rotation smoothing.
 static const unsigned SMOOTH_ROTATION = 2;
+/// Maximum number of buffered snapshots for snapshot interpolation.
+static const unsigned MAX_TRANSFORM_SNAPSHOTS = 32;
+
+/// Time-stamped transform received from the server, used for snapshot interpolation.
+struct TransformSnapshot
+{
+    /// Server time on the scene's snapshot timeline.
+    float time_;
+    /// Position in parent space.
+    Vector3 position_;
+    /// Rotation in parent space.
+    Quaternion rotation_;
+};
 
 /// Transform smoothing component for network updates.
 class URHO3D_API SmoothedTransform : public Component
@@ -49,6 +62,8 @@ public:
     
     /// Update smoothing.
     void Update(float constant, float squaredSnapThreshold);
+    /// Update snapshot interpolation to the specified server time.
+    void UpdateInterpolation(float time, float squaredSnapThreshold);
     /// Set target position in parent space.
     void SetTargetPosition(const Vector3& position);
     /// Set target rotation in parent space.
@@ -68,6 +83,8 @@ public:
     Quaternion GetTargetWorldRotation() const;
     /// Return whether smoothing is in progress.
     bool IsInProgress() const { return smoothingMask_ != 0; }
+    /// Return number of buffered snapshots for snapshot interpolation.
+    unsigned GetNumSnapshots() const { return snapshots_.Size(); }
     
 protected:
     /// Handle scene node being assigned at creation.
@@ -76,7 +93,13 @@ protected:
 private:
     /// Handle smoothing update event.
     void HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData);
+    /// Buffer the target transform as a snapshot if a time-stamped network update is being applied, or discard the buffer when not. Subscribe to the smoothing update.
+    void OnTargetChanged();
+    /// Unsubscribe from the smoothing update if smoothing has completed.
+    void CheckCompleted();
     
+    /// Buffered snapshots in time order.
+    PODVector<TransformSnapshot> snapshots_;
     /// Target position.
     Vector3 targetPosition_;
     /// Target rotation.
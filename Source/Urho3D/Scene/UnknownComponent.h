@@ -65,7 +65,7 @@ public:
     bool GetUseXML() const { return useXML_; }
     
     /// Return static type.
-    static Urho3D::StringHash GetTypeStatic() { static const StringHash typeStatic("UnknownComponent"); return typeStatic; } \
+    static Urho3D::StringHash GetTypeStatic() { return StringHash(StringHash::CalculateLiteral("UnknownComponent")); } \
     /// Return static type name.
     static const Urho3D::String& GetTypeNameStatic() { static const String typeNameStatic("UnknownComponent"); return typeNameStatic; } \
     
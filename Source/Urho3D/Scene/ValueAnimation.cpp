@@ -263,11 +263,16 @@ bool ValueAnimation::IsValid() const
 
 Variant ValueAnimation::GetAnimationValue(float scaledTime)
 {
+    // Binary search for the first key frame after the time. Key frames are sorted by time
     unsigned index = 1;
-    for (; index < keyFrames_.Size(); ++index)
+    unsigned end = keyFrames_.Size();
+    while (index < end)
     {
-        if (scaledTime < keyFrames_[index].time_)
-            break;
+        unsigned middle = (index + end) >> 1;
+        if (scaledTime < keyFrames_[middle].time_)
+            end = middle;
+        else
+            index = middle + 1;
     }
 
     if (index >= keyFrames_.Size() || !interpolatable_)
@@ -445,6 +445,9 @@ template <class T> void RegisterSerializable(asIScriptEngine* engine, const char
     engine->RegisterObjectMethod(className, "Variant GetAttributeDefault(const String&in) const", asMETHODPR(T, GetAttributeDefault, (const String&) const, Variant), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "void SetInterceptNetworkUpdate(const String&in, bool)", asMETHODPR(T, SetInterceptNetworkUpdate, (const String&, bool), void), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "bool GetInterceptNetworkUpdate(const String&in) const", asMETHODPR(T, GetInterceptNetworkUpdate, (const String&) const, bool), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "void MarkNetworkAttributeDirty(uint)", asMETHODPR(T, MarkNetworkAttributeDirty, (unsigned), void), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "void set_networkDirtyTracking(bool)", asMETHODPR(T, SetNetworkDirtyTracking, (bool), void), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "bool get_networkDirtyTracking() const", asMETHODPR(T, GetNetworkDirtyTracking, () const, bool), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "uint get_numAttributes() const", asMETHODPR(T, GetNumAttributes, () const, unsigned), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "bool set_attributes(uint, const Variant&in) const", asMETHODPR(T, SetAttribute, (unsigned, const Variant&), bool), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "Variant get_attributes(uint) const", asMETHODPR(T, GetAttribute, (unsigned) const, Variant), asCALL_THISCALL);
@@ -775,6 +778,8 @@ template <class T> void RegisterDrawable(asIScriptEngine* engine, const char* cl
     engine->RegisterObjectMethod(className, "bool get_occluder() const", asMETHOD(T, IsOccluder), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "void set_occludee(bool)", asMETHOD(T, SetOccludee), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "bool get_occludee() const", asMETHOD(T, IsOccludee), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "void set_occlusionQuery(bool)", asMETHOD(T, SetOcclusionQuery), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "bool get_occlusionQuery() const", asMETHOD(T, GetOcclusionQuery), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "void set_drawDistance(float)", asMETHOD(T, SetDrawDistance), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "float get_drawDistance() const", asMETHOD(T, GetDrawDistance), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "void set_shadowDistance(float)", asMETHOD(T, SetShadowDistance), asCALL_THISCALL);
@@ -819,6 +824,10 @@ template <class T> void RegisterSoundSource(asIScriptEngine* engine, const char*
     engine->RegisterObjectMethod(className, "void set_autoRemove(bool)", asMETHOD(T, SetAutoRemove), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "bool get_autoRemove() const", asMETHOD(T, GetAutoRemove), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "bool get_playing() const", asMETHOD(T, IsPlaying), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "void set_priority(float)", asMETHOD(T, SetPriority), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "float get_priority() const", asMETHOD(T, GetPriority), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "float get_audibility() const", asMETHOD(T, GetAudibility), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "bool get_virtual() const", asMETHOD(T, IsVirtual), asCALL_THISCALL);
 }
 
 /// Template function for registering a class derived from Texture.
@@ -1087,6 +1096,8 @@ template <class T> void RegisterUIElement(asIScriptEngine* engine, const char* c
     engine->RegisterObjectMethod(className, "bool get_sortChildren() const", asMETHOD(T, GetSortChildren), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "void set_useDerivedOpacity(bool)", asMETHOD(T, SetUseDerivedOpacity), asCALL_THISCALL);
     engine->RegisterObjectMethod(className, "bool get_useDerivedOpacity() const", asMETHOD(T, GetUseDerivedOpacity), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "void set_textureCaching(bool)", asMETHOD(T, SetTextureCaching), asCALL_THISCALL);
+    engine->RegisterObjectMethod(className, "bool get_textureCaching() const", asMETHOD(T, GetTextureCaching), asCALL_THISCALL);
     if (!isSprite)
     {
         engine->RegisterObjectMethod(className, "void SetDeepEnabled(bool)", asMETHOD(T, SetDeepEnabled), asCALL_THISCALL);
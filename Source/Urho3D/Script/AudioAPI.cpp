@@ -95,6 +95,13 @@ void RegisterAudio(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Audio", "bool get_interpolation() const", asMETHOD(Audio, GetInterpolation), asCALL_THISCALL);
     engine->RegisterObjectMethod("Audio", "bool get_playing() const", asMETHOD(Audio, IsPlaying), asCALL_THISCALL);
     engine->RegisterObjectMethod("Audio", "bool get_initialized() const", asMETHOD(Audio, IsInitialized), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "void set_maxVoices(uint)", asMETHOD(Audio, SetMaxVoices), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "uint get_maxVoices() const", asMETHOD(Audio, GetMaxVoices), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "void set_virtualThreshold(float)", asMETHOD(Audio, SetVirtualThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "float get_virtualThreshold() const", asMETHOD(Audio, GetVirtualThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "uint get_numVirtualSources() const", asMETHOD(Audio, GetNumVirtualSources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "void set_streamLookAhead(float)", asMETHOD(Audio, SetStreamLookAhead), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Audio", "float get_streamLookAhead() const", asMETHOD(Audio, GetStreamLookAhead), asCALL_THISCALL);
     engine->RegisterGlobalFunction("Audio@+ get_audio()", asFUNCTION(GetAudio), asCALL_CDECL);
 }
 
@@ -701,6 +701,10 @@ static void RegisterTimer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Time", "uint get_frameNumber() const", asMETHOD(Time, GetFrameNumber), asCALL_THISCALL);
     engine->RegisterObjectMethod("Time", "float get_timeStep() const", asMETHOD(Time, GetTimeStep), asCALL_THISCALL);
     engine->RegisterObjectMethod("Time", "float get_elapsedTime()", asMETHOD(Time, GetElapsedTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Time", "float get_frameLatency() const", asMETHOD(Time, GetFrameLatency), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Time", "float get_averageFrameLatency() const", asMETHOD(Time, GetAverageFrameLatency), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Time", "float get_frameWaitTime() const", asMETHOD(Time, GetFrameWaitTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Time", "float get_framePacingError() const", asMETHOD(Time, GetFramePacingError), asCALL_THISCALL);
     engine->RegisterObjectMethod("Time", "uint get_systemTime() const", asFUNCTION(TimeGetSystemTime), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Time", "uint get_timeSinceEpoch() const", asFUNCTION(TimeGetTimeSinceEpoch), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Time", "String get_timeStamp() const", asFUNCTION(TimeGetTimeStamp), asCALL_CDECL_OBJLAST);
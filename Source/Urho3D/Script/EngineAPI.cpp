@@ -74,6 +74,9 @@ static void RegisterDebugHud(asIScriptEngine* engine)
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_STATS", (void*)&DEBUGHUD_SHOW_STATS);
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_MODE", (void*)&DEBUGHUD_SHOW_MODE);
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_PROFILER", (void*)&DEBUGHUD_SHOW_PROFILER);
+    engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_MEMORY", (void*)&DEBUGHUD_SHOW_MEMORY);
+    engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_NETWORK", (void*)&DEBUGHUD_SHOW_NETWORK);
+    engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_FRAMETIME", (void*)&DEBUGHUD_SHOW_FRAMETIME);
     engine->RegisterGlobalProperty("const uint DEBUGHUD_SHOW_ALL", (void*)&DEBUGHUD_SHOW_ALL);
 
     RegisterObject<Console>(engine, "DebugHud");
@@ -90,9 +93,19 @@ static void RegisterDebugHud(asIScriptEngine* engine)
     engine->RegisterObjectMethod("DebugHud", "float get_profilerInterval() const", asMETHOD(DebugHud, GetProfilerInterval), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void set_useRendererStats(bool)", asMETHOD(DebugHud, SetUseRendererStats), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "bool get_useRendererStats() const", asMETHOD(DebugHud, GetUseRendererStats), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "void set_hitchThreshold(float)", asMETHOD(DebugHud, SetHitchThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "float get_hitchThreshold() const", asMETHOD(DebugHud, GetHitchThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "void set_hitchFrames(uint)", asMETHOD(DebugHud, SetHitchFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "uint get_hitchFrames() const", asMETHOD(DebugHud, GetHitchFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "void set_hitchFileName(const String&in)", asMETHOD(DebugHud, SetHitchFileName), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "const String& get_hitchFileName() const", asMETHOD(DebugHud, GetHitchFileName), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "uint get_numHitches() const", asMETHOD(DebugHud, GetNumHitches), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "Text@+ get_statsText() const", asMETHOD(DebugHud, GetStatsText), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "Text@+ get_modeText() const", asMETHOD(DebugHud, GetModeText), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "Text@+ get_profilerText() const", asMETHOD(DebugHud, GetProfilerText), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "Text@+ get_memoryText() const", asMETHOD(DebugHud, GetMemoryText), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "Text@+ get_networkText() const", asMETHOD(DebugHud, GetNetworkText), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugHud", "Text@+ get_frameTimeText() const", asMETHOD(DebugHud, GetFrameTimeText), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void SetAppStats(const String&in, const Variant&in)", asMETHODPR(DebugHud, SetAppStats, (const String&, const Variant&), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void SetAppStats(const String&in, const String&in)", asMETHODPR(DebugHud, SetAppStats, (const String&, const String&), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugHud", "void ResetAppStats(const String&in)", asMETHOD(DebugHud, ResetAppStats), asCALL_THISCALL);
@@ -121,6 +134,9 @@ static void RegisterEngine(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Engine", "int get_maxFps() const", asMETHOD(Engine, GetMaxFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "void set_timeStepSmoothing(int)", asMETHOD(Engine, SetTimeStepSmoothing), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "int get_timeStepSmoothing() const", asMETHOD(Engine, GetTimeStepSmoothing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Engine", "void set_tickRate(int)", asMETHOD(Engine, SetTickRate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Engine", "int get_tickRate() const", asMETHOD(Engine, GetTickRate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Engine", "uint get_skippedTicks() const", asMETHOD(Engine, GetSkippedTicks), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "void set_maxInactiveFps(int)", asMETHOD(Engine, SetMaxInactiveFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "int get_maxInactiveFps() const", asMETHOD(Engine, GetMaxInactiveFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Engine", "void set_pauseMinimized(bool)", asMETHOD(Engine, SetPauseMinimized), asCALL_THISCALL);
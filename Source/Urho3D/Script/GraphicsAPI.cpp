@@ -21,15 +21,18 @@
 //
 
 #include "../Graphics/AnimatedModel.h"
+#include "../Graphics/AnimatedModelGroup.h"
 #include "../Graphics/Animation.h"
 #include "../Graphics/AnimationController.h"
 #include "../Graphics/AnimationState.h"
 #include "../Script/APITemplates.h"
 #include "../Graphics/Camera.h"
+#include "../Graphics/CDLODTerrain.h"
 #include "../Graphics/CustomGeometry.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/DecalSet.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/GPUParticleEmitter.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Light.h"
@@ -46,8 +49,10 @@
 #include "../Graphics/Terrain.h"
 #include "../Graphics/TerrainPatch.h"
 #include "../Graphics/Texture2D.h"
+#include "../Graphics/Texture2DArray.h"
 #include "../Graphics/Texture3D.h"
 #include "../Graphics/TextureCube.h"
+#include "../Graphics/TextureStreamer.h"
 #include "../Graphics/Skybox.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../Graphics/Zone.h"
@@ -145,6 +150,7 @@ static void RegisterSkeleton(asIScriptEngine* engine)
     engine->RegisterObjectProperty("Bone", "const Vector3 initialScale", offsetof(Bone, initialScale_));
     engine->RegisterObjectProperty("Bone", "bool animated", offsetof(Bone, animated_));
     engine->RegisterObjectProperty("Bone", "float radius", offsetof(Bone, radius_));
+    engine->RegisterObjectProperty("Bone", "float animationLodDistance", offsetof(Bone, animationLodDistance_));
     engine->RegisterObjectProperty("Bone", "const BoundingBox boundingBox", offsetof(Bone, boundingBox_));
     engine->RegisterObjectMethod("Bone", "void set_node(Node@+)", asFUNCTION(BoneSetNode), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Bone", "Node@+ get_node() const", asFUNCTION(BoneGetNode), asCALL_CDECL_OBJLAST);
@@ -179,6 +185,11 @@ static bool Texture2DSetData(Image* image, bool useAlpha, Texture2D* ptr)
     return ptr->SetData(SharedPtr<Image>(image), useAlpha);
 }
 
+static bool Texture2DArraySetData(unsigned layer, Image* image, bool useAlpha, Texture2DArray* ptr)
+{
+    return ptr->SetData(layer, SharedPtr<Image>(image), useAlpha);
+}
+
 static bool Texture3DSetData(Image* image, bool useAlpha, Texture3D* ptr)
 {
     return ptr->SetData(SharedPtr<Image>(image), useAlpha);
@@ -288,6 +299,7 @@ static void RegisterRenderPath(asIScriptEngine* engine)
     engine->RegisterEnumValue("RenderCommandType", "CMD_FORWARDLIGHTS", CMD_FORWARDLIGHTS);
     engine->RegisterEnumValue("RenderCommandType", "CMD_LIGHTVOLUMES", CMD_LIGHTVOLUMES);
     engine->RegisterEnumValue("RenderCommandType", "CMD_RENDERUI", CMD_RENDERUI);
+    engine->RegisterEnumValue("RenderCommandType", "CMD_DEPTHPYRAMID", CMD_DEPTHPYRAMID);
     
     engine->RegisterEnum("RenderCommandSortMode");
     engine->RegisterEnumValue("RenderCommandSortMode", "SORT_FRONTTOBACK", SORT_FRONTTOBACK);
@@ -312,11 +324,13 @@ static void RegisterRenderPath(asIScriptEngine* engine)
     #ifdef DESKTOP_GRAPHICS
     engine->RegisterEnumValue("TextureUnit", "TU_CUSTOM1", TU_CUSTOM1);
     engine->RegisterEnumValue("TextureUnit", "TU_CUSTOM2", TU_CUSTOM2);
+    engine->RegisterEnumValue("TextureUnit", "TU_HEIGHTMAP", TU_HEIGHTMAP);
     engine->RegisterEnumValue("TextureUnit", "TU_VOLUMEMAP", TU_VOLUMEMAP);
     engine->RegisterEnumValue("TextureUnit", "TU_FACESELECT", TU_FACESELECT);
     engine->RegisterEnumValue("TextureUnit", "TU_INDIRECTION", TU_INDIRECTION);
     engine->RegisterEnumValue("TextureUnit", "TU_DEPTHBUFFER", TU_DEPTHBUFFER);
     engine->RegisterEnumValue("TextureUnit", "TU_LIGHTBUFFER", TU_LIGHTBUFFER);
+    engine->RegisterEnumValue("TextureUnit", "TU_LIGHTCLUSTERS", TU_LIGHTCLUSTERS);
     engine->RegisterEnumValue("TextureUnit", "TU_ZONE", TU_ZONE);
     #endif
     engine->RegisterEnumValue("TextureUnit", "MAX_MATERIAL_TEXTURE_UNITS", MAX_MATERIAL_TEXTURE_UNITS);
@@ -370,12 +384,17 @@ static void RegisterRenderPath(asIScriptEngine* engine)
     engine->RegisterObjectProperty("RenderPathCommand", "Color clearColor", offsetof(RenderPathCommand, clearColor_));
     engine->RegisterObjectProperty("RenderPathCommand", "float clearDepth", offsetof(RenderPathCommand, clearDepth_));
     engine->RegisterObjectProperty("RenderPathCommand", "uint clearStencil", offsetof(RenderPathCommand, clearStencil_));
+    engine->RegisterObjectProperty("RenderPathCommand", "uint discardFlags", offsetof(RenderPathCommand, discardFlags_));
     engine->RegisterObjectProperty("RenderPathCommand", "BlendMode blendMode", offsetof(RenderPathCommand, blendMode_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool enabled", offsetof(RenderPathCommand, enabled_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool useFogColor", offsetof(RenderPathCommand, useFogColor_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool markToStencil", offsetof(RenderPathCommand, markToStencil_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool vertexLights", offsetof(RenderPathCommand, vertexLights_));
+    engine->RegisterObjectProperty("RenderPathCommand", "bool clusteredLights", offsetof(RenderPathCommand, clusteredLights_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool useLitBase", offsetof(RenderPathCommand, useLitBase_));
+    engine->RegisterObjectProperty("RenderPathCommand", "uint depthPyramidLevels", offsetof(RenderPathCommand, depthPyramidLevels_));
+    engine->RegisterObjectProperty("RenderPathCommand", "float resolutionScale", offsetof(RenderPathCommand, resolutionScale_));
+    engine->RegisterObjectProperty("RenderPathCommand", "String upsampleDepthName", offsetof(RenderPathCommand, upsampleDepthName_));
     engine->RegisterObjectProperty("RenderPathCommand", "String vertexShaderName", offsetof(RenderPathCommand, vertexShaderName_));
     engine->RegisterObjectProperty("RenderPathCommand", "String pixelShaderName", offsetof(RenderPathCommand, pixelShaderName_));
     engine->RegisterObjectProperty("RenderPathCommand", "String vertexShaderDefines", offsetof(RenderPathCommand, vertexShaderDefines_));
@@ -455,6 +474,12 @@ static void RegisterTextures(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Viewport", "const IntRect& get_rect() const", asMETHOD(Viewport, GetRect), asCALL_THISCALL);
     engine->RegisterObjectMethod("Viewport", "void set_drawDebug(bool)", asMETHOD(Viewport, SetDrawDebug), asCALL_THISCALL);
     engine->RegisterObjectMethod("Viewport", "bool get_drawDebug() const", asMETHOD(Viewport, GetDrawDebug), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Viewport", "void set_incrementalUpdate(bool)", asMETHOD(Viewport, SetIncrementalUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Viewport", "bool get_incrementalUpdate() const", asMETHOD(Viewport, GetIncrementalUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Viewport", "void set_maxUpdateInterval(uint)", asMETHOD(Viewport, SetMaxUpdateInterval), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Viewport", "uint get_maxUpdateInterval() const", asMETHOD(Viewport, GetMaxUpdateInterval), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Viewport", "void set_cullGroup(uint)", asMETHOD(Viewport, SetCullGroup), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Viewport", "uint get_cullGroup() const", asMETHOD(Viewport, GetCullGroup), asCALL_THISCALL);
     engine->RegisterObjectMethod("Viewport", "Ray GetScreenRay(int, int) const", asMETHOD(Viewport, GetScreenRay), asCALL_THISCALL);
     engine->RegisterObjectMethod("Viewport", "Vector2 WorldToScreenPoint(const Vector3&in) const", asMETHOD(Viewport, WorldToScreenPoint), asCALL_THISCALL);
     engine->RegisterObjectMethod("Viewport", "Vector3 ScreenToWorldPoint(int, int, float) const", asMETHOD(Viewport, ScreenToWorldPoint), asCALL_THISCALL);
@@ -483,6 +508,12 @@ static void RegisterTextures(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Texture2D", "bool SetData(Image@+, bool useAlpha = false)", asFUNCTION(Texture2DSetData), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Texture2D", "RenderSurface@+ get_renderSurface() const", asMETHOD(Texture2D, GetRenderSurface), asCALL_THISCALL);
 
+    RegisterTexture<Texture2DArray>(engine, "Texture2DArray");
+    engine->RegisterObjectMethod("Texture2DArray", "bool SetSize(uint, int, int, uint, TextureUsage usage = TEXTURE_STATIC)", asMETHOD(Texture2DArray, SetSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Texture2DArray", "bool SetData(uint, Image@+, bool useAlpha = false)", asFUNCTION(Texture2DArraySetData), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Texture2DArray", "void set_layers(uint)", asMETHOD(Texture2DArray, SetLayers), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Texture2DArray", "uint get_layers() const", asMETHOD(Texture2DArray, GetLayers), asCALL_THISCALL);
+    
     RegisterTexture<Texture3D>(engine, "Texture3D");
     engine->RegisterObjectMethod("Texture3D", "bool SetSize(int, int, uint, TextureUsage usage = TEXTURE_STATIC)", asMETHOD(Texture3D, SetSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("Texture3D", "bool SetData(Image@+, bool useAlpha = false)", asFUNCTION(Texture3DSetData), asCALL_CDECL_OBJLAST);
@@ -679,6 +710,9 @@ static void RegisterBuffers(asIScriptEngine* engine)
     engine->RegisterGlobalProperty("const uint MASK_INSTANCEMATRIX1", (void*)&MASK_INSTANCEMATRIX1);
     engine->RegisterGlobalProperty("const uint MASK_INSTANCEMATRIX2", (void*)&MASK_INSTANCEMATRIX2);
     engine->RegisterGlobalProperty("const uint MASK_INSTANCEMATRIX3", (void*)&MASK_INSTANCEMATRIX3);
+    engine->RegisterGlobalProperty("const uint MASK_PACKEDNORMALS", (void*)&MASK_PACKEDNORMALS);
+    engine->RegisterGlobalProperty("const uint MASK_PACKEDTEXCOORDS", (void*)&MASK_PACKEDTEXCOORDS);
+    engine->RegisterGlobalProperty("const uint MASK_PACKEDBLENDWEIGHTS", (void*)&MASK_PACKEDBLENDWEIGHTS);
     engine->RegisterGlobalProperty("const uint MASK_DEFAULT", (void*)&MASK_DEFAULT);
 
     engine->RegisterEnum("PrimitiveType");
@@ -734,6 +768,9 @@ static void RegisterBuffers(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Geometry", "void set_lodDistance(float)", asMETHOD(Geometry, SetLodDistance), asCALL_THISCALL);
     engine->RegisterObjectMethod("Geometry", "float get_lodDistance() const", asMETHOD(Geometry, GetLodDistance), asCALL_THISCALL);
     engine->RegisterObjectMethod("Geometry", "bool get_empty() const", asMETHOD(Geometry, IsEmpty), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Geometry", "void set_triangleBVHEnabled(bool)", asMETHOD(Geometry, SetTriangleBVHEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Geometry", "bool get_triangleBVHEnabled() const", asMETHOD(Geometry, IsTriangleBVHEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Geometry", "void MarkTriangleBVHDirty()", asMETHOD(Geometry, MarkTriangleBVHDirty), asCALL_THISCALL);
 }
 
 static void RegisterMaterial(asIScriptEngine* engine)
@@ -835,6 +872,11 @@ static void RegisterMaterial(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Material", "void set_textures(uint, Texture@+)", asMETHOD(Material, SetTexture), asCALL_THISCALL);
     engine->RegisterObjectMethod("Material", "Texture@+ get_textures(uint) const", asMETHOD(Material, GetTexture), asCALL_THISCALL);
     engine->RegisterObjectMethod("Material", "bool get_occlusion()", asMETHOD(Material, GetOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Material", "bool get_textureArrays() const", asMETHOD(Material, HasTextureArrays), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Material", "void set_arrayMaterial(Material@+)", asMETHOD(Material, SetArrayMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Material", "Material@+ get_arrayMaterial() const", asMETHOD(Material, GetArrayMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Material", "void set_arrayLayer(uint)", asMETHOD(Material, SetArrayLayer), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Material", "uint get_arrayLayer() const", asMETHOD(Material, GetArrayLayer), asCALL_THISCALL);
     engine->RegisterObjectMethod("Material", "void set_cullMode(CullMode)", asMETHOD(Material, SetCullMode), asCALL_THISCALL);
     engine->RegisterObjectMethod("Material", "CullMode get_cullMode() const", asMETHOD(Material, GetCullMode), asCALL_THISCALL);
     engine->RegisterObjectMethod("Material", "void set_shadowCullMode(CullMode)", asMETHOD(Material, SetShadowCullMode), asCALL_THISCALL);
@@ -874,6 +916,13 @@ static void RegisterModel(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Model", "bool set_geometryCenters(uint, const Vector3&in)", asMETHOD(Model, SetGeometryCenter), asCALL_THISCALL);
     engine->RegisterObjectMethod("Model", "const Vector3& get_geometryCenters(uint) const", asMETHOD(Model, GetGeometryCenter), asCALL_THISCALL);
     engine->RegisterObjectMethod("Model", "uint get_numMorphs() const", asMETHOD(Model, GetNumMorphs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool RequestCPUData()", asMETHOD(Model, RequestCPUData), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool AddCPUDataUser()", asMETHOD(Model, AddCPUDataUser), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "void RemoveCPUDataUser()", asMETHOD(Model, RemoveCPUDataUser), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "void set_releaseCPUData(bool)", asMETHOD(Model, SetReleaseCPUData), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool get_releaseCPUData() const", asMETHOD(Model, GetReleaseCPUData), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool get_hasCPUData() const", asMETHOD(Model, HasCPUData), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "uint get_numCPUDataUsers() const", asMETHOD(Model, GetNumCPUDataUsers), asCALL_THISCALL);
 }
 
 static AnimationTriggerPoint* AnimationGetTrigger(unsigned index, Animation* animation)
@@ -895,6 +944,9 @@ static void RegisterAnimation(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Animation", "void AddTrigger(float, bool, const Variant&in)", asMETHOD(Animation, AddTrigger), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void RemoveTrigger(uint)", asMETHOD(Animation, RemoveTrigger), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void RemoveAllTriggers()", asMETHOD(Animation, RemoveAllTriggers), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "void RemoveRedundantKeyFrames(float, float, float)", asMETHOD(Animation, RemoveRedundantKeyFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "void set_compressed(bool)", asMETHOD(Animation, SetCompressed), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "bool get_compressed() const", asMETHOD(Animation, IsCompressed), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "float get_length() const", asMETHOD(Animation, GetLength), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "uint get_numTracks() const", asMETHOD(Animation, GetNumTracks), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void set_numTriggers(uint)", asMETHOD(Animation, SetNumTriggers), asCALL_THISCALL);
@@ -1074,6 +1126,15 @@ static void RegisterStaticModelGroup(asIScriptEngine* engine)
     engine->RegisterObjectMethod("StaticModelGroup", "void RemoveAllInstanceNodes()", asMETHOD(StaticModelGroup, RemoveAllInstanceNodes), asCALL_THISCALL);
     engine->RegisterObjectMethod("StaticModelGroup", "uint get_numInstanceNodes() const", asMETHOD(StaticModelGroup, GetNumInstanceNodes), asCALL_THISCALL);
     engine->RegisterObjectMethod("StaticModelGroup", "Node@+ get_instanceNodes(uint) const", asMETHOD(StaticModelGroup, GetInstanceNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "bool GenerateImpostor(int frameSize = 128)", asMETHOD(StaticModelGroup, GenerateImpostor), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "void set_impostorDistance(float)", asMETHOD(StaticModelGroup, SetImpostorDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "float get_impostorDistance() const", asMETHOD(StaticModelGroup, GetImpostorDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "void set_impostorFadeRange(float)", asMETHOD(StaticModelGroup, SetImpostorFadeRange), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "float get_impostorFadeRange() const", asMETHOD(StaticModelGroup, GetImpostorFadeRange), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "void set_impostorFrames(uint)", asMETHOD(StaticModelGroup, SetImpostorFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "uint get_impostorFrames() const", asMETHOD(StaticModelGroup, GetImpostorFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "void set_impostorMaterial(Material@+)", asMETHOD(StaticModelGroup, SetImpostorMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "Material@+ get_impostorMaterial() const", asMETHOD(StaticModelGroup, GetImpostorMaterial), asCALL_THISCALL);
 }
 
 static void RegisterSkybox(asIScriptEngine* engine)
@@ -1149,6 +1210,9 @@ static void RegisterAnimatedModel(asIScriptEngine* engine)
     engine->RegisterObjectMethod("AnimatedModel", "void set_model(Model@+)", asFUNCTION(AnimatedModelSetModel), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("AnimatedModel", "void set_animationLodBias(float)", asMETHOD(AnimatedModel, SetAnimationLodBias), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "float get_animationLodBias() const", asMETHOD(AnimatedModel, GetAnimationLodBias), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "void set_animationLodInterpolation(bool)", asMETHOD(AnimatedModel, SetAnimationLodInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "bool get_animationLodInterpolation() const", asMETHOD(AnimatedModel, GetAnimationLodInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "float get_animationLodDistance() const", asMETHOD(AnimatedModel, GetAnimationLodDistance), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "void set_updateInvisible(bool)", asMETHOD(AnimatedModel, SetUpdateInvisible), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "bool get_updateInvisible() const", asMETHOD(AnimatedModel, GetUpdateInvisible), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "Skeleton@+ get_skeleton()", asMETHOD(AnimatedModel, GetSkeleton), asCALL_THISCALL);
@@ -1160,6 +1224,27 @@ static void RegisterAnimatedModel(asIScriptEngine* engine)
     engine->RegisterObjectMethod("AnimatedModel", "float get_morphWeights(const String&in) const", asMETHODPR(AnimatedModel, GetMorphWeight, (const String&) const, float), asCALL_THISCALL);
 }
 
+static void RegisterAnimatedModelGroup(asIScriptEngine* engine)
+{
+    RegisterStaticModel<AnimatedModelGroup>(engine, "AnimatedModelGroup", true);
+    RegisterSubclass<StaticModelGroup, AnimatedModelGroup>(engine, "StaticModelGroup", "AnimatedModelGroup");
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void AddInstanceNode(Node@+)", asMETHOD(AnimatedModelGroup, AddInstanceNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void RemoveInstanceNode(Node@+)", asMETHOD(AnimatedModelGroup, RemoveInstanceNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void RemoveAllInstanceNodes()", asMETHOD(AnimatedModelGroup, RemoveAllInstanceNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "uint get_numInstanceNodes() const", asMETHOD(AnimatedModelGroup, GetNumInstanceNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "Node@+ get_instanceNodes(uint) const", asMETHOD(AnimatedModelGroup, GetInstanceNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "uint AddAnimation(Animation@+)", asMETHOD(AnimatedModelGroup, AddAnimation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void RemoveAllAnimations()", asMETHOD(AnimatedModelGroup, RemoveAllAnimations), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void SetInstanceAnimation(Node@+, uint, float time = 0.0f, float speed = 1.0f)", asMETHOD(AnimatedModelGroup, SetInstanceAnimation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void SetInstanceTime(Node@+, float)", asMETHOD(AnimatedModelGroup, SetInstanceTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "uint GetInstanceAnimation(Node@+) const", asMETHOD(AnimatedModelGroup, GetInstanceAnimation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "float GetInstanceTime(Node@+) const", asMETHOD(AnimatedModelGroup, GetInstanceTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "uint get_numAnimations() const", asMETHOD(AnimatedModelGroup, GetNumAnimations), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "Animation@+ get_animations(uint) const", asMETHOD(AnimatedModelGroup, GetAnimation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "void set_sampleRate(float)", asMETHOD(AnimatedModelGroup, SetSampleRate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModelGroup", "float get_sampleRate() const", asMETHOD(AnimatedModelGroup, GetSampleRate), asCALL_THISCALL);
+}
+
 static void RegisterAnimationController(asIScriptEngine* engine)
 {
     RegisterComponent<AnimationController>(engine, "AnimationController");
@@ -1368,6 +1453,25 @@ static void RegisterParticleEmitter(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ParticleEmitter", "void ApplyEffect()", asMETHOD(ParticleEmitter, ApplyEffect), asCALL_THISCALL);
 }
 
+static void RegisterGPUParticleEmitter(asIScriptEngine* engine)
+{
+    RegisterDrawable<GPUParticleEmitter>(engine, "GPUParticleEmitter");
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void set_effect(ParticleEffect@+)", asMETHOD(GPUParticleEmitter, SetEffect), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "ParticleEffect@+ get_effect() const", asMETHOD(GPUParticleEmitter, GetEffect), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "Material@+ get_material() const", asMETHOD(GPUParticleEmitter, GetMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void set_numParticles(uint)", asMETHOD(GPUParticleEmitter, SetNumParticles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "uint get_numParticles() const", asMETHOD(GPUParticleEmitter, GetNumParticles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void set_emitting(bool)", asMETHOD(GPUParticleEmitter, SetEmitting), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "bool get_emitting() const", asMETHOD(GPUParticleEmitter, IsEmitting), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void set_faceCameraMode(FaceCameraMode)", asMETHOD(GPUParticleEmitter, SetFaceCameraMode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "FaceCameraMode get_faceCameraMode() const", asMETHOD(GPUParticleEmitter, GetFaceCameraMode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "Zone@+ get_zone() const", asMETHOD(GPUParticleEmitter, GetZone), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void ResetEmissionTimer()", asMETHOD(GPUParticleEmitter, ResetEmissionTimer), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void RemoveAllParticles()", asMETHOD(GPUParticleEmitter, RemoveAllParticles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void Reset()", asMETHOD(GPUParticleEmitter, Reset), asCALL_THISCALL);
+    engine->RegisterObjectMethod("GPUParticleEmitter", "void ApplyEffect()", asMETHOD(GPUParticleEmitter, ApplyEffect), asCALL_THISCALL);
+}
+
 static void RegisterCustomGeometry(asIScriptEngine* engine)
 {
     engine->RegisterObjectType("CustomGeometryVertex", 0, asOBJ_REF);
@@ -1405,17 +1509,22 @@ static void RegisterDecalSet(asIScriptEngine* engine)
 {
     RegisterDrawable<DecalSet>(engine, "DecalSet");
     engine->RegisterObjectMethod("DecalSet", "bool AddDecal(Drawable@+, const Vector3&in, const Quaternion&in, float, float, float, const Vector2&in, const Vector2&in, float timeToLive = 0.0, float normalCutoff = 0.1, uint subGeometry = 0xffffffff)", asMETHOD(DecalSet, AddDecal), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DecalSet", "bool AddDecalAsync(Drawable@+, const Vector3&in, const Quaternion&in, float, float, float, const Vector2&in, const Vector2&in, float timeToLive = 0.0, float normalCutoff = 0.1, uint subGeometry = 0xffffffff)", asMETHOD(DecalSet, AddDecalAsync), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "void RemoveDecals(uint)", asMETHOD(DecalSet, RemoveDecals), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "void RemoveAllDecals()", asMETHOD(DecalSet, RemoveAllDecals), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DecalSet", "void ClearFaceCache()", asMETHOD(DecalSet, ClearFaceCache), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "void set_material(Material@+)", asMETHOD(DecalSet, SetMaterial), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "Material@+ get_material() const", asMETHOD(DecalSet, GetMaterial), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "uint get_numDecals() const", asMETHOD(DecalSet, GetNumDecals), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DecalSet", "uint get_numPendingDecals() const", asMETHOD(DecalSet, GetNumPendingDecals), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "uint get_numVertices() const", asMETHOD(DecalSet, GetNumVertices), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "uint get_numIndices() const", asMETHOD(DecalSet, GetNumVertices), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "void set_maxVertices(uint)", asMETHOD(DecalSet, SetMaxVertices), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "uint get_maxVertices() const", asMETHOD(DecalSet, GetMaxVertices), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "void set_maxIndices(uint)", asMETHOD(DecalSet, SetMaxIndices), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "uint get_maxIndices() const", asMETHOD(DecalSet, GetMaxIndices), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DecalSet", "void set_faceCacheSize(uint)", asMETHOD(DecalSet, SetFaceCacheSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DecalSet", "uint get_faceCacheSize() const", asMETHOD(DecalSet, GetFaceCacheSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("DecalSet", "Zone@+ get_zone() const", asMETHOD(DecalSet, GetZone), asCALL_THISCALL);
 }
 
@@ -1424,10 +1533,14 @@ static void RegisterTerrain(asIScriptEngine* engine)
     RegisterDrawable<TerrainPatch>(engine, "TerrainPatch");
     RegisterComponent<Terrain>(engine, "Terrain");
     engine->RegisterObjectMethod("Terrain", "void ApplyHeightMap()", asMETHOD(Terrain, ApplyHeightMap), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Terrain", "void SetHeightValue(const IntVector2&in, float)", asMETHOD(Terrain, SetHeightValue), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Terrain", "void ApplyHeightMapRegion(const IntRect&in)", asMETHOD(Terrain, ApplyHeightMapRegion), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "float GetHeight(const Vector3&in) const", asMETHOD(Terrain, GetHeight), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "Vector3 GetNormal(const Vector3&in) const", asMETHOD(Terrain, GetNormal), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "TerrainPatch@+ GetPatch(int, int) const", asMETHODPR(Terrain, GetPatch, (int, int) const, TerrainPatch*), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "IntVector2 WorldToHeightMap(const Vector3&in) const", asMETHOD(Terrain, WorldToHeightMap), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Terrain", "Vector3 HeightMapToWorld(const IntVector2&in) const", asMETHOD(Terrain, HeightMapToWorld), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Terrain", "float GetHeightValue(const IntVector2&in) const", asMETHOD(Terrain, GetHeightValue), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "void set_material(Material@+)", asMETHOD(Terrain, SetMaterial), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "Material@+ get_material() const", asMETHOD(Terrain, GetMaterial), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "void set_smoothing(bool)", asMETHOD(Terrain, SetSmoothing), asCALL_THISCALL);
@@ -1465,6 +1578,32 @@ static void RegisterTerrain(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Terrain", "uint get_maxLights() const", asMETHOD(Terrain, GetMaxLights), asCALL_THISCALL);
 }
 
+static void RegisterCDLODTerrain(asIScriptEngine* engine)
+{
+    RegisterDrawable<CDLODTerrain>(engine, "CDLODTerrain");
+    engine->RegisterObjectMethod("CDLODTerrain", "bool SetHeightFile(const String&in, const IntVector2&in)", asMETHOD(CDLODTerrain, SetHeightFile), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "float GetHeight(const Vector3&in) const", asMETHOD(CDLODTerrain, GetHeight), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_material(Material@+)", asMETHOD(CDLODTerrain, SetMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "Material@+ get_material() const", asMETHOD(CDLODTerrain, GetMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "const String& get_heightFile() const", asMETHOD(CDLODTerrain, GetHeightFile), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "const IntVector2& get_numVertices() const", asMETHOD(CDLODTerrain, GetNumVertices), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_spacing(const Vector3&in)", asMETHOD(CDLODTerrain, SetSpacing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "const Vector3& get_spacing() const", asMETHOD(CDLODTerrain, GetSpacing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_gridSize(int)", asMETHOD(CDLODTerrain, SetGridSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "int get_gridSize() const", asMETHOD(CDLODTerrain, GetGridSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_lodRangeFactor(float)", asMETHOD(CDLODTerrain, SetLodRangeFactor), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "float get_lodRangeFactor() const", asMETHOD(CDLODTerrain, GetLodRangeFactor), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_morphStart(float)", asMETHOD(CDLODTerrain, SetMorphStart), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "float get_morphStart() const", asMETHOD(CDLODTerrain, GetMorphStart), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_maxTiles(uint)", asMETHOD(CDLODTerrain, SetMaxTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "uint get_maxTiles() const", asMETHOD(CDLODTerrain, GetMaxTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "void set_maxTileLoads(uint)", asMETHOD(CDLODTerrain, SetMaxTileLoads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "uint get_maxTileLoads() const", asMETHOD(CDLODTerrain, GetMaxTileLoads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "uint get_numLevels() const", asMETHOD(CDLODTerrain, GetNumLevels), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "uint get_numTiles() const", asMETHOD(CDLODTerrain, GetNumTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("CDLODTerrain", "Zone@+ get_zone() const", asMETHOD(CDLODTerrain, GetZone), asCALL_THISCALL);
+}
+
 
 static CScriptArray* GraphicsGetResolutions(Graphics* ptr)
 {
@@ -1517,6 +1656,14 @@ static void RegisterGraphics(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Graphics", "bool get_sRGB() const", asMETHOD(Graphics, GetSRGB), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "void set_flushGPU(bool)", asMETHOD(Graphics, SetFlushGPU), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_flushGPU() const", asMETHOD(Graphics, GetFlushGPU), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "void set_renderThread(bool)", asMETHOD(Graphics, SetRenderThread), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_renderThread() const", asMETHOD(Graphics, GetRenderThread), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "void set_asyncShaders(bool)", asMETHOD(Graphics, SetAsyncShaders), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_asyncShaders() const", asMETHOD(Graphics, GetAsyncShaders), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "void set_shaderFallbackDefines(const String&in)", asMETHOD(Graphics, SetShaderFallbackDefines), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "const String& get_shaderFallbackDefines() const", asMETHOD(Graphics, GetShaderFallbackDefines), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "void set_shaderCacheDir(const String&in)", asMETHOD(Graphics, SetShaderCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "const String& get_shaderCacheDir() const", asMETHOD(Graphics, GetShaderCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "void set_orientations(const String&in)", asMETHOD(Graphics, SetOrientations), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "const String& get_orientations() const", asMETHOD(Graphics, GetOrientations), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "int get_width() const", asMETHOD(Graphics, GetWidth), asCALL_THISCALL);
@@ -1531,13 +1678,22 @@ static void RegisterGraphics(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Graphics", "bool get_deviceLost() const", asMETHOD(Graphics, IsDeviceLost), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "uint get_numPrimitives() const", asMETHOD(Graphics, GetNumPrimitives), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "uint get_numBatches() const", asMETHOD(Graphics, GetNumBatches), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "uint get_numStateChanges() const", asMETHOD(Graphics, GetNumStateChanges), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "uint get_numAvoidedStateChanges() const", asMETHOD(Graphics, GetNumAvoidedStateChanges), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "uint get_numParameterBytes() const", asMETHOD(Graphics, GetNumParameterBytes), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_instancingSupport() const", asMETHOD(Graphics, GetInstancingSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_indirectDrawSupport() const", asMETHOD(Graphics, GetIndirectDrawSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_framebufferDiscardSupport() const", asMETHOD(Graphics, GetFramebufferDiscardSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_textureArraySupport() const", asMETHOD(Graphics, GetTextureArraySupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_lightPrepassSupport() const", asMETHOD(Graphics, GetLightPrepassSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_deferredSupport() const", asMETHOD(Graphics, GetDeferredSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_hardwareShadowSupport() const", asMETHOD(Graphics, GetHardwareShadowSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_readableDepthSupport() const", asMETHOD(Graphics, GetReadableDepthSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_sRGBSupport() const", asMETHOD(Graphics, GetSRGBSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_sRGBWriteSupport() const", asMETHOD(Graphics, GetSRGBWriteSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_occlusionQuerySupport() const", asMETHOD(Graphics, GetOcclusionQuerySupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_textureSkinningSupport() const", asMETHOD(Graphics, GetTextureSkinningSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_vertexTextureSupport() const", asMETHOD(Graphics, GetVertexTextureSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "Array<IntVector2>@ get_resolutions() const", asFUNCTION(GraphicsGetResolutions), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Graphics", "Array<int>@ get_multiSampleLevels() const", asFUNCTION(GraphicsGetMultiSampleLevels), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Graphics", "IntVector2 get_desktopResolution() const", asMETHOD(Graphics, GetDesktopResolution), asCALL_THISCALL);
@@ -1561,9 +1717,23 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterGlobalProperty("const int SHADOWQUALITY_HIGH_16BIT", (void*)&SHADOWQUALITY_HIGH_16BIT);
     engine->RegisterGlobalProperty("const int SHADOWQUALITY_HIGH_24BIT", (void*)&SHADOWQUALITY_HIGH_24BIT);
     
+    RegisterObject<TextureStreamer>(engine, "TextureStreamer");
+    engine->RegisterObjectMethod("TextureStreamer", "void set_memoryBudget(uint)", asMETHOD(TextureStreamer, SetMemoryBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "uint get_memoryBudget() const", asMETHOD(TextureStreamer, GetMemoryBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "void set_minSize(int)", asMETHOD(TextureStreamer, SetMinSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "int get_minSize() const", asMETHOD(TextureStreamer, GetMinSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "void set_maxPendingReloads(uint)", asMETHOD(TextureStreamer, SetMaxPendingReloads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "uint get_maxPendingReloads() const", asMETHOD(TextureStreamer, GetMaxPendingReloads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "void set_keepFrames(uint)", asMETHOD(TextureStreamer, SetKeepFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "uint get_keepFrames() const", asMETHOD(TextureStreamer, GetKeepFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "uint get_numTextures() const", asMETHOD(TextureStreamer, GetNumTextures), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "uint get_numPendingReloads() const", asMETHOD(TextureStreamer, GetNumPendingReloads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("TextureStreamer", "uint get_memoryUse() const", asMETHOD(TextureStreamer, GetMemoryUse), asCALL_THISCALL);
+    
     RegisterObject<Renderer>(engine, "Renderer");
     engine->RegisterObjectMethod("Renderer", "void DrawDebugGeometry(bool) const", asMETHOD(Renderer, DrawDebugGeometry), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void ReloadShaders() const", asMETHOD(Renderer, ReloadShaders), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void CaptureFrame(const String&in)", asMETHOD(Renderer, CaptureFrame), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_numViewports(uint)", asMETHOD(Renderer, SetNumViewports), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numViewports() const", asMETHOD(Renderer, GetNumViewports), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_viewports(uint, Viewport@+)", asMETHOD(Renderer, SetViewport), asCALL_THISCALL);
@@ -1597,8 +1767,14 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Renderer", "int get_maxShadowMaps() const", asMETHOD(Renderer, GetMaxShadowMaps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_reuseShadowMaps(bool)", asMETHOD(Renderer, SetReuseShadowMaps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "bool get_reuseShadowMaps() const", asMETHOD(Renderer, GetReuseShadowMaps), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_shadowCache(bool)", asMETHOD(Renderer, SetShadowCache), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_shadowCache() const", asMETHOD(Renderer, GetShadowCache), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_shadowAtlasSize(int)", asMETHOD(Renderer, SetShadowAtlasSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "int get_shadowAtlasSize() const", asMETHOD(Renderer, GetShadowAtlasSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_dynamicInstancing(bool)", asMETHOD(Renderer, SetDynamicInstancing), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "bool get_dynamicInstancing() const", asMETHOD(Renderer, GetDynamicInstancing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_indirectDraw(bool)", asMETHOD(Renderer, SetIndirectDraw), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_indirectDraw() const", asMETHOD(Renderer, GetIndirectDraw), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_minInstances(int)", asMETHOD(Renderer, SetMinInstances), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "int get_minInstances() const", asMETHOD(Renderer, GetMinInstances), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_maxSortedInstances(int)", asMETHOD(Renderer, SetMaxSortedInstances), asCALL_THISCALL);
@@ -1609,12 +1785,34 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Renderer", "int get_occlusionBufferSize() const", asMETHOD(Renderer, GetOcclusionBufferSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_occluderSizeThreshold(float)", asMETHOD(Renderer, SetOccluderSizeThreshold), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "float get_occluderSizeThreshold() const", asMETHOD(Renderer, GetOccluderSizeThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_temporalOcclusion(bool)", asMETHOD(Renderer, SetTemporalOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_temporalOcclusion() const", asMETHOD(Renderer, GetTemporalOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_gpuOcclusion(bool)", asMETHOD(Renderer, SetGPUOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_gpuOcclusion() const", asMETHOD(Renderer, GetGPUOcclusion), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_textureSkinning(bool)", asMETHOD(Renderer, SetTextureSkinning), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_textureSkinning() const", asMETHOD(Renderer, GetTextureSkinning), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_textureStreaming(bool)", asMETHOD(Renderer, SetTextureStreaming), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_textureStreaming() const", asMETHOD(Renderer, GetTextureStreaming), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_releaseModelCPUData(bool)", asMETHOD(Renderer, SetReleaseModelCPUData), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_releaseModelCPUData() const", asMETHOD(Renderer, GetReleaseModelCPUData), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "TextureStreamer@+ get_textureStreamer() const", asMETHOD(Renderer, GetTextureStreamer), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_resolutionScale(float)", asMETHOD(Renderer, SetResolutionScale), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "float get_resolutionScale() const", asMETHOD(Renderer, GetResolutionScale), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_dynamicResolution(bool)", asMETHOD(Renderer, SetDynamicResolution), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_dynamicResolution() const", asMETHOD(Renderer, GetDynamicResolution), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_dynamicResolutionTarget(float)", asMETHOD(Renderer, SetDynamicResolutionTarget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "float get_dynamicResolutionTarget() const", asMETHOD(Renderer, GetDynamicResolutionTarget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_minResolutionScale(float)", asMETHOD(Renderer, SetMinResolutionScale), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "float get_minResolutionScale() const", asMETHOD(Renderer, GetMinResolutionScale), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_mobileShadowBiasMul(float)", asMETHOD(Renderer, SetMobileShadowBiasMul), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "float get_mobileShadowBiasMul() const", asMETHOD(Renderer, GetMobileShadowBiasMul), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_mobileShadowBiasAdd(float)", asMETHOD(Renderer, SetMobileShadowBiasAdd), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "float get_mobileShadowBiasAdd() const", asMETHOD(Renderer, GetMobileShadowBiasAdd), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numPrimitives() const", asMETHOD(Renderer, GetNumPrimitives), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numBatches() const", asMETHOD(Renderer, GetNumBatches), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "uint get_numStateChanges() const", asMETHOD(Renderer, GetNumStateChanges), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "uint get_numAvoidedStateChanges() const", asMETHOD(Renderer, GetNumAvoidedStateChanges), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "uint get_numParameterBytes() const", asMETHOD(Renderer, GetNumParameterBytes), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numViews() const", asMETHOD(Renderer, GetNumViews), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numGeometries(bool) const", asMETHOD(Renderer, GetNumGeometries), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numLights(bool) const", asMETHOD(Renderer, GetNumLights), asCALL_THISCALL);
@@ -1639,6 +1837,11 @@ static DebugRenderer* SceneGetDebugRenderer(Scene* ptr)
 
 static void RegisterDebugRenderer(asIScriptEngine* engine)
 {
+    engine->RegisterEnum("DebugShape");
+    engine->RegisterEnumValue("DebugShape", "DEBUG_BOX", DEBUG_BOX);
+    engine->RegisterEnumValue("DebugShape", "DEBUG_SPHERE", DEBUG_SPHERE);
+    engine->RegisterEnumValue("DebugShape", "DEBUG_CYLINDER", DEBUG_CYLINDER);
+
     engine->RegisterObjectMethod("DebugRenderer", "void AddLine(const Vector3&in, const Vector3&in, const Color&in, bool depthTest = true)", asMETHODPR(DebugRenderer, AddLine, (const Vector3&, const Vector3&, const Color&, bool), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugRenderer", "void AddTriangle(const Vector3&in, const Vector3&in, const Vector3&in, const Color&in, bool depthTest = true)", asMETHODPR(DebugRenderer, AddTriangle, (const Vector3&, const Vector3&, const Vector3&, const Color&, bool), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugRenderer", "void AddNode(Node@+, float scale = 1.0, bool depthTest = true)", asMETHOD(DebugRenderer, AddNode), asCALL_THISCALL);
@@ -1647,6 +1850,14 @@ static void RegisterDebugRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("DebugRenderer", "void AddPolyhedron(const Polyhedron&in, const Color&in, bool depthTest = true)", asMETHOD(DebugRenderer, AddPolyhedron), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugRenderer", "void AddSphere(const Sphere&in, const Color&in, bool depthTest = true)", asMETHOD(DebugRenderer, AddSphere), asCALL_THISCALL);
     engine->RegisterObjectMethod("DebugRenderer", "void AddSkeleton(Skeleton@+, const Color&in, bool depthTest = true)", asMETHOD(DebugRenderer, AddSkeleton), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "void AddCylinder(const Vector3&in, float, float, const Color&in, bool depthTest = true)", asMETHOD(DebugRenderer, AddCylinder), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "void AddShape(DebugShape, const Matrix3x4&in, const Color&in, bool depthTest = true)", asMETHOD(DebugRenderer, AddShape), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "void BeginPersistentGeometry(StringHash)", asMETHOD(DebugRenderer, BeginPersistentGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "void EndPersistentGeometry(const Matrix3x4&in transform = Matrix3x4())", asMETHOD(DebugRenderer, EndPersistentGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "bool DrawPersistentGeometry(StringHash, const Matrix3x4&in transform = Matrix3x4())", asMETHOD(DebugRenderer, DrawPersistentGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "void RemovePersistentGeometry(StringHash)", asMETHOD(DebugRenderer, RemovePersistentGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "void RemoveAllPersistentGeometry()", asMETHOD(DebugRenderer, RemoveAllPersistentGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DebugRenderer", "bool HasPersistentGeometry(StringHash) const", asMETHOD(DebugRenderer, HasPersistentGeometry), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "DebugRenderer@+ get_debugRenderer() const", asFUNCTION(SceneGetDebugRenderer), asCALL_CDECL_OBJLAST);
     engine->RegisterGlobalFunction("DebugRenderer@+ get_debugRenderer()", asFUNCTION(GetDebugRenderer), asCALL_CDECL);
 }
@@ -1755,6 +1966,10 @@ static void RegisterOctree(asIScriptEngine* engine)
     engine->RegisterObjectMethod("RayQueryResult", "Node@+ get_node() const", asFUNCTION(RayQueryResultGetNode), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectProperty("RayQueryResult", "uint subObject", offsetof(RayQueryResult, subObject_));
     
+    engine->RegisterEnum("SpatialIndexType");
+    engine->RegisterEnumValue("SpatialIndexType", "SPATIAL_OCTANTS", SPATIAL_OCTANTS);
+    engine->RegisterEnumValue("SpatialIndexType", "SPATIAL_BVH", SPATIAL_BVH);
+    
     RegisterComponent<Octree>(engine, "Octree");
     engine->RegisterObjectMethod("Octree", "void SetSize(const BoundingBox&in, uint)", asMETHOD(Octree, SetSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("Octree", "void DrawDebugGeometry(bool) const", asMETHODPR(Octree, DrawDebugGeometry, (bool), void), asCALL_THISCALL);
@@ -1768,6 +1983,8 @@ static void RegisterOctree(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Octree", "Array<Drawable@>@ GetDrawables(const Sphere&in, uint8 drawableFlags = DRAWABLE_ANY, uint viewMask = DEFAULT_VIEWMASK)", asFUNCTION(OctreeGetDrawablesSphere), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Octree", "const BoundingBox& get_worldBoundingBox() const", asMETHODPR(Octree, GetWorldBoundingBox, () const, const BoundingBox&), asCALL_THISCALL);
     engine->RegisterObjectMethod("Octree", "uint get_numLevels() const", asMETHOD(Octree, GetNumLevels), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Octree", "void set_spatialIndex(SpatialIndexType)", asMETHOD(Octree, SetSpatialIndex), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Octree", "SpatialIndexType get_spatialIndex() const", asMETHOD(Octree, GetSpatialIndex), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Octree@+ get_octree() const", asFUNCTION(SceneGetOctree), asCALL_CDECL_OBJLAST);
     engine->RegisterGlobalFunction("Octree@+ get_octree()", asFUNCTION(GetOctree), asCALL_CDECL);
 }
@@ -1790,13 +2007,16 @@ void RegisterGraphicsAPI(asIScriptEngine* engine)
     RegisterStaticModelGroup(engine);
     RegisterSkybox(engine);
     RegisterAnimatedModel(engine);
+    RegisterAnimatedModelGroup(engine);
     RegisterAnimationController(engine);
     RegisterBillboardSet(engine);
     RegisterParticleEffect(engine);
     RegisterParticleEmitter(engine);
+    RegisterGPUParticleEmitter(engine);
     RegisterCustomGeometry(engine);
     RegisterDecalSet(engine);
     RegisterTerrain(engine);
+    RegisterCDLODTerrain(engine);
     RegisterOctree(engine);
     RegisterGraphics(engine);
     RegisterRenderer(engine);
@@ -135,6 +135,9 @@ static void RegisterLog(asIScriptEngine* engine)
     RegisterObject<Log>(engine, "Log");
     engine->RegisterObjectMethod("Log", "void Open(const String&in)", asMETHOD(Log, Open), asCALL_THISCALL);
     engine->RegisterObjectMethod("Log", "void Close()", asMETHOD(Log, Close), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "void OpenBinary(const String&in)", asMETHOD(Log, OpenBinary), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "void CloseBinary()", asMETHOD(Log, CloseBinary), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "bool get_binaryOpen() const", asMETHOD(Log, IsBinaryOpen), asCALL_THISCALL);
     engine->RegisterObjectMethod("Log", "void Write(const String&in, bool error = false)", asFUNCTION(LogWrite), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Log", "void Debug(const String&in)", asFUNCTION(LogDebug), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Log", "void Info(const String&in)", asFUNCTION(LogInfo), asCALL_CDECL_OBJLAST);
@@ -147,6 +150,8 @@ static void RegisterLog(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Log", "String get_lastMessage()", asMETHOD(Log, GetLastMessage), asCALL_THISCALL);
     engine->RegisterObjectMethod("Log", "void set_quiet(bool)", asMETHOD(Log, SetQuiet), asCALL_THISCALL);
     engine->RegisterObjectMethod("Log", "bool get_quiet() const", asMETHOD(Log, IsQuiet), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "void set_async(bool)", asMETHOD(Log, SetAsync), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Log", "bool get_async() const", asMETHOD(Log, IsAsync), asCALL_THISCALL);
     engine->RegisterGlobalFunction("Log@+ get_log()", asFUNCTION(GetLog), asCALL_CDECL);
 
     // Register also Print() functions for convenience
@@ -231,6 +236,16 @@ static bool VariantEqualsBuffer(const VectorBuffer& buffer, Variant* ptr)
     return (*ptr) == buffer.GetBuffer();
 }
 
+static VectorBuffer CompressVectorBufferDefault(VectorBuffer& src)
+{
+    return CompressVectorBuffer(src);
+}
+
+static VectorBuffer DecompressVectorBufferDefault(VectorBuffer& src)
+{
+    return DecompressVectorBuffer(src);
+}
+
 static FileSystem* GetFileSystem()
 {
     return GetScriptContext()->GetSubsystem<FileSystem>();
@@ -322,8 +337,8 @@ static void RegisterSerialization(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Variant", "bool opEquals(const VectorBuffer&in) const", asFUNCTION(VariantEqualsBuffer), asCALL_CDECL_OBJLAST);
     
     // Register VectorBuffer compression functions
-    engine->RegisterGlobalFunction("VectorBuffer CompressVectorBuffer(VectorBuffer&in)", asFUNCTION(CompressVectorBuffer), asCALL_CDECL);
-    engine->RegisterGlobalFunction("VectorBuffer DecompressVectorBuffer(VectorBuffer&in)", asFUNCTION(DecompressVectorBuffer), asCALL_CDECL);
+    engine->RegisterGlobalFunction("VectorBuffer CompressVectorBuffer(VectorBuffer&in)", asFUNCTION(CompressVectorBufferDefault), asCALL_CDECL);
+    engine->RegisterGlobalFunction("VectorBuffer DecompressVectorBuffer(VectorBuffer&in)", asFUNCTION(DecompressVectorBufferDefault), asCALL_CDECL);
 }
 
 void RegisterFileSystem(asIScriptEngine* engine)
@@ -48,6 +48,13 @@ static CScriptArray* NavigationMeshFindPath(const Vector3& start, const Vector3&
     return VectorToArray<Vector3>(dest, "Array<Vector3>");
 }
 
+static CScriptArray* NavigationMeshGetPathResult(unsigned requestID, NavigationMesh* ptr)
+{
+    PODVector<Vector3> dest;
+    ptr->GetPathResult(requestID, dest);
+    return VectorToArray<Vector3>(dest, "Array<Vector3>");
+}
+
 static CScriptArray* DynamicNavigationMeshFindPath(const Vector3& start, const Vector3& end, const Vector3& extents, DynamicNavigationMesh* ptr)
 {
     PODVector<Vector3> dest;
@@ -55,6 +62,13 @@ static CScriptArray* DynamicNavigationMeshFindPath(const Vector3& start, const V
     return VectorToArray<Vector3>(dest, "Array<Vector3>");
 }
 
+static CScriptArray* DynamicNavigationMeshGetPathResult(unsigned requestID, DynamicNavigationMesh* ptr)
+{
+    PODVector<Vector3> dest;
+    ptr->GetPathResult(requestID, dest);
+    return VectorToArray<Vector3>(dest, "Array<Vector3>");
+}
+
 static CScriptArray* DetourCrowdManagerGetActiveAgents(DetourCrowdManager* crowd)
 {
     const PODVector<CrowdAgent*>& agents = crowd->GetActiveAgents();
@@ -65,6 +79,14 @@ template<class T> static void RegisterNavMeshBase(asIScriptEngine* engine, const
 {
     engine->RegisterObjectMethod(name, "bool Build()", asMETHODPR(T, Build, (void), bool), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "bool Build(const BoundingBox&in)", asMETHODPR(T, Build, (const BoundingBox&), bool), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "bool BuildAsync(const BoundingBox&in)", asMETHOD(T, BuildAsync), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "uint RequestPath(const Vector3&in, const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asMETHOD(T, RequestPath), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "void CancelPathRequest(uint)", asMETHOD(T, CancelPathRequest), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "uint RequestFlowField(const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asMETHOD(T, RequestFlowField), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "void ReleaseFlowField(uint)", asMETHOD(T, ReleaseFlowField), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "bool IsFlowFieldReady(uint) const", asMETHOD(T, IsFlowFieldReady), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "Vector3 GetFlowDirection(uint, const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asMETHOD(T, GetFlowDirection), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "float GetFlowCost(uint, const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asMETHOD(T, GetFlowCost), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "void SetAreaCost(uint, float)", asMETHOD(T, SetAreaCost), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "float GetAreaCost(uint) const", asMETHOD(T, GetAreaCost), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "Vector3 FindNearestPoint(const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asMETHOD(T, FindNearestPoint), asCALL_THISCALL);
@@ -106,6 +128,12 @@ template<class T> static void RegisterNavMeshBase(asIScriptEngine* engine, const
     engine->RegisterObjectMethod(name, "const BoundingBox& get_boundingBox() const", asMETHOD(T, GetBoundingBox), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "BoundingBox get_worldBoundingBox() const", asMETHOD(T, GetWorldBoundingBox), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "IntVector2 get_numTiles() const", asMETHOD(T, GetNumTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "bool get_buildingAsync() const", asMETHOD(T, IsBuildingAsync), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "void set_pathQueryBudget(int)", asMETHOD(T, SetPathQueryBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "int get_pathQueryBudget() const", asMETHOD(T, GetPathQueryBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "uint get_numPathRequests() const", asMETHOD(T, GetNumPathRequests), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "void set_hierarchicalPathfinding(bool)", asMETHOD(T, SetHierarchicalPathfinding), asCALL_THISCALL);
+    engine->RegisterObjectMethod(name, "bool get_hierarchicalPathfinding() const", asMETHOD(T, GetHierarchicalPathfinding), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "void set_partitionType()", asMETHOD(T, SetPartitionType), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "NavmeshPartitionType get_partitionType()", asMETHOD(T, GetPartitionType), asCALL_THISCALL);
     engine->RegisterObjectMethod(name, "void set_drawOffMeshConnections(bool)", asMETHOD(T, SetDrawOffMeshConnections), asCALL_THISCALL);
@@ -123,6 +151,7 @@ void RegisterNavigationMesh(asIScriptEngine* engine)
     RegisterComponent<NavigationMesh>(engine, "NavigationMesh");
     RegisterNavMeshBase<NavigationMesh>(engine, "NavigationMesh");
     engine->RegisterObjectMethod("NavigationMesh", "Array<Vector3>@ FindPath(const Vector3&in, const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asFUNCTION(NavigationMeshFindPath), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("NavigationMesh", "Array<Vector3>@ GetPathResult(uint)", asFUNCTION(NavigationMeshGetPathResult), asCALL_CDECL_OBJLAST);
 }
 
 void RegisterDynamicNavigationMesh(asIScriptEngine* engine)
@@ -131,10 +160,13 @@ void RegisterDynamicNavigationMesh(asIScriptEngine* engine)
     RegisterSubclass<NavigationMesh, DynamicNavigationMesh>(engine, "NavigationMesh", "DynamicNavigationMesh");
     RegisterNavMeshBase<DynamicNavigationMesh>(engine, "DynamicNavigationMesh");
     engine->RegisterObjectMethod("DynamicNavigationMesh", "Array<Vector3>@ FindPath(const Vector3&in, const Vector3&in, const Vector3&in extents = Vector3(1.0, 1.0, 1.0))", asFUNCTION(DynamicNavigationMeshFindPath), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("DynamicNavigationMesh", "Array<Vector3>@ GetPathResult(uint)", asFUNCTION(DynamicNavigationMeshGetPathResult), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("DynamicNavigationMesh", "void set_drawObstacles(bool)", asMETHOD(DynamicNavigationMesh, SetDrawObstacles), asCALL_THISCALL);
     engine->RegisterObjectMethod("DynamicNavigationMesh", "bool get_drawObstacles() const", asMETHOD(DynamicNavigationMesh, GetDrawObstacles), asCALL_THISCALL);
     engine->RegisterObjectMethod("DynamicNavigationMesh", "void set_maxObstacles(uint)", asMETHOD(DynamicNavigationMesh, SetMaxObstacles), asCALL_THISCALL);
     engine->RegisterObjectMethod("DynamicNavigationMesh", "uint get_maxObstacles() const", asMETHOD(DynamicNavigationMesh, GetMaxObstacles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DynamicNavigationMesh", "void set_tileUpdateMs(int)", asMETHOD(DynamicNavigationMesh, SetTileUpdateMs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DynamicNavigationMesh", "int get_tileUpdateMs() const", asMETHOD(DynamicNavigationMesh, GetTileUpdateMs), asCALL_THISCALL);
 }
 
 void RegisterOffMeshConnection(asIScriptEngine* engine)
@@ -182,6 +214,8 @@ void RegisterDetourCrowdManager(asIScriptEngine* engine)
     engine->RegisterObjectMethod("DetourCrowdManager", "NavigationMesh@+ get_navMesh() const", asMETHOD(DetourCrowdManager, GetNavigationMesh), asCALL_THISCALL);
     engine->RegisterObjectMethod("DetourCrowdManager", "int get_maxAgents() const", asMETHOD(DetourCrowdManager, GetMaxAgents), asCALL_THISCALL);
     engine->RegisterObjectMethod("DetourCrowdManager", "void set_maxAgents(int)", asMETHOD(DetourCrowdManager, SetMaxAgents), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DetourCrowdManager", "bool get_parallelUpdate() const", asMETHOD(DetourCrowdManager, GetParallelUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DetourCrowdManager", "void set_parallelUpdate(bool)", asMETHOD(DetourCrowdManager, SetParallelUpdate), asCALL_THISCALL);
     engine->RegisterObjectMethod("DetourCrowdManager", "Array<CrowdAgent@>@ GetActiveAgents()", asFUNCTION(DetourCrowdManagerGetActiveAgents), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("DetourCrowdManager", "void SetAreaCost(uint, uint, float)", asMETHOD(DetourCrowdManager, SetAreaCost), asCALL_THISCALL);
     engine->RegisterObjectMethod("DetourCrowdManager", "float GetAreaCost(uint, uint)", asMETHOD(DetourCrowdManager, GetAreaCost), asCALL_THISCALL);
@@ -78,6 +78,17 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Connection", "const Vector3& get_position() const", asMETHOD(Connection, GetPosition), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_rotation(const Quaternion&in)", asMETHOD(Connection, SetRotation), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "const Quaternion& get_rotation() const", asMETHOD(Connection, GetRotation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void set_interestRadius(float)", asMETHOD(Connection, SetInterestRadius), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "float get_interestRadius() const", asMETHOD(Connection, GetInterestRadius), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "uint get_numInterestNodes() const", asMETHOD(Connection, GetNumInterestNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void set_trafficProfiling(bool)", asMETHOD(Connection, SetTrafficProfiling), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "bool get_trafficProfiling() const", asMETHOD(Connection, GetTrafficProfiling), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void ResetTrafficStats()", asMETHOD(Connection, ResetTrafficStats), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void set_predictedNode(Node@+)", asMETHOD(Connection, SetPredictedNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "Node@+ get_predictedNode() const", asMETHOD(Connection, GetPredictedNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "uint8 get_ackedTimeStamp() const", asMETHOD(Connection, GetAckedTimeStamp), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "uint get_numUnackedControls() const", asMETHOD(Connection, GetNumUnackedControls), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "const Controls& get_unackedControls(uint) const", asMETHOD(Connection, GetUnackedControls), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void SendPackageToClient(PackageFile@+)", asMETHOD(Connection, SendPackageToClient), asCALL_THISCALL);
     engine->RegisterObjectProperty("Connection", "Controls controls", offsetof(Connection, controls_));
     engine->RegisterObjectProperty("Connection", "uint8 timeStamp", offsetof(Connection, timeStamp_));
@@ -147,6 +158,16 @@ static bool NetworkCheckRemoteEvent(const String& eventType, Network* ptr)
     return ptr->CheckRemoteEvent(eventType);
 }
 
+static void NetworkSetRemoteEventCoalescing(const String& eventType, bool enable, Network* ptr)
+{
+    ptr->SetRemoteEventCoalescing(eventType, enable);
+}
+
+static bool NetworkIsRemoteEventCoalesced(const String& eventType, Network* ptr)
+{
+    return ptr->IsRemoteEventCoalesced(eventType);
+}
+
 static HttpRequest* NetworkMakeHttpRequest(const String& url, const String& verb, CScriptArray* headers, const String& postData, Network* ptr)
 {
     SharedPtr<HttpRequest> request = ptr->MakeHttpRequest(url, verb, ArrayToVector<String>(headers), postData);
@@ -172,10 +193,20 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "void UnregisterRemoteEvent(const String&in) const", asFUNCTION(NetworkUnregisterRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void UnregisterAllRemoteEvents()", asMETHOD(Network, UnregisterAllRemoteEvents), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "bool CheckRemoteEvent(const String&in) const", asFUNCTION(NetworkCheckRemoteEvent), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "void SetRemoteEventCoalescing(const String&in, bool)", asFUNCTION(NetworkSetRemoteEventCoalescing), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "bool IsRemoteEventCoalesced(const String&in) const", asFUNCTION(NetworkIsRemoteEventCoalesced), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "HttpRequest@ MakeHttpRequest(const String&in, const String&in verb = String(), Array<String>@+ headers = null, const String&in postData = String())", asFUNCTION(NetworkMakeHttpRequest), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void SendPackageToClients(Scene@+, PackageFile@+)", asMETHOD(Network, SendPackageToClients), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_updateFps(int)", asMETHOD(Network, SetUpdateFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "int get_updateFps() const", asMETHOD(Network, GetUpdateFps), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_interestCellSize(float)", asMETHOD(Network, SetInterestCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "float get_interestCellSize() const", asMETHOD(Network, GetInterestCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_initialStateBudget(uint)", asMETHOD(Network, SetInitialStateBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "uint get_initialStateBudget() const", asMETHOD(Network, GetInitialStateBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_parallelMessageDecoding(bool)", asMETHOD(Network, SetParallelMessageDecoding), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_parallelMessageDecoding() const", asMETHOD(Network, GetParallelMessageDecoding), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_remoteEventBatching(bool)", asMETHOD(Network, SetRemoteEventBatching), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_remoteEventBatching() const", asMETHOD(Network, GetRemoteEventBatching), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_simulatedLatency(int)", asMETHOD(Network, SetSimulatedLatency), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "int get_simulatedLatency() const", asMETHOD(Network, GetSimulatedLatency), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_simulatedPacketLoss(float)", asMETHOD(Network, SetSimulatedPacketLoss), asCALL_THISCALL);
@@ -178,6 +178,7 @@ static void RegisterRigidBody(asIScriptEngine* engine)
     engine->RegisterObjectMethod("RigidBody", "void set_kinematic(bool)", asMETHOD(RigidBody, SetKinematic), asCALL_THISCALL);
     engine->RegisterObjectMethod("RigidBody", "bool get_kinematic() const", asMETHOD(RigidBody, IsKinematic), asCALL_THISCALL);
     engine->RegisterObjectMethod("RigidBody", "bool get_active() const", asMETHOD(RigidBody, IsActive), asCALL_THISCALL);
+    engine->RegisterObjectMethod("RigidBody", "bool get_frozen() const", asMETHOD(RigidBody, IsFrozen), asCALL_THISCALL);
     engine->RegisterObjectMethod("RigidBody", "void set_collisionLayer(uint)", asMETHOD(RigidBody, SetCollisionLayer), asCALL_THISCALL);
     engine->RegisterObjectMethod("RigidBody", "uint get_collisionLayer() const", asMETHOD(RigidBody, GetCollisionLayer), asCALL_THISCALL);
     engine->RegisterObjectMethod("RigidBody", "void set_collisionMask(uint)", asMETHOD(RigidBody, SetCollisionMask), asCALL_THISCALL);
@@ -246,6 +247,23 @@ static PhysicsRaycastResult PhysicsWorldSphereCast(const Ray& ray, float radius,
     return result;
 }
 
+static CScriptArray* PhysicsWorldSphereCastBatch(CScriptArray* rays, float radius, float maxDistance, unsigned collisionMask, PhysicsWorld* ptr)
+{
+    PODVector<Ray> srcRays = ArrayToPODVector<Ray>(rays);
+    PODVector<PhysicsRaycastQuery> queries(srcRays.Size());
+    for (unsigned i = 0; i < srcRays.Size(); ++i)
+        queries[i] = PhysicsRaycastQuery(srcRays[i], maxDistance, collisionMask, radius);
+
+    PODVector<PhysicsRaycastResult> result;
+    ptr->RaycastSingleBatch(result, queries);
+    return VectorToArray<PhysicsRaycastResult>(result, "Array<PhysicsRaycastResult>");
+}
+
+static CScriptArray* PhysicsWorldRaycastSingleBatch(CScriptArray* rays, float maxDistance, unsigned collisionMask, PhysicsWorld* ptr)
+{
+    return PhysicsWorldSphereCastBatch(rays, 0.0f, maxDistance, collisionMask, ptr);
+}
+
 static PhysicsRaycastResult PhysicsWorldConvexCast(CollisionShape* shape, const Vector3& startPos, const Quaternion& startRot, const Vector3& endPos, const Quaternion& endRot, unsigned collisionMask, PhysicsWorld* ptr)
 {
     PhysicsRaycastResult result;
@@ -294,6 +312,8 @@ static void RegisterPhysicsWorld(asIScriptEngine* engine)
     engine->RegisterObjectMethod("PhysicsWorld", "Array<PhysicsRaycastResult>@ Raycast(const Ray&in, float maxDistance = M_INFINITY, uint collisionMask = 0xffff)", asFUNCTION(PhysicsWorldRaycast), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("PhysicsWorld", "PhysicsRaycastResult RaycastSingle(const Ray&in, float maxDistance = M_INFINITY, uint collisionMask = 0xffff)", asFUNCTION(PhysicsWorldRaycastSingle), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("PhysicsWorld", "PhysicsRaycastResult SphereCast(const Ray&in, float, float maxDistance = M_INFINITY, uint collisionMask = 0xffff)", asFUNCTION(PhysicsWorldSphereCast), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("PhysicsWorld", "Array<PhysicsRaycastResult>@ RaycastSingleBatch(Array<Ray>@+, float, uint collisionMask = 0xffff)", asFUNCTION(PhysicsWorldRaycastSingleBatch), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("PhysicsWorld", "Array<PhysicsRaycastResult>@ SphereCastBatch(Array<Ray>@+, float, float, uint collisionMask = 0xffff)", asFUNCTION(PhysicsWorldSphereCastBatch), asCALL_CDECL_OBJLAST);
     // There seems to be a bug in AngelScript resulting in a crash if we use an auto handle with this function.
     // Work around by manually releasing the CollisionShape handle
     engine->RegisterObjectMethod("PhysicsWorld", "PhysicsRaycastResult ConvexCast(CollisionShape@, const Vector3&in, const Quaternion&in, const Vector3&in, const Quaternion&in, uint collisionMask = 0xffff)", asFUNCTION(PhysicsWorldConvexCast), asCALL_CDECL_OBJLAST);
@@ -316,6 +336,25 @@ static void RegisterPhysicsWorld(asIScriptEngine* engine)
     engine->RegisterObjectMethod("PhysicsWorld", "bool get_internalEdge() const", asMETHOD(PhysicsWorld, GetInternalEdge), asCALL_THISCALL);
     engine->RegisterObjectMethod("PhysicsWorld", "void set_splitImpulse(bool)", asMETHOD(PhysicsWorld, SetSplitImpulse), asCALL_THISCALL);
     engine->RegisterObjectMethod("PhysicsWorld", "bool get_splitImpulse() const", asMETHOD(PhysicsWorld, GetSplitImpulse), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void set_parallelSimulation(bool)", asMETHOD(PhysicsWorld, SetParallelSimulation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "bool get_parallelSimulation() const", asMETHOD(PhysicsWorld, GetParallelSimulation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void set_saveCookedGeometry(bool)", asMETHOD(PhysicsWorld, SetSaveCookedGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "bool get_saveCookedGeometry() const", asMETHOD(PhysicsWorld, GetSaveCookedGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void set_deterministic(bool)", asMETHOD(PhysicsWorld, SetDeterministic), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "bool get_deterministic() const", asMETHOD(PhysicsWorld, GetDeterministic), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void set_numSnapshots(uint)", asMETHOD(PhysicsWorld, SetNumSnapshots), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "uint get_numSnapshots() const", asMETHOD(PhysicsWorld, GetNumSnapshots), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "uint get_simulationStep() const", asMETHOD(PhysicsWorld, GetSimulationStep), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void SaveSnapshot()", asMETHOD(PhysicsWorld, SaveSnapshot), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "bool RestoreSnapshot(uint)", asMETHOD(PhysicsWorld, RestoreSnapshot), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "bool HasSnapshot(uint) const", asMETHOD(PhysicsWorld, HasSnapshot), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void AddObserver(Node@+)", asMETHOD(PhysicsWorld, AddObserver), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void RemoveObserver(Node@+)", asMETHOD(PhysicsWorld, RemoveObserver), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void RemoveAllObservers()", asMETHOD(PhysicsWorld, RemoveAllObservers), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "void set_freezeDistance(float)", asMETHOD(PhysicsWorld, SetFreezeDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "float get_freezeDistance() const", asMETHOD(PhysicsWorld, GetFreezeDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "uint get_numObservers() const", asMETHOD(PhysicsWorld, GetNumObservers), asCALL_THISCALL);
+    engine->RegisterObjectMethod("PhysicsWorld", "uint get_numFrozenBodies() const", asMETHOD(PhysicsWorld, GetNumFrozenBodies), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "PhysicsWorld@+ get_physicsWorld() const", asFUNCTION(SceneGetPhysicsWorld), asCALL_CDECL_OBJLAST);
     engine->RegisterGlobalFunction("PhysicsWorld@+ get_physicsWorld()", asFUNCTION(GetPhysicsWorld), asCALL_CDECL);
 }
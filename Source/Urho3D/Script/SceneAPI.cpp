@@ -24,10 +24,12 @@
 #include "../Scene/Animatable.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Scene/ObjectAnimation.h"
+#include "../Scene/Prefab.h"
 #include "../IO/PackageFile.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SmoothedTransform.h"
 #include "../Container/Sort.h"
+#include "../Scene/SceneStreamer.h"
 #include "../Scene/SplinePath.h"
 #include "../Scene/ValueAnimation.h"
 
@@ -105,6 +107,16 @@ static bool NodeSaveXMLVectorBuffer(VectorBuffer& buffer, const String& indentat
     return ptr->SaveXML(buffer, indentation);
 }
 
+static bool NodeSaveBulk(File* file, Node* ptr)
+{
+    return file && ptr->SaveBulk(*file);
+}
+
+static bool NodeSaveBulkVectorBuffer(VectorBuffer& buffer, Node* ptr)
+{
+    return ptr->SaveBulk(buffer);
+}
+
 static void RegisterNode(asIScriptEngine* engine)
 {
     engine->RegisterEnum("CreateMode");
@@ -128,6 +140,8 @@ static void RegisterNode(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Node", "bool get_enabledSelf() const", asMETHOD(Node, IsEnabledSelf), asCALL_THISCALL);
     engine->RegisterObjectMethod("Node", "bool SaveXML(File@+, const String&in indentation = \"\t\")", asFUNCTION(NodeSaveXML), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Node", "bool SaveXML(VectorBuffer&, const String&in indentation = \"\t\")", asFUNCTION(NodeSaveXMLVectorBuffer), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Node", "bool SaveBulk(File@+)", asFUNCTION(NodeSaveBulk), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Node", "bool SaveBulk(VectorBuffer&)", asFUNCTION(NodeSaveBulkVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Node", "Node@+ Clone(CreateMode mode = REPLICATED)", asMETHOD(Node, Clone), asCALL_THISCALL);
     RegisterObjectConstructor<Node>(engine, "Node");
     RegisterNamedObjectConstructor<Node>(engine, "Node");
@@ -142,11 +156,43 @@ static void RegisterNode(asIScriptEngine* engine)
     engine->RegisterObjectMethod("DebugRenderer", "void DrawDebugGeometry(DebugRenderer@+, bool)", asMETHOD(DebugRenderer, DrawDebugGeometry), asCALL_THISCALL);
 }
 
+static void RegisterPrefab(asIScriptEngine* engine)
+{
+    RegisterResource<Prefab>(engine, "Prefab");
+    engine->RegisterObjectMethod("Prefab", "Node@+ Instantiate(Node@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asMETHOD(Prefab, Instantiate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "uint get_numNodes() const", asMETHOD(Prefab, GetNumNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Prefab", "uint get_numComponents() const", asMETHOD(Prefab, GetNumComponents), asCALL_THISCALL);
+}
+
 static bool SceneLoadXML(File* file, Scene* ptr)
 {
     return file && ptr->LoadXML(*file);
 }
 
+static bool SceneApplySave(File* file, Scene* ptr)
+{
+    return file && ptr->ApplySave(*file);
+}
+
+static Node* SceneGetNodeByName(const String& name, Scene* ptr)
+{
+    return ptr->GetNodeByName(name);
+}
+
+static CScriptArray* SceneGetNodesByName(const String& name, Scene* ptr)
+{
+    PODVector<Node*> nodes;
+    ptr->GetNodesByName(nodes, name);
+    return VectorToHandleArray<Node>(nodes, "Array<Node@>");
+}
+
+static CScriptArray* SceneGetComponentsByType(const String& typeName, Scene* ptr)
+{
+    PODVector<Component*> components;
+    ptr->GetComponentsByType(components, typeName);
+    return VectorToHandleArray<Component>(components, "Array<Component@>");
+}
+
 static bool SceneLoadXMLVectorBuffer(VectorBuffer& buffer, Scene* ptr)
 {
     return ptr->LoadXML(buffer);
@@ -172,6 +218,26 @@ static Node* SceneInstantiateVectorBuffer(VectorBuffer& buffer, const Vector3& p
     return ptr->Instantiate(buffer, position, rotation, mode);
 }
 
+static bool SceneSaveBulk(File* file, Scene* ptr)
+{
+    return file && ptr->SaveBulk(*file);
+}
+
+static bool SceneSaveBulkVectorBuffer(VectorBuffer& buffer, Scene* ptr)
+{
+    return ptr->SaveBulk(buffer);
+}
+
+static Node* SceneInstantiateBulk(File* file, const Vector3& position, const Quaternion& rotation, CreateMode mode, Scene* ptr)
+{
+    return file ? ptr->InstantiateBulk(*file, position, rotation, mode) : 0;
+}
+
+static Node* SceneInstantiateBulkVectorBuffer(VectorBuffer& buffer, const Vector3& position, const Quaternion& rotation, CreateMode mode, Scene* ptr)
+{
+    return ptr->InstantiateBulk(buffer, position, rotation, mode);
+}
+
 static Node* SceneInstantiateXML(File* file, const Vector3& position, const Quaternion& rotation, CreateMode mode, Scene* ptr)
 {
     return file ? ptr->InstantiateXML(*file, position, rotation, mode) : 0;
@@ -227,6 +293,8 @@ static void RegisterSmoothedTransform(asIScriptEngine* engine)
 {
     RegisterComponent<SmoothedTransform>(engine, "SmoothedTransform");
     engine->RegisterObjectMethod("SmoothedTransform", "void Update(float, float)", asMETHOD(SmoothedTransform, Update), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SmoothedTransform", "void UpdateInterpolation(float, float)", asMETHOD(SmoothedTransform, UpdateInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SmoothedTransform", "uint get_numSnapshots() const", asMETHOD(SmoothedTransform, GetNumSnapshots), asCALL_THISCALL);
     engine->RegisterObjectMethod("SmoothedTransform", "void set_targetPosition(const Vector3&in)", asMETHOD(SmoothedTransform, SetTargetPosition), asCALL_THISCALL);
     engine->RegisterObjectMethod("SmoothedTransform", "const Vector3& get_targetPosition() const", asMETHOD(SmoothedTransform, GetTargetPosition), asCALL_THISCALL);
     engine->RegisterObjectMethod("SmoothedTransform", "void set_targetRotation(const Quaternion&in)", asMETHOD(SmoothedTransform, SetTargetRotation), asCALL_THISCALL);
@@ -238,6 +306,28 @@ static void RegisterSmoothedTransform(asIScriptEngine* engine)
     engine->RegisterObjectMethod("SmoothedTransform", "bool get_inProgress() const", asMETHOD(SmoothedTransform, IsInProgress), asCALL_THISCALL);
 }
 
+static void RegisterSceneStreamer(asIScriptEngine* engine)
+{
+    RegisterComponent<SceneStreamer>(engine, "SceneStreamer");
+    engine->RegisterObjectMethod("SceneStreamer", "void UnloadAllCells()", asMETHOD(SceneStreamer, UnloadAllCells), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "String GetCellFileName(const IntVector2&in) const", asMETHOD(SceneStreamer, GetCellFileName), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "IntVector2 GetCellCoords(const Vector3&in) const", asMETHOD(SceneStreamer, GetCellCoords), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "bool IsCellLoaded(const IntVector2&in) const", asMETHOD(SceneStreamer, IsCellLoaded), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "Node@+ GetCellNode(const IntVector2&in) const", asMETHOD(SceneStreamer, GetCellNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_cellSize(float)", asMETHOD(SceneStreamer, SetCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "float get_cellSize() const", asMETHOD(SceneStreamer, GetCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_loadDistance(float)", asMETHOD(SceneStreamer, SetLoadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "float get_loadDistance() const", asMETHOD(SceneStreamer, GetLoadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_unloadDistance(float)", asMETHOD(SceneStreamer, SetUnloadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "float get_unloadDistance() const", asMETHOD(SceneStreamer, GetUnloadDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_cellFileFormat(const String&in)", asMETHOD(SceneStreamer, SetCellFileFormat), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "const String& get_cellFileFormat() const", asMETHOD(SceneStreamer, GetCellFileFormat), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "void set_target(Node@+)", asMETHOD(SceneStreamer, SetTarget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "Node@+ get_target() const", asMETHOD(SceneStreamer, GetTarget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "uint get_numCells() const", asMETHOD(SceneStreamer, GetNumCells), asCALL_THISCALL);
+    engine->RegisterObjectMethod("SceneStreamer", "uint get_numLoadedCells() const", asMETHOD(SceneStreamer, GetNumLoadedCells), asCALL_THISCALL);
+}
+
 static void RegisterSplinePath(asIScriptEngine* engine)
 {
     RegisterComponent<SplinePath>(engine, "SplinePath");
@@ -277,11 +367,19 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "bool LoadXML(VectorBuffer&)", asFUNCTION(SceneLoadXMLVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool SaveXML(File@+, const String&in indentation = \"\t\")", asFUNCTION(SceneSaveXML), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool SaveXML(VectorBuffer&, const String&in indentation = \"\t\")", asFUNCTION(SceneSaveXMLVectorBuffer), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool SaveBulk(File@+)", asFUNCTION(SceneSaveBulk), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "bool SaveBulk(VectorBuffer&)", asFUNCTION(SceneSaveBulkVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "bool LoadAsync(File@+, LoadMode mode = LOAD_SCENE_AND_RESOURCES)", asMETHOD(Scene, LoadAsync), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool LoadAsyncXML(File@+, LoadMode mode = LOAD_SCENE_AND_RESOURCES)", asMETHOD(Scene, LoadAsyncXML), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void StopAsyncLoading()", asMETHOD(Scene, StopAsyncLoading), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool SaveAsync(const String&in, bool incremental = false)", asMETHOD(Scene, SaveAsync), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void CompleteAsyncSaving()", asMETHOD(Scene, CompleteAsyncSaving), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool ApplySave(File@+)", asFUNCTION(SceneApplySave), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "Node@+ Instantiate(File@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiate), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "Node@+ Instantiate(VectorBuffer&, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiateVectorBuffer), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "Node@+ Instantiate(Prefab@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asMETHODPR(Scene, Instantiate, (Prefab*, const Vector3&, const Quaternion&, CreateMode), Node*), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "Node@+ InstantiateBulk(File@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiateBulk), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "Node@+ InstantiateBulk(VectorBuffer&, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiateBulkVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "Node@+ InstantiateXML(File@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiateXML), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "Node@+ InstantiateXML(VectorBuffer&, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiateXMLVectorBuffer), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "Node@+ InstantiateXML(XMLFile@+, const Vector3&in, const Quaternion&in, CreateMode mode = REPLICATED)", asFUNCTION(SceneInstantiateXMLFile), asCALL_CDECL_OBJLAST);
@@ -294,10 +392,22 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "void UnregisterAllVars(const String&in)", asMETHOD(Scene, UnregisterAllVars), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Component@+ GetComponent(uint)", asMETHODPR(Scene, GetComponent, (unsigned) const, Component*), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "Node@+ GetNode(uint)", asMETHOD(Scene, GetNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "Node@+ GetNodeByName(const String&in) const", asFUNCTION(SceneGetNodeByName), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "Node@+ GetNodeByName(StringHash) const", asMETHOD(Scene, GetNodeByName), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "Array<Node@>@ GetNodesByName(const String&in) const", asFUNCTION(SceneGetNodesByName), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Scene", "Array<Component@>@ GetComponentsByType(const String&in) const", asFUNCTION(SceneGetComponentsByType), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Scene", "const String& GetVarName(StringHash) const", asMETHOD(Scene, GetVarName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void Update(float)", asMETHOD(Scene, Update), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_updateEnabled(bool)", asMETHOD(Scene, SetUpdateEnabled), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool get_updateEnabled() const", asMETHOD(Scene, IsUpdateEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void BeginTransformEdit()", asMETHOD(Scene, BeginTransformEdit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void EndTransformEdit()", asMETHOD(Scene, EndTransformEdit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_transformEditing() const", asMETHOD(Scene, IsTransformEditing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void UpdateTransforms()", asMETHOD(Scene, UpdateTransforms), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_batchTransformUpdate(bool)", asMETHOD(Scene, SetBatchTransformUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_batchTransformUpdate() const", asMETHOD(Scene, IsBatchTransformUpdate), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_lookupIndexEnabled(bool)", asMETHOD(Scene, SetLookupIndexEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_lookupIndexEnabled() const", asMETHOD(Scene, IsLookupIndexEnabled), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_timeScale(float)", asMETHOD(Scene, SetTimeScale), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_timeScale() const", asMETHOD(Scene, GetTimeScale), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_elapsedTime(float)", asMETHOD(Scene, SetElapsedTime), asCALL_THISCALL);
@@ -306,8 +416,13 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "float get_smoothingConstant() const", asMETHOD(Scene, GetSmoothingConstant), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_snapThreshold(float)", asMETHOD(Scene, SetSnapThreshold), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_snapThreshold() const", asMETHOD(Scene, GetSnapThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_interpolationDelay(float)", asMETHOD(Scene, SetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_interpolationDelay() const", asMETHOD(Scene, GetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_interpolating() const", asMETHOD(Scene, IsInterpolating), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_networkTime() const", asMETHOD(Scene, GetNetworkTime), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool get_asyncLoading() const", asMETHOD(Scene, IsAsyncLoading), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_asyncProgress() const", asMETHOD(Scene, GetAsyncProgress), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_asyncSaving() const", asMETHOD(Scene, IsAsyncSaving), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "LoadMode get_asyncLoadMode() const", asMETHOD(Scene, GetAsyncLoadMode), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_asyncLoadingMs(int)", asMETHOD(Scene, SetAsyncLoadingMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "int get_asyncLoadingMs() const", asMETHOD(Scene, GetAsyncLoadingMs), asCALL_THISCALL);
@@ -328,8 +443,10 @@ void RegisterSceneAPI(asIScriptEngine* engine)
     RegisterObjectAnimation(engine);
     RegisterAnimatable(engine);
     RegisterNode(engine);
+    RegisterPrefab(engine);
     RegisterSmoothedTransform(engine);
     RegisterSplinePath(engine);
+    RegisterSceneStreamer(engine);
     RegisterScene(engine);
 }
 
@@ -22,6 +22,7 @@
 
 #include "../Script/Addons.h"
 #include "../Engine/EngineEvents.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../Core/Profiler.h"
 #include "../Scene/Scene.h"
@@ -175,6 +176,25 @@ void Script::SetExecuteConsoleCommands(bool enable)
         UnsubscribeFromEvent(E_CONSOLECOMMAND);
 }
 
+void Script::SetJITCompiler(asIJITCompiler* compiler)
+{
+    // Functions without JIT entry instructions, for example from bytecode saved without them, keep being interpreted
+    if (compiler)
+        SetJITInstructions(true);
+    scriptEngine_->SetJITCompiler(compiler);
+}
+
+void Script::SetJITInstructions(bool enable)
+{
+    scriptEngine_->SetEngineProperty(asEP_INCLUDE_JIT_INSTRUCTIONS, enable);
+}
+
+void Script::SetByteCodeCacheDir(const String& path)
+{
+    String trimmedPath = path.Trimmed();
+    byteCodeCacheDir_ = trimmedPath.Empty() ? String::EMPTY : AddTrailingSlash(trimmedPath);
+}
+
 void Script::MessageCallback(const asSMessageInfo* msg)
 {
     String message;
@@ -232,6 +252,16 @@ ScriptFile* Script::GetDefaultScriptFile() const
     return defaultScriptFile_;
 }
 
+asIJITCompiler* Script::GetJITCompiler() const
+{
+    return scriptEngine_->GetJITCompiler();
+}
+
+bool Script::GetJITInstructions() const
+{
+    return scriptEngine_->GetEngineProperty(asEP_INCLUDE_JIT_INSTRUCTIONS) != 0;
+}
+
 Scene* Script::GetDefaultScene() const
 {
     return defaultScene_;
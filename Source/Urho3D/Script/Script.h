@@ -25,6 +25,7 @@
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
+class asIJITCompiler;
 class asIObjectType;
 class asIScriptContext;
 class asIScriptEngine;
@@ -38,6 +39,7 @@ namespace Urho3D
 extern const char* LOGIC_CATEGORY;
 
 class Scene;
+class ScriptCall;
 class ScriptFile;
 class ScriptInstance;
 
@@ -54,6 +56,7 @@ class URHO3D_API Script : public Object
 {
     OBJECT(Script);
 
+    friend class ScriptCall;
     friend class ScriptFile;
 
 public:
@@ -70,6 +73,12 @@ public:
     void SetDefaultScene(Scene* scene);
     /// Set whether to execute engine console commands as script code.
     void SetExecuteConsoleCommands(bool enable);
+    /// Set a JIT compiler for script functions, or null to interpret them. Should be set before loading script files, as it also enables the JIT entry instructions, which only functions compiled afterward contain. The compiler is not owned.
+    void SetJITCompiler(asIJITCompiler* compiler);
+    /// Set whether to include JIT entry instructions in compiled functions even without a JIT compiler, so that saved bytecode can be JIT compiled where it is loaded.
+    void SetJITInstructions(bool enable);
+    /// Set directory for caching the bytecode of compiled script files, or empty to disable. A cached bytecode is used instead of compiling when the source of the file and its includes is unchanged.
+    void SetByteCodeCacheDir(const String& path);
     /// Print the whole script API (all registered classes, methods and properties) to the log. No-ops when URHO3D_LOGGING not defined.
     void DumpAPI(DumpMode mode= DOXYGEN, const String& sourceTree = String::EMPTY);
     /// Log a message from the script engine.
@@ -89,6 +98,12 @@ public:
     Scene* GetDefaultScene() const;
     /// Return whether is executing engine console commands as script code.
     bool GetExecuteConsoleCommands() const { return executeConsoleCommands_; }
+    /// Return the JIT compiler, or null if interpreting.
+    asIJITCompiler* GetJITCompiler() const;
+    /// Return whether JIT entry instructions are included in compiled functions.
+    bool GetJITInstructions() const;
+    /// Return the bytecode cache directory.
+    const String& GetByteCodeCacheDir() const { return byteCodeCacheDir_; }
     /// Clear the inbuild object type cache.
     void ClearObjectTypeCache();
     /// Query for an inbuilt object type by constant declaration. Can not be used for script types.
@@ -126,6 +141,8 @@ private:
     Mutex moduleMutex_;
     /// Current script execution nesting level.
     unsigned scriptNestingLevel_;
+    /// Bytecode cache directory.
+    String byteCodeCacheDir_;
     /// Flag for executing engine console commands as script code. Default to true.
     bool executeConsoleCommands_;
 };
@@ -273,6 +273,8 @@ static void RegisterScript(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Script", "Scene@+ get_defaultScene() const", asMETHOD(Script, GetDefaultScene), asCALL_THISCALL);
     engine->RegisterObjectMethod("Script", "void set_executeConsoleCommands(bool)", asMETHOD(Script, SetExecuteConsoleCommands), asCALL_THISCALL);
     engine->RegisterObjectMethod("Script", "bool get_executeConsoleCommands() const", asMETHOD(Script, GetExecuteConsoleCommands), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Script", "void set_byteCodeCacheDir(const String&in)", asMETHOD(Script, SetByteCodeCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Script", "const String& get_byteCodeCacheDir() const", asMETHOD(Script, GetByteCodeCacheDir), asCALL_THISCALL);
     engine->RegisterGlobalFunction("Script@+ get_script()", asFUNCTION(GetScript), asCALL_CDECL);
 }
 
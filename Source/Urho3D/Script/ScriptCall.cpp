@@ -0,0 +1,245 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../Core/MemoryTracker.h"
+#include "../Script/Script.h"
+#include "../Script/ScriptCall.h"
+#include "../Script/ScriptFile.h"
+
+#include <AngelScript/angelscript.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+ScriptCall::ScriptCall() :
+    script_(0),
+    function_(0),
+    object_(0),
+    context_(0)
+{
+}
+
+ScriptCall::ScriptCall(ScriptFile* file, const String& declaration) :
+    file_(file),
+    script_(file ? file->GetSubsystem<Script>() : 0),
+    function_(0),
+    object_(0),
+    context_(0),
+    declaration_(declaration)
+{
+    Resolve();
+}
+
+ScriptCall::ScriptCall(ScriptFile* file, asIScriptObject* object, const String& declaration) :
+    file_(file),
+    script_(file ? file->GetSubsystem<Script>() : 0),
+    function_(0),
+    object_(0),
+    context_(0),
+    declaration_(declaration)
+{
+    SetObjectInternal(object);
+    Resolve();
+}
+
+ScriptCall::ScriptCall(ScriptFile* file, asIScriptFunction* function, asIScriptObject* object) :
+    file_(file),
+    script_(file ? file->GetSubsystem<Script>() : 0),
+    function_(0),
+    object_(0),
+    context_(0)
+{
+    SetFunction(function);
+    SetObjectInternal(object);
+}
+
+ScriptCall::ScriptCall(const ScriptCall& rhs) :
+    file_(rhs.file_),
+    script_(rhs.script_),
+    function_(0),
+    object_(0),
+    context_(0),
+    declaration_(rhs.declaration_)
+{
+    SetFunction(rhs.function_);
+    SetObjectInternal(rhs.object_);
+}
+
+ScriptCall::~ScriptCall()
+{
+    SetFunction(0);
+    SetObjectInternal(0);
+}
+
+ScriptCall& ScriptCall::operator = (const ScriptCall& rhs)
+{
+    file_ = rhs.file_;
+    script_ = rhs.script_;
+    SetFunction(rhs.function_);
+    SetObjectInternal(rhs.object_);
+    context_ = 0;
+    declaration_ = rhs.declaration_;
+    return *this;
+}
+
+bool ScriptCall::Begin()
+{
+    context_ = 0;
+    if (!Resolve())
+        return false;
+    
+    asIScriptContext* context = script_->GetScriptFileContext();
+    if (context->Prepare(function_) < 0)
+        return false;
+    if (object_)
+        context->SetObject(object_);
+    
+    context_ = context;
+    return true;
+}
+
+void ScriptCall::SetBool(unsigned index, bool value)
+{
+    if (context_)
+        context_->SetArgByte(index, (unsigned char)value);
+}
+
+void ScriptCall::SetInt(unsigned index, int value)
+{
+    if (!context_)
+        return;
+    
+    int paramTypeId;
+    function_->GetParam(index, &paramTypeId);
+    
+    switch (paramTypeId)
+    {
+    case asTYPEID_BOOL:
+    case asTYPEID_INT8:
+    case asTYPEID_UINT8:
+        context_->SetArgByte(index, (unsigned char)value);
+        break;
+        
+    case asTYPEID_INT16:
+    case asTYPEID_UINT16:
+        context_->SetArgWord(index, (unsigned short)value);
+        break;
+        
+    case asTYPEID_INT64:
+    case asTYPEID_UINT64:
+        context_->SetArgQWord(index, (asQWORD)value);
+        break;
+        
+    default:
+        context_->SetArgDWord(index, (unsigned)value);
+        break;
+    }
+}
+
+void ScriptCall::SetFloat(unsigned index, float value)
+{
+    if (context_)
+        context_->SetArgFloat(index, value);
+}
+
+void ScriptCall::SetDouble(unsigned index, double value)
+{
+    if (context_)
+        context_->SetArgDouble(index, value);
+}
+
+void ScriptCall::SetObject(unsigned index, void* object)
+{
+    if (context_)
+        context_->SetArgObject(index, object);
+}
+
+bool ScriptCall::Execute()
+{
+    MEMORY_TAG(MEMTAG_SCRIPT);
+    
+    if (!context_)
+        return false;
+    
+    // The call may be destroyed during execution, for example along with the object owning it. Therefore do not rely on
+    // member variables afterward
+    asIScriptContext* context = context_;
+    Script* scriptSystem = script_;
+    bool isMethod = object_ != 0;
+    context_ = 0;
+    
+    scriptSystem->IncScriptNestingLevel();
+    bool success = context->Execute() >= 0;
+    // A method call is unprepared so that the context does not keep the script object alive
+    if (isMethod)
+        context->Unprepare();
+    scriptSystem->DecScriptNestingLevel();
+    
+    return success;
+}
+
+bool ScriptCall::IsValid() const
+{
+    // When the script file is reloaded, the functions of the old module are orphaned and no longer belong to it
+    return function_ && file_ && file_->IsCompiled() && function_->GetModule() == file_->GetScriptModule();
+}
+
+void ScriptCall::SetFunction(asIScriptFunction* function)
+{
+    if (function == function_)
+        return;
+    
+    // Hold a reference so that the function can not be deleted and its address be reused by another function
+    if (function)
+        function->AddRef();
+    if (function_)
+        function_->Release();
+    function_ = function;
+}
+
+void ScriptCall::SetObjectInternal(asIScriptObject* object)
+{
+    if (object == object_)
+        return;
+    
+    if (object)
+        object->AddRef();
+    if (object_)
+        object_->Release();
+    object_ = object;
+}
+
+bool ScriptCall::Resolve()
+{
+    if (IsValid())
+        return true;
+    if (declaration_.Empty() || !file_)
+        return false;
+    
+    SetFunction(object_ ? file_->GetMethod(object_, declaration_) : file_->GetFunction(declaration_));
+    return IsValid();
+}
+
+}
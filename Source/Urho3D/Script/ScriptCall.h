@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Container/Str.h"
+
+class asIScriptContext;
+class asIScriptFunction;
+class asIScriptModule;
+class asIScriptObject;
+
+namespace Urho3D
+{
+
+class Script;
+class ScriptFile;
+
+/// Prepared call of a script function or object method. The function is resolved once, and resolved again by declaration only if the script file is reloaded. Arguments are set directly to the script context without Variant conversion, and a function call leaves the context prepared, so that calling the same function again skips most of the setup.
+class URHO3D_API ScriptCall
+{
+public:
+    /// Construct empty.
+    ScriptCall();
+    /// Construct for a function by declaration.
+    ScriptCall(ScriptFile* file, const String& declaration);
+    /// Construct for an object method by declaration.
+    ScriptCall(ScriptFile* file, asIScriptObject* object, const String& declaration);
+    /// Construct for an already resolved function, or an object method if object is non-null. Can not be resolved again after reloading.
+    ScriptCall(ScriptFile* file, asIScriptFunction* function, asIScriptObject* object = 0);
+    /// Copy-construct.
+    ScriptCall(const ScriptCall& rhs);
+    /// Destruct.
+    ~ScriptCall();
+    
+    /// Assign from another call.
+    ScriptCall& operator = (const ScriptCall& rhs);
+    
+    /// Prepare a script context for the call. Set the arguments after this and then call Execute(). Return true if successful.
+    bool Begin();
+    /// Set a bool argument.
+    void SetBool(unsigned index, bool value);
+    /// Set an integer argument of any size.
+    void SetInt(unsigned index, int value);
+    /// Set a float argument.
+    void SetFloat(unsigned index, float value);
+    /// Set a double argument.
+    void SetDouble(unsigned index, double value);
+    /// Set an object argument, passed by reference or handle.
+    void SetObject(unsigned index, void* object);
+    /// Execute the prepared call. Return true if successful.
+    bool Execute();
+    
+    /// Return the function, or null if not resolved.
+    asIScriptFunction* GetFunction() const { return function_; }
+    /// Return the script object for a method call.
+    asIScriptObject* GetObject() const { return object_; }
+    /// Return the declaration.
+    const String& GetDeclaration() const { return declaration_; }
+    /// Return whether the function is resolved and the script file has not been reloaded since.
+    bool IsValid() const;
+    
+private:
+    /// Set the function, adjusting reference counts.
+    void SetFunction(asIScriptFunction* function);
+    /// Set the object, adjusting reference counts.
+    void SetObjectInternal(asIScriptObject* object);
+    /// Resolve the function again if the script file has been reloaded. Return true if the function is valid.
+    bool Resolve();
+    
+    /// Script file.
+    WeakPtr<ScriptFile> file_;
+    /// Script subsystem.
+    Script* script_;
+    /// Function or method.
+    asIScriptFunction* function_;
+    /// Script object for a method call.
+    asIScriptObject* object_;
+    /// Context prepared by Begin(), or null when not prepared.
+    asIScriptContext* context_;
+    /// Declaration for resolving the function again, or empty if created from a function.
+    String declaration_;
+};
+
+}
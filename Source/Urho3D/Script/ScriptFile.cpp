@@ -22,12 +22,14 @@
 
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
+#include "../Core/MemoryTracker.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Core/Profiler.h"
 #include "../Resource/ResourceCache.h"
 #include "../Script/Script.h"
+#include "../Script/ScriptCall.h"
 #include "../Script/ScriptFile.h"
 #include "../Script/ScriptInstance.h"
 
@@ -97,7 +99,8 @@ ScriptFile::ScriptFile(Context* context) :
     script_(GetSubsystem<Script>()),
     scriptModule_(0),
     compiled_(false),
-    subscribed_(false)
+    subscribed_(false),
+    sourceHash_(0)
 {
 }
 
@@ -113,8 +116,11 @@ void ScriptFile::RegisterObject(Context* context)
 
 bool ScriptFile::BeginLoad(Deserializer& source)
 {
+    MEMORY_TAG(MEMTAG_SCRIPT);
+
     ReleaseModule();
     loadByteCode_.Reset();
+    sourceHash_ = 0;
     
     asIScriptEngine* engine = script_->GetScriptEngine();
     
@@ -164,6 +170,11 @@ bool ScriptFile::EndLoad()
             success = true;
         }
     }
+    else if (LoadCachedByteCode())
+    {
+        LOGINFO("Loaded script module " + GetName() + " from cached bytecode");
+        success = true;
+    }
     else
     {
         int result = scriptModule_->Build();
@@ -171,6 +182,7 @@ bool ScriptFile::EndLoad()
         {
             LOGINFO("Compiled script module " + GetName());
             success = true;
+            SaveCachedByteCode();
         }
         else
             LOGERROR("Failed to compile script module " + GetName());
@@ -285,6 +297,7 @@ bool ScriptFile::Execute(const String& declaration, const VariantVector& paramet
 bool ScriptFile::Execute(asIScriptFunction* function, const VariantVector& parameters, bool unprepare)
 {
     PROFILE(ExecuteFunction);
+    MEMORY_TAG(MEMTAG_SCRIPT);
     
     if (!compiled_ || !function)
         return false;
@@ -326,6 +339,7 @@ bool ScriptFile::Execute(asIScriptObject* object, const String& declaration, con
 bool ScriptFile::Execute(asIScriptObject* object, asIScriptFunction* method, const VariantVector& parameters, bool unprepare)
 {
     PROFILE(ExecuteMethod);
+    MEMORY_TAG(MEMTAG_SCRIPT);
     
     if (!compiled_ || !object || !method)
         return false;
@@ -685,10 +699,77 @@ bool ScriptFile::AddScriptSection(asIScriptEngine* engine, Deserializer& source)
         return false;
     }
     
+    // Hash the section including its name, so that editing or reordering any include invalidates cached bytecode
+    for (const char* name = source.GetName().CString(); *name; ++name)
+        sourceHash_ = SDBMHash(sourceHash_, (unsigned char)*name);
+    for (unsigned i = 0; i < dataSize; ++i)
+        sourceHash_ = SDBMHash(sourceHash_, (unsigned char)buffer[i]);
+    
     SetMemoryUse(GetMemoryUse() + dataSize);
     return true;
 }
 
+static String GetCachedByteCodeName(const String& cacheDir, const String& name)
+{
+    return cacheDir + StringHash(name).ToString() + ".asc";
+}
+
+bool ScriptFile::LoadCachedByteCode()
+{
+    const String& cacheDir = script_->GetByteCodeCacheDir();
+    if (cacheDir.Empty())
+        return false;
+    
+    String fileName = GetCachedByteCodeName(cacheDir, GetName());
+    if (!GetSubsystem<FileSystem>()->FileExists(fileName))
+        return false;
+    
+    SharedPtr<File> file(new File(context_, fileName));
+    if (!file->IsOpen() || file->ReadFileID() != "UASC")
+        return false;
+    
+    // Bytecode of changed source, of another AngelScript version or with different JIT instruction setting is ignored and
+    // replaced once the module is compiled
+    if (file->ReadUInt() != sourceHash_ || file->ReadUInt() != ANGELSCRIPT_VERSION || file->ReadBool() !=
+        script_->GetJITInstructions())
+        return false;
+    
+    unsigned dataSize = file->GetSize() - file->GetPosition();
+    SharedArrayPtr<unsigned char> data(new unsigned char[dataSize]);
+    if (!dataSize || file->Read(data.Get(), dataSize) != dataSize)
+        return false;
+    
+    PROFILE(LoadCachedByteCode);
+    
+    // The pending script sections remain in the module, so a failed load (e.g. after script API changes) can still be compiled
+    MemoryBuffer buffer(data.Get(), dataSize);
+    ByteCodeDeserializer deserializer = ByteCodeDeserializer(buffer);
+    return scriptModule_->LoadByteCode(&deserializer) >= 0;
+}
+
+void ScriptFile::SaveCachedByteCode()
+{
+    const String& cacheDir = script_->GetByteCodeCacheDir();
+    if (cacheDir.Empty())
+        return;
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem->DirExists(cacheDir))
+        fileSystem->CreateDir(cacheDir);
+    
+    SharedPtr<File> file(new File(context_, GetCachedByteCodeName(cacheDir, GetName()), FILE_WRITE));
+    if (!file->IsOpen())
+        return;
+    
+    file->WriteFileID("UASC");
+    file->WriteUInt(sourceHash_);
+    file->WriteUInt(ANGELSCRIPT_VERSION);
+    file->WriteBool(script_->GetJITInstructions());
+    // Keep debug info so that script exceptions still report line numbers
+    ByteCodeSerializer serializer = ByteCodeSerializer(*file);
+    scriptModule_->SaveByteCode(&serializer, false);
+}
+
 void ScriptFile::SetParameters(asIScriptContext* context, asIScriptFunction* function, const VariantVector& parameters)
 {
     unsigned paramCount = function->GetParamCount();
@@ -876,17 +957,15 @@ void ScriptEventInvoker::HandleScriptEvent(StringHash eventType, VariantMap& eve
         return;
     }
 
-    VariantVector parameters;
+    ScriptCall call(file_, method, object_);
+    if (!call.Begin())
+        return;
     if (method->GetParamCount() > 0)
     {
-        parameters.Push(Variant((void*)&eventType));
-        parameters.Push(Variant((void*)&eventData));
+        call.SetObject(0, &eventType);
+        call.SetObject(1, &eventData);
     }
-
-    if (object_)
-        file_->Execute(object_, method, parameters);
-    else
-        file_->Execute(method, parameters);
+    call.Execute();
 }
 
 ScriptFile* GetScriptContextFile()
@@ -108,6 +108,10 @@ private:
     void AddEventHandlerInternal(Object* sender, StringHash eventType, const String& handlerName);
     /// Add a script section, checking for includes recursively. Return true if successful.
     bool AddScriptSection(asIScriptEngine* engine, Deserializer& source);
+    /// Load the module from the bytecode cache if the cached bytecode is up to date. Return true if successful.
+    bool LoadCachedByteCode();
+    /// Write the compiled module to the bytecode cache.
+    void SaveCachedByteCode();
     /// Set parameters for a function or method.
     void SetParameters(asIScriptContext* context, asIScriptFunction* function, const VariantVector& parameters);
     /// Release the script module.
@@ -139,6 +143,8 @@ private:
     SharedArrayPtr<unsigned char> loadByteCode_;
     /// Byte code size for asynchronous loading.
     unsigned loadByteCodeSize_;
+    /// Hash of the script source and its includes for validating cached bytecode.
+    unsigned sourceHash_;
 };
 
 /// Helper class for forwarding events to script objects that are not part of a scene.
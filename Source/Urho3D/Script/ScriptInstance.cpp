@@ -33,6 +33,7 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Script/Script.h"
+#include "../Script/ScriptCall.h"
 #include "../Script/ScriptFile.h"
 #include "../Script/ScriptInstance.h"
 
@@ -489,7 +490,11 @@ void ScriptInstance::OnMarkedDirty(Node* node)
     }
 
     if (scriptObject_ && methods_[METHOD_TRANSFORMCHANGED])
-        scriptFile_->Execute(scriptObject_, methods_[METHOD_TRANSFORMCHANGED]);
+    {
+        ScriptCall call(scriptFile_, methods_[METHOD_TRANSFORMCHANGED], scriptObject_);
+        if (call.Begin())
+            call.Execute();
+    }
 }
 
 void ScriptInstance::CreateObject()
@@ -757,11 +762,7 @@ void ScriptInstance::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
     }
 
     if (methods_[METHOD_UPDATE])
-    {
-        VariantVector parameters;
-        parameters.Push(timeStep);
-        scriptFile_->Execute(scriptObject_, methods_[METHOD_UPDATE], parameters);
-    }
+        ExecuteUpdateMethod(METHOD_UPDATE, timeStep);
 }
 
 void ScriptInstance::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
@@ -771,9 +772,7 @@ void ScriptInstance::HandleScenePostUpdate(StringHash eventType, VariantMap& eve
 
     using namespace ScenePostUpdate;
 
-    VariantVector parameters;
-    parameters.Push(eventData[P_TIMESTEP]);
-    scriptFile_->Execute(scriptObject_, methods_[METHOD_POSTUPDATE], parameters);
+    ExecuteUpdateMethod(METHOD_POSTUPDATE, eventData[P_TIMESTEP].GetFloat());
 }
 
 #ifdef URHO3D_PHYSICS
@@ -784,9 +783,7 @@ void ScriptInstance::HandlePhysicsPreStep(StringHash eventType, VariantMap& even
 
     using namespace PhysicsPreStep;
 
-    VariantVector parameters;
-    parameters.Push(eventData[P_TIMESTEP]);
-    scriptFile_->Execute(scriptObject_, methods_[METHOD_FIXEDUPDATE], parameters);
+    ExecuteUpdateMethod(METHOD_FIXEDUPDATE, eventData[P_TIMESTEP].GetFloat());
 }
 
 void ScriptInstance::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
@@ -796,9 +793,7 @@ void ScriptInstance::HandlePhysicsPostStep(StringHash eventType, VariantMap& eve
 
     using namespace PhysicsPostStep;
 
-    VariantVector parameters;
-    parameters.Push(eventData[P_TIMESTEP]);
-    scriptFile_->Execute(scriptObject_, methods_[METHOD_FIXEDPOSTUPDATE], parameters);
+    ExecuteUpdateMethod(METHOD_FIXEDPOSTUPDATE, eventData[P_TIMESTEP].GetFloat());
 }
 #endif
 void ScriptInstance::HandleScriptEvent(StringHash eventType, VariantMap& eventData)
@@ -808,14 +803,25 @@ void ScriptInstance::HandleScriptEvent(StringHash eventType, VariantMap& eventDa
 
     asIScriptFunction* method = static_cast<asIScriptFunction*>(GetEventHandler()->GetUserData());
 
-    VariantVector parameters;
+    ScriptCall call(scriptFile_, method, scriptObject_);
+    if (!call.Begin())
+        return;
     if (method->GetParamCount() > 0)
     {
-        parameters.Push(Variant((void*)&eventType));
-        parameters.Push(Variant((void*)&eventData));
+        call.SetObject(0, &eventType);
+        call.SetObject(1, &eventData);
     }
+    call.Execute();
+}
 
-    scriptFile_->Execute(scriptObject_, method, parameters);
+void ScriptInstance::ExecuteUpdateMethod(ScriptInstanceMethod method, float timeStep)
+{
+    ScriptCall call(scriptFile_, methods_[method], scriptObject_);
+    if (call.Begin())
+    {
+        call.SetFloat(0, timeStep);
+        call.Execute();
+    }
 }
 
 void ScriptInstance::HandleScriptFileReload(StringHash eventType, VariantMap& eventData)
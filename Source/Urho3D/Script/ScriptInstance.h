@@ -158,6 +158,8 @@ private:
     void ClearScriptAttributes();
     /// Subscribe/unsubscribe from scene updates as necessary.
     void UpdateEventSubscription();
+    /// Execute an update method with the timestep as its parameter.
+    void ExecuteUpdateMethod(ScriptInstanceMethod method, float timeStep);
     /// Handle scene update event.
     void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle scene post-update event.
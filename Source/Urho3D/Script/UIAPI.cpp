@@ -70,6 +70,10 @@ static void RegisterFont(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Font", "const IntVector2& get_absoluteGlyphOffset() const", asMETHOD(Font, GetAbsoluteGlyphOffset), asCALL_THISCALL);
     engine->RegisterObjectMethod("Font", "void set_scaledGlyphOffset(const Vector2&)", asMETHOD(Font, SetScaledGlyphOffset), asCALL_THISCALL);
     engine->RegisterObjectMethod("Font", "const Vector2& get_scaledGlyphOffset() const", asMETHOD(Font, GetScaledGlyphOffset), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Font", "void SetSDFGeneration(int, int spread = 4)", asMETHOD(Font, SetSDFGeneration), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Font", "bool get_sdfFont() const", asMETHOD(Font, IsSDFFont), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Font", "int get_sdfPointSize() const", asMETHOD(Font, GetSDFPointSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Font", "int get_sdfSpread() const", asMETHOD(Font, GetSDFSpread), asCALL_THISCALL);
 }
 
 static void RegisterUIElement(asIScriptEngine* engine)
@@ -352,6 +356,20 @@ static void RegisterListView(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ListView", "bool get_clearSelectionOnDefocus() const", asMETHOD(ListView, GetClearSelectionOnDefocus), asCALL_THISCALL);
     engine->RegisterObjectMethod("ListView", "void set_selectOnClickEnd(bool)", asMETHOD(ListView, SetSelectOnClickEnd), asCALL_THISCALL);
     engine->RegisterObjectMethod("ListView", "bool get_selectOnClickEnd() const", asMETHOD(ListView, GetSelectOnClickEnd), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void SetNumVirtualItems(uint)", asMETHOD(ListView, SetNumVirtualItems), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void RefreshVirtualItems()", asMETHOD(ListView, RefreshVirtualItems), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void set_virtualMode(bool)", asMETHOD(ListView, SetVirtualMode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "bool get_virtualMode() const", asMETHOD(ListView, GetVirtualMode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void set_numVirtualItems(uint)", asMETHOD(ListView, SetNumVirtualItems), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "uint get_numVirtualItems() const", asMETHOD(ListView, GetNumItems), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void set_virtualItemHeight(int)", asMETHOD(ListView, SetVirtualItemHeight), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "int get_virtualItemHeight() const", asMETHOD(ListView, GetVirtualItemHeight), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void set_virtualItemMargin(uint)", asMETHOD(ListView, SetVirtualItemMargin), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "uint get_virtualItemMargin() const", asMETHOD(ListView, GetVirtualItemMargin), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void set_virtualItemType(StringHash)", asMETHOD(ListView, SetVirtualItemType), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "StringHash get_virtualItemType() const", asMETHOD(ListView, GetVirtualItemType), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "void set_virtualItemStyle(const String&in)", asMETHOD(ListView, SetVirtualItemStyle), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ListView", "const String& get_virtualItemStyle() const", asMETHOD(ListView, GetVirtualItemStyle), asCALL_THISCALL);
 }
 
 static void RegisterText(asIScriptEngine* engine)
@@ -731,8 +749,15 @@ static void RegisterUI(asIScriptEngine* engine)
     engine->RegisterObjectMethod("UI", "bool get_useScreenKeyboard() const", asMETHOD(UI, GetUseScreenKeyboard), asCALL_THISCALL);
     engine->RegisterObjectMethod("UI", "void set_useMutableGlyphs(bool)", asMETHOD(UI, SetUseMutableGlyphs), asCALL_THISCALL);
     engine->RegisterObjectMethod("UI", "bool get_useMutableGlyphs() const", asMETHOD(UI, GetUseMutableGlyphs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "void set_fontAtlasMaxPages(uint)", asMETHOD(UI, SetFontAtlasMaxPages), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "uint get_fontAtlasMaxPages() const", asMETHOD(UI, GetFontAtlasMaxPages), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "void set_textLayoutCacheSize(uint)", asMETHOD(UI, SetTextLayoutCacheSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "uint get_textLayoutCacheSize() const", asMETHOD(UI, GetTextLayoutCacheSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("UI", "void set_forceAutoHint(bool)", asMETHOD(UI, SetForceAutoHint), asCALL_THISCALL);
     engine->RegisterObjectMethod("UI", "bool get_forceAutoHint() const", asMETHOD(UI, GetForceAutoHint), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "void set_batchCaching(bool)", asMETHOD(UI, SetBatchCaching), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "bool get_batchCaching() const", asMETHOD(UI, GetBatchCaching), asCALL_THISCALL);
+    engine->RegisterObjectMethod("UI", "void ResetBatchCache()", asMETHOD(UI, ResetBatchCache), asCALL_THISCALL);
     engine->RegisterGlobalFunction("UI@+ get_ui()", asFUNCTION(GetUI), asCALL_CDECL);
 }
 
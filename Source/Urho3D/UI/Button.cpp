@@ -144,11 +144,13 @@ void Button::OnKey(int key, int buttons, int qualifiers)
 void Button::SetPressedOffset(const IntVector2& offset)
 {
     pressedOffset_ = offset;
+    MarkBatchesDirty();
 }
 
 void Button::SetPressedOffset(int x, int y)
 {
     pressedOffset_ = IntVector2(x, y);
+    MarkBatchesDirty();
 }
 
 void Button::SetPressedChildOffset(const IntVector2& offset)
@@ -180,6 +182,7 @@ void Button::SetRepeatRate(float rate)
 void Button::SetPressed(bool enable)
 {
     pressed_ = enable;
+    MarkBatchesDirty();
     SetChildOffset(pressed_ ? pressedChildOffset_ : IntVector2::ZERO);
 }
 
@@ -90,6 +90,9 @@ void DropDownList::GetBatches(PODVector<UIBatch>& batches, PODVector<float>& ver
     if (!placeholder_->IsVisible())
         return;
 
+    // The selected item is rendered from outside this element's hierarchy, so can not cache
+    MarkBatchesDirty();
+
     UIElement* selectedItem = GetSelectedItem();
     if (selectedItem)
     {
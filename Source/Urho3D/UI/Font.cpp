@@ -23,6 +23,7 @@
 #include "../Core/Context.h"
 #include "../IO/Deserializer.h"
 #include "../IO/FileSystem.h"
+#include "../IO/Log.h"
 #include "../UI/Font.h"
 #include "../UI/FontFaceBitmap.h"
 #include "../UI/FontFaceFreeType.h"
@@ -46,7 +47,9 @@ Font::Font(Context* context) :
     absoluteOffset_(IntVector2::ZERO),
     scaledOffset_(Vector2::ZERO),
     fontType_(FONT_NONE),
-    sdfFont_(false)
+    sdfFont_(false),
+    sdfPointSize_(0),
+    sdfSpread_(DEFAULT_SDF_SPREAD)
 {
 }
 
@@ -86,6 +89,10 @@ bool Font::BeginLoad(Deserializer& source)
     }
 
     String ext = GetExtension(GetName());
+    sdfFont_ = ext == ".sdf";
+    sdfPointSize_ = 0;
+    sdfSpread_ = DEFAULT_SDF_SPREAD;
+
     if (ext == ".ttf" || ext == ".otf" || ext == ".woff")
     {
         fontType_ = FONT_FREETYPE;
@@ -94,8 +101,6 @@ bool Font::BeginLoad(Deserializer& source)
     else if (ext == ".xml" || ext == ".fnt" || ext == ".sdf")
         fontType_ = FONT_BITMAP;
 
-    sdfFont_ = ext == ".sdf";
-
     SetMemoryUse(fontDataSize_);
     return true;
 }
@@ -125,6 +130,20 @@ void Font::SetScaledGlyphOffset(const Vector2& offset)
     scaledOffset_ = offset;
 }
 
+void Font::SetSDFGeneration(int pointSize, int spread)
+{
+    if (fontType_ != FONT_FREETYPE)
+    {
+        LOGERROR("Signed distance field generation requires a FreeType font");
+        return;
+    }
+
+    sdfPointSize_ = pointSize > 0 ? Clamp(pointSize, MIN_POINT_SIZE, MAX_POINT_SIZE) : 0;
+    sdfSpread_ = Max(spread, 1);
+    sdfFont_ = sdfPointSize_ > 0;
+    ReleaseFaces();
+}
+
 FontFace* Font::GetFace(int pointSize)
 {
     // In headless mode, always return null
@@ -135,6 +154,9 @@ FontFace* Font::GetFace(int pointSize)
     // For bitmap font type, always return the same font face provided by the font's bitmap file regardless of the actual requested point size
     if (fontType_ == FONT_BITMAP)
         pointSize = 0;
+    // Likewise a generated signed distance field face is scalable, so it serves all point sizes
+    else if (sdfPointSize_)
+        pointSize = sdfPointSize_;
     else
         pointSize = Clamp(pointSize, MIN_POINT_SIZE, MAX_POINT_SIZE);
 
@@ -205,6 +227,15 @@ void Font::LoadParameters()
         scaledOffset_.x_ = scaledElem.GetFloat("x");
         scaledOffset_.y_ = scaledElem.GetFloat("y");
     }
+
+    XMLElement sdfElem = rootElem.GetChild("sdf");
+    if (sdfElem)
+    {
+        int pointSize = sdfElem.HasAttribute("pointsize") ? sdfElem.GetInt("pointsize") : DEFAULT_SDF_POINT_SIZE;
+        sdfPointSize_ = Clamp(pointSize, MIN_POINT_SIZE, MAX_POINT_SIZE);
+        sdfSpread_ = sdfElem.HasAttribute("spread") ? Max(sdfElem.GetInt("spread"), 1) : DEFAULT_SDF_SPREAD;
+        sdfFont_ = true;
+    }
 }
 
 FontFace* Font::GetFaceFreeType(int pointSize)
@@ -32,6 +32,8 @@ class FontFace;
 
 static const int FONT_TEXTURE_MIN_SIZE = 128;
 static const int FONT_DPI = 96;
+static const int DEFAULT_SDF_POINT_SIZE = 32;
+static const int DEFAULT_SDF_SPREAD = 4;
 
 /// %Font file type.
 enum FONT_TYPE
@@ -63,11 +65,17 @@ public:
     void SetAbsoluteGlyphOffset(const IntVector2& offset);
     /// Set point size scaled position adjustment for glyphs.
     void SetScaledGlyphOffset(const Vector2& offset);
+    /// Set to generate signed distance field glyphs from a FreeType font. One face at the given point size then serves all requested sizes. Spread is the distance range in pixels outside and inside the glyph edges. Zero point size disables.
+    void SetSDFGeneration(int pointSize, int spread = DEFAULT_SDF_SPREAD);
 
     /// Return font face. Pack and render to a texture if not rendered yet. Return null on error.
     FontFace* GetFace(int pointSize);
     /// Is signed distance field font.
     bool IsSDFFont() const { return sdfFont_; }
+    /// Return point size of the generated signed distance field face, or zero if not generated from a FreeType font.
+    int GetSDFPointSize() const { return sdfPointSize_; }
+    /// Return distance range in pixels of the generated signed distance field.
+    int GetSDFSpread() const { return sdfSpread_; }
     /// Return absolute position adjustment for glyphs.
     const IntVector2& GetAbsoluteGlyphOffset() const { return absoluteOffset_; }
     /// Return point size scaled position adjustment for glyphs.
@@ -100,6 +108,10 @@ private:
     FONT_TYPE fontType_;
     /// Signed distance field font flag.
     bool sdfFont_;
+    /// Point size of the generated signed distance field face.
+    int sdfPointSize_;
+    /// Distance range in pixels of the generated signed distance field.
+    int sdfSpread_;
 };
 
 }
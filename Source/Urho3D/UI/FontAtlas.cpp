@@ -0,0 +1,224 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Container/ArrayPtr.h"
+#include "../Core/Context.h"
+#include "../UI/Font.h"
+#include "../UI/FontAtlas.h"
+#include "../UI/FontFace.h"
+#include "../Graphics/Graphics.h"
+#include "../IO/Log.h"
+#include "../Graphics/Texture2D.h"
+#include "../UI/UIEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned DEFAULT_FONT_ATLAS_MAX_PAGES = 4;
+
+FontAtlas::FontAtlas(Context* context) :
+    Object(context),
+    pageSize_(FONT_TEXTURE_MIN_SIZE),
+    maxPages_(DEFAULT_FONT_ATLAS_MAX_PAGES),
+    frameNumber_(2),
+    nextGeneration_(1),
+    numEvictions_(0)
+{
+}
+
+FontAtlas::~FontAtlas()
+{
+}
+
+void FontAtlas::SetPageSize(int size)
+{
+    size = Max(size, FONT_TEXTURE_MIN_SIZE);
+    if (size != pageSize_)
+    {
+        pageSize_ = size;
+        Reset();
+    }
+}
+
+void FontAtlas::SetMaxPages(unsigned num)
+{
+    if (!num)
+        num = 1;
+    maxPages_ = num;
+    if (textures_.Size() > maxPages_)
+        Reset();
+}
+
+void FontAtlas::Update()
+{
+    ++frameNumber_;
+
+    for (unsigned i = 0; i < textures_.Size(); ++i)
+    {
+        if (textures_[i]->IsDataLost())
+        {
+            ClearPage(i);
+            textures_[i]->ClearDataLost();
+            SendEvent(E_FONTATLASEVICTED);
+        }
+    }
+}
+
+bool FontAtlas::AddGlyph(FontGlyph& glyph, const unsigned char* data)
+{
+    if (glyph.width_ >= pageSize_ || glyph.height_ >= pageSize_)
+    {
+        LOGERROR("Glyph does not fit on a font atlas page");
+        return false;
+    }
+
+    int x, y;
+    unsigned page = M_MAX_UNSIGNED;
+    bool evicted = false;
+
+    // Try the pages from newest to oldest, as the older ones are more likely to be full
+    for (unsigned i = textures_.Size() - 1; i < textures_.Size(); --i)
+    {
+        if (allocators_[i].Allocate(glyph.width_ + 1, glyph.height_ + 1, x, y))
+        {
+            page = i;
+            break;
+        }
+    }
+
+    if (page == M_MAX_UNSIGNED)
+    {
+        // Recycle the least recently used page when at the limit. Pages used on this or the previous frame may be
+        // referenced by batches that have not been rendered yet, so grow past the limit instead if all are in use
+        if (textures_.Size() >= maxPages_)
+        {
+            unsigned oldestFrame = frameNumber_ - 1;
+            for (unsigned i = 0; i < textures_.Size(); ++i)
+            {
+                if (lastUsedFrames_[i] < oldestFrame)
+                {
+                    oldestFrame = lastUsedFrames_[i];
+                    page = i;
+                }
+            }
+        }
+
+        if (page != M_MAX_UNSIGNED)
+        {
+            ClearPage(page);
+            ++numEvictions_;
+            evicted = true;
+        }
+        else
+        {
+            if (!CreatePage())
+                return false;
+            page = textures_.Size() - 1;
+        }
+
+        if (!allocators_[page].Allocate(glyph.width_ + 1, glyph.height_ + 1, x, y))
+        {
+            if (evicted)
+                SendEvent(E_FONTATLASEVICTED);
+            return false;
+        }
+    }
+
+    glyph.x_ = (short)x;
+    glyph.y_ = (short)y;
+    glyph.page_ = page;
+    glyph.generation_ = generations_[page];
+    lastUsedFrames_[page] = frameNumber_;
+
+    textures_[page]->SetData(0, x, y, glyph.width_, glyph.height_, data);
+
+    // Notify only after the glyph is in place, as the receivers may acquire glyphs again
+    if (evicted)
+        SendEvent(E_FONTATLASEVICTED);
+    return true;
+}
+
+bool FontAtlas::TouchGlyph(const FontGlyph& glyph)
+{
+    // Glyphs with no pixels are never stored in the atlas
+    if (!glyph.width_ || !glyph.height_)
+        return true;
+
+    if (glyph.page_ >= textures_.Size() || glyph.generation_ != generations_[glyph.page_])
+        return false;
+
+    lastUsedFrames_[glyph.page_] = frameNumber_;
+    return true;
+}
+
+void FontAtlas::Reset()
+{
+    bool hadPages = !textures_.Empty();
+
+    textures_.Clear();
+    allocators_.Clear();
+    generations_.Clear();
+    lastUsedFrames_.Clear();
+
+    if (hadPages)
+        SendEvent(E_FONTATLASEVICTED);
+}
+
+bool FontAtlas::CreatePage()
+{
+    SharedPtr<Texture2D> texture(new Texture2D(context_));
+    texture->SetMipsToSkip(QUALITY_LOW, 0); // No quality reduction
+    texture->SetNumLevels(1); // No mipmaps
+    texture->SetAddressMode(COORD_U, ADDRESS_BORDER);
+    texture->SetAddressMode(COORD_V, ADDRESS_BORDER);
+    texture->SetBorderColor(Color(0.0f, 0.0f, 0.0f, 0.0f));
+    if (!texture->SetSize(pageSize_, pageSize_, Graphics::GetAlphaFormat()))
+    {
+        LOGERROR("Could not create font atlas page");
+        return false;
+    }
+
+    textures_.Push(texture);
+    allocators_.Push(AreaAllocator());
+    generations_.Push(0);
+    lastUsedFrames_.Push(frameNumber_);
+    ClearPage(textures_.Size() - 1);
+
+    LOGDEBUGF("Created font atlas page %d (%dx%d)", textures_.Size(), pageSize_, pageSize_);
+    return true;
+}
+
+void FontAtlas::ClearPage(unsigned index)
+{
+    // Clear the whole texture so that the filtering of newly allocated glyphs can not pick up remains of the old ones
+    SharedArrayPtr<unsigned char> emptyData(new unsigned char[pageSize_ * pageSize_]);
+    memset(emptyData.Get(), 0, pageSize_ * pageSize_);
+    textures_[index]->SetData(0, 0, 0, pageSize_, pageSize_, emptyData.Get());
+
+    allocators_[index].Reset(pageSize_, pageSize_);
+    generations_[index] = nextGeneration_++;
+}
+
+}
@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/Object.h"
+#include "../Math/AreaAllocator.h"
+
+namespace Urho3D
+{
+
+class Texture2D;
+struct FontGlyph;
+
+/// Glyph texture atlas shared by the dynamically rasterized faces of all fonts and sizes. Glyph space is allocated with an %AreaAllocator per page, and when all pages are full, the least recently used page is cleared and reused.
+class URHO3D_API FontAtlas : public Object
+{
+    OBJECT(FontAtlas);
+
+public:
+    /// Construct.
+    FontAtlas(Context* context);
+    /// Destruct.
+    virtual ~FontAtlas();
+
+    /// Set page texture size. Discards all pages if changed.
+    void SetPageSize(int size);
+    /// Set maximum number of pages before the least recently used page is recycled. Discards all pages if less than the current number of pages.
+    void SetMaxPages(unsigned num);
+    /// Advance the frame counter used for least recently used recycling, and recycle pages that have lost their texture data. Called by the UI before collecting rendering batches.
+    void Update();
+    /// Allocate space for a glyph and upload its 8-bit bitmap, which is the glyph's width * height. Fill in the glyph's position, page and generation. Return true if successful.
+    bool AddGlyph(FontGlyph& glyph, const unsigned char* data);
+    /// Return whether the glyph is still resident on its page, and mark the page used if it is.
+    bool TouchGlyph(const FontGlyph& glyph);
+    /// Discard all pages.
+    void Reset();
+
+    /// Return page textures.
+    const Vector<SharedPtr<Texture2D> >& GetTextures() const { return textures_; }
+    /// Return page texture size.
+    int GetPageSize() const { return pageSize_; }
+    /// Return maximum number of pages.
+    unsigned GetMaxPages() const { return maxPages_; }
+    /// Return number of pages.
+    unsigned GetNumPages() const { return textures_.Size(); }
+    /// Return number of times a page has been recycled.
+    unsigned GetNumEvictions() const { return numEvictions_; }
+
+private:
+    /// Create a new page. Return true if successful.
+    bool CreatePage();
+    /// Clear a page and invalidate the glyphs on it.
+    void ClearPage(unsigned index);
+
+    /// Page textures.
+    Vector<SharedPtr<Texture2D> > textures_;
+    /// Page area allocators.
+    Vector<AreaAllocator> allocators_;
+    /// Page generations. The glyphs rasterized on a page are valid as long as its generation has not changed.
+    PODVector<unsigned> generations_;
+    /// Frame numbers on which the pages were last used.
+    PODVector<unsigned> lastUsedFrames_;
+    /// Page texture size.
+    int pageSize_;
+    /// Maximum number of pages.
+    unsigned maxPages_;
+    /// Frame counter.
+    unsigned frameNumber_;
+    /// Next page generation.
+    unsigned nextGeneration_;
+    /// Number of page recycles.
+    unsigned numEvictions_;
+};
+
+}
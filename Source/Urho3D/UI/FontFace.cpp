@@ -34,6 +34,7 @@ namespace Urho3D
 
 FontGlyph::FontGlyph() :
     page_(M_MAX_UNSIGNED),
+    generation_(0),
     used_(false)
 {
 }
@@ -55,6 +55,8 @@ struct FontGlyph
     short advanceX_;
     /// Texture page. M_MAX_UNSIGNED if not yet resident on any texture.
     unsigned page_;
+    /// Generation of the shared font atlas page the glyph was rasterized on.
+    unsigned generation_;
     /// Used flag.
     bool used_;
 };
@@ -85,7 +87,7 @@ public:
     /// Return row height.
     int GetRowHeight() const { return rowHeight_; }
     /// Return textures.
-    const Vector<SharedPtr<Texture2D> >& GetTextures() const { return textures_; }
+    virtual const Vector<SharedPtr<Texture2D> >& GetTextures() const { return textures_; }
 
 protected:
     friend class FontFaceBitmap;
@@ -21,8 +21,10 @@
 //
 
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/FileSystem.h"
 #include "../UI/Font.h"
+#include "../UI/FontAtlas.h"
 #include "../UI/FontFaceFreeType.h"
 #include "../Graphics/Graphics.h"
 #include "../Resource/Image.h"
@@ -68,10 +70,169 @@ private:
     FT_Library library_;
 };
 
+/// Rasterization scale of signed distance field glyphs relative to the face point size.
+static const int SDF_RENDER_SCALE = 4;
+/// Number of signed distance field glyphs generated at a time when loading a face.
+static const unsigned SDF_BATCH_SIZE = 256;
+/// Squared distance of grid cells with no feature.
+static const float SDF_INFINITY = 1e20f;
+
+/// Divide rounding towards negative infinity.
+static int FloorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((divisor - 1 - value) / divisor);
+}
+
+/// Compute the squared Euclidean distance transform of a sampled function after Felzenszwalb & Huttenlocher. v and z are work arrays of size n and n + 1.
+static void DistanceTransform1D(const float* f, float* d, int* v, float* z, int n)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -SDF_INFINITY;
+    z[1] = SDF_INFINITY;
+
+    for (int q = 1; q < n; ++q)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k])
+        {
+            --k;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_INFINITY;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < q)
+            ++k;
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+/// Compute the squared Euclidean distance transform of a grid in place, separably by columns and rows.
+static void DistanceTransform2D(float* grid, int width, int height)
+{
+    int size = Max(width, height);
+    PODVector<float> f(size);
+    PODVector<float> d(size);
+    PODVector<float> z(size + 1);
+    PODVector<int> v(size);
+
+    for (int x = 0; x < width; ++x)
+    {
+        for (int y = 0; y < height; ++y)
+            f[y] = grid[y * width + x];
+        DistanceTransform1D(&f[0], &d[0], &v[0], &z[0], height);
+        for (int y = 0; y < height; ++y)
+            grid[y * width + x] = d[y];
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        float* row = grid + y * width;
+        DistanceTransform1D(row, &d[0], &v[0], &z[0], width);
+        memcpy(row, &d[0], width * sizeof(float));
+    }
+}
+
+/// Generate a signed distance field of width * height pixels from a coverage bitmap that is scale times larger. Edges map to 0.5 and the field covers spread pixels to either side.
+static void GenerateSDF(const unsigned char* source, int width, int height, int scale, int spread, unsigned char* dest,
+    unsigned pitch)
+{
+    int sourceWidth = width * scale;
+    int sourceHeight = height * scale;
+    unsigned sourceSize = sourceWidth * sourceHeight;
+
+    PODVector<float> outside(sourceSize);
+    PODVector<float> inside(sourceSize);
+    for (unsigned i = 0; i < sourceSize; ++i)
+    {
+        bool covered = source[i] >= 128;
+        outside[i] = covered ? 0.0f : SDF_INFINITY;
+        inside[i] = covered ? SDF_INFINITY : 0.0f;
+    }
+
+    DistanceTransform2D(&outside[0], sourceWidth, sourceHeight);
+    DistanceTransform2D(&inside[0], sourceWidth, sourceHeight);
+
+    // Sample the distances at the centers of the destination pixels by averaging the four source pixels around them.
+    // Distances are measured between pixel centers, so shift by half a pixel to place the edge between the covered and
+    // uncovered pixels
+    float range = 2.0f * spread * scale;
+    int half = scale / 2;
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char* destRow = dest + y * pitch;
+        for (int x = 0; x < width; ++x)
+        {
+            float distance = 0.0f;
+            for (int sy = y * scale + half - 1; sy <= y * scale + half; ++sy)
+            {
+                for (int sx = x * scale + half - 1; sx <= x * scale + half; ++sx)
+                {
+                    unsigned i = sy * sourceWidth + sx;
+                    distance += outside[i] > 0.0f ? sqrtf(outside[i]) - 0.5f : 0.5f - sqrtf(inside[i]);
+                }
+            }
+            float value = Clamp(0.5f - 0.25f * distance / range, 0.0f, 1.0f);
+            destRow[x] = (unsigned char)(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+/// Glyph whose signed distance field is generated from a high resolution coverage bitmap.
+struct SDFGlyph
+{
+    /// Character code.
+    unsigned charCode_;
+    /// Glyph description.
+    FontGlyph glyph_;
+    /// Coverage bitmap at the rasterization scale.
+    PODVector<unsigned char> source_;
+    /// Generated distance field.
+    PODVector<unsigned char> field_;
+};
+
+/// Generates the signed distance fields of a range of glyphs. Used with WorkQueue::ParallelFor().
+struct SDFGenerator
+{
+    /// Construct.
+    SDFGenerator(int scale, int spread) :
+        scale_(scale),
+        spread_(spread)
+    {
+    }
+
+    /// Generate the fields of a range of glyphs.
+    void operator () (SDFGlyph** start, SDFGlyph** end, unsigned threadIndex)
+    {
+        for (SDFGlyph** i = start; i != end; ++i)
+        {
+            SDFGlyph& sdfGlyph = **i;
+            sdfGlyph.field_.Resize(sdfGlyph.glyph_.width_ * sdfGlyph.glyph_.height_);
+            GenerateSDF(&sdfGlyph.source_[0], sdfGlyph.glyph_.width_, sdfGlyph.glyph_.height_, scale_, spread_,
+                &sdfGlyph.field_[0], sdfGlyph.glyph_.width_);
+        }
+    }
+
+    /// Rasterization scale.
+    int scale_;
+    /// Distance range in pixels.
+    int spread_;
+};
+
 FontFaceFreeType::FontFaceFreeType(Font* font) :
 FontFace(font),
     face_(0), 
-    loadMode_(FT_LOAD_DEFAULT)
+    loadMode_(FT_LOAD_DEFAULT),
+    hasMutableGlyph_(false),
+    renderScale_(1),
+    sdfSpread_(0)
 {
 }
 
@@ -121,7 +282,14 @@ bool FontFaceFreeType::Load(const unsigned char* fontData, unsigned fontDataSize
         LOGERROR("Could not create font face");
         return false;
     }
-    error = FT_Set_Char_Size(face, 0, pointSize * 64, FONT_DPI, FONT_DPI);
+    // Signed distance fields are generated from glyphs rendered at a higher resolution
+    if (font_->GetSDFPointSize())
+    {
+        renderScale_ = SDF_RENDER_SCALE;
+        sdfSpread_ = font_->GetSDFSpread();
+    }
+
+    error = FT_Set_Char_Size(face, 0, pointSize * renderScale_ * 64, FONT_DPI, FONT_DPI);
     if (error)
     {
         FT_Done_Face(face);
@@ -165,37 +333,54 @@ bool FontFaceFreeType::Load(const unsigned char* fontData, unsigned fontDataSize
 
     // Store point size and row height. Use the maximum of ascender + descender, or the face's stored default row height
     pointSize_ = pointSize;
-    rowHeight_ = Max(ascender_ + descender, face->size->metrics.height >> 6);
+    rowHeight_ = Max(ascender_ + descender, face->size->metrics.height >> 6) / renderScale_;
+    ascender_ /= renderScale_;
+
+    // With mutable glyphs, rasterize the glyphs on demand into the atlas shared by all faces. Otherwise prerender as many
+    // glyphs as possible into the face's own texture
+    bool loadAllGlyphs = false;
+    if (ui->GetUseMutableGlyphs())
+        atlas_ = ui->GetFontAtlas();
+    else
+    {
+        int textureWidth = maxTextureSize;
+        int textureHeight = maxTextureSize;
+        loadAllGlyphs = CanLoadAllGlyphs(charCodes, textureWidth, textureHeight);
 
-    int textureWidth = maxTextureSize;
-    int textureHeight = maxTextureSize;
-    bool loadAllGlyphs = CanLoadAllGlyphs(charCodes, textureWidth, textureHeight);
+        SharedPtr<Image> image(new Image(font_->GetContext()));
+        image->SetSize(textureWidth, textureHeight, 1);
+        unsigned char* imageData = image->GetData();
+        memset(imageData, 0, image->GetWidth() * image->GetHeight());
+        allocator_.Reset(FONT_TEXTURE_MIN_SIZE, FONT_TEXTURE_MIN_SIZE, textureWidth, textureHeight);
 
-    SharedPtr<Image> image(new Image(font_->GetContext()));
-    image->SetSize(textureWidth, textureHeight, 1);
-    unsigned char* imageData = image->GetData();
-    memset(imageData, 0, image->GetWidth() * image->GetHeight());
-    allocator_.Reset(FONT_TEXTURE_MIN_SIZE, FONT_TEXTURE_MIN_SIZE, textureWidth, textureHeight);
+        if (sdfSpread_)
+        {
+            if (!LoadSDFGlyphs(charCodes, loadAllGlyphs, image))
+                return false;
+        }
+        else
+        {
+            for (unsigned i = 0; i < numGlyphs; ++i)
+            {
+                unsigned charCode = charCodes[i];
+                if (charCode == 0)
+                    continue;
 
-    for (unsigned i = 0; i < numGlyphs; ++i)
-    {
-        unsigned charCode = charCodes[i];
-        if (charCode == 0)
-            continue;
-        
-        if (!loadAllGlyphs && (charCode > 0xff))
-            break;
+                if (!loadAllGlyphs && (charCode > 0xff))
+                    break;
 
-        if (!LoadCharGlyph(charCode, image))
-            return false;
-    }
+                if (!LoadCharGlyph(charCode, image))
+                    return false;
+            }
+        }
 
-    SharedPtr<Texture2D> texture = LoadFaceTexture(image);
-    if (!texture)
-        return false;
+        SharedPtr<Texture2D> texture = LoadFaceTexture(image);
+        if (!texture)
+            return false;
 
-    textures_.Push(texture);
-    font_->SetMemoryUse(font_->GetMemoryUse() + textureWidth * textureHeight);
+        textures_.Push(texture);
+        font_->SetMemoryUse(font_->GetMemoryUse() + textureWidth * textureHeight);
+    }
 
     // Store kerning if face has kerning information
     if (FT_HAS_KERNING(face))
@@ -283,6 +468,10 @@ const FontGlyph* FontFaceFreeType::GetGlyph(unsigned c)
     HashMap<unsigned, FontGlyph>::Iterator i = glyphMapping_.Find(c);
     if (i != glyphMapping_.End())
     {
+        // If the atlas page the glyph was on has been recycled, rasterize it again. The glyph structure stays in place
+        if (atlas_ && !atlas_->TouchGlyph(i->second_) && !LoadCharGlyph(c))
+            return 0;
+
         FontGlyph& glyph = i->second_;
         glyph.used_ = true;
         return &glyph;
@@ -302,6 +491,11 @@ const FontGlyph* FontFaceFreeType::GetGlyph(unsigned c)
     return 0;
 }
 
+const Vector<SharedPtr<Texture2D> >& FontFaceFreeType::GetTextures() const
+{
+    return atlas_ ? atlas_->GetTextures() : textures_;
+}
+
 bool FontFaceFreeType::CanLoadAllGlyphs(const PODVector<unsigned>& charCodes, int& textureWidth, int& textureHeight) const
 {
     FT_Face face = (FT_Face)face_;
@@ -318,10 +512,10 @@ bool FontFaceFreeType::CanLoadAllGlyphs(const PODVector<unsigned>& charCodes, in
         FT_Error error = FT_Load_Char(face, charCode, loadMode_);
         if (!error)
         {
-            int width = Max(slot->metrics.width >> 6, slot->bitmap.width);
-            int height = Max(slot->metrics.height >> 6, slot->bitmap.rows);
+            FontGlyph glyph;
+            GetGlyphMetrics(glyph);
             int x, y;
-            if (!allocator.Allocate(width + 1, height + 1, x, y))
+            if (!allocator.Allocate(glyph.width_ + 1, glyph.height_ + 1, x, y))
                 return false;
         }
     }
@@ -363,67 +557,89 @@ bool FontFaceFreeType::LoadCharGlyph(unsigned charCode, Image* image)
     if (!error)
     {
         // Note: position within texture will be filled later
-        fontGlyph.width_ = (short)Max(slot->metrics.width >> 6, slot->bitmap.width);
-        fontGlyph.height_ = (short)Max(slot->metrics.height >> 6, slot->bitmap.rows);
-        fontGlyph.offsetX_ = (short)(slot->metrics.horiBearingX >> 6);
-        fontGlyph.offsetY_ = (short)(ascender_ - (slot->metrics.horiBearingY >> 6));
-        fontGlyph.advanceX_ = (short)(slot->metrics.horiAdvance >> 6);
+        GetGlyphMetrics(fontGlyph);
 
         if (fontGlyph.width_ > 0 && fontGlyph.height_ > 0)
         {
-            int x, y;
-            if (!allocator_.Allocate(fontGlyph.width_ + 1, fontGlyph.height_ + 1, x, y))
-            {
-                if (!SetupNextTexture(allocator_.GetWidth(), allocator_.GetHeight()))
-                    return false;
-
-                if (!allocator_.Allocate(fontGlyph.width_ + 1, fontGlyph.height_ + 1, x, y))
-                    return false;
-            }
-
-            fontGlyph.x_ = x;
-            fontGlyph.y_ = y;
-
             unsigned char* dest = 0;
             unsigned pitch = 0;
-            if (image)
+            if (atlas_)
             {
-                fontGlyph.page_ = 0;
-                dest = image->GetData() + fontGlyph.y_ * image->GetWidth() + fontGlyph.x_;
-                pitch = image->GetWidth();
-            }
-            else
-            {
-                fontGlyph.page_ = textures_.Size() - 1;
+                // Note: position within the atlas will be filled after rendering
                 dest = new unsigned char[fontGlyph.width_ * fontGlyph.height_];
+                memset(dest, 0, fontGlyph.width_ * fontGlyph.height_);
                 pitch = fontGlyph.width_;
             }
-
-            FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
-            if (slot->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
+            else
             {
-                for (int y = 0; y < slot->bitmap.rows; ++y)
+                int x, y;
+                if (!allocator_.Allocate(fontGlyph.width_ + 1, fontGlyph.height_ + 1, x, y))
                 {
-                    unsigned char* src = slot->bitmap.buffer + slot->bitmap.pitch * y;
-                    unsigned char* rowDest = dest + y * pitch;
+                    if (!SetupNextTexture(allocator_.GetWidth(), allocator_.GetHeight()))
+                        return false;
 
-                    for (int x = 0; x < slot->bitmap.width; ++x)
-                        rowDest[x] = (src[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+                    if (!allocator_.Allocate(fontGlyph.width_ + 1, fontGlyph.height_ + 1, x, y))
+                        return false;
                 }
+
+                fontGlyph.x_ = x;
+                fontGlyph.y_ = y;
+
+                if (image)
+                {
+                    fontGlyph.page_ = 0;
+                    dest = image->GetData() + fontGlyph.y_ * image->GetWidth() + fontGlyph.x_;
+                    pitch = image->GetWidth();
+                }
+                else
+                {
+                    fontGlyph.page_ = textures_.Size() - 1;
+                    dest = new unsigned char[fontGlyph.width_ * fontGlyph.height_];
+                    pitch = fontGlyph.width_;
+                }
+            }
+
+            if (sdfSpread_)
+            {
+                PODVector<unsigned char> source;
+                RenderSDFSource(fontGlyph, source);
+                GenerateSDF(&source[0], fontGlyph.width_, fontGlyph.height_, renderScale_, sdfSpread_, dest, pitch);
             }
             else
             {
-                for (int y = 0; y < slot->bitmap.rows; ++y)
+                FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+                if (slot->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
                 {
-                    unsigned char* src = slot->bitmap.buffer + slot->bitmap.pitch * y;
-                    unsigned char* rowDest = dest + y * pitch;
+                    for (int y = 0; y < slot->bitmap.rows; ++y)
+                    {
+                        unsigned char* src = slot->bitmap.buffer + slot->bitmap.pitch * y;
+                        unsigned char* rowDest = dest + y * pitch;
 
-                    for (int x = 0; x < slot->bitmap.width; ++x)
-                        rowDest[x] = src[x];
+                        for (int x = 0; x < slot->bitmap.width; ++x)
+                            rowDest[x] = (src[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+                    }
+                }
+                else
+                {
+                    for (int y = 0; y < slot->bitmap.rows; ++y)
+                    {
+                        unsigned char* src = slot->bitmap.buffer + slot->bitmap.pitch * y;
+                        unsigned char* rowDest = dest + y * pitch;
+
+                        for (int x = 0; x < slot->bitmap.width; ++x)
+                            rowDest[x] = src[x];
+                    }
                 }
             }
 
-            if (!image)
+            if (atlas_)
+            {
+                bool success = atlas_->AddGlyph(fontGlyph, dest);
+                delete [] dest;
+                if (!success)
+                    return false;
+            }
+            else if (!image)
             {
                 textures_.Back()->SetData(0, fontGlyph.x_, fontGlyph.y_, fontGlyph.width_, fontGlyph.height_, dest);
                 delete [] dest;
@@ -451,4 +667,162 @@ bool FontFaceFreeType::LoadCharGlyph(unsigned charCode, Image* image)
     return true;
 }
 
+
+bool FontFaceFreeType::LoadSDFGlyphs(const PODVector<unsigned>& charCodes, bool loadAllGlyphs, Image* image)
+{
+    FT_Face face = (FT_Face)face_;
+    WorkQueue* queue = font_->GetSubsystem<WorkQueue>();
+
+    PODVector<unsigned> loadCharCodes;
+    for (unsigned i = 0; i < charCodes.Size(); ++i)
+    {
+        unsigned charCode = charCodes[i];
+        if (charCode == 0)
+            continue;
+
+        if (!loadAllGlyphs && (charCode > 0xff))
+            break;
+
+        loadCharCodes.Push(charCode);
+    }
+
+    // Render on the main thread, as a FreeType face may not be used from several threads, then generate the distance
+    // fields in parallel. Work in batches to bound the memory used by the high resolution bitmaps
+    Vector<SDFGlyph> sdfGlyphs;
+    PODVector<SDFGlyph*> generateGlyphs;
+    SDFGenerator generator(renderScale_, sdfSpread_);
+
+    for (unsigned start = 0; start < loadCharCodes.Size(); start += SDF_BATCH_SIZE)
+    {
+        unsigned end = Min((int)(start + SDF_BATCH_SIZE), (int)loadCharCodes.Size());
+        sdfGlyphs.Clear();
+        sdfGlyphs.Resize(end - start);
+        generateGlyphs.Clear();
+
+        for (unsigned i = start; i < end; ++i)
+        {
+            SDFGlyph& sdfGlyph = sdfGlyphs[i - start];
+            FontGlyph& glyph = sdfGlyph.glyph_;
+            sdfGlyph.charCode_ = loadCharCodes[i];
+            glyph.x_ = 0;
+            glyph.y_ = 0;
+            glyph.page_ = 0;
+
+            if (FT_Load_Char(face, sdfGlyph.charCode_, loadMode_))
+            {
+                glyph.width_ = 0;
+                glyph.height_ = 0;
+                glyph.offsetX_ = 0;
+                glyph.offsetY_ = 0;
+                glyph.advanceX_ = 0;
+                continue;
+            }
+
+            GetGlyphMetrics(glyph);
+            if (glyph.width_ > 0 && glyph.height_ > 0)
+            {
+                int x, y;
+                if (!allocator_.Allocate(glyph.width_ + 1, glyph.height_ + 1, x, y))
+                    return false;
+
+                glyph.x_ = x;
+                glyph.y_ = y;
+                RenderSDFSource(glyph, sdfGlyph.source_);
+                generateGlyphs.Push(&sdfGlyph);
+            }
+        }
+
+        if (queue)
+            queue->ParallelFor(generateGlyphs, 0, generator);
+        else if (generateGlyphs.Size())
+            generator(&generateGlyphs[0], &generateGlyphs[0] + generateGlyphs.Size(), 0);
+
+        for (unsigned i = 0; i < sdfGlyphs.Size(); ++i)
+        {
+            const SDFGlyph& sdfGlyph = sdfGlyphs[i];
+            const FontGlyph& glyph = sdfGlyph.glyph_;
+            if (!sdfGlyph.field_.Empty())
+            {
+                for (int y = 0; y < glyph.height_; ++y)
+                {
+                    memcpy(image->GetData() + (glyph.y_ + y) * image->GetWidth() + glyph.x_,
+                        &sdfGlyph.field_[y * glyph.width_], glyph.width_);
+                }
+            }
+            glyphMapping_[sdfGlyph.charCode_] = glyph;
+        }
+    }
+
+    return true;
+}
+
+void FontFaceFreeType::GetGlyphMetrics(FontGlyph& glyph) const
+{
+    FT_GlyphSlot slot = ((FT_Face)face_)->glyph;
+    int width = Max(slot->metrics.width >> 6, slot->bitmap.width);
+    int height = Max(slot->metrics.height >> 6, slot->bitmap.rows);
+    int left = slot->metrics.horiBearingX >> 6;
+    int top = ascender_ * renderScale_ - (slot->metrics.horiBearingY >> 6);
+
+    glyph.advanceX_ = (short)(((slot->metrics.horiAdvance >> 6) + renderScale_ / 2) / renderScale_);
+
+    if (!sdfSpread_)
+    {
+        glyph.width_ = (short)width;
+        glyph.height_ = (short)height;
+        glyph.offsetX_ = (short)left;
+        glyph.offsetY_ = (short)top;
+    }
+    else if (width > 0 && height > 0)
+    {
+        // Round outwards to whole pixels at the face size, and pad by the spread so that the field can fall off
+        int offsetX = FloorDiv(left, renderScale_) - sdfSpread_;
+        int offsetY = FloorDiv(top, renderScale_) - sdfSpread_;
+        glyph.width_ = (short)(FloorDiv(left + width + renderScale_ - 1, renderScale_) + sdfSpread_ - offsetX);
+        glyph.height_ = (short)(FloorDiv(top + height + renderScale_ - 1, renderScale_) + sdfSpread_ - offsetY);
+        glyph.offsetX_ = (short)offsetX;
+        glyph.offsetY_ = (short)offsetY;
+    }
+    else
+    {
+        glyph.width_ = 0;
+        glyph.height_ = 0;
+        glyph.offsetX_ = 0;
+        glyph.offsetY_ = 0;
+    }
+}
+
+void FontFaceFreeType::RenderSDFSource(const FontGlyph& glyph, PODVector<unsigned char>& source)
+{
+    FT_GlyphSlot slot = ((FT_Face)face_)->glyph;
+    FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+
+    int sourceWidth = glyph.width_ * renderScale_;
+    int sourceHeight = glyph.height_ * renderScale_;
+    source.Resize(sourceWidth * sourceHeight);
+    memset(&source[0], 0, source.Size());
+
+    // Position of the bitmap within the padded source
+    int left = slot->bitmap_left - glyph.offsetX_ * renderScale_;
+    int top = ascender_ * renderScale_ - slot->bitmap_top - glyph.offsetY_ * renderScale_;
+    bool mono = slot->bitmap.pixel_mode == FT_PIXEL_MODE_MONO;
+
+    for (int y = 0; y < slot->bitmap.rows; ++y)
+    {
+        int destY = top + y;
+        if (destY < 0 || destY >= sourceHeight)
+            continue;
+
+        unsigned char* src = slot->bitmap.buffer + slot->bitmap.pitch * y;
+        unsigned char* rowDest = &source[destY * sourceWidth];
+
+        for (int x = 0; x < slot->bitmap.width; ++x)
+        {
+            int destX = left + x;
+            if (destX >= 0 && destX < sourceWidth)
+                rowDest[destX] = mono ? ((src[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0) : src[x];
+        }
+    }
+}
+
 }
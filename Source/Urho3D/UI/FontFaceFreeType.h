@@ -27,6 +27,7 @@
 namespace Urho3D
 {
 
+class FontAtlas;
 class FreeTypeLibrary;
 class Texture2D;
 
@@ -45,6 +46,8 @@ public:
     virtual const FontGlyph* GetGlyph(unsigned c);
     /// Return if font face uses mutable glyphs.
     virtual bool HasMutableGlyphs() const { return hasMutableGlyph_; }
+    /// Return textures. These are the shared font atlas pages when the face uses it.
+    virtual const Vector<SharedPtr<Texture2D> >& GetTextures() const;
 
 private:
     /// Check can load all glyph in one texture, return true and texture size if can load.
@@ -53,6 +56,12 @@ private:
     bool SetupNextTexture(int textureWidth, int textureHeight);
     /// Load char glyph.
     bool LoadCharGlyph(unsigned charCode, Image* image = 0);
+    /// Load the signed distance field glyphs of the initial character set into an image, generating the fields in parallel.
+    bool LoadSDFGlyphs(const PODVector<unsigned>& charCodes, bool loadAllGlyphs, Image* image);
+    /// Fill the size, offset and advance of the glyph loaded into the FreeType glyph slot.
+    void GetGlyphMetrics(FontGlyph& glyph) const;
+    /// Render the glyph loaded into the FreeType glyph slot into a coverage bitmap at the rasterization scale, for generating its signed distance field.
+    void RenderSDFSource(const FontGlyph& glyph, PODVector<unsigned char>& source);
 
         /// FreeType library.
     SharedPtr<FreeTypeLibrary> freeType_;
@@ -64,8 +73,14 @@ private:
     int ascender_;
     /// Has mutable glyph.
     bool hasMutableGlyph_;
+    /// Rasterization scale relative to the point size. Greater than one when generating signed distance fields.
+    int renderScale_;
+    /// Signed distance field spread in pixels, or zero when rendering glyphs as coverage.
+    int sdfSpread_;
     /// Glyph area allocator.
     AreaAllocator allocator_;
+    /// Shared font atlas. Non-null when glyphs are rasterized on demand into it instead of the face's own textures.
+    SharedPtr<FontAtlas> atlas_;
 };
 
 }
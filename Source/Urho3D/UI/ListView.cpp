@@ -58,6 +58,7 @@ void SetItemExpanded(UIElement* item, bool enable)
 }
 
 static const StringHash hierarchyParentHash("HierarchyParent");
+static const StringHash virtualIndexHash("VirtualIndex");
 
 bool GetItemHierarchyParent(UIElement* item)
 {
@@ -69,6 +70,17 @@ void SetItemHierarchyParent(UIElement* item, bool enable)
     item->SetVar(hierarchyParentHash, enable);
 }
 
+unsigned GetItemVirtualIndex(UIElement* item)
+{
+    const Variant& index = item->GetVar(virtualIndexHash);
+    return index.GetType() == VAR_INT ? index.GetUInt() : M_MAX_UNSIGNED;
+}
+
+void SetItemVirtualIndex(UIElement* item, unsigned index)
+{
+    item->SetVar(virtualIndexHash, index);
+}
+
 /// Hierarchy container (used by ListView internally when in hierarchy mode).
 class HierarchyContainer : public UIElement
 {
@@ -170,7 +182,13 @@ ListView::ListView(Context* context) :
     hierarchyMode_(true),    // Init to true here so that the setter below takes effect
     baseIndent_(0),
     clearSelectionOnDefocus_(false),
-    selectOnClickEnd_(false)
+    selectOnClickEnd_(false),
+    virtualMode_(false),
+    numVirtualItems_(0),
+    virtualItemHeight_(16),
+    virtualItemMargin_(2),
+    virtualItemType_(Text::GetTypeStatic()),
+    virtualItemWidth_(0)
 {
     resizeContentWidth_ = true;
 
@@ -181,6 +199,7 @@ ListView::ListView(Context* context) :
     SubscribeToEvent(E_FOCUSCHANGED, HANDLER(ListView, HandleItemFocusChanged));
     SubscribeToEvent(this, E_DEFOCUSED, HANDLER(ListView, HandleFocusChanged));
     SubscribeToEvent(this, E_FOCUSED, HANDLER(ListView, HandleFocusChanged));
+    SubscribeToEvent(this, E_VIEWCHANGED, HANDLER(ListView, HandleViewChanged));
     
     UpdateUIClickSubscription();
 }
@@ -202,6 +221,19 @@ void ListView::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Base Indent", GetBaseIndent, SetBaseIndent, int, 0, AM_FILE);
     ACCESSOR_ATTRIBUTE("Clear Sel. On Defocus", GetClearSelectionOnDefocus, SetClearSelectionOnDefocus, bool, false, AM_FILE);
     ACCESSOR_ATTRIBUTE("Select On Click End", GetSelectOnClickEnd, SetSelectOnClickEnd, bool, false, AM_FILE);
+    ACCESSOR_ATTRIBUTE("Virtual Mode", GetVirtualMode, SetVirtualMode, bool, false, AM_FILE);
+    ACCESSOR_ATTRIBUTE("Virtual Item Height", GetVirtualItemHeight, SetVirtualItemHeight, int, 16, AM_FILE);
+    ACCESSOR_ATTRIBUTE("Virtual Item Margin", GetVirtualItemMargin, SetVirtualItemMargin, unsigned, 2, AM_FILE);
+    ACCESSOR_ATTRIBUTE("Virtual Item Style", GetVirtualItemStyle, SetVirtualItemStyle, String, String::EMPTY, AM_FILE);
+}
+
+void ListView::Update(float timeStep)
+{
+    ScrollView::Update(timeStep);
+
+    // The content element width changes along with the scroll bar visibility, so check the row width here
+    if (virtualMode_ && contentElement_->GetWidth() != virtualItemWidth_)
+        UpdateVirtualItems();
 }
 
 void ListView::OnKey(int key, int buttons, int qualifiers)
@@ -258,6 +290,13 @@ void ListView::OnKey(int key, int buttons, int qualifiers)
 
         case KEY_PAGEDOWN:
             {
+                // In virtual mode all items have the same height and are visible
+                if (virtualMode_)
+                {
+                    delta = pageDirection * Max((int)(pageStep_ * scrollPanel_->GetHeight()) / Max(virtualItemHeight_, 1), 1);
+                    break;
+                }
+
                 // Convert page step to pixels and see how many items have to be skipped to reach that many pixels
                 if (selection == M_MAX_UNSIGNED)
                     selection = 0;      // Assume as if first item is selected
@@ -318,6 +357,9 @@ void ListView::OnResize()
     // When in hierarchy mode also need to resize the overlay container
     if (hierarchyMode_)
         overlayContainer_->SetSize(scrollPanel_->GetSize());
+    // In virtual mode the number of visible items may have changed
+    else if (virtualMode_)
+        UpdateVirtualItems();
 }
 
 void ListView::AddItem(UIElement* item)
@@ -330,6 +372,12 @@ void ListView::InsertItem(unsigned index, UIElement* item, UIElement* parentItem
     if (!item || item->GetParent() == contentElement_)
         return;
 
+    if (virtualMode_)
+    {
+        LOGERROR("Can not insert items into a virtual mode ListView, set the number of items instead");
+        return;
+    }
+
     // Enable input so that clicking the item can be detected
     item->SetEnabled(true);
     item->SetSelected(false);
@@ -390,6 +438,12 @@ void ListView::RemoveItem(UIElement* item, unsigned index)
     if (!item)
         return;
 
+    if (virtualMode_)
+    {
+        LOGERROR("Can not remove items from a virtual mode ListView, set the number of items instead");
+        return;
+    }
+
     unsigned numItems = GetNumItems();
     for (unsigned i = index; i < numItems; ++i)
     {
@@ -468,6 +522,13 @@ void ListView::RemoveItem(unsigned index)
 
 void ListView::RemoveAllItems()
 {
+    if (virtualMode_)
+    {
+        ClearSelection();
+        SetNumVirtualItems(0);
+        return;
+    }
+
     contentElement_->DisableLayoutUpdate();
 
     ClearSelection();
@@ -652,8 +713,8 @@ void ListView::ChangeSelection(int delta, bool additive)
         if (newSelection >= numItems)
             break;
 
-        UIElement* item = GetItem(newSelection);
-        if (item->IsVisible())
+        // In virtual mode all items are visible
+        if (virtualMode_ || GetItem(newSelection)->IsVisible())
         {
             indices.Push(okSelection = newSelection);
             delta -= direction;
@@ -687,6 +748,12 @@ void ListView::SetHierarchyMode(bool enable)
     if (enable == hierarchyMode_)
         return;
 
+    if (enable && virtualMode_)
+    {
+        LOGERROR("Hierarchy mode is not supported in a virtual mode ListView");
+        return;
+    }
+
     hierarchyMode_ = enable;
     UIElement* container;
     if (enable)
@@ -743,6 +810,106 @@ void ListView::SetSelectOnClickEnd(bool enable)
     }
 }
 
+void ListView::SetVirtualMode(bool enable)
+{
+    if (enable == virtualMode_)
+        return;
+
+    if (enable && hierarchyMode_)
+    {
+        LOGERROR("Virtual mode is not supported in a hierarchy mode ListView");
+        return;
+    }
+
+    RemoveAllItems();
+    virtualMode_ = enable;
+
+    if (enable)
+    {
+        // The row elements are positioned manually, so the content element is sized by the number of items instead of a layout
+        contentElement_->SetLayoutMode(LM_FREE);
+        UpdateVirtualItems();
+    }
+    else
+    {
+        contentElement_->RemoveAllChildren();
+        numVirtualItems_ = 0;
+        contentElement_->SetLayoutMode(LM_VERTICAL);
+    }
+}
+
+void ListView::SetNumVirtualItems(unsigned num)
+{
+    if (num == numVirtualItems_)
+        return;
+
+    numVirtualItems_ = num;
+
+    // Drop the selections that are past the last item
+    bool removed = false;
+    while (!selections_.Empty() && selections_.Back() >= num)
+    {
+        selections_.Pop();
+        removed = true;
+    }
+
+    UpdateVirtualItems();
+    if (removed)
+        SendEvent(E_SELECTIONCHANGED);
+}
+
+void ListView::SetVirtualItemHeight(int height)
+{
+    height = Max(height, 1);
+    if (height != virtualItemHeight_)
+    {
+        virtualItemHeight_ = height;
+        UpdateVirtualItems();
+    }
+}
+
+void ListView::SetVirtualItemMargin(unsigned margin)
+{
+    if (margin != virtualItemMargin_)
+    {
+        virtualItemMargin_ = margin;
+        UpdateVirtualItems();
+    }
+}
+
+void ListView::SetVirtualItemType(StringHash type)
+{
+    if (type != virtualItemType_)
+    {
+        virtualItemType_ = type;
+        // Recreate the row elements
+        if (virtualMode_)
+        {
+            contentElement_->RemoveAllChildren();
+            UpdateVirtualItems();
+        }
+    }
+}
+
+void ListView::SetVirtualItemStyle(const String& style)
+{
+    if (style != virtualItemStyle_)
+    {
+        virtualItemStyle_ = style;
+        // Recreate the row elements
+        if (virtualMode_)
+        {
+            contentElement_->RemoveAllChildren();
+            UpdateVirtualItems();
+        }
+    }
+}
+
+void ListView::RefreshVirtualItems()
+{
+    UpdateVirtualItems(true);
+}
+
 void ListView::Expand(unsigned index, bool enable, bool recursive)
 {
     if (!hierarchyMode_)
@@ -800,18 +967,44 @@ void ListView::ToggleExpand(unsigned index, bool recursive)
 
 unsigned ListView::GetNumItems() const
 {
-    return contentElement_->GetNumChildren();
+    return virtualMode_ ? numVirtualItems_ : contentElement_->GetNumChildren();
 }
 
 UIElement* ListView::GetItem(unsigned index) const
 {
+    if (virtualMode_)
+    {
+        // Only the row elements of the visible items exist
+        if (index >= numVirtualItems_)
+            return 0;
+        const Vector<SharedPtr<UIElement> >& rows = contentElement_->GetChildren();
+        for (unsigned i = 0; i < rows.Size(); ++i)
+        {
+            if (GetItemVirtualIndex(rows[i]) == index)
+                return rows[i];
+        }
+        return 0;
+    }
+
     return contentElement_->GetChild(index);
 }
 
 PODVector<UIElement*> ListView::GetItems() const
 {
     PODVector<UIElement*> items;
-    contentElement_->GetChildren(items);
+
+    if (virtualMode_)
+    {
+        const Vector<SharedPtr<UIElement> >& rows = contentElement_->GetChildren();
+        for (unsigned i = 0; i < rows.Size(); ++i)
+        {
+            if (GetItemVirtualIndex(rows[i]) < numVirtualItems_)
+                items.Push(rows[i]);
+        }
+    }
+    else
+        contentElement_->GetChildren(items);
+
     return items;
 }
 
@@ -824,6 +1017,12 @@ unsigned ListView::FindItem(UIElement* item) const
     if (item->GetParent() != contentElement_)
         return M_MAX_UNSIGNED;
 
+    if (virtualMode_)
+    {
+        unsigned index = GetItemVirtualIndex(item);
+        return index < numVirtualItems_ ? index : M_MAX_UNSIGNED;
+    }
+
     const Vector<SharedPtr<UIElement> >& children = contentElement_->GetChildren();
 
     // Binary search for list item based on screen coordinate Y
@@ -864,7 +1063,7 @@ unsigned ListView::GetSelection() const
 
 UIElement* ListView::GetSelectedItem() const
 {
-    return contentElement_->GetChild(GetSelection());
+    return GetItem(GetSelection());
 }
 
 PODVector<UIElement*> ListView::GetSelectedItems() const
@@ -903,7 +1102,7 @@ bool ListView::IsSelected(unsigned index) const
 
 bool ListView::IsExpanded(unsigned index) const
 {
-    return GetItemExpanded(contentElement_->GetChild(index));
+    return GetItemExpanded(GetItem(index));
 }
 
 bool ListView::FilterImplicitAttributes(XMLElement& dest) const
@@ -928,7 +1127,8 @@ bool ListView::FilterImplicitAttributes(XMLElement& dest) const
         return false;
     if (!RemoveChildXML(containerElem, "Is Enabled", "true"))
         return false;
-    if (!RemoveChildXML(containerElem, "Layout Mode", "Vertical"))
+    // In virtual mode the item container does not use a layout
+    if (!virtualMode_ && !RemoveChildXML(containerElem, "Layout Mode", "Vertical"))
         return false;
     if (!RemoveChildXML(containerElem, "Size"))
         return false;
@@ -951,9 +1151,23 @@ bool ListView::FilterImplicitAttributes(XMLElement& dest) const
 
 void ListView::UpdateSelectionEffect()
 {
-    unsigned numItems = GetNumItems();
     bool highlighted = highlightMode_ == HM_ALWAYS || HasFocus();
 
+    // In virtual mode only update the existing row elements
+    if (virtualMode_)
+    {
+        const Vector<SharedPtr<UIElement> >& rows = contentElement_->GetChildren();
+        for (unsigned i = 0; i < rows.Size(); ++i)
+        {
+            unsigned index = GetItemVirtualIndex(rows[i]);
+            rows[i]->SetSelected(highlightMode_ != HM_NEVER && highlighted && index != M_MAX_UNSIGNED &&
+                selections_.Contains(index));
+        }
+        return;
+    }
+
+    unsigned numItems = GetNumItems();
+
     for (unsigned i = 0; i < numItems; ++i)
     {
         UIElement* item = GetItem(i);
@@ -966,7 +1180,14 @@ void ListView::UpdateSelectionEffect()
 
 void ListView::EnsureItemVisibility(unsigned index)
 {
-    EnsureItemVisibility(GetItem(index));
+    // In virtual mode the item may not have a row element yet, but its position is known
+    if (virtualMode_)
+    {
+        if (index < numVirtualItems_)
+            EnsureRangeVisibility((int)index * virtualItemHeight_, virtualItemHeight_);
+    }
+    else
+        EnsureItemVisibility(GetItem(index));
 }
 
 void ListView::EnsureItemVisibility(UIElement* item)
@@ -974,20 +1195,144 @@ void ListView::EnsureItemVisibility(UIElement* item)
     if (!item || !item->IsVisible())
         return;
 
+    if (virtualMode_)
+        EnsureItemVisibility(FindItem(item));
+    else
+        EnsureRangeVisibility(item->GetPosition().y_, item->GetHeight());
+}
+
+void ListView::EnsureRangeVisibility(int top, int height)
+{
     IntVector2 newView = GetViewPosition();
-    IntVector2 currentOffset = item->GetPosition() - newView;
+    int currentOffset = top - newView.y_;
     const IntRect& clipBorder = scrollPanel_->GetClipBorder();
-    IntVector2 windowSize(scrollPanel_->GetWidth() - clipBorder.left_ - clipBorder.right_, scrollPanel_->GetHeight() -
-        clipBorder.top_ - clipBorder.bottom_);
+    int windowHeight = scrollPanel_->GetHeight() - clipBorder.top_ - clipBorder.bottom_;
 
-    if (currentOffset.y_ < 0)
-        newView.y_ += currentOffset.y_;
-    if (currentOffset.y_ + item->GetHeight() > windowSize.y_)
-        newView.y_ += currentOffset.y_ + item->GetHeight() - windowSize.y_;
+    if (currentOffset < 0)
+        newView.y_ += currentOffset;
+    if (currentOffset + height > windowHeight)
+        newView.y_ += currentOffset + height - windowHeight;
 
     SetViewPosition(newView);
 }
 
+void ListView::UpdateVirtualItems(bool refresh)
+{
+    if (!virtualMode_)
+        return;
+
+    // Size the content element by the number of items, so that the view and the scroll bars cover all of them. This may
+    // change the view position
+    if (contentElement_->GetLayoutMode() != LM_FREE)
+        contentElement_->SetLayoutMode(LM_FREE);
+    int contentHeight = (int)numVirtualItems_ * virtualItemHeight_;
+    if (contentElement_->GetHeight() != contentHeight)
+        contentElement_->SetHeight(contentHeight);
+
+    // Find the range of items to show, including the margin
+    const IntRect& clipBorder = scrollPanel_->GetClipBorder();
+    int windowHeight = Max(scrollPanel_->GetHeight() - clipBorder.top_ - clipBorder.bottom_, 0);
+    unsigned first = (unsigned)(viewPosition_.y_ / virtualItemHeight_);
+    unsigned last = (unsigned)((viewPosition_.y_ + windowHeight + virtualItemHeight_ - 1) / virtualItemHeight_) + virtualItemMargin_;
+    first = first > virtualItemMargin_ ? first - virtualItemMargin_ : 0;
+    if (last > numVirtualItems_)
+        last = numVirtualItems_;
+    if (first > last)
+        first = last;
+    unsigned numRows = last - first;
+
+    // Keep the rows that already show an item in the range, and recycle the rest
+    const Vector<SharedPtr<UIElement> >& children = contentElement_->GetChildren();
+    PODVector<UIElement*> rows(numRows);
+    PODVector<UIElement*> freeRows;
+    for (unsigned i = 0; i < numRows; ++i)
+        rows[i] = 0;
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        UIElement* row = children[i];
+        unsigned index = GetItemVirtualIndex(row);
+        if (!refresh && index >= first && index < last && !rows[index - first])
+            rows[index - first] = row;
+        else
+            freeRows.Push(row);
+    }
+
+    // Create new rows if there are not enough to recycle
+    while (children.Size() < numRows)
+    {
+        UIElement* row = contentElement_->CreateChild(virtualItemType_);
+        if (!row)
+        {
+            LOGERROR("Could not create row element for virtual mode ListView");
+            return;
+        }
+
+        // Do not save the rows, as their contents come from the application. Enable input so that clicking the row can
+        // be detected
+        row->SetTemporary(true);
+        row->SetEnabled(true);
+        if (!virtualItemStyle_.Empty())
+            row->SetStyle(virtualItemStyle_);
+        else
+            row->SetStyleAuto();
+        SetItemVirtualIndex(row, M_MAX_UNSIGNED);
+        freeRows.Push(row);
+    }
+
+    virtualItemWidth_ = contentElement_->GetWidth();
+    bool highlighted = highlightMode_ != HM_NEVER && (highlightMode_ == HM_ALWAYS || HasFocus());
+    Vector<SharedPtr<UIElement> > updatedRows;
+    unsigned nextFree = 0;
+
+    for (unsigned i = 0; i < numRows; ++i)
+    {
+        unsigned index = first + i;
+        UIElement* row = rows[i];
+        if (!row)
+        {
+            row = freeRows[nextFree++];
+            SetItemVirtualIndex(row, index);
+            row->SetSelected(highlighted && selections_.Contains(index));
+            updatedRows.Push(SharedPtr<UIElement>(row));
+        }
+
+        row->SetPosition(0, (int)index * virtualItemHeight_);
+        row->SetSize(virtualItemWidth_, virtualItemHeight_);
+        row->SetVisible(true);
+    }
+
+    // Hide the rows that were not needed
+    while (nextFree < freeRows.Size())
+    {
+        UIElement* row = freeRows[nextFree++];
+        SetItemVirtualIndex(row, M_MAX_UNSIGNED);
+        row->SetSelected(false);
+        row->SetVisible(false);
+    }
+
+    // Finally request the contents of the rows that show a different item. The handlers may change the list, so check that
+    // the row still shows the same item
+    WeakPtr<ListView> self(this);
+    for (unsigned i = 0; i < updatedRows.Size(); ++i)
+    {
+        UIElement* row = updatedRows[i];
+        unsigned index = GetItemVirtualIndex(row);
+        if (row->GetParent() != contentElement_ || index >= numVirtualItems_)
+            continue;
+
+        using namespace VirtualItemUpdate;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_ELEMENT] = this;
+        eventData[P_ITEM] = row;
+        eventData[P_SELECTION] = index;
+        SendEvent(E_VIRTUALITEMUPDATE, eventData);
+
+        if (self.Expired())
+            return;
+    }
+}
+
 void ListView::HandleUIMouseClick(StringHash eventType, VariantMap& eventData)
 {
     // Disregard the click end if a drag is going on
@@ -1127,6 +1472,11 @@ void ListView::HandleFocusChanged(StringHash eventType, VariantMap& eventData)
         UpdateSelectionEffect();
 }
 
+void ListView::HandleViewChanged(StringHash eventType, VariantMap& eventData)
+{
+    UpdateVirtualItems();
+}
+
 void ListView::UpdateUIClickSubscription()
 {
     UnsubscribeFromEvent(E_UIMOUSECLICK);
@@ -51,6 +51,8 @@ public:
     /// Register object factory.
     static void RegisterObject(Context* context);
 
+    /// Perform UI element update.
+    virtual void Update(float timeStep);
     /// React to a key press.
     virtual void OnKey(int key, int buttons, int qualifiers);
     /// React to resize.
@@ -96,6 +98,21 @@ public:
     void SetClearSelectionOnDefocus(bool enable);
     /// Enable reacting to click end instead of click start for item selection. Default false.
     void SetSelectOnClickEnd(bool enable);
+    /// \brief Enable virtual mode. Only the visible items are instantiated as row elements of fixed height, which are recycled while scrolling. Their contents are requested with the VirtualItemUpdate event.
+    /// Items can not be added or removed individually in virtual mode; set the number of items instead. Not supported in hierarchy mode. All items in the list will be lost during mode change.
+    void SetVirtualMode(bool enable);
+    /// Set number of items in virtual mode.
+    void SetNumVirtualItems(unsigned num);
+    /// Set row element height in virtual mode. Default 16.
+    void SetVirtualItemHeight(int height);
+    /// Set number of extra row elements to instantiate beyond both ends of the visible area in virtual mode. Default 2.
+    void SetVirtualItemMargin(unsigned margin);
+    /// Set row element type in virtual mode. Default Text.
+    void SetVirtualItemType(StringHash type);
+    /// Set row element style in virtual mode. If empty (default), the row element type's default style is used.
+    void SetVirtualItemStyle(const String& style);
+    /// Request the contents of all instantiated row elements again in virtual mode, for example when the item data has changed.
+    void RefreshVirtualItems();
 
     /// Expand item at index. Only has effect in hierarchy mode.
     void Expand(unsigned index, bool enable, bool recursive = false);
@@ -136,6 +153,16 @@ public:
     bool GetHierarchyMode() const { return hierarchyMode_; }
     /// Return base indent.
     int GetBaseIndent() const { return baseIndent_; }
+    /// Return whether virtual mode enabled.
+    bool GetVirtualMode() const { return virtualMode_; }
+    /// Return row element height in virtual mode.
+    int GetVirtualItemHeight() const { return virtualItemHeight_; }
+    /// Return number of extra row elements beyond both ends of the visible area in virtual mode.
+    unsigned GetVirtualItemMargin() const { return virtualItemMargin_; }
+    /// Return row element type in virtual mode.
+    StringHash GetVirtualItemType() const { return virtualItemType_; }
+    /// Return row element style in virtual mode.
+    const String& GetVirtualItemStyle() const { return virtualItemStyle_; }
     /// Ensure full visibility of the item.
     void EnsureItemVisibility(unsigned index);
     /// Ensure full visibility of the item.
@@ -146,6 +173,10 @@ protected:
     virtual bool FilterImplicitAttributes(XMLElement& dest) const;
     /// Update selection effect when selection or focus changes.
     void UpdateSelectionEffect();
+    /// Position the row elements over the visible items in virtual mode, and request the contents of rows that show a different item. Optionally request the contents of all rows.
+    void UpdateVirtualItems(bool refresh = false);
+    /// Scroll the view to fully show a vertical range of the content element.
+    void EnsureRangeVisibility(int top, int height);
 
     /// Current selection.
     PODVector<unsigned> selections_;
@@ -163,6 +194,20 @@ protected:
     bool clearSelectionOnDefocus_;
     /// React to click end instead of click start flag.
     bool selectOnClickEnd_;
+    /// Virtual mode flag.
+    bool virtualMode_;
+    /// Number of items in virtual mode.
+    unsigned numVirtualItems_;
+    /// Row element height in virtual mode.
+    int virtualItemHeight_;
+    /// Number of extra row elements beyond both ends of the visible area in virtual mode.
+    unsigned virtualItemMargin_;
+    /// Row element type in virtual mode.
+    StringHash virtualItemType_;
+    /// Row element style in virtual mode.
+    String virtualItemStyle_;
+    /// Row element width on the last virtual mode update.
+    int virtualItemWidth_;
 
 private:
     /// Handle global UI mouseclick to check for selection change.
@@ -173,6 +218,8 @@ private:
     void HandleItemFocusChanged(StringHash eventType, VariantMap& eventData);
     /// Handle focus changed.
     void HandleFocusChanged(StringHash eventType, VariantMap& eventData);
+    /// Handle view changed to update the row elements in virtual mode.
+    void HandleViewChanged(StringHash eventType, VariantMap& eventData);
     /// Update subscription to UI click events
     void UpdateUIClickSubscription();
 };
@@ -27,7 +27,9 @@
 #include "../Core/Profiler.h"
 #include "../Resource/ResourceCache.h"
 #include "../UI/Text.h"
+#include "../UI/TextLayoutCache.h"
 #include "../Graphics/Texture2D.h"
+#include "../UI/UI.h"
 
 #include "../DebugNew.h"
 
@@ -116,15 +118,14 @@ void Text::GetBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData,
         return;
     }
 
-    // If face has changed or char locations are not valid anymore, update before rendering
-    if (charLocationsDirty_ || !fontFace_ || face != fontFace_)
+    // If face has changed or char locations are not valid anymore, update before rendering. If face uses mutable glyphs
+    // mechanism, also reacquire glyphs before rendering to make sure they are in the texture, as they may have moved to
+    // another page of the shared font atlas
+    if (charLocationsDirty_ || !fontFace_ || face != fontFace_ || face->HasMutableGlyphs())
         UpdateCharLocations();
-    // If face uses mutable glyphs mechanism, reacquire glyphs before rendering to make sure they are in the texture
-    else if (face->HasMutableGlyphs())
-    {
-        for (unsigned i = 0; i < printText_.Size(); ++i)
-            face->GetGlyph(printText_[i]);
-    }
+    // Mutable glyphs may move in the texture, so the batches can not be cached
+    if (face->HasMutableGlyphs())
+        MarkBatchesDirty();
 
     // Hovering and/or whole selection batch
     if ((hovering_ && hoverColor_.a_ > 0.0) || (selected_ && selectionColor_.a_ > 0.0f))
@@ -270,6 +271,7 @@ void Text::SetTextAlignment(HorizontalAlignment align)
     {
         textAlignment_ = align;
         charLocationsDirty_ = true;
+        MarkBatchesDirty();
     }
 }
 
@@ -296,32 +298,38 @@ void Text::SetSelection(unsigned start, unsigned length)
     selectionStart_ = start;
     selectionLength_ = length;
     ValidateSelection();
+    MarkBatchesDirty();
 }
 
 void Text::ClearSelection()
 {
     selectionStart_ = 0;
     selectionLength_ = 0;
+    MarkBatchesDirty();
 }
 
 void Text::SetSelectionColor(const Color& color)
 {
     selectionColor_ = color;
+    MarkBatchesDirty();
 }
 
 void Text::SetHoverColor(const Color& color)
 {
     hoverColor_ = color;
+    MarkBatchesDirty();
 }
 
 void Text::SetTextEffect(TextEffect textEffect)
 {
     textEffect_ = textEffect;
+    MarkBatchesDirty();
 }
 
 void Text::SetEffectColor(const Color& effectColor)
 {
     effectColor_ = effectColor;
+    MarkBatchesDirty();
 }
 
 void Text::SetUsedInText3D(bool usedInText3D)
@@ -332,6 +340,7 @@ void Text::SetUsedInText3D(bool usedInText3D)
 void Text::SetEffectDepthBias(float bias)
 {
     effectDepthBias_ = bias;
+    MarkBatchesDirty();
 }
 
 int Text::GetRowWidth(unsigned index) const
@@ -367,6 +376,7 @@ void Text::SetFontAttr(const ResourceRef& value)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     font_ = cache->GetResource<Font>(value.name_);
+    MarkBatchesDirty();
 }
 
 ResourceRef Text::GetFontAttr() const
@@ -394,6 +404,7 @@ bool Text::FilterImplicitAttributes(XMLElement& dest) const
 
 void Text::UpdateText(bool onResize)
 {
+    MarkBatchesDirty();
     rowWidths_.Clear();
     printText_.Clear();
 
@@ -410,148 +421,175 @@ void Text::UpdateText(bool onResize)
         int rowWidth = 0;
         int rowHeight = (int)(rowSpacing_ * rowHeight_);
 
-        // First see if the text must be split up
-        if (!wordWrap_)
+        // Reuse the layout of the same string with the same face, wrap width and row spacing if it has been done before
+        UI* ui = GetSubsystem<UI>();
+        TextLayoutCache* layoutCache = ui ? ui->GetTextLayoutCache() : 0;
+        int wrapWidth = wordWrap_ ? GetWidth() : -1;
+        const TextLayout* layout = layoutCache ? layoutCache->Find(unicodeText_, face, wrapWidth, rowSpacing_) : 0;
+        if (layout)
         {
-            printText_ = unicodeText_;
-            printToText_.Resize(printText_.Size());
-            for (unsigned i = 0; i < printText_.Size(); ++i)
-                printToText_[i] = i;
+            printText_ = layout->printText_;
+            printToText_ = layout->printToText_;
+            rowWidths_ = layout->rowWidths_;
+            width = layout->width_;
+            height = layout->height_;
         }
         else
         {
-            int maxWidth = GetWidth();
-            unsigned nextBreak = 0;
-            unsigned lineStart = 0;
-            printToText_.Clear();
-
-            for (unsigned i = 0; i < unicodeText_.Size(); ++i)
+            // First see if the text must be split up
+            if (!wordWrap_)
+            {
+                printText_ = unicodeText_;
+                printToText_.Resize(printText_.Size());
+                for (unsigned i = 0; i < printText_.Size(); ++i)
+                    printToText_[i] = i;
+            }
+            else
             {
-                unsigned j;
-                unsigned c = unicodeText_[i];
+                int maxWidth = GetWidth();
+                unsigned nextBreak = 0;
+                unsigned lineStart = 0;
+                printToText_.Clear();
 
-                if (c != '\n')
+                for (unsigned i = 0; i < unicodeText_.Size(); ++i)
                 {
-                    bool ok = true;
+                    unsigned j;
+                    unsigned c = unicodeText_[i];
 
-                    if (nextBreak <= i)
+                    if (c != '\n')
                     {
-                        int futureRowWidth = rowWidth;
-                        for (j = i; j < unicodeText_.Size(); ++j)
+                        bool ok = true;
+
+                        if (nextBreak <= i)
                         {
-                            unsigned d = unicodeText_[j];
-                            if (d == ' ' || d == '\n')
+                            int futureRowWidth = rowWidth;
+                            for (j = i; j < unicodeText_.Size(); ++j)
                             {
-                                nextBreak = j;
-                                break;
+                                unsigned d = unicodeText_[j];
+                                if (d == ' ' || d == '\n')
+                                {
+                                    nextBreak = j;
+                                    break;
+                                }
+                                const FontGlyph* glyph = face->GetGlyph(d);
+                                if (glyph)
+                                {
+                                    futureRowWidth += glyph->advanceX_;
+                                    if (j < unicodeText_.Size() - 1)
+                                        futureRowWidth += face->GetKerning(d, unicodeText_[j + 1]);
+                                }
+                                if (d == '-' && futureRowWidth <= maxWidth)
+                                {
+                                    nextBreak = j + 1;
+                                    break;
+                                }
+                                if (futureRowWidth > maxWidth)
+                                {
+                                    ok = false;
+                                    break;
+                                }
                             }
-                            const FontGlyph* glyph = face->GetGlyph(d);
-                            if (glyph)
-                            {
-                                futureRowWidth += glyph->advanceX_;
-                                if (j < unicodeText_.Size() - 1)
-                                    futureRowWidth += face->GetKerning(d, unicodeText_[j + 1]);
-                            }
-                            if (d == '-' && futureRowWidth <= maxWidth)
+                        }
+
+                        if (!ok)
+                        {
+                            // If did not find any breaks on the line, copy until j, or at least 1 char, to prevent infinite loop
+                            if (nextBreak == lineStart)
                             {
-                                nextBreak = j + 1;
-                                break;
+                                while (i < j)
+                                {
+                                    printText_.Push(unicodeText_[i]);
+                                    printToText_.Push(i);
+                                    ++i;
+                                }
                             }
-                            if (futureRowWidth > maxWidth)
+                            // Eliminate spaces that have been copied before the forced break
+                            while (printText_.Size() && printText_.Back() == ' ')
                             {
-                                ok = false;
-                                break;
+                                printText_.Pop();
+                                printToText_.Pop();
                             }
+                            printText_.Push('\n');
+                            printToText_.Push(Min((int)i, (int)unicodeText_.Size() - 1));
+                            rowWidth = 0;
+                            nextBreak = lineStart = i;
                         }
-                    }
 
-                    if (!ok)
-                    {
-                        // If did not find any breaks on the line, copy until j, or at least 1 char, to prevent infinite loop
-                        if (nextBreak == lineStart)
+                        if (i < unicodeText_.Size())
                         {
-                            while (i < j)
+                            // When copying a space, position is allowed to be over row width
+                            c = unicodeText_[i];
+                            const FontGlyph* glyph = face->GetGlyph(c);
+                            if (glyph)
                             {
-                                printText_.Push(unicodeText_[i]);
+                                rowWidth += glyph->advanceX_;
+                                if (i < unicodeText_.Size() - 1)
+                                    rowWidth += face->GetKerning(c, unicodeText_[i + 1]);
+                            }
+                            if (rowWidth <= maxWidth)
+                            {
+                                printText_.Push(c);
                                 printToText_.Push(i);
-                                ++i;
                             }
                         }
-                        // Eliminate spaces that have been copied before the forced break
-                        while (printText_.Size() && printText_.Back() == ' ')
-                        {
-                            printText_.Pop();
-                            printToText_.Pop();
-                        }
+                    }
+                    else
+                    {
                         printText_.Push('\n');
                         printToText_.Push(Min((int)i, (int)unicodeText_.Size() - 1));
                         rowWidth = 0;
                         nextBreak = lineStart = i;
                     }
+                }
+            }
+
+            rowWidth = 0;
 
-                    if (i < unicodeText_.Size())
+            for (unsigned i = 0; i < printText_.Size(); ++i)
+            {
+                unsigned c = printText_[i];
+
+                if (c != '\n')
+                {
+                    const FontGlyph* glyph = face->GetGlyph(c);
+                    if (glyph)
                     {
-                        // When copying a space, position is allowed to be over row width
-                        c = unicodeText_[i];
-                        const FontGlyph* glyph = face->GetGlyph(c);
-                        if (glyph)
-                        {
-                            rowWidth += glyph->advanceX_;
-                            if (i < unicodeText_.Size() - 1)
-                                rowWidth += face->GetKerning(c, unicodeText_[i + 1]);
-                        }
-                        if (rowWidth <= maxWidth)
-                        {
-                            printText_.Push(c);
-                            printToText_.Push(i);
-                        }
+                        rowWidth += glyph->advanceX_;
+                        if (i < printText_.Size() - 1)
+                            rowWidth += face->GetKerning(c, printText_[i + 1]);
                     }
                 }
                 else
                 {
-                    printText_.Push('\n');
-                    printToText_.Push(Min((int)i, (int)unicodeText_.Size() - 1));
+                    width = Max(width, rowWidth);
+                    height += rowHeight;
+                    rowWidths_.Push(rowWidth);
                     rowWidth = 0;
-                    nextBreak = lineStart = i;
                 }
             }
-        }
-
-        rowWidth = 0;
-
-        for (unsigned i = 0; i < printText_.Size(); ++i)
-        {
-            unsigned c = printText_[i];
 
-            if (c != '\n')
-            {
-                const FontGlyph* glyph = face->GetGlyph(c);
-                if (glyph)
-                {
-                    rowWidth += glyph->advanceX_;
-                    if (i < printText_.Size() - 1)
-                        rowWidth += face->GetKerning(c, printText_[i + 1]);
-                }
-            }
-            else
+            if (rowWidth)
             {
                 width = Max(width, rowWidth);
                 height += rowHeight;
                 rowWidths_.Push(rowWidth);
-                rowWidth = 0;
             }
-        }
 
-        if (rowWidth)
-        {
-            width = Max(width, rowWidth);
-            height += rowHeight;
-            rowWidths_.Push(rowWidth);
-        }
+            // Set at least one row height even if text is empty
+            if (!height)
+                height = rowHeight;
 
-        // Set at least one row height even if text is empty
-        if (!height)
-            height = rowHeight;
+            if (layoutCache)
+            {
+                TextLayout newLayout;
+                newLayout.printText_ = printText_;
+                newLayout.printToText_ = printToText_;
+                newLayout.rowWidths_ = rowWidths_;
+                newLayout.width_ = width;
+                newLayout.height_ = height;
+                layoutCache->Store(unicodeText_, face, wrapWidth, rowSpacing_, newLayout);
+            }
+        }
 
         // Set minimum and current size according to the text size, but respect fixed width if set
         if (!IsFixedWidth())
@@ -615,9 +653,14 @@ void Text::UpdateCharLocations()
             loc.size_ = IntVector2(glyph ? glyph->advanceX_ : 0, rowHeight_);
             if (glyph)
             {
-                // Store glyph's location for rendering. Verify that glyph page is valid
-                if (glyph->page_ < pageGlyphLocations_.Size())
+                // Store glyph's location for rendering. Verify that glyph page is valid. Acquiring the glyph may have added a
+                // page to the shared font atlas
+                if (glyph->page_ < face->GetTextures().Size())
+                {
+                    if (glyph->page_ >= pageGlyphLocations_.Size())
+                        pageGlyphLocations_.Resize(glyph->page_ + 1);
                     pageGlyphLocations_[glyph->page_].Push(GlyphLocation(x, y, glyph));
+                }
                 x += glyph->advanceX_;
                 if (i < printText_.Size() - 1)
                     x += face->GetKerning(c, printText_[i + 1]);
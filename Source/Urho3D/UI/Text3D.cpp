@@ -23,6 +23,7 @@
 #include "../Graphics/Camera.h"
 #include "../Core/Context.h"
 #include "../UI/Font.h"
+#include "../UI/FontFace.h"
 #include "../Graphics/Geometry.h"
 #include "../IO/Log.h"
 #include "../Graphics/Material.h"
@@ -31,6 +32,7 @@
 #include "../Graphics/Technique.h"
 #include "../UI/Text.h"
 #include "../UI/Text3D.h"
+#include "../UI/UIEvents.h"
 #include "../Graphics/VertexBuffer.h"
 
 namespace Urho3D
@@ -455,6 +457,12 @@ void Text3D::UpdateTextBatches()
 
     text_.GetBatches(uiBatches_, uiVertexData_, IntRect::ZERO);
 
+    // Mutable glyphs are not reacquired on every frame like in a 2D text, so rebuild the batches if they may have been evicted
+    if (text_.fontFace_ && text_.fontFace_->HasMutableGlyphs())
+        SubscribeToEvent(E_FONTATLASEVICTED, HANDLER(Text3D, HandleFontAtlasEvicted));
+    else
+        UnsubscribeFromEvent(E_FONTATLASEVICTED);
+
     Vector3 offset(Vector3::ZERO);
 
     switch (text_.GetHorizontalAlignment())
@@ -582,4 +590,13 @@ void Text3D::UpdateTextMaterials(bool forceUpdate)
     }
 }
 
+void Text3D::HandleFontAtlasEvicted(StringHash eventType, VariantMap& eventData)
+{
+    // The glyphs may have moved to other pages, so materials must be re-evaluated as well
+    textDirty_ = true;
+    OnMarkedDirty(node_);
+    UpdateTextBatches();
+    UpdateTextMaterials();
+}
+
 }
@@ -162,6 +162,8 @@ private:
     void UpdateTextBatches();
     /// Create materials for text rendering. May only be called from the main thread. Text %UI batches must be up-to-date.
     void UpdateTextMaterials(bool forceUpdate = false);
+    /// Handle shared font atlas pages being recycled.
+    void HandleFontAtlasEvicted(StringHash eventType, VariantMap& eventData);
 
     /// Internally used text element.
     Text text_;
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Container/Sort.h"
+#include "../UI/Font.h"
+#include "../UI/FontFace.h"
+#include "../UI/TextLayoutCache.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned DEFAULT_TEXT_LAYOUT_CACHE_SIZE = 256;
+
+TextLayoutCache::TextLayoutCache() :
+    maxSize_(DEFAULT_TEXT_LAYOUT_CACHE_SIZE),
+    useCounter_(0)
+{
+}
+
+TextLayoutCache::~TextLayoutCache()
+{
+}
+
+void TextLayoutCache::SetMaxSize(unsigned size)
+{
+    maxSize_ = size;
+    if (!maxSize_)
+        Clear();
+    else if (entries_.Size() > maxSize_)
+        Trim();
+}
+
+const TextLayout* TextLayoutCache::Find(const PODVector<unsigned>& text, FontFace* face, int wrapWidth, float rowSpacing)
+{
+    if (!maxSize_ || !face)
+        return 0;
+
+    HashMap<unsigned, Entry>::Iterator i = entries_.Find(GetKeyHash(text, face, wrapWidth, rowSpacing));
+    if (i == entries_.End())
+        return 0;
+
+    Entry& entry = i->second_;
+    if (entry.face_.Get() != face || entry.wrapWidth_ != wrapWidth || entry.rowSpacing_ != rowSpacing || entry.text_ != text)
+        return 0;
+
+    entry.lastUse_ = ++useCounter_;
+    return &entry.layout_;
+}
+
+void TextLayoutCache::Store(const PODVector<unsigned>& text, FontFace* face, int wrapWidth, float rowSpacing,
+    const TextLayout& layout)
+{
+    if (!maxSize_ || !face)
+        return;
+
+    // On a hash collision, the previous layout is replaced
+    Entry& entry = entries_[GetKeyHash(text, face, wrapWidth, rowSpacing)];
+    entry.text_ = text;
+    entry.face_ = face;
+    entry.wrapWidth_ = wrapWidth;
+    entry.rowSpacing_ = rowSpacing;
+    entry.layout_ = layout;
+    entry.lastUse_ = ++useCounter_;
+
+    if (entries_.Size() > maxSize_)
+        Trim();
+}
+
+void TextLayoutCache::Clear()
+{
+    entries_.Clear();
+}
+
+unsigned TextLayoutCache::GetKeyHash(const PODVector<unsigned>& text, FontFace* face, int wrapWidth, float rowSpacing)
+{
+    unsigned hash = MakeHash(face);
+    hash = hash * 31 + (unsigned)wrapWidth;
+    hash = hash * 31 + (unsigned)(rowSpacing * 1000.0f);
+    for (unsigned i = 0; i < text.Size(); ++i)
+        hash = hash * 31 + text[i];
+    return hash;
+}
+
+void TextLayoutCache::Trim()
+{
+    // Evict in bulk so that storing is amortized constant time when the cache is full
+    PODVector<unsigned> uses;
+    uses.Reserve(entries_.Size());
+    for (HashMap<unsigned, Entry>::ConstIterator i = entries_.Begin(); i != entries_.End(); ++i)
+        uses.Push(i->second_.lastUse_);
+    Sort(uses.Begin(), uses.End());
+    unsigned threshold = uses[uses.Size() - maxSize_ / 2 - 1];
+
+    for (HashMap<unsigned, Entry>::Iterator i = entries_.Begin(); i != entries_.End();)
+    {
+        if (i->second_.lastUse_ <= threshold || !i->second_.face_)
+            i = entries_.Erase(i);
+        else
+            ++i;
+    }
+}
+
+}
@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/Ptr.h"
+
+namespace Urho3D
+{
+
+class FontFace;
+
+/// Rows of text laid out with a font face.
+struct TextLayout
+{
+    /// Construct.
+    TextLayout() :
+        width_(0),
+        height_(0)
+    {
+    }
+
+    /// Text modified into printed form.
+    PODVector<unsigned> printText_;
+    /// Mapping of printed form back to original char indices.
+    PODVector<unsigned> printToText_;
+    /// Row widths.
+    PODVector<int> rowWidths_;
+    /// Total width.
+    int width_;
+    /// Total height.
+    int height_;
+};
+
+/// Cache of text layouts keyed by string, font face, wrap width and row spacing, with least recently used eviction. Lets %Text elements that show the same strings again, such as timers and damage numbers, skip laying them out.
+class URHO3D_API TextLayoutCache : public RefCounted
+{
+public:
+    /// Construct.
+    TextLayoutCache();
+    /// Destruct.
+    ~TextLayoutCache();
+
+    /// Set maximum number of cached layouts. Zero disables the cache.
+    void SetMaxSize(unsigned size);
+    /// Return cached layout or null if not found. Wrap width is negative when word wrap is off.
+    const TextLayout* Find(const PODVector<unsigned>& text, FontFace* face, int wrapWidth, float rowSpacing);
+    /// Store a layout.
+    void Store(const PODVector<unsigned>& text, FontFace* face, int wrapWidth, float rowSpacing, const TextLayout& layout);
+    /// Remove all cached layouts.
+    void Clear();
+
+    /// Return maximum number of cached layouts.
+    unsigned GetMaxSize() const { return maxSize_; }
+    /// Return number of cached layouts.
+    unsigned GetSize() const { return entries_.Size(); }
+
+private:
+    /// Cached layout with its key.
+    struct Entry
+    {
+        /// Text as Unicode characters.
+        PODVector<unsigned> text_;
+        /// Font face. The entry is stale if the face has been destroyed.
+        WeakPtr<FontFace> face_;
+        /// Wrap width.
+        int wrapWidth_;
+        /// Row spacing.
+        float rowSpacing_;
+        /// Layout.
+        TextLayout layout_;
+        /// Use counter value when last found or stored.
+        unsigned lastUse_;
+    };
+
+    /// Return hash of a key.
+    static unsigned GetKeyHash(const PODVector<unsigned>& text, FontFace* face, int wrapWidth, float rowSpacing);
+    /// Remove the least recently used half of the layouts.
+    void Trim();
+
+    /// Cached layouts by key hash.
+    HashMap<unsigned, Entry> entries_;
+    /// Maximum number of cached layouts.
+    unsigned maxSize_;
+    /// Use counter.
+    unsigned useCounter_;
+};
+
+}
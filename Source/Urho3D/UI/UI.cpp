@@ -27,6 +27,7 @@
 #include "../UI/DropDownList.h"
 #include "../UI/FileSelector.h"
 #include "../UI/Font.h"
+#include "../UI/FontAtlas.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Input/Input.h"
@@ -35,9 +36,13 @@
 #include "../UI/ListView.h"
 #include "../IO/Log.h"
 #include "../Math/Matrix3x4.h"
+#include "../Core/MemoryTracker.h"
 #include "../UI/MessageBox.h"
 #include "../Core/Profiler.h"
+#include "../Graphics/Renderer.h"
+#include "../Graphics/RenderSurface.h"
 #include "../Resource/ResourceCache.h"
+#include "../Resource/ResourceEvents.h"
 #include "../UI/ScrollBar.h"
 #include "../Graphics/Shader.h"
 #include "../Graphics/ShaderVariation.h"
@@ -46,6 +51,7 @@
 #include "../UI/Sprite.h"
 #include "../UI/Text.h"
 #include "../UI/Text3D.h"
+#include "../UI/TextLayoutCache.h"
 #include "../Graphics/Texture2D.h"
 #include "../UI/ToolTip.h"
 #include "../UI/UI.h"
@@ -104,13 +110,22 @@ UI::UI(Context* context) :
     useMutableGlyphs_(false),
     forceAutoHint_(false),
     uiRendered_(false),
+    batchCaching_(false),
     nonModalBatchSize_(0),
+    batchFrameNumber_(1),
+    vertexDirtyStart_(0),
+    vertexDirtyEnd_(M_MAX_UNSIGNED),
+    vertexCheckedEnd_(0),
     dragElementsCount_(0),
     dragConfirmedCount_(0)
 {
     rootElement_->SetTraversalMode(TM_DEPTH_FIRST);
     rootModalElement_->SetTraversalMode(TM_DEPTH_FIRST);
 
+    fontAtlas_ = new FontAtlas(context_);
+    fontAtlas_->SetPageSize(maxFontTextureSize_);
+    textLayoutCache_ = new TextLayoutCache();
+
     // Register UI library object factories
     RegisterUILibrary(context_);
 
@@ -125,6 +140,7 @@ UI::UI(Context* context) :
     SubscribeToEvent(E_KEYDOWN, HANDLER(UI, HandleKeyDown));
     SubscribeToEvent(E_TEXTINPUT, HANDLER(UI, HandleTextInput));
     SubscribeToEvent(E_DROPFILE, HANDLER(UI, HandleDropFile));
+    SubscribeToEvent(E_DEVICERESET, HANDLER(UI, HandleDeviceReset));
 
     // Try to initialize right now, but skip if screen mode is not yet set
     Initialize();
@@ -188,6 +204,7 @@ void UI::SetFocusElement(UIElement* element, bool byKey)
     {
         UIElement* oldFocusElement = focusElement_;
         focusElement_.Reset();
+        oldFocusElement->MarkBatchesDirty();
 
         VariantMap& focusEventData = GetEventDataMap();
         focusEventData[Defocused::P_ELEMENT] = oldFocusElement;
@@ -198,6 +215,7 @@ void UI::SetFocusElement(UIElement* element, bool byKey)
     if (element && element->GetFocusMode() >= FM_FOCUSABLE)
     {
         focusElement_ = element;
+        element->MarkBatchesDirty();
 
         VariantMap& focusEventData = GetEventDataMap();
         focusEventData[Focused::P_ELEMENT] = element;
@@ -295,13 +313,19 @@ void UI::Clear()
 
 void UI::Update(float timeStep)
 {
+    MEMORY_TAG(MEMTAG_UI);
+
     assert(rootElement_ && rootModalElement_);
 
     PROFILE(UpdateUI);
 
-    // Expire hovers
+    // Expire hovers. When batches or textures are cached, elements may not render to reset their hover state, so reset it here
     for (HashMap<WeakPtr<UIElement>, bool>::Iterator i = hoveredElements_.Begin(); i != hoveredElements_.End(); ++i)
+    {
         i->second_ = false;
+        if (i->first_)
+            i->first_->SetHovering(false);
+    }
 
     Input* input = GetSubsystem<Input>();
     bool mouseGrabbed = input->IsMouseGrabbed();
@@ -388,6 +412,8 @@ void UI::Update(float timeStep)
 
 void UI::RenderUpdate()
 {
+    MEMORY_TAG(MEMTAG_UI);
+
     assert(rootElement_ && rootModalElement_ && graphics_);
 
     PROFILE(GetUIBatches);
@@ -397,44 +423,77 @@ void UI::RenderUpdate()
     // If the OS cursor is visible, do not render the UI's own cursor
     bool osCursorVisible = GetSubsystem<Input>()->IsMouseVisible();
 
+    if (batchCaching_)
+    {
+        ++batchFrameNumber_;
+        vertexCheckedEnd_ = 0;
+    }
+    UpdateHoverBatches();
+    fontAtlas_->Update();
+
+    // If the cache textures queued on the previous frame were not rendered, queue them again
+    for (Vector<TextureCacheUpdate>::ConstIterator i = textureCacheUpdates_.Begin(); i != textureCacheUpdates_.End(); ++i)
+    {
+        if (i->element_)
+            i->element_->MarkBatchesDirty();
+    }
+    textureCacheUpdates_.Clear();
+    textureBatches_.Clear();
+    textureVertexData_.Clear();
+
     // Get rendering batches from the non-modal UI elements
     batches_.Clear();
     vertexData_.Clear();
     const IntVector2& rootSize = rootElement_->GetSize();
     IntRect currentScissor = IntRect(0, 0, rootSize.x_, rootSize.y_);
-    GetBatches(rootElement_, currentScissor);
+    GetBatches(batches_, vertexData_, rootElement_, currentScissor);
 
     // Save the batch size of the non-modal batches for later use
     nonModalBatchSize_ = batches_.Size();
 
     // Get rendering batches from the modal UI elements
-    GetBatches(rootModalElement_, currentScissor);
+    GetBatches(batches_, vertexData_, rootModalElement_, currentScissor);
 
     // Get batches from the cursor (and its possible children) last to draw it on top of everything
     if (cursor_ && cursor_->IsVisible() && !osCursorVisible)
     {
         currentScissor = IntRect(0, 0, rootSize.x_, rootSize.y_);
         cursor_->GetBatches(batches_, vertexData_, currentScissor);
-        GetBatches(cursor_, currentScissor);
+        GetBatches(batches_, vertexData_, cursor_, currentScissor);
     }
+
+    // Vertex data after the last reused cache needs to be uploaded
+    if (batchCaching_)
+        MarkVertexDataDirty(vertexCheckedEnd_, vertexData_.Size());
+    else
+        MarkVertexDataDirty(0, M_MAX_UNSIGNED);
 }
 
 void UI::Render(bool resetRenderTargets)
 {
+    MEMORY_TAG(MEMTAG_UI);
+
     // Perform the default render only if not rendered yet
     if (resetRenderTargets && uiRendered_)
         return;
 
     PROFILE(RenderUI);
+    graphics_->BeginGPUProfileBlock("UI");
 
     // If the OS cursor is visible, apply its shape now if changed
     bool osCursorVisible = GetSubsystem<Input>()->IsMouseVisible();
     if (cursor_ && osCursorVisible)
         cursor_->ApplyOSCursorShape();
 
-    SetVertexData(vertexBuffer_, vertexData_);
+    SetVertexData(vertexBuffer_, vertexData_, vertexDirtyStart_, vertexDirtyEnd_);
+    vertexDirtyStart_ = M_MAX_UNSIGNED;
+    vertexDirtyEnd_ = 0;
     SetVertexData(debugVertexBuffer_, debugVertexData_);
 
+    // Update the cache textures before they are drawn
+    if (!textureCacheUpdates_.Empty())
+        RenderTextureCaches();
+
     // Render non-modal batches
     Render(resetRenderTargets, vertexBuffer_, batches_, 0, nonModalBatchSize_);
     // Render debug draw
@@ -446,6 +505,7 @@ void UI::Render(bool resetRenderTargets)
     debugDrawBatches_.Clear();
     debugVertexData_.Clear();
 
+    graphics_->EndGPUProfileBlock();
     uiRendered_ = true;
 }
 
@@ -460,6 +520,8 @@ void UI::DebugDraw(UIElement* element)
 
 SharedPtr<UIElement> UI::LoadLayout(Deserializer& source, XMLFile* styleFile)
 {
+    MEMORY_TAG(MEMTAG_UI);
+
     SharedPtr<XMLFile> xml(new XMLFile(context_));
     if (!xml->Load(source))
         return SharedPtr<UIElement>();
@@ -551,6 +613,7 @@ void UI::SetMaxFontTextureSize(int size)
         if (size != maxFontTextureSize_)
         {
             maxFontTextureSize_ = size;
+            fontAtlas_->SetPageSize(size);
             ReleaseFontFaces();
         }
     }
@@ -580,6 +643,39 @@ void UI::SetUseMutableGlyphs(bool enable)
     }
 }
 
+void UI::SetFontAtlasMaxPages(unsigned num)
+{
+    fontAtlas_->SetMaxPages(num);
+}
+
+void UI::SetTextLayoutCacheSize(unsigned size)
+{
+    textLayoutCache_->SetMaxSize(size);
+}
+
+void UI::SetBatchCaching(bool enable)
+{
+    if (enable != batchCaching_)
+    {
+        batchCaching_ = enable;
+        hoverBatchElements_.Clear();
+        ResetBatchCache();
+
+        // Font reloads destroy the face textures that the cached batches refer to
+        if (enable)
+            SubscribeToEvent(E_RELOADSTARTED, HANDLER(UI, HandleReloadStarted));
+        else
+            UnsubscribeFromEvent(E_RELOADSTARTED);
+    }
+}
+
+void UI::ResetBatchCache()
+{
+    rootElement_->MarkBatchesDirty(true);
+    rootModalElement_->MarkBatchesDirty(true);
+    MarkVertexDataDirty(0, M_MAX_UNSIGNED);
+}
+
 void UI::SetForceAutoHint(bool enable)
 {
     if (enable != forceAutoHint_)
@@ -594,6 +690,26 @@ IntVector2 UI::GetCursorPosition() const
     return cursor_ ? cursor_->GetPosition() : GetSubsystem<Input>()->GetMousePosition();
 }
 
+unsigned UI::GetFontAtlasMaxPages() const
+{
+    return fontAtlas_->GetMaxPages();
+}
+
+unsigned UI::GetTextLayoutCacheSize() const
+{
+    return textLayoutCache_->GetMaxSize();
+}
+
+FontAtlas* UI::GetFontAtlas() const
+{
+    return fontAtlas_;
+}
+
+TextLayoutCache* UI::GetTextLayoutCache() const
+{
+    return textLayoutCache_;
+}
+
 UIElement* UI::GetElementAt(const IntVector2& position, bool enabledOnly)
 {
     UIElement* result = 0;
@@ -699,6 +815,7 @@ void UI::Initialize()
 
     vertexBuffer_ = new VertexBuffer(context_);
     debugVertexBuffer_ = new VertexBuffer(context_);
+    textureVertexBuffer_ = new VertexBuffer(context_);
 
     initialized_ = true;
 
@@ -724,7 +841,7 @@ void UI::Update(float timeStep, UIElement* element)
         Update(timeStep, children[i]);
 }
 
-void UI::SetVertexData(VertexBuffer* dest, const PODVector<float>& vertexData)
+void UI::SetVertexData(VertexBuffer* dest, const PODVector<float>& vertexData, unsigned dirtyStart, unsigned dirtyEnd)
 {
     if (vertexData.Empty())
         return;
@@ -733,9 +850,21 @@ void UI::SetVertexData(VertexBuffer* dest, const PODVector<float>& vertexData)
     // Resize the vertex buffer first if too small or much too large
     unsigned numVertices = vertexData.Size() / UI_VERTEX_SIZE;
     if (dest->GetVertexCount() < numVertices || dest->GetVertexCount() > numVertices * 2)
+    {
         dest->SetSize(numVertices, MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1, true);
+        dirtyStart = 0;
+        dirtyEnd = M_MAX_UNSIGNED;
+    }
 
-    dest->SetData(&vertexData[0]);
+    if (dirtyEnd > vertexData.Size())
+        dirtyEnd = vertexData.Size();
+    if ((!dirtyStart && dirtyEnd == vertexData.Size()) || dest->IsDataLost())
+        dest->SetData(&vertexData[0]);
+    else if (dirtyStart < dirtyEnd)
+    {
+        dest->SetDataRange(&vertexData[dirtyStart], dirtyStart / UI_VERTEX_SIZE, (dirtyEnd - dirtyStart) /
+            UI_VERTEX_SIZE);
+    }
 }
 
 void UI::Render(bool resetRenderTargets, VertexBuffer* buffer, const PODVector<UIBatch>& batches, unsigned batchStart, unsigned batchEnd)
@@ -822,7 +951,155 @@ void UI::Render(bool resetRenderTargets, VertexBuffer* buffer, const PODVector<U
     }
 }
 
-void UI::GetBatches(UIElement* element, IntRect currentScissor)
+void UI::RenderTextureCaches()
+{
+    PROFILE(RenderUITextureCaches);
+
+    SetVertexData(textureVertexBuffer_, textureVertexData_);
+
+    // Save the current render targets and viewport, as the UI may be rendered into a render path's target
+    RenderSurface* renderTargets[MAX_RENDERTARGETS];
+    for (unsigned i = 0; i < MAX_RENDERTARGETS; ++i)
+        renderTargets[i] = graphics_->GetRenderTarget(i);
+    RenderSurface* depthStencil = graphics_->GetDepthStencil();
+    IntRect viewport = graphics_->GetViewport();
+    Renderer* renderer = GetSubsystem<Renderer>();
+
+    // Culling is disabled, as the vertical flip on OpenGL reverses the winding order
+    graphics_->SetColorWrite(true);
+    graphics_->SetCullMode(CULL_NONE);
+    graphics_->SetDepthTest(CMP_ALWAYS);
+    graphics_->SetDepthWrite(false);
+    graphics_->SetFillMode(FILL_SOLID);
+    graphics_->SetStencilTest(false);
+    graphics_->SetVertexBuffer(textureVertexBuffer_);
+    for (unsigned i = 1; i < MAX_RENDERTARGETS; ++i)
+        graphics_->SetRenderTarget(i, (RenderSurface*)0);
+
+    ShaderVariation* noTextureVS = graphics_->GetShader(VS, "Basic", "VERTEXCOLOR");
+    ShaderVariation* diffTextureVS = graphics_->GetShader(VS, "Basic", "DIFFMAP VERTEXCOLOR");
+    ShaderVariation* noTexturePS = graphics_->GetShader(PS, "Basic", "VERTEXCOLOR");
+    ShaderVariation* noTexturePremulPS = graphics_->GetShader(PS, "Basic", "PREMULALPHA VERTEXCOLOR");
+    ShaderVariation* diffTexturePS = graphics_->GetShader(PS, "Basic", "DIFFMAP VERTEXCOLOR");
+    ShaderVariation* diffTexturePremulPS = graphics_->GetShader(PS, "Basic", "DIFFMAP PREMULALPHA VERTEXCOLOR");
+    ShaderVariation* diffMaskTexturePS = graphics_->GetShader(PS, "Basic", "DIFFMAP ALPHAMASK VERTEXCOLOR");
+    ShaderVariation* alphaTexturePS = graphics_->GetShader(PS, "Basic", "ALPHAMAP VERTEXCOLOR");
+    ShaderVariation* alphaTexturePremulPS = graphics_->GetShader(PS, "Basic", "ALPHAMAP PREMULALPHA VERTEXCOLOR");
+
+    unsigned alphaFormat = Graphics::GetAlphaFormat();
+
+    for (Vector<TextureCacheUpdate>::ConstIterator i = textureCacheUpdates_.Begin(); i != textureCacheUpdates_.End(); ++i)
+    {
+        Texture2D* texture = i->element_ ? i->element_->GetBatchCache().texture_.Get() : (Texture2D*)0;
+        int width = i->rect_.Width();
+        int height = i->rect_.Height();
+        if (!texture || texture->GetWidth() != width || texture->GetHeight() != height)
+            continue;
+
+        graphics_->SetRenderTarget(0, texture);
+        graphics_->SetDepthStencil(renderer ? renderer->GetDepthStencil(width, height) : (RenderSurface*)0);
+        graphics_->SetViewport(IntRect(0, 0, width, height));
+        graphics_->Clear(CLEAR_COLOR, Color::TRANSPARENT);
+
+        // Map the element's screen rectangle to the whole texture. On OpenGL flip vertically for consistent UV addressing
+        // with Direct3D
+        Matrix4 projection(Matrix4::IDENTITY);
+        projection.m00_ = 2.0f / (float)width;
+        projection.m03_ = -1.0f - 2.0f * (float)i->rect_.left_ / (float)width;
+        #ifdef URHO3D_OPENGL
+        projection.m11_ = 2.0f / (float)height;
+        projection.m13_ = -1.0f - 2.0f * (float)i->rect_.top_ / (float)height;
+        #else
+        projection.m11_ = -2.0f / (float)height;
+        projection.m13_ = 1.0f + 2.0f * (float)i->rect_.top_ / (float)height;
+        #endif
+        projection.m22_ = 1.0f;
+        projection.m23_ = 0.0f;
+        projection.m33_ = 1.0f;
+
+        graphics_->ClearParameterSources();
+
+        for (unsigned j = i->batchStart_; j < i->batchEnd_; ++j)
+        {
+            const UIBatch& batch = textureBatches_[j];
+            if (batch.vertexStart_ == batch.vertexEnd_)
+                continue;
+
+            // Convert alpha blending to premultiplied alpha, so that the texture's alpha channel accumulates correctly
+            // and the texture can be drawn with premultiplied alpha blending
+            BlendMode blendMode = batch.blendMode_;
+            bool premultiply = false;
+            if (blendMode == BLEND_ALPHA)
+            {
+                blendMode = BLEND_PREMULALPHA;
+                premultiply = true;
+            }
+            else if (blendMode == BLEND_ADDALPHA)
+            {
+                blendMode = BLEND_ADD;
+                premultiply = true;
+            }
+
+            ShaderVariation* ps;
+            ShaderVariation* vs;
+
+            if (!batch.texture_)
+            {
+                ps = premultiply ? noTexturePremulPS : noTexturePS;
+                vs = noTextureVS;
+            }
+            else
+            {
+                vs = diffTextureVS;
+
+                if (batch.texture_->GetFormat() == alphaFormat)
+                    ps = premultiply ? alphaTexturePremulPS : alphaTexturePS;
+                else if (batch.blendMode_ != BLEND_ALPHA && batch.blendMode_ != BLEND_ADDALPHA && batch.blendMode_ != BLEND_PREMULALPHA)
+                    ps = diffMaskTexturePS;
+                else
+                    ps = premultiply ? diffTexturePremulPS : diffTexturePS;
+            }
+
+            graphics_->SetShaders(vs, ps);
+            if (graphics_->NeedParameterUpdate(SP_OBJECT, this))
+                graphics_->SetShaderParameter(VSP_MODEL, Matrix3x4::IDENTITY);
+            if (graphics_->NeedParameterUpdate(SP_CAMERA, this))
+                graphics_->SetShaderParameter(VSP_VIEWPROJ, projection);
+            if (graphics_->NeedParameterUpdate(SP_MATERIAL, this))
+                graphics_->SetShaderParameter(PSP_MATDIFFCOLOR, Color(1.0f, 1.0f, 1.0f, 1.0f));
+
+            // Convert the scissor to texture coordinates
+            IntRect scissor = batch.scissor_;
+            scissor.left_ -= i->rect_.left_;
+            scissor.right_ -= i->rect_.left_;
+            #ifdef URHO3D_OPENGL
+            scissor.top_ = i->rect_.bottom_ - batch.scissor_.bottom_;
+            scissor.bottom_ = i->rect_.bottom_ - batch.scissor_.top_;
+            #else
+            scissor.top_ -= i->rect_.top_;
+            scissor.bottom_ -= i->rect_.top_;
+            #endif
+
+            graphics_->SetBlendMode(blendMode);
+            graphics_->SetScissorTest(true, scissor);
+            graphics_->SetTexture(0, batch.texture_);
+            graphics_->Draw(TRIANGLE_LIST, batch.vertexStart_ / UI_VERTEX_SIZE, (batch.vertexEnd_ - batch.vertexStart_) /
+                UI_VERTEX_SIZE);
+        }
+    }
+
+    for (unsigned i = 0; i < MAX_RENDERTARGETS; ++i)
+        graphics_->SetRenderTarget(i, renderTargets[i]);
+    graphics_->SetDepthStencil(depthStencil);
+    graphics_->SetViewport(viewport);
+    graphics_->SetTexture(0, 0);
+
+    textureCacheUpdates_.Clear();
+    textureBatches_.Clear();
+    textureVertexData_.Clear();
+}
+
+void UI::GetBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, IntRect currentScissor)
 {
     // Set clipping scissor for child elements. No need to draw if zero size
     element->AdjustScissor(currentScissor);
@@ -846,14 +1123,19 @@ void UI::GetBatches(UIElement* element, IntRect currentScissor)
             while (j != children.End() && (*j)->GetPriority() == currentPriority)
             {
                 if ((*j)->IsWithinScissor(currentScissor) && (*j) != cursor_)
-                    (*j)->GetBatches(batches_, vertexData_, currentScissor);
+                {
+                    if ((*j)->GetTextureCaching())
+                        GetTextureCacheBatches(batches, vertexData, *j, currentScissor);
+                    else
+                        (*j)->GetBatches(batches, vertexData, currentScissor);
+                }
                 ++j;
             }
-            // Now recurse into the children
+            // Now recurse into the children. The children of texture cached elements are drawn as part of the texture
             while (i != j)
             {
-                if ((*i)->IsVisible() && (*i) != cursor_)
-                    GetBatches(*i, currentScissor);
+                if ((*i)->IsVisible() && (*i) != cursor_ && !(*i)->GetTextureCaching())
+                    GetBatches(batches, vertexData, *i, currentScissor);
                 ++i;
             }
         }
@@ -865,16 +1147,185 @@ void UI::GetBatches(UIElement* element, IntRect currentScissor)
         {
             if ((*i) != cursor_)
             {
-                if ((*i)->IsWithinScissor(currentScissor))
-                    (*i)->GetBatches(batches_, vertexData_, currentScissor);
-                if ((*i)->IsVisible())
-                    GetBatches(*i, currentScissor);
+                if (batchCaching_)
+                    GetCachedBatches(batches, vertexData, *i, currentScissor);
+                else
+                    GetElementBatches(batches, vertexData, *i, currentScissor);
             }
             ++i;
         }
     }
 }
 
+void UI::GetCachedBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, const IntRect&
+    currentScissor)
+{
+    UIBatchCache& cache = element->GetBatchCache();
+    bool rebuilt = false;
+
+    if (cache.dirty_ || cache.scissor_ != currentScissor)
+    {
+        // Clear the dirty flag first, so that the elements can mark themselves dirty again while generating batches
+        cache.dirty_ = false;
+        cache.scissor_ = currentScissor;
+        cache.batches_.Clear();
+        cache.vertexData_.Clear();
+        GetElementBatches(cache.batches_, cache.vertexData_, element, currentScissor);
+        rebuilt = true;
+    }
+
+    unsigned vertexStart = vertexData.Size();
+    if (!cache.vertexData_.Empty())
+    {
+        vertexData.Resize(vertexStart + cache.vertexData_.Size());
+        memcpy(&vertexData[vertexStart], &cache.vertexData_[0], cache.vertexData_.Size() * sizeof(float));
+    }
+
+    for (unsigned i = 0; i < cache.batches_.Size(); ++i)
+    {
+        UIBatch batch = cache.batches_[i];
+        batch.vertexData_ = &vertexData;
+        batch.vertexStart_ += vertexStart;
+        batch.vertexEnd_ += vertexStart;
+        UIBatch::AddOrMerge(batch, batches);
+    }
+
+    // If the vertex data stays in the same place as on the previous frame it does not need to be uploaded again
+    if (&vertexData == &vertexData_)
+    {
+        bool reused = !rebuilt && cache.frameNumber_ + 1 == batchFrameNumber_ && cache.vertexOffset_ == vertexStart;
+        MarkVertexDataDirty(vertexCheckedEnd_, reused ? vertexStart : vertexData.Size());
+        vertexCheckedEnd_ = vertexData.Size();
+        cache.vertexOffset_ = vertexStart;
+        cache.frameNumber_ = batchFrameNumber_;
+    }
+}
+
+void UI::GetElementBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, const IntRect&
+    currentScissor)
+{
+    if (element->GetTextureCaching())
+    {
+        if (element->IsWithinScissor(currentScissor))
+            GetTextureCacheBatches(batches, vertexData, element, currentScissor);
+    }
+    else
+    {
+        if (element->IsWithinScissor(currentScissor))
+            element->GetBatches(batches, vertexData, currentScissor);
+        if (element->IsVisible())
+            GetBatches(batches, vertexData, element, currentScissor);
+    }
+}
+
+void UI::GetTextureCacheBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, const IntRect&
+    currentScissor)
+{
+    UIBatchCache& cache = element->GetBatchCache();
+    const IntVector2& size = element->GetSize();
+    if (size.x_ <= 0 || size.y_ <= 0)
+        return;
+
+    // (Re)create the render target texture if necessary. If that fails, disable texture caching on the element
+    if (!cache.texture_ || cache.texture_->GetWidth() != size.x_ || cache.texture_->GetHeight() != size.y_)
+    {
+        if (!cache.texture_)
+        {
+            cache.texture_ = new Texture2D(context_);
+            cache.texture_->SetNumLevels(1);
+            cache.texture_->SetFilterMode(FILTER_NEAREST);
+            cache.texture_->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+            cache.texture_->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+        }
+        if (!cache.texture_->SetSize(size.x_, size.y_, Graphics::GetRGBAFormat(), TEXTURE_RENDERTARGET))
+        {
+            LOGERROR("Failed to create cache texture for UI element " + element->GetName());
+            element->SetTextureCaching(false);
+            GetElementBatches(batches, vertexData, element, currentScissor);
+            return;
+        }
+        cache.textureDirty_ = true;
+    }
+
+    if (cache.textureDirty_)
+    {
+        // Clear the dirty flag first, so that the elements can mark themselves dirty again while generating batches.
+        // Generate the batches with the whole element as the scissor, so that the texture does not depend on clipping
+        cache.textureDirty_ = false;
+        const IntVector2& screenPos = element->GetScreenPosition();
+        IntRect elementScissor(screenPos.x_, screenPos.y_, screenPos.x_ + size.x_, screenPos.y_ + size.y_);
+        PODVector<UIBatch> elementBatches;
+        PODVector<float> elementVertexData;
+        element->GetBatches(elementBatches, elementVertexData, elementScissor);
+        GetBatches(elementBatches, elementVertexData, element, elementScissor);
+
+        // Nested cache textures were queued while generating the batches, so they get rendered first
+        TextureCacheUpdate update;
+        update.element_ = element;
+        update.rect_ = elementScissor;
+        update.batchStart_ = textureBatches_.Size();
+
+        unsigned vertexStart = textureVertexData_.Size();
+        if (!elementVertexData.Empty())
+        {
+            textureVertexData_.Resize(vertexStart + elementVertexData.Size());
+            memcpy(&textureVertexData_[vertexStart], &elementVertexData[0], elementVertexData.Size() * sizeof(float));
+        }
+        for (unsigned i = 0; i < elementBatches.Size(); ++i)
+        {
+            UIBatch batch = elementBatches[i];
+            batch.vertexData_ = &textureVertexData_;
+            batch.vertexStart_ += vertexStart;
+            batch.vertexEnd_ += vertexStart;
+            textureBatches_.Push(batch);
+        }
+
+        update.batchEnd_ = textureBatches_.Size();
+        textureCacheUpdates_.Push(update);
+    }
+
+    // The texture contains premultiplied alpha, and the element's opacity has already been applied to it
+    UIBatch batch(element, BLEND_PREMULALPHA, currentScissor, cache.texture_, &vertexData);
+    batch.SetColor(Color::WHITE, true);
+    batch.AddQuad(0, 0, size.x_, size.y_, 0, 0, size.x_, size.y_);
+    UIBatch::AddOrMerge(batch, batches);
+}
+
+void UI::UpdateHoverBatches()
+{
+    // Compare the hover states set for this frame to those the cached batches were generated with
+    Vector<WeakPtr<UIElement> > hoverElements;
+    for (HashMap<WeakPtr<UIElement>, bool>::ConstIterator i = hoveredElements_.Begin(); i != hoveredElements_.End(); ++i)
+    {
+        UIElement* element = i->first_;
+        if (element && element->IsHovering())
+        {
+            if (!hoverBatchElements_.Contains(i->first_))
+                element->MarkBatchesDirty(true);
+            hoverElements.Push(i->first_);
+        }
+    }
+
+    for (Vector<WeakPtr<UIElement> >::ConstIterator i = hoverBatchElements_.Begin(); i != hoverBatchElements_.End(); ++i)
+    {
+        if (*i && !hoverElements.Contains(*i))
+            (*i)->MarkBatchesDirty(true);
+    }
+
+    hoverBatchElements_ = hoverElements;
+}
+
+void UI::MarkVertexDataDirty(unsigned start, unsigned end)
+{
+    if (start < end)
+    {
+        if (start < vertexDirtyStart_)
+            vertexDirtyStart_ = start;
+        if (end > vertexDirtyEnd_)
+            vertexDirtyEnd_ = end;
+    }
+}
+
 void UI::GetElementAt(UIElement*& result, UIElement* current, const IntVector2& position, bool enabledOnly)
 {
     if (!current)
@@ -991,6 +1442,10 @@ void UI::ReleaseFontFaces()
 
     for (unsigned i = 0; i < fonts.Size(); ++i)
         fonts[i]->ReleaseFaces();
+
+    fontAtlas_->Reset();
+    textLayoutCache_->Clear();
+    ResetBatchCache();
 }
 
 void UI::ProcessHover(const IntVector2& cursorPos, int buttons, int qualifiers, Cursor* cursor)
@@ -1654,6 +2109,19 @@ void UI::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
     RenderUpdate();
 }
 
+void UI::HandleDeviceReset(StringHash eventType, VariantMap& eventData)
+{
+    // Lost font face textures will be recreated, so the cached batches must not refer to the old
+    ResetBatchCache();
+}
+
+void UI::HandleReloadStarted(StringHash eventType, VariantMap& eventData)
+{
+    Object* sender = GetEventSender();
+    if (sender && sender->GetType() == Font::GetTypeStatic())
+        ResetBatchCache();
+}
+
 void UI::HandleDropFile(StringHash eventType, VariantMap& eventData)
 {
     Input* input = GetSubsystem<Input>();
@@ -30,8 +30,10 @@ namespace Urho3D
 {
 
 class Cursor;
+class FontAtlas;
 class Graphics;
 class ResourceCache;
+class TextLayoutCache;
 class Timer;
 class UIBatch;
 class UIElement;
@@ -91,10 +93,18 @@ public:
     void SetUseSystemClipboard(bool enable);
     /// Set whether to show the on-screen keyboard (if supported) when a %LineEdit is focused. Default true on mobile devices.
     void SetUseScreenKeyboard(bool enable);
-    /// Set whether to use mutable (eraseable) glyphs to ensure a font face never expands to more than one texture. Default false.
+    /// Set whether to use mutable (eraseable) glyphs. These are rasterized on demand into a texture atlas shared by all fonts and sizes, whose least recently used page is recycled when it is full. Default false.
     void SetUseMutableGlyphs(bool enable);
+    /// Set maximum number of pages in the shared font atlas before pages are recycled. The page size is the maximum font texture size. Default 4.
+    void SetFontAtlasMaxPages(unsigned num);
+    /// Set maximum number of text layouts cached for reuse by text elements showing the same string with the same font, size, wrap width and row spacing. 0 disables. Default 256.
+    void SetTextLayoutCacheSize(unsigned size);
     /// Set whether to force font autohinting instead of using FreeType's TTF bytecode interpreter.
     void SetForceAutoHint(bool enable);
+    /// Set whether to cache rendering batches between frames. Each child of a depth-first traversal element (by default the root's children) caches the batches of its subtree, which are regenerated only when an element in it changes, and only the changed vertex data is uploaded. Default false.
+    void SetBatchCaching(bool enable);
+    /// Discard all cached rendering batches.
+    void ResetBatchCache();
 
     /// Return root UI element.
     UIElement* GetRoot() const { return rootElement_; }
@@ -138,8 +148,18 @@ public:
     bool GetUseScreenKeyboard() const { return useScreenKeyboard_; }
     /// Return whether is using mutable (eraseable) glyphs for fonts.
     bool GetUseMutableGlyphs() const { return useMutableGlyphs_; }
+    /// Return maximum number of pages in the shared font atlas.
+    unsigned GetFontAtlasMaxPages() const;
+    /// Return maximum number of cached text layouts.
+    unsigned GetTextLayoutCacheSize() const;
+    /// Return the font atlas shared by fonts using mutable glyphs.
+    FontAtlas* GetFontAtlas() const;
+    /// Return the text layout cache.
+    TextLayoutCache* GetTextLayoutCache() const;
     /// Return whether is using forced autohinting.
     bool GetForceAutoHint() const { return forceAutoHint_; }
+    /// Return whether rendering batches are cached between frames.
+    bool GetBatchCaching() const { return batchCaching_; }
     /// Return true when UI has modal element(s).
     bool HasModalElement() const;
     /// Return whether a drag is in progress.
@@ -163,16 +183,45 @@ public:
     };
 
 private:
+    /// UI element queued for rendering into its cache texture.
+    struct TextureCacheUpdate
+    {
+        /// Element.
+        WeakPtr<UIElement> element_;
+        /// Screen rectangle of the element.
+        IntRect rect_;
+        /// Start index of the element's batches.
+        unsigned batchStart_;
+        /// End index of the element's batches.
+        unsigned batchEnd_;
+    };
+
     /// Initialize when screen mode initially set.
     void Initialize();
     /// Update UI element logic recursively.
     void Update(float timeStep, UIElement* element);
-    /// Upload UI geometry into a vertex buffer.
-    void SetVertexData(VertexBuffer* dest, const PODVector<float>& vertexData);
+    /// Upload UI geometry into a vertex buffer. Optionally upload only a range of the vertex data, if the buffer does not need to be resized.
+    void SetVertexData(VertexBuffer* dest, const PODVector<float>& vertexData, unsigned dirtyStart = 0, unsigned dirtyEnd =
+        M_MAX_UNSIGNED);
     /// Render UI batches. Geometry must have been uploaded first.
     void Render(bool resetRenderTargets, VertexBuffer* buffer, const PODVector<UIBatch>& batches, unsigned batchStart, unsigned batchEnd);
     /// Generate batches from an UI element recursively. Skip the cursor element.
-    void GetBatches(UIElement* element, IntRect currentScissor);
+    void GetBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, IntRect currentScissor);
+    /// Generate batches from an UI element and its children, reusing the element's batch cache if valid.
+    void GetCachedBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, const IntRect&
+        currentScissor);
+    /// Generate batches from an UI element and its children, or from the element's cache texture if it uses texture caching.
+    void GetElementBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, const IntRect&
+        currentScissor);
+    /// Generate a batch drawing the cache texture of an UI element. Queue the element and its children for rendering into the texture if dirty.
+    void GetTextureCacheBatches(PODVector<UIBatch>& batches, PODVector<float>& vertexData, UIElement* element, const IntRect&
+        currentScissor);
+    /// Render the queued UI elements into their cache textures.
+    void RenderTextureCaches();
+    /// Mark the batch caches of elements whose hover state has changed since they were rendered.
+    void UpdateHoverBatches();
+    /// Mark a range of the UI vertex data as needing upload.
+    void MarkVertexDataDirty(unsigned start, unsigned end);
     /// Return UI element at screen position recursively.
     void GetElementAt(UIElement*& result, UIElement* current, const IntVector2& position, bool enabledOnly);
     /// Return the first element in hierarchy that can alter focus.
@@ -223,6 +272,10 @@ private:
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle a file being drag-dropped into the application window.
     void HandleDropFile(StringHash eventType, VariantMap& eventData);
+    /// Handle graphics device reset event.
+    void HandleDeviceReset(StringHash eventType, VariantMap& eventData);
+    /// Handle resource reload started event.
+    void HandleReloadStarted(StringHash eventType, VariantMap& eventData);
     /// Remove drag data and return next iterator.
     HashMap<WeakPtr<UIElement>, DragData*>::Iterator DragElementErase(HashMap<WeakPtr<UIElement>, DragData*>::Iterator dragElement);
     /// Handle clean up on a drag cancel.
@@ -238,6 +291,10 @@ private:
     SharedPtr<UIElement> rootModalElement_;
     /// Cursor.
     SharedPtr<Cursor> cursor_;
+    /// Font atlas shared by fonts using mutable glyphs.
+    SharedPtr<FontAtlas> fontAtlas_;
+    /// Text layout cache.
+    SharedPtr<TextLayoutCache> textLayoutCache_;
     /// Currently focused element.
     WeakPtr<UIElement> focusElement_;
     /// UI rendering batches.
@@ -252,6 +309,14 @@ private:
     SharedPtr<VertexBuffer> vertexBuffer_;
     /// UI debug geometry vertex buffer.
     SharedPtr<VertexBuffer> debugVertexBuffer_;
+    /// UI rendering batches for cache textures.
+    PODVector<UIBatch> textureBatches_;
+    /// UI rendering vertex data for cache textures.
+    PODVector<float> textureVertexData_;
+    /// Cache texture vertex buffer.
+    SharedPtr<VertexBuffer> textureVertexBuffer_;
+    /// Elements queued for rendering into their cache textures, with their batch ranges.
+    Vector<TextureCacheUpdate> textureCacheUpdates_;
     /// UI element query vector.
     PODVector<UIElement*> tempElements_;
     /// Clipboard text.
@@ -288,8 +353,20 @@ private:
     bool forceAutoHint_;
     /// Flag for UI already being rendered this frame.
     bool uiRendered_;
+    /// Flag for caching rendering batches between frames.
+    bool batchCaching_;
     /// Non-modal batch size (used internally for rendering).
     unsigned nonModalBatchSize_;
+    /// Batch generation frame number, used to detect reusable vertex data.
+    unsigned batchFrameNumber_;
+    /// Start of vertex data not yet uploaded.
+    unsigned vertexDirtyStart_;
+    /// End of vertex data not yet uploaded.
+    unsigned vertexDirtyEnd_;
+    /// End of vertex data checked for upload during batch generation.
+    unsigned vertexCheckedEnd_;
+    /// Elements that were hovering when their batches were generated.
+    Vector<WeakPtr<UIElement> > hoverBatchElements_;
     /// Timer used to trigger double click.
     Timer clickTimer_;
     /// UI element last clicked for tracking double clicks.
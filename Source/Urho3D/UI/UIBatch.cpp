@@ -23,7 +23,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Math/Matrix3x4.h"
 #include "../Graphics/ShaderVariation.h"
-#include "../Graphics/Texture.h"
+#include "../Graphics/Texture2D.h"
 #include "../UI/UIElement.h"
 
 #include "../DebugNew.h"
@@ -293,4 +293,16 @@ void UIBatch::AddOrMerge(const UIBatch& batch, PODVector<UIBatch>& batches)
     batches.Push(batch);
 }
 
+UIBatchCache::UIBatchCache() :
+    vertexOffset_(0),
+    frameNumber_(0),
+    dirty_(true),
+    textureDirty_(true)
+{
+}
+
+UIBatchCache::~UIBatchCache()
+{
+}
+
 }
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Math/Color.h"
+#include "../Container/Ptr.h"
 #include "../Graphics/GraphicsDefs.h"
 #include "../Math/Rect.h"
 
@@ -33,6 +34,7 @@ class PixelShader;
 class Graphics;
 class Matrix3x4;
 class Texture;
+class Texture2D;
 class UIElement;
 
 static const unsigned UI_VERTEX_SIZE = 6;
@@ -89,4 +91,30 @@ public:
     static Vector3 posAdjust;
 };
 
+/// Cached %UI rendering batches of an element and its children.
+struct URHO3D_API UIBatchCache
+{
+    /// Construct.
+    UIBatchCache();
+    /// Destruct.
+    ~UIBatchCache();
+
+    /// Batches with vertex ranges relative to the cached vertex data.
+    PODVector<UIBatch> batches_;
+    /// Vertex data.
+    PODVector<float> vertexData_;
+    /// Scissor rectangle the batches were generated with.
+    IntRect scissor_;
+    /// Start of the vertex data in the UI vertex buffer on the frame it was last drawn.
+    unsigned vertexOffset_;
+    /// Frame number the batches were last drawn on.
+    unsigned frameNumber_;
+    /// Render target texture the element and its children are rendered into, when texture caching is enabled.
+    SharedPtr<Texture2D> texture_;
+    /// Dirty flag.
+    bool dirty_;
+    /// Render target texture dirty flag.
+    bool textureDirty_;
+};
+
 }
@@ -28,6 +28,7 @@
 #include "../Scene/ObjectAnimation.h"
 #include "../Resource/ResourceCache.h"
 #include "../Container/Sort.h"
+#include "../Graphics/Texture2D.h"
 #include "../UI/UI.h"
 #include "../UI/UIElement.h"
 #include "../UI/UIEvents.h"
@@ -98,6 +99,7 @@ UIElement::UIElement(Context* context) :
     clipChildren_(false),
     sortChildren_(true),
     useDerivedOpacity_(true),
+    textureCaching_(false),
     editable_(true),
     selected_(false),
     visible_(true),
@@ -173,6 +175,7 @@ void UIElement::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Bring To Back", GetBringToBack, SetBringToBack, bool, true, AM_FILE);
     ACCESSOR_ATTRIBUTE("Clip Children", GetClipChildren, SetClipChildren, bool, false, AM_FILE);
     ACCESSOR_ATTRIBUTE("Use Derived Opacity", GetUseDerivedOpacity, SetUseDerivedOpacity, bool, true, AM_FILE);
+    ACCESSOR_ATTRIBUTE("Texture Caching", GetTextureCaching, SetTextureCaching, bool, false, AM_FILE);
     ENUM_ACCESSOR_ATTRIBUTE("Focus Mode", GetFocusMode, SetFocusMode, FocusMode, focusModes, FM_NOTFOCUSABLE, AM_FILE);
     ENUM_ACCESSOR_ATTRIBUTE("Drag And Drop Mode", GetDragDropMode, SetDragDropMode, unsigned, dragDropModes, DD_DISABLED, AM_FILE);
     ENUM_ACCESSOR_ATTRIBUTE("Layout Mode", GetLayoutMode, SetLayoutMode, LayoutMode, layoutModes, LM_FREE, AM_FILE);
@@ -618,6 +621,7 @@ void UIElement::SetSize(const IntVector2& size)
     if (validatedSize != size_)
     {
         size_ = validatedSize;
+        MarkBatchesDirty();
 
         if (resizeNestingLevel_ == 1)
         {
@@ -766,6 +770,7 @@ void UIElement::SetClipBorder(const IntRect& rect)
     clipBorder_.top_ = Max(rect.top_, 0);
     clipBorder_.right_ = Max(rect.right_, 0);
     clipBorder_.bottom_ = Max(rect.bottom_, 0);
+    MarkBatchesDirty();
 }
 
 void UIElement::SetColor(const Color& color)
@@ -774,6 +779,7 @@ void UIElement::SetColor(const Color& color)
         color_[i] = color;
     colorGradient_ = false;
     derivedColorDirty_ = true;
+    MarkBatchesDirty();
 }
 
 void UIElement::SetColor(Corner corner, const Color& color)
@@ -781,6 +787,7 @@ void UIElement::SetColor(Corner corner, const Color& color)
     color_[corner] = color;
     colorGradient_ = false;
     derivedColorDirty_ = true;
+    MarkBatchesDirty();
 
     for (unsigned i = 0; i < MAX_UIELEMENT_CORNERS; ++i)
     {
@@ -794,6 +801,7 @@ void UIElement::SetPriority(int priority)
     priority_ = priority;
     if (parent_)
         parent_->sortOrderDirty_ = true;
+    MarkBatchesDirty();
 }
 
 void UIElement::SetOpacity(float opacity)
@@ -815,6 +823,7 @@ void UIElement::SetBringToBack(bool enable)
 void UIElement::SetClipChildren(bool enable)
 {
     clipChildren_ = enable;
+    MarkBatchesDirty();
 }
 
 void UIElement::SetSortChildren(bool enable)
@@ -823,11 +832,24 @@ void UIElement::SetSortChildren(bool enable)
         sortOrderDirty_ = true;
 
     sortChildren_ = enable;
+    MarkBatchesDirty();
 }
 
 void UIElement::SetUseDerivedOpacity(bool enable)
 {
     useDerivedOpacity_ = enable;
+    MarkDirty();
+}
+
+void UIElement::SetTextureCaching(bool enable)
+{
+    if (enable != textureCaching_)
+    {
+        textureCaching_ = enable;
+        if (!enable)
+            batchCache_.texture_.Reset();
+        MarkBatchesDirty();
+    }
 }
 
 void UIElement::SetEnabled(bool enable)
@@ -892,7 +914,11 @@ void UIElement::SetFocus(bool enable)
 
 void UIElement::SetSelected(bool enable)
 {
-    selected_ = enable;
+    if (enable != selected_)
+    {
+        selected_ = enable;
+        MarkBatchesDirty();
+    }
 }
 
 void UIElement::SetVisible(bool enable)
@@ -900,6 +926,7 @@ void UIElement::SetVisible(bool enable)
     if (enable != visible_)
     {
         visible_ = enable;
+        MarkBatchesDirty();
 
         // Parent's layout may change as a result of visibility change
         if (parent_)
@@ -999,6 +1026,7 @@ void UIElement::SetLayoutFlexScale(const Vector2& scale)
 void UIElement::SetIndent(int indent)
 {
     indent_ = indent;
+    MarkBatchesDirty();
     if (parent_)
         parent_->UpdateLayout();
     UpdateLayout();
@@ -1008,6 +1036,7 @@ void UIElement::SetIndent(int indent)
 void UIElement::SetIndentSpacing(int indentSpacing)
 {
     indentSpacing_ = Max(indentSpacing, 0);
+    MarkBatchesDirty();
     if (parent_)
         parent_->UpdateLayout();
     UpdateLayout();
@@ -1238,6 +1267,7 @@ void UIElement::InsertChild(unsigned index, UIElement* element)
 
     element->parent_ = this;
     element->MarkDirty();
+    MarkBatchesDirty();
 
     // If child element did not already have a style file, but has specified a style name, apply it now
     if (!previousStyleFile && !element->appliedStyle_.Empty() && GetDefaultStyle())
@@ -1284,6 +1314,7 @@ void UIElement::RemoveChild(UIElement* element, unsigned index)
 
             element->Detach();
             children_.Erase(i);
+            MarkBatchesDirty();
             UpdateLayout();
             return;
         }
@@ -1311,6 +1342,7 @@ void UIElement::RemoveChildAtIndex(unsigned index)
 
     children_[index]->Detach();
     children_.Erase(index);
+    MarkBatchesDirty();
     UpdateLayout();
 }
 
@@ -1337,6 +1369,7 @@ void UIElement::RemoveAllChildren()
         (*i++)->Detach();
     }
     children_.Clear();
+    MarkBatchesDirty();
     UpdateLayout();
 }
 
@@ -1371,6 +1404,7 @@ void UIElement::SetInternal(bool enable)
 void UIElement::SetTraversalMode(TraversalMode traversalMode)
 {
     traversalMode_ = traversalMode;
+    MarkBatchesDirty(true);
 }
 
 void UIElement::SetElementEventSender(bool flag)
@@ -1607,6 +1641,24 @@ void UIElement::SetHovering(bool enable)
     hovering_ = enable;
 }
 
+void UIElement::MarkBatchesDirty(bool recursive)
+{
+    if (recursive)
+    {
+        for (Vector<SharedPtr<UIElement> >::ConstIterator i = children_.Begin(); i != children_.End(); ++i)
+            (*i)->MarkBatchesDirty(true);
+    }
+
+    // Flag all the parents, as any of them may hold the element's batches in its cache
+    UIElement* element = this;
+    while (element)
+    {
+        element->batchCache_.dirty_ = true;
+        element->batchCache_.textureDirty_ = true;
+        element = element->parent_;
+    }
+}
+
 void UIElement::AdjustScissor(IntRect& currentScissor)
 {
     if (clipChildren_)
@@ -1710,6 +1762,7 @@ void UIElement::MarkDirty()
     positionDirty_ = true;
     opacityDirty_ = true;
     derivedColorDirty_ = true;
+    MarkBatchesDirty();
 
     for (Vector<SharedPtr<UIElement> >::ConstIterator i = children_.Begin(); i != children_.End(); ++i)
         (*i)->MarkDirty();
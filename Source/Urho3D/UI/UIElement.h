@@ -249,6 +249,8 @@ public:
     void SetSortChildren(bool enable);
     /// Set whether parent elements' opacity affects opacity. Default true.
     void SetUseDerivedOpacity(bool enable);
+    /// Set whether to render the element and its children into a texture when changed, and draw that texture afterward. Default false.
+    void SetTextureCaching(bool enable);
     /// Set whether reacts to input. Default false, but is enabled by subclasses if applicable.
     void SetEnabled(bool enable);
     /// Set enabled state on self and child elements. Elements' own enabled state is remembered (IsEnabledSelf) and can be restored.
@@ -383,6 +385,8 @@ public:
     bool GetSortChildren() const { return sortChildren_; }
     /// Return whether parent elements' opacity affects opacity.
     bool GetUseDerivedOpacity() const { return useDerivedOpacity_; }
+    /// Return whether the element and its children are rendered into a texture.
+    bool GetTextureCaching() const { return textureCaching_; }
     /// Return whether has focus.
     bool HasFocus() const;
     /// Return whether reacts to input.
@@ -475,6 +479,10 @@ public:
     /// Get UI rendering batches with a specified offset. Also recurses to child elements.
     void GetBatchesWithOffset(IntVector2& offset, PODVector<UIBatch>& batches, PODVector<float>& vertexData, IntRect
         currentScissor);
+    /// Mark cached rendering batches dirty, so that they are rebuilt when the UI uses batch caching. Also marks the parent elements, and optionally the child elements recursively. Can be called from GetBatches() to never cache the element.
+    void MarkBatchesDirty(bool recursive = false);
+    /// Return cached rendering batches. Used internally by UI.
+    UIBatchCache& GetBatchCache() { return batchCache_; }
     /// Return color attribute. Uses just the top-left color.
     const Color& GetColorAttr() const { return color_[0]; }
     /// Return traversal mode for rendering.
@@ -526,6 +534,8 @@ protected:
     bool sortChildren_;
     /// Use derived opacity flag.
     bool useDerivedOpacity_;
+    /// Texture caching flag.
+    bool textureCaching_;
     /// Input enabled flag.
     bool enabled_;
     /// Last SetEnabled flag before any SetDeepEnabled.
@@ -625,6 +635,8 @@ private:
     TraversalMode traversalMode_;
     /// Flag whether node should send child added / removed events by itself.
     bool elementEventSender_;
+    /// Cached rendering batches.
+    UIBatchCache batchCache_;
     /// XPath query for selecting UI-style.
     static XPathQuery styleXPathQuery_;
 };
@@ -260,6 +260,14 @@ EVENT(E_ITEMDOUBLECLICKED, ItemDoubleClicked)
     PARAM(P_QUALIFIERS, Qualifiers);        // int
 }
 
+/// Virtual mode ListView row element needs its contents updated to show an item.
+EVENT(E_VIRTUALITEMUPDATE, VirtualItemUpdate)
+{
+    PARAM(P_ELEMENT, Element);              // UIElement pointer
+    PARAM(P_ITEM, Item);                    // UIElement pointer
+    PARAM(P_SELECTION, Selection);          // int
+}
+
 /// LineEdit or ListView unhandled key pressed.
 EVENT(E_UNHANDLEDKEY, UnhandledKey)
 {
@@ -376,4 +384,9 @@ EVENT(E_UIDROPFILE, UIDropFile)
     PARAM(P_ELEMENTY, ElementY);            // int (only if element is non-null)
 }
 
+/// Pages of the shared font atlas were recycled or discarded. Text rendered from mutable glyphs must reacquire them
+EVENT(E_FONTATLASEVICTED, FontAtlasEvicted)
+{
+}
+
 }
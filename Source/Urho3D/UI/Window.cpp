@@ -273,6 +273,7 @@ void Window::SetModal(bool modal)
     if (GetSubsystem<UI>()->SetModalElement(this, modal))
     {
         modal_ = modal;
+        MarkBatchesDirty();
 
         using namespace ModalChanged;
 
@@ -286,16 +287,19 @@ void Window::SetModal(bool modal)
 void Window::SetModalShadeColor(const Color& color)
 {
     modalShadeColor_ = color;
+    MarkBatchesDirty();
 }
 
 void Window::SetModalFrameColor(const Color& color)
 {
     modalFrameColor_ = color;
+    MarkBatchesDirty();
 }
 
 void Window::SetModalFrameSize(const IntVector2& size)
 {
     modalFrameSize_ = size;
+    MarkBatchesDirty();
 }
 
 void Window::SetModalAutoDismiss(bool enable)
@@ -360,58 +360,14 @@ void AnimatedSprite2D::UpdateAnimation(float timeStep)
     else
         time = Clamp(currentTime_, 0.0f, animationLength);
 
-    for (unsigned i = 0; i < numTracks_; ++i)
+    if (animation_->IsBaked())
+        SampleBakedFrames(time);
+    else
     {
-        trackNodeInfos_[i].worldSpace = false;
-        
-        const AnimationTrack2D& track = animation_->GetTrack(i);
-        const Vector<AnimationKeyFrame2D>& keyFrames = track.keyFrames_;
-
-        // Time out of range
-        if (time < keyFrames[0].time_ || time > keyFrames.Back().time_)
-            trackNodeInfos_[i].value.enabled_ = false;
-        else
+        for (unsigned i = 0; i < numTracks_; ++i)
         {
-            unsigned index = keyFrames.Size() - 1;
-            for (unsigned j = 0; j < keyFrames.Size() - 1; ++j)
-            {
-                if (time <= keyFrames[j + 1].time_)
-                {
-                    index = j;
-                    break;
-                }
-            }
-
-            const AnimationKeyFrame2D& currKey = keyFrames[index];
-            AnimationKeyFrame2D& value = trackNodeInfos_[i].value;
-
-            value.enabled_ = currKey.enabled_;
-            value.parent_ = currKey.parent_;
-
-            if (index < keyFrames.Size() - 1)
-            {
-                const AnimationKeyFrame2D& nextKey = keyFrames[index + 1];
-                float t = (time - currKey.time_)  / (nextKey.time_ - currKey.time_);
-                value.transform_ = currKey.transform_.Lerp(nextKey.transform_, t, currKey.spin_);
-
-                if (trackNodeInfos_[i].hasSprite)
-                    value.alpha_ = Urho3D::Lerp(currKey.alpha_, nextKey.alpha_, t);
-            }
-            else
-            {
-                value.transform_ = currKey.transform_;
-
-                if (trackNodeInfos_[i].hasSprite)
-                    value.alpha_ = currKey.alpha_;
-            }
-
-            if (trackNodeInfos_[i].hasSprite)
-            {
-                value.zIndex_ = currKey.zIndex_;
-                value.sprite_ = currKey.sprite_;
-                value.useHotSpot_ = currKey.useHotSpot_;
-                value.hotSpot_ = currKey.hotSpot_;
-            }
+            trackNodeInfos_[i].worldSpace = false;
+            animation_->GetTrack(i).Sample(time, trackNodeInfos_[i].value);
         }
     }
 
@@ -462,6 +418,36 @@ void AnimatedSprite2D::UpdateAnimation(float timeStep)
     }
 }
 
+void AnimatedSprite2D::SampleBakedFrames(float time)
+{
+    float frame = time * animation_->GetBakedFrameRate();
+    int lastIndex = (int)animation_->GetNumBakedFrames() - 1;
+    int index = Clamp((int)frame, 0, lastIndex);
+    int nextIndex = Min(index + 1, lastIndex);
+    float t = Clamp(frame - (float)index, 0.0f, 1.0f);
+
+    const AnimationKeyFrame2D* currFrame = animation_->GetBakedFrame(index);
+    const AnimationKeyFrame2D* nextFrame = animation_->GetBakedFrame(nextIndex);
+
+    for (unsigned i = 0; i < numTracks_; ++i)
+    {
+        TrackNodeInfo& info = trackNodeInfos_[i];
+        const AnimationKeyFrame2D& currKey = currFrame[i];
+        const AnimationKeyFrame2D& nextKey = nextFrame[i];
+
+        // Baked values are already in root space
+        info.worldSpace = true;
+        info.value = currKey;
+
+        if (currKey.enabled_ && nextKey.enabled_ && t > 0.0f)
+        {
+            info.value.transform_ = currKey.transform_.Lerp(nextKey.transform_, t, 0);
+            if (info.hasSprite)
+                info.value.alpha_ = Urho3D::Lerp(currKey.alpha_, nextKey.alpha_, t);
+        }
+    }
+}
+
 void AnimatedSprite2D::CalculateTimelineWorldTransform(unsigned index)
 {
     TrackNodeInfo& info = trackNodeInfos_[index];
@@ -101,6 +101,8 @@ protected:
     void SetAnimation(Animation2D* animation, LoopMode2D loopMode);
     /// Update animation.
     void UpdateAnimation(float timeStep);
+    /// Interpolate the root space track values from the baked frames of the animation.
+    void SampleBakedFrames(float time);
     /// Calculate time line world world transform.
     void CalculateTimelineWorldTransform(unsigned index);
     /// Handle scene post update.
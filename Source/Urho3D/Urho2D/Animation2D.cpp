@@ -104,10 +104,78 @@ AnimationKeyFrame2D::AnimationKeyFrame2D() :
 {
 }
 
+void AnimationTrack2D::Sample(float time, AnimationKeyFrame2D& value) const
+{
+    // Time out of range
+    if (keyFrames_.Empty() || time < keyFrames_[0].time_ || time > keyFrames_.Back().time_)
+    {
+        value.enabled_ = false;
+        return;
+    }
+
+    unsigned index = keyFrames_.Size() - 1;
+    for (unsigned j = 0; j < keyFrames_.Size() - 1; ++j)
+    {
+        if (time <= keyFrames_[j + 1].time_)
+        {
+            index = j;
+            break;
+        }
+    }
+
+    const AnimationKeyFrame2D& currKey = keyFrames_[index];
+
+    value.enabled_ = currKey.enabled_;
+    value.parent_ = currKey.parent_;
+
+    if (index < keyFrames_.Size() - 1)
+    {
+        const AnimationKeyFrame2D& nextKey = keyFrames_[index + 1];
+        float t = (time - currKey.time_)  / (nextKey.time_ - currKey.time_);
+        value.transform_ = currKey.transform_.Lerp(nextKey.transform_, t, currKey.spin_);
+
+        if (hasSprite_)
+            value.alpha_ = Urho3D::Lerp(currKey.alpha_, nextKey.alpha_, t);
+    }
+    else
+    {
+        value.transform_ = currKey.transform_;
+
+        if (hasSprite_)
+            value.alpha_ = currKey.alpha_;
+    }
+
+    if (hasSprite_)
+    {
+        value.zIndex_ = currKey.zIndex_;
+        value.sprite_ = currKey.sprite_;
+        value.useHotSpot_ = currKey.useHotSpot_;
+        value.hotSpot_ = currKey.hotSpot_;
+    }
+}
+
+/// Transform a sampled track value to root space, transforming its parents first.
+static void CalculateRootTransform(Vector<AnimationKeyFrame2D>& values, PODVector<bool>& rootSpace, unsigned index)
+{
+    if (rootSpace[index])
+        return;
+
+    rootSpace[index] = true;
+
+    int parent = values[index].parent_;
+    if (parent != -1)
+    {
+        CalculateRootTransform(values, rootSpace, parent);
+        values[index].transform_ = values[parent].transform_ * values[index].transform_;
+    }
+}
+
 Animation2D::Animation2D(AnimationSet2D* animationSet) : 
     animationSet_(animationSet),
     length_(0.0f), 
-    looped_(true)
+    looped_(true),
+    bakedFrameRate_(0.0f),
+    numBakedFrames_(0)
 {
 }
 
@@ -130,6 +198,58 @@ void Animation2D::SetLooped(bool looped)
     looped_ = looped;
 }
 
+void Animation2D::Bake(float frameRate)
+{
+    bakedFrames_.Clear();
+    bakedFrameRate_ = 0.0f;
+    numBakedFrames_ = 0;
+
+    unsigned numTracks = tracks_.Size();
+    if (frameRate <= 0.0f || !numTracks)
+        return;
+
+    bakedFrameRate_ = frameRate;
+    numBakedFrames_ = (unsigned)ceilf(length_ * frameRate) + 1;
+    bakedFrames_.Resize(numBakedFrames_ * numTracks);
+
+    // Sample the frames in order like continuous playback does, so that tracks out of their key frame range keep their
+    // previous values
+    Vector<AnimationKeyFrame2D> values(numTracks);
+    PODVector<bool> rootSpace(numTracks);
+    for (unsigned i = 0; i < numBakedFrames_; ++i)
+    {
+        float time = Min((float)i / frameRate, length_);
+        for (unsigned j = 0; j < numTracks; ++j)
+        {
+            tracks_[j].Sample(time, values[j]);
+            rootSpace[j] = false;
+        }
+
+        AnimationKeyFrame2D* frame = &bakedFrames_[i * numTracks];
+        for (unsigned j = 0; j < numTracks; ++j)
+        {
+            if (values[j].enabled_)
+                CalculateRootTransform(values, rootSpace, j);
+
+            AnimationKeyFrame2D& value = frame[j];
+            value = values[j];
+            value.time_ = time;
+            value.parent_ = -1;
+
+            // Unwind the angle to the nearest turn of the previous frame, so that interpolating between frames takes the
+            // shortest path
+            if (i > 0)
+            {
+                float prevAngle = bakedFrames_[(i - 1) * numTracks + j].transform_.angle_;
+                while (value.transform_.angle_ - prevAngle > 180.0f)
+                    value.transform_.angle_ -= 360.0f;
+                while (value.transform_.angle_ - prevAngle < -180.0f)
+                    value.transform_.angle_ += 360.0f;
+            }
+        }
+    }
+}
+
 AnimationSet2D* Animation2D::GetAnimationSet() const
 {
     return animationSet_;
@@ -146,4 +266,9 @@ const AnimationTrack2D& Animation2D::GetTrack(unsigned index) const
     return tracks_[index];
 }
 
+const AnimationKeyFrame2D* Animation2D::GetBakedFrame(unsigned index) const
+{
+    return index < numBakedFrames_ ? &bakedFrames_[index * tracks_.Size()] : 0;
+}
+
 }
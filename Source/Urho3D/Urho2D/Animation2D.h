@@ -96,6 +96,9 @@ struct AnimationTrack2D
     bool hasSprite_;
     /// Animation key frames.
     Vector<AnimationKeyFrame2D> keyFrames_;
+
+    /// Sample the key frames at time into value in parent space. If time is out of the key frame range, only disable the value.
+    void Sample(float time, AnimationKeyFrame2D& value) const;
 };
 
 /// 2D Animation.
@@ -113,6 +116,8 @@ public:
     void SetLength(float length);
     /// Set looped.
     void SetLooped(bool looped);
+    /// Bake the track values in root space at the frame rate, so that playback is a table lookup and interpolation between frames. Zero frame rate removes the baked frames.
+    void Bake(float frameRate);
     
     /// Return animation set.
     AnimationSet2D* GetAnimationSet() const;
@@ -126,6 +131,14 @@ public:
     unsigned GetNumTracks() const { return tracks_.Size(); }
     /// Return animation track.
     const AnimationTrack2D& GetTrack(unsigned index) const;
+    /// Return whether has baked frames.
+    bool IsBaked() const { return numBakedFrames_ > 0; }
+    /// Return baked frame rate.
+    float GetBakedFrameRate() const { return bakedFrameRate_; }
+    /// Return number of baked frames.
+    unsigned GetNumBakedFrames() const { return numBakedFrames_; }
+    /// Return root space track values of a baked frame, one per track, or null if out of range.
+    const AnimationKeyFrame2D* GetBakedFrame(unsigned index) const;
 
     /// Return all animation tracks (internal use only).
     Vector<AnimationTrack2D>& GetAllTracks() { return tracks_; }
@@ -141,6 +154,12 @@ private:
     bool looped_;
     /// Animation tracks.
     Vector<AnimationTrack2D> tracks_;
+    /// Baked frame rate.
+    float bakedFrameRate_;
+    /// Number of baked frames.
+    unsigned numBakedFrames_;
+    /// Baked track values, frame by frame.
+    Vector<AnimationKeyFrame2D> bakedFrames_;
 };
 
 }
@@ -93,6 +93,12 @@ Animation2D* AnimationSet2D::GetAnimation(const String& name) const
     return 0;
 }
 
+void AnimationSet2D::Bake(float frameRate)
+{
+    for (unsigned i = 0; i < animations_.Size(); ++i)
+        animations_[i]->Bake(frameRate);
+}
+
 Sprite2D* AnimationSet2D::GetSprite(const StringHash& hash) const
 {
     HashMap<StringHash, SharedPtr<Sprite2D> >::ConstIterator i = sprites_.Find(hash);
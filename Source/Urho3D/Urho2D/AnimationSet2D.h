@@ -56,6 +56,8 @@ public:
     Animation2D* GetAnimation(unsigned index) const;
     /// Return animation by name.
     Animation2D* GetAnimation(const String& name) const;
+    /// Bake all animations at the frame rate, to be shared by all animated sprites playing them. Zero frame rate removes the baked frames.
+    void Bake(float frameRate);
 
 private:
     /// Return sprite by hash.
@@ -35,7 +35,12 @@ namespace Urho3D
 
 const float PIXEL_SIZE = 0.01f;
 
-SourceBatch2D::SourceBatch2D() : drawOrder_(0)
+/// Last assigned source batch vertices version.
+static unsigned lastSourceBatchVersion = 0;
+
+SourceBatch2D::SourceBatch2D() :
+    drawOrder_(0),
+    version_(0)
 {
 }
 
@@ -94,8 +99,14 @@ void Drawable2D::SetOrderInLayer(int orderInLayer)
 const Vector<SourceBatch2D>& Drawable2D::GetSourceBatches()
 {
     if (sourceBatchesDirty_)
+    {
         UpdateSourceBatches();
 
+        // Stamp the regenerated batches, so that Renderer2D only rewrites their vertex ranges
+        for (unsigned i = 0; i < sourceBatches_.Size(); ++i)
+            sourceBatches_[i].version_ = ++lastSourceBatchVersion;
+    }
+
     return sourceBatches_;
 }
 
@@ -55,6 +55,8 @@ struct SourceBatch2D
     SharedPtr<Material> material_;
     /// Vertices.
     Vector<Vertex2D> vertices_;
+    /// Vertices version, unique across all source batches and changed whenever the vertices are regenerated.
+    unsigned version_;
 };
 
 /// Pixel size (equal 0.01f).
@@ -88,6 +90,8 @@ public:
 
     /// Return all source batches (called by Renderer2D).
     const Vector<SourceBatch2D>& GetSourceBatches();
+    /// Handle texture atlas being enabled, disabled or reset (called by Renderer2D).
+    virtual void OnTextureAtlasChanged() {}
 
 protected:
     /// Handle node being assigned.
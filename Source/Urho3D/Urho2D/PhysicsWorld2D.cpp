@@ -28,6 +28,7 @@
 #include "../Urho2D/PhysicsUtils2D.h"
 #include "../Urho2D/PhysicsWorld2D.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Renderer.h"
 #include "../Urho2D/RigidBody2D.h"
 #include "../Scene/Scene.h"
@@ -44,6 +45,29 @@ static const Vector2 DEFAULT_GRAVITY(0.0f, -9.81f);
 static const int DEFAULT_VELOCITY_ITERATIONS = 8;
 static const int DEFAULT_POSITION_ITERATIONS = 3;
 
+/// Solves a range of Box2D islands. Used with WorkQueue::ParallelFor().
+struct IslandTaskProcessor
+{
+    /// Construct.
+    IslandTaskProcessor(b2TaskFunction task, void* data) :
+        task_(task),
+        data_(data)
+    {
+    }
+
+    /// Solve a range of islands.
+    void operator () (int* start, int* end, unsigned threadIndex)
+    {
+        for (int* i = start; i < end; ++i)
+            task_(data_, *i, threadIndex);
+    }
+
+    /// Box2D task function.
+    b2TaskFunction task_;
+    /// Box2D task data.
+    void* data_;
+};
+
 PhysicsWorld2D::PhysicsWorld2D(Context* context) :
     Component(context),
     world_(0),
@@ -52,7 +76,8 @@ PhysicsWorld2D::PhysicsWorld2D(Context* context) :
     positionIterations_(DEFAULT_POSITION_ITERATIONS),
     debugRenderer_(0),
     physicsSteping_(false),
-    applyingTransforms_(false)
+    applyingTransforms_(false),
+    parallelSimulation_(false)
 {
     // Set default debug draw flags
     m_drawFlags = e_shapeBit;
@@ -95,6 +120,7 @@ void PhysicsWorld2D::RegisterObject(Context* context)
     ACCESSOR_ATTRIBUTE("Auto Clear Forces", GetAutoClearForces, SetAutoClearForces, bool, false, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Velocity Iterations", GetVelocityIterations, SetVelocityIterations, int, DEFAULT_VELOCITY_ITERATIONS, AM_DEFAULT);
     ACCESSOR_ATTRIBUTE("Position Iterations", GetPositionIterations, SetPositionIterations, int, DEFAULT_POSITION_ITERATIONS, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Parallel Simulation", GetParallelSimulation, SetParallelSimulation, bool, false, AM_DEFAULT);
 }
 
 void PhysicsWorld2D::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -221,6 +247,28 @@ void PhysicsWorld2D::DrawTransform(const b2Transform& xf)
     debugRenderer_->AddLine(Vector3(p1.x, p1.y, 0.0f), Vector3(p2.x, p2.y, 0.0f), Color::GREEN, debugDepthTest_);
 }
 
+int32 PhysicsWorld2D::GetNumThreads()
+{
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    return queue ? (int32)queue->GetNumThreads() + 1 : 1;
+}
+
+void PhysicsWorld2D::Run(b2TaskFunction task, void* data, int32 count)
+{
+    PROFILE(SolveIslands2D);
+
+    if ((int)taskIndices_.Size() < count)
+    {
+        unsigned oldSize = taskIndices_.Size();
+        taskIndices_.Resize(count);
+        for (unsigned i = oldSize; i < taskIndices_.Size(); ++i)
+            taskIndices_[i] = i;
+    }
+
+    IslandTaskProcessor processor(task, data);
+    GetSubsystem<WorkQueue>()->ParallelFor(&taskIndices_[0], &taskIndices_[0] + count, 1, processor);
+}
+
 void PhysicsWorld2D::Update(float timeStep)
 {
     using namespace PhysicsPreStep2D;
@@ -334,6 +382,13 @@ void PhysicsWorld2D::SetPositionIterations(int positionIterations)
     positionIterations_ = positionIterations;
 }
 
+void PhysicsWorld2D::SetParallelSimulation(bool enable)
+{
+    parallelSimulation_ = enable;
+
+    world_->SetTaskExecutor(enable ? this : 0);
+}
+
 void PhysicsWorld2D::AddRigidBody(RigidBody2D* rigidBody)
 {
     if (!rigidBody)
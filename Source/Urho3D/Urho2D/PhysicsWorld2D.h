@@ -53,7 +53,7 @@ struct URHO3D_API PhysicsRaycastResult2D
 };
 
 /// 2D physics simulation world component. Should be added only to the root scene node.
-class URHO3D_API PhysicsWorld2D : public Component, public b2ContactListener, public b2Draw
+class URHO3D_API PhysicsWorld2D : public Component, public b2ContactListener, public b2Draw, public b2TaskExecutor
 {
     OBJECT(PhysicsWorld2D);
 
@@ -88,6 +88,12 @@ public:
     /// Draw a transform. Choose your own length scale.
     virtual void DrawTransform(const b2Transform& xf);
 
+    // Implement b2TaskExecutor.
+    /// Return the number of threads for solving islands, including the main thread.
+    virtual int32 GetNumThreads();
+    /// Solve islands in parallel using the work queue.
+    virtual void Run(b2TaskFunction task, void* data, int32 count);
+
     /// Step the simulation forward.
     void Update(float timeStep);
     /// Add debug geometry to the debug renderer.
@@ -118,6 +124,8 @@ public:
     void SetVelocityIterations(int velocityIterations);
     /// Set position iterations.
     void SetPositionIterations(int positionIterations);
+    /// Set whether to solve the simulation islands in parallel using the work queue.
+    void SetParallelSimulation(bool enable);
     /// Add rigid body.
     void AddRigidBody(RigidBody2D* rigidBody);
     /// Remove rigid body.
@@ -160,6 +168,8 @@ public:
     int GetVelocityIterations() const { return velocityIterations_; }
     /// Return position iterations.
     int GetPositionIterations() const { return positionIterations_; }
+    /// Return whether simulation islands are solved in parallel.
+    bool GetParallelSimulation() const { return parallelSimulation_; }
 
     /// Return the Box2D physics world.
     b2World* GetWorld() { return world_; }
@@ -200,6 +210,10 @@ private:
     bool physicsSteping_;
     /// Applying transforms.
     bool applyingTransforms_;
+    /// Parallel simulation flag.
+    bool parallelSimulation_;
+    /// Island indices for the work queue.
+    PODVector<int> taskIndices_;
     /// Rigid bodies.
     Vector<WeakPtr<RigidBody2D> > rigidBodies_;
 
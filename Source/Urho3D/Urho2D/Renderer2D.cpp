@@ -26,6 +26,7 @@
 #include "../Core/WorkQueue.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Material.h"
@@ -39,6 +40,7 @@
 #include "../Scene/Scene.h"
 #include "../Urho2D/Drawable2D.h"
 #include "../Urho2D/Renderer2D.h"
+#include "../Urho2D/Sprite2D.h"
 
 #include "../DebugNew.h"
 
@@ -48,6 +50,7 @@ namespace Urho3D
 extern const char* blendModeNames[];
 
 static const unsigned MASK_VERTEX2D = MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1;
+static const int DEFAULT_TEXTURE_ATLAS_SIZE = 2048;
 
 ViewBatchInfo2D::ViewBatchInfo2D() : vertexBufferUpdateFrameNumber_(0),
     indexCount_(0),
@@ -61,7 +64,9 @@ Renderer2D::Renderer2D(Context* context) :
     Drawable(context, DRAWABLE_GEOMETRY),
     material_(new Material(context)),
     indexBuffer_(new IndexBuffer(context_)),
-    frustum_(0)
+    frustum_(0),
+    textureAtlas_(false),
+    textureAtlasSize_(DEFAULT_TEXTURE_ATLAS_SIZE)
 {
     material_->SetName("Urho2D");
 
@@ -75,6 +80,7 @@ Renderer2D::Renderer2D(Context* context) :
     material_->SetCullMode(CULL_NONE);
 
     frame_.frameNumber_ = 0;
+    frame_.occlusionBuffer_ = 0;
     SubscribeToEvent(E_BEGINVIEWUPDATE, HANDLER(Renderer2D, HandleBeginViewUpdate));
 }
 
@@ -85,6 +91,9 @@ Renderer2D::~Renderer2D()
 void Renderer2D::RegisterObject(Context* context)
 {
     context->RegisterFactory<Renderer2D>();
+
+    ACCESSOR_ATTRIBUTE("Texture Atlas", GetTextureAtlas, SetTextureAtlas, bool, false, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Texture Atlas Size", GetTextureAtlasSize, SetTextureAtlasSize, int, DEFAULT_TEXTURE_ATLAS_SIZE, AM_DEFAULT);
 }
 
 static inline bool CompareRayQueryResults(RayQueryResult& lr, RayQueryResult& rr)
@@ -188,16 +197,53 @@ void Renderer2D::UpdateGeometry(const FrameInfo& frame)
     {       
         unsigned vertexCount = viewBatchInfo.vertexCount_;
         VertexBuffer* vertexBuffer = viewBatchInfo.vertexBuffer_;
-        if (vertexBuffer->GetVertexCount() < vertexCount)
-            vertexBuffer->SetSize(vertexCount, MASK_VERTEX2D, true);
+        const PODVector<const SourceBatch2D*>& sourceBatches = viewBatchInfo.sourceBatches_;
+        PODVector<unsigned>& uploadedVersions = viewBatchInfo.uploadedVersions_;
+        PODVector<unsigned>& uploadedVertexStarts = viewBatchInfo.uploadedVertexStarts_;
+
+        // Resizing or losing the buffer invalidates every cached vertex range
+        if (vertexBuffer->GetVertexCount() < vertexCount || vertexBuffer->IsDataLost())
+        {
+            if (vertexBuffer->GetVertexCount() < vertexCount)
+                vertexBuffer->SetSize(vertexCount, MASK_VERTEX2D);
+            vertexBuffer->ClearDataLost();
+            uploadedVersions.Clear();
+            uploadedVertexStarts.Clear();
+        }
+
+        // Source batches of static drawables keep their version and position between frames, so only the span
+        // from the first to the last changed, added or moved batch needs to be rewritten
+        unsigned firstDirty = M_MAX_UNSIGNED;
+        unsigned lastDirty = 0;
+        unsigned dirtyStart = 0;
+        unsigned dirtyEnd = 0;
+        unsigned vertexStart = 0;
+        for (unsigned b = 0; b < sourceBatches.Size(); ++b)
+        {
+            const SourceBatch2D* sourceBatch = sourceBatches[b];
+            unsigned batchVertexCount = sourceBatch->vertices_.Size();
+
+            if (b >= uploadedVersions.Size() || uploadedVersions[b] != sourceBatch->version_ ||
+                uploadedVertexStarts[b] != vertexStart)
+            {
+                if (firstDirty == M_MAX_UNSIGNED)
+                {
+                    firstDirty = b;
+                    dirtyStart = vertexStart;
+                }
+                lastDirty = b;
+                dirtyEnd = vertexStart + batchVertexCount;
+            }
 
-        if (vertexCount)
+            vertexStart += batchVertexCount;
+        }
+
+        if (firstDirty != M_MAX_UNSIGNED)
         {
-            Vertex2D* dest = reinterpret_cast<Vertex2D*>(vertexBuffer->Lock(0, vertexCount, true));
+            Vertex2D* dest = reinterpret_cast<Vertex2D*>(vertexBuffer->Lock(dirtyStart, dirtyEnd - dirtyStart));
             if (dest)
             {
-                const PODVector<const SourceBatch2D*>& sourceBatches = viewBatchInfo.sourceBatches_;
-                for (unsigned b = 0; b < sourceBatches.Size(); ++b)
+                for (unsigned b = firstDirty; b <= lastDirty; ++b)
                 {
                     const Vector<Vertex2D>& vertices = sourceBatches[b]->vertices_;
                     for (unsigned i = 0; i < vertices.Size(); ++i)
@@ -208,7 +254,23 @@ void Renderer2D::UpdateGeometry(const FrameInfo& frame)
                 vertexBuffer->Unlock();
             }
             else
+            {
                 LOGERROR("Failed to lock vertex buffer");
+                uploadedVersions.Clear();
+                uploadedVertexStarts.Clear();
+                viewBatchInfo.vertexBufferUpdateFrameNumber_ = frame_.frameNumber_;
+                return;
+            }
+        }
+
+        uploadedVersions.Resize(sourceBatches.Size());
+        uploadedVertexStarts.Resize(sourceBatches.Size());
+        vertexStart = 0;
+        for (unsigned b = 0; b < sourceBatches.Size(); ++b)
+        {
+            uploadedVersions[b] = sourceBatches[b]->version_;
+            uploadedVertexStarts[b] = vertexStart;
+            vertexStart += sourceBatches[b]->vertices_.Size();
         }
 
         viewBatchInfo.vertexBufferUpdateFrameNumber_ = frame_.frameNumber_;
@@ -263,6 +325,50 @@ Material* Renderer2D::GetMaterial(Texture2D* texture, BlendMode blendMode)
     return newMaterial;
 }
 
+void Renderer2D::SetTextureAtlas(bool enable)
+{
+    if (enable == textureAtlas_)
+        return;
+
+    textureAtlas_ = enable;
+    ResetTextureAtlas();
+}
+
+void Renderer2D::SetTextureAtlasSize(int size)
+{
+    size = Max(NextPowerOfTwo(Max(size, 64)), 64);
+    if (size == textureAtlasSize_)
+        return;
+
+    textureAtlasSize_ = size;
+    if (textureAtlas_)
+        ResetTextureAtlas();
+}
+
+Sprite2D* Renderer2D::GetAtlasSprite(Sprite2D* sprite)
+{
+    // Sprites from a sprite sheet already share their texture
+    if (!textureAtlas_ || !sprite || sprite->GetSpriteSheet())
+        return sprite;
+
+    HashMap<Sprite2D*, AtlasSprite2D>::Iterator i = atlasSprites_.Find(sprite);
+    if (i != atlasSprites_.End())
+    {
+        if (i->second_.source_.Get() == sprite)
+            return i->second_.sprite_ ? i->second_.sprite_.Get() : sprite;
+
+        // Entry left over from a destroyed sprite at the same address. Its atlas area is not reclaimed
+        atlasSprites_.Erase(i);
+    }
+
+    // Remember failures too, so that unmergeable textures are not read back again
+    AtlasSprite2D& entry = atlasSprites_[sprite];
+    entry.source_ = sprite;
+    entry.sprite_ = MergeSprite(sprite);
+
+    return entry.sprite_ ? entry.sprite_.Get() : sprite;
+}
+
 bool Renderer2D::CheckVisibility(Drawable2D* drawable) const
 {
     const BoundingBox& box = drawable->GetWorldBoundingBox();
@@ -330,36 +436,19 @@ void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventDa
         PROFILE(CheckDrawableVisibility);
 
         WorkQueue* queue = GetSubsystem<WorkQueue>();
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = drawables_.Size() / numWorkItems;
-        
-        PODVector<Drawable2D*>::Iterator start = drawables_.Begin();
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckDrawableVisibility;
-            item->aux_ = this;
-
-            PODVector<Drawable2D*>::Iterator end = drawables_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-            
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-            
-            start = end;
-        }
-
+        queue->AddRangeWorkItems(drawables_, 0, CheckDrawableVisibility, this);
         queue->Complete(M_MAX_UNSIGNED);
     }
 
     ViewBatchInfo2D& viewBatchInfo = viewBatchInfos_[camera];
     
-    // Create vertex buffer
+    // Create vertex buffer. It is shadowed and static, so that unchanged vertex ranges survive between frames and
+    // changed ranges can be rewritten in place
     if (!viewBatchInfo.vertexBuffer_)
+    {
         viewBatchInfo.vertexBuffer_ = new VertexBuffer(context_);
+        viewBatchInfo.vertexBuffer_->SetShadowed(true);
+    }
 
     UpdateViewBatchInfo(viewBatchInfo, camera);
 
@@ -467,6 +556,110 @@ void Renderer2D::UpdateViewBatchInfo(ViewBatchInfo2D& viewBatchInfo, Camera* cam
     viewBatchInfo.batchUpdatedFrameNumber_ = frame_.frameNumber_;
 }
 
+SharedPtr<Sprite2D> Renderer2D::MergeSprite(Sprite2D* sprite)
+{
+    Texture2D* texture = sprite->GetTexture();
+    if (!texture)
+        return SharedPtr<Sprite2D>();
+
+    // Sprites sharing a texture, such as the tiles of a tile set, share its single copy in the atlas
+    HashMap<Texture2D*, AtlasTexture2D>::Iterator i = atlasTextureInfos_.Find(texture);
+    if (i == atlasTextureInfos_.End() || i->second_.source_.Get() != texture)
+    {
+        AtlasTexture2D& info = atlasTextureInfos_[texture];
+        info.source_ = texture;
+        info.page_ = MergeTexture(texture, info.offset_);
+        i = atlasTextureInfos_.Find(texture);
+    }
+
+    const AtlasTexture2D& info = i->second_;
+    if (info.page_ == M_MAX_UNSIGNED)
+        return SharedPtr<Sprite2D>();
+
+    const IntRect& rectangle = sprite->GetRectangle();
+    const IntVector2& offset = info.offset_;
+    SharedPtr<Sprite2D> atlasSprite(new Sprite2D(context_));
+    atlasSprite->SetName(sprite->GetName());
+    atlasSprite->SetTexture(atlasTextures_[info.page_]);
+    atlasSprite->SetRectangle(IntRect(rectangle.left_ + offset.x_, rectangle.top_ + offset.y_, rectangle.right_ + offset.x_,
+        rectangle.bottom_ + offset.y_));
+    atlasSprite->SetHotSpot(sprite->GetHotSpot());
+    atlasSprite->SetOffset(sprite->GetOffset());
+
+    return atlasSprite;
+}
+
+unsigned Renderer2D::MergeTexture(Texture2D* texture, IntVector2& offset)
+{
+    // Only small uncompressed textures with default sampling can share an atlas page. Reserve a one pixel border
+    int width = texture->GetWidth();
+    int height = texture->GetHeight();
+    int paddedWidth = width + 2;
+    int paddedHeight = height + 2;
+    if (texture->GetFormat() != Graphics::GetRGBAFormat() || texture->GetFilterMode() != FILTER_DEFAULT ||
+        paddedWidth * 2 > textureAtlasSize_ || paddedHeight * 2 > textureAtlasSize_)
+        return M_MAX_UNSIGNED;
+
+    // Read back the texture. Fails on OpenGL ES, in which case the sprite keeps its own texture
+    SharedArrayPtr<unsigned> data(new unsigned[width * height]);
+    if (!texture->GetData(0, data.Get()))
+        return M_MAX_UNSIGNED;
+
+    // Replicate the edge pixels into the border, so that bilinear filtering does not pick up neighbouring textures
+    SharedArrayPtr<unsigned> paddedData(new unsigned[paddedWidth * paddedHeight]);
+    for (int y = 0; y < paddedHeight; ++y)
+    {
+        const unsigned* src = data.Get() + Clamp(y - 1, 0, height - 1) * width;
+        unsigned* dest = paddedData.Get() + y * paddedWidth;
+        for (int x = 0; x < paddedWidth; ++x)
+            dest[x] = src[Clamp(x - 1, 0, width - 1)];
+    }
+
+    int x = 0;
+    int y = 0;
+    unsigned page = 0;
+    while (page < atlasAllocators_.Size() && !atlasAllocators_[page].Allocate(paddedWidth, paddedHeight, x, y))
+        ++page;
+
+    if (page == atlasAllocators_.Size())
+    {
+        SharedPtr<Texture2D> atlasTexture(new Texture2D(context_));
+        atlasTexture->SetName("Urho2DAtlas" + String(page));
+        // Mipmaps would not be regenerated on partial updates and would blend neighbouring textures
+        atlasTexture->SetNumLevels(1);
+        if (!atlasTexture->SetSize(textureAtlasSize_, textureAtlasSize_, Graphics::GetRGBAFormat()))
+        {
+            LOGERROR("Failed to create texture atlas page");
+            return M_MAX_UNSIGNED;
+        }
+
+        AreaAllocator allocator(textureAtlasSize_, textureAtlasSize_);
+        allocator.Allocate(paddedWidth, paddedHeight, x, y);
+        atlasTextures_.Push(atlasTexture);
+        atlasAllocators_.Push(allocator);
+    }
+
+    if (!atlasTextures_[page]->SetData(0, x, y, paddedWidth, paddedHeight, paddedData.Get()))
+        return M_MAX_UNSIGNED;
+
+    offset = IntVector2(x + 1, y + 1);
+    return page;
+}
+
+void Renderer2D::ResetTextureAtlas()
+{
+    for (unsigned i = 0; i < atlasTextures_.Size(); ++i)
+        cachedMaterials_.Erase(atlasTextures_[i]);
+
+    atlasTextures_.Clear();
+    atlasAllocators_.Clear();
+    atlasTextureInfos_.Clear();
+    atlasSprites_.Clear();
+
+    for (unsigned i = 0; i < drawables_.Size(); ++i)
+        drawables_[i]->OnTextureAtlasChanged();
+}
+
 void Renderer2D::AddViewBatch(ViewBatchInfo2D& viewBatchInfo, Material* material, unsigned indexStart, unsigned indexCount, unsigned vertexStart, unsigned vertexCount)
 {
     if (!material || indexCount == 0 || vertexCount == 0)
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Graphics/Drawable.h"
+#include "../Math/AreaAllocator.h"
 
 namespace Urho3D
 {
@@ -30,6 +31,7 @@ namespace Urho3D
 class Drawable2D;
 class IndexBuffer;
 class Material;
+class Sprite2D;
 class VertexBuffer;
 struct FrameInfo;
 struct SourceBatch2D;
@@ -52,6 +54,10 @@ struct ViewBatchInfo2D
     unsigned batchUpdatedFrameNumber_;
     /// Source batches.
     PODVector<const SourceBatch2D*> sourceBatches_;
+    /// Vertices versions of the source batches currently in the vertex buffer.
+    PODVector<unsigned> uploadedVersions_;
+    /// Vertex start positions of the source batches currently in the vertex buffer.
+    PODVector<unsigned> uploadedVertexStarts_;
     /// Batch count;
     unsigned batchCount_;
     /// Materials.
@@ -60,6 +66,26 @@ struct ViewBatchInfo2D
     Vector<SharedPtr<Geometry> > geometries_;
 };
 
+/// Placement of a texture in the Renderer2D texture atlas.
+struct AtlasTexture2D
+{
+    /// Original texture.
+    WeakPtr<Texture2D> source_;
+    /// Atlas page index, M_MAX_UNSIGNED if the texture could not be merged.
+    unsigned page_;
+    /// Position of the texture's top left pixel in the atlas page.
+    IntVector2 offset_;
+};
+
+/// Sprite merged into the Renderer2D texture atlas.
+struct AtlasSprite2D
+{
+    /// Original sprite.
+    WeakPtr<Sprite2D> source_;
+    /// Copy of the sprite referring to the atlas texture, null if the original could not be merged.
+    SharedPtr<Sprite2D> sprite_;
+};
+
 /// 2D renderer components.
 class URHO3D_API Renderer2D : public Drawable
 {
@@ -90,6 +116,19 @@ public:
     void RemoveDrawable(Drawable2D* drawable);
     /// Return material by texture and blend mode.
     Material* GetMaterial(Texture2D* texture, BlendMode blendMode);
+    /// Set whether to merge standalone sprite textures into shared atlas textures to reduce material changes.
+    void SetTextureAtlas(bool enable);
+    /// Set texture atlas page size in pixels.
+    void SetTextureAtlasSize(int size);
+    /// Return sprite to render instead of the given one. This is a copy placed in the texture atlas when merging succeeded.
+    Sprite2D* GetAtlasSprite(Sprite2D* sprite);
+
+    /// Return whether standalone sprite textures are merged into atlas textures.
+    bool GetTextureAtlas() const { return textureAtlas_; }
+    /// Return texture atlas page size in pixels.
+    int GetTextureAtlasSize() const { return textureAtlasSize_; }
+    /// Return number of texture atlas pages.
+    unsigned GetNumTextureAtlasPages() const { return atlasTextures_.Size(); }
 
     /// Check visibility.
     bool CheckVisibility(Drawable2D* drawable) const;
@@ -107,6 +146,12 @@ private:
     void UpdateViewBatchInfo(ViewBatchInfo2D& viewBatchInfo, Camera* camera);
     /// Add view batch.
     void AddViewBatch(ViewBatchInfo2D& viewBatchInfo, Material* material, unsigned indexStart, unsigned indexCount, unsigned vertexStart, unsigned vertexCount);
+    /// Return a copy of a standalone sprite remapped into the texture atlas, or null if its texture can not be merged.
+    SharedPtr<Sprite2D> MergeSprite(Sprite2D* sprite);
+    /// Copy a texture into the texture atlas. Return the atlas page index and the texture's position, or M_MAX_UNSIGNED on failure.
+    unsigned MergeTexture(Texture2D* texture, IntVector2& offset);
+    /// Release the texture atlas and notify drawables to choose their materials again.
+    void ResetTextureAtlas();
 
     /// Index buffer.
     SharedPtr<IndexBuffer> indexBuffer_;
@@ -124,6 +169,18 @@ private:
     BoundingBox frustumBoundingBox_;
     /// Cached materials.
     HashMap<Texture2D*, HashMap<int, SharedPtr<Material> > > cachedMaterials_;
+    /// Texture atlas flag.
+    bool textureAtlas_;
+    /// Texture atlas page size.
+    int textureAtlasSize_;
+    /// Texture atlas pages.
+    Vector<SharedPtr<Texture2D> > atlasTextures_;
+    /// Texture atlas page area allocators.
+    Vector<AreaAllocator> atlasAllocators_;
+    /// Textures merged into the texture atlas.
+    HashMap<Texture2D*, AtlasTexture2D> atlasTextureInfos_;
+    /// Sprites merged into the texture atlas.
+    HashMap<Sprite2D*, AtlasSprite2D> atlasSprites_;
 };
 
 }
@@ -240,26 +240,31 @@ void StaticSprite2D::UpdateSourceBatches()
     if (!sourceBatchesDirty_)
         return;
 
+    // The texture atlas may have been reset since the material was chosen, so keep it in sync with the texture coordinates
+    if (renderer_ && renderer_->GetTextureAtlas())
+        UpdateMaterial();
+
     Vector<Vertex2D>& vertices = sourceBatches_[0].vertices_;
     vertices.Clear();
 
-    if (!sprite_)
+    Sprite2D* sprite = GetRenderSprite();
+    if (!sprite)
         return;
 
     Rect drawRect;
     if (useHotSpot_)
     {
-        if (!sprite_->GetDrawRectangle(drawRect, hotSpot_, flipX_, flipY_))
+        if (!sprite->GetDrawRectangle(drawRect, hotSpot_, flipX_, flipY_))
             return;
     }
     else
     {
-        if (!sprite_->GetDrawRectangle(drawRect, flipX_, flipY_))
+        if (!sprite->GetDrawRectangle(drawRect, flipX_, flipY_))
             return;
     }
 
     Rect textureRect;
-    if (!sprite_->GetTextureRectangle(textureRect, flipX_, flipY_))
+    if (!sprite->GetTextureRectangle(textureRect, flipX_, flipY_))
         return;
     
     /*
@@ -298,6 +303,11 @@ void StaticSprite2D::UpdateSourceBatches()
     sourceBatchesDirty_ = false;
 }
 
+void StaticSprite2D::OnTextureAtlasChanged()
+{
+    sourceBatchesDirty_ = true;
+}
+
 void StaticSprite2D::OnFlipChanged()
 {
 
@@ -309,11 +319,21 @@ void StaticSprite2D::UpdateMaterial()
         sourceBatches_[0].material_ = customMaterial_;
     else
     {
-        if (sprite_)
-            sourceBatches_[0].material_ = renderer_->GetMaterial(sprite_->GetTexture(), blendMode_);
+        Sprite2D* sprite = GetRenderSprite();
+        if (sprite)
+            sourceBatches_[0].material_ = renderer_->GetMaterial(sprite->GetTexture(), blendMode_);
         else
             sourceBatches_[0].material_ = 0;
     }
 }
 
+Sprite2D* StaticSprite2D::GetRenderSprite() const
+{
+    // A custom material supplies its own texture, so it must keep the sprite's original texture coordinates
+    if (customMaterial_ || !renderer_)
+        return sprite_;
+
+    return renderer_->GetAtlasSprite(sprite_);
+}
+
 }
@@ -91,6 +91,9 @@ public:
     /// Return custom material attribute.
     ResourceRef GetCustomMaterialAttr() const;
 
+    /// Handle texture atlas being enabled, disabled or reset (called by Renderer2D).
+    virtual void OnTextureAtlasChanged();
+
 protected:
     /// Recalculate the world-space bounding box.
     virtual void OnWorldBoundingBoxUpdate();
@@ -102,6 +105,8 @@ protected:
     virtual void OnFlipChanged();
     /// Update material.
     void UpdateMaterial();
+    /// Return sprite used for rendering, which is the Renderer2D texture atlas copy when the sprite has been merged.
+    Sprite2D* GetRenderSprite() const;
 
     /// Sprite.
     SharedPtr<Sprite2D> sprite_;
@@ -37,8 +37,11 @@ namespace Urho3D
 extern const float PIXEL_SIZE;
 extern const char* URHO2D_CATEGORY;
 
+static const int DEFAULT_CHUNK_SIZE = 16;
+
 TileMap2D::TileMap2D(Context* context) :
-    Component(context)
+    Component(context),
+    chunkSize_(DEFAULT_CHUNK_SIZE)
 {
 }
 
@@ -51,6 +54,7 @@ void TileMap2D::RegisterObject(Context* context)
     context->RegisterFactory<TileMap2D>(URHO2D_CATEGORY);
 
     ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    ACCESSOR_ATTRIBUTE("Chunk Size", GetChunkSize, SetChunkSize, int, DEFAULT_CHUNK_SIZE, AM_DEFAULT);
     MIXED_ACCESSOR_ATTRIBUTE("Tmx File", GetTmxFileAttr, SetTmxFileAttr, ResourceRef, ResourceRef(TmxFile2D::GetTypeStatic()), AM_DEFAULT);
 }
 
@@ -141,6 +145,20 @@ void TileMap2D::SetTmxFile(TmxFile2D* tmxFile)
     }
 }
 
+void TileMap2D::SetChunkSize(int chunkSize)
+{
+    chunkSize = Max(chunkSize, 0);
+    if (chunkSize == chunkSize_)
+        return;
+
+    chunkSize_ = chunkSize;
+
+    // Recreate the layers with the new chunking
+    SharedPtr<TmxFile2D> tmxFile(tmxFile_);
+    SetTmxFile(0);
+    SetTmxFile(tmxFile);
+}
+
 TmxFile2D* TileMap2D::GetTmxFile() const
 {
     return tmxFile_;
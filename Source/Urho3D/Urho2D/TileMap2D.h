@@ -49,11 +49,15 @@ public:
 
     /// Set tmx file.
     void SetTmxFile(TmxFile2D* tmxFile);
+    /// Set size in tiles of the chunks tile layers are meshed into. 0 creates a node and a sprite for every tile instead.
+    void SetChunkSize(int chunkSize);
     /// Add debug geometry to the debug renderer.
     void DrawDebugGeometry();
 
     /// Return tmx file.
     TmxFile2D* GetTmxFile() const;
+    /// Return tile chunk size.
+    int GetChunkSize() const { return chunkSize_; }
     /// Return information.
     const TileMapInfo2D& GetInfo() const { return info_; }
     /// Return number of layers.
@@ -78,6 +82,8 @@ private:
     SharedPtr<TmxFile2D> tmxFile_;
     /// Tile map information.
     TileMapInfo2D info_;
+    /// Tile chunk size.
+    int chunkSize_;
     /// Root node for tile map layer.
     SharedPtr<Node> rootNode_;
     /// Tile map layers.
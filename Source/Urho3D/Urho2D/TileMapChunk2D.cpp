@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Core/Context.h"
+#include "../Graphics/Material.h"
+#include "../Scene/Node.h"
+#include "../Urho2D/Renderer2D.h"
+#include "../Urho2D/Sprite2D.h"
+#include "../Urho2D/TileMapChunk2D.h"
+#include "../Urho2D/TmxFile2D.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Largest draw order offset of a source batch within a chunk, so that it stays below the next order in layer.
+static const int MAX_CHUNK_BATCH_ORDER = 1023;
+
+TileMapChunk2D::TileMapChunk2D(Context* context) :
+    Drawable2D(context)
+{
+}
+
+TileMapChunk2D::~TileMapChunk2D()
+{
+}
+
+void TileMapChunk2D::RegisterObject(Context* context)
+{
+    context->RegisterFactory<TileMapChunk2D>();
+}
+
+void TileMapChunk2D::OnTextureAtlasChanged()
+{
+    sourceBatchesDirty_ = true;
+}
+
+void TileMapChunk2D::SetTiles(const TmxTileLayer2D* tileLayer, const TileMapInfo2D& info, int x, int y, int width, int height)
+{
+    tileRect_ = IntRect(x, y, x + width, y + height);
+    tileSprites_.Clear();
+    tilePositions_.Clear();
+    boundingBox_.Clear();
+
+    if (tileLayer)
+    {
+        // Store the tiles in the same row-major order the per-tile sprites were drawn in
+        for (int tileY = tileRect_.top_; tileY < tileRect_.bottom_; ++tileY)
+        {
+            for (int tileX = tileRect_.left_; tileX < tileRect_.right_; ++tileX)
+            {
+                const Tile2D* tile = tileLayer->GetTile(tileX, tileY);
+                Sprite2D* sprite = tile ? tile->GetSprite() : 0;
+                Rect drawRect;
+                if (!sprite || !sprite->GetDrawRectangle(drawRect))
+                    continue;
+
+                Vector2 position = info.TileIndexToPosition(tileX, tileY);
+                tileSprites_.Push(SharedPtr<Sprite2D>(sprite));
+                tilePositions_.Push(position);
+
+                boundingBox_.Merge(Vector3(position.x_ + drawRect.min_.x_, position.y_ + drawRect.min_.y_, 0.0f));
+                boundingBox_.Merge(Vector3(position.x_ + drawRect.max_.x_, position.y_ + drawRect.max_.y_, 0.0f));
+            }
+        }
+    }
+
+    sourceBatchesDirty_ = true;
+    OnMarkedDirty(node_);
+}
+
+void TileMapChunk2D::OnWorldBoundingBoxUpdate()
+{
+    worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+}
+
+void TileMapChunk2D::OnDrawOrderChanged()
+{
+    for (unsigned i = 0; i < sourceBatches_.Size(); ++i)
+        sourceBatches_[i].drawOrder_ = GetDrawOrder() + Min((int)i, MAX_CHUNK_BATCH_ORDER);
+}
+
+void TileMapChunk2D::UpdateSourceBatches()
+{
+    if (!sourceBatchesDirty_)
+        return;
+
+    sourceBatches_.Clear();
+
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    unsigned color = Color::WHITE.ToUInt();
+    Material* currMaterial = 0;
+
+    for (unsigned i = 0; i < tileSprites_.Size(); ++i)
+    {
+        Sprite2D* sprite = tileSprites_[i];
+        if (renderer_)
+            sprite = renderer_->GetAtlasSprite(sprite);
+
+        Rect drawRect;
+        Rect textureRect;
+        if (!sprite->GetDrawRectangle(drawRect) || !sprite->GetTextureRectangle(textureRect))
+            continue;
+
+        Material* material = renderer_ ? renderer_->GetMaterial(sprite->GetTexture(), BLEND_ALPHA) : 0;
+        if (!material)
+            continue;
+
+        // Start a new batch whenever the tile set changes, so that overlapping tiles keep their order within the chunk
+        if (material != currMaterial)
+        {
+            unsigned index = sourceBatches_.Size();
+            sourceBatches_.Resize(index + 1);
+            sourceBatches_[index].material_ = material;
+            sourceBatches_[index].drawOrder_ = GetDrawOrder() + Min((int)index, MAX_CHUNK_BATCH_ORDER);
+            currMaterial = material;
+        }
+
+        /*
+        V1---------V2
+        |         / |
+        |       /   |
+        |     /     |
+        |   /       |
+        | /         |
+        V0---------V3
+        */
+        const Vector2& position = tilePositions_[i];
+        Vertex2D vertex0;
+        Vertex2D vertex1;
+        Vertex2D vertex2;
+        Vertex2D vertex3;
+
+        vertex0.position_ = worldTransform * Vector3(position.x_ + drawRect.min_.x_, position.y_ + drawRect.min_.y_, 0.0f);
+        vertex1.position_ = worldTransform * Vector3(position.x_ + drawRect.min_.x_, position.y_ + drawRect.max_.y_, 0.0f);
+        vertex2.position_ = worldTransform * Vector3(position.x_ + drawRect.max_.x_, position.y_ + drawRect.max_.y_, 0.0f);
+        vertex3.position_ = worldTransform * Vector3(position.x_ + drawRect.max_.x_, position.y_ + drawRect.min_.y_, 0.0f);
+
+        vertex0.uv_ = textureRect.min_;
+        vertex1.uv_ = Vector2(textureRect.min_.x_, textureRect.max_.y_);
+        vertex2.uv_ = textureRect.max_;
+        vertex3.uv_ = Vector2(textureRect.max_.x_, textureRect.min_.y_);
+
+        vertex0.color_ = vertex1.color_ = vertex2.color_ = vertex3.color_ = color;
+
+        Vector<Vertex2D>& vertices = sourceBatches_.Back().vertices_;
+        vertices.Push(vertex0);
+        vertices.Push(vertex1);
+        vertices.Push(vertex2);
+        vertices.Push(vertex3);
+    }
+
+    sourceBatchesDirty_ = false;
+}
+
+}
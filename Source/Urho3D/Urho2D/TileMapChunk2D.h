@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2008-2015 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Urho2D/Drawable2D.h"
+
+namespace Urho3D
+{
+
+class Sprite2D;
+class TmxTileLayer2D;
+struct TileMapInfo2D;
+
+/// Drawable that meshes a rectangular block of a tile layer into shared source batches, culled as a whole.
+class URHO3D_API TileMapChunk2D : public Drawable2D
+{
+    OBJECT(TileMapChunk2D);
+
+public:
+    /// Construct.
+    TileMapChunk2D(Context* context);
+    /// Destruct.
+    ~TileMapChunk2D();
+    /// Register object factory. Drawable2D must be registered first.
+    static void RegisterObject(Context* context);
+
+    /// Handle texture atlas being enabled, disabled or reset (called by Renderer2D).
+    virtual void OnTextureAtlasChanged();
+
+    /// Set the tiles to mesh: the tile layer block starting at x, y, in tile coordinates.
+    void SetTiles(const TmxTileLayer2D* tileLayer, const TileMapInfo2D& info, int x, int y, int width, int height);
+
+    /// Return tile rectangle, with right and bottom exclusive.
+    const IntRect& GetTileRect() const { return tileRect_; }
+    /// Return number of non-empty tiles.
+    unsigned GetNumTiles() const { return tileSprites_.Size(); }
+
+protected:
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate();
+    /// Handle draw order changed.
+    virtual void OnDrawOrderChanged();
+    /// Update source batches.
+    virtual void UpdateSourceBatches();
+
+private:
+    /// Tile rectangle.
+    IntRect tileRect_;
+    /// Sprites of the non-empty tiles in drawing order.
+    Vector<SharedPtr<Sprite2D> > tileSprites_;
+    /// Positions of the non-empty tiles relative to the node.
+    PODVector<Vector2> tilePositions_;
+};
+
+}
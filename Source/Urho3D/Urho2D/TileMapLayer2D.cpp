@@ -26,6 +26,7 @@
 #include "../Resource/ResourceCache.h"
 #include "../Urho2D/StaticSprite2D.h"
 #include "../Urho2D/TileMap2D.h"
+#include "../Urho2D/TileMapChunk2D.h"
 #include "../Urho2D/TileMapLayer2D.h"
 #include "../Urho2D/TmxFile2D.h"
 
@@ -125,6 +126,14 @@ void TileMapLayer2D::Initialize(TileMap2D* tileMap, const TmxLayer2D* tmxLayer)
         }
 
         nodes_.Clear();
+
+        for (unsigned i = 0; i < chunks_.Size(); ++i)
+        {
+            if (chunks_[i])
+                chunks_[i]->Remove();
+        }
+
+        chunks_.Clear();
     }
 
     tileLayer_ = 0;
@@ -174,6 +183,12 @@ void TileMapLayer2D::SetDrawOrder(int drawOrder)
         if (staticSprite)
             staticSprite->SetLayer(drawOrder_);
     }
+
+    for (unsigned i = 0; i < chunks_.Size(); ++i)
+    {
+        if (chunks_[i])
+            chunks_[i]->SetLayer(drawOrder_);
+    }
 }
 
 void TileMapLayer2D::SetVisible(bool visible)
@@ -188,6 +203,12 @@ void TileMapLayer2D::SetVisible(bool visible)
         if (nodes_[i])
             nodes_[i]->SetEnabled(visible_);
     }
+
+    for (unsigned i = 0; i < chunks_.Size(); ++i)
+    {
+        if (chunks_[i])
+            chunks_[i]->SetEnabled(visible_);
+    }
 }
 
 TileMap2D* TileMapLayer2D::GetTileMap() const
@@ -282,6 +303,14 @@ Node* TileMapLayer2D::GetImageNode() const
     return nodes_[0];
 }
 
+TileMapChunk2D* TileMapLayer2D::GetChunk(unsigned index) const
+{
+    if (index >= chunks_.Size())
+        return 0;
+
+    return chunks_[index];
+}
+
 void TileMapLayer2D::SetTileLayer(const TmxTileLayer2D* tileLayer)
 {
     tileLayer_ = tileLayer;
@@ -291,6 +320,9 @@ void TileMapLayer2D::SetTileLayer(const TmxTileLayer2D* tileLayer)
     nodes_.Resize(width * height);
 
     const TileMapInfo2D& info = tileMap_->GetInfo();
+    int chunkSize = tileMap_->GetChunkSize();
+    TmxFile2D* tmxFile = tileLayer->GetTmxFile();
+
     for (int y = 0; y < height; ++y)
     {
         for (int x = 0; x < width; ++x)
@@ -299,18 +331,54 @@ void TileMapLayer2D::SetTileLayer(const TmxTileLayer2D* tileLayer)
             if (!tile)
                 continue;
 
+            // When meshing into chunks, keep nodes only for tiles that carry gameplay data such as collision properties
+            if (chunkSize > 0 && !tmxFile->GetTilePropertySet(tile->GetGid()))
+                continue;
+
             SharedPtr<Node> tileNode(GetNode()->CreateChild("Tile"));
             tileNode->SetTemporary(true);
             tileNode->SetPosition(info.TileIndexToPosition(x, y));
 
-            StaticSprite2D* staticSprite = tileNode->CreateComponent<StaticSprite2D>();
-            staticSprite->SetSprite(tile->GetSprite());
-            staticSprite->SetLayer(drawOrder_);
-            staticSprite->SetOrderInLayer(y * width + x);
+            if (chunkSize <= 0)
+            {
+                StaticSprite2D* staticSprite = tileNode->CreateComponent<StaticSprite2D>();
+                staticSprite->SetSprite(tile->GetSprite());
+                staticSprite->SetLayer(drawOrder_);
+                staticSprite->SetOrderInLayer(y * width + x);
+            }
 
             nodes_[y * width + x] = tileNode;
         }
     }
+
+    if (chunkSize <= 0)
+        return;
+
+    int numChunksX = (width + chunkSize - 1) / chunkSize;
+    int numChunksY = (height + chunkSize - 1) / chunkSize;
+    for (int chunkY = 0; chunkY < numChunksY; ++chunkY)
+    {
+        for (int chunkX = 0; chunkX < numChunksX; ++chunkX)
+        {
+            int x = chunkX * chunkSize;
+            int y = chunkY * chunkSize;
+
+            TileMapChunk2D* chunk = GetNode()->CreateComponent<TileMapChunk2D>();
+            chunk->SetTemporary(true);
+            chunk->SetTiles(tileLayer, info, x, y, Min(chunkSize, width - x), Min(chunkSize, height - y));
+            if (!chunk->GetNumTiles())
+            {
+                chunk->Remove();
+                continue;
+            }
+
+            // Order in layer has 10 bits; beyond that chunks can only overlap in the order of their materials
+            chunk->SetLayer(drawOrder_);
+            chunk->SetOrderInLayer(Min(chunkY * numChunksX + chunkX, 1023));
+
+            chunks_.Push(WeakPtr<TileMapChunk2D>(chunk));
+        }
+    }
 }
 
 void TileMapLayer2D::SetObjectGroup(const TmxObjectGroup2D* objectGroup)
@@ -31,6 +31,7 @@ namespace Urho3D
 class DebugRenderer;
 class Node;
 class TileMap2D;
+class TileMapChunk2D;
 class TmxImageLayer2D;
 class TmxLayer2D;
 class TmxObjectGroup2D;
@@ -78,7 +79,7 @@ public:
     int GetWidth() const;
     /// Return height (for tile layer only).
     int GetHeight() const;
-    /// Return tile node (for tile layer only).
+    /// Return tile node (for tile layer only). When the tile map meshes tiles into chunks, only tiles with properties have a node.
     Node* GetTileNode(int x, int y) const;
     /// Return tile (for tile layer only).
     Tile2D* GetTile(int x, int y) const;
@@ -92,6 +93,10 @@ public:
 
     /// Return image node (for image layer only).
     Node* GetImageNode() const;
+    /// Return number of tile chunk drawables (for tile layer only).
+    unsigned GetNumChunks() const { return chunks_.Size(); }
+    /// Return tile chunk drawable at index (for tile layer only).
+    TileMapChunk2D* GetChunk(unsigned index) const;
 
 private:
     /// Set tile layer.
@@ -117,6 +122,8 @@ private:
     bool visible_;
     /// Tile node or image nodes.
     Vector<SharedPtr<Node> > nodes_;
+    /// Tile chunk drawables.
+    Vector<WeakPtr<TileMapChunk2D> > chunks_;
 };
 
 }
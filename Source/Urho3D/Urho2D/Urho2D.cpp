@@ -51,6 +51,7 @@
 #include "../Urho2D/SpriteSheet2D.h"
 #include "../Urho2D/StaticSprite2D.h"
 #include "../Urho2D/TileMap2D.h"
+#include "../Urho2D/TileMapChunk2D.h"
 #include "../Urho2D/TileMapLayer2D.h"
 #include "../Urho2D/TmxFile2D.h"
 
@@ -81,6 +82,7 @@ void RegisterUrho2DLibrary(Context* context)
     TmxFile2D::RegisterObject(context);
     TileMap2D::RegisterObject(context);
     TileMapLayer2D::RegisterObject(context);
+    TileMapChunk2D::RegisterObject(context);
 
     PhysicsWorld2D::RegisterObject(context);
     RigidBody2D::RegisterObject(context);
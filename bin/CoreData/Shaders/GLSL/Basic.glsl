@@ -16,10 +16,18 @@ void VS()
     gl_Position = GetClipPos(worldPos);
     
     #ifdef DIFFMAP
-        vTexCoord = iTexCoord;
+        #ifdef INSTANCEDBILLBOARD
+            vTexCoord = GetInstancedBillboardTexCoord();
+        #else
+            vTexCoord = iTexCoord;
+        #endif
     #endif
     #ifdef VERTEXCOLOR
-        vColor = iColor;
+        #ifdef INSTANCEDBILLBOARD
+            vColor = GetInstancedBillboardColor();
+        #else
+            vColor = iColor;
+        #endif
     #endif
 }
 
@@ -50,4 +58,7 @@ void PS()
         #endif
         gl_FragColor = vec4(diffColor.rgb, diffColor.a * alphaInput);
     #endif
+    #ifdef PREMULALPHA
+        gl_FragColor.rgb *= gl_FragColor.a;
+    #endif
 }
@@ -0,0 +1,51 @@
+#include "Uniforms.glsl"
+#include "Samplers.glsl"
+#include "Transform.glsl"
+#include "ScreenPos.glsl"
+
+varying vec2 vScreenPos;
+
+#ifdef COMPILEPS
+uniform vec2 cUpsampleInvSize;
+
+float GetUpsampleDepth(vec2 uv)
+{
+    #ifdef HWDEPTH
+        return ReconstructDepth(texture2D(sDepthBuffer, uv).r);
+    #else
+        return DecodeDepth(texture2D(sDepthBuffer, uv).rgb);
+    #endif
+}
+#endif
+
+void VS()
+{
+    mat4 modelMatrix = iModelMatrix;
+    vec3 worldPos = GetWorldPos(modelMatrix);
+    gl_Position = GetClipPos(worldPos);
+    vScreenPos = GetScreenPosPreDiv(gl_Position);
+}
+
+void PS()
+{
+    // Locate the four low resolution texels surrounding the pixel
+    vec2 lowPos = vScreenPos / cUpsampleInvSize - 0.5;
+    vec2 base = floor(lowPos);
+    vec2 f = lowPos - base;
+    vec2 minUV = 0.5 * cUpsampleInvSize;
+    vec2 maxUV = 1.0 - minUV;
+    vec2 uv00 = clamp((base + 0.5) * cUpsampleInvSize, minUV, maxUV);
+    vec2 uv11 = clamp((base + 1.5) * cUpsampleInvSize, minUV, maxUV);
+    vec2 uv10 = vec2(uv11.x, uv00.y);
+    vec2 uv01 = vec2(uv00.x, uv11.y);
+
+    // Bilinear weights, reduced for texels whose depth differs from the full resolution pixel
+    float depth = GetUpsampleDepth(vScreenPos);
+    vec4 depths = vec4(GetUpsampleDepth(uv00), GetUpsampleDepth(uv10), GetUpsampleDepth(uv01), GetUpsampleDepth(uv11));
+    vec4 weights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    weights /= 1e-3 + abs(depths - depth) / max(depth, 1e-5);
+
+    gl_FragColor = (texture2D(sDiffMap, uv00) * weights.x + texture2D(sDiffMap, uv10) * weights.y +
+        texture2D(sDiffMap, uv01) * weights.z + texture2D(sDiffMap, uv11) * weights.w) /
+        dot(weights, vec4(1.0));
+}
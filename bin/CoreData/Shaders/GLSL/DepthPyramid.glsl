@@ -0,0 +1,42 @@
+#include "Uniforms.glsl"
+#include "Samplers.glsl"
+#include "Transform.glsl"
+#include "ScreenPos.glsl"
+
+varying vec2 vScreenPos;
+
+#ifdef COMPILEPS
+uniform vec2 cDepthPyramidSrcInvSize;
+uniform vec2 cDepthPyramidDestSize;
+#endif
+
+void VS()
+{
+    mat4 modelMatrix = iModelMatrix;
+    vec3 worldPos = GetWorldPos(modelMatrix);
+    gl_Position = GetClipPos(worldPos);
+    vScreenPos = GetScreenPosPreDiv(gl_Position);
+}
+
+void PS()
+{
+    #ifdef FIRSTLEVEL
+        // Copy the linear depth: minimum and maximum are the same
+        #ifdef HWDEPTH
+            float depth = ReconstructDepth(texture2D(sDepthBuffer, vScreenPos).r);
+        #else
+            float depth = DecodeDepth(texture2D(sDepthBuffer, vScreenPos).rgb);
+        #endif
+        gl_FragColor = vec4(depth, depth, 0.0, 0.0);
+    #else
+        // Take the min & max of the 2x2 block of the previous level. On odd-sized levels clamp to the last texel instead
+        // of wrapping around
+        vec2 srcPos = (floor(vScreenPos * cDepthPyramidDestSize) * 2.0 + 0.5) * cDepthPyramidSrcInvSize;
+        vec2 maxPos = 1.0 - 0.5 * cDepthPyramidSrcInvSize;
+        vec2 d0 = texture2D(sDiffMap, srcPos).rg;
+        vec2 d1 = texture2D(sDiffMap, min(srcPos + vec2(cDepthPyramidSrcInvSize.x, 0.0), maxPos)).rg;
+        vec2 d2 = texture2D(sDiffMap, min(srcPos + vec2(0.0, cDepthPyramidSrcInvSize.y), maxPos)).rg;
+        vec2 d3 = texture2D(sDiffMap, min(srcPos + cDepthPyramidSrcInvSize, maxPos)).rg;
+        gl_FragColor = vec4(min(min(d0.x, d1.x), min(d2.x, d3.x)), max(max(d0.y, d1.y), max(d2.y, d3.y)), 0.0, 0.0);
+    #endif
+}
@@ -94,6 +94,15 @@ float GetDiffuse(vec3 normal, vec3 worldPos, out vec3 lightDir)
     #endif
 }
 
+// Point light diffuse term with the position & inverse range given explicitly, used by instanced light volumes
+float GetDiffuse(vec3 normal, vec3 worldPos, vec4 lightPos, out vec3 lightDir)
+{
+    vec3 lightVec = (lightPos.xyz - worldPos) * lightPos.w;
+    float lightDist = length(lightVec);
+    lightDir = lightVec / lightDist;
+    return max(dot(normal, lightDir), 0.0) * texture2D(sLightRampMap, vec2(lightDist, 0.0)).r;
+}
+
 float GetDiffuseVolumetric(vec3 worldPos)
 {
     #ifdef DIRLIGHT
@@ -116,6 +125,61 @@ float GetIntensity(vec3 color)
     return dot(color, vec3(0.299, 0.587, 0.114));
 }
 
+#ifdef CLUSTERED
+// Light cluster texture layout. Must match the light cluster constants in Renderer.h
+#define NUMCLUSTERSZ 24.0
+#define MAXLIGHTSPERCLUSTER 32
+#define CLUSTERTEXWIDTH 1024.0
+#define CLUSTERTEXHEIGHT 16.0
+#define CLUSTERGRIDSTART 1024.0
+#define CLUSTERINDEXSTART 4096.0
+
+vec4 GetClusterTexel(float index)
+{
+    float row = floor(index / CLUSTERTEXWIDTH);
+    vec2 uv = vec2((index - row * CLUSTERTEXWIDTH + 0.5) / CLUSTERTEXWIDTH, (row + 0.5) / CLUSTERTEXHEIGHT);
+    return texture2D(sLightClusterMap, uv);
+}
+
+vec3 GetClusteredLight(vec3 worldPos, float depth, vec3 normal, vec3 diffColor, vec3 specColor, float specularPower)
+{
+    // Find the cluster from the screen tile and exponential depth slice
+    vec4 clusterPos = vec4(worldPos, 1.0) * cClusterViewProj;
+    vec2 tile = clamp(floor((clusterPos.xy / clusterPos.w * 0.5 + 0.5) * cClusterParams.xy), vec2(0.0, 0.0),
+        cClusterParams.xy - 1.0);
+    float slice = clamp(floor(log(max(depth, 0.000001)) * cClusterParams.z + cClusterParams.w), 0.0, NUMCLUSTERSZ - 1.0);
+    vec4 cluster = GetClusterTexel(CLUSTERGRIDSTART + (slice * cClusterParams.y + tile.y) * cClusterParams.x + tile.x);
+
+    vec3 eyeVec = cCameraPosPS - worldPos;
+    vec3 finalColor = vec3(0.0, 0.0, 0.0);
+
+    for (int i = 0; i < MAXLIGHTSPERCLUSTER; ++i)
+    {
+        if (float(i) >= cluster.y)
+            break;
+
+        // Light parameters are in the vertex light layout, followed by the specular intensity
+        float lightIndex = GetClusterTexel(CLUSTERINDEXSTART + cluster.x + float(i)).r * 4.0;
+        vec4 lightColor = GetClusterTexel(lightIndex);
+        vec4 lightDir = GetClusterTexel(lightIndex + 1.0);
+        vec4 lightPos = GetClusterTexel(lightIndex + 2.0);
+        float specIntensity = GetClusterTexel(lightIndex + 3.0).r;
+
+        vec3 lightVec = (lightPos.xyz - worldPos) * lightColor.w;
+        float lightDist = length(lightVec);
+        vec3 localDir = lightVec / lightDist;
+        float atten = clamp(1.0 - lightDist * lightDist, 0.0, 1.0);
+        float spotAtten = clamp((dot(localDir, lightDir.xyz) - lightDir.w) * lightPos.w, 0.0, 1.0);
+        float diff = max(dot(normal, localDir), 0.0) * atten * spotAtten;
+        float spec = GetSpecular(normal, eyeVec, localDir, specularPower) * specIntensity;
+
+        finalColor += diff * lightColor.rgb * (diffColor + spec * specColor);
+    }
+
+    return finalColor;
+}
+#endif
+
 #ifdef SHADOW
 
 #if defined(DIRLIGHT) && (!defined(GL_ES) || defined(WEBGL))
@@ -188,7 +252,7 @@ float GetPointShadow(vec3 lightVec)
     // Read the 2D UV coordinates, adjust according to shadow map size and add face offset
     vec4 indirectPos = textureCube(sIndirectionCubeMap, lightVec);
     indirectPos.xy *= cShadowCubeAdjust.xy;
-    indirectPos.xy += vec2(cShadowCubeAdjust.z + indirectPos.z * 0.5, cShadowCubeAdjust.w + indirectPos.w);
+    indirectPos.xy += cShadowCubeAdjust.zw + indirectPos.zw * cShadowCubeScale;
 
     vec4 shadowPos = vec4(indirectPos.xy, cShadowDepthFade.x + cShadowDepthFade.y / depth, 1.0);
     return GetShadow(shadowPos);
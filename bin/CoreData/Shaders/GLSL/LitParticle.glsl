@@ -28,11 +28,23 @@ void VS()
     mat4 modelMatrix = iModelMatrix;
     vec3 worldPos = GetWorldPos(modelMatrix);
     gl_Position = GetClipPos(worldPos);
-    vTexCoord = GetTexCoord(iTexCoord);
+    #if defined(GPUPARTICLE)
+        vTexCoord = GetTexCoord(GetParticleTexCoord());
+    #elif defined(INSTANCEDBILLBOARD)
+        vTexCoord = GetTexCoord(GetInstancedBillboardTexCoord());
+    #else
+        vTexCoord = GetTexCoord(iTexCoord);
+    #endif
     vWorldPos = vec4(worldPos, GetDepth(gl_Position));
 
     #ifdef VERTEXCOLOR
-        vColor = iColor;
+        #if defined(GPUPARTICLE)
+            vColor = GetParticleColor();
+        #elif defined(INSTANCEDBILLBOARD)
+            vColor = GetInstancedBillboardColor();
+        #else
+            vColor = iColor;
+        #endif
     #endif
 
     #ifdef PERPIXEL
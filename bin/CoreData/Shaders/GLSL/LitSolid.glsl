@@ -13,6 +13,9 @@
 #endif
 varying vec3 vNormal;
 varying vec4 vWorldPos;
+#ifdef TEXARRAY
+    varying float vArrayLayer;
+#endif
 #ifdef VERTEXCOLOR
     varying vec4 vColor;
 #endif
@@ -46,7 +49,11 @@ void VS()
     vWorldPos = vec4(worldPos, GetDepth(gl_Position));
 
     #ifdef VERTEXCOLOR
-        vColor = iColor;
+        #ifdef INSTANCEDBILLBOARD
+            vColor = GetInstancedBillboardColor();
+        #else
+            vColor = iColor;
+        #endif
     #endif
 
     #ifdef NORMALMAP
@@ -54,10 +61,16 @@ void VS()
         vec3 bitangent = cross(tangent, vNormal) * iTangent.w;
         vTexCoord = vec4(GetTexCoord(iTexCoord), bitangent.xy);
         vTangent = vec4(tangent, bitangent.z);
+    #elif defined(INSTANCEDBILLBOARD)
+        vTexCoord = GetTexCoord(GetInstancedBillboardTexCoord());
     #else
         vTexCoord = GetTexCoord(iTexCoord);
     #endif
 
+    #ifdef TEXARRAY
+        vArrayLayer = GetArrayLayer();
+    #endif
+
     #ifdef PERPIXEL
         // Per-pixel forward lighting
         vec4 projWorldPos = vec4(worldPos, 1.0);
@@ -102,9 +115,16 @@ void VS()
 
 void PS()
 {
+    // Select the texture array layer if using texture arrays
+    #ifdef TEXARRAY
+        vec3 texCoord = vec3(vTexCoord.xy, vArrayLayer);
+    #else
+        vec2 texCoord = vTexCoord.xy;
+    #endif
+
     // Get material diffuse albedo
     #ifdef DIFFMAP
-        vec4 diffInput = texture2D(sDiffMap, vTexCoord.xy);
+        vec4 diffInput = texture2D(sDiffMap, texCoord);
         #ifdef ALPHAMASK
             if (diffInput.a < 0.5)
                 discard;
@@ -120,7 +140,7 @@ void PS()
     
     // Get material specular albedo
     #ifdef SPECMAP
-        vec3 specColor = cMatSpecColor.rgb * texture2D(sSpecMap, vTexCoord.xy).rgb;
+        vec3 specColor = cMatSpecColor.rgb * texture2D(sSpecMap, texCoord).rgb;
     #else
         vec3 specColor = cMatSpecColor.rgb;
     #endif
@@ -128,7 +148,7 @@ void PS()
     // Get normal
     #ifdef NORMALMAP
         mat3 tbn = mat3(vTangent.xyz, vec3(vTexCoord.zw, vTangent.w), vNormal);
-        vec3 normal = normalize(tbn * DecodeNormal(texture2D(sNormalMap, vTexCoord.xy)));
+        vec3 normal = normalize(tbn * DecodeNormal(texture2D(sNormalMap, texCoord)));
     #else
         vec3 normal = normalize(vNormal);
     #endif
@@ -214,6 +234,11 @@ void PS()
             // If using AO, the vertex light ambient is black, calculate occluded ambient here
             finalColor += texture2D(sEmissiveMap, vTexCoord2).rgb * cAmbientColor * diffColor.rgb;
         #endif
+
+        #ifdef CLUSTERED
+            // Add all point and spot lights of the pixel's light cluster in one pass
+            finalColor += GetClusteredLight(vWorldPos.xyz, vWorldPos.w, normal, diffColor.rgb, specColor, cMatSpecColor.a);
+        #endif
         
         #ifdef MATERIAL
             // Add light pre-pass accumulation result
@@ -10,14 +10,25 @@
     varying vec4 vScreenPos;
 #endif
 varying vec3 vFarRay;
+#ifdef INSTANCED
+    varying vec4 vLightPos;
+    varying vec4 vLightColor;
+#endif
 #ifdef ORTHO
     varying vec3 vNearRay;
 #endif
 
 void VS()
 {
-    mat4 modelMatrix = iModelMatrix;
-    vec3 worldPos = GetWorldPos(modelMatrix);
+    #ifdef INSTANCED
+        // Instanced point light: the instance holds position & range, color & specular intensity, and inverse range
+        vec3 worldPos = iPos.xyz * iInstanceMatrix1.w + iInstanceMatrix1.xyz;
+        vLightPos = vec4(iInstanceMatrix1.xyz - cCameraPos, iInstanceMatrix3.x);
+        vLightColor = iInstanceMatrix2;
+    #else
+        mat4 modelMatrix = iModelMatrix;
+        vec3 worldPos = GetWorldPos(modelMatrix);
+    #endif
     gl_Position = GetClipPos(worldPos);
     #ifdef DIRLIGHT
         vScreenPos = GetScreenPosPreDiv(gl_Position);
@@ -69,7 +80,13 @@ void PS()
     vec3 lightDir;
 
     // Accumulate light at half intensity to allow 2x "overburn"
-    float diff = 0.5 * GetDiffuse(normal, worldPos, lightDir);
+    #ifdef INSTANCED
+        vec4 lightColorSpec = vLightColor;
+        float diff = 0.5 * GetDiffuse(normal, worldPos, vLightPos, lightDir);
+    #else
+        vec4 lightColorSpec = cLightColor;
+        float diff = 0.5 * GetDiffuse(normal, worldPos, lightDir);
+    #endif
 
     #ifdef SHADOW
         diff *= GetShadowDeferred(projWorldPos, depth);
@@ -77,17 +94,17 @@ void PS()
     
     #if defined(SPOTLIGHT)
         vec4 spotPos = projWorldPos * cLightMatricesPS[0];
-        lightColor = spotPos.w > 0.0 ? texture2DProj(sLightSpotMap, spotPos).rgb * cLightColor.rgb : vec3(0.0);
+        lightColor = spotPos.w > 0.0 ? texture2DProj(sLightSpotMap, spotPos).rgb * lightColorSpec.rgb : vec3(0.0);
     #elif defined(CUBEMASK)
         mat3 lightVecRot = mat3(cLightMatricesPS[0][0].xyz, cLightMatricesPS[0][1].xyz, cLightMatricesPS[0][2].xyz);
-        lightColor = textureCube(sLightCubeMap, (worldPos - cLightPosPS.xyz) * lightVecRot).rgb * cLightColor.rgb;
+        lightColor = textureCube(sLightCubeMap, (worldPos - cLightPosPS.xyz) * lightVecRot).rgb * lightColorSpec.rgb;
     #else
-        lightColor = cLightColor.rgb;
+        lightColor = lightColorSpec.rgb;
     #endif
 
     #ifdef SPECULAR
         float spec = lightColor.g * GetSpecular(normal, -worldPos, lightDir, normalInput.a * 255.0);
-        gl_FragColor = diff * vec4(lightColor, spec * cLightColor.a);
+        gl_FragColor = diff * vec4(lightColor, spec * lightColorSpec.a);
     #else
         gl_FragColor = diff * vec4(lightColor, 0.0);
     #endif
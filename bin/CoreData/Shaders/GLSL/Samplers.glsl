@@ -1,8 +1,14 @@
 #ifdef COMPILEPS
-uniform sampler2D sDiffMap;
+#ifdef TEXARRAY
+    uniform sampler2DArray sDiffMap;
+    uniform sampler2DArray sNormalMap;
+    uniform sampler2DArray sSpecMap;
+#else
+    uniform sampler2D sDiffMap;
+    uniform sampler2D sNormalMap;
+    uniform sampler2D sSpecMap;
+#endif
 uniform samplerCube sDiffCubeMap;
-uniform sampler2D sNormalMap;
-uniform sampler2D sSpecMap;
 uniform sampler2D sEmissiveMap;
 uniform sampler2D sEnvMap;
 uniform samplerCube sEnvCubeMap;
@@ -15,6 +21,7 @@ uniform samplerCube sLightCubeMap;
     uniform sampler2D sNormalBuffer;
     uniform sampler2D sDepthBuffer;
     uniform sampler2D sLightBuffer;
+    uniform sampler2D sLightClusterMap;
     uniform sampler2DShadow sShadowMap;
     uniform samplerCube sFaceSelectCubeMap;
     uniform samplerCube sIndirectionCubeMap;
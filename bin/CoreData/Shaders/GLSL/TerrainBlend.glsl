@@ -54,7 +54,11 @@ void VS()
     gl_Position = GetClipPos(worldPos);
     vNormal = GetWorldNormal(modelMatrix);
     vWorldPos = vec4(worldPos, GetDepth(gl_Position));
-    vTexCoord = GetTexCoord(iTexCoord);
+    #ifdef CDLOD
+        vTexCoord = GetTerrainTexCoord(modelMatrix);
+    #else
+        vTexCoord = GetTexCoord(iTexCoord);
+    #endif
     vDetailTexCoord = cDetailTiling * vTexCoord;
 
     #ifdef PERPIXEL
@@ -16,13 +16,50 @@ attribute vec4 iBlendWeights;
 attribute vec4 iBlendIndices;
 attribute vec3 iCubeTexCoord;
 attribute vec4 iCubeTexCoord2;
-#ifndef GL_ES
+#if !defined(GL_ES) || defined(WEBGL)
     attribute vec4 iInstanceMatrix1;
     attribute vec4 iInstanceMatrix2;
     attribute vec4 iInstanceMatrix3;
 #endif
 
 #ifdef SKINNED
+#ifdef SKINTEXTURE
+// Bone matrix texture with 256 matrices of 3 texels on each row
+uniform sampler2D sSkinMatrixMap;
+
+mat4 GetSkinTextureMatrix(int index)
+{
+    ivec2 texel = ivec2((index % 256) * 3, index / 256);
+    return mat4(texelFetch(sSkinMatrixMap, texel, 0), texelFetch(sSkinMatrixMap, texel + ivec2(1, 0), 0),
+        texelFetch(sSkinMatrixMap, texel + ivec2(2, 0), 0), vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+mat4 GetSkinMatrix(vec4 blendWeights, vec4 blendIndices)
+{
+    ivec4 idx = ivec4(blendIndices) + int(cSkinMatrixOffset);
+    return GetSkinTextureMatrix(idx.x) * blendWeights.x + GetSkinTextureMatrix(idx.y) * blendWeights.y +
+        GetSkinTextureMatrix(idx.z) * blendWeights.z + GetSkinTextureMatrix(idx.w) * blendWeights.w;
+}
+
+#ifdef SKININSTANCED
+// Each instance has its world transform followed by a pose record, which holds the bone matrix texture offsets of the
+// two poses to blend and the blend weight
+mat4 GetSkinInstanceMatrix(vec4 blendWeights, vec4 blendIndices)
+{
+    int record = int(cSkinMatrixOffset) + gl_InstanceID * 2;
+    vec4 pose = texelFetch(sSkinMatrixMap, ivec2(((record + 1) % 256) * 3, (record + 1) / 256), 0);
+    ivec4 idxA = ivec4(blendIndices) + int(pose.x);
+    ivec4 idxB = ivec4(blendIndices) + int(pose.y);
+    vec4 weightsA = blendWeights * (1.0 - pose.z);
+    vec4 weightsB = blendWeights * pose.z;
+    mat4 skinMatrix = GetSkinTextureMatrix(idxA.x) * weightsA.x + GetSkinTextureMatrix(idxA.y) * weightsA.y +
+        GetSkinTextureMatrix(idxA.z) * weightsA.z + GetSkinTextureMatrix(idxA.w) * weightsA.w +
+        GetSkinTextureMatrix(idxB.x) * weightsB.x + GetSkinTextureMatrix(idxB.y) * weightsB.y +
+        GetSkinTextureMatrix(idxB.z) * weightsB.z + GetSkinTextureMatrix(idxB.w) * weightsB.w;
+    return skinMatrix * GetSkinTextureMatrix(record);
+}
+#endif
+#else
 mat4 GetSkinMatrix(vec4 blendWeights, vec4 blendIndices)
 {
     ivec4 idx = ivec4(blendIndices) * 3;
@@ -33,6 +70,7 @@ mat4 GetSkinMatrix(vec4 blendWeights, vec4 blendIndices)
         mat4(cSkinMatrices[idx.w], cSkinMatrices[idx.w + 1], cSkinMatrices[idx.w + 2], lastColumn) * blendWeights.w;
 }
 #endif
+#endif
 
 #ifdef INSTANCED
 mat4 GetInstanceMatrix()
@@ -79,14 +117,192 @@ vec3 GetBillboardPos(vec4 iPos, vec2 iSize, mat4 modelMatrix)
 {
     return (iPos * modelMatrix).xyz + vec3(iSize.x, iSize.y, 0.0) * cBillboardRot;
 }
+#endif
+
+#ifdef INSTANCEDBILLBOARD
+// Hardware instanced billboard. The shared quad holds the corner (iPos.xy) and its UV (iTexCoord), and the instance holds
+// position & rotation (iInstanceMatrix1), size & color packed into two 16-bit pairs (iInstanceMatrix2) and UV rectangle
+// (iInstanceMatrix3)
+vec3 GetInstancedBillboardPos(mat4 modelMatrix)
+{
+    float angle = radians(iInstanceMatrix1.w);
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 corner = iPos.xy * iInstanceMatrix2.xy;
+    vec2 offset = vec2(c * corner.x + s * corner.y, -s * corner.x + c * corner.y);
+    return (vec4(iInstanceMatrix1.xyz, 1.0) * modelMatrix).xyz + vec3(offset, 0.0) * cBillboardRot;
+}
+
+vec4 GetInstancedBillboardColor()
+{
+    vec2 high = floor(iInstanceMatrix2.zw / 256.0);
+    vec2 low = iInstanceMatrix2.zw - high * 256.0;
+    return vec4(high.x, low.x, high.y, low.y) / 255.0;
+}
+
+vec2 GetInstancedBillboardTexCoord()
+{
+    return mix(iInstanceMatrix3.xy, iInstanceMatrix3.zw, iTexCoord);
+}
+#endif
 
+#if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
 vec3 GetBillboardNormal()
 {
     return vec3(-cBillboardRot[0][2], -cBillboardRot[1][2], -cBillboardRot[2][2]);
 }
 #endif
 
-#if defined(SKINNED)
+#ifdef GPUPARTICLE
+// Stateless particle simulation. The vertex holds the start position (iPos), start velocity (iNormal), quad corner
+// (iTexCoord), half size (iTexCoord2) and spawn time, time to live, rotation & rotation speed (iTangent)
+uniform float cParticleTime;
+uniform vec4 cParticleForce;
+uniform vec2 cParticleSize;
+uniform vec4 cParticleColorTimes;
+uniform vec4 cParticleColor0;
+uniform vec4 cParticleColor1;
+uniform vec4 cParticleColor2;
+uniform vec4 cParticleColor3;
+uniform vec4 cParticleUVTimes;
+uniform vec4 cParticleUV0;
+uniform vec4 cParticleUV1;
+uniform vec4 cParticleUV2;
+uniform vec4 cParticleUV3;
+
+float GetParticleAge()
+{
+    return cParticleTime - iTangent.x;
+}
+
+vec3 GetParticlePos(mat4 modelMatrix)
+{
+    float age = GetParticleAge();
+    vec3 center = iPos.xyz;
+    float scale = 0.0;
+
+    // Particles that are dead or not yet spawned collapse to a zero-area quad
+    if (age >= 0.0 && age < iTangent.y)
+    {
+        // Constant force with linear damping, integrated in closed form
+        float damping = cParticleForce.w;
+        if (abs(damping) > 0.0001)
+        {
+            vec3 terminal = cParticleForce.xyz / damping;
+            center += terminal * age + (iNormal - terminal) * (1.0 - exp(-damping * age)) / damping;
+        }
+        else
+            center += iNormal * age + 0.5 * cParticleForce.xyz * age * age;
+
+        float sizeAdd = cParticleSize.x;
+        float sizeRate = cParticleSize.y;
+        if (abs(sizeRate) > 0.0001)
+            scale = (1.0 + sizeAdd / sizeRate) * exp(sizeRate * age) - sizeAdd / sizeRate;
+        else
+            scale = 1.0 + sizeAdd * age;
+        scale = max(scale, 0.0);
+    }
+
+    float angle = radians(iTangent.z + iTangent.w * age);
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 corner = vec2(iTexCoord.x * 2.0 - 1.0, 1.0 - iTexCoord.y * 2.0) * iTexCoord2 * scale;
+    vec2 offset = vec2(c * corner.x + s * corner.y, -s * corner.x + c * corner.y);
+    return (vec4(center, 1.0) * modelMatrix).xyz + vec3(offset, 0.0) * cBillboardRot;
+}
+
+vec4 GetParticleColor()
+{
+    float age = GetParticleAge();
+    vec4 times = cParticleColorTimes;
+    if (age < times.y)
+        return mix(cParticleColor0, cParticleColor1, clamp((age - times.x) / max(times.y - times.x, 0.0001), 0.0, 1.0));
+    else if (age < times.z)
+        return mix(cParticleColor1, cParticleColor2, clamp((age - times.y) / max(times.z - times.y, 0.0001), 0.0, 1.0));
+    else if (age < times.w)
+        return mix(cParticleColor2, cParticleColor3, clamp((age - times.z) / max(times.w - times.z, 0.0001), 0.0, 1.0));
+    else
+        return cParticleColor3;
+}
+
+vec2 GetParticleTexCoord()
+{
+    float age = GetParticleAge();
+    vec4 times = cParticleUVTimes;
+    vec4 uv = age >= times.w ? cParticleUV3 : (age >= times.z ? cParticleUV2 : (age >= times.y ? cParticleUV1 : cParticleUV0));
+    return mix(uv.xy, uv.zw, iTexCoord);
+}
+#endif
+
+#ifdef CDLOD
+// Quadtree terrain node. The grid vertex (iPos.xz) spans the node in the 0-1 range and the model matrix maps it to the
+// node's area. Heights are fetched from the height tile texture and the odd grid vertices morph to the next coarser LOD
+// level as the camera distance approaches the end of the node's LOD range
+uniform sampler2D sHeightMap;
+uniform vec4 cTerrainTexelX;
+uniform vec4 cTerrainTexelZ;
+uniform vec4 cTerrainUVX;
+uniform vec4 cTerrainUVZ;
+uniform vec3 cTerrainMorph;
+
+float GetTerrainHeight(vec3 flatPos, vec2 texelOffset)
+{
+    vec4 pos = vec4(flatPos, 1.0);
+    vec2 texel = vec2(dot(pos, cTerrainTexelX), dot(pos, cTerrainTexelZ)) + texelOffset;
+    return texelFetch(sHeightMap, ivec2(floor(texel + 0.5)), 0).r;
+}
+
+vec4 GetTerrainGridPos(mat4 modelMatrix)
+{
+    vec4 gridPos = vec4(iPos.x, 0.0, iPos.z, 1.0);
+    vec3 flatPos = (gridPos * modelMatrix).xyz;
+    vec3 heightAxis = (vec4(0.0, 1.0, 0.0, 0.0) * modelMatrix).xyz;
+    float nodeSize = max(length((vec4(1.0, 0.0, 0.0, 0.0) * modelMatrix).xyz),
+        length((vec4(0.0, 0.0, 1.0, 0.0) * modelMatrix).xyz));
+    float dist = distance(flatPos + heightAxis * GetTerrainHeight(flatPos, vec2(0.0)), cCameraPos);
+    float morph = clamp((dist / nodeSize - cTerrainMorph.x) / (cTerrainMorph.y - cTerrainMorph.x), 0.0, 1.0);
+    gridPos.xz -= fract(gridPos.xz * cTerrainMorph.z * 0.5) * 2.0 / cTerrainMorph.z * morph;
+    return gridPos;
+}
+
+vec3 GetTerrainPos(mat4 modelMatrix)
+{
+    vec4 gridPos = GetTerrainGridPos(modelMatrix);
+    gridPos.y = GetTerrainHeight((gridPos * modelMatrix).xyz, vec2(0.0));
+    return (gridPos * modelMatrix).xyz;
+}
+
+vec3 GetTerrainNormal(mat4 modelMatrix)
+{
+    vec4 gridPos = GetTerrainGridPos(modelMatrix);
+    vec3 flatPos = (gridPos * modelMatrix).xyz;
+    // Central differences over one height texel, which is one grid quad
+    float halfGrid = 0.5 * cTerrainMorph.z;
+    float dx = (GetTerrainHeight(flatPos, vec2(1.0, 0.0)) - GetTerrainHeight(flatPos, vec2(-1.0, 0.0))) * halfGrid;
+    float dz = (GetTerrainHeight(flatPos, vec2(0.0, 1.0)) - GetTerrainHeight(flatPos, vec2(0.0, -1.0))) * halfGrid;
+    vec3 tangentX = (vec4(1.0, dx, 0.0, 0.0) * modelMatrix).xyz;
+    vec3 tangentZ = (vec4(0.0, dz, 1.0, 0.0) * modelMatrix).xyz;
+    return normalize(cross(tangentZ, tangentX));
+}
+
+vec2 GetTerrainTexCoord(mat4 modelMatrix)
+{
+    vec4 pos = vec4((GetTerrainGridPos(modelMatrix) * modelMatrix).xyz, 1.0);
+    return vec2(dot(pos, cTerrainUVX), dot(pos, cTerrainUVZ));
+}
+#endif
+
+#ifdef TEXARRAY
+// Texture array layers of the instances, packed four to a vector. Non-instanced draws use the first element
+float GetArrayLayer()
+{
+    return cArrayLayers[gl_InstanceID / 4][gl_InstanceID % 4];
+}
+#endif
+
+#if defined(SKININSTANCED)
+    #define iModelMatrix GetSkinInstanceMatrix(iBlendWeights, iBlendIndices)
+#elif defined(SKINNED)
     #define iModelMatrix GetSkinMatrix(iBlendWeights, iBlendIndices)
 #elif defined(INSTANCED)
     #define iModelMatrix GetInstanceMatrix();
@@ -98,6 +314,12 @@ vec3 GetWorldPos(mat4 modelMatrix)
 {
     #if defined(BILLBOARD)
         return GetBillboardPos(iPos, iTexCoord2, modelMatrix);
+    #elif defined(GPUPARTICLE)
+        return GetParticlePos(modelMatrix);
+    #elif defined(INSTANCEDBILLBOARD)
+        return GetInstancedBillboardPos(modelMatrix);
+    #elif defined(CDLOD)
+        return GetTerrainPos(modelMatrix);
     #else
         return (iPos * modelMatrix).xyz;
     #endif
@@ -105,8 +327,10 @@ vec3 GetWorldPos(mat4 modelMatrix)
 
 vec3 GetWorldNormal(mat4 modelMatrix)
 {
-    #if defined(BILLBOARD)
+    #if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
         return GetBillboardNormal();
+    #elif defined(CDLOD)
+        return GetTerrainNormal(modelMatrix);
     #else
         return normalize(iNormal * GetNormalMatrix(modelMatrix));
     #endif
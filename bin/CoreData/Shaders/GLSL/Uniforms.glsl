@@ -1,5 +1,6 @@
-// Use of constant buffers on OpenGL 3 commented out for now as it seems to be slower in practice
-//#define USE_CBUFFERS
+// Use constant buffers on OpenGL 3. Material constant buffers are persistent and bound per material, so that the
+// material parameters are uploaded only once. Comment out to use individual uniforms instead
+#define USE_CBUFFERS
 
 #if !defined(GL3) || !defined(USE_CBUFFERS)
 
@@ -33,7 +34,11 @@ uniform mat4 cZone;
     uniform mat4 cLightMatrices[2];
 #endif
 #ifdef SKINNED
-    uniform vec4 cSkinMatrices[MAXBONES*3];
+    #ifdef SKINTEXTURE
+        uniform float cSkinMatrixOffset;
+    #else
+        uniform vec4 cSkinMatrices[MAXBONES*3];
+    #endif
 #endif
 #ifdef NUMVERTEXLIGHTS
     uniform vec4 cVertexLights[4*3];
@@ -41,6 +46,9 @@ uniform mat4 cZone;
 #ifdef GL3
     uniform vec4 cClipPlane;
 #endif
+#ifdef TEXARRAY
+    uniform vec4 cArrayLayers[32];
+#endif
 #endif
 
 #ifdef COMPILEPS
@@ -52,6 +60,8 @@ uniform mat4 cZone;
 
 uniform vec3 cAmbientColor;
 uniform vec3 cCameraPosPS;
+uniform vec4 cClusterParams;
+uniform mat4 cClusterViewProj;
 uniform float cDeltaTimePS;
 uniform vec4 cDepthReconstruct;
 uniform float cElapsedTimePS;
@@ -68,6 +78,7 @@ uniform vec4 cMatSpecColor;
 uniform float cNearClipPS;
 uniform float cFarClipPS;
 uniform vec4 cShadowCubeAdjust;
+uniform vec2 cShadowCubeScale;
 uniform vec4 cShadowDepthFade;
 uniform vec2 cShadowIntensity;
 uniform vec2 cShadowMapInvSize;
@@ -130,11 +141,18 @@ uniform MaterialVS
 uniform ObjectVS
 {
     mat4 cModel;
-#ifdef BILLBOARD
+#if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
     mat3 cBillboardRot;
 #endif
 #ifdef SKINNED
-    uniform vec4 cSkinMatrices[MAXBONES*3];
+    #ifdef SKINTEXTURE
+        float cSkinMatrixOffset;
+    #else
+        uniform vec4 cSkinMatrices[MAXBONES*3];
+    #endif
+#endif
+#ifdef TEXARRAY
+    vec4 cArrayLayers[32];
 #endif
 };
 
@@ -156,6 +174,8 @@ uniform CameraPS
     vec2 cGBufferInvSize;
     float cNearClipPS;
     float cFarClipPS;
+    vec4 cClusterParams;
+    mat4 cClusterViewProj;
 };
 
 uniform ZonePS
@@ -171,6 +191,7 @@ uniform LightPS
     vec4 cLightPosPS;
     vec3 cLightDirPS;
     vec4 cShadowCubeAdjust;
+    vec2 cShadowCubeScale;
     vec4 cShadowDepthFade;
     vec2 cShadowIntensity;
     vec2 cShadowMapInvSize;
@@ -7,17 +7,27 @@ void VS(float4 iPos : POSITION,
         float4 iBlendWeights : BLENDWEIGHT,
         int4 iBlendIndices : BLENDINDICES,
     #endif
+    #ifdef SKININSTANCED
+        uint iInstanceID : SV_InstanceID,
+    #endif
     #ifdef INSTANCED
         float4x3 iModelInstance : TEXCOORD2,
     #endif
+    #ifdef INSTANCEDBILLBOARD
+        float4 iInstanceMatrix1 : TEXCOORD2,
+        float4 iInstanceMatrix2 : TEXCOORD3,
+        float4 iInstanceMatrix3 : TEXCOORD4,
+    #endif
     #ifdef BILLBOARD
         float2 iSize : TEXCOORD1,
     #endif
     #ifdef DIFFMAP
         float2 iTexCoord : TEXCOORD0,
     #endif
-    #ifdef VERTEXCOLOR
+    #if defined(VERTEXCOLOR) && !defined(INSTANCEDBILLBOARD)
         float4 iColor : COLOR0,
+    #endif
+    #ifdef VERTEXCOLOR
         out float4 oColor : COLOR0,
     #endif
     #ifdef DIFFMAP
@@ -37,10 +47,18 @@ void VS(float4 iPos : POSITION,
     #endif
 
     #ifdef VERTEXCOLOR
-        oColor = iColor;
+        #ifdef INSTANCEDBILLBOARD
+            oColor = GetInstancedBillboardColor(iInstanceMatrix2);
+        #else
+            oColor = iColor;
+        #endif
     #endif
     #ifdef DIFFMAP
-        oTexCoord = iTexCoord;
+        #ifdef INSTANCEDBILLBOARD
+            oTexCoord = GetInstancedBillboardTexCoord(iTexCoord, iInstanceMatrix3);
+        #else
+            oTexCoord = iTexCoord;
+        #endif
     #endif
 }
 
@@ -77,4 +95,7 @@ void PS(
         float alphaInput = Sample2D(DiffMap, iTexCoord).a;
         oColor = float4(diffColor.rgb, diffColor.a * alphaInput);
     #endif
+    #ifdef PREMULALPHA
+        oColor.rgb *= oColor.a;
+    #endif
 }
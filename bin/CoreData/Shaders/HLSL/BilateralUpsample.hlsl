@@ -0,0 +1,67 @@
+#include "Uniforms.hlsl"
+#include "Samplers.hlsl"
+#include "Transform.hlsl"
+#include "ScreenPos.hlsl"
+
+#ifndef D3D11
+
+// D3D9 uniforms
+uniform float2 cUpsampleInvSize;
+
+#else
+
+#ifdef COMPILEPS
+// D3D11 constant buffers
+cbuffer CustomPS : register(b6)
+{
+    float2 cUpsampleInvSize;
+}
+#endif
+
+#endif
+
+#ifdef COMPILEPS
+float GetUpsampleDepth(float2 uv)
+{
+    #ifdef HWDEPTH
+        return ReconstructDepth(Sample2DLod0(DepthBuffer, uv).r);
+    #else
+        return Sample2DLod0(DepthBuffer, uv).r;
+    #endif
+}
+#endif
+
+void VS(float4 iPos : POSITION,
+    out float2 oScreenPos : TEXCOORD0,
+    out float4 oPos : OUTPOSITION)
+{
+    float4x3 modelMatrix = iModelMatrix;
+    float3 worldPos = GetWorldPos(modelMatrix);
+    oPos = GetClipPos(worldPos);
+    oScreenPos = GetScreenPosPreDiv(oPos);
+}
+
+void PS(float2 iScreenPos : TEXCOORD0,
+    out float4 oColor : OUTCOLOR0)
+{
+    // Locate the four low resolution texels surrounding the pixel
+    float2 lowPos = iScreenPos / cUpsampleInvSize - 0.5;
+    float2 base = floor(lowPos);
+    float2 f = lowPos - base;
+    float2 minUV = 0.5 * cUpsampleInvSize;
+    float2 maxUV = 1.0 - minUV;
+    float2 uv00 = clamp((base + 0.5) * cUpsampleInvSize, minUV, maxUV);
+    float2 uv11 = clamp((base + 1.5) * cUpsampleInvSize, minUV, maxUV);
+    float2 uv10 = float2(uv11.x, uv00.y);
+    float2 uv01 = float2(uv00.x, uv11.y);
+
+    // Bilinear weights, reduced for texels whose depth differs from the full resolution pixel
+    float depth = GetUpsampleDepth(iScreenPos);
+    float4 depths = float4(GetUpsampleDepth(uv00), GetUpsampleDepth(uv10), GetUpsampleDepth(uv01), GetUpsampleDepth(uv11));
+    float4 weights = float4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    weights /= 1e-3 + abs(depths - depth) / max(depth, 1e-5);
+
+    oColor = (Sample2D(DiffMap, uv00) * weights.x + Sample2D(DiffMap, uv10) * weights.y +
+        Sample2D(DiffMap, uv01) * weights.z + Sample2D(DiffMap, uv11) * weights.w) /
+        dot(weights, 1.0);
+}
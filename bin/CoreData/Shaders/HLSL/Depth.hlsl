@@ -7,6 +7,9 @@ void VS(float4 iPos : POSITION,
         float4 iBlendWeights : BLENDWEIGHT,
         int4 iBlendIndices : BLENDINDICES,
     #endif
+    #ifdef SKININSTANCED
+        uint iInstanceID : SV_InstanceID,
+    #endif
     #ifdef INSTANCED
         float4x3 iModelInstance : TEXCOORD2,
     #endif
@@ -0,0 +1,56 @@
+#include "Uniforms.hlsl"
+#include "Samplers.hlsl"
+#include "Transform.hlsl"
+#include "ScreenPos.hlsl"
+
+#ifndef D3D11
+
+// D3D9 uniforms
+uniform float2 cDepthPyramidSrcInvSize;
+uniform float2 cDepthPyramidDestSize;
+
+#else
+
+// D3D11 constant buffers
+#ifdef COMPILEPS
+cbuffer CustomPS : register(b6)
+{
+    float2 cDepthPyramidSrcInvSize;
+    float2 cDepthPyramidDestSize;
+}
+#endif
+
+#endif
+
+void VS(float4 iPos : POSITION,
+    out float2 oScreenPos : TEXCOORD0,
+    out float4 oPos : OUTPOSITION)
+{
+    float4x3 modelMatrix = iModelMatrix;
+    float3 worldPos = GetWorldPos(modelMatrix);
+    oPos = GetClipPos(worldPos);
+    oScreenPos = GetScreenPosPreDiv(oPos);
+}
+
+void PS(float2 iScreenPos : TEXCOORD0,
+    out float4 oColor : OUTCOLOR0)
+{
+    #ifdef FIRSTLEVEL
+        // Copy the linear depth: minimum and maximum are the same
+        float depth = Sample2DLod0(DepthBuffer, iScreenPos).r;
+        #ifdef HWDEPTH
+            depth = ReconstructDepth(depth);
+        #endif
+        oColor = float4(depth, depth, 0.0, 0.0);
+    #else
+        // Take the min & max of the 2x2 block of the previous level. On odd-sized levels clamp to the last texel instead
+        // of wrapping around
+        float2 srcPos = (floor(iScreenPos * cDepthPyramidDestSize) * 2.0 + 0.5) * cDepthPyramidSrcInvSize;
+        float2 maxPos = 1.0 - 0.5 * cDepthPyramidSrcInvSize;
+        float2 d0 = Sample2DLod0(DiffMap, srcPos).rg;
+        float2 d1 = Sample2DLod0(DiffMap, min(srcPos + float2(cDepthPyramidSrcInvSize.x, 0.0), maxPos)).rg;
+        float2 d2 = Sample2DLod0(DiffMap, min(srcPos + float2(0.0, cDepthPyramidSrcInvSize.y), maxPos)).rg;
+        float2 d3 = Sample2DLod0(DiffMap, min(srcPos + cDepthPyramidSrcInvSize, maxPos)).rg;
+        oColor = float4(min(min(d0.x, d1.x), min(d2.x, d3.x)), max(max(d0.y, d1.y), max(d2.y, d3.y)), 0.0, 0.0);
+    #endif
+}
@@ -101,6 +101,15 @@ float GetDiffuse(float3 normal, float3 worldPos, out float3 lightDir)
     #endif
 }
 
+// Point light diffuse term with the position & inverse range given explicitly, used by instanced light volumes
+float GetDiffuse(float3 normal, float3 worldPos, float4 lightPos, out float3 lightDir)
+{
+    float3 lightVec = (lightPos.xyz - worldPos) * lightPos.w;
+    float lightDist = length(lightVec);
+    lightDir = lightVec / lightDist;
+    return saturate(dot(normal, lightDir)) * Sample2D(LightRampMap, float2(lightDist, 0.0)).r;
+}
+
 float GetDiffuseVolumetric(float3 worldPos)
 {
     #ifdef DIRLIGHT
@@ -123,6 +132,60 @@ float GetIntensity(float3 color)
     return dot(color, float3(0.299, 0.587, 0.114));
 }
 
+#ifdef CLUSTERED
+// Light cluster texture layout. Must match the light cluster constants in Renderer.h
+#define NUMCLUSTERSZ 24.0
+#define MAXLIGHTSPERCLUSTER 32
+#define CLUSTERTEXWIDTH 1024.0
+#define CLUSTERTEXHEIGHT 16.0
+#define CLUSTERGRIDSTART 1024.0
+#define CLUSTERINDEXSTART 4096.0
+
+float4 GetClusterTexel(float index)
+{
+    float row = floor(index / CLUSTERTEXWIDTH);
+    float2 uv = float2((index - row * CLUSTERTEXWIDTH + 0.5) / CLUSTERTEXWIDTH, (row + 0.5) / CLUSTERTEXHEIGHT);
+    return Sample2DLod0(LightClusterMap, uv);
+}
+
+float3 GetClusteredLight(float3 worldPos, float depth, float3 normal, float3 diffColor, float3 specColor, float specularPower)
+{
+    // Find the cluster from the screen tile and exponential depth slice
+    float4 clusterPos = mul(float4(worldPos, 1.0), cClusterViewProj);
+    float2 tile = clamp(floor((clusterPos.xy / clusterPos.w * 0.5 + 0.5) * cClusterParams.xy), 0.0, cClusterParams.xy - 1.0);
+    float slice = clamp(floor(log(max(depth, 0.000001)) * cClusterParams.z + cClusterParams.w), 0.0, NUMCLUSTERSZ - 1.0);
+    float4 cluster = GetClusterTexel(CLUSTERGRIDSTART + (slice * cClusterParams.y + tile.y) * cClusterParams.x + tile.x);
+
+    float3 eyeVec = cCameraPosPS - worldPos;
+    float3 finalColor = 0.0;
+
+    [loop] for (int i = 0; i < MAXLIGHTSPERCLUSTER; ++i)
+    {
+        if (float(i) >= cluster.y)
+            break;
+
+        // Light parameters are in the vertex light layout, followed by the specular intensity
+        float lightIndex = GetClusterTexel(CLUSTERINDEXSTART + cluster.x + float(i)).r * 4.0;
+        float4 lightColor = GetClusterTexel(lightIndex);
+        float4 lightDir = GetClusterTexel(lightIndex + 1.0);
+        float4 lightPos = GetClusterTexel(lightIndex + 2.0);
+        float specIntensity = GetClusterTexel(lightIndex + 3.0).r;
+
+        float3 lightVec = (lightPos.xyz - worldPos) * lightColor.w;
+        float lightDist = length(lightVec);
+        float3 localDir = lightVec / lightDist;
+        float atten = saturate(1.0 - lightDist * lightDist);
+        float spotAtten = saturate((dot(localDir, lightDir.xyz) - lightDir.w) * lightPos.w);
+        float diff = saturate(dot(normal, localDir)) * atten * spotAtten;
+        float spec = GetSpecular(normal, eyeVec, localDir, specularPower) * specIntensity;
+
+        finalColor += diff * lightColor.rgb * (diffColor + spec * specColor);
+    }
+
+    return finalColor;
+}
+#endif
+
 #ifdef SHADOW
 
 #ifdef DIRLIGHT
@@ -194,7 +257,7 @@ float GetPointShadow(float3 lightVec)
     // Read the 2D UV coordinates, adjust according to shadow map size and add face offset
     float4 indirectPos = SampleCube(IndirectionCubeMap, lightVec);
     indirectPos.xy *= cShadowCubeAdjust.xy;
-    indirectPos.xy += float2(cShadowCubeAdjust.z + indirectPos.z * 0.5, cShadowCubeAdjust.w + indirectPos.w);
+    indirectPos.xy += cShadowCubeAdjust.zw + indirectPos.zw * cShadowCubeScale;
 
     float4 shadowPos = float4(indirectPos.xy, cShadowDepthFade.x + cShadowDepthFade.y / depth, 1.0);
     return GetShadow(shadowPos);
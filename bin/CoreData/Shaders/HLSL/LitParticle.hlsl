@@ -5,25 +5,36 @@
 #include "Fog.hlsl"
 
 void VS(float4 iPos : POSITION,
-    #ifndef BILLBOARD
+    #if !defined(BILLBOARD) && !defined(INSTANCEDBILLBOARD)
         float3 iNormal : NORMAL,
     #endif
     #ifndef NOUV
         float2 iTexCoord : TEXCOORD0,
     #endif
-    #ifdef VERTEXCOLOR
+    #if defined(VERTEXCOLOR) && !defined(GPUPARTICLE) && !defined(INSTANCEDBILLBOARD)
         float4 iColor : COLOR0,
     #endif
     #ifdef SKINNED
         float4 iBlendWeights : BLENDWEIGHT,
         int4 iBlendIndices : BLENDINDICES,
     #endif
+    #ifdef SKININSTANCED
+        uint iInstanceID : SV_InstanceID,
+    #endif
     #ifdef INSTANCED
         float4x3 iModelInstance : TEXCOORD2,
     #endif
-    #ifdef BILLBOARD
+    #ifdef INSTANCEDBILLBOARD
+        float4 iInstanceMatrix1 : TEXCOORD2,
+        float4 iInstanceMatrix2 : TEXCOORD3,
+        float4 iInstanceMatrix3 : TEXCOORD4,
+    #endif
+    #if defined(BILLBOARD) || defined(GPUPARTICLE)
         float2 iSize : TEXCOORD1,
     #endif
+    #ifdef GPUPARTICLE
+        float4 iTangent : TANGENT,
+    #endif
     out float2 oTexCoord : TEXCOORD0,
     out float4 oWorldPos : TEXCOORD3,
     #if PERPIXEL
@@ -55,7 +66,13 @@ void VS(float4 iPos : POSITION,
     float4x3 modelMatrix = iModelMatrix;
     float3 worldPos = GetWorldPos(modelMatrix);
     oPos = GetClipPos(worldPos);
-    oTexCoord = GetTexCoord(iTexCoord);
+    #if defined(GPUPARTICLE)
+        oTexCoord = GetTexCoord(GetParticleTexCoord(iTexCoord, iTangent));
+    #elif defined(INSTANCEDBILLBOARD)
+        oTexCoord = GetTexCoord(GetInstancedBillboardTexCoord(iTexCoord, iInstanceMatrix3));
+    #else
+        oTexCoord = GetTexCoord(iTexCoord);
+    #endif
     oWorldPos = float4(worldPos, GetDepth(oPos));
 
     #if defined(D3D11) && defined(CLIPPLANE)
@@ -63,7 +80,13 @@ void VS(float4 iPos : POSITION,
     #endif
 
     #ifdef VERTEXCOLOR
-        oColor = iColor;
+        #if defined(GPUPARTICLE)
+            oColor = GetParticleColor(iTangent);
+        #elif defined(INSTANCEDBILLBOARD)
+            oColor = GetInstancedBillboardColor(iInstanceMatrix2);
+        #else
+            oColor = iColor;
+        #endif
     #endif
 
     #ifdef PERPIXEL
@@ -6,13 +6,13 @@
 #include "Fog.hlsl"
 
 void VS(float4 iPos : POSITION,
-    #ifndef BILLBOARD
+    #if !defined(BILLBOARD) && !defined(INSTANCEDBILLBOARD)
         float3 iNormal : NORMAL,
     #endif
     #ifndef NOUV
         float2 iTexCoord : TEXCOORD0,
     #endif
-    #ifdef VERTEXCOLOR
+    #if defined(VERTEXCOLOR) && !defined(INSTANCEDBILLBOARD)
         float4 iColor : COLOR0,
     #endif
     #if defined(LIGHTMAP) || defined(AO)
@@ -25,9 +25,17 @@ void VS(float4 iPos : POSITION,
         float4 iBlendWeights : BLENDWEIGHT,
         int4 iBlendIndices : BLENDINDICES,
     #endif
+    #if defined(SKININSTANCED) || defined(TEXARRAY)
+        uint iInstanceID : SV_InstanceID,
+    #endif
     #ifdef INSTANCED
         float4x3 iModelInstance : TEXCOORD2,
     #endif
+    #ifdef INSTANCEDBILLBOARD
+        float4 iInstanceMatrix1 : TEXCOORD2,
+        float4 iInstanceMatrix2 : TEXCOORD3,
+        float4 iInstanceMatrix3 : TEXCOORD4,
+    #endif
     #ifdef BILLBOARD
         float2 iSize : TEXCOORD1,
     #endif
@@ -39,6 +47,9 @@ void VS(float4 iPos : POSITION,
     #endif
     out float3 oNormal : TEXCOORD1,
     out float4 oWorldPos : TEXCOORD2,
+    #ifdef TEXARRAY
+        out float oArrayLayer : TEXCOORD8,
+    #endif
     #ifdef PERPIXEL
         #ifdef SHADOW
             out float4 oShadowPos[NUMCASCADES] : TEXCOORD4,
@@ -83,7 +94,11 @@ void VS(float4 iPos : POSITION,
     #endif
 
     #ifdef VERTEXCOLOR
-        oColor = iColor;
+        #ifdef INSTANCEDBILLBOARD
+            oColor = GetInstancedBillboardColor(iInstanceMatrix2);
+        #else
+            oColor = iColor;
+        #endif
     #endif
 
     #ifdef NORMALMAP
@@ -91,10 +106,16 @@ void VS(float4 iPos : POSITION,
         float3 bitangent = cross(tangent, oNormal) * iTangent.w;
         oTexCoord = float4(GetTexCoord(iTexCoord), bitangent.xy);
         oTangent = float4(tangent, bitangent.z);
+    #elif defined(INSTANCEDBILLBOARD)
+        oTexCoord = GetTexCoord(GetInstancedBillboardTexCoord(iTexCoord, iInstanceMatrix3));
     #else
         oTexCoord = GetTexCoord(iTexCoord);
     #endif
 
+    #ifdef TEXARRAY
+        oArrayLayer = GetArrayLayer(iInstanceID);
+    #endif
+
     #ifdef PERPIXEL
         // Per-pixel forward lighting
         float4 projWorldPos = float4(worldPos.xyz, 1.0);
@@ -145,6 +166,9 @@ void PS(
     #endif
     float3 iNormal : TEXCOORD1,
     float4 iWorldPos : TEXCOORD2,
+    #ifdef TEXARRAY
+        float iArrayLayer : TEXCOORD8,
+    #endif
     #ifdef PERPIXEL
         #ifdef SHADOW
             float4 iShadowPos[NUMCASCADES] : TEXCOORD4,
@@ -181,9 +205,16 @@ void PS(
     #endif
     out float4 oColor : OUTCOLOR0)
 {
+    // Select the texture array layer if using texture arrays
+    #ifdef TEXARRAY
+        float3 texCoord = float3(iTexCoord.xy, iArrayLayer);
+    #else
+        float2 texCoord = iTexCoord.xy;
+    #endif
+
     // Get material diffuse albedo
     #ifdef DIFFMAP
-        float4 diffInput = Sample2D(DiffMap, iTexCoord.xy);
+        float4 diffInput = Sample2D(DiffMap, texCoord);
         #ifdef ALPHAMASK
             if (diffInput.a < 0.5)
                 discard;
@@ -199,7 +230,7 @@ void PS(
 
     // Get material specular albedo
     #ifdef SPECMAP
-        float3 specColor = cMatSpecColor.rgb * Sample2D(SpecMap, iTexCoord.xy).rgb;
+        float3 specColor = cMatSpecColor.rgb * Sample2D(SpecMap, texCoord).rgb;
     #else
         float3 specColor = cMatSpecColor.rgb;
     #endif
@@ -207,7 +238,7 @@ void PS(
     // Get normal
     #ifdef NORMALMAP
         float3x3 tbn = float3x3(iTangent.xyz, float3(iTexCoord.zw, iTangent.w), iNormal);
-        float3 normal = normalize(mul(DecodeNormal(Sample2D(NormalMap, iTexCoord.xy)), tbn));
+        float3 normal = normalize(mul(DecodeNormal(Sample2D(NormalMap, texCoord)), tbn));
     #else
         float3 normal = normalize(iNormal);
     #endif
@@ -293,6 +324,11 @@ void PS(
             finalColor += Sample2D(EmissiveMap, iTexCoord2).rgb * cAmbientColor * diffColor.rgb;
         #endif
 
+        #ifdef CLUSTERED
+            // Add all point and spot lights of the pixel's light cluster in one pass
+            finalColor += GetClusteredLight(iWorldPos.xyz, iWorldPos.w, normal, diffColor.rgb, specColor, cMatSpecColor.a);
+        #endif
+
         #ifdef MATERIAL
             // Add light pre-pass accumulation result
             // Lights are accumulated at half intensity. Bring back to full intensity now
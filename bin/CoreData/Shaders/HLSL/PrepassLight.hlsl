@@ -5,6 +5,11 @@
 #include "Lighting.hlsl"
 
 void VS(float4 iPos : POSITION,
+    #ifdef INSTANCED
+        float4 iInstanceMatrix1 : TEXCOORD2,
+        float4 iInstanceMatrix2 : TEXCOORD3,
+        float4 iInstanceMatrix3 : TEXCOORD4,
+    #endif
     #ifdef DIRLIGHT
         out float2 oScreenPos : TEXCOORD0,
     #else
@@ -14,10 +19,21 @@ void VS(float4 iPos : POSITION,
     #ifdef ORTHO
         out float3 oNearRay : TEXCOORD2,
     #endif
+    #ifdef INSTANCED
+        out float4 oLightPos : TEXCOORD3,
+        out float4 oLightColor : TEXCOORD4,
+    #endif
     out float4 oPos : OUTPOSITION)
 {
-    float4x3 modelMatrix = iModelMatrix;
-    float3 worldPos = GetWorldPos(modelMatrix);
+    #ifdef INSTANCED
+        // Instanced point light: the instance holds position & range, color & specular intensity, and inverse range
+        float3 worldPos = iPos.xyz * iInstanceMatrix1.w + iInstanceMatrix1.xyz;
+        oLightPos = float4(iInstanceMatrix1.xyz - cCameraPos, iInstanceMatrix3.x);
+        oLightColor = iInstanceMatrix2;
+    #else
+        float4x3 modelMatrix = iModelMatrix;
+        float3 worldPos = GetWorldPos(modelMatrix);
+    #endif
     oPos = GetClipPos(worldPos);
     #ifdef DIRLIGHT
         oScreenPos = GetScreenPosPreDiv(oPos);
@@ -44,6 +60,10 @@ void PS(
     #ifdef ORTHO
         float3 iNearRay : TEXCOORD2,
     #endif
+    #ifdef INSTANCED
+        float4 iLightPos : TEXCOORD3,
+        float4 iLightColor : TEXCOORD4,
+    #endif
     out float4 oColor : OUTCOLOR0)
 {
     // If rendering a directional light quad, optimize out the w divide
@@ -77,7 +97,13 @@ void PS(
     float3 lightDir;
 
     // Accumulate light at half intensity to allow 2x "overburn"
-    float diff = 0.5 * GetDiffuse(normal, worldPos, lightDir);
+    #ifdef INSTANCED
+        float4 lightColorSpec = iLightColor;
+        float diff = 0.5 * GetDiffuse(normal, worldPos, iLightPos, lightDir);
+    #else
+        float4 lightColorSpec = cLightColor;
+        float diff = 0.5 * GetDiffuse(normal, worldPos, lightDir);
+    #endif
 
     #ifdef SHADOW
         diff *= GetShadowDeferred(projWorldPos, depth);
@@ -85,16 +111,16 @@ void PS(
 
     #if defined(SPOTLIGHT)
         float4 spotPos = mul(projWorldPos, cLightMatricesPS[0]);
-        lightColor = spotPos.w > 0.0 ? Sample2DProj(LightSpotMap, spotPos).rgb * cLightColor.rgb : 0.0;
+        lightColor = spotPos.w > 0.0 ? Sample2DProj(LightSpotMap, spotPos).rgb * lightColorSpec.rgb : 0.0;
     #elif defined(CUBEMASK)
-        lightColor = texCUBE(sLightCubeMap, mul(worldPos - cLightPosPS.xyz, (float3x3)cLightMatricesPS[0])).rgb * cLightColor.rgb;
+        lightColor = texCUBE(sLightCubeMap, mul(worldPos - cLightPosPS.xyz, (float3x3)cLightMatricesPS[0])).rgb * lightColorSpec.rgb;
     #else
-        lightColor = cLightColor.rgb;
+        lightColor = lightColorSpec.rgb;
     #endif
 
     #ifdef SPECULAR
         float spec = lightColor.g * GetSpecular(normal, -worldPos, lightDir, normalInput.a * 255.0);
-        oColor = diff * float4(lightColor, spec * cLightColor.a);
+        oColor = diff * float4(lightColor, spec * lightColorSpec.a);
     #else
         oColor = diff * float4(lightColor, 0.0);
     #endif
@@ -21,6 +21,7 @@ samplerCUBE sFaceSelectCubeMap : register(s11);
 samplerCUBE sIndirectionCubeMap : register(s12);
 sampler2D sDepthBuffer : register(s13);
 sampler2D sLightBuffer : register(s14);
+sampler2D sLightClusterMap : register(s14);
 samplerCUBE sZoneCubeMap : register(s15);
 sampler3D sZoneVolumeMap : register(s15);
 
@@ -34,12 +35,18 @@ sampler3D sZoneVolumeMap : register(s15);
 
 // D3D11 textures and samplers
 
+#ifdef TEXARRAY
+Texture2DArray tDiffMap : register(t0);
+Texture2DArray tNormalMap : register(t1);
+Texture2DArray tSpecMap : register(t2);
+#else
 Texture2D tDiffMap : register(t0);
+Texture2D tNormalMap : register(t1);
+Texture2D tSpecMap : register(t2);
+#endif
 TextureCube tDiffCubeMap : register(t0);
 Texture2D tAlbedoBuffer : register(t0);
-Texture2D tNormalMap : register(t1);
 Texture2D tNormalBuffer : register(t1);
-Texture2D tSpecMap : register(t2);
 Texture2D tEmissiveMap : register(t3);
 Texture2D tEnvMap : register(t4);
 Texture3D tVolumeMap : register(t5);
@@ -52,6 +59,7 @@ TextureCube tFaceSelectCubeMap : register(t11);
 TextureCube tIndirectionCubeMap : register(t12);
 Texture2D tDepthBuffer : register(t13);
 Texture2D tLightBuffer : register(t14);
+Texture2D tLightClusterMap : register(t14);
 TextureCube tZoneCubeMap : register(t15);
 Texture3D tZoneVolumeMap : register(t15);
 
@@ -73,6 +81,7 @@ SamplerState sFaceSelectCubeMap : register(s11);
 SamplerState sIndirectionCubeMap : register(s12);
 SamplerState sDepthBuffer : register(s13);
 SamplerState sLightBuffer : register(s14);
+SamplerState sLightClusterMap : register(s14);
 SamplerState sZoneCubeMap : register(s15);
 SamplerState sZoneVolumeMap : register(s15);
 
@@ -45,6 +45,9 @@ void VS(float4 iPos : POSITION,
         float4 iBlendWeights : BLENDWEIGHT,
         int4 iBlendIndices : BLENDINDICES,
     #endif
+    #ifdef SKININSTANCED
+        uint iInstanceID : SV_InstanceID,
+    #endif
     #ifdef INSTANCED
         float4x3 iModelInstance : TEXCOORD2,
     #endif
@@ -79,7 +82,11 @@ void VS(float4 iPos : POSITION,
     oPos = GetClipPos(worldPos);
     oNormal = GetWorldNormal(modelMatrix);
     oWorldPos = float4(worldPos, GetDepth(oPos));
-    oTexCoord = GetTexCoord(iTexCoord);
+    #ifdef CDLOD
+        oTexCoord = GetTerrainTexCoord(iPos, modelMatrix);
+    #else
+        oTexCoord = GetTexCoord(iTexCoord);
+    #endif
     oDetailTexCoord = cDetailTiling * oTexCoord;
 
     #if defined(D3D11) && defined(CLIPPLANE)
@@ -7,6 +7,51 @@
 #endif
 
 #ifdef SKINNED
+#ifdef SKINTEXTURE
+// Bone matrix texture with 256 matrices of 3 texels on each row
+Texture2D tSkinMatrixMap : register(t5);
+
+float4x3 GetSkinTextureMatrix(int index)
+{
+    int3 texel = int3((index % 256) * 3, index / 256, 0);
+    return transpose(float3x4(tSkinMatrixMap.Load(texel), tSkinMatrixMap.Load(texel + int3(1, 0, 0)),
+        tSkinMatrixMap.Load(texel + int3(2, 0, 0))));
+}
+
+float4x3 GetSkinMatrix(float4 blendWeights, int4 blendIndices)
+{
+    int4 idx = blendIndices + (int)cSkinMatrixOffset;
+    return GetSkinTextureMatrix(idx.x) * blendWeights.x +
+        GetSkinTextureMatrix(idx.y) * blendWeights.y +
+        GetSkinTextureMatrix(idx.z) * blendWeights.z +
+        GetSkinTextureMatrix(idx.w) * blendWeights.w;
+}
+
+#ifdef SKININSTANCED
+// Each instance has its world transform followed by a pose record, which holds the bone matrix texture offsets of the
+// two poses to blend and the blend weight
+float4x3 GetSkinInstanceMatrix(float4 blendWeights, int4 blendIndices, uint instanceID)
+{
+    int record = (int)cSkinMatrixOffset + (int)instanceID * 2;
+    float4 pose = tSkinMatrixMap.Load(int3(((record + 1) % 256) * 3, (record + 1) / 256, 0));
+    int4 idxA = blendIndices + (int)pose.x;
+    int4 idxB = blendIndices + (int)pose.y;
+    float4 weightsA = blendWeights * (1.0 - pose.z);
+    float4 weightsB = blendWeights * pose.z;
+    float4x3 skinMatrix = GetSkinTextureMatrix(idxA.x) * weightsA.x +
+        GetSkinTextureMatrix(idxA.y) * weightsA.y +
+        GetSkinTextureMatrix(idxA.z) * weightsA.z +
+        GetSkinTextureMatrix(idxA.w) * weightsA.w +
+        GetSkinTextureMatrix(idxB.x) * weightsB.x +
+        GetSkinTextureMatrix(idxB.y) * weightsB.y +
+        GetSkinTextureMatrix(idxB.z) * weightsB.z +
+        GetSkinTextureMatrix(idxB.w) * weightsB.w;
+    float4x4 skinMatrix4 = float4x4(float4(skinMatrix[0], 0.0), float4(skinMatrix[1], 0.0), float4(skinMatrix[2], 0.0),
+        float4(skinMatrix[3], 1.0));
+    return mul(skinMatrix4, GetSkinTextureMatrix(record));
+}
+#endif
+#else
 float4x3 GetSkinMatrix(float4 blendWeights, int4 blendIndices)
 {
     return cSkinMatrices[blendIndices.x] * blendWeights.x +
@@ -15,6 +60,7 @@ float4x3 GetSkinMatrix(float4 blendWeights, int4 blendIndices)
         cSkinMatrices[blendIndices.w] * blendWeights.w;
 }
 #endif
+#endif
 
 float2 GetTexCoord(float2 iTexCoord)
 {
@@ -41,14 +87,200 @@ float3 GetBillboardPos(float4 iPos, float2 iSize, float4x3 modelMatrix)
 {
     return mul(iPos, modelMatrix) + mul(float3(iSize.x, iSize.y, 0.0), cBillboardRot);
 }
+#endif
+
+#ifdef INSTANCEDBILLBOARD
+// Hardware instanced billboard. The shared quad holds the corner (iPos.xy) and its UV (iTexCoord), and the instance holds
+// position & rotation (iInstance1), size & color packed into two 16-bit pairs (iInstance2) and UV rectangle (iInstance3)
+float3 GetInstancedBillboardPos(float4 iPos, float4 iInstance1, float4 iInstance2, float4x3 modelMatrix)
+{
+    float angle = radians(iInstance1.w);
+    float c = cos(angle);
+    float s = sin(angle);
+    float2 corner = iPos.xy * iInstance2.xy;
+    float2 offset = float2(c * corner.x + s * corner.y, -s * corner.x + c * corner.y);
+    return mul(float4(iInstance1.xyz, 1.0), modelMatrix) + mul(float3(offset, 0.0), cBillboardRot);
+}
+
+float4 GetInstancedBillboardColor(float4 iInstance2)
+{
+    float2 high = floor(iInstance2.zw / 256.0);
+    float2 low = iInstance2.zw - high * 256.0;
+    return float4(high.x, low.x, high.y, low.y) / 255.0;
+}
+
+float2 GetInstancedBillboardTexCoord(float2 iCorner, float4 iInstance3)
+{
+    return lerp(iInstance3.xy, iInstance3.zw, iCorner);
+}
+#endif
 
+#if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
 float3 GetBillboardNormal()
 {
     return float3(-cBillboardRot[2][0], -cBillboardRot[2][1], -cBillboardRot[2][2]);
 }
 #endif
 
-#if defined(SKINNED)
+#ifdef GPUPARTICLE
+// Stateless particle simulation. The vertex holds the start position (iPos), start velocity (iNormal), quad corner
+// (iTexCoord), half size (iSize) and spawn time, time to live, rotation & rotation speed (iTangent)
+#ifndef D3D11
+uniform float cParticleTime;
+uniform float4 cParticleForce;
+uniform float2 cParticleSize;
+uniform float4 cParticleColorTimes;
+uniform float4 cParticleColor0;
+uniform float4 cParticleColor1;
+uniform float4 cParticleColor2;
+uniform float4 cParticleColor3;
+uniform float4 cParticleUVTimes;
+uniform float4 cParticleUV0;
+uniform float4 cParticleUV1;
+uniform float4 cParticleUV2;
+uniform float4 cParticleUV3;
+#else
+cbuffer ParticleVS : register(b6)
+{
+    float cParticleTime;
+    float4 cParticleForce;
+    float2 cParticleSize;
+    float4 cParticleColorTimes;
+    float4 cParticleColor0;
+    float4 cParticleColor1;
+    float4 cParticleColor2;
+    float4 cParticleColor3;
+    float4 cParticleUVTimes;
+    float4 cParticleUV0;
+    float4 cParticleUV1;
+    float4 cParticleUV2;
+    float4 cParticleUV3;
+}
+#endif
+
+float3 GetParticlePos(float4 iPos, float3 iVelocity, float2 iCorner, float2 iSize, float4 iParticle, float4x3 modelMatrix)
+{
+    float age = cParticleTime - iParticle.x;
+    float3 center = iPos.xyz;
+    float scale = 0.0;
+
+    // Particles that are dead or not yet spawned collapse to a zero-area quad
+    if (age >= 0.0 && age < iParticle.y)
+    {
+        // Constant force with linear damping, integrated in closed form
+        float damping = cParticleForce.w;
+        if (abs(damping) > 0.0001)
+        {
+            float3 terminal = cParticleForce.xyz / damping;
+            center += terminal * age + (iVelocity - terminal) * (1.0 - exp(-damping * age)) / damping;
+        }
+        else
+            center += iVelocity * age + 0.5 * cParticleForce.xyz * age * age;
+
+        float sizeAdd = cParticleSize.x;
+        float sizeRate = cParticleSize.y;
+        if (abs(sizeRate) > 0.0001)
+            scale = (1.0 + sizeAdd / sizeRate) * exp(sizeRate * age) - sizeAdd / sizeRate;
+        else
+            scale = 1.0 + sizeAdd * age;
+        scale = max(scale, 0.0);
+    }
+
+    float angle = radians(iParticle.z + iParticle.w * age);
+    float c = cos(angle);
+    float s = sin(angle);
+    float2 corner = float2(iCorner.x * 2.0 - 1.0, 1.0 - iCorner.y * 2.0) * iSize * scale;
+    float2 offset = float2(c * corner.x + s * corner.y, -s * corner.x + c * corner.y);
+    return mul(float4(center, 1.0), modelMatrix) + mul(float3(offset, 0.0), cBillboardRot);
+}
+
+float4 GetParticleColor(float4 iParticle)
+{
+    float age = cParticleTime - iParticle.x;
+    float4 times = cParticleColorTimes;
+    if (age < times.y)
+        return lerp(cParticleColor0, cParticleColor1, saturate((age - times.x) / max(times.y - times.x, 0.0001)));
+    else if (age < times.z)
+        return lerp(cParticleColor1, cParticleColor2, saturate((age - times.y) / max(times.z - times.y, 0.0001)));
+    else if (age < times.w)
+        return lerp(cParticleColor2, cParticleColor3, saturate((age - times.z) / max(times.w - times.z, 0.0001)));
+    else
+        return cParticleColor3;
+}
+
+float2 GetParticleTexCoord(float2 iCorner, float4 iParticle)
+{
+    float age = cParticleTime - iParticle.x;
+    float4 times = cParticleUVTimes;
+    float4 uv = age >= times.w ? cParticleUV3 : (age >= times.z ? cParticleUV2 : (age >= times.y ? cParticleUV1 : cParticleUV0));
+    return lerp(uv.xy, uv.zw, iCorner);
+}
+#endif
+
+#ifdef CDLOD
+// Quadtree terrain node. The grid vertex (iPos.xz) spans the node in the 0-1 range and the model matrix maps it to the
+// node's area. Heights are fetched from the height tile texture and the odd grid vertices morph to the next coarser LOD
+// level as the camera distance approaches the end of the node's LOD range. Requires vertex texture fetch (D3D11)
+Texture2D tHeightMap : register(t7);
+
+float GetTerrainHeight(float3 flatPos, float2 texelOffset)
+{
+    float4 pos = float4(flatPos, 1.0);
+    float2 texel = float2(dot(pos, cTerrainTexelX), dot(pos, cTerrainTexelZ)) + texelOffset;
+    return tHeightMap.Load(int3(floor(texel + 0.5), 0)).r;
+}
+
+float4 GetTerrainGridPos(float4 iPos, float4x3 modelMatrix)
+{
+    float4 gridPos = float4(iPos.x, 0.0, iPos.z, 1.0);
+    float3 flatPos = mul(gridPos, modelMatrix);
+    float3 heightAxis = mul(float4(0.0, 1.0, 0.0, 0.0), modelMatrix);
+    float nodeSize = max(length(mul(float4(1.0, 0.0, 0.0, 0.0), modelMatrix)),
+        length(mul(float4(0.0, 0.0, 1.0, 0.0), modelMatrix)));
+    float dist = distance(flatPos + heightAxis * GetTerrainHeight(flatPos, float2(0.0, 0.0)), cCameraPos);
+    float morph = saturate((dist / nodeSize - cTerrainMorph.x) / (cTerrainMorph.y - cTerrainMorph.x));
+    gridPos.xz -= frac(gridPos.xz * cTerrainMorph.z * 0.5) * 2.0 / cTerrainMorph.z * morph;
+    return gridPos;
+}
+
+float3 GetTerrainPos(float4 iPos, float4x3 modelMatrix)
+{
+    float4 gridPos = GetTerrainGridPos(iPos, modelMatrix);
+    gridPos.y = GetTerrainHeight(mul(gridPos, modelMatrix), float2(0.0, 0.0));
+    return mul(gridPos, modelMatrix);
+}
+
+float3 GetTerrainNormal(float4 iPos, float4x3 modelMatrix)
+{
+    float4 gridPos = GetTerrainGridPos(iPos, modelMatrix);
+    float3 flatPos = mul(gridPos, modelMatrix);
+    // Central differences over one height texel, which is one grid quad
+    float halfGrid = 0.5 * cTerrainMorph.z;
+    float dx = (GetTerrainHeight(flatPos, float2(1.0, 0.0)) - GetTerrainHeight(flatPos, float2(-1.0, 0.0))) * halfGrid;
+    float dz = (GetTerrainHeight(flatPos, float2(0.0, 1.0)) - GetTerrainHeight(flatPos, float2(0.0, -1.0))) * halfGrid;
+    float3 tangentX = mul(float4(1.0, dx, 0.0, 0.0), modelMatrix);
+    float3 tangentZ = mul(float4(0.0, dz, 1.0, 0.0), modelMatrix);
+    return normalize(cross(tangentZ, tangentX));
+}
+
+float2 GetTerrainTexCoord(float4 iPos, float4x3 modelMatrix)
+{
+    float4 pos = float4(mul(GetTerrainGridPos(iPos, modelMatrix), modelMatrix), 1.0);
+    return float2(dot(pos, cTerrainUVX), dot(pos, cTerrainUVZ));
+}
+#endif
+
+#ifdef TEXARRAY
+// Texture array layers of the instances, packed four to a vector. Non-instanced draws use the first element
+float GetArrayLayer(uint instanceID)
+{
+    return cArrayLayers[instanceID / 4][instanceID % 4];
+}
+#endif
+
+#if defined(SKININSTANCED)
+    #define iModelMatrix GetSkinInstanceMatrix(iBlendWeights, iBlendIndices, iInstanceID);
+#elif defined(SKINNED)
     #define iModelMatrix GetSkinMatrix(iBlendWeights, iBlendIndices);
 #elif defined(INSTANCED)
     #define iModelMatrix iModelInstance
@@ -58,12 +290,20 @@ float3 GetBillboardNormal()
 
 #ifdef BILLBOARD
     #define GetWorldPos(modelMatrix) GetBillboardPos(iPos, iSize, modelMatrix)
+#elif defined(GPUPARTICLE)
+    #define GetWorldPos(modelMatrix) GetParticlePos(iPos, iNormal, iTexCoord, iSize, iTangent, modelMatrix)
+#elif defined(INSTANCEDBILLBOARD)
+    #define GetWorldPos(modelMatrix) GetInstancedBillboardPos(iPos, iInstanceMatrix1, iInstanceMatrix2, modelMatrix)
+#elif defined(CDLOD)
+    #define GetWorldPos(modelMatrix) GetTerrainPos(iPos, modelMatrix)
 #else
     #define GetWorldPos(modelMatrix) mul(iPos, modelMatrix)
 #endif
 
-#ifdef BILLBOARD
+#if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
     #define GetWorldNormal(modelMatrix) GetBillboardNormal()
+#elif defined(CDLOD)
+    #define GetWorldNormal(modelMatrix) GetTerrainNormal(iPos, modelMatrix)
 #else
     #define GetWorldNormal(modelMatrix) normalize(mul(iNormal, (float3x3)modelMatrix))
 #endif
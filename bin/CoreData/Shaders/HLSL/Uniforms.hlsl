@@ -7,7 +7,7 @@
 // Vertex shader uniforms
 uniform float3 cAmbientStartColor;
 uniform float3 cAmbientEndColor;
-#ifdef BILLBOARD
+#if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
 uniform float3x3 cBillboardRot;
 #endif
 uniform float3 cCameraPos;
@@ -27,7 +27,11 @@ uniform float4 cUOffset;
 uniform float4 cVOffset;
 uniform float4x3 cZone;
 #ifdef SKINNED
-    uniform float4x3 cSkinMatrices[MAXBONES];
+    #ifdef SKINTEXTURE
+        uniform float cSkinMatrixOffset;
+    #else
+        uniform float4x3 cSkinMatrices[MAXBONES];
+    #endif
 #endif
 #ifdef NUMVERTEXLIGHTS
     uniform float4 cVertexLights[4*3];
@@ -41,6 +45,8 @@ uniform float4x3 cZone;
 // Pixel shader uniforms
 uniform float3 cAmbientColor;
 uniform float3 cCameraPosPS;
+uniform float4 cClusterParams;
+uniform float4x4 cClusterViewProj;
 uniform float cDeltaTimePS;
 uniform float4 cDepthReconstruct;
 uniform float cElapsedTimePS;
@@ -57,6 +63,7 @@ uniform float4 cMatSpecColor;
 uniform float cNearClipPS;
 uniform float cFarClipPS;
 uniform float4 cShadowCubeAdjust;
+uniform float2 cShadowCubeScale;
 uniform float4 cShadowDepthFade;
 uniform float2 cShadowIntensity;
 uniform float2 cShadowMapInvSize;
@@ -113,17 +120,31 @@ cbuffer MaterialVS : register(b4)
 {
     float4 cUOffset;
     float4 cVOffset;
+#ifdef CDLOD
+    float4 cTerrainTexelX;
+    float4 cTerrainTexelZ;
+    float4 cTerrainUVX;
+    float4 cTerrainUVZ;
+    float3 cTerrainMorph;
+#endif
 }
 #endif
 
 cbuffer ObjectVS : register(b5)
 {
     float4x3 cModel;
-#ifdef BILLBOARD
+#if defined(BILLBOARD) || defined(GPUPARTICLE) || defined(INSTANCEDBILLBOARD)
     float3x3 cBillboardRot;
 #endif
 #ifdef SKINNED
-    uniform float4x3 cSkinMatrices[MAXBONES];
+    #ifdef SKINTEXTURE
+        float cSkinMatrixOffset;
+    #else
+        uniform float4x3 cSkinMatrices[MAXBONES];
+    #endif
+#endif
+#ifdef TEXARRAY
+    float4 cArrayLayers[32];
 #endif
 }
 #endif
@@ -144,6 +165,8 @@ cbuffer CameraPS : register(b1)
     float2 cGBufferInvSize;
     float cNearClipPS;
     float cFarClipPS;
+    float4 cClusterParams;
+    float4x4 cClusterViewProj;
 }
 
 cbuffer ZonePS : register(b2)
@@ -159,6 +182,7 @@ cbuffer LightPS : register(b3)
     float4 cLightPosPS;
     float3 cLightDirPS;
     float4 cShadowCubeAdjust;
+    float2 cShadowCubeScale;
     float4 cShadowDepthFade;
     float2 cShadowIntensity;
     float2 cShadowMapInvSize;